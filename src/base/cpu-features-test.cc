@@ -0,0 +1,69 @@
+// base/cpu-features-test.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstring>
+
+#include "base/cpu-features.h"
+#include "base/kaldi-common.h"
+
+namespace kaldi {
+
+void TestCpuSimdLevel() {
+  CpuSimdLevel level = GetCpuSimdLevel();
+  KALDI_ASSERT(level >= kSimdGeneric && level <= kSimdAvx512);
+  // The decision is made once and cached.
+  KALDI_ASSERT(GetCpuSimdLevel() == level);
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__)
+  // On x86-64 the detected level is at least sse2, so anything lower can
+  // only come from the KALDI_SIMD override.
+  const char *override_str = getenv("KALDI_SIMD");
+  if (override_str == NULL || override_str[0] == '\0')
+    KALDI_ASSERT(level >= kSimdSse2);
+#endif
+  KALDI_LOG << "Level is " << CpuSimdLevelToString(level);
+}
+
+void TestCpuSimdLevelToString() {
+  const CpuSimdLevel levels[] = { kSimdGeneric, kSimdSse2, kSimdAvx,
+                                  kSimdAvx2, kSimdAvx512 };
+  for (size_t i = 0; i < sizeof(levels) / sizeof(levels[0]); i++) {
+    const char *str = CpuSimdLevelToString(levels[i]);
+    KALDI_ASSERT(str != NULL && strlen(str) > 0);
+    for (size_t j = 0; j < i; j++)  // names are distinct.
+      KALDI_ASSERT(strcmp(str, CpuSimdLevelToString(levels[j])) != 0);
+  }
+}
+
+void TestCpuDispatchReport() {
+  std::string report = CpuDispatchReport();
+  KALDI_ASSERT(report.find("cpu-dispatch:") != std::string::npos);
+  KALDI_ASSERT(
+      report.find(CpuSimdLevelToString(GetCpuSimdLevel())) !=
+      std::string::npos);
+  KALDI_LOG << report;
+}
+
+}  // end namespace kaldi.
+
+int main() {
+  kaldi::TestCpuSimdLevel();
+  kaldi::TestCpuSimdLevelToString();
+  kaldi::TestCpuDispatchReport();
+  KALDI_LOG << "Test OK.";
+}
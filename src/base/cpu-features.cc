@@ -0,0 +1,113 @@
+// base/cpu-features.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/cpu-features.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+#include "base/kaldi-error.h"
+
+namespace kaldi {
+
+const char *CpuSimdLevelToString(CpuSimdLevel level) {
+  switch (level) {
+    case kSimdGeneric: return "generic";
+    case kSimdSse2: return "sse2";
+    case kSimdAvx: return "avx";
+    case kSimdAvx2: return "avx2";
+    case kSimdAvx512: return "avx512";
+  }
+  return "unknown";  // suppresses a compiler warning; cannot be reached.
+}
+
+// Returns the highest level this CPU supports.  The __builtin_cpu_supports
+// guard mirrors the one in matrix/simd-vector-kernels.h: we only compile
+// SIMD variants with GCC on x86-64, where SSE2 is part of the ABI.
+static CpuSimdLevel DetectCpuSimdLevel() {
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && \
+    (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 8))
+  CpuSimdLevel level = kSimdSse2;
+  if (__builtin_cpu_supports("avx")) level = kSimdAvx;
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    level = kSimdAvx2;
+#if __GNUC__ >= 5  // __builtin_cpu_supports("avx512f") needs GCC >= 5.
+  if (level == kSimdAvx2 && __builtin_cpu_supports("avx512f"))
+    level = kSimdAvx512;
+#endif
+  return level;
+#else
+  return kSimdGeneric;  // no hand-written kernels on this configuration.
+#endif
+}
+
+// Parses a KALDI_SIMD value; returns true and sets *level on success.
+static bool StringToCpuSimdLevel(const char *str, CpuSimdLevel *level) {
+  static const CpuSimdLevel levels[] = { kSimdGeneric, kSimdSse2, kSimdAvx,
+                                         kSimdAvx2, kSimdAvx512 };
+  for (size_t i = 0; i < sizeof(levels) / sizeof(levels[0]); i++) {
+    if (strcmp(str, CpuSimdLevelToString(levels[i])) == 0) {
+      *level = levels[i];
+      return true;
+    }
+  }
+  return false;
+}
+
+// Applies the KALDI_SIMD override (if any) to the detected level; factored
+// out of GetCpuSimdLevel() so it runs exactly once, inside the static
+// initializer.
+static CpuSimdLevel ChooseCpuSimdLevel() {
+  CpuSimdLevel detected = DetectCpuSimdLevel();
+  const char *override_str = std::getenv("KALDI_SIMD");
+  if (override_str == NULL || override_str[0] == '\0')
+    return detected;
+  CpuSimdLevel requested;
+  if (!StringToCpuSimdLevel(override_str, &requested)) {
+    KALDI_WARN << "Ignoring unrecognized KALDI_SIMD value '" << override_str
+               << "' (expected one of: generic, sse2, avx, avx2, avx512).";
+    return detected;
+  }
+  if (requested > detected) {
+    KALDI_WARN << "KALDI_SIMD=" << override_str << " requests a level this "
+               << "CPU does not support; using the detected level "
+               << CpuSimdLevelToString(detected) << " instead.";
+    return detected;
+  }
+  return requested;
+}
+
+CpuSimdLevel GetCpuSimdLevel() {
+  static const CpuSimdLevel level = ChooseCpuSimdLevel();
+  return level;
+}
+
+std::string CpuDispatchReport() {
+  std::ostringstream os;
+  os << "cpu-dispatch: using " << CpuSimdLevelToString(GetCpuSimdLevel())
+     << " (detected: " << CpuSimdLevelToString(DetectCpuSimdLevel());
+  const char *override_str = std::getenv("KALDI_SIMD");
+  if (override_str != NULL && override_str[0] != '\0')
+    os << ", KALDI_SIMD=" << override_str;
+  os << ")";
+  return os.str();
+}
+
+}  // namespace kaldi
@@ -0,0 +1,71 @@
+// base/cpu-features.h
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_BASE_CPU_FEATURES_H_
+#define KALDI_BASE_CPU_FEATURES_H_
+
+#include <string>
+
+namespace kaldi {
+
+/// \file cpu-features.h
+/// Runtime CPU dispatch for the hand-written SIMD kernels (see
+/// matrix/simd-vector-kernels.h and the fused kernel in gmm/diag-gmm.cc).
+/// Those kernels are compiled in several instruction-set variants in one
+/// binary; this header centralizes the decision of which variant to run, so
+/// that one container image can serve a mixed fleet of machines.  The level
+/// is detected once, by CPUID, the first time GetCpuSimdLevel() is called;
+/// the environment variable KALDI_SIMD (one of "generic", "sse2", "avx",
+/// "avx2", "avx512") can lower it, which is useful for benchmarking the
+/// variants against each other and for working around CPU errata.  New
+/// dispatched kernels should consult GetCpuSimdLevel() rather than calling
+/// __builtin_cpu_supports() themselves, so the override keeps working.
+
+/// The instruction-set levels we dispatch between.  Each level implies the
+/// previous ones; kSimdAvx2 also implies FMA (we have no use for AVX2
+/// without it).  kSimdGeneric means the hand-written kernels are disabled
+/// altogether and the scalar/BLAS code paths run instead; on x86-64 the
+/// detected level is always at least kSimdSse2, so kSimdGeneric only arises
+/// from the KALDI_SIMD override or on other architectures.
+typedef enum {
+  kSimdGeneric = 0,
+  kSimdSse2 = 1,
+  kSimdAvx = 2,
+  kSimdAvx2 = 3,
+  kSimdAvx512 = 4
+} CpuSimdLevel;
+
+/// Returns the SIMD level the dispatched kernels should use.  Detected from
+/// CPUID on the first call and cached; honors the KALDI_SIMD environment
+/// variable, which can only lower the level (asking for a level the CPU
+/// does not support gets a warning and the detected level).
+CpuSimdLevel GetCpuSimdLevel();
+
+/// Returns the name of a level, e.g. "avx2"; inverse of the KALDI_SIMD
+/// values.
+const char *CpuSimdLevelToString(CpuSimdLevel level);
+
+/// Returns a one-line human-readable report of the dispatch decision, e.g.
+/// "cpu-dispatch: using avx2 (detected: avx512, KALDI_SIMD=avx2)"; printed
+/// by the --version output of the command-line tools.
+std::string CpuDispatchReport();
+
+}  // namespace kaldi
+
+#endif  // KALDI_BASE_CPU_FEATURES_H_
@@ -153,18 +153,38 @@ void WriteToken(std::ostream &os, bool binary, const std::string & token) {
 
 void ReadToken(std::istream &is, bool binary, std::string *str) {
   KALDI_ASSERT(str != NULL);
-  if (!binary) is >> std::ws;  // consume whitespace.
-  is >> *str;
-  if (is.fail()) {
+  // We read through the streambuf directly: this avoids the overhead of
+  // operator>> (sentry construction, locale handling) and any allocation for
+  // tokens that fit in the buffer below, which matters because model files
+  // contain a token for nearly every member of every object.
+  std::streambuf *buf = is.rdbuf();
+  int ch;
+  do {  // Consume whitespace.  This is needed in binary mode too, since
+        // WriteToken terminates each token with a space.
+    ch = buf->sbumpc();
+  } while (ch != EOF && isspace(ch));
+  char tmp[256];
+  size_t len = 0;
+  while (ch != EOF && !isspace(ch) && len < sizeof(tmp)) {
+    tmp[len++] = static_cast<char>(ch);
+    ch = buf->sbumpc();
+  }
+  if (len == 0) {
+    is.setstate(std::ios_base::failbit);
     KALDI_ERR << "ReadToken, failed to read token at file position "
               << is.tellg();
   }
-  if (!isspace(is.peek())) {
-    KALDI_ERR << "ReadToken, expected space after token, saw instead "
-              << static_cast<char>(is.peek())
+  str->assign(tmp, len);
+  while (ch != EOF && !isspace(ch)) {  // token did not fit in tmp; unusual.
+    *str += static_cast<char>(ch);
+    ch = buf->sbumpc();
+  }
+  if (ch == EOF) {
+    is.setstate(std::ios_base::eofbit);
+    KALDI_ERR << "ReadToken, expected space after token, saw EOF"
               << ", at file position " << is.tellg();
   }
-  is.get();  // consume the space.
+  // ... and the terminating whitespace character has been consumed.
 }
 
 int PeekToken(std::istream &is, bool binary) {
@@ -189,18 +209,33 @@ void ExpectToken(std::istream &is, bool binary, const char *token) {
   int pos_at_start = is.tellg();
   KALDI_ASSERT(token != NULL);
   CheckToken(token);  // make sure it's valid (can be read back)
-  if (!binary) is >> std::ws;  // consume whitespace.
-  std::string str;
-  is >> str;
-  is.get();  // consume the space.
-  if (is.fail()) {
+  // Match the expected token (normally a string literal) directly against
+  // the stream, without reading into a temporary std::string; see the
+  // comment in ReadToken() above.
+  std::streambuf *buf = is.rdbuf();
+  int ch;
+  do {  // consume whitespace.
+    ch = buf->sbumpc();
+  } while (ch != EOF && isspace(ch));
+  const char *p = token;
+  while (*p != '\0' && ch == static_cast<unsigned char>(*p)) {
+    p++;
+    ch = buf->sbumpc();
+  }
+  if (*p == '\0' && ch != EOF && isspace(ch))
+    return;  // matched; the terminating whitespace has been consumed.
+  if (ch == EOF) {
+    is.setstate(std::ios_base::eofbit | std::ios_base::failbit);
     KALDI_ERR << "Failed to read token [started at file position "
               << pos_at_start << "], expected " << token;
   }
-  if (strcmp(str.c_str(), token) != 0) {
-    KALDI_ERR << "Expected token \"" << token << "\", got instead \""
-              << str <<"\".";
+  std::string str(token, p - token);  // what we actually saw: the matched
+  while (ch != EOF && !isspace(ch)) {  // prefix plus the rest of the token.
+    str += static_cast<char>(ch);
+    ch = buf->sbumpc();
   }
+  KALDI_ERR << "Expected token \"" << token << "\", got instead \""
+            << str <<"\".";
 }
 
 void ExpectToken(std::istream &is, bool binary, const std::string &token) {
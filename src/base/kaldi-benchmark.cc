@@ -0,0 +1,170 @@
+// base/kaldi-benchmark.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <fstream>
+#include <sstream>
+
+#include "base/kaldi-benchmark.h"
+#include "base/timer.h"
+
+namespace kaldi {
+
+BenchmarkRegistry *BenchmarkRegistry::Instance() {
+  static BenchmarkRegistry registry;
+  return &registry;
+}
+
+void BenchmarkRegistry::Register(const std::string &name,
+                                 BenchmarkFunc func) {
+  KALDI_ASSERT(func != NULL);
+  for (size_t i = 0; i < benchmarks_.size(); i++)
+    if (benchmarks_[i].first == name)
+      KALDI_ERR << "Benchmark registered twice: " << name;
+  benchmarks_.push_back(std::make_pair(name, func));
+}
+
+BenchmarkResult BenchmarkRegistry::RunOne(const std::string &name,
+                                          BenchmarkFunc func,
+                                          const BenchmarkOptions &opts) const {
+  for (int32 i = 0; i < opts.warmup_iters; i++)
+    func();
+  BenchmarkResult result;
+  result.name = name;
+  result.num_iters = 0;
+  double measured = 0.0;
+  // run in batches, growing the batch size until a batch takes a measurable
+  // fraction of opts.min_seconds, so timer overhead doesn't bias fast
+  // operations.
+  int64 batch = 1;
+  Timer timer;
+  while (measured < opts.min_seconds) {
+    timer.Reset();
+    for (int64 i = 0; i < batch; i++)
+      func();
+    double batch_seconds = timer.Elapsed();
+    measured += batch_seconds;
+    result.num_iters += batch;
+    if (batch_seconds < opts.min_seconds * 0.1)
+      batch *= 2;
+  }
+  result.seconds_per_iter = measured / result.num_iters;
+  return result;
+}
+
+void BenchmarkRegistry::RunAll(const BenchmarkOptions &opts,
+                               std::ostream &os) const {
+  std::string environment = BenchmarkEnvironmentInfo();
+  std::vector<BenchmarkResult> results;
+  for (size_t i = 0; i < benchmarks_.size(); i++) {
+    const std::string &name = benchmarks_[i].first;
+    if (!opts.filter.empty() && name.find(opts.filter) == std::string::npos)
+      continue;
+    KALDI_LOG << "Running benchmark " << name;
+    results.push_back(RunOne(name, benchmarks_[i].second, opts));
+  }
+  if (opts.format == "json") {
+    os << "{\n  \"environment\": {\n";
+    std::istringstream env(environment);
+    std::string line;
+    bool first = true;
+    while (std::getline(env, line)) {
+      size_t pos = line.find('=');
+      if (pos == std::string::npos) continue;
+      if (!first) os << ",\n";
+      first = false;
+      os << "    \"" << line.substr(0, pos) << "\": \""
+         << line.substr(pos + 1) << "\"";
+    }
+    os << "\n  },\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+      os << "    { \"name\": \"" << results[i].name << "\", \"num_iters\": "
+         << results[i].num_iters << ", \"seconds_per_iter\": "
+         << results[i].seconds_per_iter << " }"
+         << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    os << "  ]\n}\n";
+  } else if (opts.format == "csv") {
+    std::istringstream env(environment);
+    std::string line;
+    while (std::getline(env, line))
+      os << "# " << line << '\n';
+    os << "name,num_iters,seconds_per_iter,iters_per_second\n";
+    for (size_t i = 0; i < results.size(); i++) {
+      os << results[i].name << ',' << results[i].num_iters << ','
+         << results[i].seconds_per_iter << ','
+         << (results[i].seconds_per_iter > 0.0 ?
+             1.0 / results[i].seconds_per_iter : 0.0) << '\n';
+    }
+  } else {
+    KALDI_ERR << "Unknown benchmark output format '" << opts.format
+              << "': expected \"csv\" or \"json\".";
+  }
+}
+
+std::string BenchmarkEnvironmentInfo() {
+  std::ostringstream os;
+#if defined(__VERSION__)
+  os << "compiler=" << __VERSION__ << '\n';
+#else
+  os << "compiler=unknown\n";
+#endif
+#if (KALDI_DOUBLEPRECISION != 0)
+  os << "base_float=double\n";
+#else
+  os << "base_float=float\n";
+#endif
+#if defined(HAVE_MKL)
+  os << "blas=mkl\n";
+#elif defined(HAVE_ATLAS)
+  os << "blas=atlas\n";
+#elif defined(HAVE_OPENBLAS)
+  os << "blas=openblas\n";
+#elif defined(HAVE_CLAPACK)
+  os << "blas=clapack\n";
+#else
+  os << "blas=unknown\n";
+#endif
+  // CPU model and SIMD features, where /proc/cpuinfo exists (i.e. on Linux).
+  std::string cpu_model = "unknown", cpu_flags;
+  std::ifstream cpuinfo("/proc/cpuinfo");
+  std::string line;
+  while (std::getline(cpuinfo, line)) {
+    size_t pos = line.find(':');
+    if (pos == std::string::npos) continue;
+    std::string key = line.substr(0, line.find('\t')),
+        value = (pos + 2 <= line.size() ? line.substr(pos + 2) : "");
+    if (key == "model name" && cpu_model == "unknown") cpu_model = value;
+    if (key == "flags" && cpu_flags.empty()) {
+      // keep only the flags that matter for kernel speed.
+      const char *interesting[] = { "sse2", "sse4_1", "sse4_2", "avx",
+                                    "avx2", "fma", "avx512f", NULL };
+      for (int32 i = 0; interesting[i] != NULL; i++)
+        if (value.find(interesting[i]) != std::string::npos)
+          cpu_flags += (cpu_flags.empty() ? "" : " ") +
+              std::string(interesting[i]);
+    }
+    if (cpu_model != "unknown" && !cpu_flags.empty())
+      break;  // one processor block is enough.
+  }
+  os << "cpu_model=" << cpu_model << '\n'
+     << "cpu_simd_flags=" << cpu_flags << '\n';
+  return os.str();
+}
+
+}  // namespace kaldi
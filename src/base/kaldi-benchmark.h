@@ -0,0 +1,103 @@
+// base/kaldi-benchmark.h
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_BASE_KALDI_BENCHMARK_H_
+#define KALDI_BASE_KALDI_BENCHMARK_H_
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "base/kaldi-common.h"
+
+namespace kaldi {
+
+/// \file kaldi-benchmark.h
+/// A small harness for micro-benchmarks, used by e.g. matrix-benchmark.cc.
+/// Benchmark functions register themselves with the KALDI_BENCHMARK macro;
+/// the harness handles warm-up, runs each function repeatedly until enough
+/// wall time has been measured, and writes results in CSV or JSON form
+/// together with a record of the build and machine (compiler, BLAS library,
+/// CPU model and SIMD features), so numbers from different builds can be
+/// diffed meaningfully.
+
+/// A benchmark function does one iteration of the operation being measured
+/// each time it is called; the harness does the timing.
+typedef void (*BenchmarkFunc)();
+
+struct BenchmarkOptions {
+  int32 warmup_iters;   // untimed calls of each benchmark before measuring.
+  BaseFloat min_seconds;  // keep iterating until this much time is measured.
+  std::string filter;   // if nonempty, run only benchmarks whose name
+                        // contains this substring.
+  std::string format;   // "csv" or "json".
+
+  BenchmarkOptions(): warmup_iters(3), min_seconds(1.0), format("csv") { }
+};
+
+struct BenchmarkResult {
+  std::string name;
+  int64 num_iters;
+  double seconds_per_iter;
+};
+
+class BenchmarkRegistry {
+ public:
+  /// Returns the single global registry (created on first use).
+  static BenchmarkRegistry *Instance();
+
+  /// Registers a benchmark; normally called via the KALDI_BENCHMARK macro.
+  void Register(const std::string &name, BenchmarkFunc func);
+
+  /// Runs all registered benchmarks that match opts.filter and writes the
+  /// results to "os" in the format given by opts.format, preceded by the
+  /// environment record.  Progress is logged to stderr.
+  void RunAll(const BenchmarkOptions &opts, std::ostream &os) const;
+
+ private:
+  BenchmarkRegistry() { }
+  BenchmarkResult RunOne(const std::string &name, BenchmarkFunc func,
+                         const BenchmarkOptions &opts) const;
+
+  std::vector<std::pair<std::string, BenchmarkFunc> > benchmarks_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(BenchmarkRegistry);
+};
+
+/// Helper whose constructor registers a benchmark; see KALDI_BENCHMARK.
+struct BenchmarkRegisterer {
+  BenchmarkRegisterer(const std::string &name, BenchmarkFunc func) {
+    BenchmarkRegistry::Instance()->Register(name, func);
+  }
+};
+
+/// Put KALDI_BENCHMARK(MyFunction); at file scope to register the function
+/// void MyFunction() as a benchmark named "MyFunction".
+#define KALDI_BENCHMARK(func) \
+  static ::kaldi::BenchmarkRegisterer kaldi_benchmark_registerer_ ## func( \
+      #func, func)
+
+/// Returns "key=value" lines describing the build and machine: compiler
+/// version, floating-point precision, which BLAS implementation was compiled
+/// in, and the CPU model and SIMD-related flags (from /proc/cpuinfo, where
+/// available).
+std::string BenchmarkEnvironmentInfo();
+
+}  // namespace kaldi
+
+#endif  // KALDI_BASE_KALDI_BENCHMARK_H_
@@ -38,6 +38,22 @@ void UnitTestError() {
   }
 }
 
+void UnitTestAsyncLogging() {
+  EnableAsyncLogging();
+  for (int32 i = 0; i < 1000; i++)
+    KALDI_LOG << "Ignore this message (async logging test, " << i << ")";
+  KALDI_WARN << "Ignore this warning (async logging test)";
+  SetVerboseLevel(2);
+  KALDI_VLOG(2) << "Ignore this vlog message (async logging test)";
+  SetVerboseLevel(0);
+  try {  // KALDI_ERR should still throw synchronously in async mode.
+    std::cerr << "Ignore next error:\n";
+    KALDI_ERR << "Ignore this error (async logging test)";
+    KALDI_ASSERT(0);  // should not happen.
+  } catch(std::runtime_error &r) { }
+  DisableAsyncLogging();
+  KALDI_LOG << "Back in synchronous mode (ignore this message)";
+}
 
 }  // end namespace kaldi.
 
@@ -49,5 +65,6 @@ int main() {
   } catch(std::runtime_error &r) {
     std::cout << "UnitTestError: the error we generated was: " << r.what();
   }
+  kaldi::UnitTestAsyncLogging();
 }
 
@@ -28,12 +28,19 @@
 #endif  // HAVE_CXXABI_H
 #endif  // HAVE_EXECINFO_H
 
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <ostream>
+
 #include "base/kaldi-common.h"
 #include "base/kaldi-error.h"
 
 namespace kaldi {
 int32 g_kaldi_verbose_level = 0;  // Just initialize this global variable.
 const char *g_program_name = NULL;
+bool g_kaldi_async_logging = false;
 
 // If the program name was set (g_program_name != ""), the function
 // GetProgramName returns the program name (without the path) followed by a
@@ -59,6 +66,169 @@ const char *GetShortFileName(const char *filename) {
 }
 
 
+// The code between here and KaldiGetStackTrace implements the asynchronous
+// logging mode (see EnableAsyncLogging() in kaldi-error.h).  The calling
+// thread formats each message into a preallocated thread-local buffer, then
+// copies it into a slot of a fixed-size multi-producer single-consumer ring;
+// a background thread prints the slots to stderr in order.  We cannot use
+// anything from thread/ here (base/ must not depend on other directories),
+// so this uses raw pthreads and the GCC __sync builtins.
+
+static const int32 kAsyncLogMsgBytes = 2048;  // max message size; longer
+                                              // messages are truncated.
+static const int32 kAsyncLogRingSize = 1024;  // must be a power of two.
+
+struct AsyncLogSlot {
+  volatile int64 seq;  // sequencing variable of the ring protocol; see
+                       // AsyncLogEnqueue() and AsyncLogFlusherMain().
+  char msg[kAsyncLogMsgBytes];
+};
+
+static AsyncLogSlot *g_async_log_ring = NULL;
+static volatile int64 g_async_log_write_pos = 0;  // next slot to be claimed.
+static volatile int64 g_async_log_read_pos = 0;  // next slot to be printed;
+                                                 // only the flusher writes it.
+static volatile int32 g_async_log_stop = 0;
+static pthread_t g_async_log_thread;
+static bool g_async_log_atexit_registered = false;
+
+// A streambuf over a fixed-size buffer; anything written past the end is
+// silently discarded, so formatting a message never allocates.
+class AsyncLogStreambuf : public std::streambuf {
+ public:
+  AsyncLogStreambuf() { setp(buf_, buf_ + kAsyncLogMsgBytes - 1); }
+  const char *data() const { return buf_; }
+  int32 size() const { return static_cast<int32>(pptr() - pbase()); }
+  void Reset() { setp(buf_, buf_ + kAsyncLogMsgBytes - 1); }
+ protected:
+  virtual int overflow(int c) {  // buffer full -> truncate the message.
+    return traits_type::not_eof(c);
+  }
+ private:
+  char buf_[kAsyncLogMsgBytes];
+};
+
+// The per-thread formatting buffer, allocated the first time each thread
+// logs in asynchronous mode and freed when the thread exits.
+struct AsyncLogThreadLocal {
+  AsyncLogStreambuf streambuf;
+  std::ostream stream;
+  AsyncLogThreadLocal(): stream(&streambuf) { }
+};
+
+static pthread_key_t g_async_log_key;
+static pthread_once_t g_async_log_key_once = PTHREAD_ONCE_INIT;
+
+static void AsyncLogDestroyThreadLocal(void *ptr) {
+  delete static_cast<AsyncLogThreadLocal*>(ptr);
+}
+static void AsyncLogCreateKey() {
+  pthread_key_create(&g_async_log_key, AsyncLogDestroyThreadLocal);
+}
+
+static AsyncLogThreadLocal *AsyncLogGetThreadLocal() {
+  pthread_once(&g_async_log_key_once, AsyncLogCreateKey);
+  AsyncLogThreadLocal *tls = static_cast<AsyncLogThreadLocal*>(
+      pthread_getspecific(g_async_log_key));
+  if (tls == NULL) {
+    tls = new AsyncLogThreadLocal();
+    pthread_setspecific(g_async_log_key, tls);
+  }
+  return tls;
+}
+
+// Copies one formatted message into the ring.  A slot with seq == pos is
+// free for the producer that claimed position pos; the producer sets
+// seq = pos + 1 to publish it, and the flusher sets seq = pos +
+// kAsyncLogRingSize after printing, freeing the slot for the producer that
+// will claim it next.  If the ring is full we wait for the flusher rather
+// than dropping the message.
+static void AsyncLogEnqueue(const char *msg, int32 len) {
+  while (len > 0 && msg[len - 1] == '\n')  // strip trailing newlines, as the
+    len--;                                 // synchronous destructors do.
+  if (len > kAsyncLogMsgBytes - 1)
+    len = kAsyncLogMsgBytes - 1;
+  int64 pos = __sync_fetch_and_add(&g_async_log_write_pos, 1);
+  AsyncLogSlot *slot = &g_async_log_ring[pos & (kAsyncLogRingSize - 1)];
+  while (slot->seq != pos)
+    sched_yield();
+  memcpy(slot->msg, msg, len);
+  slot->msg[len] = '\0';
+  __sync_synchronize();  // make the message visible before publishing.
+  slot->seq = pos + 1;
+}
+
+static void *AsyncLogFlusherMain(void *) {
+  while (true) {
+    int64 pos = g_async_log_read_pos;
+    AsyncLogSlot *slot = &g_async_log_ring[pos & (kAsyncLogRingSize - 1)];
+    if (slot->seq == pos + 1) {
+      __sync_synchronize();
+      fprintf(stderr, "%s\n", slot->msg);
+      __sync_synchronize();  // we are done with the slot; free it.
+      slot->seq = pos + kAsyncLogRingSize;
+      g_async_log_read_pos = pos + 1;
+    } else if (g_async_log_stop != 0 &&
+               g_async_log_read_pos == g_async_log_write_pos) {
+      break;
+    } else {
+      usleep(100);  // ring empty (or a producer is mid-copy); don't spin.
+    }
+  }
+  return NULL;
+}
+
+// Called from the constructors of the message classes below: returns the
+// stream the message should be formatted into (the thread-local buffer in
+// asynchronous mode, else the message's own ostringstream "ss").
+static std::ostream *AsyncLogBeginMessage(std::ostringstream *ss) {
+  if (!g_kaldi_async_logging) return ss;
+  AsyncLogThreadLocal *tls = AsyncLogGetThreadLocal();
+  tls->stream.clear();
+  tls->streambuf.Reset();
+  return &tls->stream;
+}
+
+// Called from the destructors when the message went to the thread-local
+// buffer: hands it off to the flusher thread.
+static void AsyncLogEndMessage() {
+  AsyncLogThreadLocal *tls = AsyncLogGetThreadLocal();
+  AsyncLogEnqueue(tls->streambuf.data(), tls->streambuf.size());
+}
+
+void EnableAsyncLogging() {
+  if (g_kaldi_async_logging) return;
+  if (g_async_log_ring == NULL)
+    g_async_log_ring = new AsyncLogSlot[kAsyncLogRingSize];
+  for (int32 i = 0; i < kAsyncLogRingSize; i++)
+    g_async_log_ring[i].seq = i;
+  g_async_log_write_pos = 0;
+  g_async_log_read_pos = 0;
+  g_async_log_stop = 0;
+  if (pthread_create(&g_async_log_thread, NULL, AsyncLogFlusherMain, NULL)
+      != 0) {
+    fprintf(stderr, "EnableAsyncLogging: could not create flusher thread; "
+            "logging stays synchronous.\n");
+    return;
+  }
+  if (!g_async_log_atexit_registered) {
+    atexit(DisableAsyncLogging);  // flush whatever is buffered at exit.
+    g_async_log_atexit_registered = true;
+  }
+  __sync_synchronize();
+  g_kaldi_async_logging = true;
+}
+
+void DisableAsyncLogging() {
+  if (!g_kaldi_async_logging) return;
+  g_kaldi_async_logging = false;  // new messages print synchronously.
+  __sync_synchronize();
+  g_async_log_stop = 1;
+  pthread_join(g_async_log_thread, NULL);  // the flusher drains the ring
+                                           // before exiting.
+}
+
+
 #if defined(HAVE_CXXABI_H) && defined(HAVE_EXECINFO_H)
 // The function name looks like a macro: it's a macro if we don't have ccxxabi.h
 inline void KALDI_APPEND_POSSIBLY_DEMANGLED_STRING(const char *to_append,
@@ -149,11 +319,16 @@ void KaldiAssertFailure_(const char *func, const char *file,
 
 KaldiWarnMessage::KaldiWarnMessage(const char *func, const char *file,
                                    int32 line) {
+  os_ = AsyncLogBeginMessage(&ss_);
   this->stream() << "WARNING (" << GetProgramName() << func << "():"
                  << GetShortFileName(file) << ':' << line << ") ";
 }
 
 KaldiWarnMessage::~KaldiWarnMessage() {
+  if (os_ != &ss_) {
+    AsyncLogEndMessage();
+    return;
+  }
   std::string str = ss_.str();
   while (!str.empty() && str[str.length() - 1] == '\n')
     str.resize(str.length() - 1);
@@ -163,11 +338,16 @@ KaldiWarnMessage::~KaldiWarnMessage() {
 
 KaldiLogMessage::KaldiLogMessage(const char *func, const char *file,
                                  int32 line) {
+  os_ = AsyncLogBeginMessage(&ss_);
   this->stream() << "LOG (" << GetProgramName() << func << "():"
                  << GetShortFileName(file) << ':' << line << ") ";
 }
 
 KaldiLogMessage::~KaldiLogMessage() {
+  if (os_ != &ss_) {
+    AsyncLogEndMessage();
+    return;
+  }
   std::string str = ss_.str();
   while (!str.empty() && str[str.length() - 1] == '\n')
     str.resize(str.length() - 1);
@@ -177,10 +357,19 @@ KaldiLogMessage::~KaldiLogMessage() {
 
 KaldiVlogMessage::KaldiVlogMessage(const char *func, const char *file,
                                    int32 line, int32 verbose) {
+  os_ = AsyncLogBeginMessage(&ss_);
   this->stream() << "VLOG[" << verbose << "] (" << GetProgramName() << func
                  << "():" << GetShortFileName(file) << ':' << line << ") ";
 }
 
+KaldiVlogMessage::~KaldiVlogMessage() {
+  if (os_ != &ss_) {
+    AsyncLogEndMessage();
+    return;
+  }
+  fprintf(stderr, "%s\n", ss_.str().c_str());
+}
+
 KaldiErrorMessage::KaldiErrorMessage(const char *func, const char *file,
                                      int32 line) {
   this->stream() << "ERROR (" << GetProgramName() << func << "():"
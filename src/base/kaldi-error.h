@@ -63,6 +63,28 @@ inline int32 GetVerboseLevel() { return g_kaldi_verbose_level; }
 /// automatically from ParseOptions.
 inline void SetVerboseLevel(int32 i) { g_kaldi_verbose_level = i; }
 
+/// This is true while asynchronous logging is enabled; see
+/// EnableAsyncLogging().  Do not set it directly.
+extern bool g_kaldi_async_logging;
+
+/// Switches KALDI_LOG, KALDI_WARN and KALDI_VLOG into asynchronous mode: the
+/// calling thread formats the message into a preallocated thread-local
+/// buffer (no allocation per message) and hands it to a background thread
+/// through a fixed-size lock-free ring, and that thread does the actual
+/// writing to stderr.  This keeps logging from perturbing latencies you are
+/// trying to measure, at the cost of messages appearing slightly later (and
+/// being truncated if longer than 2048 bytes).  KALDI_ERR and failed
+/// assertions always print synchronously, since they throw.  Call this once
+/// near the start of main(), before creating other threads; messages still
+/// buffered at exit are flushed.
+void EnableAsyncLogging();
+
+/// Flushes any pending messages, stops the background thread, and returns
+/// to the normal synchronous mode.  Called automatically at program exit if
+/// EnableAsyncLogging() was used; only call it yourself once no other
+/// threads are logging.
+void DisableAsyncLogging();
+
 // Class KaldiLogMessage is invoked from the  KALDI_WARN, KALDI_VLOG and
 // KALDI_LOG macros. It prints the message to stderr.  Note: we avoid
 // using cerr, due to problems with thread safety.  fprintf is guaranteed
@@ -71,21 +93,24 @@ inline void SetVerboseLevel(int32 i) { g_kaldi_verbose_level = i; }
 // class KaldiWarnMessage is invoked from the KALDI_WARN macro.
 class KaldiWarnMessage {
  public:
-  inline std::ostream &stream() { return ss_; }
+  inline std::ostream &stream() { return *os_; }
   KaldiWarnMessage(const char *func, const char *file, int32 line);
   ~KaldiWarnMessage();
  private:
-  std::ostringstream ss_;
+  std::ostringstream ss_;  // used in synchronous mode.
+  std::ostream *os_;  // points to ss_, or to a thread-local buffer if
+                      // asynchronous logging is enabled.
 };
 
 // class KaldiLogMessage is invoked from the KALDI_LOG macro.
 class KaldiLogMessage {
  public:
-  inline std::ostream &stream() { return ss_; }
+  inline std::ostream &stream() { return *os_; }
   KaldiLogMessage(const char *func, const char *file, int32 line);
   ~KaldiLogMessage();
  private:
-  std::ostringstream ss_;
+  std::ostringstream ss_;  // used in synchronous mode.
+  std::ostream *os_;  // as in KaldiWarnMessage.
 };
 
 // Class KaldiVlogMessage is invoked from the KALDI_VLOG macro.
@@ -93,10 +118,11 @@ class KaldiVlogMessage {
  public:
   KaldiVlogMessage(const char *func, const char *file, int32 line,
                    int32 verbose_level);
-  inline std::ostream &stream() { return ss_; }
-  ~KaldiVlogMessage() { fprintf(stderr, "%s\n", ss_.str().c_str()); }
+  inline std::ostream &stream() { return *os_; }
+  ~KaldiVlogMessage();
  private:
-  std::ostringstream ss_;
+  std::ostringstream ss_;  // used in synchronous mode.
+  std::ostream *os_;  // as in KaldiWarnMessage.
 };
 
 
@@ -163,8 +189,20 @@ class KaldiErrorMessage {
   kaldi::KaldiWarnMessage(__func__, __FILE__, __LINE__).stream()
 #define KALDI_LOG kaldi::KaldiLogMessage(__func__, __FILE__, __LINE__).stream()
 
-#define KALDI_VLOG(v) if (v <= kaldi::g_kaldi_verbose_level)     \
+// If KALDI_VLOG_MAX_LEVEL is defined (e.g. with -DKALDI_VLOG_MAX_LEVEL=1 in
+// CXXFLAGS), KALDI_VLOG calls above that level compile to nothing: the extra
+// condition is a compile-time constant, so the comparison against
+// g_kaldi_verbose_level (and the streaming of the arguments) is removed by
+// the compiler.  This is for performance-sensitive code where even the
+// level check at a VLOG site is unwelcome.
+#ifdef KALDI_VLOG_MAX_LEVEL
+#define KALDI_VLOG(v) \
+  if ((v) <= KALDI_VLOG_MAX_LEVEL && (v) <= kaldi::g_kaldi_verbose_level) \
            kaldi::KaldiVlogMessage(__func__, __FILE__, __LINE__, v).stream()
+#else
+#define KALDI_VLOG(v) if ((v) <= kaldi::g_kaldi_verbose_level)   \
+           kaldi::KaldiVlogMessage(__func__, __FILE__, __LINE__, v).stream()
+#endif
 
 inline bool IsKaldiError(const std::string &str) {
   return(!strncmp(str.c_str(), "ERROR ", 6));
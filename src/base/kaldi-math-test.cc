@@ -142,6 +142,44 @@ void UnitTestRand() {
             0.5*sqrt(static_cast<double>(j))*(maxint-minint)) break;
       }
     }
+    {  // test RandGaussBatched and RandUniformBatched.
+      float data[501];
+      int32 dim = 500 + i % 2;  // test both even and odd sizes.
+      RandUniformBatched(data, dim);
+      double sum = 0.0;
+      for (int32 j = 0; j < dim; j++) {
+        KALDI_ASSERT(data[j] > 0.0 && data[j] < 1.0);
+        sum += data[j];
+      }
+      KALDI_ASSERT(std::abs(sum / dim - 0.5) < 0.1);
+      RandGaussBatched(data, dim);
+      sum = 0.0;
+      double sumsq = 0.0;
+      for (int32 j = 0; j < dim; j++) {
+        sum += data[j];
+        sumsq += data[j] * data[j];
+      }
+      KALDI_ASSERT(std::abs(sum / dim) < 0.2);
+      KALDI_ASSERT(std::abs(sumsq / dim - 1.0) < 0.3);
+      // With an explicit RandomState, the output is a deterministic
+      // function of the seed.
+      RandomState state1, state2;
+      state2.seed = state1.seed;
+      double data2[501];
+      RandGaussBatched(data, dim, &state1);
+      RandGaussBatched(data2, dim, &state2);
+      for (int32 j = 0; j < dim; j++)
+        KALDI_ASSERT(data[j] == static_cast<float>(data2[j]));
+      // With a NULL state, srand() must control the output, since the
+      // fills are seeded from rand(); code like "srand(N); v.SetRandn();
+      // srand(N); w.SetRandn();" relies on getting identical vectors.
+      srand(104729);
+      RandGaussBatched(data, dim);
+      srand(104729);
+      RandGaussBatched(data2, dim);
+      for (int32 j = 0; j < dim; j++)
+        KALDI_ASSERT(data[j] == static_cast<float>(data2[j]));
+    }
     { // test RandPrune in basic way.
       KALDI_ASSERT(RandPrune(1.1, 1.0) == 1.1);
       KALDI_ASSERT(RandPrune(0.0, 0.0) == 0.0);
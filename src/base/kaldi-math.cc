@@ -42,6 +42,60 @@ int32 RoundUpToNearestPowerOfTwo(int32 n) {
 static pthread_mutex_t _RandMutex = PTHREAD_MUTEX_INITIALIZER;
 #endif
 
+// LocalRandState is a small xoroshiro128+ generator used by the batched
+// fill routines below: each batched call seeds one of these from rand()
+// (a single mutex-guarded draw) and then produces the whole fill from it
+// without further locking.  Because the seed is drawn from the C library's
+// generator, srand() still controls reproducibility exactly as it does for
+// Rand(): e.g. srand(N); v.SetRandn(); srand(N); v.SetRandn(); fills v
+// with identical values both times.  (Note: Rand() itself deliberately
+// keeps calling rand() under the mutex, rather than using a generator like
+// this seeded once per thread, because a thread-resident state would not
+// observe a later srand() and would break that reproducibility contract.)
+
+struct LocalRandState {
+  uint64 s[2];
+};
+
+static inline uint64 Rotl64(uint64 x, int k) {
+  return (x << k) | (x >> (64 - k));
+}
+
+static inline uint64 LocalRandNext(LocalRandState *ts) {
+  uint64 s0 = ts->s[0], s1 = ts->s[1], result = s0 + s1;
+  s1 ^= s0;
+  ts->s[0] = Rotl64(s0, 55) ^ s1 ^ (s1 << 14);
+  ts->s[1] = Rotl64(s1, 36);
+  return result;
+}
+
+// This is the "splitmix64" generator; we use it only to turn the seed into
+// a well-mixed initial state for xoroshiro128+.
+static inline uint64 SplitMix64(uint64 *x) {
+  uint64 z = (*x += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+static void SeedLocalRandState(LocalRandState *ts) {
+#ifdef _MSC_VER
+  uint64 seed = (static_cast<uint64>(rand()) << 32) +
+      static_cast<uint64>(rand());
+#else
+  int rs = pthread_mutex_lock(&_RandMutex);
+  KALDI_ASSERT(rs == 0);
+  uint64 seed = (static_cast<uint64>(rand()) << 32) +
+      static_cast<uint64>(rand());
+  rs = pthread_mutex_unlock(&_RandMutex);
+  KALDI_ASSERT(rs == 0);
+#endif
+  ts->s[0] = SplitMix64(&seed);
+  ts->s[1] = SplitMix64(&seed);
+  if (ts->s[0] == 0 && ts->s[1] == 0)
+    ts->s[1] = 1;  // the all-zero state is invalid for xoroshiro128+.
+}
+
 int Rand(struct RandomState* state) {
 #ifdef _MSC_VER
   // On Windows, just call Rand()
@@ -164,6 +218,90 @@ void RandGauss2(double *a, double *b, RandomState *state) {
   *b = b_float;
 }
 
+// Fills u[0] through u[n-1] with uniform variates strictly between 0 and 1;
+// this is the inner loop of the Batched functions below.  "ts", if non-NULL,
+// is a local generator to draw from (see SeedLocalRandState()); otherwise we
+// fall back to RandUniform() on "state".  As elsewhere in this file, float
+// precision is enough even for the double interfaces.
+static void FillRandUniformBlock(float *u, int32 n, RandomState *state,
+                                 LocalRandState *ts) {
+  if (ts != NULL) {
+    for (int32 i = 0; i < n; i++) {
+      // Take the top 24 bits; as in RandUniform(), the +1.0 and the +2 in the
+      // denominator (16777218 = 2^24 + 2) keep the result strictly inside
+      // (0, 1).
+      uint32 r = static_cast<uint32>(LocalRandNext(ts) >> 40);
+      u[i] = (r + 1.0f) * (1.0f / 16777218.0f);
+    }
+    return;
+  }
+  for (int32 i = 0; i < n; i++)
+    u[i] = RandUniform(state);
+}
+
+template<typename Real>
+static void RandGaussBatchedInternal(Real *data, int32 dim,
+                                     RandomState *state) {
+  const int32 kBlockSize = 256;  // must be even.
+  float u[kBlockSize];
+  LocalRandState local_state, *ts = NULL;
+  if (state == NULL && dim > 1) {
+    SeedLocalRandState(&local_state);
+    ts = &local_state;
+  }
+  int32 done = 0;
+  while (dim - done >= 2) {
+    int32 pairs = (dim - done) / 2;
+    if (pairs > kBlockSize / 2) pairs = kBlockSize / 2;
+    FillRandUniformBlock(u, 2 * pairs, state, ts);
+    // Box-Muller transform, as in RandGauss2(), but in a simple dense loop
+    // that the compiler has a chance to vectorize.
+    for (int32 i = 0; i < pairs; i++) {
+      float r = sqrtf(-2.0f * logf(u[2 * i])),
+          theta = 2.0f * static_cast<float>(M_PI) * u[2 * i + 1];
+      data[done + 2 * i] = r * cosf(theta);
+      data[done + 2 * i + 1] = r * sinf(theta);
+    }
+    done += 2 * pairs;
+  }
+  if (done != dim)
+    data[done] = RandGauss(state);
+}
+
+void RandGaussBatched(float *data, int32 dim, RandomState *state) {
+  RandGaussBatchedInternal(data, dim, state);
+}
+void RandGaussBatched(double *data, int32 dim, RandomState *state) {
+  RandGaussBatchedInternal(data, dim, state);
+}
+
+template<typename Real>
+static void RandUniformBatchedInternal(Real *data, int32 dim,
+                                       RandomState *state) {
+  const int32 kBlockSize = 256;
+  float u[kBlockSize];
+  LocalRandState local_state, *ts = NULL;
+  if (state == NULL && dim > 0) {
+    SeedLocalRandState(&local_state);
+    ts = &local_state;
+  }
+  int32 done = 0;
+  while (done < dim) {
+    int32 block = dim - done;
+    if (block > kBlockSize) block = kBlockSize;
+    FillRandUniformBlock(u, block, state, ts);
+    for (int32 i = 0; i < block; i++)
+      data[done + i] = u[i];
+    done += block;
+  }
+}
+
+void RandUniformBatched(float *data, int32 dim, RandomState *state) {
+  RandUniformBatchedInternal(data, dim, state);
+}
+void RandUniformBatched(double *data, int32 dim, RandomState *state) {
+  RandUniformBatchedInternal(data, dim, state);
+}
 
 }  // end namespace kaldi
 
@@ -162,6 +162,18 @@ int32 RandPoisson(float lambda, struct RandomState* state = NULL);
 void RandGauss2(float *a, float *b, RandomState *state = NULL);
 void RandGauss2(double *a, double *b, RandomState *state = NULL);
 
+// These fill data[0] through data[dim-1] with Gaussian (zero mean, unit
+// variance) or uniform (strictly between 0 and 1) random values.  They are
+// faster than calling RandGauss() or RandUniform() in a loop: the uniform
+// variates are generated a block at a time, and with state == NULL only one
+// locked rand() draw is made per call (to seed a local generator that
+// produces the whole fill), so threads hardly contend.  srand() controls
+// reproducibility the same way it does for Rand().
+void RandGaussBatched(float *data, int32 dim, RandomState *state = NULL);
+void RandGaussBatched(double *data, int32 dim, RandomState *state = NULL);
+void RandUniformBatched(float *data, int32 dim, RandomState *state = NULL);
+void RandUniformBatched(double *data, int32 dim, RandomState *state = NULL);
+
 // Also see Vector<float,double>::RandCategorical().
 
 // This is a randomized pruning mechanism that preserves expectations,
@@ -0,0 +1,99 @@
+// bin/compile-phone-loop-graph.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "tree/context-dep.h"
+#include "hmm/transition-model.h"
+#include "fstext/fstext-lib.h"
+#include "decoder/training-graph-compiler.h"
+
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    typedef kaldi::int32 int32;
+    using fst::VectorFst;
+    using fst::StdArc;
+
+    const char *usage =
+        "Creates a cyclic graph that accepts any sequence of phones,\n"
+        "expanded through the tree and HMM topology down to transition-ids,\n"
+        "with each phone uniformly weighted.  This is the denominator graph\n"
+        "of alignment-free sequence training (one graph per model, written\n"
+        "as a single FST); see also compile-train-graphs-phones for the\n"
+        "per-utterance numerator graphs.\n"
+        "\n"
+        "Usage:   compile-phone-loop-graph [options] <tree-in> <model-in> "
+        "<graph-wxfilename>\n"
+        "e.g.: \n"
+        " compile-phone-loop-graph tree 1.mdl den.fst\n";
+    ParseOptions po(usage);
+
+    TrainingGraphCompilerOptions gopts;
+    // For the denominator graph we want the transition probabilities in the
+    // graph, so keep the scales at their defaults of 1.0 (unlike
+    // compile-train-graphs-phones, where they get added later).
+    std::string disambig_rxfilename;
+    gopts.Register(&po);
+
+    po.Register("read-disambig-syms", &disambig_rxfilename, "File containing "
+                "list of disambiguation symbols in phone symbol table");
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 3) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string tree_rxfilename = po.GetArg(1);
+    std::string model_rxfilename = po.GetArg(2);
+    std::string fst_wxfilename = po.GetArg(3);
+
+    ContextDependency ctx_dep;  // the tree.
+    ReadKaldiObject(tree_rxfilename, &ctx_dep);
+
+    TransitionModel trans_model;
+    ReadKaldiObject(model_rxfilename, &trans_model);
+
+    std::vector<int32> disambig_syms;
+    if (disambig_rxfilename != "")
+      if (!ReadIntegerVectorSimple(disambig_rxfilename, &disambig_syms))
+        KALDI_ERR << "Could not read disambiguation symbols from "
+                  << disambig_rxfilename;
+
+    // NULL: no lexicon; we only do phone-level compilation.
+    TrainingGraphCompiler gc(trans_model, ctx_dep, NULL, disambig_syms, gopts);
+
+    VectorFst<StdArc> loop_fst;
+    if (!gc.CompilePhoneLoopGraph(&loop_fst) ||
+        loop_fst.Start() == fst::kNoStateId)
+      KALDI_ERR << "Failed to compile phone loop graph";
+
+    fst::WriteFstKaldi(loop_fst, fst_wxfilename);
+
+    KALDI_LOG << "compile-phone-loop-graph: wrote phone loop graph with "
+              << loop_fst.NumStates() << " states to " << fst_wxfilename;
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
@@ -0,0 +1,115 @@
+// bin/compile-train-graphs-phones.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "tree/context-dep.h"
+#include "hmm/transition-model.h"
+#include "fstext/fstext-lib.h"
+#include "decoder/training-graph-compiler.h"
+
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    typedef kaldi::int32 int32;
+    using fst::VectorFst;
+    using fst::StdArc;
+
+    const char *usage =
+        "Creates training graphs directly from phone-level transcripts,\n"
+        "without a lexicon or word-level grammar and without requiring any\n"
+        "pre-existing alignment (the graphs contain self-loops, so any\n"
+        "segmentation of the frames is allowed).  These are the numerator\n"
+        "graphs of alignment-free sequence training; see also\n"
+        "compile-phone-loop-graph for the corresponding denominator graph.\n"
+        "\n"
+        "Usage:   compile-train-graphs-phones [options] <tree-in> <model-in> "
+        "<phone-transcriptions-rspecifier> <graphs-wspecifier>\n"
+        "e.g.: \n"
+        " compile-train-graphs-phones tree 1.mdl ark:train.phones ark:graphs.fsts\n";
+    ParseOptions po(usage);
+
+    TrainingGraphCompilerOptions gopts;
+    gopts.transition_scale = 0.0;  // Change the default to 0.0 since we will generally add the
+    // transition probs in the alignment phase (since they change each time)
+    gopts.self_loop_scale = 0.0;  // Ditto for self-loop probs.
+    std::string disambig_rxfilename;
+    gopts.Register(&po);
+
+    po.Register("read-disambig-syms", &disambig_rxfilename, "File containing "
+                "list of disambiguation symbols in phone symbol table");
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 4) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string tree_rxfilename = po.GetArg(1);
+    std::string model_rxfilename = po.GetArg(2);
+    std::string transcript_rspecifier = po.GetArg(3);
+    std::string fsts_wspecifier = po.GetArg(4);
+
+    ContextDependency ctx_dep;  // the tree.
+    ReadKaldiObject(tree_rxfilename, &ctx_dep);
+
+    TransitionModel trans_model;
+    ReadKaldiObject(model_rxfilename, &trans_model);
+
+    std::vector<int32> disambig_syms;
+    if (disambig_rxfilename != "")
+      if (!ReadIntegerVectorSimple(disambig_rxfilename, &disambig_syms))
+        KALDI_ERR << "Could not read disambiguation symbols from "
+                  << disambig_rxfilename;
+
+    // NULL: no lexicon; we only do phone-level compilation.
+    TrainingGraphCompiler gc(trans_model, ctx_dep, NULL, disambig_syms, gopts);
+
+    SequentialInt32VectorReader transcript_reader(transcript_rspecifier);
+    TableWriter<fst::VectorFstHolder> fst_writer(fsts_wspecifier);
+
+    int num_succeed = 0, num_fail = 0;
+
+    for (; !transcript_reader.Done(); transcript_reader.Next()) {
+      std::string key = transcript_reader.Key();
+      const std::vector<int32> &transcript = transcript_reader.Value();
+      VectorFst<StdArc> decode_fst;
+
+      if (!gc.CompileGraphFromPhones(transcript, &decode_fst)) {
+        decode_fst.DeleteStates();  // Just make it empty.
+      }
+      if (decode_fst.Start() != fst::kNoStateId) {
+        num_succeed++;
+        fst_writer.Write(key, decode_fst);
+      } else {
+        KALDI_WARN << "Empty training graph for utterance "
+                   << key;
+        num_fail++;
+      }
+    }
+    KALDI_LOG << "compile-train-graphs-phones: succeeded for " << num_succeed
+              << " graphs, failed for " << num_fail;
+    return (num_succeed != 0 ? 0 : 1);
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
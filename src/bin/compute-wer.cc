@@ -24,6 +24,49 @@
 #include "util/parse-options.h"
 #include "tree/context-dep.h"
 #include "util/edit-distance.h"
+#include "thread/kaldi-task-sequence.h"
+
+namespace kaldi {
+
+struct WerStats {
+  int32 num_words, word_errs, num_sent, sent_errs, num_ins, num_del, num_sub;
+  WerStats(): num_words(0), word_errs(0), num_sent(0), sent_errs(0),
+              num_ins(0), num_del(0), num_sub(0) { }
+};
+
+// Task for use with TaskSequencer: the edit-distance computation (the
+// expensive part) runs in operator () on a worker thread; the destructor,
+// which TaskSequencer calls sequentially in input order, accumulates into
+// the shared stats, so no locking is needed.
+class ComputeWerTask {
+ public:
+  ComputeWerTask(const std::vector<std::string> &ref,
+                 const std::vector<std::string> &hyp,
+                 WerStats *stats):
+      ref_(ref), hyp_(hyp), stats_(stats),
+      word_errs_(0), ins_(0), del_(0), sub_(0) { }
+
+  void operator () () {
+    word_errs_ = LevenshteinEditDistance(ref_, hyp_, &ins_, &del_, &sub_);
+  }
+
+  ~ComputeWerTask() {
+    stats_->num_words += ref_.size();
+    stats_->word_errs += word_errs_;
+    stats_->num_ins += ins_;
+    stats_->num_del += del_;
+    stats_->num_sub += sub_;
+    stats_->num_sent++;
+    stats_->sent_errs += (ref_ != hyp_ ? 1 : 0);
+  }
+
+ private:
+  std::vector<std::string> ref_, hyp_;
+  WerStats *stats_;
+  int32 word_errs_, ins_, del_, sub_;
+};
+
+}  // namespace kaldi
 
 int main(int argc, char *argv[]) {
   using namespace kaldi;
@@ -42,6 +85,9 @@ int main(int argc, char *argv[]) {
 
     ParseOptions po(usage);
 
+    TaskSequencerConfig sequencer_config;  // has --num-threads option
+    sequencer_config.Register(&po);
+
     std::string mode = "strict";
     po.Register("mode", &mode,
                 "Scoring mode: \"present\"|\"all\"|\"strict\":\n"
@@ -67,38 +113,40 @@ int main(int argc, char *argv[]) {
                 << mode;
     }
 
-    int32 num_words = 0, word_errs = 0, num_sent = 0, sent_errs = 0,
-        num_ins = 0, num_del = 0, num_sub = 0, num_absent_sents = 0;
+    WerStats stats;
+    int32 num_absent_sents = 0;
 
     // Both text and integers are loaded as vector of strings,
     SequentialTokenVectorReader ref_reader(ref_rspecifier);
     RandomAccessTokenVectorReader hyp_reader(hyp_rspecifier);
-    
-    // Main loop, accumulate WER stats,
-    for (; !ref_reader.Done(); ref_reader.Next()) {
-      std::string key = ref_reader.Key();
-      const std::vector<std::string> &ref_sent = ref_reader.Value();
-      std::vector<std::string> hyp_sent;
-      if (!hyp_reader.HasKey(key)) {
-        if (mode == "strict")
-          KALDI_ERR << "No hypothesis for key " << key << " and strict "
-              "mode specifier.";
-        num_absent_sents++;
-        if (mode == "present")  // do not score this one.
-          continue;
-      } else {
-        hyp_sent = hyp_reader.Value(key);
+
+    // Main loop: the edit-distance computations run in parallel on the
+    // sequencer's worker threads (--num-threads); the accumulation into
+    // "stats" happens sequentially in input order, in the task destructors.
+    {
+      TaskSequencer<ComputeWerTask> sequencer(sequencer_config);
+      for (; !ref_reader.Done(); ref_reader.Next()) {
+        std::string key = ref_reader.Key();
+        const std::vector<std::string> &ref_sent = ref_reader.Value();
+        std::vector<std::string> hyp_sent;
+        if (!hyp_reader.HasKey(key)) {
+          if (mode == "strict")
+            KALDI_ERR << "No hypothesis for key " << key << " and strict "
+                "mode specifier.";
+          num_absent_sents++;
+          if (mode == "present")  // do not score this one.
+            continue;
+        } else {
+          hyp_sent = hyp_reader.Value(key);
+        }
+        sequencer.Run(new ComputeWerTask(ref_sent, hyp_sent, &stats));
       }
-      num_words += ref_sent.size();
-      int32 ins, del, sub;
-      word_errs += LevenshteinEditDistance(ref_sent, hyp_sent, &ins, &del, &sub);
-      num_ins += ins;
-      num_del += del;
-      num_sub += sub;
-
-      num_sent++;
-      sent_errs += (ref_sent != hyp_sent);
+      sequencer.Wait();  // waits for remaining tasks and their accumulation.
     }
+    int32 num_words = stats.num_words, word_errs = stats.word_errs,
+        num_sent = stats.num_sent, sent_errs = stats.sent_errs,
+        num_ins = stats.num_ins, num_del = stats.num_del,
+        num_sub = stats.num_sub;
 
     // Compute WER, SER,
     BaseFloat percent_wer = 100.0 * static_cast<BaseFloat>(word_errs)
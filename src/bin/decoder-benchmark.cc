@@ -0,0 +1,290 @@
+// bin/decoder-benchmark.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "fstext/fstext-lib.h"
+#include "decoder/faster-decoder.h"
+#include "decoder/lattice-faster-decoder.h"
+#include "decoder/decodable-matrix.h"
+#include "decoder/decoder-stats.h"
+#include "base/timer.h"
+#include "lat/kaldi-lattice.h"  // for LatticeArc
+
+#if !defined(_MSC_VER)
+#include <sys/resource.h>
+#endif
+
+namespace kaldi {
+
+// Returns the peak resident set size of this process in megabytes, or zero if
+// it could not be obtained.
+BaseFloat PeakRssMegabytes() {
+#if !defined(_MSC_VER)
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0)
+    return usage.ru_maxrss / 1024.0;  // ru_maxrss is in kilobytes on Linux.
+#endif
+  return 0.0;
+}
+
+// Returns the p'th percentile (0 <= p <= 100) of the values in "values",
+// which this function sorts; returns zero if "values" is empty.
+double Percentile(BaseFloat p, std::vector<double> *values) {
+  if (values->empty())
+    return 0.0;
+  std::sort(values->begin(), values->end());
+  int32 index = static_cast<int32>((p / 100.0) * (values->size() - 1) + 0.5);
+  return (*values)[index];
+}
+
+// Decodes one utterance's worth of scores, accumulating the utterance's wall
+// time into *decode_seconds; if per_frame == true, decodes one frame at a
+// time and appends each frame's wall time to *frame_seconds.  Exactly one of
+// "faster_decoder" and "lattice_decoder" should be non-NULL.
+void BenchmarkUtterance(const Matrix<BaseFloat> &loglikes,
+                        BaseFloat acoustic_scale,
+                        bool per_frame,
+                        FasterDecoder *faster_decoder,
+                        LatticeFasterDecoder *lattice_decoder,
+                        std::vector<double> *frame_seconds,
+                        double *decode_seconds) {
+  DecodableMatrixScaled decodable(loglikes, acoustic_scale);
+  Timer utt_timer;
+  if (faster_decoder != NULL) {
+    if (per_frame) {
+      faster_decoder->InitDecoding();
+      while (faster_decoder->NumFramesDecoded() < decodable.NumFramesReady()) {
+        Timer frame_timer;
+        faster_decoder->AdvanceDecoding(&decodable, 1);
+        frame_seconds->push_back(frame_timer.Elapsed());
+      }
+    } else {
+      faster_decoder->Decode(&decodable);
+    }
+    fst::VectorFst<LatticeArc> best_path;
+    faster_decoder->GetBestPath(&best_path);
+  } else {
+    if (per_frame) {
+      lattice_decoder->InitDecoding();
+      while (lattice_decoder->NumFramesDecoded() <
+             decodable.NumFramesReady()) {
+        Timer frame_timer;
+        lattice_decoder->AdvanceDecoding(&decodable, 1);
+        frame_seconds->push_back(frame_timer.Elapsed());
+      }
+      lattice_decoder->FinalizeDecoding();
+    } else {
+      lattice_decoder->Decode(&decodable);
+    }
+    fst::VectorFst<LatticeArc> best_path;
+    lattice_decoder->GetBestPath(&best_path);
+  }
+  *decode_seconds += utt_timer.Elapsed();
+}
+
+}  // namespace kaldi
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    typedef kaldi::int32 int32;
+    typedef kaldi::int64 int64;
+    using fst::VectorFst;
+    using fst::StdArc;
+
+    const char *usage =
+        "Benchmark FasterDecoder or LatticeFasterDecoder by replaying an\n"
+        "archive of recorded log-likelihood matrices (as decoded by\n"
+        "decode-faster-mapped etc.) through the decoder, or by decoding\n"
+        "synthetic random scores if no archive is given.  Reports RTF,\n"
+        "frames/sec, tokens/sec, per-frame latency percentiles and peak RSS\n"
+        "as machine-readable \"<metric> <value>\" lines on the standard\n"
+        "output, for use in regression gates.  The matrices' column count\n"
+        "must cover the input labels of the decoding graph.\n"
+        "\n"
+        "Usage: decoder-benchmark [options] <fst-in> [<loglikes-rspecifier>]\n"
+        "e.g.: decoder-benchmark --decoder=lattice-faster --beam=13.0 \\\n"
+        "        HCLG.fst ark:scores.ark\n"
+        "or, for a synthetic workload:\n"
+        "  decoder-benchmark --synthetic-num-utts=20 HCLG.fst\n";
+
+    ParseOptions po(usage);
+    std::string decoder_type = "lattice-faster";
+    BaseFloat acoustic_scale = 0.1;
+    BaseFloat frame_shift = 0.01;
+    int32 num_repeats = 1;
+    bool per_frame = true;
+    int32 synthetic_num_utts = 20,
+        synthetic_num_frames = 500,
+        synthetic_dim = 0;
+    LatticeFasterDecoderConfig config;
+    config.Register(&po);
+    po.Register("decoder", &decoder_type, "Decoder to benchmark: \"faster\" "
+                "or \"lattice-faster\".  For \"faster\", the beam, max-active, "
+                "min-active, beam-delta and hash-ratio options apply and the "
+                "lattice-specific ones are ignored.");
+    po.Register("acoustic-scale", &acoustic_scale,
+                "Scaling factor for acoustic likelihoods");
+    po.Register("frame-shift", &frame_shift,
+                "Frame shift in seconds, used to compute the real-time "
+                "factor.");
+    po.Register("num-repeats", &num_repeats,
+                "Number of times to replay the workload (raise this to get "
+                "stable numbers from small archives).");
+    po.Register("per-frame", &per_frame,
+                "If true, decode one frame per AdvanceDecoding() call and "
+                "report per-frame latency percentiles; if false, decode "
+                "whole utterances at a time (slightly less overhead, but no "
+                "latency percentiles).");
+    po.Register("synthetic-num-utts", &synthetic_num_utts,
+                "Number of utterances of random scores to decode per repeat, "
+                "when no loglikes-rspecifier is given.");
+    po.Register("synthetic-num-frames", &synthetic_num_frames,
+                "Number of frames per synthetic utterance.");
+    po.Register("synthetic-dim", &synthetic_dim,
+                "Column count of the synthetic score matrices; if zero, use "
+                "the highest input label of the decoding graph.");
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() < 1 || po.NumArgs() > 2) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string fst_in_filename = po.GetArg(1),
+        loglikes_rspecifier = po.GetOptArg(2);
+    bool synthetic = loglikes_rspecifier.empty();
+
+    if (decoder_type != "faster" && decoder_type != "lattice-faster")
+      KALDI_ERR << "Invalid option --decoder=" << decoder_type
+                << ": expected \"faster\" or \"lattice-faster\".";
+
+    VectorFst<StdArc> *decode_fst = fst::ReadFstKaldi(fst_in_filename);
+
+    if (synthetic && synthetic_dim == 0) {
+      for (fst::StateIterator<VectorFst<StdArc> > siter(*decode_fst);
+           !siter.Done(); siter.Next()) {
+        for (fst::ArcIterator<VectorFst<StdArc> > aiter(*decode_fst,
+                                                        siter.Value());
+             !aiter.Done(); aiter.Next())
+          synthetic_dim = std::max(synthetic_dim, aiter.Value().ilabel);
+      }
+      KALDI_LOG << "Graph's highest input label is " << synthetic_dim
+                << "; using that as the synthetic score dimension.";
+    }
+
+    FasterDecoder *faster_decoder = NULL;
+    LatticeFasterDecoder *lattice_decoder = NULL;
+    DecoderStats stats;
+    if (decoder_type == "faster") {
+      FasterDecoderOptions faster_opts;
+      faster_opts.beam = config.beam;
+      faster_opts.max_active = config.max_active;
+      faster_opts.min_active = config.min_active;
+      faster_opts.beam_delta = config.beam_delta;
+      faster_opts.hash_ratio = config.hash_ratio;
+      faster_decoder = new FasterDecoder(*decode_fst, faster_opts);
+      faster_decoder->SetDecoderStats(&stats);
+    } else {
+      lattice_decoder = new LatticeFasterDecoder(*decode_fst, config);
+      lattice_decoder->SetDecoderStats(&stats);
+    }
+
+    int64 tot_frames = 0;
+    int32 num_utts = 0;
+    double decode_seconds = 0.0;
+    std::vector<double> frame_seconds;
+
+    for (int32 repeat = 0; repeat < num_repeats; repeat++) {
+      if (synthetic) {
+        for (int32 utt = 0; utt < synthetic_num_utts; utt++) {
+          Matrix<BaseFloat> loglikes(synthetic_num_frames, synthetic_dim);
+          loglikes.SetRandn();
+          BenchmarkUtterance(loglikes, acoustic_scale, per_frame,
+                             faster_decoder, lattice_decoder,
+                             &frame_seconds, &decode_seconds);
+          tot_frames += loglikes.NumRows();
+          num_utts++;
+        }
+      } else {
+        SequentialBaseFloatMatrixReader loglikes_reader(loglikes_rspecifier);
+        for (; !loglikes_reader.Done(); loglikes_reader.Next()) {
+          const Matrix<BaseFloat> &loglikes = loglikes_reader.Value();
+          if (loglikes.NumRows() == 0) {
+            KALDI_WARN << "Zero-length utterance: " << loglikes_reader.Key();
+            continue;
+          }
+          BenchmarkUtterance(loglikes, acoustic_scale, per_frame,
+                             faster_decoder, lattice_decoder,
+                             &frame_seconds, &decode_seconds);
+          tot_frames += loglikes.NumRows();
+          num_utts++;
+        }
+      }
+    }
+
+    if (num_utts == 0)
+      KALDI_ERR << "No utterances were decoded.";
+
+    double audio_seconds = tot_frames * frame_shift;
+    std::cout << "decoder " << decoder_type << '\n'
+              << "beam " << config.beam << '\n'
+              << "max_active " << config.max_active << '\n'
+              << "num_utts " << num_utts << '\n'
+              << "num_frames " << tot_frames << '\n'
+              << "audio_seconds " << audio_seconds << '\n'
+              << "decode_seconds " << decode_seconds << '\n'
+              << "real_time_factor "
+              << (audio_seconds > 0.0 ? decode_seconds / audio_seconds : 0.0)
+              << '\n'
+              << "frames_per_second "
+              << (decode_seconds > 0.0 ? tot_frames / decode_seconds : 0.0)
+              << '\n'
+              << "tokens_per_second "
+              << (decode_seconds > 0.0 ? stats.TotalToks() / decode_seconds :
+                  0.0) << '\n';
+    if (per_frame) {
+      std::cout << "frame_latency_p50_ms "
+                << Percentile(50.0, &frame_seconds) * 1000.0 << '\n'
+                << "frame_latency_p90_ms "
+                << Percentile(90.0, &frame_seconds) * 1000.0 << '\n'
+                << "frame_latency_p99_ms "
+                << Percentile(99.0, &frame_seconds) * 1000.0 << '\n'
+                << "frame_latency_max_ms "
+                << Percentile(100.0, &frame_seconds) * 1000.0 << '\n';
+    }
+    std::cout << "peak_rss_mb " << PeakRssMegabytes() << '\n';
+
+    KALDI_LOG << "Decoded " << num_utts << " utterances ("
+              << tot_frames << " frames) in " << decode_seconds
+              << " seconds with decoder " << decoder_type << ".";
+
+    delete faster_decoder;
+    delete lattice_decoder;
+    delete decode_fst;
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
@@ -0,0 +1,76 @@
+// bin/kaldi-daemon-client.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "base/kaldi-common.h"
+#include "util/kaldi-daemon.h"
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+
+    const char *usage =
+        "Run one request against a Kaldi binary started in daemon mode\n"
+        "(see --daemon-socket in binaries that support it, e.g.\n"
+        "gmm-compute-likes), forwarding the given arguments and this\n"
+        "process's stdin/stdout/stderr, and exiting with the request's\n"
+        "exit status.  Note: the arguments after the socket path are\n"
+        "passed to the daemon verbatim, not interpreted here.\n"
+        "\n"
+        "Usage: kaldi-daemon-client <socket-path> [args...]\n"
+        "   or: kaldi-daemon-client [args...]  # with KALDI_DAEMON_SOCKET\n"
+        "                                      # set in the environment.\n"
+        "e.g.: gmm-compute-likes --daemon-socket=/tmp/likes.sock final.mdl &\n"
+        "      kaldi-daemon-client /tmp/likes.sock ark:feats.ark ark:likes.ark\n"
+        "      kaldi-daemon-client /tmp/likes.sock --daemon-shutdown\n"
+        "With KALDI_DAEMON_SOCKET set, existing scripts can be pointed at a\n"
+        "daemon unchanged by symlinking the binary's name to this program.\n";
+
+    // We don't use ParseOptions here: everything after the socket path must
+    // be forwarded to the daemon verbatim, including things that look like
+    // options.
+    const char *env_socket = std::getenv("KALDI_DAEMON_SOCKET");
+    std::string socket_path;
+    int args_begin;
+    if (env_socket != NULL && env_socket[0] != '\0') {
+      socket_path = env_socket;
+      args_begin = 1;
+    } else {
+      if (argc < 2 || strcmp(argv[1], "--help") == 0) {
+        std::cerr << usage;
+        return 1;
+      }
+      socket_path = argv[1];
+      args_begin = 2;
+    }
+
+    std::vector<std::string> args;
+    args.push_back(argv[0]);  // program name, for the handler's ParseOptions.
+    for (int i = args_begin; i < argc; i++)
+      args.push_back(argv[i]);
+
+    return RunDaemonClient(socket_path, args);
+  } catch (const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
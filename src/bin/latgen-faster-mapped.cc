@@ -55,7 +55,12 @@ int main(int argc, char *argv[]) {
 
     po.Register("word-symbol-table", &word_syms_filename, "Symbol table for words [for debug output]");
     po.Register("allow-partial", &allow_partial, "If true, produce output even if end state was not reached.");
-    
+    int32 post_process_threads = 0;
+    po.Register("post-process-threads", &post_process_threads,
+                "If >0, run lattice determinization and output on this many "
+                "background threads, so the decoder can start the next "
+                "utterance immediately (output order is unchanged).");
+
     po.Read(argc, argv);
 
     if (po.NumArgs() < 4 || po.NumArgs() > 6) {
@@ -95,6 +100,17 @@ int main(int argc, char *argv[]) {
     kaldi::int64 frame_count = 0;
     int num_success = 0, num_fail = 0;
 
+    AsyncLatticePostprocessor *postprocessor = NULL;
+    if (post_process_threads > 0) {
+      TaskSequencerConfig sequencer_config;
+      sequencer_config.num_threads = post_process_threads;
+      postprocessor = new AsyncLatticePostprocessor(
+          sequencer_config, config, trans_model, word_syms, acoustic_scale,
+          determinize, &alignment_writer, &words_writer,
+          &compact_lattice_writer, &lattice_writer,
+          &tot_like, &frame_count, &num_success, &num_fail, NULL);
+    }
+
     if (ClassifyRspecifier(fst_in_str, NULL, NULL) == kNoRspecifier) {
       SequentialBaseFloatMatrixReader loglike_reader(feature_rspecifier);
       // Input FST is just one FST, not a table of FSTs.
@@ -115,6 +131,13 @@ int main(int argc, char *argv[]) {
       
           DecodableMatrixScaledMapped decodable(trans_model, loglikes, acoustic_scale);
 
+          if (postprocessor != NULL) {
+            // counters are updated by the postprocessor as lattices get
+            // written.
+            DecodeUtteranceLatticeFasterAsync(decoder, decodable, utt,
+                                              allow_partial, postprocessor);
+            continue;
+          }
           double like;
           if (DecodeUtteranceLatticeFaster(
                   decoder, decodable, trans_model, word_syms, utt,
@@ -126,6 +149,10 @@ int main(int argc, char *argv[]) {
             num_success++;
           } else num_fail++;
         }
+        if (postprocessor != NULL)
+          postprocessor->Wait();  // flush pending output while "decoder" is
+                                  // still in scope (not strictly needed, but
+                                  // keeps the timing log meaningful).
       }
       delete decode_fst; // delete this only after decoder goes out of scope.
     } else { // We have different FSTs for different utterances.
@@ -147,6 +174,11 @@ int main(int argc, char *argv[]) {
         }
         LatticeFasterDecoder decoder(fst_reader.Value(), config);
         DecodableMatrixScaledMapped decodable(trans_model, loglikes, acoustic_scale);
+        if (postprocessor != NULL) {
+          DecodeUtteranceLatticeFasterAsync(decoder, decodable, utt,
+                                            allow_partial, postprocessor);
+          continue;
+        }
         double like;
         if (DecodeUtteranceLatticeFaster(
                 decoder, decodable, trans_model, word_syms, utt, acoustic_scale,
@@ -158,7 +190,8 @@ int main(int argc, char *argv[]) {
         } else num_fail++;
       }
     }
-      
+
+    delete postprocessor;  // waits for and writes any pending output.
     double elapsed = timer.Elapsed();
     KALDI_LOG << "Time taken "<< elapsed
               << "s: real-time factor assuming 100 frames/sec is "
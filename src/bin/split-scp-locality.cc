@@ -0,0 +1,72 @@
+// bin/split-scp-locality.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+
+    const char *usage =
+        "Split an scp file into shards sorted by (archive file, byte offset),\n"
+        "so that each shard reads one sequential segment of the underlying\n"
+        "archives instead of seeking around (unlike utils/split_scp.pl, which\n"
+        "splits in scp order).  The shards are balanced by approximate number\n"
+        "of bytes, estimated from the offsets, rather than by number of\n"
+        "entries.  Use this when the order of the entries does not matter\n"
+        "(or use the ls (locality-sorted) rspecifier option in the programs\n"
+        "reading the shards).\n"
+        "Usage: split-scp-locality <in-scp> <out-scp1> [<out-scp2> ...]\n"
+        " e.g.: split-scp-locality data/train/feats.scp feats.1.scp feats.2.scp\n";
+
+    ParseOptions po(usage);
+    po.Read(argc, argv);
+
+    if (po.NumArgs() < 2) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string scp_rxfilename = po.GetArg(1);
+    int32 num_shards = po.NumArgs() - 1;
+
+    std::vector<std::pair<std::string, std::string> > script;
+    if (!ReadScriptFile(scp_rxfilename, true, &script))
+      KALDI_ERR << "Could not read script file "
+                << PrintableRxfilename(scp_rxfilename);
+
+    std::vector<std::vector<std::pair<std::string, std::string> > > shards;
+    SplitScriptByLocality(script, num_shards, &shards);
+
+    for (int32 i = 0; i < num_shards; i++) {
+      std::string shard_wxfilename = po.GetArg(i + 2);
+      if (!WriteScriptFile(shard_wxfilename, shards[i]))
+        KALDI_ERR << "Could not write script file "
+                  << PrintableWxfilename(shard_wxfilename);
+    }
+
+    KALDI_LOG << "Split " << script.size() << " entries into "
+              << num_shards << " locality-sorted shards.";
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
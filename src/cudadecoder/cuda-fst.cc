@@ -0,0 +1,146 @@
+// cudadecoder/cuda-fst.cc
+
+// Copyright 2014   Johns Hopkins University
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "cudadecoder/cuda-fst.h"
+
+namespace kaldi {
+
+CudaFst::CudaFst(): start_(fst::kNoStateId), num_states_(0) {
+#if HAVE_CUDA == 1
+  d_e_offsets_ = NULL;
+  d_ne_offsets_ = NULL;
+  d_arc_weights_ = NULL;
+  d_arc_ilabels_ = NULL;
+  d_arc_olabels_ = NULL;
+  d_arc_nextstates_ = NULL;
+  d_final_ = NULL;
+#endif
+}
+
+void CudaFst::Initialize(const fst::Fst<Arc> &fst) {
+  KALDI_ASSERT(num_states_ == 0 && "Initialize() may only be called once.");
+  start_ = fst.Start();
+  KALDI_ASSERT(start_ != fst::kNoStateId);
+
+  // First pass: count states (as max state-id plus one, since the ids are
+  // not guaranteed contiguous) and emitting/nonemitting arcs.
+  int32 num_e_arcs = 0, num_ne_arcs = 0;
+  for (fst::StateIterator<fst::Fst<Arc> > siter(fst);
+       !siter.Done(); siter.Next()) {
+    StateId s = siter.Value();
+    if (s + 1 > num_states_) num_states_ = s + 1;
+    for (fst::ArcIterator<fst::Fst<Arc> > aiter(fst, s);
+         !aiter.Done(); aiter.Next()) {
+      if (aiter.Value().ilabel != 0) num_e_arcs++;
+      else num_ne_arcs++;
+    }
+  }
+  int32 num_arcs = num_e_arcs + num_ne_arcs;
+
+  e_offsets_.resize(num_states_ + 1, 0);
+  ne_offsets_.resize(num_states_ + 1, num_e_arcs);
+  arc_weights_.resize(num_arcs);
+  arc_ilabels_.resize(num_arcs);
+  arc_olabels_.resize(num_arcs);
+  arc_nextstates_.resize(num_arcs);
+  final_.resize(num_states_,
+                std::numeric_limits<BaseFloat>::infinity());
+
+  // Second pass: fill the arrays; emitting arcs go in the first part of
+  // the arc arrays, nonemitting arcs in the second.
+  int32 e_pos = 0, ne_pos = num_e_arcs;
+  StateId next_state = 0;  // the next state needing its offsets set; this
+                           // handles gaps in the state numbering.
+  for (fst::StateIterator<fst::Fst<Arc> > siter(fst);
+       !siter.Done(); siter.Next()) {
+    StateId s = siter.Value();
+    for (; next_state <= s; next_state++) {
+      e_offsets_[next_state] = e_pos;
+      ne_offsets_[next_state] = ne_pos;
+    }
+    final_[s] = fst.Final(s).Value();
+    for (fst::ArcIterator<fst::Fst<Arc> > aiter(fst, s);
+         !aiter.Done(); aiter.Next()) {
+      const Arc &arc = aiter.Value();
+      int32 pos = (arc.ilabel != 0 ? e_pos++ : ne_pos++);
+      arc_weights_[pos] = arc.weight.Value();
+      arc_ilabels_[pos] = arc.ilabel;
+      arc_olabels_[pos] = arc.olabel;
+      arc_nextstates_[pos] = arc.nextstate;
+    }
+  }
+  for (; next_state <= num_states_; next_state++) {
+    e_offsets_[next_state] = e_pos;
+    ne_offsets_[next_state] = ne_pos;
+  }
+  KALDI_ASSERT(e_pos == num_e_arcs && ne_pos == num_arcs);
+
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    d_e_offsets_ = UploadArray(e_offsets_);
+    d_ne_offsets_ = UploadArray(ne_offsets_);
+    d_arc_weights_ = UploadArray(arc_weights_);
+    d_arc_ilabels_ = UploadArray(arc_ilabels_);
+    d_arc_olabels_ = UploadArray(arc_olabels_);
+    d_arc_nextstates_ = UploadArray(arc_nextstates_);
+    d_final_ = UploadArray(final_);
+  }
+#endif
+  KALDI_VLOG(1) << "CudaFst: prepared " << num_states_ << " states, "
+                << num_e_arcs << " emitting and " << num_ne_arcs
+                << " nonemitting arcs.";
+}
+
+void CudaFst::Finalize() {
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    if (d_e_offsets_) CuDevice::Instantiate().Free(d_e_offsets_);
+    if (d_ne_offsets_) CuDevice::Instantiate().Free(d_ne_offsets_);
+    if (d_arc_weights_) CuDevice::Instantiate().Free(d_arc_weights_);
+    if (d_arc_ilabels_) CuDevice::Instantiate().Free(d_arc_ilabels_);
+    if (d_arc_olabels_) CuDevice::Instantiate().Free(d_arc_olabels_);
+    if (d_arc_nextstates_) CuDevice::Instantiate().Free(d_arc_nextstates_);
+    if (d_final_) CuDevice::Instantiate().Free(d_final_);
+    d_e_offsets_ = NULL;
+    d_ne_offsets_ = NULL;
+    d_arc_weights_ = NULL;
+    d_arc_ilabels_ = NULL;
+    d_arc_olabels_ = NULL;
+    d_arc_nextstates_ = NULL;
+    d_final_ = NULL;
+  }
+#endif
+}
+
+#if HAVE_CUDA == 1
+template<typename T>
+T *CudaFst::UploadArray(const std::vector<T> &vec) {
+  if (vec.empty()) return NULL;
+  size_t num_bytes = vec.size() * sizeof(T);
+  T *ptr = static_cast<T*>(CuDevice::Instantiate().Malloc(num_bytes));
+  CU_SAFE_CALL(cudaMemcpy(ptr, &(vec[0]), num_bytes,
+                          cudaMemcpyHostToDevice));
+  return ptr;
+}
+#else
+template<typename T>
+T *CudaFst::UploadArray(const std::vector<T> &vec) { return NULL; }
+#endif
+
+}  // end namespace kaldi.
@@ -0,0 +1,125 @@
+// cudadecoder/cuda-fst.h
+
+// Copyright 2014   Johns Hopkins University
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_CUDADECODER_CUDA_FST_H_
+#define KALDI_CUDADECODER_CUDA_FST_H_
+
+#include <vector>
+#include <fst/fstlib.h>
+#include "base/kaldi-common.h"
+#include "cudamatrix/cu-device.h"
+
+namespace kaldi {
+
+/**
+   This directory is the start of a GPU-resident decoder: the goal is to do
+   token passing on the device, next to where the nnet acoustic scores are
+   already computed (see ../cudamatrix), instead of copying likelihoods back
+   over PCIe every frame to decode on the host.
+
+   CudaFst is the first stage of that: it flattens a decoding graph (HCLG,
+   as fst::StdFst) into compacted CSR-style arrays in the layout the device
+   kernels want, and uploads them to the GPU.  The arcs are stored as
+   struct-of-arrays (separate weight/ilabel/olabel/nextstate arrays, so
+   that a warp traversing consecutive arcs does coalesced loads), and each
+   state's arcs are partitioned into emitting and nonemitting groups, since
+   the expansion kernels for the two phases of a frame are separate.
+
+   The host-side arrays are always built and remain accessible (they are
+   useful on their own, and for checking the device results in tests); the
+   device copies are only made if CUDA is compiled in and a device is
+   active, following the conventions of ../cudamatrix.  The class is
+   immutable after Initialize(), so one instance can serve all decoding
+   streams on a GPU.  The token-passing kernels themselves will arrive
+   separately.
+ */
+class CudaFst {
+ public:
+  typedef fst::StdArc Arc;
+  typedef Arc::Label Label;
+  typedef Arc::StateId StateId;
+
+  CudaFst();
+  ~CudaFst() { Finalize(); }
+
+  // Flattens "fst" into the CSR arrays and, if a CUDA device is active,
+  // uploads them; may be called only once per instance.
+  void Initialize(const fst::Fst<Arc> &fst);
+
+  // Frees the device copies (called by the destructor).
+  void Finalize();
+
+  StateId Start() const { return start_; }
+  int32 NumStates() const { return num_states_; }
+  int32 NumArcs() const { return static_cast<int32>(arc_weights_.size()); }
+
+  // Host-side accessors.  State s's emitting arcs are the arc-array
+  // entries [EmittingOffsets()[s], EmittingOffsets()[s+1]), and its
+  // nonemitting arcs [NonemittingOffsets()[s], NonemittingOffsets()[s+1]);
+  // all emitting arcs precede all nonemitting arcs in the arrays.
+  const std::vector<int32> &EmittingOffsets() const { return e_offsets_; }
+  const std::vector<int32> &NonemittingOffsets() const { return ne_offsets_; }
+  const std::vector<BaseFloat> &ArcWeights() const { return arc_weights_; }
+  const std::vector<int32> &ArcIlabels() const { return arc_ilabels_; }
+  const std::vector<int32> &ArcOlabels() const { return arc_olabels_; }
+  const std::vector<int32> &ArcNextstates() const { return arc_nextstates_; }
+  // Final costs, indexed by state; +infinity for non-final states.
+  const std::vector<BaseFloat> &FinalCosts() const { return final_; }
+
+#if HAVE_CUDA == 1
+  // Device pointers, valid only if a device was active in Initialize();
+  // NULL otherwise.  Same layout as the host arrays above.
+  const int32 *DeviceEmittingOffsets() const { return d_e_offsets_; }
+  const int32 *DeviceNonemittingOffsets() const { return d_ne_offsets_; }
+  const BaseFloat *DeviceArcWeights() const { return d_arc_weights_; }
+  const int32 *DeviceArcIlabels() const { return d_arc_ilabels_; }
+  const int32 *DeviceArcOlabels() const { return d_arc_olabels_; }
+  const int32 *DeviceArcNextstates() const { return d_arc_nextstates_; }
+  const BaseFloat *DeviceFinalCosts() const { return d_final_; }
+#endif
+
+ private:
+  // Copies one host array to newly allocated device memory (no-op with an
+  // empty array); defined in the .cc file.
+  template<typename T>
+  static T *UploadArray(const std::vector<T> &vec);
+
+  StateId start_;
+  int32 num_states_;
+  // Offset arrays of size num_states_ + 1; see the accessors above.
+  std::vector<int32> e_offsets_, ne_offsets_;
+  // The arcs, as struct-of-arrays: emitting arcs of all states (grouped by
+  // state) followed by nonemitting arcs of all states.
+  std::vector<BaseFloat> arc_weights_;
+  std::vector<int32> arc_ilabels_, arc_olabels_, arc_nextstates_;
+  std::vector<BaseFloat> final_;
+
+#if HAVE_CUDA == 1
+  int32 *d_e_offsets_, *d_ne_offsets_;
+  BaseFloat *d_arc_weights_;
+  int32 *d_arc_ilabels_, *d_arc_olabels_, *d_arc_nextstates_;
+  BaseFloat *d_final_;
+#endif
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(CudaFst);
+};
+
+}  // end namespace kaldi.
+
+#endif  // KALDI_CUDADECODER_CUDA_FST_H_
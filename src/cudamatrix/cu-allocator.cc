@@ -135,6 +135,18 @@ void CuMemoryAllocator::PrintMemoryUsage() const {
             << ", in cudaMalloc=" << tot_time_taken_in_cuda_malloc_
             << ", in cudaFree=" << tot_time_taken_in_cuda_free_
             << ", in this->MallocPitch()=" << tot_time_taken_in_malloc_pitch_;
+  if (slab_size_ != 0) {
+    size_t largest_free_block =
+        (slab_free_by_size_.empty() ? 0 : slab_free_by_size_.rbegin()->first);
+    KALDI_LOG << "Slab usage: " << slab_bytes_used_ << '/' << slab_size_
+              << " bytes currently in use (max: " << slab_max_bytes_used_
+              << "); largest free block is " << largest_free_block
+              << " bytes out of " << slab_free_.size() << " free blocks, with "
+              << slab_pending_bytes_ << " bytes awaiting coalescing; "
+              << num_slab_misses_ << '/'
+              << (num_slab_allocations_ + num_slab_misses_)
+              << " requests fell back to the caching allocator.";
+  }
 }
 
 CuMemoryAllocator::CuMemoryAllocator(CuAllocatorOptions opts):
@@ -150,7 +162,14 @@ CuMemoryAllocator::CuMemoryAllocator(CuAllocatorOptions opts):
     tot_time_taken_in_cuda_malloc_(0.0),
     tot_time_taken_in_cuda_malloc_pitch_(0.0),
     tot_time_taken_in_cuda_free_(0.0),
-    tot_time_taken_in_malloc_pitch_(0.0) { }
+    tot_time_taken_in_malloc_pitch_(0.0),
+    slab_begin_(NULL),
+    slab_size_(0),
+    slab_bytes_used_(0),
+    slab_max_bytes_used_(0),
+    num_slab_allocations_(0),
+    num_slab_misses_(0),
+    slab_pending_bytes_(0) { }
 
 void* CuMemoryAllocator::MallocPitch(size_t row_bytes,
                                      size_t num_rows,
@@ -159,6 +178,18 @@ void* CuMemoryAllocator::MallocPitch(size_t row_bytes,
   t_++;
   num_user_allocations_++;
   size_t requested_bytes = row_bytes * num_rows;
+  if (slab_size_ != 0) {
+    // slab mode: try to sub-allocate from the slab first.  Note: slab
+    // allocations are kept out of the cur_bytes_used_/cur_bytes_allocated_
+    // accounting, which controls how much memory the caching allocator
+    // below is allowed to hold on to; the slab has its own statistics.
+    void *ans = SlabMalloc(row_bytes, num_rows, pitch);
+    if (ans != NULL) {
+      tot_time_taken_in_malloc_pitch_ += tim.Elapsed();
+      return ans;
+    }
+    num_slab_misses_++;
+  }
   if (cur_bytes_used_ + requested_bytes > max_bytes_used_)
     max_bytes_used_ = cur_bytes_used_ + requested_bytes;
   MruCache &cache = GetCacheForSize(requested_bytes);
@@ -276,6 +307,11 @@ void CuMemoryAllocator::FreeSomeCachedMemory(size_t bytes_to_free_in) {
 
 void CuMemoryAllocator::Free(void *ptr) {
   t_++;
+  if (slab_size_ != 0 && static_cast<char*>(ptr) >= slab_begin_ &&
+      static_cast<char*>(ptr) < slab_begin_ + slab_size_) {
+    SlabFree(ptr);
+    return;
+  }
   unordered_map<void*, UsedMemoryElement, PointerHasher>::iterator iter =
       used_map_.find(ptr);
   if (iter == used_map_.end()) {
@@ -293,6 +329,153 @@ void CuMemoryAllocator::Free(void *ptr) {
   used_map_.erase(iter);
 }
 
+// Alignment of blocks sub-allocated from the slab; matches the alignment
+// that cudaMalloc gives in practice, so code that makes assumptions about
+// pointer alignment behaves the same in slab mode.
+static const size_t kSlabAlignment = 256;
+
+// When this many freed blocks are pending, we merge them back into the free
+// list (see CoalescePendingFreed()).
+static const size_t kSlabPendingLimit = 64;
+
+static inline size_t RoundUpToSlabAlignment(size_t size) {
+  return (size + kSlabAlignment - 1) & ~(kSlabAlignment - 1);
+}
+
+void CuMemoryAllocator::ReserveSlab(size_t bytes) {
+  if (slab_size_ != 0) {
+    KALDI_WARN << "Not reserving a slab of " << bytes << " bytes: we already "
+               << "have one of " << slab_size_ << " bytes.";
+    return;
+  }
+  bytes -= bytes % kSlabAlignment;
+  if (bytes == 0) return;
+  void *data;
+  Timer tim;
+  cudaError_t e = cudaMalloc(&data, bytes);
+  tot_time_taken_in_cuda_malloc_ += tim.Elapsed();
+  if (e != cudaSuccess) {
+    cudaGetLastError();  // Clear the error state.
+    KALDI_WARN << "Failed to reserve a slab of " << bytes << " bytes of GPU "
+               << "memory; will allocate on demand instead.";
+    return;
+  }
+  slab_begin_ = static_cast<char*>(data);
+  slab_size_ = bytes;
+  slab_free_[slab_begin_] = bytes;
+  slab_free_by_size_.insert(std::pair<size_t, char*>(bytes, slab_begin_));
+  KALDI_LOG << "Reserved a slab of " << bytes << " bytes of GPU memory; "
+            << "allocations will be sub-allocated from it.";
+}
+
+void* CuMemoryAllocator::SlabMalloc(size_t row_bytes,
+                                    size_t num_rows,
+                                    size_t *pitch) {
+  // mimic the pitch that cudaMallocPitch would choose, so strides (and hence
+  // kernel behavior) don't depend on whether slab mode is active.
+  size_t this_pitch = (num_rows == 1 ? row_bytes :
+                       RoundUpToSlabAlignment(row_bytes));
+  size_t bytes = RoundUpToSlabAlignment(this_pitch * num_rows);
+  for (int32 i = 0; i < 2; i++) {
+    std::multimap<size_t, char*>::iterator iter =
+        slab_free_by_size_.lower_bound(bytes);
+    if (iter == slab_free_by_size_.end()) {
+      // No single free block is large enough; merging the pending-free
+      // blocks into the free list may create one, so try that once.
+      if (i == 0 && !slab_pending_.empty()) {
+        CoalescePendingFreed();
+        continue;
+      }
+      return NULL;
+    }
+    char *addr = iter->second;
+    size_t block_size = iter->first;
+    slab_free_by_size_.erase(iter);
+    slab_free_.erase(addr);
+    if (block_size - bytes >= kSlabAlignment) {
+      // return the unused part of the block to the free list.
+      char *rest = addr + bytes;
+      size_t rest_size = block_size - bytes;
+      slab_free_[rest] = rest_size;
+      slab_free_by_size_.insert(std::pair<size_t, char*>(rest_size, rest));
+    } else {
+      bytes = block_size;  // absorb the too-small-to-use remainder.
+    }
+    slab_used_map_[addr] = bytes;
+    slab_bytes_used_ += bytes;
+    if (slab_bytes_used_ > slab_max_bytes_used_)
+      slab_max_bytes_used_ = slab_bytes_used_;
+    num_slab_allocations_++;
+    *pitch = this_pitch;
+    return addr;
+  }
+  return NULL;  // unreachable; makes the compiler happy.
+}
+
+void CuMemoryAllocator::SlabFree(void *ptr) {
+  unordered_map<void*, size_t, PointerHasher>::iterator iter =
+      slab_used_map_.find(ptr);
+  if (iter == slab_used_map_.end()) {
+    KALDI_ERR << "Attempt to free CUDA memory pointer that was not allocated: "
+              << ptr;
+  }
+  size_t size = iter->second;
+  slab_used_map_.erase(iter);
+  slab_bytes_used_ -= size;
+  // merging the block with its free neighbors is the expensive part of
+  // freeing, so we just queue it here and do the merging in batches, in
+  // CoalescePendingFreed().
+  slab_pending_.push_back(
+      std::pair<char*, size_t>(static_cast<char*>(ptr), size));
+  slab_pending_bytes_ += size;
+  if (slab_pending_.size() >= kSlabPendingLimit)
+    CoalescePendingFreed();
+}
+
+void CuMemoryAllocator::CoalescePendingFreed() {
+  for (size_t i = 0; i < slab_pending_.size(); i++) {
+    char *addr = slab_pending_[i].first;
+    size_t size = slab_pending_[i].second;
+    // merge with the free neighbor just above this block, if contiguous.
+    std::map<char*, size_t>::iterator iter = slab_free_.upper_bound(addr);
+    if (iter != slab_free_.end() && addr + size == iter->first) {
+      size_t next_size = iter->second;
+      RemoveSlabFreeBlock(iter->first, next_size);
+      size += next_size;
+    }
+    // ... and with the free neighbor just below it.
+    iter = slab_free_.upper_bound(addr);
+    if (iter != slab_free_.begin()) {
+      --iter;
+      if (iter->first + iter->second == addr) {
+        char *prev_addr = iter->first;
+        size_t prev_size = iter->second;
+        RemoveSlabFreeBlock(prev_addr, prev_size);
+        addr = prev_addr;
+        size += prev_size;
+      }
+    }
+    slab_free_[addr] = size;
+    slab_free_by_size_.insert(std::pair<size_t, char*>(size, addr));
+  }
+  slab_pending_.clear();
+  slab_pending_bytes_ = 0;
+}
+
+void CuMemoryAllocator::RemoveSlabFreeBlock(char *addr, size_t size) {
+  size_t num_erased = slab_free_.erase(addr);
+  KALDI_ASSERT(num_erased == 1);
+  typedef std::multimap<size_t, char*>::iterator IterType;
+  std::pair<IterType, IterType> range = slab_free_by_size_.equal_range(size);
+  for (IterType iter = range.first; iter != range.second; ++iter) {
+    if (iter->second == addr) {
+      slab_free_by_size_.erase(iter);
+      return;
+    }
+  }
+  KALDI_ASSERT(0 && "Code error: slab free-list indexes out of sync.");
+}
+
 size_t CuMemoryAllocator::MruCache::LeastRecentTime() const {
   if (list_.empty()) {
     KALDI_PARANOID_ASSERT(map_.empty());
@@ -53,11 +53,24 @@ struct CuAllocatorOptions {
   // is a constant overhead proportional to the number of buckets.
   BaseFloat delete_factor;
 
+  // If nonzero, this proportion of the GPU's free memory is allocated as one
+  // large slab when the device is initialized, and allocation requests are
+  // served by best-fit sub-allocation from that slab (coalescing of adjacent
+  // freed blocks is done in deferred batches, off the fast path).  This means
+  // we never call cudaMalloc after startup, whose occasional latency of
+  // 50-200ms is a problem for long-running online-decoding servers.  Requests
+  // that don't fit in the slab fall back to the regular caching allocator.
+  // Zero disables slab mode; see also CuDevice::ReserveSlabMemory() for
+  // turning it on at runtime.
+  BaseFloat slab_proportion;
+
   CuAllocatorOptions(): memory_factor(1.5),
-                        delete_factor(0.001) { }
+                        delete_factor(0.001),
+                        slab_proportion(0.0) { }
 
   void Check() {
     KALDI_ASSERT(delete_factor < memory_factor - 1.0 && delete_factor > 0.0);
+    KALDI_ASSERT(slab_proportion >= 0.0 && slab_proportion < 1.0);
   }
 };
 
@@ -88,6 +101,16 @@ class CuMemoryAllocator {
 
   void PrintMemoryUsage() const;
 
+  const CuAllocatorOptions &Opts() const { return opts_; }
+
+  // Reserves a slab of GPU memory of approximately this many bytes (rounded
+  // down to a multiple of the slab alignment), from which subsequent requests
+  // will be sub-allocated; see the comment for
+  // CuAllocatorOptions::slab_proportion.  Normally called once, shortly after
+  // the device is initialized.  On failure this prints a warning and leaves
+  // slab mode disabled-- the slab is an optimization, not a requirement.
+  void ReserveSlab(size_t bytes);
+
   CuMemoryAllocator(CuAllocatorOptions opts);
  private:
 
@@ -218,6 +241,52 @@ class CuMemoryAllocator {
   // the information when people call Free() and we add it back into the cache.
   unordered_map<void*, UsedMemoryElement, PointerHasher> used_map_;
 
+  // The members below implement the optional slab mode (see
+  // CuAllocatorOptions::slab_proportion), in which one large region is
+  // obtained from CUDA up front and we sub-allocate from it ourselves.
+  // Pointers handed out from the slab never enter the MruCaches above (those
+  // cudaFree their contents); Free() recognizes them by address range.
+
+  // Attempts to serve an allocation request by best-fit search of the slab's
+  // free list; returns NULL if slab mode is disabled or no sufficiently large
+  // free block exists even after coalescing (the caller then falls back to
+  // the caching allocator).
+  void *SlabMalloc(size_t row_bytes, size_t num_rows, size_t *pitch);
+
+  // Returns 'ptr' (which must have come from SlabMalloc) to the slab.  The
+  // block goes onto a pending list; merging it back into the free list is
+  // deferred to CoalescePendingFreed().
+  void SlabFree(void *ptr);
+
+  // Moves all blocks from the pending list into the free list, merging each
+  // with adjacent free blocks.  Doing this in batches amortizes the cost and
+  // keeps it off the fast path of Free().
+  void CoalescePendingFreed();
+
+  // Removes the free block ('addr', 'size') from both free-list indexes.
+  void RemoveSlabFreeBlock(char *addr, size_t size);
+
+  char *slab_begin_;  // start of the slab, or NULL if slab mode is disabled.
+  size_t slab_size_;  // size of the slab in bytes, or 0.
+  size_t slab_bytes_used_;  // bytes of the slab currently owned by callers.
+  size_t slab_max_bytes_used_;  // the max over all time, of slab_bytes_used_.
+  size_t num_slab_allocations_;  // number of requests served from the slab.
+  size_t num_slab_misses_;  // number of requests that did not fit in the slab
+                            // and fell back to the caching allocator.
+
+  // free blocks of the slab, indexed by address; used for coalescing.
+  std::map<char*, size_t> slab_free_;
+  // the same free blocks indexed by size; used for best-fit lookup.
+  std::multimap<size_t, char*> slab_free_by_size_;
+  // blocks that have been freed but not yet coalesced into slab_free_.
+  std::vector<std::pair<char*, size_t> > slab_pending_;
+  size_t slab_pending_bytes_;  // total bytes in slab_pending_.
+
+  // map from pointers handed out from the slab to the number of bytes of the
+  // slab they reserve (which may be a little more than was asked for, due to
+  // alignment).
+  unordered_map<void*, size_t, PointerHasher> slab_used_map_;
+
 };
 
 
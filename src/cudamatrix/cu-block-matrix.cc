@@ -232,6 +232,49 @@ void CuBlockMatrix<Real>::AddMatMat(
   if (CuDevice::Instantiate().Enabled()) {
     Timer tim;
 
+    // If all the blocks have the same dimensions (the usual case, e.g. for
+    // block-diagonal layers), we can do all the per-block products in a
+    // single cublasGemmBatched call via AddMatMatBatched().  For many small
+    // blocks this is much faster than the custom kernel below, whose thread
+    // geometry limits how much parallelism each block gets.
+    bool uniform_blocks = true;
+    for (int32 b = 1; b < NumBlocks(); b++) {
+      if (block_data_[b].num_rows != block_data_[0].num_rows ||
+          block_data_[b].num_cols != block_data_[0].num_cols) {
+        uniform_blocks = false;
+        break;
+      }
+    }
+    if (uniform_blocks) {
+      std::vector<CuSubMatrix<Real>* > C_batch, A_batch, B_batch;
+      int32 row_offset = 0, col_offset = 0;
+      for (MatrixIndexT b = 0; b < NumBlocks(); b++) {
+        CuSubMatrix<Real> *this_block = new CuSubMatrix<Real>(Block(b));
+        MatrixIndexT this_num_rows = this_block->NumRows(),
+            this_num_cols = this_block->NumCols();
+        A_batch.push_back(new CuSubMatrix<Real>(
+            transA == kNoTrans ?
+            A.Range(row_offset, this_num_rows, 0, A.NumCols()) :
+            A.Range(0, A.NumRows(), row_offset, this_num_rows)));
+        B_batch.push_back(new CuSubMatrix<Real>(
+            transB == kNoTrans ?
+            B.Range(0, B.NumRows(), col_offset, this_num_cols) :
+            B.Range(col_offset, this_num_cols, 0, B.NumCols())));
+        C_batch.push_back(this_block);
+        row_offset += this_num_rows;
+        col_offset += this_num_cols;
+      }
+      AddMatMatBatched(static_cast<Real>(alpha), C_batch, A_batch, transA,
+                       B_batch, transB, static_cast<Real>(beta));
+      for (MatrixIndexT b = 0; b < NumBlocks(); b++) {
+        delete A_batch[b];
+        delete B_batch[b];
+        delete C_batch[b];
+      }
+      CuDevice::Instantiate().AccuProfile(__func__, tim.Elapsed());
+      return;
+    }
+
     // (x,y,z) dimensions are (block-id, row-of-block, col-of-block)
     // First some logic to choose block dims...
     // we assume (which we can, safely) that CU1DBLOCK is <= the max threads per block.
@@ -0,0 +1,174 @@
+// cudamatrix/cu-block-sparse-matrix-test.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "cudamatrix/cu-matrix-lib.h"
+
+using namespace kaldi;
+
+namespace kaldi {
+
+// Returns a random matrix in which a random subset of the blocks has been
+// zeroed, like a structurally pruned weight matrix.
+static void GetRandBlockZeroedMatrix(int32 rows, int32 cols,
+                                     int32 block_rows, int32 block_cols,
+                                     CuMatrix<BaseFloat> *mat) {
+  Matrix<BaseFloat> host(rows, cols);
+  host.SetRandn();
+  for (int32 br = 0; br * block_rows < rows; br++) {
+    for (int32 bc = 0; bc * block_cols < cols; bc++) {
+      if (Rand() % 4 != 0) {  // keep roughly a quarter of the blocks.
+        SubMatrix<BaseFloat> block(host, br * block_rows,
+                                   std::min(block_rows, rows - br * block_rows),
+                                   bc * block_cols,
+                                   std::min(block_cols, cols - bc * block_cols));
+        block.SetZero();
+      }
+    }
+  }
+  mat->Resize(rows, cols, kUndefined);
+  mat->CopyFromMat(host);
+}
+
+static void UnitTestCuBlockSparseMatrixRoundTrip() {
+  for (int32 i = 0; i < 10; i++) {
+    int32 block_rows = 1 + Rand() % 8, block_cols = 1 + Rand() % 8;
+    int32 rows = 1 + Rand() % 50, cols = 1 + Rand() % 50;
+    CuMatrix<BaseFloat> mat;
+    GetRandBlockZeroedMatrix(rows, cols, block_rows, block_cols, &mat);
+    // with threshold 0.0 only exactly-zero blocks are dropped, so the
+    // round trip is lossless.
+    CuBlockSparseMatrix smat(mat, block_rows, block_cols, 0.0);
+    KALDI_ASSERT(smat.Density() <= 1.0);
+    CuMatrix<BaseFloat> mat2(rows, cols);
+    smat.CopyToMat(&mat2);
+    KALDI_ASSERT(mat.ApproxEqual(mat2, 1.0e-06));
+  }
+}
+
+static void UnitTestCuBlockSparseMatrixThreshold() {
+  // with a nonzero threshold, the surviving matrix must differ from the
+  // original by at most the threshold in each element (dropped blocks had
+  // all elements at or below it).
+  for (int32 i = 0; i < 10; i++) {
+    int32 block_rows = 1 + Rand() % 8, block_cols = 1 + Rand() % 8;
+    int32 rows = 1 + Rand() % 50, cols = 1 + Rand() % 50;
+    CuMatrix<BaseFloat> mat(rows, cols);
+    mat.SetRandn();
+    BaseFloat threshold = 0.5 * RandUniform();
+    CuBlockSparseMatrix smat(mat, block_rows, block_cols, threshold);
+    CuMatrix<BaseFloat> mat2(rows, cols);
+    smat.CopyToMat(&mat2);
+    Matrix<BaseFloat> h1(mat), h2(mat2);
+    for (int32 r = 0; r < rows; r++)
+      for (int32 c = 0; c < cols; c++)
+        KALDI_ASSERT(std::abs(h1(r, c) - h2(r, c)) <= threshold);
+  }
+}
+
+static void UnitTestCuBlockSparseMatrixIO() {
+  for (int32 i = 0; i < 6; i++) {
+    int32 block_rows = 1 + Rand() % 8, block_cols = 1 + Rand() % 8;
+    int32 rows = 1 + Rand() % 20, cols = 1 + Rand() % 20;
+    CuMatrix<BaseFloat> mat;
+    GetRandBlockZeroedMatrix(rows, cols, block_rows, block_cols, &mat);
+    CuBlockSparseMatrix smat(mat, block_rows, block_cols, 0.0);
+
+    std::ostringstream os;
+    bool binary = (i % 2 == 0);
+    smat.Write(os, binary);
+
+    CuBlockSparseMatrix smat2;
+    std::istringstream is(os.str());
+    smat2.Read(is, binary);
+
+    CuMatrix<BaseFloat> m1(rows, cols), m2(rows, cols);
+    smat.CopyToMat(&m1);
+    smat2.CopyToMat(&m2);
+    // text mode writes the block data with limited precision, so don't
+    // expect an exact round trip there.
+    KALDI_ASSERT(m1.ApproxEqual(m2, binary ? 1.0e-06 : 1.0e-04));
+
+    // also exercise the copy constructor.
+    CuBlockSparseMatrix smat3(smat);
+    smat3.CopyToMat(&m2);
+    KALDI_ASSERT(m1.ApproxEqual(m2, 1.0e-06));
+  }
+}
+
+static void UnitTestAddMatBlockSparse() {
+  for (int32 i = 0; i < 10; i++) {
+    MatrixTransposeType transB = (i % 2 == 0 ? kNoTrans : kTrans);
+    int32 block_rows = 1 + Rand() % 8, block_cols = 1 + Rand() % 8;
+    int32 n = 5 + Rand() % 20, o = 5 + Rand() % 20, d = 5 + Rand() % 20;
+    CuMatrix<BaseFloat> A(n, d), C(n, o), C2(n, o);
+    CuMatrix<BaseFloat> B_orig;
+    GetRandBlockZeroedMatrix(transB == kTrans ? o : d,
+                             transB == kTrans ? d : o,
+                             block_rows, block_cols, &B_orig);
+    A.SetRandn();
+    C.SetRandn();
+    C2.CopyFromMat(C);
+
+    CuBlockSparseMatrix B(B_orig, block_rows, block_cols, 0.0);
+    AddMatBlockSparse(0.5, A, kNoTrans, B, transB, 0.25, &C);
+
+    // reference: the dense product with the same matrix.
+    C2.AddMatMat(0.5, A, kNoTrans, B_orig, transB, 0.25);
+    KALDI_ASSERT(C.ApproxEqual(C2, 1.0e-05));
+  }
+}
+
+void CuBlockSparseMatrixUnitTest() {
+  UnitTestCuBlockSparseMatrixRoundTrip();
+  UnitTestCuBlockSparseMatrixThreshold();
+  UnitTestCuBlockSparseMatrixIO();
+  UnitTestAddMatBlockSparse();
+}
+
+}  // namespace kaldi
+
+
+int main() {
+  for (int32 loop = 0; loop < 2; loop++) {
+#if HAVE_CUDA == 1
+    if (loop == 0)
+      CuDevice::Instantiate().SelectGpuId("no"); // -1 means no GPU
+    else
+      CuDevice::Instantiate().SelectGpuId("yes"); // -2 .. automatic selection
+#endif
+
+    kaldi::CuBlockSparseMatrixUnitTest();
+
+    if (loop == 0)
+      KALDI_LOG << "Tests without GPU use succeeded.";
+    else
+      KALDI_LOG << "Tests with GPU use (if available) succeeded.";
+  }
+#if HAVE_CUDA == 1
+  CuDevice::Instantiate().PrintProfile();
+#endif
+  return 0;
+}
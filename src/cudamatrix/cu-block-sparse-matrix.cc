@@ -0,0 +1,252 @@
+// cudamatrix/cu-block-sparse-matrix.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#if HAVE_CUDA == 1
+#include <cuda_runtime_api.h>
+#endif
+
+#include "base/timer.h"
+#include "cudamatrix/cu-common.h"
+#include "cudamatrix/cu-block-sparse-matrix.h"
+#include "cudamatrix/cu-device.h"
+#include "cudamatrix/cu-kernels.h"
+
+namespace kaldi {
+
+BaseFloat CuBlockSparseMatrix::Density() const {
+  if (num_rows_ == 0 || num_cols_ == 0) return 0.0;
+  int32 num_block_rows = (num_rows_ + block_rows_ - 1) / block_rows_,
+      num_block_cols = (num_cols_ + block_cols_ - 1) / block_cols_;
+  return NumBlocks() /
+      (static_cast<BaseFloat>(num_block_rows) * num_block_cols);
+}
+
+void CuBlockSparseMatrix::SyncIndexesToDevice() {
+  block_row_ptr_gpu_.CopyFromVec(block_row_ptr_);
+  block_col_idx_gpu_.CopyFromVec(block_col_idx_);
+}
+
+void CuBlockSparseMatrix::CopyFromMat(const CuMatrixBase<BaseFloat> &mat,
+                                      int32 block_rows, int32 block_cols,
+                                      BaseFloat threshold) {
+  KALDI_ASSERT(block_rows > 0 && block_cols > 0 && threshold >= 0.0);
+  num_rows_ = mat.NumRows();
+  num_cols_ = mat.NumCols();
+  block_rows_ = block_rows;
+  block_cols_ = block_cols;
+  block_row_ptr_.clear();
+  block_col_idx_.clear();
+  if (num_rows_ == 0) {
+    block_row_ptr_.push_back(0);
+    block_data_.Resize(0, 0);
+    SyncIndexesToDevice();
+    return;
+  }
+  // The selection of blocks happens once, at model-conversion or
+  // model-loading time, so we stage through host memory rather than adding
+  // a kernel for it.
+  Matrix<BaseFloat> host(num_rows_, num_cols_, kUndefined);
+  mat.CopyToMat(&host);
+  int32 num_block_rows = (num_rows_ + block_rows_ - 1) / block_rows_,
+      num_block_cols = (num_cols_ + block_cols_ - 1) / block_cols_;
+  block_row_ptr_.resize(num_block_rows + 1, 0);
+  for (int32 br = 0; br < num_block_rows; br++) {
+    block_row_ptr_[br] = block_col_idx_.size();
+    int32 valid_rows = std::min<int32>(block_rows_,
+                                       num_rows_ - br * block_rows_);
+    for (int32 bc = 0; bc < num_block_cols; bc++) {
+      int32 valid_cols = std::min<int32>(block_cols_,
+                                         num_cols_ - bc * block_cols_);
+      BaseFloat max_abs = 0.0;
+      for (int32 r = 0; r < valid_rows; r++)
+        for (int32 c = 0; c < valid_cols; c++)
+          max_abs = std::max(max_abs,
+                             std::abs(host(br * block_rows_ + r,
+                                           bc * block_cols_ + c)));
+      if (max_abs > threshold)
+        block_col_idx_.push_back(bc);
+    }
+  }
+  block_row_ptr_[num_block_rows] = block_col_idx_.size();
+
+  int32 num_blocks = block_col_idx_.size();
+  if (num_blocks == 0) {  // everything was below the threshold.
+    block_data_.Resize(0, 0);
+    SyncIndexesToDevice();
+    return;
+  }
+  Matrix<BaseFloat> blocks(num_blocks * block_rows_, block_cols_);  // zeroed,
+                                       // so edge blocks get zero padding.
+  for (int32 br = 0; br < num_block_rows; br++) {
+    int32 valid_rows = std::min<int32>(block_rows_,
+                                       num_rows_ - br * block_rows_);
+    for (int32 b = block_row_ptr_[br]; b < block_row_ptr_[br + 1]; b++) {
+      int32 bc = block_col_idx_[b];
+      int32 valid_cols = std::min<int32>(block_cols_,
+                                         num_cols_ - bc * block_cols_);
+      SubMatrix<BaseFloat> src(host, br * block_rows_, valid_rows,
+                               bc * block_cols_, valid_cols),
+          dst(blocks, b * block_rows_, valid_rows, 0, valid_cols);
+      dst.CopyFromMat(src);
+    }
+  }
+  block_data_.Resize(num_blocks * block_rows_, block_cols_, kUndefined);
+  if (num_blocks != 0)
+    block_data_.CopyFromMat(blocks);
+  SyncIndexesToDevice();
+}
+
+void CuBlockSparseMatrix::CopyToMat(CuMatrixBase<BaseFloat> *mat) const {
+  KALDI_ASSERT(mat->NumRows() == num_rows_ && mat->NumCols() == num_cols_);
+  mat->SetZero();
+  int32 num_block_rows = static_cast<int32>(block_row_ptr_.size()) - 1;
+  for (int32 br = 0; br < num_block_rows; br++) {
+    int32 valid_rows = std::min<int32>(block_rows_,
+                                       num_rows_ - br * block_rows_);
+    for (int32 b = block_row_ptr_[br]; b < block_row_ptr_[br + 1]; b++) {
+      int32 bc = block_col_idx_[b];
+      int32 valid_cols = std::min<int32>(block_cols_,
+                                         num_cols_ - bc * block_cols_);
+      CuSubMatrix<BaseFloat> src(block_data_, b * block_rows_, valid_rows,
+                                 0, valid_cols),
+          dst(*mat, br * block_rows_, valid_rows,
+              bc * block_cols_, valid_cols);
+      dst.CopyFromMat(src);
+    }
+  }
+}
+
+void CuBlockSparseMatrix::Write(std::ostream &os, bool binary) const {
+  WriteToken(os, binary, "<CuBlockSparseMatrix>");
+  WriteToken(os, binary, "<NumRows>");
+  WriteBasicType(os, binary, static_cast<int32>(num_rows_));
+  WriteToken(os, binary, "<NumCols>");
+  WriteBasicType(os, binary, static_cast<int32>(num_cols_));
+  WriteToken(os, binary, "<BlockRows>");
+  WriteBasicType(os, binary, block_rows_);
+  WriteToken(os, binary, "<BlockCols>");
+  WriteBasicType(os, binary, block_cols_);
+  WriteToken(os, binary, "<BlockRowPtr>");
+  WriteIntegerVector(os, binary, block_row_ptr_);
+  WriteToken(os, binary, "<BlockColIdx>");
+  WriteIntegerVector(os, binary, block_col_idx_);
+  WriteToken(os, binary, "<Data>");
+  Matrix<BaseFloat> blocks(block_data_.NumRows(), block_data_.NumCols(),
+                           kUndefined);
+  if (blocks.NumRows() != 0)
+    block_data_.CopyToMat(&blocks);
+  blocks.Write(os, binary);
+  WriteToken(os, binary, "</CuBlockSparseMatrix>");
+  if (!os.good())
+    KALDI_ERR << "Error writing CuBlockSparseMatrix to stream";
+}
+
+void CuBlockSparseMatrix::Read(std::istream &is, bool binary) {
+  ExpectToken(is, binary, "<CuBlockSparseMatrix>");
+  int32 num_rows, num_cols;
+  ExpectToken(is, binary, "<NumRows>");
+  ReadBasicType(is, binary, &num_rows);
+  ExpectToken(is, binary, "<NumCols>");
+  ReadBasicType(is, binary, &num_cols);
+  ExpectToken(is, binary, "<BlockRows>");
+  ReadBasicType(is, binary, &block_rows_);
+  ExpectToken(is, binary, "<BlockCols>");
+  ReadBasicType(is, binary, &block_cols_);
+  ExpectToken(is, binary, "<BlockRowPtr>");
+  ReadIntegerVector(is, binary, &block_row_ptr_);
+  ExpectToken(is, binary, "<BlockColIdx>");
+  ReadIntegerVector(is, binary, &block_col_idx_);
+  ExpectToken(is, binary, "<Data>");
+  Matrix<BaseFloat> blocks;
+  blocks.Read(is, binary);
+  ExpectToken(is, binary, "</CuBlockSparseMatrix>");
+  num_rows_ = num_rows;
+  num_cols_ = num_cols;
+  KALDI_ASSERT(block_rows_ > 0 && block_cols_ > 0 &&
+               static_cast<int32>(block_col_idx_.size()) * block_rows_ ==
+               blocks.NumRows());
+  block_data_.Resize(blocks.NumRows(), blocks.NumCols(), kUndefined);
+  if (blocks.NumRows() != 0)
+    block_data_.CopyFromMat(blocks);
+  SyncIndexesToDevice();
+}
+
+void AddMatBlockSparse(BaseFloat alpha,
+                       const CuMatrixBase<BaseFloat> &A,
+                       MatrixTransposeType transA,
+                       const CuBlockSparseMatrix &B,
+                       MatrixTransposeType transB,
+                       BaseFloat beta,
+                       CuMatrixBase<BaseFloat> *C) {
+  KALDI_ASSERT(transA == kNoTrans &&
+               "AddMatBlockSparse: only transA == kNoTrans is implemented.");
+  MatrixIndexT b_rows = (transB == kTrans ? B.NumCols() : B.NumRows()),
+      b_cols = (transB == kTrans ? B.NumRows() : B.NumCols());
+  KALDI_ASSERT(A.NumRows() == C->NumRows() && A.NumCols() == b_rows &&
+               C->NumCols() == b_cols);
+  if (C->NumRows() == 0 || C->NumCols() == 0) return;
+  if (beta != 1.0)
+    C->Scale(beta);  // the per-block products below (and the kernel) add.
+
+#if HAVE_CUDA == 1 && (KALDI_DOUBLEPRECISION == 0)
+  if (CuDevice::Instantiate().Enabled() && transB == kTrans) {
+    Timer tim;
+    dim3 dimBlock(CU2DBLOCK, CU2DBLOCK);
+    dim3 dimGrid(n_blocks(C->NumCols(), CU2DBLOCK),
+                 n_blocks(C->NumRows(), CU2DBLOCK));
+    cuda_add_mat_blocksparse(dimGrid, dimBlock, alpha, A.Data(), A.Dim(),
+                             B.block_data_.Data(), B.block_data_.Stride(),
+                             B.block_row_ptr_gpu_.Data(),
+                             B.block_col_idx_gpu_.Data(),
+                             B.block_rows_, B.block_cols_,
+                             C->Data(), C->Dim());
+    CU_SAFE_CALL(cudaGetLastError());
+    CuDevice::Instantiate().AccuProfile(__func__, tim.Elapsed());
+    return;
+  }
+#endif
+  // One small GEMM per stored block; on CPU these go through BLAS.  (With a
+  // GPU but transB == kNoTrans, i.e. the backprop direction, we also take
+  // this path; that direction is not on the critical inference path.)
+  int32 num_block_rows = static_cast<int32>(B.block_row_ptr_.size()) - 1;
+  for (int32 br = 0; br < num_block_rows; br++) {
+    int32 valid_rows = std::min<int32>(B.block_rows_,
+                                       B.num_rows_ - br * B.block_rows_);
+    for (int32 b = B.block_row_ptr_[br]; b < B.block_row_ptr_[br + 1]; b++) {
+      int32 bc = B.block_col_idx_[b];
+      int32 valid_cols = std::min<int32>(B.block_cols_,
+                                         B.num_cols_ - bc * B.block_cols_);
+      CuSubMatrix<BaseFloat> block(B.block_data_, b * B.block_rows_,
+                                   valid_rows, 0, valid_cols);
+      if (transB == kTrans) {
+        CuSubMatrix<BaseFloat> c_part(*C, 0, C->NumRows(),
+                                      br * B.block_rows_, valid_rows),
+            a_part(A, 0, A.NumRows(), bc * B.block_cols_, valid_cols);
+        c_part.AddMatMat(alpha, a_part, kNoTrans, block, kTrans, 1.0);
+      } else {
+        CuSubMatrix<BaseFloat> c_part(*C, 0, C->NumRows(),
+                                      bc * B.block_cols_, valid_cols),
+            a_part(A, 0, A.NumRows(), br * B.block_rows_, valid_rows);
+        c_part.AddMatMat(alpha, a_part, kNoTrans, block, kNoTrans, 1.0);
+      }
+    }
+  }
+}
+
+}  // namespace kaldi
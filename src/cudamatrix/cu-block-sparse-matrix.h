@@ -0,0 +1,134 @@
+// cudamatrix/cu-block-sparse-matrix.h
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_CUDAMATRIX_CU_BLOCK_SPARSE_MATRIX_H_
+#define KALDI_CUDAMATRIX_CU_BLOCK_SPARSE_MATRIX_H_
+
+#include <vector>
+#include "cudamatrix/cu-matrix.h"
+#include "cudamatrix/cu-array.h"
+
+namespace kaldi {
+
+/// Matrix stored in block-sparse-row (BSR) format: the matrix is divided
+/// into a grid of blocks of size block_rows by block_cols, and only the
+/// blocks whose largest absolute element exceeds a threshold are stored
+/// (contiguously, ordered by block-row and then by block-column within the
+/// block-row, with the usual CSR-style row-pointer and column-index
+/// arrays, except that the indexes refer to blocks rather than elements).
+/// It is intended for the weights of neural nets that have been pruned to
+/// high sparsity with a structured (block) pattern, where only a small
+/// fraction of the blocks survive; dropped blocks are treated as exactly
+/// zero.  The edge blocks of a matrix whose dimensions are not multiples
+/// of the block size are stored zero-padded.  The only operation provided
+/// besides conversion is AddMatBlockSparse() below, which is what the
+/// forward computation of an affine component needs.
+class CuBlockSparseMatrix {
+ public:
+  CuBlockSparseMatrix(): num_rows_(0), num_cols_(0),
+                         block_rows_(0), block_cols_(0) { }
+
+  CuBlockSparseMatrix(const CuMatrixBase<BaseFloat> &mat,
+                      int32 block_rows, int32 block_cols,
+                      BaseFloat threshold):
+      num_rows_(0), num_cols_(0), block_rows_(0), block_cols_(0) {
+    CopyFromMat(mat, block_rows, block_cols, threshold);
+  }
+
+  // Default copy constructor and assignment operator are fine: all members
+  // have value semantics.
+
+  MatrixIndexT NumRows() const { return num_rows_; }
+  MatrixIndexT NumCols() const { return num_cols_; }
+  int32 BlockRows() const { return block_rows_; }
+  int32 BlockCols() const { return block_cols_; }
+  /// Number of blocks actually stored.
+  int32 NumBlocks() const { return static_cast<int32>(block_col_idx_.size()); }
+  /// Fraction of the blocks of the full grid that are stored (in [0, 1]).
+  BaseFloat Density() const;
+
+  /// Sets *this to a block-sparse copy of "mat", keeping the blocks whose
+  /// largest absolute element is strictly greater than "threshold" (so with
+  /// threshold = 0.0, exactly-zero blocks are dropped and the conversion is
+  /// lossless).  This is intended to be done once, at model-loading or
+  /// model-conversion time, so it stages through CPU memory even on GPU.
+  void CopyFromMat(const CuMatrixBase<BaseFloat> &mat,
+                   int32 block_rows, int32 block_cols,
+                   BaseFloat threshold);
+
+  /// Converts back to dense form (dropped blocks become zero); "mat" must
+  /// already have the right size.
+  void CopyToMat(CuMatrixBase<BaseFloat> *mat) const;
+
+  void Read(std::istream &is, bool binary);
+  void Write(std::ostream &os, bool binary) const;
+
+ private:
+  friend void AddMatBlockSparse(BaseFloat alpha,
+                                const CuMatrixBase<BaseFloat> &A,
+                                MatrixTransposeType transA,
+                                const CuBlockSparseMatrix &B,
+                                MatrixTransposeType transB,
+                                BaseFloat beta,
+                                CuMatrixBase<BaseFloat> *C);
+
+  // Rebuilds the device-side copies of block_row_ptr_ / block_col_idx_
+  // after the host-side vectors have been set.
+  void SyncIndexesToDevice();
+
+  MatrixIndexT num_rows_;  // logical (dense) dimensions.
+  MatrixIndexT num_cols_;
+  int32 block_rows_;  // number of rows in each block.
+  int32 block_cols_;  // number of columns in each block.
+
+  // block_row_ptr_ has dimension (num block-rows + 1); the blocks of
+  // block-row br are those with indexes [block_row_ptr_[br],
+  // block_row_ptr_[br+1]), and block_col_idx_ gives their block-column
+  // indexes, in increasing order within each block-row.
+  std::vector<int32> block_row_ptr_;
+  std::vector<int32> block_col_idx_;
+  // Device-side copies of the two vectors above, for the CUDA kernel.
+  CuArray<int32> block_row_ptr_gpu_;
+  CuArray<int32> block_col_idx_gpu_;
+
+  // The stored blocks, stacked vertically: block b occupies rows
+  // [b * block_rows_, (b+1) * block_rows_) of this matrix, which has
+  // block_cols_ columns.  Edge blocks are zero-padded.
+  CuMatrix<BaseFloat> block_data_;
+};
+
+/// Does C = alpha * op(A) * op(B) + beta * C where B is block-sparse;
+/// equivalent to converting B to dense form and calling C->AddMatMat(),
+/// but only the stored blocks are visited, so the work is proportional to
+/// the density.  Currently only transA == kNoTrans is implemented (that is
+/// all the affine components need).  With transB == kTrans (the forward
+/// direction, activations times transposed weights) and a GPU enabled this
+/// runs as a single block-sparse kernel; otherwise it is done as one small
+/// GEMM per stored block, which on CPU goes through BLAS.
+void AddMatBlockSparse(BaseFloat alpha,
+                       const CuMatrixBase<BaseFloat> &A,
+                       MatrixTransposeType transA,
+                       const CuBlockSparseMatrix &B,
+                       MatrixTransposeType transB,
+                       BaseFloat beta,
+                       CuMatrixBase<BaseFloat> *C);
+
+}  // namespace kaldi
+
+#endif  // KALDI_CUDAMATRIX_CU_BLOCK_SPARSE_MATRIX_H_
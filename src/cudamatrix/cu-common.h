@@ -33,7 +33,18 @@
 #include <cublas_v2.h>
 #include <cuda_runtime_api.h>
 
-
+// When the toolkit is compiled with per-thread default streams (nvcc option
+// --default-stream=per-thread; see makefiles/linux_x86_64_cuda.mk), each host
+// thread issues its kernels to its own stream, and after each call we
+// synchronize just that stream rather than the whole device: this still
+// catches errors from our own kernels but does not serialize against work
+// that other threads have in flight.  See also the multi-stream support in
+// cu-device.h.
+#ifdef CUDA_API_PER_THREAD_DEFAULT_STREAM
+#define KALDI_CUDA_SYNCHRONIZE() cudaStreamSynchronize(cudaStreamPerThread)
+#else
+#define KALDI_CUDA_SYNCHRONIZE() cudaDeviceSynchronize()
+#endif
 
 #define CU_SAFE_CALL(fun) \
 { \
@@ -41,16 +52,16 @@
   if ((ret = (fun)) != 0) { \
     KALDI_ERR << "cudaError_t " << ret << " : \"" << cudaGetErrorString((cudaError_t)ret) << "\" returned from '" << #fun << "'"; \
   } \
-  cudaDeviceSynchronize(); \
-} 
+  KALDI_CUDA_SYNCHRONIZE(); \
+}
 
 #define KALDI_CUDA_ERR(ret, msg) \
 { \
   if (ret != 0) { \
     KALDI_ERR << msg << ", diagnostics: cudaError_t " << ret << " : \"" << cudaGetErrorString((cudaError_t)ret) << "\", in " << __FILE__ << ":" << __LINE__; \
   } \
-  cudaDeviceSynchronize(); \
-} 
+  KALDI_CUDA_SYNCHRONIZE(); \
+}
 
 namespace kaldi {
 
@@ -0,0 +1,131 @@
+// cudamatrix/cu-compressed-matrix-test.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <iostream>
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "cudamatrix/cu-matrix-lib.h"
+
+using namespace kaldi;
+
+namespace kaldi {
+
+// Checks that compressing on the device (or the host fallback) and
+// decompressing again agrees with what class CompressedMatrix does on the
+// same data.  The device compression is designed to match the CPU's, but
+// the compiler is free to contract the quantization arithmetic into fused
+// multiply-adds on the device, which can move a borderline element by one
+// code, so we allow each element one quantization step of slack.
+static void UnitTestCuCompressedMatrixVsCpu() {
+  for (int32 i = 0; i < 15; i++) {
+    // make sure both the >8-rows format and the small-matrix format get
+    // exercised.
+    int32 rows = 1 + Rand() % 50, cols = 1 + Rand() % 50;
+    CuMatrix<BaseFloat> mat(rows, cols);
+    mat.SetRandn();
+    if (i % 3 == 0) mat.Set(17.3);  // constant matrix (pathological case).
+
+    CuCompressedMatrix cmat(mat);
+    KALDI_ASSERT(cmat.NumRows() == rows && cmat.NumCols() == cols);
+    CuMatrix<BaseFloat> mat2(rows, cols);
+    cmat.CopyToMat(&mat2);
+
+    Matrix<BaseFloat> host(mat);
+    CompressedMatrix compressed_cpu(host);
+    Matrix<BaseFloat> cpu_round_trip(rows, cols);
+    compressed_cpu.CopyToMat(&cpu_round_trip);
+
+    Matrix<BaseFloat> gpu_round_trip(mat2);
+    // the coarsest quantization step any element can have is (width of the
+    // widest segment) / 63, which is no more than range / 63.
+    BaseFloat range = host.Max() - host.Min(),
+        tol = range / 63.0 + 1.0e-05;
+    for (int32 r = 0; r < rows; r++)
+      for (int32 c = 0; c < cols; c++)
+        KALDI_ASSERT(std::abs(cpu_round_trip(r, c) - gpu_round_trip(r, c))
+                     <= tol);
+  }
+}
+
+// Checks the raw upload/download path: uploading a CompressedMatrix and
+// downloading it again must reproduce it byte for byte, and decompressing
+// the uploaded copy must match decompressing the original.
+static void UnitTestCuCompressedMatrixUploadDownload() {
+  for (int32 i = 0; i < 10; i++) {
+    int32 rows = 1 + Rand() % 50, cols = 1 + Rand() % 50;
+    Matrix<BaseFloat> host(rows, cols);
+    host.SetRandn();
+    CompressedMatrix compressed(host);
+
+    CuCompressedMatrix cmat(compressed);
+    CompressedMatrix compressed2;
+    cmat.CopyToCompressed(&compressed2);
+
+    Matrix<BaseFloat> m1(rows, cols), m2(rows, cols);
+    compressed.CopyToMat(&m1);
+    compressed2.CopyToMat(&m2);
+    KALDI_ASSERT(m1.Equal(m2));
+
+    CuMatrix<BaseFloat> cu_mat(rows, cols);
+    cmat.CopyToMat(&cu_mat);
+    Matrix<BaseFloat> m3(cu_mat);
+    AssertEqual(m1, m3);
+
+    // also exercise the copy constructor and Clear().
+    CuCompressedMatrix cmat2(cmat);
+    cmat2.CopyToMat(&cu_mat);
+    Matrix<BaseFloat> m4(cu_mat);
+    KALDI_ASSERT(m3.Equal(m4));
+    cmat2.Clear();
+    KALDI_ASSERT(cmat2.NumRows() == 0 && cmat2.NumCols() == 0);
+  }
+}
+
+static void CuCompressedMatrixUnitTest() {
+  UnitTestCuCompressedMatrixVsCpu();
+  UnitTestCuCompressedMatrixUploadDownload();
+}
+
+}  // namespace kaldi
+
+
+int main() {
+  for (int32 loop = 0; loop < 2; loop++) {
+#if HAVE_CUDA == 1
+    if (loop == 0)
+      CuDevice::Instantiate().SelectGpuId("no"); // -1 means no GPU
+    else
+      CuDevice::Instantiate().SelectGpuId("yes"); // -2 .. automatic selection
+#endif
+
+    kaldi::CuCompressedMatrixUnitTest();
+
+    if (loop == 0)
+      KALDI_LOG << "Tests without GPU use succeeded.";
+    else
+      KALDI_LOG << "Tests with GPU use (if available) succeeded.";
+  }
+#if HAVE_CUDA == 1
+  CuDevice::Instantiate().PrintProfile();
+#endif
+  return 0;
+}
@@ -0,0 +1,250 @@
+// cudamatrix/cu-compressed-matrix.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#if HAVE_CUDA == 1
+#include <cuda_runtime_api.h>
+#endif
+
+#include "base/timer.h"
+#include "cudamatrix/cu-common.h"
+#include "cudamatrix/cu-compressed-matrix.h"
+#include "cudamatrix/cu-device.h"
+#include "cudamatrix/cu-vector.h"
+#include "cudamatrix/cu-kernels.h"
+
+namespace kaldi {
+
+// The helpers below allocate and copy device-or-host memory; they are the
+// same as the ones in cu-quantized-matrix.cc.
+
+static void *CompressedAlloc(size_t num_bytes) {
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled())
+    return CuDevice::Instantiate().Malloc(num_bytes);
+#endif
+  void *ans = malloc(num_bytes);
+  if (ans == NULL)
+    KALDI_ERR << "Memory allocation failed, num bytes = " << num_bytes;
+  return ans;
+}
+
+static void CompressedFree(void *ptr) {
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    CuDevice::Instantiate().Free(ptr);
+    return;
+  }
+#endif
+  free(ptr);
+}
+
+static void CompressedCopyToDevice(void *dst, const void *src,
+                                   size_t num_bytes) {
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    CU_SAFE_CALL(cudaMemcpy(dst, src, num_bytes, cudaMemcpyHostToDevice));
+    return;
+  }
+#endif
+  memcpy(dst, src, num_bytes);
+}
+
+static void CompressedCopyToHost(void *dst, const void *src,
+                                 size_t num_bytes) {
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    CU_SAFE_CALL(cudaMemcpy(dst, src, num_bytes, cudaMemcpyDeviceToHost));
+    return;
+  }
+#endif
+  memcpy(dst, src, num_bytes);
+}
+
+void CuCompressedMatrix::Destroy() {
+  if (data_ != NULL)
+    CompressedFree(data_);
+  data_ = NULL;
+  format_ = 0;
+  min_value_ = 0.0;
+  range_ = 0.0;
+  num_rows_ = 0;
+  num_cols_ = 0;
+}
+
+MatrixIndexT CuCompressedMatrix::DataSize() const {
+  if (num_rows_ == 0) return 0;
+  CompressedMatrix::GlobalHeader header;
+  header.format = format_;
+  header.min_value = min_value_;
+  header.range = range_;
+  header.num_rows = num_rows_;
+  header.num_cols = num_cols_;
+  return CompressedMatrix::DataSize(header);
+}
+
+CuCompressedMatrix &CuCompressedMatrix::operator = (
+    const CuCompressedMatrix &other) {
+  if (this == &other) return *this;
+  Destroy();
+  format_ = other.format_;
+  min_value_ = other.min_value_;
+  range_ = other.range_;
+  num_rows_ = other.num_rows_;
+  num_cols_ = other.num_cols_;
+  if (num_rows_ == 0) return *this;
+  size_t num_bytes = DataSize();
+  data_ = CompressedAlloc(num_bytes);
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    CU_SAFE_CALL(cudaMemcpy(data_, other.data_, num_bytes,
+                            cudaMemcpyDeviceToDevice));
+    return *this;
+  }
+#endif
+  memcpy(data_, other.data_, num_bytes);
+  return *this;
+}
+
+void CuCompressedMatrix::CopyFromMat(const CuMatrixBase<BaseFloat> &mat) {
+  Destroy();
+  if (mat.NumRows() == 0) return;  // zero-size matrix stored as zero pointer.
+  num_rows_ = mat.NumRows();
+  num_cols_ = mat.NumCols();
+#if HAVE_CUDA == 1 && (KALDI_DOUBLEPRECISION == 0)
+  if (CuDevice::Instantiate().Enabled()) {
+    Timer tim;
+    CuVector<BaseFloat> min_max(2, kUndefined);
+    cuda_compressed_min_max(mat.Data(), mat.Dim(), min_max.Data());
+    CU_SAFE_CALL(cudaGetLastError());
+    Vector<BaseFloat> min_max_host(2, kUndefined);
+    min_max.CopyToVec(&min_max_host);
+    // From here the global header is set up exactly as in
+    // CompressedMatrix::CopyFromMat() (see there for the rationale).
+    float min_value = min_max_host(0), max_value = min_max_host(1);
+    if (max_value == min_value)
+      max_value = min_value + (1.0 + fabs(min_value));
+    KALDI_ASSERT(KALDI_ISFINITE(min_value) && KALDI_ISFINITE(max_value));
+    format_ = (num_rows_ > 8 ? 1 : 2);
+    min_value_ = min_value;
+    range_ = max_value - min_value;
+    if (range_ <= 0.0)
+      range_ = 1.0e-05;
+
+    CompressedMatrix::GlobalHeader header;
+    header.format = format_;
+    header.min_value = min_value_;
+    header.range = range_;
+    header.num_rows = num_rows_;
+    header.num_cols = num_cols_;
+    data_ = CompressedAlloc(CompressedMatrix::DataSize(header));
+    CU_SAFE_CALL(cudaMemcpy(data_, &header, sizeof(header),
+                            cudaMemcpyHostToDevice));
+    char *base = static_cast<char*>(data_) + sizeof(header);
+    dim3 dimBlock(CU2DBLOCK, CU2DBLOCK);
+    dim3 dimGrid(n_blocks(num_cols_, CU2DBLOCK),
+                 n_blocks(num_rows_, CU2DBLOCK));
+    if (format_ == 1) {
+      uint16 *col_headers = reinterpret_cast<uint16*>(base);
+      unsigned char *byte_data =
+          reinterpret_cast<unsigned char*>(col_headers + 4 * num_cols_);
+      cuda_compressed_compute_col_headers(mat.Data(), mat.Dim(), min_value_,
+                                          range_, col_headers);
+      CU_SAFE_CALL(cudaGetLastError());
+      cuda_compress_format1(dimGrid, dimBlock, byte_data, mat.Data(),
+                            mat.Dim(), min_value_, range_, col_headers);
+    } else {
+      cuda_compress_format2(dimGrid, dimBlock,
+                            reinterpret_cast<uint16*>(base), mat.Data(),
+                            mat.Dim(), min_value_, range_);
+    }
+    CU_SAFE_CALL(cudaGetLastError());
+    CuDevice::Instantiate().AccuProfile(__func__, tim.Elapsed());
+    return;
+  }
+#endif
+  {
+    // CPU compression; with CUDA enabled but BaseFloat == double we also
+    // take this path, staging through host memory.
+    Matrix<BaseFloat> host(num_rows_, num_cols_, kUndefined);
+    mat.CopyToMat(&host);
+    CompressedMatrix compressed(host);
+    CopyFromCompressed(compressed);
+  }
+}
+
+void CuCompressedMatrix::CopyToMat(CuMatrixBase<BaseFloat> *mat) const {
+  KALDI_ASSERT(mat->NumRows() == num_rows_ && mat->NumCols() == num_cols_);
+  if (num_rows_ == 0) return;
+#if HAVE_CUDA == 1 && (KALDI_DOUBLEPRECISION == 0)
+  if (CuDevice::Instantiate().Enabled()) {
+    Timer tim;
+    const char *base = static_cast<const char*>(data_) +
+        sizeof(CompressedMatrix::GlobalHeader);
+    dim3 dimBlock(CU2DBLOCK, CU2DBLOCK);
+    dim3 dimGrid(n_blocks(num_cols_, CU2DBLOCK),
+                 n_blocks(num_rows_, CU2DBLOCK));
+    if (format_ == 1) {
+      const uint16 *col_headers = reinterpret_cast<const uint16*>(base);
+      const unsigned char *byte_data =
+          reinterpret_cast<const unsigned char*>(col_headers + 4 * num_cols_);
+      cuda_uncompress_format1(dimGrid, dimBlock, mat->Data(), mat->Dim(),
+                              min_value_, range_, col_headers, byte_data);
+    } else {
+      cuda_uncompress_format2(dimGrid, dimBlock, mat->Data(), mat->Dim(),
+                              min_value_, range_,
+                              reinterpret_cast<const uint16*>(base));
+    }
+    CU_SAFE_CALL(cudaGetLastError());
+    CuDevice::Instantiate().AccuProfile(__func__, tim.Elapsed());
+    return;
+  }
+#endif
+  {
+    CompressedMatrix compressed;
+    CopyToCompressed(&compressed);
+    Matrix<BaseFloat> host(num_rows_, num_cols_, kUndefined);
+    compressed.CopyToMat(&host);
+    mat->CopyFromMat(host);
+  }
+}
+
+void CuCompressedMatrix::CopyFromCompressed(const CompressedMatrix &mat) {
+  Destroy();
+  if (mat.NumRows() == 0) return;
+  const CompressedMatrix::GlobalHeader &header =
+      *reinterpret_cast<const CompressedMatrix::GlobalHeader*>(mat.data_);
+  format_ = header.format;
+  min_value_ = header.min_value;
+  range_ = header.range;
+  num_rows_ = header.num_rows;
+  num_cols_ = header.num_cols;
+  MatrixIndexT num_bytes = CompressedMatrix::DataSize(header);
+  data_ = CompressedAlloc(num_bytes);
+  CompressedCopyToDevice(data_, mat.data_, num_bytes);
+}
+
+void CuCompressedMatrix::CopyToCompressed(CompressedMatrix *mat) const {
+  mat->Clear();
+  if (num_rows_ == 0) return;
+  MatrixIndexT num_bytes = DataSize();
+  mat->data_ = CompressedMatrix::AllocateData(num_bytes);
+  CompressedCopyToHost(mat->data_, data_, num_bytes);
+}
+
+}  // namespace kaldi
@@ -0,0 +1,110 @@
+// cudamatrix/cu-compressed-matrix.h
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_CUDAMATRIX_CU_COMPRESSED_MATRIX_H_
+#define KALDI_CUDAMATRIX_CU_COMPRESSED_MATRIX_H_
+
+#include "cudamatrix/cu-matrix.h"
+#include "matrix/compressed-matrix.h"
+
+namespace kaldi {
+
+/// This class is the GPU-resident counterpart of class CompressedMatrix: it
+/// holds the same byte-level representation (the global header, then the
+/// per-column headers, then the one-byte-per-element data; see
+/// matrix/compressed-matrix.h), but in GPU memory, with CUDA kernels for
+/// compressing from and decompressing to a CuMatrix.  The point is to move
+/// compressed data, not floats, across the PCIe bus: code that reads
+/// compressed feature or example archives can upload the compressed
+/// representation with CopyFromCompressed() and decompress on the device,
+/// which transfers about a quarter of the bytes of an uncompressed copy;
+/// and code that compresses output on the GPU can do the (relatively
+/// expensive) per-column percentile computation there, and only download
+/// the compressed bytes.
+///
+/// Compressing on the device produces (up to rounding, see the kernels in
+/// cu-kernels.cu) the same representation as compressing the same matrix on
+/// the CPU would: in particular the per-column headers are computed from
+/// exact order statistics (which the kernel obtains by binary search over
+/// the 16-bit code space), not from an approximation.  Without a GPU,
+/// everything falls back to class CompressedMatrix, staging through CPU
+/// memory.
+class CuCompressedMatrix {
+ public:
+  CuCompressedMatrix(): data_(NULL), format_(0), min_value_(0.0),
+                        range_(0.0), num_rows_(0), num_cols_(0) { }
+
+  explicit CuCompressedMatrix(const CuMatrixBase<BaseFloat> &mat):
+      data_(NULL), num_rows_(0), num_cols_(0) { CopyFromMat(mat); }
+
+  explicit CuCompressedMatrix(const CompressedMatrix &mat):
+      data_(NULL), num_rows_(0), num_cols_(0) { CopyFromCompressed(mat); }
+
+  CuCompressedMatrix(const CuCompressedMatrix &other):
+      data_(NULL), num_rows_(0), num_cols_(0) { *this = other; }
+
+  CuCompressedMatrix &operator = (const CuCompressedMatrix &other);
+
+  ~CuCompressedMatrix() { Destroy(); }
+
+  MatrixIndexT NumRows() const { return num_rows_; }
+  MatrixIndexT NumCols() const { return num_cols_; }
+
+  /// Compresses "mat" into *this, on the device if one is in use.
+  void CopyFromMat(const CuMatrixBase<BaseFloat> &mat);
+
+  /// Decompresses into "mat", which must already have the right size.
+  void CopyToMat(CuMatrixBase<BaseFloat> *mat) const;
+
+  /// Uploads the raw compressed representation of "mat" (e.g. as read from
+  /// an archive) without decompressing it; this is the cheap direction, as
+  /// only the compressed bytes cross the bus.
+  void CopyFromCompressed(const CompressedMatrix &mat);
+
+  /// Downloads the raw compressed representation into "mat" (e.g. for
+  /// writing to an archive); *mat is resized.  The result is byte-for-byte
+  /// the contents of *this.
+  void CopyToCompressed(CompressedMatrix *mat) const;
+
+  void Clear() { Destroy(); }
+
+ private:
+  void Destroy();
+
+  // Returns the size in bytes of the representation in data_ (zero if
+  // empty); this is CompressedMatrix::DataSize() of the header.
+  MatrixIndexT DataSize() const;
+
+  void *data_;  // device pointer if compiled with CUDA and the device is
+                // enabled, otherwise a host pointer; the layout is
+                // identical to CompressedMatrix::data_ (including the
+                // GlobalHeader at the start), so whole-blob copies move it
+                // to and from class CompressedMatrix.
+  // Host-side copies of the GlobalHeader fields, so decompression code
+  // doesn't have to read the header back from the device.
+  int32 format_;
+  float min_value_;
+  float range_;
+  MatrixIndexT num_rows_;
+  MatrixIndexT num_cols_;
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_CUDAMATRIX_CU_COMPRESSED_MATRIX_H_
@@ -203,6 +203,13 @@ void CuDevice::FinalizeActiveGpu() {
     active_gpu_id_ = act_gpu_id; // CuDevice::Enabled() is true from now on
     // Initialize the CUBLAS
     CU_SAFE_CALL(cublasCreate(&handle_));
+#ifdef CUDA_API_PER_THREAD_DEFAULT_STREAM
+    // Make cublas calls follow the calling thread's stream too: the
+    // cudaStreamPerThread handle resolves to the per-thread stream of
+    // whichever thread makes the call.  (The cublas v2 API is thread-safe,
+    // even with a shared handle.)
+    CU_SAFE_CALL(cublasSetStream(handle_, cudaStreamPerThread));
+#endif
 
     // Notify user which GPU is finally used
     char name[128];
@@ -213,6 +220,15 @@ void CuDevice::FinalizeActiveGpu() {
     KALDI_LOG << "The active GPU is [" << act_gpu_id << "]: " << name << "\t"
               << GetFreeMemory(&free_memory_at_startup_, NULL) << " version "
               << properties_.major << "." << properties_.minor;
+
+    // Optionally reserve one large slab of device memory up front, from
+    // which subsequent allocations will be sub-allocated; see the comment
+    // for CuAllocatorOptions::slab_proportion.
+    BaseFloat slab_proportion = allocator_.Opts().slab_proportion;
+    if (slab_proportion > 0.0) {
+      allocator_.ReserveSlab(
+          static_cast<size_t>(slab_proportion * free_memory_at_startup_));
+    }
   }
   return;
 }
@@ -554,14 +570,148 @@ void* CuDevice::Malloc(size_t size) {
 }
 */
 
+// The stream that the calling thread's kernels are issued to; see the comment
+// above RecordEvent() in cu-device.h.  Without per-thread default streams
+// this is the one default stream, shared by all threads.
+#ifdef CUDA_API_PER_THREAD_DEFAULT_STREAM
+#define KALDI_CUDA_THIS_THREADS_STREAM cudaStreamPerThread
+#else
+#define KALDI_CUDA_THIS_THREADS_STREAM 0
+#endif
+
+// In the functions below we check errors directly instead of via CU_SAFE_CALL,
+// because the synchronization that CU_SAFE_CALL does after each call would
+// defeat the purpose of the asynchronous event API.
+
+cudaEvent_t CuDevice::RecordEvent() {
+  cudaEvent_t event = NULL;
+  pthread_mutex_lock(&event_pool_mutex_);
+  if (!event_pool_.empty()) {
+    event = event_pool_.back();
+    event_pool_.pop_back();
+  }
+  pthread_mutex_unlock(&event_pool_mutex_);
+  cudaError_t e;
+  if (event == NULL) {
+    // cudaEventDisableTiming makes recording and waiting cheaper.
+    e = cudaEventCreateWithFlags(&event, cudaEventDisableTiming);
+    if (e != cudaSuccess)
+      KALDI_ERR << "Failed to create CUDA event: " << cudaGetErrorString(e);
+  }
+  e = cudaEventRecord(event, KALDI_CUDA_THIS_THREADS_STREAM);
+  if (e != cudaSuccess)
+    KALDI_ERR << "Failed to record CUDA event: " << cudaGetErrorString(e);
+  return event;
+}
+
+void CuDevice::WaitOnEvent(cudaEvent_t event) {
+  cudaError_t e = cudaStreamWaitEvent(KALDI_CUDA_THIS_THREADS_STREAM, event, 0);
+  if (e != cudaSuccess)
+    KALDI_ERR << "Failed to make stream wait on CUDA event: "
+              << cudaGetErrorString(e);
+}
+
+void CuDevice::ReleaseEvent(cudaEvent_t event) {
+  // cap the size of the pool; in steady state we should not get anywhere
+  // near this.
+  static const size_t kMaxPooledEvents = 64;
+  pthread_mutex_lock(&event_pool_mutex_);
+  if (event_pool_.size() < kMaxPooledEvents) {
+    event_pool_.push_back(event);
+    pthread_mutex_unlock(&event_pool_mutex_);
+    return;
+  }
+  pthread_mutex_unlock(&event_pool_mutex_);
+  cudaError_t e = cudaEventDestroy(event);
+  if (e != cudaSuccess)
+    KALDI_ERR << "Failed to destroy CUDA event: " << cudaGetErrorString(e);
+}
+
+void CuDevice::SynchronizeStream() {
+  cudaError_t e = cudaStreamSynchronize(KALDI_CUDA_THIS_THREADS_STREAM);
+  if (e != cudaSuccess)
+    KALDI_ERR << "Failed to synchronize CUDA stream: " << cudaGetErrorString(e);
+}
+
+void* CuDevice::MallocPinned(size_t size) {
+  void *ans = NULL;
+  pthread_mutex_lock(&pinned_pool_mutex_);
+  for (size_t i = 0; i < pinned_pool_.size(); i++) {
+    if (pinned_pool_[i].second == size) {
+      ans = pinned_pool_[i].first;
+      pinned_pool_bytes_ -= size;
+      pinned_pool_[i] = pinned_pool_.back();
+      pinned_pool_.pop_back();
+      break;
+    }
+  }
+  pthread_mutex_unlock(&pinned_pool_mutex_);
+  if (ans != NULL) return ans;
+  cudaError_t e = cudaMallocHost(&ans, size);
+  if (e != cudaSuccess) {
+    cudaGetLastError();  // Clear the error state.
+    KALDI_VLOG(2) << "Failed to allocate " << size << " bytes of pinned "
+                  << "memory; falling back to pageable transfers.";
+    return NULL;
+  }
+  return ans;
+}
+
+void CuDevice::FreePinned(void *ptr, size_t size) {
+  // Cap on how much pinned memory we keep cached: pinned memory cannot be
+  // paged out, so hoarding it degrades the rest of the system.
+  static const size_t kMaxPinnedBytes = 134217728;  // 128MB.
+  pthread_mutex_lock(&pinned_pool_mutex_);
+  if (pinned_pool_bytes_ + size <= kMaxPinnedBytes) {
+    pinned_pool_.push_back(std::pair<void*, size_t>(ptr, size));
+    pinned_pool_bytes_ += size;
+    pthread_mutex_unlock(&pinned_pool_mutex_);
+    return;
+  }
+  pthread_mutex_unlock(&pinned_pool_mutex_);
+  cudaError_t e = cudaFreeHost(ptr);
+  if (e != cudaSuccess)
+    KALDI_ERR << "Failed to free pinned memory: " << cudaGetErrorString(e);
+}
+
+bool CuDevice::RegisterPinnedMemory(void *data, size_t size) {
+#if CUDART_VERSION >= 4000
+  cudaError_t e = cudaHostRegister(data, size, cudaHostRegisterPortable);
+  if (e != cudaSuccess) {
+    cudaGetLastError();  // Clear the error state.
+    KALDI_WARN << "Failed to register " << size << " bytes of host memory "
+               << "as pinned: " << cudaGetErrorString(e);
+    return false;
+  }
+  return true;
+#else
+  return false;  // cudaHostRegister needs CUDA 4.0.
+#endif
+}
+
+void CuDevice::UnregisterPinnedMemory(void *data) {
+#if CUDART_VERSION >= 4000
+  cudaError_t e = cudaHostUnregister(data);
+  if (e != cudaSuccess)
+    KALDI_ERR << "Failed to unregister pinned memory: "
+              << cudaGetErrorString(e);
+#endif
+}
+
 CuDevice::CuDevice(): active_gpu_id_(-1), verbose_(true),
-                      allocator_(CuAllocatorOptions()) { }
+                      allocator_(CuAllocatorOptions()),
+                      pinned_pool_bytes_(0) {
+  pthread_mutex_init(&event_pool_mutex_, NULL);
+  pthread_mutex_init(&pinned_pool_mutex_, NULL);
+}
 
 
 CuDevice::~CuDevice() {
   if (Enabled()) {
     cublasDestroy(handle_);
   }
+  pthread_mutex_destroy(&event_pool_mutex_);
+  pthread_mutex_destroy(&pinned_pool_mutex_);
 }
 
 // The instance of the static singleton
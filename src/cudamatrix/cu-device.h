@@ -28,7 +28,9 @@
 #include <cublas_v2.h>
 #include <map>
 #include <string>
+#include <vector>
 #include <iostream>
+#include <pthread.h>
 #include <cuda.h>
 #include <cuda_runtime_api.h>
 #include "base/kaldi-common.h"
@@ -88,6 +90,14 @@ class CuDevice {
 
   void PrintMemoryUsage() const;
 
+  /// Reserve a slab of GPU memory of approximately this many bytes, from
+  /// which subsequent allocations will be sub-allocated instead of calling
+  /// cudaMalloc; this avoids mid-stream allocation stalls in long-running
+  /// processes such as online-decoding servers.  Call this just after
+  /// SelectGpuId().  See also CuAllocatorOptions::slab_proportion for
+  /// reserving the slab automatically at device initialization.
+  void ReserveSlabMemory(size_t bytes) { allocator_.ReserveSlab(bytes); }
+
   void ResetProfile() {
     profile_map_.clear();
   }
@@ -106,6 +116,59 @@ class CuDevice {
   /// Otherwise, return 16, which is the stride used for CPU matrices.
   int32 GetMatrixAlignment() const;
 
+  /// The functions below provide event-based dependencies between CUDA
+  /// streams, for use when the toolkit is compiled with per-thread default
+  /// streams (nvcc option --default-stream=per-thread; see
+  /// makefiles/linux_x86_64_cuda.mk, requires CUDA 7.0).  In that mode each
+  /// host thread issues its kernels and cublas calls to its own stream, so
+  /// e.g. nnet3 forward passes for different utterances, run from different
+  /// threads, can overlap with each other and with host-device transfers.  A
+  /// thread that produces data for another thread calls RecordEvent() after
+  /// issuing its kernels; the consuming thread passes the event to
+  /// WaitOnEvent() before issuing work that depends on the data, and then to
+  /// ReleaseEvent().  Without per-thread streams everything runs on the one
+  /// default stream and the waits are trivially satisfied.
+
+  /// Records an event on the calling thread's stream and returns it.
+  cudaEvent_t RecordEvent();
+
+  /// Makes all work subsequently issued to the calling thread's stream wait
+  /// for 'event' (from RecordEvent()) to complete.  Does not block the host.
+  void WaitOnEvent(cudaEvent_t event);
+
+  /// Returns an event obtained from RecordEvent() to an internal pool for
+  /// reuse.  Call this once no more streams need to wait on the event.
+  void ReleaseEvent(cudaEvent_t event);
+
+  /// Waits on the host for all work previously issued to the calling
+  /// thread's stream to complete (other threads' streams are unaffected).
+  void SynchronizeStream();
+
+  /// Allocates 'size' bytes of pinned (page-locked) host memory, from an
+  /// internal pool of previously freed buffers where possible.  Copies
+  /// between pinned memory and the device go at full DMA bandwidth, roughly
+  /// twice that of pageable memory, and can overlap with kernels; the
+  /// host<->device copies in cu-matrix.cc stage larger transfers through
+  /// buffers from this pool.  Returns NULL if pinned memory cannot be
+  /// allocated (it is a limited resource), in which case the caller should
+  /// fall back to regular pageable copies.
+  void *MallocPinned(size_t size);
+
+  /// Returns a buffer obtained from MallocPinned() to the pool (or frees it,
+  /// if the pool is full).  'size' must be the size that was passed to
+  /// MallocPinned().
+  void FreePinned(void *ptr, size_t size);
+
+  /// Registers already-allocated host memory as pinned, so that transfers
+  /// from it behave as if it had come from MallocPinned(); use this to wrap
+  /// the storage of a Matrix that repeatedly streams features to the GPU
+  /// (see RegisterMatrixAsPinned() in cu-matrix.h).  Returns false if the
+  /// memory could not be registered.  Call UnregisterPinnedMemory() before
+  /// the memory is freed.
+  bool RegisterPinnedMemory(void *data, size_t size);
+
+  void UnregisterPinnedMemory(void *data);
+
  private:
   CuDevice();
   CuDevice(CuDevice&); // Disallow.
@@ -153,6 +216,20 @@ class CuDevice {
 
   CuMemoryAllocator allocator_;
 
+  // Pool of CUDA events for RecordEvent()/ReleaseEvent(), so that in steady
+  // state we don't keep creating and destroying events.  Protected by
+  // event_pool_mutex_, since any thread may call those functions.
+  std::vector<cudaEvent_t> event_pool_;
+  pthread_mutex_t event_pool_mutex_;
+
+  // Pool of free pinned host-memory buffers for MallocPinned()/FreePinned(),
+  // as (pointer, size) pairs; only exact size matches are reused, which works
+  // well because transfer sizes repeat (minibatches have fixed dimensions).
+  // Protected by pinned_pool_mutex_.
+  std::vector<std::pair<void*, size_t> > pinned_pool_;
+  size_t pinned_pool_bytes_;  // total bytes in pinned_pool_.
+  pthread_mutex_t pinned_pool_mutex_;
+
 }; // class CuDevice
 
 // This function is declared as a more convenient way to get the CUDA device handle for use
@@ -107,6 +107,9 @@ void cudaF_vec_mul_elements(int Gr, int Bl, float* v, const float* a, int dim);
 void cudaF_vec_soft_max(int Gr, int Bl, float* v, int dim);
 void cudaF_vec_min(const float* v, float* value, int dim);
 void cudaF_vec_max(const float* v, float* value, int dim);
+void cudaF_vec_stats(const float* v, float* stats, int dim);
+void cudaF_accumulate_accuracy(const int32_cuda* best, const int32_cuda* ref,
+                               const float* weights, int dim, float* acc);
 void cudaF_trace_mat_mat_trans(const float* A, const float* B, MatrixDim dA, int B_stride, float* value);
 void cudaF_trace_mat_mat(const float* A, const float* B, MatrixDim dA, int B_stride, float* value);
 void cudaF_add_diag_mat_mat(int Gr, int Bl, float alpha, float* v, int v_dim, const float* M, 
@@ -138,7 +141,11 @@ void cudaF_block_add_mat_mat(dim3 Gr, dim3 Bl, CuBlockMatrixData *B_cu_data, int
  * cu::
  */
 void cudaF_softmax_reduce(size_t Gr, size_t Bl, float *y, const float *x, MatrixDim d, int src_stride);
+void cudaF_softmax_floor_reduce(size_t Gr, size_t Bl, float *y, const float *x, MatrixDim d, int src_stride, float floor_val);
 void cudaF_log_softmax_reduce(size_t Gr, size_t Bl, float *y, const float *x, MatrixDim d, int src_stride);
+void cudaF_log_softmax_floor_reduce(size_t Gr, size_t Bl, float *y, const float *x, MatrixDim d, int src_stride, float floor_val);
+void cudaF_apply_floor_log(dim3 Gr, dim3 Bl, float *mat, float floor_val, MatrixDim d);
+void cudaF_floor_with_row_sums(size_t Gr, size_t Bl, float *y, const float *x, float floor_val, float *row_sums, MatrixDim d, int src_stride);
 void cudaF_soft_hinge(dim3 Gr, dim3 Bl, float *y, const float *x, MatrixDim d, int src_stride);
 void cudaF_group_pnorm(dim3 Gr, dim3 Bl, float *y, const float *x, MatrixDim d, int src_stride, int group_size, float power);
 void cudaF_group_max(dim3 Gr, dim3 Bl, float *y, const float *x, MatrixDim d, int src_stride, int group_size);
@@ -249,6 +256,9 @@ void cudaD_vec_mul_elements(int Gr, int Bl, double* v, const double* a, int dim)
 void cudaD_vec_soft_max(int Gr, int Bl, double* v, int dim);
 void cudaD_vec_min(const double* v, double* value, int dim);
 void cudaD_vec_max(const double* v, double* value, int dim);
+void cudaD_vec_stats(const double* v, double* stats, int dim);
+void cudaD_accumulate_accuracy(const int32_cuda* best, const int32_cuda* ref,
+                               const double* weights, int dim, double* acc);
 void cudaD_trace_mat_mat_trans(const double* A, const double* B, MatrixDim dA, int B_stride, double* value);
 void cudaD_trace_mat_mat(const double* A, const double* B, MatrixDim dA, int B_stride, double* value);
 void cudaD_add_diag_mat_mat(int Gr, int Bl, double alpha, double* v, int v_dim, const double* M, 
@@ -282,7 +292,11 @@ void cudaD_block_add_mat_mat(dim3 Gr, dim3 Bl, CuBlockMatrixData *B_cu_data, int
  * cu::
  */
 void cudaD_softmax_reduce(size_t Gr, size_t Bl, double *y, const double *x, MatrixDim d, int src_stride);
+void cudaD_softmax_floor_reduce(size_t Gr, size_t Bl, double *y, const double *x, MatrixDim d, int src_stride, double floor_val);
 void cudaD_log_softmax_reduce(size_t Gr, size_t Bl, double *y, const double *x, MatrixDim d, int src_stride);
+void cudaD_log_softmax_floor_reduce(size_t Gr, size_t Bl, double *y, const double *x, MatrixDim d, int src_stride, double floor_val);
+void cudaD_apply_floor_log(dim3 Gr, dim3 Bl, double *mat, double floor_val, MatrixDim d);
+void cudaD_floor_with_row_sums(size_t Gr, size_t Bl, double *y, const double *x, double floor_val, double *row_sums, MatrixDim d, int src_stride);
 void cudaD_soft_hinge(dim3 Gr, dim3 Bl, double *y, const double *x, MatrixDim d, int src_stride);
 void cudaD_group_pnorm(dim3 Gr, dim3 Bl, double *y, const double *x, MatrixDim d, int src_stride, int group_size, double power);
 void cudaD_group_max(dim3 Gr, dim3 Bl, double *y, const double *x, MatrixDim d, int src_stride, int group_size);
@@ -316,6 +330,29 @@ void cuda_copy_from_mat_ff_trans(dim3 Gr, dim3 Bl, float* mat_out, const float*
 void cuda_copy_from_mat_fd_trans(dim3 Gr, dim3 Bl, float *mat_out, const double* mat_in, MatrixDim d_out, MatrixDim d_in);
 void cuda_copy_from_mat_dd_trans(dim3 Gr, dim3 Bl, double *mat_out, const double* mat_in, MatrixDim d_out, MatrixDim d_in);
 
+// reduced-precision conversions, see cu-quantized-matrix.h ('h' is IEEE
+// half-precision stored as uint16, 'q' is int8 with per-row scales).
+void cuda_copy_from_mat_fh(dim3 Gr, dim3 Bl, float *mat_out, const unsigned short *mat_in, MatrixDim d_out, int in_stride);
+void cuda_copy_from_mat_hf(dim3 Gr, dim3 Bl, unsigned short *mat_out, const float *mat_in, MatrixDim d_in, int out_stride);
+void cuda_copy_from_mat_fq(dim3 Gr, dim3 Bl, float *mat_out, const signed char *mat_in, const float *row_scales, MatrixDim d_out, int in_stride);
+
+// block-sparse GEMM, see cu-block-sparse-matrix.h: does C += alpha * A * B^T
+// where B is stored in BSR form (blocks of block_rows by block_cols, stacked
+// vertically in "blocks" with row stride block_stride; block_row_ptr and
+// block_col_idx index the blocks CSR-style).  The grid is 2D over C.
+void cuda_add_mat_blocksparse(dim3 Gr, dim3 Bl, float alpha, const float *A, MatrixDim a_dim, const float *blocks, int block_stride, const int *block_row_ptr, const int *block_col_idx, int block_rows, int block_cols, float *C, MatrixDim c_dim);
+
+// kernels for cu-compressed-matrix.h (the GPU version of class
+// CompressedMatrix); min_max points to 2 floats, col_headers to 4 uint16's
+// per column.  The first two launch their own grids (one block, and one
+// block per column, respectively).
+void cuda_compressed_min_max(const float *mat, MatrixDim d, float *min_max);
+void cuda_compressed_compute_col_headers(const float *mat, MatrixDim d, float min_value, float range, unsigned short *col_headers);
+void cuda_compress_format1(dim3 Gr, dim3 Bl, unsigned char *byte_data, const float *mat, MatrixDim d, float min_value, float range, const unsigned short *col_headers);
+void cuda_uncompress_format1(dim3 Gr, dim3 Bl, float *mat, MatrixDim d, float min_value, float range, const unsigned short *col_headers, const unsigned char *byte_data);
+void cuda_compress_format2(dim3 Gr, dim3 Bl, unsigned short *out, const float *mat, MatrixDim d, float min_value, float range);
+void cuda_uncompress_format2(dim3 Gr, dim3 Bl, float *mat, MatrixDim d, float min_value, float range, const unsigned short *in);
+
 void cuda_copy_from_smat_ff(dim3 Gr, dim3 Bl, float* mat_out, const MatrixElement<float>* smat_in, MatrixDim d_out, MatrixIndexT_cuda d_in);
 void cuda_copy_from_smat_fd(dim3 Gr, dim3 Bl, float* mat_out, const MatrixElement<double>* smat_in, MatrixDim d_out, MatrixIndexT_cuda d_in);
 void cuda_copy_from_smat_df(dim3 Gr, dim3 Bl, double* mat_out, const MatrixElement<float>* smat_in, MatrixDim d_out, MatrixIndexT_cuda d_in);
@@ -357,6 +394,26 @@ void cudaD_equal_element_mask(dim3 Gr, dim3 Bl, const double *mat1,
                               int mat2_stride, int mask_stride);
   
 
+// lattice forward-backward (see cudamatrix/cu-lattice.h).
+void cudaD_lattice_alpha_level(dim3 Gr, dim3 Bl, int num_level_states,
+                               const int32_cuda *level_states,
+                               const int32_cuda *in_arc_offsets,
+                               const int32_cuda *in_arc_ids,
+                               const int32_cuda *arc_src,
+                               const double *arc_like, double *alpha);
+void cudaD_lattice_beta_level(dim3 Gr, dim3 Bl, int num_level_states,
+                              const int32_cuda *level_states,
+                              const int32_cuda *arc_offsets,
+                              const int32_cuda *arc_nextstate,
+                              const double *arc_like,
+                              const double *final_like, double *beta);
+void cudaD_lattice_arc_post(dim3 Gr, dim3 Bl, int num_arcs,
+                            const int32_cuda *arc_src,
+                            const int32_cuda *arc_nextstate,
+                            const double *arc_like, const double *alpha,
+                            const double *beta, double tot_prob,
+                            double *arc_post);
+
   
 } // extern "C" 
 
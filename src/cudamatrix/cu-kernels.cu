@@ -871,6 +871,92 @@ static void _vec_max(const Real* v, Real* value, int dim) {
 }
 
 
+// Fused reduction: one pass over the vector computing sum, min, max and
+// sum-of-squares at once, writing them to stats[0..3]; this replaces up to
+// four separate kernel launches (and four device syncs) when diagnostics
+// want several statistics of the same vector.  Expects to be called with
+// 1 block of CU1DBLOCK threads, like _vec_min and _vec_max above.
+template<typename Real>
+__global__
+static void _vec_stats(const Real* v, Real* stats, int dim) {
+  int32_cuda i = blockIdx.x * blockDim.x + threadIdx.x;
+
+  if(i >= CU1DBLOCK) return;
+
+  __shared__ Real sum_data[CU1DBLOCK];
+  __shared__ Real min_data[CU1DBLOCK];
+  __shared__ Real max_data[CU1DBLOCK];
+  __shared__ Real sumsq_data[CU1DBLOCK];
+
+  int block_size = (dim + CU1DBLOCK - 1) / CU1DBLOCK;
+
+  Real sum = 0.0, sumsq = 0.0;
+  Real min = 1.0 / 0.0, max = -1.0 / 0.0; // +/- infinity.
+
+  for (int j = i * block_size; j < (i+1) * block_size && j < dim; j++) {
+     Real v_j = v[j];
+     sum += v_j;
+     sumsq += v_j * v_j;
+     if (v_j < min) min = v_j;
+     if (v_j > max) max = v_j;
+  }
+
+  sum_data[i] = sum;
+  min_data[i] = min;
+  max_data[i] = max;
+  sumsq_data[i] = sumsq;
+
+  __syncthreads();
+
+  // each _*_reduce call syncs internally, and they use separate buffers,
+  // so it is safe to call them back to back.
+  stats[0] = _sum_reduce(sum_data);
+  stats[1] = _min_reduce(min_data);
+  stats[2] = _max_reduce(max_data);
+  stats[3] = _sum_reduce(sumsq_data);
+}
+
+
+// Accumulates classification-accuracy statistics on the device: adds the
+// total weight to acc[0] and the weight of the frames where best[j] ==
+// ref[j] to acc[1], so diagnostics can accumulate over many minibatches
+// without reading anything back to the host.  Expects to be called with
+// 1 block of CU1DBLOCK threads, like _vec_stats above.
+template<typename Real>
+__global__
+static void _accumulate_accuracy(const int32_cuda* best, const int32_cuda* ref,
+                                 const Real* weights, int dim, Real* acc) {
+  int32_cuda i = blockIdx.x * blockDim.x + threadIdx.x;
+
+  if(i >= CU1DBLOCK) return;
+
+  __shared__ Real weight_data[CU1DBLOCK];
+  __shared__ Real correct_data[CU1DBLOCK];
+
+  int block_size = (dim + CU1DBLOCK - 1) / CU1DBLOCK;
+
+  Real weight = 0.0, correct = 0.0;
+
+  for (int j = i * block_size; j < (i+1) * block_size && j < dim; j++) {
+     Real w_j = weights[j];
+     weight += w_j;
+     if (best[j] == ref[j]) correct += w_j;
+  }
+
+  weight_data[i] = weight;
+  correct_data[i] = correct;
+
+  __syncthreads();
+
+  Real tot_weight = _sum_reduce(weight_data);
+  Real tot_correct = _sum_reduce(correct_data);
+  if (threadIdx.x == 0) {
+    acc[0] += tot_weight;
+    acc[1] += tot_correct;
+  }
+}
+
+
 // _trace_mat_mat expects to be called with 1 blocks, each of dimension
 // CU1DBLOCK.  Each block outputs a partial sum to value[blockIdx.x],
 // i.e. value[0 through 0].
@@ -1836,7 +1922,8 @@ static void _diff_tanh(Real*eout, const Real*e, const Real*y, MatrixDim d, int e
 
 template<typename Real>
 __global__
-static void _softmax_reduce(Real*y, const Real*x, MatrixDim d, int src_stride) {
+static void _softmax_reduce(Real*y, const Real*x, MatrixDim d, int src_stride,
+                            Real floor_val) {
   int j = blockIdx.x;
   int THREADS = blockDim.x;
   if (j >= d.rows) return;
@@ -1893,10 +1980,13 @@ static void _softmax_reduce(Real*y, const Real*x, MatrixDim d, int src_stride) {
   Real sum = aux[0];
   __syncthreads();
 
-  //normalize by sum...
+  //normalize by sum (and apply the floor, which costs nothing extra here;
+  //floor_val == 0 means no flooring, as the values are nonnegative anyway).
   for(int i=0; i<steps; i++) {
     if(threadIdx.x+i*THREADS < d.cols) {
-      y[threadIdx.x+i*THREADS+j*d.stride] = y[threadIdx.x+i*THREADS+j*d.stride] / sum;
+      Real val = y[threadIdx.x+i*THREADS+j*d.stride] / sum;
+      if (val < floor_val) val = floor_val;
+      y[threadIdx.x+i*THREADS+j*d.stride] = val;
     }
   }
 
@@ -1905,7 +1995,7 @@ static void _softmax_reduce(Real*y, const Real*x, MatrixDim d, int src_stride) {
 template<typename Real>
 __global__
 static void _log_softmax_reduce(Real *y, const Real *x,
-                                MatrixDim d, int src_stride) {
+                                MatrixDim d, int src_stride, Real floor_val) {
   int j = blockIdx.x;
   int THREADS = blockDim.x;
   if (j >= d.rows) return;
@@ -1965,15 +2055,69 @@ static void _log_softmax_reduce(Real *y, const Real *x,
   Real log_sum = log(aux[0]);
   __syncthreads();
 
-  // Computes log softmax.
+  // Computes log softmax (and applies the floor; passing -HUGE_VAL as
+  // floor_val means no flooring).
   for (int i = 0; i < steps; ++i) {
     if (threadIdx.x + i * THREADS < d.cols) {
-      y[threadIdx.x + i * THREADS + j * d.stride] -= log_sum;
+      Real val = y[threadIdx.x + i * THREADS + j * d.stride] - log_sum;
+      if (val < floor_val) val = floor_val;
+      y[threadIdx.x + i * THREADS + j * d.stride] = val;
     }
   }
 }
 
 
+// y = log(max(x, floor_val)), in one pass over the data; this fuses the
+// ApplyFloor+ApplyLog chain that is applied to softmax outputs.
+template<typename Real>
+__global__
+static void _apply_floor_log(Real *mat, Real floor_val, MatrixDim d) {
+  int i = blockIdx.x * blockDim.x + threadIdx.x;
+  int j = blockIdx.y * blockDim.y + threadIdx.y;
+  int index = i + j * d.stride;
+  if (i < d.cols && j < d.rows) {
+    Real val = mat[index];
+    if (val < floor_val) val = floor_val;
+    mat[index] = log(val);
+  }
+}
+
+// atomic add: CUDA provides it natively for float (from compute capability
+// 2.0) but for double only from 6.0, so we provide a compare-and-swap
+// version for double.
+__device__ inline void _atomic_add(float *address, float value) {
+  atomicAdd(address, value);
+}
+__device__ inline void _atomic_add(double *address, double value) {
+  unsigned long long int *address_as_ull = (unsigned long long int*)address;
+  unsigned long long int old = *address_as_ull, assumed;
+  do {
+    assumed = old;
+    old = atomicCAS(address_as_ull, assumed,
+                    __double_as_longlong(value +
+                                         __longlong_as_double(assumed)));
+  } while (assumed != old);
+}
+
+// y = max(x, floor_val), also accumulating the sums over rows of y into
+// row_sums (so row_sums[i] += sum_j y(j, i)); with floor_val == 0 this is a
+// ReLU that also collects the per-dimension activation statistics, in one
+// pass over the data.  One block per row; the accumulation order over rows
+// is unspecified (the sums are used for diagnostics).
+template<typename Real>
+__global__
+static void _floor_with_row_sums(Real *y, const Real *x, Real floor_val,
+                                 Real *row_sums, MatrixDim d, int src_stride) {
+  int j = blockIdx.x;  // row index.
+  if (j >= d.rows) return;
+  for (int i = threadIdx.x; i < d.cols; i += blockDim.x) {
+    Real val = x[i + j * src_stride];
+    if (val < floor_val) val = floor_val;
+    y[i + j * d.stride] = val;
+    _atomic_add(row_sums + i, val);
+  }
+}
+
 template<typename Real>
 __global__
 static void _splice(Real* y, const Real* x, const int32_cuda* off, MatrixDim d_out, MatrixDim d_in) {
@@ -2166,6 +2310,77 @@ static void _diff_xent(const int32_cuda* vec_tgt, Real* mat_net_out, Real* vec_l
 
 
 
+/***********************************************************************
+ * lattice forward-backward (see cudamatrix/cu-lattice.h).  The lattice
+ * is in frozen CSR form; states are processed one topological level per
+ * kernel launch, so all reads within a launch are of values written by
+ * earlier launches and no atomics are needed.
+ */
+
+__device__ static double _log_add(double x, double y) {
+  if (x < y) { double t = x; x = y; y = t; }
+  double diff = y - x;  // <= 0, or nan if both are -inf.
+  if (!(diff > -690.0))  // exp() would underflow anyway.
+    return x;
+  return x + log1p(exp(diff));
+}
+
+// Computes alpha for one level of states, by gathering over each state's
+// incoming arcs (in_arc_offsets/in_arc_ids index arcs by destination
+// state).  alpha must be initialized to the log-zero value, except 0.0 for
+// the start state; the kernel log-adds onto the existing value.
+__global__
+static void _lattice_alpha_level(int num_level_states,
+                                 const int32_cuda *level_states,
+                                 const int32_cuda *in_arc_offsets,
+                                 const int32_cuda *in_arc_ids,
+                                 const int32_cuda *arc_src,
+                                 const double *arc_like, double *alpha) {
+  int i = blockIdx.x * blockDim.x + threadIdx.x;
+  if (i >= num_level_states) return;
+  int s = level_states[i];
+  double sum = alpha[s];
+  for (int j = in_arc_offsets[s]; j < in_arc_offsets[s + 1]; j++) {
+    int a = in_arc_ids[j];
+    sum = _log_add(sum, alpha[arc_src[a]] + arc_like[a]);
+  }
+  alpha[s] = sum;
+}
+
+// Computes beta for one level of states, by gathering over each state's
+// outgoing arcs (the natural CSR arrays); final_like is the state's
+// final log-probability (log-zero if not final).
+__global__
+static void _lattice_beta_level(int num_level_states,
+                                const int32_cuda *level_states,
+                                const int32_cuda *arc_offsets,
+                                const int32_cuda *arc_nextstate,
+                                const double *arc_like,
+                                const double *final_like, double *beta) {
+  int i = blockIdx.x * blockDim.x + threadIdx.x;
+  if (i >= num_level_states) return;
+  int s = level_states[i];
+  double sum = final_like[s];
+  for (int j = arc_offsets[s]; j < arc_offsets[s + 1]; j++)
+    sum = _log_add(sum, arc_like[j] + beta[arc_nextstate[j]]);
+  beta[s] = sum;
+}
+
+// Computes the posterior of every arc from alpha and beta; one thread
+// per arc.
+__global__
+static void _lattice_arc_post(int num_arcs, const int32_cuda *arc_src,
+                              const int32_cuda *arc_nextstate,
+                              const double *arc_like, const double *alpha,
+                              const double *beta, double tot_prob,
+                              double *arc_post) {
+  int i = blockIdx.x * blockDim.x + threadIdx.x;
+  if (i >= num_arcs) return;
+  arc_post[i] = exp(alpha[arc_src[i]] + arc_like[i] +
+                    beta[arc_nextstate[i]] - tot_prob);
+}
+
+
 /***********************************************************************
  * ANSI-C wrappers of CUDA kernels
  */
@@ -2433,6 +2648,15 @@ void cudaF_vec_max(const float* v, float* value, int dim) {
   _vec_max<<<1,CU1DBLOCK>>>(v, value, dim);
 }
 
+void cudaF_vec_stats(const float* v, float* stats, int dim) {
+  _vec_stats<<<1,CU1DBLOCK>>>(v, stats, dim);
+}
+
+void cudaF_accumulate_accuracy(const int32_cuda* best, const int32_cuda* ref,
+                               const float* weights, int dim, float* acc) {
+  _accumulate_accuracy<<<1,CU1DBLOCK>>>(best, ref, weights, dim, acc);
+}
+
 void cudaF_trace_mat_mat_trans(const float* A, const float* B, MatrixDim dA, int B_stride, float* value) {
   _trace_mat_mat_trans<float,4> <<<4,CU1DBLOCK>>>(A,B,dA,B_stride,value);
 }
@@ -2559,11 +2783,27 @@ void cudaF_diff_tanh (dim3 Gr, dim3 Bl, float* eout, const float* e, const float
 }
 
 void cudaF_softmax_reduce (size_t Gr, size_t Bl, float* y, const float* x, MatrixDim d, int src_stride) {
-  _softmax_reduce<<<Gr,Bl>>>(y, x, d, src_stride);
+  _softmax_reduce<<<Gr,Bl>>>(y, x, d, src_stride, 0.0f);
+}
+
+void cudaF_softmax_floor_reduce (size_t Gr, size_t Bl, float* y, const float* x, MatrixDim d, int src_stride, float floor_val) {
+  _softmax_reduce<<<Gr,Bl>>>(y, x, d, src_stride, floor_val);
 }
 
 void cudaF_log_softmax_reduce (size_t Gr, size_t Bl, float* y, const float* x, MatrixDim d, int src_stride) {
-  _log_softmax_reduce<<<Gr,Bl>>>(y, x, d, src_stride);
+  _log_softmax_reduce<<<Gr,Bl>>>(y, x, d, src_stride, -HUGE_VALF);
+}
+
+void cudaF_log_softmax_floor_reduce (size_t Gr, size_t Bl, float* y, const float* x, MatrixDim d, int src_stride, float floor_val) {
+  _log_softmax_reduce<<<Gr,Bl>>>(y, x, d, src_stride, floor_val);
+}
+
+void cudaF_apply_floor_log(dim3 Gr, dim3 Bl, float* mat, float floor_val, MatrixDim d) {
+  _apply_floor_log<<<Gr,Bl>>>(mat, floor_val, d);
+}
+
+void cudaF_floor_with_row_sums(size_t Gr, size_t Bl, float* y, const float* x, float floor_val, float* row_sums, MatrixDim d, int src_stride) {
+  _floor_with_row_sums<<<Gr,Bl>>>(y, x, floor_val, row_sums, d, src_stride);
 }
 
 void cudaF_splice(dim3 Gr, dim3 Bl, float* y, const float* x, const int32_cuda* off, MatrixDim d_out, MatrixDim d_in) {
@@ -2902,6 +3142,15 @@ void cudaD_vec_max(const double* v, double* value, int dim) {
   _vec_max<<<1,CU1DBLOCK>>>(v, value, dim);
 }
 
+void cudaD_vec_stats(const double* v, double* stats, int dim) {
+  _vec_stats<<<1,CU1DBLOCK>>>(v, stats, dim);
+}
+
+void cudaD_accumulate_accuracy(const int32_cuda* best, const int32_cuda* ref,
+                               const double* weights, int dim, double* acc) {
+  _accumulate_accuracy<<<1,CU1DBLOCK>>>(best, ref, weights, dim, acc);
+}
+
 void cudaD_trace_mat_mat_trans(const double* A, const double* B, MatrixDim dA, int B_stride, double* value) {
   _trace_mat_mat_trans<double,4> <<<4,CU1DBLOCK>>>(A,B,dA,B_stride,value);
 }
@@ -3031,11 +3280,27 @@ void cudaD_diff_tanh (dim3 Gr, dim3 Bl, double* eout, const double* e, const dou
 }
 
 void cudaD_softmax_reduce (size_t Gr, size_t Bl, double* y, const double* x, MatrixDim d, int src_stride) {
-  _softmax_reduce<<<Gr,Bl>>>(y, x, d, src_stride);
+  _softmax_reduce<<<Gr,Bl>>>(y, x, d, src_stride, 0.0);
+}
+
+void cudaD_softmax_floor_reduce (size_t Gr, size_t Bl, double* y, const double* x, MatrixDim d, int src_stride, double floor_val) {
+  _softmax_reduce<<<Gr,Bl>>>(y, x, d, src_stride, floor_val);
 }
 
 void cudaD_log_softmax_reduce (size_t Gr, size_t Bl, double* y, const double* x, MatrixDim d, int src_stride) {
-  _log_softmax_reduce<<<Gr,Bl>>>(y, x, d, src_stride);
+  _log_softmax_reduce<<<Gr,Bl>>>(y, x, d, src_stride, -HUGE_VAL);
+}
+
+void cudaD_log_softmax_floor_reduce (size_t Gr, size_t Bl, double* y, const double* x, MatrixDim d, int src_stride, double floor_val) {
+  _log_softmax_reduce<<<Gr,Bl>>>(y, x, d, src_stride, floor_val);
+}
+
+void cudaD_apply_floor_log(dim3 Gr, dim3 Bl, double* mat, double floor_val, MatrixDim d) {
+  _apply_floor_log<<<Gr,Bl>>>(mat, floor_val, d);
+}
+
+void cudaD_floor_with_row_sums(size_t Gr, size_t Bl, double* y, const double* x, double floor_val, double* row_sums, MatrixDim d, int src_stride) {
+  _floor_with_row_sums<<<Gr,Bl>>>(y, x, floor_val, row_sums, d, src_stride);
 }
 
 void cudaD_splice(dim3 Gr, dim3 Bl, double* y, const double* x, const int32_cuda* off, MatrixDim d_out, MatrixDim d_in) {
@@ -3146,6 +3411,334 @@ void cuda_copy_from_mat_dd_trans(dim3 Gr, dim3 Bl, double *mat_out, const double
   _copy_from_mat_trans<<<Gr,Bl>>>(mat_out,mat_in,d_out,d_in);
 }
 
+/* Reduced-precision conversions (see cu-quantized-matrix.h).  We do the
+   half-precision conversion with explicit bit manipulation rather than the
+   __float2half_rn/__half2float intrinsics, whose signatures changed between
+   toolkit versions; this matches the host-side code in
+   cu-quantized-matrix.cc. */
+
+__device__ static float _half_bits_to_float(unsigned short h) {
+  unsigned int sign = (unsigned int)(h & 0x8000) << 16;
+  unsigned int exp = (h >> 10) & 0x1f;
+  unsigned int mant = h & 0x3ff;
+  unsigned int bits;
+  if (exp == 0) {
+    if (mant == 0) {
+      bits = sign;
+    } else {  // subnormal half: renormalize.
+      exp = 127 - 15 + 1;
+      while ((mant & 0x400) == 0) { mant <<= 1; exp--; }
+      bits = sign | (exp << 23) | ((mant & 0x3ff) << 13);
+    }
+  } else if (exp == 31) {  // infinity or NaN.
+    bits = sign | 0x7f800000 | (mant << 13);
+  } else {
+    bits = sign | ((exp + 127 - 15) << 23) | (mant << 13);
+  }
+  return __int_as_float(bits);
+}
+
+__device__ static unsigned short _float_to_half_bits(float f) {
+  unsigned int bits = __float_as_int(f);
+  unsigned short sign = (unsigned short)((bits >> 16) & 0x8000);
+  int exp = (int)((bits >> 23) & 0xff);
+  unsigned int mant = bits & 0x7fffff;
+  if (exp == 0xff)  // infinity or NaN.
+    return sign | 0x7c00 | (mant != 0 ? 0x200 : 0);
+  exp += 15 - 127;
+  if (exp >= 31)  // overflow: round to infinity.
+    return sign | 0x7c00;
+  if (exp <= 0) {  // subnormal half (or underflow to zero).
+    if (exp < -10) return sign;
+    mant |= 0x800000;
+    int shift = 14 - exp;
+    unsigned short h = (unsigned short)(mant >> shift);
+    unsigned int rem = mant & ((1u << shift) - 1), halfway = 1u << (shift - 1);
+    if (rem > halfway || (rem == halfway && (h & 1))) h++;
+    return sign | h;
+  }
+  unsigned short h = (unsigned short)(sign | (exp << 10) | (mant >> 13));
+  unsigned int rem = mant & 0x1fff;
+  if (rem > 0x1000 || (rem == 0x1000 && (h & 1))) h++;
+  return h;
+}
+
+__global__ static void _copy_from_mat_fh(float *mat_out, const unsigned short *mat_in, MatrixDim d_out, int in_stride) {
+  int i = blockIdx.x * blockDim.x + threadIdx.x;  // col-index
+  int j = blockIdx.y * blockDim.y + threadIdx.y;  // row-index
+  if (i < d_out.cols && j < d_out.rows)
+    mat_out[j * d_out.stride + i] = _half_bits_to_float(mat_in[j * in_stride + i]);
+}
+
+__global__ static void _copy_from_mat_hf(unsigned short *mat_out, const float *mat_in, MatrixDim d_in, int out_stride) {
+  int i = blockIdx.x * blockDim.x + threadIdx.x;  // col-index
+  int j = blockIdx.y * blockDim.y + threadIdx.y;  // row-index
+  if (i < d_in.cols && j < d_in.rows)
+    mat_out[j * out_stride + i] = _float_to_half_bits(mat_in[j * d_in.stride + i]);
+}
+
+__global__ static void _copy_from_mat_fq(float *mat_out, const signed char *mat_in, const float *row_scales, MatrixDim d_out, int in_stride) {
+  int i = blockIdx.x * blockDim.x + threadIdx.x;  // col-index
+  int j = blockIdx.y * blockDim.y + threadIdx.y;  // row-index
+  if (i < d_out.cols && j < d_out.rows)
+    mat_out[j * d_out.stride + i] = row_scales[j] * (float)mat_in[j * in_stride + i];
+}
+
+void cuda_copy_from_mat_fh(dim3 Gr, dim3 Bl, float *mat_out, const unsigned short *mat_in, MatrixDim d_out, int in_stride) {
+  _copy_from_mat_fh<<<Gr,Bl>>>(mat_out, mat_in, d_out, in_stride);
+}
+
+void cuda_copy_from_mat_hf(dim3 Gr, dim3 Bl, unsigned short *mat_out, const float *mat_in, MatrixDim d_in, int out_stride) {
+  _copy_from_mat_hf<<<Gr,Bl>>>(mat_out, mat_in, d_in, out_stride);
+}
+
+void cuda_copy_from_mat_fq(dim3 Gr, dim3 Bl, float *mat_out, const signed char *mat_in, const float *row_scales, MatrixDim d_out, int in_stride) {
+  _copy_from_mat_fq<<<Gr,Bl>>>(mat_out, mat_in, row_scales, d_out, in_stride);
+}
+
+// Block-sparse GEMM for cu-block-sparse-matrix.h: each thread owns one
+// element of C (column i = output unit, row j = frame) and walks the stored
+// blocks of the block-row that the output unit falls in.  All threads of a
+// warp share the same frame row of A, so the A reads are broadcasts; the
+// block data is read along rows and hits in L2/texture cache.
+__global__ static void _add_mat_blocksparse(float alpha, const float *A,
+                                            MatrixDim a_dim,
+                                            const float *blocks,
+                                            int block_stride,
+                                            const int *block_row_ptr,
+                                            const int *block_col_idx,
+                                            int block_rows, int block_cols,
+                                            float *C, MatrixDim c_dim) {
+  int i = blockIdx.x * blockDim.x + threadIdx.x;  // col-index into C
+  int j = blockIdx.y * blockDim.y + threadIdx.y;  // row-index into C
+  if (i >= c_dim.cols || j >= c_dim.rows) return;
+  int br = i / block_rows, r = i % block_rows;
+  float sum = 0.0f;
+  for (int b = block_row_ptr[br]; b < block_row_ptr[br + 1]; b++) {
+    int col0 = block_col_idx[b] * block_cols;
+    const float *block_row = blocks + (b * block_rows + r) * block_stride;
+    const float *a_row = A + j * a_dim.stride + col0;
+    int limit = a_dim.cols - col0;  // edge blocks are zero-padded, but we
+    if (limit > block_cols)         // must not read A past its last column.
+      limit = block_cols;
+    for (int k = 0; k < limit; k++)
+      sum += a_row[k] * block_row[k];
+  }
+  C[j * c_dim.stride + i] += alpha * sum;
+}
+
+void cuda_add_mat_blocksparse(dim3 Gr, dim3 Bl, float alpha, const float *A, MatrixDim a_dim, const float *blocks, int block_stride, const int *block_row_ptr, const int *block_col_idx, int block_rows, int block_cols, float *C, MatrixDim c_dim) {
+  _add_mat_blocksparse<<<Gr,Bl>>>(alpha, A, a_dim, blocks, block_stride, block_row_ptr, block_col_idx, block_rows, block_cols, C, c_dim);
+}
+
+// Below are the kernels behind cu-compressed-matrix.{h,cc}.  The four
+// _float_to_*/_*_to_float helpers are device-side copies of the scalar
+// codec in matrix/compressed-matrix.cc (FloatToUint16 etc.); keep them in
+// sync with it so that compressing on the device gives the same bytes as
+// compressing on the host (up to fused-multiply-add contraction, which
+// can move a borderline element by one code).
+
+__device__ static unsigned short _float_to_uint16(float min_value, float range,
+                                                  float value) {
+  float f = (value - min_value) / range;
+  if (f > 1.0) f = 1.0;  // Note: this should not happen.
+  if (f < 0.0) f = 0.0;  // Note: this should not happen.
+  return (unsigned short)(int)(f * 65535 + 0.499);
+}
+
+__device__ static float _uint16_to_float(float min_value, float range,
+                                         unsigned short value) {
+  // the constant 1.52590218966964e-05 is 1/65535.
+  return min_value + range * 1.52590218966964e-05F * value;
+}
+
+__device__ static unsigned char _float_to_char(float p0, float p25, float p75,
+                                               float p100, float value) {
+  int ans;
+  if (value < p25) {
+    float f = (value - p0) / (p25 - p0);
+    ans = (int)(f * 64 + 0.5);
+    if (ans < 0) ans = 0;
+    if (ans > 64) ans = 64;
+  } else if (value < p75) {
+    float f = (value - p25) / (p75 - p25);
+    ans = 64 + (int)(f * 128 + 0.5);
+    if (ans < 64) ans = 64;
+    if (ans > 192) ans = 192;
+  } else {
+    float f = (value - p75) / (p100 - p75);
+    ans = 192 + (int)(f * 63 + 0.5);
+    if (ans < 192) ans = 192;
+    if (ans > 255) ans = 255;
+  }
+  return (unsigned char)ans;
+}
+
+__device__ static float _char_to_float(float p0, float p25, float p75,
+                                       float p100, unsigned char value) {
+  if (value <= 64) {
+    return p0 + (p25 - p0) * value * (1/64.0);
+  } else if (value <= 192) {
+    return p25 + (p75 - p25) * (value - 64) * (1/128.0);
+  } else {
+    return p75 + (p100 - p75) * (value - 192) * (1/63.0);
+  }
+}
+
+// One block of CU1DBLOCK threads, like _vec_min and _vec_max above, but
+// over a (possibly padded) matrix; writes { min, max } to min_max.
+__global__ static void _compressed_min_max(const float *mat, MatrixDim d,
+                                           float *min_max) {
+  int tid = threadIdx.x;
+  __shared__ float min_data[CU1DBLOCK];
+  __shared__ float max_data[CU1DBLOCK];
+  float min = 1.0 / 0.0, max = -1.0 / 0.0;  // +/- infinity.
+  int num_elements = d.rows * d.cols;
+  for (int k = tid; k < num_elements; k += CU1DBLOCK) {
+    float v = mat[(k / d.cols) * d.stride + (k % d.cols)];
+    if (v < min) min = v;
+    if (v > max) max = v;
+  }
+  min_data[tid] = min;
+  max_data[tid] = max;
+  __syncthreads();
+  min_max[0] = _min_reduce(min_data);
+  __syncthreads();
+  min_max[1] = _max_reduce(max_data);
+}
+
+// One block of CU1DBLOCK threads per column.  Computes the four per-column
+// percentile codes that CompressedMatrix::ComputeColHeader() computes: the
+// 16-bit codes of the elements that sorted order would put at positions 0,
+// num_rows/4, 3*(num_rows/4) and num_rows-1.  Because _float_to_uint16 is
+// monotonic, the code of the k'th smallest element equals the k'th
+// smallest code, so instead of selecting in float space we binary-search
+// the code space, counting elements whose code is <= the midpoint; this
+// gives exact order statistics, not an approximation, so the headers match
+// what the CPU computes.  num_rows >= 5 can be assumed
+// (this format is only used for matrices with more than 8 rows), so we
+// don't replicate the small-num_rows branch of ComputeColHeader().
+__global__ static void _compressed_compute_col_headers(
+    const float *mat, MatrixDim d, float min_value, float range,
+    unsigned short *col_headers) {
+  int col = blockIdx.x;
+  int tid = threadIdx.x;
+  __shared__ int count[CU1DBLOCK];
+  int num_rows = d.rows, quarter_nr = num_rows / 4;
+  int ranks[4], codes[4];
+  ranks[0] = 0;
+  ranks[1] = quarter_nr;
+  ranks[2] = 3 * quarter_nr;
+  ranks[3] = num_rows - 1;
+  for (int s = 0; s < 4; s++) {
+    int lo = 0, hi = 65535;  // invariant: the answer is in [lo, hi].
+    while (lo < hi) {
+      int mid = (lo + hi) / 2, c = 0;
+      for (int j = tid; j < num_rows; j += CU1DBLOCK)
+        if (_float_to_uint16(min_value, range, mat[j * d.stride + col]) <= mid)
+          c++;
+      count[tid] = c;
+      for (int nt = CU1DBLOCK / 2; nt > 0; nt >>= 1) {
+        __syncthreads();
+        if (tid < nt) count[tid] += count[tid + nt];
+      }
+      __syncthreads();
+      int num_leq = count[0];  // #elements with code <= mid, in this column.
+      __syncthreads();  // make sure all threads read count[0] before the
+                        // next iteration overwrites it.
+      if (num_leq > ranks[s]) hi = mid;
+      else lo = mid + 1;
+    }
+    codes[s] = lo;
+  }
+  if (tid == 0) {
+    // the same monotonicity fixups as in ComputeColHeader(): the four
+    // values must be strictly increasing, with room above percentile_100.
+    int p0 = codes[0], p25 = codes[1], p75 = codes[2], p100 = codes[3];
+    if (p0 > 65532) p0 = 65532;
+    if (p25 < p0 + 1) p25 = p0 + 1;
+    if (p25 > 65533) p25 = 65533;
+    if (p75 < p25 + 1) p75 = p25 + 1;
+    if (p75 > 65534) p75 = 65534;
+    if (p100 < p75 + 1) p100 = p75 + 1;
+    col_headers[col * 4] = (unsigned short)p0;
+    col_headers[col * 4 + 1] = (unsigned short)p25;
+    col_headers[col * 4 + 2] = (unsigned short)p75;
+    col_headers[col * 4 + 3] = (unsigned short)p100;
+  }
+}
+
+// Note: in the four kernels below the byte data is stored column-major
+// (column i occupies bytes [i * d.rows, (i+1) * d.rows)) and the uint16
+// data of format 2 is stored row-major without padding, matching class
+// CompressedMatrix's layout.
+
+__global__ static void _compress_format1(unsigned char *byte_data, const float *mat, MatrixDim d, float min_value, float range, const unsigned short *col_headers) {
+  int i = blockIdx.x * blockDim.x + threadIdx.x;  // col-index
+  int j = blockIdx.y * blockDim.y + threadIdx.y;  // row-index
+  if (i < d.cols && j < d.rows) {
+    float p0 = _uint16_to_float(min_value, range, col_headers[i * 4]),
+        p25 = _uint16_to_float(min_value, range, col_headers[i * 4 + 1]),
+        p75 = _uint16_to_float(min_value, range, col_headers[i * 4 + 2]),
+        p100 = _uint16_to_float(min_value, range, col_headers[i * 4 + 3]);
+    byte_data[i * d.rows + j] =
+        _float_to_char(p0, p25, p75, p100, mat[j * d.stride + i]);
+  }
+}
+
+__global__ static void _uncompress_format1(float *mat, MatrixDim d, float min_value, float range, const unsigned short *col_headers, const unsigned char *byte_data) {
+  int i = blockIdx.x * blockDim.x + threadIdx.x;  // col-index
+  int j = blockIdx.y * blockDim.y + threadIdx.y;  // row-index
+  if (i < d.cols && j < d.rows) {
+    float p0 = _uint16_to_float(min_value, range, col_headers[i * 4]),
+        p25 = _uint16_to_float(min_value, range, col_headers[i * 4 + 1]),
+        p75 = _uint16_to_float(min_value, range, col_headers[i * 4 + 2]),
+        p100 = _uint16_to_float(min_value, range, col_headers[i * 4 + 3]);
+    mat[j * d.stride + i] =
+        _char_to_float(p0, p25, p75, p100, byte_data[i * d.rows + j]);
+  }
+}
+
+__global__ static void _compress_format2(unsigned short *out, const float *mat, MatrixDim d, float min_value, float range) {
+  int i = blockIdx.x * blockDim.x + threadIdx.x;  // col-index
+  int j = blockIdx.y * blockDim.y + threadIdx.y;  // row-index
+  if (i < d.cols && j < d.rows)
+    out[j * d.cols + i] = _float_to_uint16(min_value, range,
+                                           mat[j * d.stride + i]);
+}
+
+__global__ static void _uncompress_format2(float *mat, MatrixDim d, float min_value, float range, const unsigned short *in) {
+  int i = blockIdx.x * blockDim.x + threadIdx.x;  // col-index
+  int j = blockIdx.y * blockDim.y + threadIdx.y;  // row-index
+  if (i < d.cols && j < d.rows)
+    mat[j * d.stride + i] = _uint16_to_float(min_value, range,
+                                             in[j * d.cols + i]);
+}
+
+void cuda_compressed_min_max(const float *mat, MatrixDim d, float *min_max) {
+  _compressed_min_max<<<1,CU1DBLOCK>>>(mat, d, min_max);
+}
+
+void cuda_compressed_compute_col_headers(const float *mat, MatrixDim d, float min_value, float range, unsigned short *col_headers) {
+  _compressed_compute_col_headers<<<d.cols,CU1DBLOCK>>>(mat, d, min_value, range, col_headers);
+}
+
+void cuda_compress_format1(dim3 Gr, dim3 Bl, unsigned char *byte_data, const float *mat, MatrixDim d, float min_value, float range, const unsigned short *col_headers) {
+  _compress_format1<<<Gr,Bl>>>(byte_data, mat, d, min_value, range, col_headers);
+}
+
+void cuda_uncompress_format1(dim3 Gr, dim3 Bl, float *mat, MatrixDim d, float min_value, float range, const unsigned short *col_headers, const unsigned char *byte_data) {
+  _uncompress_format1<<<Gr,Bl>>>(mat, d, min_value, range, col_headers, byte_data);
+}
+
+void cuda_compress_format2(dim3 Gr, dim3 Bl, unsigned short *out, const float *mat, MatrixDim d, float min_value, float range) {
+  _compress_format2<<<Gr,Bl>>>(out, mat, d, min_value, range);
+}
+
+void cuda_uncompress_format2(dim3 Gr, dim3 Bl, float *mat, MatrixDim d, float min_value, float range, const unsigned short *in) {
+  _uncompress_format2<<<Gr,Bl>>>(mat, d, min_value, range, in);
+}
+
 void cuda_copy_from_smat_ff(dim3 Gr, dim3 Bl, float* mat_out, const MatrixElement<float>* smat_in, MatrixDim d_out, MatrixIndexT_cuda d_in) {
   _copy_from_smat<<<Gr,Bl>>>(mat_out, smat_in, d_out, d_in);
 }
@@ -3197,3 +3790,15 @@ void cudaD_trace_mat_smat_trans(dim3 Gr, dim3 Bl, const double* mat_in, const Ma
   _trace_mat_smat_trans<<<Gr,Bl>>>(mat_in, smat_in, mat_d_in, smat_d_in, trace_vec_out);
 }
 
+/*
+ * lattice forward-backward
+ */
+void cudaD_lattice_alpha_level(dim3 Gr, dim3 Bl, int num_level_states, const int32_cuda *level_states, const int32_cuda *in_arc_offsets, const int32_cuda *in_arc_ids, const int32_cuda *arc_src, const double *arc_like, double *alpha) {
+  _lattice_alpha_level<<<Gr,Bl>>>(num_level_states, level_states, in_arc_offsets, in_arc_ids, arc_src, arc_like, alpha);
+}
+void cudaD_lattice_beta_level(dim3 Gr, dim3 Bl, int num_level_states, const int32_cuda *level_states, const int32_cuda *arc_offsets, const int32_cuda *arc_nextstate, const double *arc_like, const double *final_like, double *beta) {
+  _lattice_beta_level<<<Gr,Bl>>>(num_level_states, level_states, arc_offsets, arc_nextstate, arc_like, final_like, beta);
+}
+void cudaD_lattice_arc_post(dim3 Gr, dim3 Bl, int num_arcs, const int32_cuda *arc_src, const int32_cuda *arc_nextstate, const double *arc_like, const double *alpha, const double *beta, double tot_prob, double *arc_post) {
+  _lattice_arc_post<<<Gr,Bl>>>(num_arcs, arc_src, arc_nextstate, arc_like, alpha, beta, tot_prob, arc_post);
+}
@@ -206,6 +206,8 @@ inline void cuda_vec_mul_elements(int Gr, int Bl, float* v, const float* a, int
 inline void cuda_vec_soft_max(int Gr, int Bl, float* v, int dim) { cudaF_vec_soft_max(Gr,Bl,v,dim); }
 inline void cuda_vec_min(const float* v, float* value, int dim) { cudaF_vec_min(v,value,dim); }
 inline void cuda_vec_max(const float* v, float* value, int dim) { cudaF_vec_max(v,value,dim); }
+inline void cuda_vec_stats(const float* v, float* stats, int dim) { cudaF_vec_stats(v,stats,dim); }
+inline void cuda_accumulate_accuracy(const int32_cuda* best, const int32_cuda* ref, const float* weights, int dim, float* acc) { cudaF_accumulate_accuracy(best,ref,weights,dim,acc); }
 inline void cuda_trace_mat_mat_trans(const float* A, const float* B, MatrixDim dA, int B_stride, float* value) { cudaF_trace_mat_mat_trans(A,B,dA,B_stride,value); }
 inline void cuda_trace_mat_mat(const float* A, const float* B, MatrixDim dA, int B_stride, float* value) { cudaF_trace_mat_mat(A,B,dA,B_stride,value); }
 inline void cuda_add_diag_mat_mat(int Gr, int Bl, float alpha, float* v, int v_dim, const float* M, 
@@ -260,7 +262,11 @@ Bl: dimBlock value is fixed min(d.col, CU1DBLOCK), represent CU1DBLOCK threads r
 Gr: the number of rows
 */
 inline void cuda_softmax_reduce(size_t Gr, size_t Bl, float *y, const float *x, MatrixDim d, int src_stride) { cudaF_softmax_reduce(Gr,Bl,y,x,d,src_stride); }
+inline void cuda_softmax_floor_reduce(size_t Gr, size_t Bl, float *y, const float *x, MatrixDim d, int src_stride, float floor_val) { cudaF_softmax_floor_reduce(Gr,Bl,y,x,d,src_stride,floor_val); }
 inline void cuda_log_softmax_reduce(size_t Gr, size_t Bl, float *y, const float *x, MatrixDim d, int src_stride) { cudaF_log_softmax_reduce(Gr,Bl,y,x,d,src_stride); }
+inline void cuda_log_softmax_floor_reduce(size_t Gr, size_t Bl, float *y, const float *x, MatrixDim d, int src_stride, float floor_val) { cudaF_log_softmax_floor_reduce(Gr,Bl,y,x,d,src_stride,floor_val); }
+inline void cuda_apply_floor_log(dim3 Gr, dim3 Bl, float *mat, float floor_val, MatrixDim d) { cudaF_apply_floor_log(Gr,Bl,mat,floor_val,d); }
+inline void cuda_floor_with_row_sums(size_t Gr, size_t Bl, float *y, const float *x, float floor_val, float *row_sums, MatrixDim d, int src_stride) { cudaF_floor_with_row_sums(Gr,Bl,y,x,floor_val,row_sums,d,src_stride); }
 
 inline void cuda_regularize_l1(dim3 Gr, dim3 Bl, float *wei, float *grad, float l1, float lr, MatrixDim d, int stride_grad) { cudaF_regularize_l1(Gr,Bl,wei,grad,l1,lr,d,stride_grad); }
 inline void cuda_find_row_max_id(dim3 Gr, dim3 Bl, const float *mat, float *vec_val, int32_cuda *vec_id, int32_cuda voff, MatrixDim d) { cudaF_find_row_max_id(Gr,Bl,mat,vec_val,vec_id,voff,d); }
@@ -392,6 +398,8 @@ inline void cuda_vec_mul_elements(int Gr, int Bl, double* v, const double* a, in
 inline void cuda_vec_soft_max(int Gr, int Bl, double* v, int dim) { cudaD_vec_soft_max(Gr,Bl,v,dim); }
 inline void cuda_vec_min(const double* v, double* value, int dim) { cudaD_vec_min(v,value,dim); }
 inline void cuda_vec_max(const double* v, double* value, int dim) { cudaD_vec_max(v,value,dim); }
+inline void cuda_vec_stats(const double* v, double* stats, int dim) { cudaD_vec_stats(v,stats,dim); }
+inline void cuda_accumulate_accuracy(const int32_cuda* best, const int32_cuda* ref, const double* weights, int dim, double* acc) { cudaD_accumulate_accuracy(best,ref,weights,dim,acc); }
 inline void cuda_trace_mat_mat_trans(const double* A, const double* B, MatrixDim dA, int B_stride, double* value) { cudaD_trace_mat_mat_trans(A,B,dA,B_stride,value); }
 inline void cuda_trace_mat_mat(const double* A, const double* B, MatrixDim dA, int B_stride, double* value) { cudaD_trace_mat_mat(A,B,dA,B_stride,value); }
 inline void cuda_add_diag_mat_mat(int Gr, int Bl, double alpha, double* v, int v_dim, const double* M, 
@@ -440,7 +448,11 @@ inline void cuda_diff_sigmoid(dim3 Gr, dim3 Bl, double *eout, const double *e, c
 inline void cuda_tanh(dim3 Gr, dim3 Bl, double *y, const double *x, MatrixDim d, int src_stride) { cudaD_tanh(Gr,Bl,y,x,d,src_stride); }
 inline void cuda_diff_tanh(dim3 Gr, dim3 Bl, double *eout, const double *e, const double *y, MatrixDim d, int e_stride, int y_stride) { cudaD_diff_tanh(Gr,Bl,eout,e,y,d,e_stride,y_stride); }
 inline void cuda_softmax_reduce(size_t Gr, size_t Bl, double *y, const double *x, MatrixDim d, int src_stride) { cudaD_softmax_reduce(Gr,Bl,y,x,d,src_stride); }
+inline void cuda_softmax_floor_reduce(size_t Gr, size_t Bl, double *y, const double *x, MatrixDim d, int src_stride, double floor_val) { cudaD_softmax_floor_reduce(Gr,Bl,y,x,d,src_stride,floor_val); }
 inline void cuda_log_softmax_reduce(size_t Gr, size_t Bl, double *y, const double *x, MatrixDim d, int src_stride) { cudaD_log_softmax_reduce(Gr,Bl,y,x,d,src_stride); }
+inline void cuda_log_softmax_floor_reduce(size_t Gr, size_t Bl, double *y, const double *x, MatrixDim d, int src_stride, double floor_val) { cudaD_log_softmax_floor_reduce(Gr,Bl,y,x,d,src_stride,floor_val); }
+inline void cuda_apply_floor_log(dim3 Gr, dim3 Bl, double *mat, double floor_val, MatrixDim d) { cudaD_apply_floor_log(Gr,Bl,mat,floor_val,d); }
+inline void cuda_floor_with_row_sums(size_t Gr, size_t Bl, double *y, const double *x, double floor_val, double *row_sums, MatrixDim d, int src_stride) { cudaD_floor_with_row_sums(Gr,Bl,y,x,floor_val,row_sums,d,src_stride); }
 
 inline void cuda_regularize_l1(dim3 Gr, dim3 Bl, double *wei, double *grad, double l1, double lr, MatrixDim d, int stride_grad) { cudaD_regularize_l1(Gr,Bl,wei,grad,l1,lr,d,stride_grad); }
 inline void cuda_find_row_max_id(dim3 Gr, dim3 Bl, const double *mat, double *vec_val, int32_cuda *vec_id, int32_cuda voff, MatrixDim d) { cudaD_find_row_max_id(Gr,Bl,mat,vec_val,vec_id,voff,d); }
@@ -497,6 +509,20 @@ inline cublasStatus_t cuda_scal(cublasHandle_t handle, int n, double alpha, doub
 }
 
 
+
+/*
+ * lattice forward-backward
+ */
+inline void cuda_lattice_alpha_level(dim3 Gr, dim3 Bl, int num_level_states, const int32_cuda *level_states, const int32_cuda *in_arc_offsets, const int32_cuda *in_arc_ids, const int32_cuda *arc_src, const double *arc_like, double *alpha) {
+  cudaD_lattice_alpha_level(Gr, Bl, num_level_states, level_states, in_arc_offsets, in_arc_ids, arc_src, arc_like, alpha);
+}
+inline void cuda_lattice_beta_level(dim3 Gr, dim3 Bl, int num_level_states, const int32_cuda *level_states, const int32_cuda *arc_offsets, const int32_cuda *arc_nextstate, const double *arc_like, const double *final_like, double *beta) {
+  cudaD_lattice_beta_level(Gr, Bl, num_level_states, level_states, arc_offsets, arc_nextstate, arc_like, final_like, beta);
+}
+inline void cuda_lattice_arc_post(dim3 Gr, dim3 Bl, int num_arcs, const int32_cuda *arc_src, const int32_cuda *arc_nextstate, const double *arc_like, const double *alpha, const double *beta, double tot_prob, double *arc_post) {
+  cudaD_lattice_arc_post(Gr, Bl, num_arcs, arc_src, arc_nextstate, arc_like, alpha, beta, tot_prob, arc_post);
+}
+
 } // namespace kaldi
 
 
@@ -0,0 +1,193 @@
+// cudamatrix/cu-lattice.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+
+#include "cudamatrix/cu-lattice.h"
+
+#if HAVE_CUDA == 1
+#include <cuda_runtime_api.h>
+#include "base/timer.h"
+#include "cudamatrix/cu-array.h"
+#include "cudamatrix/cu-common.h"
+#include "cudamatrix/cu-device.h"
+#include "cudamatrix/cu-kernels.h"
+#endif
+
+namespace kaldi {
+
+#if HAVE_CUDA == 1
+
+double CudaLatticeForwardBackward(int32 num_states,
+                                  const std::vector<int32> &arc_offsets,
+                                  const std::vector<int32> &arc_nextstate,
+                                  const std::vector<double> &arc_loglike,
+                                  const std::vector<double> &final_loglike,
+                                  std::vector<double> *arc_post,
+                                  std::vector<double> *alpha_out) {
+  KALDI_ASSERT(CuDevice::Instantiate().Enabled());
+  KALDI_ASSERT(num_states > 0 &&
+               arc_offsets.size() == static_cast<size_t>(num_states) + 1);
+  int32 num_arcs = static_cast<int32>(arc_nextstate.size());
+  KALDI_ASSERT(arc_offsets[num_states] == num_arcs &&
+               arc_loglike.size() == static_cast<size_t>(num_arcs) &&
+               final_loglike.size() == static_cast<size_t>(num_states));
+  Timer tim;
+
+  // Source state of each arc, and topological depth ("level") of each
+  // state: level(s) = 1 + max over predecessors p of level(p).  All of a
+  // state's predecessors are at strictly lower levels, so states on the
+  // same level never depend on each other and one kernel launch can
+  // process a whole level.
+  std::vector<int32> arc_src(num_arcs);
+  std::vector<int32> level(num_states, 0);
+  int32 num_levels = 1;
+  for (int32 s = 0; s < num_states; s++) {
+    for (int32 i = arc_offsets[s]; i < arc_offsets[s + 1]; i++) {
+      int32 t = arc_nextstate[i];
+      KALDI_ASSERT(t > s && t < num_states &&
+                   "Lattice is not topologically sorted");
+      arc_src[i] = s;
+      if (level[t] < level[s] + 1) {
+        level[t] = level[s] + 1;
+        if (num_levels < level[t] + 1)
+          num_levels = level[t] + 1;
+      }
+    }
+  }
+  // Counting-sort the states by level.
+  std::vector<int32> level_offsets(num_levels + 1, 0),
+      level_states(num_states);
+  for (int32 s = 0; s < num_states; s++)
+    level_offsets[level[s] + 1]++;
+  for (int32 l = 0; l < num_levels; l++)
+    level_offsets[l + 1] += level_offsets[l];
+  {
+    std::vector<int32> cursor(level_offsets.begin(),
+                              level_offsets.end() - 1);
+    for (int32 s = 0; s < num_states; s++)
+      level_states[cursor[level[s]]++] = s;
+  }
+  // Incoming-arc CSR (arc indexes grouped by destination state), for the
+  // alpha gather.
+  std::vector<int32> in_arc_offsets(num_states + 1, 0),
+      in_arc_ids(num_arcs);
+  for (int32 i = 0; i < num_arcs; i++)
+    in_arc_offsets[arc_nextstate[i] + 1]++;
+  for (int32 s = 0; s < num_states; s++)
+    in_arc_offsets[s + 1] += in_arc_offsets[s];
+  {
+    std::vector<int32> cursor(in_arc_offsets.begin(),
+                              in_arc_offsets.end() - 1);
+    for (int32 i = 0; i < num_arcs; i++)
+      in_arc_ids[cursor[arc_nextstate[i]]++] = i;
+  }
+
+  CuArray<int32> cu_level_states(level_states),
+      cu_in_arc_offsets(in_arc_offsets), cu_in_arc_ids(in_arc_ids),
+      cu_arc_offsets(arc_offsets), cu_arc_src(arc_src),
+      cu_arc_nextstate(arc_nextstate);
+  CuArray<double> cu_arc_like(arc_loglike), cu_final(final_loglike);
+
+  std::vector<double> alpha(num_states, kLogZeroDouble);
+  alpha[0] = 0.0;  // the start state.
+  CuArray<double> cu_alpha(alpha);
+  // Level 0 is just the states with no incoming arcs, whose alphas are
+  // already their initialized values.
+  for (int32 l = 1; l < num_levels; l++) {
+    int32 n = level_offsets[l + 1] - level_offsets[l];
+    if (n == 0) continue;
+    dim3 dimBlock(CU1DBLOCK);
+    dim3 dimGrid(n_blocks(n, CU1DBLOCK));
+    cuda_lattice_alpha_level(dimGrid, dimBlock, n,
+                             cu_level_states.Data() + level_offsets[l],
+                             cu_in_arc_offsets.Data(), cu_in_arc_ids.Data(),
+                             cu_arc_src.Data(), cu_arc_like.Data(),
+                             cu_alpha.Data());
+  }
+  CU_SAFE_CALL(cudaGetLastError());
+  cu_alpha.CopyToVec(&alpha);
+
+  double tot_forward_prob = kLogZeroDouble;
+  for (int32 s = 0; s < num_states; s++)
+    if (final_loglike[s] != kLogZeroDouble)
+      tot_forward_prob = LogAdd(tot_forward_prob,
+                                alpha[s] + final_loglike[s]);
+
+  CuArray<double> cu_beta(num_states, kUndefined);
+  for (int32 l = num_levels - 1; l >= 0; l--) {
+    int32 n = level_offsets[l + 1] - level_offsets[l];
+    if (n == 0) continue;
+    dim3 dimBlock(CU1DBLOCK);
+    dim3 dimGrid(n_blocks(n, CU1DBLOCK));
+    cuda_lattice_beta_level(dimGrid, dimBlock, n,
+                            cu_level_states.Data() + level_offsets[l],
+                            cu_arc_offsets.Data(), cu_arc_nextstate.Data(),
+                            cu_arc_like.Data(), cu_final.Data(),
+                            cu_beta.Data());
+  }
+  CU_SAFE_CALL(cudaGetLastError());
+
+  arc_post->resize(num_arcs);
+  if (num_arcs > 0) {
+    CuArray<double> cu_arc_post(num_arcs, kUndefined);
+    dim3 dimBlock(CU1DBLOCK);
+    dim3 dimGrid(n_blocks(num_arcs, CU1DBLOCK));
+    // As in the CPU code, the posteriors are normalized by the forward
+    // probability.
+    cuda_lattice_arc_post(dimGrid, dimBlock, num_arcs, cu_arc_src.Data(),
+                          cu_arc_nextstate.Data(), cu_arc_like.Data(),
+                          cu_alpha.Data(), cu_beta.Data(), tot_forward_prob,
+                          cu_arc_post.Data());
+    CU_SAFE_CALL(cudaGetLastError());
+    cu_arc_post.CopyToVec(arc_post);
+  }
+
+  std::vector<double> beta;
+  cu_beta.CopyToVec(&beta);
+  double tot_backward_prob = beta[0];
+  if (!ApproxEqual(tot_forward_prob, tot_backward_prob, 1e-8)) {
+    KALDI_WARN << "Total forward probability over lattice = "
+               << tot_forward_prob << ", while total backward probability = "
+               << tot_backward_prob;
+  }
+  if (alpha_out != NULL)
+    alpha_out->swap(alpha);
+  CuDevice::Instantiate().AccuProfile("CudaLatticeForwardBackward",
+                                      tim.Elapsed());
+  return tot_backward_prob;
+}
+
+#else
+
+double CudaLatticeForwardBackward(int32 num_states,
+                                  const std::vector<int32> &arc_offsets,
+                                  const std::vector<int32> &arc_nextstate,
+                                  const std::vector<double> &arc_loglike,
+                                  const std::vector<double> &final_loglike,
+                                  std::vector<double> *arc_post,
+                                  std::vector<double> *alpha_out) {
+  KALDI_ERR << "CudaLatticeForwardBackward() called but Kaldi was compiled "
+            << "without CUDA support.";
+  return 0.0;
+}
+
+#endif  // HAVE_CUDA
+
+}  // namespace kaldi
@@ -0,0 +1,72 @@
+// cudamatrix/cu-lattice.h
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_CUDAMATRIX_CU_LATTICE_H_
+#define KALDI_CUDAMATRIX_CU_LATTICE_H_
+
+#include <vector>
+
+#include "base/kaldi-common.h"
+
+namespace kaldi {
+
+/**
+   Computes the forward-backward over a lattice on the GPU, returning the
+   posterior of every arc.  This is the numeric core only: the lattice
+   comes in as plain arrays (frozen CSR form, c.f. lat/frozen-lattice.h)
+   so that this file has no FST dependency; see
+   CudaLatticeForwardBackward() in lat/cu-lattice-functions.h for the
+   version that takes a Lattice and produces a Posterior.
+
+   The states must be topologically sorted with start state 0.
+   "arc_offsets" has size num_states + 1, with state s's arcs being the
+   indexes [arc_offsets[s], arc_offsets[s+1]) into the per-arc arrays;
+   "arc_loglike" is the arc's negated total cost (graph plus acoustic) and
+   "final_loglike" is each state's negated final cost, -infinity if the
+   state is not final.
+
+   Internally the states are level-scheduled by topological depth:
+   alpha is computed with one kernel launch per level, gathering each
+   state's incoming arcs (which by construction were all written by
+   earlier levels, so no atomics are needed), beta the same way in
+   reverse over the outgoing arcs, and a final kernel over all arcs
+   computes the posteriors.  Dense lattices have few levels relative to
+   their arc count, which is what makes this worthwhile; a linear-chain
+   lattice would degenerate to one launch per state and should stay on
+   the CPU.
+
+   Outputs the per-arc posteriors in "arc_post", and, if "alpha_out" is
+   non-NULL, the per-state forward log-probabilities (which the caller
+   needs to compute final-state posteriors).  Returns the total backward
+   log-probability, warning if it differs from the forward one, like
+   LatticeForwardBackward().  A CUDA GPU must be active (check
+   CuDevice::Instantiate().Enabled() and fall back to the CPU code
+   otherwise); errors if compiled without CUDA.
+*/
+double CudaLatticeForwardBackward(int32 num_states,
+                                  const std::vector<int32> &arc_offsets,
+                                  const std::vector<int32> &arc_nextstate,
+                                  const std::vector<double> &arc_loglike,
+                                  const std::vector<double> &final_loglike,
+                                  std::vector<double> *arc_post,
+                                  std::vector<double> *alpha_out);
+
+}  // namespace kaldi
+
+#endif  // KALDI_CUDAMATRIX_CU_LATTICE_H_
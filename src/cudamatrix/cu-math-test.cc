@@ -139,6 +139,100 @@ static void UnitTestCuMathSplice() {
   }
 }
 
+template<typename Real>
+static void UnitTestCuMathSoftmaxWithFloor() {
+  int32 M = 100 + Rand() % 200, N = 100 + Rand() % 200;
+  CuMatrix<Real> src(M, N);
+  src.SetRandn();
+  Real floor_val = 1.0e-10;
+
+  CuMatrix<Real> fused(M, N);
+  cu::SoftmaxWithFloor(src, floor_val, &fused);
+
+  CuMatrix<Real> unfused(M, N);
+  unfused.ApplySoftMaxPerRow(src);
+  unfused.ApplyFloor(floor_val);
+
+  AssertEqual(fused, unfused);
+}
+
+template<typename Real>
+static void UnitTestCuMathLogSoftmaxWithFloor() {
+  int32 M = 100 + Rand() % 200, N = 100 + Rand() % 200;
+  CuMatrix<Real> src(M, N);
+  src.SetRandn();
+  Real floor_val = -10.0;
+
+  CuMatrix<Real> fused(M, N);
+  cu::LogSoftmaxWithFloor(src, floor_val, &fused);
+
+  CuMatrix<Real> unfused(M, N);
+  unfused.ApplyLogSoftMaxPerRow(src);
+  unfused.ApplyFloor(floor_val);
+
+  AssertEqual(fused, unfused);
+}
+
+template<typename Real>
+static void UnitTestCuMathFloorAndLog() {
+  int32 M = 100 + Rand() % 200, N = 100 + Rand() % 200;
+  CuMatrix<Real> src(M, N);
+  src.SetRandUniform();  // in [0, 1), so some values fall below the floor.
+  Real floor_val = 0.5;
+
+  CuMatrix<Real> fused(src);
+  cu::FloorAndLog(floor_val, &fused);
+
+  CuMatrix<Real> unfused(src);
+  unfused.ApplyFloor(floor_val);
+  unfused.ApplyLog();
+
+  AssertEqual(fused, unfused);
+}
+
+template<typename Real>
+static void UnitTestCuMathFloorWithRowSums() {
+  int32 M = 100 + Rand() % 200, N = 100 + Rand() % 200;
+  CuMatrix<Real> src(M, N);
+  src.SetRandn();
+  Real floor_val = 0.0;  // ReLU.
+
+  CuMatrix<Real> fused(M, N);
+  CuVector<Real> fused_sums(M);
+  cu::FloorWithRowSums(src, floor_val, &fused, &fused_sums);
+
+  CuMatrix<Real> unfused(src);
+  unfused.ApplyFloor(floor_val);
+  CuVector<Real> unfused_sums(M);
+  unfused_sums.AddColSumMat(1.0, unfused, 0.0);
+
+  AssertEqual(fused, unfused);
+  AssertEqual(fused_sums, unfused_sums);
+}
+
+template<typename Real>
+static void UnitTestCuMathAccumulateAccuracy() {
+  int32 N = 100 + Rand() % 200;
+  std::vector<int32> best(N), ref(N);
+  Vector<Real> weights(N);
+  double tot_weight = 0.0, tot_correct = 0.0;
+  for (int32 i = 0; i < N; i++) {
+    best[i] = Rand() % 10;
+    ref[i] = Rand() % 10;
+    weights(i) = 0.5 + RandUniform();
+    tot_weight += weights(i);
+    if (best[i] == ref[i]) tot_correct += weights(i);
+  }
+  CuArray<int32> best_gpu(best), ref_gpu(ref);
+  CuVector<Real> weights_gpu(weights);
+  CuVector<Real> acc(2);
+  cu::AccumulateAccuracy(best_gpu, ref_gpu, weights_gpu, &acc);
+  cu::AccumulateAccuracy(best_gpu, ref_gpu, weights_gpu, &acc);  // += again.
+  Vector<Real> acc_cpu(acc);
+  AssertEqual(acc_cpu(0), Real(2.0 * tot_weight));
+  AssertEqual(acc_cpu(1), Real(2.0 * tot_correct));
+}
+
 template<typename Real> void CudaMathUnitTest() {
   #if HAVE_CUDA == 1  
     if (CuDevice::Instantiate().DoublePrecisionSupported())
@@ -146,6 +240,11 @@ template<typename Real> void CudaMathUnitTest() {
   UnitTestCuMathRandomize<Real>();
   UnitTestCuMathSplice<Real>();
   UnitTestCuMathCopy<Real>();
+  UnitTestCuMathSoftmaxWithFloor<Real>();
+  UnitTestCuMathLogSoftmaxWithFloor<Real>();
+  UnitTestCuMathFloorAndLog<Real>();
+  UnitTestCuMathFloorWithRowSums<Real>();
+  UnitTestCuMathAccumulateAccuracy<Real>();
 }
 
 
@@ -18,9 +18,12 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <limits>
+
 #include "base/timer.h"
 #include "cudamatrix/cu-common.h"
 #include "cudamatrix/cu-matrix.h"
+#include "cudamatrix/cu-vector.h"
 #include "cudamatrix/cu-device.h"
 #include "cudamatrix/cu-kernels.h"
 
@@ -205,6 +208,136 @@ void Copy(const CuMatrixBase<Real> &src, const CuArray<int32> &copy_from_indices
   }
 }
 
+template<typename Real>
+void SoftmaxWithFloor(const CuMatrixBase<Real> &src, Real floor_val,
+                      CuMatrixBase<Real> *dst) {
+  KALDI_ASSERT(SameDim(src, *dst));
+  KALDI_ASSERT(floor_val >= 0.0);
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    Timer tim;
+
+    size_t dimBlock = src.NumCols() > CU1DBLOCK ? CU1DBLOCK : src.NumCols();
+    size_t dimGrid = src.NumRows();
+    cuda_softmax_floor_reduce(dimGrid, dimBlock, dst->Data(), src.Data(),
+                              dst->Dim(), src.Stride(), floor_val);
+    CU_SAFE_CALL(cudaGetLastError());
+
+    CuDevice::Instantiate().AccuProfile(__func__, tim.Elapsed());
+  } else
+  #endif
+  {
+    dst->ApplySoftMaxPerRow(src);
+    if (floor_val > 0.0)
+      dst->ApplyFloor(floor_val);
+  }
+}
+
+template<typename Real>
+void LogSoftmaxWithFloor(const CuMatrixBase<Real> &src, Real floor_val,
+                         CuMatrixBase<Real> *dst) {
+  KALDI_ASSERT(SameDim(src, *dst));
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    Timer tim;
+
+    size_t dimBlock = src.NumCols() > CU1DBLOCK ? CU1DBLOCK : src.NumCols();
+    size_t dimGrid = src.NumRows();
+    cuda_log_softmax_floor_reduce(dimGrid, dimBlock, dst->Data(), src.Data(),
+                                  dst->Dim(), src.Stride(), floor_val);
+    CU_SAFE_CALL(cudaGetLastError());
+
+    CuDevice::Instantiate().AccuProfile(__func__, tim.Elapsed());
+  } else
+  #endif
+  {
+    dst->ApplyLogSoftMaxPerRow(src);
+    if (floor_val != -std::numeric_limits<Real>::infinity())
+      dst->ApplyFloor(floor_val);
+  }
+}
+
+template<typename Real>
+void FloorAndLog(Real floor_val, CuMatrixBase<Real> *mat) {
+  KALDI_ASSERT(floor_val > 0.0);
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    Timer tim;
+
+    dim3 dimBlock(CU2DBLOCK, CU2DBLOCK);
+    dim3 dimGrid(n_blocks(mat->NumCols(), CU2DBLOCK), n_blocks(mat->NumRows(), CU2DBLOCK));
+
+    cuda_apply_floor_log(dimGrid, dimBlock, mat->Data(), floor_val, mat->Dim());
+    CU_SAFE_CALL(cudaGetLastError());
+
+    CuDevice::Instantiate().AccuProfile(__func__, tim.Elapsed());
+  } else
+  #endif
+  {
+    mat->ApplyFloor(floor_val);
+    mat->ApplyLog();
+  }
+}
+
+template<typename Real>
+void FloorWithRowSums(const CuMatrixBase<Real> &src, Real floor_val,
+                      CuMatrixBase<Real> *dst, CuVectorBase<Real> *row_sums) {
+  KALDI_ASSERT(SameDim(src, *dst));
+  KALDI_ASSERT(row_sums->Dim() == src.NumRows());
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    Timer tim;
+
+    row_sums->SetZero();
+    size_t dimBlock = src.NumCols() > CU1DBLOCK ? CU1DBLOCK : src.NumCols();
+    size_t dimGrid = src.NumRows();
+    cuda_floor_with_row_sums(dimGrid, dimBlock, dst->Data(), src.Data(),
+                             floor_val, row_sums->Data(), dst->Dim(),
+                             src.Stride());
+    CU_SAFE_CALL(cudaGetLastError());
+
+    CuDevice::Instantiate().AccuProfile(__func__, tim.Elapsed());
+  } else
+  #endif
+  {
+    dst->CopyFromMat(src);
+    dst->ApplyFloor(floor_val);
+    row_sums->AddColSumMat(1.0, *dst, 0.0);
+  }
+}
+
+template<typename Real>
+void AccumulateAccuracy(const CuArray<int32> &best_index,
+                        const CuArray<int32> &ref_index,
+                        const CuVectorBase<Real> &weights,
+                        CuVectorBase<Real> *acc) {
+  int32 dim = weights.Dim();
+  KALDI_ASSERT(best_index.Dim() == dim && ref_index.Dim() == dim &&
+               acc->Dim() == 2);
+  if (dim == 0) return;
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    Timer tim;
+    cuda_accumulate_accuracy(best_index.Data(), ref_index.Data(),
+                             weights.Data(), dim, acc->Data());
+    CU_SAFE_CALL(cudaGetLastError());
+    CuDevice::Instantiate().AccuProfile(__func__, tim.Elapsed());
+  } else
+#endif
+  {
+    const int32 *best = best_index.Data(), *ref = ref_index.Data();
+    const Real *w = weights.Data();
+    double tot_weight = 0.0, tot_correct = 0.0;
+    for (int32 i = 0; i < dim; i++) {
+      tot_weight += w[i];
+      if (best[i] == ref[i]) tot_correct += w[i];
+    }
+    Real *acc_data = acc->Data();
+    acc_data[0] += tot_weight;
+    acc_data[1] += tot_correct;
+  }
+}
+
 // instantiate the templates.
 template
 void RegularizeL1(CuMatrixBase<float> *weight, CuMatrixBase<float> *grad, float l1, float lr);
@@ -233,6 +366,39 @@ void Randomize(const CuMatrixBase<double> &src,
                const CuArray<int32> &copy_from_idx,
                CuMatrixBase<double> *tgt);
 
+template
+void SoftmaxWithFloor(const CuMatrixBase<float> &src, float floor_val,
+                      CuMatrixBase<float> *dst);
+template
+void SoftmaxWithFloor(const CuMatrixBase<double> &src, double floor_val,
+                      CuMatrixBase<double> *dst);
+template
+void LogSoftmaxWithFloor(const CuMatrixBase<float> &src, float floor_val,
+                         CuMatrixBase<float> *dst);
+template
+void LogSoftmaxWithFloor(const CuMatrixBase<double> &src, double floor_val,
+                         CuMatrixBase<double> *dst);
+template
+void FloorAndLog(float floor_val, CuMatrixBase<float> *mat);
+template
+void FloorAndLog(double floor_val, CuMatrixBase<double> *mat);
+template
+void FloorWithRowSums(const CuMatrixBase<float> &src, float floor_val,
+                      CuMatrixBase<float> *dst, CuVectorBase<float> *row_sums);
+template
+void FloorWithRowSums(const CuMatrixBase<double> &src, double floor_val,
+                      CuMatrixBase<double> *dst, CuVectorBase<double> *row_sums);
+template
+void AccumulateAccuracy(const CuArray<int32> &best_index,
+                        const CuArray<int32> &ref_index,
+                        const CuVectorBase<float> &weights,
+                        CuVectorBase<float> *acc);
+template
+void AccumulateAccuracy(const CuArray<int32> &best_index,
+                        const CuArray<int32> &ref_index,
+                        const CuVectorBase<double> &weights,
+                        CuVectorBase<double> *acc);
+
 
 
 } //namespace cu
@@ -73,6 +73,60 @@ void Copy(const CuMatrixBase<Real> &src,
           const CuArray<int32> &copy_from_indices,
           CuMatrixBase<Real> *tgt);
 
+/// The functions below fuse an activation with the small "cleanup" operation
+/// that in practice always follows it, so the chain costs one kernel launch
+/// and one pass over the data instead of two.  For the typical nnet
+/// minibatch sizes the unfused versions are launch-overhead and
+/// memory-bandwidth bound, so the fusion roughly halves their time.
+
+/// Does dst = Softmax(src) followed by flooring the result at floor_val,
+/// equivalent to dst->ApplySoftMaxPerRow(src); dst->ApplyFloor(floor_val);
+/// but as a single kernel.  floor_val = 0 means no flooring.
+/// src and dst must have the same dimension (dst may alias src).
+template<typename Real>
+void SoftmaxWithFloor(const CuMatrixBase<Real> &src, Real floor_val,
+                      CuMatrixBase<Real> *dst);
+
+/// Does dst = LogSoftmax(src) followed by flooring the result at floor_val,
+/// equivalent to dst->ApplyLogSoftMaxPerRow(src); dst->ApplyFloor(floor_val);
+/// but as a single kernel.  floor_val = -inf means no flooring.
+/// src and dst must have the same dimension (dst may alias src).
+template<typename Real>
+void LogSoftmaxWithFloor(const CuMatrixBase<Real> &src, Real floor_val,
+                         CuMatrixBase<Real> *dst);
+
+/// Sets each element of mat to Log(max(element, floor_val)), equivalent to
+/// mat->ApplyFloor(floor_val); mat->ApplyLog(); as a single kernel.
+/// floor_val must be > 0.  Used when converting probabilities to
+/// log-likelihoods, e.g. in online decoding.
+template<typename Real>
+void FloorAndLog(Real floor_val, CuMatrixBase<Real> *mat);
+
+/// Does dst(i,j) = max(src(i,j), floor_val), simultaneously setting
+/// row_sums(i) = sum_j dst(i,j); with floor_val = 0 this is a ReLU forward
+/// pass that also collects the per-row sums often wanted for diagnostics,
+/// without a separate reduction kernel.  The accumulation uses atomics, so
+/// the order of summation is unspecified (results may differ in the last
+/// bit from run to run).  Dimensions of src and dst must match, and
+/// row_sums->Dim() must equal src.NumRows().
+template<typename Real>
+void FloorWithRowSums(const CuMatrixBase<Real> &src, Real floor_val,
+                      CuMatrixBase<Real> *dst, CuVectorBase<Real> *row_sums);
+
+/// Device-resident accuracy accumulation, for diagnostics: adds to
+/// (*acc)(0) the sum of "weights", and to (*acc)(1) the sum of weights[i]
+/// for frames where best_index[i] == ref_index[i].  "best_index" would
+/// typically come from CuMatrixBase::FindRowMaxId() on the network output
+/// and "ref_index"/"weights" from the supervision; since nothing is read
+/// back, a diagnostic pass can accumulate over all its minibatches and do
+/// a single device-to-host transfer at the end, instead of syncing with
+/// the device every minibatch.  All three inputs must have the same
+/// dimension, and acc must have dimension 2.
+template<typename Real>
+void AccumulateAccuracy(const CuArray<int32> &best_index,
+                        const CuArray<int32> &ref_index,
+                        const CuVectorBase<Real> &weights,
+                        CuVectorBase<Real> *acc);
 
 } // namespace cu
 } // namespace kaldi
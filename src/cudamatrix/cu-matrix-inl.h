@@ -44,7 +44,26 @@ inline CuSubMatrix<Real>::CuSubMatrix(const CuMatrixBase<Real> &mat,
     this->stride_ = mat.stride_;
   }
 }
-  
+
+template<typename Real>
+inline CuSubMatrix<Real>::CuSubMatrix(const Real *data,
+                                      const MatrixIndexT num_rows,
+                                      const MatrixIndexT num_cols,
+                                      const MatrixIndexT stride) {
+  if (num_rows == 0 || num_cols == 0) {
+    KALDI_ASSERT(num_rows == 0 && num_cols == 0);
+    // Everything will have been set to zero in CuMatrixBase's default
+    // initializer, so nothing to do.
+  } else {
+    KALDI_ASSERT(data != NULL && num_rows > 0 && num_cols > 0 &&
+                 stride >= num_cols);
+    this->data_ = const_cast<Real*>(data);
+    this->num_cols_ = num_cols;
+    this->num_rows_ = num_rows;
+    this->stride_ = stride;
+  }
+}
+
 } // namespace kaldi
 
 #endif
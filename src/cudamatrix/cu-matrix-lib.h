@@ -28,6 +28,9 @@
 #include "cudamatrix/cu-tp-matrix.h"
 #include "cudamatrix/cu-sparse-matrix.h"
 #include "cudamatrix/cu-block-matrix.h"
+#include "cudamatrix/cu-quantized-matrix.h"
+#include "cudamatrix/cu-compressed-matrix.h"
+#include "cudamatrix/cu-block-sparse-matrix.h"
 #include "cudamatrix/cu-rand.h"
 
 #endif
@@ -2069,6 +2069,35 @@ void UnitTestSwapCu2M() {
   AssertEqual(Hi2,Hi);
 }
 
+template<typename Real>
+void UnitTestCuMatrixView() {
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled())
+    return;  // the views only exist when no GPU is in use.
+#endif
+  Matrix<Real> H(100, 111);
+  H.SetRandn();
+  CuSubMatrix<Real> D = ViewAsCuMatrix(H);
+  KALDI_ASSERT(D.NumRows() == H.NumRows() && D.NumCols() == H.NumCols() &&
+               D.Stride() == H.Stride());
+  Matrix<Real> Hf(D.NumRows(), D.NumCols());
+  D.CopyToMat(&Hf);
+  AssertEqual(H, Hf);
+
+  CuMatrix<Real> Di(100, 111);
+  Di.SetRandn();
+  SubMatrix<Real> M = ViewAsMatrix(Di);
+  Matrix<Real> Df(Di.NumRows(), Di.NumCols());
+  Di.CopyToMat(&Df);
+  AssertEqual(Df, Matrix<Real>(M));
+  // writes through the view must be visible in the CuMatrix.
+  M.Add(1.0);
+  Df.Add(1.0);
+  Matrix<Real> Df2(Di.NumRows(), Di.NumCols());
+  Di.CopyToMat(&Df2);
+  AssertEqual(Df, Df2);
+}
+
 
 template<typename Real>
 void UnitTestCuTanh() {
@@ -2489,6 +2518,7 @@ template<typename Real> void CudaMatrixUnitTest() {
   UnitTestCheck<Real>();
   UnitTestSwapCu2Cu<Real>();
   UnitTestSwapCu2M<Real>();
+  UnitTestCuMatrixView<Real>();
   UnitTestCuMatrixAddDiagVecMat<Real>();
   UnitTestCuMatrixAddMatDiagVec<Real>();
   UnitTestCuMatrixAddMatMatElements<Real>();
@@ -44,6 +44,13 @@
 
 namespace kaldi {
 
+#if HAVE_CUDA == 1
+// Host<->device copies of at least this many bytes are staged through pinned
+// memory (see MallocPinned() in cu-device.h); below this size the extra
+// host-side copy costs more than the bandwidth it buys.
+static const size_t kMinBytesForPinnedTransfer = 65536;
+#endif
+
 template<typename Real>
 void CuMatrix<Real>::Resize(MatrixIndexT rows, MatrixIndexT cols,
                             MatrixResizeType resize_type) {
@@ -303,9 +310,28 @@ void CuMatrixBase<Real>::CopyFromMat(const MatrixBase<Real> &src,
       MatrixIndexT dst_pitch = stride_*sizeof(Real);
       MatrixIndexT src_pitch = src.Stride()*sizeof(Real);
       MatrixIndexT width = src.NumCols()*sizeof(Real);
-      CU_SAFE_CALL(cudaMemcpy2D(data_, dst_pitch, src.Data(), src_pitch,
-                                width, src.NumRows(), cudaMemcpyHostToDevice));
-
+      size_t bytes = static_cast<size_t>(num_rows_) * dst_pitch;
+      Real *staging = NULL;
+      if (bytes >= kMinBytesForPinnedTransfer)
+        staging = static_cast<Real*>(CuDevice::Instantiate().MallocPinned(bytes));
+      if (staging != NULL) {
+        // Stage larger copies through pinned memory, which transfers at
+        // roughly twice the bandwidth of pageable memory.  We pack the rows
+        // with the stride of the device matrix so that one contiguous
+        // transfer suffices.
+        for (MatrixIndexT r = 0; r < num_rows_; r++) {
+          memcpy(staging + r * stride_, src.RowData(r), width);
+          if (dst_pitch != width)  // don't copy uninitialized bytes into the
+                                   // padding of the device matrix.
+            memset(reinterpret_cast<char*>(staging + r * stride_) + width, 0,
+                   dst_pitch - width);
+        }
+        CU_SAFE_CALL(cudaMemcpy(data_, staging, bytes, cudaMemcpyHostToDevice));
+        CuDevice::Instantiate().FreePinned(staging, bytes);
+      } else {
+        CU_SAFE_CALL(cudaMemcpy2D(data_, dst_pitch, src.Data(), src_pitch,
+                                  width, src.NumRows(), cudaMemcpyHostToDevice));
+      }
       CuDevice::Instantiate().AccuProfile("CuMatrixBase::CopyFromMat(from CPU)",tim.Elapsed());
     } else {
       CuMatrix<Real> trans_mat(src); // Do the transpose on the GPU board.
@@ -411,9 +437,21 @@ void CuMatrixBase<Real>::CopyToMat(MatrixBase<OtherReal> *dst,
       MatrixIndexT src_pitch = stride_*sizeof(Real);
       MatrixIndexT dst_pitch = dst->Stride()*sizeof(Real);
       MatrixIndexT width = NumCols()*sizeof(Real);
-      CU_SAFE_CALL(cudaMemcpy2D(dst->Data(), dst_pitch, this->data_, src_pitch,
-                                width, this->num_rows_, cudaMemcpyDeviceToHost));
-
+      size_t bytes = static_cast<size_t>(num_rows_) * src_pitch;
+      Real *staging = NULL;
+      if (bytes >= kMinBytesForPinnedTransfer)
+        staging = static_cast<Real*>(CuDevice::Instantiate().MallocPinned(bytes));
+      if (staging != NULL) {
+        // see the comment about pinned staging in CopyFromMat() above.
+        CU_SAFE_CALL(cudaMemcpy(staging, this->data_, bytes,
+                                cudaMemcpyDeviceToHost));
+        for (MatrixIndexT r = 0; r < num_rows_; r++)
+          memcpy(dst->RowData(r), staging + r * stride_, width);
+        CuDevice::Instantiate().FreePinned(staging, bytes);
+      } else {
+        CU_SAFE_CALL(cudaMemcpy2D(dst->Data(), dst_pitch, this->data_, src_pitch,
+                                  width, this->num_rows_, cudaMemcpyDeviceToHost));
+      }
       CuDevice::Instantiate().AccuProfile("CuMatrix::CopyToMatD2H",tim.Elapsed());
     }
   } else
@@ -1837,6 +1875,60 @@ void AddMatMatBatched(const double alpha, std::vector<CuSubMatrix<double>* > &C,
 		const std::vector<CuSubMatrix<double>* > &B, MatrixTransposeType transB,
 		const double beta);
 
+template<typename Real>
+bool RegisterMatrixAsPinned(MatrixBase<Real> *mat) {
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    // note: num-rows times stride is how much memory the Matrix allocated.
+    size_t bytes = static_cast<size_t>(mat->NumRows()) *
+        static_cast<size_t>(mat->Stride()) * sizeof(Real);
+    if (bytes == 0) return false;
+    return CuDevice::Instantiate().RegisterPinnedMemory(mat->Data(), bytes);
+  }
+#endif
+  return false;
+}
+
+template<typename Real>
+void UnregisterMatrixAsPinned(MatrixBase<Real> *mat) {
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled())
+    CuDevice::Instantiate().UnregisterPinnedMemory(mat->Data());
+#endif
+}
+
+template bool RegisterMatrixAsPinned(MatrixBase<float> *mat);
+template bool RegisterMatrixAsPinned(MatrixBase<double> *mat);
+template void UnregisterMatrixAsPinned(MatrixBase<float> *mat);
+template void UnregisterMatrixAsPinned(MatrixBase<double> *mat);
+
+template<typename Real>
+CuSubMatrix<Real> ViewAsCuMatrix(const MatrixBase<Real> &mat) {
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled())
+    KALDI_ERR << "ViewAsCuMatrix() called while a GPU is in use (a CuMatrix "
+              << "cannot alias host memory; copy instead).";
+#endif
+  return CuSubMatrix<Real>(mat.Data(), mat.NumRows(), mat.NumCols(),
+                           mat.Stride());
+}
+
+template<typename Real>
+SubMatrix<Real> ViewAsMatrix(const CuMatrixBase<Real> &mat) {
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled())
+    KALDI_ERR << "ViewAsMatrix() called while a GPU is in use (the CuMatrix's "
+              << "data is on the GPU; copy instead).";
+#endif
+  return SubMatrix<Real>(const_cast<Real*>(mat.Data()), mat.NumRows(),
+                         mat.NumCols(), mat.Stride());
+}
+
+template CuSubMatrix<float> ViewAsCuMatrix(const MatrixBase<float> &mat);
+template CuSubMatrix<double> ViewAsCuMatrix(const MatrixBase<double> &mat);
+template SubMatrix<float> ViewAsMatrix(const CuMatrixBase<float> &mat);
+template SubMatrix<double> ViewAsMatrix(const CuMatrixBase<double> &mat);
+
 template<typename Real>
 void CuMatrixBase<Real>::CopyRowsFromVec(const CuVectorBase<Real> &v) {
 #if HAVE_CUDA == 1
@@ -55,6 +55,21 @@ void AddMatMatBatched(const Real alpha, std::vector<CuSubMatrix<Real>* > &C,
 		const std::vector<CuSubMatrix<Real>* > &B, MatrixTransposeType transB,
 		const Real beta);
 
+/// Registers the memory underlying 'mat' as pinned (page-locked), so that
+/// host<->device copies involving it go at full DMA bandwidth and can overlap
+/// with GPU computation; useful for a Matrix that repeatedly streams features
+/// to the GPU.  The Matrix must own its storage (i.e. not be a SubMatrix into
+/// someone else's memory), and you must call UnregisterMatrixAsPinned()
+/// before it is resized or destroyed.  Returns true on success; returns
+/// false, doing nothing, if no GPU is in use or registration failed.
+template<typename Real>
+bool RegisterMatrixAsPinned(MatrixBase<Real> *mat);
+
+/// Reverses the effect of RegisterMatrixAsPinned(); only call this if that
+/// function returned true for this Matrix.
+template<typename Real>
+void UnregisterMatrixAsPinned(MatrixBase<Real> *mat);
+
 /**
  * Matrix for CUDA computing.
  * Does the computation on the CUDA card when CUDA is compiled in and
@@ -183,6 +198,11 @@ class CuMatrixBase {
                                  const CuSparseMatrix<Real> &B,
                                  MatrixTransposeType trans);
 
+  friend void TraceMatSmat<Real>(const CuMatrixBase<Real> &A,
+                                 const CuSparseMatrix<Real> &B,
+                                 MatrixTransposeType trans,
+                                 CuVectorBase<Real> *result);
+
   friend void AddMatMatBatched<Real>(const Real alpha, std::vector<CuSubMatrix<Real>* > &C,
 		const std::vector<CuSubMatrix<Real>* > &A, MatrixTransposeType transA,
 		const std::vector<CuSubMatrix<Real>* > &B, MatrixTransposeType transB,
@@ -732,6 +752,18 @@ class CuSubMatrix: public CuMatrixBase<Real> {
                      const MatrixIndexT col_offset,
                      const MatrixIndexT num_cols);
 
+  /// This constructor creates a view of external memory: it interprets
+  /// "data" as a matrix with the given dimensions and stride, without
+  /// copying and without taking ownership (the memory must stay valid for
+  /// the lifetime of the view).  If we are using a GPU, "data" must point to
+  /// memory on the GPU; otherwise to host memory.  See also ViewAsCuMatrix()
+  /// and ViewAsMatrix(), declared below, which use this to bridge between
+  /// Matrix and CuMatrix code without copies when no GPU is in use.
+  inline CuSubMatrix(const Real *data,
+                     const MatrixIndexT num_rows,
+                     const MatrixIndexT num_cols,
+                     const MatrixIndexT stride);
+
   /// This type of constructor is needed for Range() to work [in CuMatrix base
   /// class]. Cannot make it explicit or that breaks.
   inline CuSubMatrix<Real> (const CuSubMatrix &other):
@@ -766,6 +798,25 @@ bool SameDimAndStride(const CuMatrixBase<Real> &M, const CuMatrixBase<Real> &N)
           && M.Stride() == N.Stride());
 }
 
+/// Returns a CuSubMatrix that aliases the memory of "mat", without copying;
+/// this lets code written against the CuMatrix interface (e.g. the nnet
+/// components) consume a regular Matrix without double-buffering it, on
+/// machines with no GPU.  It is an error to call this when a GPU is in use,
+/// as the view would alias host memory.  Caution: as with SubMatrix, the
+/// view is only valid as long as "mat" is, and writing through it writes to
+/// "mat" (the constness of "mat" is cast away, as in the CuSubMatrix
+/// constructor).
+template<typename Real>
+CuSubMatrix<Real> ViewAsCuMatrix(const MatrixBase<Real> &mat);
+
+/// The reverse of ViewAsCuMatrix(): returns a SubMatrix that aliases the
+/// memory of "mat", without copying, so CPU code can consume the output of
+/// CuMatrix-based code directly.  It is an error to call this when a GPU is
+/// in use (in that case the data lives on the GPU and you need CopyToMat()).
+/// The same aliasing cautions apply.
+template<typename Real>
+SubMatrix<Real> ViewAsMatrix(const CuMatrixBase<Real> &mat);
+
 /// I/O
 template<typename Real>
 std::ostream &operator << (std::ostream &out, const CuMatrixBase<Real> &mat);
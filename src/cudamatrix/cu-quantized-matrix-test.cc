@@ -0,0 +1,181 @@
+// cudamatrix/cu-quantized-matrix-test.cc
+
+// Copyright 2014   Johns Hopkins University
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "cudamatrix/cu-matrix-lib.h"
+
+using namespace kaldi;
+
+namespace kaldi {
+
+static void UnitTestCuHalfMatrixRoundTrip() {
+  for (int32 i = 0; i < 10; i++) {
+    int32 rows = 1 + Rand() % 50, cols = 1 + Rand() % 50;
+    CuMatrix<BaseFloat> mat(rows, cols);
+    mat.SetRandn();
+    CuHalfMatrix half(mat);
+    CuMatrix<BaseFloat> mat2(rows, cols);
+    half.CopyToMat(&mat2);
+    Matrix<BaseFloat> h1(mat), h2(mat2);
+    for (int32 r = 0; r < rows; r++) {
+      for (int32 c = 0; c < cols; c++) {
+        // half precision has a 10-bit mantissa, so relative error is
+        // bounded by 2^-11 for values in the normal range.
+        BaseFloat tol = std::abs(h1(r, c)) * 5.0e-04 + 1.0e-06;
+        KALDI_ASSERT(std::abs(h1(r, c) - h2(r, c)) <= tol);
+      }
+    }
+  }
+}
+
+static void UnitTestCuInt8MatrixRoundTrip() {
+  for (int32 i = 0; i < 10; i++) {
+    int32 rows = 1 + Rand() % 50, cols = 1 + Rand() % 50;
+    CuMatrix<BaseFloat> mat(rows, cols);
+    mat.SetRandn();
+    mat.Scale(0.1 + 2.0 * RandUniform());  // vary the dynamic range.
+    CuInt8Matrix qmat(mat);
+    CuMatrix<BaseFloat> mat2(rows, cols);
+    qmat.CopyToMat(&mat2);
+    Matrix<BaseFloat> h1(mat), h2(mat2);
+    for (int32 r = 0; r < rows; r++) {
+      BaseFloat row_max = 0.0;
+      for (int32 c = 0; c < cols; c++)
+        row_max = std::max(row_max, std::abs(h1(r, c)));
+      // error is at most half a quantization step per element.
+      BaseFloat tol = 0.51 * row_max / 127.0 + 1.0e-06;
+      for (int32 c = 0; c < cols; c++)
+        KALDI_ASSERT(std::abs(h1(r, c) - h2(r, c)) <= tol);
+    }
+  }
+}
+
+static void UnitTestCuInt8MatrixIO() {
+  for (int32 i = 0; i < 6; i++) {
+    int32 rows = 1 + Rand() % 20, cols = 1 + Rand() % 20;
+    CuMatrix<BaseFloat> mat(rows, cols);
+    mat.SetRandn();
+    CuInt8Matrix qmat(mat);
+
+    std::ostringstream os;
+    bool binary = (i % 2 == 0);
+    qmat.Write(os, binary);
+
+    CuInt8Matrix qmat2;
+    std::istringstream is(os.str());
+    qmat2.Read(is, binary);
+
+    CuMatrix<BaseFloat> m1(rows, cols), m2(rows, cols);
+    qmat.CopyToMat(&m1);
+    qmat2.CopyToMat(&m2);
+    // text mode writes the row scales with limited precision, so don't
+    // expect an exact round trip there.
+    KALDI_ASSERT(m1.ApproxEqual(m2, binary ? 1.0e-06 : 1.0e-04));
+
+    // also exercise the copy constructor.
+    CuInt8Matrix qmat3(qmat);
+    qmat3.CopyToMat(&m2);
+    KALDI_ASSERT(m1.ApproxEqual(m2, 1.0e-06));
+  }
+}
+
+static void UnitTestAddMatMatHalf() {
+  for (int32 i = 0; i < 10; i++) {
+    MatrixTransposeType transB = (i % 2 == 0 ? kNoTrans : kTrans);
+    int32 n = 5 + Rand() % 20, o = 5 + Rand() % 20, d = 5 + Rand() % 20;
+    CuMatrix<BaseFloat> A(n, d), C(n, o), C2(n, o);
+    CuMatrix<BaseFloat> B_orig(transB == kTrans ? o : d,
+                               transB == kTrans ? d : o);
+    A.SetRandn();
+    B_orig.SetRandn();
+    C.SetRandn();
+    C2.CopyFromMat(C);
+
+    CuHalfMatrix B(B_orig);
+    AddMatMatHalf(0.5, A, kNoTrans, B, transB, 0.25, &C);
+
+    // reference: dequantize B and use the regular AddMatMat.
+    CuMatrix<BaseFloat> B_full(B.NumRows(), B.NumCols(), kUndefined);
+    B.CopyToMat(&B_full);
+    C2.AddMatMat(0.5, A, kNoTrans, B_full, transB, 0.25);
+    // loose tolerance: on GPU the activations also get rounded to fp16.
+    KALDI_ASSERT(C.ApproxEqual(C2, 0.01));
+  }
+}
+
+static void UnitTestAddMatMatQuantized() {
+  for (int32 i = 0; i < 10; i++) {
+    MatrixTransposeType transB = (i % 2 == 0 ? kNoTrans : kTrans);
+    int32 n = 5 + Rand() % 20, o = 5 + Rand() % 20, d = 5 + Rand() % 20;
+    CuMatrix<BaseFloat> A(n, d), C(n, o), C2(n, o);
+    CuMatrix<BaseFloat> B_orig(transB == kTrans ? o : d,
+                               transB == kTrans ? d : o);
+    A.SetRandn();
+    B_orig.SetRandn();
+    C.SetRandn();
+    C2.CopyFromMat(C);
+
+    CuInt8Matrix B(B_orig);
+    AddMatMatQuantized(0.5, A, kNoTrans, B, transB, 0.25, &C);
+
+    CuMatrix<BaseFloat> B_full(B.NumRows(), B.NumCols(), kUndefined);
+    B.CopyToMat(&B_full);
+    C2.AddMatMat(0.5, A, kNoTrans, B_full, transB, 0.25);
+    KALDI_ASSERT(C.ApproxEqual(C2, 1.0e-05));
+  }
+}
+
+static void CuQuantizedMatrixUnitTest() {
+  UnitTestCuHalfMatrixRoundTrip();
+  UnitTestCuInt8MatrixRoundTrip();
+  UnitTestCuInt8MatrixIO();
+  UnitTestAddMatMatHalf();
+  UnitTestAddMatMatQuantized();
+}
+
+}  // namespace kaldi
+
+
+int main() {
+  for (int32 loop = 0; loop < 2; loop++) {
+#if HAVE_CUDA == 1
+    if (loop == 0)
+      CuDevice::Instantiate().SelectGpuId("no"); // -1 means no GPU
+    else
+      CuDevice::Instantiate().SelectGpuId("yes"); // -2 .. automatic selection
+#endif
+
+    kaldi::CuQuantizedMatrixUnitTest();
+
+    if (loop == 0)
+      KALDI_LOG << "Tests without GPU use succeeded.";
+    else
+      KALDI_LOG << "Tests with GPU use (if available) succeeded.";
+  }
+#if HAVE_CUDA == 1
+  CuDevice::Instantiate().PrintProfile();
+#endif
+  return 0;
+}
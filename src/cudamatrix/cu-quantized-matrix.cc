@@ -0,0 +1,428 @@
+// cudamatrix/cu-quantized-matrix.cc
+
+// Copyright 2014   Johns Hopkins University
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#if HAVE_CUDA == 1
+#include <cuda_runtime_api.h>
+#include <cublas_v2.h>
+#endif
+
+#include "base/timer.h"
+#include "cudamatrix/cu-common.h"
+#include "cudamatrix/cu-quantized-matrix.h"
+#include "cudamatrix/cu-device.h"
+#include "cudamatrix/cu-kernels.h"
+#include "cudamatrix/cublas-wrappers.h"
+
+namespace kaldi {
+
+// Host-side conversion of a float to IEEE half-precision bits, rounding to
+// nearest even.  (The CUDA kernels have their own device-side copy of this
+// logic; see _float_to_half_bits in cu-kernels.cu.)
+static uint16 FloatToHalfBits(float f) {
+  union { float f; uint32 i; } u;
+  u.f = f;
+  uint32 bits = u.i;
+  uint16 sign = static_cast<uint16>((bits >> 16) & 0x8000);
+  int32 exp = static_cast<int32>((bits >> 23) & 0xff);
+  uint32 mant = bits & 0x7fffff;
+  if (exp == 0xff)  // infinity or NaN.
+    return sign | 0x7c00 | (mant != 0 ? 0x200 : 0);
+  exp += 15 - 127;
+  if (exp >= 31)  // overflow: round to infinity.
+    return sign | 0x7c00;
+  if (exp <= 0) {  // subnormal half (or underflow to zero).
+    if (exp < -10) return sign;
+    mant |= 0x800000;
+    int32 shift = 14 - exp;
+    uint16 h = static_cast<uint16>(mant >> shift);
+    uint32 rem = mant & ((1u << shift) - 1), halfway = 1u << (shift - 1);
+    if (rem > halfway || (rem == halfway && (h & 1))) h++;
+    return sign | h;
+  }
+  uint16 h = static_cast<uint16>(sign | (exp << 10) | (mant >> 13));
+  uint32 rem = mant & 0x1fff;
+  // Note: the increment can carry into the exponent; that yields the
+  // correctly rounded result (including rounding up to infinity).
+  if (rem > 0x1000 || (rem == 0x1000 && (h & 1))) h++;
+  return h;
+}
+
+static float HalfBitsToFloat(uint16 h) {
+  uint32 sign = static_cast<uint32>(h & 0x8000) << 16;
+  uint32 exp = (h >> 10) & 0x1f;
+  uint32 mant = h & 0x3ff;
+  uint32 bits;
+  if (exp == 0) {
+    if (mant == 0) {
+      bits = sign;  // +/- zero.
+    } else {  // subnormal half: renormalize.
+      exp = 127 - 15 + 1;
+      while ((mant & 0x400) == 0) { mant <<= 1; exp--; }
+      bits = sign | (exp << 23) | ((mant & 0x3ff) << 13);
+    }
+  } else if (exp == 31) {  // infinity or NaN.
+    bits = sign | 0x7f800000 | (mant << 13);
+  } else {
+    bits = sign | ((exp + 127 - 15) << 23) | (mant << 13);
+  }
+  union { float f; uint32 i; } u;
+  u.i = bits;
+  return u.f;
+}
+
+// Allocates "num_bytes" on the device (if enabled) or the host, in the
+// style of CuArray.
+static void *QuantizedAlloc(size_t num_bytes) {
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled())
+    return CuDevice::Instantiate().Malloc(num_bytes);
+#endif
+  void *ans = malloc(num_bytes);
+  if (ans == NULL)
+    KALDI_ERR << "Memory allocation failed, num bytes = " << num_bytes;
+  return ans;
+}
+
+static void QuantizedFree(void *ptr) {
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    CuDevice::Instantiate().Free(ptr);
+    return;
+  }
+#endif
+  free(ptr);
+}
+
+// Copies "num_bytes" from a host buffer to a (device or host) buffer
+// allocated with QuantizedAlloc, and the reverse.
+static void QuantizedCopyToDevice(void *dst, const void *src,
+                                  size_t num_bytes) {
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    CU_SAFE_CALL(cudaMemcpy(dst, src, num_bytes, cudaMemcpyHostToDevice));
+    return;
+  }
+#endif
+  memcpy(dst, src, num_bytes);
+}
+
+static void QuantizedCopyToHost(void *dst, const void *src,
+                                size_t num_bytes) {
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    CU_SAFE_CALL(cudaMemcpy(dst, src, num_bytes, cudaMemcpyDeviceToHost));
+    return;
+  }
+#endif
+  memcpy(dst, src, num_bytes);
+}
+
+void CuHalfMatrix::Destroy() {
+  if (data_ != NULL)
+    QuantizedFree(data_);
+  data_ = NULL;
+  num_rows_ = 0;
+  num_cols_ = 0;
+}
+
+CuHalfMatrix &CuHalfMatrix::operator = (const CuHalfMatrix &other) {
+  if (this == &other) return *this;
+  Destroy();
+  num_rows_ = other.num_rows_;
+  num_cols_ = other.num_cols_;
+  if (num_rows_ == 0) return *this;
+  size_t num_bytes = static_cast<size_t>(num_rows_) * num_cols_
+      * sizeof(uint16);
+  data_ = static_cast<uint16*>(QuantizedAlloc(num_bytes));
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    CU_SAFE_CALL(cudaMemcpy(data_, other.data_, num_bytes,
+                            cudaMemcpyDeviceToDevice));
+    return *this;
+  }
+#endif
+  memcpy(data_, other.data_, num_bytes);
+  return *this;
+}
+
+void CuHalfMatrix::CopyFromMat(const CuMatrixBase<BaseFloat> &mat) {
+  Destroy();
+  num_rows_ = mat.NumRows();
+  num_cols_ = mat.NumCols();
+  if (num_rows_ == 0) return;
+  data_ = static_cast<uint16*>(QuantizedAlloc(
+      static_cast<size_t>(num_rows_) * num_cols_ * sizeof(uint16)));
+#if HAVE_CUDA == 1 && (KALDI_DOUBLEPRECISION == 0)
+  if (CuDevice::Instantiate().Enabled()) {
+    Timer tim;
+    dim3 dimBlock(CU2DBLOCK, CU2DBLOCK);
+    dim3 dimGrid(n_blocks(num_cols_, CU2DBLOCK),
+                 n_blocks(num_rows_, CU2DBLOCK));
+    cuda_copy_from_mat_hf(dimGrid, dimBlock, data_, mat.Data(), mat.Dim(),
+                          num_cols_);
+    CU_SAFE_CALL(cudaGetLastError());
+    CuDevice::Instantiate().AccuProfile(__func__, tim.Elapsed());
+    return;
+  }
+#endif
+  {
+    // CPU conversion; with CUDA enabled but BaseFloat == double we also
+    // take this path, staging through host memory.
+    Matrix<BaseFloat> host(num_rows_, num_cols_, kUndefined);
+    mat.CopyToMat(&host);
+    std::vector<uint16> buf(static_cast<size_t>(num_rows_) * num_cols_);
+    for (MatrixIndexT r = 0; r < num_rows_; r++)
+      for (MatrixIndexT c = 0; c < num_cols_; c++)
+        buf[r * num_cols_ + c] = FloatToHalfBits(host(r, c));
+    QuantizedCopyToDevice(data_, &buf[0], buf.size() * sizeof(uint16));
+  }
+}
+
+void CuHalfMatrix::CopyToMat(CuMatrixBase<BaseFloat> *mat) const {
+  KALDI_ASSERT(mat->NumRows() == num_rows_ && mat->NumCols() == num_cols_);
+  if (num_rows_ == 0) return;
+#if HAVE_CUDA == 1 && (KALDI_DOUBLEPRECISION == 0)
+  if (CuDevice::Instantiate().Enabled()) {
+    Timer tim;
+    dim3 dimBlock(CU2DBLOCK, CU2DBLOCK);
+    dim3 dimGrid(n_blocks(num_cols_, CU2DBLOCK),
+                 n_blocks(num_rows_, CU2DBLOCK));
+    cuda_copy_from_mat_fh(dimGrid, dimBlock, mat->Data(), data_, mat->Dim(),
+                          num_cols_);
+    CU_SAFE_CALL(cudaGetLastError());
+    CuDevice::Instantiate().AccuProfile(__func__, tim.Elapsed());
+    return;
+  }
+#endif
+  {
+    std::vector<uint16> buf(static_cast<size_t>(num_rows_) * num_cols_);
+    QuantizedCopyToHost(&buf[0], data_, buf.size() * sizeof(uint16));
+    Matrix<BaseFloat> host(num_rows_, num_cols_, kUndefined);
+    for (MatrixIndexT r = 0; r < num_rows_; r++)
+      for (MatrixIndexT c = 0; c < num_cols_; c++)
+        host(r, c) = HalfBitsToFloat(buf[r * num_cols_ + c]);
+    mat->CopyFromMat(host);
+  }
+}
+
+void CuInt8Matrix::Destroy() {
+  if (data_ != NULL)
+    QuantizedFree(data_);
+  data_ = NULL;
+  num_rows_ = 0;
+  num_cols_ = 0;
+  row_scales_.Resize(0);
+}
+
+CuInt8Matrix &CuInt8Matrix::operator = (const CuInt8Matrix &other) {
+  if (this == &other) return *this;
+  Destroy();
+  num_rows_ = other.num_rows_;
+  num_cols_ = other.num_cols_;
+  row_scales_ = other.row_scales_;
+  if (num_rows_ == 0) return *this;
+  size_t num_bytes = static_cast<size_t>(num_rows_) * num_cols_;
+  data_ = static_cast<int8*>(QuantizedAlloc(num_bytes));
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    CU_SAFE_CALL(cudaMemcpy(data_, other.data_, num_bytes,
+                            cudaMemcpyDeviceToDevice));
+    return *this;
+  }
+#endif
+  memcpy(data_, other.data_, num_bytes);
+  return *this;
+}
+
+void CuInt8Matrix::CopyFromMat(const CuMatrixBase<BaseFloat> &mat) {
+  Destroy();
+  num_rows_ = mat.NumRows();
+  num_cols_ = mat.NumCols();
+  if (num_rows_ == 0) return;
+  // Quantization happens once, at model-loading time, so we always stage
+  // through host memory rather than adding a kernel for it.
+  Matrix<BaseFloat> host(num_rows_, num_cols_, kUndefined);
+  mat.CopyToMat(&host);
+  Vector<BaseFloat> scales(num_rows_);
+  std::vector<int8> buf(static_cast<size_t>(num_rows_) * num_cols_);
+  for (MatrixIndexT r = 0; r < num_rows_; r++) {
+    BaseFloat max_abs = 0.0;
+    for (MatrixIndexT c = 0; c < num_cols_; c++)
+      max_abs = std::max(max_abs, std::abs(host(r, c)));
+    BaseFloat scale = (max_abs != 0.0 ? max_abs / 127.0 : 1.0);
+    scales(r) = scale;
+    for (MatrixIndexT c = 0; c < num_cols_; c++) {
+      int32 q = static_cast<int32>(floor(host(r, c) / scale + 0.5));
+      if (q > 127) q = 127;
+      if (q < -127) q = -127;
+      buf[r * num_cols_ + c] = static_cast<int8>(q);
+    }
+  }
+  row_scales_.Resize(num_rows_, kUndefined);
+  row_scales_.CopyFromVec(scales);
+  data_ = static_cast<int8*>(QuantizedAlloc(buf.size()));
+  QuantizedCopyToDevice(data_, &buf[0], buf.size());
+}
+
+void CuInt8Matrix::CopyToMat(CuMatrixBase<BaseFloat> *mat) const {
+  KALDI_ASSERT(mat->NumRows() == num_rows_ && mat->NumCols() == num_cols_);
+  if (num_rows_ == 0) return;
+#if HAVE_CUDA == 1 && (KALDI_DOUBLEPRECISION == 0)
+  if (CuDevice::Instantiate().Enabled()) {
+    Timer tim;
+    dim3 dimBlock(CU2DBLOCK, CU2DBLOCK);
+    dim3 dimGrid(n_blocks(num_cols_, CU2DBLOCK),
+                 n_blocks(num_rows_, CU2DBLOCK));
+    cuda_copy_from_mat_fq(dimGrid, dimBlock, mat->Data(), data_,
+                          row_scales_.Data(), mat->Dim(), num_cols_);
+    CU_SAFE_CALL(cudaGetLastError());
+    CuDevice::Instantiate().AccuProfile(__func__, tim.Elapsed());
+    return;
+  }
+#endif
+  {
+    std::vector<int8> buf(static_cast<size_t>(num_rows_) * num_cols_);
+    QuantizedCopyToHost(&buf[0], data_, buf.size());
+    Vector<BaseFloat> scales(num_rows_, kUndefined);
+    row_scales_.CopyToVec(&scales);
+    Matrix<BaseFloat> host(num_rows_, num_cols_, kUndefined);
+    for (MatrixIndexT r = 0; r < num_rows_; r++)
+      for (MatrixIndexT c = 0; c < num_cols_; c++)
+        host(r, c) = scales(r) * static_cast<BaseFloat>(buf[r * num_cols_ + c]);
+    mat->CopyFromMat(host);
+  }
+}
+
+void CuInt8Matrix::Write(std::ostream &os, bool binary) const {
+  WriteToken(os, binary, "<CuInt8Matrix>");
+  WriteToken(os, binary, "<NumRows>");
+  WriteBasicType(os, binary, static_cast<int32>(num_rows_));
+  WriteToken(os, binary, "<NumCols>");
+  WriteBasicType(os, binary, static_cast<int32>(num_cols_));
+  WriteToken(os, binary, "<RowScales>");
+  Vector<BaseFloat> scales(num_rows_, kUndefined);
+  if (num_rows_ != 0) row_scales_.CopyToVec(&scales);
+  scales.Write(os, binary);
+  WriteToken(os, binary, "<Data>");
+  std::vector<int8> buf(static_cast<size_t>(num_rows_) * num_cols_);
+  if (!buf.empty())
+    QuantizedCopyToHost(&buf[0], data_, buf.size());
+  if (binary) {
+    if (!buf.empty())
+      os.write(reinterpret_cast<const char*>(&buf[0]), buf.size());
+  } else {
+    for (size_t i = 0; i < buf.size(); i++)
+      WriteBasicType(os, binary, static_cast<int32>(buf[i]));
+    os << "\n";
+  }
+  WriteToken(os, binary, "</CuInt8Matrix>");
+  if (!os.good())
+    KALDI_ERR << "Error writing CuInt8Matrix to stream";
+}
+
+void CuInt8Matrix::Read(std::istream &is, bool binary) {
+  Destroy();
+  ExpectToken(is, binary, "<CuInt8Matrix>");
+  int32 num_rows, num_cols;
+  ExpectToken(is, binary, "<NumRows>");
+  ReadBasicType(is, binary, &num_rows);
+  ExpectToken(is, binary, "<NumCols>");
+  ReadBasicType(is, binary, &num_cols);
+  ExpectToken(is, binary, "<RowScales>");
+  Vector<BaseFloat> scales;
+  scales.Read(is, binary);
+  KALDI_ASSERT(scales.Dim() == num_rows);
+  ExpectToken(is, binary, "<Data>");
+  std::vector<int8> buf(static_cast<size_t>(num_rows) * num_cols);
+  if (binary) {
+    if (!buf.empty())
+      is.read(reinterpret_cast<char*>(&buf[0]), buf.size());
+  } else {
+    for (size_t i = 0; i < buf.size(); i++) {
+      int32 q;
+      ReadBasicType(is, binary, &q);
+      buf[i] = static_cast<int8>(q);
+    }
+  }
+  if (is.fail())
+    KALDI_ERR << "Error reading CuInt8Matrix from stream";
+  ExpectToken(is, binary, "</CuInt8Matrix>");
+  num_rows_ = num_rows;
+  num_cols_ = num_cols;
+  row_scales_.Resize(num_rows, kUndefined);
+  row_scales_.CopyFromVec(scales);
+  if (!buf.empty()) {
+    data_ = static_cast<int8*>(QuantizedAlloc(buf.size()));
+    QuantizedCopyToDevice(data_, &buf[0], buf.size());
+  }
+}
+
+void AddMatMatHalf(BaseFloat alpha,
+                   const CuMatrixBase<BaseFloat> &A,
+                   MatrixTransposeType transA,
+                   const CuHalfMatrix &B,
+                   MatrixTransposeType transB,
+                   BaseFloat beta,
+                   CuMatrixBase<BaseFloat> *C) {
+  // Dimension mapping as in CuMatrixBase::AddMatMat (CUBLAS is col-major,
+  // so keep the trans flags and swap the operands).
+  MatrixIndexT m = ((transB == kTrans) ? B.NumRows() : B.NumCols());
+  MatrixIndexT n = ((transA == kTrans) ? A.NumCols() : A.NumRows());
+  MatrixIndexT k = ((transB == kTrans) ? B.NumCols() : B.NumRows());
+  MatrixIndexT k1 = ((transA == kTrans) ? A.NumRows() : A.NumCols());
+  KALDI_ASSERT(m == C->NumCols() && n == C->NumRows() && k == k1);
+  if (m == 0) return;
+
+#if HAVE_CUDA == 1 && CUDA_VERSION >= 8000 && (KALDI_DOUBLEPRECISION == 0)
+  if (CuDevice::Instantiate().Enabled()) {
+    Timer tim;
+    // cublasSgemmEx wants both input operands in the same precision, so
+    // convert the activations to fp16 too; accumulation and C are fp32.
+    CuHalfMatrix A_half(A);
+    CU_SAFE_CALL(cublas_gemm_fp16(GetCublasHandle(),
+                                  (transB == kTrans ? CUBLAS_OP_T : CUBLAS_OP_N),
+                                  (transA == kTrans ? CUBLAS_OP_T : CUBLAS_OP_N),
+                                  m, n, k, alpha, B.Data(), B.Stride(),
+                                  A_half.Data(), A_half.Stride(), beta,
+                                  C->Data(), C->Stride()));
+    CuDevice::Instantiate().AccuProfile(__func__, tim.Elapsed());
+    return;
+  }
+#endif
+  {
+    CuMatrix<BaseFloat> B_full(B.NumRows(), B.NumCols(), kUndefined);
+    B.CopyToMat(&B_full);
+    C->AddMatMat(alpha, A, transA, B_full, transB, beta);
+  }
+}
+
+void AddMatMatQuantized(BaseFloat alpha,
+                        const CuMatrixBase<BaseFloat> &A,
+                        MatrixTransposeType transA,
+                        const CuInt8Matrix &B,
+                        MatrixTransposeType transB,
+                        BaseFloat beta,
+                        CuMatrixBase<BaseFloat> *C) {
+  if (C->NumRows() == 0 || C->NumCols() == 0) return;
+  CuMatrix<BaseFloat> B_full(B.NumRows(), B.NumCols(), kUndefined);
+  B.CopyToMat(&B_full);
+  C->AddMatMat(alpha, A, transA, B_full, transB, beta);
+}
+
+}  // namespace kaldi
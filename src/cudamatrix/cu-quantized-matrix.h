@@ -0,0 +1,156 @@
+// cudamatrix/cu-quantized-matrix.h
+
+// Copyright 2014   Johns Hopkins University
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_CUDAMATRIX_CU_QUANTIZED_MATRIX_H_
+#define KALDI_CUDAMATRIX_CU_QUANTIZED_MATRIX_H_
+
+#include "cudamatrix/cu-matrix.h"
+#include "cudamatrix/cu-vector.h"
+
+namespace kaldi {
+
+// This file declares reduced-precision storage formats for matrices that
+// live on the GPU (or, without a GPU, in CPU memory): IEEE fp16 and 8-bit
+// linearly quantized.  They are intended for the *weights* of neural nets
+// at inference time, where memory bandwidth for the parameter matrices is
+// the bottleneck; activations stay in BaseFloat.  Neither class supports
+// general matrix operations: you get them by converting from a
+// CuMatrixBase, and use them via CopyToMat() or the AddMatMatHalf() /
+// AddMatMatQuantized() functions below.
+
+/// Matrix stored in IEEE half precision (one uint16 per element).  The
+/// data is not padded (Stride() == NumCols()).
+class CuHalfMatrix {
+ public:
+  CuHalfMatrix(): data_(NULL), num_rows_(0), num_cols_(0) { }
+
+  explicit CuHalfMatrix(const CuMatrixBase<BaseFloat> &mat):
+      data_(NULL), num_rows_(0), num_cols_(0) { CopyFromMat(mat); }
+
+  CuHalfMatrix(const CuHalfMatrix &other):
+      data_(NULL), num_rows_(0), num_cols_(0) { *this = other; }
+
+  CuHalfMatrix &operator = (const CuHalfMatrix &other);
+
+  ~CuHalfMatrix() { Destroy(); }
+
+  MatrixIndexT NumRows() const { return num_rows_; }
+  MatrixIndexT NumCols() const { return num_cols_; }
+  MatrixIndexT Stride() const { return num_cols_; }
+
+  /// Sets *this to a half-precision copy of "mat" (round to nearest even).
+  void CopyFromMat(const CuMatrixBase<BaseFloat> &mat);
+
+  /// Converts back to BaseFloat; "mat" must already have the right size.
+  void CopyToMat(CuMatrixBase<BaseFloat> *mat) const;
+
+  const uint16 *Data() const { return data_; }
+
+ private:
+  void Destroy();
+
+  friend void AddMatMatHalf(BaseFloat alpha,
+                            const CuMatrixBase<BaseFloat> &A,
+                            MatrixTransposeType transA,
+                            const CuHalfMatrix &B,
+                            MatrixTransposeType transB,
+                            BaseFloat beta,
+                            CuMatrixBase<BaseFloat> *C);
+
+  uint16 *data_;  // device pointer if compiled with CUDA and the device is
+                  // enabled; otherwise a host pointer.
+  MatrixIndexT num_rows_;
+  MatrixIndexT num_cols_;
+};
+
+/// Matrix stored as 8-bit signed integers with one BaseFloat scale per row,
+/// i.e. element (r, c) represents row_scales(r) * data(r, c) with data in
+/// [-127, 127].  The row scales are chosen so that quantization error is
+/// relative to each row's largest element, which suits weight matrices
+/// whose rows (output neurons) can differ a lot in dynamic range.  The
+/// data is not padded (Stride() == NumCols()).
+class CuInt8Matrix {
+ public:
+  CuInt8Matrix(): data_(NULL), num_rows_(0), num_cols_(0) { }
+
+  explicit CuInt8Matrix(const CuMatrixBase<BaseFloat> &mat):
+      data_(NULL), num_rows_(0), num_cols_(0) { CopyFromMat(mat); }
+
+  CuInt8Matrix(const CuInt8Matrix &other):
+      data_(NULL), num_rows_(0), num_cols_(0) { *this = other; }
+
+  CuInt8Matrix &operator = (const CuInt8Matrix &other);
+
+  ~CuInt8Matrix() { Destroy(); }
+
+  MatrixIndexT NumRows() const { return num_rows_; }
+  MatrixIndexT NumCols() const { return num_cols_; }
+  MatrixIndexT Stride() const { return num_cols_; }
+
+  /// Quantizes "mat" into *this.  This is intended to be done once, at
+  /// model-loading time, so it stages through CPU memory even on GPU.
+  void CopyFromMat(const CuMatrixBase<BaseFloat> &mat);
+
+  /// Dequantizes into "mat", which must already have the right size.
+  void CopyToMat(CuMatrixBase<BaseFloat> *mat) const;
+
+  void Read(std::istream &is, bool binary);
+  void Write(std::ostream &os, bool binary) const;
+
+  const int8 *Data() const { return data_; }
+  const CuVector<BaseFloat> &RowScales() const { return row_scales_; }
+
+ private:
+  void Destroy();
+
+  int8 *data_;  // device pointer if compiled with CUDA and the device is
+                // enabled; otherwise a host pointer.
+  MatrixIndexT num_rows_;
+  MatrixIndexT num_cols_;
+  CuVector<BaseFloat> row_scales_;  // of dimension num_rows_.
+};
+
+/// Does C = alpha * op(A) * op(B) + beta * C, where B is stored in half
+/// precision; equivalent to dequantizing B and calling C->AddMatMat().  On
+/// GPUs with native fp16 arithmetic (CUDA 8.0 or later) this converts the
+/// activations A to fp16 internally and uses cublasSgemmEx, accumulating
+/// in fp32; otherwise it falls back to dequantizing B.
+void AddMatMatHalf(BaseFloat alpha,
+                   const CuMatrixBase<BaseFloat> &A,
+                   MatrixTransposeType transA,
+                   const CuHalfMatrix &B,
+                   MatrixTransposeType transB,
+                   BaseFloat beta,
+                   CuMatrixBase<BaseFloat> *C);
+
+/// Does C = alpha * op(A) * op(B) + beta * C, where B is stored in int8
+/// quantized form; B is dequantized into a temporary and the product is
+/// done in BaseFloat, so the saving is in storage and weight-matrix
+/// memory bandwidth, not arithmetic.
+void AddMatMatQuantized(BaseFloat alpha,
+                        const CuMatrixBase<BaseFloat> &A,
+                        MatrixTransposeType transA,
+                        const CuInt8Matrix &B,
+                        MatrixTransposeType transB,
+                        BaseFloat beta,
+                        CuMatrixBase<BaseFloat> *C);
+
+}  // namespace kaldi
+
+#endif  // KALDI_CUDAMATRIX_CU_QUANTIZED_MATRIX_H_
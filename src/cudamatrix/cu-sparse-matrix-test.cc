@@ -57,6 +57,12 @@ static void UnitTestCuSparseMatrixTraceMatSmat() {
     trace1 = TraceMatMat(mat3, mat2, kNoTrans);
     trace2 = TraceMatSmat(mat3, cu_smat2, kNoTrans);
     AssertEqual(trace1, trace2, 0.00001);
+
+    // the device-resident version, which leaves the result on the GPU.
+    CuVector<Real> result(1);
+    TraceMatSmat(mat3, cu_smat1, kTrans, &result);
+    Vector<Real> result_cpu(result);
+    AssertEqual(TraceMatSmat(mat3, cu_smat1, kTrans), result_cpu(0), 0.00001);
   }
 }
 
@@ -323,6 +323,63 @@ double TraceMatSmat(const CuMatrixBase<double> &A,
                     const CuSparseMatrix<double> &B,
                     MatrixTransposeType trans);
 
+template <typename Real>
+void TraceMatSmat(const CuMatrixBase<Real> &A,
+                  const CuSparseMatrix<Real> &B,
+                  MatrixTransposeType trans,
+                  CuVectorBase<Real> *result) {
+  KALDI_ASSERT(result->Dim() == 1);
+  if (A.NumCols() == 0 || B.NumElements() == 0) {
+    if (A.NumCols() == 0)
+      KALDI_ASSERT(B.NumCols() == 0);
+    result->SetZero();
+    return;
+  }
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    if (trans == kTrans) {
+      KALDI_ASSERT(A.NumRows() == B.NumRows() && A.NumCols() == B.NumCols());
+    } else {
+      KALDI_ASSERT(A.NumCols() == B.NumRows() && A.NumRows() == B.NumCols());
+    }
+    CuVector<Real> sum_vec(B.NumElements());
+    Timer tim;
+    dim3 dimBlock(CU1DBLOCK, 1);
+    dim3 dimGrid(n_blocks(B.NumElements(), CU1DBLOCK), 1);
+    if (trans == kNoTrans) {
+      cuda_trace_mat_smat(dimGrid, dimBlock, A.Data(), B.Data(),
+                          A.Dim(), B.NumElements(), sum_vec.Data());
+    } else {
+      cuda_trace_mat_smat_trans(dimGrid, dimBlock, A.Data(), B.Data(),
+                                A.Dim(), B.NumElements(), sum_vec.Data());
+    }
+    // reduce the partial products into (*result)(0), staying on the device
+    // (this is how this version differs from the one above: no
+    // device-to-host transfer happens here).
+    cuda_vec_sum(1, CU1DBLOCK, sum_vec.Data(), result->Data(),
+                 sum_vec.Dim(), 1);
+    CU_SAFE_CALL(cudaGetLastError());
+    CuDevice::Instantiate().AccuProfile(__func__, tim.Elapsed());
+  } else
+#endif
+  {
+    Vector<Real> tmp(1, kUndefined);
+    tmp(0) = TraceMatSmat(A.Mat(), B.Mat(), trans);
+    result->CopyFromVec(tmp);
+  }
+}
+
+template
+void TraceMatSmat(const CuMatrixBase<float> &A,
+                  const CuSparseMatrix<float> &B,
+                  MatrixTransposeType trans,
+                  CuVectorBase<float> *result);
+template
+void TraceMatSmat(const CuMatrixBase<double> &A,
+                  const CuSparseMatrix<double> &B,
+                  MatrixTransposeType trans,
+                  CuVectorBase<double> *result);
+
 void GeneralMatrix::CopyToMat(CuMatrixBase<BaseFloat> *cu_mat,
                               MatrixTransposeType trans) const {
 #if HAVE_CUDA == 1
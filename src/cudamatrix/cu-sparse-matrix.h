@@ -43,6 +43,17 @@ Real TraceMatSmat(const CuMatrixBase<Real> &A,
                   const CuSparseMatrix<Real> &B,
                   MatrixTransposeType trans = kNoTrans);
 
+/// Version of TraceMatSmat above that writes the result to element 0 of
+/// "result" (which must have dimension 1) and keeps it on the device, so
+/// the caller can accumulate traces over many calls (e.g. per-minibatch
+/// objectives during diagnostics) and read the total back just once,
+/// instead of syncing with the GPU for each scalar.
+template <typename Real>
+void TraceMatSmat(const CuMatrixBase<Real> &A,
+                  const CuSparseMatrix<Real> &B,
+                  MatrixTransposeType trans,
+                  CuVectorBase<Real> *result);
+
 template <class Real>
 class CuSparseMatrix {
  public:
@@ -57,6 +68,11 @@ class CuSparseMatrix {
                                  const CuSparseMatrix<Real> &B,
                                  MatrixTransposeType trans);
 
+  friend void TraceMatSmat<Real>(const CuMatrixBase<Real> &A,
+                                 const CuSparseMatrix<Real> &B,
+                                 MatrixTransposeType trans,
+                                 CuVectorBase<Real> *result);
+
   MatrixIndexT NumRows() const { return num_rows_; }
 
   MatrixIndexT NumCols() const { return num_cols_; }
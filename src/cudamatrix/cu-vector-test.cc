@@ -438,6 +438,40 @@ template<typename Real> void CuVectorUnitTestMax() {
 }
 
 
+template<typename Real> void CuVectorUnitTestComputeStats() {
+  for (int32 p = 0; p < 5; p++) {
+    int32 dim = 100 + Rand() % 500;
+    CuVector<Real> cu_vector(dim);
+    cu_vector.SetRandn();
+    Vector<Real> vector(cu_vector);
+    CuVectorStats<Real> stats;
+    cu_vector.ComputeStats(&stats);
+    AssertEqual(stats.sum, vector.Sum());
+    KALDI_ASSERT(stats.min == vector.Min());
+    KALDI_ASSERT(stats.max == vector.Max());
+    AssertEqual(stats.sumsq, VecVec(vector, vector));
+  }
+  {  // the empty vector.
+    CuVector<Real> cu_vector;
+    CuVectorStats<Real> stats;
+    cu_vector.ComputeStats(&stats);
+    KALDI_ASSERT(stats.sum == 0.0 && stats.sumsq == 0.0 &&
+                 stats.min == std::numeric_limits<Real>::infinity() &&
+                 stats.max == -std::numeric_limits<Real>::infinity());
+  }
+  {  // the future interface: launch several, then read them all back.
+    CuVector<Real> v1(200), v2(300);
+    v1.SetRandn();
+    v2.SetRandn();
+    CuVectorStatsFuture<Real> f1(v1), f2(v2);
+    AssertEqual(f1.Value().sum, v1.Sum());
+    AssertEqual(f2.Value().sum, v2.Sum());
+    KALDI_ASSERT(f1.Value().min == v1.Min());  // Value() may be re-called.
+    KALDI_ASSERT(f2.Value().max == v2.Max());
+  }
+}
+
+
 template<typename Real> void CuVectorUnitTestApplySoftMax() {
   for (int32 i = 0; i < 10; i++) {
     int32 dim = 100 + Rand() % 300;
@@ -704,6 +738,7 @@ template<typename Real> void CuVectorUnitTest() {
   CuVectorUnitTestCopyFromMat<Real>();
   CuVectorUnitTestMin<Real>();
   CuVectorUnitTestMax<Real>();
+  CuVectorUnitTestComputeStats<Real>();
   CuVectorUnitTestApplySoftMax<Real>();
   CuVectorUnitTestCopyDiagFromPacked<Real>();
   CuVectorUnitTestCopyDiagFromMat<Real>();
@@ -675,6 +675,82 @@ Real CuVectorBase<Real>::Max() const {
   return result;
 }
 
+template<typename Real>
+void CuVectorBase<Real>::ComputeStats(CuVectorStats<Real> *stats) const {
+  *stats = CuVectorStats<Real>();  // the values for the empty vector.
+  if (dim_ == 0) return;
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    Timer tim;
+    CuVector<Real> buf(4, kUndefined);
+    cuda_vec_stats(data_, buf.Data(), dim_);
+    CU_SAFE_CALL(cudaGetLastError());
+    Vector<Real> host(4, kUndefined);
+    buf.CopyToVec(&host);
+    stats->sum = host(0);
+    stats->min = host(1);
+    stats->max = host(2);
+    stats->sumsq = host(3);
+    CuDevice::Instantiate().AccuProfile(__func__, tim.Elapsed());
+  } else
+#endif
+  {
+    // a single pass, unlike calling Sum(), Min(), Max() separately.
+    double sum = 0.0, sumsq = 0.0;
+    Real min = data_[0], max = data_[0];
+    for (MatrixIndexT i = 0; i < dim_; i++) {
+      Real d = data_[i];
+      sum += d;
+      sumsq += static_cast<double>(d) * d;
+      if (d < min) min = d;
+      if (d > max) max = d;
+    }
+    stats->sum = sum;
+    stats->min = min;
+    stats->max = max;
+    stats->sumsq = sumsq;
+  }
+}
+
+template<typename Real>
+CuVectorStatsFuture<Real>::CuVectorStatsFuture(const CuVectorBase<Real> &vec):
+    computed_(false) {
+#if HAVE_CUDA == 1
+  if (CuDevice::Instantiate().Enabled()) {
+    if (vec.Dim() == 0) {
+      computed_ = true;  // stats_ already has the empty-vector values.
+    } else {
+      buf_.Resize(4, kUndefined);
+      cuda_vec_stats(vec.Data(), buf_.Data(), vec.Dim());
+      CU_SAFE_CALL(cudaGetLastError());
+      // note: we do not wait for the kernel or read the result here; that
+      // happens in Value().
+    }
+    return;
+  }
+#endif
+  vec.ComputeStats(&stats_);
+  computed_ = true;
+}
+
+template<typename Real>
+const CuVectorStats<Real>& CuVectorStatsFuture<Real>::Value() {
+  if (!computed_) {
+    Vector<Real> host(4, kUndefined);
+    buf_.CopyToVec(&host);  // this syncs with the device.
+    stats_.sum = host(0);
+    stats_.min = host(1);
+    stats_.max = host(2);
+    stats_.sumsq = host(3);
+    buf_.Resize(0);
+    computed_ = true;
+  }
+  return stats_;
+}
+
+template class CuVectorStatsFuture<float>;
+template class CuVectorStatsFuture<double>;
+
 template<typename Real> 
 void CuVectorBase<Real>::ReplaceValue(Real orig, Real changed) {
 #if HAVE_CUDA == 1 
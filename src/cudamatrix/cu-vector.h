@@ -35,6 +35,22 @@ namespace kaldi {
 
 template<typename Real> class CuMatrixBase;
 
+/// Element statistics of a vector, as computed in one pass by
+/// CuVectorBase::ComputeStats() and CuVectorStatsFuture; the default
+/// constructor gives the values for the empty vector.
+template<typename Real>
+struct CuVectorStats {
+  Real sum;
+  Real min;  ///< +infinity for the empty vector.
+  Real max;  ///< -infinity for the empty vector.
+  Real sumsq;  ///< sum of squared elements.
+
+  CuVectorStats(): sum(0.0),
+                   min(std::numeric_limits<Real>::infinity()),
+                   max(-std::numeric_limits<Real>::infinity()),
+                   sumsq(0.0) { }
+};
+
 template<typename Real>
 Real VecVec(const CuVectorBase<Real> &v1, const CuVectorBase<Real> &v2);
 
@@ -189,9 +205,17 @@ class CuVectorBase {
   /// Returns the maximum value of any element, or -infinity for the empty vector.  
   Real Max() const;
 
-  /// Returns the minimum value of any element, or +infinity for the empty vector.  
+  /// Returns the minimum value of any element, or +infinity for the empty vector.
   Real Min() const;
-  
+
+  /// Computes sum, min, max and sum-of-squares in a single pass (on GPU, a
+  /// single kernel launch and a single device-to-host transfer, where
+  /// calling Sum(), Min() and Max() separately would sync with the device
+  /// three times).  Prefer this when diagnostics need more than one
+  /// statistic of the same vector; see also class CuVectorStatsFuture,
+  /// which additionally lets you delay the device-to-host read.
+  void ComputeStats(CuVectorStats<Real> *stats) const;
+
   // Set each element to y = (x == orig ? changed : x).
   void ReplaceValue(Real orig, Real changed);
   
@@ -328,6 +352,37 @@ class CuSubVector: public CuVectorBase<Real> {
 
 };
 
+/// A "future" for the statistics of a vector: the constructor launches the
+/// fused stats kernel (see CuVectorBase::ComputeStats()) but does not wait
+/// for it or read the result back; the first call to Value() does the
+/// device-to-host read, which syncs with the device.  This lets callers who
+/// want statistics of several vectors (e.g. per-component diagnostics once
+/// per minibatch) queue all the kernels first and then pay for only one
+/// pipeline stall, instead of one sync per scalar:
+/// \code
+///   CuVectorStatsFuture<BaseFloat> f1(v1), f2(v2);  // launches kernels.
+///   ... f1.Value().sum ... f2.Value().max ...  // one stall, at f1.Value().
+/// \endcode
+/// The vector must not be modified or destroyed before Value() is first
+/// called.  Without a GPU the stats are simply computed in the constructor.
+template<typename Real>
+class CuVectorStatsFuture {
+ public:
+  explicit CuVectorStatsFuture(const CuVectorBase<Real> &vec);
+
+  /// Waits for the result if it is not ready yet; may be called more than
+  /// once.
+  const CuVectorStats<Real> &Value();
+
+ private:
+  CuVector<Real> buf_;  ///< 4-element device buffer the kernel wrote to;
+                        ///< empty if stats_ is already valid.
+  CuVectorStats<Real> stats_;
+  bool computed_;  ///< true if stats_ is valid.
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(CuVectorStatsFuture);
+};
+
 /// I/O
 template<typename Real>
 std::ostream &operator << (std::ostream &out, const CuVectorBase<Real> &vec);
@@ -49,6 +49,19 @@ inline cublasStatus_t cublas_gemmBatched(cublasHandle_t handle, cublasOperation_
 		double *C[], int ldc, int batchCount) {
   return cublasDgemmBatched(handle, transa, transb, m, n, k, &alpha, A, lda, B, ldb, &beta, C, ldc, batchCount); 
 }
+#if CUDA_VERSION >= 8000
+// Gemm on half-precision inputs with fp32 accumulation and output, used by
+// AddMatMatHalf() in cu-quantized-matrix.cc.  We require toolkit 8.0 for
+// the CUDA_R_16F etc. constants (7.5 spelled them differently).
+inline cublasStatus_t cublas_gemm_fp16(cublasHandle_t handle, cublasOperation_t transa,
+		cublasOperation_t transb, int m, int n, int k, float alpha,
+		const uint16 *A, int lda, const uint16 *B, int ldb, float beta,
+		float *C, int ldc) {
+  return cublasSgemmEx(handle, transa, transb, m, n, k, &alpha,
+                       A, CUDA_R_16F, lda, B, CUDA_R_16F, ldb, &beta,
+                       C, CUDA_R_32F, ldc);
+}
+#endif
 inline cublasStatus_t cublas_trsm(cublasHandle_t handle, int m, int n, float alpha,
 	       	const float* A, int lda, float* B, int ldb) {
   return cublasStrsm_v2(handle,CUBLAS_SIDE_LEFT,CUBLAS_FILL_MODE_UPPER,CUBLAS_OP_N,CUBLAS_DIAG_NON_UNIT,m,n,&alpha,A,lda,B,ldb);
@@ -0,0 +1,238 @@
+// decoder/biglm-lookahead.cc
+
+// Copyright 2015   Johns Hopkins University (Author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <deque>
+#include <limits>
+#include <set>
+#include "decoder/biglm-lookahead.h"
+
+namespace kaldi {
+
+// A frame of the iterative depth-first search in the constructor; one per
+// state on the current search path.  We follow only output-epsilon arcs
+// downward, accumulating the labels of the output-nonepsilon arcs we see.
+struct BiglmLookaheadDfsFrame {
+  typedef fst::StdArc::StateId StateId;
+  StateId state;
+  size_t arc_pos;    // next arc of "state" to look at, for resuming after we
+                     // descend into a child.
+  bool universal;    // true if the label set was capped (or hit a cycle).
+  bool final_ok;     // true if a final state is reachable without a label.
+  std::set<int32> labels;  // empty if universal.
+  explicit BiglmLookaheadDfsFrame(StateId state):
+      state(state), arc_pos(0), universal(false), final_ok(false) { }
+};
+
+// Merges the already-computed result of state "t" into the frame of one of
+// its predecessors.  (Static with everything passed in, because the frame
+// type is local to this file.)
+static void MergeCompletedState(const std::vector<int32> &set_ids,
+                                const std::vector<char> &final_ok,
+                                const std::vector<std::vector<int32> > &sets,
+                                int32 max_labels,
+                                fst::StdArc::StateId t,
+                                BiglmLookaheadDfsFrame *f) {
+  if (final_ok[t] != 0) f->final_ok = true;
+  if (f->universal) return;
+  if (set_ids[t] == -1) {  // kUniversalSet; it is private to the class.
+    f->universal = true;
+    f->labels.clear();
+  } else {
+    const std::vector<int32> &child_labels = sets[set_ids[t]];
+    f->labels.insert(child_labels.begin(), child_labels.end());
+    if (static_cast<int32>(f->labels.size()) > max_labels) {
+      f->universal = true;
+      f->labels.clear();
+    }
+  }
+}
+
+BiglmLookahead::BiglmLookahead(const fst::Fst<fst::StdArc> &fst,
+                               int32 max_labels):
+    max_labels_(max_labels) {
+  KALDI_ASSERT(max_labels > 0);
+  StateId num_states = 0;
+  for (fst::StateIterator<fst::Fst<Arc> > siter(fst);
+       !siter.Done(); siter.Next())
+    if (siter.Value() + 1 > num_states) num_states = siter.Value() + 1;
+  // Unused state-ids (if the FST's numbering has gaps) keep the universal
+  // set, which is harmless since they can never be reached.
+  set_ids_.resize(num_states, static_cast<int32>(kUniversalSet));
+  final_ok_.resize(num_states, 0);
+
+  std::vector<char> color(num_states, 0);  // 0 white, 1 gray, 2 black.
+  unordered_map<std::vector<int32>, int32, VectorHasher<int32> > set_map;
+  std::deque<BiglmLookaheadDfsFrame> stack;
+
+  for (fst::StateIterator<fst::Fst<Arc> > siter(fst);
+       !siter.Done(); siter.Next()) {
+    StateId root = siter.Value();
+    if (color[root] != 0) continue;
+    color[root] = 1;
+    stack.push_back(BiglmLookaheadDfsFrame(root));
+    while (!stack.empty()) {
+      BiglmLookaheadDfsFrame &f = stack.back();
+      StateId s = f.state;
+      bool descended = false;
+      fst::ArcIterator<fst::Fst<Arc> > aiter(fst, s);
+      aiter.Seek(f.arc_pos);
+      for (; !aiter.Done(); aiter.Next()) {
+        const Arc &arc = aiter.Value();
+        f.arc_pos++;
+        if (arc.olabel != 0) {
+          if (!f.universal) {
+            f.labels.insert(arc.olabel);
+            if (static_cast<int32>(f.labels.size()) > max_labels_) {
+              f.universal = true;
+              f.labels.clear();
+            }
+          }
+        } else {
+          StateId t = arc.nextstate;
+          if (color[t] == 0) {
+            color[t] = 1;
+            stack.push_back(BiglmLookaheadDfsFrame(t));
+            descended = true;
+            break;
+          } else if (color[t] == 1) {
+            // "t" is on the current search path: an output-epsilon cycle.
+            // Treating the set as universal over-approximates it, which
+            // can only make pruning less effective, never incorrect.
+            f.universal = true;
+            f.labels.clear();
+          } else {
+            MergeCompletedState(set_ids_, final_ok_, sets_, max_labels_,
+                                t, &f);
+          }
+        }
+      }
+      if (descended) continue;  // f will be resumed at f.arc_pos later.
+      // All arcs of s have been processed: finalize its entry.
+      if (fst.Final(s) != Weight::Zero()) f.final_ok = true;
+      final_ok_[s] = f.final_ok ? 1 : 0;
+      if (f.universal) {
+        set_ids_[s] = static_cast<int32>(kUniversalSet);
+      } else {
+        std::vector<int32> labels(f.labels.begin(), f.labels.end());
+        set_ids_[s] = InternSet(labels, &set_map);
+      }
+      color[s] = 2;
+      stack.pop_back();
+      if (!stack.empty())
+        MergeCompletedState(set_ids_, final_ok_, sets_, max_labels_,
+                            s, &stack.back());
+    }
+  }
+  KALDI_VLOG(1) << "BiglmLookahead: " << sets_.size()
+                << " distinct label sets over " << num_states << " states.";
+}
+
+int32 BiglmLookahead::InternSet(
+    const std::vector<int32> &labels,
+    unordered_map<std::vector<int32>, int32,
+                  VectorHasher<int32> > *set_map) {
+  unordered_map<std::vector<int32>, int32,
+                VectorHasher<int32> >::const_iterator iter =
+      set_map->find(labels);
+  if (iter != set_map->end()) return iter->second;
+  int32 id = static_cast<int32>(sets_.size());
+  sets_.push_back(labels);
+  (*set_map)[labels] = id;
+  return id;
+}
+
+BaseFloat BiglmLookahead::LookaheadCost(
+    StateId state, StateId lm_state,
+    fst::DeterministicOnDemandFst<fst::StdArc> *lm_diff_fst) {
+  KALDI_PARANOID_ASSERT(static_cast<size_t>(state) < set_ids_.size());
+  int32 set_id = set_ids_[state];
+  if (set_id == static_cast<int32>(kUniversalSet) || final_ok_[state] != 0)
+    return 0.0;  // nothing useful known; cannot prune.
+  std::pair<int32, int32> key(set_id, static_cast<int32>(lm_state));
+  unordered_map<std::pair<int32, int32>, BaseFloat,
+                PairHasher<int32> >::const_iterator iter = cache_.find(key);
+  if (iter != cache_.end()) return iter->second;
+  const std::vector<int32> &labels = sets_[set_id];
+  BaseFloat best = std::numeric_limits<BaseFloat>::infinity();
+  Arc lm_arc;
+  // Note: no early termination here; the answer must be a lower bound over
+  // the whole set (LM-difference weights can be negative), and it gets
+  // cached anyway.
+  for (size_t i = 0; i < labels.size(); i++)
+    if (lm_diff_fst->GetArc(lm_state, labels[i], &lm_arc) &&
+        lm_arc.weight.Value() < best)
+      best = lm_arc.weight.Value();
+  // "best" stays infinite if the LM accepts none of the reachable words
+  // (and no final state is reachable): a dead end.
+  cache_[key] = best;
+  return best;
+}
+
+void BiglmLookahead::Write(std::ostream &os, bool binary) const {
+  WriteToken(os, binary, "<BiglmLookahead>");
+  WriteToken(os, binary, "<MaxLabels>");
+  WriteBasicType(os, binary, max_labels_);
+  WriteToken(os, binary, "<Sets>");
+  int32 num_sets = static_cast<int32>(sets_.size());
+  WriteBasicType(os, binary, num_sets);
+  for (int32 i = 0; i < num_sets; i++)
+    WriteIntegerVector(os, binary, sets_[i]);
+  WriteToken(os, binary, "<SetIds>");
+  WriteIntegerVector(os, binary, set_ids_);
+  WriteToken(os, binary, "<FinalOk>");
+  // final_ok_ goes through an int32 vector, as the I/O routines are not
+  // meant for char (text mode would print the raw characters).
+  std::vector<int32> final_ok(final_ok_.begin(), final_ok_.end());
+  WriteIntegerVector(os, binary, final_ok);
+  WriteToken(os, binary, "</BiglmLookahead>");
+}
+
+void BiglmLookahead::Read(std::istream &is, bool binary) {
+  ExpectToken(is, binary, "<BiglmLookahead>");
+  ExpectToken(is, binary, "<MaxLabels>");
+  ReadBasicType(is, binary, &max_labels_);
+  ExpectToken(is, binary, "<Sets>");
+  int32 num_sets;
+  ReadBasicType(is, binary, &num_sets);
+  if (num_sets < 0)
+    KALDI_ERR << "Invalid lookahead index: " << num_sets << " label sets.";
+  sets_.resize(num_sets);
+  for (int32 i = 0; i < num_sets; i++)
+    ReadIntegerVector(is, binary, &sets_[i]);
+  ExpectToken(is, binary, "<SetIds>");
+  ReadIntegerVector(is, binary, &set_ids_);
+  ExpectToken(is, binary, "<FinalOk>");
+  std::vector<int32> final_ok;
+  ReadIntegerVector(is, binary, &final_ok);
+  ExpectToken(is, binary, "</BiglmLookahead>");
+  if (final_ok.size() != set_ids_.size())
+    KALDI_ERR << "Invalid lookahead index: " << set_ids_.size()
+              << " set-ids vs. " << final_ok.size() << " final flags.";
+  final_ok_.resize(final_ok.size());
+  for (size_t i = 0; i < final_ok.size(); i++) {
+    final_ok_[i] = static_cast<char>(final_ok[i]);
+    if (set_ids_[i] != static_cast<int32>(kUniversalSet) &&
+        (set_ids_[i] < 0 || set_ids_[i] >= num_sets))
+      KALDI_ERR << "Invalid lookahead index: set-id " << set_ids_[i]
+                << " out of range.";
+  }
+  cache_.clear();
+}
+
+}  // end namespace kaldi.
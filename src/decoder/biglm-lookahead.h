@@ -0,0 +1,131 @@
+// decoder/biglm-lookahead.h
+
+// Copyright 2015   Johns Hopkins University (Author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_DECODER_BIGLM_LOOKAHEAD_H_
+#define KALDI_DECODER_BIGLM_LOOKAHEAD_H_
+
+#include <utility>
+#include <vector>
+#include "base/kaldi-common.h"
+#include "util/stl-utils.h"
+#include "fst/fstlib.h"
+#include "fstext/deterministic-fst.h"
+
+namespace kaldi {
+
+/**
+   BiglmLookahead is a label-lookahead index for decoders that compose HCLG
+   with a language model on the fly (currently LatticeBiglmFasterDecoder).
+   For each state of HCLG it precomputes the set of word labels that can
+   appear as the first output symbol on some path from that state, together
+   with a flag saying whether a final state is reachable without emitting any
+   word.  During decoding, before a token is created at a (graph-state,
+   lm-state) pair, we check that the LM actually accepts at least one of the
+   words reachable from the graph state, and we use the best LM weight over
+   that set as an anticipated cost for pruning.  This prunes dead-end
+   expansions (especially with grammar-type LMs, where many words are simply
+   absent from a state) before they cost us token creation and further
+   expansion; it plays the same role as OpenFst's lookahead matchers, but
+   the index is precomputed and can be written and read in Kaldi format.
+
+   Label sets are computed by following output-epsilon arcs, capped at
+   "max_labels" distinct labels: a state from which more than max_labels
+   words are reachable gets the "universal" set, which is never checked
+   against the LM (with a statistical backoff LM every word is accepted
+   anyway, so large sets could only cost time, not help pruning).  The cap
+   also keeps the index small, since the interesting sets -- those deep
+   inside words of the lexicon -- are tiny, and identical sets are shared
+   between states.  The over-approximations (the universal set, and cycles of
+   output-epsilon arcs, which are also treated as universal) can only make
+   pruning less effective, never wrong.
+
+   Per-(label-set, lm-state) query results are cached internally, so the cost
+   of consulting the LM is shared by all tokens in the same region of the
+   graph; this makes LookaheadCost() non-const.  The cache assumes the same
+   lm_diff_fst is passed every time; call ClearCache() if it changes.  Like
+   EpsilonArcCache, the index itself is immutable after construction and
+   must outlive any decoder using it.
+ */
+class BiglmLookahead {
+ public:
+  typedef fst::StdArc Arc;
+  typedef Arc::Label Label;
+  typedef Arc::StateId StateId;
+  typedef Arc::Weight Weight;
+
+  // Builds the index from the decoding graph; this scans each arc of "fst"
+  // once (the fst is not kept).  See the comment above for "max_labels".
+  explicit BiglmLookahead(const fst::Fst<fst::StdArc> &fst,
+                          int32 max_labels = 100);
+
+  // Constructor for use prior to Read().
+  BiglmLookahead(): max_labels_(0) { }
+
+  void Write(std::ostream &os, bool binary) const;
+
+  void Read(std::istream &is, bool binary);
+
+  // Number of graph states the index covers; a decoder should check this
+  // matches its graph (it would be an index built from a different FST
+  // otherwise).
+  int32 NumStates() const { return static_cast<int32>(set_ids_.size()); }
+
+  /// Returns a lower bound on the extra LM cost that any path leaving graph
+  /// state "state" with the LM in state "lm_state" will incur at its next
+  /// word, or +infinity if no reachable word is accepted by the LM (i.e. the
+  /// pair is a dead end and the token need not be created).  Returns 0.0
+  /// whenever nothing useful is known (universal label set, or a final state
+  /// reachable without emitting a word).
+  BaseFloat LookaheadCost(StateId state, StateId lm_state,
+                          fst::DeterministicOnDemandFst<fst::StdArc>
+                              *lm_diff_fst);
+
+  // Discards the per-(label-set, lm-state) cache; only needed if you start
+  // using a different lm_diff_fst with the same index.
+  void ClearCache() { cache_.clear(); }
+
+ private:
+  // set_ids_[s] is kUniversalSet for states whose reachable-label set was
+  // capped (or lies on an output-epsilon cycle).
+  enum { kUniversalSet = -1 };
+
+  // Returns the id of the set "labels" (sorted, unique), adding it to sets_
+  // if not seen before; used only during construction.
+  int32 InternSet(
+      const std::vector<int32> &labels,
+      unordered_map<std::vector<int32>, int32,
+                    VectorHasher<int32> > *set_map);
+
+  int32 max_labels_;
+  std::vector<int32> set_ids_;   // per graph state: index into sets_, or
+                                 // kUniversalSet.
+  std::vector<char> final_ok_;   // per graph state: nonzero if a final state
+                                 // is reachable via output-epsilon arcs only.
+  std::vector<std::vector<int32> > sets_;  // the distinct label sets, each
+                                           // sorted and without repeats.
+  unordered_map<std::pair<int32, int32>, BaseFloat,
+                PairHasher<int32> > cache_;  // maps (set-id, lm-state) to the
+                                             // answer of LookaheadCost().
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(BiglmLookahead);
+};
+
+}  // end namespace kaldi.
+
+#endif  // KALDI_DECODER_BIGLM_LOOKAHEAD_H_
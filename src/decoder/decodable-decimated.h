@@ -0,0 +1,102 @@
+// decoder/decodable-decimated.h
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_DECODER_DECODABLE_DECIMATED_H_
+#define KALDI_DECODER_DECODABLE_DECIMATED_H_
+
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "itf/decodable-itf.h"
+
+namespace kaldi {
+
+// DecodableDecimated wraps another decodable object and only evaluates the
+// underlying likelihoods on every "decimation"'th frame: the other frames of
+// each decimation block return the score of the block's first frame.  The
+// frame count is unchanged, so the decoder still passes tokens over every
+// frame and the resulting alignment is full-length and consistent with the
+// HMM topology; only the acoustic scores are held constant within a block.
+// Since the base decodable classes generally do not memoize, we cache the
+// scores of the current block's first frame here (one entry per index), so
+// a block of N frames costs one acoustic evaluation per distinct index
+// instead of N.
+//
+// SetFullRateFrames() optionally marks frames to be scored individually
+// regardless of the decimation factor, e.g. regions that looked poorly
+// matched in a first decoding pass; see AlignUtteranceWrapper() in
+// decoder-wrappers.cc for how this is used.
+
+class DecodableDecimated: public DecodableInterface {
+ public:
+  // Does not take ownership of "decodable".  "decimation" must be >= 1;
+  // 1 means no decimation (every frame scored normally).
+  DecodableDecimated(DecodableInterface *decodable, int32 decimation):
+      decodable_(decodable), decimation_(decimation),
+      cache_values_(decodable->NumIndices() + 1),
+      cache_frames_(decodable->NumIndices() + 1, -1) {
+    KALDI_ASSERT(decimation >= 1);
+  }
+
+  // Frames f with full_rate[f] == true will be scored individually rather
+  // than inheriting the score of their block's first frame.  The vector may
+  // be shorter than the utterance; missing entries count as false.  Clears
+  // the cache, so this may be called between two decoding passes over the
+  // same utterance.
+  void SetFullRateFrames(const std::vector<bool> &full_rate) {
+    full_rate_ = full_rate;
+    cache_frames_.clear();
+    cache_frames_.resize(cache_values_.size(), -1);
+  }
+
+  virtual BaseFloat LogLikelihood(int32 frame, int32 index) {
+    int32 base_frame = frame - (frame % decimation_);
+    if (static_cast<size_t>(frame) < full_rate_.size() && full_rate_[frame])
+      base_frame = frame;
+    KALDI_PARANOID_ASSERT(static_cast<size_t>(index) < cache_frames_.size());
+    if (cache_frames_[index] != base_frame) {
+      cache_values_[index] = decodable_->LogLikelihood(base_frame, index);
+      cache_frames_[index] = base_frame;
+    }
+    return cache_values_[index];
+  }
+
+  virtual int32 NumFramesReady() const { return decodable_->NumFramesReady(); }
+
+  virtual bool IsLastFrame(int32 frame) const {
+    return decodable_->IsLastFrame(frame);
+  }
+
+  virtual int32 NumIndices() const { return decodable_->NumIndices(); }
+
+ private:
+  DecodableInterface *decodable_;  // not owned here.
+  int32 decimation_;
+  std::vector<bool> full_rate_;  // empty means all frames are decimated.
+  std::vector<BaseFloat> cache_values_;  // indexed by the decodable's index
+                                         // (one-based, hence NumIndices()+1).
+  std::vector<int32> cache_frames_;  // frame each cache entry was computed
+                                     // at, or -1 if never computed.
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(DecodableDecimated);
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_DECODER_DECODABLE_DECIMATED_H_
@@ -0,0 +1,146 @@
+// decoder/decodable-shared-cache.h
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_DECODER_DECODABLE_SHARED_CACHE_H_
+#define KALDI_DECODER_DECODABLE_SHARED_CACHE_H_
+
+#include <limits>
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "itf/decodable-itf.h"
+
+namespace kaldi {
+
+/**
+   These classes let several decoder threads that decode the same utterance
+   with the same acoustic model (e.g. with different graphs, for system
+   combination) share the acoustic computation: whichever thread first needs
+   the score of a (frame, index) pair computes it and publishes it in a
+   shared lock-free table, and the other threads read it from there.
+
+   SharedScoreCache is the shared table, one per utterance.  Each slot holds
+   either a published score or an "empty" sentinel, and a slot is published
+   with a single aligned store of the value itself, so readers see either
+   the sentinel or a complete score and no locking or ordering is needed.
+   If two threads miss on the same slot concurrently they both compute it,
+   which is harmless: the inputs are identical, so they store the same
+   value.  Scores of +infinity are never cached (no valid log-likelihood is
+   +infinity, so this does not arise in practice).
+
+   The table is dense, num_frames * num_slots values, so for decodables
+   whose indices are transition-ids you will usually want to supply an
+   index map that collapses indices with equal scores onto one slot (e.g.
+   map each transition-id to its pdf-id via
+   TransitionModel::TransitionIdToPdf(); indices mapped to the same slot
+   must have equal scores, which is not checked).
+*/
+class SharedScoreCache {
+ public:
+  // "num_slots" is one more than the largest slot index that will be used
+  // (slots, like decodable indices, are one-based unless an index map says
+  // otherwise).
+  SharedScoreCache(int32 num_frames, int32 num_slots):
+      num_slots_(num_slots),
+      table_(static_cast<size_t>(num_frames) * static_cast<size_t>(num_slots),
+             std::numeric_limits<BaseFloat>::infinity()) {
+    KALDI_ASSERT(num_frames > 0 && num_slots > 0);
+  }
+
+  // If (frame, slot) has been published, sets *value and returns true.
+  inline bool Lookup(int32 frame, int32 slot, BaseFloat *value) const {
+    KALDI_PARANOID_ASSERT(slot >= 0 && slot < num_slots_);
+    BaseFloat v = *const_cast<const volatile BaseFloat*>(
+        &table_[static_cast<size_t>(frame) * num_slots_ + slot]);
+    if (v == std::numeric_limits<BaseFloat>::infinity()) return false;
+    *value = v;
+    return true;
+  }
+
+  // Publishes the score of (frame, slot); safe to call from any thread,
+  // including concurrently for the same slot (the values are then equal).
+  inline void Insert(int32 frame, int32 slot, BaseFloat value) {
+    KALDI_PARANOID_ASSERT(slot >= 0 && slot < num_slots_);
+    if (value == std::numeric_limits<BaseFloat>::infinity()) return;
+    *const_cast<volatile BaseFloat*>(
+        &table_[static_cast<size_t>(frame) * num_slots_ + slot]) = value;
+  }
+
+ private:
+  int32 num_slots_;
+  std::vector<BaseFloat> table_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(SharedScoreCache);
+};
+
+
+/// DecodableSharedCache is the per-thread view of a SharedScoreCache.
+/// Each decoder thread wraps its OWN decodable instance (decodables such
+/// as DecodableAmDiagGmmScaled keep mutable per-frame state, so the
+/// underlying objects themselves must not be shared; they are cheap, as
+/// they only reference the model and the feature matrix).  Neither the
+/// decodable nor the cache is owned here.
+class DecodableSharedCache: public DecodableInterface {
+ public:
+  // This version caches by the decodable's own index; the cache must have
+  // num_slots >= decodable->NumIndices() + 1.
+  DecodableSharedCache(DecodableInterface *decodable,
+                       SharedScoreCache *cache):
+      decodable_(decodable), cache_(cache), index_map_(NULL) { }
+
+  // This version caches by index_map[index]; see the comment above
+  // SharedScoreCache about collapsing transition-ids to pdf-ids.  The map
+  // must cover [0, decodable->NumIndices()], and is not copied, so it must
+  // outlive this object.
+  DecodableSharedCache(DecodableInterface *decodable,
+                       SharedScoreCache *cache,
+                       const std::vector<int32> &index_map):
+      decodable_(decodable), cache_(cache), index_map_(&index_map) {
+    KALDI_ASSERT(static_cast<int32>(index_map.size()) >
+                 decodable->NumIndices());
+  }
+
+  virtual BaseFloat LogLikelihood(int32 frame, int32 index) {
+    int32 slot = (index_map_ != NULL) ? (*index_map_)[index] : index;
+    BaseFloat value;
+    if (cache_->Lookup(frame, slot, &value)) return value;
+    value = decodable_->LogLikelihood(frame, index);
+    cache_->Insert(frame, slot, value);
+    return value;
+  }
+
+  virtual int32 NumFramesReady() const { return decodable_->NumFramesReady(); }
+
+  virtual bool IsLastFrame(int32 frame) const {
+    return decodable_->IsLastFrame(frame);
+  }
+
+  virtual int32 NumIndices() const { return decodable_->NumIndices(); }
+
+ private:
+  DecodableInterface *decodable_;  // not owned here.
+  SharedScoreCache *cache_;  // not owned here.
+  const std::vector<int32> *index_map_;  // not owned here; NULL if absent.
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(DecodableSharedCache);
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_DECODER_DECODABLE_SHARED_CACHE_H_
@@ -0,0 +1,61 @@
+// decoder/decoder-stats.cc
+
+// Copyright 2014   Johns Hopkins University
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "decoder/decoder-stats.h"
+
+namespace kaldi {
+
+void DecoderStats::PrintSummary(const std::string &name) const {
+  if (num_frames_ == 0) {
+    KALDI_LOG << "DecoderStats (" << name << "): no frames recorded.";
+    return;
+  }
+  KALDI_LOG << "DecoderStats (" << name << "): " << num_frames_
+            << " frames in " << total_seconds_ << "s ("
+            << (1000.0 * total_seconds_ / num_frames_)
+            << " ms/frame avg, " << (1000.0 * max_frame_seconds_)
+            << " ms worst); avg tokens/frame "
+            << (total_toks_ / static_cast<double>(num_frames_))
+            << "; pruned " << total_toks_pruned_ << " tokens, "
+            << total_links_pruned_ << " links.";
+}
+
+void DecoderStats::Print(std::ostream &os) const {
+  int32 num_retained = std::min(num_frames_,
+                                static_cast<int32>(ring_.size()));
+  for (int32 i = num_frames_ - num_retained; i < num_frames_; i++) {
+    const FrameStats &f = ring_[i % ring_.size()];
+    os << f.frame << ' ' << f.seconds << ' ' << f.num_toks << ' '
+       << f.beam_used << ' ' << f.best_cost << ' ' << f.toks_pruned << ' '
+       << f.links_pruned << '\n';
+  }
+}
+
+void DecoderStats::WriteStateVisits(std::ostream &os) const {
+  if (state_visits_.empty())
+    KALDI_WARN << "WriteStateVisits called but state-visit counting was "
+               << "never enabled; writing nothing.";
+  for (size_t s = 0; s < state_visits_.size(); s++)
+    if (state_visits_[s] != 0)
+      os << s << ' ' << state_visits_[s] << '\n';
+  if (!os.good())
+    KALDI_ERR << "Failure writing state-visit counts to stream.";
+}
+
+}  // end namespace kaldi.
@@ -0,0 +1,193 @@
+// decoder/decoder-stats.h
+
+// Copyright 2014   Johns Hopkins University
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_DECODER_DECODER_STATS_H_
+#define KALDI_DECODER_DECODER_STATS_H_
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+#include "base/kaldi-common.h"
+#include "base/timer.h"
+
+namespace kaldi {
+
+/**
+   DecoderStats is an optional per-frame instrumentation surface for the
+   decoders: it records wall time, token counts, the adaptive beam used,
+   and pruning counts for each decoded frame into a preallocated ring
+   buffer.  Attach one via FasterDecoder::SetDecoderStats() or
+   LatticeFasterDecoder::SetDecoderStats(); when no stats object is
+   attached the decoders only pay a pointer test per frame, so there is
+   no need for a special build to get these numbers in production.
+
+   The ring buffer keeps the most recent ring_size frames (so memory is
+   bounded for arbitrarily long utterances); totals are accumulated over
+   all frames regardless.  The object may be reused across utterances:
+   call Reset() between them, or let the counts accumulate if you want
+   per-job rather than per-utterance numbers.  Recording is not
+   thread-safe; use one DecoderStats per decoder.
+ */
+class DecoderStats {
+ public:
+  struct FrameStats {
+    int32 frame;          // frame index, as the decoder counts them.
+    double seconds;       // wall time of this frame's token passing.
+    int32 num_toks;       // tokens active when the frame was processed.
+    BaseFloat beam_used;  // the (possibly adaptive) beam applied.
+    double best_cost;     // cost of the best token entering this frame; the
+                          // increment between consecutive frames is the cost
+                          // the best path picked up on one frame.
+    int32 toks_pruned;    // tokens removed by pruning after this frame
+                          // (zero on frames where no pruning ran).
+    int32 links_pruned;   // forward links removed likewise.
+  };
+
+  explicit DecoderStats(int32 ring_size = 2000):
+      ring_(static_cast<size_t>(ring_size)), num_frames_(0),
+      total_seconds_(0.0), total_toks_(0), total_toks_pruned_(0),
+      total_links_pruned_(0), max_frame_seconds_(0.0), in_frame_(false) {
+    KALDI_ASSERT(ring_size > 0);
+  }
+
+  // Called by the decoder at the start of a frame's emitting pass.
+  inline void BeginFrame(int32 frame) {
+    cur_.frame = frame;
+    cur_.num_toks = 0;
+    cur_.beam_used = 0.0;
+    cur_.best_cost = 0.0;
+    cur_.toks_pruned = 0;
+    cur_.links_pruned = 0;
+    in_frame_ = true;
+    timer_.Reset();
+  }
+
+  // Called once per frame, when the beam for the frame is known.
+  inline void RecordBeam(BaseFloat beam) { cur_.beam_used = beam; }
+
+  // Called once per frame, with the cost of the best active token.
+  inline void RecordBestCost(double best_cost) { cur_.best_cost = best_cost; }
+
+  // Called by the decoder when the frame's token passing is complete;
+  // "num_toks" is the number of tokens that were active this frame.
+  inline void EndFrame(int32 num_toks) {
+    if (!in_frame_) return;  // e.g. the nonemitting pass of InitDecoding().
+    cur_.seconds = timer_.Elapsed();
+    cur_.num_toks = num_toks;
+    num_frames_++;
+    total_seconds_ += cur_.seconds;
+    total_toks_ += num_toks;
+    if (cur_.seconds > max_frame_seconds_) max_frame_seconds_ = cur_.seconds;
+    ring_[(num_frames_ - 1) % ring_.size()] = cur_;
+    in_frame_ = false;
+  }
+
+  // Enables per-state visit counting (off by default, since the count
+  // array is the size of the graph); "num_states" is the number of states
+  // in the decoding graph.  When enabled, the decoders count how often
+  // each graph state had a surviving token in ProcessEmitting().  The
+  // counts accumulate across utterances (Reset() does not clear them), so
+  // one job's worth of decoding yields a usable traversal profile, e.g.
+  // for fstreorderstates.
+  void EnableStateVisits(int32 num_states) {
+    KALDI_ASSERT(num_states > 0);
+    state_visits_.clear();
+    state_visits_.resize(static_cast<size_t>(num_states), 0);
+  }
+
+  // Called by the decoder once per surviving token per frame; no-op
+  // unless EnableStateVisits() was called.
+  inline void RecordStateVisit(int32 state) {
+    if (state_visits_.empty()) return;
+    KALDI_PARANOID_ASSERT(static_cast<size_t>(state) < state_visits_.size());
+    state_visits_[state]++;
+  }
+
+  // Writes the visit counts as text, one "<state-id> <count>" pair per
+  // line, omitting states that were never visited.  This is the format
+  // fstreorderstates reads via its --state-visits option.
+  void WriteStateVisits(std::ostream &os) const;
+
+  // Called when pruning runs; the counts are attributed to the most
+  // recently completed frame.
+  inline void RecordPrune(int32 toks_pruned, int32 links_pruned) {
+    total_toks_pruned_ += toks_pruned;
+    total_links_pruned_ += links_pruned;
+    if (num_frames_ > 0) {
+      FrameStats &last = ring_[(num_frames_ - 1) % ring_.size()];
+      last.toks_pruned += toks_pruned;
+      last.links_pruned += links_pruned;
+    }
+  }
+
+  // Logs a one-line summary (totals and worst frame); the decoders call
+  // this from FinalizeDecoding() when stats are attached.
+  void PrintSummary(const std::string &name) const;
+
+  // Writes one line per retained frame, oldest first, e.g. for offline
+  // analysis or dashboards.  Frames older than ring-size are gone.
+  void Print(std::ostream &os) const;
+
+  void Reset() {
+    num_frames_ = 0;
+    total_seconds_ = 0.0;
+    total_toks_ = 0;
+    total_toks_pruned_ = 0;
+    total_links_pruned_ = 0;
+    max_frame_seconds_ = 0.0;
+    in_frame_ = false;
+  }
+
+  int32 NumFrames() const { return num_frames_; }
+  double TotalSeconds() const { return total_seconds_; }
+  int64 TotalToks() const { return total_toks_; }
+
+  // The number of frames still in the ring buffer (equals NumFrames() as
+  // long as the utterance is no longer than the ring size).
+  int32 NumFramesRetained() const {
+    return std::min(num_frames_, static_cast<int32>(ring_.size()));
+  }
+
+  // Returns the i'th oldest retained frame, 0 <= i < NumFramesRetained();
+  // e.g. used to read back the best-cost trajectory after decoding.
+  const FrameStats &RetainedFrame(int32 i) const {
+    int32 num_retained = NumFramesRetained();
+    KALDI_ASSERT(i >= 0 && i < num_retained);
+    return ring_[(num_frames_ - num_retained + i) % ring_.size()];
+  }
+
+ private:
+  std::vector<FrameStats> ring_;
+  std::vector<int64> state_visits_;  // empty unless EnableStateVisits().
+  int32 num_frames_;  // frames recorded since Reset(), >= frames retained.
+  double total_seconds_;
+  int64 total_toks_;
+  int64 total_toks_pruned_;
+  int64 total_links_pruned_;
+  double max_frame_seconds_;
+  FrameStats cur_;  // the frame currently being recorded.
+  bool in_frame_;
+  Timer timer_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(DecoderStats);
+};
+
+}  // end namespace kaldi.
+
+#endif  // KALDI_DECODER_DECODER_STATS_H_
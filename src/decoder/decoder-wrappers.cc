@@ -19,6 +19,7 @@
 
 #include "decoder/decoder-wrappers.h"
 #include "decoder/faster-decoder.h"
+#include "decoder/decodable-decimated.h"
 
 namespace kaldi {
 
@@ -193,6 +194,419 @@ DecodeUtteranceLatticeFasterClass::~DecodeUtteranceLatticeFasterClass() {
 }
 
 
+// The unit of work that BatchedLatticeDecoder gives to its TaskSequencer.
+// The decoding happens in operator (), using a decoder borrowed from the
+// parent's pool (and returned to it as soon as decoding is done); the output
+// happens in the destructor, which the TaskSequencer runs in the order the
+// utterances were queued.  This closely mirrors
+// DecodeUtteranceLatticeFasterClass, except that the decoder is reused.
+class BatchedLatticeDecoder::UtteranceTask {
+ public:
+  // Takes ownership of "decodable".
+  UtteranceTask(BatchedLatticeDecoder *parent,
+                const std::string &utt,
+                DecodableInterface *decodable):
+      parent_(parent), utt_(utt), decodable_(decodable),
+      computed_(false), success_(false), partial_(false),
+      clat_(NULL), lat_(NULL) { }
+
+  void operator () () {
+    computed_ = true;
+    success_ = true;
+    LatticeFasterDecoder *decoder = parent_->GetDecoder();
+    if (!decoder->Decode(decodable_)) {
+      KALDI_WARN << "Failed to decode file " << utt_;
+      success_ = false;
+    }
+    if (success_ && !decoder->ReachedFinal()) {
+      if (parent_->allow_partial_) {
+        KALDI_WARN << "Outputting partial output for utterance " << utt_
+                   << " since no final-state reached\n";
+        partial_ = true;
+      } else {
+        KALDI_WARN << "Not producing output for utterance " << utt_
+                   << " since no final-state reached and "
+                   << "--allow-partial=false.\n";
+        success_ = false;
+      }
+    }
+    if (success_) {
+      // Get best path and raw lattice out of the decoder now, so the decoder
+      // can go back to the pool before determinization (the slow part for
+      // some configurations) happens.
+      decoder->GetBestPath(&best_path_);
+      lat_ = new Lattice;
+      decoder->GetRawLattice(lat_);
+      if (lat_->NumStates() == 0)
+        KALDI_ERR << "Unexpected problem getting lattice for utterance "
+                  << utt_;
+      fst::Connect(lat_);
+    }
+    parent_->ReleaseDecoder(decoder);
+    if (!success_) return;
+    if (parent_->determinize_) {
+      clat_ = new CompactLattice;
+      if (!DeterminizeLatticePhonePrunedWrapper(
+              parent_->trans_model_,
+              lat_,
+              parent_->decoder_config_.lattice_beam,
+              clat_,
+              parent_->decoder_config_.det_opts))
+        KALDI_WARN << "Determinization finished earlier than the beam for "
+                   << "utterance " << utt_;
+      delete lat_;
+      lat_ = NULL;
+      // We'll write the lattice without acoustic scaling.
+      if (parent_->acoustic_scale_ != 0.0)
+        fst::ScaleLattice(fst::AcousticLatticeScale(
+            1.0 / parent_->acoustic_scale_), clat_);
+    } else {
+      // We'll write the lattice without acoustic scaling.
+      if (parent_->acoustic_scale_ != 0.0)
+        fst::ScaleLattice(fst::AcousticLatticeScale(
+            1.0 / parent_->acoustic_scale_), lat_);
+    }
+  }
+
+  ~UtteranceTask() {
+    if (!computed_)
+      KALDI_ERR << "Destructor called without operator (), error in calling "
+                << "code.";
+    if (!success_) {
+      if (parent_->num_err_ != NULL) (*parent_->num_err_)++;
+    } else {
+      double likelihood;
+      LatticeWeight weight;
+      int32 num_frames;
+      { // Word-level traceback, basically for diagnostics.
+        if (best_path_.NumStates() == 0)
+          KALDI_ERR << "Failed to get traceback for utterance " << utt_;
+        std::vector<int32> alignment;
+        std::vector<int32> words;
+        GetLinearSymbolSequence(best_path_, &alignment, &words, &weight);
+        num_frames = alignment.size();
+        if (parent_->words_writer_ != NULL &&
+            parent_->words_writer_->IsOpen())
+          parent_->words_writer_->Write(utt_, words);
+        if (parent_->alignments_writer_ != NULL &&
+            parent_->alignments_writer_->IsOpen())
+          parent_->alignments_writer_->Write(utt_, alignment);
+        if (parent_->word_syms_ != NULL) {
+          std::cerr << utt_ << ' ';
+          for (size_t i = 0; i < words.size(); i++) {
+            std::string s = parent_->word_syms_->Find(words[i]);
+            if (s == "")
+              KALDI_ERR << "Word-id " << words[i] << " not in symbol table.";
+            std::cerr << s << ' ';
+          }
+          std::cerr << '\n';
+        }
+        likelihood = -(weight.Value1() + weight.Value2());
+      }
+      if (parent_->determinize_) {
+        KALDI_ASSERT(parent_->compact_lattice_writer_ != NULL &&
+                     clat_ != NULL);
+        if (clat_->NumStates() == 0)
+          KALDI_WARN << "Empty lattice for utterance " << utt_;
+        else
+          parent_->compact_lattice_writer_->Write(utt_, *clat_);
+        delete clat_;
+        clat_ = NULL;
+      } else {
+        KALDI_ASSERT(parent_->lattice_writer_ != NULL && lat_ != NULL);
+        if (lat_->NumStates() == 0)
+          KALDI_WARN << "Empty lattice for utterance " << utt_;
+        else
+          parent_->lattice_writer_->Write(utt_, *lat_);
+        delete lat_;
+        lat_ = NULL;
+      }
+      KALDI_LOG << "Log-like per frame for utterance " << utt_ << " is "
+                << (likelihood / num_frames) << " over "
+                << num_frames << " frames.";
+      if (parent_->like_sum_ != NULL) *parent_->like_sum_ += likelihood;
+      if (parent_->frame_sum_ != NULL) *parent_->frame_sum_ += num_frames;
+      if (parent_->num_done_ != NULL) (*parent_->num_done_)++;
+      if (partial_ && parent_->num_partial_ != NULL)
+        (*parent_->num_partial_)++;
+    }
+    delete decodable_;
+  }
+ private:
+  BatchedLatticeDecoder *parent_;
+  std::string utt_;
+  DecodableInterface *decodable_;
+  bool computed_;
+  bool success_;
+  bool partial_;
+  fst::VectorFst<LatticeArc> best_path_;
+  CompactLattice *clat_;
+  Lattice *lat_;
+};
+
+BatchedLatticeDecoder::BatchedLatticeDecoder(
+    const fst::Fst<fst::StdArc> &fst,
+    const LatticeFasterDecoderConfig &decoder_config,
+    const TaskSequencerConfig &sequencer_config,
+    const TransitionModel &trans_model,
+    const fst::SymbolTable *word_syms,
+    BaseFloat acoustic_scale,
+    bool determinize,
+    bool allow_partial,
+    Int32VectorWriter *alignments_writer,
+    Int32VectorWriter *words_writer,
+    CompactLatticeWriter *compact_lattice_writer,
+    LatticeWriter *lattice_writer,
+    double *like_sum,
+    int64 *frame_sum,
+    int32 *num_done,
+    int32 *num_err,
+    int32 *num_partial):
+    fst_(fst), decoder_config_(decoder_config), trans_model_(trans_model),
+    word_syms_(word_syms), acoustic_scale_(acoustic_scale),
+    determinize_(determinize), allow_partial_(allow_partial),
+    alignments_writer_(alignments_writer), words_writer_(words_writer),
+    compact_lattice_writer_(compact_lattice_writer),
+    lattice_writer_(lattice_writer),
+    like_sum_(like_sum), frame_sum_(frame_sum), num_done_(num_done),
+    num_err_(num_err), num_partial_(num_partial),
+    sequencer_(new TaskSequencer<UtteranceTask>(sequencer_config)) { }
+
+void BatchedLatticeDecoder::DecodeUtterance(const std::string &utt,
+                                            DecodableInterface *decodable) {
+  // The sequencer takes ownership of the task (and thereby of "decodable"),
+  // and blocks here if all worker threads are busy.
+  sequencer_->Run(new UtteranceTask(this, utt, decodable));
+}
+
+void BatchedLatticeDecoder::Wait() {
+  sequencer_->Wait();
+}
+
+BatchedLatticeDecoder::~BatchedLatticeDecoder() {
+  delete sequencer_;  // waits for any remaining tasks.
+  for (size_t i = 0; i < free_decoders_.size(); i++)
+    delete free_decoders_[i];
+}
+
+LatticeFasterDecoder *BatchedLatticeDecoder::GetDecoder() {
+  LatticeFasterDecoder *ans = NULL;
+  pool_mutex_.Lock();
+  if (!free_decoders_.empty()) {
+    ans = free_decoders_.back();
+    free_decoders_.pop_back();
+  }
+  pool_mutex_.Unlock();
+  if (ans == NULL)  // pool was empty -> this is one of the first utterances.
+    ans = new LatticeFasterDecoder(fst_, decoder_config_);
+  return ans;
+}
+
+void BatchedLatticeDecoder::ReleaseDecoder(LatticeFasterDecoder *decoder) {
+  pool_mutex_.Lock();
+  free_decoders_.push_back(decoder);
+  pool_mutex_.Unlock();
+}
+
+
+// The unit of work that AsyncLatticePostprocessor gives to its
+// TaskSequencer.  operator () does the determinization and rescaling on a
+// worker thread; the destructor, which the TaskSequencer runs on the
+// queueing thread in queueing order, writes all the output and updates the
+// counters.  This mirrors the corresponding parts of
+// BatchedLatticeDecoder::UtteranceTask, except that decoding has already
+// happened by the time this task is created.
+class AsyncLatticePostprocessor::Task {
+ public:
+  // Takes ownership of "lat", which must be non-NULL and connected.
+  Task(AsyncLatticePostprocessor *parent,
+       const std::string &utt,
+       bool partial,
+       const fst::VectorFst<LatticeArc> &best_path,
+       Lattice *lat):
+      parent_(parent), utt_(utt), partial_(partial), best_path_(best_path),
+      clat_(NULL), lat_(lat) { }
+
+  void operator () () {
+    if (parent_->determinize_) {
+      clat_ = new CompactLattice;
+      if (!DeterminizeLatticePhonePrunedWrapper(
+              parent_->trans_model_,
+              lat_,
+              parent_->decoder_config_.lattice_beam,
+              clat_,
+              parent_->decoder_config_.det_opts))
+        KALDI_WARN << "Determinization finished earlier than the beam for "
+                   << "utterance " << utt_;
+      delete lat_;
+      lat_ = NULL;
+      // We'll write the lattice without acoustic scaling.
+      if (parent_->acoustic_scale_ != 0.0)
+        fst::ScaleLattice(fst::AcousticLatticeScale(
+            1.0 / parent_->acoustic_scale_), clat_);
+    } else {
+      // We'll write the lattice without acoustic scaling.
+      if (parent_->acoustic_scale_ != 0.0)
+        fst::ScaleLattice(fst::AcousticLatticeScale(
+            1.0 / parent_->acoustic_scale_), lat_);
+    }
+  }
+
+  ~Task() {
+    double likelihood;
+    LatticeWeight weight;
+    int32 num_frames;
+    { // Word-level traceback, basically for diagnostics.
+      if (best_path_.NumStates() == 0)
+        KALDI_ERR << "Failed to get traceback for utterance " << utt_;
+      std::vector<int32> alignment;
+      std::vector<int32> words;
+      GetLinearSymbolSequence(best_path_, &alignment, &words, &weight);
+      num_frames = alignment.size();
+      if (parent_->words_writer_ != NULL &&
+          parent_->words_writer_->IsOpen())
+        parent_->words_writer_->Write(utt_, words);
+      if (parent_->alignments_writer_ != NULL &&
+          parent_->alignments_writer_->IsOpen())
+        parent_->alignments_writer_->Write(utt_, alignment);
+      if (parent_->word_syms_ != NULL) {
+        std::cerr << utt_ << ' ';
+        for (size_t i = 0; i < words.size(); i++) {
+          std::string s = parent_->word_syms_->Find(words[i]);
+          if (s == "")
+            KALDI_ERR << "Word-id " << words[i] << " not in symbol table.";
+          std::cerr << s << ' ';
+        }
+        std::cerr << '\n';
+      }
+      likelihood = -(weight.Value1() + weight.Value2());
+    }
+    if (parent_->determinize_) {
+      KALDI_ASSERT(parent_->compact_lattice_writer_ != NULL &&
+                   clat_ != NULL);
+      if (clat_->NumStates() == 0)
+        KALDI_WARN << "Empty lattice for utterance " << utt_;
+      else
+        parent_->compact_lattice_writer_->Write(utt_, *clat_);
+      delete clat_;
+      clat_ = NULL;
+    } else {
+      KALDI_ASSERT(parent_->lattice_writer_ != NULL && lat_ != NULL);
+      if (lat_->NumStates() == 0)
+        KALDI_WARN << "Empty lattice for utterance " << utt_;
+      else
+        parent_->lattice_writer_->Write(utt_, *lat_);
+      delete lat_;
+      lat_ = NULL;
+    }
+    KALDI_LOG << "Log-like per frame for utterance " << utt_ << " is "
+              << (likelihood / num_frames) << " over "
+              << num_frames << " frames.";
+    if (parent_->like_sum_ != NULL) *parent_->like_sum_ += likelihood;
+    if (parent_->frame_sum_ != NULL) *parent_->frame_sum_ += num_frames;
+    if (parent_->num_done_ != NULL) (*parent_->num_done_)++;
+    if (partial_ && parent_->num_partial_ != NULL)
+      (*parent_->num_partial_)++;
+  }
+ private:
+  AsyncLatticePostprocessor *parent_;
+  std::string utt_;
+  bool partial_;
+  fst::VectorFst<LatticeArc> best_path_;
+  CompactLattice *clat_;
+  Lattice *lat_;
+};
+
+AsyncLatticePostprocessor::AsyncLatticePostprocessor(
+    const TaskSequencerConfig &sequencer_config,
+    const LatticeFasterDecoderConfig &decoder_config,
+    const TransitionModel &trans_model,
+    const fst::SymbolTable *word_syms,
+    BaseFloat acoustic_scale,
+    bool determinize,
+    Int32VectorWriter *alignments_writer,
+    Int32VectorWriter *words_writer,
+    CompactLatticeWriter *compact_lattice_writer,
+    LatticeWriter *lattice_writer,
+    double *like_sum,
+    int64 *frame_sum,
+    int32 *num_done,
+    int32 *num_err,
+    int32 *num_partial):
+    decoder_config_(decoder_config), trans_model_(trans_model),
+    word_syms_(word_syms), acoustic_scale_(acoustic_scale),
+    determinize_(determinize),
+    alignments_writer_(alignments_writer), words_writer_(words_writer),
+    compact_lattice_writer_(compact_lattice_writer),
+    lattice_writer_(lattice_writer),
+    like_sum_(like_sum), frame_sum_(frame_sum), num_done_(num_done),
+    num_err_(num_err), num_partial_(num_partial),
+    sequencer_(new TaskSequencer<Task>(sequencer_config)) { }
+
+void AsyncLatticePostprocessor::ProcessUtterance(
+    const std::string &utt, bool partial,
+    const fst::VectorFst<LatticeArc> &best_path, Lattice *lat) {
+  KALDI_ASSERT(lat != NULL);
+  // The sequencer takes ownership of the task (and thereby of "lat"), and
+  // blocks here if all worker threads are busy.
+  sequencer_->Run(new Task(this, utt, partial, best_path, lat));
+}
+
+void AsyncLatticePostprocessor::UtteranceFailed() {
+  // This runs on the queueing thread, the same thread that runs the task
+  // destructors, so incrementing the shared counter here is safe.
+  if (num_err_ != NULL) (*num_err_)++;
+}
+
+void AsyncLatticePostprocessor::Wait() {
+  sequencer_->Wait();
+}
+
+AsyncLatticePostprocessor::~AsyncLatticePostprocessor() {
+  delete sequencer_;  // waits for any remaining tasks.
+}
+
+bool DecodeUtteranceLatticeFasterAsync(
+    LatticeFasterDecoder &decoder, // not const but is really an input.
+    DecodableInterface &decodable, // not const but is really an input.
+    std::string utt,
+    bool allow_partial,
+    AsyncLatticePostprocessor *postprocessor) {
+  bool partial = false;
+  if (!decoder.Decode(&decodable)) {
+    KALDI_WARN << "Failed to decode file " << utt;
+    postprocessor->UtteranceFailed();
+    return false;
+  }
+  if (!decoder.ReachedFinal()) {
+    if (allow_partial) {
+      KALDI_WARN << "Outputting partial output for utterance " << utt
+                 << " since no final-state reached\n";
+      partial = true;
+    } else {
+      KALDI_WARN << "Not producing output for utterance " << utt
+                 << " since no final-state reached and "
+                 << "--allow-partial=false.\n";
+      postprocessor->UtteranceFailed();
+      return false;
+    }
+  }
+  // Getting the best path and the raw lattice out of the decoder is cheap
+  // compared to determinization; everything from here on is queued.
+  fst::VectorFst<LatticeArc> best_path;
+  if (!decoder.GetBestPath(&best_path))
+    // Shouldn't really reach this point as already checked success.
+    KALDI_ERR << "Failed to get traceback for utterance " << utt;
+  Lattice *lat = new Lattice;
+  decoder.GetRawLattice(lat);
+  if (lat->NumStates() == 0)
+    KALDI_ERR << "Unexpected problem getting lattice for utterance " << utt;
+  fst::Connect(lat);
+  postprocessor->ProcessUtterance(utt, partial, best_path, lat);
+  return true;
+}
+
+
 // Takes care of output.  Returns true on success.
 bool DecodeUtteranceLatticeFaster(
     LatticeFasterDecoder &decoder, // not const but is really an input.
@@ -291,6 +705,169 @@ bool DecodeUtteranceLatticeFaster(
   return true;
 }
 
+bool DecodeUtteranceLatticeFasterToLattice(
+    LatticeFasterDecoder &decoder, // not const but is really an input.
+    DecodableInterface &decodable, // not const but is really an input.
+    const TransitionModel &trans_model,
+    const fst::SymbolTable *word_syms,
+    std::string utt,
+    double acoustic_scale,
+    bool allow_partial,
+    CompactLattice *clat,
+    double *like_ptr) { // puts utterance's like in like_ptr on success.
+  using fst::VectorFst;
+
+  if (!decoder.Decode(&decodable)) {
+    KALDI_WARN << "Failed to decode file " << utt;
+    return false;
+  }
+  if (!decoder.ReachedFinal()) {
+    if (allow_partial) {
+      KALDI_WARN << "Outputting partial output for utterance " << utt
+                 << " since no final-state reached\n";
+    } else {
+      KALDI_WARN << "Not producing output for utterance " << utt
+                 << " since no final-state reached and "
+                 << "--allow-partial=false.\n";
+      return false;
+    }
+  }
+
+  double likelihood;
+  LatticeWeight weight;
+  int32 num_frames;
+  { // First do some stuff with word-level traceback...
+    VectorFst<LatticeArc> decoded;
+    if (!decoder.GetBestPath(&decoded))
+      // Shouldn't really reach this point as already checked success.
+      KALDI_ERR << "Failed to get traceback for utterance " << utt;
+
+    std::vector<int32> alignment;
+    std::vector<int32> words;
+    GetLinearSymbolSequence(decoded, &alignment, &words, &weight);
+    num_frames = alignment.size();
+    if (word_syms != NULL) {
+      std::cerr << utt << ' ';
+      for (size_t i = 0; i < words.size(); i++) {
+        std::string s = word_syms->Find(words[i]);
+        if (s == "")
+          KALDI_ERR << "Word-id " << words[i] << " not in symbol table.";
+        std::cerr << s << ' ';
+      }
+      std::cerr << '\n';
+    }
+    likelihood = -(weight.Value1() + weight.Value2());
+  }
+
+  // Get the lattice and determinize it.
+  Lattice lat;
+  decoder.GetRawLattice(&lat);
+  if (lat.NumStates() == 0)
+    KALDI_ERR << "Unexpected problem getting lattice for utterance " << utt;
+  fst::Connect(&lat);
+  if (!DeterminizeLatticePhonePrunedWrapper(
+          trans_model,
+          &lat,
+          decoder.GetOptions().lattice_beam,
+          clat,
+          decoder.GetOptions().det_opts))
+    KALDI_WARN << "Determinization finished earlier than the beam for "
+               << "utterance " << utt;
+  // The caller gets the lattice without acoustic scaling.
+  if (acoustic_scale != 0.0)
+    fst::ScaleLattice(fst::AcousticLatticeScale(1.0 / acoustic_scale), clat);
+  KALDI_LOG << "Log-like per frame for utterance " << utt << " is "
+            << (likelihood / num_frames) << " over "
+            << num_frames << " frames.";
+  KALDI_VLOG(2) << "Cost for utterance " << utt << " is "
+                << weight.Value1() << " + " << weight.Value2();
+  *like_ptr = likelihood;
+  return true;
+}
+
+bool DecodeUtteranceLatticeFasterNBest(
+    LatticeFasterDecoder &decoder, // not const but is really an input.
+    DecodableInterface &decodable, // not const but is really an input.
+    const fst::SymbolTable *word_syms,
+    std::string utt,
+    double acoustic_scale,
+    int32 num_best,
+    bool allow_partial,
+    Int32VectorWriter *alignment_writer,
+    Int32VectorWriter *words_writer,
+    CompactLatticeWriter *compact_lattice_writer,
+    double *like_ptr) { // puts utterance's like in like_ptr on success.
+  if (!decoder.Decode(&decodable)) {
+    KALDI_WARN << "Failed to decode file " << utt;
+    return false;
+  }
+  if (!decoder.ReachedFinal()) {
+    if (allow_partial) {
+      KALDI_WARN << "Outputting partial output for utterance " << utt
+                 << " since no final-state reached\n";
+    } else {
+      KALDI_WARN << "Not producing output for utterance " << utt
+                 << " since no final-state reached and "
+                 << "--allow-partial=false.\n";
+      return false;
+    }
+  }
+
+  std::vector<Lattice> nbest;
+  if (!decoder.GetNBestPaths(num_best, &nbest))
+    // Shouldn't really reach this point as already checked success.
+    KALDI_ERR << "Failed to get n-best paths for utterance " << utt;
+
+  double likelihood;
+  LatticeWeight weight;
+  int32 num_frames;
+  { // Word-level traceback of the best path, same as
+    // DecodeUtteranceLatticeFaster() gets from GetBestPath().
+    std::vector<int32> alignment;
+    std::vector<int32> words;
+    GetLinearSymbolSequence(nbest[0], &alignment, &words, &weight);
+    num_frames = alignment.size();
+    if (words_writer->IsOpen())
+      words_writer->Write(utt, words);
+    if (alignment_writer->IsOpen())
+      alignment_writer->Write(utt, alignment);
+    if (word_syms != NULL) {
+      std::cerr << utt << ' ';
+      for (size_t i = 0; i < words.size(); i++) {
+        std::string s = word_syms->Find(words[i]);
+        if (s == "")
+          KALDI_ERR << "Word-id " << words[i] << " not in symbol table.";
+        std::cerr << s << ' ';
+      }
+      std::cerr << '\n';
+    }
+    likelihood = -(weight.Value1() + weight.Value2());
+  }
+
+  if (compact_lattice_writer != NULL && compact_lattice_writer->IsOpen()) {
+    for (size_t k = 0; k < nbest.size(); k++) {
+      // We'll write the paths without acoustic scaling.
+      if (acoustic_scale != 0.0)
+        fst::ScaleLattice(fst::AcousticLatticeScale(1.0 / acoustic_scale),
+                          &(nbest[k]));
+      CompactLattice nbest_clat;
+      ConvertLattice(nbest[k], &nbest_clat);
+      std::ostringstream os;
+      os << utt << "-" << (k + 1);  // so if key is "utt_id", the keys of the
+      // n-best are utt_id-1, utt_id-2, etc., as with lattice-to-nbest.
+      compact_lattice_writer->Write(os.str(), nbest_clat);
+    }
+  }
+  KALDI_LOG << "Log-like per frame for utterance " << utt << " is "
+            << (likelihood / num_frames) << " over "
+            << num_frames << " frames; output " << nbest.size()
+            << " best paths.";
+  KALDI_VLOG(2) << "Cost for utterance " << utt << " is "
+                << weight.Value1() << " + " << weight.Value2();
+  *like_ptr = likelihood;
+  return true;
+}
+
 // Takes care of output.  Returns true on success.
 bool DecodeUtteranceLatticeSimple(
     LatticeSimpleDecoder &decoder, // not const but is really an input.
@@ -419,7 +996,43 @@ void ModifyGraphForCarefulAlignment(
   fst::Concat(fst, fst_rhs);
 }
 
-    
+
+// Called from AlignUtteranceWrapper() when aligning with frame decimation.
+// Looks for frames where the best-token cost grew by more than "threshold"
+// above the average per-frame increment of the first (decimated) pass --
+// places where holding the scores constant evidently fit the data badly --
+// and marks them, padded by "context" frames on each side, in "full_rate".
+// Returns true if any frame was flagged.
+static bool FindLowConfidenceFrames(const DecoderStats &stats,
+                                    BaseFloat threshold,
+                                    int32 context,
+                                    std::vector<bool> *full_rate) {
+  int32 num_frames = stats.NumFramesRetained();
+  if (num_frames < 2) return false;
+  double avg_increment =
+      (stats.RetainedFrame(num_frames - 1).best_cost -
+       stats.RetainedFrame(0).best_cost) / (num_frames - 1);
+  int32 max_frame = stats.RetainedFrame(num_frames - 1).frame;
+  full_rate->clear();
+  full_rate->resize(max_frame + context + 1, false);
+  bool flagged_any = false;
+  for (int32 i = 1; i < num_frames; i++) {
+    double increment = stats.RetainedFrame(i).best_cost -
+        stats.RetainedFrame(i - 1).best_cost;
+    if (increment > avg_increment + threshold) {
+      flagged_any = true;
+      int32 frame = stats.RetainedFrame(i).frame,
+          begin = std::max(frame - context, 0),
+          end = std::min(frame + context,
+                         static_cast<int32>(full_rate->size()) - 1);
+      for (int32 f = begin; f <= end; f++)
+        (*full_rate)[f] = true;
+    }
+  }
+  return flagged_any;
+}
+
+
 void AlignUtteranceWrapper(
     const AlignConfig &config,
     const std::string &utt,
@@ -457,17 +1070,49 @@ void AlignUtteranceWrapper(
   decode_opts.beam = config.beam;
 
   FasterDecoder decoder(*fst, decode_opts);
-  decoder.Decode(decodable);
+
+  // When frame decimation is on, the decoder sees the wrapped decodable,
+  // which scores only every config.frame_decimation'th frame; the wrapper
+  // reports the full number of frames, so the alignment is still
+  // full-length.
+  DecodableDecimated decimated_decodable(
+      decodable, std::max(config.frame_decimation, static_cast<int32>(1)));
+  DecodableInterface *align_decodable = decodable;
+  if (config.frame_decimation > 1)
+    align_decodable = &decimated_decodable;
+
+  if (config.frame_decimation > 1 &&
+      config.decimation_fallback_threshold >= 0.0) {
+    // First pass at the decimated rate, recording the per-frame best-token
+    // cost; regions where that trajectory jumps are places the decimated
+    // scores fit poorly, and get re-decoded at full rate.
+    int32 num_frames = decodable->NumFramesReady();
+    DecoderStats stats(std::max(num_frames, static_cast<int32>(1)));
+    decoder.SetDecoderStats(&stats);
+    decoder.Decode(align_decodable);
+    decoder.SetDecoderStats(NULL);
+    std::vector<bool> full_rate;
+    if (FindLowConfidenceFrames(stats, config.decimation_fallback_threshold,
+                                config.decimation_fallback_context,
+                                &full_rate)) {
+      KALDI_VLOG(2) << "Re-aligning utterance " << utt << " with full-rate "
+                    << "scoring in low-confidence regions.";
+      decimated_decodable.SetFullRateFrames(full_rate);
+      decoder.Decode(align_decodable);
+    }
+  } else {
+    decoder.Decode(align_decodable);
+  }
 
   bool ans = decoder.ReachedFinal();  // consider only final states.
-  
+
   if (!ans && config.retry_beam != 0.0) {
     if (num_retried != NULL) (*num_retried)++;
     KALDI_WARN << "Retrying utterance " << utt << " with beam "
                << config.retry_beam;
     decode_opts.beam = config.retry_beam;
     decoder.SetOptions(decode_opts);
-    decoder.Decode(decodable);
+    decoder.Decode(align_decodable);
     ans = decoder.ReachedFinal();
   }
 
@@ -23,6 +23,8 @@
 #include "itf/options-itf.h"
 #include "decoder/lattice-faster-decoder.h"
 #include "decoder/lattice-simple-decoder.h"
+#include "thread/kaldi-mutex.h"
+#include "thread/kaldi-task-sequence.h"
 
 // This header contains declarations from various convenience functions that are called
 // from binary-level programs such as gmm-decode-faster.cc, gmm-align-compiled.cc, and
@@ -35,8 +37,13 @@ struct AlignConfig {
   BaseFloat beam;
   BaseFloat retry_beam;
   bool careful;
+  int32 frame_decimation;
+  BaseFloat decimation_fallback_threshold;
+  int32 decimation_fallback_context;
 
-  AlignConfig(): beam(200.0), retry_beam(0.0), careful(false) { }
+  AlignConfig(): beam(200.0), retry_beam(0.0), careful(false),
+                 frame_decimation(1), decimation_fallback_threshold(5.0),
+                 decimation_fallback_context(10) { }
 
   void Register(OptionsItf *opts) {
     opts->Register("beam", &beam, "Decoding beam used in alignment");
@@ -45,6 +52,21 @@ struct AlignConfig {
     opts->Register("careful", &careful,
                    "If true, do 'careful' alignment, which is better at detecting "
                    "alignment failure (involves loop to start of decoding graph).");
+    opts->Register("frame-decimation", &frame_decimation,
+                   "If >1, evaluate acoustic scores only on every this-many'th "
+                   "frame during alignment, holding the score constant in "
+                   "between (the alignment itself is still per-frame).  "
+                   "Try 2 or 3.");
+    opts->Register("decimation-fallback-threshold", &decimation_fallback_threshold,
+                   "If >=0 and frame-decimation >1, frames where the best-token "
+                   "cost grows by more than this much above the average "
+                   "per-frame increment trigger a second pass that scores the "
+                   "surrounding region at full rate.  Negative means no "
+                   "fallback pass.");
+    opts->Register("decimation-fallback-context", &decimation_fallback_context,
+                   "Number of frames on each side of a flagged frame that the "
+                   "fallback pass scores at full rate (see "
+                   "--decimation-fallback-threshold).");
   }
 };
 
@@ -109,6 +131,48 @@ bool DecodeUtteranceLatticeFaster(
     LatticeWriter *lattice_writer,
     double *like_ptr);  // puts utterance's likelihood in like_ptr on success.
 
+/// Variant of DecodeUtteranceLatticeFaster that returns the determinized
+/// lattice as an object instead of writing it to a table, for use with an
+/// in-process post-processing pipeline (see lat/lattice-pipeline.h and
+/// gmmbin/gmm-latgen-pipeline.cc).  The lattice comes out with acoustic
+/// scaling undone, exactly as DecodeUtteranceLatticeFaster would have
+/// written it with determinize == true.  Returns false (leaving *clat
+/// unspecified) on decoding failure.
+bool DecodeUtteranceLatticeFasterToLattice(
+    LatticeFasterDecoder &decoder, // not const but is really an input.
+    DecodableInterface &decodable, // not const but is really an input.
+    const TransitionModel &trans_model,
+    const fst::SymbolTable *word_syms, // may be NULL; for debug output.
+    std::string utt,
+    double acoustic_scale,
+    bool allow_partial,
+    CompactLattice *clat,
+    double *like_ptr);  // puts utterance's likelihood in like_ptr on success.
+
+/// Variant of DecodeUtteranceLatticeFaster for the common case where the
+/// caller only wants the 1-best or a small n-best list, not the lattice: it
+/// calls decoder.GetNBestPaths(), which searches the decoder's token
+/// structure directly, so no raw lattice is built and determinization is
+/// skipped entirely.  The n-best entries are written as linear compact
+/// lattices with keys utt-1, utt-2, ..., best first, following the
+/// convention of lattice-to-nbest (fewer than num_best entries are written
+/// if the pruned token structure does not contain that many paths).  The
+/// words and alignment writers get the 1-best path, and will only be
+/// written to if they are open; compact_lattice_writer may be NULL or not
+/// open if only words/alignments are wanted.
+bool DecodeUtteranceLatticeFasterNBest(
+    LatticeFasterDecoder &decoder, // not const but is really an input.
+    DecodableInterface &decodable, // not const but is really an input.
+    const fst::SymbolTable *word_syms,
+    std::string utt,
+    double acoustic_scale,
+    int32 num_best,
+    bool allow_partial,
+    Int32VectorWriter *alignments_writer,
+    Int32VectorWriter *words_writer,
+    CompactLatticeWriter *compact_lattice_writer,
+    double *like_ptr);  // puts utterance's likelihood in like_ptr on success.
+
 /// This class basically does the same job as the function
 /// DecodeUtteranceLatticeFaster, but in a way that allows us
 /// to build a multi-threaded command line program more easily,
@@ -168,6 +232,189 @@ class DecodeUtteranceLatticeFasterClass {
   Lattice *lat_; // Stored output, if determinize_ == false.
 };
 
+/// BatchedLatticeDecoder decodes a sequence of utterances using a pool of
+/// pre-initialized LatticeFasterDecoder objects, all sharing the same decoding
+/// graph (so we bind to HCLG once, and the decoders' internal token pools stay
+/// warm across utterances instead of being torn down per utterance).  This is
+/// intended for servers and binaries that decode many short utterances: you
+/// feed it decodables one at a time with DecodeUtterance(), it runs them on
+/// worker threads (see TaskSequencerConfig, i.e. the --num-threads option),
+/// and the output is written in the order the utterances were provided, as
+/// each one completes.  Compare DecodeUtteranceLatticeFasterClass, which
+/// creates and destroys one decoder per utterance.
+class BatchedLatticeDecoder {
+ public:
+  // The writers that are not needed may be NULL or not open; like_sum,
+  // frame_sum and the counters will (if non-NULL) be added to, not set.
+  // The fst, trans_model and writers must remain valid for the lifetime
+  // of this object.
+  BatchedLatticeDecoder(
+      const fst::Fst<fst::StdArc> &fst,
+      const LatticeFasterDecoderConfig &decoder_config,
+      const TaskSequencerConfig &sequencer_config,
+      const TransitionModel &trans_model,
+      const fst::SymbolTable *word_syms,
+      BaseFloat acoustic_scale,
+      bool determinize,
+      bool allow_partial,
+      Int32VectorWriter *alignments_writer,
+      Int32VectorWriter *words_writer,
+      CompactLatticeWriter *compact_lattice_writer,
+      LatticeWriter *lattice_writer,
+      double *like_sum,
+      int64 *frame_sum,
+      int32 *num_done,
+      int32 *num_err,
+      int32 *num_partial);
+
+  /// Queues one utterance for decoding.  Takes ownership of "decodable", which
+  /// is deleted when the utterance's output has been written.  This will block
+  /// if all worker threads are busy.
+  void DecodeUtterance(const std::string &utt, DecodableInterface *decodable);
+
+  /// Waits for all queued utterances to finish decoding and their output to
+  /// be written.  Called by the destructor, so calling it yourself is only
+  /// needed if you want the diagnostic counters before destruction.
+  void Wait();
+
+  ~BatchedLatticeDecoder();
+ private:
+  class UtteranceTask;  // the unit of work we give to sequencer_; defined in
+                        // decoder-wrappers.cc.
+  friend class UtteranceTask;
+
+  // Gets a free decoder from the pool, creating one if the pool is empty
+  // (the pool size therefore converges to the number of worker threads).
+  LatticeFasterDecoder *GetDecoder();
+  // Returns a decoder to the pool after use.
+  void ReleaseDecoder(LatticeFasterDecoder *decoder);
+
+  const fst::Fst<fst::StdArc> &fst_;
+  LatticeFasterDecoderConfig decoder_config_;
+  const TransitionModel &trans_model_;
+  const fst::SymbolTable *word_syms_;
+  BaseFloat acoustic_scale_;
+  bool determinize_;
+  bool allow_partial_;
+  Int32VectorWriter *alignments_writer_;
+  Int32VectorWriter *words_writer_;
+  CompactLatticeWriter *compact_lattice_writer_;
+  LatticeWriter *lattice_writer_;
+  double *like_sum_;
+  int64 *frame_sum_;
+  int32 *num_done_;
+  int32 *num_err_;
+  int32 *num_partial_;
+
+  Mutex pool_mutex_;  // guards free_decoders_.
+  std::vector<LatticeFasterDecoder*> free_decoders_;
+  TaskSequencer<UtteranceTask> *sequencer_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(BatchedLatticeDecoder);
+};
+
+/// AsyncLatticePostprocessor moves the per-utterance lattice post-processing
+/// (determinization, acoustic rescaling, the word-level traceback output and
+/// the table writes) off the decoding thread of a sequential decode binary:
+/// the decoder hands over the raw lattice and immediately starts on the next
+/// utterance, while a pool of worker threads (--num-threads of the
+/// TaskSequencerConfig) determinizes.  This helps because for lattice-heavy
+/// configurations DeterminizeLatticePhonePrunedWrapper() can take a large
+/// fraction of an utterance's processing time.  Backpressure is inherited
+/// from the TaskSequencer: queueing blocks when all workers are busy, and
+/// the number of finished-but-unwritten lattices is bounded by its
+/// --num-threads-total.  Output is written in the order the utterances were
+/// queued, and the writers and counters are only ever touched from the
+/// queueing thread (the TaskSequencer runs task destructors there), so no
+/// locking is needed around them.  Note that the counters and like_sum /
+/// frame_sum are updated as lattices get written, i.e. with a delay; call
+/// Wait() before reading them.  Normally you would not use this class
+/// directly but call DecodeUtteranceLatticeFasterAsync(), below.
+class AsyncLatticePostprocessor {
+ public:
+  // The writers that are not needed may be NULL or not open; like_sum,
+  // frame_sum and the counters will (if non-NULL) be added to, not set.
+  // decoder_config is needed for the lattice beam and determinization
+  // options; trans_model, word_syms and the writers must remain valid for
+  // the lifetime of this object.
+  AsyncLatticePostprocessor(
+      const TaskSequencerConfig &sequencer_config,
+      const LatticeFasterDecoderConfig &decoder_config,
+      const TransitionModel &trans_model,
+      const fst::SymbolTable *word_syms,
+      BaseFloat acoustic_scale,
+      bool determinize,
+      Int32VectorWriter *alignments_writer,
+      Int32VectorWriter *words_writer,
+      CompactLatticeWriter *compact_lattice_writer,
+      LatticeWriter *lattice_writer,
+      double *like_sum,
+      int64 *frame_sum,
+      int32 *num_done,
+      int32 *num_err,
+      int32 *num_partial);
+
+  /// Queues the post-processing of one utterance.  "best_path" is the
+  /// decoder's best path (copied; used for the words/alignments output and
+  /// the diagnostics); "lat" is the connected raw lattice, of which we take
+  /// ownership.  Blocks if all worker threads are busy.
+  void ProcessUtterance(const std::string &utt,
+                        bool partial,
+                        const fst::VectorFst<LatticeArc> &best_path,
+                        Lattice *lat);
+
+  /// Records a decoding failure, incrementing the num_err counter; called
+  /// by DecodeUtteranceLatticeFasterAsync() so that all the counters are
+  /// maintained in one place.
+  void UtteranceFailed();
+
+  /// Waits for all queued utterances' output to be written.  Called by the
+  /// destructor, so calling it yourself is only needed if you want the
+  /// diagnostic counters before destruction.
+  void Wait();
+
+  ~AsyncLatticePostprocessor();
+ private:
+  class Task;  // the unit of work we give to sequencer_; defined in
+               // decoder-wrappers.cc.
+  friend class Task;
+
+  LatticeFasterDecoderConfig decoder_config_;
+  const TransitionModel &trans_model_;
+  const fst::SymbolTable *word_syms_;
+  BaseFloat acoustic_scale_;
+  bool determinize_;
+  Int32VectorWriter *alignments_writer_;
+  Int32VectorWriter *words_writer_;
+  CompactLatticeWriter *compact_lattice_writer_;
+  LatticeWriter *lattice_writer_;
+  double *like_sum_;
+  int64 *frame_sum_;
+  int32 *num_done_;
+  int32 *num_err_;
+  int32 *num_partial_;
+
+  TaskSequencer<Task> *sequencer_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(AsyncLatticePostprocessor);
+};
+
+/// Variant of DecodeUtteranceLatticeFaster for use with an
+/// AsyncLatticePostprocessor: it runs the decoding and extracts the best
+/// path and raw lattice, but queues the determinization and all the output
+/// on the postprocessor instead of doing them inline, so the caller can
+/// start decoding the next utterance immediately.  Returns true if the
+/// utterance was queued and false if decoding failed (in which case the
+/// postprocessor's num_err counter has been incremented); the num_done /
+/// like_sum etc. counters for queued utterances are updated by the
+/// postprocessor as the lattices get written.
+bool DecodeUtteranceLatticeFasterAsync(
+    LatticeFasterDecoder &decoder, // not const but is really an input.
+    DecodableInterface &decodable, // not const but is really an input.
+    std::string utt,
+    bool allow_partial,
+    AsyncLatticePostprocessor *postprocessor);
+
 // This function DecodeUtteranceLatticeSimple is used in several decoders, and
 // we have moved it here.  Note: this is really "binary-level" code as it
 // involves table readers and writers; we've just put it here as there is no
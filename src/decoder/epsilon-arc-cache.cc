@@ -0,0 +1,66 @@
+// decoder/epsilon-arc-cache.cc
+
+// Copyright 2014   Johns Hopkins University
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "decoder/epsilon-arc-cache.h"
+
+namespace kaldi {
+
+EpsilonArcCache::EpsilonArcCache(const fst::Fst<fst::StdArc> &fst) {
+  // Two passes: the first finds the number of states and of epsilon arcs (so
+  // we can size the arrays exactly), the second fills the index in.
+  StateId num_states = 0;
+  size_t num_eps_arcs = 0;
+  for (fst::StateIterator<fst::Fst<Arc> > siter(fst);
+       !siter.Done(); siter.Next()) {
+    StateId state = siter.Value();
+    if (state + 1 > num_states) num_states = state + 1;
+    for (fst::ArcIterator<fst::Fst<Arc> > aiter(fst, state);
+         !aiter.Done(); aiter.Next())
+      if (aiter.Value().ilabel == 0) num_eps_arcs++;
+  }
+  offsets_.resize(num_states + 1, 0);
+  arcs_.resize(num_eps_arcs);
+  size_t pos = 0;
+  StateId next_offset_state = 0;  // the next state needing its offset set;
+                                  // this handles FSTs with non-contiguous
+                                  // state indices, where some ids are unused.
+  for (fst::StateIterator<fst::Fst<Arc> > siter(fst);
+       !siter.Done(); siter.Next()) {
+    StateId state = siter.Value();
+    while (next_offset_state <= state)
+      offsets_[next_offset_state++] = static_cast<int32>(pos);
+    for (fst::ArcIterator<fst::Fst<Arc> > aiter(fst, state);
+         !aiter.Done(); aiter.Next()) {
+      const Arc &arc = aiter.Value();
+      if (arc.ilabel == 0) {
+        EpsArc &e = arcs_[pos++];
+        e.nextstate = arc.nextstate;
+        e.olabel = arc.olabel;
+        e.weight = arc.weight.Value();
+      }
+    }
+  }
+  while (next_offset_state <= num_states)
+    offsets_[next_offset_state++] = static_cast<int32>(pos);
+  KALDI_ASSERT(pos == num_eps_arcs);
+  KALDI_VLOG(1) << "EpsilonArcCache: indexed " << num_eps_arcs
+                << " epsilon arcs over " << num_states << " states.";
+}
+
+}  // end namespace kaldi.
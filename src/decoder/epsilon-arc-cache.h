@@ -0,0 +1,87 @@
+// decoder/epsilon-arc-cache.h
+
+// Copyright 2014   Johns Hopkins University
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_DECODER_EPSILON_ARC_CACHE_H_
+#define KALDI_DECODER_EPSILON_ARC_CACHE_H_
+
+#include <vector>
+#include "base/kaldi-common.h"
+#include "fst/fstlib.h"
+
+namespace kaldi {
+
+/**
+   EpsilonArcCache is a per-FST index of the input-epsilon arcs of a decoding
+   graph, stored contiguously in CSR-like form (a flat arc array plus
+   per-state offsets).  The epsilon structure of HCLG never changes, but
+   ProcessNonemitting() in the decoders re-traverses it every frame through a
+   virtual ArcIterator that also has to skip over all the emitting arcs; on
+   typical graphs epsilon processing is a substantial fraction of decode time.
+   With this index, a state with no epsilon arcs costs one contiguous array
+   lookup, and the epsilon arcs of a state are read from consecutive memory.
+
+   We keep the individual arcs (with their output labels and weights) rather
+   than flattening each state's full epsilon closure, because the decoders
+   that generate lattices need one forward link per traversed epsilon arc to
+   preserve word labels on the lattice.
+
+   The index is built once, in the constructor, by scanning the whole FST; it
+   is immutable afterwards, so one instance can be shared (e.g. by pointer)
+   between any number of decoders and threads using the same FST.  For a
+   single short decode the scan may not pay for itself; the intended use is
+   long-running or multi-utterance decoding against a fixed graph.  See
+   LatticeFasterDecoder::SetEpsilonArcCache().
+ */
+class EpsilonArcCache {
+ public:
+  typedef fst::StdArc Arc;
+  typedef Arc::Label Label;
+  typedef Arc::StateId StateId;
+
+  // What we keep per epsilon arc; the ilabel is zero by definition.
+  struct EpsArc {
+    StateId nextstate;
+    Label olabel;
+    BaseFloat weight;
+  };
+
+  // Scans all states of "fst" and builds the index.  The fst is not kept.
+  explicit EpsilonArcCache(const fst::Fst<fst::StdArc> &fst);
+
+  // Returns a pointer to the contiguous epsilon arcs leaving "state" and
+  // puts their number in *num_arcs (zero for most states of a typical HCLG,
+  // in which case the returned pointer should not be dereferenced).
+  inline const EpsArc *GetArcs(StateId state, size_t *num_arcs) const {
+    KALDI_PARANOID_ASSERT(static_cast<size_t>(state) + 1 < offsets_.size());
+    int32 offset = offsets_[state];
+    *num_arcs = offsets_[state + 1] - offset;
+    return &(arcs_[0]) + offset;
+  }
+
+ private:
+  std::vector<int32> offsets_;  // of size num-states + 1; state s's epsilon
+                                // arcs are arcs_[offsets_[s] ... offsets_[s+1]).
+  std::vector<EpsArc> arcs_;    // all epsilon arcs, grouped by state.
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(EpsilonArcCache);
+};
+
+}  // end namespace kaldi.
+
+#endif  // KALDI_DECODER_EPSILON_ARC_CACHE_H_
@@ -18,6 +18,7 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include "base/timer.h"
 #include "decoder/faster-decoder.h"
 
 namespace kaldi {
@@ -25,7 +26,9 @@ namespace kaldi {
 
 FasterDecoder::FasterDecoder(const fst::Fst<fst::StdArc> &fst,
                              const FasterDecoderOptions &opts):
-    fst_(fst), config_(opts), num_frames_decoded_(-1) {
+    fst_(fst), config_(opts), num_frames_decoded_(-1),
+    effective_beam_(opts.beam), token_history_pos_(0),
+    stats_(NULL), stats_tok_cnt_(0) {
   KALDI_ASSERT(config_.hash_ratio >= 1.0);  // less doesn't make much sense.
   KALDI_ASSERT(config_.max_active > 1);
   KALDI_ASSERT(config_.min_active >= 0 && config_.min_active < config_.max_active);
@@ -36,6 +39,9 @@ FasterDecoder::FasterDecoder(const fst::Fst<fst::StdArc> &fst,
 void FasterDecoder::InitDecoding() {
   // clean up from last time:
   ClearToks(toks_.Clear());
+  effective_beam_ = config_.beam;
+  token_history_.clear();
+  token_history_pos_ = 0;
   StateId start_state = fst_.Start();
   KALDI_ASSERT(start_state != fst::kNoStateId);
   Arc dummy_arc(0, 0, Weight::One(), start_state);
@@ -152,22 +158,34 @@ double FasterDecoder::GetCutoff(Elem *list_head, size_t *tok_count,
                                 BaseFloat *adaptive_beam, Elem **best_elem) {
   double best_cost = std::numeric_limits<double>::infinity();
   size_t count = 0;
+  // While walking the token list we also gather the structure-of-arrays
+  // copy of the tokens that ProcessEmitting() will iterate over.
+  prev_states_.clear();
+  prev_toks_.clear();
+  prev_costs_.clear();
   if (config_.max_active == std::numeric_limits<int32>::max() &&
       config_.min_active == 0) {
     for (Elem *e = list_head; e != NULL; e = e->tail, count++) {
       double w = e->val->cost_;
+      prev_states_.push_back(e->key);
+      prev_toks_.push_back(e->val);
+      prev_costs_.push_back(w);
       if (w < best_cost) {
         best_cost = w;
         if (best_elem) *best_elem = e;
       }
     }
     if (tok_count != NULL) *tok_count = count;
-    if (adaptive_beam != NULL) *adaptive_beam = config_.beam;
-    return best_cost + config_.beam;
+    if (adaptive_beam != NULL) *adaptive_beam = effective_beam_;
+    if (stats_ != NULL) stats_->RecordBestCost(best_cost);
+    return best_cost + effective_beam_;
   } else {
     tmp_array_.clear();
     for (Elem *e = list_head; e != NULL; e = e->tail, count++) {
       double w = e->val->cost_;
+      prev_states_.push_back(e->key);
+      prev_toks_.push_back(e->val);
+      prev_costs_.push_back(w);
       tmp_array_.push_back(w);
       if (w < best_cost) {
         best_cost = w;
@@ -175,7 +193,8 @@ double FasterDecoder::GetCutoff(Elem *list_head, size_t *tok_count,
       }
     }
     if (tok_count != NULL) *tok_count = count;
-    double beam_cutoff = best_cost + config_.beam,
+    if (stats_ != NULL) stats_->RecordBestCost(best_cost);
+    double beam_cutoff = best_cost + effective_beam_,
         min_active_cutoff = std::numeric_limits<double>::infinity(),
         max_active_cutoff = std::numeric_limits<double>::infinity();
     
@@ -206,12 +225,52 @@ double FasterDecoder::GetCutoff(Elem *list_head, size_t *tok_count,
         *adaptive_beam = min_active_cutoff - best_cost + config_.beam_delta;
       return min_active_cutoff;
     } else {
-      *adaptive_beam = config_.beam;
+      *adaptive_beam = effective_beam_;
       return beam_cutoff;
     }
   }
 }
 
+// See the comment by this function's declaration in the header for what it
+// does.  This is a simple multiplicative-decrease / additive-ish-increase
+// controller: over budget -> beam *= 0.9 (but not below min_beam); under
+// budget with some headroom -> beam *= 1.05 (but not above config_.beam).
+void FasterDecoder::UpdateBeamController(size_t tok_cnt,
+                                         double frame_seconds) {
+  const size_t kWindow = 10;  // frames of history we average over.
+  if (token_history_.size() < kWindow)
+    token_history_.resize(kWindow, 0);
+  token_history_[token_history_pos_ % kWindow] = tok_cnt;
+  token_history_pos_++;
+  size_t num_valid = std::min(token_history_pos_, kWindow);
+  double avg_toks = 0.0;
+  for (size_t i = 0; i < num_valid; i++)
+    avg_toks += token_history_[i];
+  avg_toks /= num_valid;
+
+  bool over_budget =
+      (config_.target_tokens_per_frame > 0 &&
+       avg_toks > config_.target_tokens_per_frame) ||
+      (config_.frame_time_budget > 0.0 &&
+       frame_seconds > config_.frame_time_budget);
+  bool under_budget =
+      (config_.target_tokens_per_frame <= 0 ||
+       avg_toks < 0.8 * config_.target_tokens_per_frame) &&
+      (config_.frame_time_budget <= 0.0 ||
+       frame_seconds < 0.8 * config_.frame_time_budget);
+  if (over_budget) {
+    BaseFloat new_beam = std::max(config_.min_beam,
+                                  effective_beam_ * 0.9f);
+    if (new_beam != effective_beam_)
+      KALDI_VLOG(3) << "Beam controller: tightening beam from "
+                    << effective_beam_ << " to " << new_beam
+                    << " on frame " << num_frames_decoded_;
+    effective_beam_ = new_beam;
+  } else if (under_budget && effective_beam_ < config_.beam) {
+    effective_beam_ = std::min(config_.beam, effective_beam_ * 1.05f);
+  }
+}
+
 void FasterDecoder::PossiblyResizeHash(size_t num_toks) {
   size_t new_sz = static_cast<size_t>(static_cast<BaseFloat>(num_toks)
                                       * config_.hash_ratio);
@@ -222,7 +281,9 @@ void FasterDecoder::PossiblyResizeHash(size_t num_toks) {
 
 // ProcessEmitting returns the likelihood cutoff used.
 double FasterDecoder::ProcessEmitting(DecodableInterface *decodable) {
+  Timer frame_timer;  // only inspected by the beam controller, below.
   int32 frame = num_frames_decoded_;
+  if (stats_ != NULL) stats_->BeginFrame(frame);
   Elem *last_toks = toks_.Clear();
   size_t tok_cnt;
   BaseFloat adaptive_beam;
@@ -230,6 +291,10 @@ double FasterDecoder::ProcessEmitting(DecodableInterface *decodable) {
   double weight_cutoff = GetCutoff(last_toks, &tok_cnt,
                                    &adaptive_beam, &best_elem);
   KALDI_VLOG(3) << tok_cnt << " tokens active.";
+  if (stats_ != NULL) {
+    stats_->RecordBeam(adaptive_beam);
+    stats_tok_cnt_ = tok_cnt;
+  }
   PossiblyResizeHash(tok_cnt);  // This makes sure the hash is always big enough.
     
   // This is the cutoff we use after adding in the log-likes (i.e.
@@ -255,19 +320,17 @@ double FasterDecoder::ProcessEmitting(DecodableInterface *decodable) {
     }
   }
 
-  // int32 n = 0, np = 0;
-
-  // the tokens are now owned here, in last_toks, and the hash is empty.
-  // 'owned' is a complex thing here; the point is we need to call TokenDelete
-  // on each elem 'e' to let toks_ know we're done with them.
-  for (Elem *e = last_toks, *e_tail; e != NULL; e = e_tail) {  // loop this way
-    // n++;
-    // because we delete "e" as we go.
-    StateId state = e->key;
-    Token *tok = e->val;
-    if (tok->cost_ < weight_cutoff) {  // not pruned.
-      // np++;
+  // The tokens are now owned in last_toks, and the hash is empty; we iterate
+  // over the structure-of-arrays copy of them gathered by GetCutoff() (see
+  // the comment by prev_costs_ in the header): the cutoff test below scans a
+  // flat array of costs, and pruned tokens are never touched.
+  size_t num_prev = prev_costs_.size();
+  for (size_t i = 0; i < num_prev; i++) {
+    if (prev_costs_[i] < weight_cutoff) {  // not pruned.
+      StateId state = prev_states_[i];
+      Token *tok = prev_toks_[i];
       KALDI_ASSERT(state == tok->arc_.nextstate);
+      if (stats_ != NULL) stats_->RecordStateVisit(state);
       for (fst::ArcIterator<fst::Fst<Arc> > aiter(fst_, state);
            !aiter.Done();
            aiter.Next()) {
@@ -294,11 +357,17 @@ double FasterDecoder::ProcessEmitting(DecodableInterface *decodable) {
         }
       }
     }
+  }
+  // We need to call TokenDelete on each Elem's token to let toks_ know we're
+  // done with them, and return the Elems themselves for reuse.
+  for (Elem *e = last_toks, *e_tail; e != NULL; e = e_tail) {
     e_tail = e->tail;
     Token::TokenDelete(e->val);
     toks_.Delete(e);
   }
   num_frames_decoded_++;
+  if (config_.target_tokens_per_frame > 0 || config_.frame_time_budget > 0.0)
+    UpdateBeamController(tok_cnt, frame_timer.Elapsed());
   return next_weight_cutoff;
 }
 
@@ -343,6 +412,7 @@ void FasterDecoder::ProcessNonemitting(double cutoff) {
       }
     }
   }
+  if (stats_ != NULL) stats_->EndFrame(stats_tok_cnt_);
 }
 
 void FasterDecoder::ClearToks(Elem *list) {
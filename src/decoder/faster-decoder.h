@@ -24,6 +24,7 @@
 #include "util/stl-utils.h"
 #include "itf/options-itf.h"
 #include "util/hash-list.h"
+#include "decoder/decoder-stats.h"
 #include "fst/fstlib.h"
 #include "itf/decodable-itf.h"
 #include "lat/kaldi-lattice.h" // for CompactLatticeArc
@@ -36,12 +37,27 @@ struct FasterDecoderOptions {
   int32 min_active;
   BaseFloat beam_delta;
   BaseFloat hash_ratio;
+  // The following three options control the predictive beam controller (see
+  // the comment by FasterDecoder::UpdateBeamController()).  The difference
+  // from max-active is that max-active reacts within a frame, after the
+  // tokens have already been created; the controller tightens the beam for
+  // future frames before a frame blows up, which matters for real-time
+  // decoding with per-frame deadlines.  Disabled by default.
+  int32 target_tokens_per_frame;  // if > 0, tighten the beam when the recent
+                                  // average token count exceeds this.
+  BaseFloat frame_time_budget;    // in seconds; if > 0, tighten the beam
+                                  // when a frame's wall time exceeds this.
+  BaseFloat min_beam;             // floor below which the controller will
+                                  // not tighten the beam.
   FasterDecoderOptions(): beam(16.0),
                           max_active(std::numeric_limits<int32>::max()),
                           min_active(20), // This decoder mostly used for
                                           // alignment, use small default.
                           beam_delta(0.5),
-                          hash_ratio(2.0) { }
+                          hash_ratio(2.0),
+                          target_tokens_per_frame(0),
+                          frame_time_budget(0.0),
+                          min_beam(4.0) { }
   void Register(OptionsItf *opts, bool full) {  /// if "full", use obscure
     /// options too.
     /// Depends on program.
@@ -49,11 +65,20 @@ struct FasterDecoderOptions {
     opts->Register("max-active", &max_active, "Decoder max active states.");
     opts->Register("min-active", &min_active,
                    "Decoder min active states (don't prune if #active less than this).");
+    opts->Register("target-tokens-per-frame", &target_tokens_per_frame,
+                   "If > 0, predictively tighten the beam when the rolling "
+                   "average of active tokens per frame exceeds this budget.");
+    opts->Register("frame-time-budget", &frame_time_budget,
+                   "If > 0, wall-time budget per frame in seconds; the beam "
+                   "is tightened when a frame exceeds it.");
     if (full) {
       opts->Register("beam-delta", &beam_delta,
                      "Increment used in decoder [obscure setting]");
       opts->Register("hash-ratio", &hash_ratio,
                      "Setting used in decoder to control hash behavior");
+      opts->Register("min-beam", &min_beam,
+                     "Floor on the beam used by the predictive beam "
+                     "controller [obscure setting]");
     }
   }
 };
@@ -69,6 +94,12 @@ class FasterDecoder {
                 const FasterDecoderOptions &config);
 
   void SetOptions(const FasterDecoderOptions &config) { config_ = config; }
+
+  /// Attaches an optional per-frame instrumentation object (see
+  /// decoder-stats.h) recording frame times, token counts and the beam in
+  /// use.  Not owned here; NULL (the default) disables recording, leaving
+  /// only a pointer test per frame.
+  void SetDecoderStats(DecoderStats *stats) { stats_ = stats; }
   
   ~FasterDecoder() { ClearToks(toks_.Clear()); }
 
@@ -160,6 +191,16 @@ class FasterDecoder {
   // and then increments num_frames_decoded_
   double ProcessEmitting(DecodableInterface *decodable);
 
+  // The predictive beam controller, called at the end of each
+  // ProcessEmitting() if target_tokens_per_frame or frame_time_budget is
+  // set.  It keeps a rolling window of recent per-frame token counts, and
+  // tightens effective_beam_ (multiplicatively, before the budget is
+  // actually blown) when the rolling average exceeds the token budget or
+  // the frame's wall time exceeds the time budget; when comfortably under
+  // budget it relaxes the beam back toward config_.beam.  The beam never
+  // goes below config_.min_beam.
+  void UpdateBeamController(size_t tok_cnt, double frame_seconds);
+
   // TODO: first time we go through this, could avoid using the queue.
   void ProcessNonemitting(double cutoff);
 
@@ -173,9 +214,33 @@ class FasterDecoder {
   std::vector<BaseFloat> tmp_array_;  // used in GetCutoff.
   // make it class member to avoid internal new/delete.
 
+  // Structure-of-arrays copy of the previous frame's tokens, filled in by
+  // GetCutoff() (which has to walk the token list anyway) and iterated by
+  // ProcessEmitting().  Keeping states, token pointers and costs in separate
+  // flat arrays means the pruning test in ProcessEmitting() scans a
+  // contiguous array of costs instead of chasing Elem and Token pointers for
+  // tokens that get pruned anyway; with tight beams most tokens are pruned,
+  // and those never get their Token touched at all.
+  std::vector<StateId> prev_states_;
+  std::vector<Token*> prev_toks_;
+  std::vector<double> prev_costs_;
+
   // Keep track of the number of frames decoded in the current file.
   int32 num_frames_decoded_;
 
+  // The beam actually used by GetCutoff(); equals config_.beam unless the
+  // predictive beam controller has tightened it.  Reset in InitDecoding().
+  BaseFloat effective_beam_;
+  // Rolling window of recent per-frame token counts, used by
+  // UpdateBeamController(); token_history_pos_ counts frames so far.
+  std::vector<size_t> token_history_;
+  size_t token_history_pos_;
+
+  DecoderStats *stats_;  // optional instrumentation, or NULL; not owned
+                         // here.  See SetDecoderStats().
+  size_t stats_tok_cnt_;  // token count of the frame being recorded; passed
+                          // from ProcessEmitting() to ProcessNonemitting().
+
   // It might seem unclear why we call ClearToks(toks_.Clear()).
   // There are two separate cleanup tasks we need to do at when we start a new file.
   // one is to delete the Token objects in the list; the other is to delete
@@ -28,6 +28,7 @@
 #include "itf/decodable-itf.h"
 #include "fstext/fstext-lib.h"
 #include "lat/kaldi-lattice.h"
+#include "decoder/biglm-lookahead.h"
 #include "decoder/lattice-faster-decoder.h" // for options.
 
 
@@ -58,14 +59,25 @@ class LatticeBiglmFasterDecoder {
       const fst::Fst<fst::StdArc> &fst,      
       const LatticeBiglmFasterDecoderConfig &config,
       fst::DeterministicOnDemandFst<fst::StdArc> *lm_diff_fst):
-      fst_(fst), lm_diff_fst_(lm_diff_fst), config_(config),
-      warned_noarc_(false), num_toks_(0) {
+      fst_(fst), lm_diff_fst_(lm_diff_fst), lookahead_(NULL),
+      config_(config), warned_noarc_(false), num_toks_(0) {
     config.Check();
     KALDI_ASSERT(fst.Start() != fst::kNoStateId &&
                  lm_diff_fst->Start() != fst::kNoStateId);
     toks_.SetSize(1000);  // just so on the first frame we do something reasonable.
   }
-  void SetOptions(const LatticeBiglmFasterDecoderConfig &config) { config_ = config; } 
+  void SetOptions(const LatticeBiglmFasterDecoderConfig &config) { config_ = config; }
+
+  /// Provides a label-lookahead index over "fst" (see biglm-lookahead.h);
+  /// if set, (graph-state, lm-state) pairs from which no reachable word is
+  /// accepted by the LM, or whose anticipated LM cost puts them outside the
+  /// beam, are pruned before token creation.  The index must have been built
+  /// from the same FST this decoder uses, and must outlive the decoder; it
+  /// can be shared by decoders on the same graph and LM-difference FST (but
+  /// see BiglmLookahead::ClearCache() if the latter changes).  Passing NULL
+  /// disables lookahead (the default).
+  void SetLookahead(BiglmLookahead *lookahead) { lookahead_ = lookahead; }
+
   LatticeBiglmFasterDecoderConfig GetOptions() { return config_; } 
   ~LatticeBiglmFasterDecoder() {
     DeleteElems(toks_.Clear());    
@@ -743,6 +755,11 @@ class LatticeBiglmFasterDecoder {
             if (tot_cost > next_cutoff) continue;
             else if (tot_cost + config_.beam < next_cutoff)
               next_cutoff = tot_cost + config_.beam; // prune by best current token
+            if (lookahead_ != NULL &&
+                tot_cost + lookahead_->LookaheadCost(arc.nextstate,
+                                                     next_lm_state,
+                                                     lm_diff_fst_) > next_cutoff)
+              continue; // LM dead end, or anticipated LM cost outside beam.
             PairId next_pair = ConstructPair(arc.nextstate, next_lm_state);
             Token *next_tok = FindOrAddToken(next_pair, frame, tot_cost, true, NULL);
             // true: emitting, NULL: no change indicator needed
@@ -810,6 +827,11 @@ class LatticeBiglmFasterDecoder {
           BaseFloat graph_cost = arc.weight.Value(),
               tot_cost = cur_cost + graph_cost;
           if (tot_cost < cutoff) {
+            if (lookahead_ != NULL &&
+                tot_cost + lookahead_->LookaheadCost(arc.nextstate,
+                                                     next_lm_state,
+                                                     lm_diff_fst_) > cutoff)
+              continue; // LM dead end, or anticipated LM cost outside beam.
             bool changed;
             PairId next_pair = ConstructPair(arc.nextstate, next_lm_state);
             Token *new_tok = FindOrAddToken(next_pair, frame, tot_cost,
@@ -839,7 +861,9 @@ class LatticeBiglmFasterDecoder {
   std::vector<BaseFloat> tmp_array_;  // used in GetCutoff.
   // make it class member to avoid internal new/delete.
   const fst::Fst<fst::StdArc> &fst_;
-  fst::DeterministicOnDemandFst<fst::StdArc> *lm_diff_fst_;  
+  fst::DeterministicOnDemandFst<fst::StdArc> *lm_diff_fst_;
+  BiglmLookahead *lookahead_;  // label-lookahead index of fst_, or NULL; not
+                               // owned here.  See SetLookahead().
   LatticeBiglmFasterDecoderConfig config_;
   bool warned_noarc_;  
   int32 num_toks_; // current total #toks allocated...
@@ -24,15 +24,24 @@
 // after committing the changes to this file, using the command
 // svn merge ^/sandbox/online/src/decoder/lattice-faster-decoder.cc lattice-faster-online-decoder.cc
 
+#include <queue>
+
 #include "decoder/lattice-faster-decoder.h"
+#include "fstext/mapped-fst.h"
 #include "lat/lattice-functions.h"
+#include "thread/kaldi-thread.h"
+#include "thread/kaldi-profiler.h"
 
 namespace kaldi {
 
+const uint32 LatticeFasterDecoder::kNoLink;
+
 // instantiate this class once for each thing you have to decode.
 LatticeFasterDecoder::LatticeFasterDecoder(const fst::Fst<fst::StdArc> &fst,
                                            const LatticeFasterDecoderConfig &config):
-    fst_(fst), delete_fst_(false), config_(config), num_toks_(0) {
+    fst_(fst), delete_fst_(false), eps_cache_(NULL), stats_(NULL),
+    prefetch_fst_(dynamic_cast<const fst::PrefetchableFst*>(&fst)),
+    config_(config), num_toks_(0), num_links_pruned_(0), prune_cursor_(-1) {
   config.Check();
   toks_.SetSize(1000);  // just so on the first frame we do something reasonable.
 }
@@ -40,7 +49,9 @@ LatticeFasterDecoder::LatticeFasterDecoder(const fst::Fst<fst::StdArc> &fst,
 
 LatticeFasterDecoder::LatticeFasterDecoder(const LatticeFasterDecoderConfig &config,
                                            fst::Fst<fst::StdArc> *fst):
-    fst_(*fst), delete_fst_(true), config_(config), num_toks_(0) {
+    fst_(*fst), delete_fst_(true), eps_cache_(NULL), stats_(NULL),
+    prefetch_fst_(dynamic_cast<const fst::PrefetchableFst*>(fst)),
+    config_(config), num_toks_(0), num_links_pruned_(0), prune_cursor_(-1) {
   config.Check();
   toks_.SetSize(1000);  // just so on the first frame we do something reasonable.
 }
@@ -59,12 +70,16 @@ void LatticeFasterDecoder::InitDecoding() {
   ClearActiveTokens();
   warned_ = false;
   num_toks_ = 0;
+  num_links_pruned_ = 0;
+  prune_cursor_ = -1;
   decoding_finalized_ = false;
   final_costs_.clear();
   StateId start_state = fst_.Start();
   KALDI_ASSERT(start_state != fst::kNoStateId);
   active_toks_.resize(1);
-  Token *start_tok = new Token(0.0, 0.0, NULL, NULL);
+  Token *start_tok = new (token_pool_.Malloc()) Token(0.0, 0.0, NULL, NULL);
+  if (config_.compact_links)
+    start_tok->compact_links = kNoLink;  // the "empty list" in compact mode.
   active_toks_[0].toks = start_tok;
   toks_.Insert(start_state, start_tok);
   num_toks_++;
@@ -82,7 +97,9 @@ bool LatticeFasterDecoder::Decode(DecodableInterface *decodable) {
   // numbering, which we have to correct for when we call it.
 
   while (!decodable->IsLastFrame(NumFramesDecoded() - 1)) {
-    if (NumFramesDecoded() % config_.prune_interval == 0)
+    if (config_.prune_frames_per_step > 0)
+      PruneActiveTokensIncremental(config_.lattice_beam * config_.prune_scale);
+    else if (NumFramesDecoded() % config_.prune_interval == 0)
       PruneActiveTokens(config_.lattice_beam * config_.prune_scale);
     BaseFloat cost_cutoff = ProcessEmitting(decodable);
     ProcessNonemitting(cost_cutoff);
@@ -104,6 +121,200 @@ bool LatticeFasterDecoder::GetBestPath(Lattice *olat,
   return (olat->NumStates() != 0);
 }
 
+// Outputs the n best paths, searched directly over the token structure.
+bool LatticeFasterDecoder::GetNBestPaths(int32 n,
+                                         std::vector<Lattice> *nbest_out,
+                                         bool use_final_probs) const {
+  typedef LatticeArc Arc;
+  typedef Arc::StateId StateId;
+  typedef Arc::Weight Weight;
+
+  nbest_out->clear();
+  KALDI_ASSERT(n > 0);
+  // See the comment in GetRawLattice() about this restriction.
+  if (decoding_finalized_ && !use_final_probs)
+    KALDI_ERR << "You cannot call FinalizeDecoding() and then call "
+              << "GetNBestPaths() with use_final_probs == false";
+
+  unordered_map<Token*, BaseFloat> final_costs_local;
+  const unordered_map<Token*, BaseFloat> &final_costs =
+      (decoding_finalized_ ? final_costs_ : final_costs_local);
+  if (!decoding_finalized_ && use_final_probs)
+    ComputeFinalCosts(&final_costs_local, NULL, NULL);
+
+  int32 num_frames = active_toks_.size() - 1;
+  KALDI_ASSERT(num_frames > 0);
+  const double infinity = std::numeric_limits<double>::infinity();
+  // As in GetRawLattice(): if we did not reach a final state (or were asked
+  // not to use final-probs), all tokens on the last frame count as final.
+  bool treat_all_final = (!use_final_probs || final_costs.empty());
+
+  // First compute the exact backward (completion) cost of every token, frame
+  // by frame from the end; within a frame the tokens are processed in
+  // reverse topological order, so the epsilon links to later tokens on the
+  // same frame are already resolved when we need them.  These are the
+  // heuristic for the A* search below; because they are exact, the search
+  // emits complete paths in order of increasing cost.
+  unordered_map<Token*, double> backward_cost(num_toks_/2 + 3);
+  std::vector<Token*> token_list;
+  for (int32 f = num_frames; f >= 0; f--) {
+    if (active_toks_[f].toks == NULL) {
+      KALDI_WARN << "GetNBestPaths: no tokens active on frame " << f
+                 << ": not producing output.\n";
+      return false;
+    }
+    TopSortTokens(active_toks_[f].toks, &token_list);
+    for (int32 i = static_cast<int32>(token_list.size()) - 1; i >= 0; i--) {
+      Token *tok = token_list[i];
+      if (tok == NULL) continue;
+      double cost = infinity;
+      if (f == num_frames) {
+        if (treat_all_final) {
+          cost = 0.0;
+        } else {
+          unordered_map<Token*, BaseFloat>::const_iterator iter =
+              final_costs.find(tok);
+          if (iter != final_costs.end())
+            cost = iter->second;
+        }
+      }
+      for (ForwardLinkIterator link(*this, tok); !link.Done(); link.Next()) {
+        unordered_map<Token*, double>::const_iterator iter =
+            backward_cost.find(link.NextTok());
+        if (iter == backward_cost.end() || iter->second == infinity)
+          continue;
+        BaseFloat cost_offset = 0.0;
+        if (link.Ilabel() != 0) {  // emitting; undo the per-frame offset.
+          KALDI_ASSERT(f >= 0 && f < cost_offsets_.size());
+          cost_offset = cost_offsets_[f];
+        }
+        double this_cost = link.GraphCost()
+            + (link.AcousticCost() - cost_offset) + iter->second;
+        if (this_cost < cost)
+          cost = this_cost;
+      }
+      backward_cost[tok] = cost;
+    }
+  }
+  // token_list now holds the frame-zero tokens in topological order, whose
+  // first element is the token at the start state of the graph.
+  Token *start_tok = NULL;
+  for (size_t i = 0; i < token_list.size() && start_tok == NULL; i++)
+    start_tok = token_list[i];
+  KALDI_ASSERT(start_tok != NULL);
+  if (backward_cost[start_tok] == infinity)
+    return false;  // no complete path survived the pruning.
+
+  // The A* search.  Partial paths live in "nodes" (which functions as the
+  // pool and the back-pointer structure); the queue orders them by forward
+  // cost plus exact completion cost.  Popping a node with tok == NULL means
+  // a path is complete.  Each token may appear in at most n popped partial
+  // paths: with an exact heuristic this cannot lose any of the n best
+  // paths, and it bounds the work on dense token structures.
+  std::vector<NBestSearchNode> nodes;
+  typedef std::pair<double, int32> QueueElem;  // (total cost, node index).
+  std::priority_queue<QueueElem, std::vector<QueueElem>,
+                      std::greater<QueueElem> > queue;
+  unordered_map<Token*, int32> num_expansions;
+  std::vector<int32> completed;
+
+  NBestSearchNode start_node;
+  start_node.tok = start_tok;
+  start_node.frame = 0;
+  start_node.parent = -1;
+  start_node.ilabel = 0;
+  start_node.olabel = 0;
+  start_node.graph_cost = 0.0;
+  start_node.acoustic_cost = 0.0;
+  start_node.cost = 0.0;
+  nodes.push_back(start_node);
+  queue.push(QueueElem(backward_cost[start_tok], 0));
+
+  while (!queue.empty() && static_cast<int32>(completed.size()) < n) {
+    int32 node_index = queue.top().second;
+    queue.pop();
+    // Copy what we need: pushing to "nodes" below may reallocate it.
+    Token *tok = nodes[node_index].tok;
+    int32 frame = nodes[node_index].frame;
+    double cost = nodes[node_index].cost;
+    if (tok == NULL) {  // a completed path.
+      completed.push_back(node_index);
+      continue;
+    }
+    int32 &expansions = num_expansions[tok];
+    if (expansions >= n)
+      continue;
+    expansions++;
+    if (frame == num_frames) {
+      double final_cost = infinity;
+      if (treat_all_final) {
+        final_cost = 0.0;
+      } else {
+        unordered_map<Token*, BaseFloat>::const_iterator iter =
+            final_costs.find(tok);
+        if (iter != final_costs.end())
+          final_cost = iter->second;
+      }
+      if (final_cost != infinity) {
+        NBestSearchNode node;
+        node.tok = NULL;
+        node.frame = frame;
+        node.parent = node_index;
+        node.ilabel = 0;
+        node.olabel = 0;
+        node.graph_cost = final_cost;  // becomes the final weight.
+        node.acoustic_cost = 0.0;
+        node.cost = cost + final_cost;
+        nodes.push_back(node);
+        queue.push(QueueElem(node.cost, static_cast<int32>(nodes.size()) - 1));
+      }
+    }
+    for (ForwardLinkIterator link(*this, tok); !link.Done(); link.Next()) {
+      unordered_map<Token*, double>::const_iterator iter =
+          backward_cost.find(link.NextTok());
+      if (iter == backward_cost.end() || iter->second == infinity)
+        continue;
+      BaseFloat cost_offset =
+          (link.Ilabel() != 0 ? cost_offsets_[frame] : 0.0);
+      NBestSearchNode node;
+      node.tok = link.NextTok();
+      node.frame = frame + (link.Ilabel() != 0 ? 1 : 0);
+      node.parent = node_index;
+      node.ilabel = link.Ilabel();
+      node.olabel = link.Olabel();
+      node.graph_cost = link.GraphCost();
+      node.acoustic_cost = link.AcousticCost() - cost_offset;
+      node.cost = cost + node.graph_cost + node.acoustic_cost;
+      nodes.push_back(node);
+      queue.push(QueueElem(node.cost + iter->second,
+                           static_cast<int32>(nodes.size()) - 1));
+    }
+  }
+
+  // Turn each completed path into a linear FST, best path first.
+  nbest_out->resize(completed.size());
+  for (size_t k = 0; k < completed.size(); k++) {
+    std::vector<int32> chain;  // node indexes, from completion back to start.
+    for (int32 idx = completed[k]; idx != -1; idx = nodes[idx].parent)
+      chain.push_back(idx);
+    Lattice &path = (*nbest_out)[k];
+    StateId cur_state = path.AddState();
+    path.SetStart(cur_state);
+    // Skip chain.back() (the start node, which carries no link) and
+    // chain[0] (the completion node, which becomes the final weight).
+    for (int32 i = static_cast<int32>(chain.size()) - 2; i >= 1; i--) {
+      const NBestSearchNode &node = nodes[chain[i]];
+      StateId next_state = path.AddState();
+      path.AddArc(cur_state, Arc(node.ilabel, node.olabel,
+                                 Weight(node.graph_cost, node.acoustic_cost),
+                                 next_state));
+      cur_state = next_state;
+    }
+    path.SetFinal(cur_state, Weight(nodes[completed[k]].graph_cost, 0.0));
+  }
+  return !nbest_out->empty();
+}
+
 // Outputs an FST corresponding to the raw, state-level
 // tracebacks.
 bool LatticeFasterDecoder::GetRawLattice(Lattice *ofst,
@@ -158,20 +369,18 @@ bool LatticeFasterDecoder::GetRawLattice(Lattice *ofst,
   for (int32 f = 0; f <= num_frames; f++) {
     for (Token *tok = active_toks_[f].toks; tok != NULL; tok = tok->next) {
       StateId cur_state = tok_map[tok];
-      for (ForwardLink *l = tok->links;
-           l != NULL;
-           l = l->next) {
+      for (ForwardLinkIterator l(*this, tok); !l.Done(); l.Next()) {
         unordered_map<Token*, StateId>::const_iterator iter =
-            tok_map.find(l->next_tok);
+            tok_map.find(l.NextTok());
         StateId nextstate = iter->second;
         KALDI_ASSERT(iter != tok_map.end());
         BaseFloat cost_offset = 0.0;
-        if (l->ilabel != 0) {  // emitting..
+        if (l.Ilabel() != 0) {  // emitting..
           KALDI_ASSERT(f >= 0 && f < cost_offsets_.size());
           cost_offset = cost_offsets_[f];
         }
-        Arc arc(l->ilabel, l->olabel,
-                Weight(l->graph_cost, l->acoustic_cost - cost_offset),
+        Arc arc(l.Ilabel(), l.Olabel(),
+                Weight(l.GraphCost(), l.AcousticCost() - cost_offset),
                 nextstate);
         ofst->AddArc(cur_state, arc);
       }
@@ -241,8 +450,11 @@ inline LatticeFasterDecoder::Token *LatticeFasterDecoder::FindOrAddToken(
     // tokens on the currently final frame have zero extra_cost
     // as any of them could end up
     // on the winning path.
-    Token *new_tok = new Token (tot_cost, extra_cost, NULL, toks);
+    Token *new_tok = new (token_pool_.Malloc()) Token(tot_cost, extra_cost,
+                                                      NULL, toks);
     // NULL: no forward links yet
+    if (config_.compact_links)
+      new_tok->compact_links = kNoLink;  // the "empty list" in compact mode.
     toks = new_tok;
     num_toks_++;
     toks_.Insert(state, new_tok);
@@ -267,6 +479,25 @@ inline LatticeFasterDecoder::Token *LatticeFasterDecoder::FindOrAddToken(
   }
 }
 
+// Adds a forward link from "tok" to "next_tok", at the head of tok's list,
+// in whichever representation config_.compact_links selects.  In compact
+// mode the pointers become 32-bit pool indices; the IndexOf() calls are
+// binary searches over the pools' allocated blocks, which is cheap compared
+// with the hash lookup the caller just did to find "next_tok".
+inline void LatticeFasterDecoder::AddForwardLink(
+    Token *tok, Token *next_tok, Label ilabel, Label olabel,
+    BaseFloat graph_cost, BaseFloat acoustic_cost) {
+  if (config_.compact_links) {
+    CompactForwardLink *link = new (compact_link_pool_.Malloc())
+        CompactForwardLink(token_pool_.IndexOf(next_tok), ilabel, olabel,
+                           graph_cost, acoustic_cost, tok->compact_links);
+    tok->compact_links = compact_link_pool_.IndexOf(link);
+  } else {
+    tok->links = new (forward_link_pool_.Malloc()) ForwardLink(
+        next_tok, ilabel, olabel, graph_cost, acoustic_cost, tok->links);
+  }
+}
+
 // prunes outgoing links for all tokens in active_toks_[frame]
 // it's called by PruneActiveTokens
 // all links, that have link_extra_cost > lattice_beam are pruned
@@ -297,38 +528,74 @@ void LatticeFasterDecoder::PruneForwardLinks(
     changed = false;
     for (Token *tok = active_toks_[frame_plus_one].toks;
          tok != NULL; tok = tok->next) {
-      ForwardLink *link, *prev_link = NULL;
       // will recompute tok_extra_cost for tok.
       BaseFloat tok_extra_cost = std::numeric_limits<BaseFloat>::infinity();
       // tok_extra_cost is the best (min) of link_extra_cost of outgoing links
-      for (link = tok->links; link != NULL; ) {
-        // See if we need to excise this link...
-        Token *next_tok = link->next_tok;
-        BaseFloat link_extra_cost = next_tok->extra_cost +
-            ((tok->tot_cost + link->acoustic_cost + link->graph_cost)
-             - next_tok->tot_cost);  // difference in brackets is >= 0
-        // link_exta_cost is the difference in score between the best paths
-        // through link source state and through link destination state
-        KALDI_ASSERT(link_extra_cost == link_extra_cost);  // check for NaN
-        if (link_extra_cost > config_.lattice_beam) {  // excise link
-          ForwardLink *next_link = link->next;
-          if (prev_link != NULL) prev_link->next = next_link;
-          else tok->links = next_link;
-          delete link;
-          link = next_link;  // advance link but leave prev_link the same.
-          *links_pruned = true;
-        } else {   // keep the link and update the tok_extra_cost if needed.
-          if (link_extra_cost < 0.0) {  // this is just a precaution.
-            if (link_extra_cost < -0.01)
-              KALDI_WARN << "Negative extra_cost: " << link_extra_cost;
-            link_extra_cost = 0.0;
+      if (config_.compact_links) {
+        // the compact-representation twin of the loop in the "else" branch;
+        // identical logic, but the list is threaded through 32-bit pool
+        // indices instead of pointers.
+        uint32 link_index = tok->compact_links, prev_index = kNoLink;
+        while (link_index != kNoLink) {
+          CompactForwardLink *link = compact_link_pool_.Get(link_index);
+          Token *next_tok = token_pool_.Get(link->next_tok);
+          BaseFloat link_extra_cost = next_tok->extra_cost +
+              ((tok->tot_cost + link->acoustic_cost + link->graph_cost)
+               - next_tok->tot_cost);  // difference in brackets is >= 0
+          KALDI_ASSERT(link_extra_cost == link_extra_cost);  // check for NaN
+          if (link_extra_cost > config_.lattice_beam) {  // excise link
+            uint32 next_index = link->next;
+            if (prev_index != kNoLink)
+              compact_link_pool_.Get(prev_index)->next = next_index;
+            else tok->compact_links = next_index;
+            compact_link_pool_.Free(link);
+            num_links_pruned_++;
+            link_index = next_index;  // advance but leave prev_index the same.
+            *links_pruned = true;
+          } else {  // keep the link and update the tok_extra_cost if needed.
+            if (link_extra_cost < 0.0) {  // this is just a precaution.
+              if (link_extra_cost < -0.01)
+                KALDI_WARN << "Negative extra_cost: " << link_extra_cost;
+              link_extra_cost = 0.0;
+            }
+            if (link_extra_cost < tok_extra_cost)
+              tok_extra_cost = link_extra_cost;
+            prev_index = link_index;  // move to next link
+            link_index = link->next;
           }
-          if (link_extra_cost < tok_extra_cost)
-            tok_extra_cost = link_extra_cost;
-          prev_link = link;  // move to next link
-          link = link->next;
-        }
-      }  // for all outgoing links
+        }  // for all outgoing links
+      } else {
+        ForwardLink *link, *prev_link = NULL;
+        for (link = tok->links; link != NULL; ) {
+          // See if we need to excise this link...
+          Token *next_tok = link->next_tok;
+          BaseFloat link_extra_cost = next_tok->extra_cost +
+              ((tok->tot_cost + link->acoustic_cost + link->graph_cost)
+               - next_tok->tot_cost);  // difference in brackets is >= 0
+          // link_exta_cost is the difference in score between the best paths
+          // through link source state and through link destination state
+          KALDI_ASSERT(link_extra_cost == link_extra_cost);  // check for NaN
+          if (link_extra_cost > config_.lattice_beam) {  // excise link
+            ForwardLink *next_link = link->next;
+            if (prev_link != NULL) prev_link->next = next_link;
+            else tok->links = next_link;
+            forward_link_pool_.Free(link);
+            num_links_pruned_++;
+            link = next_link;  // advance link but leave prev_link the same.
+            *links_pruned = true;
+          } else {   // keep the link and update the tok_extra_cost if needed.
+            if (link_extra_cost < 0.0) {  // this is just a precaution.
+              if (link_extra_cost < -0.01)
+                KALDI_WARN << "Negative extra_cost: " << link_extra_cost;
+              link_extra_cost = 0.0;
+            }
+            if (link_extra_cost < tok_extra_cost)
+              tok_extra_cost = link_extra_cost;
+            prev_link = link;  // move to next link
+            link = link->next;
+          }
+        }  // for all outgoing links
+      }
       if (fabs(tok_extra_cost - tok->extra_cost) > delta)
         changed = true;   // difference new minus old is bigger than delta
       tok->extra_cost = tok_extra_cost;
@@ -372,7 +639,6 @@ void LatticeFasterDecoder::PruneForwardLinksFinal() {
     changed = false;
     for (Token *tok = active_toks_[frame_plus_one].toks;
          tok != NULL; tok = tok->next) {
-      ForwardLink *link, *prev_link = NULL;
       // will recompute tok_extra_cost.  It has a term in it that corresponds
       // to the "final-prob", so instead of initializing tok_extra_cost to infinity
       // below we set it to the difference between the (score+final_prob) of this token,
@@ -391,28 +657,60 @@ void LatticeFasterDecoder::PruneForwardLinksFinal() {
       // tok_extra_cost will be a "min" over either directly being final, or
       // being indirectly final through other links, and the loop below may
       // decrease its value:
-      for (link = tok->links; link != NULL; ) {
-        // See if we need to excise this link...
-        Token *next_tok = link->next_tok;
-        BaseFloat link_extra_cost = next_tok->extra_cost +
-            ((tok->tot_cost + link->acoustic_cost + link->graph_cost)
-             - next_tok->tot_cost);
-        if (link_extra_cost > config_.lattice_beam) {  // excise link
-          ForwardLink *next_link = link->next;
-          if (prev_link != NULL) prev_link->next = next_link;
-          else tok->links = next_link;
-          delete link;
-          link = next_link; // advance link but leave prev_link the same.
-        } else { // keep the link and update the tok_extra_cost if needed.
-          if (link_extra_cost < 0.0) { // this is just a precaution.
-            if (link_extra_cost < -0.01)
-              KALDI_WARN << "Negative extra_cost: " << link_extra_cost;
-            link_extra_cost = 0.0;
+      if (config_.compact_links) {
+        // the compact-representation twin of the loop in the "else" branch;
+        // see PruneForwardLinks() for comments.
+        uint32 link_index = tok->compact_links, prev_index = kNoLink;
+        while (link_index != kNoLink) {
+          CompactForwardLink *link = compact_link_pool_.Get(link_index);
+          Token *next_tok = token_pool_.Get(link->next_tok);
+          BaseFloat link_extra_cost = next_tok->extra_cost +
+              ((tok->tot_cost + link->acoustic_cost + link->graph_cost)
+               - next_tok->tot_cost);
+          if (link_extra_cost > config_.lattice_beam) {  // excise link
+            uint32 next_index = link->next;
+            if (prev_index != kNoLink)
+              compact_link_pool_.Get(prev_index)->next = next_index;
+            else tok->compact_links = next_index;
+            compact_link_pool_.Free(link);
+            link_index = next_index;  // advance but leave prev_index the same.
+          } else {  // keep the link and update the tok_extra_cost if needed.
+            if (link_extra_cost < 0.0) {  // this is just a precaution.
+              if (link_extra_cost < -0.01)
+                KALDI_WARN << "Negative extra_cost: " << link_extra_cost;
+              link_extra_cost = 0.0;
+            }
+            if (link_extra_cost < tok_extra_cost)
+              tok_extra_cost = link_extra_cost;
+            prev_index = link_index;
+            link_index = link->next;
+          }
+        }
+      } else {
+        ForwardLink *link, *prev_link = NULL;
+        for (link = tok->links; link != NULL; ) {
+          // See if we need to excise this link...
+          Token *next_tok = link->next_tok;
+          BaseFloat link_extra_cost = next_tok->extra_cost +
+              ((tok->tot_cost + link->acoustic_cost + link->graph_cost)
+               - next_tok->tot_cost);
+          if (link_extra_cost > config_.lattice_beam) {  // excise link
+            ForwardLink *next_link = link->next;
+            if (prev_link != NULL) prev_link->next = next_link;
+            else tok->links = next_link;
+            forward_link_pool_.Free(link);
+            link = next_link; // advance link but leave prev_link the same.
+          } else { // keep the link and update the tok_extra_cost if needed.
+            if (link_extra_cost < 0.0) { // this is just a precaution.
+              if (link_extra_cost < -0.01)
+                KALDI_WARN << "Negative extra_cost: " << link_extra_cost;
+              link_extra_cost = 0.0;
+            }
+            if (link_extra_cost < tok_extra_cost)
+              tok_extra_cost = link_extra_cost;
+            prev_link = link;
+            link = link->next;
           }
-          if (link_extra_cost < tok_extra_cost)
-            tok_extra_cost = link_extra_cost;
-          prev_link = link;
-          link = link->next;
         }
       }
       // prune away tokens worse than lattice_beam above best path.  This step
@@ -460,7 +758,9 @@ void LatticeFasterDecoder::PruneTokensForFrame(int32 frame_plus_one) {
       // excise tok from list and delete tok.
       if (prev_tok != NULL) prev_tok->next = tok->next;
       else toks = tok->next;
-      delete tok;
+      DeleteForwardLinks(tok);  // in case any links survived (they can, on
+                                // the final frame).
+      token_pool_.Free(tok);
       num_toks_--;
     } else {  // fetch next Token
       prev_tok = tok;
@@ -474,8 +774,9 @@ void LatticeFasterDecoder::PruneTokensForFrame(int32 frame_plus_one) {
 // where the delta-costs are not changing (and the delta controls when we consider
 // a cost to have "not changed").
 void LatticeFasterDecoder::PruneActiveTokens(BaseFloat delta) {
+  KALDI_PROFILE_SCOPE("LatticeFasterDecoder::PruneActiveTokens");
   int32 cur_frame_plus_one = NumFramesDecoded();
-  int32 num_toks_begin = num_toks_;
+  int32 num_toks_begin = num_toks_, num_links_pruned_begin = num_links_pruned_;
   // The index "f" below represents a "frame plus one", i.e. you'd have to subtract
   // one to get the corresponding index for the decodable object.
   for (int32 f = cur_frame_plus_one - 1; f >= 0; f--) {
@@ -500,6 +801,45 @@ void LatticeFasterDecoder::PruneActiveTokens(BaseFloat delta) {
   }
   KALDI_VLOG(4) << "PruneActiveTokens: pruned tokens from " << num_toks_begin
                 << " to " << num_toks_;
+  if (stats_ != NULL)
+    stats_->RecordPrune(num_toks_begin - num_toks_,
+                        num_links_pruned_ - num_links_pruned_begin);
+}
+
+// See the comment in the header.  The loop body is the same as in
+// PruneActiveTokens(); only the range of frames swept per call differs.
+void LatticeFasterDecoder::PruneActiveTokensIncremental(BaseFloat delta) {
+  int32 cur_frame_plus_one = NumFramesDecoded();
+  int32 num_toks_begin = num_toks_, num_links_pruned_begin = num_links_pruned_;
+  if (prune_cursor_ < 0 || prune_cursor_ >= cur_frame_plus_one)
+    prune_cursor_ = cur_frame_plus_one - 1;  // start a new backward round
+                                             // from the newest frame.
+  int32 f_begin = prune_cursor_,
+      f_end = std::max(0, f_begin - config_.prune_frames_per_step + 1);
+  for (int32 f = f_begin; f >= f_end; f--) {
+    if (active_toks_[f].must_prune_forward_links) {
+      bool extra_costs_changed = false, links_pruned = false;
+      PruneForwardLinks(f, &extra_costs_changed, &links_pruned, delta);
+      if (extra_costs_changed && f > 0)
+        active_toks_[f-1].must_prune_forward_links = true;
+      if (links_pruned)
+        active_toks_[f].must_prune_tokens = true;
+      active_toks_[f].must_prune_forward_links = false;
+    }
+    if (f+1 < cur_frame_plus_one &&
+        active_toks_[f+1].must_prune_tokens) {
+      PruneTokensForFrame(f+1);
+      active_toks_[f+1].must_prune_tokens = false;
+    }
+  }
+  prune_cursor_ = f_end - 1;  // -1 once we hit frame zero, which starts a
+                              // fresh round on the next call.
+  if (num_toks_begin != num_toks_)
+    KALDI_VLOG(4) << "PruneActiveTokensIncremental: pruned tokens from "
+                  << num_toks_begin << " to " << num_toks_;
+  if (stats_ != NULL)
+    stats_->RecordPrune(num_toks_begin - num_toks_,
+                        num_links_pruned_ - num_links_pruned_begin);
 }
 
 void LatticeFasterDecoder::ComputeFinalCosts(
@@ -558,8 +898,12 @@ void LatticeFasterDecoder::AdvanceDecoding(DecodableInterface *decodable,
   if (max_num_frames >= 0)
     target_frames_decoded = std::min(target_frames_decoded,
                                      NumFramesDecoded() + max_num_frames);
+  if (target_frames_decoded > NumFramesDecoded())
+    decodable->PrefetchFrames(NumFramesDecoded(), target_frames_decoded);
   while (NumFramesDecoded() < target_frames_decoded) {
-    if (NumFramesDecoded() % config_.prune_interval == 0) {
+    if (config_.prune_frames_per_step > 0) {
+      PruneActiveTokensIncremental(config_.lattice_beam * config_.prune_scale);
+    } else if (NumFramesDecoded() % config_.prune_interval == 0) {
       PruneActiveTokens(config_.lattice_beam * config_.prune_scale);
     }
     BaseFloat cost_cutoff = ProcessEmitting(decodable);
@@ -585,9 +929,38 @@ void LatticeFasterDecoder::FinalizeDecoding() {
   PruneTokensForFrame(0);
   KALDI_VLOG(4) << "pruned tokens from " << num_toks_begin
                 << " to " << num_toks_;
+  if (stats_ != NULL) {
+    stats_->RecordPrune(num_toks_begin - num_toks_, 0);
+    stats_->PrintSummary("LatticeFasterDecoder");
+  }
 }
 
 /// Gets the weight cutoff.  Also counts the active tokens.
+void LatticeFasterDecoder::GetMemoryStats(MemoryStats *stats) const {
+  // The pools hand memory back only on destruction, so their allocated
+  // size is the high-water mark over all utterances this decoder has seen.
+  int64 pools_used = token_pool_.UsedBytes() +
+      forward_link_pool_.UsedBytes() + compact_link_pool_.UsedBytes();
+  int64 pools_allocated = token_pool_.AllocatedBytes() +
+      forward_link_pool_.AllocatedBytes() +
+      compact_link_pool_.AllocatedBytes();
+  // the token hash and the scratch vectors hold no per-utterance live data
+  // to speak of, so we count their allocation on both sides.
+  int64 overhead = toks_.MemoryBytes() +
+      queue_.capacity() * sizeof(StateId) +
+      tmp_array_.capacity() * sizeof(BaseFloat) +
+      batch_indices_.capacity() * sizeof(int32) +
+      batch_loglikes_.capacity() * sizeof(BaseFloat) +
+      like_stamps_.capacity() * sizeof(int32) +
+      like_cache_.capacity() * sizeof(BaseFloat);
+  stats->cur_bytes += pools_used + overhead +
+      active_toks_.size() * sizeof(TokenList) +
+      cost_offsets_.size() * sizeof(BaseFloat);
+  stats->peak_bytes += pools_allocated + overhead +
+      active_toks_.capacity() * sizeof(TokenList) +
+      cost_offsets_.capacity() * sizeof(BaseFloat);
+}
+
 BaseFloat LatticeFasterDecoder::GetCutoff(Elem *list_head, size_t *tok_count,
                                           BaseFloat *adaptive_beam, Elem **best_elem) {
   BaseFloat best_weight = std::numeric_limits<BaseFloat>::infinity();
@@ -658,11 +1031,13 @@ BaseFloat LatticeFasterDecoder::GetCutoff(Elem *list_head, size_t *tok_count,
 }
 
 BaseFloat LatticeFasterDecoder::ProcessEmitting(DecodableInterface *decodable) {
+  KALDI_PROFILE_SCOPE("LatticeFasterDecoder::ProcessEmitting");
   KALDI_ASSERT(active_toks_.size() > 0);
   int32 frame = active_toks_.size() - 1; // frame is the frame-index
                                          // (zero-based) used to get likelihoods
                                          // from the decodable object.
   active_toks_.resize(active_toks_.size() + 1);
+  if (stats_ != NULL) stats_->BeginFrame(frame);
 
   Elem *final_toks = toks_.Clear(); // analogous to swapping prev_toks_ / cur_toks_
                                    // in simple-decoder.h.   Removes the Elems from
@@ -673,6 +1048,7 @@ BaseFloat LatticeFasterDecoder::ProcessEmitting(DecodableInterface *decodable) {
   BaseFloat cur_cutoff = GetCutoff(final_toks, &tok_cnt, &adaptive_beam, &best_elem);
   KALDI_VLOG(6) << "Adaptive beam on frame " << NumFramesDecoded() << " is "
                 << adaptive_beam;
+  if (stats_ != NULL) stats_->RecordBeam(adaptive_beam);
   
   PossiblyResizeHash(tok_cnt);  // This makes sure the hash is always big enough.
 
@@ -710,6 +1086,41 @@ BaseFloat LatticeFasterDecoder::ProcessEmitting(DecodableInterface *decodable) {
   cost_offsets_.resize(frame + 1, 0.0);
   cost_offsets_[frame] = cost_offset;
 
+  if (config_.num_decode_threads > 1)
+    return ProcessEmittingParallel(decodable, final_toks, frame, cur_cutoff,
+                                   next_cutoff, adaptive_beam, cost_offset);
+
+  if (config_.batch_acoustic_scores) {
+    // Collect the distinct ilabels on the emitting arcs of the surviving
+    // tokens and score them with a single batched call; the main loop below
+    // then reads the scores from like_cache_.  This costs a second pass
+    // over the arcs, so it only pays off when the decodable object
+    // overrides LogLikelihoods() with something faster than per-index
+    // virtual calls.
+    if (like_stamps_.size() !=
+        static_cast<size_t>(decodable->NumIndices()) + 1) {
+      like_stamps_.clear();
+      like_stamps_.resize(decodable->NumIndices() + 1, -1);
+      like_cache_.resize(decodable->NumIndices() + 1);
+    }
+    batch_indices_.clear();
+    for (Elem *e = final_toks; e != NULL; e = e->tail) {
+      if (e->val->tot_cost <= cur_cutoff) {
+        for (fst::ArcIterator<fst::Fst<Arc> > aiter(fst_, e->key);
+             !aiter.Done(); aiter.Next()) {
+          int32 ilabel = aiter.Value().ilabel;
+          if (ilabel != 0 && like_stamps_[ilabel] != frame) {
+            like_stamps_[ilabel] = frame;
+            batch_indices_.push_back(ilabel);
+          }
+        }
+      }
+    }
+    decodable->LogLikelihoods(frame, batch_indices_, &batch_loglikes_);
+    for (size_t i = 0; i < batch_indices_.size(); i++)
+      like_cache_[batch_indices_[i]] = batch_loglikes_[i];
+  }
+
   // the tokens are now owned here, in final_toks, and the hash is empty.
   // 'owned' is a complex thing here; the point is we need to call DeleteElem
   // on each elem 'e' to let toks_ know we're done with them.
@@ -718,13 +1129,16 @@ BaseFloat LatticeFasterDecoder::ProcessEmitting(DecodableInterface *decodable) {
     StateId state = e->key;
     Token *tok = e->val;
     if (tok->tot_cost <= cur_cutoff) {
+      if (stats_ != NULL) stats_->RecordStateVisit(state);
       for (fst::ArcIterator<fst::Fst<Arc> > aiter(fst_, state);
            !aiter.Done();
            aiter.Next()) {
         const Arc &arc = aiter.Value();
         if (arc.ilabel != 0) {  // propagate..
-          BaseFloat ac_cost = cost_offset -
-              decodable->LogLikelihood(frame, arc.ilabel),
+          BaseFloat log_like = (config_.batch_acoustic_scores ?
+                                like_cache_[arc.ilabel] :
+                                decodable->LogLikelihood(frame, arc.ilabel));
+          BaseFloat ac_cost = cost_offset - log_like,
               graph_cost = arc.weight.Value(),
               cur_cost = tok->tot_cost,
               tot_cost = cur_cost + ac_cost + graph_cost;
@@ -737,9 +1151,9 @@ BaseFloat LatticeFasterDecoder::ProcessEmitting(DecodableInterface *decodable) {
                                            frame + 1, tot_cost, NULL);
           // NULL: no change indicator needed
 
-          // Add ForwardLink from tok to next_tok (put on head of list tok->links)
-          tok->links = new ForwardLink(next_tok, arc.ilabel, arc.olabel,
-                                       graph_cost, ac_cost, tok->links);
+          // Add a forward link from tok to next_tok (put on head of list)
+          AddForwardLink(tok, next_tok, arc.ilabel, arc.olabel, graph_cost,
+                         ac_cost);
         }
       } // for all arcs
     }
@@ -749,7 +1163,118 @@ BaseFloat LatticeFasterDecoder::ProcessEmitting(DecodableInterface *decodable) {
   return next_cutoff;
 }
 
+// The MultiThreadable used by ProcessEmittingParallel(); each copy expands
+// the emitting arcs out of its own slice of the active tokens, into a
+// per-thread candidate buffer, keeping a thread-local pruning cutoff.
+class LatticeFasterDecoder::EmittingArcTask: public MultiThreadable {
+ public:
+  EmittingArcTask(const LatticeFasterDecoder *decoder,
+                  DecodableInterface *decodable,
+                  const std::vector<const Elem*> *elems,
+                  int32 frame,
+                  BaseFloat cur_cutoff,
+                  BaseFloat initial_next_cutoff,
+                  BaseFloat adaptive_beam,
+                  BaseFloat cost_offset,
+                  std::vector<std::vector<EmittingCandidate> > *candidates,
+                  std::vector<BaseFloat> *next_cutoffs):
+      decoder_(decoder), decodable_(decodable), elems_(elems), frame_(frame),
+      cur_cutoff_(cur_cutoff), initial_next_cutoff_(initial_next_cutoff),
+      adaptive_beam_(adaptive_beam), cost_offset_(cost_offset),
+      candidates_(candidates), next_cutoffs_(next_cutoffs) { }
+
+  void operator () () {
+    std::vector<EmittingCandidate> &cands = (*candidates_)[thread_id_];
+    BaseFloat next_cutoff = initial_next_cutoff_;
+    // Each thread takes a contiguous slice of the active tokens.
+    size_t num_elems = elems_->size(),
+        begin = (num_elems * thread_id_) / num_threads_,
+        end = (num_elems * (thread_id_ + 1)) / num_threads_;
+    for (size_t i = begin; i < end; i++) {
+      const Elem *e = (*elems_)[i];
+      StateId state = e->key;
+      Token *tok = e->val;
+      if (tok->tot_cost > cur_cutoff_) continue;
+      for (fst::ArcIterator<fst::Fst<Arc> > aiter(decoder_->fst_, state);
+           !aiter.Done();
+           aiter.Next()) {
+        const Arc &arc = aiter.Value();
+        if (arc.ilabel != 0) {  // emitting arc.
+          EmittingCandidate cand;
+          cand.tok = tok;
+          cand.nextstate = arc.nextstate;
+          cand.ilabel = arc.ilabel;
+          cand.olabel = arc.olabel;
+          cand.ac_cost = cost_offset_ -
+              decodable_->LogLikelihood(frame_, arc.ilabel);
+          cand.graph_cost = arc.weight.Value();
+          cand.tot_cost = tok->tot_cost + cand.ac_cost + cand.graph_cost;
+          if (cand.tot_cost > next_cutoff) continue;
+          else if (cand.tot_cost + adaptive_beam_ < next_cutoff)
+            next_cutoff = cand.tot_cost + adaptive_beam_;
+          cands.push_back(cand);
+        }
+      }
+    }
+    (*next_cutoffs_)[thread_id_] = next_cutoff;
+  }
+ private:
+  const LatticeFasterDecoder *decoder_;
+  DecodableInterface *decodable_;
+  const std::vector<const Elem*> *elems_;
+  int32 frame_;
+  BaseFloat cur_cutoff_;
+  BaseFloat initial_next_cutoff_;
+  BaseFloat adaptive_beam_;
+  BaseFloat cost_offset_;
+  std::vector<std::vector<EmittingCandidate> > *candidates_;
+  std::vector<BaseFloat> *next_cutoffs_;
+};
+
+BaseFloat LatticeFasterDecoder::ProcessEmittingParallel(
+    DecodableInterface *decodable, Elem *final_toks, int32 frame,
+    BaseFloat cur_cutoff, BaseFloat next_cutoff, BaseFloat adaptive_beam,
+    BaseFloat cost_offset) {
+  int32 num_threads = config_.num_decode_threads;
+  std::vector<const Elem*> elems;
+  for (const Elem *e = final_toks; e != NULL; e = e->tail)
+    elems.push_back(e);
+
+  std::vector<std::vector<EmittingCandidate> > candidates(num_threads);
+  std::vector<BaseFloat> next_cutoffs(num_threads, next_cutoff);
+  {
+    EmittingArcTask task(this, decodable, &elems, frame, cur_cutoff,
+                         next_cutoff, adaptive_beam, cost_offset,
+                         &candidates, &next_cutoffs);
+    MultiThreader<EmittingArcTask> m(num_threads, task);
+    // the threads are joined when "m" goes out of scope.
+  }
+  for (int32 t = 0; t < num_threads; t++)
+    next_cutoff = std::min(next_cutoff, next_cutoffs[t]);
+
+  // Serial merge phase: insert the surviving candidates into the token hash
+  // and allocate forward links.  (The hash and the pools only support
+  // single-threaded insertion; the expensive part -- expanding arcs and
+  // computing acoustic likelihoods -- happened on the worker threads.)
+  // Note: because each worker kept its own cutoff, this may keep slightly
+  // more arcs than the single-threaded version, never fewer.
+  for (int32 t = 0; t < num_threads; t++) {
+    const std::vector<EmittingCandidate> &cands = candidates[t];
+    for (size_t i = 0; i < cands.size(); i++) {
+      const EmittingCandidate &cand = cands[i];
+      if (cand.tot_cost > next_cutoff) continue;
+      Token *next_tok = FindOrAddToken(cand.nextstate, frame + 1,
+                                       cand.tot_cost, NULL);
+      AddForwardLink(cand.tok, next_tok, cand.ilabel, cand.olabel,
+                     cand.graph_cost, cand.ac_cost);
+    }
+  }
+  DeleteElems(final_toks);
+  return next_cutoff;
+}
+
 void LatticeFasterDecoder::ProcessNonemitting(BaseFloat cutoff) {
+  KALDI_PROFILE_SCOPE("LatticeFasterDecoder::ProcessNonemitting");
   KALDI_ASSERT(!active_toks_.empty());
   int32 frame = static_cast<int32>(active_toks_.size()) - 2;
   // Note: "frame" is the time-index we just processed, or -1 if
@@ -784,8 +1309,27 @@ void LatticeFasterDecoder::ProcessNonemitting(BaseFloat cutoff) {
     // because we're about to regenerate them.  This is a kind
     // of non-optimality (remember, this is the simple decoder),
     // but since most states are emitting it's not a huge issue.
-    tok->DeleteForwardLinks(); // necessary when re-visiting
-    tok->links = NULL;
+    DeleteForwardLinks(tok); // necessary when re-visiting
+    if (eps_cache_ != NULL) {
+      // Use the precomputed epsilon-arc index; this avoids the virtual
+      // ArcIterator and skipping over the state's emitting arcs.
+      size_t num_arcs;
+      const EpsilonArcCache::EpsArc *arcs = eps_cache_->GetArcs(state,
+                                                               &num_arcs);
+      for (size_t i = 0; i < num_arcs; i++) {
+        const EpsilonArcCache::EpsArc &arc = arcs[i];
+        BaseFloat graph_cost = arc.weight,
+            tot_cost = cur_cost + graph_cost;
+        if (tot_cost < cutoff) {
+          bool changed;
+          Token *new_tok = FindOrAddToken(arc.nextstate, frame + 1, tot_cost,
+                                          &changed);
+          AddForwardLink(tok, new_tok, 0, arc.olabel, graph_cost, 0);
+          if (changed) queue_.push_back(arc.nextstate);
+        }
+      }
+      continue;
+    }
     for (fst::ArcIterator<fst::Fst<Arc> > aiter(fst_, state);
          !aiter.Done();
          aiter.Next()) {
@@ -799,8 +1343,7 @@ void LatticeFasterDecoder::ProcessNonemitting(BaseFloat cutoff) {
           Token *new_tok = FindOrAddToken(arc.nextstate, frame + 1, tot_cost,
                                           &changed);
 
-          tok->links = new ForwardLink(new_tok, 0, arc.olabel,
-                                       graph_cost, 0, tok->links);
+          AddForwardLink(tok, new_tok, 0, arc.olabel, graph_cost, 0);
 
           // "changed" tells us whether the new token has a different
           // cost from before, or is new [if so, add into queue].
@@ -809,6 +1352,16 @@ void LatticeFasterDecoder::ProcessNonemitting(BaseFloat cutoff) {
       }
     } // for all arcs
   } // while queue not empty
+  if (prefetch_fst_ != NULL && config_.prefetch_arcs) {
+    // The tokens that survived this frame are the states the next call to
+    // ProcessEmitting() will expand; hint them to the graph so it can read
+    // their arcs from disk while we wait for the next frame's features.
+    prefetch_states_.clear();
+    for (const Elem *e = toks_.GetList(); e != NULL; e = e->tail)
+      prefetch_states_.push_back(e->key);
+    prefetch_fst_->PrefetchStates(prefetch_states_);
+  }
+  if (stats_ != NULL) stats_->EndFrame(num_toks_);
 }
 
 
@@ -819,25 +1372,39 @@ void LatticeFasterDecoder::DeleteElems(Elem *list) {
   }
 }
 
-void LatticeFasterDecoder::ClearActiveTokens() { // a cleanup routine, at utt end/begin
-  for (size_t i = 0; i < active_toks_.size(); i++) {
-    // Delete all tokens alive on this frame, and any forward
-    // links they may have.
-    for (Token *tok = active_toks_[i].toks; tok != NULL; ) {
-      tok->DeleteForwardLinks();
-      Token *next_tok = tok->next;
-      delete tok;
-      num_toks_--;
-      tok = next_tok;
+void LatticeFasterDecoder::DeleteForwardLinks(Token *tok) {
+  if (config_.compact_links) {
+    uint32 l = tok->compact_links;
+    while (l != kNoLink) {
+      CompactForwardLink *link = compact_link_pool_.Get(l);
+      l = link->next;
+      compact_link_pool_.Free(link);
     }
+    tok->compact_links = kNoLink;
+  } else {
+    ForwardLink *l = tok->links, *m;
+    while (l != NULL) {
+      m = l->next;
+      forward_link_pool_.Free(l);
+      l = m;
+    }
+    tok->links = NULL;
   }
+}
+
+void LatticeFasterDecoder::ClearActiveTokens() { // a cleanup routine, at utt end/begin
+  // All tokens and forward links live in the pools, so rather than freeing
+  // them one by one we reset the pools, which returns all their memory to
+  // the free state in one go (keeping it allocated for the next utterance).
   active_toks_.clear();
-  KALDI_ASSERT(num_toks_ == 0);
+  num_toks_ = 0;
+  token_pool_.Clear();
+  forward_link_pool_.Clear();
+  compact_link_pool_.Clear();
 }
 
-// static
-void LatticeFasterDecoder::TopSortTokens(Token *tok_list,
-                                         std::vector<Token*> *topsorted_list) {
+void LatticeFasterDecoder::TopSortTokens(
+    Token *tok_list, std::vector<Token*> *topsorted_list) const {
   unordered_map<Token*, int32> token2pos;
   typedef unordered_map<Token*, int32>::iterator IterType;
   int32 num_toks = 0;
@@ -856,18 +1423,18 @@ void LatticeFasterDecoder::TopSortTokens(Token *tok_list,
   for (IterType iter = token2pos.begin(); iter != token2pos.end(); ++iter) {
     Token *tok = iter->first;
     int32 pos = iter->second;
-    for (ForwardLink *link = tok->links; link != NULL; link = link->next) {
-      if (link->ilabel == 0) {
+    for (ForwardLinkIterator link(*this, tok); !link.Done(); link.Next()) {
+      if (link.Ilabel() == 0) {
         // We only need to consider epsilon links, since non-epsilon links
         // transition between frames and this function only needs to sort a list
         // of tokens from a single frame.
-        IterType following_iter = token2pos.find(link->next_tok);
+        IterType following_iter = token2pos.find(link.NextTok());
         if (following_iter != token2pos.end()) { // another token on this frame,
                                                  // so must consider it.
           int32 next_pos = following_iter->second;
           if (next_pos < pos) { // reassign the position of the next Token.
             following_iter->second = cur_pos++;
-            reprocess.insert(link->next_tok);
+            reprocess.insert(link.NextTok());
           }
         }
       }
@@ -890,14 +1457,14 @@ void LatticeFasterDecoder::TopSortTokens(Token *tok_list,
       Token *tok = *iter;
       int32 pos = token2pos[tok];
       // Repeat the processing we did above (for comments, see above).
-      for (ForwardLink *link = tok->links; link != NULL; link = link->next) {
-        if (link->ilabel == 0) {
-          IterType following_iter = token2pos.find(link->next_tok);
+      for (ForwardLinkIterator link(*this, tok); !link.Done(); link.Next()) {
+        if (link.Ilabel() == 0) {
+          IterType following_iter = token2pos.find(link.NextTok());
           if (following_iter != token2pos.end()) {
             int32 next_pos = following_iter->second;
             if (next_pos < pos) {
               following_iter->second = cur_pos++;
-              reprocess.insert(link->next_tok);
+              reprocess.insert(link.NextTok());
             }
           }
         }
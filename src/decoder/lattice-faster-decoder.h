@@ -29,12 +29,20 @@
 
 #include "util/stl-utils.h"
 #include "util/hash-list.h"
+#include "util/memory-stats.h"
+#include "util/object-pool.h"
 #include "fst/fstlib.h"
+#include "decoder/decoder-stats.h"
+#include "decoder/epsilon-arc-cache.h"
 #include "itf/decodable-itf.h"
 #include "fstext/fstext-lib.h"
 #include "lat/determinize-lattice-pruned.h"
 #include "lat/kaldi-lattice.h"
 
+namespace fst {
+class PrefetchableFst;  // see fstext/mapped-fst.h.
+}
+
 namespace kaldi {
 
 struct LatticeFasterDecoderConfig {
@@ -47,6 +55,30 @@ struct LatticeFasterDecoderConfig {
                             // command-line program.
   BaseFloat beam_delta; // has nothing to do with beam_ratio
   BaseFloat hash_ratio;
+  int32 num_decode_threads;  // if > 1, ProcessEmitting() expands emitting
+                             // arcs on this many threads; see the comment by
+                             // ProcessEmittingParallel() for the requirements
+                             // this places on the decodable object.
+  bool batch_acoustic_scores;  // if true, ProcessEmitting() collects the
+                               // distinct ilabels of a frame's emitting arcs
+                               // and scores them with one call to the
+                               // decodable's batched LogLikelihoods();
+                               // worthwhile for decodables that override it.
+  int32 prune_frames_per_step;  // if > 0, replaces the periodic full
+                                // backward pruning sweep with an incremental
+                                // one that processes this many frames of the
+                                // sweep per decoded frame; see
+                                // PruneActiveTokensIncremental().
+  bool prefetch_arcs;  // if true, and the decoding graph supports it (it is
+                       // a fst::PrefetchableFst, e.g. a disk-backed graph
+                       // read with DiskBackedStdFst), hint the next frame's
+                       // active states to the graph after each frame so it
+                       // can read their arcs ahead of the decoder.
+  bool compact_links;  // if true, forward links are stored in a compact
+                       // representation with 32-bit pool indices instead of
+                       // pointers (24 bytes per link instead of 32 on 64-bit
+                       // machines); reduces memory on long utterances at a
+                       // small cost in speed.  See CompactForwardLink below.
   BaseFloat prune_scale;   // Note: we don't make this configurable on the command line,
                            // it's not a very important parameter.  It affects the
                            // algorithm that prunes the tokens as we go.
@@ -63,6 +95,11 @@ struct LatticeFasterDecoderConfig {
                                 determinize_lattice(true),
                                 beam_delta(0.5),
                                 hash_ratio(2.0),
+                                num_decode_threads(1),
+                                batch_acoustic_scores(false),
+                                prune_frames_per_step(0),
+                                prefetch_arcs(true),
+                                compact_links(false),
                                 prune_scale(0.1) { }
   void Register(OptionsItf *opts) {
     det_opts.Register(opts);
@@ -80,10 +117,32 @@ struct LatticeFasterDecoderConfig {
                    "max-active constraint is applied.  Larger is more accurate.");
     opts->Register("hash-ratio", &hash_ratio, "Setting used in decoder to control"
                    " hash behavior");
+    opts->Register("num-decode-threads", &num_decode_threads, "Number of "
+                   "threads used to expand emitting arcs within a single "
+                   "utterance.  If > 1, the decodable object's LogLikelihood() "
+                   "function must be safe to call concurrently.");
+    opts->Register("batch-acoustic-scores", &batch_acoustic_scores, "If true, "
+                   "score each frame's distinct emitting-arc labels with one "
+                   "batched LogLikelihoods() call on the decodable object, "
+                   "instead of a virtual call per arc.");
+    opts->Register("prune-frames-per-step", &prune_frames_per_step, "If > 0, "
+                   "amortize lattice pruning by sweeping this many frames of "
+                   "the backward pruning pass per decoded frame, instead of a "
+                   "full sweep every prune-interval frames; bounds worst-case "
+                   "per-frame latency on long utterances.");
+    opts->Register("prefetch-arcs", &prefetch_arcs, "If true, and the "
+                   "decoding graph supports prefetching (e.g. a disk-backed "
+                   "graph), hint each frame's surviving states to the graph "
+                   "so their arcs can be read ahead of the next frame.");
+    opts->Register("compact-links", &compact_links, "If true, store lattice "
+                   "forward links in a compact representation (32-bit pool "
+                   "indices instead of pointers); reduces decoding memory on "
+                   "long utterances at a small cost in speed.");
   }
   void Check() const {
     KALDI_ASSERT(beam > 0.0 && max_active > 1 && lattice_beam > 0.0
                  && prune_interval > 0 && beam_delta > 0.0 && hash_ratio >= 1.0
+                 && num_decode_threads >= 1 && prune_frames_per_step >= 0
                  && prune_scale > 0.0 && prune_scale < 1.0);
   }
 };
@@ -117,7 +176,31 @@ class LatticeFasterDecoder {
   const LatticeFasterDecoderConfig &GetOptions() const {
     return config_;
   }
-  
+
+  /// Provides an epsilon-arc index for the decoding graph, which
+  /// ProcessNonemitting() will use instead of iterating over the FST's arcs;
+  /// see epsilon-arc-cache.h.  The cache must have been built from the same
+  /// FST this decoder uses, and must outlive the decoder; one cache is
+  /// typically shared by all decoders on the same graph.  Passing NULL
+  /// reverts to iterating the FST directly (the default).
+  void SetEpsilonArcCache(const EpsilonArcCache *cache) {
+    eps_cache_ = cache;
+  }
+
+  /// Attaches an optional per-frame instrumentation object (see
+  /// decoder-stats.h); the decoder will record frame times, token counts,
+  /// the adaptive beam and pruning counts into it, and log a summary from
+  /// FinalizeDecoding().  Not owned here; pass NULL (the default) to turn
+  /// recording off, in which case the overhead is one pointer test per
+  /// frame.
+  void SetDecoderStats(DecoderStats *stats) { stats_ = stats; }
+
+  /// Adds to *stats the dynamic memory held by this decoder: the token and
+  /// forward-link pools, the token hash and the per-frame vectors (see
+  /// util/memory-stats.h for the conventions).  Cheap enough to poll once
+  /// per utterance, e.g. just before InitDecoding() of the next one.
+  void GetMemoryStats(MemoryStats *stats) const;
+
   ~LatticeFasterDecoder();
 
   /// Decodes until there are no more frames left in the "decodable" object..
@@ -142,6 +225,19 @@ class LatticeFasterDecoder {
   bool GetBestPath(Lattice *ofst,
                    bool use_final_probs = true) const;
 
+  /// Outputs the n best paths through the lattice, searched directly over
+  /// the decoder's token structure (A* with the exact backward cost as the
+  /// heuristic, so paths come out in order of increasing cost), without
+  /// constructing the raw lattice and without any determinization.  Each
+  /// element of "nbest_out" is a linear FST whose path has the same labels
+  /// and costs it would have in the output of GetRawLattice(); fewer than n
+  /// paths are produced if the (pruned) token structure does not contain n.
+  /// Use this instead of GetRawLattice()/GetLattice() when only the 1-best
+  /// or a small n-best is wanted; "use_final_probs" has the same meaning as
+  /// in GetRawLattice().  Returns true if at least one path was produced.
+  bool GetNBestPaths(int32 n, std::vector<Lattice> *nbest_out,
+                     bool use_final_probs = true) const;
+
   /// Outputs an FST corresponding to the raw, state-level
   /// tracebacks.  Returns true if result is nonempty.
   /// If "use_final_probs" is true AND we reached the final-state
@@ -224,6 +320,38 @@ class LatticeFasterDecoder {
         next(next) { }
   };
 
+  // "null" value for the 32-bit link and token indices used by
+  // CompactForwardLink; the same value as ObjectPool<T>::kNoIndex.
+  static const uint32 kNoLink = 0xFFFFFFFF;
+
+  // The compact representation of a forward link, used instead of
+  // ForwardLink when config_.compact_links is true: the two pointers become
+  // 32-bit indices into token_pool_ / compact_link_pool_, taking the link
+  // from 32 bytes down to 24 on 64-bit machines.  Hour-long utterances
+  // decoded with wide beams hold hundreds of millions of links, so this is
+  // a substantial saving when memory capacity limits how many decoders can
+  // run concurrently.  [We considered also storing the costs in half
+  // precision, but the pruning code compares differences of these costs
+  // against lattice-beam, and the rounding would perturb which links
+  // survive and the costs in the output lattice, so we keep them as
+  // BaseFloat.]
+  struct CompactForwardLink {
+    uint32 next_tok;  // index of the next token, in token_pool_.
+    Label ilabel;  // ilabel on link.
+    Label olabel;  // olabel on link.
+    BaseFloat graph_cost;  // graph cost of traversing link (contains LM, etc.)
+    BaseFloat acoustic_cost;  // acoustic cost (pre-scaled) of traversing link
+    uint32 next;  // index (in compact_link_pool_) of the next link in the
+                  // singly-linked list of forward links from a token, or
+                  // kNoLink at the end of the list.
+    inline CompactForwardLink(uint32 next_tok, Label ilabel, Label olabel,
+                              BaseFloat graph_cost, BaseFloat acoustic_cost,
+                              uint32 next):
+        next_tok(next_tok), ilabel(ilabel), olabel(olabel),
+        graph_cost(graph_cost), acoustic_cost(acoustic_cost),
+        next(next) { }
+  };
+
   // Token is what's resident in a particular state at a particular time.
   // In this decoder a Token actually contains *forward* links.
   // When first created, a Token just has the (total) cost.    We add forward
@@ -237,22 +365,22 @@ class LatticeFasterDecoder {
     // eventually succeed (e.g. if you were to take the currently active states
     // one by one and compute this difference, and then take the minimum).
 
-    ForwardLink *links; // Head of singly linked list of ForwardLinks
+    // Head of the singly linked list of forward links, in whichever
+    // representation the decoder is configured for; only the member
+    // matching config_.compact_links is meaningful.  [Note: the Token
+    // constructor initializes "links"; FindOrAddToken sets compact_links to
+    // kNoLink right after construction when in compact mode.]
+    union {
+      ForwardLink *links;  // head of list of ForwardLinks.
+      uint32 compact_links;  // index (in compact_link_pool_) of the head of
+                             // the list of CompactForwardLinks, or kNoLink.
+    };
 
     Token *next; // Next in list of tokens for this frame.
 
     inline Token(BaseFloat tot_cost, BaseFloat extra_cost, ForwardLink *links,
                  Token *next):
         tot_cost(tot_cost), extra_cost(extra_cost), links(links), next(next) { }
-    inline void DeleteForwardLinks() {
-      ForwardLink *l = links, *m;
-      while (l != NULL) {
-        m = l->next;
-        delete l;
-        l = m;
-      }
-      links = NULL;
-    }
   };
 
   // head of per-frame list of Tokens (list is in topological order),
@@ -267,6 +395,75 @@ class LatticeFasterDecoder {
 
   typedef HashList<StateId, Token*>::Elem Elem;
 
+  // Read-only iterator over the forward links of a token that hides which
+  // of the two link representations (ForwardLink or CompactForwardLink) is
+  // in use, so that the lattice-extraction code (GetRawLattice(),
+  // GetNBestPaths(), TopSortTokens()) can be written once for both.  The
+  // pruning loops, which excise links as they go, handle the two
+  // representations explicitly instead.
+  class ForwardLinkIterator {
+   public:
+    inline ForwardLinkIterator(const LatticeFasterDecoder &decoder,
+                               const Token *tok):
+        decoder_(decoder), compact_(decoder.config_.compact_links) {
+      if (compact_) {
+        link_ = NULL;
+        index_ = tok->compact_links;
+      } else {
+        link_ = tok->links;
+        index_ = kNoLink;
+      }
+    }
+    inline bool Done() const {
+      return compact_ ? index_ == kNoLink : link_ == NULL;
+    }
+    inline void Next() {
+      if (compact_) index_ = CLink()->next;
+      else link_ = link_->next;
+    }
+    inline Token *NextTok() const {
+      return compact_ ? decoder_.token_pool_.Get(CLink()->next_tok) :
+          link_->next_tok;
+    }
+    inline Label Ilabel() const {
+      return compact_ ? CLink()->ilabel : link_->ilabel;
+    }
+    inline Label Olabel() const {
+      return compact_ ? CLink()->olabel : link_->olabel;
+    }
+    inline BaseFloat GraphCost() const {
+      return compact_ ? CLink()->graph_cost : link_->graph_cost;
+    }
+    inline BaseFloat AcousticCost() const {
+      return compact_ ? CLink()->acoustic_cost : link_->acoustic_cost;
+    }
+   private:
+    inline const CompactForwardLink *CLink() const {
+      return decoder_.compact_link_pool_.Get(index_);
+    }
+    const LatticeFasterDecoder &decoder_;
+    bool compact_;
+    const ForwardLink *link_;  // current link, in the pointer representation.
+    uint32 index_;  // index of the current link, in the compact one.
+  };
+
+  // One element of the best-first search that GetNBestPaths() runs over the
+  // token structure; declared here because it refers to Token.  A node
+  // stands for a partial path from the start token, ending in "tok" via the
+  // link whose labels and costs are stored in it.
+  struct NBestSearchNode {
+    Token *tok;      // the token the partial path ends at, or NULL for a
+                     // node standing for a completed path.
+    int32 frame;     // the frame "tok" is on (frame index plus one, as used
+                     // for active_toks_).
+    int32 parent;    // index of the predecessor node, or -1 at the start.
+    Label ilabel;    // labels and costs of the link leading to "tok" (all
+    Label olabel;    // zero for the node at the start token).
+    BaseFloat graph_cost;
+    BaseFloat acoustic_cost;
+    double cost;     // forward cost of the partial path, including the link.
+  };
+
   void PossiblyResizeHash(size_t num_toks);
 
   // FindOrAddToken either locates a token in hash of toks_, or if necessary
@@ -280,6 +477,19 @@ class LatticeFasterDecoder {
   inline Token *FindOrAddToken(StateId state, int32 frame_plus_one,
                                BaseFloat tot_cost, bool *changed);
 
+  // Adds a forward link from "tok" to "next_tok" with the given labels and
+  // costs, at the head of tok's list, in whichever representation
+  // config_.compact_links selects.
+  inline void AddForwardLink(Token *tok, Token *next_tok, Label ilabel,
+                             Label olabel, BaseFloat graph_cost,
+                             BaseFloat acoustic_cost);
+
+  // Deletes a token's forward links, returning them to the pool they came
+  // from, and resets the head of the token's list.  [This used to be a
+  // member of Token, but moved here when tokens and links became
+  // pool-allocated.]
+  void DeleteForwardLinks(Token *tok);
+
   // prunes outgoing links for all tokens in active_toks_[frame]
   // it's called by PruneActiveTokens
   // all links, that have link_extra_cost > lattice_beam are pruned
@@ -334,6 +544,19 @@ class LatticeFasterDecoder {
   // less far.
   void PruneActiveTokens(BaseFloat delta);
 
+  // Incremental version of PruneActiveTokens(), used when
+  // config_.prune_frames_per_step > 0.  It is called every frame and does
+  // at most prune_frames_per_step frames' worth of the backward sweep,
+  // continuing from where the previous call stopped (via prune_cursor_) and
+  // restarting from the newest frame when it reaches frame zero.  The
+  // must-prune flags on the token lists carry the extra-cost propagation
+  // across calls, so the result after a complete round is the same set of
+  // prunings as the full sweep, just spread over frames; FinalizeDecoding()
+  // still does an exact full pass at the end.  This bounds worst-case
+  // per-frame pruning work at the cost of pruning a little later (so peak
+  // memory is slightly higher than with the periodic full sweep).
+  void PruneActiveTokensIncremental(BaseFloat delta);
+
   /// Gets the weight cutoff.  Also counts the active tokens.
   BaseFloat GetCutoff(Elem *list_head, size_t *tok_count,
                       BaseFloat *adaptive_beam, Elem **best_elem);
@@ -342,6 +565,40 @@ class LatticeFasterDecoder {
   /// Returns the cost cutoff for subsequent ProcessNonemitting() to use.
   BaseFloat ProcessEmitting(DecodableInterface *decodable);
 
+  // An emitting arc expansion computed by one of the worker threads of
+  // ProcessEmittingParallel(), to be turned into a token and forward link in
+  // the (serial) merge phase.
+  struct EmittingCandidate {
+    Token *tok;  // source token (on the previous frame).
+    StateId nextstate;
+    Label ilabel;
+    Label olabel;
+    BaseFloat graph_cost;
+    BaseFloat ac_cost;
+    BaseFloat tot_cost;
+  };
+  class EmittingArcTask;  // the MultiThreadable that expands a slice of the
+                          // active tokens; defined in the .cc file.
+  friend class EmittingArcTask;
+
+  // The multi-threaded body of ProcessEmitting(), used when
+  // config_.num_decode_threads > 1.  The previous frame's tokens are
+  // partitioned across worker threads, which expand emitting arcs and compute
+  // acoustic likelihoods into per-thread candidate buffers (each thread keeps
+  // a thread-local pruning cutoff); then a serial merge phase inserts the
+  // surviving candidates into the token hash and allocates forward links (the
+  // hash and the pools only support single-threaded insertion, but the bulk
+  // of the per-frame work is in the expansion phase).  Requires a decodable
+  // whose LogLikelihood() may be called concurrently for the same frame,
+  // e.g. DecodableMatrixScaledMapped; decodables that cache state per frame
+  // are generally not safe.
+  BaseFloat ProcessEmittingParallel(DecodableInterface *decodable,
+                                    Elem *final_toks, int32 frame,
+                                    BaseFloat cur_cutoff,
+                                    BaseFloat next_cutoff,
+                                    BaseFloat adaptive_beam,
+                                    BaseFloat cost_offset);
+
   /// Processes nonemitting (epsilon) arcs for one frame.  Called after
   /// ProcessEmitting() on each frame.  The cost cutoff is computed by the
   /// preceding ProcessEmitting().
@@ -356,6 +613,18 @@ class LatticeFasterDecoder {
   // the graph.
   HashList<StateId, Token*> toks_;
 
+  // Pools that tokens and forward links are allocated from (via placement
+  // new); this avoids hitting the global allocator on each token, which can
+  // be a significant fraction of decoding time when beams are wide.  The
+  // pools are bulk-reset in InitDecoding(), via ClearActiveTokens().
+  ObjectPool<Token> token_pool_;
+  ObjectPool<ForwardLink> forward_link_pool_;
+  // The pool used instead of forward_link_pool_ when config_.compact_links
+  // is true (whichever one is unused never allocates).  The pools allocate
+  // lazily, and CompactForwardLink stores indices into this pool and into
+  // token_pool_.
+  ObjectPool<CompactForwardLink> compact_link_pool_;
+
   std::vector<TokenList> active_toks_; // Lists of tokens, indexed by
   // frame (members of TokenList are toks, must_prune_forward_links,
   // must_prune_tokens).
@@ -364,6 +633,29 @@ class LatticeFasterDecoder {
   // make it class member to avoid internal new/delete.
   const fst::Fst<fst::StdArc> &fst_;
   bool delete_fst_;
+  const EpsilonArcCache *eps_cache_;  // epsilon-arc index of fst_, or NULL;
+                                      // not owned here.  See SetEpsilonArcCache().
+  DecoderStats *stats_;  // optional instrumentation, or NULL; not owned here.
+                         // See SetDecoderStats().
+  const fst::PrefetchableFst *prefetch_fst_;  // fst_ again, if it supports
+                                              // prefetching (see
+                                              // fstext/mapped-fst.h), else
+                                              // NULL.  Set in the constructor.
+  std::vector<StateId> prefetch_states_;  // temp variable used when
+                                          // prefetching; a class member to
+                                          // avoid reallocation every frame.
+  int32 num_links_pruned_;  // forward links freed since decoding started;
+                            // only reported via stats_, but cheap to keep.
+  int32 prune_cursor_;  // the frame (plus one) where the next call to
+                        // PruneActiveTokensIncremental() will resume its
+                        // backward sweep; -1 means "start a new round".
+  // The next four members are used only with --batch-acoustic-scores:
+  // scratch for the distinct ilabels of a frame and their scores, plus a
+  // per-ilabel cache stamped with the frame it is valid for.
+  std::vector<int32> batch_indices_;
+  std::vector<BaseFloat> batch_loglikes_;
+  std::vector<int32> like_stamps_;
+  std::vector<BaseFloat> like_cache_;
   std::vector<BaseFloat> cost_offsets_; // This contains, for each
   // frame, an offset that was added to the acoustic likelihoods on that
   // frame in order to keep everything in a nice dynamic range.
@@ -403,9 +695,11 @@ class LatticeFasterDecoder {
   // can be found, which will typically be due to decoding graphs with epsilon
   // cycles, which are not allowed).  Note: the output list may contain NULLs,
   // which the caller should pass over; it just happens to be more efficient for
-  // the algorithm to output a list that contains NULLs.
-  static void TopSortTokens(Token *tok_list,
-                            std::vector<Token*> *topsorted_list);
+  // the algorithm to output a list that contains NULLs.  [This used to be
+  // static, but became a member function so that it can reach the link
+  // pools through ForwardLinkIterator.]
+  void TopSortTokens(Token *tok_list,
+                     std::vector<Token*> *topsorted_list) const;
 
   void ClearActiveTokens();
 
@@ -25,6 +25,8 @@
 
 #include "decoder/lattice-faster-online-decoder.h"
 #include "lat/lattice-functions.h"
+#include "util/const-integer-set.h"
+#include "util/text-utils.h"
 
 namespace kaldi {
 
@@ -32,7 +34,8 @@ namespace kaldi {
 LatticeFasterOnlineDecoder::LatticeFasterOnlineDecoder(
     const fst::Fst<fst::StdArc> &fst,
     const LatticeFasterDecoderConfig &config):
-    fst_(fst), delete_fst_(false), config_(config), num_toks_(0) {
+    fst_(fst), delete_fst_(false), shared_fst_(NULL), config_(config),
+    num_toks_(0), compute_frame_confidence_(false) {
   config.Check();
   toks_.SetSize(1000);  // just so on the first frame we do something reasonable.
 }
@@ -40,7 +43,18 @@ LatticeFasterOnlineDecoder::LatticeFasterOnlineDecoder(
 
 LatticeFasterOnlineDecoder::LatticeFasterOnlineDecoder(const LatticeFasterDecoderConfig &config,
                                                        fst::Fst<fst::StdArc> *fst):
-    fst_(*fst), delete_fst_(true), config_(config), num_toks_(0) {
+    fst_(*fst), delete_fst_(true), shared_fst_(NULL), config_(config),
+    num_toks_(0), compute_frame_confidence_(false) {
+  config.Check();
+  toks_.SetSize(1000);  // just so on the first frame we do something reasonable.
+}
+
+
+LatticeFasterOnlineDecoder::LatticeFasterOnlineDecoder(
+    SharedFst *shared_fst,
+    const LatticeFasterDecoderConfig &config):
+    fst_(*shared_fst->GetFst()), delete_fst_(false), shared_fst_(shared_fst),
+    config_(config), num_toks_(0), compute_frame_confidence_(false) {
   config.Check();
   toks_.SetSize(1000);  // just so on the first frame we do something reasonable.
 }
@@ -50,6 +64,7 @@ LatticeFasterOnlineDecoder::~LatticeFasterOnlineDecoder() {
   DeleteElems(toks_.Clear());
   ClearActiveTokens();
   if (delete_fst_) delete &(fst_);
+  if (shared_fst_ != NULL) shared_fst_->ReleaseFst(&fst_);
 }
 
 void LatticeFasterOnlineDecoder::InitDecoding() {
@@ -61,10 +76,17 @@ void LatticeFasterOnlineDecoder::InitDecoding() {
   num_toks_ = 0;
   decoding_finalized_ = false;
   final_costs_.clear();
+  frame_confidences_.clear();
+  chunk_begin_frame_ = 0;
+  discarded_frames_ = 0;
+  total_frames_rebased_ = 0;
+  trailing_silence_frames_ = 0;
+  endpoint_final_relative_cost_ = std::numeric_limits<BaseFloat>::infinity();
   StateId start_state = fst_.Start();
   KALDI_ASSERT(start_state != fst::kNoStateId);
   active_toks_.resize(1);
-  Token *start_tok = new Token(0.0, 0.0, NULL, NULL, NULL);
+  Token *start_tok = new (token_pool_.Malloc()) Token(0.0, 0.0, NULL, NULL,
+                                                      NULL);
   active_toks_[0].toks = start_tok;
   toks_.Insert(start_state, start_tok);
   num_toks_++;
@@ -86,6 +108,8 @@ bool LatticeFasterOnlineDecoder::Decode(DecodableInterface *decodable) {
       PruneActiveTokens(config_.lattice_beam * config_.prune_scale);
     BaseFloat cost_cutoff = ProcessEmitting(decodable);  // Note: the value returned by
     ProcessNonemitting(cost_cutoff);
+    if (compute_frame_confidence_)
+      RecordFrameConfidence();
   }
   FinalizeDecoding();
 
@@ -156,6 +180,9 @@ bool LatticeFasterOnlineDecoder::GetRawLattice(Lattice *ofst,
   if (decoding_finalized_ && !use_final_probs)
     KALDI_ERR << "You cannot call FinalizeDecoding() and then call "
               << "GetRawLattice() with use_final_probs == false";
+  if (discarded_frames_ > 0)
+    KALDI_ERR << "You cannot get a whole-utterance lattice after "
+              << "DiscardChunkFrames(); use the chunk interface.";
 
   unordered_map<Token*, BaseFloat> final_costs_local;
 
@@ -227,6 +254,208 @@ bool LatticeFasterOnlineDecoder::GetRawLattice(Lattice *ofst,
   return (ofst->NumStates() > 0);
 }
 
+int32 LatticeFasterOnlineDecoder::FindChunkBoundary() const {
+  for (int32 f = NumFramesDecoded(); f > chunk_begin_frame_; f--) {
+    Token *toks = active_toks_[f].toks;
+    if (toks != NULL && toks->next == NULL)
+      return f;
+  }
+  return -1;
+}
+
+bool LatticeFasterOnlineDecoder::GetRawLatticeChunk(
+    Lattice *ofst, int32 begin_frame, int32 end_frame,
+    bool is_final_chunk, bool use_final_probs) const {
+  typedef LatticeArc Arc;
+  typedef Arc::StateId StateId;
+  typedef Arc::Weight Weight;
+
+  KALDI_ASSERT(begin_frame >= discarded_frames_ && begin_frame <= end_frame &&
+               end_frame <= NumFramesDecoded());
+  if (decoding_finalized_ && !use_final_probs && is_final_chunk)
+    KALDI_ERR << "You cannot call FinalizeDecoding() and then call "
+              << "GetFinalLatticeChunk() with use_final_probs == false";
+
+  unordered_map<Token*, BaseFloat> final_costs_local;
+  const unordered_map<Token*, BaseFloat> &final_costs =
+      (decoding_finalized_ ? final_costs_ : final_costs_local);
+  if (is_final_chunk && !decoding_finalized_ && use_final_probs)
+    ComputeFinalCosts(&final_costs_local, NULL, NULL);
+
+  ofst->DeleteStates();
+  unordered_map<Token*, StateId> tok_map;
+  std::vector<Token*> token_list;
+  // First create all states.  Because within each frame the tokens are
+  // topologically sorted, and the chunk's first frame contains its start
+  // token first, state zero will be the start state (the single token at
+  // the previous chunk boundary, or the decoder's start token).
+  for (int32 f = begin_frame; f <= end_frame; f++) {
+    if (active_toks_[f].toks == NULL) {
+      KALDI_WARN << "GetRawLatticeChunk: no tokens active on frame " << f
+                 << ": not producing lattice.\n";
+      return false;
+    }
+    TopSortTokens(active_toks_[f].toks, &token_list);
+    for (size_t i = 0; i < token_list.size(); i++)
+      if (token_list[i] != NULL)
+        tok_map[token_list[i]] = ofst->AddState();
+  }
+  ofst->SetStart(0);
+  // Now create all arcs.  The forward links of the tokens on the end
+  // boundary of a non-final chunk are not included: they belong to the
+  // next chunk (which starts at that token).
+  for (int32 f = begin_frame; f <= end_frame; f++) {
+    for (Token *tok = active_toks_[f].toks; tok != NULL; tok = tok->next) {
+      StateId cur_state = tok_map[tok];
+      if (f < end_frame || is_final_chunk) {
+        for (ForwardLink *l = tok->links; l != NULL; l = l->next) {
+          unordered_map<Token*, StateId>::const_iterator iter =
+              tok_map.find(l->next_tok);
+          KALDI_ASSERT(iter != tok_map.end());
+          StateId nextstate = iter->second;
+          BaseFloat cost_offset = 0.0;
+          if (l->ilabel != 0) {  // emitting..
+            KALDI_ASSERT(f >= 0 && f < cost_offsets_.size());
+            cost_offset = cost_offsets_[f];
+          }
+          Arc arc(l->ilabel, l->olabel,
+                  Weight(l->graph_cost, l->acoustic_cost - cost_offset),
+                  nextstate);
+          ofst->AddArc(cur_state, arc);
+        }
+      }
+      if (f == end_frame) {
+        if (!is_final_chunk) {
+          // the chunk boundary holds a single token, which becomes the
+          // only final state; the final-weight is One() since the real
+          // final-probs will come with the last chunk.
+          KALDI_ASSERT(tok == active_toks_[f].toks && tok->next == NULL);
+          ofst->SetFinal(cur_state, LatticeWeight::One());
+        } else if (use_final_probs && !final_costs.empty()) {
+          unordered_map<Token*, BaseFloat>::const_iterator iter =
+              final_costs.find(tok);
+          if (iter != final_costs.end())
+            ofst->SetFinal(cur_state, LatticeWeight(iter->second, 0));
+        } else {
+          ofst->SetFinal(cur_state, LatticeWeight::One());
+        }
+      }
+    }
+  }
+  return (ofst->NumStates() > 0);
+}
+
+bool LatticeFasterOnlineDecoder::DeterminizeLatticeChunk(
+    Lattice *raw_fst, CompactLattice *ofst) const {
+  fst::Invert(raw_fst);  // to get word labels on the input side.
+  // The raw chunk is topologically sorted by construction (and Invert()
+  // does not change the structure), so no TopSort() is needed here.
+  fst::ArcSort(raw_fst, fst::ILabelCompare<LatticeArc>());
+  fst::DeterminizeLatticePrunedOptions det_opts;
+  det_opts.max_mem = 50000000;
+  if (!fst::DeterminizeLatticePruned(
+          *raw_fst, static_cast<double>(config_.lattice_beam), ofst,
+          det_opts)) {
+    KALDI_WARN << "Determinization of lattice chunk terminated early "
+               << "(output will be pruned tighter than the lattice-beam).";
+    return false;
+  }
+  return true;
+}
+
+bool LatticeFasterOnlineDecoder::GetLatticeChunk(CompactLattice *ofst,
+                                                 int32 *chunk_end_frame) {
+  ofst->DeleteStates();
+  if (decoding_finalized_)
+    KALDI_ERR << "You cannot call GetLatticeChunk() after "
+              << "FinalizeDecoding(); use GetFinalLatticeChunk().";
+  int32 end_frame = FindChunkBoundary();
+  if (end_frame == -1)
+    return false;  // No new boundary frame is available yet.
+  Lattice raw_fst;
+  if (!GetRawLatticeChunk(&raw_fst, chunk_begin_frame_, end_frame,
+                          false, false))
+    return false;
+  DeterminizeLatticeChunk(&raw_fst, ofst);
+  chunk_begin_frame_ = end_frame;
+  if (chunk_end_frame != NULL)
+    *chunk_end_frame = end_frame;
+  return true;
+}
+
+bool LatticeFasterOnlineDecoder::GetFinalLatticeChunk(CompactLattice *ofst,
+                                                      bool use_final_probs) {
+  ofst->DeleteStates();
+  int32 end_frame = NumFramesDecoded();
+  Lattice raw_fst;
+  if (!GetRawLatticeChunk(&raw_fst, chunk_begin_frame_, end_frame,
+                          true, use_final_probs))
+    return false;
+  DeterminizeLatticeChunk(&raw_fst, ofst);
+  chunk_begin_frame_ = end_frame;
+  return (ofst->NumStates() > 0);
+}
+
+void LatticeFasterOnlineDecoder::FreeFramesBefore(int32 frame_plus_one) {
+  KALDI_ASSERT(frame_plus_one < static_cast<int32>(active_toks_.size()));
+  for (int32 f = discarded_frames_; f < frame_plus_one; f++) {
+    for (Token *tok = active_toks_[f].toks, *next_tok; tok != NULL;
+         tok = next_tok) {
+      next_tok = tok->next;
+      DeleteForwardLinks(tok);
+      token_pool_.Free(tok);
+      num_toks_--;
+    }
+    active_toks_[f].toks = NULL;
+    active_toks_[f].must_prune_forward_links = false;
+    active_toks_[f].must_prune_tokens = false;
+  }
+  discarded_frames_ = frame_plus_one;
+}
+
+void LatticeFasterOnlineDecoder::DiscardChunkFrames() {
+  if (chunk_begin_frame_ <= discarded_frames_)
+    return;  // nothing new to free.
+  FreeFramesBefore(chunk_begin_frame_);
+  // The traceback now ends at the boundary, as it would at a start token
+  // (the freed frames' tokens must not be reachable via backpointers).
+  for (Token *tok = active_toks_[chunk_begin_frame_].toks; tok != NULL;
+       tok = tok->next)
+    tok->backpointer = NULL;
+}
+
+bool LatticeFasterOnlineDecoder::RebaseAtChunkBoundary() {
+  if (decoding_finalized_)
+    KALDI_ERR << "You cannot call RebaseAtChunkBoundary() after "
+              << "FinalizeDecoding().";
+  int32 frontier = NumFramesDecoded();
+  if (chunk_begin_frame_ != frontier)
+    return false;
+  Token *tok = active_toks_[frontier].toks;
+  if (tok == NULL || tok->next != NULL || tok->links != NULL)
+    return false;  // should not happen (the boundary held a single token
+                   // with no forward links yet), but be safe.
+  FreeFramesBefore(frontier);
+  // The boundary token becomes the start token of a fresh bookkeeping
+  // epoch: frame numbering restarts from zero, and the accumulated path
+  // cost is dropped -- it is common to every future path, and letting it
+  // grow for days would exhaust BaseFloat precision in the beam
+  // comparisons.  The token itself (and its entry in the toks_ hash,
+  // which carries the graph state) is preserved, so decoding continues
+  // exactly where it was.
+  total_frames_rebased_ += frontier;
+  tok->tot_cost = 0.0;
+  tok->backpointer = NULL;
+  active_toks_.clear();
+  active_toks_.resize(1);
+  active_toks_[0].toks = tok;
+  cost_offsets_.clear();
+  frame_confidences_.clear();
+  chunk_begin_frame_ = 0;
+  discarded_frames_ = 0;
+  return true;
+}
+
 bool LatticeFasterOnlineDecoder::GetRawLatticePruned(
     Lattice *ofst,
     bool use_final_probs,
@@ -242,6 +471,9 @@ bool LatticeFasterOnlineDecoder::GetRawLatticePruned(
   if (decoding_finalized_ && !use_final_probs)
     KALDI_ERR << "You cannot call FinalizeDecoding() and then call "
               << "GetRawLattice() with use_final_probs == false";
+  if (discarded_frames_ > 0)
+    KALDI_ERR << "You cannot get a whole-utterance lattice after "
+              << "DiscardChunkFrames(); use the chunk interface.";
 
   unordered_map<Token*, BaseFloat> final_costs_local;
 
@@ -351,7 +583,8 @@ inline LatticeFasterOnlineDecoder::Token *LatticeFasterOnlineDecoder::FindOrAddT
     // tokens on the currently final frame have zero extra_cost
     // as any of them could end up
     // on the winning path.
-    Token *new_tok = new Token (tot_cost, extra_cost, NULL, toks, backpointer);
+    Token *new_tok = new (token_pool_.Malloc()) Token(tot_cost, extra_cost,
+                                                      NULL, toks, backpointer);
     // NULL: no forward links yet
     toks = new_tok;
     num_toks_++;
@@ -425,7 +658,7 @@ void LatticeFasterOnlineDecoder::PruneForwardLinks(
           ForwardLink *next_link = link->next;
           if (prev_link != NULL) prev_link->next = next_link;
           else tok->links = next_link;
-          delete link;
+          forward_link_pool_.Free(link);
           link = next_link;  // advance link but leave prev_link the same.
           *links_pruned = true;
         } else {   // keep the link and update the tok_extra_cost if needed.
@@ -512,7 +745,7 @@ void LatticeFasterOnlineDecoder::PruneForwardLinksFinal() {
           ForwardLink *next_link = link->next;
           if (prev_link != NULL) prev_link->next = next_link;
           else tok->links = next_link;
-          delete link;
+          forward_link_pool_.Free(link);
           link = next_link; // advance link but leave prev_link the same.
         } else { // keep the link and update the tok_extra_cost if needed.
           if (link_extra_cost < 0.0) { // this is just a precaution.
@@ -542,6 +775,49 @@ void LatticeFasterOnlineDecoder::PruneForwardLinksFinal() {
 
 }
 
+void LatticeFasterOnlineDecoder::TrackTrailingSilence(
+    const TransitionModel &tmodel, const std::string &silence_phones_str) {
+  std::vector<int32> silence_phones;
+  if (!SplitStringToIntegers(silence_phones_str, ":", false, &silence_phones))
+    KALDI_ERR << "Bad --silence-phones option in endpointing config: "
+              << silence_phones_str;
+  std::sort(silence_phones.begin(), silence_phones.end());
+  KALDI_ASSERT(IsSortedAndUniq(silence_phones) &&
+               "Duplicates in --silence-phones option in endpointing config");
+  KALDI_ASSERT(!silence_phones.empty() &&
+               "Endpointing requires nonempty --endpoint.silence-phones option");
+  ConstIntegerSet<int32> silence_set(silence_phones);
+  silence_ilabels_.resize(tmodel.NumTransitionIds() + 1);
+  silence_ilabels_[0] = 0;  // epsilon; won't be looked up anyway.
+  for (int32 tid = 1; tid <= tmodel.NumTransitionIds(); tid++)
+    silence_ilabels_[tid] =
+        (silence_set.count(tmodel.TransitionIdToPhone(tid)) != 0 ? 1 : 0);
+  trailing_silence_frames_ = 0;
+  endpoint_final_relative_cost_ = std::numeric_limits<BaseFloat>::infinity();
+}
+
+bool LatticeFasterOnlineDecoder::GetCachedEndpointInfo(
+    int32 *trailing_silence_frames,
+    BaseFloat *final_relative_cost) const {
+  if (silence_ilabels_.empty() || NumFramesDecoded() <= 0)
+    return false;
+  *trailing_silence_frames = trailing_silence_frames_;
+  *final_relative_cost = endpoint_final_relative_cost_;
+  return true;
+}
+
+void LatticeFasterOnlineDecoder::UpdateCachedEndpointInfo() {
+  KALDI_ASSERT(!active_toks_.empty() && !decoding_finalized_);
+  Token *best_tok = NULL;
+  for (Token *tok = active_toks_.back().toks; tok != NULL; tok = tok->next)
+    if (best_tok == NULL || tok->tot_cost < best_tok->tot_cost)
+      best_tok = tok;
+  if (best_tok == NULL) // no surviving tokens; we warned elsewhere.
+    return;
+  trailing_silence_frames_ = best_tok->trailing_silence;
+  ComputeFinalCosts(NULL, &endpoint_final_relative_cost_, NULL);
+}
+
 BaseFloat LatticeFasterOnlineDecoder::FinalRelativeCost() const {
   if (!decoding_finalized_) {
     BaseFloat relative_cost;
@@ -572,7 +848,9 @@ void LatticeFasterOnlineDecoder::PruneTokensForFrame(int32 frame_plus_one) {
       // excise tok from list and delete tok.
       if (prev_tok != NULL) prev_tok->next = tok->next;
       else toks = tok->next;
-      delete tok;
+      DeleteForwardLinks(tok);  // in case any links survived (they can, on
+                                // the final frame).
+      token_pool_.Free(tok);
       num_toks_--;
     } else {  // fetch next Token
       prev_tok = tok;
@@ -589,8 +867,11 @@ void LatticeFasterOnlineDecoder::PruneActiveTokens(BaseFloat delta) {
   int32 cur_frame_plus_one = NumFramesDecoded();
   int32 num_toks_begin = num_toks_;
   // The index "f" below represents a "frame plus one", i.e. you'd have to subtract
-  // one to get the corresponding index for the decodable object.
-  for (int32 f = cur_frame_plus_one - 1; f >= 0; f--) {
+  // one to get the corresponding index for the decodable object.  Frames
+  // before discarded_frames_ were freed by DiscardChunkFrames(), so we stop
+  // there (nothing on a frame at or before an emitted chunk boundary can be
+  // pruned anyway).
+  for (int32 f = cur_frame_plus_one - 1; f >= discarded_frames_; f--) {
     // Reason why we need to prune forward links in this situation:
     // (1) we have never pruned them (new TokenList)
     // (2) we have not yet pruned the forward links to the next f,
@@ -598,7 +879,8 @@ void LatticeFasterOnlineDecoder::PruneActiveTokens(BaseFloat delta) {
     if (active_toks_[f].must_prune_forward_links) {
       bool extra_costs_changed = false, links_pruned = false;
       PruneForwardLinks(f, &extra_costs_changed, &links_pruned, delta);
-      if (extra_costs_changed && f > 0) // any token has changed extra_cost
+      if (extra_costs_changed && f > discarded_frames_) // any token has
+                                                        // changed extra_cost
         active_toks_[f-1].must_prune_forward_links = true;
       if (links_pruned) // any link was pruned
         active_toks_[f].must_prune_tokens = true;
@@ -758,6 +1040,7 @@ void LatticeFasterOnlineDecoder::AdvanceDecoding(DecodableInterface *decodable,
   if (max_num_frames >= 0)
     target_frames_decoded = std::min(target_frames_decoded,
                                      NumFramesDecoded() + max_num_frames);
+  int32 num_frames_decoded_at_start = NumFramesDecoded();
   while (NumFramesDecoded() < target_frames_decoded) {
     if (NumFramesDecoded() % config_.prune_interval == 0) {
       PruneActiveTokens(config_.lattice_beam * config_.prune_scale);
@@ -765,7 +1048,12 @@ void LatticeFasterOnlineDecoder::AdvanceDecoding(DecodableInterface *decodable,
     // note: ProcessEmitting() increments NumFramesDecoded().
     BaseFloat cost_cutoff = ProcessEmitting(decodable);
     ProcessNonemitting(cost_cutoff);
+    if (compute_frame_confidence_)
+      RecordFrameConfidence();
   }
+  if (!silence_ilabels_.empty() &&
+      NumFramesDecoded() > num_frames_decoded_at_start)
+    UpdateCachedEndpointInfo();
 }
 
 
@@ -778,18 +1066,38 @@ void LatticeFasterOnlineDecoder::FinalizeDecoding() {
   // PruneForwardLinksFinal() prunes final frame (with final-probs), and
   // sets decoding_finalized_.
   PruneForwardLinksFinal();
-  for (int32 f = final_frame_plus_one - 1; f >= 0; f--) {
+  for (int32 f = final_frame_plus_one - 1; f >= discarded_frames_; f--) {
     bool b1, b2; // values not used.
     BaseFloat dontcare = 0.0; // delta of zero means we must always update
     PruneForwardLinks(f, &b1, &b2, dontcare);
     PruneTokensForFrame(f + 1);
   }
-  PruneTokensForFrame(0);
+  PruneTokensForFrame(discarded_frames_);
   KALDI_VLOG(4) << "pruned tokens from " << num_toks_begin
                 << " to " << num_toks_;
 }
 
 /// Gets the weight cutoff.  Also counts the active tokens.
+void LatticeFasterOnlineDecoder::GetMemoryStats(MemoryStats *stats) const {
+  // The pools hand memory back only on destruction, so their allocated
+  // size is the high-water mark over all utterances this decoder has seen.
+  int64 pools_used = token_pool_.UsedBytes() + forward_link_pool_.UsedBytes();
+  int64 pools_allocated = token_pool_.AllocatedBytes() +
+      forward_link_pool_.AllocatedBytes();
+  // the token hash and the scratch vectors hold no per-utterance live data
+  // to speak of, so we count their allocation on both sides.
+  int64 overhead = toks_.MemoryBytes() +
+      queue_.capacity() * sizeof(StateId) +
+      tmp_array_.capacity() * sizeof(BaseFloat) +
+      silence_ilabels_.capacity() * sizeof(char);
+  stats->cur_bytes += pools_used + overhead +
+      active_toks_.size() * sizeof(TokenList) +
+      cost_offsets_.size() * sizeof(BaseFloat);
+  stats->peak_bytes += pools_allocated + overhead +
+      active_toks_.capacity() * sizeof(TokenList) +
+      cost_offsets_.capacity() * sizeof(BaseFloat);
+}
+
 BaseFloat LatticeFasterOnlineDecoder::GetCutoff(Elem *list_head, size_t *tok_count,
                                                 BaseFloat *adaptive_beam, Elem **best_elem) {
   BaseFloat best_weight = std::numeric_limits<BaseFloat>::infinity();
@@ -935,13 +1243,21 @@ BaseFloat LatticeFasterOnlineDecoder::ProcessEmitting(
             next_cutoff = tot_cost + adaptive_beam; // prune by best current token
           // Note: the frame indexes into active_toks_ are one-based,
           // hence the + 1.
+          bool changed;
           Token *next_tok = FindOrAddToken(arc.nextstate,
-                                           frame + 1, tot_cost, tok, NULL);
-          // NULL: no change indicator needed
+                                           frame + 1, tot_cost, tok, &changed);
+          // "changed" is true if the best path into next_tok is now via
+          // "tok" (i.e. its backpointer was just updated); at that point we
+          // keep its trailing-silence count in sync, if we're tracking it.
+          if (!silence_ilabels_.empty() && changed)
+            next_tok->trailing_silence =
+                (silence_ilabels_[arc.ilabel] != 0 ?
+                 tok->trailing_silence + 1 : 0);
 
           // Add ForwardLink from tok to next_tok (put on head of list tok->links)
-          tok->links = new ForwardLink(next_tok, arc.ilabel, arc.olabel,
-                                       graph_cost, ac_cost, tok->links);
+          tok->links = new (forward_link_pool_.Malloc()) ForwardLink(
+              next_tok, arc.ilabel, arc.olabel, graph_cost, ac_cost,
+              tok->links);
         }
       } // for all arcs
     }
@@ -951,6 +1267,37 @@ BaseFloat LatticeFasterOnlineDecoder::ProcessEmitting(
   return next_cutoff;
 }
 
+void LatticeFasterOnlineDecoder::RecordFrameConfidence() {
+  FrameConfidence conf;
+  BaseFloat best_cost = std::numeric_limits<BaseFloat>::infinity(),
+      second_cost = std::numeric_limits<BaseFloat>::infinity();
+  for (const Elem *e = toks_.GetList(); e != NULL; e = e->tail) {
+    BaseFloat cost = e->val->tot_cost;
+    if (cost < best_cost) {
+      second_cost = best_cost;
+      best_cost = cost;
+    } else if (cost < second_cost) {
+      second_cost = cost;
+    }
+    conf.num_toks++;
+  }
+  conf.margin = second_cost - best_cost;
+  // Entropy of the distribution p_i proportional to exp(best_cost -
+  // cost_i); computed as log(sum) + (sum of p*cost) / sum, in one further
+  // pass.  Doubles, as the terms can be small and numerous.
+  double sum = 0.0, cost_sum = 0.0;
+  for (const Elem *e = toks_.GetList(); e != NULL; e = e->tail) {
+    double p = Exp(static_cast<double>(best_cost - e->val->tot_cost));
+    sum += p;
+    cost_sum += p * (e->val->tot_cost - best_cost);
+  }
+  if (sum > 0.0)
+    conf.entropy = Log(sum) + cost_sum / sum;
+  frame_confidences_.push_back(conf);
+  KALDI_PARANOID_ASSERT(static_cast<int32>(frame_confidences_.size()) ==
+                        NumFramesDecoded());
+}
+
 void LatticeFasterOnlineDecoder::ProcessNonemitting(BaseFloat cutoff) {
   KALDI_ASSERT(!active_toks_.empty());
   int32 frame = static_cast<int32>(active_toks_.size()) - 2;
@@ -986,8 +1333,7 @@ void LatticeFasterOnlineDecoder::ProcessNonemitting(BaseFloat cutoff) {
     // because we're about to regenerate them.  This is a kind
     // of non-optimality (remember, this is the simple decoder),
     // but since most states are emitting it's not a huge issue.
-    tok->DeleteForwardLinks(); // necessary when re-visiting
-    tok->links = NULL;
+    DeleteForwardLinks(tok); // necessary when re-visiting
     for (fst::ArcIterator<fst::Fst<Arc> > aiter(fst_, state);
          !aiter.Done();
          aiter.Next()) {
@@ -1001,8 +1347,13 @@ void LatticeFasterOnlineDecoder::ProcessNonemitting(BaseFloat cutoff) {
           Token *new_tok = FindOrAddToken(arc.nextstate, frame + 1, tot_cost,
                                           tok, &changed);
 
-          tok->links = new ForwardLink(new_tok, 0, arc.olabel,
-                                       graph_cost, 0, tok->links);
+          // Nonemitting arcs don't cross a frame, so the trailing-silence
+          // count just carries over when the backpointer is updated.
+          if (!silence_ilabels_.empty() && changed)
+            new_tok->trailing_silence = tok->trailing_silence;
+
+          tok->links = new (forward_link_pool_.Malloc()) ForwardLink(
+              new_tok, 0, arc.olabel, graph_cost, 0, tok->links);
 
           // "changed" tells us whether the new token has a different
           // cost from before, or is new [if so, add into queue].
@@ -1022,20 +1373,24 @@ void LatticeFasterOnlineDecoder::DeleteElems(Elem *list) {
   }
 }
 
-void LatticeFasterOnlineDecoder::ClearActiveTokens() { // a cleanup routine, at utt end/begin
-  for (size_t i = 0; i < active_toks_.size(); i++) {
-    // Delete all tokens alive on this frame, and any forward
-    // links they may have.
-    for (Token *tok = active_toks_[i].toks; tok != NULL; ) {
-      tok->DeleteForwardLinks();
-      Token *next_tok = tok->next;
-      delete tok;
-      num_toks_--;
-      tok = next_tok;
-    }
+void LatticeFasterOnlineDecoder::DeleteForwardLinks(Token *tok) {
+  ForwardLink *l = tok->links, *m;
+  while (l != NULL) {
+    m = l->next;
+    forward_link_pool_.Free(l);
+    l = m;
   }
+  tok->links = NULL;
+}
+
+void LatticeFasterOnlineDecoder::ClearActiveTokens() { // a cleanup routine, at utt end/begin
+  // All tokens and forward links live in the pools, so rather than freeing
+  // them one by one we reset the pools, which returns all their memory to
+  // the free state in one go (keeping it allocated for the next utterance).
   active_toks_.clear();
-  KALDI_ASSERT(num_toks_ == 0);
+  num_toks_ = 0;
+  token_pool_.Clear();
+  forward_link_pool_.Clear();
 }
 
 // static
@@ -28,6 +28,7 @@
 
 #include "util/stl-utils.h"
 #include "util/hash-list.h"
+#include "util/object-pool.h"
 #include "fst/fstlib.h"
 #include "itf/decodable-itf.h"
 #include "fstext/fstext-lib.h"
@@ -35,6 +36,8 @@
 #include "lat/kaldi-lattice.h"
 // Use the same configuration class as LatticeFasterDecoder.
 #include "decoder/lattice-faster-decoder.h"
+#include "decoder/shared-fst.h"
+#include "hmm/transition-model.h"
 
 namespace kaldi {
 
@@ -72,6 +75,14 @@ class LatticeFasterOnlineDecoder {
   LatticeFasterOnlineDecoder(const LatticeFasterDecoderConfig &config,
                              fst::Fst<fst::StdArc> *fst);
 
+  // This version of the initializer gets the graph from a SharedFst (see
+  // decoder/shared-fst.h), which supports replacing the graph in a running
+  // server: this decoder keeps a reference to whichever graph is current at
+  // construction time, even if the SharedFst is given a new graph while we
+  // decode, and releases the reference when destroyed.
+  LatticeFasterOnlineDecoder(SharedFst *shared_fst,
+                             const LatticeFasterDecoderConfig &config);
+
 
   void SetOptions(const LatticeFasterDecoderConfig &config) {
     config_ = config;
@@ -189,10 +200,135 @@ class LatticeFasterOnlineDecoder {
   /// reasonable likelihood.
   BaseFloat FinalRelativeCost() const;
 
+  /// Adds to *stats the dynamic memory held by this decoder: the token and
+  /// forward-link pools, the token hash and the per-frame vectors (see
+  /// util/memory-stats.h for the conventions).  Cheap enough to poll once
+  /// per utterance, e.g. just before InitDecoding() of the next one.
+  void GetMemoryStats(MemoryStats *stats) const;
+
+  /// Tells the decoder to keep track, as tokens advance, of the quantities
+  /// the endpointing code needs: the number of trailing silence frames on the
+  /// best path, and the final relative cost [c.f. FinalRelativeCost()]; see
+  /// GetCachedEndpointInfo().  "silence_phones" is a colon-separated list of
+  /// phones we consider as silence, as in --endpoint.silence-phones.  Call
+  /// this before decoding starts (tracking stays enabled across calls to
+  /// InitDecoding()); enabling it mid-utterance would under-count any
+  /// silence run in progress.
+  void TrackTrailingSilence(const TransitionModel &tmodel,
+                            const std::string &silence_phones);
+
+  /// If TrackTrailingSilence() has been called and we have decoded something,
+  /// outputs the cached endpointing quantities and returns true; this is
+  /// O(1), unlike the best-path traceback the endpointing code does
+  /// otherwise.  The cached values are refreshed at the end of each
+  /// AdvanceDecoding() call (this is not supported with Decode()).  Returns
+  /// false if we are not tracking trailing silence, or decoded no frames.
+  bool GetCachedEndpointInfo(int32 *trailing_silence_frames,
+                             BaseFloat *final_relative_cost) const;
+
   // Returns the number of frames decoded so far.  The value returned changes
   // whenever we call ProcessEmitting().
   inline int32 NumFramesDecoded() const { return active_toks_.size() - 1; }
 
+  /// Per-frame confidence signals, cheap byproducts of the search recorded
+  /// as each frame is decoded; see EnableFrameConfidence().  Unlike
+  /// lattice-posterior confidence (lat/confidence.h), these do not need the
+  /// full lattice, so they are usable mid-utterance, at the price of being
+  /// less exact (they describe the token distribution, which reflects only
+  /// the past, not the lattice posterior).
+  struct FrameConfidence {
+    BaseFloat margin;   // cost of the second-best active token minus the
+                        // best; infinity if only one token is active.
+    BaseFloat entropy;  // entropy (in nats) of the active-token
+                        // distribution, with token costs interpreted as
+                        // negative log-probabilities.  Near zero when one
+                        // hypothesis dominates; large when many compete.
+    int32 num_toks;     // number of active tokens on this frame.
+    FrameConfidence(): margin(0.0), entropy(0.0), num_toks(0) { }
+  };
+
+  /// Call this before InitDecoding() or Decode() to make the decoder record
+  /// a FrameConfidence for each frame as it is decoded; it stays enabled
+  /// for the life of the decoder.  Off by default as it costs an extra pass
+  /// over the token list per frame.
+  void EnableFrameConfidence() { compute_frame_confidence_ = true; }
+
+  /// Returns the confidence signals for the frames decoded so far, indexed
+  /// by frame (zero-based); entry t is valid as soon as NumFramesDecoded()
+  /// exceeds t, so callers interleaving this with AdvanceDecoding() can act
+  /// on low confidence mid-utterance.  Empty if EnableFrameConfidence() was
+  /// never called.
+  const std::vector<FrameConfidence> &GetFrameConfidences() const {
+    return frame_confidences_;
+  }
+
+  /// This function supports incremental lattice output: between calls to
+  /// AdvanceDecoding(), it emits the part of the lattice that has become
+  /// "frozen" since the last chunk, as a determinized CompactLattice, so
+  /// that downstream processing (e.g. LM rescoring) can start before the
+  /// utterance ends.  A chunk ends at the most recent frame on which
+  /// exactly one token is active: every path passes through that token, so
+  /// the chunk can never be invalidated by later frames.  Each non-final
+  /// chunk has exactly one final state (with unit final-weight),
+  /// corresponding to the start state of the next chunk; concatenating the
+  /// chunks in order (e.g. with fst::Concat()) gives a lattice over the
+  /// whole utterance, equivalent to what GetRawLattice() plus
+  /// determinization would have produced except that tokens already
+  /// emitted in a chunk can no longer be removed by later lattice pruning
+  /// (so the concatenation may keep slightly more paths).  Each chunk is
+  /// determinized and pruned to the configured lattice-beam.
+  ///
+  /// Returns false if no new boundary frame is available yet (call again
+  /// after decoding more frames); otherwise outputs the chunk, outputs the
+  /// zero-based end frame of the chunk to "chunk_end_frame" if non-NULL,
+  /// and advances the internal chunk position.  May not be called after
+  /// FinalizeDecoding(); use GetFinalLatticeChunk() for the last chunk.
+  bool GetLatticeChunk(CompactLattice *ofst,
+                       int32 *chunk_end_frame = NULL);
+
+  /// Emits the last chunk, from the previous chunk boundary to the end of
+  /// the utterance, with real final-probs (if use_final_probs == true and
+  /// a final state was reached; the same rules as GetRawLattice() apply).
+  /// Call this once, after FinalizeDecoding() (or at any point when you do
+  /// not intend to decode further).  If no chunk was previously emitted
+  /// this outputs the determinized lattice of the whole utterance.
+  /// Returns true if the output is nonempty.
+  bool GetFinalLatticeChunk(CompactLattice *ofst,
+                            bool use_final_probs = true);
+
+  /// Frees the tokens, forward links and traceback of all frames before
+  /// the last emitted chunk boundary (see GetLatticeChunk()).  Together
+  /// with the chunk interface this bounds the token memory of a
+  /// continuously running stream by the distance between the decoding
+  /// frontier and the last boundary, instead of growing with the session.
+  /// After calling this, the whole-utterance outputs (GetRawLattice(),
+  /// GetRawLatticePruned()) may no longer be used, and best-path
+  /// tracebacks end at the boundary rather than at the start of the
+  /// utterance; the chunk interface is unaffected.
+  void DiscardChunkFrames();
+
+  /// For unbounded (24/7) sessions.  When the last chunk boundary
+  /// coincides with the decoding frontier -- i.e. GetLatticeChunk() has
+  /// emitted everything decoded so far, which happens whenever the
+  /// frontier narrows to a single token, e.g. in a pause -- this rebases
+  /// the decoder's bookkeeping in place: all earlier frames are freed,
+  /// frame numbering restarts from zero at the boundary token, and the
+  /// accumulated path cost (common to every future path, and large enough
+  /// after hours of audio to exhaust float precision) is dropped.  The
+  /// decoding state itself is preserved exactly, so unlike re-running
+  /// InitDecoding() no audio is lost.  The caller must supply a decodable
+  /// object whose frame numbering also restarts at zero to subsequent
+  /// AdvanceDecoding() calls.  Returns false (doing nothing) if the
+  /// boundary is not at the frontier; call GetLatticeChunk() first.
+  bool RebaseAtChunkBoundary();
+
+  /// Total frames decoded since InitDecoding(), including frames dropped
+  /// from the numbering by RebaseAtChunkBoundary(); int64, so it stays
+  /// monotonic for arbitrarily long sessions.
+  int64 TotalFramesDecoded() const {
+    return total_frames_rebased_ + NumFramesDecoded();
+  }
+
  private:
   // ForwardLinks are the links from a token to a token on the next frame.
   // or sometimes on the current frame (for input-epsilon links).
@@ -236,19 +372,16 @@ class LatticeFasterOnlineDecoder {
                         // the lattice generation (the "links" list is what
                         // stores the forward links, for that).
 
+    int32 trailing_silence; // number of consecutive silence frames ending at
+                            // this token, along the backpointer traceback.
+                            // Only maintained if TrackTrailingSilence() was
+                            // called (else it stays zero); used for cheap
+                            // endpointing.
+
     inline Token(BaseFloat tot_cost, BaseFloat extra_cost, ForwardLink *links,
                  Token *next, Token *backpointer):
         tot_cost(tot_cost), extra_cost(extra_cost), links(links), next(next),
-        backpointer(backpointer) { }
-    inline void DeleteForwardLinks() {
-      ForwardLink *l = links, *m;
-      while (l != NULL) {
-        m = l->next;
-        delete l;
-        l = m;
-      }
-      links = NULL;
-    }
+        backpointer(backpointer), trailing_silence(0) { }
   };
 
   // head of per-frame list of Tokens (list is in topological order),
@@ -277,6 +410,11 @@ class LatticeFasterOnlineDecoder {
                                BaseFloat tot_cost, Token *backpointer,
                                bool *changed);
 
+  // Deletes a token's forward links, returning them to forward_link_pool_,
+  // and sets tok->links to NULL.  [This used to be a member of Token, but
+  // moved here when tokens and links became pool-allocated.]
+  void DeleteForwardLinks(Token *tok);
+
   // prunes outgoing links for all tokens in active_toks_[frame]
   // it's called by PruneActiveTokens
   // all links, that have link_extra_cost > lattice_beam are pruned
@@ -343,7 +481,16 @@ class LatticeFasterOnlineDecoder {
   /// ProcessEmitting() on each frame.  The cost cutoff is computed by the
   /// preceding ProcessEmitting().
   void ProcessNonemitting(BaseFloat cost_cutoff);
-  
+
+  // Recomputes the values returned by GetCachedEndpointInfo(); called at the
+  // end of AdvanceDecoding() when TrackTrailingSilence() was called.
+  void UpdateCachedEndpointInfo();
+
+  // Appends the FrameConfidence for the frame just decoded, from one pass
+  // over the current token list; called after ProcessNonemitting() on each
+  // frame, if EnableFrameConfidence() was called.
+  void RecordFrameConfidence();
+
   // HashList defined in ../util/hash-list.h.  It actually allows us to maintain
   // more than one list (e.g. for current and previous frames), but only one of
   // them at a time can be indexed by StateId.  It is indexed by frame-index
@@ -353,14 +500,35 @@ class LatticeFasterOnlineDecoder {
   // the graph.
   HashList<StateId, Token*> toks_;
 
+  // Pools that tokens and forward links are allocated from (via placement
+  // new); this avoids hitting the global allocator on each token, which can
+  // be a significant fraction of decoding time when beams are wide.  The
+  // pools are bulk-reset in InitDecoding(), via ClearActiveTokens().
+  ObjectPool<Token> token_pool_;
+  ObjectPool<ForwardLink> forward_link_pool_;
+
   std::vector<TokenList> active_toks_; // Lists of tokens, indexed by
   // frame (members of TokenList are toks, must_prune_forward_links,
   // must_prune_tokens).
   std::vector<StateId> queue_;  // temp variable used in ProcessNonemitting,
   std::vector<BaseFloat> tmp_array_;  // used in GetCutoff.
   // make it class member to avoid internal new/delete.
+
+  // silence_ilabels_ is empty unless TrackTrailingSilence() was called; then
+  // it is indexed by transition-id, and nonzero for transition-ids whose
+  // phone is a silence phone.
+  std::vector<char> silence_ilabels_;
+  // The values output by GetCachedEndpointInfo(); see UpdateCachedEndpointInfo().
+  int32 trailing_silence_frames_;
+  BaseFloat endpoint_final_relative_cost_;
+
+  bool compute_frame_confidence_;  // see EnableFrameConfidence().
+  std::vector<FrameConfidence> frame_confidences_;  // indexed by frame.
+
   const fst::Fst<fst::StdArc> &fst_;
   bool delete_fst_;
+  SharedFst *shared_fst_;  // non-NULL if fst_ came from a SharedFst, to
+                           // which we release it in the destructor.
   std::vector<BaseFloat> cost_offsets_; // This contains, for each
   // frame, an offset that was added to the acoustic likelihoods on that
   // frame in order to keep everything in a nice dynamic range.
@@ -382,6 +550,20 @@ class LatticeFasterOnlineDecoder {
   BaseFloat final_relative_cost_;
   BaseFloat final_best_cost_;
 
+  /// The frame up to which we have emitted incremental lattice chunks (0
+  /// if none was emitted yet); the next chunk starts at the (single)
+  /// token active on this frame.  See GetLatticeChunk().
+  int32 chunk_begin_frame_;
+
+  /// Frames before this index in active_toks_ have had their tokens freed
+  /// by DiscardChunkFrames(); always <= chunk_begin_frame_.
+  int32 discarded_frames_;
+
+  /// Number of frames dropped from the numbering by
+  /// RebaseAtChunkBoundary(), since InitDecoding(); see
+  /// TotalFramesDecoded().
+  int64 total_frames_rebased_;
+
   // There are various cleanup tasks... the the toks_ structure contains
   // singly linked lists of Token pointers, where Elem is the list type.
   // It also indexes them in a hash, indexed by state (this hash is only
@@ -404,6 +586,35 @@ class LatticeFasterOnlineDecoder {
   static void TopSortTokens(Token *tok_list,
                             std::vector<Token*> *topsorted_list);
 
+  // Returns the latest frame later than chunk_begin_frame_ on which exactly
+  // one token is active (a frame every path passes through, so a valid
+  // incremental-chunk boundary), or -1 if there is none.  Once a frame has
+  // a single token it keeps a single token, since tokens are only ever
+  // added to the most recent frame and the token cannot be pruned while it
+  // has surviving descendants.
+  int32 FindChunkBoundary() const;
+
+  // Outputs the raw (state-level) lattice of the tokens on frames
+  // begin_frame through end_frame, with the same conventions as
+  // GetRawLattice(): used by GetLatticeChunk() and GetFinalLatticeChunk().
+  // If is_final_chunk == false, end_frame must hold a single token, which
+  // becomes the one final state (with unit final-weight) and whose forward
+  // links are left for the next chunk; otherwise final-probs are handled
+  // as in GetRawLattice().
+  bool GetRawLatticeChunk(Lattice *ofst, int32 begin_frame, int32 end_frame,
+                          bool is_final_chunk, bool use_final_probs) const;
+
+  // Determinizes a raw lattice chunk (as output by GetRawLatticeChunk(),
+  // so already topologically sorted), pruning to the configured
+  // lattice-beam.  Returns false if determinization terminated early.
+  bool DeterminizeLatticeChunk(Lattice *raw_fst, CompactLattice *ofst) const;
+
+  // Frees the tokens and forward links of frames [discarded_frames_,
+  // frame_plus_one), leaving empty token lists, and advances
+  // discarded_frames_; called by DiscardChunkFrames() and
+  // RebaseAtChunkBoundary().
+  void FreeFramesBefore(int32 frame_plus_one);
+
   void ClearActiveTokens();
 
 
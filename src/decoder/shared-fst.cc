@@ -0,0 +1,84 @@
+// decoder/shared-fst.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "decoder/shared-fst.h"
+
+namespace kaldi {
+
+void SharedFst::SetFst(fst::Fst<fst::StdArc> *fst) {
+  KALDI_ASSERT(fst != NULL);
+  mutex_.Lock();
+  if (cur_fst_ != NULL) {
+    // Release the reference that *this held on the graph being retired;
+    // if no decoder was using it (e.g. two swaps in quick succession),
+    // delete it right away.
+    KALDI_ASSERT(!graphs_.empty() && graphs_.back().fst == cur_fst_);
+    if (--graphs_.back().ref_count == 0) {
+      delete graphs_.back().fst;
+      graphs_.pop_back();
+    }
+  }
+  graphs_.push_back(GraphEntry(fst));
+  cur_fst_ = fst;
+  mutex_.Unlock();
+}
+
+const fst::Fst<fst::StdArc> *SharedFst::GetFst() {
+  mutex_.Lock();
+  KALDI_ASSERT(cur_fst_ != NULL && "SharedFst::GetFst() called before SetFst()");
+  graphs_.back().ref_count++;
+  const fst::Fst<fst::StdArc> *ans = cur_fst_;
+  mutex_.Unlock();
+  return ans;
+}
+
+void SharedFst::ReleaseFst(const fst::Fst<fst::StdArc> *fst) {
+  mutex_.Lock();
+  size_t i;
+  for (i = 0; i < graphs_.size(); i++)
+    if (graphs_[i].fst == fst)
+      break;
+  KALDI_ASSERT(i < graphs_.size() &&
+               "Releasing an fst this SharedFst does not own");
+  if (--graphs_[i].ref_count == 0) {
+    // can't happen for the current graph, which *this holds a reference to.
+    KALDI_ASSERT(fst != cur_fst_);
+    delete graphs_[i].fst;
+    graphs_.erase(graphs_.begin() + i);
+  }
+  mutex_.Unlock();
+}
+
+int32 SharedFst::NumGraphs() {
+  mutex_.Lock();
+  int32 ans = graphs_.size();
+  mutex_.Unlock();
+  return ans;
+}
+
+SharedFst::~SharedFst() {
+  for (size_t i = 0; i < graphs_.size(); i++) {
+    if (graphs_[i].fst != cur_fst_ || graphs_[i].ref_count != 1)
+      KALDI_WARN << "Destroying SharedFst while decoders still hold "
+                 << "references to its graphs.";
+    delete graphs_[i].fst;
+  }
+}
+
+}  // end namespace kaldi.
@@ -0,0 +1,93 @@
+// decoder/shared-fst.h
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_DECODER_SHARED_FST_H_
+#define KALDI_DECODER_SHARED_FST_H_
+
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "fst/fstlib.h"
+#include "thread/kaldi-mutex.h"
+
+namespace kaldi {
+
+/// SharedFst owns one or more decoding graphs and hands out
+/// reference-counted pointers to the current one, so that a long-running
+/// server can swap in a freshly compiled HCLG without restarting:
+/// decoders created after SetFst() use the new graph, decoders still
+/// decoding keep the graph they started with, and each retired graph is
+/// deleted when the last decoder using it releases its reference.  All
+/// member functions may be called concurrently from multiple threads (the
+/// reference counts are protected by a mutex; the graphs themselves are
+/// only ever read).  LatticeFasterOnlineDecoder accepts a SharedFst*
+/// directly and does the GetFst()/ReleaseFst() calls itself.
+class SharedFst {
+ public:
+  SharedFst(): cur_fst_(NULL) { }
+
+  /// Takes ownership of "fst" and makes it the current graph; equivalent
+  /// to calling SetFst() on a default-constructed object.
+  explicit SharedFst(fst::Fst<fst::StdArc> *fst): cur_fst_(NULL) {
+    SetFst(fst);
+  }
+
+  /// Takes ownership of "fst" (which must not be NULL) and makes it the
+  /// graph that subsequent GetFst() calls return.  The previous graph, if
+  /// any, stays alive until the last reference to it is released.
+  void SetFst(fst::Fst<fst::StdArc> *fst);
+
+  /// Returns the current graph and increments its reference count; the
+  /// caller must hand the returned pointer back to ReleaseFst() when done
+  /// decoding with it.  It is an error to call this before SetFst().
+  const fst::Fst<fst::StdArc> *GetFst();
+
+  /// Releases a reference obtained from GetFst().  If "fst" is no longer
+  /// the current graph and this was its last reference, it is deleted
+  /// here.
+  void ReleaseFst(const fst::Fst<fst::StdArc> *fst);
+
+  /// Returns the number of graphs currently alive: the current one plus
+  /// any retired graphs that in-flight decoders still reference.
+  /// Intended for logging and diagnostics.
+  int32 NumGraphs();
+
+  /// Deletes all owned graphs.  All references should have been released
+  /// by now, i.e. any decoders using this object must be destroyed first.
+  ~SharedFst();
+
+ private:
+  struct GraphEntry {
+    const fst::Fst<fst::StdArc> *fst;
+    int32 ref_count;  // number of GetFst() calls not yet released, plus
+                      // one for *this while this is the current graph.
+    explicit GraphEntry(const fst::Fst<fst::StdArc> *fst):
+        fst(fst), ref_count(1) { }
+  };
+
+  Mutex mutex_;  // guards graphs_ and cur_fst_.
+  std::vector<GraphEntry> graphs_;  // the current graph is graphs_.back().
+  const fst::Fst<fst::StdArc> *cur_fst_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(SharedFst);
+};
+
+}  // end namespace kaldi.
+
+#endif  // KALDI_DECODER_SHARED_FST_H_
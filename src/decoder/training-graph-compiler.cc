@@ -15,8 +15,13 @@
 // MERCHANTABLITY OR NON-INFRINGEMENT.
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
+#include <fstream>
+#include <sstream>
+
 #include "decoder/training-graph-compiler.h"
 #include "hmm/hmm-utils.h" // for GetHTransducer
+#include "util/kaldi-io.h"
+#include "thread/kaldi-thread.h"
 
 namespace kaldi {
 
@@ -27,7 +32,8 @@ TrainingGraphCompiler::TrainingGraphCompiler(const TransitionModel &trans_model,
                                              const std::vector<int32> &disambig_syms,
                                              const TrainingGraphCompilerOptions &opts):
     trans_model_(trans_model), ctx_dep_(ctx_dep), lex_fst_(lex_fst),
-    disambig_syms_(disambig_syms), opts_(opts) {
+    disambig_syms_(disambig_syms), cache_hits_(0), cache_misses_(0),
+    opts_(opts) {
   using namespace fst;
   const std::vector<int32> &phone_syms = trans_model_.GetPhones();  // needed to create context fst.
 
@@ -44,18 +50,135 @@ TrainingGraphCompiler::TrainingGraphCompiler(const TransitionModel &trans_model,
   if (!disambig_syms_.empty() && subseq_symbol <= disambig_syms_.back())
     subseq_symbol = 1 + disambig_syms_.back();
 
-  {
-    int32 N = ctx_dep.ContextWidth(),
-        P = ctx_dep.CentralPosition();
-    if (P != N-1)
-      AddSubsequentialLoop(subseq_symbol, lex_fst_);  // This is needed for
-    // systems with right-context or we will not successfully compose
-    // with C.
+  if (lex_fst_ != NULL) {  // NULL is allowed for phone-level-only use.
+    {
+      int32 N = ctx_dep.ContextWidth(),
+          P = ctx_dep.CentralPosition();
+      if (P != N-1)
+        AddSubsequentialLoop(subseq_symbol, lex_fst_);  // This is needed for
+      // systems with right-context or we will not successfully compose
+      // with C.
+    }
+
+    {  // make sure lexicon is olabel sorted.
+      fst::OLabelCompare<fst::StdArc> olabel_comp;
+      fst::ArcSort(lex_fst_, olabel_comp);
+    }
   }
+}
 
-  {  // make sure lexicon is olabel sorted.
-    fst::OLabelCompare<fst::StdArc> olabel_comp;
-    fst::ArcSort(lex_fst_, olabel_comp);
+TrainingGraphCompiler::~TrainingGraphCompiler() {
+  if (CacheEnabled() && cache_hits_ + cache_misses_ != 0)
+    KALDI_VLOG(1) << "Graph cache: " << cache_hits_ << " hits, "
+                  << cache_misses_ << " misses.";
+  for (GraphCacheList::iterator iter = graph_cache_list_.begin();
+       iter != graph_cache_list_.end(); ++iter)
+    delete iter->second;
+  delete lex_fst_;
+}
+
+std::string TrainingGraphCompiler::GraphCacheFilename(
+    const std::vector<int32> &transcript) const {
+  size_t hash = VectorHasher<int32>()(transcript);
+  // Mix in a coarse fingerprint of the model, tree and options.  This does
+  // not protect against e.g. a changed lexicon with identical dimensions;
+  // the cache directory must not be shared between different systems.
+  hash = hash * 31 + trans_model_.NumTransitionIds();
+  hash = hash * 31 + ctx_dep_.NumPdfs();
+  hash = hash * 31 + ctx_dep_.ContextWidth();
+  hash = hash * 31 + ctx_dep_.CentralPosition();
+  hash = hash * 31 + static_cast<size_t>(100.0 * opts_.transition_scale);
+  hash = hash * 31 + static_cast<size_t>(100.0 * opts_.self_loop_scale);
+  hash = hash * 31 + (opts_.reorder ? 1 : 0);
+  std::ostringstream os;
+  os << opts_.graph_cache_dir << "/graph." << std::hex << hash << ".fst";
+  return os.str();
+}
+
+bool TrainingGraphCompiler::GetCachedGraph(
+    const std::vector<int32> &transcript,
+    fst::VectorFst<fst::StdArc> *out_fst) {
+  using namespace fst;
+  if (opts_.graph_cache_size > 0) {
+    unordered_map<std::vector<int32>, GraphCacheList::iterator,
+        VectorHasher<int32> >::iterator iter =
+        graph_cache_index_.find(transcript);
+    if (iter != graph_cache_index_.end()) {
+      graph_cache_list_.splice(graph_cache_list_.begin(),
+                               graph_cache_list_, iter->second);
+      *out_fst = *(iter->second->second);
+      cache_hits_++;
+      return true;
+    }
+  }
+  if (!opts_.graph_cache_dir.empty()) {
+    std::string filename = GraphCacheFilename(transcript);
+    std::ifstream test(filename.c_str(), std::ios_base::in);
+    if (test.good()) {
+      test.close();
+      try {
+        bool binary;
+        Input ki(filename, &binary);
+        KALDI_ASSERT(binary);
+        std::vector<int32> cached_transcript;
+        ReadIntegerVector(ki.Stream(), binary, &cached_transcript);
+        if (cached_transcript != transcript) {  // hash collision (rare).
+          KALDI_WARN << "Transcript mismatch in cached graph " << filename
+                     << " (hash collision?): will recompile.";
+        } else {
+          VectorFst<StdArc> *cached_fst =
+              VectorFst<StdArc>::Read(ki.Stream(), FstReadOptions(filename));
+          if (cached_fst == NULL)
+            KALDI_ERR << "Error reading cached graph from " << filename;
+          *out_fst = *cached_fst;
+          delete cached_fst;
+          cache_hits_++;
+          return true;
+        }
+      } catch (const std::exception &e) {
+        KALDI_WARN << "Error reading cached graph " << filename
+                   << ", will recompile: " << e.what();
+      }
+    }
+  }
+  cache_misses_++;
+  return false;
+}
+
+void TrainingGraphCompiler::CacheGraph(
+    const std::vector<int32> &transcript,
+    const fst::VectorFst<fst::StdArc> &graph) {
+  using namespace fst;
+  if (opts_.graph_cache_size > 0 &&
+      graph_cache_index_.count(transcript) == 0) {
+    graph_cache_list_.push_front(
+        std::make_pair(transcript, new VectorFst<StdArc>(graph)));
+    graph_cache_index_[transcript] = graph_cache_list_.begin();
+    if (static_cast<int32>(graph_cache_index_.size()) >
+        opts_.graph_cache_size) {  // evict the least recently used entry.
+      graph_cache_index_.erase(graph_cache_list_.back().first);
+      delete graph_cache_list_.back().second;
+      graph_cache_list_.pop_back();
+    }
+  }
+  if (!opts_.graph_cache_dir.empty()) {
+    std::string filename = GraphCacheFilename(transcript);
+    std::ifstream test(filename.c_str(), std::ios_base::in);
+    if (!test.good()) {  // not already written (e.g. by another job).
+      try {
+        Output ko(filename, true);
+        WriteIntegerVector(ko.Stream(), true, transcript);
+        FstWriteOptions wopts(filename);
+        if (!graph.Write(ko.Stream(), wopts))
+          KALDI_ERR << "Error writing cached graph to " << filename;
+      } catch (const std::exception &e) {
+        // Failure to write the cache is not fatal, but if the directory is
+        // unwritable every transcript would fail, so disable the disk tier.
+        KALDI_WARN << "Error writing cached graph " << filename
+                   << ": disabling on-disk graph cache: " << e.what();
+        opts_.graph_cache_dir = "";
+      }
+    }
   }
 }
 
@@ -63,9 +186,14 @@ bool TrainingGraphCompiler::CompileGraphFromText(
     const std::vector<int32> &transcript,
     fst::VectorFst<fst::StdArc> *out_fst) {
   using namespace fst;
+  if (CacheEnabled() && GetCachedGraph(transcript, out_fst))
+    return true;
   VectorFst<StdArc> word_fst;
   MakeLinearAcceptor(transcript, &word_fst);
-  return CompileGraph(word_fst, out_fst);
+  bool ans = CompileGraph(word_fst, out_fst);
+  if (ans && CacheEnabled())
+    CacheGraph(transcript, *out_fst);
+  return ans;
 }
 
 bool TrainingGraphCompiler::CompileGraph(const fst::VectorFst<fst::StdArc> &word_fst,
@@ -80,6 +208,42 @@ bool TrainingGraphCompiler::CompileGraph(const fst::VectorFst<fst::StdArc> &word
 
   KALDI_ASSERT(phone2word_fst.Start() != kNoStateId);
 
+  return CompileGraphFromPhoneFst(phone2word_fst, out_fst);
+}
+
+bool TrainingGraphCompiler::CompileGraphFromPhones(
+    const std::vector<int32> &phone_transcript,
+    fst::VectorFst<fst::StdArc> *out_fst) {
+  using namespace fst;
+  VectorFst<StdArc> phone_fst;
+  MakeLinearAcceptor(phone_transcript, &phone_fst);
+  return CompileGraphFromPhoneFst(phone_fst, out_fst);
+}
+
+bool TrainingGraphCompiler::CompilePhoneLoopGraph(
+    fst::VectorFst<fst::StdArc> *out_fst) {
+  using namespace fst;
+  const std::vector<int32> &phone_syms = trans_model_.GetPhones();
+  // A single-state acceptor with one self-loop arc per phone, uniformly
+  // weighted; the context and HMM expansion below turns this into a cyclic
+  // graph over transition-ids.
+  VectorFst<StdArc> phone_fst;
+  StdArc::StateId state = phone_fst.AddState();
+  phone_fst.SetStart(state);
+  phone_fst.SetFinal(state, StdArc::Weight::One());
+  BaseFloat phone_cost = Log(static_cast<double>(phone_syms.size()));
+  for (size_t i = 0; i < phone_syms.size(); i++)
+    phone_fst.AddArc(state, StdArc(phone_syms[i], phone_syms[i],
+                                   StdArc::Weight(phone_cost), state));
+  return CompileGraphFromPhoneFst(phone_fst, out_fst);
+}
+
+bool TrainingGraphCompiler::CompileGraphFromPhoneFst(
+    const fst::VectorFst<fst::StdArc> &phone_fst,
+    fst::VectorFst<fst::StdArc> *out_fst) {
+  using namespace fst;
+  KALDI_ASSERT(out_fst != NULL);
+
   ContextFst<StdArc> *cfst = NULL;
   {  // make cfst [ it's expanded on the fly ]
     const std::vector<int32> &phone_syms = trans_model_.GetPhones();  // needed to create context fst.
@@ -95,7 +259,7 @@ bool TrainingGraphCompiler::CompileGraph(const fst::VectorFst<fst::StdArc> &word
   }
 
   VectorFst<StdArc> ctx2word_fst;
-  ComposeContextFst(*cfst, phone2word_fst, &ctx2word_fst);
+  ComposeContextFst(*cfst, phone_fst, &ctx2word_fst);
   // ComposeContextFst is like Compose but faster for this particular Fst type.
   // [and doesn't expand too many arcs in the ContextFst.]
 
@@ -149,18 +313,114 @@ bool TrainingGraphCompiler::CompileGraphsFromText(
     const std::vector<std::vector<int32> > &transcripts,
     std::vector<fst::VectorFst<fst::StdArc>*> *out_fsts) {
   using namespace fst;
-  std::vector<const VectorFst<StdArc>* > word_fsts(transcripts.size());
+  KALDI_ASSERT(out_fsts != NULL && out_fsts->empty());
+  out_fsts->resize(transcripts.size(), NULL);
+  // Each transcript is compiled at most once per batch: duplicates (common
+  // in prompted-speech corpora) are copied from the first occurrence, and
+  // if graph caching is enabled, transcripts found in the cache are not
+  // compiled at all.
+  unordered_map<std::vector<int32>, size_t, VectorHasher<int32> > first_index;
+  std::vector<std::pair<size_t, size_t> > duplicates;  // (index, first index)
+  std::vector<size_t> miss_indices;
   for (size_t i = 0; i < transcripts.size(); i++) {
-    VectorFst<StdArc> *word_fst = new VectorFst<StdArc>();
-    MakeLinearAcceptor(transcripts[i], word_fst);
-    word_fsts[i] = word_fst;
-  }    
-  bool ans = CompileGraphs(word_fsts, out_fsts);
-  for (size_t i = 0; i < transcripts.size(); i++)
-    delete word_fsts[i];
+    unordered_map<std::vector<int32>, size_t,
+        VectorHasher<int32> >::const_iterator iter =
+        first_index.find(transcripts[i]);
+    if (iter != first_index.end()) {
+      duplicates.push_back(std::make_pair(i, iter->second));
+      continue;
+    }
+    first_index[transcripts[i]] = i;
+    VectorFst<StdArc> *fst = new VectorFst<StdArc>();
+    (*out_fsts)[i] = fst;
+    if (!(CacheEnabled() && GetCachedGraph(transcripts[i], fst)))
+      miss_indices.push_back(i);
+  }
+
+  bool ans = true;
+  if (!miss_indices.empty()) {
+    std::vector<const VectorFst<StdArc>* > word_fsts(miss_indices.size());
+    for (size_t m = 0; m < miss_indices.size(); m++) {
+      VectorFst<StdArc> *word_fst = new VectorFst<StdArc>();
+      MakeLinearAcceptor(transcripts[miss_indices[m]], word_fst);
+      word_fsts[m] = word_fst;
+    }
+    std::vector<VectorFst<StdArc>* > compiled_fsts;
+    ans = CompileGraphs(word_fsts, &compiled_fsts);
+    for (size_t m = 0; m < miss_indices.size(); m++)
+      delete word_fsts[m];
+    KALDI_ASSERT(compiled_fsts.size() == miss_indices.size());
+    for (size_t m = 0; m < miss_indices.size(); m++) {
+      size_t i = miss_indices[m];
+      delete (*out_fsts)[i];
+      (*out_fsts)[i] = compiled_fsts[m];
+      if (ans && CacheEnabled())
+        CacheGraph(transcripts[i], *(compiled_fsts[m]));
+    }
+  }
+  for (size_t d = 0; d < duplicates.size(); d++)
+    (*out_fsts)[duplicates[d].first] =
+        new VectorFst<StdArc>(*((*out_fsts)[duplicates[d].second]));
   return ans;
 }
 
+void TrainingGraphCompiler::FinishGraphCompilation(
+    const fst::VectorFst<fst::StdArc> &H,
+    const std::vector<int32> &disambig_syms_h,
+    fst::VectorFst<fst::StdArc> *fst) const {
+  using namespace fst;
+  VectorFst<StdArc> &ctx2word_fst = *fst;
+  VectorFst<StdArc> trans2word_fst;
+  TableCompose(H, ctx2word_fst, &trans2word_fst);
+
+  DeterminizeStarInLog(&trans2word_fst);
+
+  if (!disambig_syms_h.empty()) {
+    RemoveSomeInputSymbols(disambig_syms_h, &trans2word_fst);
+    if (opts_.rm_eps)
+      RemoveEpsLocal(&trans2word_fst);
+  }
+
+  // Encoded minimization.
+  MinimizeEncoded(&trans2word_fst);
+
+  std::vector<int32> disambig;
+  AddSelfLoops(trans_model_,
+               disambig,
+               opts_.self_loop_scale,
+               opts_.reorder,
+               &trans2word_fst);
+
+  KALDI_ASSERT(trans2word_fst.Start() != fst::kNoStateId);
+
+  *fst = trans2word_fst;
+}
+
+// Runs the finishing phase of CompileGraphs() over a round-robin share of
+// the batch; all the shared state it touches is read-only (see
+// FinishGraphCompilation), so the threads need no locking.
+class TrainingGraphCompilerFinishClass: public MultiThreadable {
+ public:
+  TrainingGraphCompilerFinishClass(
+      const TrainingGraphCompiler &compiler,
+      const fst::VectorFst<fst::StdArc> &H,
+      const std::vector<int32> &disambig_syms_h,
+      std::vector<fst::VectorFst<fst::StdArc>* > *fsts)
+      : compiler_(compiler), H_(H), disambig_syms_h_(disambig_syms_h),
+        fsts_(fsts) { }
+
+  void operator() () {
+    for (size_t i = thread_id_; i < fsts_->size(); i += num_threads_)
+      compiler_.FinishGraphCompilation(H_, disambig_syms_h_, (*fsts_)[i]);
+  }
+
+ private:
+  const TrainingGraphCompiler &compiler_;
+  const fst::VectorFst<fst::StdArc> &H_;
+  const std::vector<int32> &disambig_syms_h_;
+  std::vector<fst::VectorFst<fst::StdArc>* > *fsts_;
+};
+
 bool TrainingGraphCompiler::CompileGraphs(
     const std::vector<const fst::VectorFst<fst::StdArc>* > &word_fsts,
     std::vector<fst::VectorFst<fst::StdArc>* > *out_fsts) {
@@ -214,32 +474,16 @@ bool TrainingGraphCompiler::CompileGraphs(
                                         h_cfg,
                                         &disambig_syms_h);
 
-  for (size_t i = 0; i < out_fsts->size(); i++) {
-    VectorFst<StdArc> &ctx2word_fst = *((*out_fsts)[i]);
-    VectorFst<StdArc> trans2word_fst;
-    TableCompose(*H, ctx2word_fst, &trans2word_fst);
-
-    DeterminizeStarInLog(&trans2word_fst);
-
-    if (!disambig_syms_h.empty()) {
-      RemoveSomeInputSymbols(disambig_syms_h, &trans2word_fst);
-      if (opts_.rm_eps)
-        RemoveEpsLocal(&trans2word_fst);
+  int32 num_threads = std::min<int32>(g_num_threads, out_fsts->size());
+  if (num_threads > 1) {
+    TrainingGraphCompilerFinishClass c(*this, *H, disambig_syms_h, out_fsts);
+    {
+      // The work happens in the destructor of the MultiThreader.
+      MultiThreader<TrainingGraphCompilerFinishClass> m(num_threads, c);
     }
-    
-    // Encoded minimization.
-    MinimizeEncoded(&trans2word_fst);
-
-    std::vector<int32> disambig;
-    AddSelfLoops(trans_model_,
-                 disambig,
-                 opts_.self_loop_scale,
-                 opts_.reorder,
-                 &trans2word_fst);
-
-    KALDI_ASSERT(trans2word_fst.Start() != kNoStateId);
-
-    *((*out_fsts)[i]) = trans2word_fst;
+  } else {
+    for (size_t i = 0; i < out_fsts->size(); i++)
+      FinishGraphCompilation(*H, disambig_syms_h, (*out_fsts)[i]);
   }
 
   delete H;
@@ -19,8 +19,12 @@
 #ifndef KALDI_DECODER_TRAINING_GRAPH_COMPILER_H_
 #define KALDI_DECODER_TRAINING_GRAPH_COMPILER_H_
 
+#include <list>
+#include <utility>
+
 #include "base/kaldi-common.h"
 #include "hmm/transition-model.h"
+#include "util/stl-utils.h"
 #include "fst/fstlib.h"
 #include "fstext/fstext-lib.h"
 
@@ -33,6 +37,13 @@ struct TrainingGraphCompilerOptions {
   BaseFloat self_loop_scale;
   bool rm_eps;
   bool reorder;  // (Dan-style graphs)
+  int32 graph_cache_size;  // if > 0, the text-based compilation functions
+                           // keep this many compiled graphs in an in-memory
+                           // LRU cache keyed by the transcript.
+  std::string graph_cache_dir;  // if nonempty, compiled graphs are also
+                                // stored in this directory, keyed by a hash
+                                // of the transcript, and re-read on a miss
+                                // in the in-memory cache.
 
   explicit TrainingGraphCompilerOptions(BaseFloat transition_scale = 1.0,
                                         BaseFloat self_loop_scale = 1.0,
@@ -40,7 +51,8 @@ struct TrainingGraphCompilerOptions {
       transition_scale(transition_scale),
       self_loop_scale(self_loop_scale),
       rm_eps(false),
-      reorder(b) { }
+      reorder(b),
+      graph_cache_size(0) { }
 
   void Register(OptionsItf *opts) {
     opts->Register("transition-scale", &transition_scale, "Scale of transition "
@@ -50,6 +62,13 @@ struct TrainingGraphCompilerOptions {
     opts->Register("reorder", &reorder, "Reorder transition ids for greater decoding efficiency.");
     opts->Register("rm-eps", &rm_eps,  "Remove [most] epsilons before minimization (only applicable "
                    "if disambig symbols present)");
+    opts->Register("graph-cache-size", &graph_cache_size, "If >0, number of "
+                   "compiled graphs to keep in an in-memory cache keyed by "
+                   "the transcript (useful if transcripts repeat)");
+    opts->Register("graph-cache-dir", &graph_cache_dir, "If set, directory "
+                   "in which to cache compiled graphs on disk, keyed by a "
+                   "hash of the transcript.  Must not be shared between "
+                   "different models/trees/lexicons.");
   }
 };
 
@@ -60,7 +79,10 @@ class TrainingGraphCompiler {
                         const ContextDependency &ctx_dep,  // And this.
                         fst::VectorFst<fst::StdArc> *lex_fst,  // Takes ownership of this object.
                         // It should not contain disambiguation symbols or subsequential symbol,
-                        // but it should contain optional silence.
+                        // but it should contain optional silence.  May be NULL
+                        // if you will only call the phone-level compilation
+                        // functions (CompileGraphFromPhones and
+                        // CompilePhoneLoopGraph), which do not use a lexicon.
                         const std::vector<int32> &disambig_syms, // disambig symbols in phone symbol table.
                         const TrainingGraphCompilerOptions &opts);
 
@@ -74,23 +96,95 @@ class TrainingGraphCompiler {
                     fst::VectorFst<fst::StdArc> *out_fst);
   
   // CompileGraphs allows you to compile a number of graphs at the same
-  // time.  This consumes more memory but is faster.
+  // time.  This consumes more memory but is faster.  If g_num_threads
+  // (see thread/kaldi-thread.h) is more than one, the expensive
+  // per-utterance finishing work (composition with H, determinization and
+  // minimization) is spread over that many threads.
   bool CompileGraphs(
       const std::vector<const fst::VectorFst<fst::StdArc> *> &word_fsts,
       std::vector<fst::VectorFst<fst::StdArc> *> *out_fsts);
 
   // This version creates an FST from the text and calls CompileGraph.
+  // If graph caching is enabled (see TrainingGraphCompilerOptions), repeated
+  // transcripts are served from the cache instead of being recompiled.
   bool CompileGraphFromText(const std::vector<int32> &transcript,
                             fst::VectorFst<fst::StdArc> *out_fst);
 
   // This function creates FSTs from the text and calls CompileGraphs.
+  // Transcripts that are repeated within the batch are compiled only once;
+  // if graph caching is enabled, transcripts found in the cache are not
+  // compiled at all.
   bool CompileGraphsFromText(
       const std::vector<std::vector<int32> >  &word_grammar,
       std::vector<fst::VectorFst<fst::StdArc> *> *out_fsts);
-  
-  
-  ~TrainingGraphCompiler() { delete lex_fst_; }
+
+  // Compiles a training graph directly from a phone-level transcript,
+  // skipping the lexicon and word level entirely: the output is the linear
+  // phone sequence expanded through the context-dependency tree and the HMM
+  // topology, down to transition-ids (with self-loops, so any segmentation
+  // of the frames is allowed and no pre-existing alignment is needed).  The
+  // output labels of the graph are phones rather than words.  This is the
+  // "numerator" graph of alignment-free sequence training, and is also
+  // useful for alignment at the phone level.
+  bool CompileGraphFromPhones(const std::vector<int32> &phone_transcript,
+                              fst::VectorFst<fst::StdArc> *out_fst);
+
+  // Compiles a cyclic "phone loop" graph that accepts any sequence of
+  // phones, expanded down to transition-ids like CompileGraphFromPhones;
+  // each phone arc gets the uniform cost log(num-phones).  This is the
+  // "denominator" graph of alignment-free sequence training (a stand-in
+  // for a phone language model; compose the phone-level acceptor with a
+  // phone LM first and use CompileGraphFromPhoneFst-style compilation if
+  // you need weighted denominators).
+  bool CompilePhoneLoopGraph(fst::VectorFst<fst::StdArc> *out_fst);
+
+  ~TrainingGraphCompiler();
  private:
+  typedef std::list<std::pair<std::vector<int32>,
+                              fst::VectorFst<fst::StdArc>*> > GraphCacheList;
+
+  // Returns true and copies the cached graph into "out_fst" if "transcript"
+  // is in the in-memory cache or (if configured) the on-disk cache;
+  // otherwise returns false.  Hits are moved to the front of the LRU list.
+  bool GetCachedGraph(const std::vector<int32> &transcript,
+                      fst::VectorFst<fst::StdArc> *out_fst);
+
+  // Inserts a copy of "graph" into the in-memory cache (evicting the least
+  // recently used entry if full), and writes it to the on-disk cache if
+  // configured.  Has no effect on entries that are already cached.
+  void CacheGraph(const std::vector<int32> &transcript,
+                  const fst::VectorFst<fst::StdArc> &graph);
+
+  // Returns the on-disk cache filename for this transcript: a hash of the
+  // transcript, mixed with a coarse fingerprint of the model, tree and
+  // compilation options so a stale cache directory from a different system
+  // is (usually) not picked up.
+  std::string GraphCacheFilename(const std::vector<int32> &transcript) const;
+
+  inline bool CacheEnabled() const {
+    return (opts_.graph_cache_size > 0 || !opts_.graph_cache_dir.empty());
+  }
+
+  // The finishing work on one graph that already has transition-ids on the
+  // input side of H still to be composed in: composes with H, determinizes,
+  // removes disambiguation symbols, minimizes and adds self-loops.  This is
+  // the per-utterance part of compilation that CompileGraphs() may run in
+  // parallel; it only reads shared state, so it is safe to call from
+  // several threads at once.
+  void FinishGraphCompilation(const fst::VectorFst<fst::StdArc> &H,
+                              const std::vector<int32> &disambig_syms_h,
+                              fst::VectorFst<fst::StdArc> *fst) const;
+
+  friend class TrainingGraphCompilerFinishClass;
+  // The shared phone-level part of graph compilation: takes an FST with
+  // phones on its input side (and anything on its output side), composes it
+  // with the context FST and the H transducer, determinizes, minimizes and
+  // adds self-loops.  CompileGraph() calls this after composing the lexicon
+  // with the word grammar; the phone-level entry points above call it
+  // directly.
+  bool CompileGraphFromPhoneFst(const fst::VectorFst<fst::StdArc> &phone_fst,
+                                fst::VectorFst<fst::StdArc> *out_fst);
+
   const TransitionModel &trans_model_;
   const ContextDependency &ctx_dep_;
   fst::VectorFst<fst::StdArc> *lex_fst_; // lexicon FST (an input; we take
@@ -100,6 +194,12 @@ class TrainingGraphCompiler {
   fst::TableComposeCache<fst::Fst<fst::StdArc> > lex_cache_;  // stores matcher..
   // this is one of Dan's extensions.
 
+  GraphCacheList graph_cache_list_;  // most recently used entry at the front;
+  // the cache owns the FST pointers.
+  unordered_map<std::vector<int32>, GraphCacheList::iterator,
+                VectorHasher<int32> > graph_cache_index_;
+  int64 cache_hits_, cache_misses_;
+
   TrainingGraphCompilerOptions opts_;
 };
 
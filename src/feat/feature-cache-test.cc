@@ -0,0 +1,105 @@
+// feat/feature-cache-test.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdlib>
+#include <sys/stat.h>
+
+#include "feat/feature-cache.h"
+
+namespace kaldi {
+
+static void TestOptionsSignature() {
+  bool b = true;
+  int32 i = -7;
+  float f = 0.5;
+  std::string s = "hello";
+  OptionsSignature sig1;
+  sig1.Register("my-bool", &b, "");
+  sig1.Register("my-int", &i, "");
+  sig1.Register("my-float", &f, "");
+  sig1.Register("my-string", &s, "");
+  std::string str1 = sig1.Str();
+  KALDI_ASSERT(str1.find("my-bool=true\n") != std::string::npos);
+  KALDI_ASSERT(str1.find("my-int=-7\n") != std::string::npos);
+  KALDI_ASSERT(str1.find("my-string='hello'\n") != std::string::npos);
+
+  i = -8;  // changing any registered value must change the signature.
+  OptionsSignature sig2;
+  sig2.Register("my-bool", &b, "");
+  sig2.Register("my-int", &i, "");
+  sig2.Register("my-float", &f, "");
+  sig2.Register("my-string", &s, "");
+  KALDI_ASSERT(sig2.Str() != str1);
+}
+
+static void TestFeatureCache() {
+  const char *dir = "tmp_feature_cache_test";
+#ifdef _MSC_VER
+  mkdir(dir);
+#else
+  mkdir(dir, 0777);
+#endif
+  FeatureCacheConfig config;
+  config.cache_dir = dir;
+
+  Vector<BaseFloat> waveform(200 + Rand() % 100);
+  waveform.SetRandn();
+  Matrix<BaseFloat> feats(5 + Rand() % 10, 13);
+  feats.SetRandn();
+
+  {
+    FeatureCache cache(config, "num-ceps=13\n");
+    Matrix<BaseFloat> feats2;
+    KALDI_ASSERT(!cache.Lookup(waveform, 1.0, &feats2));  // not stored yet.
+    cache.Store(waveform, 1.0, feats);
+    KALDI_ASSERT(cache.Lookup(waveform, 1.0, &feats2));
+    AssertEqual(feats, feats2);
+    // A different warp factor is a different key...
+    KALDI_ASSERT(!cache.Lookup(waveform, 1.1, &feats2));
+    // ... as is different audio.
+    Vector<BaseFloat> waveform2(waveform);
+    waveform2(0) += 1.0;
+    KALDI_ASSERT(!cache.Lookup(waveform2, 1.0, &feats2));
+  }
+  {
+    // A different options signature must not see the entry.
+    FeatureCache cache(config, "num-ceps=12\n");
+    Matrix<BaseFloat> feats2;
+    KALDI_ASSERT(!cache.Lookup(waveform, 1.0, &feats2));
+  }
+  {
+    // A second cache object over the same directory sees the entry (this is
+    // the shared-between-jobs use case).
+    FeatureCache cache(config, "num-ceps=13\n");
+    Matrix<BaseFloat> feats2;
+    KALDI_ASSERT(cache.Lookup(waveform, 1.0, &feats2));
+    AssertEqual(feats, feats2);
+  }
+  int ret = system("rm -rf tmp_feature_cache_test");
+  KALDI_ASSERT(ret == 0);
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  TestOptionsSignature();
+  TestFeatureCache();
+  std::cout << "Test OK.\n";
+}
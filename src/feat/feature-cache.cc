@@ -0,0 +1,175 @@
+// feat/feature-cache.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cerrno>
+#include <cstdio>  // for rename().
+#include <fstream>
+#include <sys/stat.h>
+#include <sys/types.h>
+#ifndef _MSC_VER
+#include <unistd.h>  // for getpid().
+#endif
+
+#include "feat/feature-cache.h"
+
+namespace kaldi {
+
+// 64-bit FNV-1a over a byte range, continuing from "hash" (pass the offset
+// basis, or a previous return value to chain ranges together).
+static uint64 HashBytes(const void *data, size_t num_bytes, uint64 hash) {
+  const unsigned char *p = reinterpret_cast<const unsigned char*>(data);
+  for (size_t i = 0; i < num_bytes; i++) {
+    hash ^= static_cast<uint64>(p[i]);
+    hash *= 1099511628211ULL;  // the FNV-1a 64-bit prime.
+  }
+  return hash;
+}
+
+FeatureCache::FeatureCache(const FeatureCacheConfig &config,
+                           const std::string &options_signature):
+    config_(config), options_signature_(options_signature),
+    num_hits_(0), num_misses_(0), num_store_errors_(0) {
+  KALDI_ASSERT(!config_.cache_dir.empty() &&
+               "Do not construct FeatureCache with an empty cache directory.");
+  struct stat statbuf;
+  if (stat(config_.cache_dir.c_str(), &statbuf) != 0 ||
+      !S_ISDIR(statbuf.st_mode))
+    KALDI_ERR << "Feature-cache directory " << config_.cache_dir
+              << " does not exist or is not a directory.";
+}
+
+std::string FeatureCache::PathForKey(const VectorBase<BaseFloat> &waveform,
+                                     BaseFloat vtln_warp,
+                                     bool create_dir) const {
+  // We hash the signature, the warp factor and the raw samples twice with
+  // different starting values, to get 128 bits: a single 64-bit hash would
+  // give a small but not negligible chance of collision over a large
+  // corpus, and a collision here would silently produce wrong features.
+  uint64 hash1 = 14695981039346656037ULL,  // the FNV-1a 64-bit offset basis.
+      hash2 = 9376919041173931297ULL;  // arbitrary odd constant.
+  hash1 = HashBytes(options_signature_.data(), options_signature_.size(),
+                    hash1);
+  hash2 = HashBytes(options_signature_.data(), options_signature_.size(),
+                    hash2);
+  hash1 = HashBytes(&vtln_warp, sizeof(vtln_warp), hash1);
+  hash2 = HashBytes(&vtln_warp, sizeof(vtln_warp), hash2);
+  size_t wave_bytes = static_cast<size_t>(waveform.Dim()) * sizeof(BaseFloat);
+  hash1 = HashBytes(waveform.Data(), wave_bytes, hash1);
+  hash2 = HashBytes(waveform.Data(), wave_bytes, hash2);
+
+  char hex[33];
+  snprintf(hex, sizeof(hex), "%016llx%016llx",
+           static_cast<unsigned long long>(hash1),
+           static_cast<unsigned long long>(hash2));
+  // The first two hex digits name a subdirectory, to keep the number of
+  // files per directory manageable on large corpora.
+  std::string subdir = config_.cache_dir + "/" + std::string(hex, 2);
+  if (create_dir) {
+#ifdef _MSC_VER
+    if (mkdir(subdir.c_str()) != 0 && errno != EEXIST)
+#else
+    if (mkdir(subdir.c_str(), 0777) != 0 && errno != EEXIST)
+#endif
+      KALDI_WARN << "Could not create feature-cache subdirectory " << subdir;
+  }
+  return subdir + "/" + std::string(hex + 2) + ".feats";
+}
+
+bool FeatureCache::Lookup(const VectorBase<BaseFloat> &waveform,
+                          BaseFloat vtln_warp,
+                          Matrix<BaseFloat> *feats) {
+  std::string path = PathForKey(waveform, vtln_warp, false);
+  std::ifstream is(path.c_str(), std::ios_base::in | std::ios_base::binary);
+  if (!is.is_open()) {
+    mutex_.Lock();
+    num_misses_++;
+    mutex_.Unlock();
+    return false;
+  }
+  try {
+    bool binary = true;  // entries are always written in binary mode.
+    ExpectToken(is, binary, "<FeatureCacheEntry>");
+    int32 num_samples;
+    ReadBasicType(is, binary, &num_samples);
+    if (num_samples != waveform.Dim())
+      KALDI_ERR << "Sample count mismatch (" << num_samples << " vs. "
+                << waveform.Dim() << "): hash collision or corrupt entry.";
+    feats->Read(is, binary);
+    ExpectToken(is, binary, "</FeatureCacheEntry>");
+  } catch (const std::exception &e) {
+    // A corrupt or truncated entry (e.g. from a job that was killed before
+    // rename(), on a filesystem where rename is not atomic) is a miss.
+    KALDI_WARN << "Ignoring bad feature-cache entry " << path << ": "
+               << e.what();
+    mutex_.Lock();
+    num_misses_++;
+    mutex_.Unlock();
+    return false;
+  }
+  mutex_.Lock();
+  num_hits_++;
+  mutex_.Unlock();
+  return true;
+}
+
+void FeatureCache::Store(const VectorBase<BaseFloat> &waveform,
+                         BaseFloat vtln_warp,
+                         const Matrix<BaseFloat> &feats) {
+  std::string path = PathForKey(waveform, vtln_warp, true);
+  // Write to a temporary name and rename() into place, so that concurrent
+  // jobs sharing the cache never see a half-written entry.
+  std::ostringstream tmp_path;
+  tmp_path << path << ".tmp." << getpid();
+  {
+    std::ofstream os(tmp_path.str().c_str(),
+                     std::ios_base::out | std::ios_base::binary);
+    bool binary = true;
+    WriteToken(os, binary, "<FeatureCacheEntry>");
+    int32 num_samples = waveform.Dim();
+    WriteBasicType(os, binary, num_samples);
+    feats.Write(os, binary);
+    WriteToken(os, binary, "</FeatureCacheEntry>");
+    if (os.fail()) {
+      KALDI_WARN << "Error writing feature-cache entry to " << tmp_path.str()
+                 << " (disk full?)";
+      os.close();
+      unlink(tmp_path.str().c_str());
+      mutex_.Lock();
+      num_store_errors_++;
+      mutex_.Unlock();
+      return;
+    }
+  }
+  if (rename(tmp_path.str().c_str(), path.c_str()) != 0) {
+    KALDI_WARN << "Could not rename " << tmp_path.str() << " to " << path;
+    unlink(tmp_path.str().c_str());
+    mutex_.Lock();
+    num_store_errors_++;
+    mutex_.Unlock();
+  }
+}
+
+FeatureCache::~FeatureCache() {
+  KALDI_LOG << "Feature cache " << config_.cache_dir << ": " << num_hits_
+            << " hits, " << num_misses_ << " misses"
+            << (num_store_errors_ == 0 ? "" : " (some entries could not be "
+                "stored; see warnings above)") << ".";
+}
+
+}  // namespace kaldi
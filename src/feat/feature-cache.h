@@ -0,0 +1,160 @@
+// feat/feature-cache.h
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_FEAT_FEATURE_CACHE_H_
+#define KALDI_FEAT_FEATURE_CACHE_H_
+
+#include <sstream>
+#include <string>
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "thread/kaldi-mutex.h"
+
+namespace kaldi {
+/// @addtogroup  feat FeatureExtraction
+/// @{
+
+/// This header provides a content-addressed cache for computed features
+/// (class FeatureCache), for the feature-computation binaries
+/// compute-mfcc-feats etc.  The key of a cache entry is a hash of the
+/// waveform samples together with a string encoding all the options that
+/// affect the output (see OptionsSignature below) and the per-utterance
+/// VTLN warp factor; the value is the computed feature matrix, stored as
+/// one small file per entry under a configurable directory.  When the same
+/// audio is re-processed with the same options -- which on a grid happens
+/// every time an experiment re-runs feature extraction -- the features are
+/// read back instead of recomputed.  The cache directory may be shared
+/// between jobs and machines (entries are written to a temporary name and
+/// rename()d into place, which is atomic on the same filesystem); entries
+/// are never deleted by this code, so clean up old caches with e.g.
+/// "find <dir> -atime +30 -delete" as appropriate.  Since the utterance-id
+/// is not part of the key, renaming utterances or re-segmenting a corpus
+/// into identical pieces still hits the cache.
+
+struct FeatureCacheConfig {
+  /// Directory of the cache; empty means caching is disabled.
+  std::string cache_dir;
+
+  FeatureCacheConfig() { }
+
+  void Register(OptionsItf *opts) {
+    opts->Register("feature-cache-dir", &cache_dir, "If set, a directory "
+                   "used as a content-addressed cache of computed features: "
+                   "features are looked up there by a hash of the waveform "
+                   "and the extraction options before being computed, and "
+                   "stored there after.  The directory must exist; it may "
+                   "be shared between jobs and machines.");
+  }
+};
+
+
+/// OptionsSignature is an implementation of OptionsItf that, instead of
+/// making the options parseable, records their names and current values as
+/// a string, for use as (part of) a cache key: register the same option
+/// structs whose values affect the computed output (e.g. MfccOptions),
+/// after command-line parsing, and pass Str() to the FeatureCache
+/// constructor.  Any change to those options then changes the cache key.
+class OptionsSignature : public OptionsItf {
+ public:
+  OptionsSignature() { }
+
+  virtual void Register(const std::string &name, bool *ptr,
+                        const std::string &doc) {
+    os_ << name << '=' << (*ptr ? "true" : "false") << '\n';
+  }
+  virtual void Register(const std::string &name, int32 *ptr,
+                        const std::string &doc) {
+    os_ << name << '=' << *ptr << '\n';
+  }
+  virtual void Register(const std::string &name, uint32 *ptr,
+                        const std::string &doc) {
+    os_ << name << '=' << *ptr << '\n';
+  }
+  virtual void Register(const std::string &name, float *ptr,
+                        const std::string &doc) {
+    os_ << name << '=' << *ptr << '\n';
+  }
+  virtual void Register(const std::string &name, double *ptr,
+                        const std::string &doc) {
+    os_ << name << '=' << *ptr << '\n';
+  }
+  virtual void Register(const std::string &name, std::string *ptr,
+                        const std::string &doc) {
+    os_ << name << "='" << *ptr << "'\n";
+  }
+
+  std::string Str() const { return os_.str(); }
+
+ private:
+  std::ostringstream os_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(OptionsSignature);
+};
+
+
+class FeatureCache {
+ public:
+  /// "options_signature" should encode all the configuration that affects
+  /// the computed features (it is hashed into the cache key, never parsed);
+  /// see OptionsSignature.  The cache directory must already exist.
+  FeatureCache(const FeatureCacheConfig &config,
+               const std::string &options_signature);
+
+  /// Looks up the features for this waveform (and per-utterance warp
+  /// factor; pass 1.0 if not doing VTLN); returns true and outputs to
+  /// "feats" on a hit.  A corrupted or half-written entry is treated as a
+  /// miss.  Safe to call from multiple threads at once.
+  bool Lookup(const VectorBase<BaseFloat> &waveform, BaseFloat vtln_warp,
+              Matrix<BaseFloat> *feats);
+
+  /// Stores the features computed from this waveform.  Failure to write
+  /// (e.g. a full disk) produces a warning, not an error, since the cache
+  /// is only an optimization.  Safe to call from multiple threads at once.
+  void Store(const VectorBase<BaseFloat> &waveform, BaseFloat vtln_warp,
+             const Matrix<BaseFloat> &feats);
+
+  /// Logs the hit/miss statistics.
+  ~FeatureCache();
+
+ private:
+  /// Returns the path of the entry for this key, i.e.
+  /// cache_dir/xx/xxxxxx...xx (the first two hex digits of the hash are a
+  /// subdirectory, to keep directory sizes manageable); if "create_dir" is
+  /// true, creates the subdirectory if needed.
+  std::string PathForKey(const VectorBase<BaseFloat> &waveform,
+                         BaseFloat vtln_warp, bool create_dir) const;
+
+  FeatureCacheConfig config_;
+  std::string options_signature_;
+
+  Mutex mutex_;  // guards the counters below (Lookup and Store may be
+                 // called from multiple worker threads).
+  int32 num_hits_;
+  int32 num_misses_;
+  int32 num_store_errors_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(FeatureCache);
+};
+
+/// @} End of "addtogroup feat"
+
+}  // namespace kaldi
+
+#endif  // KALDI_FEAT_FEATURE_CACHE_H_
@@ -0,0 +1,143 @@
+// feat/feature-compute-task.h
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_FEAT_FEATURE_COMPUTE_TASK_H_
+#define KALDI_FEAT_FEATURE_COMPUTE_TASK_H_
+
+#include <string>
+#include <utility>
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "feat/feature-cache.h"
+#include "thread/kaldi-task-sequence.h"
+
+namespace kaldi {
+/// @addtogroup  feat FeatureExtraction
+/// @{
+
+/// FeatureComputeTask is for use with TaskSequencer (see
+/// thread/kaldi-task-sequence.h), to parallelize the feature-computation
+/// binaries compute-mfcc-feats, compute-fbank-feats and compute-plp-feats:
+/// the main thread keeps reading waveforms and handing tasks to the
+/// sequencer, the operator () (run in worker threads) computes the features,
+/// and the destructor writes them out.  Because TaskSequencer calls the
+/// destructors sequentially in the order the tasks were given to Run(), the
+/// Table output order matches the input, the same as the single-threaded
+/// loop would produce.
+///
+/// C is the feature computer class, e.g. Mfcc, Fbank or Plp; we use the
+/// const version of its Compute() function, which is safe to call from
+/// multiple threads at once.  Exactly one of "kaldi_writer" and
+/// "htk_writer" should be non-NULL; "htk_sample_kind" is the HTK
+/// sample-kind code to put in the header in the htk case (e.g. 006 for
+/// MFCC), and is ignored in the kaldi case.  "num_success" is incremented
+/// in the destructor if the computation succeeded (this is safe because
+/// the destructors run sequentially).  If "cache" is non-NULL we look the
+/// features up there before computing them and store them there afterward
+/// (see feat/feature-cache.h); note, cached features already had any mean
+/// subtraction applied, which is correct because --subtract-mean is part
+/// of the cache key.
+template<class C>
+class FeatureComputeTask {
+ public:
+  FeatureComputeTask(const C &computer,
+                     const std::string &utt,
+                     const VectorBase<BaseFloat> &waveform,
+                     BaseFloat vtln_warp,
+                     bool subtract_mean,
+                     uint16 htk_sample_kind,
+                     BaseFloatMatrixWriter *kaldi_writer,
+                     TableWriter<HtkMatrixHolder> *htk_writer,
+                     int32 *num_success,
+                     FeatureCache *cache = NULL):
+      computer_(computer), utt_(utt), waveform_(waveform),
+      vtln_warp_(vtln_warp), subtract_mean_(subtract_mean),
+      htk_sample_kind_(htk_sample_kind), kaldi_writer_(kaldi_writer),
+      htk_writer_(htk_writer), num_success_(num_success), cache_(cache),
+      success_(false) {
+    KALDI_ASSERT((kaldi_writer != NULL) != (htk_writer != NULL));
+  }
+
+  void operator () () {
+    if (cache_ != NULL && cache_->Lookup(waveform_, vtln_warp_, &features_)) {
+      success_ = true;
+      return;
+    }
+    try {
+      computer_.Compute(waveform_, vtln_warp_, &features_, NULL);
+    } catch (...) {
+      KALDI_WARN << "Failed to compute features for utterance " << utt_;
+      return;
+    }
+    if (subtract_mean_) {
+      Vector<BaseFloat> mean(features_.NumCols());
+      mean.AddRowSumMat(1.0, features_);
+      mean.Scale(1.0 / features_.NumRows());
+      for (int32 i = 0; i < features_.NumRows(); i++)
+        features_.Row(i).AddVec(-1.0, mean);
+    }
+    if (cache_ != NULL)
+      cache_->Store(waveform_, vtln_warp_, features_);
+    success_ = true;
+  }
+
+  ~FeatureComputeTask() {
+    if (!success_) return;
+    if (kaldi_writer_ != NULL) {
+      kaldi_writer_->Write(utt_, features_);
+    } else {
+      std::pair<Matrix<BaseFloat>, HtkHeader> p;
+      p.first.Resize(features_.NumRows(), features_.NumCols());
+      p.first.CopyFromMat(features_);
+      HtkHeader header = {
+        features_.NumRows(),
+        100000,  // 10ms shift
+        static_cast<int16>(sizeof(float) * features_.NumCols()),
+        htk_sample_kind_
+      };
+      p.second = header;
+      htk_writer_->Write(utt_, p);
+    }
+    KALDI_VLOG(2) << "Processed features for key " << utt_;
+    (*num_success_)++;
+  }
+
+ private:
+  const C &computer_;
+  std::string utt_;
+  Vector<BaseFloat> waveform_;
+  BaseFloat vtln_warp_;
+  bool subtract_mean_;
+  uint16 htk_sample_kind_;
+  BaseFloatMatrixWriter *kaldi_writer_;  // NULL if writing htk format.
+  TableWriter<HtkMatrixHolder> *htk_writer_;  // NULL if writing kaldi format.
+  int32 *num_success_;
+  FeatureCache *cache_;  // NULL if not caching.
+  bool success_;
+  Matrix<BaseFloat> features_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(FeatureComputeTask);
+};
+
+/// @} End of "addtogroup feat"
+
+}  // namespace kaldi
+
+#endif  // KALDI_FEAT_FEATURE_COMPUTE_TASK_H_
@@ -109,6 +109,28 @@ static void UnitTestSimple() {
 }
 
 
+static void UnitTestBatched() {
+  std::cout << "=== UnitTestBatched() ===\n";
+  // Check that ComputeBatched() gives the same output as Compute().
+  Vector<BaseFloat> v(16000);
+  v.SetRandn();
+  v.Scale(1000.0);
+  for (int32 i = 0; i < 4; i++) {
+    FbankOptions op;
+    op.frame_opts.dither = 0.0;  // so the two computations see the same data.
+    op.use_energy = (i % 2 == 0);
+    op.htk_compat = (i > 1);
+    op.use_log_fbank = (i != 1);
+    Fbank fbank(op);
+    Matrix<BaseFloat> feats, feats_batched;
+    fbank.Compute(v, 1.0, &feats, NULL);
+    fbank.ComputeBatched(v, 1.0, &feats_batched, NULL);
+    KALDI_ASSERT(feats.ApproxEqual(feats_batched, 0.001));
+  }
+  std::cout << "Test passed :)\n\n";
+}
+
+
 static void UnitTestHTKCompare1() {
   std::cout << "=== UnitTestHTKCompare1() ===\n";
 
@@ -446,6 +468,7 @@ static void UnitTestHTKCompare4() {
 static void UnitTestFeat() {
   UnitTestReadWave();
   UnitTestSimple();
+  UnitTestBatched();
   UnitTestHTKCompare1();
   UnitTestHTKCompare2();
   UnitTestHTKCompare3();
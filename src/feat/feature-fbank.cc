@@ -30,7 +30,7 @@ Fbank::Fbank(const FbankOptions &opts)
 
   int32 padded_window_size = opts.frame_opts.PaddedWindowSize();
   if ((padded_window_size & (padded_window_size-1)) == 0)  // Is a power of two...
-    srfft_ = new SplitRadixRealFft<BaseFloat>(padded_window_size);
+    srfft_ = GetSplitRadixRealFft<BaseFloat>(padded_window_size);
 
   // We'll definitely need the filterbanks info for VTLN warping factor 1.0.
   // [note: this call caches it.]  The reason we call this here is to
@@ -39,21 +39,17 @@ Fbank::Fbank(const FbankOptions &opts)
 }
 
 Fbank::~Fbank() {
-  for (std::map<BaseFloat, MelBanks*>::iterator iter = mel_banks_.begin();
-      iter != mel_banks_.end();
-      ++iter) {
-    delete iter->second;
-  }
-  delete srfft_;
+  // The mel banks and srfft_ are process-wide and shared; not owned here.
 }
 
 const MelBanks *Fbank::GetMelBanks(BaseFloat vtln_warp) {
-  MelBanks *this_mel_banks = NULL;
-  std::map<BaseFloat, MelBanks*>::iterator iter = mel_banks_.find(vtln_warp);
+  const MelBanks *this_mel_banks = NULL;
+  std::map<BaseFloat, const MelBanks*>::iterator iter =
+      mel_banks_.find(vtln_warp);
   if (iter == mel_banks_.end()) {
-    this_mel_banks = new MelBanks(opts_.mel_opts,
-                                  opts_.frame_opts,
-                                  vtln_warp);
+    this_mel_banks = kaldi::GetMelBanks(opts_.mel_opts,
+                                        opts_.frame_opts,
+                                        vtln_warp);
     mel_banks_[vtln_warp] = this_mel_banks;
   } else {
     this_mel_banks = iter->second;
@@ -61,21 +57,13 @@ const MelBanks *Fbank::GetMelBanks(BaseFloat vtln_warp) {
   return this_mel_banks;
 }
 
-const MelBanks *Fbank::GetMelBanks(BaseFloat vtln_warp,
-                                   bool *must_delete) const {
-  MelBanks *this_mel_banks = NULL;
-  std::map<BaseFloat, MelBanks*>::const_iterator iter =
+const MelBanks *Fbank::GetMelBanks(BaseFloat vtln_warp) const {
+  std::map<BaseFloat, const MelBanks*>::const_iterator iter =
       mel_banks_.find(vtln_warp);
-  if (iter == mel_banks_.end()) {
-    this_mel_banks = new MelBanks(opts_.mel_opts,
-                                  opts_.frame_opts,
-                                  vtln_warp);
-    *must_delete = true;
-  } else {
-    this_mel_banks = iter->second;
-    *must_delete = false;
-  }
-  return this_mel_banks;
+  if (iter == mel_banks_.end())
+    return kaldi::GetMelBanks(opts_.mel_opts, opts_.frame_opts, vtln_warp);
+  else
+    return iter->second;
 }
 
 void Fbank::Compute(const VectorBase<BaseFloat> &wave,
@@ -90,16 +78,26 @@ void Fbank::Compute(const VectorBase<BaseFloat> &wave,
                     BaseFloat vtln_warp,
                     Matrix<BaseFloat> *output,
                     Vector<BaseFloat> *wave_remainder) const {
-  bool must_delete_mel_banks;
-  const MelBanks *mel_banks = GetMelBanks(vtln_warp,
-                                          &must_delete_mel_banks);
-
+  const MelBanks *mel_banks = GetMelBanks(vtln_warp);
   ComputeInternal(wave, *mel_banks, output, wave_remainder);
+}
 
-  if (must_delete_mel_banks)
-    delete mel_banks;
+
+void Fbank::ComputeBatched(const VectorBase<BaseFloat> &wave,
+                           BaseFloat vtln_warp,
+                           Matrix<BaseFloat> *output,
+                           Vector<BaseFloat> *wave_remainder) {
+  const MelBanks *this_mel_banks = GetMelBanks(vtln_warp);
+  ComputeBatchedInternal(wave, *this_mel_banks, output, wave_remainder);
 }
 
+void Fbank::ComputeBatched(const VectorBase<BaseFloat> &wave,
+                           BaseFloat vtln_warp,
+                           Matrix<BaseFloat> *output,
+                           Vector<BaseFloat> *wave_remainder) const {
+  const MelBanks *mel_banks = GetMelBanks(vtln_warp);
+  ComputeBatchedInternal(wave, *mel_banks, output, wave_remainder);
+}
 
 void Fbank::ComputeInternal(const VectorBase<BaseFloat> &wave,
                             const MelBanks &mel_banks,
@@ -183,4 +181,94 @@ void Fbank::ComputeInternal(const VectorBase<BaseFloat> &wave,
   }
 }
 
+void Fbank::ComputeBatchedInternal(const VectorBase<BaseFloat> &wave,
+                                   const MelBanks &mel_banks,
+                                   Matrix<BaseFloat> *output,
+                                   Vector<BaseFloat> *wave_remainder) const {
+  KALDI_ASSERT(output != NULL);
+
+  // Get dimensions of output features
+  int32 rows_out = NumFrames(wave.Dim(), opts_.frame_opts);
+  int32 num_bins = opts_.mel_opts.num_bins;
+  int32 cols_out = num_bins + opts_.use_energy;
+  if (rows_out == 0) {
+    output->Resize(0, 0);
+    if (wave_remainder != NULL)
+      *wave_remainder = wave;
+    return;
+  }
+  // Prepare the output buffer
+  output->Resize(rows_out, cols_out);
+
+  // Optionally extract the remainder for further processing
+  if (wave_remainder != NULL)
+    ExtractWaveformRemainder(wave, opts_.frame_opts, wave_remainder);
+
+  // Window all the frames into the rows of a single matrix.
+  int32 padded_window_size = opts_.frame_opts.PaddedWindowSize();
+  Matrix<BaseFloat> windows(rows_out, padded_window_size, kUndefined);
+  Vector<BaseFloat> log_energies(rows_out, kUndefined);
+  Vector<BaseFloat> window;  // one windowed frame; ExtractWindow resizes it.
+  std::vector<BaseFloat> temp_buffer;  // used by srfft.
+  for (int32 r = 0; r < rows_out; r++) {
+    BaseFloat log_energy;
+    ExtractWindow(wave, r, opts_.frame_opts, feature_window_function_, &window,
+                  (opts_.use_energy && opts_.raw_energy ? &log_energy : NULL));
+    if (opts_.use_energy && !opts_.raw_energy)
+      log_energy = Log(std::max(VecVec(window, window),
+                                std::numeric_limits<BaseFloat>::min()));
+    if (opts_.use_energy)
+      log_energies(r) = log_energy;
+    windows.Row(r).CopyFromVec(window);
+  }
+
+  // Compute the FFTs over the rows of "windows", in place, and convert them
+  // to power spectra; the power spectrum of frame r then occupies the first
+  // half plus one element of row r.
+  for (int32 r = 0; r < rows_out; r++) {
+    if (srfft_ != NULL)  // Compute FFT using split-radix algorithm.
+      srfft_->Compute(windows.RowData(r), true, &temp_buffer);
+    else {  // An alternative algorithm that works for non-powers-of-two.
+      SubVector<BaseFloat> this_window(windows, r);
+      RealFft(&this_window, true);
+    }
+    SubVector<BaseFloat> this_window(windows, r);
+    ComputePowerSpectrum(&this_window);
+  }
+  SubMatrix<BaseFloat> power_spectra(windows, 0, rows_out,
+                                     0, padded_window_size / 2 + 1);
+
+  // The mel binning of all the frames is a single matrix product, computed
+  // directly into the filterbank columns of the output.
+  SubMatrix<BaseFloat> this_fbank(*output, 0, rows_out,
+                                  (opts_.use_energy ? 1 : 0), num_bins);
+  mel_banks.Compute(power_spectra, &this_fbank);
+  if (opts_.use_log_fbank) {
+    // avoid log of zero (which should be prevented anyway by dithering).
+    this_fbank.ApplyFloor(std::numeric_limits<BaseFloat>::min());
+    this_fbank.ApplyLog();  // take the log.
+  }
+
+  // Copy energy as first value
+  if (opts_.use_energy) {
+    for (int32 r = 0; r < rows_out; r++) {
+      BaseFloat log_energy = log_energies(r);
+      if (opts_.energy_floor > 0.0 && log_energy < log_energy_floor_)
+        log_energy = log_energy_floor_;
+      (*output)(r, 0) = log_energy;
+    }
+  }
+
+  // HTK compat: Shift features, so energy is last value
+  if (opts_.htk_compat && opts_.use_energy) {
+    for (int32 r = 0; r < rows_out; r++) {
+      SubVector<BaseFloat> this_output(output->Row(r));
+      BaseFloat energy = this_output(0);
+      for (int32 i = 0; i < num_bins; i++)
+        this_output(i) = this_output(i+1);
+      this_output(num_bins) = energy;
+    }
+  }
+}
+
 }  // namespace kaldi
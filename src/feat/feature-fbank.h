@@ -98,6 +98,23 @@ class Fbank {
                BaseFloat vtln_warp,
                Matrix<BaseFloat> *output,
                Vector<BaseFloat> *wave_remainder = NULL) const;
+
+  /// Batched version of Compute(), intended for offline (whole-utterance)
+  /// use; the output is the same up to floating-point roundoff.  All frames
+  /// are windowed into a single matrix, the FFTs are computed over its rows,
+  /// and the mel binning is applied to all frames at once as a matrix
+  /// multiplication, so most of the work is done inside the BLAS.
+  void ComputeBatched(const VectorBase<BaseFloat> &wave,
+                      BaseFloat vtln_warp,
+                      Matrix<BaseFloat> *output,
+                      Vector<BaseFloat> *wave_remainder = NULL);
+
+  /// Const version of ComputeBatched()
+  void ComputeBatched(const VectorBase<BaseFloat> &wave,
+                      BaseFloat vtln_warp,
+                      Matrix<BaseFloat> *output,
+                      Vector<BaseFloat> *wave_remainder = NULL) const;
+
   typedef FbankOptions Options;
  private:
   void ComputeInternal(const VectorBase<BaseFloat> &wave,
@@ -105,16 +122,23 @@ class Fbank {
                        Matrix<BaseFloat> *output,
                        Vector<BaseFloat> *wave_remainder = NULL) const;
 
+  void ComputeBatchedInternal(const VectorBase<BaseFloat> &wave,
+                              const MelBanks &mel_banks,
+                              Matrix<BaseFloat> *output,
+                              Vector<BaseFloat> *wave_remainder = NULL) const;
+
   const MelBanks *GetMelBanks(BaseFloat vtln_warp);
 
-  const MelBanks *GetMelBanks(BaseFloat vtln_warp,
-                              bool *must_delete) const;
+  const MelBanks *GetMelBanks(BaseFloat vtln_warp) const;
 
   FbankOptions opts_;
   BaseFloat log_energy_floor_;
-  std::map<BaseFloat, MelBanks*> mel_banks_;  // BaseFloat is VTLN coefficient.
+  // BaseFloat is the VTLN coefficient; the pointers are to process-wide
+  // shared objects (see GetMelBanks() in mel-computations.h), not owned here.
+  std::map<BaseFloat, const MelBanks*> mel_banks_;
   FeatureWindowFunction feature_window_function_;
-  SplitRadixRealFft<BaseFloat> *srfft_;
+  const SplitRadixRealFft<BaseFloat> *srfft_;  // shared, process-wide; see
+                                               // GetSplitRadixRealFft().
   KALDI_DISALLOW_COPY_AND_ASSIGN(Fbank);
 };
 
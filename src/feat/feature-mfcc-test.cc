@@ -71,6 +71,44 @@ static void UnitTestReadWave() {
 
 
 
+static void UnitTestWaveStreamReader() {
+  std::cout << "=== UnitTestWaveStreamReader() ===\n";
+  // Check that WaveStreamReader gives the same samples as WaveData,
+  // both via Read() on a stream and via Open() (the mmap path).
+  WaveData wave;
+  {
+    std::ifstream is("test_data/test.wav", std::ios_base::binary);
+    wave.Read(is);
+  }
+  KALDI_ASSERT(wave.Data().NumRows() == 1);
+
+  for (int32 i = 0; i < 2; i++) {
+    WaveStreamReader stream_reader;
+    if (i == 0) {
+      std::ifstream is("test_data/test.wav", std::ios_base::binary);
+      stream_reader.Read(is);
+    } else {
+      stream_reader.Open("test_data/test.wav");
+    }
+    KALDI_ASSERT(stream_reader.NumChannels() == wave.Data().NumRows());
+    KALDI_ASSERT(stream_reader.NumSamples() == wave.Data().NumCols());
+    KALDI_ASSERT(stream_reader.SampFreq() == wave.SampFreq());
+
+    int32 num_samp = stream_reader.NumSamples();
+    Vector<BaseFloat> window;
+    stream_reader.GetWindow(0, 0, num_samp, &window);
+    KALDI_ASSERT(window.ApproxEqual(wave.Data().Row(0), 0.0f));
+
+    // Also check a sub-window.
+    int32 begin = num_samp / 4, length = num_samp / 2;
+    stream_reader.GetWindow(0, begin, length, &window);
+    SubVector<BaseFloat> sub(wave.Data().Row(0), begin, length);
+    KALDI_ASSERT(window.ApproxEqual(sub, 0.0f));
+  }
+  std::cout << "Test passed :)\n\n";
+}
+
+
 /**
  */
 static void UnitTestSimple() {
@@ -108,6 +146,26 @@ static void UnitTestSimple() {
   std::cout << "Test passed :)\n\n";
 }
 
+static void UnitTestBatched() {
+  std::cout << "=== UnitTestBatched() ===\n";
+  // Check that ComputeBatched() gives the same output as Compute().
+  Vector<BaseFloat> v(16000);
+  v.SetRandn();
+  v.Scale(1000.0);
+  for (int32 i = 0; i < 4; i++) {
+    MfccOptions op;
+    op.frame_opts.dither = 0.0;  // so the two computations see the same data.
+    op.use_energy = (i % 2 == 0);
+    op.htk_compat = (i > 1);
+    Mfcc mfcc(op);
+    Matrix<BaseFloat> feats, feats_batched;
+    mfcc.Compute(v, 1.0, &feats, NULL);
+    mfcc.ComputeBatched(v, 1.0, &feats_batched, NULL);
+    KALDI_ASSERT(feats.ApproxEqual(feats_batched, 0.001));
+  }
+  std::cout << "Test passed :)\n\n";
+}
+
 
 static void UnitTestHTKCompare1() {
   std::cout << "=== UnitTestHTKCompare1() ===\n";
@@ -656,7 +714,9 @@ void UnitTestVtln() {
 static void UnitTestFeat() {
   UnitTestVtln();
   UnitTestReadWave();
+  UnitTestWaveStreamReader();
   UnitTestSimple();
+  UnitTestBatched();
   UnitTestHTKCompare1();
   UnitTestHTKCompare2();
   // commenting out this one as it doesn't compare right now I normalized
@@ -35,15 +35,18 @@ Mfcc::Mfcc(const MfccOptions &opts)
   dct_matrix_.Resize(opts.num_ceps, num_bins);
   dct_matrix_.CopyFromMat(dct_rows);  // subset of rows.
   if (opts.cepstral_lifter != 0.0) {
-    lifter_coeffs_.Resize(opts.num_ceps);
-    ComputeLifterCoeffs(opts.cepstral_lifter, &lifter_coeffs_);
+    // Fold the cepstral lifter into the DCT matrix (scaling row i by the
+    // i'th lifter coefficient), so liftering costs nothing per frame.
+    Vector<BaseFloat> lifter_coeffs(opts.num_ceps);
+    ComputeLifterCoeffs(opts.cepstral_lifter, &lifter_coeffs);
+    dct_matrix_.MulRowsVec(lifter_coeffs);
   }
   if (opts.energy_floor > 0.0)
     log_energy_floor_ = Log(opts.energy_floor);
 
   int32 padded_window_size = opts.frame_opts.PaddedWindowSize();
   if ((padded_window_size & (padded_window_size-1)) == 0)  // Is a power of two...
-    srfft_ = new SplitRadixRealFft<BaseFloat>(padded_window_size);
+    srfft_ = GetSplitRadixRealFft<BaseFloat>(padded_window_size);
   
   // We'll definitely need the filterbanks info for VTLN warping factor 1.0.
   // [note: this call caches it.]  The reason we call this here is to
@@ -52,20 +55,17 @@ Mfcc::Mfcc(const MfccOptions &opts)
 }
 
 Mfcc::~Mfcc() {
-  for (std::map<BaseFloat, MelBanks*>::iterator iter = mel_banks_.begin();
-      iter != mel_banks_.end();
-      ++iter)
-    delete iter->second;
-  delete srfft_;
+  // The mel banks and srfft_ are process-wide and shared; not owned here.
 }
 
 const MelBanks *Mfcc::GetMelBanks(BaseFloat vtln_warp) {
-  MelBanks *this_mel_banks = NULL;
-  std::map<BaseFloat, MelBanks*>::iterator iter = mel_banks_.find(vtln_warp);
+  const MelBanks *this_mel_banks = NULL;
+  std::map<BaseFloat, const MelBanks*>::iterator iter =
+      mel_banks_.find(vtln_warp);
   if (iter == mel_banks_.end()) {
-    this_mel_banks = new MelBanks(opts_.mel_opts,
-                                  opts_.frame_opts,
-                                  vtln_warp);
+    this_mel_banks = kaldi::GetMelBanks(opts_.mel_opts,
+                                        opts_.frame_opts,
+                                        vtln_warp);
     mel_banks_[vtln_warp] = this_mel_banks;
   } else {
     this_mel_banks = iter->second;
@@ -74,20 +74,13 @@ const MelBanks *Mfcc::GetMelBanks(BaseFloat vtln_warp) {
 }
 
 
-const MelBanks *Mfcc::GetMelBanks(BaseFloat vtln_warp, bool *must_delete) const {
-  MelBanks *this_mel_banks = NULL;
-  std::map<BaseFloat, MelBanks*>::const_iterator iter =
+const MelBanks *Mfcc::GetMelBanks(BaseFloat vtln_warp) const {
+  std::map<BaseFloat, const MelBanks*>::const_iterator iter =
       mel_banks_.find(vtln_warp);
-  if (iter == mel_banks_.end()) {
-    this_mel_banks = new MelBanks(opts_.mel_opts,
-                                  opts_.frame_opts,
-                                  vtln_warp);
-    *must_delete = true;
-  } else {
-    this_mel_banks = iter->second;
-    *must_delete = false;
-  }
-  return this_mel_banks;
+  if (iter == mel_banks_.end())
+    return kaldi::GetMelBanks(opts_.mel_opts, opts_.frame_opts, vtln_warp);
+  else
+    return iter->second;
 }
 
 
@@ -103,14 +96,24 @@ void Mfcc::Compute(const VectorBase<BaseFloat> &wave,
                    BaseFloat vtln_warp,
                    Matrix<BaseFloat> *output,
                    Vector<BaseFloat> *wave_remainder) const {
-  bool must_delete_mel_banks;
-  const MelBanks *mel_banks = GetMelBanks(vtln_warp,
-                                               &must_delete_mel_banks);
-  
+  const MelBanks *mel_banks = GetMelBanks(vtln_warp);
   ComputeInternal(wave, *mel_banks, output, wave_remainder);
-  
-  if (must_delete_mel_banks)
-    delete mel_banks;
+}
+
+void Mfcc::ComputeBatched(const VectorBase<BaseFloat> &wave,
+                          BaseFloat vtln_warp,
+                          Matrix<BaseFloat> *output,
+                          Vector<BaseFloat> *wave_remainder) {
+  const MelBanks *this_mel_banks = GetMelBanks(vtln_warp);
+  ComputeBatchedInternal(wave, *this_mel_banks, output, wave_remainder);
+}
+
+void Mfcc::ComputeBatched(const VectorBase<BaseFloat> &wave,
+                          BaseFloat vtln_warp,
+                          Matrix<BaseFloat> *output,
+                          Vector<BaseFloat> *wave_remainder) const {
+  const MelBanks *mel_banks = GetMelBanks(vtln_warp);
+  ComputeBatchedInternal(wave, *mel_banks, output, wave_remainder);
 }
 
 void Mfcc::ComputeInternal(const VectorBase<BaseFloat> &wave,
@@ -158,12 +161,10 @@ void Mfcc::ComputeInternal(const VectorBase<BaseFloat> &wave,
 
     SubVector<BaseFloat> this_mfcc(output->Row(r));
 
-    // this_mfcc = dct_matrix_ * mel_energies [which now have log]
+    // this_mfcc = dct_matrix_ * mel_energies [which now have log]; the
+    // cepstral lifter is part of dct_matrix_ (see the constructor).
     this_mfcc.AddMatVec(1.0, dct_matrix_, kNoTrans, mel_energies, 0.0);
 
-    if (opts_.cepstral_lifter != 0.0)
-      this_mfcc.MulElements(lifter_coeffs_);
-
     if (opts_.use_energy) {
       if (opts_.energy_floor > 0.0 && log_energy < log_energy_floor_)
         log_energy = log_energy_floor_;
@@ -183,6 +184,92 @@ void Mfcc::ComputeInternal(const VectorBase<BaseFloat> &wave,
   }
 }
 
+void Mfcc::ComputeBatchedInternal(const VectorBase<BaseFloat> &wave,
+                                  const MelBanks &mel_banks,
+                                  Matrix<BaseFloat> *output,
+                                  Vector<BaseFloat> *wave_remainder) const {
+  KALDI_ASSERT(output != NULL);
+  int32 rows_out = NumFrames(wave.Dim(), opts_.frame_opts),
+      cols_out = opts_.num_ceps;
+  if (rows_out == 0) {
+    output->Resize(0, 0);
+    if (wave_remainder != NULL)
+      *wave_remainder = wave;
+    return;
+  }
+  output->Resize(rows_out, cols_out);
+  if (wave_remainder != NULL)
+    ExtractWaveformRemainder(wave, opts_.frame_opts, wave_remainder);
+
+  // Window all the frames into the rows of a single matrix.
+  int32 padded_window_size = opts_.frame_opts.PaddedWindowSize();
+  Matrix<BaseFloat> windows(rows_out, padded_window_size, kUndefined);
+  Vector<BaseFloat> log_energies(rows_out, kUndefined);
+  Vector<BaseFloat> window;  // one windowed frame; ExtractWindow resizes it.
+  std::vector<BaseFloat> temp_buffer;  // used by srfft.
+  for (int32 r = 0; r < rows_out; r++) {
+    BaseFloat log_energy;
+    ExtractWindow(wave, r, opts_.frame_opts, feature_window_function_, &window,
+                  (opts_.use_energy && opts_.raw_energy ? &log_energy : NULL));
+    if (opts_.use_energy && !opts_.raw_energy)
+      log_energy = Log(std::max(VecVec(window, window),
+                                std::numeric_limits<BaseFloat>::min()));
+    if (opts_.use_energy)
+      log_energies(r) = log_energy;
+    windows.Row(r).CopyFromVec(window);
+  }
+
+  // Compute the FFTs over the rows of "windows", in place, and convert them
+  // to power spectra; the power spectrum of frame r then occupies the first
+  // half plus one element of row r.
+  for (int32 r = 0; r < rows_out; r++) {
+    if (srfft_ != NULL)  // Compute FFT using the split-radix algorithm.
+      srfft_->Compute(windows.RowData(r), true, &temp_buffer);
+    else {  // An alternative algorithm that works for non-powers-of-two.
+      SubVector<BaseFloat> this_window(windows, r);
+      RealFft(&this_window, true);
+    }
+    SubVector<BaseFloat> this_window(windows, r);
+    ComputePowerSpectrum(&this_window);
+  }
+  SubMatrix<BaseFloat> power_spectra(windows, 0, rows_out,
+                                     0, padded_window_size / 2 + 1);
+
+  // The mel binning of all the frames is a single matrix product...
+  Matrix<BaseFloat> mel_energies(rows_out, opts_.mel_opts.num_bins,
+                                 kUndefined);
+  mel_banks.Compute(power_spectra, &mel_energies);
+  // avoid log of zero (which should be prevented anyway by dithering).
+  mel_energies.ApplyFloor(std::numeric_limits<BaseFloat>::min());
+  mel_energies.ApplyLog();  // take the log.
+
+  // ... and so is the DCT (with the cepstral lifter folded into
+  // dct_matrix_; see the constructor).
+  output->AddMatMat(1.0, mel_energies, kNoTrans, dct_matrix_, kTrans, 0.0);
+
+  if (opts_.use_energy) {
+    for (int32 r = 0; r < rows_out; r++) {
+      BaseFloat log_energy = log_energies(r);
+      if (opts_.energy_floor > 0.0 && log_energy < log_energy_floor_)
+        log_energy = log_energy_floor_;
+      (*output)(r, 0) = log_energy;
+    }
+  }
+
+  if (opts_.htk_compat) {
+    for (int32 r = 0; r < rows_out; r++) {
+      SubVector<BaseFloat> this_mfcc(output->Row(r));
+      BaseFloat energy = this_mfcc(0);
+      for (int32 i = 0; i < opts_.num_ceps-1; i++)
+        this_mfcc(i) = this_mfcc(i+1);
+      if (!opts_.use_energy)
+        energy *= M_SQRT2;  // scale on C0; see the comment in
+                            // ComputeInternal().
+      this_mfcc(opts_.num_ceps-1) = energy;
+    }
+  }
+}
+
 
 
 
@@ -104,26 +104,54 @@ class Mfcc {
                BaseFloat vtln_warp,
                Matrix<BaseFloat> *output,
                Vector<BaseFloat> *wave_remainder = NULL) const;
-  
+
+  /// Batched version of Compute(), intended for offline (whole-utterance)
+  /// use; the output is the same up to floating-point roundoff.  All frames
+  /// are windowed into a single matrix, the FFTs are computed over its rows,
+  /// and the mel binning and the DCT are each applied to all frames at once
+  /// as a matrix multiplication, so most of the work is done inside the
+  /// BLAS.
+  void ComputeBatched(const VectorBase<BaseFloat> &wave,
+                      BaseFloat vtln_warp,
+                      Matrix<BaseFloat> *output,
+                      Vector<BaseFloat> *wave_remainder = NULL);
+
+  /// Const version of ComputeBatched()
+  void ComputeBatched(const VectorBase<BaseFloat> &wave,
+                      BaseFloat vtln_warp,
+                      Matrix<BaseFloat> *output,
+                      Vector<BaseFloat> *wave_remainder = NULL) const;
+
   typedef MfccOptions Options;
  private:
   void ComputeInternal(const VectorBase<BaseFloat> &wave,
                        const MelBanks &mel_banks,
                        Matrix<BaseFloat> *output,
                        Vector<BaseFloat> *wave_remainder = NULL) const;
-  
+
+  void ComputeBatchedInternal(const VectorBase<BaseFloat> &wave,
+                              const MelBanks &mel_banks,
+                              Matrix<BaseFloat> *output,
+                              Vector<BaseFloat> *wave_remainder = NULL) const;
+
   const MelBanks *GetMelBanks(BaseFloat vtln_warp);
 
-  const MelBanks *GetMelBanks(BaseFloat vtln_warp,
-                              bool *must_delete) const;
-  
+  const MelBanks *GetMelBanks(BaseFloat vtln_warp) const;
+
   MfccOptions opts_;
-  Vector<BaseFloat> lifter_coeffs_;
-  Matrix<BaseFloat> dct_matrix_;  // matrix we left-multiply by to perform DCT.
+  Matrix<BaseFloat> dct_matrix_;  // matrix we left-multiply by to perform DCT;
+                                  // only the num_ceps rows we need, and with
+                                  // the cepstral lifter coefficients folded
+                                  // into the rows, so DCT plus liftering is a
+                                  // single matrix-vector (or, in the batched
+                                  // path, matrix-matrix) product.
   BaseFloat log_energy_floor_;
-  std::map<BaseFloat, MelBanks*> mel_banks_;  // BaseFloat is VTLN coefficient.
+  // BaseFloat is the VTLN coefficient; the pointers are to process-wide
+  // shared objects (see GetMelBanks() in mel-computations.h), not owned here.
+  std::map<BaseFloat, const MelBanks*> mel_banks_;
   FeatureWindowFunction feature_window_function_;
-  SplitRadixRealFft<BaseFloat> *srfft_;
+  const SplitRadixRealFft<BaseFloat> *srfft_;  // shared, process-wide; see
+                                               // GetSplitRadixRealFft().
   KALDI_DISALLOW_COPY_AND_ASSIGN(Mfcc);
 };
 
@@ -38,7 +38,7 @@ Plp::Plp(const PlpOptions &opts)
 
   int32 padded_window_size = opts.frame_opts.PaddedWindowSize();
   if ((padded_window_size & (padded_window_size-1)) == 0)  // Is a power of two...
-    srfft_ = new SplitRadixRealFft<BaseFloat>(padded_window_size);
+    srfft_ = GetSplitRadixRealFft<BaseFloat>(padded_window_size);
 
   // We'll definitely need the filterbanks info for VTLN warping factor 1.0.
   // [note: this call caches it.]  The reason we call this here is to
@@ -47,27 +47,23 @@ Plp::Plp(const PlpOptions &opts)
 }
 
 Plp::~Plp() {
-  for (std::map<BaseFloat, MelBanks*>::iterator iter = mel_banks_.begin();
-      iter != mel_banks_.end();
-      ++iter)
-    delete iter->second;
+  // The mel banks and srfft_ are process-wide and shared; not owned here.
 
   for (std::map<BaseFloat,
                 Vector<BaseFloat>* >::iterator iter = equal_loudness_.begin();
       iter != equal_loudness_.end();
       ++iter)
     delete iter->second;
-
-   delete srfft_;
 }
 
 const MelBanks *Plp::GetMelBanks(BaseFloat vtln_warp) {
-  MelBanks *this_mel_banks = NULL;
-  std::map<BaseFloat, MelBanks*>::iterator iter = mel_banks_.find(vtln_warp);
+  const MelBanks *this_mel_banks = NULL;
+  std::map<BaseFloat, const MelBanks*>::iterator iter =
+      mel_banks_.find(vtln_warp);
   if (iter == mel_banks_.end()) {
-    this_mel_banks = new MelBanks(opts_.mel_opts,
-                                  opts_.frame_opts,
-                                  vtln_warp);
+    this_mel_banks = kaldi::GetMelBanks(opts_.mel_opts,
+                                        opts_.frame_opts,
+                                        vtln_warp);
     mel_banks_[vtln_warp] = this_mel_banks;
   } else {
     this_mel_banks = iter->second;
@@ -75,20 +71,13 @@ const MelBanks *Plp::GetMelBanks(BaseFloat vtln_warp) {
   return this_mel_banks;
 }
 
-const MelBanks *Plp::GetMelBanks(BaseFloat vtln_warp, bool *must_delete) const {
-  MelBanks *this_mel_banks = NULL;
-  std::map<BaseFloat, MelBanks*>::const_iterator iter =
+const MelBanks *Plp::GetMelBanks(BaseFloat vtln_warp) const {
+  std::map<BaseFloat, const MelBanks*>::const_iterator iter =
       mel_banks_.find(vtln_warp);
-  if (iter == mel_banks_.end()) {
-    this_mel_banks = new MelBanks(opts_.mel_opts,
-                                  opts_.frame_opts,
-                                  vtln_warp);
-    *must_delete = true;
-  } else {
-    this_mel_banks = iter->second;
-    *must_delete = false;
-  }
-  return this_mel_banks;
+  if (iter == mel_banks_.end())
+    return kaldi::GetMelBanks(opts_.mel_opts, opts_.frame_opts, vtln_warp);
+  else
+    return iter->second;
 }
 
 const Vector<BaseFloat> *Plp::GetEqualLoudness(BaseFloat vtln_warp) {
@@ -140,9 +129,8 @@ void Plp::Compute(const VectorBase<BaseFloat> &wave,
                    BaseFloat vtln_warp,
                    Matrix<BaseFloat> *output,
                    Vector<BaseFloat> *wave_remainder) const {
-  bool must_delete_mel_banks, must_delete_equal_loudness;
-  const MelBanks *mel_banks = GetMelBanks(vtln_warp,
-                                               &must_delete_mel_banks);
+  bool must_delete_equal_loudness;
+  const MelBanks *mel_banks = GetMelBanks(vtln_warp);
   const Vector<BaseFloat> *equal_loudness
       = GetEqualLoudness(vtln_warp, *mel_banks,
                          &must_delete_equal_loudness);
@@ -150,10 +138,8 @@ void Plp::Compute(const VectorBase<BaseFloat> &wave,
   ComputeInternal(wave, *mel_banks, *equal_loudness,
                   output, wave_remainder);
 
-  if (must_delete_mel_banks)
-    delete mel_banks;
   if (must_delete_equal_loudness)
-    delete equal_loudness;  
+    delete equal_loudness;
 }
 
 
@@ -129,7 +129,7 @@ class Plp {
 
   const MelBanks *GetMelBanks(BaseFloat vtln_warp);
 
-  const MelBanks *GetMelBanks(BaseFloat vtln_warp, bool *must_delete) const;
+  const MelBanks *GetMelBanks(BaseFloat vtln_warp) const;
 
   const Vector<BaseFloat> *GetEqualLoudness(BaseFloat vtln_warp);
 
@@ -141,10 +141,13 @@ class Plp {
   Vector<BaseFloat> lifter_coeffs_;
   Matrix<BaseFloat> idft_bases_;
   BaseFloat log_energy_floor_;
-  std::map<BaseFloat, MelBanks*> mel_banks_;  // BaseFloat is VTLN coefficient.
+  // BaseFloat is the VTLN coefficient; the pointers are to process-wide
+  // shared objects (see GetMelBanks() in mel-computations.h), not owned here.
+  std::map<BaseFloat, const MelBanks*> mel_banks_;
   std::map<BaseFloat, Vector<BaseFloat>* > equal_loudness_;
   FeatureWindowFunction feature_window_function_;
-  SplitRadixRealFft<BaseFloat> *srfft_;
+  const SplitRadixRealFft<BaseFloat> *srfft_;  // shared, process-wide; see
+                                               // GetSplitRadixRealFft().
   KALDI_DISALLOW_COPY_AND_ASSIGN(Plp);
 };
 
@@ -31,11 +31,11 @@ Spectrogram::Spectrogram(const SpectrogramOptions &opts)
 
   int32 padded_window_size = opts.frame_opts.PaddedWindowSize();
   if ((padded_window_size & (padded_window_size-1)) == 0)  // Is a power of two
-    srfft_ = new SplitRadixRealFft<BaseFloat>(padded_window_size);
+    srfft_ = GetSplitRadixRealFft<BaseFloat>(padded_window_size);
 }
 
 Spectrogram::~Spectrogram() {
-  delete srfft_;
+  // srfft_ is process-wide and shared; not owned here.
 }
 
 void Spectrogram::Compute(const VectorBase<BaseFloat> &wave,
@@ -57,6 +57,7 @@ void Spectrogram::Compute(const VectorBase<BaseFloat> &wave,
 
   // Buffers
   Vector<BaseFloat> window;  // windowed waveform.
+  std::vector<BaseFloat> temp_buffer;  // used by srfft.
   BaseFloat log_energy;
 
   // Compute all the freames, r is frame index..
@@ -71,7 +72,7 @@ void Spectrogram::Compute(const VectorBase<BaseFloat> &wave,
                                 std::numeric_limits<BaseFloat>::min()));
     
     if (srfft_ != NULL)  // Compute FFT using split-radix algorithm.
-      srfft_->Compute(window.Data(), true);
+      srfft_->Compute(window.Data(), true, &temp_buffer);
     else  // An alternative algorithm that works for non-powers-of-two
       RealFft(&window, true);
 
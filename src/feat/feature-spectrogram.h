@@ -69,7 +69,8 @@ class Spectrogram {
   SpectrogramOptions opts_;
   BaseFloat log_energy_floor_;
   FeatureWindowFunction feature_window_function_;
-  SplitRadixRealFft<BaseFloat> *srfft_;
+  const SplitRadixRealFft<BaseFloat> *srfft_;  // shared, process-wide; see
+                                               // GetSplitRadixRealFft().
   KALDI_DISALLOW_COPY_AND_ASSIGN(Spectrogram);
 };
 
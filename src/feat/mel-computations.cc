@@ -22,6 +22,11 @@
 #include <float.h>
 #include <algorithm>
 #include <iostream>
+#include <map>
+#include <sstream>
+#ifndef _MSC_VER
+#include <pthread.h>
+#endif
 
 #include "feat/mel-computations.h"
 #include "feat/feature-functions.h"
@@ -133,6 +138,23 @@ MelBanks::MelBanks(const MelBanksOptions &opts,
       bins_[bin].second(0) = 0.0;
     
   }
+
+  // Also store the bins in dense form, for the batched version of Compute().
+  bins_mat_.Resize(num_bins, num_fft_bins + 1);
+  for (int32 bin = 0; bin < num_bins; bin++)
+    bins_mat_.Row(bin).Range(bins_[bin].first, bins_[bin].second.Dim()).
+        CopyFromVec(bins_[bin].second);
+
+  // ... and in packed banded form, for the vector version of Compute().
+  packed_offsets_.resize(num_bins + 1);
+  packed_offsets_[0] = 0;
+  for (int32 bin = 0; bin < num_bins; bin++)
+    packed_offsets_[bin + 1] = packed_offsets_[bin] + bins_[bin].second.Dim();
+  packed_weights_.Resize(packed_offsets_[num_bins], kUndefined);
+  for (int32 bin = 0; bin < num_bins; bin++)
+    packed_weights_.Range(packed_offsets_[bin], bins_[bin].second.Dim()).
+        CopyFromVec(bins_[bin].second);
+
   if (debug_) {
     for (size_t i = 0; i < bins_.size(); i++) {
       KALDI_LOG << "bin " << i << ", offset = " << bins_[i].first
@@ -223,18 +245,29 @@ void MelBanks::Compute(const VectorBase<BaseFloat> &power_spectrum,
   if (mel_energies_out->Dim() != num_bins)
     mel_energies_out->Resize(num_bins);
 
+  KALDI_ASSERT(power_spectrum.Dim() >= bins_mat_.NumCols() - 1);
+
+  // Apply the filterbank in its packed banded form: one pass over the
+  // contiguous weights array, with each band a short dot-product against
+  // the relevant range of the power spectrum.
+  const BaseFloat *power_data = power_spectrum.Data(),
+      *weight_data = packed_weights_.Data();
+  BaseFloat *out_data = mel_energies_out->Data();
   for (int32 i = 0; i < num_bins; i++) {
-    int32 offset = bins_[i].first;
-    const Vector<BaseFloat> &v(bins_[i].second);
-    BaseFloat energy = VecVec(v, power_spectrum.Range(offset, v.Dim()));
+    const BaseFloat *w = weight_data + packed_offsets_[i],
+        *p = power_data + bins_[i].first;
+    int32 band_size = packed_offsets_[i + 1] - packed_offsets_[i];
+    BaseFloat energy = 0.0;
+    for (int32 j = 0; j < band_size; j++)
+      energy += w[j] * p[j];
     // HTK-like flooring- for testing purposes (we prefer dither)
-    if (htk_mode_ && energy < 1.0) energy = 1.0; 
-    (*mel_energies_out)(i) = energy;
-    
+    if (htk_mode_ && energy < 1.0) energy = 1.0;
+    out_data[i] = energy;
+
     // The following assert was added due to a problem with OpenBlas that
     // we had at one point (it was a bug in that library).  Just to detect
     // it early.
-    KALDI_ASSERT(!KALDI_ISNAN((*mel_energies_out)(i)));
+    KALDI_ASSERT(!KALDI_ISNAN(out_data[i]));
   }
 
   if (debug_) {
@@ -245,6 +278,51 @@ void MelBanks::Compute(const VectorBase<BaseFloat> &power_spectrum,
   }
 }
 
+void MelBanks::Compute(const MatrixBase<BaseFloat> &power_spectra,
+                       MatrixBase<BaseFloat> *mel_energies_out) const {
+  KALDI_ASSERT(power_spectra.NumCols() == bins_mat_.NumCols() &&
+               mel_energies_out->NumRows() == power_spectra.NumRows() &&
+               mel_energies_out->NumCols() == bins_mat_.NumRows());
+  mel_energies_out->AddMatMat(1.0, power_spectra, kNoTrans,
+                              bins_mat_, kTrans, 0.0);
+  // HTK-like flooring- for testing purposes (we prefer dither)
+  if (htk_mode_)
+    mel_energies_out->ApplyFloor(1.0);
+  // see the comment in the vector version of Compute() about this check.
+  KALDI_ASSERT(!KALDI_ISNAN(mel_energies_out->Sum()));
+}
+
+const MelBanks *GetMelBanks(const MelBanksOptions &opts,
+                            const FrameExtractionOptions &frame_opts,
+                            BaseFloat vtln_warp_factor) {
+  // The key encodes everything the MelBanks constructor reads from its
+  // arguments.  As with the cache in GetSplitRadixRealFft(), the map and
+  // its contents are never freed: they live for the lifetime of the
+  // process, which is the point.
+  std::ostringstream key;
+  key << opts.num_bins << ' ' << opts.low_freq << ' ' << opts.high_freq
+      << ' ' << opts.vtln_low << ' ' << opts.vtln_high << ' '
+      << opts.debug_mel << ' ' << opts.htk_mode << ' '
+      << frame_opts.samp_freq << ' ' << frame_opts.frame_length_ms << ' '
+      << frame_opts.round_to_power_of_two << ' ' << vtln_warp_factor;
+  static std::map<std::string, MelBanks*> *cache = NULL;
+#ifndef _MSC_VER
+  static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+  pthread_mutex_lock(&mutex);
+#endif
+  if (cache == NULL)
+    cache = new std::map<std::string, MelBanks*>;
+  MelBanks **banks = &((*cache)[key.str()]);
+  if (*banks == NULL)
+    *banks = new MelBanks(opts, frame_opts, vtln_warp_factor);
+  const MelBanks *ans = *banks;
+#ifndef _MSC_VER
+  pthread_mutex_unlock(&mutex);
+#endif
+  return ans;
+}
+
+
 void ComputeLifterCoeffs(BaseFloat Q, VectorBase<BaseFloat> *coeffs) {
   // Compute liftering coefficients (scaling on cepstral coeffs)
   // coeffs are numbered slightly differently from HTK: the zeroth
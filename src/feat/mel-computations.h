@@ -73,9 +73,21 @@ class MelBanks {
 
   /// Compute Mel energies (note: not log enerties).
   /// At input, "fft_energies" contains the FFT energies (not log).
+  /// This applies the filterbank in its packed banded form, in a single
+  /// pass over the weights.
   void Compute(const VectorBase<BaseFloat> &fft_energies,
                Vector<BaseFloat> *mel_energies_out) const;
 
+  /// Batched version of Compute(), for whole-utterance computation: each row
+  /// of "power_spectra" contains the FFT energies of one frame, and the
+  /// corresponding row of "mel_energies_out" (whose dimensions must be
+  /// correct at entry) is filled with that frame's mel energies.  This is a
+  /// single matrix multiplication against a dense copy of the filterbank
+  /// weights, so it is much faster than calling the vector version in a
+  /// loop.
+  void Compute(const MatrixBase<BaseFloat> &power_spectra,
+               MatrixBase<BaseFloat> *mel_energies_out) const;
+
   int32 NumBins() const { return bins_.size(); }
 
   // returns vector of central freq of each bin; needed by plp code.
@@ -90,12 +102,38 @@ class MelBanks {
   // (the first nonzero fft-bin), (the vector of weights).
   std::vector<std::pair<int32, Vector<BaseFloat> > > bins_;
 
+  // dense version of bins_, of dimension num-bins by the power-spectrum
+  // dimension (num-fft-bins + 1); used by the batched version of Compute().
+  Matrix<BaseFloat> bins_mat_;
+
+  // The same weights as in "bins_", packed end-to-end into a single array:
+  // the band of weights for bin i occupies the range
+  // [ packed_offsets_[i], packed_offsets_[i+1] ) of packed_weights_, and is
+  // applied to the power spectrum starting at fft bin bins_[i].first.  This
+  // is the sparse-banded form of the filterbank that the vector version of
+  // Compute() applies; keeping all the weights contiguous avoids chasing a
+  // separate heap allocation per bin in that inner loop.
+  Vector<BaseFloat> packed_weights_;
+  std::vector<int32> packed_offsets_;  // of size num-bins + 1.
+
   bool debug_;
   bool htk_mode_;
   KALDI_DISALLOW_COPY_AND_ASSIGN(MelBanks);
 };
 
 
+/// Returns a process-wide shared MelBanks object for the given options and
+/// VTLN warp factor, creating it if one does not already exist; like the
+/// plans returned by GetSplitRadixRealFft(), the object is owned by a
+/// process-wide cache, must not be deleted by the caller, and lives until
+/// the process exits.  The filterbank for a given configuration is thus
+/// computed only once, however many feature computers come and go (in the
+/// online-decoding code a new feature computer is created per utterance).
+const MelBanks *GetMelBanks(const MelBanksOptions &opts,
+                            const FrameExtractionOptions &frame_opts,
+                            BaseFloat vtln_warp_factor);
+
+
 // Compute liftering coefficients (scaling on cepstral coeffs)
 // coeffs are numbered slightly differently from HTK: the zeroth
 // index is C0, which is not affected.
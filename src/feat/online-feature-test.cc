@@ -105,6 +105,32 @@ void TestOnlineMatrixCacheFeature() {
   AssertEqual(input_feats, output_feats);
 }
 
+void TestOnlineCacheFeatureDiscard() {
+  int32 dim = 2 + rand() % 5;  // dimension of features.
+  int32 num_frames = 100 + rand() % 100;
+
+  Matrix<BaseFloat> input_feats(num_frames, dim);
+  input_feats.SetRandn();
+
+  OnlineMatrixFeature matrix_feats(input_feats);
+  OnlineCacheFeature cache_feats(&matrix_feats);
+
+  Vector<BaseFloat> feat(dim);
+  for (int32 i = 0; i < num_frames; i++)
+    cache_feats.GetFrame(i, &feat);
+  int32 boundary = rand() % num_frames;
+  cache_feats.DiscardCacheBefore(boundary);
+  // frames at or after the boundary must still be correct (and discarded
+  // frames would be recomputed, so they must be too).
+  for (int32 i = 0; i < num_frames; i++) {
+    cache_feats.GetFrame(i, &feat);
+    Vector<BaseFloat> expected(dim);
+    expected.CopyRowFromMat(input_feats, i);
+    AssertEqual(feat, expected);
+  }
+  cache_feats.DiscardCacheBefore(num_frames + 10);  // past the end is OK.
+}
+
 void TestOnlineDeltaFeature() {
   int32 dim = 2 + rand() % 5;  // dimension of features.
   int32 num_frames = 100 + rand() % 100;
@@ -204,6 +230,139 @@ void TestOnlineMfcc() {
   }
 }
 
+void TestOnlineMfccRecycling() {
+  std::ifstream is("../feat/test_data/test.wav", std::ios_base::binary);
+  WaveData wave;
+  wave.Read(is);
+  KALDI_ASSERT(wave.Data().NumRows() == 1);
+  SubVector<BaseFloat> waveform(wave.Data(), 0);
+
+  // the parametrization object
+  MfccOptions op;
+  op.frame_opts.dither = 0.0;  // so the two objects see the same data.
+  op.frame_opts.samp_freq = wave.SampFreq();
+
+  // Check that an OnlineMfcc in the sliding-window recycling mode produces
+  // the same features as one that remembers everything, for the frames that
+  // are guaranteed to still be remembered.
+  int32 num_piece = 5 + rand() % 5;
+  OnlineMfcc online_mfcc(op), online_mfcc_limited(op);
+  int32 window = 5 + rand() % 40;
+  online_mfcc_limited.SetMaxRememberedFrames(window);
+
+  std::vector<int32> piece_length(num_piece, 0);
+  bool ret = RandomSplit(waveform.Dim(), &piece_length, num_piece);
+  KALDI_ASSERT(ret);
+
+  int32 offset_start = 0;
+  for (int32 i = 0; i < num_piece; i++) {
+    Vector<BaseFloat> wave_piece(
+      waveform.Range(offset_start, piece_length[i]));
+    online_mfcc.AcceptWaveform(wave.SampFreq(), wave_piece);
+    online_mfcc_limited.AcceptWaveform(wave.SampFreq(), wave_piece);
+    offset_start += piece_length[i];
+
+    int32 num_ready = online_mfcc_limited.NumFramesReady();
+    KALDI_ASSERT(num_ready == online_mfcc.NumFramesReady());
+    Vector<BaseFloat> feat(online_mfcc.Dim()),
+        feat_limited(online_mfcc.Dim());
+    for (int32 t = std::max<int32>(0, num_ready - window);
+         t < num_ready; t++) {
+      online_mfcc.GetFrame(t, &feat);
+      online_mfcc_limited.GetFrame(t, &feat_limited);
+      KALDI_ASSERT(feat.ApproxEqual(feat_limited, 0.0001f));
+    }
+  }
+}
+
+void TestOnlineCmvnRecycling() {
+  int32 dim = 2 + rand() % 5;  // dimension of features.
+  int32 num_frames = 300 + rand() % 100;
+  Matrix<BaseFloat> input_feats(num_frames, dim);
+  input_feats.SetRandn();
+
+  OnlineCmvnOptions opts;
+  opts.cmn_window = 30 + rand() % 20;
+  opts.speaker_frames = opts.cmn_window;
+  opts.global_frames = opts.cmn_window / 2;
+
+  // global stats, accumulated from the data itself.
+  Matrix<double> global_stats(2, dim + 1);
+  Vector<double> feat_dbl(dim);
+  for (int32 t = 0; t < num_frames; t++) {
+    feat_dbl.CopyFromVec(input_feats.Row(t));
+    global_stats.Row(0).Range(0, dim).AddVec(1.0, feat_dbl);
+    global_stats.Row(1).Range(0, dim).AddVec2(1.0, feat_dbl);
+  }
+  global_stats(0, dim) = num_frames;
+  OnlineCmvnState state(global_stats);
+
+  // Check that an OnlineCmvn in the sliding-window recycling mode produces
+  // the same output as one that caches everything, when the frames are
+  // accessed in increasing order as a decoder would.
+  OnlineMatrixFeature src(input_feats), src_limited(input_feats);
+  OnlineCmvn cmvn(opts, state, &src), cmvn_limited(opts, state, &src_limited);
+  int32 window = opts.cmn_window + 20 + rand() % 50;
+  cmvn_limited.SetMaxRememberedFrames(window);
+
+  Vector<BaseFloat> feat(dim), feat_limited(dim);
+  for (int32 t = 0; t < num_frames; t++) {
+    cmvn.GetFrame(t, &feat);
+    cmvn_limited.GetFrame(t, &feat_limited);
+    KALDI_ASSERT(feat.ApproxEqual(feat_limited, 0.0001f));
+  }
+}
+
+void TestOnlineCmvnGetFrames() {
+  int32 dim = 2 + rand() % 5;  // dimension of features.
+  int32 num_frames = 300 + rand() % 100;
+  Matrix<BaseFloat> input_feats(num_frames, dim);
+  input_feats.SetRandn();
+
+  OnlineCmvnOptions opts;
+  opts.cmn_window = 30 + rand() % 20;
+  opts.speaker_frames = opts.cmn_window;
+  opts.global_frames = opts.cmn_window / 2;
+  opts.normalize_variance = (rand() % 2 == 0);
+
+  // global stats, accumulated from the data itself.
+  Matrix<double> global_stats(2, dim + 1);
+  Vector<double> feat_dbl(dim);
+  for (int32 t = 0; t < num_frames; t++) {
+    feat_dbl.CopyFromVec(input_feats.Row(t));
+    global_stats.Row(0).Range(0, dim).AddVec(1.0, feat_dbl);
+    global_stats.Row(1).Range(0, dim).AddVec2(1.0, feat_dbl);
+  }
+  global_stats(0, dim) = num_frames;
+  OnlineCmvnState state(global_stats);
+
+  // Check that GetFrames() produces the same output as calling GetFrame()
+  // on each frame in turn, reading the frames in chunks of random size,
+  // with the occasional interleaved GetFrame() call on the chunk-wise
+  // object (the two interfaces share the internal stats cache).
+  OnlineMatrixFeature src(input_feats), src_batch(input_feats);
+  OnlineCmvn cmvn(opts, state, &src), cmvn_batch(opts, state, &src_batch);
+
+  Vector<BaseFloat> feat(dim), feat_batch(dim);
+  int32 t = 0;
+  while (t < num_frames) {
+    int32 chunk = std::min<int32>(num_frames - t, 1 + rand() % 50);
+    Matrix<BaseFloat> chunk_feats(chunk, dim);
+    cmvn_batch.GetFrames(t, t + chunk - 1, &chunk_feats);
+    for (int32 i = 0; i < chunk; i++) {
+      cmvn.GetFrame(t + i, &feat);
+      KALDI_ASSERT(feat.ApproxEqual(chunk_feats.Row(i), 0.0001f));
+    }
+    t += chunk;
+    if (rand() % 2 == 0) {
+      int32 t2 = rand() % t;
+      cmvn.GetFrame(t2, &feat);
+      cmvn_batch.GetFrame(t2, &feat_batch);
+      KALDI_ASSERT(feat.ApproxEqual(feat_batch, 0.0001f));
+    }
+  }
+}
+
 void TestOnlinePlp() {
   std::ifstream is("../feat/test_data/test.wav", std::ios_base::binary);
   WaveData wave;
@@ -390,9 +549,13 @@ int main() {
   using namespace kaldi;
   for (int i = 0; i < 10; i++) {
     TestOnlineMatrixCacheFeature();
+    TestOnlineCacheFeatureDiscard();
     TestOnlineDeltaFeature();
     TestOnlineSpliceFrames();
     TestOnlineMfcc();
+    TestOnlineMfccRecycling();
+    TestOnlineCmvnRecycling();
+    TestOnlineCmvnGetFrames();
     TestOnlinePlp();
     TestOnlineTransform();
     TestOnlineAppendFeature();
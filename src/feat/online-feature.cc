@@ -29,8 +29,12 @@ template<class C>
 void OnlineGenericBaseFeature<C>::GetFrame(int32 frame,
                                            VectorBase<BaseFloat> *feat) {
   KALDI_ASSERT(frame >= 0 && frame < num_frames_);
+  if (frame < features_offset_)
+    KALDI_ERR << "Frame " << frame << " was already discarded (we were told "
+              << "to remember only the most recent " << max_remembered_frames_
+              << " frames; see SetMaxRememberedFrames()).";
   KALDI_ASSERT(feat->Dim() == Dim());
-  feat->CopyFromVec(features_.Row(frame));
+  feat->CopyFromVec(features_.Row(frame - features_offset_));
 };
 
 template<class C>
@@ -42,6 +46,7 @@ template<class C>
 OnlineGenericBaseFeature<C>::OnlineGenericBaseFeature(
     const typename C::Options &opts)
     :mfcc_or_plp_(opts), input_finished_(false), num_frames_(0),
+    max_remembered_frames_(-1), features_offset_(0),
     sampling_frequency_(opts.frame_opts.samp_freq) { }
 
 template<class C>
@@ -82,17 +87,35 @@ void OnlineGenericBaseFeature<C>::AcceptWaveform(BaseFloat sampling_rate,
     return;
   }
   int32 new_num_frames = num_frames_ + feats.NumRows();
+  if (max_remembered_frames_ >= 0) {
+    // Sliding-window recycling mode: discard frames more than
+    // max_remembered_frames_ behind the most recent frame, by shifting the
+    // frames we are keeping to the top of the matrix (we never discard
+    // frames from the chunk we are currently adding, so the memory used
+    // stays O(window + chunk-size) rather than O(duration)).
+    int32 new_offset = std::min(new_num_frames - max_remembered_frames_,
+                                num_frames_);
+    if (new_offset > features_offset_) {
+      int32 shift = new_offset - features_offset_,
+          frames_kept = num_frames_ - new_offset;
+      // this copies top-down, so the overlapping ranges work out correctly.
+      for (int32 i = 0; i < frames_kept; i++)
+        features_.Row(i).CopyFromVec(features_.Row(i + shift));
+      features_offset_ = new_offset;
+    }
+  }
   BaseFloat increase_ratio = 1.5;  // This is a tradeoff between memory and
                                    // compute; it's the factor by which we
                                    // increase the memory used each time.
-  if (new_num_frames > features_.NumRows()) {
-    int32 new_num_rows = std::max<int32>(new_num_frames,
+  if (new_num_frames - features_offset_ > features_.NumRows()) {
+    int32 new_num_rows = std::max<int32>(new_num_frames - features_offset_,
                                          features_.NumRows() * increase_ratio);
     // Increase the size of the features_ matrix and copy over any existing
     // data.
     features_.Resize(new_num_rows, Dim(), kCopyData);
   }
-  features_.Range(num_frames_, feats.NumRows(), 0, Dim()).CopyFromMat(feats);
+  features_.Range(num_frames_ - features_offset_, feats.NumRows(), 0, Dim()).
+      CopyFromMat(feats);
   num_frames_ = new_num_frames;
 }
 
@@ -134,7 +157,8 @@ void OnlineCmvnState::Read(std::istream &is, bool binary) {
 OnlineCmvn::OnlineCmvn(const OnlineCmvnOptions &opts,
                        const OnlineCmvnState &cmvn_state,
                        OnlineFeatureInterface *src):
-    opts_(opts), src_(src) {
+    opts_(opts), max_remembered_frames_(-1), num_cached_modulo_freed_(0),
+    src_(src) {
   SetState(cmvn_state);
   if (!SplitStringToIntegers(opts.skip_dims, ":", false, &skip_dims_))
     KALDI_ERR << "Bad --skip-dims option (should be colon-separated list of "
@@ -142,7 +166,9 @@ OnlineCmvn::OnlineCmvn(const OnlineCmvnOptions &opts,
 }
 
 OnlineCmvn::OnlineCmvn(const OnlineCmvnOptions &opts,
-                       OnlineFeatureInterface *src): opts_(opts), src_(src) {
+                       OnlineFeatureInterface *src):
+    opts_(opts), max_remembered_frames_(-1), num_cached_modulo_freed_(0),
+    src_(src) {
   if (!SplitStringToIntegers(opts.skip_dims, ":", false, &skip_dims_))
     KALDI_ERR << "Bad --skip-dims option (should be colon-separated list of "
               <<  "integers)";
@@ -180,7 +206,11 @@ void OnlineCmvn::GetMostRecentCachedFrame(int32 frame,
     }
   }
   *cached_frame = n * opts_.modulus;
-  KALDI_ASSERT(cached_stats_modulo_[n] != NULL);
+  if (cached_stats_modulo_[n] == NULL)
+    KALDI_ERR << "CMVN stats for frame " << frame << " were already freed "
+              << "(we were told to remember only the most recent "
+              << max_remembered_frames_ << " frames; see "
+              << "SetMaxRememberedFrames()).";
   *stats = *(cached_stats_modulo_[n]);
 }
 
@@ -203,7 +233,26 @@ void OnlineCmvn::CacheFrame(int32 frame, const Matrix<double> &stats) {
       // which it has to because you need a previous frame to compute the
       // current one.
       KALDI_ASSERT(n == cached_stats_modulo_.size());
-      cached_stats_modulo_.push_back(new Matrix<double>(stats));
+      if (!recycled_stats_.empty()) {  // re-use a matrix freed by Reset().
+        Matrix<double> *mat = recycled_stats_.back();
+        recycled_stats_.pop_back();
+        mat->Resize(stats.NumRows(), stats.NumCols(), kUndefined);
+        mat->CopyFromMat(stats);
+        cached_stats_modulo_.push_back(mat);
+      } else {
+        cached_stats_modulo_.push_back(new Matrix<double>(stats));
+      }
+      if (max_remembered_frames_ >= 0) {
+        // Free cached stats that have fallen more than max_remembered_frames_
+        // behind this frame; we keep the (now NULL) entries of the vector so
+        // that the frame indexing stays valid.
+        int32 oldest_needed = (frame - max_remembered_frames_) / opts_.modulus;
+        for (; num_cached_modulo_freed_ < oldest_needed;
+             num_cached_modulo_freed_++) {
+          delete cached_stats_modulo_[num_cached_modulo_freed_];
+          cached_stats_modulo_[num_cached_modulo_freed_] = NULL;
+        }
+      }
     } else {
       KALDI_WARN << "Did not expect to reach this part of code.";
       // do what seems right, but we shouldn't get here.
@@ -223,6 +272,27 @@ OnlineCmvn::~OnlineCmvn() {
   for (size_t i = 0; i < cached_stats_modulo_.size(); i++)
     delete cached_stats_modulo_[i];
   cached_stats_modulo_.clear();
+  for (size_t i = 0; i < recycled_stats_.size(); i++)
+    delete recycled_stats_[i];
+  recycled_stats_.clear();
+}
+
+void OnlineCmvn::Reset(const OnlineCmvnState &cmvn_state) {
+  // Move the cached stats of this utterance to recycled_stats_, from where
+  // CacheFrame() will re-use them, rather than freeing them; NULL entries
+  // arise if SetMaxRememberedFrames() was in effect.
+  for (size_t i = 0; i < cached_stats_modulo_.size(); i++)
+    if (cached_stats_modulo_[i] != NULL)
+      recycled_stats_.push_back(cached_stats_modulo_[i]);
+  cached_stats_modulo_.clear();
+  num_cached_modulo_freed_ = 0;
+  // Invalidate the ring-buffer entries (their matrices stay allocated); a
+  // stale frame index from the previous utterance must not be mistaken for
+  // a cached frame of this one.
+  for (size_t i = 0; i < cached_stats_ring_.size(); i++)
+    cached_stats_ring_[i].first = -1;
+  orig_state_ = cmvn_state;
+  frozen_state_ = cmvn_state.frozen_state;
 }
 
 void OnlineCmvn::ComputeStatsForFrame(int32 frame,
@@ -330,6 +400,118 @@ void OnlineCmvn::GetFrame(int32 frame,
   feat->CopyFromVec(feat_mat.Row(0));
 }
 
+void OnlineCmvn::GetFrames(int32 first_frame, int32 last_frame,
+                           MatrixBase<BaseFloat> *feats) {
+  KALDI_ASSERT(first_frame >= 0 && last_frame >= first_frame &&
+               last_frame < src_->NumFramesReady());
+  int32 dim = this->Dim();
+  KALDI_ASSERT(feats->NumRows() == last_frame - first_frame + 1 &&
+               feats->NumCols() == dim);
+
+  // Fetch each source frame in the range just once, directly into the
+  // rows of the output.
+  for (int32 t = first_frame; t <= last_frame; t++) {
+    SubVector<BaseFloat> row(*feats, t - first_frame);
+    src_->GetFrame(t, &row);
+  }
+  if (!opts_.normalize_mean) {
+    // and the same assert as in GetFrame(): we can't only normalize the
+    // variance.
+    KALDI_ASSERT(!opts_.normalize_variance);
+    return;
+  }
+
+  // We first work out the per-frame normalizations, and only at the end
+  // apply them to the rows of "feats"; while accumulating the sliding-window
+  // stats we read the incoming and outgoing frames in the requested range
+  // from those rows, so they must stay un-normalized until then.
+  int32 num_frames = last_frame - first_frame + 1;
+  Matrix<BaseFloat> norm_offset(num_frames, dim);
+  Matrix<BaseFloat> norm_scale;  // only used if normalize_variance.
+  if (opts_.normalize_variance)
+    norm_scale.Resize(num_frames, dim);
+
+  Matrix<double> stats(2, dim + 1), smoothed_stats(2, dim + 1);
+  Vector<BaseFloat> feat(dim);
+  Vector<double> feat_dbl(dim);
+  int32 cur_frame = -1;
+  if (frozen_state_.NumRows() == 0) {
+    // Seed the running sums from the most recent cached frame; the loop
+    // below will bring them forward one frame at a time, exactly as
+    // ComputeStatsForFrame() would.
+    GetMostRecentCachedFrame(first_frame, &cur_frame, &stats);
+  }
+  for (int32 frame = first_frame; frame <= last_frame; frame++) {
+    if (frozen_state_.NumRows() != 0) {  // the CMVN state has been frozen.
+      smoothed_stats.CopyFromMat(frozen_state_);
+    } else {
+      while (cur_frame < frame) {
+        cur_frame++;
+        if (cur_frame >= first_frame)
+          feat.CopyFromVec(feats->Row(cur_frame - first_frame));
+        else
+          src_->GetFrame(cur_frame, &feat);
+        feat_dbl.CopyFromVec(feat);
+        stats.Row(0).Range(0, dim).AddVec(1.0, feat_dbl);
+        stats.Row(1).Range(0, dim).AddVec2(1.0, feat_dbl);
+        stats(0, dim) += 1.0;
+        // it's a sliding buffer; a frame at the back may be
+        // leaving the buffer so we have to subtract that.
+        int32 prev_frame = cur_frame - opts_.cmn_window;
+        if (prev_frame >= 0) {
+          if (prev_frame >= first_frame)
+            feat.CopyFromVec(feats->Row(prev_frame - first_frame));
+          else
+            src_->GetFrame(prev_frame, &feat);
+          feat_dbl.CopyFromVec(feat);
+          stats.Row(0).Range(0, dim).AddVec(-1.0, feat_dbl);
+          stats.Row(1).Range(0, dim).AddVec2(-1.0, feat_dbl);
+          stats(0, dim) -= 1.0;
+        }
+        CacheFrame(cur_frame, stats);
+      }
+      smoothed_stats.CopyFromMat(stats);
+      SmoothOnlineCmvnStats(orig_state_.speaker_cmvn_stats,
+                            orig_state_.global_cmvn_stats,
+                            opts_,
+                            &smoothed_stats);
+    }
+    if (!skip_dims_.empty())
+      FakeStatsForSomeDims(skip_dims_, &smoothed_stats);
+
+    // Work out the normalization for this frame; this is the same
+    // computation as in ApplyCmvn() in ../transform/cmvn.h.
+    double count = smoothed_stats(0, dim);
+    if (count < 1.0)
+      KALDI_ERR << "Insufficient stats for cepstral mean and variance "
+                << "normalization: count = " << count;
+    int32 i = frame - first_frame;
+    for (int32 d = 0; d < dim; d++) {
+      double mean = smoothed_stats(0, d) / count;
+      if (!opts_.normalize_variance) {
+        norm_offset(i, d) = -mean;
+      } else {
+        double var = (smoothed_stats(1, d) / count) - mean * mean,
+            floor = 1.0e-20;
+        if (var < floor) {
+          KALDI_WARN << "Flooring cepstral variance from " << var << " to "
+                     << floor;
+          var = floor;
+        }
+        double scale = 1.0 / sqrt(var);
+        if (scale != scale || 1 / scale == 0.0)
+          KALDI_ERR << "NaN or infinity in cepstral mean/variance computation";
+        norm_offset(i, d) = -(mean * scale);
+        norm_scale(i, d) = scale;
+      }
+    }
+  }
+  // Apply the normalizations.
+  if (opts_.normalize_variance)
+    feats->MulElements(norm_scale);
+  feats->AddMat(1.0, norm_offset);
+}
+
 void OnlineCmvn::Freeze(int32 cur_frame) {
   int32 dim = this->Dim();
   Matrix<double> stats(2, dim + 1);
@@ -352,7 +534,14 @@ void OnlineCmvn::GetState(int32 cur_frame,
       state_out->speaker_cmvn_stats.Resize(2, dim + 1);
     Vector<BaseFloat> feat(dim);
     Vector<double> feat_dbl(dim);
-    for (int32 t = 0; t <= cur_frame; t++) {
+    int32 t_begin = 0;
+    if (max_remembered_frames_ >= 0) {
+      // In the sliding-window recycling mode the source will typically no
+      // longer retain the whole utterance, so we accumulate the speaker
+      // stats over the most recent window of frames only.
+      t_begin = std::max<int32>(0, cur_frame + 1 - max_remembered_frames_);
+    }
+    for (int32 t = t_begin; t <= cur_frame; t++) {
       src_->GetFrame(t, &feat);
       feat_dbl.CopyFromVec(feat);
       state_out->speaker_cmvn_stats(0, dim) += 1.0;
@@ -490,6 +679,15 @@ void OnlineCacheFeature::ClearCache() {
   cache_.resize(0);
 }
 
+void OnlineCacheFeature::DiscardCacheBefore(int32 frame) {
+  if (static_cast<size_t>(frame) > cache_.size())
+    frame = static_cast<int32>(cache_.size());
+  for (int32 i = 0; i < frame; i++) {
+    delete cache_[i];
+    cache_[i] = NULL;
+  }
+}
+
 
 
 void OnlineAppendFeature::GetFrame(int32 frame, VectorBase<BaseFloat> *feat) {
@@ -29,6 +29,7 @@
 
 #include "matrix/matrix-lib.h"
 #include "util/common-utils.h"
+#include "util/memory-stats.h"
 #include "base/kaldi-error.h"
 #include "feat/feature-functions.h"
 #include "feat/feature-mfcc.h"
@@ -76,11 +77,48 @@ class OnlineGenericBaseFeature: public OnlineBaseFeature {
   // of delta or LDA features.
   virtual void InputFinished() { input_finished_= true; }
 
+  // Discards all input and computed features, as if freshly constructed, but
+  // keeps the feature matrix allocated at its high-water-mark size; for
+  // re-using this object across the utterances of a session.
+  virtual void Reset() {
+    num_frames_ = 0;
+    features_offset_ = 0;
+    input_finished_ = false;
+    waveform_remainder_.Resize(0);
+  }
+
+  // Enables sliding-window recycling of the stored features, to keep memory
+  // usage O(window) instead of O(duration) on very long inputs: frames more
+  // than "max_remembered_frames" behind the most recent frame may be
+  // discarded.  You must set this large enough to cover the lookback of
+  // whatever consumes these features -- e.g. the left-context of
+  // OnlineSpliceFrames, the context of OnlineDeltaFeature and the cmn_window
+  // of OnlineCmvn -- plus however far behind the most recent frame the
+  // decoder may request frames.  Calling GetFrame() on a discarded frame is
+  // an error.  The default (-1) keeps all frames, as before.
+  void SetMaxRememberedFrames(int32 max_remembered_frames) {
+    KALDI_ASSERT(max_remembered_frames > 0 || max_remembered_frames == -1);
+    max_remembered_frames_ = max_remembered_frames;
+  }
+
+  // Adds to *stats the memory used for buffered feature frames and leftover
+  // waveform (see util/memory-stats.h for the conventions).  The feature
+  // matrix is resized with headroom and kept across Reset(), so the
+  // allocated size reported in peak_bytes is a high-water mark.
+  void GetMemoryStats(MemoryStats *stats) const {
+    int64 row_bytes = features_.Stride() * sizeof(BaseFloat),
+        waveform_bytes = waveform_remainder_.Dim() * sizeof(BaseFloat);
+    stats->cur_bytes += (num_frames_ - features_offset_) * row_bytes +
+        waveform_bytes;
+    stats->peak_bytes += features_.NumRows() * row_bytes + waveform_bytes;
+  }
 
  private:
   C mfcc_or_plp_;  // class that does the MFCC or PLP computation
 
-  // features_ is the Mfcc or Plp or Fbank features that we have already computed.
+  // features_ is the Mfcc or Plp or Fbank features that we have already
+  // computed, for the frames that we are still remembering; row r of the
+  // matrix contains the features for frame (r + features_offset_).
   Matrix<BaseFloat> features_;
 
   // True if the user has called "InputFinished()"
@@ -92,6 +130,14 @@ class OnlineGenericBaseFeature: public OnlineBaseFeature {
   // so that we don't spend too much time resizing.
   int32 num_frames_;
 
+  // If >= 0, we may discard feature frames more than this far behind the
+  // most recent frame; see SetMaxRememberedFrames().
+  int32 max_remembered_frames_;
+
+  // The frame index corresponding to row zero of features_; nonzero only if
+  // SetMaxRememberedFrames() was called and frames have been discarded.
+  int32 features_offset_;
+
   // The sampling frequency, extracted from the config.  Should
   // be identical to the waveform supplied.
   BaseFloat sampling_frequency_;
@@ -281,6 +327,17 @@ class OnlineCmvn: public OnlineFeatureInterface {
   // Next, functions that are not in the interface.
   //
 
+  /// Outputs the normalized features for the contiguous range of frames
+  /// "first_frame" through "last_frame" (inclusive) to the rows of "feats",
+  /// which must have last_frame - first_frame + 1 rows.  This produces the
+  /// same output as calling GetFrame() on each frame in turn, but is more
+  /// efficient for consumers that process whole chunks: each source frame
+  /// in the range is fetched just once, the sliding-window statistics are
+  /// updated incrementally with O(dim) work per frame, and the per-frame
+  /// temporaries of GetFrame() are allocated once per chunk.
+  void GetFrames(int32 first_frame, int32 last_frame,
+                 MatrixBase<BaseFloat> *feats);
+
   /// Initializer that sets the cmvn state.  If you don't have previous
   /// utterances from the same speaker you are supposed to initialize the CMVN
   /// state from some global CMVN stats, which you can get from summing all cmvn
@@ -324,6 +381,29 @@ class OnlineCmvn: public OnlineFeatureInterface {
   // utterance's CMVN object.
   void Freeze(int32 cur_frame);
 
+  // Enables sliding-window recycling of the internally cached CMVN stats, to
+  // keep memory usage bounded on very long inputs: cached stats more than
+  // "max_remembered_frames" behind the most recent frame we have computed
+  // stats for may be freed.  This should be set at least as large as
+  // opts_.cmn_window plus however far behind the most recent frame the
+  // consumer may request frames, and would normally be coordinated with
+  // SetMaxRememberedFrames() of the source features.  Note: in this mode,
+  // GetState() accumulates speaker stats over only the most recent
+  // "max_remembered_frames" frames (the source will typically no longer
+  // retain the rest of the utterance anyway).  The default (-1) keeps
+  // everything, as before.
+  void SetMaxRememberedFrames(int32 max_remembered_frames) {
+    KALDI_ASSERT(max_remembered_frames > 0 || max_remembered_frames == -1);
+    max_remembered_frames_ = max_remembered_frames;
+  }
+
+  // Discards the state of this utterance and re-initializes with the given
+  // between-utterance state, as if the object had been freshly constructed
+  // with "cmvn_state"; for re-using this object across the utterances of a
+  // session.  The internally cached stats matrices are kept allocated and
+  // recycled for the next utterance.
+  void Reset(const OnlineCmvnState &cmvn_state);
+
   virtual ~OnlineCmvn();
  private:
 
@@ -356,6 +436,12 @@ class OnlineCmvn: public OnlineFeatureInterface {
 
 
   OnlineCmvnOptions opts_;
+  int32 max_remembered_frames_;  // see SetMaxRememberedFrames(); -1 means
+                                 // keep all cached stats.
+  int32 num_cached_modulo_freed_;  // number of leading entries of
+                                   // cached_stats_modulo_ that have been
+                                   // freed and set to NULL; only nonzero if
+                                   // SetMaxRememberedFrames() was called.
   std::vector<int32> skip_dims_; // Skip CMVN for these dimensions.  Derived from opts_.
   OnlineCmvnState orig_state_;   // reflects the state before we saw this
                                  // utterance.
@@ -368,6 +454,10 @@ class OnlineCmvn: public OnlineFeatureInterface {
   // contains the (count, x, x^2) statistics for the frames from
   // std::max(0, n - opts_.cmn_window) through n.
   std::vector<Matrix<double>*> cached_stats_modulo_;
+  // matrices previously used in cached_stats_modulo_ and recycled by Reset(),
+  // ready for re-use by CacheFrame(); this is how we avoid re-allocating the
+  // cache for each utterance when the object is re-used across a session.
+  std::vector<Matrix<double>*> recycled_stats_;
   // the variable below is a ring-buffer of cached stats.  the int32 is the
   // frame index.
   std::vector<std::pair<int32, Matrix<double> > > cached_stats_ring_;
@@ -501,6 +591,13 @@ class OnlineCacheFeature: public OnlineFeatureInterface {
   void ClearCache();  // this should be called if you change the underlying
                       // features in some way.
 
+  // Frees the cached feature vectors of all frames before "frame" (e.g.
+  // frames behind an emitted lattice-chunk boundary in continuous
+  // decoding), so the cache stays bounded on very long inputs.  Unlike
+  // ClearCache() this keeps later frames; a discarded frame would be
+  // recomputed from src_ if it were requested again.
+  void DiscardCacheBefore(int32 frame);
+
   explicit OnlineCacheFeature(OnlineFeatureInterface *src): src_(src) { }
  private:
 
@@ -199,6 +199,68 @@ static void UnitTestDelay() {
   }
 }
 
+// Make sure that limiting the latency with max_frames_latency (which also
+// makes AcceptWaveform() free the Viterbi state info of frames the
+// traceback has converged past) does not change the final output.
+static void UnitTestMaxFramesLatency() {
+  KALDI_LOG << "=== UnitTestMaxFramesLatency() ===\n";
+  for (int32 n = 0; n < 10; n++) {
+    // the parametrization object
+    PitchExtractionOptions op1, op2;
+    op1.nccf_ballast_online = true;  // this is necessary for the computation
+    // to be identical regardless how many pieces we break the signal into.
+    op2 = op1;
+    op2.max_frames_latency = 5 + rand() % 40;
+
+    int32 size = 10000 + rand() % 50000;
+
+    Vector<BaseFloat> v(size);
+    // init with noise plus a sine-wave whose frequency is changing randomly.
+
+    double cur_freq = 200.0, normalized_time = 0.0;
+
+    for (int32 i = 0; i < size; i++) {
+      v(i) = RandGauss() + cos(normalized_time * M_2PI);
+      cur_freq += RandGauss();  // let the frequency wander a little.
+      if (cur_freq < 100.0) cur_freq = 100.0;
+      if (cur_freq > 300.0) cur_freq = 300.0;
+      normalized_time += cur_freq / op1.samp_freq;
+    }
+
+    OnlinePitchFeature pitch_extractor1(op1), pitch_extractor2(op2);
+    int32 start_samp = 0;
+    while (start_samp < v.Dim()) {
+      int32 num_samp = rand() % (v.Dim() + 1 - start_samp);
+      SubVector<BaseFloat> v_part(v, start_samp, num_samp);
+      pitch_extractor1.AcceptWaveform(op1.samp_freq, v_part);
+      pitch_extractor2.AcceptWaveform(op2.samp_freq, v_part);
+      start_samp += num_samp;
+      // Read the frames that are ready so far from the latency-limited
+      // extractor; this exercises GetFrame() on frames before which the
+      // state info has already been freed.
+      int32 num_ready = pitch_extractor2.NumFramesReady();
+      for (int32 frame = num_ready - 1; frame >= 0 && frame >= num_ready - 5;
+           frame--) {
+        Vector<BaseFloat> feat(2);
+        pitch_extractor2.GetFrame(frame, &feat);
+      }
+    }
+    pitch_extractor1.InputFinished();
+    pitch_extractor2.InputFinished();
+
+    int32 num_frames = pitch_extractor1.NumFramesReady();
+    KALDI_ASSERT(num_frames == pitch_extractor2.NumFramesReady());
+    Matrix<BaseFloat> m1(num_frames, 2), m2(num_frames, 2);
+    for (int32 frame = 0; frame < num_frames; frame++) {
+      SubVector<BaseFloat> row1(m1, frame), row2(m2, frame);
+      pitch_extractor1.GetFrame(frame, &row1);
+      pitch_extractor2.GetFrame(frame, &row2);
+    }
+    AssertEqual(m1, m2);
+    KALDI_LOG << "Test passed :)\n";
+  }
+}
+
 extern bool pitch_use_naive_search; // was declared in pitch-functions.cc
 
 // Make sure that doing a calculation on the whole waveform gives
@@ -514,6 +576,7 @@ static void UnitTestFeatNoKeele() {
   UnitTestSimple();
   UnitTestPieces();
   UnitTestDelay();
+  UnitTestMaxFramesLatency();
   UnitTestSearch();
 }
 
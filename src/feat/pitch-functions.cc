@@ -197,12 +197,15 @@ void ComputeLocalCost(const VectorBase<BaseFloat> &nccf_pitch,
 // of the pitch computation.
 class PitchFrameInfo {
  public:
-  /// This function resizes the arrays for this object and updates the reference
-  /// counts for the previous object (by decrementing those reference counts
-  /// when we destroy a StateInfo object).  A StateInfo object is considered to
-  /// be destroyed when we delete it, not when its reference counts goes to
-  /// zero.
-  void Cleanup(PitchFrameInfo *prev_frame);
+  /// This function frees the memory used for the Viterbi state information
+  /// of this frame (the backpointers and cached nccf values).  It is called
+  /// from OnlinePitchFeatureImpl::AcceptWaveform() on frames that the
+  /// traceback has converged past: SetBestState() and ComputeLatency() end
+  /// their backward passes at the convergence point, so the state
+  /// information of earlier frames can never be accessed again.  Note:
+  /// cur_best_state_ is kept, as SetBestState() still inspects it to detect
+  /// where to stop.
+  void Cleanup();
 
   /// This function may be called for the last (most recent) PitchFrameInfo
   /// object with the best state (obtained from the externally held
@@ -543,8 +546,14 @@ int32 PitchFrameInfo::ComputeLatency(int32 max_latency) {
   return latency;
 }
 
-void PitchFrameInfo::Cleanup(PitchFrameInfo *prev_frame) {
-  KALDI_ERR << "Cleanup not implemented.";
+void PitchFrameInfo::Cleanup() {
+  // The swap idiom actually frees the memory, which vector::clear() would
+  // not.  If some code error leads to the state info being accessed after
+  // this, the assertions on state_info_.size() in SetBestState() and
+  // ComputeLatency() will catch it.
+  std::vector<StateInfo> empty;
+  state_info_.swap(empty);
+  state_offset_ = 0;
 }
 
 
@@ -677,6 +686,13 @@ class OnlinePitchFeatureImpl {
   // limit.
   int32 frames_latency_;
 
+  // The number of initial frames whose Viterbi state info we have freed
+  // with PitchFrameInfo::Cleanup(), because the traceback had converged
+  // past them; relevant only when opts_.max_frames_latency > 0.  The
+  // lag_nccf_ entries of these frames are final, so GetFrame() still works
+  // for them.
+  int32 frames_cleaned_up_;
+
   // The forward-cost at the current frame (the last frame in frame_info_);
   // this has the same dimension as lags_.  We normalize each time so
   // the lowest cost is zero, for numerical accuracy and so we can use float.
@@ -726,6 +742,7 @@ OnlinePitchFeatureImpl::OnlinePitchFeatureImpl(
   nccf_last_lag_ = floor(opts.resample_freq * outer_max_lag);
 
   frames_latency_ = 0;  // will be set in AcceptWaveform()
+  frames_cleaned_up_ = 0;
 
   // Choose the lags at which we resample the NCCF.
   SelectLags(opts, &lags_);
@@ -1154,6 +1171,28 @@ void OnlinePitchFeatureImpl::AcceptWaveform(
   frames_latency_ =
       frame_info_.back()->ComputeLatency(opts_.max_frames_latency);
   KALDI_VLOG(4) << "Latency is " << frames_latency_;
+
+  // In the online case, once the traceback has converged to a single state
+  // at some frame we can free the Viterbi state info of all earlier frames,
+  // as no backward pass will visit them again; this keeps the memory used
+  // on long utterances bounded (by the convergence window), instead of
+  // growing linearly with the utterance length.  We mustn't free frames
+  // that RecomputeBacktraces() could still need to revisit: it's never
+  // called if nccf_ballast_online is set, and otherwise nccf_info_ being
+  // empty tells us it has already run (or found nothing to do).
+  if (opts_.max_frames_latency > 0 &&
+      frames_latency_ < opts_.max_frames_latency &&
+      (opts_.nccf_ballast_online || nccf_info_.empty())) {
+    // frames_latency_ < max_frames_latency means the traceback actually
+    // converged, to a single state at frame index
+    // frame_info_.size() - 3 - frames_latency_ (see ComputeLatency()); we
+    // keep that frame, as its cur_best_state_ is what terminates later
+    // backward passes, and free everything before it.
+    int32 settled_frame =
+        static_cast<int32>(frame_info_.size()) - 3 - frames_latency_;
+    for (; frames_cleaned_up_ < settled_frame; frames_cleaned_up_++)
+      frame_info_[frames_cleaned_up_ + 1]->Cleanup();
+  }
 }
 
 
@@ -1165,7 +1204,14 @@ int32 OnlinePitchFeature::NumFramesReady() const {
 }
 
 OnlinePitchFeature::OnlinePitchFeature(const PitchExtractionOptions &opts)
-    :impl_(new OnlinePitchFeatureImpl(opts)) { }
+    :opts_(opts), impl_(new OnlinePitchFeatureImpl(opts)) { }
+
+void OnlinePitchFeature::Reset() {
+  // The implementation object has no way (yet) to restart on a new waveform,
+  // so we just re-create it.
+  delete impl_;
+  impl_ = new OnlinePitchFeatureImpl(opts_);
+}
 
 bool OnlinePitchFeature::IsLastFrame(int32 frame) const {
   return impl_->IsLastFrame(frame);
@@ -313,9 +313,16 @@ class OnlinePitchFeature: public OnlineBaseFeature {
 
   virtual void InputFinished();
 
+  /// Starts a new waveform, as if freshly constructed.  Note: unlike most of
+  /// the online feature classes, this one does not yet retain its internal
+  /// buffers across Reset() (it re-creates its implementation object), so
+  /// there is still some per-utterance allocation on the pitch path.
+  virtual void Reset();
+
   virtual ~OnlinePitchFeature();
 
  private:
+  PitchExtractionOptions opts_;
   OnlinePitchFeatureImpl *impl_;
 };
 
@@ -341,6 +348,13 @@ class OnlineProcessPitch: public OnlineFeatureInterface {
 
   virtual void GetFrame(int32 frame, VectorBase<BaseFloat> *feat);
 
+  /// Discards the state of this utterance, as if freshly constructed (the
+  /// source, which is not owned here, must be reset separately).
+  void Reset() {
+    delta_feature_noise_.clear();
+    normalization_stats_.clear();
+  }
+
   virtual ~OnlineProcessPitch() {  }
 
   // Does not take ownership of "src".
@@ -107,6 +107,9 @@ void LinearResample::SetIndexesAndWeights() {
 
   double window_width = num_zeros_ / (2.0 * filter_cutoff_);
 
+  min_first_index_ = std::numeric_limits<int32>::max();
+  max_last_index_ = std::numeric_limits<int32>::min();
+
   for (int32 i = 0; i < output_samples_in_unit_; i++) {
     double output_t = i / static_cast<double>(samp_rate_out_);
     double min_t = output_t - window_width, max_t = output_t + window_width;
@@ -121,6 +124,8 @@ void LinearResample::SetIndexesAndWeights() {
         max_input_index = floor(max_t * samp_rate_in_),
         num_indices = max_input_index - min_input_index + 1;
     first_index_[i] = min_input_index;
+    min_first_index_ = std::min(min_first_index_, min_input_index);
+    max_last_index_ = std::max(max_last_index_, min_input_index + num_indices);
     weights_[i].Resize(num_indices);
     for (int32 j = 0; j < num_indices; j++) {
       int32 input_index = min_input_index + j;
@@ -155,50 +160,85 @@ void LinearResample::Resample(const VectorBase<BaseFloat> &input,
   int32 input_dim = input.Dim();
   int64 tot_input_samp = input_sample_offset_ + input_dim,
       tot_output_samp = GetNumOutputSamples(tot_input_samp, flush);
-  
+
   KALDI_ASSERT(tot_output_samp >= output_sample_offset_);
 
   output->Resize(tot_output_samp - output_sample_offset_);
 
+  // We compute most of the output with a block-based (polyphase)
+  // computation: the output samples of a unit that share the same phase
+  // (i.e. the same index modulo output_samples_in_unit_), taken across
+  // consecutive units, read the input at a constant stride of
+  // input_samples_in_unit_, so we can compute all of them with one
+  // matrix-vector product per phase; this lets the BLAS vectorize over both
+  // the filter taps and the output samples.  Output samples whose filter
+  // support is not entirely inside "input" (at the edges of the signal, and
+  // where the filter overlaps the remainder from a previous call) are
+  // computed one at a time by ResampleOneSample().
+
+  int32 opu = output_samples_in_unit_, ipu = input_samples_in_unit_;
+  // unit_begin and unit_end (exclusive) delimit the units that (a) consist
+  // entirely of output samples we have yet to produce, and (b) whose filters
+  // only touch input samples present in "input".  The n'th unit consists of
+  // output samples [ n * opu, (n + 1) * opu ), whose filters touch input
+  // samples [ n * ipu + min_first_index_, n * ipu + max_last_index_ ).
+  int64 unit_begin = (output_sample_offset_ + opu - 1) / opu,
+      unit_end = tot_output_samp / opu;
+  int64 lo = input_sample_offset_ - min_first_index_;
+  if (lo > 0)
+    unit_begin = std::max<int64>(unit_begin, (lo + ipu - 1) / ipu);
+  int64 hi = input_sample_offset_ + input_dim - max_last_index_;
+  unit_end = std::min<int64>(unit_end, hi >= 0 ? hi / ipu + 1 : 0);
+
+  // The block-based path views the input as a matrix whose rows are spaced
+  // ipu samples apart, which requires each filter to fit within one unit of
+  // input (num-taps <= ipu).  This holds in the downsampling setups this
+  // path is aimed at; when it doesn't (e.g. when upsampling, where the
+  // windows of adjacent units overlap), everything goes through the scalar
+  // path.
+  int32 max_num_taps = 0;
+  for (int32 i = 0; i < opu; i++)
+    max_num_taps = std::max<int32>(max_num_taps, weights_[i].Dim());
+
+  int64 block_begin_samp, block_end_samp;
+  if (unit_end > unit_begin && max_num_taps <= ipu) {
+    block_begin_samp = unit_begin * opu;
+    block_end_samp = unit_end * opu;
+    int32 num_units = static_cast<int32>(unit_end - unit_begin);
+    // View the block of the output as a matrix with one row per unit; phase
+    // i of each unit is column i.
+    SubMatrix<BaseFloat> output_block(
+        output->Data() + static_cast<int32>(block_begin_samp -
+                                            output_sample_offset_),
+        num_units, opu, opu);
+    Vector<BaseFloat> this_phase(num_units, kUndefined);
+    // the const_cast is harmless; we only read through the submatrices.
+    BaseFloat *input_data = const_cast<BaseFloat*>(input.Data());
+    for (int32 i = 0; i < opu; i++) {
+      int32 num_taps = weights_[i].Dim();
+      SubMatrix<BaseFloat> input_part(
+          input_data + static_cast<int32>(first_index_[i] + unit_begin * ipu -
+                                          input_sample_offset_),
+          num_units, num_taps, ipu);
+      this_phase.AddMatVec(1.0, input_part, kNoTrans, weights_[i], 0.0);
+      output_block.CopyColFromVec(this_phase, i);
+    }
+  } else {
+    // No complete units could be processed as a block; everything goes
+    // through the scalar path below.
+    block_begin_samp = block_end_samp = tot_output_samp;
+  }
+
   // samp_out is the index into the total output signal, not just the part
   // of it we are producing here.
   for (int64 samp_out = output_sample_offset_;
-       samp_out < tot_output_samp;
-       samp_out++) {
-    int64 first_samp_in;
-    int32 samp_out_wrapped;
-    GetIndexes(samp_out, &first_samp_in, &samp_out_wrapped);
-    const Vector<BaseFloat> &weights = weights_[samp_out_wrapped];
-    // first_input_index is the first index into "input" that we have a weight
-    // for.
-    int32 first_input_index = static_cast<int32>(first_samp_in -
-                                                 input_sample_offset_);
-    BaseFloat this_output;
-    if (first_input_index >= 0 &&
-        first_input_index + weights.Dim() <= input_dim) {
-      SubVector<BaseFloat> input_part(input, first_input_index, weights.Dim());
-      this_output = VecVec(input_part, weights);
-    } else {  // Handle edge cases.
-      this_output = 0.0;
-      for (int32 i = 0; i < weights.Dim(); i++) {
-        BaseFloat weight = weights(i);
-        int32 input_index = first_input_index + i;
-        if (input_index < 0 && input_remainder_.Dim() + input_index >= 0) {
-          this_output += weight *
-              input_remainder_(input_remainder_.Dim() + input_index);
-        } else if (input_index >= 0 && input_index < input_dim) {
-          this_output += weight * input(input_index);
-        } else if (input_index >= input_dim) {
-          // We're past the end of the input and are adding zero; should only
-          // happen if the user specified flush == true, or else we would not
-          // be trying to output this sample.
-          KALDI_ASSERT(flush);
-        }
-      }
-    }
-    int32 output_index = static_cast<int32>(samp_out - output_sample_offset_);
-    (*output)(output_index) = this_output;
-  }
+       samp_out < block_begin_samp; samp_out++)
+    (*output)(static_cast<int32>(samp_out - output_sample_offset_)) =
+        ResampleOneSample(input, flush, samp_out);
+  for (int64 samp_out = block_end_samp;
+       samp_out < tot_output_samp; samp_out++)
+    (*output)(static_cast<int32>(samp_out - output_sample_offset_)) =
+        ResampleOneSample(input, flush, samp_out);
 
   if (flush) {
     Reset();  // Reset the internal state.
@@ -209,6 +249,44 @@ void LinearResample::Resample(const VectorBase<BaseFloat> &input,
   }
 }
 
+BaseFloat LinearResample::ResampleOneSample(const VectorBase<BaseFloat> &input,
+                                            bool flush,
+                                            int64 samp_out) const {
+  int32 input_dim = input.Dim();
+  int64 first_samp_in;
+  int32 samp_out_wrapped;
+  GetIndexes(samp_out, &first_samp_in, &samp_out_wrapped);
+  const Vector<BaseFloat> &weights = weights_[samp_out_wrapped];
+  // first_input_index is the first index into "input" that we have a weight
+  // for.
+  int32 first_input_index = static_cast<int32>(first_samp_in -
+                                               input_sample_offset_);
+  BaseFloat this_output;
+  if (first_input_index >= 0 &&
+      first_input_index + weights.Dim() <= input_dim) {
+    SubVector<BaseFloat> input_part(input, first_input_index, weights.Dim());
+    this_output = VecVec(input_part, weights);
+  } else {  // Handle edge cases.
+    this_output = 0.0;
+    for (int32 i = 0; i < weights.Dim(); i++) {
+      BaseFloat weight = weights(i);
+      int32 input_index = first_input_index + i;
+      if (input_index < 0 && input_remainder_.Dim() + input_index >= 0) {
+        this_output += weight *
+            input_remainder_(input_remainder_.Dim() + input_index);
+      } else if (input_index >= 0 && input_index < input_dim) {
+        this_output += weight * input(input_index);
+      } else if (input_index >= input_dim) {
+        // We're past the end of the input and are adding zero; should only
+        // happen if the user specified flush == true, or else we would not
+        // be trying to output this sample.
+        KALDI_ASSERT(flush);
+      }
+    }
+  }
+  return this_output;
+}
+
 void LinearResample::SetRemainder(const VectorBase<BaseFloat> &input) {
   Vector<BaseFloat> old_remainder(input_remainder_);
   // max_remainder_needed is the width of the filter from side to side,
@@ -142,6 +142,10 @@ class ArbitraryResample {
 
    We require that the input and output sampling rate be specified as
    integers, as this is an easy way to specify that their ratio be rational.
+
+   Note: all the weight setup is done in the constructor, so the object acts
+   as a reusable "plan" for a given pair of rates: construct it once and
+   reuse it for any number of signals, calling Reset() between them.
 */
 
 class LinearResample {
@@ -205,6 +209,16 @@ class LinearResample {
                          int64 *first_samp_in,
                          int32 *samp_out_wrapped) const;
 
+  /// Computes a single output sample; this is the scalar code path, used by
+  /// Resample() for output samples whose filter support is not entirely
+  /// inside "input" (i.e. at the edges of the signal, and where the filter
+  /// overlaps the remainder from a previous call).  samp_out is the index
+  /// into the total output signal, not just the part we are currently
+  /// producing.
+  BaseFloat ResampleOneSample(const VectorBase<BaseFloat> &input,
+                              bool flush,
+                              int64 samp_out) const;
+
   void SetRemainder(const VectorBase<BaseFloat> &input);
 
   void SetIndexesAndWeights();
@@ -236,6 +250,14 @@ class LinearResample {
   /// Weights on the input samples, for this output-sample index.
   std::vector<Vector<BaseFloat> > weights_;
 
+  /// min_first_index_ is the smallest value of first_index_[i], and
+  /// max_last_index_ the largest value of first_index_[i] +
+  /// weights_[i].Dim(), over all i.  They are used by Resample() to work out
+  /// which units of output samples can be computed by the block-based
+  /// (polyphase) code path.
+  int32 min_first_index_;
+  int32 max_last_index_;
+
   // the following variables keep track of where we are in a particular signal,
   // if it is being provided over multiple calls to Resample().
 
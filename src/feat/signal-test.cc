@@ -38,6 +38,28 @@ void UnitTestBlockConvolution() {
   }
 }
 
+void UnitTestBlockConvolver() {
+  for (int32 i = 0; i < 5; i++) {
+    // Alternate between a filter that is long enough for the FFT-based
+    // method and one short enough that Convolve() falls back to the
+    // direct method.
+    int32 filter_length = (i % 2 == 0 ? 1000 + Rand() % 1000 :
+                                        10 + Rand() % 50);
+    Vector<BaseFloat> filter(filter_length);
+    filter.SetRandn();
+    BlockConvolver convolver(filter);
+    for (int32 j = 0; j < 3; j++) {  // reuse the convolver on several signals.
+      int32 signal_length = 40000 + Rand() % 4000;
+      Vector<BaseFloat> signal(signal_length);
+      signal.SetRandn();
+      Vector<BaseFloat> signal_test(signal);
+      FFTbasedConvolveSignals(filter, &signal_test);
+      convolver.Convolve(&signal);
+      AssertEqual(signal, signal_test, 0.0001 * signal.Dim());
+    }
+  }
+}
+
 void UnitTestConvolution() {
   for (int32 i = 0; i < 5; i++) {
     int32 signal_length = 40000 + Rand() % 4000;
@@ -57,6 +79,7 @@ void UnitTestConvolution() {
 int main() {
   using namespace kaldi;
   UnitTestBlockConvolution();
+  UnitTestBlockConvolver();
   UnitTestConvolution();
   KALDI_LOG << "Tests succeeded.";
 
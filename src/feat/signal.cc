@@ -71,44 +71,65 @@ void FFTbasedConvolveSignals(const Vector<BaseFloat> &filter, Vector<BaseFloat>
 }
 
 void FFTbasedBlockConvolveSignals(const Vector<BaseFloat> &filter, Vector<BaseFloat> *signal) {
-  int32 signal_length = signal->Dim();
-  int32 filter_length = filter.Dim();
+  BlockConvolver convolver(filter);
+  convolver.Convolve(signal);
+}
 
+// Below this filter length Convolve() uses the direct time-domain method:
+// there, each output sample costs filter-length multiply-adds, which is
+// cheaper than its share of the forward+inverse block FFTs.
+static const int32 kMinFilterLengthForFftConvolution = 64;
+
+BlockConvolver::BlockConvolver(const Vector<BaseFloat> &filter):
+    filter_(filter), fft_length_(0), block_length_(0), srfft_(NULL) {
+  int32 filter_length = filter.Dim();
+  KALDI_ASSERT(filter_length > 0);
   KALDI_VLOG(1) << "Length of the filter is " << filter_length;
+  if (filter_length < kMinFilterLengthForFftConvolution)
+    return;  // Convolve() will use the direct method.
 
-  int32 fft_length = RoundUpToNearestPowerOfTwo(4 * filter_length);
-  KALDI_VLOG(1) << "Best FFT length is " << fft_length;
+  fft_length_ = RoundUpToNearestPowerOfTwo(4 * filter_length);
+  KALDI_VLOG(1) << "Best FFT length is " << fft_length_;
 
-  int32 block_length = fft_length - filter_length + 1;
-  KALDI_VLOG(1) << "Block size is " << block_length;
-  SplitRadixRealFft<BaseFloat> srfft(fft_length);
+  block_length_ = fft_length_ - filter_length + 1;
+  KALDI_VLOG(1) << "Block size is " << block_length_;
+  srfft_ = new SplitRadixRealFft<BaseFloat>(fft_length_);
 
-  Vector<float> filter_padded(fft_length);
-  filter_padded.Range(0, filter_length).CopyFromVec(filter);
-  srfft.Compute(filter_padded.Data(), true);
+  filter_padded_.Resize(fft_length_);
+  filter_padded_.Range(0, filter_length).CopyFromVec(filter);
+  srfft_->Compute(filter_padded_.Data(), true);
+}
+
+void BlockConvolver::Convolve(Vector<BaseFloat> *signal) const {
+  if (srfft_ == NULL) {  // short filter: the direct method is faster.
+    ConvolveSignals(filter_, signal);
+    return;
+  }
+  int32 signal_length = signal->Dim(),
+      filter_length = filter_.Dim();
 
   Vector<float> temp_pad(filter_length - 1);
-  temp_pad.SetZero();
-  Vector<float> signal_block_padded(fft_length);
+  Vector<float> signal_block_padded(fft_length_);
+  std::vector<BaseFloat> temp_buffer;
 
-  for (int32 po = 0; po < signal_length; po += block_length) {
+  for (int32 po = 0; po < signal_length; po += block_length_) {
     // get a block of the signal
-    int32 process_length = std::min(block_length, signal_length - po);
+    int32 process_length = std::min(block_length_, signal_length - po);
     signal_block_padded.SetZero();
     signal_block_padded.Range(0, process_length).CopyFromVec(signal->Range(po, process_length));
 
-    srfft.Compute(signal_block_padded.Data(), true);
+    srfft_->Compute(signal_block_padded.Data(), true, &temp_buffer);
 
-    ElementwiseProductOfFft(filter_padded, &signal_block_padded);
+    ElementwiseProductOfFft(filter_padded_, &signal_block_padded);
 
-    srfft.Compute(signal_block_padded.Data(), false);
-    signal_block_padded.Scale(1.0 / fft_length);
+    srfft_->Compute(signal_block_padded.Data(), false, &temp_buffer);
+    signal_block_padded.Scale(1.0 / fft_length_);
 
     // combine the block
-    if (po + block_length < signal_length) {       // current block is not the last block
-      signal->Range(po, block_length).CopyFromVec(signal_block_padded.Range(0, block_length));
+    if (po + block_length_ < signal_length) {      // current block is not the last block
+      signal->Range(po, block_length_).CopyFromVec(signal_block_padded.Range(0, block_length_));
       signal->Range(po, filter_length - 1).AddVec(1.0, temp_pad);
-      temp_pad.CopyFromVec(signal_block_padded.Range(block_length, filter_length - 1));
+      temp_pad.CopyFromVec(signal_block_padded.Range(block_length_, filter_length - 1));
     } else {
       signal->Range(po, signal_length - po).CopyFromVec(
                         signal_block_padded.Range(0, signal_length - po));
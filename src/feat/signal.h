@@ -22,6 +22,7 @@
 
 #include "base/kaldi-common.h"
 #include "util/common-utils.h"
+#include "matrix/srfft.h"
 
 namespace kaldi {
 
@@ -46,6 +47,38 @@ void FFTbasedConvolveSignals(const Vector<BaseFloat> &filter, Vector<BaseFloat>
 */
 void FFTbasedBlockConvolveSignals(const Vector<BaseFloat> &filter, Vector<BaseFloat> *signal);
 
+/*
+   This class does the same computation as FFTbasedBlockConvolveSignals(), but
+   sets up the FFT and the forward-transformed filter just once in the
+   constructor, so that the same filter can be applied cheaply to many signals
+   (e.g. convolving one room impulse response with a whole corpus, or with
+   each channel of a file).  For short filters, where the direct method is
+   faster than the block FFTs, Convolve() automatically falls back to
+   time-domain convolution.  Convolve() is const and does not share temporary
+   buffers, so one BlockConvolver may be used from multiple threads at once.
+*/
+class BlockConvolver {
+ public:
+  explicit BlockConvolver(const Vector<BaseFloat> &filter);
+
+  ~BlockConvolver() { delete srfft_; }
+
+  /// Replaces "signal" with the convolution of the filter with "signal",
+  /// truncated to the original signal->Dim() (the same output as
+  /// ConvolveSignals() and FFTbasedBlockConvolveSignals() produce).
+  void Convolve(Vector<BaseFloat> *signal) const;
+
+ private:
+  Vector<BaseFloat> filter_;  // the filter as supplied; used by the direct
+                              // method.
+  int32 fft_length_;
+  int32 block_length_;  // fft_length_ - filter_.Dim() + 1.
+  Vector<BaseFloat> filter_padded_;  // forward FFT of the zero-padded filter.
+  SplitRadixRealFft<BaseFloat> *srfft_;  // NULL if the filter is short enough
+                                         // that we use the direct method.
+  KALDI_DISALLOW_COPY_AND_ASSIGN(BlockConvolver);
+};
+
 }  // namespace kaldi
 
 #endif  // KALDI_FEAT_SIGNAL_H_
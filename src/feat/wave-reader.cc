@@ -20,18 +20,25 @@
 // limitations under the License.
 
 #include <cstdio>
+#include <fstream>
 #include <limits>
 #include <sstream>
 #include <vector>
 
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #include "feat/wave-reader.h"
 #include "base/kaldi-error.h"
 #include "base/kaldi-utils.h"
 
 namespace kaldi {
 
-// static
-void WaveData::Expect4ByteTag(std::istream &is, const char *expected) {
+static void Expect4ByteTag(std::istream &is, const char *expected) {
   char tmp[5];
   tmp[4] = '\0';
   is.read(tmp, 4);
@@ -41,7 +48,7 @@ void WaveData::Expect4ByteTag(std::istream &is, const char *expected) {
     KALDI_ERR << "WaveData: expected " << expected << ", got " << tmp;
 }
 
-uint32 WaveData::ReadUint32(std::istream &is, bool swap) {
+static uint32 ReadUint32(std::istream &is, bool swap) {
   union {
     char result[4];
     uint32 ans;
@@ -55,7 +62,7 @@ uint32 WaveData::ReadUint32(std::istream &is, bool swap) {
 }
 
 
-uint16 WaveData::ReadUint16(std::istream &is, bool swap) {
+static uint16 ReadUint16(std::istream &is, bool swap) {
   union {
     char result[2];
     int16 ans;
@@ -68,47 +75,27 @@ uint16 WaveData::ReadUint16(std::istream &is, bool swap) {
   return u.ans;
 }
 
-// static
-void WaveData::Read4ByteTag(std::istream &is, char *dest) {
+static void Read4ByteTag(std::istream &is, char *dest) {
   is.read(dest, 4);
   if (is.fail())
     KALDI_ERR << "WaveData: expected 4-byte chunk-name, got read errror";
 }
 
-// static
-void WaveData::WriteUint32(std::ostream &os, int32 i) {
-  union {
-    char buf[4];
-    int i;
-  } u;
-  u.i = i;
-#ifdef __BIG_ENDIAN__
-  KALDI_SWAP4(u.buf);
-#endif
-  os.write(u.buf, 4);
-  if (os.fail())
-    KALDI_ERR << "WaveData: error writing to stream.";
-}
-
-void WaveData::WriteUint16(std::ostream &os, int16 i) {
-  union {
-    char buf[2];
-    int16 i;
-  } u;
-  u.i = i;
-#ifdef __BIG_ENDIAN__
-  KALDI_SWAP2(u.buf);
-#endif
-  os.write(u.buf, 2);
-  if (os.fail())
-    KALDI_ERR << "WaveData: error writing to stream.";
-}
-
-
-
-void WaveData::Read(std::istream &is) {
-  data_.Resize(0, 0);  // clear the data.
-
+// The parsed information from a .wav header, together with the "swap" flag
+// saying whether the sample bytes are opposite-endian to this machine.
+struct WaveHeaderInfo {
+  bool swap;
+  uint16 num_channels;
+  uint32 sample_rate;
+  uint32 bits_per_sample;
+  uint32 block_align;
+  uint32 data_chunk_size;
+};
+
+// Reads the header of a .wav stream, up to and including the size field of
+// the "data" chunk, leaving the stream positioned at the first sample.
+// Shared between WaveData::Read() and WaveStreamReader.  Throws on error.
+static void ReadWaveHeader(std::istream &is, WaveHeaderInfo *info) {
   char tmp[5];
   tmp[4] = '\0';
   Read4ByteTag(is, &tmp[0]);
@@ -175,7 +162,6 @@ void WaveData::Read(std::istream &is) {
 
   if (num_channels <= 0)
     KALDI_ERR << "WaveData: no channels present";
-  samp_freq_ = static_cast<BaseFloat>(sample_rate);
   if (bits_per_sample != 8 && bits_per_sample != 16 && bits_per_sample != 32)
     KALDI_ERR << "WaveData: bits_per_sample is " << bits_per_sample;
   if (byte_rate != sample_rate * bits_per_sample/8 * num_channels)
@@ -233,45 +219,88 @@ void WaveData::Read(std::istream &is) {
               << "(we do not support reading multiple data chunks).";
   }
 
-  std::vector<char*> data_pointer_vec;
-  std::vector<int> data_size_vec;
+  if (data_chunk_size == 0)
+    KALDI_ERR << "WaveData: empty file (no data)";
+
+  info->swap = swap;
+  info->num_channels = num_channels;
+  info->sample_rate = sample_rate;
+  info->bits_per_sample = bits_per_sample;
+  info->block_align = block_align;
+  info->data_chunk_size = data_chunk_size;
+}
+
+// Reads the sample bytes of the "data" chunk into "data", growing it
+// block-wise (so a bogus chunk size in the header cannot make us allocate
+// more memory than the stream actually contains).  Warns if fewer bytes
+// than the header promised could be read; throws if there were none.
+static void ReadWaveSamples(std::istream &is, uint32 data_chunk_size,
+                            uint32 block_size, std::vector<char> *data) {
   uint32 num_bytes_read = 0;
-  for (int32 remain_chunk_size = data_chunk_size; remain_chunk_size > 0;
-       remain_chunk_size -= kBlockSize) {
-    int32 this_block_size = remain_chunk_size;
-    if (kBlockSize < remain_chunk_size)
-      this_block_size = kBlockSize;
-    char *block_data_vec = new char[this_block_size];
-    is.read(block_data_vec, this_block_size);
+  while (num_bytes_read < data_chunk_size) {
+    uint32 this_block_size = std::min(data_chunk_size - num_bytes_read,
+                                      block_size);
+    data->resize(num_bytes_read + this_block_size);
+    is.read(&((*data)[num_bytes_read]), this_block_size);
     num_bytes_read += is.gcount();
-    data_size_vec.push_back(is.gcount());
-    data_pointer_vec.push_back(block_data_vec);
-    if (num_bytes_read < this_block_size)
+    if (static_cast<uint32>(is.gcount()) < this_block_size)
       break;
   }
-
-  std::vector<char> chunk_data_vec(num_bytes_read);
-  uint32 data_address = 0;
-  for (int i = 0; i < data_pointer_vec.size(); i++) {
-    memcpy(&(chunk_data_vec[data_address]), data_pointer_vec[i],
-           data_size_vec[i]);
-    delete[] data_pointer_vec[i];
-    data_address += data_size_vec[i];
-  }
-
-  char *data_ptr = &(chunk_data_vec[0]);
-  if (num_bytes_read == 0 && num_bytes_read != data_chunk_size) {
+  data->resize(num_bytes_read);
+  if (num_bytes_read == 0) {
     KALDI_ERR << "WaveData: failed to read data chunk (read no bytes)";
   } else if (num_bytes_read != data_chunk_size) {
     KALDI_ASSERT(num_bytes_read < data_chunk_size);
     KALDI_WARN << "Read fewer bytes than specified in the header: "
                << num_bytes_read << " < " << data_chunk_size;
   }
+}
+
+// static
+void WaveData::WriteUint32(std::ostream &os, int32 i) {
+  union {
+    char buf[4];
+    int i;
+  } u;
+  u.i = i;
+#ifdef __BIG_ENDIAN__
+  KALDI_SWAP4(u.buf);
+#endif
+  os.write(u.buf, 4);
+  if (os.fail())
+    KALDI_ERR << "WaveData: error writing to stream.";
+}
+
+void WaveData::WriteUint16(std::ostream &os, int16 i) {
+  union {
+    char buf[2];
+    int16 i;
+  } u;
+  u.i = i;
+#ifdef __BIG_ENDIAN__
+  KALDI_SWAP2(u.buf);
+#endif
+  os.write(u.buf, 2);
+  if (os.fail())
+    KALDI_ERR << "WaveData: error writing to stream.";
+}
 
-  if (data_chunk_size == 0)
-    KALDI_ERR << "WaveData: empty file (no data)";
 
-  uint32 num_samp = num_bytes_read / block_align;
+
+void WaveData::Read(std::istream &is) {
+  data_.Resize(0, 0);  // clear the data.
+
+  WaveHeaderInfo info;
+  ReadWaveHeader(is, &info);
+  samp_freq_ = static_cast<BaseFloat>(info.sample_rate);
+
+  std::vector<char> chunk_data_vec;
+  ReadWaveSamples(is, info.data_chunk_size, kBlockSize, &chunk_data_vec);
+  const char *data_ptr = &(chunk_data_vec[0]);
+  bool swap = info.swap;
+  uint32 bits_per_sample = info.bits_per_sample,
+      num_channels = info.num_channels,
+      num_samp = chunk_data_vec.size() / info.block_align;
   data_.Resize(num_channels, num_samp);
   for (uint32 i = 0; i < num_samp; i++) {
     for (uint32 j = 0; j < num_channels; j++) {
@@ -282,7 +311,7 @@ void WaveData::Read(std::istream &is) {
           break;
         case 16:
           {
-            int16 k = *reinterpret_cast<uint16*>(data_ptr);
+            int16 k = *reinterpret_cast<const uint16*>(data_ptr);
             if (swap)
               KALDI_SWAP2(k);
             data_(j, i) =  k;
@@ -291,7 +320,7 @@ void WaveData::Read(std::istream &is) {
           }
         case 32:
           {
-            int32 k = *reinterpret_cast<uint32*>(data_ptr);
+            int32 k = *reinterpret_cast<const uint32*>(data_ptr);
             if (swap)
               KALDI_SWAP4(k);
             data_(j, i) =  k;
@@ -305,6 +334,139 @@ void WaveData::Read(std::istream &is) {
   }
 }
 
+void WaveStreamReader::Clear() {
+#ifndef _MSC_VER
+  if (mmap_data_ != NULL)
+    munmap(mmap_data_, mmap_size_);
+#endif
+  mmap_data_ = NULL;
+  mmap_size_ = 0;
+  samples_ = NULL;
+  std::vector<char>().swap(buffer_);  // clear, freeing memory.
+  samp_freq_ = 0.0;
+  num_channels_ = 0;
+  num_samp_ = 0;
+  bits_per_sample_ = 0;
+  block_align_ = 0;
+  swap_ = false;
+}
+
+void WaveStreamReader::SetInfo(const WaveHeaderInfo &info,
+                               size_t num_data_bytes) {
+  if (num_data_bytes < info.data_chunk_size)
+    KALDI_WARN << "Read fewer bytes than specified in the header: "
+               << num_data_bytes << " < " << info.data_chunk_size;
+  samp_freq_ = static_cast<BaseFloat>(info.sample_rate);
+  num_channels_ = info.num_channels;
+  bits_per_sample_ = info.bits_per_sample;
+  block_align_ = info.block_align;
+  swap_ = info.swap;
+  num_samp_ = std::min<size_t>(num_data_bytes, info.data_chunk_size) /
+      info.block_align;
+  if (num_samp_ == 0)
+    KALDI_ERR << "WaveData: failed to read data chunk (read no bytes)";
+}
+
+void WaveStreamReader::Read(std::istream &is) {
+  Clear();
+  WaveHeaderInfo info;
+  ReadWaveHeader(is, &info);
+  ReadWaveSamples(is, info.data_chunk_size, kBlockSize, &buffer_);
+  samples_ = &(buffer_[0]);
+  SetInfo(info, buffer_.size());
+}
+
+namespace {
+// A read-only streambuf over an existing block of memory; does not copy.
+// Used to parse the .wav header out of a memory-mapped file.
+class MemoryStreambuf: public std::streambuf {
+ public:
+  MemoryStreambuf(char *data, size_t size) {
+    this->setg(data, data, data + size);
+  }
+  // Returns the number of bytes consumed so far.
+  size_t BytesRead() const { return this->gptr() - this->eback(); }
+};
+}  // namespace
+
+void WaveStreamReader::Open(const std::string &filename) {
+  Clear();
+#ifndef _MSC_VER
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd == -1)
+    KALDI_ERR << "WaveStreamReader: failed to open " << filename;
+  struct stat st;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map != MAP_FAILED) {
+      close(fd);  // the mapping stays valid after close.
+      mmap_data_ = static_cast<char*>(map);
+      mmap_size_ = st.st_size;
+      MemoryStreambuf buf(mmap_data_, mmap_size_);
+      std::istream header_is(&buf);
+      WaveHeaderInfo info;
+      try {
+        ReadWaveHeader(header_is, &info);
+      } catch (...) {
+        Clear();  // unmap before rethrowing.
+        throw;
+      }
+      size_t header_size = buf.BytesRead();
+      samples_ = mmap_data_ + header_size;
+      SetInfo(info, mmap_size_ - header_size);
+      return;
+    }
+  }
+  // Not a regular file, or mmap failed: fall back to reading it in.
+  close(fd);
+#endif
+  std::ifstream is(filename.c_str(),
+                   std::ios_base::in | std::ios_base::binary);
+  if (!is.is_open())
+    KALDI_ERR << "WaveStreamReader: failed to open " << filename;
+  Read(is);
+}
+
+void WaveStreamReader::GetWindow(int32 channel, int32 begin, int32 num_samp,
+                                 Vector<BaseFloat> *window) const {
+  KALDI_ASSERT(channel >= 0 && channel < num_channels_ &&
+               begin >= 0 && num_samp >= 0 && begin + num_samp <= num_samp_);
+  if (window->Dim() != num_samp)
+    window->Resize(num_samp, kUndefined);
+  uint32 bytes_per_samp = bits_per_sample_ / 8;
+  const char *data_ptr = samples_ +
+      static_cast<size_t>(begin) * block_align_ + channel * bytes_per_samp;
+  BaseFloat *window_data = window->Data();
+  for (int32 i = 0; i < num_samp; i++, data_ptr += block_align_) {
+    switch (bits_per_sample_) {
+      case 8:
+        window_data[i] = *data_ptr;
+        break;
+      case 16:
+        {
+          // memcpy, as the mapped data may not be 2-byte aligned.
+          int16 k;
+          memcpy(&k, data_ptr, 2);
+          if (swap_)
+            KALDI_SWAP2(k);
+          window_data[i] = k;
+          break;
+        }
+      case 32:
+        {
+          int32 k;
+          memcpy(&k, data_ptr, 4);
+          if (swap_)
+            KALDI_SWAP4(k);
+          window_data[i] = k;
+          break;
+        }
+      default:
+        KALDI_ERR << "bits per sample is " << bits_per_sample_;  // already checked this.
+    }
+  }
+}
+
 
 // Write 16-bit PCM.
 
@@ -44,6 +44,8 @@
 #define KALDI_FEAT_WAVE_READER_H_
 
 #include <cstring>
+#include <string>
+#include <vector>
 
 #include "base/kaldi-types.h"
 #include "matrix/kaldi-vector.h"
@@ -96,15 +98,82 @@ class WaveData {
   static const uint32 kBlockSize = 1024 * 1024;  // Use 1M bytes.
   Matrix<BaseFloat> data_;
   BaseFloat samp_freq_;
-  static void Expect4ByteTag(std::istream &is, const char *expected);
-  uint32 ReadUint32(std::istream &is, bool swap);
-  uint16 ReadUint16(std::istream &is, bool swap);
-  static void Read4ByteTag(std::istream &is, char *dest);
-
   static void WriteUint32(std::ostream &os, int32 i);
   static void WriteUint16(std::ostream &os, int16 i);
 };
 
+struct WaveHeaderInfo;  // defined in wave-reader.cc.
+
+/// WaveStreamReader reads .wav data but, unlike WaveData, does not convert
+/// the samples to BaseFloat up front: it keeps them in their on-disk form
+/// (memory-mapped where possible) and converts them lazily, window by
+/// window, as requested via GetWindow().  For 16-bit data this roughly
+/// halves the memory used per file and avoids converting channels that are
+/// never looked at, which matters when scanning large corpora for feature
+/// extraction.
+class WaveStreamReader {
+ public:
+  WaveStreamReader(): samp_freq_(0.0), num_channels_(0), num_samp_(0),
+                      bits_per_sample_(0), block_align_(0), swap_(false),
+                      samples_(NULL), mmap_data_(NULL), mmap_size_(0) { }
+
+  ~WaveStreamReader() { Clear(); }
+
+  /// Opens the named .wav file, memory-mapping the sample data where
+  /// possible (falling back to reading the file into memory, e.g. on
+  /// Windows or if the input is not a regular file).  Throws on error.
+  void Open(const std::string &filename);
+
+  /// Reads .wav data from a stream, as WaveData::Read() does, but keeping
+  /// the sample bytes in their on-disk form.  "is" should be opened in
+  /// binary mode.  It's valid to call Read() or Open() more than once--
+  /// in this case it will destroy what was there before.  Throws on error.
+  void Read(std::istream &is);
+
+  BaseFloat SampFreq() const { return samp_freq_; }
+
+  int32 NumChannels() const { return num_channels_; }
+
+  /// Returns the number of samples per channel.
+  int32 NumSamples() const { return num_samp_; }
+
+  /// Returns the duration in seconds.
+  BaseFloat Duration() const { return num_samp_ / samp_freq_; }
+
+  /// Converts samples [ begin, begin + num_samp ) of channel "channel" to
+  /// BaseFloat, on the same scale as the data of WaveData (see
+  /// kWaveSampleMax above); resizes "window" to num_samp.
+  void GetWindow(int32 channel, int32 begin, int32 num_samp,
+                 Vector<BaseFloat> *window) const;
+
+  void Clear();
+
+ private:
+  // Sets the format members from a parsed header, and works out num_samp_
+  // from the number of sample bytes actually present.  Shared between
+  // Read() and Open().
+  void SetInfo(const WaveHeaderInfo &info, size_t num_data_bytes);
+
+  static const uint32 kBlockSize = 1024 * 1024;  // Use 1M bytes.
+
+  BaseFloat samp_freq_;
+  int32 num_channels_;
+  int32 num_samp_;  // per channel.
+  uint32 bits_per_sample_;
+  uint32 block_align_;  // bytes per frame of samples, i.e.
+                        // num_channels_ * bits_per_sample_ / 8.
+  bool swap_;  // true if sample bytes are opposite-endian to this machine.
+
+  // Points to the raw sample bytes: into the memory-mapped region if we
+  // mapped the file, else into buffer_.
+  const char *samples_;
+  std::vector<char> buffer_;  // used by Read(), and by Open() as fallback.
+  char *mmap_data_;   // start of the memory-mapped region, or NULL.
+  size_t mmap_size_;  // size of the memory-mapped region.
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(WaveStreamReader);
+};
+
 
 // Holder class for .wav files that enables us to read (but not write)
 // .wav files. c.f. util/kaldi-holder.h
@@ -131,7 +200,7 @@ class WaveHolder {
 
   void Clear() { t_.Clear(); }
 
-  const T &Value() { return t_; }
+  T &Value() { return t_; }
 
   WaveHolder &operator = (const WaveHolder &other) {
     t_.CopyFrom(other.t_);
@@ -158,6 +227,45 @@ class WaveHolder {
 };
 
 
+// Holder class for .wav files that reads them via WaveStreamReader, so
+// Table-based pipelines (e.g. featbin/compute-mfcc-feats.cc) convert
+// samples lazily instead of materializing a Matrix<BaseFloat> per file.
+// Read-only: writing is not supported.  c.f. util/kaldi-holder.h
+class WaveStreamHolder {
+ public:
+  typedef WaveStreamReader T;
+
+  static bool Write(std::ostream &os, bool binary, const T &t) {
+    KALDI_ERR << "Writing is not supported for WaveStreamHolder.";
+    return false;
+  }
+
+  static bool IsReadInBinary() { return true; }
+
+  void Clear() { t_.Clear(); }
+
+  T &Value() { return t_; }
+
+  WaveStreamHolder() {}
+
+  bool Read(std::istream &is) {
+    // We don't look for the binary-mode header here [always binary]
+    try {
+      t_.Read(is);  // throws exception on failure.
+      return true;
+    } catch (const std::exception &e) {
+      KALDI_WARN << "Exception caught in WaveStreamHolder object (reading).";
+      if (!IsKaldiError(e.what())) { std::cerr << e.what(); }
+      return false;  // read failure.
+    }
+  }
+
+ private:
+  T t_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(WaveStreamHolder);
+};
+
+
 }  // namespace kaldi
 
 #endif  // KALDI_FEAT_WAVE_READER_H_
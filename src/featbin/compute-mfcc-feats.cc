@@ -20,8 +20,11 @@
 
 #include "base/kaldi-common.h"
 #include "util/common-utils.h"
+#include "feat/feature-cache.h"
+#include "feat/feature-compute-task.h"
 #include "feat/feature-mfcc.h"
 #include "feat/wave-reader.h"
+#include "thread/kaldi-task-sequence.h"
 
 int main(int argc, char *argv[]) {
   try {
@@ -33,6 +36,8 @@ int main(int argc, char *argv[]) {
     // construct all the global objects
     ParseOptions po(usage);
     MfccOptions mfcc_opts;
+    TaskSequencerConfig sequencer_config;  // has --num-threads option
+    FeatureCacheConfig cache_config;  // has --feature-cache-dir option
     bool subtract_mean = false;
     BaseFloat vtln_warp = 1.0;
     std::string vtln_map_rspecifier;
@@ -44,6 +49,8 @@ int main(int argc, char *argv[]) {
 
     // Register the MFCC option struct
     mfcc_opts.Register(&po);
+    sequencer_config.Register(&po);
+    cache_config.Register(&po);
 
     // Register the options
     po.Register("output-format", &output_format, "Format of the output "
@@ -74,7 +81,20 @@ int main(int argc, char *argv[]) {
 
     Mfcc mfcc(mfcc_opts);
 
-    SequentialTableReader<WaveHolder> reader(wav_rspecifier);
+    FeatureCache *cache = NULL;
+    if (cache_config.cache_dir != "") {
+      // The cache key must cover every option that affects the features we
+      // write; the VTLN warp factor is hashed separately for each utterance.
+      OptionsSignature signature;
+      mfcc_opts.Register(&signature);
+      signature.Register("subtract-mean", &subtract_mean, "");
+      cache = new FeatureCache(cache_config, signature.Str());
+    }
+
+    // WaveStreamHolder keeps the samples in their on-disk form and converts
+    // only the channel we extract, rather than materializing a
+    // Matrix<BaseFloat> of all channels per file as WaveHolder would.
+    SequentialTableReader<WaveStreamHolder> reader(wav_rspecifier);
     BaseFloatMatrixWriter kaldi_writer;  // typedef to TableWriter<something>.
     TableWriter<HtkMatrixHolder> htk_writer;
 
@@ -97,16 +117,20 @@ int main(int argc, char *argv[]) {
     }
 
     int32 num_utts = 0, num_success = 0;
+    // The sequencer runs the feature computation of different utterances in
+    // parallel (--num-threads), but writes the output in input order; see
+    // feat/feature-compute-task.h.
+    TaskSequencer<FeatureComputeTask<Mfcc> > sequencer(sequencer_config);
     for (; !reader.Done(); reader.Next()) {
       num_utts++;
       std::string utt = reader.Key();
-      const WaveData &wave_data = reader.Value();
+      const WaveStreamReader &wave_data = reader.Value();
       if (wave_data.Duration() < min_duration) {
         KALDI_WARN << "File: " << utt << " is too short ("
                    << wave_data.Duration() << " sec): producing no output.";
         continue;
       }
-      int32 num_chan = wave_data.Data().NumRows(), this_chan = channel;
+      int32 num_chan = wave_data.NumChannels(), this_chan = channel;
       {  // This block works out the channel (0=left, 1=right...)
         KALDI_ASSERT(num_chan > 0);  // should have been caught in
         // reading code if no channels.
@@ -141,43 +165,20 @@ int main(int argc, char *argv[]) {
                   << wave_data.SampFreq() << " (use --sample-frequency "
                   << "option).  Utterance is " << utt;
 
-      SubVector<BaseFloat> waveform(wave_data.Data(), this_chan);
-      Matrix<BaseFloat> features;
-      try {
-        mfcc.Compute(waveform, vtln_warp_local, &features, NULL);
-      } catch (...) {
-        KALDI_WARN << "Failed to compute features for utterance "
-                   << utt;
-        continue;
-      }
-      if (subtract_mean) {
-        Vector<BaseFloat> mean(features.NumCols());
-        mean.AddRowSumMat(1.0, features);
-        mean.Scale(1.0 / features.NumRows());
-        for (int32 i = 0; i < features.NumRows(); i++)
-          features.Row(i).AddVec(-1.0, mean);
-      }
-      if (output_format == "kaldi") {
-        kaldi_writer.Write(utt, features);
-      } else {
-        std::pair<Matrix<BaseFloat>, HtkHeader> p;
-        p.first.Resize(features.NumRows(), features.NumCols());
-        p.first.CopyFromMat(features);
-        HtkHeader header = {
-          features.NumRows(),
-          100000,  // 10ms shift
-          static_cast<int16>(sizeof(float)*(features.NumCols())),
+      Vector<BaseFloat> waveform;
+      wave_data.GetWindow(this_chan, 0, wave_data.NumSamples(), &waveform);
+      sequencer.Run(new FeatureComputeTask<Mfcc>(
+          mfcc, utt, waveform, vtln_warp_local, subtract_mean,
           static_cast<uint16>( 006 | // MFCC
-          (mfcc_opts.use_energy ? 0100 : 020000)) // energy; otherwise c0
-        };
-        p.second = header;
-        htk_writer.Write(utt, p);
-      }
+          (mfcc_opts.use_energy ? 0100 : 020000)), // energy; otherwise c0
+          (output_format == "kaldi" ? &kaldi_writer : NULL),
+          (output_format == "kaldi" ? NULL : &htk_writer),
+          &num_success, cache));
       if (num_utts % 10 == 0)
         KALDI_LOG << "Processed " << num_utts << " utterances";
-      KALDI_VLOG(2) << "Processed features for key " << utt;
-      num_success++;
     }
+    sequencer.Wait();  // Waits for any remaining tasks and their output.
+    delete cache;  // logs the hit/miss statistics.
     KALDI_LOG << " Done " << num_success << " out of " << num_utts
               << " utterances.";
     return (num_success != 0 ? 0 : 1);
@@ -20,8 +20,11 @@
 
 #include "base/kaldi-common.h"
 #include "util/common-utils.h"
+#include "feat/feature-cache.h"
+#include "feat/feature-compute-task.h"
 #include "feat/feature-plp.h"
 #include "feat/wave-reader.h"
+#include "thread/kaldi-task-sequence.h"
 
 
 int main(int argc, char *argv[]) {
@@ -34,6 +37,8 @@ int main(int argc, char *argv[]) {
     // construct all the global objects
     ParseOptions po(usage);
     PlpOptions plp_opts;
+    TaskSequencerConfig sequencer_config;  // has --num-threads option
+    FeatureCacheConfig cache_config;  // has --feature-cache-dir option
     bool subtract_mean = false;
     BaseFloat vtln_warp = 1.0;
     std::string vtln_map_rspecifier;
@@ -60,6 +65,8 @@ int main(int argc, char *argv[]) {
                 "to process (in seconds).");
 
     plp_opts.Register(&po);
+    sequencer_config.Register(&po);
+    cache_config.Register(&po);
 
     po.Read(argc, argv);
     
@@ -74,6 +81,16 @@ int main(int argc, char *argv[]) {
 
     Plp plp(plp_opts);
 
+    FeatureCache *cache = NULL;
+    if (cache_config.cache_dir != "") {
+      // The cache key must cover every option that affects the features we
+      // write; the VTLN warp factor is hashed separately for each utterance.
+      OptionsSignature signature;
+      plp_opts.Register(&signature);
+      signature.Register("subtract-mean", &subtract_mean, "");
+      cache = new FeatureCache(cache_config, signature.Str());
+    }
+
     SequentialTableReader<WaveHolder> reader(wav_rspecifier);
     BaseFloatMatrixWriter kaldi_writer;  // typedef to TableWriter<something>.
     TableWriter<HtkMatrixHolder> htk_writer;
@@ -97,6 +114,10 @@ int main(int argc, char *argv[]) {
     }
 
     int32 num_utts = 0, num_success = 0;
+    // The sequencer runs the feature computation of different utterances in
+    // parallel (--num-threads), but writes the output in input order; see
+    // feat/feature-compute-task.h.
+    TaskSequencer<FeatureComputeTask<Plp> > sequencer(sequencer_config);
     for (; !reader.Done(); reader.Next()) {
       num_utts++;
       std::string utt = reader.Key();
@@ -142,42 +163,18 @@ int main(int argc, char *argv[]) {
                   << "option).  Utterance is " << utt;
 
       SubVector<BaseFloat> waveform(wave_data.Data(), this_chan);
-      Matrix<BaseFloat> features;
-      try {
-        plp.Compute(waveform, vtln_warp_local, &features, NULL);
-      } catch (...) {
-        KALDI_WARN << "Failed to compute features for utterance "
-                   << utt;
-        continue;
-      }
-      if (subtract_mean) {
-        Vector<BaseFloat> mean(features.NumCols());
-        mean.AddRowSumMat(1.0, features);
-        mean.Scale(1.0 / features.NumRows());
-        for (size_t i = 0; i < features.NumRows(); i++)
-          features.Row(i).AddVec(-1.0, mean);
-      }
-      if (output_format == "kaldi") {
-        kaldi_writer.Write(utt, features);
-      } else {
-        std::pair<Matrix<BaseFloat>, HtkHeader> p;
-        p.first.Resize(features.NumRows(), features.NumCols());
-        p.first.CopyFromMat(features);
-        HtkHeader header = {
-          features.NumRows(),
-          100000,  // 10ms shift
-          static_cast<int16>(sizeof(float)*features.NumCols()),
-          013 | // PLP
-          020000 // C0 [no option currently to use energy in PLP.
-        };
-        p.second = header;
-        htk_writer.Write(utt, p);
-      }
+      sequencer.Run(new FeatureComputeTask<Plp>(
+          plp, utt, waveform, vtln_warp_local, subtract_mean,
+          static_cast<uint16>(013 | // PLP
+          020000), // C0 [no option currently to use energy in PLP.
+          (output_format == "kaldi" ? &kaldi_writer : NULL),
+          (output_format == "kaldi" ? NULL : &htk_writer),
+          &num_success, cache));
       if (num_utts % 10 == 0)
         KALDI_LOG << "Processed " << num_utts << " utterances";
-      KALDI_VLOG(2) << "Processed features for key " << utt;
-      num_success++;
     }
+    sequencer.Wait();  // Waits for any remaining tasks and their output.
+    delete cache;  // logs the hit/miss statistics.
     KALDI_LOG << " Done " << num_success << " out of " << num_utts
               << " utterances.";
     return (num_success != 0 ? 0 : 1);
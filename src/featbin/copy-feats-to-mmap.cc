@@ -0,0 +1,69 @@
+// featbin/copy-feats-to-mmap.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "util/mapped-matrix-archive.h"
+#include "matrix/kaldi-matrix.h"
+
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+
+    const char *usage =
+        "Copy features into a memory-mapped random-access archive (see\n"
+        "util/mapped-matrix-archive.h); use this format where random,\n"
+        "read-heavy access to uncompressed features is needed, e.g. when\n"
+        "generating training examples.  The output is a plain filename,\n"
+        "not a wspecifier, and no separate .scp is needed: the index is\n"
+        "embedded in the file.\n"
+        "Usage: copy-feats-to-mmap <feature-rspecifier> <archive-filename>\n"
+        "e.g.: copy-feats-to-mmap scp:train.scp train.mmapark\n"
+        "See also: copy-feats\n";
+
+    ParseOptions po(usage);
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 2) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string rspecifier = po.GetArg(1),
+        archive_filename = po.GetArg(2);
+
+    MappedMatrixArchiveWriter writer;
+    writer.Open(archive_filename);
+
+    int32 num_done = 0;
+    SequentialBaseFloatMatrixReader reader(rspecifier);
+    for (; !reader.Done(); reader.Next(), num_done++)
+      writer.Write(reader.Key(), reader.Value());
+    writer.Close();
+
+    KALDI_LOG << "Copied " << num_done << " feature matrices to "
+              << archive_filename;
+    return (num_done != 0 ? 0 : 1);
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
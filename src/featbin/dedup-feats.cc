@@ -0,0 +1,186 @@
+// featbin/dedup-feats.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <map>
+#include <utility>
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "matrix/kaldi-matrix.h"
+
+namespace kaldi {
+
+// 128-bit content hash of a feature matrix (dimensions plus raw data), as
+// two independently seeded 64-bit FNV-1a lanes computed in one streaming
+// pass.  With 128 bits, accidental collisions are negligible even across
+// our largest archive collections, so records with equal hashes are
+// treated as identical without a byte-level comparison.
+static std::pair<uint64, uint64> FeatureHash(const Matrix<BaseFloat> &feats) {
+  const uint64 prime = 1099511628211ULL;
+  uint64 a = 14695981039346656037ULL,  // standard FNV offset basis.
+      b = 0x8e88d3b214f85b33ULL;       // arbitrary alternative seed.
+  int32 num_rows = feats.NumRows(), num_cols = feats.NumCols();
+  a = (a ^ static_cast<uint64>(num_rows)) * prime;
+  b = (b ^ static_cast<uint64>(num_rows)) * prime;
+  a = (a ^ static_cast<uint64>(num_cols)) * prime;
+  b = (b ^ static_cast<uint64>(num_cols)) * prime;
+  for (int32 r = 0; r < num_rows; r++) {
+    // Hash row by row, as the rows of a Matrix need not be contiguous.
+    const char *data = reinterpret_cast<const char*>(feats.RowData(r));
+    size_t num_bytes = sizeof(BaseFloat) * num_cols;
+    for (size_t i = 0; i < num_bytes; i++) {
+      a = (a ^ static_cast<unsigned char>(data[i])) * prime;
+      b = (b ^ static_cast<unsigned char>(data[i])) * prime;
+    }
+  }
+  return std::make_pair(a, b);
+}
+
+}  // namespace kaldi
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    typedef kaldi::int32 int32;
+    typedef kaldi::int64 int64;
+
+    const char *usage =
+        "Copy features, writing each distinct record only once: duplicated\n"
+        "records (e.g. from re-runs merged into one rspecifier) get script-file\n"
+        "entries pointing at the first copy's archive offset, which\n"
+        "RandomAccessTableReader and friends resolve like any other scp entry.\n"
+        "The archive and script filenames are passed separately (not as an\n"
+        "ark,scp wspecifier) because the script file is rewritten with shared\n"
+        "offsets.  With --index-out, also writes a text index of per-record\n"
+        "content hashes, for measuring duplication without rewriting anything\n"
+        "(in that mode the archive and script file may be omitted).\n"
+        "\n"
+        "Usage: dedup-feats [options] <feats-rspecifier> <ark-wxfilename> <scp-wxfilename>\n"
+        "  or:  dedup-feats --index-out=<index-wxfilename> <feats-rspecifier>\n"
+        "e.g.: dedup-feats 'ark:cat run1.ark run2.ark|' dedup.ark dedup.scp\n";
+
+    ParseOptions po(usage);
+    std::string index_out;
+    po.Register("index-out", &index_out, "If set, write a text index with "
+                "lines <utterance-id> <content-hash> <num-rows> <num-cols>");
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 3 && !(po.NumArgs() == 1 && !index_out.empty())) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string rspecifier = po.GetArg(1),
+        ark_wxfilename = po.GetOptArg(2),
+        scp_wxfilename = po.GetOptArg(3);
+
+    bool write_archive = (po.NumArgs() == 3);
+    if (write_archive &&
+        ClassifyWxfilename(ark_wxfilename) != kFileOutput)
+      KALDI_WARN << "The script file will generally not be interpreted "
+          "correctly unless the archive is an actual file: "
+                 << PrintableWxfilename(ark_wxfilename);
+
+    Output ark_output, scp_output, index_output;
+    if (write_archive) {
+      if (!ark_output.Open(ark_wxfilename, true, false))  // binary, no header.
+        KALDI_ERR << "Failed opening archive "
+                  << PrintableWxfilename(ark_wxfilename);
+      if (!scp_output.Open(scp_wxfilename, false, false))  // text.
+        KALDI_ERR << "Failed opening script file "
+                  << PrintableWxfilename(scp_wxfilename);
+    }
+    if (!index_out.empty()) {
+      if (!index_output.Open(index_out, false, false))  // text.
+        KALDI_ERR << "Failed opening index file "
+                  << PrintableWxfilename(index_out);
+    }
+
+    // Maps content hash to the offset rxfilename (e.g. dedup.ark:12345) of
+    // the first record with that content.  Only hashes and offsets are kept
+    // in memory, never the feature data itself.
+    std::map<std::pair<uint64, uint64>, std::string> first_copy;
+
+    SequentialBaseFloatMatrixReader reader(rspecifier);
+    int64 num_done = 0, num_dups = 0, bytes_written = 0, bytes_shared = 0;
+    for (; !reader.Done(); reader.Next()) {
+      const std::string &key = reader.Key();
+      const Matrix<BaseFloat> &feats = reader.Value();
+      std::pair<uint64, uint64> hash = FeatureHash(feats);
+      int64 num_bytes = static_cast<int64>(sizeof(BaseFloat)) *
+          feats.NumRows() * feats.NumCols();
+
+      if (!index_out.empty()) {
+        std::ostringstream hash_str;
+        hash_str << std::hex << hash.first << hash.second;
+        index_output.Stream() << key << ' ' << hash_str.str() << ' '
+                              << feats.NumRows() << ' ' << feats.NumCols()
+                              << '\n';
+      }
+
+      std::map<std::pair<uint64, uint64>, std::string>::const_iterator
+          iter = first_copy.find(hash);
+      if (iter != first_copy.end()) {  // duplicate content.
+        num_dups++;
+        bytes_shared += num_bytes;
+        if (write_archive)
+          scp_output.Stream() << key << ' ' << iter->second << '\n';
+      } else {
+        bytes_written += num_bytes;
+        if (write_archive) {
+          // Mirrors how TableWriter writes an archive with an associated
+          // scp: key, space, then the object; the scp entry points at the
+          // stream position just after the space.
+          std::ostream &ark_os = ark_output.Stream();
+          ark_os << key << ' ';
+          std::ostream::pos_type ark_pos = ark_os.tellp();
+          InitKaldiOutputStream(ark_os, true);
+          feats.Write(ark_os, true);
+          if (ark_os.fail())
+            KALDI_ERR << "Error writing archive "
+                      << PrintableWxfilename(ark_wxfilename);
+          std::ostringstream offset_rxfilename;
+          offset_rxfilename << ark_wxfilename << ':' << ark_pos;
+          scp_output.Stream() << key << ' ' << offset_rxfilename.str() << '\n';
+          first_copy[hash] = offset_rxfilename.str();
+        } else {
+          first_copy[hash] = key;
+        }
+      }
+      num_done++;
+    }
+
+    if (write_archive) {
+      if (!scp_output.Close() || !ark_output.Close())
+        KALDI_ERR << "Error closing output (disk full?)";
+    }
+    if (!index_out.empty() && !index_output.Close())
+      KALDI_ERR << "Error closing index file.";
+
+    KALDI_LOG << "Processed " << num_done << " feature matrices; "
+              << num_dups << " were duplicates, sharing "
+              << bytes_shared << " bytes of " << (bytes_written + bytes_shared)
+              << " total.";
+    return (num_done != 0 ? 0 : 1);
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
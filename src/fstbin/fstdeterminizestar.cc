@@ -24,6 +24,7 @@
 #include "fstext/determinize-star.h"
 #include "fstext/fstext-utils.h"
 #include "fstext/kaldi-fst-io.h"
+#include "fstext/mapped-fst.h"
 #ifndef _MSC_VER
 #include <signal.h> // Comment this line and the call to signal below if
 // it causes compilation problems.  It is only to enable a debugging procedure
@@ -74,11 +75,24 @@ int main(int argc, char *argv[]) {
 
     float delta = kDelta;
     int max_states = -1;
+    int num_threads = 1;
     bool use_log = false;
     ParseOptions po(usage);
     po.Register("use-log", &use_log, "Determinize in log semiring.");
     po.Register("delta", &delta, "Delta value used to determine equivalence of weights.");
     po.Register("max-states", &max_states, "Maximum number of states in determinized FST before it will abort.");
+    po.Register("num-threads", &num_threads, "Number of threads used in "
+                "determinization (only supported in the default, tropical "
+                "semiring, i.e. without --use-log).");
+    bool disk_backed_input = false;
+    int32 disk_cache_mb = 1024;
+    po.Register("disk-backed-input", &disk_backed_input, "If true, the input "
+                "must be a file in the mapped-FST format (see fsttomapped); "
+                "it is read through a bounded cache rather than held in "
+                "memory, for inputs larger than RAM.  Not compatible with "
+                "--use-log or with archive inputs.");
+    po.Register("disk-cache-mb", &disk_cache_mb, "With --disk-backed-input, "
+                "the number of megabytes of input arcs to cache in memory.");
     po.Read(argc, argv);
 
     if (po.NumArgs() > 2) {
@@ -95,21 +109,45 @@ int main(int argc, char *argv[]) {
     signal(SIGUSR1, signal_handler);
 #endif
     if (ClassifyRspecifier(fst_in_str, NULL, NULL) == kNoRspecifier) {
+      if (disk_backed_input) {
+        // Input larger than memory: read it through DiskBackedStdFst.  Note,
+        // no ArcSort here (the input is read-only); sorting only affects
+        // speed, not correctness.
+        if (use_log)
+          KALDI_ERR << "--disk-backed-input is not supported with --use-log.";
+        if (fst_in_str == "" || fst_in_str == "-")
+          KALDI_ERR << "--disk-backed-input requires a real input file, "
+                    << "not a pipe or stdin.";
+        DiskBackedStdFst disk_fst(fst_in_str,
+                                  static_cast<size_t>(disk_cache_mb) * 1048576);
+        VectorFst<StdArc> det_fst;
+        DeterminizeStar<Fst<StdArc> >(disk_fst, &det_fst, delta,
+                                      &debug_location, max_states,
+                                      false, num_threads);
+        WriteFstKaldi(det_fst, fst_out_str);
+        return 0;
+      }
       // Normal case: just files.
       VectorFst<StdArc> *fst = ReadFstKaldi(fst_in_str);
 
       ArcSort(fst, ILabelCompare<StdArc>());  // improves speed.
       if (use_log) {
+        if (num_threads != 1)
+          KALDI_WARN << "--num-threads is not supported with --use-log.";
         DeterminizeStarInLog(fst, delta, &debug_location, max_states);
       } else {
         VectorFst<StdArc> det_fst;
-        DeterminizeStar(*fst, &det_fst, delta, &debug_location, max_states);
+        DeterminizeStar(*fst, &det_fst, delta, &debug_location, max_states,
+                        false, num_threads);
         *fst = det_fst;  // will do shallow copy and then det_fst goes
         // out of scope anyway.
       }
       WriteFstKaldi(*fst, fst_out_str);
       delete fst;
     } else { // Dealing with archives.
+      if (disk_backed_input)
+        KALDI_ERR << "--disk-backed-input is not supported with archive "
+                  << "inputs (archive members are deserialized anyway).";
       SequentialTableReader<VectorFstHolder> fst_reader(fst_in_str);
       TableWriter<VectorFstHolder> fst_writer(fst_out_str);
       for (; !fst_reader.Done(); fst_reader.Next()) {
@@ -122,7 +160,8 @@ int main(int argc, char *argv[]) {
             DeterminizeStarInLog(&fst, delta, &debug_location, max_states);
           } else {
             VectorFst<StdArc> det_fst;
-            DeterminizeStar(fst, &det_fst, delta, &debug_location, max_states);
+            DeterminizeStar(fst, &det_fst, delta, &debug_location, max_states,
+                            false, num_threads);
             fst = det_fst;  // will do shallow copy and then det_fst goes out
             // of scope anyway.
           }
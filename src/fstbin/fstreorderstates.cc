@@ -0,0 +1,211 @@
+// fstbin/fstreorderstates.cc
+
+// Copyright 2015   Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "fst/fstlib.h"
+#include "fstext/kaldi-fst-io.h"
+
+namespace kaldi {
+
+// Comparator for ordering states by descending visit count; used with
+// stable_sort so states with equal counts keep their relative order.
+struct VisitCountGreater {
+  explicit VisitCountGreater(const std::vector<int64> &visits):
+      visits_(visits) { }
+  bool operator () (fst::StdArc::StateId a, fst::StdArc::StateId b) const {
+    return visits_[a] > visits_[b];
+  }
+  const std::vector<int64> &visits_;
+};
+
+// As above but compares the destination states of arcs.
+struct ArcDestVisitCountGreater {
+  explicit ArcDestVisitCountGreater(const std::vector<int64> &visits):
+      visits_(visits) { }
+  bool operator () (const fst::StdArc &a, const fst::StdArc &b) const {
+    return visits_[a.nextstate] > visits_[b.nextstate];
+  }
+  const std::vector<int64> &visits_;
+};
+
+// Reads state-visit counts in the format DecoderStats::WriteStateVisits()
+// produces: one "<state-id> <count>" pair per line.  States not listed get
+// count zero.
+void ReadStateVisits(const std::string &rxfilename,
+                     std::vector<int64> *visits) {
+  Input ki(rxfilename);
+  int64 state, count, num_read = 0;
+  while (ki.Stream() >> state >> count) {
+    if (state < 0 || count < 0)
+      KALDI_ERR << "Bad line in state-visit counts "
+                << PrintableRxfilename(rxfilename) << ": " << state
+                << ' ' << count;
+    if (state >= static_cast<int64>(visits->size())) {
+      KALDI_WARN << "State " << state << " in visit counts is not in the "
+                 << "FST (it has " << visits->size() << " states); the "
+                 << "counts are probably from a different graph.";
+      continue;
+    }
+    (*visits)[state] += count;
+    num_read++;
+  }
+  if (!ki.Stream().eof())
+    KALDI_ERR << "Failure reading state-visit counts from "
+              << PrintableRxfilename(rxfilename);
+  KALDI_LOG << "Read visit counts for " << num_read << " states from "
+            << PrintableRxfilename(rxfilename);
+}
+
+}  // namespace kaldi
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    using namespace fst;
+    typedef StdArc::StateId StateId;
+
+    const char *usage =
+        "Reorder the states of an FST (e.g. HCLG) into BFS order from the\n"
+        "start state, and write the result as a ConstFst.  Within each BFS\n"
+        "level, states are ordered by descending visit count when a profile\n"
+        "is supplied via --state-visits (the format written by\n"
+        "DecoderStats::WriteStateVisits()), so the states the decoder\n"
+        "touches most often end up close together in memory; with\n"
+        "--reorder-arcs (default: true) each state's arcs are also sorted\n"
+        "so the most-visited successors come first.  Note: arc reordering\n"
+        "discards any ilabel- or olabel-sorted property, which the\n"
+        "decoders do not need but composition does.\n"
+        "\n"
+        "Usage: fstreorderstates [options] [<fst-rxfilename> "
+        "[<const-fst-wxfilename>]]\n"
+        " e.g.: fstreorderstates --state-visits=visits.txt HCLG.fst "
+        "HCLG_reord.fst\n";
+
+    ParseOptions po(usage);
+
+    std::string state_visits_rxfilename;
+    bool reorder_arcs = true;
+    po.Register("state-visits", &state_visits_rxfilename, "rxfilename of "
+                "state-visit counts from decoding with DecoderStats "
+                "(one '<state-id> <count>' pair per line); if not given, "
+                "plain BFS order is used.");
+    po.Register("reorder-arcs", &reorder_arcs, "If true, sort each state's "
+                "arcs by descending visit count of their destination "
+                "states (the output is then no longer ilabel-sorted).");
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() > 2) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string fst_rxfilename = po.GetOptArg(1),
+        fst_wxfilename = po.GetOptArg(2);
+
+    VectorFst<StdArc> *fst = ReadFstKaldi(fst_rxfilename);
+    StateId num_states = fst->NumStates();
+    if (num_states == 0 || fst->Start() == kNoStateId)
+      KALDI_ERR << "Empty FST input.";
+
+    std::vector<int64> visits(static_cast<size_t>(num_states), 0);
+    if (state_visits_rxfilename != "")
+      ReadStateVisits(state_visits_rxfilename, &visits);
+
+    // BFS from the start state; within each level, most-visited states
+    // first.  This clusters each level's hot states on adjacent pages,
+    // which matches the decoder's access order (tokens for a frame are
+    // roughly one BFS level further on than the previous frame's).
+    std::vector<StateId> bfs_order;  // old state-ids, in their new order.
+    bfs_order.reserve(num_states);
+    std::vector<bool> queued(static_cast<size_t>(num_states), false);
+    std::vector<StateId> cur_level, next_level;
+    cur_level.push_back(fst->Start());
+    queued[fst->Start()] = true;
+    while (!cur_level.empty()) {
+      std::stable_sort(cur_level.begin(), cur_level.end(),
+                       VisitCountGreater(visits));
+      for (size_t i = 0; i < cur_level.size(); i++) {
+        StateId s = cur_level[i];
+        bfs_order.push_back(s);
+        for (ArcIterator<VectorFst<StdArc> > aiter(*fst, s); !aiter.Done();
+             aiter.Next()) {
+          StateId ns = aiter.Value().nextstate;
+          if (!queued[ns]) {
+            queued[ns] = true;
+            next_level.push_back(ns);
+          }
+        }
+      }
+      cur_level.swap(next_level);
+      next_level.clear();
+    }
+    // States unreachable from the start keep their relative order, at the
+    // end (Connect() would remove them, but that is not this tool's job).
+    size_t num_reachable = bfs_order.size();
+    for (StateId s = 0; s < num_states; s++)
+      if (!queued[s])
+        bfs_order.push_back(s);
+    if (static_cast<StateId>(num_reachable) != num_states)
+      KALDI_WARN << (num_states - num_reachable) << " of " << num_states
+                 << " states are unreachable from the start state.";
+
+    if (reorder_arcs) {
+      ArcDestVisitCountGreater comp(visits);
+      std::vector<StdArc> arcs;
+      for (StateId s = 0; s < num_states; s++) {
+        arcs.clear();
+        for (ArcIterator<VectorFst<StdArc> > aiter(*fst, s); !aiter.Done();
+             aiter.Next())
+          arcs.push_back(aiter.Value());
+        std::stable_sort(arcs.begin(), arcs.end(), comp);
+        MutableArcIterator<VectorFst<StdArc> > maiter(fst, s);
+        for (size_t i = 0; i < arcs.size(); i++, maiter.Next())
+          maiter.SetValue(arcs[i]);  // SetValue() invalidates the sorted
+                                     // properties for us.
+      }
+    }
+
+    // StateSort() wants order[old-id] = new-id.
+    std::vector<StateId> order(static_cast<size_t>(num_states));
+    for (StateId new_id = 0;
+         new_id < static_cast<StateId>(bfs_order.size()); new_id++)
+      order[bfs_order[new_id]] = new_id;
+    StateSort(fst, order);
+
+    // Write as a ConstFst: one contiguous arc array, so consecutive
+    // states' arcs are on the same or adjacent cache lines.
+    ConstFst<StdArc> const_fst(*fst);
+    delete fst;
+    if (fst_wxfilename == "") fst_wxfilename = "-";
+    bool write_binary = true, write_header = false;
+    Output ko(fst_wxfilename, write_binary, write_header);
+    FstWriteOptions wopts(PrintableWxfilename(fst_wxfilename));
+    const_fst.Write(ko.Stream(), wopts);
+
+    KALDI_LOG << "Reordered " << num_states << " states and wrote "
+              << PrintableWxfilename(fst_wxfilename) << " as ConstFst.";
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
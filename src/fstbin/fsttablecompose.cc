@@ -39,6 +39,41 @@
 
 */
 
+// Fills in *data with the precomputed match tables for "match_fst" (the FST
+// on the match side of the composition): either by reading them from
+// "read_table_cache", or, if "write_table_cache" is given, by building them
+// (with "num_threads" threads) and writing them out for later runs.  Returns
+// false if neither option was supplied, i.e. tables should be built lazily.
+static bool GetTableMatcherData(const fst::VectorFst<fst::StdArc> &match_fst,
+                                const fst::TableComposeOptions &opts,
+                                const std::string &read_table_cache,
+                                const std::string &write_table_cache,
+                                kaldi::int32 num_threads,
+                                fst::TableMatcherData<fst::StdArc> *data) {
+  using namespace kaldi;
+  if (read_table_cache != "") {
+    bool binary;
+    Input ki(read_table_cache, &binary);
+    data->Read(ki.Stream(), binary);
+    if (data->match_type != opts.table_match_type)
+      KALDI_ERR << "Table cache " << read_table_cache << " was built with a "
+                << "different --match-side.";
+    if (data->tables.size() != static_cast<size_t>(match_fst.NumStates()))
+      KALDI_ERR << "Table cache " << read_table_cache << " was built from a "
+                << "different FST (" << data->tables.size() << " vs. "
+                << match_fst.NumStates() << " states).";
+    return true;
+  } else if (write_table_cache != "") {
+    BuildTableMatcherData(match_fst, opts.table_match_type, opts,
+                          num_threads, data);
+    Output ko(write_table_cache, true);
+    data->Write(ko.Stream(), true);
+    KALDI_LOG << "Wrote table cache to " << write_table_cache;
+    return true;
+  }
+  return false;
+}
+
 int main(int argc, char *argv[]) {
   try {
     using namespace kaldi;
@@ -68,13 +103,29 @@ int main(int argc, char *argv[]) {
     TableComposeOptions opts;
     std::string match_side = "left";
     std::string compose_filter = "sequence";
+    std::string read_table_cache;
+    std::string write_table_cache;
+    int32 num_threads = 1;
 
     po.Register("connect", &opts.connect, "If true, trim FST before output.");
     po.Register("match-side", &match_side, "Side of composition to do table "
                 "match, one of: \"left\" or \"right\".");
     po.Register("compose-filter", &compose_filter, "Composition filter to use, "
                 "one of: \"alt_sequence\", \"auto\", \"match\", \"sequence\"");
-    
+    po.Register("read-table-cache", &read_table_cache, "If supplied, read "
+                "precomputed match tables for the FST on the match side from "
+                "this file (written by --write-table-cache), skipping table "
+                "construction.  The cache must have been built from the same "
+                "FST with the same --match-side.");
+    po.Register("write-table-cache", &write_table_cache, "If supplied, "
+                "precompute the match tables for the FST on the match side, "
+                "write them to this file for reuse in later runs, and use "
+                "them for this composition.");
+    po.Register("num-threads", &num_threads, "Number of threads to use when "
+                "precomputing match tables (only relevant with "
+                "--write-table-cache).");
+
+
     po.Read(argc, argv);
 
     if (match_side == "left") {
@@ -134,7 +185,14 @@ int main(int argc, char *argv[]) {
       
       VectorFst<StdArc> composed_fst;
 
-      TableCompose(*fst1, *fst2, &composed_fst, opts);
+      TableMatcherData<StdArc> table_data;
+      bool have_table_data = GetTableMatcherData(
+          opts.table_match_type == MATCH_OUTPUT ? *fst1 : *fst2,
+          opts, read_table_cache, write_table_cache, num_threads,
+          &table_data);
+
+      TableCompose(*fst1, *fst2, &composed_fst, opts,
+                   have_table_data ? &table_data : NULL);
 
       delete fst1;
       delete fst2;
@@ -144,8 +202,9 @@ int main(int argc, char *argv[]) {
     } else if (!is_table_1 && is_table_2
                && opts.table_match_type == MATCH_OUTPUT) {
       // second arg is an archive, and match-side=left (default).
+      TableMatcherData<StdArc> table_data;  // must outlive "cache" below.
       TableComposeCache<Fst<StdArc> > cache(opts);
-      VectorFst<StdArc> *fst1 = ReadFstKaldi(fst1_in_str);      
+      VectorFst<StdArc> *fst1 = ReadFstKaldi(fst1_in_str);
       SequentialTableReader<VectorFstHolder> fst2_reader(fst2_in_str);
       TableWriter<VectorFstHolder> fst_writer(fst_out_str);
       int32 n_done = 0;
@@ -154,6 +213,13 @@ int main(int argc, char *argv[]) {
       if (fst1->Properties(fst::kOLabelSorted, true) == 0) {
         KALDI_WARN << "The first FST is not olabel sorted.";
       }
+      if (GetTableMatcherData(*fst1, opts, read_table_cache,
+                              write_table_cache, num_threads, &table_data)) {
+        // Pre-create the cached matcher from the precomputed tables;
+        // TableCompose below will reuse it for every FST in the archive.
+        cache.matcher = new TableMatcher<Fst<StdArc> >(*fst1, MATCH_OUTPUT,
+                                                       opts, &table_data);
+      }
       for (; !fst2_reader.Done(); fst2_reader.Next(), n_done++) {
         VectorFst<StdArc> fst2(fst2_reader.Value());
         VectorFst<StdArc> fst_out;
@@ -163,6 +229,9 @@ int main(int argc, char *argv[]) {
       KALDI_LOG << "Composed " << n_done << " FSTs.";
       return (n_done != 0 ? 0 : 1);
     } else if (is_table_1 && is_table_2) {
+      if (read_table_cache != "" || write_table_cache != "")
+        KALDI_ERR << "Table caching is not supported when both inputs are "
+                  << "archives (there is no single FST to cache tables for).";
       SequentialTableReader<VectorFstHolder> fst1_reader(fst1_in_str);
       RandomAccessTableReader<VectorFstHolder> fst2_reader(fst2_in_str);
       TableWriter<VectorFstHolder> fst_writer(fst_out_str);
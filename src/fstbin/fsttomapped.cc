@@ -0,0 +1,64 @@
+// fstbin/fsttomapped.cc
+
+// Copyright 2014   Johns Hopkins University
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "fst/fstlib.h"
+#include "fstext/kaldi-fst-io.h"
+#include "fstext/mapped-fst.h"
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    using namespace fst;
+
+    const char *usage =
+        "Convert an FST (e.g. HCLG) to the memory-mapped format read by\n"
+        "MappedStdFst; decoders can then mmap the graph for near-instant\n"
+        "startup and a single shared page-cache copy per machine.\n"
+        "The output must be a real file, not a pipe.\n"
+        "\n"
+        "Usage: fsttomapped <fst-rxfilename> <mapped-fst-filename>\n"
+        " e.g.: fsttomapped HCLG.fst HCLG.mfst\n";
+
+    ParseOptions po(usage);
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 2) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string fst_rxfilename = po.GetArg(1),
+        mapped_filename = po.GetArg(2);
+
+    VectorFst<StdArc> *fst = ReadFstKaldi(fst_rxfilename);
+
+    WriteMappedFst(*fst, mapped_filename);
+    delete fst;
+
+    KALDI_LOG << "Wrote " << mapped_filename << " in mapped format.";
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
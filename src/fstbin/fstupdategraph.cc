@@ -0,0 +1,136 @@
+// fstbin/fstupdategraph.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "util/const-integer-set.h"
+#include "fst/fstlib.h"
+#include "fstext/fstext-utils.h"
+#include "fstext/kaldi-fst-io.h"
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    using namespace fst;
+    using kaldi::int32;
+
+    const char *usage =
+        "Incrementally update a decoding graph (e.g. HCLG) for a small\n"
+        "vocabulary change, without recomposing it from scratch.  Words are\n"
+        "identified by the graph's output labels: arcs whose output label is\n"
+        "in --remove-words are deleted (and states that become unreachable\n"
+        "are removed), which excises exactly the paths emitting those words;\n"
+        "a patch graph for added words, compiled with the normal pipeline\n"
+        "over just the new entries and supplied via --add-fst, is then\n"
+        "unioned in at the start state.  To change a word's pronunciation,\n"
+        "list it in --remove-words and include it in the patch.  The result\n"
+        "accepts the updated vocabulary but, unlike a full recomposition,\n"
+        "the patch does not share states with the main graph and the union\n"
+        "start is nondeterministic; the decoders do not mind, but after many\n"
+        "updates a full rebuild will give a somewhat smaller graph.\n"
+        "\n"
+        "Usage: fstupdategraph [options] [in.fst [out.fst]]\n"
+        "E.g.: fstupdategraph --remove-words=stale_words.int \\\n"
+        "  --add-fst=HCLG_patch.fst HCLG.fst HCLG_new.fst\n";
+
+    ParseOptions po(usage);
+    std::string remove_words_rxfilename, add_fst_rxfilename;
+    po.Register("remove-words", &remove_words_rxfilename,
+                "File with a list of word-ids (one per line) whose paths are "
+                "removed from the graph.");
+    po.Register("add-fst", &add_fst_rxfilename,
+                "Patch graph (at the same level as the input graph, e.g. "
+                "HCLG over the added words) to union into the graph.");
+    po.Read(argc, argv);
+
+    if (po.NumArgs() > 2) {
+      po.PrintUsage();
+      exit(1);
+    }
+    if (remove_words_rxfilename == "" && add_fst_rxfilename == "")
+      KALDI_ERR << "At least one of --remove-words and --add-fst must be "
+                << "supplied, or there is nothing to do.";
+
+    std::string fst_rxfilename = po.GetOptArg(1),
+        fst_wxfilename = po.GetOptArg(2);
+
+    VectorFst<StdArc> *fst = ReadFstKaldi(fst_rxfilename);
+    typedef StdArc::StateId StateId;
+
+    if (remove_words_rxfilename != "") {
+      std::vector<int32> remove_words;
+      if (!ReadIntegerVectorSimple(remove_words_rxfilename, &remove_words))
+        KALDI_ERR << "Could not read word list from "
+                  << PrintableRxfilename(remove_words_rxfilename);
+      for (size_t i = 0; i < remove_words.size(); i++)
+        if (remove_words[i] == 0)
+          KALDI_ERR << "Cannot remove word-id zero (epsilon).";
+      ConstIntegerSet<int32> remove_set(remove_words);
+
+      int64 num_arcs_removed = 0;
+      StateId num_states = fst->NumStates();
+      std::vector<StdArc> arcs_kept;
+      for (StateId s = 0; s < num_states; s++) {
+        size_t num_arcs = fst->NumArcs(s);
+        arcs_kept.clear();
+        for (ArcIterator<VectorFst<StdArc> > aiter(*fst, s);
+             !aiter.Done(); aiter.Next())
+          if (!remove_set.count(aiter.Value().olabel))
+            arcs_kept.push_back(aiter.Value());
+        if (arcs_kept.size() != num_arcs) {
+          num_arcs_removed += num_arcs - arcs_kept.size();
+          fst->DeleteArcs(s);
+          for (size_t i = 0; i < arcs_kept.size(); i++)
+            fst->AddArc(s, arcs_kept[i]);
+        }
+      }
+      Connect(fst);  // remove states only reachable via the deleted words.
+      if (num_arcs_removed == 0)
+        KALDI_WARN << "No arcs with the given word-ids were found; does the "
+                   << "list use the graph's word-symbol integers?";
+      KALDI_LOG << "Removed " << num_arcs_removed << " arcs; "
+                << (num_states - fst->NumStates())
+                << " states became unreachable.";
+    }
+
+    if (add_fst_rxfilename != "") {
+      VectorFst<StdArc> *patch_fst = ReadFstKaldi(add_fst_rxfilename);
+      if (patch_fst->Start() == kNoStateId)
+        KALDI_ERR << "Patch graph " << PrintableRxfilename(add_fst_rxfilename)
+                  << " is empty.";
+      StateId num_states = fst->NumStates();
+      Union(fst, *patch_fst);
+      KALDI_LOG << "Unioned in patch graph with " << patch_fst->NumStates()
+                << " states (graph grew from " << num_states << " to "
+                << fst->NumStates() << " states).";
+      delete patch_fst;
+    }
+
+    if (fst->Start() == kNoStateId)
+      KALDI_WARN << "Result of update is the empty graph.";
+
+    WriteFstKaldi(*fst, fst_wxfilename);
+    delete fst;
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
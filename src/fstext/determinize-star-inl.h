@@ -24,6 +24,8 @@
 
 #include "base/kaldi-error.h"
 
+#include <pthread.h>
+
 #ifdef _MSC_VER
 #include <unordered_map>
 using std::unordered_map;
@@ -96,8 +98,10 @@ template<class Label, class StringId> class StringRepository {
     else if (id>=single_symbol_start) {
       v->resize(1); (*v)[0] = id - single_symbol_start;
     } else {
+      if (lock_ != NULL) pthread_mutex_lock(lock_);
       assert(id >= string_start && id < static_cast<StringId>(vec_.size()));
       *v = *(vec_[id]);
+      if (lock_ != NULL) pthread_mutex_unlock(lock_);
     }
   }
   StringId RemovePrefix(StringId id, size_t prefix_len) {
@@ -113,7 +117,14 @@ template<class Label, class StringId> class StringRepository {
     }
   }
 
-  StringRepository() {
+  // If called with a non-NULL lock, accesses to the repository's map and
+  // vector will be serialized with that lock, so it can be shared between
+  // threads (see the parallel mode of DeterminizerStar).  The caller retains
+  // ownership of the lock.  Call with NULL (the default state) for
+  // single-threaded use with no locking overhead.
+  void SetLock(pthread_mutex_t *lock) { lock_ = lock; }
+
+  StringRepository(): lock_(NULL) {
     // The following are really just constants but don't want to complicate compilation so make them
     // class variables.  Due to the brokenness of <limits>, they can't be accessed as constants.
     string_end = (numeric_limits<StringId>::max() / 2) - 1;  // all hash values must be <= this.
@@ -137,21 +148,26 @@ template<class Label, class StringId> class StringRepository {
   DISALLOW_COPY_AND_ASSIGN(StringRepository);
 
   StringId IdOfSeqInternal(const vector<Label> &v) {
+    if (lock_ != NULL) pthread_mutex_lock(lock_);
+    StringId ans;
     typename MapType::iterator iter = map_.find(&v);
     if (iter != map_.end()) {
-      return iter->second;
+      ans = iter->second;
     } else {  // must add it to map.
       StringId this_id = (StringId) vec_.size();
       vector<Label> *v_new = new vector<Label> (v);
       vec_.push_back(v_new);
       map_[v_new] = this_id;
       assert(this_id < string_end);  // or we used up the labels.
-      return this_id;
+      ans = this_id;
     }
+    if (lock_ != NULL) pthread_mutex_unlock(lock_);
+    return ans;
   }
 
   vector<vector<Label>* > vec_;
   MapType map_;
+  pthread_mutex_t *lock_;  // if non-NULL, serializes access (not owned here).
 
   static const StringId string_start = (StringId) 0;  // This must not change.  It's assumed.
   StringId string_end;  // = (numeric_limits<StringId>::max() / 2) - 1; // all hash values must be <= this.
@@ -178,8 +194,15 @@ template<class F> class DeterminizerStar {
 
   // Initializer.  After initializing the object you will typically call
   // Determinize() and then one of the Output functions.
+  // If num_threads > 1, Determinize() will process independent subsets from
+  // the queue with that many worker threads, sharding the subset hash map and
+  // locking the shared string repository; the input FST must then be of an
+  // expanded type such as VectorFst or ConstFst (arc iteration has to be safe
+  // from several threads on a const FST).  The output is the same either way,
+  // up to the numbering of the determinized states.
   DeterminizerStar(const Fst<Arc> &ifst, float delta = kDelta,
-                   int max_states = -1, bool allow_partial = false):
+                   int max_states = -1, bool allow_partial = false,
+                   int num_threads = 1):
       ifst_(ifst.Copy()), delta_(delta), max_states_(max_states),
       determinized_(false), allow_partial_(allow_partial),
       is_partial_(false), equal_(delta),
@@ -187,7 +210,23 @@ template<class F> class DeterminizerStar {
               down_cast<const ExpandedFst<Arc>*,
               const Fst<Arc> >(&ifst)->NumStates()/2 + 3 : 20,
             hasher_, equal_),
-      epsilon_closure_(ifst_, max_states, &repository_, delta) { }
+      num_threads_(num_threads > 1 ? num_threads : 1),
+      num_active_(0), stop_(false), error_(false),
+      epsilon_closure_(ifst_, max_states, &repository_, delta) {
+    pthread_mutex_init(&queue_lock_, NULL);
+    pthread_cond_init(&queue_cond_, NULL);
+    pthread_mutex_init(&repository_lock_, NULL);
+    pthread_mutex_init(&output_lock_, NULL);
+    if (num_threads_ > 1) {
+      hash_shards_.resize(kNumHashShards, NULL);
+      hash_locks_.resize(kNumHashShards);
+      for (int i = 0; i < kNumHashShards; i++) {
+        hash_shards_[i] = new SubsetHash(20, hasher_, equal_);
+        pthread_mutex_init(&(hash_locks_[i]), NULL);
+      }
+      repository_.SetLock(&repository_lock_);
+    }
+  }
 
   void Determinize(bool *debug_ptr) {
     assert(!determinized_);
@@ -205,10 +244,15 @@ template<class F> class DeterminizerStar {
       OutputStateId cur_id = SubsetToStateId(vec);
       assert(cur_id == 0 && "Do not call Determinize twice.");
     }
+    if (num_threads_ > 1) {
+      DeterminizeParallel();  // debug_ptr is not supported in parallel mode.
+      determinized_ = true;
+      return;
+    }
     while (!Q_.empty()) {
       pair<vector<Element>*, OutputStateId> cur_pair = Q_.front();
       Q_.pop_front();
-      ProcessSubset(cur_pair);
+      ProcessSubset(cur_pair, &epsilon_closure_);
       if (debug_ptr && *debug_ptr) Debug();  // will exit.
       if (max_states_ > 0 && output_arcs_.size() > max_states_) {
         if (allow_partial_ == false) {
@@ -242,10 +286,24 @@ template<class F> class DeterminizerStar {
       delete iter->first;
     SubsetHash tmp;
     tmp.swap(hash_);
+    for (size_t i = 0; i < hash_shards_.size(); i++) {
+      if (hash_shards_[i] == NULL) continue;
+      for (typename SubsetHash::iterator iter = hash_shards_[i]->begin();
+          iter != hash_shards_[i]->end(); ++iter)
+        delete iter->first;
+      delete hash_shards_[i];
+      hash_shards_[i] = NULL;
+    }
   }
 
   ~DeterminizerStar() {
     FreeMostMemory();
+    pthread_mutex_destroy(&queue_lock_);
+    pthread_cond_destroy(&queue_cond_);
+    pthread_mutex_destroy(&repository_lock_);
+    pthread_mutex_destroy(&output_lock_);
+    for (size_t i = 0; i < hash_locks_.size(); i++)
+      pthread_mutex_destroy(&(hash_locks_[i]));
   }
  private:
   typedef typename Arc::Label Label;
@@ -472,7 +530,7 @@ template<class F> class DeterminizerStar {
       temp_arc.nextstate = kNoStateId;  // special marker meaning "final weight".
       temp_arc.ostring = final_string;
       temp_arc.weight = final_weight;
-      output_arcs_[state].push_back(temp_arc);
+      GetOutputArcs(state)->push_back(temp_arc);
     }
   }
 
@@ -561,6 +619,7 @@ template<class F> class DeterminizerStar {
   // Side effects on hash_ and Q_, and on output_arcs_ [just affects the size].
   OutputStateId SubsetToStateId(const vector<Element> &subset) {  // may add the subset to the queue.
     typedef typename SubsetHash::iterator IterType;
+    if (num_threads_ > 1) return SubsetToStateIdParallel(subset);
     IterType iter = hash_.find(&subset);
     if (iter == hash_.end()) {  // was not there.
       vector<Element> *new_subset = new vector<Element>(subset);
@@ -585,6 +644,58 @@ template<class F> class DeterminizerStar {
     }
   }
 
+  // Parallel-mode version of SubsetToStateId: the hash is sharded on the
+  // subset's hash value and each shard has its own lock, so threads
+  // processing unrelated subsets rarely contend.  Holding the shard's lock
+  // across find-and-insert keeps the subset-to-state mapping unique.
+  OutputStateId SubsetToStateIdParallel(const vector<Element> &subset) {
+    typedef typename SubsetHash::iterator IterType;
+    size_t shard = hasher_(&subset) % kNumHashShards;
+    pthread_mutex_lock(&(hash_locks_[shard]));
+    SubsetHash &hash = *(hash_shards_[shard]);
+    IterType iter = hash.find(&subset);
+    if (iter != hash.end()) {
+      OutputStateId ans = iter->second;
+      pthread_mutex_unlock(&(hash_locks_[shard]));
+      return ans;
+    }
+    vector<Element> *new_subset = new vector<Element>(subset);
+    OutputStateId new_state_id;
+    {  // Allocate the state id; output_arcs_ is a deque, so elements already
+      // handed out through GetOutputArcs() stay valid as it grows.
+      pthread_mutex_lock(&output_lock_);
+      new_state_id = (OutputStateId) output_arcs_.size();
+      output_arcs_.push_back(vector<TempArc>());
+      pthread_mutex_unlock(&output_lock_);
+    }
+    bool ans = hash.insert(std::pair<const vector<Element>*,
+                                     OutputStateId>(new_subset,
+                                                    new_state_id)).second;
+    assert(ans);
+    pthread_mutex_unlock(&(hash_locks_[shard]));
+    pthread_mutex_lock(&queue_lock_);
+    // Note: the depth-first ordering we use in serial mode when
+    // allow_partial_ is false has no real meaning once several subsets are
+    // in flight, so parallel mode always appends (breadth-first-ish).
+    Q_.push_back(pair<vector<Element>*, OutputStateId>(new_subset, new_state_id));
+    pthread_cond_signal(&queue_cond_);
+    pthread_mutex_unlock(&queue_lock_);
+    return new_state_id;
+  }
+
+  // Returns a pointer to the output-arc vector of the given determinized
+  // state.  In parallel mode the indexing has to be done under output_lock_
+  // because other threads may be appending new states concurrently; the
+  // returned vector itself is only ever written by the thread that is
+  // processing "state", so writing through the pointer needs no lock.
+  vector<TempArc> *GetOutputArcs(OutputStateId state) {
+    if (num_threads_ == 1) return &(output_arcs_[state]);
+    pthread_mutex_lock(&output_lock_);
+    vector<TempArc> *ans = &(output_arcs_[state]);
+    pthread_mutex_unlock(&output_lock_);
+    return ans;
+  }
+
 
   // ProcessSubset does the processing of a determinized state, i.e. it creates
   // transitions out of it and adds new determinized states to the queue if necessary.
@@ -592,12 +703,16 @@ template<class F> class DeterminizerStar {
   // of (states, weights)).  After that we ignore epsilons.  We process the final-weight
   // of the state, and then handle transitions out (this may add more determinized states
   // to the queue).
-  void ProcessSubset(const pair<vector<Element>*, OutputStateId> & pair) {
+  // The epsilon-closure object is passed in because in parallel mode each
+  // worker thread has its own (it contains per-call scratch space); in serial
+  // mode it is just &epsilon_closure_.
+  void ProcessSubset(const pair<vector<Element>*, OutputStateId> & pair,
+                     EpsilonClosure *epsilon_closure) {
     const vector<Element> *subset = pair.first;
     OutputStateId state = pair.second;
 
     vector<Element> closed_subset;  // subset after epsilon closure.
-    epsilon_closure_.GetEpsilonClosure(*subset, &closed_subset);
+    epsilon_closure->GetEpsilonClosure(*subset, &closed_subset);
 
     // Now follow non-epsilon arcs [and also process final states]
     ProcessFinal(closed_subset, state);
@@ -606,12 +721,107 @@ template<class F> class DeterminizerStar {
     ProcessTransitions(closed_subset, state);
   }
 
+  // Entry point of the worker threads in parallel mode.
+  static void *DeterminizeThread(void *ptr) {
+    reinterpret_cast<DeterminizerStar<F>*>(ptr)->WorkerLoop();
+    return NULL;
+  }
+
+  // Spawns num_threads_ workers that pull subsets from the shared queue, and
+  // waits for them to drain it.  Called from Determinize() after the start
+  // state has been queued.  Any exception thrown while processing a subset
+  // (e.g. from a non-functional FST) is recorded by the worker that hit it
+  // and re-thrown here on the calling thread.
+  void DeterminizeParallel() {
+    vector<pthread_t> threads(num_threads_);
+    for (int i = 0; i < num_threads_; i++) {
+      int ret = pthread_create(&(threads[i]), NULL,
+                               &DeterminizerStar<F>::DeterminizeThread, this);
+      if (ret != 0)
+        KALDI_ERR << "DeterminizeStar: error creating thread, errno = " << ret;
+    }
+    for (int i = 0; i < num_threads_; i++) {
+      if (pthread_join(threads[i], NULL) != 0)
+        KALDI_ERR << "DeterminizeStar: error joining thread.";
+    }
+    if (error_)
+      throw std::runtime_error(error_message_);
+  }
+
+  // Main loop of each worker thread.  Workers take one subset at a time from
+  // the shared queue; "num_active_" counts the workers currently processing
+  // one, so an empty queue only means termination once it reaches zero
+  // (a busy worker may still add new subsets).
+  void WorkerLoop() {
+    // Per-thread scratch space for epsilon closure; the string repository it
+    // writes to is shared and internally locked.
+    EpsilonClosure epsilon_closure(ifst_, max_states_, &repository_, delta_);
+    while (true) {
+      pair<vector<Element>*, OutputStateId> cur_pair;
+      pthread_mutex_lock(&queue_lock_);
+      while (Q_.empty() && num_active_ > 0 && !stop_ && !error_)
+        pthread_cond_wait(&queue_cond_, &queue_lock_);
+      if (stop_ || error_ || Q_.empty()) {  // Q_.empty() here implies
+        // num_active_ == 0, i.e. nobody can add more work: we are done.
+        pthread_mutex_unlock(&queue_lock_);
+        return;
+      }
+      cur_pair = Q_.front();
+      Q_.pop_front();
+      num_active_++;
+      pthread_mutex_unlock(&queue_lock_);
+
+      bool processed_ok = true;
+      std::string message;
+      try {
+        ProcessSubset(cur_pair, &epsilon_closure);
+      } catch (const std::runtime_error &e) {
+        processed_ok = false;
+        message = e.what();
+      }
+
+      bool too_many_states = false;
+      if (max_states_ > 0) {
+        pthread_mutex_lock(&output_lock_);
+        too_many_states = (output_arcs_.size() > static_cast<size_t>(max_states_));
+        pthread_mutex_unlock(&output_lock_);
+      }
+
+      pthread_mutex_lock(&queue_lock_);
+      num_active_--;
+      if (!processed_ok && !error_) {
+        error_ = true;
+        error_message_ = message;
+      }
+      if (too_many_states && !stop_ && !error_) {
+        if (allow_partial_ == false) {
+          std::cerr << "Determinization aborted since passed " << max_states_
+                    << " states.\n";
+          error_ = true;
+          error_message_ = "max-states reached in determinization";
+        } else {
+          KALDI_WARN << "Determinization terminated since passed " << max_states_
+                     << " states, partial results will be generated.";
+          is_partial_ = true;
+          stop_ = true;
+        }
+      }
+      if (stop_ || error_ || (num_active_ == 0 && Q_.empty()))
+        pthread_cond_broadcast(&queue_cond_);  // wake everyone up to exit.
+      pthread_mutex_unlock(&queue_lock_);
+    }
+  }
+
   void Debug();
 
   DISALLOW_COPY_AND_ASSIGN(DeterminizerStar);
   deque<pair<vector<Element>*, OutputStateId> > Q_;  // queue of subsets to be processed.
+  // In parallel mode Q_ is guarded by queue_lock_.
 
-  vector<vector<TempArc> > output_arcs_;  // essentially an FST in our format.
+  deque<vector<TempArc> > output_arcs_;  // essentially an FST in our format.
+  // This is a deque rather than a vector so that in parallel mode, pointers
+  // to its elements (see GetOutputArcs()) stay valid while other threads
+  // append new states; its size is guarded by output_lock_.
 
   const Fst<Arc> *ifst_;
   float delta_;
@@ -621,7 +831,24 @@ template<class F> class DeterminizerStar {
   bool is_partial_;     // if we get partial results or not
   SubsetKey hasher_;  // object that computes keys-- has no data members.
   SubsetEqual equal_;  // object that compares subsets-- only data member is delta_.
-  SubsetHash hash_;  // hash from Subset to StateId in final Fst.
+  SubsetHash hash_;  // hash from Subset to StateId in final Fst. [serial mode]
+
+  // Members below (down to error_message_) are for the parallel mode; see
+  // the constructor and WorkerLoop() for how they are used.
+  static const int kNumHashShards = 61;  // prime, for better spread of shards.
+  int num_threads_;  // 1 means the old serial algorithm, with no locking.
+  vector<SubsetHash*> hash_shards_;  // replaces hash_ in parallel mode;
+  // shard chosen by subset hash value.
+  vector<pthread_mutex_t> hash_locks_;  // one lock per shard.
+  pthread_mutex_t queue_lock_;  // guards Q_, num_active_, stop_, error_,
+  // error_message_.
+  pthread_cond_t queue_cond_;  // signalled when work arrives or we are done.
+  pthread_mutex_t repository_lock_;  // serializes the shared repository_.
+  pthread_mutex_t output_lock_;  // guards the size of output_arcs_.
+  int num_active_;  // number of workers currently processing a subset.
+  bool stop_;  // set on early termination with partial output.
+  bool error_;  // set when a worker caught an exception; see error_message_.
+  std::string error_message_;
 
   StringRepository<Label, StringId> repository_;  // associate integer id's with sequences of labels.
   EpsilonClosure epsilon_closure_;
@@ -631,11 +858,12 @@ template<class F> class DeterminizerStar {
 template<class F>
 bool DeterminizeStar(F &ifst, MutableFst<typename F::Arc> *ofst,
                      float delta, bool *debug_ptr, int max_states,
-                     bool allow_partial) {
+                     bool allow_partial, int num_threads) {
   typedef typename F::Arc Arc;
   ofst->SetOutputSymbols(ifst.OutputSymbols());
   ofst->SetInputSymbols(ifst.InputSymbols());
-  DeterminizerStar<F> det(ifst, delta, max_states, allow_partial);
+  DeterminizerStar<F> det(ifst, delta, max_states, allow_partial,
+                          num_threads);
   det.Determinize(debug_ptr);
   det.Output(ofst);
   return det.IsPartial();
@@ -646,11 +874,12 @@ template<class F>
 bool DeterminizeStar(F &ifst,
                      MutableFst<GallicArc<typename F::Arc> > *ofst, float delta,
                      bool *debug_ptr, int max_states,
-                     bool allow_partial) {
+                     bool allow_partial, int num_threads) {
   typedef typename F::Arc Arc;
   ofst->SetOutputSymbols(ifst.InputSymbols());
   ofst->SetInputSymbols(ifst.InputSymbols());
-  DeterminizerStar<F> det(ifst, delta, max_states, allow_partial);
+  DeterminizerStar<F> det(ifst, delta, max_states, allow_partial,
+                          num_threads);
   det.Determinize(debug_ptr);
   det.Output(ofst);
   return det.IsPartial();
@@ -916,7 +1145,7 @@ void DeterminizerStar<F>::Output(MutableFst<GallicArc<Arc> > *ofst,
     // Free up memory.  Do this inside the loop as ofst is also allocating memory
     if (destroy) { vector<TempArc> temp; temp.swap(this_vec); }
   }
-  if (destroy) { vector<vector<TempArc> > temp; temp.swap(output_arcs_); }
+  if (destroy) { deque<vector<TempArc> > temp; temp.swap(output_arcs_); }
 }
 
 template<class F>
@@ -990,7 +1219,7 @@ void DeterminizerStar<F>::Output(MutableFst<Arc> *ofst, bool destroy) {
     if (destroy) { vector<TempArc> temp; temp.swap(this_vec); }
   }
   if (destroy) {
-    vector<vector<TempArc> > temp;
+    deque<vector<TempArc> > temp;
     temp.swap(output_arcs_);
     repository_.Destroy();
   }
@@ -1073,7 +1302,7 @@ ProcessTransition(OutputStateId state, Label ilabel, vector<Element> *subset) {
   temp_arc.nextstate = SubsetToStateId(*subset);  // may or may not really add the subset.
   temp_arc.ostring = common_str;
   temp_arc.weight = tot_weight;
-  output_arcs_[state].push_back(temp_arc);  // record the arc.
+  GetOutputArcs(state)->push_back(temp_arc);  // record the arc.
 }
 
 template<class F>
@@ -65,6 +65,40 @@ template<class Arc> void TestDeterminizeGeneral() {
 }
 
 
+// Tests the parallel mode: determinize with several threads and check the
+// result is equivalent to the input (and to the serial result).
+template<class Arc> void TestDeterminizeParallel() {
+  int max_states = 100; // don't allow more det-states than this.
+  for(int i = 0; i < 20; i++) {
+    VectorFst<Arc> *fst = RandFst<Arc>();
+    int num_threads = 2 + kaldi::Rand() % 3;
+    VectorFst<Arc> ofst, ofst_serial;
+    bool parallel_ok = true, serial_ok = true;
+    try {
+      DeterminizeStar<Fst<Arc> >(*fst, &ofst, kDelta, NULL, max_states,
+                                 false, num_threads);
+    } catch (...) {
+      parallel_ok = false;
+    }
+    try {
+      DeterminizeStar<Fst<Arc> >(*fst, &ofst_serial, kDelta, NULL, max_states);
+    } catch (...) {
+      serial_ok = false;
+    }
+    // Note: we cannot insist that parallel_ok == serial_ok, because with the
+    // max-states limit the two may visit different numbers of states before
+    // aborting; but when both succeed, the results must be equivalent.
+    if (parallel_ok && serial_ok) {
+      assert(RandEquivalent(*fst, ofst, 5/*paths*/, 0.01/*delta*/, kaldi::Rand()/*seed*/, 100/*path length, max*/));
+      assert(RandEquivalent(ofst, ofst_serial, 5/*paths*/, 0.01/*delta*/, kaldi::Rand()/*seed*/, 100/*path length, max*/));
+    } else {
+      std::cout << "Failed to determinize this FST (probably not determinizable)\n";
+    }
+    delete fst;
+  }
+}
+
+
 // Don't instantiate with log semiring, as RandEquivalent may fail.
 template<class Arc>  void TestDeterminize() {
   typedef typename Arc::Label Label;
@@ -601,6 +635,7 @@ int main() {
     fst::TestStringRepository<fst::StdArc, unsigned char>();
     fst::TestStringRepository<fst::StdArc, char>();
     fst::TestDeterminizeGeneral<fst::StdArc>();
+    fst::TestDeterminizeParallel<fst::StdArc>();
     fst::TestDeterminize<fst::StdArc>();
     // fst::TestDeterminize2<fst::StdArc>();
     fst::TestPush<fst::StdArc>();
@@ -80,6 +80,10 @@ namespace fst {
     If allow_partial is true, the algorithm will output partial results when the
     specified max_states is reached (when larger than zero), instead of throwing
     out an error.
+    If num_threads is greater than one, independent subsets from the queue are
+    processed by that many worker threads; the result is the same up to the
+    numbering of the determinized states, but debug_ptr is ignored, and ifst
+    must be of an expanded type such as VectorFst or ConstFst.
     The function will return false if partial FST is generated, and true if the
     complete determinized FST is generated.
 */
@@ -88,7 +92,8 @@ bool DeterminizeStar(F &ifst, MutableFst<typename F::Arc> *ofst,
                      float delta = kDelta,
                      bool *debug_ptr = NULL,
                      int max_states = -1,
-                     bool allow_partial = false);
+                     bool allow_partial = false,
+                     int num_threads = 1);
 
 
 
@@ -100,6 +105,7 @@ bool DeterminizeStar(F &ifst, MutableFst<typename F::Arc> *ofst,
     If allow_partial is true, the algorithm will output partial results when the
     specified max_states is reached (when larger than zero), instead of throwing
     out an error.
+    num_threads has the same meaning as in the version above.
     The function will return false if partial FST is generated, and true if the
     complete determinized FST is generated.
 */
@@ -107,7 +113,8 @@ template<class F>
 bool DeterminizeStar(F &ifst, MutableFst<GallicArc<typename F::Arc> > *ofst,
                      float delta = kDelta, bool *debug_ptr = NULL,
                      int max_states = -1,
-                     bool allow_partial = false);
+                     bool allow_partial = false,
+                     int num_threads = 1);
 
 
 /// @} end "addtogroup fst_extensions"
@@ -87,7 +87,7 @@ class VectorFstTplHolder {
   // them.
   static bool IsReadInBinary() { return true; }
 
-  const T &Value() {
+  T &Value() {
     // code error if !t_.
     if (!t_) KALDI_ERR << "VectorFstTplHolder::Value() called wrongly.";
     return *t_;
@@ -0,0 +1,573 @@
+// fstext/mapped-fst.cc
+
+// Copyright 2014   Johns Hopkins University
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "fstext/mapped-fst.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fst {
+
+static const char *kMappedFstMagic = "KldMapF1";
+
+void WriteMappedFst(const Fst<StdArc> &fst, const std::string &filename) {
+  typedef StdArc Arc;
+  typedef Arc::StateId StateId;
+  KALDI_COMPILE_TIME_ASSERT(sizeof(MappedFstHeader) == 48);
+  KALDI_COMPILE_TIME_ASSERT(sizeof(MappedFstState) == 16);
+  if (filename == "" || filename == "-")
+    KALDI_ERR << "WriteMappedFst: the mapped format requires a real "
+        "filename (the file will be mmap'd), not a pipe or stdout.";
+
+  // First pass: find num-states (as max state-id plus one, in case the
+  // state ids are not contiguous) and the total number of arcs.
+  StateId num_states = 0;
+  kaldi::int64 num_arcs = 0;
+  for (StateIterator<Fst<Arc> > siter(fst); !siter.Done(); siter.Next()) {
+    StateId s = siter.Value();
+    if (s + 1 > num_states) num_states = s + 1;
+    num_arcs += fst.NumArcs(s);
+  }
+
+  MappedFstHeader hdr;
+  std::memset(&hdr, 0, sizeof(hdr));
+  std::memcpy(hdr.magic, kMappedFstMagic, 8);
+  hdr.arc_size = static_cast<kaldi::int32>(sizeof(Arc));
+  hdr.start = fst.Start();
+  hdr.num_states = num_states;
+  hdr.num_arcs = num_arcs;
+  hdr.properties = fst.Properties(kFstProperties, true) & ~kError;
+
+  std::ofstream os(filename.c_str(),
+                   std::ios_base::out | std::ios_base::binary);
+  if (!os.is_open())
+    KALDI_ERR << "WriteMappedFst: failed to open " << filename
+              << " for writing.";
+  os.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+
+  // Second pass: the per-state table.  Unused state ids (possible if the
+  // ids are not contiguous) get zero arcs and Zero() final-weight.
+  MappedFstState dead_state;
+  dead_state.final = Arc::Weight::Zero().Value();
+  dead_state.num_arcs = 0;
+  dead_state.first_arc = 0;
+  kaldi::int64 arc_pos = 0;
+  StateId next_state = 0;
+  for (StateIterator<Fst<Arc> > siter(fst); !siter.Done(); siter.Next()) {
+    StateId s = siter.Value();
+    KALDI_ASSERT(s >= next_state && "WriteMappedFst requires the state "
+                 "iterator to visit states in increasing order.");
+    for (; next_state < s; next_state++)
+      os.write(reinterpret_cast<const char*>(&dead_state),
+               sizeof(dead_state));
+    MappedFstState state;
+    state.final = fst.Final(s).Value();
+    state.num_arcs = fst.NumArcs(s);
+    state.first_arc = arc_pos;
+    arc_pos += state.num_arcs;
+    os.write(reinterpret_cast<const char*>(&state), sizeof(state));
+    next_state = s + 1;
+  }
+  KALDI_ASSERT(next_state == num_states && arc_pos == num_arcs);
+
+  // Third pass: the arcs themselves, written per state in contiguous
+  // blocks so they can be served straight out of the mapping.
+  std::vector<Arc> buf;
+  for (StateIterator<Fst<Arc> > siter(fst); !siter.Done(); siter.Next()) {
+    StateId s = siter.Value();
+    buf.clear();
+    for (ArcIterator<Fst<Arc> > aiter(fst, s); !aiter.Done(); aiter.Next())
+      buf.push_back(aiter.Value());
+    if (!buf.empty())
+      os.write(reinterpret_cast<const char*>(&(buf[0])),
+               buf.size() * sizeof(Arc));
+  }
+  os.flush();
+  if (os.fail())
+    KALDI_ERR << "WriteMappedFst: error writing to " << filename;
+  KALDI_VLOG(1) << "WriteMappedFst: wrote " << num_states << " states and "
+                << num_arcs << " arcs to " << filename;
+}
+
+#ifndef _MSC_VER
+
+MappedStdFst::MappedStdFst(const std::string &filename):
+    filename_(filename), map_(NULL), map_size_(0) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    KALDI_ERR << "MappedStdFst: failed to open " << filename;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) <
+      sizeof(MappedFstHeader)) {
+    close(fd);
+    KALDI_ERR << "MappedStdFst: " << filename
+              << " is not a mapped-FST file (too small, or stat failed).";
+  }
+  map_size_ = st.st_size;
+  map_ = mmap(NULL, map_size_, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);  // the mapping keeps its own reference to the file.
+  if (map_ == MAP_FAILED) {
+    map_ = NULL;
+    KALDI_ERR << "MappedStdFst: mmap of " << filename << " failed.";
+  }
+  header_ = reinterpret_cast<const MappedFstHeader*>(map_);
+  if (std::memcmp(header_->magic, kMappedFstMagic, 8) != 0)
+    KALDI_ERR << "MappedStdFst: " << filename
+              << " does not look like a mapped-FST file (bad magic).";
+  if (header_->arc_size != static_cast<kaldi::int32>(sizeof(Arc)))
+    KALDI_ERR << "MappedStdFst: " << filename << " was written with "
+              << "sizeof(arc) = " << header_->arc_size << " vs. "
+              << sizeof(Arc) << " here; it was probably written on an "
+              << "incompatible architecture (regenerate it with fsttomapped).";
+  size_t expected_size = sizeof(MappedFstHeader)
+      + header_->num_states * sizeof(MappedFstState)
+      + header_->num_arcs * sizeof(Arc);
+  if (map_size_ != expected_size)
+    KALDI_ERR << "MappedStdFst: " << filename << " has size " << map_size_
+              << " vs. expected " << expected_size << " (truncated file?)";
+  states_ = reinterpret_cast<const MappedFstState*>(
+      static_cast<const char*>(map_) + sizeof(MappedFstHeader));
+  arcs_ = reinterpret_cast<const Arc*>(states_ + header_->num_states);
+}
+
+MappedStdFst::~MappedStdFst() {
+  if (map_ != NULL)
+    munmap(map_, map_size_);
+}
+
+void MappedStdFst::PrefetchStates(const std::vector<StateId> &states) const {
+  if (states.empty()) return;
+  long page_size = sysconf(_SC_PAGESIZE);
+  const char *base = static_cast<const char*>(map_);
+  // Collect the page ranges holding the arcs of the given states, and merge
+  // adjacent/overlapping ranges so we issue one madvise() per run of pages
+  // rather than one per state.
+  std::vector<std::pair<size_t, size_t> > ranges;  // [first_page, end_page)
+  ranges.reserve(states.size());
+  for (size_t i = 0; i < states.size(); i++) {
+    StateId s = states[i];
+    KALDI_PARANOID_ASSERT(s >= 0 && s < header_->num_states);
+    if (states_[s].num_arcs == 0) continue;
+    const char *begin = reinterpret_cast<const char*>(
+        arcs_ + states_[s].first_arc),
+        *end = reinterpret_cast<const char*>(
+            arcs_ + states_[s].first_arc + states_[s].num_arcs);
+    ranges.push_back(std::make_pair((begin - base) / page_size,
+                                    (end - base) / page_size + 1));
+  }
+  if (ranges.empty()) return;
+  std::sort(ranges.begin(), ranges.end());
+  size_t first = ranges[0].first, end = ranges[0].second;
+  for (size_t i = 1; i <= ranges.size(); i++) {
+    if (i < ranges.size() && ranges[i].first <= end) {
+      end = std::max(end, ranges[i].second);
+    } else {
+      // madvise is advisory; if the kernel refuses there is nothing useful
+      // to do about it, so we ignore the return value.
+      madvise(const_cast<char*>(base) + first * page_size,
+              (end - first) * page_size, MADV_WILLNEED);
+      if (i < ranges.size()) {
+        first = ranges[i].first;
+        end = ranges[i].second;
+      }
+    }
+  }
+}
+
+#else  // _MSC_VER
+
+MappedStdFst::MappedStdFst(const std::string &filename):
+    filename_(filename), map_(NULL), map_size_(0) {
+  KALDI_ERR << "MappedStdFst is not supported on Windows.";
+}
+
+MappedStdFst::~MappedStdFst() { }
+
+void MappedStdFst::PrefetchStates(const std::vector<StateId> &states) const { }
+
+#endif  // _MSC_VER
+
+// The arc iterator of DiskBackedStdFst: pins the partition holding the
+// state's arcs for its own lifetime, so eviction can never pull the arcs
+// out from under it.
+class DiskBackedArcIterator : public ArcIteratorBase<StdArc> {
+ public:
+  typedef StdArc Arc;
+  typedef Arc::StateId StateId;
+
+  DiskBackedArcIterator(const DiskBackedStdFst *fst, StateId s):
+      fst_(fst), partition_(s / DiskBackedStdFst::kStatesPerPartition),
+      i_(0) {
+    arcs_ = fst_->PinState(s, &narcs_);
+  }
+
+  virtual ~DiskBackedArcIterator() {
+    if (arcs_ != NULL) fst_->UnpinPartition(partition_);
+  }
+
+  virtual bool Done() const { return i_ >= narcs_; }
+  virtual const Arc &Value() const { return arcs_[i_]; }
+  virtual void Next() { ++i_; }
+  virtual size_t Position() const { return i_; }
+  virtual void Reset() { i_ = 0; }
+  virtual void Seek(size_t a) { i_ = a; }
+  virtual uint32 Flags() const { return kArcValueFlags | kArcNoCache; }
+  virtual void SetFlags(uint32 flags, uint32 mask) { }
+
+ private:
+  const DiskBackedStdFst *fst_;
+  int partition_;
+  const Arc *arcs_;  // the state's arcs, inside the pinned partition.
+  size_t narcs_;
+  size_t i_;
+};
+
+void DiskBackedStdFst::InitArcIterator(StateId s,
+                                       ArcIteratorData<Arc> *data) const {
+  KALDI_PARANOID_ASSERT(s >= 0 && s < header_.num_states);
+  data->base = new DiskBackedArcIterator(this, s);
+}
+
+#ifndef _MSC_VER
+
+// Reads exactly "count" bytes at "offset"; returns false on error or short
+// read.  pread() keeps no file position, so concurrent readers are fine.
+static bool FullPread(int fd, void *buf, size_t count, kaldi::int64 offset) {
+  char *p = static_cast<char*>(buf);
+  while (count > 0) {
+    ssize_t ret = pread(fd, p, count, offset);
+    if (ret <= 0) return false;
+    p += ret;
+    offset += ret;
+    count -= ret;
+  }
+  return true;
+}
+
+DiskBackedStdFst::DiskBackedStdFst(const std::string &filename,
+                                   size_t cache_bytes):
+    filename_(filename), cache_bytes_(cache_bytes), fd_(-1),
+    cache_bytes_used_(0), prefetch_thread_started_(false),
+    prefetch_shutdown_(false) {
+  fd_ = open(filename.c_str(), O_RDONLY);
+  if (fd_ < 0)
+    KALDI_ERR << "DiskBackedStdFst: failed to open " << filename;
+  if (!FullPread(fd_, &header_, sizeof(header_), 0))
+    KALDI_ERR << "DiskBackedStdFst: failed reading header of " << filename;
+  if (std::memcmp(header_.magic, kMappedFstMagic, 8) != 0)
+    KALDI_ERR << "DiskBackedStdFst: " << filename
+              << " does not look like a mapped-FST file (bad magic).";
+  if (header_.arc_size != static_cast<kaldi::int32>(sizeof(Arc)))
+    KALDI_ERR << "DiskBackedStdFst: " << filename << " was written with "
+              << "sizeof(arc) = " << header_.arc_size << " vs. "
+              << sizeof(Arc) << " here; it was probably written on an "
+              << "incompatible architecture (regenerate it with fsttomapped).";
+  states_.resize(header_.num_states);
+  if (header_.num_states > 0 &&
+      !FullPread(fd_, &(states_[0]),
+                 header_.num_states * sizeof(MappedFstState),
+                 sizeof(MappedFstHeader)))
+    KALDI_ERR << "DiskBackedStdFst: failed reading the state table of "
+              << filename << " (truncated file?)";
+  arcs_offset_ = sizeof(MappedFstHeader)
+      + header_.num_states * sizeof(MappedFstState);
+  // Unused state-ids are stored with first_arc = 0; patch them up so that
+  // first_arc is monotone, which PartitionFirstArc/PartitionEndArc rely on.
+  kaldi::int64 arc_pos = 0;
+  for (StateId s = 0; s < header_.num_states; s++) {
+    if (states_[s].num_arcs == 0) states_[s].first_arc = arc_pos;
+    else KALDI_ASSERT(states_[s].first_arc == arc_pos);
+    arc_pos += states_[s].num_arcs;
+  }
+  KALDI_ASSERT(arc_pos == header_.num_arcs);
+  num_partitions_ = (header_.num_states + kStatesPerPartition - 1)
+      / kStatesPerPartition;
+  partitions_.resize(num_partitions_);
+  pthread_mutex_init(&cache_lock_, NULL);
+  pthread_mutex_init(&prefetch_lock_, NULL);
+  pthread_cond_init(&prefetch_cond_, NULL);
+}
+
+DiskBackedStdFst::~DiskBackedStdFst() {
+  pthread_mutex_lock(&prefetch_lock_);
+  prefetch_shutdown_ = true;
+  pthread_cond_signal(&prefetch_cond_);
+  bool must_join = prefetch_thread_started_;
+  pthread_mutex_unlock(&prefetch_lock_);
+  if (must_join)
+    pthread_join(prefetch_thread_, NULL);
+  pthread_cond_destroy(&prefetch_cond_);
+  pthread_mutex_destroy(&prefetch_lock_);
+  for (int p = 0; p < num_partitions_; p++) {
+    KALDI_ASSERT(partitions_[p].pins == 0 &&
+                 "Arc iterator outlived its DiskBackedStdFst.");
+    if (partitions_[p].arcs != NULL) std::free(partitions_[p].arcs);
+  }
+  pthread_mutex_destroy(&cache_lock_);
+  if (fd_ >= 0) close(fd_);
+}
+
+kaldi::int64 DiskBackedStdFst::PartitionFirstArc(int p) const {
+  return states_[static_cast<StateId>(p) * kStatesPerPartition].first_arc;
+}
+
+kaldi::int64 DiskBackedStdFst::PartitionEndArc(int p) const {
+  StateId last = std::min<kaldi::int64>(
+      static_cast<kaldi::int64>(p + 1) * kStatesPerPartition,
+      header_.num_states) - 1;
+  return states_[last].first_arc + states_[last].num_arcs;
+}
+
+void DiskBackedStdFst::LoadPartitionLocked(int p) const {
+  Partition &part = partitions_[p];
+  KALDI_ASSERT(part.arcs == NULL);
+  kaldi::int64 begin = PartitionFirstArc(p), end = PartitionEndArc(p);
+  size_t bytes = (end - begin) * sizeof(Arc);
+  part.arcs = static_cast<Arc*>(std::malloc(bytes > 0 ? bytes : 1));
+  if (part.arcs == NULL)
+    KALDI_ERR << "DiskBackedStdFst: failed to allocate " << bytes
+              << " bytes for a partition (cache size too large?)";
+  if (bytes > 0 &&
+      !FullPread(fd_, part.arcs, bytes,
+                 arcs_offset_ + begin * sizeof(Arc))) {
+    std::free(part.arcs);
+    part.arcs = NULL;
+    KALDI_ERR << "DiskBackedStdFst: failed reading arcs from " << filename_;
+  }
+  cache_bytes_used_ += bytes;
+  lru_.push_front(p);
+  part.lru_pos = lru_.begin();
+  EvictAsNeededLocked(p);
+}
+
+void DiskBackedStdFst::EvictAsNeededLocked(int protected_partition) const {
+  // Walks the LRU list from the cold end, freeing unpinned partitions until
+  // we are back under budget.  If everything left is pinned we go over
+  // budget rather than fail; the pins bound this by the number of live arc
+  // iterators.
+  std::list<int>::iterator iter = lru_.end();
+  while (cache_bytes_used_ > cache_bytes_ && iter != lru_.begin()) {
+    --iter;
+    int p = *iter;
+    if (p == protected_partition || partitions_[p].pins > 0) continue;
+    Partition &part = partitions_[p];
+    cache_bytes_used_ -=
+        (PartitionEndArc(p) - PartitionFirstArc(p)) * sizeof(Arc);
+    std::free(part.arcs);
+    part.arcs = NULL;
+    iter = lru_.erase(iter);  // returns the next-colder position.
+  }
+}
+
+const StdArc *DiskBackedStdFst::PinState(StateId s, size_t *num_arcs) const {
+  KALDI_PARANOID_ASSERT(s >= 0 && s < header_.num_states);
+  *num_arcs = states_[s].num_arcs;
+  if (*num_arcs == 0) return NULL;  // nothing to read or pin.
+  int p = s / kStatesPerPartition;
+  pthread_mutex_lock(&cache_lock_);
+  Partition &part = partitions_[p];
+  if (part.arcs == NULL) {
+    LoadPartitionLocked(p);
+  } else {  // move to the hot end of the LRU list.
+    lru_.erase(part.lru_pos);
+    lru_.push_front(p);
+    part.lru_pos = lru_.begin();
+  }
+  part.pins++;
+  const Arc *ans = part.arcs + (states_[s].first_arc - PartitionFirstArc(p));
+  pthread_mutex_unlock(&cache_lock_);
+  return ans;
+}
+
+void DiskBackedStdFst::UnpinPartition(int p) const {
+  pthread_mutex_lock(&cache_lock_);
+  KALDI_PARANOID_ASSERT(partitions_[p].pins > 0);
+  partitions_[p].pins--;
+  pthread_mutex_unlock(&cache_lock_);
+}
+
+void DiskBackedStdFst::PrefetchStates(
+    const std::vector<StateId> &states) const {
+  // Map the states to partition-ids and deduplicate; the set of partitions
+  // is typically far smaller than the set of states.
+  std::vector<int> partitions;
+  partitions.reserve(states.size());
+  for (size_t i = 0; i < states.size(); i++) {
+    KALDI_PARANOID_ASSERT(states[i] >= 0 &&
+                          states[i] < header_.num_states);
+    partitions.push_back(states[i] / kStatesPerPartition);
+  }
+  std::sort(partitions.begin(), partitions.end());
+  partitions.erase(std::unique(partitions.begin(), partitions.end()),
+                   partitions.end());
+  pthread_mutex_lock(&prefetch_lock_);
+  if (!prefetch_thread_started_) {
+    int ret = pthread_create(&prefetch_thread_, NULL,
+                             &DiskBackedStdFst::PrefetchThread,
+                             const_cast<DiskBackedStdFst*>(this));
+    if (ret != 0) {  // just do without prefetching; it's only advisory.
+      KALDI_WARN << "DiskBackedStdFst: could not create prefetch thread.";
+      pthread_mutex_unlock(&prefetch_lock_);
+      return;
+    }
+    prefetch_thread_started_ = true;
+  }
+  // Replace, rather than append to, whatever is left of the previous
+  // request: it described an older frame's active set, which is stale now.
+  prefetch_queue_.swap(partitions);
+  pthread_cond_signal(&prefetch_cond_);
+  pthread_mutex_unlock(&prefetch_lock_);
+}
+
+// static
+void *DiskBackedStdFst::PrefetchThread(void *arg) {
+  DiskBackedStdFst *self = static_cast<DiskBackedStdFst*>(arg);
+  pthread_mutex_lock(&self->prefetch_lock_);
+  while (true) {
+    while (self->prefetch_queue_.empty() && !self->prefetch_shutdown_)
+      pthread_cond_wait(&self->prefetch_cond_, &self->prefetch_lock_);
+    if (self->prefetch_shutdown_) break;
+    int p = self->prefetch_queue_.back();
+    self->prefetch_queue_.pop_back();
+    // Drop the lock while doing the read, so that a new PrefetchStates()
+    // call (or the shutdown) does not have to wait for the disk.
+    pthread_mutex_unlock(&self->prefetch_lock_);
+    self->PrefetchPartition(p);
+    pthread_mutex_lock(&self->prefetch_lock_);
+  }
+  pthread_mutex_unlock(&self->prefetch_lock_);
+  return NULL;
+}
+
+void DiskBackedStdFst::PrefetchPartition(int p) const {
+  pthread_mutex_lock(&cache_lock_);
+  if (partitions_[p].arcs != NULL) {  // already resident; nothing to do.
+    pthread_mutex_unlock(&cache_lock_);
+    return;
+  }
+  kaldi::int64 begin = PartitionFirstArc(p), end = PartitionEndArc(p);
+  pthread_mutex_unlock(&cache_lock_);
+  size_t bytes = (end - begin) * sizeof(Arc);
+  if (bytes == 0) return;
+  // Unlike LoadPartitionLocked(), we read without holding cache_lock_, so
+  // that the decoder thread is never blocked behind a speculative read.
+  Arc *arcs = static_cast<Arc*>(std::malloc(bytes));
+  if (arcs == NULL) return;  // prefetching is best-effort; just give up.
+  if (!FullPread(fd_, arcs, bytes, arcs_offset_ + begin * sizeof(Arc))) {
+    std::free(arcs);
+    return;
+  }
+  pthread_mutex_lock(&cache_lock_);
+  Partition &part = partitions_[p];
+  if (part.arcs != NULL) {  // the decoder loaded it while we were reading.
+    std::free(arcs);
+  } else {
+    part.arcs = arcs;
+    cache_bytes_used_ += bytes;
+    lru_.push_front(p);
+    part.lru_pos = lru_.begin();
+    EvictAsNeededLocked(p);
+  }
+  pthread_mutex_unlock(&cache_lock_);
+}
+
+#else  // _MSC_VER
+
+DiskBackedStdFst::DiskBackedStdFst(const std::string &filename,
+                                   size_t cache_bytes):
+    filename_(filename), cache_bytes_(cache_bytes), fd_(-1),
+    cache_bytes_used_(0) {
+  KALDI_ERR << "DiskBackedStdFst is not supported on Windows.";
+}
+
+DiskBackedStdFst::~DiskBackedStdFst() { }
+
+kaldi::int64 DiskBackedStdFst::PartitionFirstArc(int p) const { return 0; }
+
+kaldi::int64 DiskBackedStdFst::PartitionEndArc(int p) const { return 0; }
+
+void DiskBackedStdFst::LoadPartitionLocked(int p) const { }
+
+void DiskBackedStdFst::EvictAsNeededLocked(int protected_partition) const { }
+
+const StdArc *DiskBackedStdFst::PinState(StateId s, size_t *num_arcs) const {
+  *num_arcs = 0;
+  return NULL;
+}
+
+void DiskBackedStdFst::UnpinPartition(int p) const { }
+
+void DiskBackedStdFst::PrefetchStates(
+    const std::vector<StateId> &states) const { }
+
+void *DiskBackedStdFst::PrefetchThread(void *arg) { return NULL; }
+
+void DiskBackedStdFst::PrefetchPartition(int p) const { }
+
+#endif  // _MSC_VER
+
+size_t DiskBackedStdFst::NumInputEpsilons(StateId s) const {
+  // Not stored in the file; this is rarely called, so we just count.
+  size_t num_arcs, ans = 0;
+  const Arc *arcs = PinState(s, &num_arcs);
+  for (size_t i = 0; i < num_arcs; i++)
+    if (arcs[i].ilabel == 0) ans++;
+  if (arcs != NULL) UnpinPartition(s / kStatesPerPartition);
+  return ans;
+}
+
+size_t DiskBackedStdFst::NumOutputEpsilons(StateId s) const {
+  size_t num_arcs, ans = 0;
+  const Arc *arcs = PinState(s, &num_arcs);
+  for (size_t i = 0; i < num_arcs; i++)
+    if (arcs[i].olabel == 0) ans++;
+  if (arcs != NULL) UnpinPartition(s / kStatesPerPartition);
+  return ans;
+}
+
+size_t MappedStdFst::NumInputEpsilons(StateId s) const {
+  // Not stored in the file; this is rarely called, so we just count.
+  KALDI_PARANOID_ASSERT(s >= 0 && s < header_->num_states);
+  const Arc *arcs = arcs_ + states_[s].first_arc;
+  size_t ans = 0;
+  for (kaldi::int32 i = 0; i < states_[s].num_arcs; i++)
+    if (arcs[i].ilabel == 0) ans++;
+  return ans;
+}
+
+size_t MappedStdFst::NumOutputEpsilons(StateId s) const {
+  KALDI_PARANOID_ASSERT(s >= 0 && s < header_->num_states);
+  const Arc *arcs = arcs_ + states_[s].first_arc;
+  size_t ans = 0;
+  for (kaldi::int32 i = 0; i < states_[s].num_arcs; i++)
+    if (arcs[i].olabel == 0) ans++;
+  return ans;
+}
+
+}  // end namespace fst.
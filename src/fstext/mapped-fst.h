@@ -0,0 +1,353 @@
+// fstext/mapped-fst.h
+
+// Copyright 2014   Johns Hopkins University
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_FSTEXT_MAPPED_FST_H_
+#define KALDI_FSTEXT_MAPPED_FST_H_
+
+#include <pthread.h>
+#include <list>
+#include <string>
+#include <vector>
+#include <fst/fstlib.h>
+#include "base/kaldi-common.h"
+
+namespace fst {
+
+/*
+   This file implements a read-only, memory-mapped on-disk format for
+   StdArc FSTs, intended for large decoding graphs (HCLG).  Reading a
+   VectorFst deserializes every state into freshly allocated arc vectors,
+   which for a multi-gigabyte graph takes tens of seconds and gives each
+   decoding process its own private copy of the arcs.  The mapped format
+   instead stores the per-state table and the arc array as flat,
+   mmap()-able images; MappedStdFst just maps the file and serves arcs
+   directly out of the mapping, so startup is near-instant and all
+   processes on a machine share a single page-cache copy of the graph.
+
+   The format is native-endian and records sizeof(StdArc) in its header as
+   a layout check; files are not portable across architectures (regenerate
+   them with fsttomapped where needed).  Like ConstFst, the format cannot
+   be mutated.  Reading requires a real file (no pipes), since mmap needs
+   a seekable descriptor; this is only supported on systems with POSIX
+   mmap().
+*/
+
+// The fixed-size header at the start of a mapped-FST file.  The layout
+// below is 48 bytes, so the state table that follows it (16 bytes per
+// state) and the arc array after that stay 16-byte aligned.
+struct MappedFstHeader {
+  char magic[8];           // "KldMapF1"
+  kaldi::int32 arc_size;   // sizeof(StdArc), as a layout/endianness check.
+  kaldi::int32 start;      // start state, or kNoStateId.
+  kaldi::int64 num_states;
+  kaldi::int64 num_arcs;
+  kaldi::uint64 properties;  // the FST property bits, as of writing.
+  char padding[8];           // zero; reserved.
+};
+
+// Per-state record in the mapped file; states are stored by state-id, with
+// any unused ids appearing as records with no arcs and Zero() final-weight.
+struct MappedFstState {
+  float final;             // final cost; +infinity if not final.
+  kaldi::int32 num_arcs;
+  kaldi::int64 first_arc;  // index of this state's first arc in the arc array.
+};
+
+// Writes "fst" to "filename" in the mapped format.  The filename must be a
+// real, seekable file (not a pipe or "-"), because the result is intended
+// to be mmap'd.  Throws on error.
+void WriteMappedFst(const Fst<StdArc> &fst, const std::string &filename);
+
+/*
+   PrefetchableFst is a mix-in interface for FSTs whose arcs are not all
+   resident in memory (the two classes below), through which a caller that
+   knows which states it will visit soon -- typically a decoder, whose
+   active tokens at frame t sit at exactly the states whose arcs frame t+1
+   will expand -- can start the I/O for those arcs early.  The call is
+   asynchronous and purely advisory: it returns immediately, the read-side
+   interface is unchanged, and a reader that arrives before the prefetch
+   has completed just does the read itself as usual.  The decoders test for
+   this interface with a dynamic_cast, so plain in-memory FSTs pay nothing.
+*/
+class PrefetchableFst {
+ public:
+  // Hints that the arcs of "states" will be read soon.  Supersedes the
+  // hints from any previous call that have not been acted on yet (the
+  // caller's new active set makes the old one obsolete).
+  virtual void PrefetchStates(const std::vector<StdArc::StateId> &states)
+      const = 0;
+
+  virtual ~PrefetchableFst() { }
+};
+
+// MappedStdFst is a read-only Fst<StdArc> backed by an mmap'd file in the
+// format written by WriteMappedFst().  The constructor just maps the file
+// and validates the header, so it is cheap no matter how large the graph
+// is; the kernel pages arcs in on demand and shares them between all
+// processes mapping the same file.
+class MappedStdFst : public Fst<StdArc>, public PrefetchableFst {
+ public:
+  typedef StdArc Arc;
+  typedef Arc::Weight Weight;
+  typedef Arc::StateId StateId;
+
+  // Maps "filename"; throws via KALDI_ERR if the file cannot be mapped or
+  // is not a valid mapped-FST file.
+  explicit MappedStdFst(const std::string &filename);
+
+  virtual ~MappedStdFst();
+
+  virtual StateId Start() const { return header_->start; }
+
+  virtual Weight Final(StateId s) const {
+    KALDI_PARANOID_ASSERT(s >= 0 && s < header_->num_states);
+    return Weight(states_[s].final);
+  }
+
+  virtual size_t NumArcs(StateId s) const {
+    KALDI_PARANOID_ASSERT(s >= 0 && s < header_->num_states);
+    return states_[s].num_arcs;
+  }
+
+  virtual size_t NumInputEpsilons(StateId s) const;
+
+  virtual size_t NumOutputEpsilons(StateId s) const;
+
+  virtual uint64 Properties(uint64 mask, bool test) const {
+    // All properties were computed when the file was written; the FST
+    // cannot change, so there is nothing to test.
+    return header_->properties & mask;
+  }
+
+  virtual const string &Type() const {
+    static const string type = "kaldi-mapped-const";
+    return type;
+  }
+
+  // Returns a new MappedStdFst mapping the same file; the mappings share
+  // physical pages, so this is cheap.
+  virtual MappedStdFst *Copy(bool safe = false) const {
+    return new MappedStdFst(filename_);
+  }
+
+  virtual bool Write(std::ostream &strm, const FstWriteOptions &opts) const {
+    KALDI_WARN << "MappedStdFst does not support Write(); convert via "
+        "VectorFst, or copy the mapped file itself.";
+    return false;
+  }
+
+  virtual bool Write(const string &filename) const {
+    return Write(std::cout, FstWriteOptions());  // prints the warning.
+  }
+
+  virtual const SymbolTable *InputSymbols() const { return NULL; }
+
+  virtual const SymbolTable *OutputSymbols() const { return NULL; }
+
+  virtual void InitStateIterator(StateIteratorData<Arc> *data) const {
+    data->base = NULL;
+    data->nstates = header_->num_states;
+  }
+
+  virtual void InitArcIterator(StateId s, ArcIteratorData<Arc> *data) const {
+    KALDI_PARANOID_ASSERT(s >= 0 && s < header_->num_states);
+    data->base = NULL;
+    data->arcs = arcs_ + states_[s].first_arc;
+    data->narcs = states_[s].num_arcs;
+    data->ref_count = NULL;
+  }
+
+  // Asks the kernel (via madvise) to read ahead the pages holding the arcs
+  // of "states", so that when the graph is larger than memory and being
+  // paged from disk, those reads overlap with the caller's other work.
+  virtual void PrefetchStates(const std::vector<StateId> &states) const;
+
+ private:
+  std::string filename_;  // kept so that Copy() can re-map the file.
+  void *map_;             // the whole mapped file image.
+  size_t map_size_;
+  // The three pointers below all point into map_:
+  const MappedFstHeader *header_;
+  const MappedFstState *states_;
+  const Arc *arcs_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(MappedStdFst);
+};
+
+
+class DiskBackedArcIterator;
+
+/*
+   DiskBackedStdFst reads the same on-disk format as MappedStdFst, but with
+   an explicit memory budget rather than a whole-file mapping: only the
+   header and the per-state table are held resident (16 bytes per state),
+   while the arc array -- which dominates the file size for large graphs --
+   is served from an LRU cache of partitions, each covering a fixed range of
+   states, read with pread() on demand.  This is for graph-building steps
+   whose intermediate FSTs are larger than physical memory (e.g. a 50 GB
+   C o L o G input to determinization on a 32 GB machine): a full mmap of
+   such a file competes with the algorithm's own working memory for pages,
+   whereas here the cache never exceeds the configured number of bytes.
+
+   The FST is read-only.  Arc iterators pin the partition holding their
+   state's arcs until they are destroyed, so a partition is never evicted
+   while its arcs are in use; pinning and eviction are internally locked, so
+   const access (e.g. from the multi-threaded mode of DeterminizeStar) is
+   safe from several threads.  Like MappedStdFst, this requires a real file
+   and POSIX I/O, and is not supported on Windows.
+*/
+class DiskBackedStdFst : public Fst<StdArc>, public PrefetchableFst {
+ public:
+  typedef StdArc Arc;
+  typedef Arc::Weight Weight;
+  typedef Arc::StateId StateId;
+
+  static const size_t kDefaultCacheBytes = 1073741824;  // 1 GB.
+
+  // Opens "filename" (a mapped-FST file, see WriteMappedFst) and reads the
+  // state table; arcs are read lazily.  "cache_bytes" bounds the memory used
+  // for cached arc partitions.  Throws via KALDI_ERR on failure.
+  explicit DiskBackedStdFst(const std::string &filename,
+                            size_t cache_bytes = kDefaultCacheBytes);
+
+  virtual ~DiskBackedStdFst();
+
+  virtual StateId Start() const { return header_.start; }
+
+  virtual Weight Final(StateId s) const {
+    KALDI_PARANOID_ASSERT(s >= 0 && s < header_.num_states);
+    return Weight(states_[s].final);
+  }
+
+  virtual size_t NumArcs(StateId s) const {
+    KALDI_PARANOID_ASSERT(s >= 0 && s < header_.num_states);
+    return states_[s].num_arcs;
+  }
+
+  virtual size_t NumInputEpsilons(StateId s) const;
+
+  virtual size_t NumOutputEpsilons(StateId s) const;
+
+  virtual uint64 Properties(uint64 mask, bool test) const {
+    return header_.properties & mask;
+  }
+
+  virtual const string &Type() const {
+    static const string type = "kaldi-disk-backed-const";
+    return type;
+  }
+
+  // Returns a new DiskBackedStdFst reading the same file, with its own
+  // cache of the same size.
+  virtual DiskBackedStdFst *Copy(bool safe = false) const {
+    return new DiskBackedStdFst(filename_, cache_bytes_);
+  }
+
+  virtual bool Write(std::ostream &strm, const FstWriteOptions &opts) const {
+    KALDI_WARN << "DiskBackedStdFst does not support Write(); convert via "
+        "VectorFst, or copy the underlying file itself.";
+    return false;
+  }
+
+  virtual bool Write(const string &filename) const {
+    return Write(std::cout, FstWriteOptions());  // prints the warning.
+  }
+
+  virtual const SymbolTable *InputSymbols() const { return NULL; }
+
+  virtual const SymbolTable *OutputSymbols() const { return NULL; }
+
+  virtual void InitStateIterator(StateIteratorData<Arc> *data) const {
+    data->base = NULL;
+    data->nstates = header_.num_states;
+  }
+
+  virtual void InitArcIterator(StateId s, ArcIteratorData<Arc> *data) const;
+
+  // Queues the partitions holding the arcs of "states" to be read by a
+  // background thread (started on the first call), so the pread()s overlap
+  // with the caller's own work; partitions that are already resident cost
+  // one locked lookup.  Each call replaces the not-yet-started part of the
+  // previous request.  The loaded partitions enter the same LRU cache as
+  // demand loads and are subject to the same memory budget.
+  virtual void PrefetchStates(const std::vector<StateId> &states) const;
+
+ private:
+  friend class DiskBackedArcIterator;
+
+  // Number of states per cache partition; a state's arcs always lie inside
+  // its own partition, since arcs are stored per state in contiguous blocks.
+  static const StateId kStatesPerPartition = 8192;
+
+  struct Partition {
+    Arc *arcs;  // the partition's block of the arc array, or NULL if not
+                // resident.
+    int pins;   // number of live arc iterators reading from "arcs".
+    std::list<int>::iterator lru_pos;  // position in lru_; valid iff resident.
+    Partition(): arcs(NULL), pins(0) { }
+  };
+
+  // Ensures the partition holding state s is resident, pins it, and returns
+  // a pointer to the arcs of s (NULL if the state has none, in which case
+  // nothing is pinned).  Pairs with UnpinPartition(s / kStatesPerPartition).
+  const Arc *PinState(StateId s, size_t *num_arcs) const;
+  void UnpinPartition(int p) const;
+
+  // The functions below assume cache_lock_ is held.
+  void LoadPartitionLocked(int p) const;
+  void EvictAsNeededLocked(int protected_partition) const;
+  kaldi::int64 PartitionFirstArc(int p) const;
+  kaldi::int64 PartitionEndArc(int p) const;
+
+  // Loads partition p if it is not resident, doing the pread() *without*
+  // holding cache_lock_ so that it does not stall concurrent readers; used
+  // by the prefetch thread.
+  void PrefetchPartition(int p) const;
+  // pthread start routine of the prefetch thread; "arg" is the fst.
+  static void *PrefetchThread(void *arg);
+
+  std::string filename_;  // kept so that Copy() can re-open the file.
+  size_t cache_bytes_;    // budget for resident partitions.
+  int fd_;
+  MappedFstHeader header_;
+  std::vector<MappedFstState> states_;  // resident copy of the state table.
+  kaldi::int64 arcs_offset_;  // byte offset of the arc array in the file.
+  int num_partitions_;
+  mutable std::vector<Partition> partitions_;
+  mutable std::list<int> lru_;  // resident partitions, most recent first.
+  mutable size_t cache_bytes_used_;
+  mutable pthread_mutex_t cache_lock_;
+
+  // State of the prefetch thread (see PrefetchStates()); all of it is
+  // guarded by prefetch_lock_.  The thread is started on the first
+  // PrefetchStates() call, so FSTs that are never prefetched from don't
+  // get one.
+  mutable std::vector<int> prefetch_queue_;  // partitions still to load.
+  mutable bool prefetch_thread_started_;
+  mutable bool prefetch_shutdown_;
+  mutable pthread_t prefetch_thread_;
+  mutable pthread_mutex_t prefetch_lock_;
+  mutable pthread_cond_t prefetch_cond_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(DiskBackedStdFst);
+};
+
+}  // end namespace fst.
+
+#endif  // KALDI_FSTEXT_MAPPED_FST_H_
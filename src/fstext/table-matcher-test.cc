@@ -272,6 +272,90 @@ template<class Arc>  void TestTableMatcherCacheRight(bool connect) {
 }
 
 
+// Don't instantiate with log semiring, as RandEquivalent may fail.
+// Tests composition with precomputed match tables (TableMatcherData),
+// including building them multi-threaded and round-tripping them through
+// the Write/Read functions.
+template<class Arc>  void TestTableMatcherData(bool connect, bool left) {
+  typedef typename Arc::Label Label;
+  typedef typename Arc::StateId StateId;
+  typedef typename Arc::Weight Weight;
+
+
+  VectorFst<Arc> *fst1 = RandFst<Arc>();
+
+  VectorFst<Arc> *fst2 = RandFst<Arc>();
+
+  ILabelCompare<Arc> ilabel_comp;
+  OLabelCompare<Arc> olabel_comp;
+
+  TableComposeOptions opts;
+  if (left) opts.table_match_type = MATCH_OUTPUT;
+  else opts.table_match_type = MATCH_INPUT;
+  opts.min_table_size = 1 + kaldi::Rand() % 5;
+  opts.table_ratio = 0.25 * (kaldi::Rand() % 5);
+  opts.connect = connect;
+
+  ArcSort(fst1, olabel_comp);
+  ArcSort(fst2, ilabel_comp);
+
+  TableMatcherData<Arc> data;
+  int32 num_threads = 1 + kaldi::Rand() % 3;
+  BuildTableMatcherData(left ? *fst1 : *fst2, opts.table_match_type,
+                        opts, num_threads, &data);
+
+  // Round-trips the precomputed tables through serialization, in binary
+  // or text mode at random.
+  TableMatcherData<Arc> data2;
+  {
+    bool binary = (kaldi::Rand() % 2 == 0);
+    std::ostringstream os;
+    data.Write(os, binary);
+    std::istringstream is(os.str());
+    data2.Read(is, binary);
+  }
+  assert(data2.match_type == data.match_type);
+  assert(data2.tables == data.tables);
+
+  VectorFst<Arc> composed;
+
+  TableCompose(*fst1, *fst2, &composed, opts, &data2);
+
+  if (!connect) Connect(&composed);
+
+  VectorFst<Arc> composed_baseline;
+
+  Compose(*fst1, *fst2, &composed_baseline);
+
+  if ( !RandEquivalent(composed, composed_baseline, 3/*paths*/, 0.01/*delta*/, kaldi::Rand()/*seed*/, 20/*path length-- max?*/)) {
+    std::cout <<" Composed FST (with precomputed tables)\n";
+    {
+#ifdef HAVE_OPENFST_GE_10400
+      FstPrinter<Arc> fstprinter(composed, NULL, NULL, NULL, false, true, "\t");
+#else
+      FstPrinter<Arc> fstprinter(composed, NULL, NULL, NULL, false, true);
+#endif
+      fstprinter.Print(&std::cout, "standard output");
+    }
+
+    std::cout <<" Baseline-Composed FST\n";
+    {
+#ifdef HAVE_OPENFST_GE_10400
+      FstPrinter<Arc> fstprinter(composed_baseline, NULL, NULL, NULL, false, true, "\t");
+#else
+      FstPrinter<Arc> fstprinter(composed_baseline, NULL, NULL, NULL, false, true);
+#endif
+      fstprinter.Print(&std::cout, "standard output");
+    }
+
+    assert(0);
+  }
+
+  delete fst1;
+  delete fst2;
+}
+
+
 } // namespace fst
 
 int main() {
@@ -285,5 +369,9 @@ int main() {
     TestTableMatcherCacheLeft<fst::StdArc>(false);
     TestTableMatcherCacheRight<fst::StdArc>(true);
     TestTableMatcherCacheRight<fst::StdArc>(false);
+    TestTableMatcherData<fst::StdArc>(true, true);
+    TestTableMatcherData<fst::StdArc>(false, true);
+    TestTableMatcherData<fst::StdArc>(true, false);
+    TestTableMatcherData<fst::StdArc>(false, false);
   }
 }
@@ -19,9 +19,11 @@
 
 #ifndef KALDI_FSTEXT_TABLE_MATCHER_H_
 #define KALDI_FSTEXT_TABLE_MATCHER_H_
+#include <pthread.h>
 #include <fst/fstlib.h>
 #include <fst/fst-decl.h>
 
+#include "base/io-funcs.h"
 
 
 namespace fst {
@@ -46,6 +48,166 @@ struct TableMatcherOptions {
 };
 
 
+/// TableMatcherData holds the per-state lookup tables that TableMatcherImpl
+/// would otherwise construct lazily during composition.  It can be built
+/// once for an FST (see BuildTableMatcherData below), written to disk
+/// alongside that FST, and handed to TableMatcher/TableCompose on later runs
+/// so that repeated compositions against the same FST (e.g. against G or L
+/// in graph building) skip table construction entirely.  An empty vector for
+/// a state means "no table": the matcher uses its backoff (sorted) matcher
+/// there, exactly as in the lazy case.  The object is read-only during
+/// matching, so one instance may be shared by concurrent compositions.
+template<class Arc>
+struct TableMatcherData {
+  typedef typename Arc::StateId StateId;
+
+  MatchType match_type;  // MATCH_OUTPUT or MATCH_INPUT: which side was indexed.
+  vector<vector<StateId> > tables;  // indexed by state; tables[s][label] is the
+  // position of the first arc with this label, or kNoStateId.
+
+  TableMatcherData(): match_type(MATCH_NONE) { }
+
+  void Write(std::ostream &os, bool binary) const {
+    kaldi::WriteToken(os, binary, "<TableMatcherData>");
+    kaldi::WriteBasicType(os, binary, static_cast<int32>(match_type));
+    int32 num_states = static_cast<int32>(tables.size());
+    kaldi::WriteBasicType(os, binary, num_states);
+    for (int32 s = 0; s < num_states; s++)
+      kaldi::WriteIntegerVector(os, binary, tables[s]);
+    kaldi::WriteToken(os, binary, "</TableMatcherData>");
+  }
+
+  void Read(std::istream &is, bool binary) {
+    kaldi::ExpectToken(is, binary, "<TableMatcherData>");
+    int32 m;
+    kaldi::ReadBasicType(is, binary, &m);
+    match_type = static_cast<MatchType>(m);
+    int32 num_states;
+    kaldi::ReadBasicType(is, binary, &num_states);
+    if (num_states < 0)
+      LOG(FATAL) << "Reading TableMatcherData: bad num-states " << num_states;
+    tables.clear();
+    tables.resize(num_states);
+    for (int32 s = 0; s < num_states; s++)
+      kaldi::ReadIntegerVector(is, binary, &(tables[s]));
+    kaldi::ExpectToken(is, binary, "</TableMatcherData>");
+  }
+};
+
+template<class F> struct TableMatcherDataBuildTask;  // forward declaration.
+
+// Builds the table for one state, with the same size/sparsity criteria as
+// TableMatcherImpl::SetState; leaves (*table) empty if the state should use
+// the backoff matcher.  Shared between the lazy and precomputed paths would
+// be nicer, but SetState interleaves this with matcher state, so the logic
+// is kept in sync by hand (it is only a few lines).
+template<class F>
+inline void BuildTableMatcherState(const F &fst, MatchType match_type,
+                                   const TableMatcherOptions &opts,
+                                   typename F::Arc::StateId s,
+                                   vector<typename F::Arc::StateId> *table) {
+  typedef typename F::Arc Arc;
+  typedef typename Arc::Label Label;
+  typedef typename Arc::StateId StateId;
+  table->clear();
+  StateId num_arcs = fst.NumArcs(s);
+  if (num_arcs == 0 || num_arcs < opts.min_table_size)
+    return;
+  ArcIterator<F> aiter(fst, s);
+  aiter.SetFlags(kArcNoCache|(match_type == MATCH_OUTPUT ?
+                              kArcOLabelValue : kArcILabelValue),
+                 kArcNoCache|kArcValueFlags);
+  aiter.Seek(num_arcs - 1);
+  Label highest_label = (match_type == MATCH_OUTPUT ?
+                         aiter.Value().olabel : aiter.Value().ilabel);
+  if ((highest_label+1) * opts.table_ratio > num_arcs)
+    return;  // table would be too sparse.
+  table->resize(highest_label+1, kNoStateId);
+  StateId pos = 0;
+  for (aiter.Seek(0); !aiter.Done(); aiter.Next(), pos++) {
+    Label label = (match_type == MATCH_OUTPUT ?
+                   aiter.Value().olabel : aiter.Value().ilabel);
+    assert((size_t)label <= (size_t)highest_label);  // also checks >= 0.
+    if ((*table)[label] == kNoStateId) (*table)[label] = pos;
+  }
+}
+
+template<class F>
+struct TableMatcherDataBuildTask {
+  const F *fst;
+  MatchType match_type;
+  TableMatcherOptions opts;
+  typename F::Arc::StateId begin_state, end_state;  // [begin, end) shard.
+  TableMatcherData<typename F::Arc> *data;
+};
+
+template<class F>
+void *TableMatcherDataBuildThread(void *ptr) {
+  TableMatcherDataBuildTask<F> *task =
+      reinterpret_cast<TableMatcherDataBuildTask<F>*>(ptr);
+  typedef typename F::Arc::StateId StateId;
+  for (StateId s = task->begin_state; s < task->end_state; s++)
+    BuildTableMatcherState(*(task->fst), task->match_type, task->opts,
+                           s, &(task->data->tables[s]));
+  return NULL;
+}
+
+/// Precomputes the lookup tables for all states of "fst", sharding the states
+/// across "num_threads" threads (table construction is independent per state,
+/// so this parallelizes trivially; composition itself stays sequential).  The
+/// FST must be label-sorted on the matched side, as for TableMatcher, and
+/// must be of an expanded type such as VectorFst or ConstFst: arc iteration
+/// must be safe from several threads on a const FST, which rules out
+/// on-demand FSTs with arc caching (use num_threads = 1 for those).
+template<class F>
+void BuildTableMatcherData(const F &fst, MatchType match_type,
+                           const TableMatcherOptions &opts,
+                           int32 num_threads,
+                           TableMatcherData<typename F::Arc> *data) {
+  typedef typename F::Arc::StateId StateId;
+  assert(data != NULL);
+  assert(opts.min_table_size > 0);
+  if (match_type == MATCH_INPUT)
+    assert(fst.Properties(kILabelSorted, true) == kILabelSorted);
+  else if (match_type == MATCH_OUTPUT)
+    assert(fst.Properties(kOLabelSorted, true) == kOLabelSorted);
+  else
+    assert(0 && "Invalid match type");
+
+  StateId num_states = fst.NumStates();
+  data->match_type = match_type;
+  data->tables.clear();
+  data->tables.resize(num_states);
+  if (num_threads <= 1 || num_states <= 1) {
+    for (StateId s = 0; s < num_states; s++)
+      BuildTableMatcherState(fst, match_type, opts, s, &(data->tables[s]));
+    return;
+  }
+  if (num_threads > num_states) num_threads = num_states;
+  vector<TableMatcherDataBuildTask<F> > tasks(num_threads);
+  vector<pthread_t> threads(num_threads);
+  for (int32 t = 0; t < num_threads; t++) {
+    tasks[t].fst = &fst;
+    tasks[t].match_type = match_type;
+    tasks[t].opts = opts;
+    tasks[t].begin_state = static_cast<StateId>(
+        (static_cast<int64>(num_states) * t) / num_threads);
+    tasks[t].end_state = static_cast<StateId>(
+        (static_cast<int64>(num_states) * (t+1)) / num_threads);
+    tasks[t].data = data;
+    int ret = pthread_create(&(threads[t]), NULL,
+                             TableMatcherDataBuildThread<F>, &(tasks[t]));
+    if (ret != 0)
+      LOG(FATAL) << "BuildTableMatcherData: error creating thread, errno = "
+                 << ret;
+  }
+  for (int32 t = 0; t < num_threads; t++) {
+    if (pthread_join(threads[t], NULL) != 0)
+      LOG(FATAL) << "BuildTableMatcherData: error joining thread.";
+  }
+}
+
+
 // Introducing an "impl" class for TableMatcher because
 // we need to do a shallow copy of the Matcher for when
 // we want to cache tables for multiple compositions.
@@ -63,8 +225,12 @@ class TableMatcherImpl : public MatcherBase<typename F::Arc> {
 
  public:
 
+  // If "data" is non-NULL it must outlive this object and must have been
+  // built (with the same match_type) from the FST we are matching; the
+  // matcher then uses the precomputed tables instead of constructing its own.
   TableMatcherImpl(const FST &fst, MatchType match_type,
-                   const TableMatcherOptions &opts = TableMatcherOptions()):
+                   const TableMatcherOptions &opts = TableMatcherOptions(),
+                   const TableMatcherData<Arc> *data = NULL):
       match_type_(match_type),
       fst_(fst.Copy()),
       loop_(match_type == MATCH_INPUT ?
@@ -72,9 +238,11 @@ class TableMatcherImpl : public MatcherBase<typename F::Arc> {
             Arc(0, kNoLabel, Weight::One(), kNoStateId)),
       aiter_(NULL),
       s_(kNoStateId), opts_(opts),
-      backoff_matcher_(fst, match_type)
+      backoff_matcher_(fst, match_type),
+      data_(data), current_table_(NULL)
   {
     assert(opts_.min_table_size > 0);
+    assert(data == NULL || data->match_type == match_type);
     if (match_type == MATCH_INPUT)
       assert(fst_->Properties(kILabelSorted, true) == kILabelSorted);
     else if (match_type == MATCH_OUTPUT)
@@ -108,6 +276,22 @@ class TableMatcherImpl : public MatcherBase<typename F::Arc> {
     if (match_type_ == MATCH_NONE)
       LOG(FATAL) << "TableMatcher: bad match type";
     s_ = s;
+    current_table_ = NULL;
+    if (data_ != NULL) {  // precomputed tables: nothing to construct here.
+      if (static_cast<size_t>(s) >= data_->tables.size())
+        LOG(FATAL) << "TableMatcher: state " << s << " out of range of "
+            "precomputed TableMatcherData (data built from a different FST?)";
+      const vector<ArcId> &table = data_->tables[s];
+      if (table.empty()) {  // this state has no table: use backoff matcher.
+        backoff_matcher_.SetState(s);
+        return;
+      }
+      current_table_ = &table;
+      aiter_ = new ArcIterator<FST>(*fst_, s);
+      aiter_->SetFlags(kArcNoCache, kArcNoCache);
+      loop_.nextstate = s;
+      return;
+    }
     vector<ArcId> *const empty = ((vector<ArcId>*)(NULL)) + 1;  // special marker.
     if (static_cast<size_t>(s) >= tables_.size()) {
       assert(s>=0);
@@ -150,6 +334,7 @@ class TableMatcherImpl : public MatcherBase<typename F::Arc> {
       }
     }
     // At this point in the code, this_table_ != NULL and != empty.
+    current_table_ = this_table_;
     aiter_ = new ArcIterator<FST>(*fst_, s);
     aiter_->SetFlags(kArcNoCache, kArcNoCache);  // don't need to cache arcs as may only
     // need a small subset.
@@ -166,9 +351,9 @@ class TableMatcherImpl : public MatcherBase<typename F::Arc> {
       // kNoLabel means the implicit loop on the other FST --
       // matches real epsilons but not the self-loop.
       match_label_ = (match_label_ == kNoLabel ? 0 : match_label_);
-      if (static_cast<size_t>(match_label_) < tables_[s_]->size() &&
-         (*(tables_[s_]))[match_label_] != kNoStateId) {
-        aiter_->Seek( (*(tables_[s_]))[match_label_] );  // label exists.
+      if (static_cast<size_t>(match_label_) < current_table_->size() &&
+         (*current_table_)[match_label_] != kNoStateId) {
+        aiter_->Seek( (*current_table_)[match_label_] );  // label exists.
         return true;
       }
       return current_loop_;
@@ -249,6 +434,10 @@ class TableMatcherImpl : public MatcherBase<typename F::Arc> {
   vector<vector<ArcId> *> tables_;
   TableMatcherOptions opts_;
   BackoffMatcher backoff_matcher_;
+  const TableMatcherData<Arc> *data_;  // precomputed tables, not owned; NULL
+  // means construct tables lazily into tables_.
+  const vector<ArcId> *current_table_;  // table of the current state (points
+  // either into *data_ or into tables_), or NULL if using backoff matcher.
 
 };
 
@@ -264,9 +453,13 @@ class TableMatcher : public MatcherBase<typename F::Arc> {
   // in the Seek function of ArcIterator, but StateId should be big enough].
   typedef typename Arc::Weight Weight;
 
+  // See TableMatcherImpl for the meaning of the optional "data" argument
+  // (precomputed tables; must outlive this matcher and all its copies).
   TableMatcher(const FST &fst, MatchType match_type,
-               const TableMatcherOptions &opts = TableMatcherOptions()):
-      impl_(new TableMatcherImpl<F, BackoffMatcher>(fst, match_type, opts)) { }
+               const TableMatcherOptions &opts = TableMatcherOptions(),
+               const TableMatcherData<Arc> *data = NULL):
+      impl_(new TableMatcherImpl<F, BackoffMatcher>(fst, match_type, opts,
+                                                    data)) { }
 
 
   TableMatcher(const TableMatcher<FST, BackoffMatcher> &matcher, bool safe):
@@ -325,28 +518,41 @@ struct TableComposeOptions: public TableMatcherOptions {
 };
 
 
+// Version of TableCompose taking precomputed tables ("data", which may be
+// NULL meaning construct tables lazily); the data must have been built from
+// the FST on the matched side (ifst1 for MATCH_OUTPUT, ifst2 for
+// MATCH_INPUT), with the same match type and table-building options.
 template<class Arc>
 void TableCompose(const Fst<Arc> &ifst1, const Fst<Arc> &ifst2,
                   MutableFst<Arc> *ofst,
-                  const TableComposeOptions &opts = TableComposeOptions()) {
+                  const TableComposeOptions &opts,
+                  const TableMatcherData<Arc> *data) {
   typedef Fst<Arc> F;
   CacheOptions nopts;
   nopts.gc_limit = 0;  // Cache only the last state for fastest copy.
   if (opts.table_match_type == MATCH_OUTPUT) {
     // ComposeFstImplOptions templated on matcher for fst1, matcher for fst2.
     ComposeFstImplOptions<TableMatcher<F>, SortedMatcher<F> > impl_opts(nopts);
-    impl_opts.matcher1 = new TableMatcher<F>(ifst1, MATCH_OUTPUT, opts);
+    impl_opts.matcher1 = new TableMatcher<F>(ifst1, MATCH_OUTPUT, opts, data);
     *ofst = ComposeFst<Arc>(ifst1, ifst2, impl_opts);
   } else {
     assert(opts.table_match_type == MATCH_INPUT) ;
-    // ComposeFstImplOptions templated on matcher for fst1, matcher for fst2.    
+    // ComposeFstImplOptions templated on matcher for fst1, matcher for fst2.
     ComposeFstImplOptions<SortedMatcher<F>, TableMatcher<F> > impl_opts(nopts);
-    impl_opts.matcher2 = new TableMatcher<F>(ifst2, MATCH_INPUT, opts);
+    impl_opts.matcher2 = new TableMatcher<F>(ifst2, MATCH_INPUT, opts, data);
     *ofst = ComposeFst<Arc>(ifst1, ifst2, impl_opts);
   }
   if (opts.connect) Connect(ofst);
 }
 
+template<class Arc>
+void TableCompose(const Fst<Arc> &ifst1, const Fst<Arc> &ifst2,
+                  MutableFst<Arc> *ofst,
+                  const TableComposeOptions &opts = TableComposeOptions()) {
+  TableCompose(ifst1, ifst2, ofst, opts,
+               static_cast<const TableMatcherData<Arc>*>(NULL));
+}
+
 
 /// TableComposeCache lets us do multiple compositions while caching the same
 /// matcher.
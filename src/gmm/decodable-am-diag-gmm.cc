@@ -81,4 +81,43 @@ void DecodableAmDiagGmmUnmapped::ResetLogLikeCache() {
 }
 
 
+BaseFloat DecodableAmDiagGmmPruned::LogLikelihoodZeroBased(
+    int32 frame, int32 state) {
+  KALDI_ASSERT(static_cast<size_t>(frame) <
+               static_cast<size_t>(NumFramesReady()));
+  KALDI_ASSERT(static_cast<size_t>(state) <
+               static_cast<size_t>(acoustic_model_.NumPdfs()) &&
+               "Likely graph/model mismatch, e.g. using wrong HCLG.fst");
+
+  if (log_like_cache_[state].hit_time == frame)
+    return log_like_cache_[state].log_like;
+
+  const VectorBase<BaseFloat> &data = feature_matrix_.Row(frame);
+  if (frame != clusters_frame_) {  // select this frame's clusters once.
+    shortlist_.GetFrameClusters(data, &clusters_);
+    clusters_frame_ = frame;
+  }
+
+  const DiagGmm &pdf = acoustic_model_.GetPdf(state);
+  shortlist_.GetPdfShortlist(state, clusters_, &gauss_ids_);
+  BaseFloat log_sum;
+  if (gauss_ids_.empty()) {
+    // None of this pdf's Gaussians belong to the selected clusters;
+    // evaluate in full rather than returning a junk value.
+    Vector<BaseFloat> loglikes;
+    pdf.LogLikelihoods(data, &loglikes);
+    log_sum = loglikes.LogSumExp(log_sum_exp_prune_);
+  } else {
+    Vector<BaseFloat> loglikes;
+    pdf.LogLikelihoodsPreselect(data, gauss_ids_, &loglikes);
+    log_sum = loglikes.LogSumExp(log_sum_exp_prune_);
+  }
+  if (KALDI_ISNAN(log_sum) || KALDI_ISINF(log_sum))
+    KALDI_ERR << "Invalid answer (overflow or invalid variances/features?)";
+
+  log_like_cache_[state].log_like = log_sum;
+  log_like_cache_[state].hit_time = frame;
+  return log_sum;
+}
+
 }  // namespace kaldi
@@ -26,6 +26,7 @@
 
 #include "base/kaldi-common.h"
 #include "gmm/am-diag-gmm.h"
+#include "gmm/gaussian-shortlist.h"
 #include "hmm/transition-model.h"
 #include "itf/decodable-itf.h"
 #include "transform/regression-tree.h"
@@ -159,6 +160,47 @@ class DecodableAmDiagGmmScaled: public DecodableAmDiagGmmUnmapped {
   KALDI_DISALLOW_COPY_AND_ASSIGN(DecodableAmDiagGmmScaled);
 };
 
+/// DecodableAmDiagGmmPruned is like DecodableAmDiagGmmScaled, but it uses a
+/// GaussianShortlist (see gaussian-shortlist.h) built offline from the
+/// model: each frame the shortlist's small top-level GMM is scored once,
+/// and for each requested pdf only the mixture components in the selected
+/// clusters are evaluated exactly.  Pdfs whose shortlist is empty on a
+/// frame fall back to full evaluation, so the result is never worse than a
+/// pruned-to-nothing score.
+class DecodableAmDiagGmmPruned : public DecodableAmDiagGmmUnmapped {
+ public:
+  DecodableAmDiagGmmPruned(const AmDiagGmm &am,
+                           const TransitionModel &tm,
+                           const GaussianShortlist &shortlist,
+                           const Matrix<BaseFloat> &feats,
+                           BaseFloat scale):
+      DecodableAmDiagGmmUnmapped(am, feats), trans_model_(tm),
+      shortlist_(shortlist), scale_(scale), clusters_frame_(-1) {
+    KALDI_ASSERT(shortlist.NumPdfs() == am.NumPdfs() &&
+                 "Shortlist/model mismatch.");
+  }
+
+  // Note, frames are numbered from zero but transition-ids from one.
+  virtual BaseFloat LogLikelihood(int32 frame, int32 tid) {
+    return scale_ * LogLikelihoodZeroBased(frame,
+                                           trans_model_.TransitionIdToPdf(tid));
+  }
+  // Indices are one-based!  This is for compatibility with OpenFst.
+  virtual int32 NumIndices() const { return trans_model_.NumTransitionIds(); }
+
+ protected:
+  virtual BaseFloat LogLikelihoodZeroBased(int32 frame, int32 state_index);
+
+ private:
+  const TransitionModel &trans_model_;  // for transition-id to pdf mapping
+  const GaussianShortlist &shortlist_;
+  BaseFloat scale_;
+  int32 clusters_frame_;  // the frame clusters_ is valid for, or -1.
+  std::vector<int32> clusters_;   // selected clusters of clusters_frame_.
+  std::vector<int32> gauss_ids_;  // scratch, to avoid reallocation.
+  KALDI_DISALLOW_COPY_AND_ASSIGN(DecodableAmDiagGmmPruned);
+};
+
 }  // namespace kaldi
 
 #endif  // KALDI_GMM_DECODABLE_AM_DIAG_GMM_H_
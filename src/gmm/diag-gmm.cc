@@ -27,12 +27,22 @@
 #include <string>
 #include <vector>
 
+#include "base/cpu-features.h"
 #include "gmm/diag-gmm.h"
 #include "gmm/diag-gmm-normal.h"
 #include "gmm/full-gmm.h"
 #include "gmm/full-gmm-normal.h"
 #include "tree/clusterable-classes.h"
 
+// The explicitly vectorized likelihood kernel below is limited to x86-64
+// gcc in single precision; everything else uses the BLAS path.
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) \
+    && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 8)) \
+    && (KALDI_DOUBLEPRECISION == 0)
+#define KALDI_DIAG_GMM_SIMD 1
+#include <immintrin.h>
+#endif
+
 namespace kaldi {
 
 // Constructor that allows us to merge GMMs.
@@ -514,6 +524,108 @@ BaseFloat DiagGmm::ComponentLogLikelihood(const VectorBase<BaseFloat> &data,
 }
 
 // Gets likelihood of data given this.
+#ifdef KALDI_DIAG_GMM_SIMD
+// Fused per-Gaussian likelihood kernel: for each row g it computes the two
+// dot products of DiagGmm::LogLikelihoods() in one pass and does
+//   loglikes[g] += mi[g]'data - 0.5 * iv[g]'data_sq.
+// Compared with the two AddMatVec() calls this halves the passes over the
+// model rows and avoids per-call BLAS overhead, which matters at typical
+// GMM sizes (tens of mixtures, dim ~40).  The AVX2 version uses FMA and is
+// selected at runtime; the SSE2 version is the x86-64 baseline.
+
+__attribute__((target("avx2,fma")))
+static void FusedGaussianDotsAvx2(int32 num_rows, int32 dim,
+                                  const float *mi, int32 mi_stride,
+                                  const float *iv, int32 iv_stride,
+                                  const float *data, const float *data_sq,
+                                  float *loglikes) {
+  for (int32 g = 0; g < num_rows; g++) {
+    const float *mi_row = mi + g * mi_stride,
+        *iv_row = iv + g * iv_stride;
+    __m256 acc1a = _mm256_setzero_ps(), acc1b = _mm256_setzero_ps(),
+        acc2a = _mm256_setzero_ps(), acc2b = _mm256_setzero_ps();
+    int32 d = 0;
+    for (; d + 16 <= dim; d += 16) {  // two accumulators per dot product,
+                                      // to hide the FMA latency.
+      acc1a = _mm256_fmadd_ps(_mm256_loadu_ps(mi_row + d),
+                              _mm256_loadu_ps(data + d), acc1a);
+      acc1b = _mm256_fmadd_ps(_mm256_loadu_ps(mi_row + d + 8),
+                              _mm256_loadu_ps(data + d + 8), acc1b);
+      acc2a = _mm256_fmadd_ps(_mm256_loadu_ps(iv_row + d),
+                              _mm256_loadu_ps(data_sq + d), acc2a);
+      acc2b = _mm256_fmadd_ps(_mm256_loadu_ps(iv_row + d + 8),
+                              _mm256_loadu_ps(data_sq + d + 8), acc2b);
+    }
+    for (; d + 8 <= dim; d += 8) {
+      acc1a = _mm256_fmadd_ps(_mm256_loadu_ps(mi_row + d),
+                              _mm256_loadu_ps(data + d), acc1a);
+      acc2a = _mm256_fmadd_ps(_mm256_loadu_ps(iv_row + d),
+                              _mm256_loadu_ps(data_sq + d), acc2a);
+    }
+    acc1a = _mm256_add_ps(acc1a, acc1b);
+    acc2a = _mm256_add_ps(acc2a, acc2b);
+    __m128 s1 = _mm_add_ps(_mm256_castps256_ps128(acc1a),
+                           _mm256_extractf128_ps(acc1a, 1)),
+        s2 = _mm_add_ps(_mm256_castps256_ps128(acc2a),
+                        _mm256_extractf128_ps(acc2a, 1));
+    s1 = _mm_add_ps(s1, _mm_movehl_ps(s1, s1));
+    s1 = _mm_add_ss(s1, _mm_shuffle_ps(s1, s1, 1));
+    s2 = _mm_add_ps(s2, _mm_movehl_ps(s2, s2));
+    s2 = _mm_add_ss(s2, _mm_shuffle_ps(s2, s2, 1));
+    float sum1 = _mm_cvtss_f32(s1), sum2 = _mm_cvtss_f32(s2);
+    for (; d < dim; d++) {
+      sum1 += mi_row[d] * data[d];
+      sum2 += iv_row[d] * data_sq[d];
+    }
+    loglikes[g] += sum1 - 0.5f * sum2;
+  }
+}
+
+static void FusedGaussianDotsSse2(int32 num_rows, int32 dim,
+                                  const float *mi, int32 mi_stride,
+                                  const float *iv, int32 iv_stride,
+                                  const float *data, const float *data_sq,
+                                  float *loglikes) {
+  for (int32 g = 0; g < num_rows; g++) {
+    const float *mi_row = mi + g * mi_stride,
+        *iv_row = iv + g * iv_stride;
+    __m128 acc1 = _mm_setzero_ps(), acc2 = _mm_setzero_ps();
+    int32 d = 0;
+    for (; d + 4 <= dim; d += 4) {
+      acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(mi_row + d),
+                                         _mm_loadu_ps(data + d)));
+      acc2 = _mm_add_ps(acc2, _mm_mul_ps(_mm_loadu_ps(iv_row + d),
+                                         _mm_loadu_ps(data_sq + d)));
+    }
+    acc1 = _mm_add_ps(acc1, _mm_movehl_ps(acc1, acc1));
+    acc1 = _mm_add_ss(acc1, _mm_shuffle_ps(acc1, acc1, 1));
+    acc2 = _mm_add_ps(acc2, _mm_movehl_ps(acc2, acc2));
+    acc2 = _mm_add_ss(acc2, _mm_shuffle_ps(acc2, acc2, 1));
+    float sum1 = _mm_cvtss_f32(acc1), sum2 = _mm_cvtss_f32(acc2);
+    for (; d < dim; d++) {
+      sum1 += mi_row[d] * data[d];
+      sum2 += iv_row[d] * data_sq[d];
+    }
+    loglikes[g] += sum1 - 0.5f * sum2;
+  }
+}
+
+static void FusedGaussianDots(int32 num_rows, int32 dim,
+                              const float *mi, int32 mi_stride,
+                              const float *iv, int32 iv_stride,
+                              const float *data, const float *data_sq,
+                              float *loglikes) {
+  // one-time runtime dispatch; see base/cpu-features.h.
+  static const bool have_avx2 = (GetCpuSimdLevel() >= kSimdAvx2);
+  if (have_avx2)
+    FusedGaussianDotsAvx2(num_rows, dim, mi, mi_stride, iv, iv_stride,
+                          data, data_sq, loglikes);
+  else
+    FusedGaussianDotsSse2(num_rows, dim, mi, mi_stride, iv, iv_stride,
+                          data, data_sq, loglikes);
+}
+#endif  // KALDI_DIAG_GMM_SIMD
+
 BaseFloat DiagGmm::LogLikelihood(const VectorBase<BaseFloat> &data) const {
   if (!valid_gconsts_)
     KALDI_ERR << "Must call ComputeGconsts() before computing likelihood";
@@ -536,6 +648,15 @@ void DiagGmm::LogLikelihoods(const VectorBase<BaseFloat> &data,
   Vector<BaseFloat> data_sq(data);
   data_sq.ApplyPow(2.0);
 
+#ifdef KALDI_DIAG_GMM_SIMD
+  if (GetCpuSimdLevel() >= kSimdSse2) {  // false only if KALDI_SIMD=generic.
+    FusedGaussianDots(NumGauss(), Dim(),
+                      means_invvars_.Data(), means_invvars_.Stride(),
+                      inv_vars_.Data(), inv_vars_.Stride(),
+                      data.Data(), data_sq.Data(), loglikes->Data());
+    return;
+  }
+#endif
   // loglikes +=  means * inv(vars) * data.
   loglikes->AddMatVec(1.0, means_invvars_, kNoTrans, data, 1.0);
   // loglikes += -0.5 * inv(vars) * data_sq.
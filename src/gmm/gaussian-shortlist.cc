@@ -0,0 +1,148 @@
+// gmm/gaussian-shortlist.cc
+
+// Copyright 2014   Johns Hopkins University
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "gmm/gaussian-shortlist.h"
+
+namespace kaldi {
+
+void GaussianShortlist::Build(const AmDiagGmm &am,
+                              const Vector<BaseFloat> &state_occs,
+                              const GaussianShortlistOptions &opts) {
+  KALDI_ASSERT(opts.num_clusters > 1 && opts.clusters_per_frame > 0 &&
+               opts.clusters_per_frame <= opts.num_clusters);
+  clusters_per_frame_ = opts.clusters_per_frame;
+
+  UbmClusteringOptions ubm_opts(opts.ubm_opts);
+  ubm_opts.ubm_num_gauss = opts.num_clusters;
+  if (ubm_opts.intermediate_num_gauss < ubm_opts.ubm_num_gauss)
+    ubm_opts.intermediate_num_gauss = ubm_opts.ubm_num_gauss;
+  ClusterGaussiansToUbm(am, state_occs, ubm_opts, &cluster_gmm_);
+  int32 num_clusters = cluster_gmm_.NumGauss();
+  if (num_clusters != opts.num_clusters)
+    KALDI_WARN << "Clustering produced " << num_clusters
+               << " clusters vs. " << opts.num_clusters << " requested.";
+
+  // Assign each Gaussian of each pdf to the cluster under which its mean
+  // scores best, and store the per-pdf member lists grouped by cluster.
+  int32 num_pdfs = am.NumPdfs();
+  offsets_.resize(num_pdfs);
+  gauss_ids_.resize(num_pdfs);
+  std::vector<std::vector<int32> > buckets(num_clusters);
+  for (int32 j = 0; j < num_pdfs; j++) {
+    const DiagGmm &pdf = am.GetPdf(j);
+    Matrix<BaseFloat> means;
+    pdf.GetMeans(&means);
+    for (int32 c = 0; c < num_clusters; c++) buckets[c].clear();
+    Vector<BaseFloat> cluster_loglikes;
+    for (int32 i = 0; i < pdf.NumGauss(); i++) {
+      cluster_gmm_.LogLikelihoods(means.Row(i), &cluster_loglikes);
+      MatrixIndexT best_cluster;
+      cluster_loglikes.Max(&best_cluster);
+      buckets[best_cluster].push_back(i);
+    }
+    offsets_[j].resize(num_clusters + 1);
+    gauss_ids_[j].clear();
+    gauss_ids_[j].reserve(pdf.NumGauss());
+    for (int32 c = 0; c < num_clusters; c++) {
+      offsets_[j][c] = static_cast<int32>(gauss_ids_[j].size());
+      gauss_ids_[j].insert(gauss_ids_[j].end(),
+                           buckets[c].begin(), buckets[c].end());
+    }
+    offsets_[j][num_clusters] = static_cast<int32>(gauss_ids_[j].size());
+    KALDI_ASSERT(offsets_[j][num_clusters] == pdf.NumGauss());
+  }
+  KALDI_LOG << "Built Gaussian shortlist with " << num_clusters
+            << " clusters over " << num_pdfs << " pdfs.";
+}
+
+void GaussianShortlist::GetFrameClusters(
+    const VectorBase<BaseFloat> &data, std::vector<int32> *clusters) const {
+  KALDI_ASSERT(clusters_per_frame_ > 0 && "Shortlist not initialized.");
+  Vector<BaseFloat> loglikes;
+  cluster_gmm_.LogLikelihoods(data, &loglikes);
+  int32 num_clusters = loglikes.Dim(),
+      num_keep = std::min(clusters_per_frame_, num_clusters);
+  // Negate the scores so that nth_element's ascending order gives us the
+  // best clusters first.
+  std::vector<std::pair<BaseFloat, int32> > pairs(num_clusters);
+  for (int32 c = 0; c < num_clusters; c++)
+    pairs[c] = std::make_pair(-loglikes(c), c);
+  std::nth_element(pairs.begin(), pairs.begin() + num_keep - 1, pairs.end());
+  clusters->resize(num_keep);
+  for (int32 i = 0; i < num_keep; i++) (*clusters)[i] = pairs[i].second;
+  std::sort(clusters->begin(), clusters->end());
+}
+
+void GaussianShortlist::GetPdfShortlist(
+    int32 pdf_id, const std::vector<int32> &clusters,
+    std::vector<int32> *gauss_ids) const {
+  KALDI_ASSERT(static_cast<size_t>(pdf_id) < offsets_.size());
+  const std::vector<int32> &offsets = offsets_[pdf_id],
+      &ids = gauss_ids_[pdf_id];
+  gauss_ids->clear();
+  for (size_t i = 0; i < clusters.size(); i++) {
+    int32 c = clusters[i];
+    gauss_ids->insert(gauss_ids->end(),
+                      ids.begin() + offsets[c], ids.begin() + offsets[c+1]);
+  }
+  // Sort the result: LogLikelihoodsPreselect() detects contiguous index
+  // ranges (and gets them right) only for sorted input.
+  std::sort(gauss_ids->begin(), gauss_ids->end());
+}
+
+void GaussianShortlist::Write(std::ostream &os, bool binary) const {
+  WriteToken(os, binary, "<GaussianShortlist>");
+  WriteToken(os, binary, "<ClustersPerFrame>");
+  WriteBasicType(os, binary, clusters_per_frame_);
+  cluster_gmm_.Write(os, binary);
+  int32 num_pdfs = NumPdfs();
+  WriteToken(os, binary, "<NumPdfs>");
+  WriteBasicType(os, binary, num_pdfs);
+  for (int32 j = 0; j < num_pdfs; j++) {
+    WriteIntegerVector(os, binary, offsets_[j]);
+    WriteIntegerVector(os, binary, gauss_ids_[j]);
+  }
+  WriteToken(os, binary, "</GaussianShortlist>");
+}
+
+void GaussianShortlist::Read(std::istream &is, bool binary) {
+  ExpectToken(is, binary, "<GaussianShortlist>");
+  ExpectToken(is, binary, "<ClustersPerFrame>");
+  ReadBasicType(is, binary, &clusters_per_frame_);
+  cluster_gmm_.Read(is, binary);
+  int32 num_pdfs;
+  ExpectToken(is, binary, "<NumPdfs>");
+  ReadBasicType(is, binary, &num_pdfs);
+  KALDI_ASSERT(num_pdfs >= 0);
+  offsets_.resize(num_pdfs);
+  gauss_ids_.resize(num_pdfs);
+  for (int32 j = 0; j < num_pdfs; j++) {
+    ReadIntegerVector(is, binary, &(offsets_[j]));
+    ReadIntegerVector(is, binary, &(gauss_ids_[j]));
+    if (offsets_[j].size() != static_cast<size_t>(NumClusters()) + 1)
+      KALDI_ERR << "Corrupt or mismatched GaussianShortlist.";
+  }
+  ExpectToken(is, binary, "</GaussianShortlist>");
+}
+
+}  // namespace kaldi
@@ -0,0 +1,109 @@
+// gmm/gaussian-shortlist.h
+
+// Copyright 2014   Johns Hopkins University
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_GMM_GAUSSIAN_SHORTLIST_H_
+#define KALDI_GMM_GAUSSIAN_SHORTLIST_H_
+
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "gmm/am-diag-gmm.h"
+#include "gmm/diag-gmm.h"
+#include "itf/options-itf.h"
+
+namespace kaldi {
+
+struct GaussianShortlistOptions {
+  int32 num_clusters;        // number of components in the top-level GMM.
+  int32 clusters_per_frame;  // how many of the best-scoring clusters to
+                             // expand exactly on each frame.
+  UbmClusteringOptions ubm_opts;  // controls the clustering itself; its
+                                  // ubm-num-gauss is overridden by
+                                  // num_clusters.
+  GaussianShortlistOptions(): num_clusters(256), clusters_per_frame(10) { }
+  void Register(OptionsItf *opts) {
+    opts->Register("num-clusters", &num_clusters, "Number of components in "
+                   "the top-level clustered GMM used for Gaussian selection.");
+    opts->Register("clusters-per-frame", &clusters_per_frame, "Number of "
+                   "top-level clusters whose member Gaussians are evaluated "
+                   "exactly on each frame; larger is more exact.");
+    ubm_opts.Register(opts);
+  }
+};
+
+/**
+   GaussianShortlist is a Gaussian-selection index for an AmDiagGmm: a small
+   top-level GMM obtained by clustering all the Gaussians of the model, plus,
+   for each pdf, its Gaussians grouped by which cluster they were assigned
+   to.  At decode time the top-level GMM is scored once per frame and the
+   best few clusters are kept; for each pdf only the mixture components
+   belonging to those clusters are then evaluated exactly (see
+   DecodableAmDiagGmmPruned in decodable-am-diag-gmm.h).  This reduces
+   acoustic scoring cost roughly by the fraction of Gaussians shortlisted.
+
+   The index depends only on the model, so it is built once offline (see
+   gmm-make-shortlist) and stored alongside the model with the usual
+   Read/Write mechanisms.  It is immutable at decode time and can be shared
+   between decoding threads.
+ */
+class GaussianShortlist {
+ public:
+  GaussianShortlist(): clusters_per_frame_(0) { }
+
+  // Builds the index; "state_occs" are the per-pdf occupation counts (as
+  // output by gmm-est), needed by the Gaussian clustering.
+  void Build(const AmDiagGmm &am, const Vector<BaseFloat> &state_occs,
+             const GaussianShortlistOptions &opts);
+
+  void Write(std::ostream &os, bool binary) const;
+  void Read(std::istream &is, bool binary);
+
+  int32 NumPdfs() const { return static_cast<int32>(offsets_.size()); }
+  int32 NumClusters() const { return cluster_gmm_.NumGauss(); }
+  int32 ClustersPerFrame() const { return clusters_per_frame_; }
+
+  // Scores the top-level GMM on "data" and outputs the indices of the
+  // clusters_per_frame_ best clusters, in ascending order.
+  void GetFrameClusters(const VectorBase<BaseFloat> &data,
+                        std::vector<int32> *clusters) const;
+
+  // Outputs, in ascending order, the Gaussian indices of pdf "pdf_id" that
+  // belong to any of the given clusters (each index appears at most once,
+  // since each Gaussian has exactly one cluster).  The output may be empty,
+  // in which case the caller should fall back to evaluating the pdf in
+  // full.
+  void GetPdfShortlist(int32 pdf_id, const std::vector<int32> &clusters,
+                       std::vector<int32> *gauss_ids) const;
+
+ private:
+  DiagGmm cluster_gmm_;       // the small top-level GMM.
+  int32 clusters_per_frame_;  // stored so decoding uses the setting the
+                              // index was built (or overridden) with.
+  // Per pdf, its Gaussian indices grouped by assigned cluster, in CSR form:
+  // for pdf j, the Gaussians of cluster c are
+  // gauss_ids_[j][offsets_[j][c] ... offsets_[j][c+1]).
+  std::vector<std::vector<int32> > offsets_;    // each of size NumClusters()+1.
+  std::vector<std::vector<int32> > gauss_ids_;  // each of size NumGauss(j).
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(GaussianShortlist);
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_GMM_GAUSSIAN_SHORTLIST_H_
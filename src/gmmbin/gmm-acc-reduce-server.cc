@@ -0,0 +1,206 @@
+// gmmbin/gmm-acc-reduce-server.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "util/common-utils.h"
+#include "gmm/mle-am-diag-gmm.h"
+#include "hmm/transition-model.h"
+
+namespace kaldi {
+
+// Creates a TCP socket listening on "port" and returns its descriptor.
+static int32 ListenOnPort(int32 port, int32 backlog) {
+  int32 server_desc = socket(AF_INET, SOCK_STREAM, 0);
+  if (server_desc == -1)
+    KALDI_ERR << "Cannot create TCP socket!";
+  int32 flag = 1;
+  if (setsockopt(server_desc, SOL_SOCKET, SO_REUSEADDR,
+                 &flag, sizeof(flag)) == -1)
+    KALDI_ERR << "Cannot set socket options!";
+  struct sockaddr_in h_addr;
+  memset(&h_addr, 0, sizeof(h_addr));
+  h_addr.sin_family = AF_INET;
+  h_addr.sin_addr.s_addr = INADDR_ANY;
+  h_addr.sin_port = htons(port);
+  if (bind(server_desc, (struct sockaddr*) &h_addr, sizeof(h_addr)) == -1)
+    KALDI_ERR << "Cannot bind to port: " << port << " (is it taken?)";
+  if (listen(server_desc, backlog) == -1)
+    KALDI_ERR << "Cannot listen on port!";
+  return server_desc;
+}
+
+// Reads from the socket until the peer half-closes it, returning the bytes.
+static void RecvAll(int32 sock_desc, std::string *data) {
+  char buf[65536];
+  data->clear();
+  while (true) {
+    ssize_t ret = recv(sock_desc, buf, sizeof(buf), 0);
+    if (ret < 0)
+      KALDI_ERR << "recv() from worker failed after " << data->size()
+                << " bytes.";
+    if (ret == 0)
+      return;
+    data->append(buf, ret);
+  }
+}
+
+// These two are shared with gmm-send-accs.cc in spirit; they are small
+// enough that we keep a copy in each binary, like the onlinebin programs do.
+static int32 ConnectToServer(const std::string &host,
+                             const std::string &port) {
+  addrinfo hints, *server_addr;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_protocol = IPPROTO_TCP;
+  if (getaddrinfo(host.c_str(), port.c_str(), &hints, &server_addr) != 0)
+    KALDI_ERR << "getaddrinfo() failed for " << host << ":" << port;
+  int32 sock_desc = socket(server_addr->ai_family, server_addr->ai_socktype,
+                           server_addr->ai_protocol);
+  if (sock_desc == -1)
+    KALDI_ERR << "socket() call failed!";
+  if (connect(sock_desc, server_addr->ai_addr, server_addr->ai_addrlen) == -1)
+    KALDI_ERR << "Cannot connect to " << host << ":" << port
+              << " (is the parent reduce server running?)";
+  freeaddrinfo(server_addr);
+  return sock_desc;
+}
+
+static void SendAll(int32 sock_desc, const std::string &data) {
+  size_t num_sent = 0;
+  while (num_sent < data.size()) {
+    ssize_t ret = send(sock_desc, data.data() + num_sent,
+                       data.size() - num_sent, 0);
+    if (ret <= 0)
+      KALDI_ERR << "send() to parent server failed after " << num_sent
+                << " of " << data.size() << " bytes.";
+    num_sent += ret;
+  }
+}
+
+}  // namespace kaldi
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    typedef kaldi::int32 int32;
+
+    const char *usage =
+        "Accept accumulated stats for GMM training over TCP (sent by\n"
+        "gmm-send-accs) and merge them in memory, avoiding the per-iteration\n"
+        "round-trip of acc files through the filesystem.  The program exits\n"
+        "after <num-workers> connections have been merged; the merged stats\n"
+        "are written to <stats-out>, or forwarded to another\n"
+        "gmm-acc-reduce-server if --parent-host is given, so reducers can be\n"
+        "arranged in a tree for large jobs.  Each connection is acknowledged\n"
+        "only after its stats have been added, so a worker whose\n"
+        "gmm-send-accs exited with status zero is known to be counted.\n"
+        "Usage: gmm-acc-reduce-server [options] <num-workers> [<stats-out>]\n"
+        "E.g.: gmm-acc-reduce-server --port=6270 16 1.acc\n"
+        " or: gmm-acc-reduce-server --port=6270 --parent-host=reducer01 "
+        "--parent-port=6270 16\n"
+        "See also: gmm-send-accs, gmm-sum-accs\n";
+
+    bool binary = true;
+    int32 port = 6270;
+    std::string parent_host, parent_port = "6270";
+    ParseOptions po(usage);
+    po.Register("binary", &binary, "Write output in binary mode");
+    po.Register("port", &port, "TCP port to listen on");
+    po.Register("parent-host", &parent_host, "If set, forward the merged "
+                "stats to a gmm-acc-reduce-server on this host instead of "
+                "writing them locally");
+    po.Register("parent-port", &parent_port,
+                "Port of the parent reduce server");
+    po.Read(argc, argv);
+
+    if (po.NumArgs() < 1 || po.NumArgs() > 2) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    int32 num_workers = 0;
+    if (!ConvertStringToInteger(po.GetArg(1), &num_workers) ||
+        num_workers <= 0)
+      KALDI_ERR << "Bad <num-workers>: " << po.GetArg(1);
+    std::string stats_out_filename = po.GetOptArg(2);
+    if (stats_out_filename.empty() && parent_host.empty())
+      KALDI_ERR << "Either <stats-out> or --parent-host must be given, "
+                << "or the merged stats would go nowhere.";
+
+    Vector<double> transition_accs;
+    AccumAmDiagGmm gmm_accs;
+
+    int32 server_desc = ListenOnPort(port, num_workers);
+    KALDI_LOG << "Listening on port " << port << ", waiting for "
+              << num_workers << " worker(s).";
+    std::string data;
+    for (int32 i = 0; i < num_workers; i++) {
+      int32 client_desc = accept(server_desc, NULL, NULL);
+      if (client_desc == -1)
+        KALDI_ERR << "accept() failed!";
+      RecvAll(client_desc, &data);
+      std::istringstream is(data);
+      bool binary_read;
+      if (!InitKaldiInputStream(is, &binary_read))
+        KALDI_ERR << "Malformed stats from worker " << (i + 1)
+                  << " (" << data.size() << " bytes).";
+      transition_accs.Read(is, binary_read, true /*add read values*/);
+      gmm_accs.Read(is, binary_read, true /*add read values*/);
+      char ack = 'K';  // acknowledge only after a successful merge.
+      if (send(client_desc, &ack, 1, 0) != 1)
+        KALDI_WARN << "Could not acknowledge worker " << (i + 1);
+      close(client_desc);
+      KALDI_VLOG(1) << "Merged stats from worker " << (i + 1) << " of "
+                    << num_workers << " (" << data.size() << " bytes).";
+    }
+    close(server_desc);
+
+    if (!parent_host.empty()) {
+      std::ostringstream os;
+      InitKaldiOutputStream(os, true /*binary*/);
+      transition_accs.Write(os, true);
+      gmm_accs.Write(os, true);
+      int32 sock_desc = ConnectToServer(parent_host, parent_port);
+      SendAll(sock_desc, os.str());
+      shutdown(sock_desc, SHUT_WR);
+      char ack;
+      if (recv(sock_desc, &ack, 1, 0) != 1 || ack != 'K')
+        KALDI_ERR << "Parent reduce server did not acknowledge the stats.";
+      close(sock_desc);
+      KALDI_LOG << "Forwarded merged stats to " << parent_host << ":"
+                << parent_port;
+    } else {
+      Output ko(stats_out_filename, binary);
+      transition_accs.Write(ko.Stream(), binary);
+      gmm_accs.Write(ko.Stream(), binary);
+      KALDI_LOG << "Written stats to " << stats_out_filename;
+    }
+    KALDI_LOG << "Summed " << num_workers << " stats, total count "
+              << gmm_accs.TotCount() << ", avg like/frame "
+              << (gmm_accs.TotLogLike() / gmm_accs.TotCount());
+  } catch(const std::exception &e) {
+    std::cerr << e.what() << '\n';
+    return -1;
+  }
+}
@@ -23,8 +23,73 @@
 #include "gmm/am-diag-gmm.h"
 #include "hmm/transition-model.h"
 #include "gmm/mle-am-diag-gmm.h"
-
-
+#include "thread/kaldi-task-sequence.h"
+#include "thread/kaldi-mutex.h"
+
+namespace kaldi {
+
+// This class runs the accumulation for one utterance; it is used to support
+// multi-threaded operation (--num-threads option).  Each task accumulates
+// into one of a pool of accumulators, each with its own lock (the pool has
+// one entry per thread, so the threads will rarely contend); the pool gets
+// summed up after all utterances are processed.
+class AccStatsAliTask {
+ public:
+  AccStatsAliTask(const AmDiagGmm &am_gmm,
+                  const TransitionModel &trans_model,
+                  const std::string &utt,
+                  const Matrix<BaseFloat> &feats,
+                  const std::vector<int32> &alignment,
+                  int32 utt_index,
+                  Mutex *mutex,
+                  AccumAmDiagGmm *gmm_accs,
+                  Vector<double> *transition_accs,
+                  double *tot_like,
+                  int64 *tot_t):
+      am_gmm_(am_gmm), trans_model_(trans_model), utt_(utt),
+      feats_(feats),  // copy, since the reference from the Table code is not
+                      // valid long-term.
+      alignment_(alignment), utt_index_(utt_index), mutex_(mutex),
+      gmm_accs_(gmm_accs), transition_accs_(transition_accs),
+      tot_like_(tot_like), tot_t_(tot_t) { }
+
+  void operator () () {
+    BaseFloat tot_like_this_file = 0.0;
+    mutex_->Lock();
+    for (size_t i = 0; i < alignment_.size(); i++) {
+      int32 tid = alignment_[i],  // transition identifier.
+          pdf_id = trans_model_.TransitionIdToPdf(tid);
+      trans_model_.Accumulate(1.0, tid, transition_accs_);
+      tot_like_this_file += gmm_accs_->AccumulateForGmm(am_gmm_,
+                                                        feats_.Row(i),
+                                                        pdf_id, 1.0);
+    }
+    *tot_like_ += tot_like_this_file;
+    *tot_t_ += alignment_.size();
+    mutex_->Unlock();
+    if ((utt_index_ + 1) % 50 == 0) {
+      KALDI_LOG << "Processed " << (utt_index_ + 1) << " utterances; for "
+                << "utterance " << utt_ << " avg. like is "
+                << (tot_like_this_file/alignment_.size())
+                << " over " << alignment_.size() <<" frames.";
+    }
+  }
+  ~AccStatsAliTask() { }  // the destructor doesn't have to do anything.
+ private:
+  const AmDiagGmm &am_gmm_;
+  const TransitionModel &trans_model_;
+  std::string utt_;
+  Matrix<BaseFloat> feats_;
+  std::vector<int32> alignment_;
+  int32 utt_index_;
+  Mutex *mutex_;  // guards the four pointers below.
+  AccumAmDiagGmm *gmm_accs_;
+  Vector<double> *transition_accs_;
+  double *tot_like_;
+  int64 *tot_t_;
+};
+
+}  // namespace kaldi
 
 
 int main(int argc, char *argv[]) {
@@ -33,13 +98,20 @@ int main(int argc, char *argv[]) {
   try {
     const char *usage =
         "Accumulate stats for GMM training.\n"
+        "Supports multiple threads (--num-threads); the utterances are "
+        "processed in parallel\n"
+        "and the stats summed at the end, so one multi-threaded process can "
+        "replace several\n"
+        "single-threaded ones plus gmm-sum-accs.\n"
         "Usage:  gmm-acc-stats-ali [options] <model-in> <feature-rspecifier> "
         "<alignments-rspecifier> <stats-out>\n"
         "e.g.:\n gmm-acc-stats-ali 1.mdl scp:train.scp ark:1.ali 1.acc\n";
 
     ParseOptions po(usage);
     bool binary = true;
+    TaskSequencerConfig sequencer_opts;  // has --num-threads option.
     po.Register("binary", &binary, "Write output in binary mode");
+    sequencer_opts.Register(&po);
     po.Read(argc, argv);
 
     if (po.NumArgs() != 4) {
@@ -61,53 +133,65 @@ int main(int argc, char *argv[]) {
       am_gmm.Read(ki.Stream(), binary);
     }
 
-    Vector<double> transition_accs;
-    trans_model.InitStats(&transition_accs);
-    AccumAmDiagGmm gmm_accs;
-    gmm_accs.Init(am_gmm, kGmmAll);
-
-    double tot_like = 0.0;
-    kaldi::int64 tot_t = 0;
+    // A pool of accumulators, one per thread, each with its own lock; the
+    // threads accumulate into these (mostly without contending) and we sum
+    // them up at the end.
+    int32 num_accs = std::max(1, sequencer_opts.num_threads);
+    std::vector<AccumAmDiagGmm*> gmm_accs(num_accs);
+    std::vector<Vector<double>*> transition_accs(num_accs);
+    std::vector<Mutex*> mutexes(num_accs);
+    std::vector<double> tot_likes(num_accs, 0.0);
+    std::vector<kaldi::int64> tot_ts(num_accs, 0);
+    for (int32 i = 0; i < num_accs; i++) {
+      gmm_accs[i] = new AccumAmDiagGmm();
+      gmm_accs[i]->Init(am_gmm, kGmmAll);
+      transition_accs[i] = new Vector<double>();
+      trans_model.InitStats(transition_accs[i]);
+      mutexes[i] = new Mutex();
+    }
 
     SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
     RandomAccessInt32VectorReader alignments_reader(alignments_rspecifier);
 
     int32 num_done = 0, num_err = 0;
-    for (; !feature_reader.Done(); feature_reader.Next()) {
-      std::string key = feature_reader.Key();
-      if (!alignments_reader.HasKey(key)) {
-        KALDI_WARN << "No alignment for utterance " << key;
-        num_err++;
-      } else {
-        const Matrix<BaseFloat> &mat = feature_reader.Value();
-        const std::vector<int32> &alignment = alignments_reader.Value(key);
-
-        if (alignment.size() != mat.NumRows()) {
-          KALDI_WARN << "Alignments has wrong size " << (alignment.size())
-                     << " vs. " << (mat.NumRows());
+    {
+      TaskSequencer<AccStatsAliTask> sequencer(sequencer_opts);
+      for (; !feature_reader.Done(); feature_reader.Next()) {
+        std::string key = feature_reader.Key();
+        if (!alignments_reader.HasKey(key)) {
+          KALDI_WARN << "No alignment for utterance " << key;
           num_err++;
-          continue;
-        }
-
-        num_done++;
-        BaseFloat tot_like_this_file = 0.0;
-
-        for (size_t i = 0; i < alignment.size(); i++) {
-          int32 tid = alignment[i],  // transition identifier.
-              pdf_id = trans_model.TransitionIdToPdf(tid);
-          trans_model.Accumulate(1.0, tid, &transition_accs);
-          tot_like_this_file += gmm_accs.AccumulateForGmm(am_gmm, mat.Row(i),
-                                                          pdf_id, 1.0);
-        }
-        tot_like += tot_like_this_file;
-        tot_t += alignment.size();
-        if (num_done % 50 == 0) {
-          KALDI_LOG << "Processed " << num_done << " utterances; for utterance "
-                    << key << " avg. like is "
-                    << (tot_like_this_file/alignment.size())
-                    << " over " << alignment.size() <<" frames.";
+        } else {
+          const Matrix<BaseFloat> &mat = feature_reader.Value();
+          const std::vector<int32> &alignment = alignments_reader.Value(key);
+
+          if (alignment.size() != mat.NumRows()) {
+            KALDI_WARN << "Alignments has wrong size " << (alignment.size())
+                       << " vs. " << (mat.NumRows());
+            num_err++;
+            continue;
+          }
+
+          int32 a = num_done % num_accs;  // which accumulator to use.
+          sequencer.Run(new AccStatsAliTask(am_gmm, trans_model, key, mat,
+                                            alignment, num_done, mutexes[a],
+                                            gmm_accs[a], transition_accs[a],
+                                            &(tot_likes[a]), &(tot_ts[a])));
+          num_done++;
         }
       }
+      // destructor of "sequencer" waits for all tasks to finish.
+    }
+
+    double tot_like = 0.0;
+    kaldi::int64 tot_t = 0;
+    for (int32 i = 1; i < num_accs; i++) {
+      gmm_accs[0]->Add(1.0, *(gmm_accs[i]));
+      transition_accs[0]->AddVec(1.0, *(transition_accs[i]));
+    }
+    for (int32 i = 0; i < num_accs; i++) {
+      tot_like += tot_likes[i];
+      tot_t += tot_ts[i];
     }
     KALDI_LOG << "Done " << num_done << " files, " << num_err
               << " with errors.";
@@ -117,8 +201,13 @@ int main(int argc, char *argv[]) {
 
     {
       Output ko(accs_wxfilename, binary);
-      transition_accs.Write(ko.Stream(), binary);
-      gmm_accs.Write(ko.Stream(), binary);
+      transition_accs[0]->Write(ko.Stream(), binary);
+      gmm_accs[0]->Write(ko.Stream(), binary);
+    }
+    for (int32 i = 0; i < num_accs; i++) {
+      delete gmm_accs[i];
+      delete transition_accs[i];
+      delete mutexes[i];
     }
     KALDI_LOG << "Written accs.";
     if (num_done != 0)
@@ -78,6 +78,10 @@ int main(int argc, char *argv[]) {
     SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
     RandomAccessPosteriorReader posteriors_reader(posteriors_rspecifier);
 
+    // declared outside the loop so their buffers get re-used across
+    // utterances.
+    FlatPosterior flat_posterior, pdf_posterior;
+
     int32 num_done = 0, num_err = 0;
     for (; !feature_reader.Done(); feature_reader.Next()) {
       std::string key = feature_reader.Key();
@@ -99,22 +103,26 @@ int main(int argc, char *argv[]) {
         num_done++;
         BaseFloat tot_like_this_file = 0.0, tot_weight = 0.0;
 
-        Posterior pdf_posterior;
-        ConvertPosteriorToPdfs(trans_model, posterior, &pdf_posterior);
-        for (size_t i = 0; i < posterior.size(); i++) {
+        flat_posterior.CopyFromPosterior(posterior);
+        ConvertFlatPosteriorToPdfs(trans_model, flat_posterior, &pdf_posterior);
+        for (int32 i = 0; i < flat_posterior.NumFrames(); i++) {
           // Accumulates for GMM.
-          for (size_t j = 0; j < pdf_posterior[i].size(); j++) {
-            int32 pdf_id = pdf_posterior[i][j].first;
-            BaseFloat weight = pdf_posterior[i][j].second;
+          const std::pair<int32, BaseFloat> *pdf_post =
+              pdf_posterior.FrameData(i);
+          for (int32 j = 0; j < pdf_posterior.FrameSize(i); j++) {
+            int32 pdf_id = pdf_post[j].first;
+            BaseFloat weight = pdf_post[j].second;
             tot_like_this_file += gmm_accs.AccumulateForGmm(am_gmm, mat.Row(i), pdf_id, weight)
                 * weight;
             tot_weight += weight;
           }
 
           // Accumulates for transitions.
-          for (size_t j = 0; j < posterior[i].size(); j++) {
-            int32 tid = posterior[i][j].first;
-            BaseFloat weight = posterior[i][j].second;
+          const std::pair<int32, BaseFloat> *tid_post =
+              flat_posterior.FrameData(i);
+          for (int32 j = 0; j < flat_posterior.FrameSize(i); j++) {
+            int32 tid = tid_post[j].first;
+            BaseFloat weight = tid_post[j].second;
             trans_model.Accumulate(weight, tid, &transition_accs);
           }
         }
@@ -20,12 +20,65 @@
 
 #include "base/kaldi-common.h"
 #include "util/common-utils.h"
+#include "util/kaldi-daemon.h"
 #include "gmm/am-diag-gmm.h"
 #include "hmm/transition-model.h"
 #include "fstext/fstext-lib.h"
 #include "base/timer.h"
 
+namespace kaldi {
+
+// Computes log-likelihoods for all utterances in the rspecifier with the
+// given (already-loaded) model; the per-request work of this program.
+int ComputeLikes(const AmDiagGmm &am_gmm,
+                 const std::string &feature_rspecifier,
+                 const std::string &loglikes_wspecifier) {
+  BaseFloatMatrixWriter loglikes_writer(loglikes_wspecifier);
+  SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
+
+  int32 num_done = 0;
+  for (; !feature_reader.Done(); feature_reader.Next()) {
+    std::string key = feature_reader.Key();
+    const Matrix<BaseFloat> &features (feature_reader.Value());
+    Matrix<BaseFloat> loglikes(features.NumRows(), am_gmm.NumPdfs());
+    for (int32 i = 0; i < features.NumRows(); i++) {
+      for (int32 j = 0; j < am_gmm.NumPdfs(); j++) {
+        SubVector<BaseFloat> feat_row(features, i);
+        loglikes(i, j) = am_gmm.LogLikelihood(j, feat_row);
+      }
+    }
+    loglikes_writer.Write(key, loglikes);
+    num_done++;
+  }
+
+  KALDI_LOG << "gmm-compute-likes: computed likelihoods for " << num_done
+            << " utterances.";
+  return 0;
+}
+
+// Handler for daemon mode (see util/kaldi-daemon.h): parses one request's
+// arguments and runs ComputeLikes() with the model loaded at startup.
+int ComputeLikesHandler(int argc, char **argv, void *user_data) {
+  try {
+    const char *usage =
+        "Compute log-likelihoods from the GMM-based model that this daemon\n"
+        "loaded at startup.\n"
+        "Usage (via kaldi-daemon-client): features-rspecifier likes-wspecifier\n";
+    ParseOptions po(usage);
+    po.Read(argc, argv);
+    if (po.NumArgs() != 2) {
+      po.PrintUsage();
+      return 1;
+    }
+    const AmDiagGmm &am_gmm = *static_cast<const AmDiagGmm*>(user_data);
+    return ComputeLikes(am_gmm, po.GetArg(1), po.GetArg(2));
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
 
+}  // namespace kaldi
 
 int main(int argc, char *argv[]) {
   try {
@@ -38,19 +91,27 @@ int main(int argc, char *argv[]) {
     const char *usage =
         "Compute log-likelihoods from GMM-based model\n"
         "(outputs matrices of log-likelihoods indexed by (frame, pdf)\n"
-        "Usage: gmm-compute-likes [options] model-in features-rspecifier likes-wspecifier\n";
+        "Usage: gmm-compute-likes [options] model-in features-rspecifier likes-wspecifier\n"
+        "With --daemon-socket the rspecifier and wspecifier are omitted:\n"
+        "the program loads the model once and then serves\n"
+        "\"features-rspecifier likes-wspecifier\" requests sent via\n"
+        "kaldi-daemon-client, avoiding the per-invocation startup cost.\n";
     ParseOptions po(usage);
 
+    std::string daemon_socket;
+    po.Register("daemon-socket", &daemon_socket, "If set, run as a daemon: "
+                "load the model, then serve requests over a Unix-domain "
+                "socket at this path until kaldi-daemon-client sends "
+                "--daemon-shutdown.");
+
     po.Read(argc, argv);
 
-    if (po.NumArgs() != 3) {
+    if (po.NumArgs() != (daemon_socket.empty() ? 3 : 1)) {
       po.PrintUsage();
       exit(1);
     }
 
-    std::string model_in_filename = po.GetArg(1),
-        feature_rspecifier = po.GetArg(2),
-        loglikes_wspecifier = po.GetArg(3);
+    std::string model_in_filename = po.GetArg(1);
 
     AmDiagGmm am_gmm;
     {
@@ -61,31 +122,12 @@ int main(int argc, char *argv[]) {
       am_gmm.Read(ki.Stream(), binary);
     }
 
-    BaseFloatMatrixWriter loglikes_writer(loglikes_wspecifier);
-    SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
-
-    int32 num_done = 0;
-    for (; !feature_reader.Done(); feature_reader.Next()) {
-      std::string key = feature_reader.Key();
-      const Matrix<BaseFloat> &features (feature_reader.Value());
-      Matrix<BaseFloat> loglikes(features.NumRows(), am_gmm.NumPdfs());
-      for (int32 i = 0; i < features.NumRows(); i++) {
-        for (int32 j = 0; j < am_gmm.NumPdfs(); j++) {
-          SubVector<BaseFloat> feat_row(features, i);
-          loglikes(i, j) = am_gmm.LogLikelihood(j, feat_row);
-        }
-      }
-      loglikes_writer.Write(key, loglikes);
-      num_done++;
-    }
+    if (!daemon_socket.empty())
+      return RunDaemonServer(daemon_socket, &ComputeLikesHandler, &am_gmm);
 
-    KALDI_LOG << "gmm-compute-likes: computed likelihoods for " << num_done
-              << " utterances.";
-    return 0;
+    return ComputeLikes(am_gmm, po.GetArg(2), po.GetArg(3));
   } catch(const std::exception &e) {
     std::cerr << e.what();
     return -1;
   }
 }
-
-
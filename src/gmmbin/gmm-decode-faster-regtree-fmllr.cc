@@ -234,10 +234,7 @@ int main(int argc, char *argv[]) {
         Matrix<BaseFloat> xformed_features(features);
         Matrix<BaseFloat> fmllr_matrix;
         fmllr.GetXformMatrix(0, &fmllr_matrix);
-        for (int32 i = 0; i < xformed_features.NumRows(); i++) {
-          SubVector<BaseFloat> row(xformed_features, i);
-          ApplyAffineTransform(fmllr_matrix, &row);
-        }
+        ApplyAffineTransform(fmllr_matrix, &xformed_features);
         kaldi::DecodableAmDiagGmmScaled gmm_decodable(am_gmm, trans_model,
                                                       xformed_features,
                                                       acoustic_scale);
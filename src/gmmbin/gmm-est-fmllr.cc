@@ -30,6 +30,7 @@ using std::vector;
 #include "hmm/transition-model.h"
 #include "transform/fmllr-diag-gmm.h"
 #include "hmm/posterior.h"
+#include "thread/kaldi-task-sequence.h"
 
 namespace kaldi {
 void AccumulateForUtterance(const Matrix<BaseFloat> &feats,
@@ -49,6 +50,51 @@ void AccumulateForUtterance(const Matrix<BaseFloat> &feats,
   }
 }
 
+// This class parallelizes the estimation of the transforms over speakers (or
+// utterances), once their stats have been accumulated: the iterative Update()
+// happens in the operator (), and the transform is written out in the
+// destructor, which TaskSequencer calls in order, on a single thread.  The
+// accumulation itself stays on the main thread as the table readers are not
+// thread safe.
+class FmllrEstTask {
+ public:
+  FmllrEstTask(const std::string &key,
+               const FmllrDiagGmmAccs &stats,  // makes a copy of this.
+               const FmllrOptions &opts,
+               int32 dim,
+               const char *key_type,  // "speaker" or "utterance", for logging.
+               BaseFloatMatrixWriter *transform_writer,
+               double *tot_impr,
+               double *tot_t):
+      key_(key), stats_(stats), opts_(opts), dim_(dim), key_type_(key_type),
+      transform_writer_(transform_writer), tot_impr_(tot_impr),
+      tot_t_(tot_t) { }
+
+  void operator () () {
+    transform_.Resize(dim_, dim_ + 1);
+    transform_.SetUnit();
+    stats_.Update(opts_, &transform_, &impr_, &t_);
+  }
+
+  ~FmllrEstTask() {
+    transform_writer_->Write(key_, transform_);
+    KALDI_LOG << "For " << key_type_ << " " << key_ << ", auxf-impr from "
+              << "fMLLR is " << (impr_/t_) << ", over " << t_ << " frames.";
+    *tot_impr_ += impr_;
+    *tot_t_ += t_;
+  }
+ private:
+  std::string key_;
+  FmllrDiagGmmAccs stats_;
+  FmllrOptions opts_;
+  int32 dim_;
+  const char *key_type_;
+  BaseFloatMatrixWriter *transform_writer_;
+  double *tot_impr_;
+  double *tot_t_;
+  Matrix<BaseFloat> transform_;
+  BaseFloat impr_, t_;
+};
 
 }
 
@@ -65,10 +111,12 @@ int main(int argc, char *argv[]) {
 
     ParseOptions po(usage);
     FmllrOptions fmllr_opts;
+    TaskSequencerConfig sequencer_config;  // has --num-threads option
     string spk2utt_rspecifier;
     po.Register("spk2utt", &spk2utt_rspecifier, "rspecifier for speaker to "
                 "utterance-list map");
     fmllr_opts.Register(&po);
+    sequencer_config.Register(&po);
 
     po.Read(argc, argv);
 
@@ -102,6 +150,7 @@ int main(int argc, char *argv[]) {
     if (spk2utt_rspecifier != "") {  // per-speaker adaptation
       SequentialTokenVectorReader spk2utt_reader(spk2utt_rspecifier);
       RandomAccessBaseFloatMatrixReader feature_reader(feature_rspecifier);
+      TaskSequencer<FmllrEstTask> sequencer(sequencer_config);
 
       for (; !spk2utt_reader.Done(); spk2utt_reader.Next()) {
         FmllrDiagGmmAccs spk_stats(am_gmm.Dim(), fmllr_opts);
@@ -133,20 +182,17 @@ int main(int argc, char *argv[]) {
           num_done++;
         }  // end looping over all utterances of the current speaker
 
-        BaseFloat impr, spk_tot_t;
-        {  // Compute the transform and write it out.
-          Matrix<BaseFloat> transform(am_gmm.Dim(), am_gmm.Dim()+1);
-          transform.SetUnit();
-          spk_stats.Update(fmllr_opts, &transform, &impr, &spk_tot_t);
-          transform_writer.Write(spk, transform);
-        }
-        KALDI_LOG << "For speaker " << spk << ", auxf-impr from fMLLR is "
-                  << (impr/spk_tot_t) << ", over " << spk_tot_t << " frames.";
-        tot_impr += impr;
-        tot_t += spk_tot_t;
+        // Compute the transform on one of the sequencer's threads; the
+        // task's destructor writes it out and updates the totals.
+        sequencer.Run(new FmllrEstTask(spk, spk_stats, fmllr_opts,
+                                       am_gmm.Dim(), "speaker",
+                                       &transform_writer,
+                                       &tot_impr, &tot_t));
       }  // end looping over speakers
+      sequencer.Wait();
     } else {  // per-utterance adaptation
       SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
+      TaskSequencer<FmllrEstTask> sequencer(sequencer_config);
       for (; !feature_reader.Done(); feature_reader.Next()) {
         string utt = feature_reader.Key();
         if (!post_reader.HasKey(utt)) {
@@ -171,18 +217,12 @@ int main(int argc, char *argv[]) {
         AccumulateForUtterance(feats, post, trans_model, am_gmm,
                                &spk_stats);
 
-        BaseFloat impr, utt_tot_t;
-        {  // Compute the transform and write it out.
-          Matrix<BaseFloat> transform(am_gmm.Dim(), am_gmm.Dim()+1);
-          transform.SetUnit();
-          spk_stats.Update(fmllr_opts, &transform, &impr, &utt_tot_t);
-          transform_writer.Write(utt, transform);
-        }
-        KALDI_LOG << "For utterance " << utt << ", auxf-impr from fMLLR is "
-                  << (impr/utt_tot_t) << ", over " << utt_tot_t << " frames.";
-        tot_impr += impr;
-        tot_t += utt_tot_t;
+        sequencer.Run(new FmllrEstTask(utt, spk_stats, fmllr_opts,
+                                       am_gmm.Dim(), "utterance",
+                                       &transform_writer,
+                                       &tot_impr, &tot_t));
       }
+      sequencer.Wait();
     }
 
     KALDI_LOG << "Done " << num_done << " files, " << num_no_post
@@ -161,14 +161,32 @@ int main(int argc, char *argv[]) {
     bool allow_partial = false;
     BaseFloat acoustic_scale = 0.1;
     LatticeBiglmFasterDecoderConfig config;
-    
+
     std::string word_syms_filename;
     config.Register(&po);
     po.Register("acoustic-scale", &acoustic_scale, "Scaling factor for acoustic likelihoods");
 
     po.Register("word-symbol-table", &word_syms_filename, "Symbol table for words [for debug output]");
     po.Register("allow-partial", &allow_partial, "If true, produce output even if end state was not reached.");
-    
+    bool use_lookahead = false;
+    int32 lookahead_max_labels = 100;
+    std::string read_lookahead, write_lookahead;
+    po.Register("use-lm-lookahead", &use_lookahead, "If true, build a "
+                "label-lookahead index over the decoding graph and use it to "
+                "prune (graph-state, LM-state) expansions during decoding; "
+                "see biglm-lookahead.h.  Only supported when the decoding "
+                "graph is a single FST.");
+    po.Register("read-lm-lookahead", &read_lookahead, "File to read a "
+                "precomputed lookahead index from (as written by "
+                "--write-lm-lookahead); implies --use-lm-lookahead.");
+    po.Register("write-lm-lookahead", &write_lookahead, "File to write the "
+                "lookahead index to, for reuse by later runs on the same "
+                "decoding graph.");
+    po.Register("lm-lookahead-max-labels", &lookahead_max_labels, "Maximum "
+                "size of the reachable-word sets in the lookahead index; "
+                "graph states with more reachable words are not checked "
+                "against the LM.");
+
     po.Read(argc, argv);
 
     if (po.NumArgs() < 6 || po.NumArgs() > 8) {
@@ -233,9 +251,29 @@ int main(int argc, char *argv[]) {
       // Input FST is just one FST, not a table of FSTs.
       VectorFst<StdArc> *decode_fst = fst::ReadFstKaldi(fst_in_str);
 
+      BiglmLookahead *lookahead = NULL;
+      if (read_lookahead != "") {
+        lookahead = new BiglmLookahead();
+        bool binary;
+        Input ki(read_lookahead, &binary);
+        lookahead->Read(ki.Stream(), binary);
+        if (lookahead->NumStates() != decode_fst->NumStates())
+          KALDI_ERR << "Lookahead index " << read_lookahead << " has "
+                    << lookahead->NumStates() << " states but the decoding "
+                    << "graph has " << decode_fst->NumStates()
+                    << "; it was built from a different FST.";
+      } else if (use_lookahead || write_lookahead != "") {
+        lookahead = new BiglmLookahead(*decode_fst, lookahead_max_labels);
+      }
+      if (lookahead != NULL && write_lookahead != "") {
+        Output ko(write_lookahead, true);
+        lookahead->Write(ko.Stream(), true);
+      }
+
       {
         LatticeBiglmFasterDecoder decoder(*decode_fst, config, &cache_dfst);
-    
+        decoder.SetLookahead(lookahead);
+
         for (; !feature_reader.Done(); feature_reader.Next()) {
           std::string utt = feature_reader.Key();
           Matrix<BaseFloat> features (feature_reader.Value());
@@ -263,7 +301,11 @@ int main(int argc, char *argv[]) {
         }
       }
       delete decode_fst; // delete this only after decoder goes out of scope.
+      delete lookahead;
     } else { // We have different FSTs for different utterances.
+      if (use_lookahead || read_lookahead != "" || write_lookahead != "")
+        KALDI_ERR << "LM lookahead is only supported when the decoding graph "
+                  << "is a single FST, not a table of FSTs.";
       SequentialTableReader<fst::VectorFstHolder> fst_reader(fst_in_str);
       RandomAccessBaseFloatMatrixReader feature_reader(feature_rspecifier);          
       for (; !fst_reader.Done(); fst_reader.Next()) {
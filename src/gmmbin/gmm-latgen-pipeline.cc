@@ -0,0 +1,244 @@
+// gmmbin/gmm-latgen-pipeline.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "gmm/am-diag-gmm.h"
+#include "tree/context-dep.h"
+#include "hmm/transition-model.h"
+#include "fstext/fstext-lib.h"
+#include "decoder/decoder-wrappers.h"
+#include "gmm/decodable-am-diag-gmm.h"
+#include "lat/lattice-pipeline.h"
+#include "lat/word-align-lattice.h"
+#include "base/timer.h"
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    typedef kaldi::int32 int32;
+    using fst::SymbolTable;
+    using fst::VectorFst;
+    using fst::StdArc;
+
+    const char *usage =
+        "Generate lattices using GMM-based model and post-process them in the\n"
+        "same process, avoiding the archive round-trips of running\n"
+        "gmm-latgen-faster | lattice-align-words | lattice-lmrescore as\n"
+        "separate programs.  Lattices pass between the stages as in-memory\n"
+        "objects through bounded queues, each stage on its own thread.  The\n"
+        "stages, each enabled by its option and run in this order, are:\n"
+        "word alignment (--word-boundary), LM subtraction (--lm-to-subtract,\n"
+        "composed with scale -lm-scale) and LM addition (--lm-to-add, composed\n"
+        "with scale lm-scale).  With no stage options this decodes like\n"
+        "gmm-latgen-faster with --determinize-lattice=true.\n"
+        "Usage: gmm-latgen-pipeline [options] model-in (fst-in|fsts-rspecifier) "
+        "features-rspecifier lattice-wspecifier\n"
+        "e.g.: gmm-latgen-pipeline --word-boundary=word_boundary.int \\\n"
+        "  --lm-to-subtract=G_old.fst --lm-to-add=G_new.fst \\\n"
+        "  final.mdl HCLG.fst ark:feats.ark ark:rescored.lats\n";
+    ParseOptions po(usage);
+    Timer timer;
+    bool allow_partial = false;
+    BaseFloat acoustic_scale = 0.1;
+    LatticeFasterDecoderConfig config;
+    LatticePipelineConfig pipeline_config;
+    WordBoundaryInfoNewOpts word_boundary_opts;
+
+    std::string word_syms_filename, word_boundary_filename,
+        lm_to_subtract_filename, lm_to_add_filename;
+    BaseFloat max_expand = 0.0, lm_scale = 1.0;
+    config.Register(&po);
+    pipeline_config.Register(&po);
+    word_boundary_opts.Register(&po);
+    po.Register("acoustic-scale", &acoustic_scale,
+                "Scaling factor for acoustic likelihoods");
+    po.Register("word-symbol-table", &word_syms_filename,
+                "Symbol table for words [for debug output]");
+    po.Register("allow-partial", &allow_partial,
+                "If true, produce output even if end state was not reached.");
+    po.Register("word-boundary", &word_boundary_filename,
+                "If set, word-align the lattices using this word-boundary "
+                "file, as lattice-align-words would.");
+    po.Register("max-expand", &max_expand,
+                "If >0, the maximum factor by which the word-alignment stage "
+                "will expand lattices before giving up on an utterance.");
+    po.Register("lm-to-subtract", &lm_to_subtract_filename,
+                "If set, an LM fst whose scores are subtracted from the "
+                "lattices (composed with scale -lm-scale), typically the LM "
+                "used to build the decoding graph.");
+    po.Register("lm-to-add", &lm_to_add_filename,
+                "If set, an LM fst whose scores are added to the lattices "
+                "(composed with scale lm-scale), typically a bigger LM.");
+    po.Register("lm-scale", &lm_scale,
+                "Scale applied in the LM rescoring stages (see --lm-to-subtract"
+                " and --lm-to-add).");
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 4) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string model_in_filename = po.GetArg(1),
+        fst_in_str = po.GetArg(2),
+        feature_rspecifier = po.GetArg(3),
+        lattice_wspecifier = po.GetArg(4);
+
+    if (!config.determinize_lattice)
+      KALDI_ERR << "The pipeline passes CompactLattices between stages, so "
+                << "--determinize-lattice=false is not supported.";
+
+    TransitionModel trans_model;
+    AmDiagGmm am_gmm;
+    {
+      bool binary;
+      Input ki(model_in_filename, &binary);
+      trans_model.Read(ki.Stream(), binary);
+      am_gmm.Read(ki.Stream(), binary);
+    }
+
+    CompactLatticeWriter compact_lattice_writer;
+    if (!compact_lattice_writer.Open(lattice_wspecifier))
+      KALDI_ERR << "Could not open table for writing lattices: "
+                << lattice_wspecifier;
+
+    fst::SymbolTable *word_syms = NULL;
+    if (word_syms_filename != "")
+      if (!(word_syms = fst::SymbolTable::ReadText(word_syms_filename)))
+        KALDI_ERR << "Could not read symbol table from file "
+                  << word_syms_filename;
+
+    WordBoundaryInfo *word_boundary_info = NULL;
+    LatticePipeline pipeline(pipeline_config, &compact_lattice_writer);
+    if (word_boundary_filename != "") {
+      word_boundary_info = new WordBoundaryInfo(word_boundary_opts,
+                                                word_boundary_filename);
+      pipeline.AddStage(new WordAlignLatticeStage(trans_model,
+                                                  *word_boundary_info,
+                                                  max_expand));
+    }
+    if (lm_to_subtract_filename != "")
+      pipeline.AddStage(new LmRescoreLatticeStage(lm_to_subtract_filename,
+                                                  -lm_scale));
+    if (lm_to_add_filename != "")
+      pipeline.AddStage(new LmRescoreLatticeStage(lm_to_add_filename,
+                                                  lm_scale));
+    pipeline.Start();
+
+    double tot_like = 0.0;
+    kaldi::int64 frame_count = 0;
+    int num_err = 0;
+
+    if (ClassifyRspecifier(fst_in_str, NULL, NULL) == kNoRspecifier) {
+      SequentialBaseFloatMatrixReader feature_reader(feature_rspecifier);
+      // Input FST is just one FST, not a table of FSTs.
+      VectorFst<StdArc> *decode_fst = fst::ReadFstKaldi(fst_in_str);
+
+      {
+        LatticeFasterDecoder decoder(*decode_fst, config);
+
+        for (; !feature_reader.Done(); feature_reader.Next()) {
+          std::string utt = feature_reader.Key();
+          Matrix<BaseFloat> features (feature_reader.Value());
+          feature_reader.FreeCurrent();
+          if (features.NumRows() == 0) {
+            KALDI_WARN << "Zero-length utterance: " << utt;
+            num_err++;
+            continue;
+          }
+
+          DecodableAmDiagGmmScaled gmm_decodable(am_gmm, trans_model, features,
+                                                 acoustic_scale);
+          double like;
+          CompactLattice *clat = new CompactLattice;
+          if (DecodeUtteranceLatticeFasterToLattice(
+                  decoder, gmm_decodable, trans_model, word_syms, utt,
+                  acoustic_scale, allow_partial, clat, &like)) {
+            tot_like += like;
+            frame_count += features.NumRows();
+            pipeline.Push(utt, clat);  // blocks if the pipeline is backed up.
+          } else {
+            delete clat;
+            num_err++;
+          }
+        }
+      }
+      delete decode_fst; // delete this only after decoder goes out of scope.
+    } else { // We have different FSTs for different utterances.
+      SequentialTableReader<fst::VectorFstHolder> fst_reader(fst_in_str);
+      RandomAccessBaseFloatMatrixReader feature_reader(feature_rspecifier);
+      for (; !fst_reader.Done(); fst_reader.Next()) {
+        std::string utt = fst_reader.Key();
+        if (!feature_reader.HasKey(utt)) {
+          KALDI_WARN << "Not decoding utterance " << utt
+                     << " because no features available.";
+          num_err++;
+          continue;
+        }
+        const Matrix<BaseFloat> &features = feature_reader.Value(utt);
+        if (features.NumRows() == 0) {
+          KALDI_WARN << "Zero-length utterance: " << utt;
+          num_err++;
+          continue;
+        }
+
+        LatticeFasterDecoder decoder(fst_reader.Value(), config);
+        DecodableAmDiagGmmScaled gmm_decodable(am_gmm, trans_model, features,
+                                               acoustic_scale);
+        double like;
+        CompactLattice *clat = new CompactLattice;
+        if (DecodeUtteranceLatticeFasterToLattice(
+                decoder, gmm_decodable, trans_model, word_syms, utt,
+                acoustic_scale, allow_partial, clat, &like)) {
+          tot_like += like;
+          frame_count += features.NumRows();
+          pipeline.Push(utt, clat);
+        } else {
+          delete clat;
+          num_err++;
+        }
+      }
+    }
+
+    pipeline.Finish();  // waits until everything has been written.
+    int num_done = pipeline.NumDone();
+    num_err += pipeline.NumFailed();
+
+    double elapsed = timer.Elapsed();
+    KALDI_LOG << "Time taken "<< elapsed
+              << "s: real-time factor assuming 100 frames/sec is "
+              << (elapsed*100.0/frame_count);
+    KALDI_LOG << "Done " << num_done << " utterances, failed for "
+              << num_err;
+    KALDI_LOG << "Overall log-likelihood per frame is "
+              << (tot_like/frame_count) << " over "
+              << frame_count << " frames.";
+
+    delete word_syms;
+    delete word_boundary_info;
+    if (num_done != 0) return 0;
+    else return 1;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
@@ -0,0 +1,86 @@
+// gmmbin/gmm-make-shortlist.cc
+
+// Copyright 2014   Johns Hopkins University
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "gmm/am-diag-gmm.h"
+#include "gmm/gaussian-shortlist.h"
+#include "hmm/transition-model.h"
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    typedef kaldi::int32 int32;
+
+    const char *usage =
+        "Build a Gaussian-selection shortlist index for a diagonal-GMM\n"
+        "acoustic model, for use with pruned decodables (it is stored\n"
+        "alongside the model and read at decode time).\n"
+        "Usage: gmm-make-shortlist [options] <model-file> <state-occs> "
+        "<shortlist-out>\n"
+        " e.g.: gmm-make-shortlist final.mdl final.occs final.shortlist\n";
+
+    bool binary_write = true;
+    ParseOptions po(usage);
+    po.Register("binary", &binary_write, "Write output in binary mode");
+    GaussianShortlistOptions shortlist_opts;
+    shortlist_opts.Register(&po);
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 3) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string model_in_filename = po.GetArg(1),
+        occs_in_filename = po.GetArg(2),
+        shortlist_out_filename = po.GetArg(3);
+
+    AmDiagGmm am_gmm;
+    TransitionModel trans_model;
+    {
+      bool binary_read;
+      Input ki(model_in_filename, &binary_read);
+      trans_model.Read(ki.Stream(), binary_read);
+      am_gmm.Read(ki.Stream(), binary_read);
+    }
+
+    Vector<BaseFloat> state_occs;
+    state_occs.Resize(am_gmm.NumPdfs());
+    {
+      bool binary_read;
+      Input ki(occs_in_filename, &binary_read);
+      state_occs.Read(ki.Stream(), binary_read);
+    }
+
+    GaussianShortlist shortlist;
+    shortlist.Build(am_gmm, state_occs, shortlist_opts);
+
+    {
+      Output ko(shortlist_out_filename, binary_write);
+      shortlist.Write(ko.Stream(), binary_write);
+    }
+    KALDI_LOG << "Written Gaussian shortlist to " << shortlist_out_filename;
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what() << '\n';
+    return -1;
+  }
+}
@@ -0,0 +1,127 @@
+// gmmbin/gmm-send-accs.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <netdb.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "util/common-utils.h"
+#include "gmm/mle-am-diag-gmm.h"
+#include "hmm/transition-model.h"
+
+namespace kaldi {
+
+// Connects to host:port over TCP and returns the socket descriptor.
+static int32 ConnectToServer(const std::string &host,
+                             const std::string &port) {
+  addrinfo hints, *server_addr;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_protocol = IPPROTO_TCP;
+  if (getaddrinfo(host.c_str(), port.c_str(), &hints, &server_addr) != 0)
+    KALDI_ERR << "getaddrinfo() failed for " << host << ":" << port;
+  int32 sock_desc = socket(server_addr->ai_family, server_addr->ai_socktype,
+                           server_addr->ai_protocol);
+  if (sock_desc == -1)
+    KALDI_ERR << "socket() call failed!";
+  if (connect(sock_desc, server_addr->ai_addr, server_addr->ai_addrlen) == -1)
+    KALDI_ERR << "Cannot connect to " << host << ":" << port
+              << " (is the reduce server running?)";
+  freeaddrinfo(server_addr);
+  return sock_desc;
+}
+
+// Sends all of "data" over the socket, looping over short writes.
+static void SendAll(int32 sock_desc, const std::string &data) {
+  size_t num_sent = 0;
+  while (num_sent < data.size()) {
+    ssize_t ret = send(sock_desc, data.data() + num_sent,
+                       data.size() - num_sent, 0);
+    if (ret <= 0)
+      KALDI_ERR << "send() to reduce server failed after " << num_sent
+                << " of " << data.size() << " bytes.";
+    num_sent += ret;
+  }
+}
+
+}  // namespace kaldi
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    typedef kaldi::int32 int32;
+
+    const char *usage =
+        "Sum accumulated stats for GMM training and stream the result over\n"
+        "TCP to a gmm-acc-reduce-server, instead of writing them to disk.\n"
+        "The wire format is the normal (binary) acc-file format, and the\n"
+        "program waits for the server to acknowledge the merge before\n"
+        "exiting, so a zero exit status means the stats were accumulated.\n"
+        "Usage: gmm-send-accs [options] <server-host> <server-port> "
+        "<stats-in1> [<stats-in2> ...]\n"
+        "E.g.: gmm-send-accs reducer01 6270 1.1.acc\n"
+        "See also: gmm-acc-reduce-server, gmm-sum-accs\n";
+
+    ParseOptions po(usage);
+    po.Read(argc, argv);
+
+    if (po.NumArgs() < 3) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string server_host = po.GetArg(1),
+        server_port = po.GetArg(2);
+
+    Vector<double> transition_accs;
+    AccumAmDiagGmm gmm_accs;
+    int32 num_accs = po.NumArgs() - 2;
+    for (int32 i = 3, max = po.NumArgs(); i <= max; i++) {
+      std::string stats_in_filename = po.GetArg(i);
+      bool binary_read;
+      Input ki(stats_in_filename, &binary_read);
+      transition_accs.Read(ki.Stream(), binary_read, true /*add read values*/);
+      gmm_accs.Read(ki.Stream(), binary_read, true /*add read values*/);
+    }
+
+    std::ostringstream os;
+    InitKaldiOutputStream(os, true /*binary*/);
+    transition_accs.Write(os, true);
+    gmm_accs.Write(os, true);
+
+    int32 sock_desc = ConnectToServer(server_host, server_port);
+    SendAll(sock_desc, os.str());
+    // Half-close so the server sees end-of-stream, then wait for the
+    // one-byte acknowledgment it sends once the stats are merged.
+    shutdown(sock_desc, SHUT_WR);
+    char ack;
+    if (recv(sock_desc, &ack, 1, 0) != 1 || ack != 'K')
+      KALDI_ERR << "Reduce server did not acknowledge the stats "
+                << "(it may have failed to parse them).";
+    close(sock_desc);
+
+    KALDI_LOG << "Sent " << num_accs << " stats (" << os.str().size()
+              << " bytes, total count " << gmm_accs.TotCount() << ") to "
+              << server_host << ":" << server_port;
+  } catch(const std::exception &e) {
+    std::cerr << e.what() << '\n';
+    return -1;
+  }
+}
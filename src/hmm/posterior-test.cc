@@ -82,6 +82,50 @@ void TestPosteriorIo() {
     }
   }
 }
+void TestFlatPosterior() {
+  int32 post_size = RandInt(0, 10);
+  Posterior post(post_size);
+  for (int32 i = 0; i < post.size(); i++) {
+    int32 s = RandInt(0, 3);
+    for (int32 j = 0; j < s; j++)
+      post[i].push_back(std::pair<int32,BaseFloat>(
+          RandInt(0, 100), RandUniform()));
+  }
+
+  // round trip through the flat representation.
+  FlatPosterior flat(post);
+  KALDI_ASSERT(flat.NumFrames() == post_size);
+  Posterior post2;
+  flat.CopyToPosterior(&post2);
+  KALDI_ASSERT(post == post2);
+
+  // building frame by frame gives the same result.
+  FlatPosterior flat2;
+  for (int32 i = 0; i < post.size(); i++)
+    flat2.AppendFrame(post[i].empty() ? NULL : &(post[i][0]),
+                      static_cast<int32>(post[i].size()));
+  for (int32 i = 0; i < flat2.NumFrames(); i++) {
+    KALDI_ASSERT(flat2.FrameSize(i) == flat.FrameSize(i));
+    for (int32 j = 0; j < flat2.FrameSize(i); j++)
+      KALDI_ASSERT(flat2.FrameData(i)[j] == flat.FrameData(i)[j]);
+  }
+
+  KALDI_ASSERT(fabs(flat.Total() - TotalPosterior(post)) < 0.01);
+  BaseFloat scale = RandUniform();
+  flat.Scale(scale);
+  KALDI_ASSERT(fabs(flat.Total() - scale * TotalPosterior(post)) < 0.01);
+
+  // the alignment constructor matches AlignmentToPosterior.
+  std::vector<int32> ali(RandInt(0, 10));
+  for (size_t i = 0; i < ali.size(); i++)
+    ali[i] = RandInt(1, 100);
+  FlatPosterior ali_flat(ali);
+  Posterior ali_post, ali_flat_post;
+  AlignmentToPosterior(ali, &ali_post);
+  ali_flat.CopyToPosterior(&ali_flat_post);
+  KALDI_ASSERT(ali_post == ali_flat_post);
+}
+
 }
 
 int main() {
@@ -89,6 +133,7 @@ int main() {
   for (int i = 0; i < 10; i++) {
     kaldi::TestVectorToPosteriorEntry();
     kaldi::TestPosteriorIo();
+    kaldi::TestFlatPosterior();
   }
   std::cout << "Test OK.\n";
 }
@@ -218,6 +218,96 @@ bool GaussPostHolder::Read(std::istream &is) {
 }
 
 
+FlatPosterior::FlatPosterior(const std::vector<int32> &ali) {
+  offsets_.reserve(ali.size() + 1);
+  entries_.reserve(ali.size());
+  offsets_.push_back(0);
+  for (size_t i = 0; i < ali.size(); i++) {
+    entries_.push_back(std::make_pair(ali[i], static_cast<BaseFloat>(1.0)));
+    offsets_.push_back(static_cast<int32>(entries_.size()));
+  }
+}
+
+void FlatPosterior::CopyFromPosterior(const Posterior &post) {
+  Clear();
+  size_t num_entries = 0;
+  for (size_t i = 0; i < post.size(); i++)
+    num_entries += post[i].size();
+  offsets_.reserve(post.size() + 1);
+  entries_.reserve(num_entries);
+  offsets_.push_back(0);
+  for (size_t i = 0; i < post.size(); i++) {
+    entries_.insert(entries_.end(), post[i].begin(), post[i].end());
+    offsets_.push_back(static_cast<int32>(entries_.size()));
+  }
+}
+
+void FlatPosterior::CopyToPosterior(Posterior *post) const {
+  int32 num_frames = NumFrames();
+  post->clear();
+  post->resize(num_frames);
+  for (int32 t = 0; t < num_frames; t++)
+    (*post)[t].assign(entries_.begin() + offsets_[t],
+                      entries_.begin() + offsets_[t + 1]);
+}
+
+void FlatPosterior::AppendFrame(const std::pair<int32, BaseFloat> *entries,
+                                int32 num_entries) {
+  KALDI_ASSERT(num_entries >= 0);
+  if (offsets_.empty())
+    offsets_.push_back(0);
+  entries_.insert(entries_.end(), entries, entries + num_entries);
+  offsets_.push_back(static_cast<int32>(entries_.size()));
+}
+
+void FlatPosterior::Scale(BaseFloat scale) {
+  if (scale == 1.0) return;
+  for (size_t i = 0; i < entries_.size(); i++)
+    entries_[i].second *= scale;
+}
+
+BaseFloat FlatPosterior::Total() const {
+  double sum = 0.0;
+  for (size_t i = 0; i < entries_.size(); i++)
+    sum += entries_[i].second;
+  return sum;
+}
+
+void ConvertFlatPosteriorToPdfs(const TransitionModel &tmodel,
+                                const FlatPosterior &post_in,
+                                FlatPosterior *post_out) {
+  post_out->Clear();
+  std::vector<std::pair<int32, BaseFloat> > this_frame;
+  for (int32 t = 0; t < post_in.NumFrames(); t++) {
+    const std::pair<int32, BaseFloat> *data = post_in.FrameData(t);
+    int32 size = post_in.FrameSize(t);
+    this_frame.clear();
+    for (int32 j = 0; j < size; j++) {
+      int32 pdf_id = tmodel.TransitionIdToPdf(data[j].first);
+      BaseFloat weight = data[j].second;
+      // A frame only has a few distinct pdf-ids, so a linear search is
+      // cheaper than the hash map that ConvertPosteriorToPdfs() uses.
+      size_t k;
+      for (k = 0; k < this_frame.size(); k++) {
+        if (this_frame[k].first == pdf_id) {
+          this_frame[k].second += weight;
+          break;
+        }
+      }
+      if (k == this_frame.size())
+        this_frame.push_back(std::make_pair(pdf_id, weight));
+    }
+    // as in ConvertPosteriorToPdfs(), entries that summed to zero are
+    // removed.
+    size_t num_kept = 0;
+    for (size_t k = 0; k < this_frame.size(); k++)
+      if (this_frame[k].second != 0.0)
+        this_frame[num_kept++] = this_frame[k];
+    post_out->AppendFrame(num_kept == 0 ? NULL : &(this_frame[0]),
+                          static_cast<int32>(num_kept));
+  }
+}
+
 void ScalePosterior(BaseFloat scale, Posterior *post) {
   if (scale == 1.0) return;
   for (size_t i = 0; i < post->size(); i++) {
@@ -72,7 +72,7 @@ class PosteriorHolder {
   // reading.
   static bool IsReadInBinary() { return true; }
 
-  const T &Value() const { return t_; }
+  T &Value() { return t_; }
   
  private:
   KALDI_DISALLOW_COPY_AND_ASSIGN(PosteriorHolder);
@@ -108,7 +108,7 @@ class GaussPostHolder {
   // reading.
   static bool IsReadInBinary() { return true; }
 
-  const T &Value() const { return t_; }
+  T &Value() { return t_; }
   
  private:
   KALDI_DISALLOW_COPY_AND_ASSIGN(GaussPostHolder);
@@ -130,6 +130,76 @@ typedef SequentialTableReader<GaussPostHolder> SequentialGaussPostReader;
 typedef RandomAccessTableReader<GaussPostHolder> RandomAccessGaussPostReader;
 
 
+/** FlatPosterior stores the same information as Posterior, but in a single
+    contiguous buffer in compressed-sparse-row style: one array of
+    (id, weight) entries, plus per-frame offsets into it.  Unlike Posterior it
+    does not heap-allocate a vector per frame, so it is much cheaper to build
+    and destroy in the inner loops of stats-accumulation code that processes
+    large numbers of frames, and the buffers are re-used if you re-use the
+    object across utterances.  Posterior remains the interchange (I/O) format:
+    convert with CopyFromPosterior() / CopyToPosterior(), and view the entries
+    of individual frames via FrameData() and FrameSize().
+*/
+class FlatPosterior {
+ public:
+  FlatPosterior() { }
+
+  /// Initializes from nested-vector form.
+  explicit FlatPosterior(const Posterior &post) { CopyFromPosterior(post); }
+
+  /// Initializes from an alignment, with a weight of 1.0 for each frame
+  /// (cf. AlignmentToPosterior).
+  explicit FlatPosterior(const std::vector<int32> &ali);
+
+  int32 NumFrames() const {
+    return (offsets_.empty() ? 0 : static_cast<int32>(offsets_.size()) - 1);
+  }
+
+  /// Returns the number of entries on frame t.
+  int32 FrameSize(int32 t) const { return offsets_[t + 1] - offsets_[t]; }
+
+  /// Returns a pointer to the entries of frame t (NULL if that frame has no
+  /// entries).
+  const std::pair<int32, BaseFloat> *FrameData(int32 t) const {
+    return (FrameSize(t) == 0 ? NULL : &(entries_[offsets_[t]]));
+  }
+
+  /// Sets *this from nested-vector form, re-using the buffers if they are
+  /// large enough.
+  void CopyFromPosterior(const Posterior &post);
+
+  /// Copies *this to nested-vector form.
+  void CopyToPosterior(Posterior *post) const;
+
+  /// Appends one frame with the supplied entries; use this when building a
+  /// posterior frame by frame.  "entries" may be NULL if num_entries is zero.
+  void AppendFrame(const std::pair<int32, BaseFloat> *entries,
+                   int32 num_entries);
+
+  /// Removes all frames; the allocated buffers are kept for re-use.
+  void Clear() { offsets_.clear(); entries_.clear(); }
+
+  /// Scales the weights of all the entries.
+  void Scale(BaseFloat scale);
+
+  /// Returns the total of all the weights.
+  BaseFloat Total() const;
+
+ private:
+  // offsets_ has size NumFrames() + 1 (or zero, if there are no frames); the
+  // entries of frame t are entries_[offsets_[t]] ... entries_[offsets_[t+1]-1].
+  std::vector<int32> offsets_;
+  std::vector<std::pair<int32, BaseFloat> > entries_;
+};
+
+/// Converts a FlatPosterior over transition-ids to be over pdf-ids, merging
+/// the weights of transition-ids that map to the same pdf-id; this is the
+/// FlatPosterior analog of ConvertPosteriorToPdfs().
+void ConvertFlatPosteriorToPdfs(const TransitionModel &tmodel,
+                                const FlatPosterior &post_in,
+                                FlatPosterior *post_out);
+
+
 /// Scales the BaseFloat (weight) element in the posterior entries.
 void ScalePosterior(BaseFloat scale, Posterior *post);
 
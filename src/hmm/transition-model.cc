@@ -91,10 +91,15 @@ void TransitionModel::ComputeDerived() {
   }
 
   id2state_.resize(cur_transition_id);   // cur_transition_id is #transition-ids+1.
-  for (int32 tstate = 1; tstate <= static_cast<int32>(triples_.size()); tstate++)
-    for (int32 tid = state2id_[tstate]; tid < state2id_[tstate+1]; tid++)
+  id2info_.resize(cur_transition_id);
+  for (int32 tstate = 1; tstate <= static_cast<int32>(triples_.size()); tstate++) {
+    for (int32 tid = state2id_[tstate]; tid < state2id_[tstate+1]; tid++) {
       id2state_[tid] = tstate;
-
+      id2info_[tid].pdf = triples_[tstate-1].pdf;
+      id2info_[tid].phone = triples_[tstate-1].phone;
+      id2info_[tid].log_prob = 0.0;  // set up in ComputeDerivedOfProbs().
+    }
+  }
 }
 void TransitionModel::InitializeProbs() {
   log_probs_.Resize(NumTransitionIds()+1);  // one-based array, zeroth element empty.
@@ -253,6 +258,10 @@ int32 TransitionModel::SelfLoopOf(int32 trans_state) const {  // returns the sel
 }
 
 void TransitionModel::ComputeDerivedOfProbs() {
+  // Refresh the flattened per-transition-id table first, since
+  // GetTransitionLogProb() (called just below) reads from it.
+  for (int32 tid = 1; tid <= NumTransitionIds(); tid++)
+    id2info_[tid].log_prob = log_probs_(tid);
   non_self_loop_log_probs_.Resize(NumTransitionStates()+1);  // this array indexed
   //  by transition-state with nothing in zeroth element.
   for (int32 tstate = 1; tstate <= NumTransitionStates(); tstate++) {
@@ -321,10 +330,6 @@ BaseFloat TransitionModel::GetTransitionProb(int32 trans_id) const {
   return Exp(log_probs_(trans_id));
 }
 
-BaseFloat TransitionModel::GetTransitionLogProb(int32 trans_id) const {
-  return log_probs_(trans_id);
-}
-
 BaseFloat TransitionModel::GetNonSelfLoopLogProb(int32 trans_state) const {
   KALDI_ASSERT(trans_state != 0);
   return non_self_loop_log_probs_(trans_state);
@@ -639,12 +644,6 @@ void TransitionModel::MapUpdateShared(const Vector<double> &stats,
 }
 
 
-int32 TransitionModel::TransitionIdToPhone(int32 trans_id) const {
-  KALDI_ASSERT(trans_id != 0 && static_cast<size_t>(trans_id) < id2state_.size());
-  int32 trans_state = id2state_[trans_id];
-  return triples_[trans_state-1].phone;
-}
-
 int32 TransitionModel::TransitionIdToPdfClass(int32 trans_id) const {
   KALDI_ASSERT(trans_id != 0 && static_cast<size_t>(trans_id) < id2state_.size());
   int32 trans_state = id2state_[trans_id];
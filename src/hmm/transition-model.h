@@ -152,7 +152,7 @@ class TransitionModel {
   // this state doesn't have a self-loop.
 
   inline int32 TransitionIdToPdf(int32 trans_id) const;
-  int32 TransitionIdToPhone(int32 trans_id) const;
+  inline int32 TransitionIdToPhone(int32 trans_id) const;
   int32 TransitionIdToPdfClass(int32 trans_id) const;
   int32 TransitionIdToHmmState(int32 trans_id) const;
 
@@ -191,7 +191,7 @@ class TransitionModel {
 
   // Transition-parameter-getting functions:
   BaseFloat GetTransitionProb(int32 trans_id) const;
-  BaseFloat GetTransitionLogProb(int32 trans_id) const;
+  inline BaseFloat GetTransitionLogProb(int32 trans_id) const;
 
   // The following functions are more specialized functions for getting
   // transition probabilities, that are provided for convenience.
@@ -292,6 +292,20 @@ class TransitionModel {
   /// state (indexed by transition-id).
   std::vector<int32> id2state_;
 
+  /// The most frequently needed per-transition-id quantities (the log-prob,
+  /// pdf-id and phone), packed together in one small struct so the lookups
+  /// that decoding and lattice-processing code does for every arc are a
+  /// single array access, instead of chasing through id2state_ and triples_.
+  /// The pdf and phone fields are set up in ComputeDerived(), the log_prob
+  /// field in ComputeDerivedOfProbs().  Indexed by transition-id; the zeroth
+  /// element is unused.
+  struct IdInfo {
+    BaseFloat log_prob;
+    int32 pdf;
+    int32 phone;
+  };
+  std::vector<IdInfo> id2info_;
+
   /// For each transition-id, the corresponding log-prob.  Indexed by transition-id.
   Vector<BaseFloat> log_probs_;
 
@@ -310,12 +324,18 @@ class TransitionModel {
 };
 
 inline int32 TransitionModel::TransitionIdToPdf(int32 trans_id) const {
-  // If a lot of time is spent here we may create an extra array
-  // to handle this.
-  KALDI_ASSERT(static_cast<size_t>(trans_id) < id2state_.size() &&
+  KALDI_ASSERT(static_cast<size_t>(trans_id) < id2info_.size() &&
                "Likely graph/model mismatch (graph built from wrong model?)");
-  int32 trans_state = id2state_[trans_id];
-  return triples_[trans_state-1].pdf;
+  return id2info_[trans_id].pdf;
+}
+
+inline int32 TransitionModel::TransitionIdToPhone(int32 trans_id) const {
+  KALDI_ASSERT(trans_id != 0 && static_cast<size_t>(trans_id) < id2info_.size());
+  return id2info_[trans_id].phone;
+}
+
+inline BaseFloat TransitionModel::GetTransitionLogProb(int32 trans_id) const {
+  return id2info_[trans_id].log_prob;
 }
 
 /// Works out which pdfs might correspond to the given phones.  Will return true
@@ -85,20 +85,31 @@ void AccumulateTreeStats(const TransitionModel &trans_model,
         if (is_ctx_dep || j == P)
           evec.push_back(std::make_pair(static_cast<EventKeyType>(j), static_cast<EventValueType>(phone)));
       }
-      for (int j = 0; j < static_cast<int>(split_alignment[i+P].size());j++) {
+      int num_central_frames = static_cast<int>(split_alignment[i+P].size());
+      for (int j = 0; j < num_central_frames; ) {
         // for central phone of this window...
-        EventType evec_more(evec);
         int32 pdf_class = trans_model.TransitionIdToPdfClass(split_alignment[i+P][j]);
         // pdf_class will normally by 0, 1 or 2 for 3-state HMM.
+        // Thanks to self-loops, runs of consecutive frames usually share the
+        // pdf-class (and hence the stats object); batch each such run into
+        // one AddStatsBlock() call.
+        int num_frames = 1;
+        while (j + num_frames < num_central_frames &&
+               trans_model.TransitionIdToPdfClass(
+                   split_alignment[i+P][j + num_frames]) == pdf_class)
+          num_frames++;
+        EventType evec_more(evec);
         std::pair<EventKeyType, EventValueType> pr(kPdfClass, pdf_class);
         evec_more.push_back(pr);
         std::sort(evec_more.begin(), evec_more.end());  // these must be sorted!
         if (stats->count(evec_more) == 0)
           (*stats)[evec_more] = new GaussClusterable(dim, var_floor);
-        
+
         BaseFloat weight = 1.0;
-        (*stats)[evec_more]->AddStats(features.Row(cur_pos), weight);
-        cur_pos++;
+        SubMatrix<BaseFloat> this_feats(features, cur_pos, num_frames, 0, dim);
+        (*stats)[evec_more]->AddStatsBlock(this_feats, weight);
+        cur_pos += num_frames;
+        j += num_frames;
       }
     }
   }
@@ -21,6 +21,8 @@
 
 #ifndef KALDI_ITF_DECODABLE_ITF_H_
 #define KALDI_ITF_DECODABLE_ITF_H_ 1
+
+#include <vector>
 #include "base/kaldi-common.h"
 
 namespace kaldi {
@@ -114,6 +116,29 @@ class DecodableInterface {
   /// (they will be indexed one-based, i.e. from 1 to NumIndices();
   /// this is for compatibility with OpenFst.
   virtual int32 NumIndices() const = 0;
+
+  /// Batched version of LogLikelihood(): computes the log-likelihoods of
+  /// all the given indices on one frame, resizing "loglikes" to
+  /// indices.size().  The base-class version just loops over
+  /// LogLikelihood(), so overriding this is optional; subclasses whose
+  /// likelihoods come from matrix-level computations can override it to
+  /// amortize per-call setup and use vectorized kernels.  Decoders may
+  /// call it with all the distinct indices they need on a frame (see
+  /// e.g. --batch-acoustic-scores in LatticeFasterDecoder).
+  virtual void LogLikelihoods(int32 frame,
+                              const std::vector<int32> &indices,
+                              std::vector<BaseFloat> *loglikes) {
+    loglikes->resize(indices.size());
+    for (size_t i = 0; i < indices.size(); i++)
+      (*loglikes)[i] = LogLikelihood(frame, indices[i]);
+  }
+
+  /// A hint that the decoder expects to request likelihoods for frames in
+  /// the range [begin_frame, end_frame); the frames are already ready in
+  /// the sense of NumFramesReady().  Subclasses that compute likelihoods
+  /// lazily can use this to batch the computation over several frames;
+  /// the default does nothing.
+  virtual void PrefetchFrames(int32 begin_frame, int32 end_frame) { }
   
   virtual ~DecodableInterface() {}
 };
@@ -96,6 +96,13 @@ class OnlineBaseFeature: public OnlineFeatureInterface {
   /// of delta or LDA features (it will typically affect the return value
   /// of IsLastFrame.
   virtual void InputFinished() = 0;
+
+  /// Reset() returns the object to the state it had just after construction,
+  /// so it can be re-used for the next utterance of a session without being
+  /// destroyed and re-created (implementations are expected to keep their
+  /// internal buffers allocated, so that back-to-back short utterances don't
+  /// pay allocation costs per utterance).
+  virtual void Reset() = 0;
 };
 
 
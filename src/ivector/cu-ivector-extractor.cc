@@ -0,0 +1,119 @@
+// ivector/cu-ivector-extractor.cc
+
+// Copyright 2015   Johns Hopkins University (Author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ivector/cu-ivector-extractor.h"
+#include "cudamatrix/cu-sparse-matrix.h"
+
+namespace kaldi {
+
+CuIvectorExtractor::CuIvectorExtractor(const IvectorExtractor &extractor):
+    extractor_(extractor) {
+  Sigma_inv_M_ = extractor.Sigma_inv_M_;
+  U_ = extractor.U_;
+}
+
+void CuIvectorExtractor::AccStats(
+    const MatrixBase<BaseFloat> &feats,
+    const Posterior &post,
+    IvectorExtractorUtteranceStats *utt_stats) const {
+  typedef std::vector<std::pair<int32, BaseFloat> > VecType;
+  int32 num_frames = feats.NumRows(),
+      num_gauss = NumGauss(),
+      feat_dim = feats.NumCols();
+  KALDI_ASSERT(feat_dim == FeatDim());
+  KALDI_ASSERT(num_frames == static_cast<int32>(post.size()));
+  KALDI_ASSERT(utt_stats->S_.empty() &&
+               "2nd-order stats are not supported on the GPU.");
+
+  // The zeroth-order stats are cheap; do them on the host while checking the
+  // posteriors' Gaussian indices.
+  for (int32 t = 0; t < num_frames; t++) {
+    const VecType &this_post(post[t]);
+    for (VecType::const_iterator iter = this_post.begin();
+         iter != this_post.end(); ++iter) {
+      int32 i = iter->first; // Gaussian index.
+      KALDI_ASSERT(i >= 0 && i < num_gauss &&
+                   "Out-of-range Gaussian (mismatched posteriors?)");
+      utt_stats->gamma_(i) += iter->second;
+    }
+  }
+
+  // First-order stats: X += P^T F, with P the [T][I] matrix of posteriors
+  // and F the [T][D] feature block.  The posteriors go to the device in
+  // sparse form (note: the Posterior type is exactly the pair-list format
+  // the SparseMatrix constructor wants), and are expanded to a dense matrix
+  // there, since we only have a dense matrix multiply on the device.
+  SparseMatrix<BaseFloat> post_smat(num_gauss, post);
+  CuSparseMatrix<BaseFloat> post_cu(post_smat);
+  CuMatrix<double> post_mat(num_frames, num_gauss);  // zeroed.
+  post_cu.CopyToMat(&post_mat);
+  CuMatrix<double> feats_cu(num_frames, feat_dim, kUndefined);
+  feats_cu.CopyFromMat(feats);
+  CuMatrix<double> X(num_gauss, feat_dim, kUndefined);
+  X.AddMatMat(1.0, post_mat, kTrans, feats_cu, kNoTrans, 0.0);
+  Matrix<double> X_cpu(num_gauss, feat_dim, kUndefined);
+  X.CopyToMat(&X_cpu);
+  utt_stats->X_.AddMat(1.0, X_cpu);
+}
+
+void CuIvectorExtractor::GetIvectorDistribution(
+    const IvectorExtractorUtteranceStats &utt_stats,
+    VectorBase<double> *mean,
+    SpMatrix<double> *var) const {
+  if (extractor_.IvectorDependentWeights()) {
+    // The iterative weight-dependent computation involves small quantities
+    // and host-side logic; just use the CPU implementation.
+    extractor_.GetIvectorDistribution(utt_stats, mean, var);
+    return;
+  }
+  int32 I = NumGauss(), D = FeatDim(), S = IvectorDim(),
+      quadratic_dim = S * (S + 1) / 2;
+
+  // linear = Sigma_inv_M_^T vec(X), quadratic = U_^T gamma; both are
+  // matrix-vector products against the large device-resident matrices.
+  CuVector<double> x(I * D, kUndefined);
+  x.CopyRowsFromMat(CuMatrix<double>(utt_stats.X_));
+  CuVector<double> linear_cu(S);
+  linear_cu.AddMatVec(1.0, Sigma_inv_M_, kTrans, x, 0.0);
+  CuVector<double> gamma_cu(utt_stats.gamma_);
+  CuVector<double> quadratic_cu(quadratic_dim);
+  quadratic_cu.AddMatVec(1.0, U_, kTrans, gamma_cu, 0.0);
+
+  Vector<double> linear(S, kUndefined);
+  linear_cu.CopyToVec(&linear);
+  SpMatrix<double> quadratic(S);
+  SubVector<double> q_vec(quadratic.Data(), quadratic_dim);
+  quadratic_cu.CopyToVec(&q_vec);
+
+  // The prior terms and the inversion, as in
+  // IvectorExtractor::GetIvectorDistribution(); these are small.
+  linear(0) += extractor_.prior_offset_;
+  quadratic.AddToDiag(1.0);
+  if (var != NULL) {
+    var->CopyFromSp(quadratic);
+    var->Invert(); // now it's a variance.
+    // mean of distribution = quadratic^{-1} * linear...
+    mean->AddSpVec(1.0, *var, linear, 0.0);
+  } else {
+    quadratic.Invert();
+    mean->AddSpVec(1.0, quadratic, linear, 0.0);
+  }
+}
+
+}  // namespace kaldi
@@ -0,0 +1,86 @@
+// ivector/cu-ivector-extractor.h
+
+// Copyright 2015   Johns Hopkins University (Author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_IVECTOR_CU_IVECTOR_EXTRACTOR_H_
+#define KALDI_IVECTOR_CU_IVECTOR_EXTRACTOR_H_
+
+#include "base/kaldi-common.h"
+#include "matrix/matrix-lib.h"
+#include "cudamatrix/cu-matrix-lib.h"
+#include "ivector/ivector-extractor.h"
+
+namespace kaldi {
+
+/**
+   CuIvectorExtractor does the per-utterance math of iVector extraction on
+   the GPU.  It keeps device copies of the large derived variables of an
+   IvectorExtractor (the stacked Sigma_inv_M_ matrix and U_), accumulates the
+   zeroth and first order utterance stats as one sparse-times-dense matrix
+   multiply of the posteriors against the feature block, and computes the
+   linear and quadratic terms of the iVector distribution with device
+   matrix-vector products; only the small S-dimensional inversion happens on
+   the host.  Second-order stats (only needed for updating the extractor's
+   variances during training) are not supported.
+
+   All the work goes through CuMatrix/CuVector, so if Kaldi was not compiled
+   with CUDA, or no GPU was selected (see CuDevice::SelectGpuId()), the same
+   code transparently runs on the CPU; callers do not need a separate path.
+   The results match the CPU implementation up to rounding.
+
+   The IvectorExtractor must outlive this object; one CuIvectorExtractor can
+   serve any number of utterances, but (like anything using the GPU context)
+   it should be used from a single thread.
+ */
+class CuIvectorExtractor {
+ public:
+  explicit CuIvectorExtractor(const IvectorExtractor &extractor);
+
+  /// Accumulates stats for one utterance into "utt_stats" (adding to any
+  /// stats already there, like IvectorExtractorUtteranceStats::AccStats());
+  /// utt_stats must have been constructed with need_2nd_order_stats == false.
+  void AccStats(const MatrixBase<BaseFloat> &feats,
+                const Posterior &post,
+                IvectorExtractorUtteranceStats *utt_stats) const;
+
+  /// As IvectorExtractor::GetIvectorDistribution(), but with the linear and
+  /// quadratic terms computed on the device.  If the extractor has
+  /// iVector-dependent weights we fall back to the (iterative) CPU
+  /// computation, which is not a bottleneck in that configuration.
+  void GetIvectorDistribution(const IvectorExtractorUtteranceStats &utt_stats,
+                              VectorBase<double> *mean,
+                              SpMatrix<double> *var) const;
+
+  int32 FeatDim() const { return extractor_.FeatDim(); }
+  int32 IvectorDim() const { return extractor_.IvectorDim(); }
+  int32 NumGauss() const { return extractor_.NumGauss(); }
+  double PriorOffset() const { return extractor_.PriorOffset(); }
+
+ private:
+  const IvectorExtractor &extractor_;  // not owned here; used for dimensions,
+                                       // the prior, and the fallback path.
+  CuMatrix<double> Sigma_inv_M_;  // device copy of the stacked
+                                  // Sigma_inv_[i] * M_[i] matrix, [I*D][S].
+  CuMatrix<double> U_;            // device copy of U_, [I][S*(S+1)/2].
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(CuIvectorExtractor);
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_IVECTOR_CU_IVECTOR_EXTRACTOR_H_
@@ -188,7 +188,7 @@ void IvectorExtractor::ComputeDerivedVars() {
     // the gconsts don't contain any weight-related terms.
   }
   U_.Resize(NumGauss(), IvectorDim() * (IvectorDim() + 1) / 2);
-  Sigma_inv_M_.resize(NumGauss());
+  Sigma_inv_M_.Resize(NumGauss() * FeatDim(), IvectorDim());
 
   // Note, we could have used RunMultiThreaded for this and similar tasks we
   // have here, but we found that we don't get as complete CPU utilization as we
@@ -213,8 +213,9 @@ void IvectorExtractor::ComputeDerivedVars(int32 i) {
                                IvectorDim() * (IvectorDim() + 1) / 2);
   U_.Row(i).CopyFromVec(temp_U_vec);
 
-  Sigma_inv_M_[i].Resize(FeatDim(), IvectorDim());
-  Sigma_inv_M_[i].AddSpMat(1.0, Sigma_inv_[i], M_[i], kNoTrans, 0.0);
+  SubMatrix<double> Sigma_inv_M_i(Sigma_inv_M_, i * FeatDim(), FeatDim(),
+                                  0, IvectorDim());
+  Sigma_inv_M_i.AddSpMat(1.0, Sigma_inv_[i], M_[i], kNoTrans, 0.0);
 }
 
 
@@ -258,15 +259,15 @@ void IvectorExtractor::GetIvectorDistMean(
     const IvectorExtractorUtteranceStats &utt_stats,
     VectorBase<double> *linear,
     SpMatrix<double> *quadratic) const {
-  int32 I = NumGauss();
-  for (int32 i = 0; i < I; i++) {
-    double gamma = utt_stats.gamma_(i);
-    if (gamma != 0.0) {
-      SubVector<double> x(utt_stats.X_, i); // == \gamma(i) \m_i
-      // next line: a += \gamma_i \M_i^T \Sigma_i^{-1} \m_i
-      linear->AddMatVec(1.0, Sigma_inv_M_[i], kTrans, x, 1.0);
-    }
-  }
+  int32 I = NumGauss(), D = FeatDim();
+  // linear += \sum_i \gamma_i \M_i^T \Sigma_i^{-1} \m_i.  Since the matrices
+  // \Sigma_i^{-1} \M_i are stored stacked vertically in Sigma_inv_M_, this is
+  // a single matrix-vector multiply, with the rows of X_ (the \gamma_i \m_i)
+  // laid out end to end; rows with zero count are zero and contribute
+  // nothing.  This is much faster than looping over the Gaussians.
+  Vector<double> x(I * D, kUndefined);
+  x.CopyRowsFromMat(utt_stats.X_);
+  linear->AddMatVec(1.0, Sigma_inv_M_, kTrans, x, 1.0);
   SubVector<double> q_vec(quadratic->Data(), IvectorDim()*(IvectorDim()+1)/2);
   q_vec.AddMatVec(1.0, U_, kTrans, utt_stats.gamma_, 1.0);
 }
@@ -541,7 +542,11 @@ void OnlineIvectorEstimationStats::AccStats(
     // stuff we previously added if the traceback changes).
     if (weight == 0.0)
       continue;
-    linear_term_.AddMatVec(weight, extractor.Sigma_inv_M_[g], kTrans,
+    SubMatrix<double> Sigma_inv_M_g(extractor.Sigma_inv_M_,
+                                    g * extractor.FeatDim(),
+                                    extractor.FeatDim(),
+                                    0, ivector_dim);
+    linear_term_.AddMatVec(weight, Sigma_inv_M_g, kTrans,
                            feature_dbl, 1.0);
     SubVector<double> U_g(extractor.U_, g);
     quadratic_term_vec.AddVec(weight, U_g);
@@ -751,31 +756,101 @@ void IvectorExtractor::Read(std::istream &is, bool binary) {
 void IvectorExtractorUtteranceStats::AccStats(
     const MatrixBase<BaseFloat> &feats,
     const Posterior &post) {
-  typedef std::vector<std::pair<int32, BaseFloat> > VecType;
+  KALDI_ASSERT(feats.NumRows() == static_cast<int32>(post.size()));
+  // Pack the posteriors into contiguous form; this costs one pass over the
+  // entries and lets both representations share the accumulation code.
+  FlatPosterior flat_post(post);
+  AccStats(feats, flat_post);
+}
+
+void IvectorExtractorUtteranceStats::AccStats(
+    const MatrixBase<BaseFloat> &feats,
+    const FlatPosterior &post) {
   int32 num_frames = feats.NumRows(),
       num_gauss = X_.NumRows(),
       feat_dim = feats.NumCols();
   KALDI_ASSERT(X_.NumCols() == feat_dim);
-  KALDI_ASSERT(feats.NumRows() == static_cast<int32>(post.size()));
+  KALDI_ASSERT(num_frames == post.NumFrames());
   bool update_variance = (!S_.empty());
+  if (!update_variance) {
+    // The common case, e.g. iVector extraction for speaker-id: no 2nd-order
+    // stats are needed, and we can use a much faster blocked path.
+    AccStatsBlocked(feats, post);
+    return;
+  }
   SpMatrix<double> outer_prod(feat_dim);
   for (int32 t = 0; t < num_frames; t++) {
     SubVector<BaseFloat> frame(feats, t);
-    const VecType &this_post(post[t]);
-    if (update_variance) {
-      outer_prod.SetZero();
-      outer_prod.AddVec2(1.0, frame);
-    }
-    for (VecType::const_iterator iter = this_post.begin();
-         iter != this_post.end(); ++iter) {
-      int32 i = iter->first; // Gaussian index.
+    const std::pair<int32, BaseFloat> *this_post = post.FrameData(t);
+    int32 this_size = post.FrameSize(t);
+    outer_prod.SetZero();
+    outer_prod.AddVec2(1.0, frame);
+    for (int32 j = 0; j < this_size; j++) {
+      int32 i = this_post[j].first; // Gaussian index.
       KALDI_ASSERT(i >= 0 && i < num_gauss &&
                    "Out-of-range Gaussian (mismatched posteriors?)");
-      double weight = iter->second;
+      double weight = this_post[j].second;
       gamma_(i) += weight;
       X_.Row(i).AddVec(weight, frame);
-      if (update_variance)
-        S_[i].AddSp(weight, outer_prod);
+      S_[i].AddSp(weight, outer_prod);
+    }
+  }
+}
+
+void IvectorExtractorUtteranceStats::AccStatsBlocked(
+    const MatrixBase<BaseFloat> &feats,
+    const FlatPosterior &post) {
+  // Frames per block.  Larger blocks give the matrix multiply more work per
+  // call, but make the gathered posterior matrix sparser (it is stored
+  // densely); around a hundred frames is a reasonable tradeoff.
+  const int32 block_size = 128;
+  int32 num_frames = feats.NumRows(),
+      num_gauss = X_.NumRows(),
+      feat_dim = feats.NumCols();
+  std::vector<int32> local_index(num_gauss, -1);  // Gaussian index -> row of
+                                                  // post_block, or -1.
+  std::vector<int32> active;  // Gaussians with nonzero posterior in the block.
+  Matrix<double> feats_block, post_block, x_block;
+  for (int32 t0 = 0; t0 < num_frames; t0 += block_size) {
+    int32 this_block = std::min(block_size, num_frames - t0);
+    // First pass over the block: find the set of active Gaussians, so
+    // post_block only needs one row per Gaussian that actually appears.
+    active.clear();
+    for (int32 t = t0; t < t0 + this_block; t++) {
+      const std::pair<int32, BaseFloat> *this_post = post.FrameData(t);
+      int32 this_size = post.FrameSize(t);
+      for (int32 j = 0; j < this_size; j++) {
+        int32 i = this_post[j].first; // Gaussian index.
+        KALDI_ASSERT(i >= 0 && i < num_gauss &&
+                     "Out-of-range Gaussian (mismatched posteriors?)");
+        if (local_index[i] == -1) {
+          local_index[i] = static_cast<int32>(active.size());
+          active.push_back(i);
+        }
+      }
+    }
+    if (active.empty()) continue;
+    int32 num_active = static_cast<int32>(active.size());
+    // Second pass: gather the posteriors of the block into a matrix, and
+    // accumulate the first-order stats X_ as a matrix-matrix multiply of it
+    // against the feature block.
+    post_block.Resize(num_active, this_block);
+    for (int32 t = t0; t < t0 + this_block; t++) {
+      const std::pair<int32, BaseFloat> *this_post = post.FrameData(t);
+      int32 this_size = post.FrameSize(t);
+      for (int32 j = 0; j < this_size; j++)
+        post_block(local_index[this_post[j].first], t - t0) +=
+            this_post[j].second;
+    }
+    feats_block.Resize(this_block, feat_dim, kUndefined);
+    feats_block.CopyFromMat(feats.Range(t0, this_block, 0, feat_dim));
+    x_block.Resize(num_active, feat_dim, kUndefined);
+    x_block.AddMatMat(1.0, post_block, kNoTrans, feats_block, kNoTrans, 0.0);
+    for (int32 r = 0; r < num_active; r++) {
+      int32 i = active[r];
+      gamma_(i) += post_block.Row(r).Sum();
+      X_.Row(i).AddVec(1.0, x_block.Row(r));
+      local_index[i] = -1;  // reset for the next block.
     }
   }
 }
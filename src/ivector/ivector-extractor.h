@@ -71,6 +71,7 @@ struct IvectorEstimationOptions {
 
 class IvectorExtractor;
 class IvectorExtractorComputeDerivedVarsClass;
+class CuIvectorExtractor;  // GPU version; see ivector/cu-ivector-extractor.h.
 
 /// These are the stats for a particular utterance, i.e. the sufficient stats
 /// for estimating an iVector (if need_2nd_order_stats == true, we can also
@@ -91,6 +92,12 @@ class IvectorExtractorUtteranceStats {
   void AccStats(const MatrixBase<BaseFloat> &feats,
                 const Posterior &post);
 
+  // As above, but taking the posteriors in contiguous (FlatPosterior) form,
+  // which avoids per-frame allocation; the Posterior version just packs its
+  // input and calls this one.
+  void AccStats(const MatrixBase<BaseFloat> &feats,
+                const FlatPosterior &post);
+
   void Scale(double scale); // Used to apply acoustic scale.
 
   double NumFrames() { return gamma_.Sum(); }
@@ -98,6 +105,16 @@ class IvectorExtractorUtteranceStats {
  protected:
   friend class IvectorExtractor;
   friend class IvectorExtractorStats;
+  friend class CuIvectorExtractor;
+
+  // Implements AccStats() for the common case where the 2nd-order stats are
+  // not needed, by gathering the posteriors of a block of frames into a
+  // matrix and accumulating the first-order stats with a matrix-matrix
+  // multiply against the feature block; gives the same results (modulo
+  // rounding) much faster.
+  void AccStatsBlocked(const MatrixBase<BaseFloat> &feats,
+                       const FlatPosterior &post);
+
   Vector<double> gamma_; // zeroth-order stats (summed posteriors), dimension [I]
   Matrix<double> X_; // first-order stats, dimension [I][D]
   std::vector<SpMatrix<double> > S_; // 2nd-order stats, dimension [I][D][D], if
@@ -137,6 +154,7 @@ class IvectorExtractor {
  public:
   friend class IvectorExtractorStats;
   friend class OnlineIvectorEstimationStats;
+  friend class CuIvectorExtractor;
 
   IvectorExtractor(): prior_offset_(0.0) { }
 
@@ -297,8 +315,13 @@ class IvectorExtractor {
   /// improvement (we can use matrix-multiplies).
   Matrix<double> U_;
 
-  /// The product of Sigma_inv_[i] with M_[i].
-  std::vector<Matrix<double> > Sigma_inv_M_;
+  /// The products Sigma_inv_[i] * M_[i], stored stacked vertically: rows
+  /// [i*D, (i+1)*D) hold Sigma_inv_[i] * M_[i].  Conceptually this is a
+  /// std::vector<Matrix<double> >, but storing the matrices contiguously
+  /// lets us compute the linear term of the iVector distribution with a
+  /// single matrix-vector multiply over all Gaussians at once (see
+  /// GetIvectorDistMean()), analogous to what we do with U_.
+  Matrix<double> Sigma_inv_M_;
  private:
   // var <-- quadratic_term^{-1}, but done carefully, first flooring eigenvalues
   // of quadratic_term to 1.0, which mathematically is the least they can be,
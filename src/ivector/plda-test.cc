@@ -86,7 +86,64 @@ void UnitTestPldaEstimation(int32 dim) {
     KALDI_LOG << "Diagonal of between-class variance in normalized space "
               << "should be: " << s;
   }
-  
+
+}
+
+// Estimates a small PLDA model and checks that batched scoring
+// (PreprocessEnrollment plus ScoreAgainstAll) gives the same answers as
+// LogLikelihoodRatio.
+void UnitTestPldaScoring(int32 dim) {
+  Plda plda;
+  {
+    Matrix<double> between_proj(dim, dim);
+    while (between_proj.Cond() > 100)
+      between_proj.SetRandn();
+    Matrix<double> within_proj(dim, dim);
+    while (within_proj.Cond() > 100)
+      within_proj.SetRandn();
+
+    PldaStats stats;
+    int32 num_classes = 100;
+    for (int32 n = 0; n < num_classes; n++) {
+      int32 num_egs = 1 + Rand() % 10;
+      Vector<double> rand_vec(dim);
+      rand_vec.SetRandn();
+      Vector<double> class_mean(dim);
+      class_mean.AddMatVec(1.0, between_proj, kNoTrans, rand_vec, 0.0);
+
+      Matrix<double> rand_mat(num_egs, dim);
+      rand_mat.SetRandn();
+      Matrix<double> offset_mat(num_egs, dim);
+      offset_mat.AddMatMat(1.0, rand_mat, kNoTrans, within_proj,
+                           kTrans, 0.0);
+      offset_mat.AddVecToRows(1.0, class_mean);
+      stats.AddSamples(1.0, offset_mat);
+    }
+    stats.Sort();
+    PldaEstimator estimator(stats);
+    PldaEstimationConfig config;
+    estimator.Estimate(config, &plda);
+  }
+
+  int32 num_speakers = 50;
+  Matrix<double> train_ivectors(num_speakers, dim);
+  train_ivectors.SetRandn();
+  std::vector<int32> num_utts(num_speakers);
+  for (int32 s = 0; s < num_speakers; s++)
+    num_utts[s] = 1 + Rand() % 5;
+  Vector<double> test_ivector(dim);
+  test_ivector.SetRandn();
+
+  Matrix<double> enrollment;
+  plda.PreprocessEnrollment(train_ivectors, num_utts, &enrollment);
+  Vector<double> scores;
+  plda.ScoreAgainstAll(test_ivector, enrollment, &scores);
+  KALDI_ASSERT(scores.Dim() == num_speakers);
+  for (int32 s = 0; s < num_speakers; s++) {
+    double ref = plda.LogLikelihoodRatio(train_ivectors.Row(s),
+                                         num_utts[s], test_ivector);
+    KALDI_ASSERT(fabs(scores(s) - ref) < 0.001);
+  }
 }
 
 }
@@ -110,6 +167,9 @@ int main() {
 
   // UnitTestPldaEstimation(400);
   UnitTestPldaEstimation(80);
+  for (int i = 0; i < 5; i++)
+    UnitTestPldaScoring(i + 1);
+  UnitTestPldaScoring(20);
   std::cout << "Test OK.\n";
   return 0;
 }
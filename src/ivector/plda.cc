@@ -149,6 +149,79 @@ double Plda::LogLikelihoodRatio(
   return loglike_ratio;
 }
 
+/*
+   The functions PreprocessEnrollment and ScoreAgainstAll compute the same
+   log-likelihood ratio as LogLikelihoodRatio, but factored so that scoring one
+   probe against many enrolled speakers is a single matrix-vector product.
+   Writing a_i = n \psi_i / (n \psi_i + 1) and v_i = 1 + \psi_i / (n \psi_i + 1)
+   (the per-dimension mean scale and variance from LogLikelihoodRatio), and
+   expanding the quadratic form (u^p_i - a_i u_i)^2 / v_i, the ratio becomes
+
+     \sum_i (a_i u_i / v_i) u^p_i  -  0.5 \sum_i (u^p_i)^2 / v_i
+     - 0.5 [ \sum_i \log v_i + \sum_i a_i^2 u_i^2 / v_i ]
+     + 0.5 [ \sum_i \log (1 + \psi_i) + \sum_i (u^p_i)^2 / (1 + \psi_i) ],
+
+   where the first line is linear in the "augmented probe" (u^p, (u^p)^2, 1)
+   with speaker-dependent coefficients, the second line depends only on the
+   speaker, and the third only on the probe.  (The 2 pi terms cancel.)  So we
+   store per speaker a row [ a u / v ; -0.5 / v ; second-line constant ], and
+   scoring is one GEMV plus a probe-only offset.
+*/
+
+void Plda::PreprocessEnrollment(
+    const MatrixBase<double> &transformed_train_ivectors,
+    const std::vector<int32> &num_utts,
+    Matrix<double> *enrollment) const {
+  int32 dim = Dim(),
+      num_speakers = transformed_train_ivectors.NumRows();
+  KALDI_ASSERT(transformed_train_ivectors.NumCols() == dim);
+  KALDI_ASSERT(static_cast<int32>(num_utts.size()) == num_speakers);
+  enrollment->Resize(num_speakers, 2 * dim + 1, kUndefined);
+  for (int32 s = 0; s < num_speakers; s++) {
+    int32 n = num_utts[s];
+    KALDI_ASSERT(n > 0);
+    double constant = 0.0;
+    for (int32 i = 0; i < dim; i++) {
+      double mean_scale = n * psi_(i) / (n * psi_(i) + 1.0),
+          variance = 1.0 + psi_(i) / (n * psi_(i) + 1.0),
+          u = transformed_train_ivectors(s, i);
+      (*enrollment)(s, i) = mean_scale * u / variance;
+      (*enrollment)(s, dim + i) = -0.5 / variance;
+      constant -= 0.5 * (Log(variance) +
+                         mean_scale * mean_scale * u * u / variance);
+    }
+    (*enrollment)(s, 2 * dim) = constant;
+  }
+}
+
+void Plda::ScoreAgainstAll(const VectorBase<double> &transformed_test_ivector,
+                           const MatrixBase<double> &enrollment,
+                           Vector<double> *scores) const {
+  int32 dim = Dim(),
+      num_speakers = enrollment.NumRows();
+  KALDI_ASSERT(transformed_test_ivector.Dim() == dim);
+  KALDI_ASSERT(enrollment.NumCols() == 2 * dim + 1);
+  Vector<double> probe(2 * dim + 1, kUndefined);
+  SubVector<double> linear_part(probe, 0, dim),
+      quadratic_part(probe, dim, dim);
+  linear_part.CopyFromVec(transformed_test_ivector);
+  quadratic_part.CopyFromVec(transformed_test_ivector);
+  quadratic_part.ApplyPow(2.0);
+  probe(2 * dim) = 1.0;
+  // The probe-only part of the log-likelihood ratio, i.e. plus the
+  // "without-class" log-likelihood with mean zero and variance I + \Psi;
+  // it is shared by all the speakers.
+  double probe_offset = 0.0;
+  for (int32 i = 0; i < dim; i++) {
+    double variance = 1.0 + psi_(i),
+        p = transformed_test_ivector(i);
+    probe_offset += 0.5 * (Log(variance) + p * p / variance);
+  }
+  scores->Resize(num_speakers, kUndefined);
+  scores->AddMatVec(1.0, enrollment, kNoTrans, probe, 0.0);
+  scores->Add(probe_offset);
+}
+
 
 void Plda::SmoothWithinClassCovariance(double smoothing_factor) {
   KALDI_ASSERT(smoothing_factor >= 0.0 && smoothing_factor <= 1.0);
@@ -100,7 +100,30 @@ class Plda {
                             int32 num_train_utts,
                             const VectorBase<double> &transformed_test_ivector);
 
-  
+  /// Precomputes, for a set of enrolled speakers, the quantities that
+  /// LogLikelihoodRatio() would otherwise recompute for every trial.  Each row
+  /// of "transformed_train_ivectors" is the averaged, transformed iVector of
+  /// one speaker (as given to LogLikelihoodRatio()), and num_utts gives the
+  /// number of training utterances for each of them.  The output is a matrix
+  /// with one row per speaker and 2 * Dim() + 1 columns, laid out so that the
+  /// log-likelihood ratio against a probe becomes a single dot product; see
+  /// ScoreAgainstAll().  Use this when scoring each probe against many
+  /// enrolled speakers.
+  void PreprocessEnrollment(const MatrixBase<double> &transformed_train_ivectors,
+                            const std::vector<int32> &num_utts,
+                            Matrix<double> *enrollment) const;
+
+  /// Scores one probe against all enrolled speakers at once: outputs a vector
+  /// of the same values that LogLikelihoodRatio() would give for each row of
+  /// the training iVectors that "enrollment" was computed from, but as a
+  /// single matrix-vector product.  "enrollment" must come from
+  /// PreprocessEnrollment() on this object; "scores" is resized to the number
+  /// of speakers.
+  void ScoreAgainstAll(const VectorBase<double> &transformed_test_ivector,
+                       const MatrixBase<double> &enrollment,
+                       Vector<double> *scores) const;
+
+
   /// This function smooths the within-class covariance by adding to it,
   /// smoothing_factor (e.g. 0.1) times the between-class covariance (it's
   /// implemented by modifying transform_).  This is to compensate for
@@ -22,6 +22,8 @@
 #include "util/common-utils.h"
 #include "gmm/am-diag-gmm.h"
 #include "ivector/ivector-extractor.h"
+#include "ivector/cu-ivector-extractor.h"
+#include "cudamatrix/cu-device.h"
 #include "thread/kaldi-task-sequence.h"
 
 namespace kaldi {
@@ -36,29 +38,34 @@ class IvectorExtractTask {
                      const Matrix<BaseFloat> &feats,
                      const Posterior &posterior,
                      BaseFloatVectorWriter *writer,
-                     double *tot_auxf_change):
-      extractor_(extractor), utt_(utt), feats_(feats), posterior_(posterior),
+                     double *tot_auxf_change,
+                     const CuIvectorExtractor *cu_extractor = NULL):
+      extractor_(extractor), cu_extractor_(cu_extractor), utt_(utt),
+      feats_(feats), posterior_(posterior),
       writer_(writer), tot_auxf_change_(tot_auxf_change) { }
 
   void operator () () {
     bool need_2nd_order_stats = false;
-    
+
     IvectorExtractorUtteranceStats utt_stats(extractor_.NumGauss(),
                                              extractor_.FeatDim(),
                                              need_2nd_order_stats);
-      
-    utt_stats.AccStats(feats_, posterior_);
-    
+
+    if (cu_extractor_ != NULL)
+      cu_extractor_->AccStats(feats_, posterior_, &utt_stats);
+    else
+      utt_stats.AccStats(feats_, posterior_);
+
     ivector_.Resize(extractor_.IvectorDim());
     ivector_(0) = extractor_.PriorOffset();
 
     if (tot_auxf_change_ != NULL) {
       double old_auxf = extractor_.GetAuxf(utt_stats, ivector_);
-      extractor_.GetIvectorDistribution(utt_stats, &ivector_, NULL);
+      this->GetIvectorDistribution(utt_stats);
       double new_auxf = extractor_.GetAuxf(utt_stats, ivector_);
       auxf_change_ = new_auxf - old_auxf;
     } else {
-      extractor_.GetIvectorDistribution(utt_stats, &ivector_, NULL);
+      this->GetIvectorDistribution(utt_stats);
     }
   }
   ~IvectorExtractTask() {
@@ -79,7 +86,15 @@ class IvectorExtractTask {
     writer_->Write(utt_, Vector<BaseFloat>(ivector_));
   }
  private:
+  void GetIvectorDistribution(const IvectorExtractorUtteranceStats &utt_stats) {
+    if (cu_extractor_ != NULL)
+      cu_extractor_->GetIvectorDistribution(utt_stats, &ivector_, NULL);
+    else
+      extractor_.GetIvectorDistribution(utt_stats, &ivector_, NULL);
+  }
+
   const IvectorExtractor &extractor_;
+  const CuIvectorExtractor *cu_extractor_;  // NULL unless --use-gpu was given.
   std::string utt_;
   Matrix<BaseFloat> feats_;
   Posterior posterior_;
@@ -225,6 +240,7 @@ int main(int argc, char *argv[]) {
     bool compute_objf_change = true;
     IvectorEstimationOptions opts;
     std::string spk2utt_rspecifier;
+    std::string use_gpu = "no";
     TaskSequencerConfig sequencer_config;
     po.Register("compute-objf-change", &compute_objf_change,
                 "If true, compute the change in objective function from using "
@@ -236,7 +252,10 @@ int main(int argc, char *argv[]) {
                 "is not the normal way iVectors are obtained for speaker-id. "
                 "This option will cause the program to ignore the --num-threads "
                 "option.");
-    
+    po.Register("use-gpu", &use_gpu,
+                "yes|no|optional|wait, only has effect if compiled with CUDA; "
+                "incompatible with --num-threads and --spk2utt");
+
     opts.Register(&po);
     sequencer_config.Register(&po);
     
@@ -254,12 +273,25 @@ int main(int argc, char *argv[]) {
 
 
     if (spk2utt_rspecifier.empty()) {
+      if (use_gpu != "no") {
+        // The GPU context belongs to one thread, and there is nothing for
+        // other threads to do once the heavy math is on the device.
+        if (sequencer_config.num_threads != 1)
+          KALDI_ERR << "--use-gpu is incompatible with --num-threads="
+                    << sequencer_config.num_threads;
+#if HAVE_CUDA == 1
+        CuDevice::Instantiate().SelectGpuId(use_gpu);
+#endif
+      }
       // g_num_threads affects how ComputeDerivedVars is called when we read the
       // extractor.
-      g_num_threads = sequencer_config.num_threads; 
+      g_num_threads = sequencer_config.num_threads;
       IvectorExtractor extractor;
       ReadKaldiObject(ivector_extractor_rxfilename, &extractor);
 
+      CuIvectorExtractor *cu_extractor =
+          (use_gpu != "no" ? new CuIvectorExtractor(extractor) : NULL);
+
       double tot_auxf_change = 0.0, tot_t = 0.0;
       int32 num_done = 0, num_err = 0;
     
@@ -303,13 +335,15 @@ int main(int argc, char *argv[]) {
           // note: now, this_t == sum of posteriors.
           
           sequencer.Run(new IvectorExtractTask(extractor, utt, mat, posterior,
-                                               &ivector_writer, auxf_ptr));
-          
+                                               &ivector_writer, auxf_ptr,
+                                               cu_extractor));
+
           tot_t += this_t;
           num_done++;
         }
         // Destructor of "sequencer" will wait for any remaining tasks.
       }
+      delete cu_extractor;
 
       KALDI_LOG << "Done " << num_done << " files, " << num_err
                 << " with errors.  Total (weighted) frames " << tot_t;
@@ -322,6 +356,8 @@ int main(int argc, char *argv[]) {
     } else {
       KALDI_ASSERT(sequencer_config.num_threads == 1 &&
                    "--spk2utt option is incompatible with --num-threads option");
+      if (use_gpu != "no")
+        KALDI_ERR << "--use-gpu is not supported with the --spk2utt option.";
       return RunPerSpeaker(ivector_extractor_rxfilename,
                            opts,
                            compute_objf_change,
@@ -371,6 +371,108 @@ void MaybeDoSanityCheck(const KwsLexicographicFst &index_transducer) {
 }
   
 
+// Comparison on the interval part, for sorting (interval, log-posterior)
+// pairs; used by ComputeLatticeWordPostings() below.
+static bool CompareIntervalPosteriorPair(
+    const std::pair<Interval, double> &p1,
+    const std::pair<Interval, double> &p2) {
+  return CompareInterval(p1.first, p2.first);
+}
+
+static bool CompareKwsPosting(const KwsPosting &p1, const KwsPosting &p2) {
+  return (p1.word_id != p2.word_id ? p1.word_id < p2.word_id :
+          p1.start_frame < p2.start_frame);
+}
+
+bool ComputeLatticeWordPostings(const CompactLattice &clat,
+                                const vector<int32> &state_times,
+                                int32 utterance_id,
+                                BaseFloat min_posterior,
+                                std::vector<KwsPosting> *postings) {
+  using namespace fst;
+  typedef CompactLattice::StateId StateId;
+  postings->clear();
+
+  if (clat.Start() == kNoStateId)
+    return false;
+  vector<double> alpha;
+  vector<double> beta;
+  if (!ComputeCompactLatticeAlphas(clat, &alpha) ||
+      !ComputeCompactLatticeBetas(clat, &beta))
+    return false;
+  double tot_like = beta[clat.Start()];
+
+  // For each word label, collect the time interval and log-posterior of each
+  // arc carrying that word.
+  unordered_map<int32, vector<std::pair<Interval, double> > > word_arcs;
+  for (StateIterator<CompactLattice> siter(clat); !siter.Done(); siter.Next()) {
+    StateId state_id = siter.Value();
+    for (ArcIterator<CompactLattice> aiter(clat, state_id); !aiter.Done();
+         aiter.Next()) {
+      const CompactLatticeArc &arc = aiter.Value();
+      if (state_id >= state_times.size() || arc.nextstate >= state_times.size())
+        return false;
+      if (arc.ilabel == 0)  // epsilon arcs (silences) generate no postings.
+        continue;
+      double arc_like = -(arc.weight.Weight().Value1() +
+                          arc.weight.Weight().Value2());
+      double log_post = alpha[state_id] + arc_like + beta[arc.nextstate]
+          - tot_like;
+      word_arcs[arc.ilabel].push_back(std::make_pair(
+          Interval(state_times[state_id], state_times[arc.nextstate]),
+          log_post));
+    }
+  }
+
+  double min_log_posterior = (min_posterior > 0.0 ?
+                              Log(static_cast<double>(min_posterior)) :
+                              kLogZeroDouble);
+
+  // Cluster each word's arcs the same way ClusterLattice() does: sort on
+  // time, take the maximal set of non-overlapping arcs as cluster heads, and
+  // attach each arc to the head it overlaps most.  The posting for a cluster
+  // log-adds the posteriors of its member arcs.
+  unordered_map<int32, vector<std::pair<Interval, double> > >::iterator iter;
+  for (iter = word_arcs.begin(); iter != word_arcs.end(); iter++) {
+    vector<std::pair<Interval, double> > &arcs = iter->second;
+    sort(arcs.begin(), arcs.end(), CompareIntervalPosteriorPair);
+    vector<Interval> heads;
+    heads.push_back(arcs[0].first);
+    for (int32 i = 1; i < arcs.size(); i++) {
+      if (heads.back().End() <= arcs[i].first.Start())
+        heads.push_back(arcs[i].first);
+    }
+    vector<double> cluster_post(heads.size(), kLogZeroDouble);
+    for (int32 i = 0; i < arcs.size(); i++) {
+      int32 max_overlap = 0;
+      size_t cluster = 0;
+      for (int32 j = 0; j < heads.size(); j++) {
+        int32 overlap = arcs[i].first.Overlap(heads[j]);
+        if (overlap > max_overlap) {
+          max_overlap = overlap;
+          cluster = j;
+        }
+      }
+      cluster_post[cluster] = LogAdd(cluster_post[cluster], arcs[i].second);
+    }
+    for (int32 j = 0; j < heads.size(); j++) {
+      if (cluster_post[j] < min_log_posterior)
+        continue;
+      KwsPosting posting;
+      posting.word_id = iter->first;
+      posting.utterance_id = utterance_id;
+      posting.start_frame = heads[j].Start();
+      posting.end_frame = heads[j].End();
+      posting.log_posterior = cluster_post[j];
+      postings->push_back(posting);
+    }
+  }
+  sort(postings->begin(), postings->end(), CompareKwsPosting);
+
+  return true;
+}
+
+
 void MaybeDoSanityCheck(const KwsProductFst &product_transducer) {
   typedef KwsProductFst::Arc::Label Label;
   if (GetVerboseLevel() < 2) return;
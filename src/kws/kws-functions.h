@@ -98,6 +98,39 @@ void OptimizeFactorTransducer(KwsLexicographicFst *index_transducer,
                               int32 max_states,
                               bool allow_partial);
 
+// A single word occurrence ("posting") extracted from a lattice: a cluster of
+// overlapping arcs with the same word label, summarized by the time extent of
+// the cluster head and the log of the summed arc posteriors.  This is the unit
+// stored by the posting-list index in kws-posting-index.h, which is a
+// lighter-weight alternative to the factor-transducer index when only
+// single-word (or proxy-expanded) queries are needed.
+struct KwsPosting {
+  int32 word_id;
+  int32 utterance_id;
+  int32 start_frame;
+  int32 end_frame;
+  BaseFloat log_posterior;
+  KwsPosting(): word_id(0), utterance_id(0), start_frame(0), end_frame(0),
+                log_posterior(0.0) { }
+};
+
+// This function extracts word postings from a lattice: it computes the arc
+// posteriors from the alphas and betas (ComputeCompactLatticeAlphas/Betas),
+// clusters the arcs exactly as ClusterLattice() does (cluster heads are the
+// maximal set of non-overlapping arcs per word, and each arc joins the head
+// it overlaps most), and outputs one posting per cluster with the posteriors
+// of its arcs summed.  Clusters whose total posterior is below min_posterior
+// (interpreted as a probability; 0 means no limit) are dropped.  Unlike
+// CreateFactorTransducer() this never expands the lattice, so the memory used
+// is bounded by the lattice size.  The postings come out sorted on
+// (word_id, start_frame).  Returns false if the state times do not match the
+// lattice (as ClusterLattice() does).
+bool ComputeLatticeWordPostings(const CompactLattice &clat,
+                                const vector<int32> &state_times,
+                                int32 utterance_id,
+                                BaseFloat min_posterior,
+                                std::vector<KwsPosting> *postings);
+
 // the following two functions will, if GetVerboseLevel() >= 2, check that the
 // cost of the second-best path in the transducers is not negative, and print
 // out some associated debugging info if GetVerboseLevel() >= 3.  The best path
@@ -0,0 +1,390 @@
+// kws/kws-posting-index.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "kws/kws-posting-index.h"
+#include "util/kaldi-io.h"
+
+namespace kaldi {
+
+static const char kKwsPostingIndexMagic[] = "KWSPIDX1";  // 8 bytes + NUL.
+// A spilled posting is its five fields written back to back (no padding).
+static const int32 kRawPostingBytes = 20;
+// A word-table entry is (int32 word-id, int32 num-postings, int64 offset,
+// int64 num-bytes) written back to back.
+static const int32 kTableEntryBytes = 24;
+
+// Full ordering for the index: by word, then by utterance and time, which is
+// the order the posting lists are delta-coded in.
+static bool KwsPostingIndexCompare(const KwsPosting &p1,
+                                   const KwsPosting &p2) {
+  if (p1.word_id != p2.word_id) return p1.word_id < p2.word_id;
+  if (p1.utterance_id != p2.utterance_id)
+    return p1.utterance_id < p2.utterance_id;
+  if (p1.start_frame != p2.start_frame)
+    return p1.start_frame < p2.start_frame;
+  return p1.end_frame < p2.end_frame;
+}
+
+static void WriteRawPosting(std::ostream &os, const KwsPosting &p) {
+  os.write(reinterpret_cast<const char*>(&p.word_id), 4);
+  os.write(reinterpret_cast<const char*>(&p.utterance_id), 4);
+  os.write(reinterpret_cast<const char*>(&p.start_frame), 4);
+  os.write(reinterpret_cast<const char*>(&p.end_frame), 4);
+  os.write(reinterpret_cast<const char*>(&p.log_posterior), 4);
+}
+
+static void ReadRawPosting(std::istream &is, KwsPosting *p) {
+  is.read(reinterpret_cast<char*>(&p->word_id), 4);
+  is.read(reinterpret_cast<char*>(&p->utterance_id), 4);
+  is.read(reinterpret_cast<char*>(&p->start_frame), 4);
+  is.read(reinterpret_cast<char*>(&p->end_frame), 4);
+  is.read(reinterpret_cast<char*>(&p->log_posterior), 4);
+  if (is.fail())
+    KALDI_ERR << "Error reading back spilled postings (disk full?)";
+}
+
+static void WriteVarint(std::ostream &os, uint32 value) {
+  while (value >= 0x80) {
+    char c = static_cast<char>((value & 0x7f) | 0x80);
+    os.put(c);
+    value >>= 7;
+  }
+  os.put(static_cast<char>(value));
+}
+
+// Encodes the merged, sorted posting stream into the index file and collects
+// the word-table entries; local to this file so the writer's header does not
+// need to expose the encoding state.
+class KwsPostingEncoder {
+ public:
+  struct TableEntry {
+    int32 word_id;
+    int32 num_postings;
+    int64 offset;
+    int64 num_bytes;
+  };
+
+  explicit KwsPostingEncoder(std::ostream &os): os_(os), cur_word_(-1),
+                                                prev_utt_(0), prev_start_(0) { }
+
+  void Emit(const KwsPosting &p) {
+    KALDI_ASSERT(p.word_id > 0 && p.utterance_id >= 0 &&
+                 p.end_frame >= p.start_frame);
+    if (p.word_id != cur_word_) {
+      FinishWord();
+      TableEntry entry;
+      entry.word_id = p.word_id;
+      entry.num_postings = 0;
+      entry.offset = static_cast<int64>(os_.tellp());
+      entry.num_bytes = 0;  // filled in by FinishWord().
+      table_.push_back(entry);
+      cur_word_ = p.word_id;
+      prev_utt_ = 0;
+      prev_start_ = 0;
+    }
+    int32 utt_delta = p.utterance_id - prev_utt_;
+    KALDI_ASSERT(utt_delta >= 0 && "Posting stream is not sorted");
+    if (utt_delta != 0)
+      prev_start_ = 0;
+    KALDI_ASSERT(p.start_frame >= prev_start_ &&
+                 "Posting stream is not sorted");
+    WriteVarint(os_, static_cast<uint32>(utt_delta));
+    WriteVarint(os_, static_cast<uint32>(p.start_frame - prev_start_));
+    WriteVarint(os_, static_cast<uint32>(p.end_frame - p.start_frame));
+    // The posterior is stored as the negated log-posterior in fixed point
+    // with 8 fractional bits, saturated at 16 bits; this resolves posterior
+    // ratios of about 0.4% and reaches below exp(-255).
+    double cost = -256.0 * static_cast<double>(p.log_posterior);
+    if (cost < 0.0) cost = 0.0;
+    if (cost > 65535.0) cost = 65535.0;
+    uint16 quantized = static_cast<uint16>(cost + 0.5);
+    os_.write(reinterpret_cast<const char*>(&quantized), 2);
+    table_.back().num_postings++;
+    prev_utt_ = p.utterance_id;
+    prev_start_ = p.start_frame;
+  }
+
+  // Call after the last posting; returns the table.
+  const std::vector<TableEntry> &Finish() {
+    FinishWord();
+    return table_;
+  }
+
+ private:
+  void FinishWord() {
+    if (!table_.empty())
+      table_.back().num_bytes = static_cast<int64>(os_.tellp())
+          - table_.back().offset;
+  }
+
+  std::ostream &os_;
+  std::vector<TableEntry> table_;
+  int32 cur_word_;
+  int32 prev_utt_;
+  int32 prev_start_;
+};
+
+void KwsPostingIndexWriter::Open(const std::string &filename) {
+  KALDI_ASSERT(!open_);
+  KALDI_ASSERT(opts_.max_postings_in_memory > 0);
+  filename_ = filename;
+  tmp_filename_ = filename + ".tmp";
+  stream_.open(filename.c_str(),
+               std::ios_base::out | std::ios_base::trunc |
+               std::ios_base::binary);
+  if (!stream_.is_open())
+    KALDI_ERR << "Failed to open " << PrintableWxfilename(filename)
+              << " for writing.";
+  stream_.write(kKwsPostingIndexMagic, 8);
+  open_ = true;
+}
+
+void KwsPostingIndexWriter::AddPostings(
+    const std::vector<KwsPosting> &postings) {
+  KALDI_ASSERT(open_);
+  for (size_t i = 0; i < postings.size(); i++) {
+    buffer_.push_back(postings[i]);
+    if (buffer_.size() >= static_cast<size_t>(opts_.max_postings_in_memory))
+      SpillRun();
+  }
+}
+
+void KwsPostingIndexWriter::SpillRun() {
+  if (buffer_.empty())
+    return;
+  if (!tmp_stream_.is_open()) {
+    tmp_stream_.open(tmp_filename_.c_str(),
+                     std::ios_base::out | std::ios_base::trunc |
+                     std::ios_base::binary);
+    if (!tmp_stream_.is_open())
+      KALDI_ERR << "Failed to open temporary file "
+                << PrintableWxfilename(tmp_filename_) << " for writing.";
+  }
+  std::sort(buffer_.begin(), buffer_.end(), KwsPostingIndexCompare);
+  for (size_t i = 0; i < buffer_.size(); i++)
+    WriteRawPosting(tmp_stream_, buffer_[i]);
+  if (tmp_stream_.fail())
+    KALDI_ERR << "Error spilling postings to "
+              << PrintableWxfilename(tmp_filename_) << " (disk full?)";
+  run_sizes_.push_back(static_cast<int64>(buffer_.size()));
+  buffer_.clear();
+}
+
+void KwsPostingIndexWriter::Close() {
+  KALDI_ASSERT(open_);
+  KwsPostingEncoder encoder(stream_);
+  if (run_sizes_.empty()) {
+    // Everything fitted in the buffer; no merge needed.
+    std::sort(buffer_.begin(), buffer_.end(), KwsPostingIndexCompare);
+    for (size_t i = 0; i < buffer_.size(); i++)
+      encoder.Emit(buffer_[i]);
+    buffer_.clear();
+  } else {
+    SpillRun();
+    tmp_stream_.close();
+    // Merge the sorted runs.  There is one cursor per run; the number of
+    // runs is the number of postings over max_postings_in_memory, so a
+    // linear scan per output posting is cheap for any sane buffer size.
+    size_t num_runs = run_sizes_.size();
+    std::vector<std::ifstream*> streams(num_runs, static_cast<std::ifstream*>(NULL));
+    std::vector<int64> remaining(run_sizes_);
+    std::vector<KwsPosting> heads(num_runs);
+    int64 offset = 0, total = 0;
+    for (size_t i = 0; i < num_runs; i++) {
+      streams[i] = new std::ifstream(tmp_filename_.c_str(),
+                                     std::ios_base::in |
+                                     std::ios_base::binary);
+      if (!streams[i]->is_open())
+        KALDI_ERR << "Failed to reopen temporary file "
+                  << PrintableRxfilename(tmp_filename_);
+      streams[i]->seekg(offset * kRawPostingBytes);
+      ReadRawPosting(*streams[i], &heads[i]);
+      offset += run_sizes_[i];
+      total += run_sizes_[i];
+    }
+    for (int64 n = 0; n < total; n++) {
+      size_t best = num_runs;
+      for (size_t i = 0; i < num_runs; i++) {
+        if (remaining[i] > 0 &&
+            (best == num_runs ||
+             KwsPostingIndexCompare(heads[i], heads[best])))
+          best = i;
+      }
+      KALDI_ASSERT(best != num_runs);
+      encoder.Emit(heads[best]);
+      if (--remaining[best] > 0)
+        ReadRawPosting(*streams[best], &heads[best]);
+    }
+    for (size_t i = 0; i < num_runs; i++)
+      delete streams[i];
+    std::remove(tmp_filename_.c_str());
+  }
+  const std::vector<KwsPostingEncoder::TableEntry> &table = encoder.Finish();
+  int64 table_offset = static_cast<int64>(stream_.tellp()),
+      num_words = static_cast<int64>(table.size());
+  for (size_t i = 0; i < table.size(); i++) {
+    stream_.write(reinterpret_cast<const char*>(&table[i].word_id), 4);
+    stream_.write(reinterpret_cast<const char*>(&table[i].num_postings), 4);
+    stream_.write(reinterpret_cast<const char*>(&table[i].offset), 8);
+    stream_.write(reinterpret_cast<const char*>(&table[i].num_bytes), 8);
+  }
+  stream_.write(reinterpret_cast<const char*>(&table_offset), 8);
+  stream_.write(reinterpret_cast<const char*>(&num_words), 8);
+  stream_.write(kKwsPostingIndexMagic, 8);
+  if (stream_.fail())
+    KALDI_ERR << "Error writing index to " << PrintableWxfilename(filename_)
+              << " (disk full?)";
+  stream_.close();
+  KALDI_LOG << "Wrote posting-list index with " << num_words
+            << " distinct words to " << PrintableWxfilename(filename_);
+  open_ = false;
+}
+
+void KwsPostingIndexReader::Open(const std::string &filename) {
+  KALDI_ASSERT(!IsOpen());
+  filename_ = filename;
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    KALDI_ERR << "Failed to open " << PrintableRxfilename(filename)
+              << " for reading.";
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    KALDI_ERR << "Failed to stat " << PrintableRxfilename(filename);
+  }
+  mmap_size_ = static_cast<size_t>(st.st_size);
+  void *data = mmap(NULL, mmap_size_, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+    KALDI_ERR << "Failed to mmap " << PrintableRxfilename(filename);
+  mmap_data_ = static_cast<const char*>(data);
+
+  // 8-byte magic at the front, (table-offset, num-words, magic) footer at
+  // the back.
+  if (mmap_size_ < 32 ||
+      memcmp(mmap_data_, kKwsPostingIndexMagic, 8) != 0 ||
+      memcmp(mmap_data_ + mmap_size_ - 8, kKwsPostingIndexMagic, 8) != 0) {
+    Close();
+    KALDI_ERR << PrintableRxfilename(filename) << " is not a posting-list "
+              << "index file (or was written on an incompatible machine).";
+  }
+  int64 table_offset, num_words;
+  memcpy(&table_offset, mmap_data_ + mmap_size_ - 24, 8);
+  memcpy(&num_words, mmap_data_ + mmap_size_ - 16, 8);
+  if (table_offset < 8 || num_words < 0 ||
+      table_offset + num_words * kTableEntryBytes !=
+      static_cast<int64>(mmap_size_) - 24) {
+    Close();
+    KALDI_ERR << "Corrupted posting-list index "
+              << PrintableRxfilename(filename);
+  }
+  table_offset_ = table_offset;
+  num_words_ = static_cast<int32>(num_words);
+}
+
+// Decodes one varint from *p, not reading at or past "end"; used by
+// Lookup() below.
+static uint32 ReadVarint(const char **p, const char *end,
+                         const std::string &filename) {
+  uint32 value = 0;
+  int32 shift = 0;
+  while (true) {
+    if (*p >= end || shift > 28)
+      KALDI_ERR << "Corrupted posting list in "
+                << PrintableRxfilename(filename);
+    unsigned char c = static_cast<unsigned char>(*(*p)++);
+    value |= static_cast<uint32>(c & 0x7f) << shift;
+    if ((c & 0x80) == 0)
+      return value;
+    shift += 7;
+  }
+}
+
+bool KwsPostingIndexReader::Lookup(int32 word_id,
+                                   std::vector<KwsPosting> *postings) const {
+  KALDI_ASSERT(IsOpen());
+  postings->clear();
+  // Binary search on the word table.
+  int32 lo = 0, hi = num_words_ - 1, found = -1;
+  while (lo <= hi) {
+    int32 mid = lo + (hi - lo) / 2;
+    int32 mid_word;
+    memcpy(&mid_word, mmap_data_ + table_offset_ + mid * kTableEntryBytes, 4);
+    if (mid_word < word_id) lo = mid + 1;
+    else if (mid_word > word_id) hi = mid - 1;
+    else { found = mid; break; }
+  }
+  if (found == -1)
+    return false;
+  const char *entry = mmap_data_ + table_offset_ + found * kTableEntryBytes;
+  int32 num_postings;
+  int64 offset, num_bytes;
+  memcpy(&num_postings, entry + 4, 4);
+  memcpy(&offset, entry + 8, 8);
+  memcpy(&num_bytes, entry + 16, 8);
+  if (offset < 8 || num_bytes < 0 || offset + num_bytes > table_offset_)
+    KALDI_ERR << "Corrupted posting-list index "
+              << PrintableRxfilename(filename_);
+  const char *p = mmap_data_ + offset, *end = p + num_bytes;
+  postings->reserve(num_postings);
+  int32 prev_utt = 0, prev_start = 0;
+  for (int32 i = 0; i < num_postings; i++) {
+    KwsPosting posting;
+    posting.word_id = word_id;
+    int32 utt_delta = static_cast<int32>(ReadVarint(&p, end, filename_));
+    if (utt_delta != 0)
+      prev_start = 0;
+    posting.utterance_id = prev_utt + utt_delta;
+    posting.start_frame = prev_start
+        + static_cast<int32>(ReadVarint(&p, end, filename_));
+    posting.end_frame = posting.start_frame
+        + static_cast<int32>(ReadVarint(&p, end, filename_));
+    if (p + 2 > end)
+      KALDI_ERR << "Corrupted posting list in "
+                << PrintableRxfilename(filename_);
+    uint16 quantized;
+    memcpy(&quantized, p, 2);
+    p += 2;
+    posting.log_posterior = -static_cast<BaseFloat>(quantized) / 256.0;
+    postings->push_back(posting);
+    prev_utt = posting.utterance_id;
+    prev_start = posting.start_frame;
+  }
+  return true;
+}
+
+void KwsPostingIndexReader::Close() {
+  KALDI_ASSERT(mmap_data_ != NULL);
+  munmap(const_cast<char*>(mmap_data_), mmap_size_);
+  mmap_data_ = NULL;
+  mmap_size_ = 0;
+  num_words_ = 0;
+  table_offset_ = 0;
+}
+
+}  // namespace kaldi
@@ -0,0 +1,148 @@
+// kws/kws-posting-index.h
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_KWS_KWS_POSTING_INDEX_H_
+#define KALDI_KWS_KWS_POSTING_INDEX_H_
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "itf/options-itf.h"
+#include "kws/kws-functions.h"
+
+namespace kaldi {
+
+/// The classes in this file implement an on-disk posting-list index over the
+/// word occurrences that ComputeLatticeWordPostings() extracts from lattices
+/// (see kws-functions.h).  The factor-transducer index built by
+/// lattice-to-kws-index holds whole expanded transducers in memory, which
+/// forces large archives to be split into shards; this builder instead
+/// streams postings through a fixed-size buffer, spilling sorted runs to a
+/// temporary file and merging them when the index is finalized, so the build
+/// memory is bounded by the buffer size regardless of the archive size.
+///
+/// The file starts with an 8-byte magic, followed by one varint-compressed
+/// posting list per word (utterance-ids and start frames delta-coded,
+/// durations as-is, posteriors quantized to 16 bits), then a table of
+/// (word-id, num-postings, offset, length) entries sorted on the word-id, and
+/// a footer giving the table position plus the magic again.  The reader maps
+/// the whole file with mmap() and looks words up by binary search on the
+/// table, so queries touch only the pages holding the requested list.
+///
+/// Caution: like the mapped matrix archive in util/, the file is in the byte
+/// order of the machine that wrote it and is meant for use within a compute
+/// cluster, not for interchange.
+
+struct KwsPostingIndexOptions {
+  int32 max_postings_in_memory;
+  KwsPostingIndexOptions(): max_postings_in_memory(1000000) { }
+  void Register(OptionsItf *opts) {
+    opts->Register("max-postings-in-memory", &max_postings_in_memory,
+                   "Number of postings the index builder buffers before "
+                   "spilling a sorted run to disk; this bounds the build-time "
+                   "memory (each buffered posting takes 20 bytes).");
+  }
+};
+
+/// KwsPostingIndexWriter builds an index file in the format described above.
+/// Postings may be added in any order; they are sorted as runs are spilled
+/// and merged in Close().
+class KwsPostingIndexWriter {
+ public:
+  explicit KwsPostingIndexWriter(const KwsPostingIndexOptions &opts):
+      opts_(opts), open_(false) { }
+
+  /// Opens the file, crashing via KALDI_ERR if it cannot be opened.  This is
+  /// a plain filename, not a wspecifier.
+  void Open(const std::string &filename);
+
+  bool IsOpen() const { return open_; }
+
+  /// Adds the postings of one utterance (typically the output of
+  /// ComputeLatticeWordPostings()) to the index.
+  void AddPostings(const std::vector<KwsPosting> &postings);
+
+  /// Merges the spilled runs, writes the word table and the footer, closes
+  /// the file and removes the temporary file; called from the destructor if
+  /// you do not call it.  It is an error to call Close() if the writer is
+  /// not open.
+  void Close();
+
+  ~KwsPostingIndexWriter() {
+    if (open_) Close();
+  }
+
+ private:
+  // Sorts the buffer and appends it to the temporary file as one run.
+  void SpillRun();
+
+  KwsPostingIndexOptions opts_;
+  bool open_;
+  std::string filename_;
+  std::string tmp_filename_;
+  std::ofstream stream_;       // the index file itself.
+  std::ofstream tmp_stream_;   // the spilled sorted runs.
+  std::vector<KwsPosting> buffer_;
+  std::vector<int64> run_sizes_;  // #postings in each spilled run.
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(KwsPostingIndexWriter);
+};
+
+/// KwsPostingIndexReader provides query-time access to an index file written
+/// by KwsPostingIndexWriter, via mmap() as described above.
+class KwsPostingIndexReader {
+ public:
+  KwsPostingIndexReader(): mmap_data_(NULL), mmap_size_(0), num_words_(0),
+                           table_offset_(0) { }
+
+  /// Maps the file and reads the table location, crashing via KALDI_ERR if
+  /// the file cannot be mapped or is not an index file.
+  void Open(const std::string &filename);
+
+  bool IsOpen() const { return mmap_data_ != NULL; }
+
+  /// The number of distinct word-ids in the index.
+  int32 NumWords() const { return num_words_; }
+
+  /// Decodes the posting list of the given word into "postings", which come
+  /// out sorted on (utterance-id, start-frame).  Returns false if the word
+  /// is not in the index (*postings is then empty).
+  bool Lookup(int32 word_id, std::vector<KwsPosting> *postings) const;
+
+  void Close();
+
+  ~KwsPostingIndexReader() {
+    if (IsOpen()) Close();
+  }
+
+ private:
+  const char *mmap_data_;
+  size_t mmap_size_;
+  int32 num_words_;
+  int64 table_offset_;
+  std::string filename_;  // for error messages.
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(KwsPostingIndexReader);
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_KWS_KWS_POSTING_INDEX_H_
@@ -0,0 +1,130 @@
+// kwsbin/lattice-to-kws-postings.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "lat/kaldi-lattice.h"
+#include "lat/lattice-functions.h"
+#include "kws/kws-functions.h"
+#include "kws/kws-posting-index.h"
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    typedef kaldi::int32 int32;
+    typedef kaldi::uint64 uint64;
+
+    const char *usage =
+        "Build a posting-list keyword index from the given lattices: for each\n"
+        "word in each lattice we store the clustered occurrences (utterance-id,\n"
+        "start frame, end frame, log-posterior) in a compressed on-disk format\n"
+        "supporting memory-mapped lookup (see src/kws/kws-posting-index.h).\n"
+        "Unlike lattice-to-kws-index this streams through the archive with\n"
+        "bounded memory, so the whole archive can be indexed in one run, but\n"
+        "the index only supports single-word queries.\n"
+        "\n"
+        "Usage: lattice-to-kws-postings [options] utter-symtab-rspecifier "
+        "lattice-rspecifier index-file\n"
+        " e.g.: lattice-to-kws-postings ark:utter.symtab ark:1.lats global.pidx\n";
+
+    ParseOptions po(usage);
+
+    bool strict = true;
+    BaseFloat min_posterior = 0.0;
+    KwsPostingIndexOptions index_opts;
+    po.Register("strict", &strict, "Setting --strict=false will cause successful "
+                "termination even if we processed no lattices.");
+    po.Register("min-posterior", &min_posterior, "Word occurrences with "
+                "posterior below this are not indexed (0 == keep all).");
+    index_opts.Register(&po);
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 3) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string usymtab_rspecifier = po.GetArg(1),
+        lats_rspecifier = po.GetArg(2),
+        index_filename = po.GetArg(3);
+
+    // We use RandomAccessInt32Reader to read the utterance symtab table.
+    RandomAccessInt32Reader usymtab_reader(usymtab_rspecifier);
+
+    SequentialCompactLatticeReader clat_reader(lats_rspecifier);
+    KwsPostingIndexWriter index_writer(index_opts);
+    index_writer.Open(index_filename);
+
+    int32 n_done = 0;
+    int32 n_fail = 0;
+
+    for (; !clat_reader.Done(); clat_reader.Next()) {
+      std::string key = clat_reader.Key();
+      CompactLattice clat = clat_reader.Value();
+      clat_reader.FreeCurrent();
+
+      // Check if we have the corresponding utterance id.
+      if (!usymtab_reader.HasKey(key)) {
+        KALDI_WARN << "Cannot find utterance id for " << key;
+        n_fail++;
+        continue;
+      }
+
+      // Topologically sort the lattice, if not already sorted.
+      uint64 props = clat.Properties(fst::kFstProperties, false);
+      if (!(props & fst::kTopSorted)) {
+        if (fst::TopSort(&clat) == false) {
+          KALDI_WARN << "Cycles detected in lattice " << key;
+          n_fail++;
+          continue;
+        }
+      }
+
+      // Get the alignments
+      std::vector<int32> state_times;
+      CompactLatticeStateTimes(clat, &state_times);
+
+      int32 utterance_id = usymtab_reader.Value(key);
+      std::vector<KwsPosting> postings;
+      if (!ComputeLatticeWordPostings(clat, state_times, utterance_id,
+                                      min_posterior, &postings)) {
+        KALDI_WARN << "State id's and alignments do not match for lattice "
+                   << key;
+        n_fail++;
+        continue;
+      }
+      index_writer.AddPostings(postings);
+
+      n_done++;
+    }
+
+    index_writer.Close();
+
+    KALDI_LOG << "Done " << n_done << " lattices, failed for " << n_fail;
+    if (strict == true)
+      return (n_done != 0 ? 0 : 1);
+    else
+      return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
@@ -0,0 +1,160 @@
+// lat/compressed-lattice-test.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lat/compressed-lattice.h"
+#include "fstext/rand-fst.h"
+
+namespace kaldi {
+
+static CompactLattice *RandCompactLattice() {
+  Lattice *fst = fst::RandPairFst<LatticeArc>();
+  CompactLattice *cfst = new CompactLattice;
+  ConvertLattice(*fst, cfst);
+  delete fst;
+  return cfst;
+}
+
+// Checks that clat2 has the same structure and alignments as clat1 (assuming
+// both are sorted the same way) and costs that match to within "precision".
+static void AssertLatticesMatch(const CompactLattice &clat1,
+                                const CompactLattice &clat2,
+                                BaseFloat precision) {
+  typedef CompactLattice::StateId StateId;
+  KALDI_ASSERT(clat1.NumStates() == clat2.NumStates());
+  KALDI_ASSERT(clat1.Start() == clat2.Start());
+  for (StateId s = 0; s < clat1.NumStates(); s++) {
+    KALDI_ASSERT((clat1.Final(s) == CompactLatticeWeight::Zero()) ==
+                 (clat2.Final(s) == CompactLatticeWeight::Zero()));
+    if (clat1.Final(s) != CompactLatticeWeight::Zero()) {
+      KALDI_ASSERT(clat1.Final(s).String() == clat2.Final(s).String());
+      KALDI_ASSERT(fabs(clat1.Final(s).Weight().Value1() -
+                        clat2.Final(s).Weight().Value1()) <= precision);
+      KALDI_ASSERT(fabs(clat1.Final(s).Weight().Value2() -
+                        clat2.Final(s).Weight().Value2()) <= precision);
+    }
+    KALDI_ASSERT(clat1.NumArcs(s) == clat2.NumArcs(s));
+    fst::ArcIterator<CompactLattice> aiter1(clat1, s), aiter2(clat2, s);
+    for (; !aiter1.Done(); aiter1.Next(), aiter2.Next()) {
+      const CompactLatticeArc &arc1 = aiter1.Value(),
+          &arc2 = aiter2.Value();
+      KALDI_ASSERT(arc1.ilabel == arc2.ilabel &&
+                   arc1.olabel == arc2.olabel &&
+                   arc1.nextstate == arc2.nextstate);
+      KALDI_ASSERT(arc1.weight.String() == arc2.weight.String());
+      KALDI_ASSERT(fabs(arc1.weight.Weight().Value1() -
+                        arc2.weight.Weight().Value1()) <= precision);
+      KALDI_ASSERT(fabs(arc1.weight.Weight().Value2() -
+                        arc2.weight.Weight().Value2()) <= precision);
+    }
+  }
+}
+
+void TestCompressedLatticeRoundTrip() {
+  CompactLattice *clat = RandCompactLattice();
+  if (clat->Properties(fst::kTopSorted, true) == 0) {
+    // The encoder sorts, so sort the reference too for the comparison.
+    fst::TopSort(clat);
+  }
+  BaseFloat precision = (Rand() % 2 == 0 ? 1.0 / 1024.0 : 1.0 / 64.0);
+  CompressedCompactLattice compressed(*clat, precision);
+  KALDI_ASSERT(compressed.NumStates() == clat->NumStates());
+  CompactLattice decoded;
+  compressed.CopyToLattice(&decoded);
+  AssertLatticesMatch(*clat, decoded, precision * 1.001);
+  delete clat;
+}
+
+void TestCompressedLatticeIo() {
+  CompactLattice *clat = RandCompactLattice();
+  fst::TopSort(clat);
+  CompressedCompactLattice compressed(*clat, 1.0 / 1024.0);
+  std::ostringstream os;
+  compressed.Write(os, true);
+  std::istringstream is(os.str());
+  CompressedCompactLattice compressed2;
+  compressed2.Read(is, true);
+  CompactLattice decoded1, decoded2;
+  compressed.CopyToLattice(&decoded1);
+  compressed2.CopyToLattice(&decoded2);
+  AssertLatticesMatch(decoded1, decoded2, 0.0001);
+  delete clat;
+}
+
+void TestCompressedLatticeTable() {
+  int32 N = 10;
+  std::vector<CompactLattice*> lat_vec(N);
+  {
+    CompressedCompactLatticeWriter writer("ark:tmpf");
+    for (int32 i = 0; i < N; i++) {
+      char buf[2];
+      buf[0] = '0' + i;
+      buf[1] = '\0';
+      std::string key = "key" + std::string(buf);
+      CompactLattice *clat = RandCompactLattice();
+      fst::TopSort(clat);
+      lat_vec[i] = clat;
+      CompressedCompactLattice compressed(*clat, 1.0 / 1024.0);
+      writer.Write(key, compressed);
+    }
+  }
+  RandomAccessCompressedCompactLatticeReader reader("ark:tmpf");
+  for (int32 i = 0; i < N; i++) {
+    char buf[2];
+    buf[0] = '0' + i;
+    buf[1] = '\0';
+    std::string key = "key" + std::string(buf);
+    CompactLattice decoded;
+    reader.Value(key).CopyToLattice(&decoded);
+    AssertLatticesMatch(*lat_vec[i], decoded, 1.001 / 1024.0);
+    delete lat_vec[i];
+  }
+}
+
+void TestCompressedLatticeTimeRange() {
+  CompactLattice *clat = RandCompactLattice();
+  fst::TopSort(clat);
+  CompressedCompactLattice compressed(*clat, 1.0 / 1024.0);
+  int32 num_frames = compressed.NumFrames();
+  // The full range keeps every state, so after the extra start state the
+  // output must have a path wherever the original does.
+  CompactLattice ranged;
+  compressed.DecodeTimeRange(0, num_frames, &ranged);
+  if (clat->NumStates() > 0) {
+    KALDI_ASSERT(ranged.NumStates() > 0);
+    KALDI_ASSERT(ranged.NumStates() <= clat->NumStates() + 1);
+  }
+  // An empty range at a random offset must still produce a valid (possibly
+  // empty) lattice without crashing.
+  int32 t = Rand() % (num_frames + 1);
+  compressed.DecodeTimeRange(t, t, &ranged);
+  delete clat;
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  for (int32 i = 0; i < 30; i++) {
+    TestCompressedLatticeRoundTrip();
+    TestCompressedLatticeIo();
+    TestCompressedLatticeTimeRange();
+  }
+  TestCompressedLatticeTable();
+  KALDI_LOG << "Test OK.";
+}
@@ -0,0 +1,403 @@
+// lat/compressed-lattice.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstring>
+
+#include "lat/compressed-lattice.h"
+
+namespace kaldi {
+
+// Record layout: a 28-byte header -- the magic below, then int32 num-states,
+// int32 start-state, int32 num-arcs, int32 num-frames, float precision,
+// int32 body-bytes -- followed by the body: for each state, in topological
+// order, the zigzag-varint delta of its time from the previous state's time,
+// then a varint holding (num-arcs << 1 | has-final-weight), the final weight
+// if present, and the arcs.  Each arc is a varint word label, a varint
+// next-state offset (next-state minus this state; positive since the states
+// are sorted), and its weight.  A weight is the two costs as zigzag varints
+// of round(cost / precision), then the alignment as a varint length and
+// zigzag-varint deltas of successive transition-ids.
+
+static const char kCompressedLatticeMagic[] = "CCL1";  // 4 bytes + NUL.
+static const int32 kCompressedLatticeHeaderBytes = 28;
+
+// Offsets of the header fields, after the 4-byte magic.
+enum {
+  kHeaderNumStates = 4,
+  kHeaderStart = 8,
+  kHeaderNumArcs = 12,
+  kHeaderNumFrames = 16,
+  kHeaderPrecision = 20,
+  kHeaderBodyBytes = 24
+};
+
+static inline uint32 ZigzagEncode(int32 n) {
+  return (static_cast<uint32>(n) << 1) ^ static_cast<uint32>(n >> 31);
+}
+
+static inline int32 ZigzagDecode(uint32 n) {
+  return static_cast<int32>(n >> 1) ^ -static_cast<int32>(n & 1);
+}
+
+static void AppendVarint(std::string *buf, uint32 value) {
+  while (value >= 0x80) {
+    buf->push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  buf->push_back(static_cast<char>(value));
+}
+
+static uint32 ReadVarint(const char **p, const char *end) {
+  uint32 value = 0;
+  int32 shift = 0;
+  while (true) {
+    if (*p >= end || shift > 28)
+      KALDI_ERR << "Corrupted compressed lattice.";
+    unsigned char c = static_cast<unsigned char>(*(*p)++);
+    value |= static_cast<uint32>(c & 0x7f) << shift;
+    if ((c & 0x80) == 0)
+      return value;
+    shift += 7;
+  }
+}
+
+static void AppendWeight(std::string *buf, const CompactLatticeWeight &w,
+                         BaseFloat precision) {
+  double inv_precision = 1.0 / precision;
+  int32 q_graph = static_cast<int32>(floor(
+      w.Weight().Value1() * inv_precision + 0.5));
+  int32 q_acoustic = static_cast<int32>(floor(
+      w.Weight().Value2() * inv_precision + 0.5));
+  AppendVarint(buf, ZigzagEncode(q_graph));
+  AppendVarint(buf, ZigzagEncode(q_acoustic));
+  const std::vector<int32> &string = w.String();
+  AppendVarint(buf, static_cast<uint32>(string.size()));
+  int32 prev_tid = 0;
+  for (size_t i = 0; i < string.size(); i++) {
+    AppendVarint(buf, ZigzagEncode(string[i] - prev_tid));
+    prev_tid = string[i];
+  }
+}
+
+static CompactLatticeWeight ReadWeight(const char **p, const char *end,
+                                       BaseFloat precision) {
+  BaseFloat graph_cost = ZigzagDecode(ReadVarint(p, end)) * precision;
+  BaseFloat acoustic_cost = ZigzagDecode(ReadVarint(p, end)) * precision;
+  int32 len = static_cast<int32>(ReadVarint(p, end));
+  std::vector<int32> string(len);
+  int32 prev_tid = 0;
+  for (int32 i = 0; i < len; i++) {
+    prev_tid += ZigzagDecode(ReadVarint(p, end));
+    string[i] = prev_tid;
+  }
+  return CompactLatticeWeight(LatticeWeight(graph_cost, acoustic_cost),
+                              string);
+}
+
+// Computes per-state times of a topologically sorted CompactLattice, taking
+// the maximum over paths if the lattice is inconsistent (it should not be,
+// but we do not want compression to be the thing that crashes on such a
+// lattice).  Returns the largest state time.
+static int32 CompressedLatticeStateTimes(const CompactLattice &clat,
+                                         std::vector<int32> *times) {
+  typedef CompactLattice::StateId StateId;
+  int32 num_states = clat.NumStates(), max_time = 0;
+  times->clear();
+  times->resize(num_states, 0);
+  for (StateId s = 0; s < num_states; s++) {
+    int32 cur_time = (*times)[s];
+    if (cur_time > max_time) max_time = cur_time;
+    for (fst::ArcIterator<CompactLattice> aiter(clat, s); !aiter.Done();
+         aiter.Next()) {
+      const CompactLatticeArc &arc = aiter.Value();
+      int32 next_time = cur_time
+          + static_cast<int32>(arc.weight.String().size());
+      if ((*times)[arc.nextstate] < next_time)
+        (*times)[arc.nextstate] = next_time;
+    }
+  }
+  return max_time;
+}
+
+// Reads an int32 or float header field at the given offset.
+template<typename T>
+static inline T HeaderField(const std::string &data, int32 offset) {
+  T value;
+  memcpy(&value, data.data() + offset, sizeof(T));
+  return value;
+}
+
+void CompressedCompactLattice::CopyFromLattice(const CompactLattice &clat_in,
+                                               BaseFloat precision) {
+  typedef CompactLattice::StateId StateId;
+  KALDI_ASSERT(precision > 0.0);
+  Clear();
+  if (clat_in.Start() == fst::kNoStateId)
+    return;  // empty lattice encodes as the empty string.
+
+  const CompactLattice *clat = &clat_in;
+  CompactLattice clat_sorted;
+  if (clat_in.Properties(fst::kTopSorted, true) == 0) {
+    clat_sorted = clat_in;
+    if (!fst::TopSort(&clat_sorted))
+      KALDI_ERR << "Cannot compress cyclic lattice.";
+    clat = &clat_sorted;
+  }
+
+  std::vector<int32> times;
+  int32 num_frames = CompressedLatticeStateTimes(*clat, &times);
+  int32 num_states = clat->NumStates();
+
+  std::string body;
+  int32 num_arcs = 0, prev_time = 0;
+  for (StateId s = 0; s < num_states; s++) {
+    AppendVarint(&body, ZigzagEncode(times[s] - prev_time));
+    prev_time = times[s];
+    uint32 this_num_arcs = clat->NumArcs(s);
+    bool has_final = (clat->Final(s) != CompactLatticeWeight::Zero());
+    AppendVarint(&body, (this_num_arcs << 1) | (has_final ? 1 : 0));
+    if (has_final)
+      AppendWeight(&body, clat->Final(s), precision);
+    for (fst::ArcIterator<CompactLattice> aiter(*clat, s); !aiter.Done();
+         aiter.Next(), num_arcs++) {
+      const CompactLatticeArc &arc = aiter.Value();
+      KALDI_ASSERT(arc.nextstate > s);  // true for a top-sorted acyclic fst.
+      AppendVarint(&body, static_cast<uint32>(arc.ilabel));
+      AppendVarint(&body, static_cast<uint32>(arc.nextstate - s));
+      AppendWeight(&body, arc.weight, precision);
+    }
+  }
+
+  int32 start = clat->Start(), body_bytes = static_cast<int32>(body.size());
+  data_.reserve(kCompressedLatticeHeaderBytes + body.size());
+  data_.append(kCompressedLatticeMagic, 4);
+  data_.append(reinterpret_cast<const char*>(&num_states), 4);
+  data_.append(reinterpret_cast<const char*>(&start), 4);
+  data_.append(reinterpret_cast<const char*>(&num_arcs), 4);
+  data_.append(reinterpret_cast<const char*>(&num_frames), 4);
+  float precision_f = precision;
+  data_.append(reinterpret_cast<const char*>(&precision_f), 4);
+  data_.append(reinterpret_cast<const char*>(&body_bytes), 4);
+  data_.append(body);
+}
+
+int32 CompressedCompactLattice::NumStates() const {
+  return data_.empty() ? 0 : HeaderField<int32>(data_, kHeaderNumStates);
+}
+
+int32 CompressedCompactLattice::NumArcs() const {
+  return data_.empty() ? 0 : HeaderField<int32>(data_, kHeaderNumArcs);
+}
+
+int32 CompressedCompactLattice::NumFrames() const {
+  return data_.empty() ? 0 : HeaderField<int32>(data_, kHeaderNumFrames);
+}
+
+BaseFloat CompressedCompactLattice::Precision() const {
+  return data_.empty() ? 0.0 : HeaderField<float>(data_, kHeaderPrecision);
+}
+
+void CompressedCompactLattice::CopyToLattice(CompactLattice *clat) const {
+  typedef CompactLattice::StateId StateId;
+  clat->DeleteStates();
+  if (data_.empty())
+    return;
+  int32 num_states = NumStates();
+  BaseFloat precision = Precision();
+  const char *p = data_.data() + kCompressedLatticeHeaderBytes,
+      *end = data_.data() + data_.size();
+  for (StateId s = 0; s < num_states; s++)
+    clat->AddState();
+  clat->SetStart(HeaderField<int32>(data_, kHeaderStart));
+  for (StateId s = 0; s < num_states; s++) {
+    ReadVarint(&p, end);  // the state time; not needed for full decode.
+    uint32 arcs_and_final = ReadVarint(&p, end);
+    if (arcs_and_final & 1)
+      clat->SetFinal(s, ReadWeight(&p, end, precision));
+    for (uint32 i = arcs_and_final >> 1; i > 0; i--) {
+      int32 ilabel = static_cast<int32>(ReadVarint(&p, end));
+      StateId nextstate = s + static_cast<int32>(ReadVarint(&p, end));
+      CompactLatticeWeight weight = ReadWeight(&p, end, precision);
+      clat->AddArc(s, CompactLatticeArc(ilabel, ilabel, weight, nextstate));
+    }
+  }
+  if (p != end)
+    KALDI_ERR << "Corrupted compressed lattice (trailing data).";
+}
+
+// An arc held back by DecodeTimeRange() until it knows whether the
+// destination state is kept.
+struct PendingCompressedArc {
+  CompactLattice::StateId src;
+  int32 ilabel;
+  CompactLatticeWeight weight;
+  int32 orig_nextstate;
+  PendingCompressedArc(CompactLattice::StateId src, int32 ilabel,
+                       const CompactLatticeWeight &weight,
+                       int32 orig_nextstate):
+      src(src), ilabel(ilabel), weight(weight),
+      orig_nextstate(orig_nextstate) { }
+};
+
+// Skips over one encoded weight without constructing it.
+static void SkipWeight(const char **p, const char *end) {
+  ReadVarint(p, end);
+  ReadVarint(p, end);
+  for (uint32 len = ReadVarint(p, end); len > 0; len--)
+    ReadVarint(p, end);
+}
+
+void CompressedCompactLattice::DecodeTimeRange(int32 begin_frame,
+                                               int32 end_frame,
+                                               CompactLattice *clat) const {
+  typedef CompactLattice::StateId StateId;
+  KALDI_ASSERT(begin_frame >= 0 && begin_frame <= end_frame);
+  clat->DeleteStates();
+  if (data_.empty())
+    return;
+  int32 num_states = NumStates(),
+      orig_start = HeaderField<int32>(data_, kHeaderStart);
+  BaseFloat precision = Precision();
+  const char *p = data_.data() + kCompressedLatticeHeaderBytes,
+      *end = data_.data() + data_.size();
+
+  StateId start = clat->AddState();
+  clat->SetStart(start);
+  std::vector<PendingCompressedArc> pending_arcs;
+  // Map from original state to output state, for the kept states only; we
+  // can fill it in a single sweep because arcs only go forward.
+  std::vector<StateId> state_map(num_states, fst::kNoStateId);
+  int32 prev_time = 0;
+  for (StateId s = 0; s < num_states; s++) {
+    int32 time = prev_time + ZigzagDecode(ReadVarint(&p, end));
+    prev_time = time;
+    bool keep = (time >= begin_frame && time <= end_frame);
+    uint32 arcs_and_final = ReadVarint(&p, end);
+    StateId out_s = fst::kNoStateId;
+    if (keep) {
+      out_s = clat->AddState();
+      state_map[s] = out_s;
+      if (time == begin_frame || s == orig_start)
+        clat->AddArc(start, CompactLatticeArc(0, 0,
+                                              CompactLatticeWeight::One(),
+                                              out_s));
+      if (time == end_frame)
+        clat->SetFinal(out_s, CompactLatticeWeight::One());
+    }
+    if (arcs_and_final & 1) {
+      if (keep)
+        clat->SetFinal(out_s, ReadWeight(&p, end, precision));
+      else
+        SkipWeight(&p, end);
+    }
+    for (uint32 i = arcs_and_final >> 1; i > 0; i--) {
+      int32 ilabel = static_cast<int32>(ReadVarint(&p, end));
+      StateId nextstate = s + static_cast<int32>(ReadVarint(&p, end));
+      // The next-state is beyond s, so whether it is kept is not yet known;
+      // but its time is at least this state's time, so if this state is
+      // beyond the range nothing reachable from the arc can be kept.
+      if (keep && nextstate < num_states) {
+        pending_arcs.push_back(PendingCompressedArc(
+            out_s, ilabel, ReadWeight(&p, end, precision), nextstate));
+      } else {
+        SkipWeight(&p, end);
+      }
+    }
+  }
+  if (p != end)
+    KALDI_ERR << "Corrupted compressed lattice (trailing data).";
+  // Add the arcs whose destination states turned out to be kept.
+  for (size_t i = 0; i < pending_arcs.size(); i++) {
+    const PendingCompressedArc &arc = pending_arcs[i];
+    StateId dest = state_map[arc.orig_nextstate];
+    if (dest != fst::kNoStateId)
+      clat->AddArc(arc.src, CompactLatticeArc(arc.ilabel, arc.ilabel,
+                                              arc.weight, dest));
+  }
+  // Trim states that ended up unreachable or without a path to a final
+  // state (e.g. states whose in-range arcs were all dropped).
+  fst::Connect(clat);
+}
+
+void CompressedCompactLattice::Write(std::ostream &os, bool binary) const {
+  if (!binary)
+    KALDI_ERR << "CompressedCompactLattice does not support text-mode "
+              << "writing; decompress first.";
+  int32 num_bytes = static_cast<int32>(data_.size());
+  WriteBasicType(os, binary, num_bytes);
+  os.write(data_.data(), data_.size());
+  if (os.fail())
+    KALDI_ERR << "Error writing compressed lattice to stream.";
+}
+
+void CompressedCompactLattice::Read(std::istream &is, bool binary) {
+  if (!binary)
+    KALDI_ERR << "CompressedCompactLattice does not support text-mode "
+              << "reading.";
+  Clear();
+  int32 num_bytes;
+  ReadBasicType(is, binary, &num_bytes);
+  if (num_bytes < 0 ||
+      (num_bytes > 0 && num_bytes < kCompressedLatticeHeaderBytes))
+    KALDI_ERR << "Corrupted compressed lattice (bad size " << num_bytes
+              << ")";
+  if (num_bytes == 0)
+    return;  // an empty lattice.
+  data_.resize(num_bytes);
+  is.read(&data_[0], num_bytes);
+  if (is.fail() || memcmp(data_.data(), kCompressedLatticeMagic, 4) != 0 ||
+      HeaderField<int32>(data_, kHeaderBodyBytes) !=
+      num_bytes - kCompressedLatticeHeaderBytes)
+    KALDI_ERR << "Corrupted or truncated compressed lattice.";
+}
+
+bool CompressedCompactLatticeHolder::Write(std::ostream &os, bool binary,
+                                           const T &t) {
+  if (!binary) {
+    KALDI_WARN << "Compressed lattices can only be written in binary mode.";
+    return false;
+  }
+  InitKaldiOutputStream(os, binary);
+  try {
+    t.Write(os, binary);
+    return true;
+  } catch(const std::exception &e) {
+    KALDI_WARN << "Exception caught writing compressed lattice: " << e.what();
+    return false;
+  }
+}
+
+bool CompressedCompactLatticeHolder::Read(std::istream &is) {
+  t_.Clear();
+  bool is_binary;
+  if (!InitKaldiInputStream(is, &is_binary) || !is_binary) {
+    KALDI_WARN << "Reading compressed lattice: bad or non-binary stream "
+               << "header.";
+    return false;
+  }
+  try {
+    t_.Read(is, is_binary);
+    return true;
+  } catch(const std::exception &e) {
+    KALDI_WARN << "Exception caught reading compressed lattice: " << e.what();
+    return false;
+  }
+}
+
+}  // namespace kaldi
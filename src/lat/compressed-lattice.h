@@ -0,0 +1,136 @@
+// lat/compressed-lattice.h
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_LAT_COMPRESSED_LATTICE_H_
+#define KALDI_LAT_COMPRESSED_LATTICE_H_
+
+#include <string>
+#include <vector>
+
+#include "lat/kaldi-lattice.h"
+
+namespace kaldi {
+
+/// This class does lossy compression of a CompactLattice, in the same spirit
+/// as class CompressedMatrix does for matrices.  The regular binary lattice
+/// format stores each arc as fixed-size fields; here the lattice is encoded
+/// state by state (it is topologically sorted first if needed) with all
+/// integer quantities as variable-length integers, next-states and
+/// transition-ids delta-coded, and the graph and acoustic costs quantized to
+/// a configurable precision (the maximum error per cost, default 1/1024).
+/// Typical word-aligned lattices shrink by a factor of four to six, which
+/// matters when the archives live on network storage.
+///
+/// The record header stores the state count, arc count and frame count, so
+/// those can be inspected without decoding the arcs, and DecodeTimeRange()
+/// extracts just the arcs lying inside a time range, for scan/filter usage.
+class CompressedCompactLattice {
+ public:
+  CompressedCompactLattice() { }
+
+  explicit CompressedCompactLattice(const CompactLattice &clat,
+                                    BaseFloat precision = 1.0 / 1024.0) {
+    CopyFromLattice(clat, precision);
+  }
+
+  /// Replaces the contents of *this with an encoding of "clat".  "precision"
+  /// is the quantization step, i.e. the maximum absolute error this
+  /// introduces into each graph and acoustic cost.
+  void CopyFromLattice(const CompactLattice &clat,
+                       BaseFloat precision = 1.0 / 1024.0);
+
+  /// Decodes to a CompactLattice.  The structure and alignments are exact;
+  /// the costs are within Precision() of the originals.  The output is
+  /// topologically sorted (the encoder sorts).
+  void CopyToLattice(CompactLattice *clat) const;
+
+  /// These read the record header only, without decoding any arcs, so they
+  /// are cheap enough to use for scanning an archive.  NumFrames() is the
+  /// largest state time in the lattice, as computed by
+  /// CompactLatticeStateTimes().
+  int32 NumStates() const;
+  int32 NumArcs() const;
+  int32 NumFrames() const;
+  BaseFloat Precision() const;
+
+  bool Empty() const { return data_.empty(); }
+
+  /// Extracts the part of the lattice lying within the given time range into
+  /// "clat", without constructing the out-of-range states and arcs: a state
+  /// is kept if its time t satisfies begin_frame <= t <= end_frame, and an
+  /// arc is kept if both its endpoints are.  A new start state is added with
+  /// epsilon arcs (weight One()) to the kept states at begin_frame (and to
+  /// the original start state if kept), states at end_frame are made final
+  /// with weight One(), kept original final weights are preserved, and
+  /// disconnected states are trimmed.  This is a scan/filter primitive --
+  /// e.g. for checking which words a lattice contains in a time window --
+  /// not a way of computing posteriors over the range, since the weights
+  /// outside the range are discarded.
+  void DecodeTimeRange(int32 begin_frame, int32 end_frame,
+                       CompactLattice *clat) const;
+
+  void Write(std::ostream &os, bool binary) const;
+
+  void Read(std::istream &is, bool binary);
+
+  void Swap(CompressedCompactLattice *other) { data_.swap(other->data_); }
+
+  void Clear() { std::string temp; data_.swap(temp); }
+
+ private:
+  // The encoded record: a fixed-size header followed by the
+  // varint-compressed states and arcs.  See the .cc file for the layout.
+  std::string data_;
+};
+
+/// Holder for CompressedCompactLattice, so compressed lattices can be stored
+/// in regular Kaldi tables.  Only binary mode is supported for writing (a
+/// text form of a compressed object would defeat the purpose; use
+/// lattice-decompress if you need to look at one).
+class CompressedCompactLatticeHolder {
+ public:
+  typedef CompressedCompactLattice T;
+
+  CompressedCompactLatticeHolder() { }
+
+  static bool Write(std::ostream &os, bool binary, const T &t);
+
+  bool Read(std::istream &is);
+
+  static bool IsReadInBinary() { return true; }
+
+  T &Value() { return t_; }
+
+  void Clear() { t_.Clear(); }
+
+ private:
+  T t_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(CompressedCompactLatticeHolder);
+};
+
+typedef TableWriter<CompressedCompactLatticeHolder>
+    CompressedCompactLatticeWriter;
+typedef SequentialTableReader<CompressedCompactLatticeHolder>
+    SequentialCompressedCompactLatticeReader;
+typedef RandomAccessTableReader<CompressedCompactLatticeHolder>
+    RandomAccessCompressedCompactLatticeReader;
+
+}  // namespace kaldi
+
+#endif  // KALDI_LAT_COMPRESSED_LATTICE_H_
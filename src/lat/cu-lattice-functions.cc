@@ -0,0 +1,106 @@
+// lat/cu-lattice-functions.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lat/cu-lattice-functions.h"
+#include "lat/lattice-functions.h"
+#include "cudamatrix/cu-device.h"
+#include "cudamatrix/cu-lattice.h"
+
+namespace kaldi {
+
+BaseFloat CudaLatticeForwardBackward(const Lattice &lat,
+                                     Posterior *post,
+                                     double *acoustic_like_sum) {
+  bool gpu_active = false;
+#if HAVE_CUDA == 1
+  gpu_active = CuDevice::Instantiate().Enabled();
+#endif
+  if (!gpu_active)
+    return LatticeForwardBackward(lat, post, acoustic_like_sum);
+
+  typedef LatticeArc Arc;
+  typedef Arc::Weight Weight;
+  typedef Arc::StateId StateId;
+
+  if (lat.Properties(fst::kTopSorted, true) == 0)
+    KALDI_ERR << "Input lattice must be topologically sorted.";
+  KALDI_ASSERT(lat.Start() == 0);
+
+  if (acoustic_like_sum) *acoustic_like_sum = 0.0;
+
+  std::vector<int32> state_times;
+  int32 max_time = LatticeStateTimes(lat, &state_times);
+  int32 num_states = lat.NumStates();
+
+  // Flatten into the plain arrays the device code wants; also keep the
+  // per-arc source state for scattering the posteriors afterwards.
+  std::vector<int32> arc_offsets(num_states + 1);
+  std::vector<int32> arc_nextstate, arc_src;
+  std::vector<double> arc_loglike, final_loglike(num_states,
+                                                 kLogZeroDouble);
+  for (StateId s = 0; s < num_states; s++) {
+    arc_offsets[s] = static_cast<int32>(arc_nextstate.size());
+    for (fst::ArcIterator<Lattice> aiter(lat, s); !aiter.Done();
+         aiter.Next()) {
+      const Arc &arc = aiter.Value();
+      arc_nextstate.push_back(arc.nextstate);
+      arc_src.push_back(s);
+      arc_loglike.push_back(-ConvertToCost(arc.weight));
+    }
+    Weight f = lat.Final(s);
+    if (f != Weight::Zero()) {
+      final_loglike[s] = -(f.Value1() + f.Value2());
+      KALDI_ASSERT(state_times[s] == max_time &&
+                   "Lattice is inconsistent (final-prob not at max_time)");
+    }
+  }
+  arc_offsets[num_states] = static_cast<int32>(arc_nextstate.size());
+
+  std::vector<double> arc_post, alpha;
+  double tot_prob = CudaLatticeForwardBackward(num_states, arc_offsets,
+                                               arc_nextstate, arc_loglike,
+                                               final_loglike, &arc_post,
+                                               &alpha);
+
+  post->clear();
+  post->resize(max_time);
+  size_t i = 0;
+  for (StateId s = 0; s < num_states; s++) {
+    for (fst::ArcIterator<Lattice> aiter(lat, s); !aiter.Done();
+         aiter.Next(), i++) {
+      const Arc &arc = aiter.Value();
+      if (arc.ilabel != 0)  // Arc has a transition-id on it [not epsilon]
+        (*post)[state_times[s]].push_back(
+            std::make_pair(arc.ilabel,
+                           static_cast<BaseFloat>(arc_post[i])));
+      if (acoustic_like_sum != NULL)
+        *acoustic_like_sum -= arc_post[i] * arc.weight.Value2();
+    }
+    Weight f = lat.Final(s);
+    if (acoustic_like_sum != NULL && f != Weight::Zero()) {
+      double posterior = Exp(alpha[s] + final_loglike[s] - tot_prob);
+      *acoustic_like_sum -= posterior * f.Value2();
+    }
+  }
+  for (int32 t = 0; t < max_time; t++)
+    MergePairVectorSumming(&((*post)[t]));
+  return tot_prob;
+}
+
+}  // namespace kaldi
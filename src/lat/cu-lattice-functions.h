@@ -0,0 +1,44 @@
+// lat/cu-lattice-functions.h
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_LAT_CU_LATTICE_FUNCTIONS_H_
+#define KALDI_LAT_CU_LATTICE_FUNCTIONS_H_
+
+#include "hmm/posterior.h"
+#include "lat/kaldi-lattice.h"
+
+namespace kaldi {
+
+/// GPU version of LatticeForwardBackward() (see lat/lattice-functions.h
+/// for the semantics: writes per-frame transition-id posteriors to
+/// "post", optionally the posterior-weighted acoustic likelihood sum,
+/// and returns the total log-probability).  The alpha/beta sweeps run as
+/// level-scheduled kernels on the device (see cudamatrix/cu-lattice.h);
+/// converting the lattice to arrays and scattering the arc posteriors
+/// into "post" happen on the host.  If Kaldi was compiled without CUDA,
+/// or no GPU is active (CuDevice::SelectGpuId() was not called, or
+/// failed), this transparently falls back to the CPU implementation, so
+/// callers do not need a separate path.
+BaseFloat CudaLatticeForwardBackward(const Lattice &lat,
+                                     Posterior *post,
+                                     double *acoustic_like_sum = NULL);
+
+}  // namespace kaldi
+
+#endif  // KALDI_LAT_CU_LATTICE_FUNCTIONS_H_
@@ -161,11 +161,82 @@ template<class Arc> void TestDeterminizeLatticePruned2() {
 }
 
 
+// test the windowed version against the whole-lattice version.  We chain
+// several random acyclic FSTs through single connector states, so the
+// resulting lattice is guaranteed to have cut states to split at.
+template<class Arc> void TestDeterminizeLatticePrunedWindowed() {
+  typedef kaldi::int32 Int;
+  typedef typename Arc::Weight Weight;
+  typedef typename Arc::StateId StateId;
+  typedef ArcTpl<CompactLatticeWeightTpl<Weight, Int> > CompactArc;
+
+  for (int i = 0; i < 100; i++) {
+    RandFstOptions opts;
+    opts.n_states = 4;
+    opts.n_arcs = 10;
+    opts.n_final = 2;
+    opts.allow_empty = false;
+    opts.weight_multiplier = 0.5;  // impt for the randomly generated weights
+    opts.acyclic = true;           // to be exactly representable in float.
+
+    VectorFst<Arc> fst;
+    int num_pieces = 2 + kaldi::Rand() % 3;
+    for (int p = 0; p < num_pieces; p++) {
+      VectorFst<Arc> *piece = RandPairFst<Arc>(opts);
+      StateId offset = fst.NumStates();
+      for (StateId s = 0; s < piece->NumStates(); s++) {
+        fst.AddState();
+        fst.SetFinal(offset + s, piece->Final(s));
+        for (ArcIterator<VectorFst<Arc> > aiter(*piece, s); !aiter.Done();
+             aiter.Next()) {
+          Arc arc = aiter.Value();
+          arc.nextstate += offset;
+          fst.AddArc(offset + s, arc);
+        }
+      }
+      if (p == 0) {
+        fst.SetStart(offset + piece->Start());
+      } else {
+        // Connect the previous piece's final states to this piece's start;
+        // using a nonzero label because RandEquivalent below does not treat
+        // epsilons specially.
+        typename Arc::Label label = 1 + kaldi::Rand() % 5;
+        for (StateId s = 0; s < offset; s++) {
+          Weight final = fst.Final(s);
+          if (final != Weight::Zero()) {
+            fst.AddArc(s, Arc(label, label, final,
+                              offset + piece->Start()));
+            fst.SetFinal(s, Weight::Zero());
+          }
+        }
+      }
+      delete piece;
+    }
+    Connect(&fst);
+    bool sorted = TopSort(&fst);
+    KALDI_ASSERT(sorted);
+    if (fst.NumStates() == 0) continue;
+
+    // A beam large enough that nothing gets pruned, so the windowed and
+    // whole-lattice versions should both be equivalent to the input.
+    double beam = 100.0;
+    VectorFst<CompactArc> det_fst, det_fst_windowed;
+    bool ans = DeterminizeLatticePruned<Weight, Int>(fst, beam, &det_fst);
+    bool ans_windowed = DeterminizeLatticePrunedWindowed<Weight, Int>(
+        fst, beam, 1 + kaldi::Rand() % 5, &det_fst_windowed);
+    KALDI_ASSERT(ans && ans_windowed);
+    KALDI_ASSERT(RandEquivalent(det_fst, det_fst_windowed, 5/*paths*/,
+                                0.01/*delta*/, kaldi::Rand()/*seed*/,
+                                100/*path length, max*/));
+  }
+}
+
 } // end namespace fst
 
 int main() {
   using namespace fst;
   TestDeterminizeLatticePruned<kaldi::LatticeArc>();
   TestDeterminizeLatticePruned2<kaldi::LatticeArc>();
+  TestDeterminizeLatticePrunedWindowed<kaldi::LatticeArc>();
   std::cout << "Tests succeeded\n";
 }
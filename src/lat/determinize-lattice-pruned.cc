@@ -1306,6 +1306,164 @@ bool DeterminizeLatticePruned(const ExpandedFst<ArcTpl<Weight> > &ifst,
   return false; // Suppress compiler warning; this code is unreachable.
 }
 
+// Finds, in topological order, the "cut states" of a topologically sorted
+// fst: states that every successful path from the start state to a final
+// state passes through.  With the states in topological order, state s is a
+// cut state iff no arc leaving an earlier state reaches past s and no earlier
+// state is final, which we detect in a single sweep by tracking the furthest
+// arc destination seen so far.  (The no-earlier-final condition keeps the
+// windowed splitting below correct: a path may not end before the cut.)
+template<class Weight>
+static void FindLatticeCutStates(
+    const ExpandedFst<ArcTpl<Weight> > &fst,
+    std::vector<typename ArcTpl<Weight>::StateId> *cut_states) {
+  typedef ArcTpl<Weight> Arc;
+  typedef typename Arc::StateId StateId;
+  cut_states->clear();
+  StateId num_states = fst.NumStates(), max_reach = 0;
+  bool seen_final = false;
+  for (StateId s = 0; s < num_states; s++) {
+    if (s > 0 && max_reach == s && !seen_final)
+      cut_states->push_back(s);
+    for (ArcIterator<ExpandedFst<Arc> > aiter(fst, s); !aiter.Done();
+         aiter.Next())
+      max_reach = std::max(max_reach, aiter.Value().nextstate);
+    if (fst.Final(s) != Weight::Zero())
+      seen_final = true;
+  }
+}
+
+template<class Weight, class IntType>
+bool DeterminizeLatticePrunedWindowed(
+    const ExpandedFst<ArcTpl<Weight> > &ifst,
+    double beam,
+    typename ArcTpl<Weight>::StateId min_window_states,
+    MutableFst<ArcTpl<CompactLatticeWeightTpl<Weight, IntType> > > *ofst,
+    DeterminizeLatticePrunedOptions opts) {
+  typedef ArcTpl<Weight> Arc;
+  typedef typename Arc::StateId StateId;
+  typedef CompactLatticeWeightTpl<Weight, IntType> CompactWeight;
+  typedef ArcTpl<CompactWeight> CompactArc;
+  KALDI_ASSERT(min_window_states > 0);
+
+  StateId num_states = ifst.NumStates();
+  // The splitting below relies on the start state coming first in the
+  // topological order, which is how TopSort() numbers connected input.
+  if (num_states == 0 || ifst.Start() != 0)
+    return DeterminizeLatticePruned<Weight, IntType>(ifst, beam, ofst, opts);
+  std::vector<StateId> cut_states;
+  FindLatticeCutStates(ifst, &cut_states);
+  // "boundaries" are the window starts: the subset of cut states that leave
+  // at least min_window_states states on both sides, plus the start state.
+  std::vector<StateId> boundaries;
+  boundaries.push_back(0);
+  for (size_t i = 0; i < cut_states.size(); i++)
+    if (cut_states[i] - boundaries.back() >= min_window_states &&
+        num_states - cut_states[i] >= min_window_states)
+      boundaries.push_back(cut_states[i]);
+  if (boundaries.size() == 1)  // no usable cut state; nothing to be gained.
+    return DeterminizeLatticePruned<Weight, IntType>(ifst, beam, ofst, opts);
+  boundaries.push_back(num_states);  // sentinel ending the last window.
+  size_t num_windows = boundaries.size() - 1;
+  KALDI_VLOG(2) << "Windowed determinization: splitting lattice with "
+                << num_states << " states into " << num_windows
+                << " windows.";
+
+  ofst->DeleteStates();
+  ofst->SetInputSymbols(ifst.InputSymbols());
+  ofst->SetOutputSymbols(ifst.OutputSymbols());
+
+  bool ans = true;
+  // Final states of the most recently appended window, with their final
+  // weights; the next window gets spliced onto these.
+  std::vector<std::pair<StateId, CompactWeight> > pending;
+  for (size_t w = 0; w < num_windows; w++) {
+    StateId begin = boundaries[w], end = boundaries[w + 1];
+    bool last_window = (w + 1 == num_windows);
+    VectorFst<Arc> window_fst;
+    for (StateId s = begin; s < end; s++) {
+      window_fst.AddState();
+      window_fst.SetFinal(s - begin, ifst.Final(s));
+    }
+    if (!last_window) {
+      // The next cut state becomes an extra final state with no arcs; its
+      // own arcs and final weight belong to the next window.
+      window_fst.SetFinal(window_fst.AddState(), Weight::One());
+    }
+    window_fst.SetStart(0);
+    for (StateId s = begin; s < end; s++) {
+      for (ArcIterator<ExpandedFst<Arc> > aiter(ifst, s); !aiter.Done();
+           aiter.Next()) {
+        Arc arc = aiter.Value();
+        // By the cut-state property no arc reaches past the window's end.
+        KALDI_PARANOID_ASSERT(arc.nextstate <= end);
+        arc.nextstate -= begin;
+        window_fst.AddArc(s - begin, arc);
+      }
+    }
+
+    VectorFst<CompactArc> det_fst;
+    ans = DeterminizeLatticePruned<Weight, IntType>(window_fst, beam,
+                                                    &det_fst, opts) && ans;
+    // Append det_fst's states to ofst; handling of start and final states
+    // comes below.
+    StateId offset = ofst->NumStates(),
+        det_num_states = det_fst.NumStates();
+    std::vector<std::pair<StateId, CompactWeight> > pending_next;
+    for (StateId s = 0; s < det_num_states; s++) {
+      ofst->AddState();
+      for (ArcIterator<VectorFst<CompactArc> > aiter(det_fst, s);
+           !aiter.Done(); aiter.Next()) {
+        CompactArc arc = aiter.Value();
+        arc.nextstate += offset;
+        ofst->AddArc(offset + s, arc);
+      }
+      CompactWeight final = det_fst.Final(s);
+      if (final != CompactWeight::Zero()) {
+        if (last_window) ofst->SetFinal(offset + s, final);
+        else pending_next.push_back(std::make_pair(offset + s, final));
+      }
+    }
+    if (det_num_states == 0 || (!last_window && pending_next.empty())) {
+      // Can happen only if determinization of a window was cut short so
+      // severely that nothing reached the cut state; the retry mechanism in
+      // DeterminizeLatticePruned() makes this very unlikely.
+      KALDI_WARN << "Determinization of window " << w << " of " << num_windows
+                 << " reached no final state; falling back to whole-lattice "
+                 << "determinization.";
+      ofst->DeleteStates();
+      return DeterminizeLatticePruned<Weight, IntType>(ifst, beam, ofst, opts);
+    }
+    if (w == 0) {
+      ofst->SetStart(offset + det_fst.Start());
+    } else {
+      // Splice this window onto the previous window's final states: each of
+      // them gets a copy of the arcs leaving this window's determinized start
+      // state, with the final weight multiplied on, so no epsilon seam arcs
+      // appear in the output.  The start state itself generally becomes
+      // unreachable and is removed by Connect() below.
+      StateId det_start = det_fst.Start();
+      CompactWeight start_final = det_fst.Final(det_start);
+      for (size_t i = 0; i < pending.size(); i++) {
+        StateId src = pending[i].first;
+        const CompactWeight &weight_in = pending[i].second;
+        for (ArcIterator<VectorFst<CompactArc> > aiter(det_fst, det_start);
+             !aiter.Done(); aiter.Next()) {
+          CompactArc arc = aiter.Value();
+          arc.weight = Times(weight_in, arc.weight);
+          arc.nextstate += offset;
+          ofst->AddArc(src, arc);
+        }
+        if (start_final != CompactWeight::Zero())
+          ofst->SetFinal(src, Times(weight_in, start_final));
+      }
+    }
+    pending.swap(pending_next);
+  }
+  Connect(ofst);
+  return ans;
+}
+
 template<class Weight>
 typename ArcTpl<Weight>::Label DeterminizeLatticeInsertPhones(
     const kaldi::TransitionModel &trans_model,
@@ -1465,8 +1623,12 @@ bool DeterminizeLatticePhonePruned(
   // If --word-determinize is true, do the determinization on word lattices.
   if (opts.word_determinize) {
     KALDI_VLOG(1) << "Doing second pass of determinization on word lattices.";
-    ans = DeterminizeLatticePruned<Weight, IntType>(
-        *ifst, beam, ofst, det_opts) && ans;
+    if (opts.min_window_states > 0)
+      ans = DeterminizeLatticePrunedWindowed<Weight, IntType>(
+          *ifst, beam, opts.min_window_states, ofst, det_opts) && ans;
+    else
+      ans = DeterminizeLatticePruned<Weight, IntType>(
+          *ifst, beam, ofst, det_opts) && ans;
   }
 
   // If --minimize is true, push and minimize after determinization.
@@ -1532,7 +1694,15 @@ template
 bool DeterminizeLatticePruned<kaldi::LatticeWeight>(
     const ExpandedFst<kaldi::LatticeArc> &ifst,
     double prune,
-    MutableFst<kaldi::LatticeArc> *ofst, 
+    MutableFst<kaldi::LatticeArc> *ofst,
+    DeterminizeLatticePrunedOptions opts);
+
+template
+bool DeterminizeLatticePrunedWindowed<kaldi::LatticeWeight, kaldi::int32>(
+    const ExpandedFst<kaldi::LatticeArc> &ifst,
+    double prune,
+    kaldi::LatticeArc::StateId min_window_states,
+    MutableFst<kaldi::CompactLatticeArc> *ofst,
     DeterminizeLatticePrunedOptions opts);
 
 template
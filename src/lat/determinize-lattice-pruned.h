@@ -155,11 +155,20 @@ struct DeterminizeLatticePhonePrunedOptions {
   bool word_determinize;
   // minimize: if true, push and minimize after determinization.
   bool minimize;
+  // min_window_states: if > 0, the word-level determinization pass is done
+  // window by window: the lattice is split at states that every path passes
+  // through, into pieces of at least this many states, which are determinized
+  // independently and then joined up.  This bounds the memory used on very
+  // long utterances, without the whole-lattice pruning and retrying that the
+  // max_mem mechanism would otherwise do.  See
+  // DeterminizeLatticePrunedWindowed() for caveats.
+  int min_window_states;
   DeterminizeLatticePhonePrunedOptions(): delta(kDelta),
                                           max_mem(50000000),
                                           phone_determinize(true),
                                           word_determinize(true),
-                                          minimize(false) {}
+                                          minimize(false),
+                                          min_window_states(0) {}
   void Register (kaldi::OptionsItf *opts) {
     opts->Register("delta", &delta, "Tolerance used in determinization");
     opts->Register("max-mem", &max_mem, "Maximum approximate memory usage in "
@@ -172,6 +181,10 @@ struct DeterminizeLatticePhonePrunedOptions {
                    "--phone-determinize)");
     opts->Register("minimize", &minimize, "If true, push and minimize after "
                    "determinization.");
+    opts->Register("min-window-states", &min_window_states, "If > 0, "
+                   "determinize the word lattice in windows of at least this "
+                   "many states, split at states all paths pass through; "
+                   "bounds memory on very long utterances (try e.g. 30000).");
   }
 };
 
@@ -212,6 +225,29 @@ bool DeterminizeLatticePruned(
     MutableFst<ArcTpl<CompactLatticeWeightTpl<Weight, IntType> > > *ofst,
     DeterminizeLatticePrunedOptions opts = DeterminizeLatticePrunedOptions());
 
+/** Windowed version of DeterminizeLatticePruned() above, for very long
+    lattices.  The input, which must be topologically sorted, is split at "cut
+    states" -- states that every successful path passes through, which in
+    practice occur at low-connectivity frame boundaries such as long silences
+    -- into windows of at least min_window_states states.  The windows are
+    determinized independently and the results joined back up, so the peak
+    memory usage is that of the largest window, and if max_mem is hit the
+    pruning and retrying is confined to one window instead of restarting on
+    the whole lattice.  If no usable cut state exists this reduces to a single
+    call of DeterminizeLatticePruned().  Two caveats: pruning is relative to
+    the best path within each window, so slightly more of the lattice may be
+    kept than with whole-lattice determinization; and the output may be
+    non-deterministic at the window seams.  Returns true if determinization of
+    every window completed within the beam.
+*/
+template<class Weight, class IntType>
+bool DeterminizeLatticePrunedWindowed(
+    const ExpandedFst<ArcTpl<Weight> > &ifst,
+    double prune,
+    typename ArcTpl<Weight>::StateId min_window_states,
+    MutableFst<ArcTpl<CompactLatticeWeightTpl<Weight, IntType> > > *ofst,
+    DeterminizeLatticePrunedOptions opts = DeterminizeLatticePrunedOptions());
+
 /** This function takes in lattices and inserts phones at phone boundaries. It
     uses the transition model to work out the transition_id to phone map. The
     returning value is the starting index of the phone label. Typically we pick
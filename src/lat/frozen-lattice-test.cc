@@ -0,0 +1,96 @@
+// lat/frozen-lattice-test.cc
+
+// Copyright 2015  Johns Hopkins University (Author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lat/frozen-lattice.h"
+#include "lat/lattice-functions.h"
+#include "fstext/rand-fst.h"
+
+namespace kaldi {
+
+CompactLattice *RandCompactLattice() {
+  Lattice *fst = fst::RandPairFst<LatticeArc>();
+  CompactLattice *cfst = new CompactLattice;
+  ConvertLattice(*fst, cfst);
+  delete fst;
+  return cfst;
+}
+
+// Freezing and un-freezing must give back the identical lattice (state
+// numbering is preserved).
+void TestFrozenLatticeRoundTrip() {
+  CompactLattice *clat = RandCompactLattice();
+  FrozenLattice<CompactLatticeArc> flat(*clat);
+  KALDI_ASSERT(flat.NumStates() == clat->NumStates());
+  CompactLattice clat2;
+  flat.GetFst(&clat2);
+  KALDI_ASSERT(fst::Equal(*clat, clat2));
+  delete clat;
+}
+
+// Filter() with everything kept is a no-op.
+void TestFrozenLatticeFilterKeepAll() {
+  CompactLattice *clat = RandCompactLattice();
+  FrozenLattice<CompactLatticeArc> flat(*clat);
+  std::vector<bool> keep_state(flat.NumStates(), true),
+      keep_arc(flat.NumArcsTotal(), true);
+  flat.Filter(keep_state, keep_arc);
+  CompactLattice clat2;
+  flat.GetFst(&clat2);
+  KALDI_ASSERT(fst::Equal(*clat, clat2));
+  delete clat;
+}
+
+// PruneLattice() goes via the frozen representation; with a huge beam it
+// must keep the successful paths intact (i.e. be equivalent to
+// fst::Connect()), and with any beam the total number of states and arcs
+// must not grow.
+void TestFrozenLatticePrune() {
+  Lattice *lat = fst::RandPairFst<LatticeArc>();
+  Lattice connected(*lat);
+  fst::Connect(&connected);
+  int32 num_states = connected.NumStates();
+  bool ans = PruneLattice(1.0e+10, lat);
+  KALDI_ASSERT(ans == (num_states > 0));
+  if (num_states > 0) {
+    // With the huge beam, pruning should have removed only states and
+    // arcs that are not on any successful path.
+    KALDI_ASSERT(lat->NumStates() == num_states);
+    KALDI_ASSERT(fst::RandEquivalent(*lat, connected, 5 /*paths*/,
+                                     0.01 /*delta*/, Rand() /*seed*/,
+                                     100 /*path length, max*/));
+    BaseFloat beam = 0.1 + 2.0 * RandUniform();
+    Lattice copy(*lat);
+    if (PruneLattice(beam, &copy))
+      KALDI_ASSERT(copy.NumStates() <= lat->NumStates());
+  }
+  delete lat;
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  for (int32 i = 0; i < 30; i++) {
+    TestFrozenLatticeRoundTrip();
+    TestFrozenLatticeFilterKeepAll();
+    TestFrozenLatticePrune();
+  }
+  KALDI_LOG << "Success.";
+  return 0;
+}
@@ -0,0 +1,189 @@
+// lat/frozen-lattice.h
+
+// Copyright 2015  Johns Hopkins University (Author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_LAT_FROZEN_LATTICE_H_
+#define KALDI_LAT_FROZEN_LATTICE_H_
+
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "lat/kaldi-lattice.h"
+
+namespace kaldi {
+
+/**
+   FrozenLattice is a "frozen" representation of a lattice in
+   compressed-sparse-row form: all arcs live in one contiguous array,
+   ordered by source state, with a per-state offset table, plus arrays of
+   final-weights.  A VectorFst keeps a separately heap-allocated arc
+   vector per state, which on million-arc lattices thrashes the allocator
+   and the cache; freezing costs one pass over the lattice and two large
+   allocations, after which algorithms can sweep the arc array linearly.
+
+   The structure is not freely mutable like a MutableFst: you can change
+   weights in place, and remove states and arcs in bulk with Filter(), but
+   not add anything.  Convert from any lattice type with Freeze() (or the
+   constructor) and back with GetFst(); use FrozenLattice<LatticeArc> or
+   FrozenLattice<CompactLatticeArc>.  Used by the forward-backward and
+   pruning code in lat/lattice-functions.cc.
+*/
+template<class Arc>
+class FrozenLattice {
+ public:
+  typedef typename Arc::StateId StateId;
+  typedef typename Arc::Weight Weight;
+
+  FrozenLattice(): start_(fst::kNoStateId) { }
+
+  explicit FrozenLattice(const fst::ExpandedFst<Arc> &fst) { Freeze(fst); }
+
+  /// Copies "fst" into the frozen representation, replacing any previous
+  /// contents.  State numbering is preserved.
+  void Freeze(const fst::ExpandedFst<Arc> &fst) {
+    StateId num_states = fst.NumStates();
+    start_ = fst.Start();
+    final_.clear();
+    final_.resize(num_states, Weight::Zero());
+    arc_offsets_.clear();
+    arc_offsets_.resize(num_states + 1);
+    size_t num_arcs = 0;
+    for (StateId s = 0; s < num_states; s++) {
+      arc_offsets_[s] = num_arcs;
+      num_arcs += fst.NumArcs(s);
+    }
+    arc_offsets_[num_states] = num_arcs;
+    arcs_.clear();
+    arcs_.reserve(num_arcs);
+    for (StateId s = 0; s < num_states; s++) {
+      final_[s] = fst.Final(s);
+      for (fst::ArcIterator<fst::ExpandedFst<Arc> > aiter(fst, s);
+           !aiter.Done(); aiter.Next())
+        arcs_.push_back(aiter.Value());
+    }
+    KALDI_ASSERT(arcs_.size() == num_arcs);
+  }
+
+  /// Converts back to a regular lattice.  State numbering is preserved.
+  void GetFst(fst::MutableFst<Arc> *ofst) const {
+    ofst->DeleteStates();
+    if (start_ == fst::kNoStateId)
+      return;
+    StateId num_states = NumStates();
+    for (StateId s = 0; s < num_states; s++)
+      ofst->AddState();
+    ofst->SetStart(start_);
+    for (StateId s = 0; s < num_states; s++) {
+      if (final_[s] != Weight::Zero())
+        ofst->SetFinal(s, final_[s]);
+      for (size_t i = arc_offsets_[s]; i < arc_offsets_[s + 1]; i++)
+        ofst->AddArc(s, arcs_[i]);
+    }
+  }
+
+  StateId Start() const { return start_; }
+
+  StateId NumStates() const { return static_cast<StateId>(final_.size()); }
+
+  Weight Final(StateId s) const { return final_[s]; }
+
+  void SetFinal(StateId s, const Weight &w) { final_[s] = w; }
+
+  size_t NumArcs(StateId s) const {
+    return arc_offsets_[s + 1] - arc_offsets_[s];
+  }
+
+  size_t NumArcsTotal() const { return arcs_.size(); }
+
+  /// Index of state s's first arc in the global arc array (so state s's
+  /// arcs are the indexes [ArcOffset(s), ArcOffset(s + 1)).)
+  size_t ArcOffset(StateId s) const { return arc_offsets_[s]; }
+
+  /// The i'th arc of the global arc array, 0 <= i < NumArcsTotal().
+  const Arc &GetArc(size_t i) const { return arcs_[i]; }
+
+  Arc &MutableArc(size_t i) { return arcs_[i]; }
+
+  /// Bulk removal: keeps only the states s with keep_state[s] true and
+  /// the arcs i (indexing the global arc array) with keep_arc[i] true,
+  /// renumbering the surviving states to be consecutive (in the same
+  /// order) and remapping the surviving arcs' nextstates.  Surviving arcs
+  /// must not leave from, or point to, removed states.  If the start
+  /// state is removed the lattice becomes empty.  This is a single linear
+  /// sweep with no per-state allocation.
+  void Filter(const std::vector<bool> &keep_state,
+              const std::vector<bool> &keep_arc) {
+    StateId num_states = NumStates();
+    KALDI_ASSERT(keep_state.size() == static_cast<size_t>(num_states) &&
+                 keep_arc.size() == arcs_.size());
+    if (start_ == fst::kNoStateId || !keep_state[start_]) {
+      start_ = fst::kNoStateId;
+      final_.clear();
+      arcs_.clear();
+      arc_offsets_.clear();
+      arc_offsets_.resize(1, 0);
+      return;
+    }
+    std::vector<StateId> new_id(num_states, fst::kNoStateId);
+    StateId num_new_states = 0;
+    for (StateId s = 0; s < num_states; s++)
+      if (keep_state[s])
+        new_id[s] = num_new_states++;
+    size_t arc_out = 0;
+    for (StateId s = 0; s < num_states; s++) {
+      size_t begin = arc_offsets_[s], end = arc_offsets_[s + 1];
+      if (keep_state[s]) {
+        StateId t = new_id[s];
+        arc_offsets_[t] = arc_out;
+        final_[t] = final_[s];
+        for (size_t i = begin; i < end; i++) {
+          if (keep_arc[i]) {
+            Arc &arc = arcs_[arc_out];
+            arc = arcs_[i];
+            KALDI_ASSERT(new_id[arc.nextstate] != fst::kNoStateId);
+            arc.nextstate = new_id[arc.nextstate];
+            arc_out++;
+          }
+        }
+      } else {
+        for (size_t i = begin; i < end; i++)
+          KALDI_ASSERT(!keep_arc[i]);
+      }
+    }
+    start_ = new_id[start_];
+    final_.resize(num_new_states);
+    arc_offsets_.resize(num_new_states + 1);
+    arc_offsets_[num_new_states] = arc_out;
+    arcs_.resize(arc_out);
+  }
+
+ private:
+  StateId start_;  // fst::kNoStateId if the lattice is empty.
+  std::vector<Weight> final_;  // final-weight of each state (Zero() if the
+                               // state is not final).
+  // arc_offsets_[s] is the index in arcs_ of state s's first arc;
+  // arc_offsets_.back() == arcs_.size().
+  std::vector<size_t> arc_offsets_;
+  std::vector<Arc> arcs_;  // all arcs, ordered by source state.
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(FrozenLattice);
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_LAT_FROZEN_LATTICE_H_
@@ -83,7 +83,7 @@ class CompactLatticeHolder {
 
   static bool IsReadInBinary() { return true; }
 
-  const T &Value() const {
+  T &Value() {
     KALDI_ASSERT(t_ != NULL && "Called Value() on empty CompactLatticeHolder");
     return *t_;
   }
@@ -113,7 +113,7 @@ class LatticeHolder {
 
   static bool IsReadInBinary() { return true; }
 
-  const T &Value() const {
+  T &Value() {
     KALDI_ASSERT(t_ != NULL && "Called Value() on empty LatticeHolder");
     return *t_;
   }
@@ -24,10 +24,13 @@
 
 
 #include "lat/lattice-functions.h"
+#include "lat/push-lattice.h"
+#include "lat/minimize-lattice.h"
 #include "hmm/transition-model.h"
 #include "util/stl-utils.h"
 #include "base/kaldi-math.h"
 #include "hmm/hmm-utils.h"
+#include "thread/kaldi-task-sequence.h"
 
 namespace kaldi {
 using std::map;
@@ -201,6 +204,11 @@ bool PruneLattice(BaseFloat beam, LatType *lat) {
   int32 start = lat->Start();
   int32 num_states = lat->NumStates();
   if (num_states == 0) return false;
+  // We work on a frozen copy of the lattice: its contiguous arc array
+  // makes the two cost sweeps below cache-friendly, and removing the
+  // pruned arcs and states is a single linear compaction instead of
+  // per-state arc-vector surgery plus fst::Connect().
+  FrozenLattice<Arc> flat(*lat);
   std::vector<double> forward_cost(num_states,
                                    std::numeric_limits<double>::infinity());  // viterbi forward.
   forward_cost[start] = 0.0; // lattice can't have cycles so couldn't be
@@ -210,10 +218,9 @@ bool PruneLattice(BaseFloat beam, LatType *lat) {
   // Thanks to Jing Zheng for finding a bug here.
   for (int32 state = 0; state < num_states; state++) {
     double this_forward_cost = forward_cost[state];
-    for (fst::ArcIterator<LatType> aiter(*lat, state);
-         !aiter.Done();
-         aiter.Next()) {
-      const Arc &arc(aiter.Value());
+    for (size_t i = flat.ArcOffset(state), end = flat.ArcOffset(state + 1);
+         i < end; i++) {
+      const Arc &arc = flat.GetArc(i);
       StateId nextstate = arc.nextstate;
       KALDI_ASSERT(nextstate > state && nextstate < num_states);
       double next_forward_cost = this_forward_cost +
@@ -221,31 +228,32 @@ bool PruneLattice(BaseFloat beam, LatType *lat) {
       if (forward_cost[nextstate] > next_forward_cost)
         forward_cost[nextstate] = next_forward_cost;
     }
-    Weight final_weight = lat->Final(state);
+    Weight final_weight = flat.Final(state);
     double this_final_cost = this_forward_cost +
         ConvertToCost(final_weight);
     if (this_final_cost < best_final_cost)
       best_final_cost = this_final_cost;
   }
-  int32 bad_state = lat->AddState(); // this state is not final.
   double cutoff = best_final_cost + beam;
 
   // Go backwards updating the backward probs (which share memory with the
-  // forward probs), and pruning arcs and deleting final-probs.  We prune arcs
-  // by making them point to the non-final state "bad_state".  We'll then use
-  // Trim() to remove unnecessary arcs and states.  [this is just easier than
-  // doing it ourselves.]
+  // forward probs), deleting final-probs and marking which arcs and states
+  // to keep.  A state survives iff some path through it is within the
+  // cutoff, i.e. its forward plus backward cost is within it; such states
+  // are automatically both reachable and co-reachable via surviving arcs,
+  // so no separate connection step is needed.
   std::vector<double> &backward_cost(forward_cost);
+  std::vector<bool> keep_arc(flat.NumArcsTotal(), false);
+  std::vector<bool> keep_state(num_states, false);
   for (int32 state = num_states - 1; state >= 0; state--) {
     double this_forward_cost = forward_cost[state];
-    double this_backward_cost = ConvertToCost(lat->Final(state));
+    double this_backward_cost = ConvertToCost(flat.Final(state));
     if (this_backward_cost + this_forward_cost > cutoff
         && this_backward_cost != std::numeric_limits<double>::infinity())
-      lat->SetFinal(state, Weight::Zero());
-    for (fst::MutableArcIterator<LatType> aiter(lat, state);
-         !aiter.Done();
-         aiter.Next()) {
-      Arc arc(aiter.Value());
+      flat.SetFinal(state, Weight::Zero());
+    for (size_t i = flat.ArcOffset(state), end = flat.ArcOffset(state + 1);
+         i < end; i++) {
+      const Arc &arc = flat.GetArc(i);
       StateId nextstate = arc.nextstate;
       KALDI_ASSERT(nextstate > state && nextstate < num_states);
       double arc_cost = ConvertToCost(arc.weight),
@@ -253,14 +261,15 @@ bool PruneLattice(BaseFloat beam, LatType *lat) {
           this_fb_cost = this_forward_cost + arc_backward_cost;
       if (arc_backward_cost < this_backward_cost)
         this_backward_cost = arc_backward_cost;
-      if (this_fb_cost > cutoff) { // Prune the arc.
-        arc.nextstate = bad_state;
-        aiter.SetValue(arc);
-      }
+      if (this_fb_cost <= cutoff) // Keep the arc.
+        keep_arc[i] = true;
     }
     backward_cost[state] = this_backward_cost;
+    if (this_forward_cost + this_backward_cost <= cutoff)
+      keep_state[state] = true;
   }
-  fst::Connect(lat);
+  flat.Filter(keep_state, keep_arc);
+  flat.GetFst(lat);
   return (lat->NumStates() > 0);
 }
 
@@ -271,24 +280,70 @@ template bool PruneLattice(BaseFloat beam, CompactLattice *lat);
 
 BaseFloat LatticeForwardBackward(const Lattice &lat, Posterior *post,
                                  double *acoustic_like_sum) {
+  // Make sure the lattice is topologically sorted.
+  if (lat.Properties(fst::kTopSorted, true) == 0)
+    KALDI_ERR << "Input lattice must be topologically sorted.";
+  KALDI_ASSERT(lat.Start() == 0);
+  // Freeze the lattice, so the forward and backward sweeps below iterate
+  // over one contiguous arc array; the copy is a couple of bulk
+  // allocations, which on large lattices is more than paid back by the
+  // better locality.
+  FrozenLattice<LatticeArc> flat(lat);
+  return LatticeForwardBackward(flat, post, acoustic_like_sum);
+}
+
+// Version of LatticeStateTimes() for frozen lattices, used by the
+// frozen-lattice LatticeForwardBackward() below; see its comments.
+static int32 FrozenLatticeStateTimes(const FrozenLattice<LatticeArc> &lat,
+                                     vector<int32> *times) {
+  KALDI_ASSERT(lat.Start() == 0);
+  int32 num_states = lat.NumStates();
+  times->clear();
+  times->resize(num_states, -1);
+  (*times)[0] = 0;
+  for (int32 state = 0; state < num_states; state++) {
+    int32 cur_time = (*times)[state];
+    for (size_t i = lat.ArcOffset(state), end = lat.ArcOffset(state + 1);
+         i < end; i++) {
+      const LatticeArc &arc = lat.GetArc(i);
+      if (arc.ilabel != 0) {  // Non-epsilon input label on arc
+        // next time instance
+        if ((*times)[arc.nextstate] == -1) {
+          (*times)[arc.nextstate] = cur_time + 1;
+        } else {
+          KALDI_ASSERT((*times)[arc.nextstate] == cur_time + 1);
+        }
+      } else {  // epsilon input label on arc
+        // Same time instance
+        if ((*times)[arc.nextstate] == -1)
+          (*times)[arc.nextstate] = cur_time;
+        else
+          KALDI_ASSERT((*times)[arc.nextstate] == cur_time);
+      }
+    }
+  }
+  return (*std::max_element(times->begin(), times->end()));
+}
+
+BaseFloat LatticeForwardBackward(const FrozenLattice<LatticeArc> &lat,
+                                 Posterior *post,
+                                 double *acoustic_like_sum) {
   // Note, Posterior is defined as follows:  Indexed [frame], then a list
   // of (transition-id, posterior-probability) pairs.
   // typedef std::vector<std::vector<std::pair<int32, BaseFloat> > > Posterior;
-  using namespace fst;
-  typedef Lattice::Arc Arc;
+  typedef LatticeArc Arc;
   typedef Arc::Weight Weight;
   typedef Arc::StateId StateId;
 
   if (acoustic_like_sum) *acoustic_like_sum = 0.0;
 
-  // Make sure the lattice is topologically sorted.
-  if (lat.Properties(fst::kTopSorted, true) == 0)
-    KALDI_ERR << "Input lattice must be topologically sorted.";
+  // The lattice is required to be topologically sorted (checked by the
+  // wrapper above for lattices frozen from a Lattice).
   KALDI_ASSERT(lat.Start() == 0);
 
   int32 num_states = lat.NumStates();
   vector<int32> state_times;
-  int32 max_time = LatticeStateTimes(lat, &state_times);
+  int32 max_time = FrozenLatticeStateTimes(lat, &state_times);
   std::vector<double> alpha(num_states, kLogZeroDouble);
   std::vector<double> &beta(alpha); // we re-use the same memory for
   // this, but it's semantically distinct so we name it differently.
@@ -301,8 +356,9 @@ BaseFloat LatticeForwardBackward(const Lattice &lat, Posterior *post,
   // Propagate alphas forward.
   for (StateId s = 0; s < num_states; s++) {
     double this_alpha = alpha[s];
-    for (ArcIterator<Lattice> aiter(lat, s); !aiter.Done(); aiter.Next()) {
-      const Arc &arc = aiter.Value();
+    for (size_t i = lat.ArcOffset(s), end = lat.ArcOffset(s + 1); i < end;
+         i++) {
+      const Arc &arc = lat.GetArc(i);
       double arc_like = -ConvertToCost(arc.weight);
       alpha[arc.nextstate] = LogAdd(alpha[arc.nextstate], this_alpha + arc_like);
     }
@@ -317,8 +373,9 @@ BaseFloat LatticeForwardBackward(const Lattice &lat, Posterior *post,
   for (StateId s = num_states-1; s >= 0; s--) {
     Weight f = lat.Final(s);
     double this_beta = -(f.Value1() + f.Value2());
-    for (ArcIterator<Lattice> aiter(lat, s); !aiter.Done(); aiter.Next()) {
-      const Arc &arc = aiter.Value();
+    for (size_t i = lat.ArcOffset(s), end = lat.ArcOffset(s + 1); i < end;
+         i++) {
+      const Arc &arc = lat.GetArc(i);
       double arc_like = -ConvertToCost(arc.weight),
           arc_beta = beta[arc.nextstate] + arc_like;
       this_beta = LogAdd(this_beta, arc_beta);
@@ -1584,4 +1641,312 @@ void ComposeCompactLatticeDeterministic(
   fst::Connect(composed_clat);
 }
 
+DeterminizeLatticeTask::DeterminizeLatticeTask(
+    const fst::DeterminizeLatticePrunedOptions &opts,
+    std::string key,
+    BaseFloat acoustic_scale,
+    BaseFloat beam,
+    bool minimize,
+    Lattice *lat,
+    CompactLatticeWriter *clat_writer,
+    int32 *num_warn):
+    trans_model_(NULL), opts_(&opts), phone_opts_(NULL), key_(key),
+    acoustic_scale_(acoustic_scale), beam_(beam), minimize_(minimize),
+    lat_(lat), clat_writer_(clat_writer), num_warn_(num_warn) { }
+
+DeterminizeLatticeTask::DeterminizeLatticeTask(
+    const TransitionModel &trans_model,
+    const fst::DeterminizeLatticePhonePrunedOptions &opts,
+    std::string key,
+    BaseFloat acoustic_scale,
+    BaseFloat beam,
+    Lattice *lat,
+    CompactLatticeWriter *clat_writer,
+    int32 *num_warn):
+    trans_model_(&trans_model), opts_(NULL), phone_opts_(&opts), key_(key),
+    acoustic_scale_(acoustic_scale), beam_(beam), minimize_(false),
+    lat_(lat), clat_writer_(clat_writer), num_warn_(num_warn) { }
+
+void DeterminizeLatticeTask::operator () () {
+  // We apply the acoustic scale before determinization and will undo it
+  // afterward, since it can affect the result.
+  fst::ScaleLattice(fst::AcousticLatticeScale(acoustic_scale_), lat_);
+  if (phone_opts_ != NULL) {
+    if (!DeterminizeLatticePhonePrunedWrapper(
+            *trans_model_, lat_, beam_, &det_clat_, *phone_opts_)) {
+      KALDI_WARN << "For key " << key_ << ", determinization did not succeed"
+          "(partial output will be pruned tighter than the specified beam.)";
+      (*num_warn_)++;
+    }
+  } else {
+    fst::Invert(lat_);  // to get word labels on the input side.
+    if (!TopSort(lat_)) {
+      KALDI_WARN << "Could not topologically sort lattice: this probably means it"
+          " has bad properties e.g. epsilon cycles.  Your LM or lexicon might "
+          "be broken, e.g. LM with epsilon cycles or lexicon with empty words.";
+      (*num_warn_)++;
+    }
+    fst::ArcSort(lat_, fst::ILabelCompare<LatticeArc>());
+    if (!DeterminizeLatticePruned(*lat_, beam_, &det_clat_, *opts_)) {
+      KALDI_WARN << "For key " << key_ << ", determinization did not succeed"
+          "(partial output will be pruned tighter than the specified beam.)";
+      (*num_warn_)++;
+    }
+  }
+  delete lat_;  // This is no longer needed so we can delete it now.
+  lat_ = NULL;
+  if (minimize_) {
+    PushCompactLatticeStrings(&det_clat_);
+    PushCompactLatticeWeights(&det_clat_);
+    MinimizeCompactLattice(&det_clat_);
+  }
+  // Invert the original acoustic scaling
+  fst::ScaleLattice(fst::AcousticLatticeScale(1.0/acoustic_scale_),
+                    &det_clat_);
+}
+
+DeterminizeLatticeTask::~DeterminizeLatticeTask() {
+  KALDI_VLOG(2) << "Wrote lattice with " << det_clat_.NumStates()
+                << " for key " << key_;
+  clat_writer_->Write(key_, det_clat_);
+}
+
+// Finds the "cut states" of a connected, topologically sorted lattice:
+// states, other than the start state and the last state, that every
+// successful path passes through.  A state s qualifies if no arc spans it
+// (i.e. no arc goes from a state before s to a state after s in the
+// topological order) and no path can terminate before it (no state up to
+// and including s is final).  Cut states closer than "min_segment_states"
+// to the previously accepted one are skipped, so that we do not produce
+// uselessly small segments.  The cut states are output in increasing
+// order.
+static void FindLatticeCutStates(const Lattice &lat,
+                                 int32 min_segment_states,
+                                 std::vector<int32> *cut_states) {
+  typedef LatticeArc::StateId StateId;
+  cut_states->clear();
+  StateId num_states = lat.NumStates();
+  StateId max_target = 0;  // highest nextstate of any arc leaving a state
+                           // before the one we are considering.
+  bool seen_final = false;
+  StateId prev_cut = 0;
+  for (StateId s = 0; s + 1 < num_states; s++) {
+    if (s > 0 && max_target <= s && !seen_final &&
+        lat.Final(s) == LatticeWeight::Zero() &&
+        s - prev_cut >= min_segment_states) {
+      cut_states->push_back(s);
+      prev_cut = s;
+    }
+    for (fst::ArcIterator<Lattice> aiter(lat, s); !aiter.Done();
+         aiter.Next())
+      max_target = std::max(max_target, aiter.Value().nextstate);
+    if (lat.Final(s) != LatticeWeight::Zero())
+      seen_final = true;
+  }
+}
+
+// Task class used by DeterminizeLatticePhonePrunedSegmented() to
+// determinize one segment of a lattice on a worker thread; the output goes
+// to a caller-owned slot, and the segments are stitched together after all
+// tasks have finished.
+class DeterminizeLatticeSegmentTask {
+ public:
+  // Takes ownership of "segment".
+  DeterminizeLatticeSegmentTask(
+      const TransitionModel &trans_model,
+      const fst::DeterminizeLatticePhonePrunedOptions &opts,
+      double beam,
+      Lattice *segment,
+      CompactLattice *det_segment,
+      bool *success):
+      trans_model_(&trans_model), opts_(&opts), beam_(beam),
+      segment_(segment), det_segment_(det_segment), success_(success) { }
+
+  void operator () () {
+    if (!DeterminizeLatticePhonePrunedWrapper(
+            *trans_model_, segment_, beam_, det_segment_, *opts_))
+      *success_ = false;
+    delete segment_;
+    segment_ = NULL;
+  }
+
+  ~DeterminizeLatticeSegmentTask() { }
+ private:
+  const TransitionModel *trans_model_;
+  const fst::DeterminizeLatticePhonePrunedOptions *opts_;
+  double beam_;
+  Lattice *segment_;  // Owned locally.
+  CompactLattice *det_segment_;  // Owned by the caller.
+  bool *success_;
+};
+
+bool DeterminizeLatticePhonePrunedSegmented(
+    const TransitionModel &trans_model,
+    Lattice *ifst,
+    double beam,
+    CompactLattice *ofst,
+    fst::DeterminizeLatticePhonePrunedOptions opts,
+    int32 num_threads) {
+  typedef LatticeArc::StateId StateId;
+  ofst->DeleteStates();
+  fst::Connect(ifst);
+  if (ifst->Start() == fst::kNoStateId)
+    return true;  // empty lattice; nothing to do.
+  TopSortLatticeIfNeeded(ifst);
+  StateId num_states = ifst->NumStates();
+  // Determinizing very short segments wastes more in per-call overhead
+  // than the parallelism gains, so do not accept cuts that would produce
+  // them; more segments than threads is still useful for load balancing.
+  int32 min_segment_states = std::max<int32>(
+      100, num_states / (num_threads * 8));
+  std::vector<int32> cut_states;
+  if (num_threads > 1)
+    FindLatticeCutStates(*ifst, min_segment_states, &cut_states);
+  if (cut_states.empty())
+    return DeterminizeLatticePhonePrunedWrapper(trans_model, ifst, beam,
+                                                ofst, opts);
+  int32 num_segments = cut_states.size() + 1;
+  KALDI_VLOG(2) << "Splitting lattice with " << num_states << " states "
+                << "into " << num_segments << " segments.";
+  std::vector<CompactLattice> det_segments(num_segments);
+  bool success = true;
+  {
+    TaskSequencerConfig sequencer_config;
+    sequencer_config.num_threads = num_threads;
+    TaskSequencer<DeterminizeLatticeSegmentTask> sequencer(sequencer_config);
+    for (int32 k = 0; k < num_segments; k++) {
+      StateId begin = (k == 0 ? 0 : cut_states[k - 1]);
+      bool is_last = (k + 1 == num_segments);
+      StateId end = (is_last ? num_states - 1 : cut_states[k]);
+      Lattice *segment = new Lattice();
+      for (StateId s = begin; s <= end; s++)
+        segment->AddState();
+      segment->SetStart(0);
+      if (is_last) {
+        // The last segment keeps the original final-weights.
+        for (StateId s = begin; s <= end; s++)
+          segment->SetFinal(s - begin, ifst->Final(s));
+      } else {
+        // The cut state ending this segment becomes final; its arcs belong
+        // to the next segment.
+        segment->SetFinal(end - begin, LatticeWeight::One());
+      }
+      for (StateId s = begin; s < (is_last ? end + 1 : end); s++) {
+        for (fst::ArcIterator<Lattice> aiter(*ifst, s); !aiter.Done();
+             aiter.Next()) {
+          LatticeArc arc = aiter.Value();
+          // No arc can leave the segment, since "end" is a cut state.
+          KALDI_ASSERT(arc.nextstate <= end);
+          arc.nextstate -= begin;
+          segment->AddArc(s - begin, arc);
+        }
+      }
+      sequencer.Run(new DeterminizeLatticeSegmentTask(
+          trans_model, opts, beam, segment, &det_segments[k], &success));
+    }
+    sequencer.Wait();
+  }
+  ifst->DeleteStates();  // like the wrapper, we are destructive; free the
+                         // memory early.
+  *ofst = det_segments[0];
+  for (int32 k = 1; k < num_segments; k++)
+    fst::Concat(ofst, det_segments[k]);
+  // Remove the epsilon arcs that Concat() introduced at the joins.
+  fst::RemoveEpsLocal(ofst);
+  return success;
+}
+
+void CompactLatticeToConstrainedFst(const CompactLattice &clat,
+                                    BaseFloat old_acoustic_scale,
+                                    fst::VectorFst<fst::StdArc> *ofst) {
+  typedef fst::StdArc StdArc;
+  typedef StdArc::StateId StateId;
+  typedef StdArc::Weight Weight;
+  ofst->DeleteStates();
+  if (clat.Start() == fst::kNoStateId) return;
+  StateId num_states = clat.NumStates();
+  for (StateId s = 0; s < num_states; s++)
+    ofst->AddState();
+  ofst->SetStart(clat.Start());
+  for (StateId s = 0; s < num_states; s++) {
+    for (fst::ArcIterator<CompactLattice> aiter(clat, s); !aiter.Done();
+         aiter.Next()) {
+      const CompactLatticeArc &arc = aiter.Value();
+      const std::vector<int32> &tids = arc.weight.String();
+      BaseFloat cost = arc.weight.Weight().Value1() +
+          old_acoustic_scale * arc.weight.Weight().Value2();
+      if (tids.empty()) {
+        // e.g. an epsilon arc from determinization; nonemitting in the
+        // output too.
+        ofst->AddArc(s, StdArc(0, arc.ilabel, Weight(cost), arc.nextstate));
+      } else {
+        // Expand the alignment to a chain of one-frame arcs; the word
+        // label and the cost go on the first arc.
+        StateId cur_state = s;
+        for (size_t i = 0; i < tids.size(); i++) {
+          StateId next_state = (i + 1 == tids.size() ? arc.nextstate :
+                                ofst->AddState());
+          ofst->AddArc(cur_state,
+                       StdArc(tids[i], (i == 0 ? arc.ilabel : 0),
+                              (i == 0 ? Weight(cost) : Weight::One()),
+                              next_state));
+          cur_state = next_state;
+        }
+      }
+    }
+    CompactLatticeWeight final = clat.Final(s);
+    if (final != CompactLatticeWeight::Zero()) {
+      const std::vector<int32> &tids = final.String();
+      BaseFloat cost = final.Weight().Value1() +
+          old_acoustic_scale * final.Weight().Value2();
+      if (tids.empty()) {
+        ofst->SetFinal(s, Weight(cost));
+      } else {
+        // Final weights can carry alignments too; expand them to a chain
+        // ending in a new final state.
+        StateId cur_state = s;
+        for (size_t i = 0; i < tids.size(); i++) {
+          StateId next_state = ofst->AddState();
+          ofst->AddArc(cur_state,
+                       StdArc(tids[i], 0,
+                              (i == 0 ? Weight(cost) : Weight::One()),
+                              next_state));
+          cur_state = next_state;
+        }
+        ofst->SetFinal(cur_state, Weight::One());
+      }
+    }
+  }
+}
+
+int64 LatticeMemoryBytes(const Lattice &lat) {
+  typedef Lattice::StateId StateId;
+  int64 ans = sizeof(Lattice);
+  StateId num_states = lat.NumStates();
+  for (StateId s = 0; s < num_states; s++) {
+    // Per-state overhead: the final-weight plus VectorFst's per-state
+    // arc-vector bookkeeping, approximated as one pointer-sized header.
+    ans += sizeof(LatticeWeight) + sizeof(void*);
+    ans += static_cast<int64>(lat.NumArcs(s)) * sizeof(LatticeArc);
+  }
+  return ans;
+}
+
+int64 CompactLatticeMemoryBytes(const CompactLattice &clat) {
+  typedef CompactLattice::StateId StateId;
+  int64 ans = sizeof(CompactLattice);
+  StateId num_states = clat.NumStates();
+  for (StateId s = 0; s < num_states; s++) {
+    ans += sizeof(CompactLatticeWeight) + sizeof(void*);
+    ans += static_cast<int64>(clat.Final(s).String().size()) * sizeof(int32);
+    for (fst::ArcIterator<CompactLattice> aiter(clat, s); !aiter.Done();
+         aiter.Next()) {
+      ans += sizeof(CompactLatticeArc) +
+          static_cast<int64>(aiter.Value().weight.String().size()) *
+          sizeof(int32);
+    }
+  }
+  return ans;
+}
+
 }  // namespace kaldi
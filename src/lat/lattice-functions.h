@@ -32,6 +32,8 @@
 #include "fstext/fstext-lib.h"
 #include "hmm/transition-model.h"
 #include "lat/kaldi-lattice.h"
+#include "lat/frozen-lattice.h"
+#include "lat/determinize-lattice-pruned.h"
 #include "itf/decodable-itf.h"
 
 namespace kaldi {
@@ -63,6 +65,15 @@ BaseFloat LatticeForwardBackward(const Lattice &lat,
                                  Posterior *arc_post,
                                  double *acoustic_like_sum = NULL);
 
+/// Version of LatticeForwardBackward() that operates on an
+/// already-frozen lattice (see lat/frozen-lattice.h); the version above
+/// delegates to this after freezing, so freeze once if you will run it
+/// several times.  The lattice must have been frozen from a
+/// topologically sorted Lattice with start state 0.
+BaseFloat LatticeForwardBackward(const FrozenLattice<LatticeArc> &lat,
+                                 Posterior *arc_post,
+                                 double *acoustic_like_sum = NULL);
+
 // This function is something similar to LatticeForwardBackward(), but it is on
 // the CompactLattice lattice format. Also we only need the alpha in the forward 
 // path, not the posteriors.
@@ -306,6 +317,119 @@ void ComposeCompactLatticeDeterministic(
     fst::DeterministicOnDemandFst<fst::StdArc>* det_fst,
     CompactLattice* composed_clat);
 
+/// A task class for determinizing many utterances' lattices in parallel
+/// with TaskSequencer (see thread/kaldi-task-sequence.h): each task
+/// determinizes one lattice on a worker thread and writes the result to
+/// "clat_writer" in its destructor.  The destructors are called on the
+/// submitting thread in the order the tasks were submitted, so the output
+/// archive order matches the input.  Used by
+/// lattice-determinize-pruned-parallel and
+/// lattice-determinize-phone-pruned-parallel.
+class DeterminizeLatticeTask {
+ public:
+  /// Version doing word-level determinization, as in
+  /// DeterminizeLatticePruned().  Takes ownership of "lat".  "num_warn" is
+  /// incremented if determinization does not succeed (i.e. if it prunes
+  /// more tightly than "beam" due to the max-mem or similar constraints);
+  /// note, it is incremented from the worker threads without locking, so
+  /// treat it as approximate.
+  DeterminizeLatticeTask(
+      const fst::DeterminizeLatticePrunedOptions &opts,
+      std::string key,
+      BaseFloat acoustic_scale,
+      BaseFloat beam,
+      bool minimize,
+      Lattice *lat,
+      CompactLatticeWriter *clat_writer,
+      int32 *num_warn);
+
+  /// Version doing a first pass of determinization on phones+words, as in
+  /// DeterminizeLatticePhonePrunedWrapper().  Takes ownership of "lat".
+  DeterminizeLatticeTask(
+      const TransitionModel &trans_model,
+      const fst::DeterminizeLatticePhonePrunedOptions &opts,
+      std::string key,
+      BaseFloat acoustic_scale,
+      BaseFloat beam,
+      Lattice *lat,
+      CompactLatticeWriter *clat_writer,
+      int32 *num_warn);
+
+  void operator () ();
+
+  ~DeterminizeLatticeTask();  // Writes the result to *clat_writer_.
+
+ private:
+  const TransitionModel *trans_model_;  // NULL for the word-level version.
+  // Exactly one of opts_ and phone_opts_ is non-NULL, depending on which
+  // constructor was used; they are owned by the caller.
+  const fst::DeterminizeLatticePrunedOptions *opts_;
+  const fst::DeterminizeLatticePhonePrunedOptions *phone_opts_;
+  std::string key_;
+  BaseFloat acoustic_scale_;
+  BaseFloat beam_;
+  bool minimize_;
+  Lattice *lat_;  // The lattice we are working on.  Owned locally.
+  CompactLattice det_clat_;  // The output of our process.  Written to
+                             // clat_writer_ in the destructor.
+  CompactLatticeWriter *clat_writer_;
+  int32 *num_warn_;
+};
+
+/// This is a multi-threaded version of
+/// fst::DeterminizeLatticePhonePrunedWrapper() for use on a single long
+/// lattice (for many independent lattices, prefer one
+/// DeterminizeLatticeTask per lattice, which parallelizes better).  It
+/// splits the lattice at "cut states"-- states that every successful path
+/// passes through, which in practice occur at word boundaries where the
+/// lattice pinches down-- determinizes the segments in parallel using
+/// TaskSequencer with "num_threads" threads, and concatenates the results.
+/// Pruning each segment to "beam" around its own best path only removes
+/// paths that are more than "beam" worse than the overall best path, so
+/// the output contains everything the single-threaded version would keep.
+/// The result is determinized within each segment but the concatenation is
+/// not re-determinized, so unlike the single-threaded version the output
+/// is not guaranteed globally deterministic (the epsilon arcs introduced
+/// at the joins are removed locally).  If the lattice has no usable cut
+/// states, or num_threads <= 1, this is identical to
+/// fst::DeterminizeLatticePhonePrunedWrapper().  Like the wrapper, it is
+/// destructive (the input lattice is emptied).  Returns true on success,
+/// false if any segment's determinization terminated early.
+bool DeterminizeLatticePhonePrunedSegmented(
+    const TransitionModel &trans_model,
+    Lattice *ifst,
+    double beam,
+    CompactLattice *ofst,
+    fst::DeterminizeLatticePhonePrunedOptions opts,
+    int32 num_threads);
+
+/// Converts a first-pass CompactLattice into a decoding graph for
+/// lattice-constrained second-pass decoding: transition-ids on the input
+/// side (one per frame, expanded from the alignment strings), words on
+/// the output side, and the lattice's graph/LM cost as the arc cost.
+/// Since the lattice is frame-synchronous, so is the output FST, so
+/// decoding it with e.g. LatticeFasterDecoder and a decodable from a
+/// bigger model rescores exactly the first-pass-plausible paths, which
+/// is much faster than re-decoding the full graph.  The old acoustic
+/// costs are dropped by default; "old_acoustic_scale" retains a scaled
+/// copy in the graph cost (e.g. for model interpolation).  The input
+/// must have alignments (be careful that determinization has not been
+/// run with them removed).
+void CompactLatticeToConstrainedFst(const CompactLattice &clat,
+                                    BaseFloat old_acoustic_scale,
+                                    fst::VectorFst<fst::StdArc> *ofst);
+
+/// Returns an estimate, in bytes, of the dynamic memory held by "lat":
+/// sizeof(LatticeArc) per arc plus per-state bookkeeping.  VectorFst does
+/// not expose its allocations, so this is a lower bound (it ignores
+/// vector headroom), but it is accurate enough for the per-utterance
+/// memory accounting described in util/memory-stats.h.
+int64 LatticeMemoryBytes(const Lattice &lat);
+
+/// As LatticeMemoryBytes() but for CompactLattice; additionally counts
+/// the transition-id strings stored in the arc and final weights.
+int64 CompactLatticeMemoryBytes(const CompactLattice &clat);
+
 }  // namespace kaldi
 
 #endif  // KALDI_LAT_LATTICE_FUNCTIONS_H_
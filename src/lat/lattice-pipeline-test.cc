@@ -0,0 +1,109 @@
+// lat/lattice-pipeline-test.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lat/lattice-pipeline.h"
+#include "fstext/rand-fst.h"
+
+namespace kaldi {
+
+static CompactLattice *RandCompactLattice() {
+  RandFstOptions opts;
+  opts.acyclic = true;
+  Lattice *fst = fst::RandPairFst<LatticeArc>(opts);
+  CompactLattice *cfst = new CompactLattice;
+  ConvertLattice(*fst, cfst);
+  delete fst;
+  return cfst;
+}
+
+static bool IsFailKey(const std::string &key) {
+  return key.size() > 5 && key.substr(key.size() - 5) == "-fail";
+}
+
+// A trivial stage that scales the lattice weights, counts what passes
+// through it, and fails for keys ending in "-fail".
+class TestScaleStage: public LatticePipelineStage {
+ public:
+  explicit TestScaleStage(int32 *num_processed):
+      num_processed_(num_processed) { }
+  virtual bool Process(const std::string &utt, CompactLattice *clat) {
+    (*num_processed_)++;  // only this stage's thread touches the counter
+                          // before Finish().
+    if (IsFailKey(utt))
+      return false;
+    fst::ScaleLattice(fst::GraphLatticeScale(0.5), clat);
+    return true;
+  }
+ private:
+  int32 *num_processed_;
+};
+
+void TestLatticePipeline() {
+  int32 num_utts = 20 + Rand() % 20, num_fail = 0;
+  int32 num_processed1 = 0, num_processed2 = 0;
+  std::vector<std::string> keys;
+  {
+    CompactLatticeWriter writer("ark:tmpf");
+    LatticePipelineConfig config;
+    config.queue_size = 1 + Rand() % 4;  // exercise producer blocking.
+    LatticePipeline pipeline(config, &writer);
+    pipeline.AddStage(new TestScaleStage(&num_processed1));
+    pipeline.AddStage(new TestScaleStage(&num_processed2));
+    pipeline.Start();
+    for (int32 i = 0; i < num_utts; i++) {
+      std::ostringstream os;
+      os << "key" << i;
+      if (Rand() % 4 == 0) { os << "-fail"; num_fail++; }
+      keys.push_back(os.str());
+      pipeline.Push(os.str(), RandCompactLattice());
+    }
+    pipeline.Finish();
+    KALDI_ASSERT(pipeline.NumDone() == num_utts - num_fail);
+    KALDI_ASSERT(pipeline.NumFailed() == num_fail);
+    KALDI_ASSERT(num_processed1 == num_utts);
+    // Failed utterances are dropped before the second stage.
+    KALDI_ASSERT(num_processed2 == num_utts - num_fail);
+  }
+  {  // Everything that succeeded must have been written, in input order.
+    SequentialCompactLatticeReader reader("ark:tmpf");
+    size_t i = 0;
+    for (; !reader.Done(); reader.Next()) {
+      while (i < keys.size() && keys[i] != reader.Key()) {
+        KALDI_ASSERT(IsFailKey(keys[i]));
+        i++;
+      }
+      KALDI_ASSERT(i < keys.size() && keys[i] == reader.Key());
+      i++;
+    }
+    while (i < keys.size()) {
+      KALDI_ASSERT(IsFailKey(keys[i]));
+      i++;
+    }
+  }
+  unlink("tmpf");
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  for (int32 i = 0; i < 10; i++)
+    TestLatticePipeline();
+  KALDI_LOG << "Test OK.";
+}
@@ -0,0 +1,196 @@
+// lat/lattice-pipeline.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lat/lattice-pipeline.h"
+#include "lat/lattice-functions.h"
+
+namespace kaldi {
+
+WordAlignLatticeStage::WordAlignLatticeStage(const TransitionModel &tmodel,
+                                             const WordBoundaryInfo &info,
+                                             BaseFloat max_expand):
+    tmodel_(tmodel), info_(info), ctable_(tmodel, info),
+    max_expand_(max_expand) { }
+
+bool WordAlignLatticeStage::Process(const std::string &utt,
+                                    CompactLattice *clat) {
+  int32 max_states;
+  if (max_expand_ > 0) max_states = 1000 + max_expand_ * clat->NumStates();
+  else max_states = 0;
+
+  CompactLattice aligned_clat;
+  bool ok = WordAlignLattice(*clat, ctable_, info_, max_states,
+                             &aligned_clat);
+  if (aligned_clat.Start() == fst::kNoStateId) {
+    KALDI_WARN << "Empty aligned lattice for utterance " << utt;
+    return false;
+  }
+  if (!ok)  // As in lattice-align-words with --output-error-lats=true: the
+            // lattice may have been forced out, so a partial alignment is
+            // still worth passing on.
+    KALDI_WARN << "Lattice for utterance " << utt << " did not align "
+               << "correctly; passing on partial output.";
+  TopSortCompactLatticeIfNeeded(&aligned_clat);
+  *clat = aligned_clat;
+  return true;
+}
+
+LmRescoreLatticeStage::LmRescoreLatticeStage(const std::string &lm_rxfilename,
+                                             BaseFloat lm_scale,
+                                             int32 num_states_cache):
+    lm_scale_(lm_scale),
+    compose_opts_(fst::TableMatcherOptions(), true, fst::SEQUENCE_FILTER,
+                  fst::MATCH_INPUT),
+    lm_compose_cache_(compose_opts_) {
+  fst::VectorFst<fst::StdArc> *std_lm_fst = fst::ReadFstKaldi(lm_rxfilename);
+  if (std_lm_fst->Properties(fst::kILabelSorted, true) == 0) {
+    // Make sure the LM is sorted on ilabel.
+    fst::ILabelCompare<fst::StdArc> ilabel_comp;
+    fst::ArcSort(std_lm_fst, ilabel_comp);
+  }
+  // Interpret the LM fst using the LatticeWeight semiring, with all the
+  // cost on the first member of the pair (since it's a graph weight).
+  fst::CacheOptions cache_opts(true, num_states_cache);
+  fst::StdToLatticeMapper<BaseFloat> mapper;
+  lm_fst_ = new MappedLmFst(*std_lm_fst, mapper, cache_opts);
+  delete std_lm_fst;
+}
+
+LmRescoreLatticeStage::~LmRescoreLatticeStage() {
+  delete lm_fst_;
+}
+
+bool LmRescoreLatticeStage::Process(const std::string &utt,
+                                    CompactLattice *clat) {
+  if (lm_scale_ == 0.0) return true;  // nothing to do.
+  // This mirrors lattice-lmrescore: scale the lattice by the inverse of
+  // lm_scale before composing and by lm_scale after determinizing, so
+  // taking the "best path" through the LM works regardless of the sign of
+  // lm_scale.
+  Lattice lat;
+  ConvertLattice(*clat, &lat);
+  fst::ScaleLattice(fst::GraphLatticeScale(1.0 / lm_scale_), &lat);
+  fst::ArcSort(&lat, fst::OLabelCompare<LatticeArc>());
+
+  Lattice composed_lat;
+  TableCompose(lat, *lm_fst_, &composed_lat, &lm_compose_cache_);
+  fst::Invert(&composed_lat);  // make it so word labels are on the input.
+  CompactLattice determinized_lat;
+  DeterminizeLattice(composed_lat, &determinized_lat);
+  fst::ScaleLattice(fst::GraphLatticeScale(lm_scale_), &determinized_lat);
+  if (determinized_lat.Start() == fst::kNoStateId) {
+    KALDI_WARN << "Empty lattice for utterance " << utt
+               << " (incompatible LM?)";
+    return false;
+  }
+  *clat = determinized_lat;
+  return true;
+}
+
+LatticePipeline::LatticePipeline(const LatticePipelineConfig &config,
+                                 CompactLatticeWriter *writer):
+    config_(config), writer_(writer), num_done_(0), num_failed_(0),
+    started_(false), finished_(false) {
+  KALDI_ASSERT(config.queue_size > 0);
+  KALDI_ASSERT(writer != NULL && writer->IsOpen());
+}
+
+void LatticePipeline::AddStage(LatticePipelineStage *stage) {
+  KALDI_ASSERT(!started_);
+  stages_.push_back(stage);
+}
+
+void LatticePipeline::Start() {
+  KALDI_ASSERT(!started_);
+  started_ = true;
+  // queues_[i] feeds stage i; the last queue feeds the writer.
+  for (size_t i = 0; i < stages_.size() + 1; i++)
+    queues_.push_back(new ItemQueue(config_.queue_size));
+  for (size_t i = 0; i < stages_.size(); i++) {
+    StageRunner runner(this, stages_[i], queues_[i], queues_[i + 1]);
+    threads_.push_back(new MultiThreader<StageRunner>(1, runner));
+  }
+  StageRunner writer_runner(this, NULL, queues_.back(), NULL);
+  threads_.push_back(new MultiThreader<StageRunner>(1, writer_runner));
+}
+
+void LatticePipeline::Push(const std::string &utt, CompactLattice *clat) {
+  KALDI_ASSERT(started_ && !finished_);
+  queues_[0]->Push(new Item(utt, clat));
+}
+
+void LatticePipeline::Finish() {
+  if (!started_) { finished_ = true; return; }
+  if (finished_) return;
+  finished_ = true;
+  queues_[0]->Push(NULL);  // end marker; forwarded down the chain.
+  // Deleting each MultiThreader joins its thread; by the time the last one
+  // (the writer's) is deleted, all queued lattices have been written.
+  for (size_t i = 0; i < threads_.size(); i++)
+    delete threads_[i];
+  threads_.clear();
+}
+
+LatticePipeline::~LatticePipeline() {
+  Finish();
+  for (size_t i = 0; i < queues_.size(); i++)
+    delete queues_[i];
+  for (size_t i = 0; i < stages_.size(); i++)
+    delete stages_[i];
+}
+
+void LatticePipeline::WriteLattice(const Item &item) {
+  writer_->Write(item.utt, *item.clat);
+  stats_mutex_.Lock();
+  num_done_++;
+  stats_mutex_.Unlock();
+}
+
+void LatticePipeline::RecordFailure(const std::string &utt) {
+  stats_mutex_.Lock();
+  num_failed_++;
+  stats_mutex_.Unlock();
+}
+
+void LatticePipeline::StageRunner::operator() () {
+  while (true) {
+    Item *item = in_->Pop();
+    if (item == NULL) {  // end of input: pass it on and stop.
+      if (out_ != NULL) out_->Push(NULL);
+      return;
+    }
+    if (stage_ != NULL) {
+      if (stage_->Process(item->utt, item->clat)) {
+        out_->Push(item);
+      } else {
+        KALDI_WARN << "Pipeline stage failed for utterance " << item->utt
+                   << "; not producing output.";
+        pipeline_->RecordFailure(item->utt);
+        delete item->clat;
+        delete item;
+      }
+    } else {  // the writer thread.
+      pipeline_->WriteLattice(*item);
+      delete item->clat;
+      delete item;
+    }
+  }
+}
+
+}  // namespace kaldi
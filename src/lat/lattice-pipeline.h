@@ -0,0 +1,225 @@
+// lat/lattice-pipeline.h
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_LAT_LATTICE_PIPELINE_H_
+#define KALDI_LAT_LATTICE_PIPELINE_H_
+
+#include <string>
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "itf/options-itf.h"
+#include "fstext/fstext-lib.h"
+#include "hmm/transition-model.h"
+#include "lat/kaldi-lattice.h"
+#include "lat/word-align-lattice.h"
+#include "thread/kaldi-thread.h"
+#include "thread/kaldi-mutex.h"
+#include "thread/kaldi-semaphore.h"
+#include "thread/kaldi-lockfree-queue.h"
+
+namespace kaldi {
+
+/**
+   This header provides an in-process pipeline for the common
+   decode -> post-process -> write pattern that is otherwise run as several
+   programs with archive round-trips between them (e.g. gmm-latgen-faster |
+   lattice-align-words | lattice-lmrescore).  The producer (normally a
+   decoding loop; see gmmbin/gmm-latgen-pipeline.cc) pushes each utterance's
+   CompactLattice into a LatticePipeline; each stage runs on its own thread,
+   and lattices pass between stages as in-memory objects through small
+   bounded queues, so nothing is serialized until the single writer at the
+   end.  This saves the archive reads and writes between the programs, which
+   on network storage can be a substantial fraction of pipeline wall time.
+*/
+
+/// Base class for a pipeline stage: something that rewrites a
+/// CompactLattice in place.  Process() is called from the stage's own
+/// thread, for one utterance at a time, in input order; implementations
+/// need not be thread-safe but must not share mutable state with other
+/// stages.  Return false on failure, in which case the utterance is
+/// dropped from the pipeline (with a warning) and counted as failed.
+class LatticePipelineStage {
+ public:
+  virtual bool Process(const std::string &utt, CompactLattice *clat) = 0;
+  virtual ~LatticePipelineStage() { }
+};
+
+/// Pipeline stage wrapping WordAlignLattice() (see word-align-lattice.h);
+/// does the same job as the program lattice-align-words.  The transition
+/// model and word-boundary info must outlive this object.
+class WordAlignLatticeStage: public LatticePipelineStage {
+ public:
+  /// "max_expand" has the same meaning as the --max-expand option of
+  /// lattice-align-words: if > 0, refuse to expand a lattice by more than
+  /// roughly this factor.
+  WordAlignLatticeStage(const TransitionModel &tmodel,
+                        const WordBoundaryInfo &info,
+                        BaseFloat max_expand);
+
+  virtual bool Process(const std::string &utt, CompactLattice *clat);
+
+ private:
+  const TransitionModel &tmodel_;
+  const WordBoundaryInfo &info_;
+  CompiledWordBoundaryInfo ctable_;
+  BaseFloat max_expand_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(WordAlignLatticeStage);
+};
+
+/// Pipeline stage that composes the lattice with a language model and
+/// re-determinizes, like the program lattice-lmrescore: the LM scores in
+/// the lattice change by lm_scale times the LM's scores.  Use a negative
+/// scale to subtract an old LM and a positive one to add a new LM (two
+/// stages for the usual rescoring recipe).
+class LmRescoreLatticeStage: public LatticePipelineStage {
+ public:
+  LmRescoreLatticeStage(const std::string &lm_rxfilename,
+                        BaseFloat lm_scale,
+                        int32 num_states_cache = 50000);
+  virtual ~LmRescoreLatticeStage();
+
+  virtual bool Process(const std::string &utt, CompactLattice *clat);
+
+ private:
+  typedef fst::MapFst<fst::StdArc, LatticeArc,
+                      fst::StdToLatticeMapper<BaseFloat> > MappedLmFst;
+  BaseFloat lm_scale_;
+  MappedLmFst *lm_fst_;
+  fst::TableComposeOptions compose_opts_;
+  fst::TableComposeCache<fst::Fst<LatticeArc> > lm_compose_cache_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(LmRescoreLatticeStage);
+};
+
+struct LatticePipelineConfig {
+  int32 queue_size;  // bound on in-flight lattices between adjacent stages.
+  LatticePipelineConfig(): queue_size(16) { }
+  void Register(OptionsItf *po) {
+    po->Register("pipeline-queue-size", &queue_size, "Maximum number of "
+                 "lattices queued between adjacent pipeline stages (bounds "
+                 "memory use; the producer blocks when a queue is full).");
+  }
+};
+
+/// The pipeline driver.  Usage:
+///  - construct with a writer (not owned) that the final thread writes to;
+///  - AddStage() for each processing stage, in order (ownership is taken);
+///  - Start(), then Push() each utterance's lattice (ownership is taken);
+///  - Finish() (or just destroy the object), then read NumDone()/NumFailed().
+/// Push() blocks while the first queue is full, so the number of lattices
+/// in flight never exceeds queue_size * (num-stages + 1).
+class LatticePipeline {
+ public:
+  /// "writer" must be open, and is used only from the pipeline's writer
+  /// thread until Finish() returns.
+  LatticePipeline(const LatticePipelineConfig &config,
+                  CompactLatticeWriter *writer);
+
+  /// Appends a stage; call before Start().  Takes ownership of "stage".
+  void AddStage(LatticePipelineStage *stage);
+
+  /// Starts the stage and writer threads.
+  void Start();
+
+  /// Hands the lattice for "utt" to the first stage; takes ownership of
+  /// "clat".  Blocks while the first queue is full.  Call only between
+  /// Start() and Finish(), from a single thread.
+  void Push(const std::string &utt, CompactLattice *clat);
+
+  /// Signals end of input and waits for all queued lattices to be written.
+  /// Called from the destructor if not called explicitly, but calling it
+  /// yourself is better as the destructor cannot report write errors.
+  void Finish();
+
+  ~LatticePipeline();
+
+  /// Counters, valid after Finish().
+  int32 NumDone() const { return num_done_; }
+  int32 NumFailed() const { return num_failed_; }
+
+ private:
+  struct Item {
+    std::string utt;
+    CompactLattice *clat;
+    Item(const std::string &utt, CompactLattice *clat):
+        utt(utt), clat(clat) { }
+  };
+
+  // A bounded blocking queue of Item*; a NULL item marks end of input.
+  // The semaphores count free slots and queued elements, so SpscQueue's
+  // TryPush and TryPop cannot fail when we call them.
+  class ItemQueue {
+   public:
+    explicit ItemQueue(int32 capacity):
+        slots_(capacity), elements_(0), queue_(capacity) { }
+    void Push(Item *item) {
+      slots_.Wait();
+      bool ok = queue_.TryPush(item);
+      KALDI_ASSERT(ok);
+      elements_.Signal();
+    }
+    Item *Pop() {
+      elements_.Wait();
+      Item *ans;
+      bool ok = queue_.TryPop(&ans);
+      KALDI_ASSERT(ok);
+      slots_.Signal();
+      return ans;
+    }
+   private:
+    Semaphore slots_, elements_;
+    SpscQueue<Item*> queue_;
+    KALDI_DISALLOW_COPY_AND_ASSIGN(ItemQueue);
+  };
+
+  // Runs one stage (or, if stage == NULL, the final writer) on its own
+  // thread, via MultiThreader with one thread.
+  class StageRunner: public MultiThreadable {
+   public:
+    StageRunner(LatticePipeline *pipeline, LatticePipelineStage *stage,
+                ItemQueue *in, ItemQueue *out):
+        pipeline_(pipeline), stage_(stage), in_(in), out_(out) { }
+    virtual void operator() ();
+   private:
+    LatticePipeline *pipeline_;
+    LatticePipelineStage *stage_;  // NULL for the writer thread.
+    ItemQueue *in_;
+    ItemQueue *out_;  // NULL for the writer thread.
+  };
+  friend class StageRunner;
+
+  void WriteLattice(const Item &item);  // called from the writer thread.
+  void RecordFailure(const std::string &utt);  // called from stage threads.
+
+  LatticePipelineConfig config_;
+  CompactLatticeWriter *writer_;  // not owned.
+  std::vector<LatticePipelineStage*> stages_;  // owned.
+  std::vector<ItemQueue*> queues_;  // queues_[i] feeds stage i (or, for the
+                                    // last one, the writer); owned.
+  std::vector<MultiThreader<StageRunner>*> threads_;
+  Mutex stats_mutex_;  // guards the counters below.
+  int32 num_done_, num_failed_;
+  bool started_, finished_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(LatticePipeline);
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_LAT_LATTICE_PIPELINE_H_
@@ -0,0 +1,202 @@
+// lat/online-combination.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "lat/online-combination.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace kaldi {
+
+// Comparator for sorting the (word, posterior) pairs of a bin with the most
+// likely word first; same ordering as MinimumBayesRisk uses internally.
+namespace {
+struct BinEntryCompare {
+  bool operator () (const std::pair<int32, BaseFloat> &a,
+                    const std::pair<int32, BaseFloat> &b) const {
+    if (a.second > b.second) return true;
+    else if (a.second < b.second) return false;
+    else return a.first > b.first;
+  }
+};
+}  // namespace
+
+OnlineSausageCombiner::OnlineSausageCombiner(
+    const OnlineSausageCombinerOptions &opts,
+    int32 num_systems): opts_(opts), num_stable_bins_(0) {
+  KALDI_ASSERT(num_systems > 0 && opts.stable_delay >= 0);
+  if (opts_.system_weights.empty()) {
+    weights_.resize(num_systems, 1.0);
+  } else {
+    if (!SplitStringToFloats(opts_.system_weights, ":", false, &weights_) ||
+        static_cast<int32>(weights_.size()) != num_systems)
+      KALDI_ERR << "Invalid option --system-weights="
+                << opts_.system_weights << " (expected " << num_systems
+                << " colon-separated weights)";
+    for (int32 s = 0; s < num_systems; s++)
+      if (weights_[s] <= 0.0)
+        KALDI_ERR << "System weights must be positive: got "
+                  << opts_.system_weights;
+  }
+  systems_.resize(num_systems);
+}
+
+void OnlineSausageCombiner::AcceptLattice(int32 system,
+                                          const CompactLattice &clat,
+                                          int32 num_frames_decoded) {
+  KALDI_ASSERT(system >= 0 &&
+               system < static_cast<int32>(systems_.size()));
+  SystemState &sys = systems_[system];
+  KALDI_ASSERT(num_frames_decoded >= sys.num_frames_decoded &&
+               "Partial lattices for a system must cover growing prefixes.");
+  sys.num_frames_decoded = num_frames_decoded;
+  if (clat.Start() == fst::kNoStateId) {
+    KALDI_WARN << "Empty partial lattice for system " << system
+               << "; keeping its previous sausage.";
+  } else {
+    MinimumBayesRisk mbr(clat, opts_.mbr_opts, opts_.do_mbr);
+    sys.gamma = mbr.GetSausageStats();
+    sys.times = mbr.GetSausageTimes();
+  }
+  Combine();
+}
+
+void OnlineSausageCombiner::MergeIntoBin(
+    const std::vector<std::pair<int32, BaseFloat> > &gamma,
+    const std::pair<BaseFloat, BaseFloat> &times,
+    BaseFloat weight, int32 bin) {
+  std::vector<std::pair<int32, BaseFloat> > &dest = gamma_[bin];
+  for (size_t i = 0; i < gamma.size(); i++) {
+    int32 word = gamma[i].first;
+    BaseFloat post = weight * gamma[i].second;
+    size_t j;
+    for (j = 0; j < dest.size(); j++) {
+      if (dest[j].first == word) { dest[j].second += post; break; }
+    }
+    if (j == dest.size())
+      dest.push_back(std::make_pair(word, post));
+  }
+  // these are weighted sums; Combine() divides by bin_weights_ at the end.
+  times_[bin].first += weight * times.first;
+  times_[bin].second += weight * times.second;
+  bin_weights_[bin] += weight;
+}
+
+void OnlineSausageCombiner::Combine() {
+  gamma_.clear();
+  times_.clear();
+  bin_weights_.clear();
+
+  int32 num_systems = systems_.size(),
+      min_frames = std::numeric_limits<int32>::max();
+  for (int32 s = 0; s < num_systems; s++)
+    min_frames = std::min(min_frames, systems_[s].num_frames_decoded);
+
+  for (int32 s = 0; s < num_systems; s++) {
+    const SystemState &sys = systems_[s];
+    if (sys.gamma.empty()) continue;
+    int32 num_bins = sys.gamma.size();
+    if (gamma_.empty()) {
+      // The first system with a sausage acts as the backbone: its bins
+      // become the combined bins.
+      gamma_.resize(num_bins);
+      times_.resize(num_bins, std::make_pair(0.0f, 0.0f));
+      bin_weights_.resize(num_bins, 0.0);
+      for (int32 j = 0; j < num_bins; j++)
+        MergeIntoBin(sys.gamma[j], sys.times[j], weights_[s], j);
+    } else {
+      int32 i = 0;  // index into the combined bins; advances monotonically,
+                    // since both bin sequences are ordered by time.
+      for (int32 j = 0; j < num_bins; j++) {
+        // Overlap in frames of system bin j with combined bin i (negative
+        // if disjoint).  Combined times are still weighted sums here, so we
+        // divide by the weight merged so far.
+        BaseFloat start_j = sys.times[j].first, end_j = sys.times[j].second;
+        double best_overlap = std::min<double>(
+            times_[i].second / bin_weights_[i], end_j) -
+            std::max<double>(times_[i].first / bin_weights_[i], start_j);
+        // Both sequences are time-ordered, so overlap as a function of i is
+        // unimodal and we can advance greedily to the best-matching bin.
+        while (i + 1 < static_cast<int32>(gamma_.size())) {
+          double overlap = std::min<double>(
+              times_[i+1].second / bin_weights_[i+1], end_j) -
+              std::max<double>(times_[i+1].first / bin_weights_[i+1], start_j);
+          if (overlap > best_overlap) { best_overlap = overlap; i++; }
+          else break;
+        }
+        if (best_overlap < 0.0 && i + 1 == static_cast<int32>(gamma_.size()) &&
+            start_j >= times_[i].second / bin_weights_[i]) {
+          // This bin starts after everything we have (e.g. this system has
+          // decoded further than the backbone): append a new combined bin.
+          gamma_.resize(gamma_.size() + 1);
+          times_.push_back(std::make_pair(0.0f, 0.0f));
+          bin_weights_.push_back(0.0);
+          i = gamma_.size() - 1;
+        }
+        MergeIntoBin(sys.gamma[j], sys.times[j], weights_[s], i);
+      }
+    }
+  }
+
+  // Normalize: posteriors in each bin sum to one (a system that contributed
+  // nothing to a bin is treated as having voted for what is there, which
+  // slightly overstates confidence but keeps the code simple), and the
+  // weighted time sums become averages.
+  int32 num_bins = gamma_.size();
+  for (int32 i = 0; i < num_bins; i++) {
+    double tot = 0.0;
+    for (size_t j = 0; j < gamma_[i].size(); j++) tot += gamma_[i][j].second;
+    if (tot > 0.0)
+      for (size_t j = 0; j < gamma_[i].size(); j++) gamma_[i][j].second /= tot;
+    BinEntryCompare comp;
+    std::sort(gamma_[i].begin(), gamma_[i].end(), comp);
+    times_[i].first /= bin_weights_[i];
+    times_[i].second /= bin_weights_[i];
+  }
+
+  int32 num_stable = 0;
+  if (min_frames > 0 && min_frames != std::numeric_limits<int32>::max()) {
+    while (num_stable < num_bins &&
+           times_[num_stable].second + opts_.stable_delay <= min_frames)
+      num_stable++;
+  }
+  // the stable count never decreases, so a caller who has already forwarded
+  // the stable prefix to the user is not asked to retract it.
+  num_stable_bins_ = std::max(num_stable_bins_, num_stable);
+}
+
+void OnlineSausageCombiner::GetBestHypothesis(
+    std::vector<int32> *words,
+    std::vector<BaseFloat> *confidences,
+    bool stable_only) const {
+  KALDI_ASSERT(words != NULL);
+  words->clear();
+  if (confidences != NULL) confidences->clear();
+  int32 num_bins = (stable_only ? num_stable_bins_ :
+                    static_cast<int32>(gamma_.size()));
+  for (int32 i = 0; i < num_bins; i++) {
+    if (gamma_[i].empty()) continue;
+    int32 word = gamma_[i][0].first;  // bins are sorted, best word first.
+    if (word == 0) continue;  // epsilon: no word in this bin.
+    words->push_back(word);
+    if (confidences != NULL) confidences->push_back(gamma_[i][0].second);
+  }
+}
+
+}  // namespace kaldi
@@ -0,0 +1,178 @@
+// lat/online-combination.h
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_LAT_ONLINE_COMBINATION_H_
+#define KALDI_LAT_ONLINE_COMBINATION_H_
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "lat/kaldi-lattice.h"
+#include "lat/sausages.h"
+
+namespace kaldi {
+
+/// This header provides a streaming version of the system combination that
+/// we normally do offline with MBR decoding: several decoders (e.g. several
+/// LatticeFasterOnlineDecoder instances running different acoustic models on
+/// the same audio) each periodically supply the lattice of the utterance
+/// decoded so far, and this class maintains a combined confusion network
+/// ("sausage") over all systems, so that a combined hypothesis is available
+/// while decoding is still in progress.
+///
+/// For each system we run the MinimumBayesRisk machinery of sausages.h on the
+/// partial lattice, which gives a linear sequence of bins, each with a
+/// distribution over words and with average (start,end) times in frames.  We
+/// then align the per-system sausages to each other by time overlap and
+/// average the word posteriors, weighted by the per-system weights.  This is
+/// cruder than the joint MBR decoding we do offline (where the stats of all
+/// systems go through the edit-distance recursion together), but it requires
+/// no cross-system lattice alignment and its cost is linear in the number of
+/// bins, which is what makes it usable online.
+///
+/// A prefix of the combined sausage is reported as "stable" once it ends more
+/// than --stable-delay frames before the last frame that every system has
+/// decoded; you would typically forward only the stable part to the user and
+/// re-display the rest as it changes.  The stability is heuristic: a bin can
+/// still change if some decoder's lattice revises that far back, so
+/// --stable-delay should comfortably exceed the decoders' typical traceback
+/// depth.
+///
+/// The partial lattices can come from
+/// LatticeFasterOnlineDecoder::GetRawLatticePruned() followed by
+/// determinization, or by concatenating the chunks from GetLatticeChunk();
+/// in either case any acoustic scaling should already have been applied,
+/// as with the offline MBR code.
+
+struct OnlineSausageCombinerOptions {
+  /// Colon-separated weights, one per system, e.g. "1.0:0.5"; the empty
+  /// string means equal weights.  They need not sum to one.
+  std::string system_weights;
+  /// A bin is reported stable once it ends this many frames before the
+  /// last frame all systems have decoded.
+  int32 stable_delay;
+  /// If true, each system's hypothesis is MBR-decoded before the stats are
+  /// accumulated (as in the offline code); if false, MAP output is used.
+  bool do_mbr;
+
+  MinimumBayesRiskOptions mbr_opts;
+
+  OnlineSausageCombinerOptions(): system_weights(""),
+                                  stable_delay(50),
+                                  do_mbr(true) { }
+
+  void Register(OptionsItf *opts) {
+    opts->Register("system-weights", &system_weights, "Colon-separated "
+                   "per-system weights for combination, e.g. '1.0:0.5'; "
+                   "empty means equal weights.");
+    opts->Register("stable-delay", &stable_delay, "Number of frames behind "
+                   "the slowest system's decoded frontier after which a "
+                   "confusion-network bin is treated as stable.");
+    opts->Register("do-mbr", &do_mbr, "If true, do MBR decoding on each "
+                   "system's partial lattice (recommended); if false, use "
+                   "the MAP output, which is faster.");
+    mbr_opts.Register(opts);
+  }
+};
+
+class OnlineSausageCombiner {
+ public:
+  OnlineSausageCombiner(const OnlineSausageCombinerOptions &opts,
+                        int32 num_systems);
+
+  /// Call this whenever system "system" (zero-based) has a new partial
+  /// lattice available; "clat" must cover the utterance from frame zero up
+  /// to frame "num_frames_decoded" (exclusive), i.e. it is the lattice so
+  /// far, not an incremental chunk.  Supplying a lattice for a system
+  /// replaces that system's previous contribution; the combined sausage is
+  /// recomputed, so after this call the Get*() accessors reflect all the
+  /// latest lattices.  Lattices need not arrive in any particular order
+  /// across systems.
+  void AcceptLattice(int32 system, const CompactLattice &clat,
+                     int32 num_frames_decoded);
+
+  /// The combined confusion network: for each bin, (word, posterior) pairs
+  /// sorted with the most likely word first; posteriors in each bin sum to
+  /// one and word may be epsilon.  Same format as
+  /// MinimumBayesRisk::GetSausageStats().
+  const std::vector<std::vector<std::pair<int32, BaseFloat> > >
+      &GetSausageStats() const { return gamma_; }
+
+  /// Average (start,end) times in frames for each bin of GetSausageStats().
+  const std::vector<std::pair<BaseFloat, BaseFloat> > &GetSausageTimes()
+      const { return times_; }
+
+  /// Number of leading bins of GetSausageStats() that are currently stable
+  /// (see --stable-delay above); this never decreases.
+  int32 NumStableBins() const { return num_stable_bins_; }
+
+  /// Outputs the most likely word in each bin, with epsilons removed; if
+  /// "confidences" is non-NULL, outputs the corresponding bin posteriors.
+  /// If "stable_only" is true, only the stable prefix is output.
+  void GetBestHypothesis(std::vector<int32> *words,
+                         std::vector<BaseFloat> *confidences = NULL,
+                         bool stable_only = false) const;
+
+ private:
+  /// The per-system sausage, from the most recent lattice of that system.
+  struct SystemState {
+    std::vector<std::vector<std::pair<int32, BaseFloat> > > gamma;
+    std::vector<std::pair<BaseFloat, BaseFloat> > times;
+    int32 num_frames_decoded;
+    SystemState(): num_frames_decoded(0) { }
+  };
+
+  /// Recomputes gamma_, times_ and num_stable_bins_ from systems_.  The
+  /// first system that has supplied a lattice acts as the backbone; each
+  /// other system's bins are merged into the backbone bin they overlap most
+  /// in time (appended at the end if they overlap nothing), with posteriors
+  /// scaled by the system weight, and each combined bin is renormalized.
+  void Combine();
+
+  /// Merges "gamma" (scaled by "weight") and "times" of one system bin into
+  /// combined bin "bin".
+  void MergeIntoBin(const std::vector<std::pair<int32, BaseFloat> > &gamma,
+                    const std::pair<BaseFloat, BaseFloat> &times,
+                    BaseFloat weight, int32 bin);
+
+  const OnlineSausageCombinerOptions opts_;
+  std::vector<BaseFloat> weights_;  // one per system, parsed from opts_.
+  std::vector<SystemState> systems_;
+
+  // The combined sausage; same formats as in MinimumBayesRisk.  During
+  // Combine() the per-bin posteriors in gamma_ are unnormalized and we also
+  // use bin_weights_ (total weight merged into each bin, for the
+  // renormalization and the time averaging); they are normalized before
+  // Combine() returns.
+  std::vector<std::vector<std::pair<int32, BaseFloat> > > gamma_;
+  std::vector<std::pair<BaseFloat, BaseFloat> > times_;
+  std::vector<BaseFloat> bin_weights_;
+
+  int32 num_stable_bins_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineSausageCombiner);
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_LAT_ONLINE_COMBINATION_H_
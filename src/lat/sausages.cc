@@ -312,10 +312,95 @@ void MinimumBayesRisk::PrepareLatticeAndInitStats(CompactLattice *clat) {
       arcs_.push_back(arc);
     }
   }
+  if (opts_.prune_posterior > 0.0)
+    PruneArcs();
 }
 
-MinimumBayesRisk::MinimumBayesRisk(const CompactLattice &clat_in, bool do_mbr):
-    do_mbr_(do_mbr) {
+void MinimumBayesRisk::PruneArcs() {
+  int32 N = static_cast<int32>(pre_.size()) - 1;
+  size_t num_arcs = arcs_.size();
+  if (N < 2 || num_arcs == 0)
+    return;
+  // Plain forward-backward over the word-level graph to get each arc's
+  // posterior; this is O(arcs), negligible next to the recursions we are
+  // pruning for.  Node numbering is topological (the lattice was sorted).
+  std::vector<double> alpha(N + 1, kLogZeroDouble),
+      beta(N + 1, kLogZeroDouble);
+  alpha[1] = 0.0;
+  for (int32 n = 2; n <= N; n++)
+    for (size_t i = 0; i < pre_[n].size(); i++) {
+      const Arc &arc = arcs_[pre_[n][i]];
+      alpha[n] = LogAdd(alpha[n], alpha[arc.start_node] + arc.loglike);
+    }
+  beta[N] = 0.0;
+  for (int32 n = N; n >= 2; n--)
+    for (size_t i = 0; i < pre_[n].size(); i++) {
+      const Arc &arc = arcs_[pre_[n][i]];
+      beta[arc.start_node] = LogAdd(beta[arc.start_node],
+                                    arc.loglike + beta[n]);
+    }
+  double tot_like = alpha[N],
+      log_cutoff = Log(static_cast<double>(opts_.prune_posterior));
+  std::vector<bool> keep(num_arcs);
+  for (size_t i = 0; i < num_arcs; i++) {
+    const Arc &arc = arcs_[i];
+    keep[i] = (alpha[arc.start_node] + arc.loglike + beta[arc.end_node]
+               - tot_like >= log_cutoff);
+  }
+  // An arc may only survive if it still lies on a complete path through the
+  // kept arcs, since the recursions assume every state is reachable;
+  // "acc" is reachability from the start node over kept arcs, "coacc"
+  // reachability to the final node.
+  std::vector<bool> acc(N + 1, false), coacc(N + 1, false);
+  acc[1] = true;
+  for (int32 n = 2; n <= N; n++)
+    for (size_t i = 0; i < pre_[n].size(); i++)
+      if (keep[pre_[n][i]] && acc[arcs_[pre_[n][i]].start_node])
+        acc[n] = true;
+  coacc[N] = true;
+  for (int32 n = N; n >= 2; n--)
+    for (size_t i = 0; i < pre_[n].size(); i++)
+      if (keep[pre_[n][i]] && coacc[n])
+        coacc[arcs_[pre_[n][i]].start_node] = true;
+  if (!coacc[1]) {  // this can happen if even the best path has posterior
+                    // below the threshold (very flat lattice).
+    KALDI_WARN << "Posterior pruning at " << opts_.prune_posterior
+               << " would remove all complete paths; not pruning "
+               << "this lattice.";
+    return;
+  }
+  // Renumber the surviving states in their old (still topological) order,
+  // and rebuild the arc array and indexes.
+  std::vector<int32> new_id(N + 1, -1);
+  int32 new_N = 0;
+  for (int32 n = 1; n <= N; n++)
+    if (acc[n] && coacc[n])
+      new_id[n] = ++new_N;
+  std::vector<Arc> arcs;
+  std::vector<std::vector<int32> > pre(new_N + 1);
+  std::vector<int32> state_times(new_N + 1, 0);
+  for (int32 n = 1; n <= N; n++)
+    if (new_id[n] != -1)
+      state_times[new_id[n]] = state_times_[n];
+  for (size_t i = 0; i < num_arcs; i++) {
+    Arc arc = arcs_[i];
+    if (keep[i] && acc[arc.start_node] && coacc[arc.end_node]) {
+      arc.start_node = new_id[arc.start_node];
+      arc.end_node = new_id[arc.end_node];
+      pre[arc.end_node].push_back(static_cast<int32>(arcs.size()));
+      arcs.push_back(arc);
+    }
+  }
+  KALDI_VLOG(2) << "Posterior pruning kept " << arcs.size() << " of "
+                << num_arcs << " arcs and " << new_N << " of " << N
+                << " states.";
+  arcs_.swap(arcs);
+  pre_.swap(pre);
+  state_times_.swap(state_times);
+}
+
+void MinimumBayesRisk::Initialize(const CompactLattice &clat_in,
+                                  const std::vector<int32> *words) {
   CompactLattice clat(clat_in); // copy.
 
   PrepareLatticeAndInitStats(&clat);
@@ -326,7 +411,9 @@ MinimumBayesRisk::MinimumBayesRisk(const CompactLattice &clat_in, bool do_mbr):
   // numbered state, thanks to CreateSuperFinal and the topological
   // sorting.
 
-  { // Now set R_ to one best in the FST.
+  if (words != NULL) {
+    R_ = *words;
+  } else { // Now set R_ to one best in the FST.
     RemoveAlignmentsFromCompactLattice(&clat); // will be more efficient
     // in best-path if we do this.
     Lattice lat;
@@ -335,30 +422,43 @@ MinimumBayesRisk::MinimumBayesRisk(const CompactLattice &clat_in, bool do_mbr):
     ConvertLattice(lat, &fst); // convert from lattice to normal FST.
     fst::VectorFst<fst::StdArc> fst_shortest_path;
     fst::ShortestPath(fst, &fst_shortest_path); // take shortest path of FST.
-    std::vector<int32> alignment, words;
+    std::vector<int32> alignment, best_words;
     fst::TropicalWeight weight;
-    GetLinearSymbolSequence(fst_shortest_path, &alignment, &words, &weight);
+    GetLinearSymbolSequence(fst_shortest_path, &alignment, &best_words,
+                            &weight);
     KALDI_ASSERT(alignment.empty()); // we removed the alignment.
-    R_ = words;
-    L_ = 0.0; // Set current edit-distance to 0 [just so we know
-    // when we're on the 1st iter.]
+    R_ = best_words;
   }
-  
+  L_ = 0.0; // Set current edit-distance to 0 [just so we know
+  // when we're on the 1st iter.]
+
   MbrDecode();
-  
+}
+
+MinimumBayesRisk::MinimumBayesRisk(const CompactLattice &clat_in, bool do_mbr):
+    do_mbr_(do_mbr) {
+  Initialize(clat_in, NULL);
+}
+
+MinimumBayesRisk::MinimumBayesRisk(const CompactLattice &clat_in,
+                                   const MinimumBayesRiskOptions &opts,
+                                   bool do_mbr):
+    opts_(opts), do_mbr_(do_mbr) {
+  Initialize(clat_in, NULL);
 }
 
 MinimumBayesRisk::MinimumBayesRisk(const CompactLattice &clat_in,
                                    const std::vector<int32> &words,
                                    bool do_mbr): do_mbr_(do_mbr) {
-  CompactLattice clat(clat_in); // copy.
-
-  PrepareLatticeAndInitStats(&clat);
-
-  R_ = words;
-  L_ = 0.0;
+  Initialize(clat_in, &words);
+}
 
-  MbrDecode();
+MinimumBayesRisk::MinimumBayesRisk(const CompactLattice &clat_in,
+                                   const std::vector<int32> &words,
+                                   const MinimumBayesRiskOptions &opts,
+                                   bool do_mbr):
+    opts_(opts), do_mbr_(do_mbr) {
+  Initialize(clat_in, &words);
 }
 
 }  // namespace kaldi
@@ -53,6 +53,27 @@ namespace kaldi {
 /// is where we put possible insertions. 
 
 
+struct MinimumBayesRiskOptions {
+  /// Arcs of the word-level lattice whose posterior is below this value are
+  /// pruned away before the edit-distance recursions, which are
+  /// O(lattice-arcs * hypothesis-words) per iteration; on dense lattices
+  /// most of those arcs contribute negligibly to the stats.  The pruning
+  /// keeps complete paths intact (and is skipped, with a warning, in the
+  /// unusual case where no complete path would survive).  Zero means no
+  /// pruning, which gives exactly the old behavior; something like 1.0e-05
+  /// typically loses nothing measurable.
+  BaseFloat prune_posterior;
+
+  MinimumBayesRiskOptions(): prune_posterior(0.0) { }
+
+  void Register(OptionsItf *opts) {
+    opts->Register("mbr-prune-posterior", &prune_posterior, "Prune away arcs "
+                   "with posterior below this value before the MBR "
+                   "computation (0 == no pruning); speeds it up on dense "
+                   "lattices at a small cost in exactness.");
+  }
+};
+
 /// This class does the word-level Minimum Bayes Risk computation, and gives you
 /// either the 1-best MBR output together with the expected Bayes Risk,
 /// or a sausage-like structure.
@@ -66,10 +87,21 @@ class MinimumBayesRisk {
   // it will just use the MAP recognition output, but will get the MBR stats for things
   // like confidences.
 
+  // As above, but with configuration (e.g. posterior pruning).
+  MinimumBayesRisk(const CompactLattice &clat,
+                   const MinimumBayesRiskOptions &opts,
+                   bool do_mbr = true);
+
   // Uses the provided <words> as <R_> instead of using the lattice best path. 
   MinimumBayesRisk(const CompactLattice &clat,
                    const std::vector<int32> &words, bool do_mbr = false);
 
+  // As above, but with configuration (e.g. posterior pruning).
+  MinimumBayesRisk(const CompactLattice &clat,
+                   const std::vector<int32> &words,
+                   const MinimumBayesRiskOptions &opts,
+                   bool do_mbr = false);
+
   const std::vector<int32> &GetOneBest() const { // gets one-best (with no epsilons)
     return R_;
   }
@@ -101,8 +133,20 @@ class MinimumBayesRisk {
   }  
 
  private:
+  /// Common setup for the constructors: prepares the lattice, sets the
+  /// initial hypothesis R_ ("words" if non-NULL, else the lattice best
+  /// path) and runs the decode.
+  void Initialize(const CompactLattice &clat, const std::vector<int32> *words);
+
   void PrepareLatticeAndInitStats(CompactLattice *clat);
 
+  /// Implements opts_.prune_posterior: computes the posterior of each arc of
+  /// the internal word-level graph (arcs_/pre_) with a cheap
+  /// forward-backward, and rebuilds arcs_, pre_ and state_times_ with the
+  /// arcs below the threshold (and any states left off all complete paths)
+  /// removed.  Called from PrepareLatticeAndInitStats().
+  void PruneArcs();
+
   /// Minimum-Bayes-Risk Decode. Top-level algorithm.  Figure 6 of the paper.
   void MbrDecode(); 
 
@@ -148,6 +192,8 @@ class MinimumBayesRisk {
     BaseFloat loglike;
   };
 
+  MinimumBayesRiskOptions opts_;
+
   /// Boolean configuration parameter: if true, we actually update the hypothesis
   /// to do MBR decoding (if false, our output is the MAP decoded output, but we
   /// output the stats too).
@@ -57,27 +57,27 @@ class LatticeWordAligner {
     /// Note: the "next_state" of the arc will not be set, you have to do that
     /// yourself.
     bool OutputArc(const WordBoundaryInfo &info,
-                   const TransitionModel &tmodel,
+                   const CompiledWordBoundaryInfo &ctable,
                    CompactLatticeArc *arc_out,
                    bool *error) {
       // order of this ||-expression doesn't matter for
       // function behavior, only for efficiency, since the
       // cases are disjoint.
-      return OutputNormalWordArc(info, tmodel, arc_out, error) ||
-          OutputSilenceArc(info, tmodel, arc_out, error) ||
-          OutputOnePhoneWordArc(info, tmodel, arc_out, error);
+      return OutputNormalWordArc(info, ctable, arc_out, error) ||
+          OutputSilenceArc(info, ctable, arc_out, error) ||
+          OutputOnePhoneWordArc(info, ctable, arc_out, error);
     }
 
     bool OutputSilenceArc(const WordBoundaryInfo &info,
-                          const TransitionModel &tmodel,
+                          const CompiledWordBoundaryInfo &ctable,
                           CompactLatticeArc *arc_out,
                           bool *error); 
     bool OutputOnePhoneWordArc(const WordBoundaryInfo &info,
-                               const TransitionModel &tmodel,
+                               const CompiledWordBoundaryInfo &ctable,
                                CompactLatticeArc *arc_out,
                                bool *error); 
     bool OutputNormalWordArc(const WordBoundaryInfo &info,
-                             const TransitionModel &tmodel,
+                             const CompiledWordBoundaryInfo &ctable,
                              CompactLatticeArc *arc_out,
                              bool *error);
     
@@ -101,7 +101,7 @@ class LatticeWordAligner {
     /// happen for lattices that were somehow broken, i.e.
     /// had not reached the final state.
     void OutputArcForce(const WordBoundaryInfo &info,
-                        const TransitionModel &tmodel,
+                        const CompiledWordBoundaryInfo &ctable,
                         CompactLatticeArc *arc_out,
                         bool *error);
   
@@ -185,7 +185,7 @@ class LatticeWordAligner {
       // have returned false or we wouldn't have been called, so we have to
       // force it out.
       CompactLatticeArc lat_arc;
-      tuple.comp_state.OutputArcForce(info_, tmodel_, &lat_arc, &error_);
+      tuple.comp_state.OutputArcForce(info_, ctable_, &lat_arc, &error_);
       lat_arc.nextstate = GetStateForTuple(tuple, true); // true == add to queue.
       // The final-prob stuff will get called again from ProcessQueueElement().
       // Note: because we did CreateSuperFinal(), this final-state on the input
@@ -211,7 +211,7 @@ class LatticeWordAligner {
     // composition.
     CompactLatticeArc lat_arc;
     Tuple tuple2(tuple); // temp
-    if (tuple.comp_state.OutputArc(info_, tmodel_, &lat_arc, &error_)) {
+    if (tuple.comp_state.OutputArc(info_, ctable_, &lat_arc, &error_)) {
       // note: this function changes the tuple (when it returns true).
       lat_arc.nextstate = GetStateForTuple(tuple, true); // true == add to queue,
       // if not already present.
@@ -250,11 +250,11 @@ class LatticeWordAligner {
   }
   
   LatticeWordAligner(const CompactLattice &lat,
-                     const TransitionModel &tmodel,
+                     const CompiledWordBoundaryInfo &ctable,
                      const WordBoundaryInfo &info,
                      int32 max_states,
                      CompactLattice *lat_out):
-      lat_(lat), tmodel_(tmodel), info_in_(info), info_(info),
+      lat_(lat), ctable_(ctable), info_in_(info), info_(info),
       max_states_(max_states), lat_out_(lat_out),
       error_(false) {
     bool test = true;
@@ -328,7 +328,7 @@ class LatticeWordAligner {
   }
   
   CompactLattice lat_;
-  const TransitionModel &tmodel_;
+  const CompiledWordBoundaryInfo &ctable_;
   const WordBoundaryInfo &info_in_;
   WordBoundaryInfo info_;
   int32 max_states_;
@@ -344,11 +344,12 @@ class LatticeWordAligner {
 };
 
 bool LatticeWordAligner::ComputationState::OutputSilenceArc(
-    const WordBoundaryInfo &info, const TransitionModel &tmodel,
+    const WordBoundaryInfo &info, const CompiledWordBoundaryInfo &ctable,
     CompactLatticeArc *arc_out,  bool *error) {
   if (transition_ids_.empty()) return false;
-  int32 phone = tmodel.TransitionIdToPhone(transition_ids_[0]);
-  if (info.TypeOfPhone(phone) != WordBoundaryInfo::kNonWordPhone) return false;
+  if (ctable.TypeOfTid(transition_ids_[0]) != WordBoundaryInfo::kNonWordPhone)
+    return false;
+  int32 phone = ctable.Phone(transition_ids_[0]);
 
   // we assume the start of transition_ids_ is the start of the phone [silence];
   // this is a precondition.
@@ -357,22 +358,22 @@ bool LatticeWordAligner::ComputationState::OutputSilenceArc(
   // reorder==true, we have to go a bit further after this.
   for (i = 1; i < len; i++) {
     int32 tid = transition_ids_[i];
-    int32 this_phone = tmodel.TransitionIdToPhone(tid);
+    int32 this_phone = ctable.Phone(tid);
     if (this_phone != phone && ! *error) { // error condition: should have reached final transition-id first.
       *error = true;
       KALDI_WARN << "Phone changed before final transition-id found "
           "[broken lattice or mismatched model or wrong --reorder option?]";
     }
-    if (tmodel.IsFinal(tid))
+    if (ctable.IsFinal(tid))
       break;
   }
   if (i == len) return false; // fell off loop.
   i++; // go past the one for which IsFinal returned true.
   if (info.reorder) // we have to consume the following self-loop transition-ids.
-    while (i < len && tmodel.IsSelfLoop(transition_ids_[i])) i++;
+    while (i < len && ctable.IsSelfLoop(transition_ids_[i])) i++;
   if (i == len) return false; // we don't know if it ends here... so can't output arc.
 
-  if (tmodel.TransitionIdToPhone(transition_ids_[i-1]) != phone
+  if (ctable.Phone(transition_ids_[i-1]) != phone
       && ! *error) { // another check.
     KALDI_WARN << "Phone changed unexpectedly in lattice "
         "[broken lattice or mismatched model?]";
@@ -390,34 +391,34 @@ bool LatticeWordAligner::ComputationState::OutputSilenceArc(
 
 
 bool LatticeWordAligner::ComputationState::OutputOnePhoneWordArc(
-    const WordBoundaryInfo &info, const TransitionModel &tmodel,
+    const WordBoundaryInfo &info, const CompiledWordBoundaryInfo &ctable,
     CompactLatticeArc *arc_out,  bool *error) {
   if (transition_ids_.empty()) return false;
   if (word_labels_.empty()) return false;
-  int32 phone = tmodel.TransitionIdToPhone(transition_ids_[0]);
-  if (info.TypeOfPhone(phone) != WordBoundaryInfo::kWordBeginAndEndPhone)
-    return false;  
+  if (ctable.TypeOfTid(transition_ids_[0]) != WordBoundaryInfo::kWordBeginAndEndPhone)
+    return false;
+  int32 phone = ctable.Phone(transition_ids_[0]);
   // we assume the start of transition_ids_ is the start of the phone.
   // this is a precondition.
   size_t len = transition_ids_.size(), i;
   for (i = 1; i < len; i++) {
     int32 tid = transition_ids_[i];
-    int32 this_phone = tmodel.TransitionIdToPhone(tid);
+    int32 this_phone = ctable.Phone(tid);
     if (this_phone != phone && ! *error) { // error condition: should have reached final transition-id first.
       KALDI_WARN << "Phone changed before final transition-id found "
           "[broken lattice or mismatched model or wrong --reorder option?]";
       // just continue, ignoring this-- we'll probably output something...
     }
-    if (tmodel.IsFinal(tid))
+    if (ctable.IsFinal(tid))
       break;
   }
   if (i == len) return false; // fell off loop.
   i++; // go past the one for which IsFinal returned true.
   if (info.reorder) // we have to consume the following self-loop transition-ids.
-    while (i < len && tmodel.IsSelfLoop(transition_ids_[i])) i++;
+    while (i < len && ctable.IsSelfLoop(transition_ids_[i])) i++;
   if (i == len) return false; // we don't know if it ends here... so can't output arc.
   
-  if (tmodel.TransitionIdToPhone(transition_ids_[i-1]) != phone
+  if (ctable.Phone(transition_ids_[i-1]) != phone
       && ! *error) { // another check.
     KALDI_WARN << "Phone changed unexpectedly in lattice "
         "[broken lattice or mismatched model?]";
@@ -441,13 +442,13 @@ bool LatticeWordAligner::ComputationState::OutputOnePhoneWordArc(
 /// This function tries to see if it can output a normal word arc--
 /// one with at least two phones in it.
 bool LatticeWordAligner::ComputationState::OutputNormalWordArc(
-    const WordBoundaryInfo &info, const TransitionModel &tmodel,
+    const WordBoundaryInfo &info, const CompiledWordBoundaryInfo &ctable,
     CompactLatticeArc *arc_out,  bool *error) {
   if (transition_ids_.empty()) return false;
   if (word_labels_.empty()) return false;
-  int32 begin_phone = tmodel.TransitionIdToPhone(transition_ids_[0]);
-  if (info.TypeOfPhone(begin_phone) != WordBoundaryInfo::kWordBeginPhone)
-    return false;  
+  if (ctable.TypeOfTid(transition_ids_[0]) != WordBoundaryInfo::kWordBeginPhone)
+    return false;
+  int32 begin_phone = ctable.Phone(transition_ids_[0]);
   // we assume the start of transition_ids_ is the start of the phone.
   // this is a precondition.
   size_t len = transition_ids_.size(), i;
@@ -455,13 +456,13 @@ bool LatticeWordAligner::ComputationState::OutputNormalWordArc(
   // Eat up the transition-ids of this word-begin phone until we get to the
   // "final" transition-id.  [there may be self-loops following this though,
   // if reorder==true]
-  for (i = 0; i < len && !tmodel.IsFinal(transition_ids_[i]); i++);
+  for (i = 0; i < len && !ctable.IsFinal(transition_ids_[i]); i++);
   if (i == len) return false;
   i++; // Skip over this final-transition.
   if (info.reorder) // Skip over any reordered self-loops for this final-transition
-    for (; i < len && tmodel.IsSelfLoop(transition_ids_[i]); i++);
+    for (; i < len && ctable.IsSelfLoop(transition_ids_[i]); i++);
   if (i == len) return false;
-  if (tmodel.TransitionIdToPhone(transition_ids_[i-1]) != begin_phone
+  if (ctable.Phone(transition_ids_[i-1]) != begin_phone
       && ! *error) { // another check.
     KALDI_WARN << "Phone changed unexpectedly in lattice "
         "[broken lattice or mismatched model?]";
@@ -472,12 +473,12 @@ bool LatticeWordAligner::ComputationState::OutputNormalWordArc(
   // here, but we'll just print a warning if we get something
   // else.
   for (; i < len; i++) {
-    int32 this_phone = tmodel.TransitionIdToPhone(transition_ids_[i]);
-    if (info.TypeOfPhone(this_phone) == WordBoundaryInfo::kWordEndPhone)
+    WordBoundaryInfo::PhoneType this_type = ctable.TypeOfTid(transition_ids_[i]);
+    if (this_type == WordBoundaryInfo::kWordEndPhone)
       break;
-    if (info.TypeOfPhone(this_phone) != WordBoundaryInfo::kWordInternalPhone
+    if (this_type != WordBoundaryInfo::kWordInternalPhone
         && !*error) {
-      KALDI_WARN << "Unexpected phone " << this_phone
+      KALDI_WARN << "Unexpected phone " << ctable.Phone(transition_ids_[i])
                  << " found inside a word.";
       *error = true;
     }
@@ -488,24 +489,24 @@ bool LatticeWordAligner::ComputationState::OutputNormalWordArc(
   // a "final-transition".
 
   // this variable just used for checks.
-  int32 final_phone = tmodel.TransitionIdToPhone(transition_ids_[i]); 
+  int32 final_phone = ctable.Phone(transition_ids_[i]); 
   for (; i < len; i++) {
-    int32 this_phone = tmodel.TransitionIdToPhone(transition_ids_[i]);
+    int32 this_phone = ctable.Phone(transition_ids_[i]);
     if (this_phone != final_phone && ! *error) {
       *error = true;
       KALDI_WARN << "Phone changed before final transition-id found "
           "[broken lattice or mismatched model or wrong --reorder option?]";
     }
-    if (tmodel.IsFinal(transition_ids_[i])) break;
+    if (ctable.IsFinal(transition_ids_[i])) break;
   }
   if (i == len) return false;
   i++;
   // We got to the final-transition of the final phone;
   // if reorder==true, continue eating up the self-loop.
   if (info.reorder == true)
-    while (i < len && tmodel.IsSelfLoop(transition_ids_[i])) i++;
+    while (i < len && ctable.IsSelfLoop(transition_ids_[i])) i++;
   if (i == len) return false;
-  if (tmodel.TransitionIdToPhone(transition_ids_[i-1]) != final_phone
+  if (ctable.Phone(transition_ids_[i-1]) != final_phone
       && ! *error) {
     *error = true;
     KALDI_WARN << "Phone changed while following final self-loop "
@@ -530,29 +531,29 @@ bool LatticeWordAligner::ComputationState::OutputNormalWordArc(
 // Returns true if this vector of transition-ids could be a valid
 // word.  Note: the checks are not 100% exhaustive.
 static bool IsPlausibleWord(const WordBoundaryInfo &info,
-                            const TransitionModel &tmodel,
+                            const CompiledWordBoundaryInfo &ctable,
                             const std::vector<int32> &transition_ids) {
   if (transition_ids.empty()) return false;
-  int32 first_phone = tmodel.TransitionIdToPhone(transition_ids.front()),
-      last_phone = tmodel.TransitionIdToPhone(transition_ids.back());
+  int32 first_phone = ctable.Phone(transition_ids.front()),
+      last_phone = ctable.Phone(transition_ids.back());
   if ( (info.TypeOfPhone(first_phone) == WordBoundaryInfo::kWordBeginAndEndPhone
         && first_phone == last_phone)
        ||
        (info.TypeOfPhone(first_phone) == WordBoundaryInfo::kWordBeginPhone &&
         info.TypeOfPhone(last_phone) == WordBoundaryInfo::kWordEndPhone) ) {
     if (! info.reorder) {
-      return (tmodel.IsFinal(transition_ids.back()));
+      return (ctable.IsFinal(transition_ids.back()));
     } else {
       int32 i = transition_ids.size() - 1;
-      while (i > 0 && tmodel.IsSelfLoop(transition_ids[i])) i--;
-      return tmodel.IsFinal(transition_ids[i]);
+      while (i > 0 && ctable.IsSelfLoop(transition_ids[i])) i--;
+      return ctable.IsFinal(transition_ids[i]);
     }
   } else return false;
 }
 
     
 void LatticeWordAligner::ComputationState::OutputArcForce(
-    const WordBoundaryInfo &info, const TransitionModel &tmodel,
+    const WordBoundaryInfo &info, const CompiledWordBoundaryInfo &ctable,
     CompactLatticeArc *arc_out,  bool *error) {
 
   KALDI_ASSERT(!IsEmpty());
@@ -562,7 +563,7 @@ void LatticeWordAligner::ComputationState::OutputArcForce(
     // and failed, so this means we didn't see the end of that
     // word. 
     int32 word = word_labels_[0];
-    if (! *error && !IsPlausibleWord(info, tmodel, transition_ids_)) {
+    if (! *error && !IsPlausibleWord(info, ctable, transition_ids_)) {
       *error = true;
       KALDI_WARN << "Invalid word at end of lattice [partial lattice, forced out?]";
     }
@@ -589,10 +590,10 @@ void LatticeWordAligner::ComputationState::OutputArcForce(
     word_labels_.clear();
   } else if (!transition_ids_.empty() && word_labels_.empty()) {
     // Transition-ids but no word label-- either silence or partial word.
-    int32 first_phone = tmodel.TransitionIdToPhone(transition_ids_[0]);
+    int32 first_phone = ctable.Phone(transition_ids_[0]);
     if (info.TypeOfPhone(first_phone) == WordBoundaryInfo::kNonWordPhone) {
       // first phone is silence...
-      if (first_phone != tmodel.TransitionIdToPhone(transition_ids_.back())
+      if (first_phone != ctable.Phone(transition_ids_.back())
           && ! *error) {
         *error = true;
         // Phone changed-- this is a code error, because the regular OutputArc
@@ -604,8 +605,8 @@ void LatticeWordAligner::ComputationState::OutputArcForce(
       if (!*error) { // Check that it ends at the end state of silence; error otherwise.
         int32 i = transition_ids_.size() - 1;
         if (info.reorder)
-          while(tmodel.IsSelfLoop(transition_ids_[i]) && i > 0) i--;
-        if (!tmodel.IsFinal(transition_ids_[i])) {
+          while(ctable.IsSelfLoop(transition_ids_[i]) && i > 0) i--;
+        if (!ctable.IsFinal(transition_ids_[i])) {
           *error = true;
           KALDI_WARN << "Broken silence arc at end of utterance (does not "
               "reach end of silence)";
@@ -708,12 +709,41 @@ void WordBoundaryInfo::Init(std::istream &stream) {
     KALDI_ERR << "Empty word-boundary file";
 }
   
+CompiledWordBoundaryInfo::CompiledWordBoundaryInfo(
+    const TransitionModel &tmodel, const WordBoundaryInfo &info) {
+  int32 num_tids = tmodel.NumTransitionIds();
+  phones_.resize(num_tids + 1);  // transition-ids are one-based.
+  codes_.resize(num_tids + 1);
+  phones_[0] = -1;
+  codes_[0] = kInvalidType;
+  for (int32 tid = 1; tid <= num_tids; tid++) {
+    int32 phone = tmodel.TransitionIdToPhone(tid);
+    phones_[tid] = phone;
+    int32 type = kInvalidType;
+    if (phone >= 0 && phone < static_cast<int32>(info.phone_to_type.size()))
+      type = static_cast<int32>(info.phone_to_type[phone]);
+    unsigned char code = static_cast<unsigned char>(type);
+    if (tmodel.IsFinal(tid)) code |= kFinalFlag;
+    if (tmodel.IsSelfLoop(tid)) code |= kSelfLoopFlag;
+    codes_[tid] = code;
+  }
+}
+
 bool WordAlignLattice(const CompactLattice &lat,
                       const TransitionModel &tmodel,
                       const WordBoundaryInfo &info,
                       int32 max_states,
                       CompactLattice *lat_out) {
-  LatticeWordAligner aligner(lat, tmodel, info, max_states, lat_out);
+  CompiledWordBoundaryInfo ctable(tmodel, info);
+  return WordAlignLattice(lat, ctable, info, max_states, lat_out);
+}
+
+bool WordAlignLattice(const CompactLattice &lat,
+                      const CompiledWordBoundaryInfo &ctable,
+                      const WordBoundaryInfo &info,
+                      int32 max_states,
+                      CompactLattice *lat_out) {
+  LatticeWordAligner aligner(lat, ctable, info, max_states, lat_out);
   return aligner.AlignLattice();
 }
 
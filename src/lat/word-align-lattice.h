@@ -168,6 +168,55 @@ struct WordBoundaryInfo {
   void SetOptions(const std::string int_list, PhoneType phone_type);
 };
 
+/// CompiledWordBoundaryInfo precomputes, for each transition-id, the
+/// quantities the word-alignment code looks up for every element of every
+/// arc's transition-id sequence: the phone, the word-boundary type of that
+/// phone, and whether the transition-id is "final" or a self-loop.  These
+/// are packed into flat arrays indexed by transition-id, so the inner loops
+/// of the aligner do a couple of array reads instead of several
+/// transition-model lookups plus a phone-type lookup.  It depends only on
+/// the model and the WordBoundaryInfo, so compile it once and reuse it for
+/// all the lattices in an archive.
+class CompiledWordBoundaryInfo {
+ public:
+  CompiledWordBoundaryInfo(const TransitionModel &tmodel,
+                           const WordBoundaryInfo &info);
+
+  /// Returns tmodel.TransitionIdToPhone(tid).
+  inline int32 Phone(int32 tid) const { return phones_[tid]; }
+
+  /// Returns info.TypeOfPhone(tmodel.TransitionIdToPhone(tid)).  Phones not
+  /// covered by the word-boundary info throw the same error TypeOfPhone()
+  /// would; the error is deferred to here (rather than thrown when
+  /// compiling) so that models containing phones absent from the
+  /// word-boundary file still work, as long as those phones do not appear
+  /// in the lattices.
+  inline WordBoundaryInfo::PhoneType TypeOfTid(int32 tid) const {
+    int32 type = codes_[tid] & kTypeMask;
+    if (type == kInvalidType)
+      KALDI_ERR << "Phone " << phones_[tid] << " was not specified in "
+          "word-boundary file (or options)";
+    return static_cast<WordBoundaryInfo::PhoneType>(type);
+  }
+
+  /// Returns tmodel.IsFinal(tid).
+  inline bool IsFinal(int32 tid) const {
+    return (codes_[tid] & kFinalFlag) != 0;
+  }
+
+  /// Returns tmodel.IsSelfLoop(tid).
+  inline bool IsSelfLoop(int32 tid) const {
+    return (codes_[tid] & kSelfLoopFlag) != 0;
+  }
+
+ private:
+  enum { kTypeMask = 7, kInvalidType = 7, kFinalFlag = 8, kSelfLoopFlag = 16 };
+
+  std::vector<int32> phones_;  // indexed by transition-id (one-based).
+  std::vector<unsigned char> codes_;  // packed phone-type and flags, indexed
+                                      // by transition-id.
+};
+
 /// Align lattice so that each arc has the transition-ids on it
 /// that correspond to the word that is on that arc.  [May also have
 /// epsilon arcs for optional silences.]
@@ -194,6 +243,17 @@ bool WordAlignLattice(const CompactLattice &lat,
                       int32 max_states,
                       CompactLattice *lat_out);
 
+/// This version takes a CompiledWordBoundaryInfo (built from the model and
+/// "info"), which is cheaper when aligning many lattices with the same model
+/// as the per-transition-id tables get compiled only once; prefer it when
+/// processing archives.  "info" is still needed for the labels and the
+/// reorder option.
+bool WordAlignLattice(const CompactLattice &lat,
+                      const CompiledWordBoundaryInfo &ctable,
+                      const WordBoundaryInfo &info,
+                      int32 max_states,
+                      CompactLattice *lat_out);
+
 
 
 /// This function is designed to crash if something went wrong with the
@@ -23,6 +23,89 @@
 #include "lat/kaldi-lattice.h"
 #include "lat/word-align-lattice.h"
 #include "lat/lattice-functions.h"
+#include "thread/kaldi-task-sequence.h"
+
+namespace kaldi {
+
+// Word-aligns one lattice; the alignment (and the top-sorting of the result)
+// runs in parallel in the worker threads of a TaskSequencer, and the
+// destructors, which write the outputs and update the counters, run in input
+// order on the main thread.
+class WordAlignLatticeTask {
+ public:
+  WordAlignLatticeTask(const std::string &key, const CompactLattice &clat,
+                       const TransitionModel &tmodel,
+                       const WordBoundaryInfo &info,
+                       const CompiledWordBoundaryInfo &ctable,
+                       BaseFloat max_expand, bool output_if_error,
+                       bool do_test, CompactLatticeWriter *clat_writer,
+                       int32 *num_done, int32 *num_err):
+      key_(key), clat_(clat), tmodel_(tmodel), info_(info), ctable_(ctable),
+      max_expand_(max_expand), output_if_error_(output_if_error),
+      do_test_(do_test), clat_writer_(clat_writer),
+      num_done_(num_done), num_err_(num_err), ok_(false) { }
+
+  void operator() () {  // runs in a worker thread.
+    int32 max_states;
+    if (max_expand_ > 0) max_states = 1000 + max_expand_ * clat_.NumStates();
+    else max_states = 0;
+
+    ok_ = WordAlignLattice(clat_, ctable_, info_, max_states, &aligned_clat_);
+
+    if (do_test_ && ok_)
+      TestWordAlignedLattice(clat_, tmodel_, info_, aligned_clat_);
+
+    // Top-sort here, on the worker thread, so the destructor only has to
+    // write the already-sorted lattice.
+    if (aligned_clat_.Start() != fst::kNoStateId)
+      TopSortCompactLatticeIfNeeded(&aligned_clat_);
+  }
+
+  ~WordAlignLatticeTask() {
+    if (!ok_) {
+      (*num_err_)++;
+      if (!output_if_error_)
+        KALDI_WARN << "Lattice for " << key_
+                   << " did not align correctly, producing no output.";
+      else {
+        if (aligned_clat_.Start() != fst::kNoStateId) {
+          KALDI_WARN << "Outputting partial lattice for " << key_;
+          clat_writer_->Write(key_, aligned_clat_);
+        } else {
+          KALDI_WARN << "Empty aligned lattice for " << key_
+                     << ", producing no output.";
+        }
+      }
+    } else {
+      if (aligned_clat_.Start() == fst::kNoStateId) {
+        (*num_err_)++;
+        KALDI_WARN << "Lattice was empty for key " << key_;
+      } else {
+        (*num_done_)++;
+        KALDI_VLOG(2) << "Aligned lattice for " << key_;
+        clat_writer_->Write(key_, aligned_clat_);
+      }
+    }
+  }
+
+ private:
+  std::string key_;
+  CompactLattice clat_;
+  const TransitionModel &tmodel_;
+  const WordBoundaryInfo &info_;
+  const CompiledWordBoundaryInfo &ctable_;
+  BaseFloat max_expand_;
+  bool output_if_error_;
+  bool do_test_;
+  CompactLattice aligned_clat_;  // The output of our process, written to
+                                 // *clat_writer_ in the destructor.
+  CompactLatticeWriter *clat_writer_;
+  int32 *num_done_;
+  int32 *num_err_;
+  bool ok_;
+};
+
+}  // namespace kaldi
 
 int main(int argc, char *argv[]) {
   try {
@@ -41,12 +124,13 @@ int main(int argc, char *argv[]) {
         "<integer-phone-id> [begin|end|singleton|internal|nonword]\n"
         "See also: lattice-align-words-lexicon, for use in cases where phones\n"
         "don't have word-position information.\n";
-    
+
     ParseOptions po(usage);
     BaseFloat max_expand = 0.0;
     bool output_if_error = true;
     bool do_test = false;
-    
+    TaskSequencerConfig sequencer_config;  // has --num-threads option.
+
     po.Register("output-error-lats", &output_if_error, "Output lattices that aligned "
                 "with errors (e.g. due to force-out");
     po.Register("test", &do_test, "Test the algorithm while running it.");
@@ -54,7 +138,8 @@ int main(int argc, char *argv[]) {
                 "program will expand lattices before refusing to continue.  E.g. 10."
                 "This can be used to prevent this program consuming excessive memory "
                 "if there is a mismatch on the command-line or a 'problem' lattice.");
-    
+    sequencer_config.Register(&po);
+
     WordBoundaryInfoNewOpts opts;
     opts.Register(&po);
 
@@ -73,54 +158,28 @@ int main(int argc, char *argv[]) {
 
     TransitionModel tmodel;
     ReadKaldiObject(model_rxfilename, &tmodel);
-    
+
     SequentialCompactLatticeReader clat_reader(lats_rspecifier);
-    CompactLatticeWriter clat_writer(lats_wspecifier); 
+    CompactLatticeWriter clat_writer(lats_wspecifier);
 
     WordBoundaryInfo info(opts, word_boundary_rxfilename);
-    
+
+    // Compile the per-transition-id tables once, up front; they are shared
+    // (read-only) by all the tasks.
+    CompiledWordBoundaryInfo ctable(tmodel, info);
+
     int32 num_done = 0, num_err = 0;
-    
-    for (; !clat_reader.Done(); clat_reader.Next()) {
-      std::string key = clat_reader.Key();
-      const CompactLattice &clat = clat_reader.Value();
-
-      CompactLattice aligned_clat;
-      int32 max_states;
-      if (max_expand > 0) max_states = 1000 + max_expand * clat.NumStates();
-      else max_states = 0;
-      
-      bool ok = WordAlignLattice(clat, tmodel, info, max_states, &aligned_clat);
-      
-      if (do_test && ok)
-        TestWordAlignedLattice(clat, tmodel, info, aligned_clat);
-
-      if (!ok) {
-        num_err++;
-        if (!output_if_error)
-          KALDI_WARN << "Lattice for " << key
-                     << " did not align correctly, producing no output.";
-        else {
-          if (aligned_clat.Start() != fst::kNoStateId) {
-            KALDI_WARN << "Outputting partial lattice for " << key;
-            TopSortCompactLatticeIfNeeded(&aligned_clat);
-            clat_writer.Write(key, aligned_clat);
-          } else {
-            KALDI_WARN << "Empty aligned lattice for " << key
-                       << ", producing no output.";
-          }
-        }
-      } else {
-        if (aligned_clat.Start() == fst::kNoStateId) {
-          num_err++;
-          KALDI_WARN << "Lattice was empty for key " << key;
-        } else {
-          num_done++;
-          KALDI_VLOG(2) << "Aligned lattice for " << key;
-          TopSortCompactLatticeIfNeeded(&aligned_clat);
-          clat_writer.Write(key, aligned_clat);
-        }
+
+    {
+      TaskSequencer<WordAlignLatticeTask> sequencer(sequencer_config);
+      for (; !clat_reader.Done(); clat_reader.Next()) {
+        sequencer.Run(new WordAlignLatticeTask(
+            clat_reader.Key(), clat_reader.Value(), tmodel, info, ctable,
+            max_expand, output_if_error, do_test, &clat_writer,
+            &num_done, &num_err));
+        clat_reader.FreeCurrent();
       }
+      // the sequencer's destructor waits for all the tasks to finish.
     }
     KALDI_LOG << "Successfully aligned " << num_done << " lattices; "
               << num_err << " had errors.";
@@ -0,0 +1,71 @@
+// latbin/lattice-compress.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "lat/kaldi-lattice.h"
+#include "lat/compressed-lattice.h"
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    typedef kaldi::int32 int32;
+
+    const char *usage =
+        "Compress lattices into the compact varint-coded format of\n"
+        "lat/compressed-lattice.h (lossy: the costs are quantized to the\n"
+        "given precision).  Use lattice-decompress to get regular lattices\n"
+        "back.\n"
+        "\n"
+        "Usage: lattice-compress [options] lattice-rspecifier "
+        "compressed-lattice-wspecifier\n"
+        " e.g.: lattice-compress ark:1.lats ark:1.clats.compressed\n";
+
+    ParseOptions po(usage);
+    BaseFloat precision = 1.0 / 1024.0;
+    po.Register("precision", &precision, "Quantization step of the graph and "
+                "acoustic costs, i.e. the maximum error compression "
+                "introduces into each cost.");
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 2) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string lats_rspecifier = po.GetArg(1),
+        compressed_wspecifier = po.GetArg(2);
+
+    SequentialCompactLatticeReader clat_reader(lats_rspecifier);
+    CompressedCompactLatticeWriter compressed_writer(compressed_wspecifier);
+
+    int32 n_done = 0;
+    for (; !clat_reader.Done(); clat_reader.Next()) {
+      CompressedCompactLattice compressed(clat_reader.Value(), precision);
+      compressed_writer.Write(clat_reader.Key(), compressed);
+      n_done++;
+    }
+    KALDI_LOG << "Compressed " << n_done << " lattices.";
+    return (n_done != 0 ? 0 : 1);
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
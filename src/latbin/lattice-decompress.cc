@@ -0,0 +1,91 @@
+// latbin/lattice-decompress.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "lat/kaldi-lattice.h"
+#include "lat/compressed-lattice.h"
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    typedef kaldi::int32 int32;
+
+    const char *usage =
+        "Decompress lattices written by lattice-compress back into regular\n"
+        "CompactLattice archives.  With --begin-frame/--end-frame set, only\n"
+        "the part of each lattice within that time range is extracted (see\n"
+        "CompressedCompactLattice::DecodeTimeRange() for the exact\n"
+        "semantics); lattices with no states in the range are skipped.\n"
+        "\n"
+        "Usage: lattice-decompress [options] compressed-lattice-rspecifier "
+        "lattice-wspecifier\n"
+        " e.g.: lattice-decompress ark:1.clats.compressed ark:1.lats\n";
+
+    ParseOptions po(usage);
+    int32 begin_frame = -1, end_frame = -1;
+    po.Register("begin-frame", &begin_frame, "If >= 0, extract only the part "
+                "of each lattice from this frame (requires --end-frame).");
+    po.Register("end-frame", &end_frame, "If >= 0, extract only the part of "
+                "each lattice up to this frame (requires --begin-frame).");
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 2) {
+      po.PrintUsage();
+      exit(1);
+    }
+    if ((begin_frame >= 0) != (end_frame >= 0) ||
+        (begin_frame >= 0 && end_frame < begin_frame))
+      KALDI_ERR << "--begin-frame and --end-frame must be set together, "
+                << "with begin <= end.";
+
+    std::string compressed_rspecifier = po.GetArg(1),
+        lats_wspecifier = po.GetArg(2);
+
+    SequentialCompressedCompactLatticeReader compressed_reader(
+        compressed_rspecifier);
+    CompactLatticeWriter clat_writer(lats_wspecifier);
+
+    int32 n_done = 0, n_empty = 0;
+    for (; !compressed_reader.Done(); compressed_reader.Next()) {
+      const CompressedCompactLattice &compressed = compressed_reader.Value();
+      CompactLattice clat;
+      if (begin_frame >= 0)
+        compressed.DecodeTimeRange(begin_frame, end_frame, &clat);
+      else
+        compressed.CopyToLattice(&clat);
+      if (begin_frame >= 0 && clat.NumStates() <= 1) {
+        n_empty++;  // nothing of this lattice is inside the time range.
+        continue;
+      }
+      clat_writer.Write(compressed_reader.Key(), clat);
+      n_done++;
+    }
+    if (begin_frame >= 0)
+      KALDI_LOG << "Decompressed " << n_done << " lattices, skipped "
+                << n_empty << " with nothing in the time range.";
+    else
+      KALDI_LOG << "Decompressed " << n_done << " lattices.";
+    return (n_done != 0 ? 0 : 1);
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
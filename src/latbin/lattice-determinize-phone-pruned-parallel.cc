@@ -25,66 +25,6 @@
 #include "util/common-utils.h"
 #include "thread/kaldi-task-sequence.h"
 
-namespace kaldi {
-
-class DeterminizeLatticeTask {
- public:
-  // Initializer takes ownership of "lat".
-  DeterminizeLatticeTask(
-      const TransitionModel &trans_model,
-      fst::DeterminizeLatticePhonePrunedOptions &opts,
-      std::string key,
-      BaseFloat acoustic_scale,
-      BaseFloat beam,
-      Lattice *lat,
-      CompactLatticeWriter *clat_writer,
-      int32 *num_warn):
-      trans_model_(&trans_model), opts_(opts), key_(key),
-      acoustic_scale_(acoustic_scale), beam_(beam),
-      lat_(lat), clat_writer_(clat_writer), num_warn_(num_warn) { }
-
-  void operator () () {
-    // We apply the acoustic scale before determinization and will undo it
-    // afterward, since it can affect the result.
-    fst::ScaleLattice(fst::AcousticLatticeScale(acoustic_scale_), lat_);
-
-    if (!DeterminizeLatticePhonePrunedWrapper(
-            *trans_model_, lat_, beam_, &det_clat_, opts_)) {
-      KALDI_WARN << "For key " << key_ << ", determinization did not succeed"
-          "(partial output will be pruned tighter than the specified beam.)";
-      (*num_warn_)++;
-    }
-
-    delete lat_;
-    lat_ = NULL;
-
-    // Invert the original acoustic scaling
-    fst::ScaleLattice(fst::AcousticLatticeScale(1.0/acoustic_scale_),
-                      &det_clat_);
-  }
-
-  ~DeterminizeLatticeTask() {
-    KALDI_VLOG(2) << "Wrote lattice with " << det_clat_.NumStates()
-                  << " for key " << key_;
-    clat_writer_->Write(key_, det_clat_);
-  }
- private:
-  const TransitionModel *trans_model_;
-  const fst::DeterminizeLatticePhonePrunedOptions &opts_;
-  std::string key_;
-  BaseFloat acoustic_scale_;
-  BaseFloat beam_;
-  // The lattice we're working on. Owned locally.
-  Lattice *lat_;
-  // The output of our process. Will be written to clat_writer_ in the
-  // destructor.
-  CompactLattice det_clat_;
-  CompactLatticeWriter *clat_writer_;
-  int32 *num_warn_;
-
-};
-
-} // namespace kaldi
 
 int main(int argc, char *argv[]) {
   try {
@@ -45,12 +45,18 @@ int main(int argc, char *argv[]) {
     ParseOptions po(usage);
     BaseFloat acoustic_scale = 1.0;
     BaseFloat beam = 10.0;
+    int32 num_threads = 1;
     fst::DeterminizeLatticePhonePrunedOptions opts;
     opts.max_mem = 50000000;
-    
+
     po.Register("acoustic-scale", &acoustic_scale, "Scaling factor for acoustic"
                 " likelihoods.");
     po.Register("beam", &beam, "Pruning beam [applied after acoustic scaling].");
+    po.Register("num-threads", &num_threads, "If >1, each lattice is split "
+                "at states that all paths pass through, and the pieces are "
+                "determinized in parallel with this many threads.  See also "
+                "lattice-determinize-phone-pruned-parallel, which instead "
+                "processes multiple lattices in parallel.");
     opts.Register(&po);
     po.Read(argc, argv);
 
@@ -88,8 +94,14 @@ int main(int argc, char *argv[]) {
       fst::ScaleLattice(fst::AcousticLatticeScale(acoustic_scale), &lat);
 
       CompactLattice det_clat;
-      if (!DeterminizeLatticePhonePrunedWrapper(
-              trans_model, &lat, beam, &det_clat, opts)) {
+      bool ok;
+      if (num_threads > 1)
+        ok = DeterminizeLatticePhonePrunedSegmented(
+            trans_model, &lat, beam, &det_clat, opts, num_threads);
+      else
+        ok = DeterminizeLatticePhonePrunedWrapper(
+            trans_model, &lat, beam, &det_clat, opts);
+      if (!ok) {
         KALDI_WARN << "For key " << key << ", determinization did not succeed"
             "(partial output will be pruned tighter than the specified beam.)";
         n_warn++;
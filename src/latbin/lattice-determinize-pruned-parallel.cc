@@ -25,73 +25,6 @@
 #include "lat/minimize-lattice.h"
 #include "thread/kaldi-task-sequence.h"
 
-namespace kaldi {
-
-class DeterminizeLatticeTask {
- public:
-  // Initializer takes ownership of "lat".
-  DeterminizeLatticeTask(
-      fst::DeterminizeLatticePrunedOptions &opts,
-      std::string key,
-      BaseFloat acoustic_scale,
-      BaseFloat beam,
-      bool minimize,
-      Lattice *lat,
-      CompactLatticeWriter *clat_writer,
-      int32 *num_warn):
-      opts_(opts), key_(key), acoustic_scale_(acoustic_scale), beam_(beam),
-      minimize_(minimize), lat_(lat), clat_writer_(clat_writer),
-      num_warn_(num_warn) { }
-
-  void operator () () {
-    Invert(lat_); // to get word labels on the input side.
-    // We apply the acoustic scale before determinization and will undo it
-    // afterward, since it can affect the result.
-    fst::ScaleLattice(fst::AcousticLatticeScale(acoustic_scale_), lat_);
-    if (!TopSort(lat_)) {
-      KALDI_WARN << "Could not topologically sort lattice: this probably means it"
-          " has bad properties e.g. epsilon cycles.  Your LM or lexicon might "
-          "be broken, e.g. LM with epsilon cycles or lexicon with empty words.";
-      (*num_warn_)++;
-    }
-    fst::ArcSort(lat_, fst::ILabelCompare<LatticeArc>());
-    if (!DeterminizeLatticePruned(*lat_, beam_, &det_clat_, opts_)) {
-      KALDI_WARN << "For key " << key_ << ", determinization did not succeed"
-          "(partial output will be pruned tighter than the specified beam.)";
-      (*num_warn_)++;
-    }
-    delete lat_; // This is no longer needed so we can delete it now;
-    lat_ = NULL;
-    if (minimize_) {
-      PushCompactLatticeStrings(&det_clat_);
-      PushCompactLatticeWeights(&det_clat_);
-      MinimizeCompactLattice(&det_clat_);
-    }
-    // Invert the original acoustic scaling
-    fst::ScaleLattice(fst::AcousticLatticeScale(1.0/acoustic_scale_),
-                      &det_clat_);
-  }
-  ~DeterminizeLatticeTask() {
-    KALDI_VLOG(2) << "Wrote lattice with " << det_clat_.NumStates()
-                  << " for key " << key_;
-    clat_writer_->Write(key_, det_clat_);
-  }
- private:
-  const fst::DeterminizeLatticePrunedOptions &opts_;
-  std::string key_;
-  BaseFloat acoustic_scale_;
-  BaseFloat beam_;
-  bool minimize_;
-  Lattice *lat_; // The lattice we're working on.  Owned locally.
-  CompactLattice det_clat_; // The output of our process.  Will be written
-  // to clat_writer_ in the destructor.
-  CompactLatticeWriter *clat_writer_;
-  int32 *num_warn_;
-
-};
-
-} // namespace kaldi
-
 
 int main(int argc, char *argv[]) {
   try {
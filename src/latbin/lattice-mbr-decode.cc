@@ -20,11 +20,76 @@
 #include "util/common-utils.h"
 #include "lat/sausages.h"
 #include "hmm/posterior.h"
+#include "thread/kaldi-task-sequence.h"
+
+namespace kaldi {
+
+// Runs the MBR computation for one utterance; the computations run in
+// parallel in the worker threads of a TaskSequencer, and the destructors,
+// which write the outputs and update the summary stats, run in input order
+// on the main thread.
+class MbrDecodeTask {
+ public:
+  MbrDecodeTask(const std::string &key, const CompactLattice &clat,
+                const std::vector<std::vector<double> > &scale,
+                const MinimumBayesRiskOptions &opts,
+                bool one_best_times,
+                Int32VectorWriter *trans_writer,
+                BaseFloatWriter *bayes_risk_writer,
+                PosteriorWriter *sausage_stats_writer,
+                BaseFloatPairVectorWriter *times_writer,
+                int32 *n_done, int64 *n_words, double *tot_bayes_risk):
+      key_(key), clat_(clat), scale_(scale), opts_(opts),
+      one_best_times_(one_best_times), trans_writer_(trans_writer),
+      bayes_risk_writer_(bayes_risk_writer),
+      sausage_stats_writer_(sausage_stats_writer),
+      times_writer_(times_writer), n_done_(n_done), n_words_(n_words),
+      tot_bayes_risk_(tot_bayes_risk), mbr_(NULL) { }
+
+  void operator() () {  // runs in a worker thread.
+    fst::ScaleLattice(scale_, &clat_);
+    mbr_ = new MinimumBayesRisk(clat_, opts_);
+  }
+
+  ~MbrDecodeTask() {
+    if (trans_writer_->IsOpen())
+      trans_writer_->Write(key_, mbr_->GetOneBest());
+    if (bayes_risk_writer_->IsOpen())
+      bayes_risk_writer_->Write(key_, mbr_->GetBayesRisk());
+    if (sausage_stats_writer_->IsOpen())
+      sausage_stats_writer_->Write(key_, mbr_->GetSausageStats());
+    if (times_writer_->IsOpen())
+      times_writer_->Write(key_, one_best_times_ ? mbr_->GetOneBestTimes() :
+                           mbr_->GetSausageTimes());
+    (*n_done_)++;
+    *n_words_ += mbr_->GetOneBest().size();
+    *tot_bayes_risk_ += mbr_->GetBayesRisk();
+    delete mbr_;
+  }
+
+ private:
+  std::string key_;
+  CompactLattice clat_;
+  const std::vector<std::vector<double> > &scale_;
+  const MinimumBayesRiskOptions &opts_;
+  bool one_best_times_;
+  Int32VectorWriter *trans_writer_;
+  BaseFloatWriter *bayes_risk_writer_;
+  PosteriorWriter *sausage_stats_writer_;
+  BaseFloatPairVectorWriter *times_writer_;
+  int32 *n_done_;
+  int64 *n_words_;
+  double *tot_bayes_risk_;
+  MinimumBayesRisk *mbr_;
+};
+
+}  // namespace kaldi
 
 int main(int argc, char *argv[]) {
   try {
     using namespace kaldi;
     typedef kaldi::int32 int32;
+    typedef kaldi::int64 int64;
 
     const char *usage =
         "Do Minimum Bayes Risk decoding (decoding that aims to minimize the \n"
@@ -45,11 +110,13 @@ int main(int argc, char *argv[]) {
         "[ sausage-stats-wspecifier [ times-wspecifier] ] ] \n"
         " e.g.: lattice-mbr-decode --acoustic-scale=0.1 ark:1.lats ark:1.tra "
         "ark:/dev/null ark:1.sau\n";
-    
+
     ParseOptions po(usage);
     BaseFloat acoustic_scale = 1.0;
     BaseFloat lm_scale = 1.0;
     bool one_best_times = false;
+    MinimumBayesRiskOptions mbr_opts;
+    TaskSequencerConfig sequencer_config;  // has --num-threads option.
 
     std::string word_syms_filename;
     po.Register("acoustic-scale", &acoustic_scale, "Scaling factor for "
@@ -60,7 +127,9 @@ int main(int argc, char *argv[]) {
                 "words [for debug output]");
     po.Register("one-best-times", &one_best_times, "If true, output times "
                 "corresponding to one-best, not whole sausage.");
-    
+    mbr_opts.Register(&po);
+    sequencer_config.Register(&po);
+
     po.Read(argc, argv);
 
     if (po.NumArgs() < 2 || po.NumArgs() > 5) {
@@ -73,7 +142,7 @@ int main(int argc, char *argv[]) {
         bayes_risk_wspecifier = po.GetOptArg(3),
         sausage_stats_wspecifier = po.GetOptArg(4),
         times_wspecifier = po.GetOptArg(5);
-    
+
     // Read as compact lattice.
     SequentialCompactLatticeReader clat_reader(lats_rspecifier);
 
@@ -84,44 +153,37 @@ int main(int argc, char *argv[]) {
     PosteriorWriter sausage_stats_writer(sausage_stats_wspecifier);
 
     BaseFloatPairVectorWriter times_writer(times_wspecifier);
-    
+
     fst::SymbolTable *word_syms = NULL;
-    if (word_syms_filename != "") 
+    if (word_syms_filename != "")
       if (!(word_syms = fst::SymbolTable::ReadText(word_syms_filename)))
         KALDI_ERR << "Could not read symbol table from file "
                    << word_syms_filename;
 
-    int32 n_done = 0, n_words = 0;
-    BaseFloat tot_bayes_risk = 0.0;
-    
-    for (; !clat_reader.Done(); clat_reader.Next()) {
-      std::string key = clat_reader.Key();
-      CompactLattice clat = clat_reader.Value();
-      clat_reader.FreeCurrent();
-      fst::ScaleLattice(fst::LatticeScale(lm_scale, acoustic_scale), &clat);
-
-      MinimumBayesRisk mbr(clat);
-
-      if (trans_wspecifier != "")
-        trans_writer.Write(key, mbr.GetOneBest());
-      if (bayes_risk_wspecifier != "")
-        bayes_risk_writer.Write(key, mbr.GetBayesRisk());
-      if (sausage_stats_wspecifier != "")
-        sausage_stats_writer.Write(key, mbr.GetSausageStats());
-      if (times_wspecifier != "")
-        times_writer.Write(key, one_best_times ? mbr.GetOneBestTimes() :
-                           mbr.GetSausageTimes());
-      
-      n_done++;
-      n_words += mbr.GetOneBest().size();
-      tot_bayes_risk += mbr.GetBayesRisk();
+    int32 n_done = 0;
+    int64 n_words = 0;
+    double tot_bayes_risk = 0.0;
+    std::vector<std::vector<double> > scale =
+        fst::LatticeScale(lm_scale, acoustic_scale);
+
+    {
+      TaskSequencer<MbrDecodeTask> sequencer(sequencer_config);
+      for (; !clat_reader.Done(); clat_reader.Next()) {
+        sequencer.Run(new MbrDecodeTask(
+            clat_reader.Key(), clat_reader.Value(), scale, mbr_opts,
+            one_best_times, &trans_writer, &bayes_risk_writer,
+            &sausage_stats_writer, &times_writer,
+            &n_done, &n_words, &tot_bayes_risk));
+        clat_reader.FreeCurrent();
+      }
+      sequencer.Wait();
     }
 
     KALDI_LOG << "Done " << n_done << " lattices.";
     KALDI_LOG << "Average Bayes Risk per sentence is "
               << (tot_bayes_risk / n_done) << " and per word, "
               << (tot_bayes_risk / n_words);
-    
+
     delete word_syms;
     return (n_done != 0 ? 0 : 1);
   } catch(const std::exception &e) {
@@ -24,8 +24,49 @@
 #include "lat/kaldi-lattice.h"
 #include "lat/minimize-lattice.h"
 #include "lat/push-lattice.h"
+#include "thread/kaldi-parallel-table-driver.h"
+
+namespace kaldi {
+
+// Mapper for ParallelTableDriver: pushes and minimizes one lattice.  Called
+// concurrently from worker threads; touches only its own lattice, so needs
+// no locking.
+class MinimizeLatticeMapper {
+ public:
+  MinimizeLatticeMapper(bool push_strings, bool push_weights):
+      push_strings_(push_strings), push_weights_(push_weights) { }
+
+  bool operator()(const std::string &key, CompactLattice *clat,
+                  CompactLattice *clat_out) {
+    if (push_strings_ && !PushCompactLatticeStrings(clat)) {
+      KALDI_WARN << "Failure in pushing lattice strings (bad lattice?), "
+                 << "for key " << key;
+      return false;
+    }
+    if (push_weights_ && !PushCompactLatticeWeights(clat)) {
+      KALDI_WARN << "Failure in pushing lattice weights (bad lattice?),"
+                 << "for key " << key;
+      return false;
+    }
+    if (!MinimizeCompactLattice(clat)) {
+      KALDI_WARN << "Failure in minimizing lattice (bad lattice?),"
+                 << "for key " << key;
+      return false;
+    }
+    if (clat->NumStates() == 0) {
+      KALDI_WARN << "Empty lattice for key " << key;
+      return false;
+    }
+    *clat_out = *clat;
+    return true;
+  }
 
+ private:
+  bool push_strings_;
+  bool push_weights_;
+};
 
+}  // namespace kaldi
 
 int main(int argc, char *argv[]) {
   try {
@@ -48,12 +89,14 @@ int main(int argc, char *argv[]) {
 
     bool push_strings = true;
     bool push_weights = true;
+    TaskSequencerConfig sequencer_config;  // has --num-threads option.
 
     po.Register("push-strings", &push_strings, "If true, push the strings in the "
                 "lattice to the start.");
     po.Register("push-weights", &push_weights, "If true, push the weights in the "
                 "lattice to the start.");
-    
+    sequencer_config.Register(&po);
+
     po.Read(argc, argv);
 
     if (po.NumArgs() != 2) {
@@ -65,44 +108,14 @@ int main(int argc, char *argv[]) {
         lats_wspecifier = po.GetArg(2);
 
 
-    SequentialCompactLatticeReader clat_reader(lats_rspecifier);
-    CompactLatticeWriter clat_writer(lats_wspecifier); 
-
-    int32 n_done = 0, n_err = 0;
-
-    
-    for (; !clat_reader.Done(); clat_reader.Next()) {
-      std::string key = clat_reader.Key();
-      CompactLattice clat = clat_reader.Value();
-      KALDI_VLOG(1) << "Processing lattice for utterance " << key;
-      if (push_strings && !PushCompactLatticeStrings(&clat)) {
-        KALDI_WARN << "Failure in pushing lattice strings (bad lattice?), "
-                   << "for key " << key;
-        n_err++;
-        continue;
-      }
-      if (push_weights && !PushCompactLatticeWeights(&clat)) {
-        KALDI_WARN << "Failure in pushing lattice weights (bad lattice?),"
-                   << "for key " << key ;           
-        n_err++;
-        continue;
-      }
-      if (!MinimizeCompactLattice(&clat)) {
-        KALDI_WARN << "Failure in minimizing lattice (bad lattice?),"
-                   << "for key " << key ;           
-        n_err++;
-        continue;
-      }
-      if (clat.NumStates() == 0) {
-        KALDI_WARN << "Empty lattice for key " << key;
-        n_err++;
-        continue;
-      }
-      clat_writer.Write(key, clat);
-      n_done++;
-    }
-    KALDI_LOG << "Minimized " << n_done << " lattices, errors on " << n_err;
-    return (n_done != 0 ? 0 : 1);
+    MinimizeLatticeMapper mapper(push_strings, push_weights);
+    ParallelTableDriver<CompactLatticeHolder, CompactLatticeHolder,
+        MinimizeLatticeMapper> driver(sequencer_config, &mapper,
+                                      lats_rspecifier, lats_wspecifier);
+    driver.Run();
+    KALDI_LOG << "Minimized " << driver.NumDone() << " lattices, errors on "
+              << driver.NumSkipped();
+    return (driver.NumDone() != 0 ? 0 : 1);
   } catch(const std::exception &e) {
     std::cerr << e.what();
     return -1;
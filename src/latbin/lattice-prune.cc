@@ -24,6 +24,61 @@
 #include "fstext/fstext-lib.h"
 #include "lat/kaldi-lattice.h"
 #include "lat/lattice-functions.h"
+#include "thread/kaldi-mutex.h"
+#include "thread/kaldi-parallel-table-driver.h"
+
+namespace kaldi {
+
+// Mapper for ParallelTableDriver: prunes one lattice.  operator() is
+// called concurrently from worker threads, so the statistics are
+// accumulated under a mutex.
+class PruneLatticeMapper {
+ public:
+  PruneLatticeMapper(BaseFloat acoustic_scale, BaseFloat beam):
+      acoustic_scale_(acoustic_scale), beam_(beam), n_err_(0),
+      n_arcs_in_(0), n_arcs_out_(0), n_states_in_(0), n_states_out_(0) { }
+
+  bool operator()(const std::string &key, CompactLattice *clat,
+                  CompactLattice *pruned_clat) {
+    fst::ScaleLattice(fst::AcousticLatticeScale(acoustic_scale_), clat);
+    int64 narcs = NumArcs(*clat), nstates = clat->NumStates();
+    *pruned_clat = *clat;
+    bool prune_ok = PruneLattice(beam_, pruned_clat);
+    if (!prune_ok)
+      KALDI_WARN << "Error pruning lattice for utterance " << key;
+    int64 pruned_narcs = NumArcs(*pruned_clat),
+        pruned_nstates = pruned_clat->NumStates();
+    KALDI_LOG << "For utterance " << key << ", pruned #states from "
+              << nstates << " to " << pruned_nstates << " and #arcs from "
+              << narcs << " to " << pruned_narcs;
+    fst::ScaleLattice(fst::AcousticLatticeScale(1.0 / acoustic_scale_),
+                      pruned_clat);
+    stats_mutex_.Lock();
+    if (!prune_ok) n_err_++;
+    n_arcs_in_ += narcs;
+    n_states_in_ += nstates;
+    n_arcs_out_ += pruned_narcs;
+    n_states_out_ += pruned_nstates;
+    stats_mutex_.Unlock();
+    return true;  // as before, we write the lattice even if pruning had
+                  // an error (it may just not have been fully pruned).
+  }
+
+  int32 NumErr() const { return n_err_; }
+  int64 NumArcsIn() const { return n_arcs_in_; }
+  int64 NumArcsOut() const { return n_arcs_out_; }
+  int64 NumStatesIn() const { return n_states_in_; }
+  int64 NumStatesOut() const { return n_states_out_; }
+
+ private:
+  BaseFloat acoustic_scale_;
+  BaseFloat beam_;
+  Mutex stats_mutex_;
+  int32 n_err_;
+  int64 n_arcs_in_, n_arcs_out_, n_states_in_, n_states_out_;
+};
+
+}  // namespace kaldi
 
 int main(int argc, char *argv[]) {
   try {
@@ -43,12 +98,14 @@ int main(int argc, char *argv[]) {
     BaseFloat acoustic_scale = 1.0;
     BaseFloat inv_acoustic_scale = 1.0;
     BaseFloat beam = 10.0;
-    
+    TaskSequencerConfig sequencer_config;  // has --num-threads option.
+
     po.Register("acoustic-scale", &acoustic_scale, "Scaling factor for acoustic likelihoods");
     po.Register("inv-acoustic-scale", &inv_acoustic_scale, "An alternative way of setting the "
                 "acoustic scale: you can set its inverse.");
     po.Register("beam", &beam, "Pruning beam [applied after acoustic scaling]");
-    
+    sequencer_config.Register(&po);
+
     po.Read(argc, argv);
 
     if (po.NumArgs() != 2) {
@@ -65,47 +122,24 @@ int main(int argc, char *argv[]) {
 
 
     
-    SequentialCompactLatticeReader compact_lattice_reader(lats_rspecifier);
-    CompactLatticeWriter compact_lattice_writer(lats_wspecifier); 
-
-    int32 n_done = 0, n_err = 0;
-    int64 n_arcs_in = 0, n_arcs_out = 0,
-        n_states_in = 0, n_states_out = 0;
-
     if (acoustic_scale == 0.0)
       KALDI_ERR << "Do not use a zero acoustic scale (cannot be inverted)";
-    
-    for (; !compact_lattice_reader.Done(); compact_lattice_reader.Next()) {
-      std::string key = compact_lattice_reader.Key();
-      CompactLattice clat = compact_lattice_reader.Value();
-      compact_lattice_reader.FreeCurrent();
-      fst::ScaleLattice(fst::AcousticLatticeScale(acoustic_scale), &clat);
-      int64 narcs = NumArcs(clat), nstates = clat.NumStates();
-      n_arcs_in += narcs;
-      n_states_in += nstates;
-      CompactLattice pruned_clat(clat);
-      if (!PruneLattice(beam, &pruned_clat)) {
-        KALDI_WARN << "Error pruning lattice for utterance " << key;
-        n_err++;
-      }
-      int64 pruned_narcs = NumArcs(pruned_clat),          
-          pruned_nstates = pruned_clat.NumStates();
-      n_arcs_out += pruned_narcs;
-      n_states_out += pruned_nstates;
-      KALDI_LOG << "For utterance " << key << ", pruned #states from "
-                << nstates << " to " << pruned_nstates << " and #arcs from "
-                << narcs << " to " << pruned_narcs;
-      fst::ScaleLattice(fst::AcousticLatticeScale(1.0/acoustic_scale), &pruned_clat);
-      compact_lattice_writer.Write(key, pruned_clat);
-      n_done++;
-    }
 
+    PruneLatticeMapper mapper(acoustic_scale, beam);
+    ParallelTableDriver<CompactLatticeHolder, CompactLatticeHolder,
+        PruneLatticeMapper> driver(sequencer_config, &mapper,
+                                   lats_rspecifier, lats_wspecifier);
+    driver.Run();
+
+    int64 n_done = driver.NumDone();
     BaseFloat den = (n_done > 0 ? static_cast<BaseFloat>(n_done) : 1.0);
-    KALDI_LOG << "Overall, pruned from on average " << (n_states_in/den) << " to "
-              << (n_states_out/den) << " states, and from " << (n_arcs_in/den)
-              << " to " << (n_arcs_out/den) << " arcs, over " << n_done
-              << " utterances.";
-    KALDI_LOG << "Done " << n_done << " lattices.";
+    KALDI_LOG << "Overall, pruned from on average "
+              << (mapper.NumStatesIn()/den) << " to "
+              << (mapper.NumStatesOut()/den) << " states, and from "
+              << (mapper.NumArcsIn()/den) << " to " << (mapper.NumArcsOut()/den)
+              << " arcs, over " << n_done << " utterances.";
+    KALDI_LOG << "Done " << n_done << " lattices, had errors on "
+              << mapper.NumErr() << " of these.";
     return (n_done != 0 ? 0 : 1);
   } catch(const std::exception &e) {
     std::cerr << e.what();
@@ -0,0 +1,91 @@
+// latbin/lattice-to-constrained-fst.cc
+
+// Copyright 2015   Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "fstext/fstext-lib.h"
+#include "lat/kaldi-lattice.h"
+#include "lat/lattice-functions.h"
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    typedef kaldi::int32 int32;
+    using fst::VectorFst;
+    using fst::StdArc;
+
+    const char *usage =
+        "Convert first-pass lattices into per-utterance decoding graphs\n"
+        "for lattice-constrained second-pass decoding: transition-ids on\n"
+        "the input side (one per frame), words on the output side, and\n"
+        "the lattice's graph/LM cost on the arcs.  Decoding these graphs\n"
+        "with a bigger acoustic model (e.g. with gmm-latgen-faster over\n"
+        "an fsts-rspecifier) only explores first-pass-plausible paths,\n"
+        "which is far faster than re-decoding HCLG.  The lattices must\n"
+        "have alignments.\n"
+        "Usage: lattice-to-constrained-fst [options] <lattice-rspecifier>"
+        " <fsts-wspecifier>\n"
+        " e.g.: lattice-to-constrained-fst ark:1.lats ark:1.fsts\n";
+
+    BaseFloat old_acoustic_scale = 0.0;
+
+    ParseOptions po(usage);
+    po.Register("old-acoustic-scale", &old_acoustic_scale, "Add the "
+                "lattice's old acoustic scores to the graph cost with this "
+                "scale (the default drops them, so the second pass "
+                "supplies all acoustics).");
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 2) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string lats_rspecifier = po.GetArg(1),
+        fsts_wspecifier = po.GetArg(2);
+
+    SequentialCompactLatticeReader lattice_reader(lats_rspecifier);
+    TableWriter<fst::VectorFstHolder> fst_writer(fsts_wspecifier);
+
+    int32 n_done = 0, n_fail = 0;
+
+    for (; !lattice_reader.Done(); lattice_reader.Next()) {
+      std::string key = lattice_reader.Key();
+      const CompactLattice &clat = lattice_reader.Value();
+      VectorFst<StdArc> fst;
+      CompactLatticeToConstrainedFst(clat, old_acoustic_scale, &fst);
+      lattice_reader.FreeCurrent();
+      if (fst.Start() == fst::kNoStateId) {
+        KALDI_WARN << "Empty lattice for utterance " << key;
+        n_fail++;
+        continue;
+      }
+      fst_writer.Write(key, fst);
+      n_done++;
+    }
+    KALDI_LOG << "Converted " << n_done << " lattices to constrained "
+              << "decoding graphs; " << n_fail << " failed.";
+    return (n_done != 0 ? 0 : 1);
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
@@ -22,7 +22,17 @@
 #include <sstream>
 #include <utility>
 
+#if !defined(_MSC_VER)
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #include "lm/const-arpa-lm.h"
+#include "util/shared-memory-io.h"
 #include "util/stl-utils.h"
 #include "util/text-utils.h"
 #include "base/kaldi-math.h"
@@ -648,17 +658,32 @@ void ConstArpaLm::Write(std::ostream &os, bool binary) const {
     KALDI_ERR << "text-mode writing is not implemented for ConstArpaLm.";
   }
 
+  WriteToken(os, binary, "<ConstArpaLm>");
+
   // Misc info.
   WriteBasicType(os, binary, bos_symbol_);
   WriteBasicType(os, binary, eos_symbol_);
   WriteBasicType(os, binary, unk_symbol_);
   WriteBasicType(os, binary, ngram_order_);
 
-  // LmStates section.
+  // LmStates section. We write the entire <lm_states_> array in one block, so
+  // that ReadMemoryMapped() can map it straight from the file. A few zero
+  // bytes of padding keep the block 4-byte aligned in the file (when <os> is
+  // seekable so that we know the current file offset); we record the number
+  // of padding bytes so that readers on non-seekable streams can skip them.
   WriteBasicType(os, binary, lm_states_size_);
-  for (int32 i = 0; i < lm_states_size_; ++i) {
-    WriteBasicType(os, binary, lm_states_[i]);
-  }
+  int64 pos = static_cast<int64>(os.tellp());
+  char num_pad = 0;
+  if (pos >= 0)
+    num_pad = static_cast<char>((sizeof(int32) - (pos + 1) % sizeof(int32))
+                                % sizeof(int32));
+  os.put(num_pad);
+  for (char i = 0; i < num_pad; ++i)
+    os.put('\0');
+  os.write(reinterpret_cast<const char*>(lm_states_),
+           static_cast<std::streamsize>(lm_states_size_) * sizeof(int32));
+  if (!os.good())
+    KALDI_ERR << "ConstArpaLm: failed writing <lm_states_> section.";
 
   // Unigram section. We write memory offset to disk instead of the absolute
   // pointers.
@@ -697,19 +722,58 @@ void ConstArpaLm::Read(std::istream &is, bool binary) {
     KALDI_ERR << "text-mode reading is not implemented for ConstArpaLm.";
   }
 
-  // Misc info.
-  ReadBasicType(is, binary, &bos_symbol_);
-  ReadBasicType(is, binary, &eos_symbol_);
-  ReadBasicType(is, binary, &unk_symbol_);
-  ReadBasicType(is, binary, &ngram_order_);
+  if (is.peek() == '<') {
+    // Newer format, written by the current Write(): the <lm_states_> array is
+    // stored as one contiguous, aligned block.
+    ExpectToken(is, binary, "<ConstArpaLm>");
+
+    // Misc info.
+    ReadBasicType(is, binary, &bos_symbol_);
+    ReadBasicType(is, binary, &eos_symbol_);
+    ReadBasicType(is, binary, &unk_symbol_);
+    ReadBasicType(is, binary, &ngram_order_);
+
+    // LmStates section.
+    ReadBasicType(is, binary, &lm_states_size_);
+    char num_pad = 0;
+    is.read(&num_pad, 1);
+    is.ignore(num_pad);
+    lm_states_ = new int32[lm_states_size_];
+    is.read(reinterpret_cast<char*>(lm_states_),
+            static_cast<std::streamsize>(lm_states_size_) * sizeof(int32));
+    if (!is.good())
+      KALDI_ERR << "ConstArpaLm: failed reading <lm_states_> section.";
+  } else {
+    // Older format: every element of <lm_states_> was written individually
+    // with WriteBasicType().
 
-  // LmStates section.
-  ReadBasicType(is, binary, &lm_states_size_);
-  lm_states_ = new int32[lm_states_size_];
-  for (int32 i = 0; i < lm_states_size_; ++i) {
-    ReadBasicType(is, binary, &lm_states_[i]);
+    // Misc info.
+    ReadBasicType(is, binary, &bos_symbol_);
+    ReadBasicType(is, binary, &eos_symbol_);
+    ReadBasicType(is, binary, &unk_symbol_);
+    ReadBasicType(is, binary, &ngram_order_);
+
+    // LmStates section.
+    ReadBasicType(is, binary, &lm_states_size_);
+    lm_states_ = new int32[lm_states_size_];
+    for (int32 i = 0; i < lm_states_size_; ++i) {
+      ReadBasicType(is, binary, &lm_states_[i]);
+    }
   }
 
+  ReadPointerTables(is, binary);
+
+  KALDI_ASSERT(ngram_order_ > 0);
+  KALDI_ASSERT(bos_symbol_ < num_words_ && bos_symbol_ > 0);
+  KALDI_ASSERT(eos_symbol_ < num_words_ && eos_symbol_ > 0);
+  KALDI_ASSERT(unk_symbol_ < num_words_ &&
+               (unk_symbol_ > 0 || unk_symbol_ == -1));
+  lm_states_end_ = lm_states_ + lm_states_size_ - 1;
+  memory_assigned_ = true;
+  initialized_ = true;
+}
+
+void ConstArpaLm::ReadPointerTables(std::istream &is, bool binary) {
   // Unigram section. We write memory offset to disk instead of the absolute
   // pointers.
   ReadBasicType(is, binary, &num_words_);
@@ -733,14 +797,107 @@ void ConstArpaLm::Read(std::istream &is, bool binary) {
     overflow_buffer_[i] =
         (tmp_address == 0) ? NULL : lm_states_ + tmp_address - 1;
   }
+}
+
+void ConstArpaLm::ReadMemoryMapped(const std::string &rxfilename) {
+#if !defined(_MSC_VER)
+  KALDI_ASSERT(!initialized_);
+  int fd = open(rxfilename.c_str(), O_RDONLY);
+  if (fd == -1)
+    KALDI_ERR << "ConstArpaLm: failed opening " << rxfilename << ": "
+              << strerror(errno);
+  struct stat statbuf;
+  if (fstat(fd, &statbuf) == -1 || !S_ISREG(statbuf.st_mode)) {
+    close(fd);
+    KALDI_ERR << "ConstArpaLm: " << rxfilename << " is not a regular file; "
+              << "memory mapping requires one (no pipes or stdin).";
+  }
+  size_t file_size = static_cast<size_t>(statbuf.st_size);
+  void *data = mmap(NULL, file_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);  // The mapping stays valid after closing the descriptor.
+  if (data == MAP_FAILED)
+    KALDI_ERR << "ConstArpaLm: failed memory-mapping " << rxfilename << ": "
+              << strerror(errno);
+  const char *base = reinterpret_cast<const char*>(data);
+
+  // Kaldi binary-mode files start with the two-byte marker "\0B".
+  if (file_size < 2 || base[0] != '\0' || base[1] != 'B') {
+    munmap(data, file_size);
+    KALDI_ERR << "ConstArpaLm: " << rxfilename
+              << " is not a Kaldi binary-mode file.";
+  }
+  MemoryInputBuffer buffer(base + 2, file_size - 2);
+  std::istream is(&buffer);
+  bool binary = true;
+
+  if (is.peek() != '<') {
+    // Older format: <lm_states_> is not stored contiguously, so it cannot be
+    // mapped. Fall back to the regular reading code.
+    munmap(data, file_size);
+    KALDI_WARN << "ConstArpaLm model " << rxfilename << " is in the older "
+               << "format, which cannot be memory-mapped; reading it into "
+               << "memory instead. Re-write the model with current tools to "
+               << "enable memory mapping.";
+    bool binary_in;
+    Input ki(rxfilename, &binary_in);
+    Read(ki.Stream(), binary_in);
+    return;
+  }
+  ExpectToken(is, binary, "<ConstArpaLm>");
+
+  // Misc info.
+  ReadBasicType(is, binary, &bos_symbol_);
+  ReadBasicType(is, binary, &eos_symbol_);
+  ReadBasicType(is, binary, &unk_symbol_);
+  ReadBasicType(is, binary, &ngram_order_);
+
+  // LmStates section: point straight into the mapping, and skip over the
+  // block in the stream.
+  ReadBasicType(is, binary, &lm_states_size_);
+  char num_pad = 0;
+  is.read(&num_pad, 1);
+  is.ignore(num_pad);
+  int64 blob_offset = 2 + static_cast<int64>(is.tellg());
+  if (blob_offset % sizeof(int32) != 0) {
+    // Write() pads the block to a 4-byte file offset; this can only happen
+    // if the model was written to a non-seekable stream.
+    munmap(data, file_size);
+    KALDI_ERR << "ConstArpaLm: <lm_states_> block in " << rxfilename
+              << " is misaligned; re-write the model to a regular file to "
+              << "enable memory mapping.";
+  }
+  lm_states_ = reinterpret_cast<int32*>(const_cast<char*>(base + blob_offset));
+  is.seekg(static_cast<std::streamoff>(lm_states_size_) * sizeof(int32),
+           std::ios_base::cur);
+  if (!is.good()) {
+    munmap(data, file_size);
+    KALDI_ERR << "ConstArpaLm: " << rxfilename << " is truncated.";
+  }
+
+  ReadPointerTables(is, binary);
+
   KALDI_ASSERT(ngram_order_ > 0);
   KALDI_ASSERT(bos_symbol_ < num_words_ && bos_symbol_ > 0);
   KALDI_ASSERT(eos_symbol_ < num_words_ && eos_symbol_ > 0);
   KALDI_ASSERT(unk_symbol_ < num_words_ &&
                (unk_symbol_ > 0 || unk_symbol_ == -1));
   lm_states_end_ = lm_states_ + lm_states_size_ - 1;
+  mmap_data_ = data;
+  mmap_size_ = file_size;
   memory_assigned_ = true;
   initialized_ = true;
+#else
+  KALDI_ERR << "ConstArpaLm::ReadMemoryMapped() is not supported on Windows.";
+#endif
+}
+
+void ConstArpaLm::Unmap() {
+#if !defined(_MSC_VER)
+  if (munmap(mmap_data_, mmap_size_) != 0)
+    KALDI_WARN << "ConstArpaLm: munmap() failed: " << strerror(errno);
+  mmap_data_ = NULL;
+  mmap_size_ = 0;
+#endif
 }
 
 bool ConstArpaLm::HistoryStateExists(const std::vector<int32>& hist) const {
@@ -1042,6 +1199,14 @@ ConstArpaLmDeterministicFst::ConstArpaLmDeterministicFst(
   state_to_wseq_.push_back(bos_state);
   wseq_to_state_[bos_state] = 0;
   start_state_ = 0;
+
+  // Preallocates the lookup cache, with all entries marked unused.
+  CacheEntry unused_entry;
+  unused_entry.state = fst::kNoStateId;
+  unused_entry.word = 0;
+  unused_entry.logprob = 0.0f;
+  unused_entry.next_state = fst::kNoStateId;
+  cache_.resize(kCacheSize, unused_entry);
 }
 
 fst::StdArc::Weight ConstArpaLmDeterministicFst::Final(StateId s) {
@@ -1052,8 +1217,83 @@ fst::StdArc::Weight ConstArpaLmDeterministicFst::Final(StateId s) {
   return Weight(-logprob);
 }
 
+const ConstArpaLmDeterministicFst::CacheEntry*
+ConstArpaLmDeterministicFst::CacheLookup(StateId s, Label ilabel) const {
+  size_t index = CacheIndex(s, ilabel);
+  for (size_t p = 0; p < kCacheMaxProbe; ++p) {
+    const CacheEntry &entry = cache_[(index + p) & (kCacheSize - 1)];
+    if (entry.state == s && entry.word == ilabel)
+      return &entry;
+    if (entry.state == fst::kNoStateId)
+      return NULL;  // Hit an unused slot; the pair cannot be further along.
+  }
+  return NULL;
+}
+
+void ConstArpaLmDeterministicFst::CacheInsert(StateId s, Label ilabel,
+                                              float logprob,
+                                              StateId next_state) {
+  // Takes the first unused (or matching) slot within probing distance of the
+  // home slot; if all of them hold other pairs, evicts the home slot. We
+  // never remove entries, so the lookup code above can still stop at the
+  // first unused slot it sees.
+  size_t index = CacheIndex(s, ilabel);
+  size_t target = index;
+  for (size_t p = 0; p < kCacheMaxProbe; ++p) {
+    size_t i = (index + p) & (kCacheSize - 1);
+    if (cache_[i].state == fst::kNoStateId ||
+        (cache_[i].state == s && cache_[i].word == ilabel)) {
+      target = i;
+      break;
+    }
+  }
+  CacheEntry &entry = cache_[target];
+  entry.state = s;
+  entry.word = ilabel;
+  entry.logprob = logprob;
+  entry.next_state = next_state;
+}
+
 bool ConstArpaLmDeterministicFst::GetArc(StateId s,
                                          Label ilabel, fst::StdArc *oarc) {
+  // The same histories recur constantly across lattice paths, so first check
+  // if we have looked this (state, word) pair up before.
+  const CacheEntry *entry = CacheLookup(s, ilabel);
+  if (entry != NULL) {
+    if (entry->next_state == fst::kNoStateId)
+      return false;
+    oarc->ilabel = ilabel;
+    oarc->olabel = ilabel;
+    oarc->nextstate = entry->next_state;
+    oarc->weight = Weight(-entry->logprob);
+    return true;
+  }
+
+  bool ans = GetArcInternal(s, ilabel, oarc);
+  CacheInsert(s, ilabel, ans ? -oarc->weight.Value() : 0.0f,
+              ans ? oarc->nextstate : fst::kNoStateId);
+  return ans;
+}
+
+size_t ConstArpaLmDeterministicFst::GetArcs(StateId s,
+                                            const std::vector<Label> &ilabels,
+                                            std::vector<fst::StdArc> *oarcs) {
+  oarcs->resize(ilabels.size());
+  size_t num_found = 0;
+  for (size_t i = 0; i < ilabels.size(); ++i) {
+    fst::StdArc &oarc = (*oarcs)[i];
+    if (GetArc(s, ilabels[i], &oarc)) {
+      ++num_found;
+    } else {
+      oarc.nextstate = fst::kNoStateId;
+    }
+  }
+  return num_found;
+}
+
+bool ConstArpaLmDeterministicFst::GetArcInternal(StateId s,
+                                                 Label ilabel,
+                                                 fst::StdArc *oarc) {
   // At this point, we should have created the state.
   KALDI_ASSERT(static_cast<size_t>(s) < state_to_wseq_.size());
   std::vector<Label> wseq = state_to_wseq_[s];
@@ -50,6 +50,8 @@ class ConstArpaLm {
     lm_states_ = NULL;
     unigram_states_ = NULL;
     overflow_buffer_ = NULL;
+    mmap_data_ = NULL;
+    mmap_size_ = 0;
     memory_assigned_ = false;
     initialized_ = false;
   }
@@ -75,21 +77,39 @@ class ConstArpaLm {
     KALDI_ASSERT(unk_symbol_ < num_words_ &&
                  (unk_symbol_ > 0 || unk_symbol_ == -1));
     lm_states_end_ = lm_states_ + lm_states_size_ - 1;
+    mmap_data_ = NULL;
+    mmap_size_ = 0;
     memory_assigned_ = false;
     initialized_ = true;
   }
 
   ~ConstArpaLm() {
     if (memory_assigned_) {
-      delete[] lm_states_;
+      // If <lm_states_> is memory-mapped it does not live on the heap; it is
+      // released by Unmap() below instead.
+      if (mmap_data_ == NULL)
+        delete[] lm_states_;
       delete[] unigram_states_;
       delete[] overflow_buffer_;
     }
+    if (mmap_data_ != NULL)
+      Unmap();
   }
 
   // Reads the ConstArpaLm format language model.
   void Read(std::istream &is, bool binary);
 
+  // Reads the ConstArpaLm format language model, memory-mapping the
+  // <lm_states_> array read-only straight from the file instead of copying it
+  // into heap memory. Loading is near-instant regardless of model size, the
+  // pages are faulted in lazily as n-grams are looked up, and the OS page
+  // cache shares a single physical copy of the model across all processes
+  // that map the same file. <rxfilename> must be a regular file (not a pipe
+  // or stdin), and the model must have been written by a version of
+  // ConstArpaLm::Write() that stores <lm_states_> as one contiguous block;
+  // for older models we fall back to the regular Read() with a warning.
+  void ReadMemoryMapped(const std::string &rxfilename);
+
   // Writes the language model in ConstArpaLm format.
   void Write(std::ostream &os, bool binary) const;
 
@@ -144,10 +164,23 @@ class ConstArpaLm {
                         const std::vector<int32>& seq,
                         std::vector<ArpaLine> *output) const;
 
+  // Reads the sections that follow <lm_states_> (the unigram and overflow
+  // pointer tables), converting the on-disk relative addresses to absolute
+  // pointers into <lm_states_>. Shared between Read() and ReadMemoryMapped().
+  void ReadPointerTables(std::istream &is, bool binary);
+
+  // Releases the memory mapping created by ReadMemoryMapped().
+  void Unmap();
+
   // We assign memory in Read(). If it is called, we have to release memory in
   // the destructor.
   bool memory_assigned_;
 
+  // Non-NULL if ReadMemoryMapped() was used; in that case <lm_states_> points
+  // into this mapping and must not be deleted.
+  void *mmap_data_;
+  size_t mmap_size_;
+
   // Makes sure that the language model has been loaded before using it.
   bool initialized_;
 
@@ -230,13 +263,65 @@ class ConstArpaLmDeterministicFst
 
   virtual bool GetArc(StateId s, Label ilabel, fst::StdArc* oarc);
 
+  // Batched version of GetArc(). Computes the arcs for all the given labels
+  // out of state <s> (e.g. the labels on the out-arcs of a lattice state) in
+  // one call; <oarcs> is resized to match <ilabels>, and entries for which no
+  // n-gram exists get nextstate == fst::kNoStateId. Returns the number of
+  // labels for which an arc exists.
+  size_t GetArcs(StateId s, const std::vector<Label>& ilabels,
+                 std::vector<fst::StdArc>* oarcs);
+
  private:
+  // One entry of the (state, word) -> (logprob, next state) lookup cache; see
+  // <cache_> below. state == fst::kNoStateId marks an unused entry. For
+  // (state, word) pairs that turned out to have no arc, next_state is
+  // fst::kNoStateId.
+  struct CacheEntry {
+    StateId state;
+    Label word;
+    float logprob;
+    StateId next_state;
+  };
+
+  // Number of entries in <cache_>; must be a power of two.
+  static const size_t kCacheSize = 131072;
+
+  // Number of slots we probe linearly before we give up (on lookup) or evict
+  // (on insertion).
+  static const size_t kCacheMaxProbe = 4;
+
+  // Index of the home slot for the pair (s, ilabel) in <cache_>.
+  inline size_t CacheIndex(StateId s, Label ilabel) const {
+    return (static_cast<size_t>(s) * 49999 + static_cast<size_t>(ilabel))
+        & (kCacheSize - 1);
+  }
+
+  // Returns the cache entry for the pair (s, ilabel), or NULL if it is not
+  // cached.
+  const CacheEntry* CacheLookup(StateId s, Label ilabel) const;
+
+  // Enters the pair (s, ilabel) into the cache, possibly evicting an older
+  // entry.
+  void CacheInsert(StateId s, Label ilabel, float logprob,
+                   StateId next_state);
+
+  // Uncached version of GetArc(); does the actual backoff walks through the
+  // language model.
+  bool GetArcInternal(StateId s, Label ilabel, fst::StdArc* oarc);
+
   typedef unordered_map<std::vector<Label>,
                         StateId, VectorHasher<Label> > MapType;
   StateId start_state_;
   MapType wseq_to_state_;
   std::vector<std::vector<Label> > state_to_wseq_;
   const ConstArpaLm& lm_;
+
+  // Open-addressing cache of (state, word) -> (logprob, next state), with
+  // storage preallocated in the constructor. The histories seen during
+  // lattice rescoring recur constantly across lattice paths, and the cache
+  // saves us from repeating the trie walks in ConstArpaLm, which dominate
+  // rescoring time with large language models.
+  std::vector<CacheEntry> cache_;
 };
 
 // Reads in an Arpa format language model and converts it into ConstArpaLm
@@ -26,8 +26,138 @@
 
 #include "lm/kaldi-lm.h"
 #include <stdexcept>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#if !defined(_MSC_VER)
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace kaldi {
+
+// Suffix appended to an ARPA filename to name its compiled cache, and the
+// token heading the cache file (before the hash and the FST itself).
+static const char *kLmCacheSuffix = ".cached.fst";
+static const char *kLmCacheToken = "<LmFstCache>";
+
+// Hashes the contents of the ARPA source file together with the reading
+// parameters (FNV-1a, 64-bit); any change to either invalidates the cache.
+// Returns false if the file cannot be read.
+static bool HashArpaSource(const string &filename, bool useNaturalLog,
+                           const string &startSent, const string &endSent,
+                           uint64 *hash) {
+  std::ifstream strm(filename.c_str(),
+                     std::ios_base::in | std::ios_base::binary);
+  if (!strm.is_open()) return false;
+  uint64 h = 14695981039346656037ULL;
+  char buf[65536];
+  while (strm) {
+    strm.read(buf, sizeof(buf));
+    std::streamsize n = strm.gcount();
+    for (std::streamsize i = 0; i < n; ++i) {
+      h ^= static_cast<unsigned char>(buf[i]);
+      h *= 1099511628211ULL;
+    }
+  }
+  std::ostringstream params;
+  params << useNaturalLog << ' ' << startSent << ' ' << endSent;
+  const string &p = params.str();
+  for (size_t i = 0; i < p.size(); ++i) {
+    h ^= static_cast<unsigned char>(p[i]);
+    h *= 1099511628211ULL;
+  }
+  *hash = h;
+  return true;
+}
+
+fst::StdVectorFst* LangModelFst::ReadArpaWithCache(const string &rxfilename,
+                                                   bool useNaturalLog,
+                                                   const string &startSent,
+                                                   const string &endSent) {
+#if !defined(_MSC_VER)
+  struct stat statbuf;
+  if (stat(rxfilename.c_str(), &statbuf) != 0 || !S_ISREG(statbuf.st_mode))
+    return NULL;  // a pipe, stdin etc.: no place to put a cache.
+  uint64 hash;
+  if (!HashArpaSource(rxfilename, useNaturalLog, startSent, endSent, &hash))
+    return NULL;
+  string cache_filename = rxfilename + kLmCacheSuffix;
+
+  // Tries the cache first: it must carry our token and the current hash.
+  {
+    std::ifstream strm(cache_filename.c_str(),
+                       std::ios_base::in | std::ios_base::binary);
+    if (strm.is_open()) {
+      bool cache_ok = false;
+      uint64 cached_hash = 0;
+      try {
+        std::string token;
+        ReadToken(strm, true, &token);
+        if (token == kLmCacheToken) {
+          ReadBasicType(strm, true, &cached_hash);
+          cache_ok = true;
+        }
+      } catch(const std::exception &e) {
+        cache_ok = false;  // garbled header: treat as a cache miss.
+      }
+      if (cache_ok && cached_hash == hash) {
+        fst::FstReadOptions ropts(cache_filename);
+        fst::StdVectorFst *cached_fst = fst::StdVectorFst::Read(strm, ropts);
+        if (cached_fst != NULL) {
+          KALDI_VLOG(1) << "Reused compiled LM cache " << cache_filename;
+          return cached_fst;
+        }
+      }
+      KALDI_VLOG(1) << "Compiled LM cache " << cache_filename
+                    << " is stale or unreadable; re-parsing the ARPA file.";
+    }
+  }
+
+  // Cache miss: parses the ARPA text the usual way.
+  {
+    Input ki(rxfilename);
+    if (ReadStream(ki.Stream(), PrintableRxfilename(rxfilename), kArpaLm,
+                   NULL, useNaturalLog, startSent, endSent) == NULL)
+      return NULL;
+  }
+
+  // Writes the compiled FST next to the source, via a temporary file plus
+  // rename() so that concurrent jobs never see a partial cache.  Failure to
+  // write (e.g. a read-only directory) is not an error.
+  std::ostringstream tmp_name;
+  tmp_name << cache_filename << ".tmp." << getpid();
+  {
+    std::ofstream strm(tmp_name.str().c_str(),
+                       std::ios_base::out | std::ios_base::binary);
+    if (!strm.is_open()) {
+      KALDI_VLOG(1) << "Not writing compiled LM cache " << cache_filename
+                    << " (directory not writable?)";
+      return pfst_;
+    }
+    WriteToken(strm, true, kLmCacheToken);
+    WriteBasicType(strm, true, hash);
+    fst::FstWriteOptions wopts(cache_filename);
+    if (!pfst_->Write(strm, wopts) || !strm) {
+      strm.close();
+      std::remove(tmp_name.str().c_str());
+      KALDI_VLOG(1) << "Failed writing compiled LM cache " << cache_filename;
+      return pfst_;
+    }
+  }
+  if (std::rename(tmp_name.str().c_str(), cache_filename.c_str()) != 0) {
+    std::remove(tmp_name.str().c_str());
+    KALDI_VLOG(1) << "Failed renaming compiled LM cache into place: "
+                  << cache_filename;
+  } else {
+    KALDI_VLOG(1) << "Wrote compiled LM cache " << cache_filename;
+  }
+  return pfst_;
+#else
+  return NULL;  // no caching on Windows.
+#endif
+}
 // add the string contained in inpline to the current transducer
 // starting at initial state
 LangModelFst::StateId LangModelFst::ReadTxtLine(const string &inpline) {
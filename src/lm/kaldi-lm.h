@@ -92,6 +92,11 @@ class LangModelFst: public fst::VectorFst<fst::StdArc> {
     return(pfst_ ? true : false);
   }
 
+  /// For ARPA input read from a regular file (with no external symbol
+  /// table), a compiled copy of the FST is automatically cached next to the
+  /// source file and reused on subsequent runs, skipping the text parsing;
+  /// the cache records a hash of the ARPA contents and of the reading
+  /// parameters, and is rebuilt whenever either changes.
   bool Read(const string &rxfilename,
             GrammarType gtype,
             fst::SymbolTable *pst = 0,
@@ -100,10 +105,19 @@ class LangModelFst: public fst::VectorFst<fst::StdArc> {
             const string endSent = "</s>") {
 
     delete pfst_;
+    pfst_ = NULL;
     if (rxfilename == "") {
       KALDI_ERR << "arpa2fst and similar programs no longer support empty filename "
                 << "for standard input; use '-'";
     }
+    // When reading ARPA into our own symbol table, go through the compiled
+    // cache (this returns NULL e.g. if the input is a pipe, in which case we
+    // fall through to plain parsing).  With a caller-supplied symbol table we
+    // cannot cache, since the caller expects its table to be filled in.
+    if (gtype == kArpaLm && pst == NULL) {
+      pfst_ = ReadArpaWithCache(rxfilename, useNaturalLog, startSent, endSent);
+      if (pfst_) return true;
+    }
     Input ki(rxfilename);
 
     pfst_ = ReadStream(ki.Stream(),
@@ -143,6 +157,16 @@ class LangModelFst: public fst::VectorFst<fst::StdArc> {
                                           const string endSent);
   void ReadTxtString(std::istream &strm);
   fst::StdArc::StateId ReadTxtLine(const string &inpline);
+
+  /// Reads an ARPA language model, using the compiled FST cached next to the
+  /// source file ("<source>.cached.fst") when it is up to date, and
+  /// (re-)writing it after parsing otherwise.  Returns NULL if the input is
+  /// not a regular file (e.g. a pipe or stdin), in which case the caller
+  /// falls back to plain parsing with no cache.
+  fst::StdVectorFst* ReadArpaWithCache(const string &rxfilename,
+                                       bool useNaturalLog,
+                                       const string &startSent,
+                                       const string &endSent);
 };
 /// @} LanguageModel
 
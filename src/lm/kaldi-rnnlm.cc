@@ -54,12 +54,14 @@ KaldiRnnlmWrapper::KaldiRnnlmWrapper(
   }
   label_to_word_[label_to_word_.size() - 1] = opts.eos_symbol;
   eos_ = label_to_word_.size() - 1;
+  prepared_ = false;
 }
 
-BaseFloat KaldiRnnlmWrapper::GetLogProb(
-    int32 word, const std::vector<int32> &wseq,
-    const std::vector<BaseFloat> &context_in,
-    std::vector<BaseFloat> *context_out) {
+void KaldiRnnlmWrapper::PrepareForScoring(
+    const std::vector<int32> &wseq,
+    const std::vector<BaseFloat> &context_in) {
+  if (prepared_ && wseq == prepared_wseq_ && context_in == prepared_context_in_)
+    return;  // The network is already prepared for this history.
 
   std::vector<std::string> wseq_symbols(wseq.size());
   for (int32 i = 0; i < wseq_symbols.size(); ++i) {
@@ -67,8 +69,36 @@ BaseFloat KaldiRnnlmWrapper::GetLogProb(
     wseq_symbols[i] = label_to_word_[wseq[i]];
   }
 
-  return rnnlm_.computeConditionalLogprob(label_to_word_[word], wseq_symbols,
-                                          context_in, context_out);
+  rnnlm_.prepareForScoring(wseq_symbols, context_in);
+  rnnlm_.saveContextToVector(&prepared_context_out_);
+  prepared_wseq_ = wseq;
+  prepared_context_in_ = context_in;
+  prepared_ = true;
+}
+
+BaseFloat KaldiRnnlmWrapper::GetLogProb(
+    int32 word, const std::vector<int32> &wseq,
+    const std::vector<BaseFloat> &context_in,
+    std::vector<BaseFloat> *context_out) {
+  PrepareForScoring(wseq, context_in);
+  BaseFloat logprob = rnnlm_.scoreWord(label_to_word_[word]);
+  if (context_out != NULL)
+    *context_out = prepared_context_out_;
+  return logprob;
+}
+
+void KaldiRnnlmWrapper::GetLogProbs(
+    const std::vector<int32> &words, const std::vector<int32> &wseq,
+    const std::vector<BaseFloat> &context_in,
+    std::vector<BaseFloat> *context_out,
+    std::vector<BaseFloat> *logprobs) {
+  KALDI_ASSERT(logprobs != NULL);
+  PrepareForScoring(wseq, context_in);
+  logprobs->resize(words.size());
+  for (size_t i = 0; i < words.size(); ++i)
+    (*logprobs)[i] = rnnlm_.scoreWord(label_to_word_[words[i]]);
+  if (context_out != NULL)
+    *context_out = prepared_context_out_;
 }
 
 RnnlmDeterministicFst::RnnlmDeterministicFst(int32 max_ngram_order,
@@ -137,4 +167,49 @@ bool RnnlmDeterministicFst::GetArc(StateId s, Label ilabel, fst::StdArc *oarc) {
   return true;
 }
 
+void RnnlmDeterministicFst::GetArcs(StateId s,
+                                    const std::vector<Label> &ilabels,
+                                    std::vector<fst::StdArc> *oarcs) {
+  // At this point, we should have created the state.
+  KALDI_ASSERT(static_cast<size_t>(s) < state_to_wseq_.size());
+  KALDI_ASSERT(oarcs != NULL);
+
+  // One shared forward pass scores all the queried words; the new hidden
+  // state depends only on the history, so it is shared as well.
+  std::vector<BaseFloat> new_context(rnnlm_->GetHiddenLayerSize());
+  std::vector<BaseFloat> logprobs;
+  rnnlm_->GetLogProbs(ilabels, state_to_wseq_[s], state_to_context_[s],
+                      &new_context, &logprobs);
+
+  oarcs->resize(ilabels.size());
+  for (size_t i = 0; i < ilabels.size(); ++i) {
+    std::vector<Label> wseq = state_to_wseq_[s];
+    wseq.push_back(ilabels[i]);
+    if (max_ngram_order_ > 0) {
+      while (wseq.size() >= max_ngram_order_) {
+        // History state has at most <max_ngram_order_> - 1 words in the state.
+        wseq.erase(wseq.begin(), wseq.begin() + 1);
+      }
+    }
+
+    std::pair<const std::vector<Label>, StateId> wseq_state_pair(
+        wseq, static_cast<Label>(state_to_wseq_.size()));
+
+    // Attemps to insert the pair; if it already exists then insert() returns
+    // false and we reuse the existing state.
+    typedef MapType::iterator IterType;
+    std::pair<IterType, bool> result = wseq_to_state_.insert(wseq_state_pair);
+    if (result.second == true) {
+      state_to_wseq_.push_back(wseq);
+      state_to_context_.push_back(new_context);
+    }
+
+    fst::StdArc &oarc = (*oarcs)[i];
+    oarc.ilabel = ilabels[i];
+    oarc.olabel = ilabels[i];
+    oarc.nextstate = result.first->second;
+    oarc.weight = Weight(-logprobs[i]);
+  }
+}
+
 }  // namespace kaldi
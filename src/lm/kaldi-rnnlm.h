@@ -59,11 +59,34 @@ class KaldiRnnlmWrapper {
                        const std::vector<BaseFloat> &context_in,
                        std::vector<BaseFloat> *context_out);
 
+  // Batched version of GetLogProb(): scores all of <words> against the same
+  // history (wseq, context_in) with one shared forward pass through the
+  // network, instead of one full pass per word.
+  void GetLogProbs(const std::vector<int32> &words,
+                   const std::vector<int32> &wseq,
+                   const std::vector<BaseFloat> &context_in,
+                   std::vector<BaseFloat> *context_out,
+                   std::vector<BaseFloat> *logprobs);
+
  private:
+  // Runs the history-dependent part of the forward pass for (wseq,
+  // context_in), unless that is already the prepared history; consecutive
+  // queries against the same history (the access pattern of lattice
+  // composition, which takes the arcs of a state one by one) then share it.
+  void PrepareForScoring(const std::vector<int32> &wseq,
+                         const std::vector<BaseFloat> &context_in);
+
   rnnlm::CRnnLM rnnlm_;
   std::vector<std::string> label_to_word_;
   int32 eos_;
 
+  // The history that the underlying network is currently prepared for (see
+  // PrepareForScoring()), and the hidden state it produced.
+  bool prepared_;
+  std::vector<int32> prepared_wseq_;
+  std::vector<BaseFloat> prepared_context_in_;
+  std::vector<BaseFloat> prepared_context_out_;
+
   KALDI_DISALLOW_COPY_AND_ASSIGN(KaldiRnnlmWrapper);
 };
 
@@ -87,6 +110,13 @@ class RnnlmDeterministicFst
 
   virtual bool GetArc(StateId s, Label ilabel, fst::StdArc* oarc);
 
+  // Batched version of GetArc(): computes the arcs for all the given labels
+  // out of state <s> (e.g. the labels on the out-arcs of a lattice state)
+  // with one shared forward pass through the network. Every label has an
+  // arc, so unlike GetArc() there is no failure case.
+  void GetArcs(StateId s, const std::vector<Label> &ilabels,
+               std::vector<fst::StdArc> *oarcs);
+
  private:
   typedef unordered_map<std::vector<Label>,
                         StateId, VectorHasher<Label> > MapType;
@@ -55,6 +55,7 @@
 #include <string.h>
 #include <math.h>
 #include "lm/mikolov-rnnlm-lib.h"
+#include "matrix/kaldi-blas.h"
 #include "util/table-types.h"
 
 namespace rnnlm {
@@ -784,44 +785,20 @@ void CRnnLM::matrixXvector(struct neuron *dest, struct neuron *srcvec,
   real val5, val6, val7, val8;
 
   if (type == 0) {    // ac mod
-    for (b = 0; b < (to - from) / 8; b++) {
-      val1 = 0;
-      val2 = 0;
-      val3 = 0;
-      val4 = 0;
-
-      val5 = 0;
-      val6 = 0;
-      val7 = 0;
-      val8 = 0;
-
-      for (a = from2; a < to2; a++) {
-        val1 += srcvec[a].ac * srcmatrix[a+(b*8+from+0)*matrix_width].weight;
-        val2 += srcvec[a].ac * srcmatrix[a+(b*8+from+1)*matrix_width].weight;
-        val3 += srcvec[a].ac * srcmatrix[a+(b*8+from+2)*matrix_width].weight;
-        val4 += srcvec[a].ac * srcmatrix[a+(b*8+from+3)*matrix_width].weight;
-
-        val5 += srcvec[a].ac * srcmatrix[a+(b*8+from+4)*matrix_width].weight;
-        val6 += srcvec[a].ac * srcmatrix[a+(b*8+from+5)*matrix_width].weight;
-        val7 += srcvec[a].ac * srcmatrix[a+(b*8+from+6)*matrix_width].weight;
-        val8 += srcvec[a].ac * srcmatrix[a+(b*8+from+7)*matrix_width].weight;
-      }
-      dest[b*8+from+0].ac += val1;
-      dest[b*8+from+1].ac += val2;
-      dest[b*8+from+2].ac += val3;
-      dest[b*8+from+3].ac += val4;
-
-      dest[b*8+from+4].ac += val5;
-      dest[b*8+from+5].ac += val6;
-      dest[b*8+from+6].ac += val7;
-      dest[b*8+from+7].ac += val8;
-    }
-
-    for (b = b*8; b < to-from; b++) {
-      for (a = from2; a < to2; a++) {
-        dest[b+from].ac +=
-            srcvec[a].ac * srcmatrix[a+(b+from)*matrix_width].weight;
-      }
+    // This computes, for b in [from, to):
+    //   dest[b].ac += \sum_{a in [from2, to2)}
+    //       srcvec[a].ac * srcmatrix[a + b*matrix_width].weight,
+    // which is one matrix-vector product, so we hand it to BLAS (the neuron
+    // struct stores (ac, er) pairs, hence the input/output strides of two;
+    // the synapse struct is a bare weight, so the matrix is dense with row
+    // stride matrix_width).
+    assert(sizeof(struct neuron) == 2 * sizeof(real) &&
+           sizeof(struct synapse) == sizeof(real));
+    if (to > from && to2 > from2) {
+      cblas_dgemv(CblasRowMajor, CblasNoTrans, to - from, to2 - from2,
+                  1.0, &srcmatrix[from2 + from * matrix_width].weight,
+                  matrix_width, &srcvec[from2].ac, 2,
+                  1.0, &dest[from].ac, 2);
     }
   } else {    // er mod
     for (a = 0; a < (to2-from2)/8; a++) {
@@ -891,7 +868,7 @@ void CRnnLM::matrixXvector(struct neuron *dest, struct neuron *srcvec,
 }
 
 void CRnnLM::computeNet(int last_word, int word) {
-  int a, b, c;
+  int a, b;
   real val;
   double sum;   // sum is used for normalization: it's better to have larger
                 // precision as many numbers are summed together here
@@ -993,6 +970,19 @@ void CRnnLM::computeNet(int last_word, int word) {
                         // is -> only classes are estimated and word is selected
                         // in testGen()
 
+  computeNetWord(word);
+}
+
+// The word-dependent tail of computeNet(): propagates to the output units of
+// <word>'s class, applies the direct connections and the softmax within the
+// class.  It only touches neu2[0..vocab_size), so once computeNet(last_word,
+// -1) has run for the current history, this can be called repeatedly to score
+// several words against that same history (see prepareForScoring()).
+void CRnnLM::computeNetWord(int word) {
+  int a, b, c;
+  real val;
+  double sum;   // sum is used for normalization: it's better to have larger
+                // precision as many numbers are summed together here
 
   // 1->2 word
   if (word != -1) {
@@ -1084,11 +1074,9 @@ void CRnnLM::saveContextToVector(std::vector <float> *context_out) {
   }
 }
 
-float CRnnLM::computeConditionalLogprob(
-    std::string current_word,
+void CRnnLM::prepareForScoring(
     const std::vector < std::string >  &history_words,
-    const std::vector < float >  &context_in,
-    std::vector < float >  *context_out) {
+    const std::vector < float >  &context_in) {
   // We assume the network has been restored.
   netReset();
   restoreContextFromVector(context_in);
@@ -1096,10 +1084,6 @@ float CRnnLM::computeConditionalLogprob(
 
   // Maps unk to the unk symbol.
   std::vector <std::string>  history_words_nounk(history_words);
-  std::string current_word_nounk = current_word;
-  if (isUnk(current_word_nounk)) {
-    current_word_nounk = unk_sym;
-  }
   for (int i = 0; i < history_words_nounk.size(); ++i) {
     if (isUnk(history_words_nounk[i])) {
       history_words_nounk[i] = unk_sym;
@@ -1115,17 +1099,34 @@ float CRnnLM::computeConditionalLogprob(
         history_words_nounk[history_words_nounk.size() - 1 - i].c_str());
   }
 
-  int word = 0, last_word = 0;
-  float logprob = 0;
-  if (current_word_nounk == unk_sym) {
-    logprob += getUnkPenalty(current_word);
-  }
-  word = searchVocab(current_word_nounk.c_str());
+  int last_word = 0;
   if (history_words_nounk.size() > 0) {
     last_word = searchVocab(
         history_words_nounk[history_words_nounk.size() - 1].c_str());
   }
-  computeNet(last_word, word);
+
+  // Runs the history-dependent part of the forward pass: the hidden layer
+  // and the softmax over classes.  The word-dependent tail runs in
+  // scoreWord(), once per queried word.
+  computeNet(last_word, -1);
+
+  if (last_word != -1) {
+    neu0[last_word].ac = 0;
+  }
+}
+
+float CRnnLM::scoreWord(const std::string &current_word) {
+  std::string current_word_nounk = current_word;
+  if (isUnk(current_word_nounk)) {
+    current_word_nounk = unk_sym;
+  }
+
+  float logprob = 0;
+  if (current_word_nounk == unk_sym) {
+    logprob += getUnkPenalty(current_word);
+  }
+  int word = searchVocab(current_word_nounk.c_str());
+  computeNetWord(word);
 
   if (word != -1) {
     logprob +=
@@ -1134,15 +1135,41 @@ float CRnnLM::computeConditionalLogprob(
     logprob += -16.118;
   }
 
+  return logprob;
+}
+
+float CRnnLM::computeConditionalLogprob(
+    std::string current_word,
+    const std::vector < std::string >  &history_words,
+    const std::vector < float >  &context_in,
+    std::vector < float >  *context_out) {
+  prepareForScoring(history_words, context_in);
+  float logprob = scoreWord(current_word);
+
   if (context_out != NULL) {
     saveContextToVector(context_out);
   }
 
-  if (last_word != -1) {
-    neu0[last_word].ac = 0;
+  return logprob;
+}
+
+void CRnnLM::computeConditionalLogprobs(
+    const std::vector < std::string >  &current_words,
+    const std::vector < std::string >  &history_words,
+    const std::vector < float >  &context_in,
+    std::vector < float >  *context_out,
+    std::vector < float >  *logprobs) {
+  assert(logprobs != NULL);
+  prepareForScoring(history_words, context_in);
+
+  logprobs->resize(current_words.size());
+  for (int i = 0; i < current_words.size(); ++i) {
+    (*logprobs)[i] = scoreWord(current_words[i]);
   }
 
-  return logprob;
+  if (context_out != NULL) {
+    saveContextToVector(context_out);
+  }
 }
 
 bool CRnnLM::isUnk(const std::string &word) {
@@ -213,6 +213,7 @@ class CRnnLM {
                            // the independent mode)
 
   void computeNet(int last_word, int word);
+  void computeNetWord(int word);  // word-dependent tail of computeNet()
   void copyHiddenLayerToInput();
 
   void matrixXvector(struct neuron *dest, struct neuron *srcvec,
@@ -222,12 +223,33 @@ class CRnnLM {
   void restoreContextFromVector(const std::vector<float> &context_in);
   void saveContextToVector(std::vector<float> *context_out);
 
+  // Runs the history-dependent part of the forward pass (hidden layer and
+  // class softmax) for the given history and context.  Any number of words
+  // can then be scored against this history with scoreWord(), which only
+  // runs the (much cheaper) word-dependent tail; this is what makes lattice
+  // rescoring affordable, where many words are queried per history.
+  void prepareForScoring(const std::vector<std::string> &history_words,
+                         const std::vector<float> &context_in);
+
+  // Scores one word against the history given to the most recent call of
+  // prepareForScoring().
+  float scoreWord(const std::string &current_word);
+
   float computeConditionalLogprob(
       std::string current_word,
       const std::vector<std::string> &history_words,
       const std::vector<float> &context_in,
       std::vector<float> *context_out);
 
+  // Batched version of computeConditionalLogprob(): scores all of
+  // <current_words> against the same history with one shared forward pass.
+  void computeConditionalLogprobs(
+      const std::vector<std::string> &current_words,
+      const std::vector<std::string> &history_words,
+      const std::vector<float> &context_in,
+      std::vector<float> *context_out,
+      std::vector<float> *logprobs);
+
   void setUnkSym(const std::string &unk);
   void setUnkPenalty(const std::string &filename);
   float getUnkPenalty(const std::string &word);
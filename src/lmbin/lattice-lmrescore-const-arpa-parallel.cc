@@ -0,0 +1,182 @@
+// lmbin/lattice-lmrescore-const-arpa-parallel.cc
+
+// Copyright 2015  Johns Hopkins University (Author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "base/kaldi-common.h"
+#include "fstext/fstext-lib.h"
+#include "lat/kaldi-lattice.h"
+#include "lat/lattice-functions.h"
+#include "lm/const-arpa-lm.h"
+#include "thread/kaldi-prefetch-table-reader.h"
+#include "thread/kaldi-task-sequence.h"
+#include "util/common-utils.h"
+
+namespace kaldi {
+
+// Rescores one lattice against the (shared, read-only) ConstArpaLm; designed
+// to be run by TaskSequencer.  The work happens in operator (), which runs in
+// a worker thread; the destructor, which TaskSequencer calls on the main
+// thread in the order the tasks were submitted, writes the result, so the
+// output order matches the input order.
+class RescoreConstArpaLmTask {
+ public:
+  RescoreConstArpaLmTask(const std::string &key,
+                         const CompactLattice &clat,
+                         BaseFloat lm_scale,
+                         const ConstArpaLm &const_arpa,
+                         CompactLatticeWriter *clat_writer,
+                         int32 *num_done, int32 *num_fail):
+      key_(key), clat_(clat), lm_scale_(lm_scale), const_arpa_(const_arpa),
+      clat_writer_(clat_writer), num_done_(num_done), num_fail_(num_fail),
+      success_(false) { }
+
+  void operator () () {
+    if (lm_scale_ == 0.0) {
+      // Zero scale so nothing to do; write the input unchanged.
+      success_ = true;
+      return;
+    }
+    // Before composing with the LM FST, we scale the lattice weights
+    // by the inverse of "lm_scale".  We'll later scale by "lm_scale".
+    // We do it this way so we can determinize and it will give the
+    // right effect (taking the "best path" through the LM) regardless
+    // of the sign of lm_scale.
+    fst::ScaleLattice(fst::GraphLatticeScale(1.0 / lm_scale_), &clat_);
+    ArcSort(&clat_, fst::OLabelCompare<CompactLatticeArc>());
+
+    // Wraps the ConstArpaLm format language model into FST.  The wrapper
+    // holds the per-composition state (and lookup cache), so each task gets
+    // its own; the underlying ConstArpaLm is read-only and shared.
+    ConstArpaLmDeterministicFst const_arpa_fst(const_arpa_);
+
+    // Composes lattice with language model.
+    CompactLattice composed_clat;
+    ComposeCompactLatticeDeterministic(clat_, &const_arpa_fst, &composed_clat);
+
+    // Determinizes the composed lattice.
+    Lattice composed_lat;
+    ConvertLattice(composed_clat, &composed_lat);
+    Invert(&composed_lat);
+    CompactLattice determinized_clat;
+    DeterminizeLattice(composed_lat, &determinized_clat);
+    fst::ScaleLattice(fst::GraphLatticeScale(lm_scale_), &determinized_clat);
+    if (determinized_clat.Start() == fst::kNoStateId) {
+      KALDI_WARN << "Empty lattice for utterance " << key_
+                 << " (incompatible LM?)";
+    } else {
+      clat_ = determinized_clat;
+      success_ = true;
+    }
+  }
+
+  ~RescoreConstArpaLmTask() {
+    if (success_) {
+      clat_writer_->Write(key_, clat_);
+      (*num_done_)++;
+    } else {
+      (*num_fail_)++;
+    }
+  }
+
+ private:
+  std::string key_;
+  CompactLattice clat_;
+  BaseFloat lm_scale_;
+  const ConstArpaLm &const_arpa_;
+  CompactLatticeWriter *clat_writer_;
+  int32 *num_done_;
+  int32 *num_fail_;
+  bool success_;
+};
+
+}  // namespace kaldi
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    typedef kaldi::int32 int32;
+    typedef kaldi::int64 int64;
+
+    const char *usage =
+        "Rescores lattices with a ConstArpaLm format language model, like\n"
+        "lattice-lmrescore-const-arpa, but multi-threaded: lattices are read\n"
+        "ahead by a prefetching reader and rescored by --num-threads worker\n"
+        "threads against a single shared copy of the language model, with\n"
+        "the output written in the input order.  With --mmap-lm=true the\n"
+        "model is additionally memory-mapped so that all such processes on\n"
+        "a machine share one physical copy.\n"
+        "\n"
+        "Usage: lattice-lmrescore-const-arpa-parallel [options] \\\n"
+        "           lattice-rspecifier const-arpa-in lattice-wspecifier\n"
+        " e.g.: lattice-lmrescore-const-arpa-parallel --num-threads=8 \\\n"
+        "           --lm-scale=-1.0 ark:in.lats const_arpa ark:out.lats\n";
+
+    ParseOptions po(usage);
+    BaseFloat lm_scale = 1.0;
+    bool mmap_lm = false;
+    TaskSequencerConfig sequencer_config;  // has --num-threads option
+
+    po.Register("lm-scale", &lm_scale, "Scaling factor for language model "
+                "costs; frequently 1.0 or -1.0");
+    po.Register("mmap-lm", &mmap_lm, "If true, memory-map the language model "
+                "read-only instead of reading it into memory (the model file "
+                "must be a regular file, not a pipe).");
+    sequencer_config.Register(&po);
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 3) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string lats_rspecifier = po.GetArg(1),
+        lm_rxfilename = po.GetArg(2),
+        lats_wspecifier = po.GetArg(3);
+
+    // Reads the language model in ConstArpaLm format.
+    ConstArpaLm const_arpa;
+    if (mmap_lm) const_arpa.ReadMemoryMapped(lm_rxfilename);
+    else ReadKaldiObject(lm_rxfilename, &const_arpa);
+
+    // Reads and writes as compact lattice.
+    PrefetchingSequentialTableReader<CompactLatticeHolder>
+        compact_lattice_reader(lats_rspecifier);
+    CompactLatticeWriter compact_lattice_writer(lats_wspecifier);
+
+    int32 n_done = 0, n_fail = 0;
+    {
+      TaskSequencer<RescoreConstArpaLmTask> sequencer(sequencer_config);
+      for (; !compact_lattice_reader.Done(); compact_lattice_reader.Next()) {
+        RescoreConstArpaLmTask *task = new RescoreConstArpaLmTask(
+            compact_lattice_reader.Key(), compact_lattice_reader.Value(),
+            lm_scale, const_arpa, &compact_lattice_writer,
+            &n_done, &n_fail);
+        sequencer.Run(task);  // takes ownership of "task".
+      }
+      sequencer.Wait();  // destroys the remaining tasks, writing the output.
+    }
+
+    KALDI_LOG << "Done " << n_done << " lattices, failed for " << n_fail;
+    return (n_done != 0 ? 0 : 1);
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}
@@ -2,7 +2,19 @@
 CUDA_INCLUDE= -I$(CUDATKDIR)/include
 CUDA_FLAGS = -g -Xcompiler -fPIC --verbose --machine 64 -DHAVE_CUDA
 
-CXXFLAGS += -DHAVE_CUDA -I$(CUDATKDIR)/include 
+CXXFLAGS += -DHAVE_CUDA -I$(CUDATKDIR)/include
+
+# With CUDA 7.0 or later, compile with per-thread default streams: each host
+# thread then issues its kernels to its own stream, so independent work from
+# different threads can overlap on the GPU.  See the multi-stream support in
+# cudamatrix/cu-device.h.
+CUDA_MAJOR_VERSION := $(shell $(CUDATKDIR)/bin/nvcc --version | \
+    sed -n 's/^.*release \([0-9]*\)\..*$$/\1/p')
+ifeq ($(shell [ "$(CUDA_MAJOR_VERSION)" -ge 7 ] 2>/dev/null && echo true), true)
+  CUDA_FLAGS += --default-stream per-thread
+  CXXFLAGS += -DCUDA_API_PER_THREAD_DEFAULT_STREAM
+endif
+
 UNAME := $(shell uname)
 #aware of fact in cuda60 there is no lib64, just lib.
 ifeq ($(UNAME), Darwin)
@@ -0,0 +1,157 @@
+// matrix/blocked-gemm.h
+
+// Copyright 2014   Johns Hopkins University
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_MATRIX_BLOCKED_GEMM_H_
+#define KALDI_MATRIX_BLOCKED_GEMM_H_
+
+#include <vector>
+#include "matrix/matrix-common.h"
+
+namespace kaldi {
+
+/*
+   This header implements a self-contained, cache-blocked matrix
+   multiplication, used by MatrixBase::AddMatMat() as a fallback when Kaldi
+   is built against an untuned BLAS (compile with -DHAVE_KALDI_INTERNAL_GEMM;
+   see the note in kaldi-blas.h).  A reference cblas dgemm can be 20x
+   slower than a tuned one; this version gets within a small factor of
+   tuned-BLAS speed by packing blocks of both operands into contiguous
+   buffers (which also normalizes away the transpose variants), iterating
+   in a cache-friendly block order, and keeping the innermost loop
+   unit-stride so the compiler can vectorize it.  If Kaldi is built with
+   OpenMP (-fopenmp), the row-blocks of the output are additionally
+   computed in parallel.
+
+   This is not meant to compete with a tuned BLAS -- configure against one
+   where possible -- it just puts a sane floor under performance on hosts
+   where that is not an option.
+ */
+
+// Computes M = alpha * op(A) * op(B) + beta * M, with the same argument
+// conventions as the cblas_Xgemm wrapper in cblas-wrappers.h: all matrices
+// are row-major with the given strides; num_rows/num_cols are the size of
+// M, and op(A) is "A" or "A transposed" per transA (likewise for B).
+template<typename Real>
+void BlockedGemm(const Real alpha,
+                 MatrixTransposeType transA, const Real *Adata,
+                 MatrixIndexT a_num_rows, MatrixIndexT a_num_cols,
+                 MatrixIndexT a_stride,
+                 MatrixTransposeType transB, const Real *Bdata,
+                 MatrixIndexT b_stride,
+                 const Real beta, Real *Mdata,
+                 MatrixIndexT num_rows, MatrixIndexT num_cols,
+                 MatrixIndexT stride) {
+  const MatrixIndexT m = num_rows, n = num_cols,
+      k = (transA == kNoTrans ? a_num_cols : a_num_rows);
+  // Block sizes: the packed B block (kKB x kNB) is sized to stay resident
+  // in L2 while a row-block of the output is computed; the packed A block
+  // (kMB x kKB) fits easily in L1/L2.  These are conservative round
+  // numbers; exact tuning matters much less than the packing itself.
+  const MatrixIndexT kMB = 64, kKB = 256, kNB = 128;
+
+  // First apply beta to the output (done up front so the accumulation
+  // passes below can just add).
+  if (beta != 1.0) {
+    for (MatrixIndexT i = 0; i < m; i++) {
+      Real *M_row = Mdata + i * stride;
+      if (beta == 0.0) {
+        for (MatrixIndexT j = 0; j < n; j++) M_row[j] = 0.0;
+      } else {
+        for (MatrixIndexT j = 0; j < n; j++) M_row[j] *= beta;
+      }
+    }
+  }
+  if (alpha == 0.0 || m == 0 || n == 0 || k == 0) return;
+
+  std::vector<Real> b_block_vec(kKB * kNB);
+  Real *b_block = &(b_block_vec[0]);
+
+  for (MatrixIndexT jj = 0; jj < n; jj += kNB) {
+    MatrixIndexT nb = std::min(kNB, n - jj);
+    for (MatrixIndexT ll = 0; ll < k; ll += kKB) {
+      MatrixIndexT kb = std::min(kKB, k - ll);
+      // Pack op(B)[ll:ll+kb, jj:jj+nb] contiguously, row-major, with alpha
+      // folded in (cheaper here than in the O(m*n*k) kernel).
+      if (transB == kNoTrans) {
+        for (MatrixIndexT l = 0; l < kb; l++) {
+          const Real *src = Bdata + (ll + l) * b_stride + jj;
+          Real *dst = b_block + l * nb;
+          for (MatrixIndexT j = 0; j < nb; j++) dst[j] = alpha * src[j];
+        }
+      } else {
+        for (MatrixIndexT l = 0; l < kb; l++) {
+          const Real *src = Bdata + (jj * b_stride) + (ll + l);
+          Real *dst = b_block + l * nb;
+          for (MatrixIndexT j = 0; j < nb; j++)
+            dst[j] = alpha * src[j * b_stride];
+        }
+      }
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+      for (MatrixIndexT ii = 0; ii < m; ii += kMB) {
+        MatrixIndexT mb = std::min(kMB, m - ii);
+        // Pack op(A)[ii:ii+mb, ll:ll+kb]; this buffer is per-iteration so
+        // that the loop body is safe to run in parallel.
+        std::vector<Real> a_block_vec(mb * kb);
+        Real *a_block = &(a_block_vec[0]);
+        if (transA == kNoTrans) {
+          for (MatrixIndexT i = 0; i < mb; i++) {
+            const Real *src = Adata + (ii + i) * a_stride + ll;
+            Real *dst = a_block + i * kb;
+            for (MatrixIndexT l = 0; l < kb; l++) dst[l] = src[l];
+          }
+        } else {
+          for (MatrixIndexT i = 0; i < mb; i++) {
+            const Real *src = Adata + (ll * a_stride) + (ii + i);
+            Real *dst = a_block + i * kb;
+            for (MatrixIndexT l = 0; l < kb; l++)
+              dst[l] = src[l * a_stride];
+          }
+        }
+        // The kernel: M[ii:ii+mb, jj:jj+nb] += a_block * b_block.  The
+        // inner loop over j is unit-stride in both b_block and the output
+        // row, so it vectorizes; unrolling over l keeps several
+        // independent multiply-adds in flight.
+        for (MatrixIndexT i = 0; i < mb; i++) {
+          const Real *a_row = a_block + i * kb;
+          Real *M_row = Mdata + (ii + i) * stride + jj;
+          MatrixIndexT l = 0;
+          for (; l + 4 <= kb; l += 4) {
+            const Real a0 = a_row[l], a1 = a_row[l+1],
+                a2 = a_row[l+2], a3 = a_row[l+3];
+            const Real *b0 = b_block + l * nb, *b1 = b0 + nb,
+                *b2 = b1 + nb, *b3 = b2 + nb;
+            for (MatrixIndexT j = 0; j < nb; j++)
+              M_row[j] += a0 * b0[j] + a1 * b1[j] + a2 * b2[j] + a3 * b3[j];
+          }
+          for (; l < kb; l++) {
+            const Real a0 = a_row[l];
+            const Real *b0 = b_block + l * nb;
+            for (MatrixIndexT j = 0; j < nb; j++) M_row[j] += a0 * b0[j];
+          }
+        }
+      }
+    }
+  }
+}
+
+}  // namespace kaldi
+
+#endif  // KALDI_MATRIX_BLOCKED_GEMM_H_
@@ -432,8 +432,49 @@ inline void clapack_Xgesvd(char *v, char *u, KaldiBlasInt *num_cols,
           sv, Vdata, vstride, Udata, ustride,
           p_work, l_work, result); 
 }
+// divide-and-conquer Svd; as clapack_Xgesvd but jobz applies to both U and
+// V at once, and an integer workspace of size 8*min(M, N) is required.
+inline void clapack_Xgesdd(char *jobz, KaldiBlasInt *num_cols,
+                           KaldiBlasInt *num_rows, float *Mdata, KaldiBlasInt *stride,
+                           float *sv, float *Vdata, KaldiBlasInt *vstride,
+                           float *Udata, KaldiBlasInt *ustride, float *p_work,
+                           KaldiBlasInt *l_work, KaldiBlasInt *i_work,
+                           KaldiBlasInt *result) {
+  sgesdd_(jobz,
+          num_cols, num_rows, Mdata, stride,
+          sv, Vdata, vstride, Udata, ustride,
+          p_work, l_work, i_work, result);
+}
+inline void clapack_Xgesdd(char *jobz, KaldiBlasInt *num_cols,
+                           KaldiBlasInt *num_rows, double *Mdata, KaldiBlasInt *stride,
+                           double *sv, double *Vdata, KaldiBlasInt *vstride,
+                           double *Udata, KaldiBlasInt *ustride, double *p_work,
+                           KaldiBlasInt *l_work, KaldiBlasInt *i_work,
+                           KaldiBlasInt *result) {
+  dgesdd_(jobz,
+          num_cols, num_rows, Mdata, stride,
+          sv, Vdata, vstride, Udata, ustride,
+          p_work, l_work, i_work, result);
+}
+// divide-and-conquer symmetric eigenvalue decomposition.
+inline void clapack_Xsyevd(char *jobz, char *uplo, KaldiBlasInt *num_rows,
+                           float *Mdata, KaldiBlasInt *stride, float *eigs,
+                           float *p_work, KaldiBlasInt *l_work,
+                           KaldiBlasInt *i_work, KaldiBlasInt *l_iwork,
+                           KaldiBlasInt *result) {
+  ssyevd_(jobz, uplo, num_rows, Mdata, stride, eigs,
+          p_work, l_work, i_work, l_iwork, result);
+}
+inline void clapack_Xsyevd(char *jobz, char *uplo, KaldiBlasInt *num_rows,
+                           double *Mdata, KaldiBlasInt *stride, double *eigs,
+                           double *p_work, KaldiBlasInt *l_work,
+                           KaldiBlasInt *i_work, KaldiBlasInt *l_iwork,
+                           KaldiBlasInt *result) {
+  dsyevd_(jobz, uplo, num_rows, Mdata, stride, eigs,
+          p_work, l_work, i_work, l_iwork, result);
+}
 //
-void inline clapack_Xsptri(KaldiBlasInt *num_rows, float *Mdata, 
+void inline clapack_Xsptri(KaldiBlasInt *num_rows, float *Mdata,
                            KaldiBlasInt *ipiv, float *work, KaldiBlasInt *result) {
   ssptri_(const_cast<char *>("U"), num_rows, Mdata, ipiv, work, result);
 }
@@ -20,10 +20,240 @@
 // limitations under the License.
 
 #include "matrix/compressed-matrix.h"
+#include "base/cpu-features.h"
 #include <algorithm>
 
+// The vectorized codec kernels below are limited to x86-64 gcc, like the
+// other hand-written SIMD code (see the similar blocks in gmm/diag-gmm.cc
+// and matrix/simd-vector-kernels.h); everything else uses the scalar code.
+// They need AVX2 for the byte <-> int32 conversions, so unlike the vector
+// kernels there is no SSE2 baseline: below kSimdAvx2 we stay scalar.
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) \
+    && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 8))
+#define KALDI_COMPRESSED_MATRIX_SIMD 1
+#include <immintrin.h>
+#endif
+
 namespace kaldi {
 
+#ifdef KALDI_COMPRESSED_MATRIX_SIMD
+
+// How many elements the SIMD paths process per stack buffer; the buffers
+// exist to make the data contiguous in float (the byte data of format 1 is
+// stored down the column, but the matrix is accessed with a row stride, and
+// the element type may be double).
+static const int32 kCodecBlockSize = 512;
+
+static inline bool CodecSimdEnabled() {
+  static const bool enabled = (GetCpuSimdLevel() >= kSimdAvx2);
+  return enabled;
+}
+
+// Local copies of the scalar FloatToChar and FloatToUint16 (which are
+// private members, defined further down), used for the remainders of the
+// vector loops; the expressions must be kept identical so that the SIMD
+// paths stay bit-exact with the scalar ones.
+static inline unsigned char FloatToCharScalar(float p0, float p25,
+                                              float p75, float p100,
+                                              float value) {
+  int ans;
+  if (value < p25) {
+    float f = (value - p0) / (p25 - p0);
+    ans = static_cast<int>(f * 64 + 0.5);
+    if (ans < 0) ans = 0;
+    if (ans > 64) ans = 64;
+  } else if (value < p75) {
+    float f = (value - p25) / (p75 - p25);
+    ans = 64 + static_cast<int>(f * 128 + 0.5);
+    if (ans < 64) ans = 64;
+    if (ans > 192) ans = 192;
+  } else {
+    float f = (value - p75) / (p100 - p75);
+    ans = 192 + static_cast<int>(f * 63 + 0.5);
+    if (ans < 192) ans = 192;
+    if (ans > 255) ans = 255;
+  }
+  return static_cast<unsigned char>(ans);
+}
+
+static inline float CharToFloatScalar(float p0, float p25,
+                                      float p75, float p100,
+                                      unsigned char value) {
+  if (value <= 64) {
+    return p0 + (p25 - p0) * value * (1/64.0);
+  } else if (value <= 192) {
+    return p25 + (p75 - p25) * (value - 64) * (1/128.0);
+  } else {
+    return p75 + (p100 - p75) * (value - 192) * (1/63.0);
+  }
+}
+
+static inline uint16 FloatToUint16Scalar(float min_value, float range,
+                                         float value) {
+  float f = (value - min_value) / range;
+  if (f > 1.0) f = 1.0;
+  if (f < 0.0) f = 0.0;
+  return static_cast<int>(f * 65535 + 0.499);
+}
+
+// The kernels below are bit-exact with the scalar FloatToChar /
+// CharToFloat / FloatToUint16 / Uint16ToFloat: the scalar expressions
+// promote some intermediates to double (through double literals like 0.5
+// and 1/63.0), and the kernels reproduce exactly that — the parts the
+// scalar code does in float are done in __m256 and the double parts
+// 4-wide in __m256d.  Bit-exactness matters because not every access path
+// is vectorized (e.g. CopyRowToVec is not), and mixing decoders that
+// differ even in the last ulp would make results depend on the access
+// pattern.
+
+// Converts ps to pd (by halves), adds "add" in double, and truncates to
+// int32, i.e. computes static_cast<int32>(v + add) with double-precision
+// rounding like the scalar encoders.
+__attribute__((target("avx2")))
+static inline __m256i AddRoundDouble(__m256 v, __m256d add) {
+  __m128i lo = _mm256_cvttpd_epi32(
+      _mm256_add_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(v)), add));
+  __m128i hi = _mm256_cvttpd_epi32(
+      _mm256_add_pd(_mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)), add));
+  return _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+}
+
+// Computes base + v * scale with v widened to double, like the scalar
+// decoder expressions p0 + (p25 - p0) * value * (1/64.0), in which the
+// float product (p25 - p0) * value gets multiplied and accumulated in
+// double and only the final result is rounded back to float.
+__attribute__((target("avx2")))
+static inline __m256 ScaleAddDouble(__m256 v, __m256d scale, __m256d base) {
+  __m128 lo = _mm256_cvtpd_ps(_mm256_add_pd(
+      base, _mm256_mul_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(v)), scale)));
+  __m128 hi = _mm256_cvtpd_ps(_mm256_add_pd(
+      base, _mm256_mul_pd(_mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)),
+                          scale)));
+  return _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1);
+}
+
+__attribute__((target("avx2")))
+static void FloatToCharAvx2(const float *in, int32 n,
+                            float p0, float p25, float p75, float p100,
+                            unsigned char *out) {
+  __m256 vp0 = _mm256_set1_ps(p0), vp25 = _mm256_set1_ps(p25),
+      vp75 = _mm256_set1_ps(p75),
+      vd0 = _mm256_set1_ps(p25 - p0), vd1 = _mm256_set1_ps(p75 - p25),
+      vd2 = _mm256_set1_ps(p100 - p75);
+  __m256d vhalf = _mm256_set1_pd(0.5);
+  int32 i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256 v = _mm256_loadu_ps(in + i);
+    // candidate codes for the three ranges; each is clamped to its range
+    // exactly as in the scalar code, then the right one is selected.
+    __m256i ia = AddRoundDouble(
+        _mm256_mul_ps(_mm256_div_ps(_mm256_sub_ps(v, vp0), vd0),
+                      _mm256_set1_ps(64.0f)), vhalf);
+    ia = _mm256_min_epi32(_mm256_max_epi32(ia, _mm256_setzero_si256()),
+                          _mm256_set1_epi32(64));
+    __m256i ib = _mm256_add_epi32(
+        _mm256_set1_epi32(64),
+        AddRoundDouble(
+            _mm256_mul_ps(_mm256_div_ps(_mm256_sub_ps(v, vp25), vd1),
+                          _mm256_set1_ps(128.0f)), vhalf));
+    ib = _mm256_min_epi32(_mm256_max_epi32(ib, _mm256_set1_epi32(64)),
+                          _mm256_set1_epi32(192));
+    __m256i ic = _mm256_add_epi32(
+        _mm256_set1_epi32(192),
+        AddRoundDouble(
+            _mm256_mul_ps(_mm256_div_ps(_mm256_sub_ps(v, vp75), vd2),
+                          _mm256_set1_ps(63.0f)), vhalf));
+    ic = _mm256_min_epi32(_mm256_max_epi32(ic, _mm256_set1_epi32(192)),
+                          _mm256_set1_epi32(255));
+    __m256i mask_a = _mm256_castps_si256(_mm256_cmp_ps(v, vp25, _CMP_LT_OQ)),
+        mask_b = _mm256_castps_si256(_mm256_cmp_ps(v, vp75, _CMP_LT_OQ));
+    __m256i ans = _mm256_blendv_epi8(ic, ib, mask_b);
+    ans = _mm256_blendv_epi8(ans, ia, mask_a);
+    // pack the eight int32 codes (all in [0, 255]) down to bytes.
+    __m128i p16 = _mm_packus_epi32(_mm256_castsi256_si128(ans),
+                                   _mm256_extracti128_si256(ans, 1));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i),
+                     _mm_packus_epi16(p16, p16));
+  }
+  for (; i < n; i++)
+    out[i] = FloatToCharScalar(p0, p25, p75, p100, in[i]);
+}
+
+__attribute__((target("avx2")))
+static void CharToFloatAvx2(const unsigned char *in, int32 n,
+                            float p0, float p25, float p75, float p100,
+                            float *out) {
+  __m256 vd0 = _mm256_set1_ps(p25 - p0), vd1 = _mm256_set1_ps(p75 - p25),
+      vd2 = _mm256_set1_ps(p100 - p75);
+  __m256d vb0 = _mm256_set1_pd(p0), vb1 = _mm256_set1_pd(p25),
+      vb2 = _mm256_set1_pd(p75),
+      vs0 = _mm256_set1_pd(1/64.0), vs1 = _mm256_set1_pd(1/128.0),
+      vs2 = _mm256_set1_pd(1/63.0);
+  int32 i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i vi = _mm256_cvtepu8_epi32(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + i)));
+    __m256 fa = ScaleAddDouble(
+        _mm256_mul_ps(vd0, _mm256_cvtepi32_ps(vi)), vs0, vb0);
+    __m256 fb = ScaleAddDouble(
+        _mm256_mul_ps(vd1, _mm256_cvtepi32_ps(
+            _mm256_sub_epi32(vi, _mm256_set1_epi32(64)))), vs1, vb1);
+    __m256 fc = ScaleAddDouble(
+        _mm256_mul_ps(vd2, _mm256_cvtepi32_ps(
+            _mm256_sub_epi32(vi, _mm256_set1_epi32(192)))), vs2, vb2);
+    __m256i mask_a = _mm256_cmpgt_epi32(_mm256_set1_epi32(65), vi),
+        mask_b = _mm256_cmpgt_epi32(_mm256_set1_epi32(193), vi);
+    __m256 ans = _mm256_blendv_ps(fc, fb, _mm256_castsi256_ps(mask_b));
+    ans = _mm256_blendv_ps(ans, fa, _mm256_castsi256_ps(mask_a));
+    _mm256_storeu_ps(out + i, ans);
+  }
+  for (; i < n; i++)
+    out[i] = CharToFloatScalar(p0, p25, p75, p100, in[i]);
+}
+
+__attribute__((target("avx2")))
+static void FloatToUint16Avx2(const float *in, int32 n,
+                              float min_value, float range,
+                              uint16 *out) {
+  __m256 vmin = _mm256_set1_ps(min_value), vrange = _mm256_set1_ps(range);
+  __m256d vround = _mm256_set1_pd(0.499);
+  int32 i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256 f = _mm256_div_ps(_mm256_sub_ps(_mm256_loadu_ps(in + i), vmin),
+                             vrange);
+    f = _mm256_min_ps(_mm256_max_ps(f, _mm256_setzero_ps()),
+                      _mm256_set1_ps(1.0f));
+    __m256i ans = AddRoundDouble(_mm256_mul_ps(f, _mm256_set1_ps(65535.0f)),
+                                 vround);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                     _mm_packus_epi32(_mm256_castsi256_si128(ans),
+                                      _mm256_extracti128_si256(ans, 1)));
+  }
+  for (; i < n; i++)
+    out[i] = FloatToUint16Scalar(min_value, range, in[i]);
+}
+
+__attribute__((target("avx2")))
+static void Uint16ToFloatAvx2(const uint16 *in, int32 n,
+                              float min_value, float range_scale,
+                              float *out) {
+  // range_scale is range * (1/65535), applied exactly as in the scalar
+  // Uint16ToFloat, whose arithmetic is all single precision.
+  __m256 vmin = _mm256_set1_ps(min_value), vrs = _mm256_set1_ps(range_scale);
+  int32 i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i vi = _mm256_cvtepu16_epi32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)));
+    _mm256_storeu_ps(out + i,
+                     _mm256_add_ps(vmin, _mm256_mul_ps(
+                         vrs, _mm256_cvtepi32_ps(vi))));
+  }
+  for (; i < n; i++)
+    out[i] = min_value + range_scale * in[i];
+}
+
+#endif  // KALDI_COMPRESSED_MATRIX_SIMD
+
 //static 
 MatrixIndexT CompressedMatrix::DataSize(const GlobalHeader &header) {
   // Returns size in bytes of the data.
@@ -113,6 +343,23 @@ void CompressedMatrix::CopyFromMat(
     uint16 *data = reinterpret_cast<uint16*>(static_cast<char*>(data_) +
                                              sizeof(GlobalHeader));
     int32 num_rows = mat.NumRows(), num_cols = mat.NumCols();
+#ifdef KALDI_COMPRESSED_MATRIX_SIMD
+    if (CodecSimdEnabled()) {
+      float buf[kCodecBlockSize];
+      for (int32 r = 0; r < num_rows; r++) {
+        const Real *row_data = mat.RowData(r);
+        for (int32 start = 0; start < num_cols; start += kCodecBlockSize) {
+          int32 this_n = std::min(num_cols - start, kCodecBlockSize);
+          for (int32 c = 0; c < this_n; c++)
+            buf[c] = row_data[start + c];
+          FloatToUint16Avx2(buf, this_n, global_header.min_value,
+                            global_header.range, data + start);
+        }
+        data += num_cols;
+      }
+      return;
+    }
+#endif
     for (int32 r = 0; r < num_rows; r++) {
       const Real *row_data = mat.RowData(r);
       for (int32 c = 0; c < num_cols; c++)
@@ -388,6 +635,18 @@ void CompressedMatrix::CompressColumn(
       p75 = Uint16ToFloat(global_header, header->percentile_75),
       p100 = Uint16ToFloat(global_header, header->percentile_100);
 
+#ifdef KALDI_COMPRESSED_MATRIX_SIMD
+  if (CodecSimdEnabled()) {
+    float buf[kCodecBlockSize];
+    for (int32 start = 0; start < num_rows; start += kCodecBlockSize) {
+      int32 this_n = std::min(num_rows - start, kCodecBlockSize);
+      for (int32 i = 0; i < this_n; i++)
+        buf[i] = data[(start + i) * stride];
+      FloatToCharAvx2(buf, this_n, p0, p25, p75, p100, byte_data + start);
+    }
+    return;
+  }
+#endif
   for (int32 i = 0; i < num_rows; i++) {
     Real this_data = data[i * stride];
     byte_data[i] = FloatToChar(p0, p25, p75, p100, this_data);
@@ -506,6 +765,25 @@ void CompressedMatrix::CopyToMat(MatrixBase<Real> *mat,
     PerColHeader *per_col_header = reinterpret_cast<PerColHeader*>(h+1);
     unsigned char *byte_data = reinterpret_cast<unsigned char*>(per_col_header +
                                                                 h->num_cols);
+#ifdef KALDI_COMPRESSED_MATRIX_SIMD
+    if (CodecSimdEnabled()) {
+      float buf[kCodecBlockSize];
+      for (int32 i = 0; i < num_cols;
+           i++, per_col_header++, byte_data += num_rows) {
+        float p0 = Uint16ToFloat(*h, per_col_header->percentile_0),
+            p25 = Uint16ToFloat(*h, per_col_header->percentile_25),
+            p75 = Uint16ToFloat(*h, per_col_header->percentile_75),
+            p100 = Uint16ToFloat(*h, per_col_header->percentile_100);
+        for (int32 start = 0; start < num_rows; start += kCodecBlockSize) {
+          int32 this_n = std::min(num_rows - start, kCodecBlockSize);
+          CharToFloatAvx2(byte_data + start, this_n, p0, p25, p75, p100, buf);
+          for (int32 j = 0; j < this_n; j++)
+            (*mat)(start + j, i) = buf[j];
+        }
+      }
+      return;
+    }
+#endif
     for (int32 i = 0; i < num_cols; i++, per_col_header++) {
       float p0 = Uint16ToFloat(*h, per_col_header->percentile_0),
           p25 = Uint16ToFloat(*h, per_col_header->percentile_25),
@@ -519,6 +797,24 @@ void CompressedMatrix::CopyToMat(MatrixBase<Real> *mat,
   } else {
     KALDI_ASSERT(h->format == 2);
     const uint16 *data = reinterpret_cast<const uint16*>(h + 1);
+#ifdef KALDI_COMPRESSED_MATRIX_SIMD
+    if (CodecSimdEnabled()) {
+      float buf[kCodecBlockSize];
+      float range_scale = h->range * 1.52590218966964e-05F;
+      for (int32 i = 0; i < num_rows; i++) {
+        Real *row_data = mat->RowData(i);
+        for (int32 start = 0; start < num_cols; start += kCodecBlockSize) {
+          int32 this_n = std::min(num_cols - start, kCodecBlockSize);
+          Uint16ToFloatAvx2(data + start, this_n, h->min_value, range_scale,
+                            buf);
+          for (int32 j = 0; j < this_n; j++)
+            row_data[start + j] = buf[j];
+        }
+        data += num_cols;
+      }
+      return;
+    }
+#endif
     for (int32 i = 0; i < num_rows; i++) {
       Real *row_data = mat->RowData(i);
       for (int32 j = 0; j < num_cols; j++)
@@ -697,5 +993,104 @@ CompressedMatrix &CompressedMatrix::operator = (const CompressedMatrix &mat) {
   return *this;
 }
 
+CompressedMatrixRowStream::CompressedMatrixRowStream(
+    const CompressedMatrix &mat, MatrixIndexT rows_per_block):
+    mat_(mat), rows_per_block_(rows_per_block),
+    block_begin_(-1), block_rows_(0) {
+  KALDI_ASSERT(rows_per_block_ > 0);
+  if (mat_.data_ == NULL) return;  // empty matrix; Row() may not be called.
+  CompressedMatrix::GlobalHeader *h =
+      reinterpret_cast<CompressedMatrix::GlobalHeader*>(mat_.data_);
+  if (rows_per_block_ > h->num_rows) rows_per_block_ = h->num_rows;
+  scratch_.Resize(rows_per_block_, h->num_cols, kUndefined);
+  if (h->format == 1) {
+    // Decode the four per-column percentile values up front, so each block
+    // only does the byte-to-float mapping.
+    CompressedMatrix::PerColHeader *per_col_header =
+        reinterpret_cast<CompressedMatrix::PerColHeader*>(h + 1);
+    col_percentiles_.resize(static_cast<size_t>(h->num_cols) * 4);
+    for (int32 i = 0; i < h->num_cols; i++, per_col_header++) {
+      float *p = &(col_percentiles_[static_cast<size_t>(i) * 4]);
+      p[0] = CompressedMatrix::Uint16ToFloat(*h, per_col_header->percentile_0);
+      p[1] = CompressedMatrix::Uint16ToFloat(*h, per_col_header->percentile_25);
+      p[2] = CompressedMatrix::Uint16ToFloat(*h, per_col_header->percentile_75);
+      p[3] = CompressedMatrix::Uint16ToFloat(*h,
+                                             per_col_header->percentile_100);
+    }
+  }
+}
+
+void CompressedMatrixRowStream::DecompressBlock(MatrixIndexT block_begin) {
+  CompressedMatrix::GlobalHeader *h =
+      reinterpret_cast<CompressedMatrix::GlobalHeader*>(mat_.data_);
+  int32 num_rows = h->num_rows, num_cols = h->num_cols;
+  block_begin_ = block_begin;
+  block_rows_ = std::min(rows_per_block_, num_rows - block_begin);
+  if (h->format == 1) {
+    CompressedMatrix::PerColHeader *per_col_header =
+        reinterpret_cast<CompressedMatrix::PerColHeader*>(h + 1);
+    const unsigned char *byte_data =
+        reinterpret_cast<const unsigned char*>(per_col_header + num_cols)
+        + block_begin;  // the byte data is stored column by column.
+#ifdef KALDI_COMPRESSED_MATRIX_SIMD
+    if (CodecSimdEnabled()) {
+      float buf[kCodecBlockSize];
+      for (int32 i = 0; i < num_cols; i++, byte_data += num_rows) {
+        const float *p = &(col_percentiles_[static_cast<size_t>(i) * 4]);
+        for (int32 start = 0; start < block_rows_; start += kCodecBlockSize) {
+          int32 this_n = std::min(block_rows_ - start, kCodecBlockSize);
+          CharToFloatAvx2(byte_data + start, this_n, p[0], p[1], p[2], p[3],
+                          buf);
+          for (int32 j = 0; j < this_n; j++)
+            scratch_(start + j, i) = buf[j];
+        }
+      }
+      return;
+    }
+#endif
+    for (int32 i = 0; i < num_cols; i++, byte_data += num_rows) {
+      const float *p = &(col_percentiles_[static_cast<size_t>(i) * 4]);
+      for (int32 j = 0; j < block_rows_; j++)
+        scratch_(j, i) = CompressedMatrix::CharToFloat(p[0], p[1], p[2], p[3],
+                                                       byte_data[j]);
+    }
+  } else {
+    KALDI_ASSERT(h->format == 2);
+    const uint16 *data = reinterpret_cast<const uint16*>(h + 1)
+        + static_cast<size_t>(block_begin) * num_cols;
+#ifdef KALDI_COMPRESSED_MATRIX_SIMD
+    if (CodecSimdEnabled()) {
+      float buf[kCodecBlockSize];
+      float range_scale = h->range * 1.52590218966964e-05F;
+      for (int32 j = 0; j < block_rows_; j++) {
+        BaseFloat *row_data = scratch_.RowData(j);
+        for (int32 start = 0; start < num_cols; start += kCodecBlockSize) {
+          int32 this_n = std::min(num_cols - start, kCodecBlockSize);
+          Uint16ToFloatAvx2(data + start, this_n, h->min_value, range_scale,
+                            buf);
+          for (int32 i = 0; i < this_n; i++)
+            row_data[start + i] = buf[i];
+        }
+        data += num_cols;
+      }
+      return;
+    }
+#endif
+    for (int32 j = 0; j < block_rows_; j++) {
+      BaseFloat *row_data = scratch_.RowData(j);
+      for (int32 i = 0; i < num_cols; i++)
+        row_data[i] = CompressedMatrix::Uint16ToFloat(*h, data[i]);
+      data += num_cols;
+    }
+  }
+}
+
+SubVector<BaseFloat> CompressedMatrixRowStream::Row(MatrixIndexT row) {
+  KALDI_ASSERT(row >= 0 && row < mat_.NumRows());
+  if (row < block_begin_ || row >= block_begin_ + block_rows_)
+    DecompressBlock((row / rows_per_block_) * rows_per_block_);
+  return scratch_.Row(row - block_begin_);
+}
+
 
 }  // namespace kaldi
@@ -21,6 +21,8 @@
 #ifndef KALDI_MATRIX_COMPRESSED_MATRIX_H_
 #define KALDI_MATRIX_COMPRESSED_MATRIX_H_ 1
 
+#include <vector>
+
 #include "kaldi-matrix.h"
 
 namespace kaldi {
@@ -113,9 +115,12 @@ class CompressedMatrix {
   void Swap(CompressedMatrix *other) { std::swap(data_, other->data_); }
 
   void Clear();
-  
+
   friend class Matrix<float>;
   friend class Matrix<double>;
+  friend class CompressedMatrixRowStream;
+  friend class CuCompressedMatrix;  // cudamatrix/cu-compressed-matrix.h; it
+  // uploads and downloads the raw compressed representation.
  private:
 
   // allocates data using new [], ensures byte alignment
@@ -170,6 +175,51 @@ class CompressedMatrix {
 
 };
 
+/// This class lets you scan the rows of a CompressedMatrix without
+/// decompressing the whole thing into a float matrix first: it decompresses
+/// a small block of rows at a time into a scratch buffer that is reused
+/// across calls, so the memory traffic stays proportional to the block
+/// size rather than to the matrix.  Use it in code that reads (possibly
+/// compressed) feature archives but only ever looks at rows sequentially,
+/// e.g. when extracting training examples.  The per-column dequantization
+/// parameters are decoded once in the constructor, not once per row.
+/// The CompressedMatrix must outlive the stream and not be modified
+/// while it is in use.
+class CompressedMatrixRowStream {
+ public:
+  /// "rows_per_block" is how many rows are decompressed at a time; the
+  /// scratch buffer is rows_per_block * NumCols() floats.  The default
+  /// keeps it around L1-cache-sized for typical feature dimensions.
+  explicit CompressedMatrixRowStream(const CompressedMatrix &mat,
+                                     MatrixIndexT rows_per_block = 16);
+
+  MatrixIndexT NumRows() const { return mat_.NumRows(); }
+  MatrixIndexT NumCols() const { return mat_.NumCols(); }
+
+  /// Returns row "row" as a sub-vector into the internal scratch buffer;
+  /// the data is only valid until the next call.  Rows should normally be
+  /// requested in nondecreasing order: random access also works, but each
+  /// access outside the currently decompressed block decompresses a whole
+  /// new block.
+  SubVector<BaseFloat> Row(MatrixIndexT row);
+
+ private:
+  // Decompresses rows [block_begin, min(block_begin + rows_per_block,
+  // num-rows)) into scratch_.
+  void DecompressBlock(MatrixIndexT block_begin);
+
+  const CompressedMatrix &mat_;
+  MatrixIndexT rows_per_block_;
+  MatrixIndexT block_begin_;    // first row currently in scratch_, or -1
+                                // if nothing is decompressed yet.
+  MatrixIndexT block_rows_;     // number of valid rows in scratch_.
+  Matrix<BaseFloat> scratch_;   // size rows_per_block_ x NumCols().
+  std::vector<float> col_percentiles_;  // for format 1: the four decoded
+                                        // percentile values per column.
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(CompressedMatrixRowStream);
+};
+
 /// @} end of \addtogroup matrix_group
 
 
@@ -48,6 +48,14 @@
 #error "Do not define more than one of HAVE_CLAPACK, HAVE_ATLAS and HAVE_MKL"
 #endif
 
+// Independently of which library is selected above, you can define
+// HAVE_KALDI_INTERNAL_GEMM (e.g. by adding -DHAVE_KALDI_INTERNAL_GEMM to the
+// CXXFLAGS at configure time) to make MatrixBase::AddMatMat() use the
+// built-in cache-blocked multiplication from matrix/blocked-gemm.h instead
+// of the library's gemm.  This is intended for hosts where only a reference
+// (untuned) BLAS is available, whose gemm can be an order of magnitude
+// slower; all other BLAS/LAPACK routines are still taken from the library.
+
 #ifdef HAVE_ATLAS
   extern "C" {
     #include <cblas.h>
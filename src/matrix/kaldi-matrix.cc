@@ -21,6 +21,10 @@
 // limitations under the License.
 
 #include "matrix/kaldi-matrix.h"
+#ifdef HAVE_KALDI_INTERNAL_GEMM
+#include "matrix/blocked-gemm.h"
+#endif
+#include "matrix/memory-pool.h"
 #include "matrix/sp-matrix.h"
 #include "matrix/jama-svd.h"
 #include "matrix/jama-eig.h"
@@ -170,9 +174,13 @@ void MatrixBase<Real>::AddMatMat(const Real alpha,
                || (transA == kTrans && transB == kTrans && A.num_rows_ == B.num_cols_ && A.num_cols_ == num_rows_ && B.num_rows_ == num_cols_));
   KALDI_ASSERT(&A !=  this && &B != this);
   if (num_rows_ == 0) return;
+#ifdef HAVE_KALDI_INTERNAL_GEMM
+  BlockedGemm(alpha, transA, A.data_, A.num_rows_, A.num_cols_, A.stride_,
+              transB, B.data_, B.stride_, beta, data_, num_rows_, num_cols_, stride_);
+#else
   cblas_Xgemm(alpha, transA, A.data_, A.num_rows_, A.num_cols_, A.stride_,
               transB, B.data_, B.stride_, beta, data_, num_rows_, num_cols_, stride_);
-
+#endif
 }
 
 template<typename Real>
@@ -501,10 +509,15 @@ void MatrixBase<Real>::AddMatMatElements(const Real alpha,
 }
 
 #if !defined(HAVE_ATLAS) && !defined(USE_KALDI_SVD)
+// From this dimension (of the smaller side) upwards, DestructiveSvd uses
+// the divide-and-conquer routine ?gesdd instead of ?gesvd; below it the
+// saving is negligible and we keep the long-established code path.
+static const MatrixIndexT kSvdDivideAndConquerDim = 100;
+
 // ****************************************************************************
 // ****************************************************************************
 template<typename Real>
-void MatrixBase<Real>::LapackGesvd(VectorBase<Real> *s, MatrixBase<Real> *U_in, 
+void MatrixBase<Real>::LapackGesvd(VectorBase<Real> *s, MatrixBase<Real> *U_in,
                                    MatrixBase<Real> *V_in) {
   KALDI_ASSERT(s != NULL && U_in != this && V_in != this);
 
@@ -580,6 +593,68 @@ void MatrixBase<Real>::LapackGesvd(VectorBase<Real> *s, MatrixBase<Real> *U_in,
   KALDI_MEMALIGN_FREE(p_work);
 }
 
+template<typename Real>
+bool MatrixBase<Real>::LapackGesdd(VectorBase<Real> *s, MatrixBase<Real> *U_in,
+                                   MatrixBase<Real> *V_in) {
+  KALDI_ASSERT(s != NULL && U_in != NULL && V_in != NULL &&
+               U_in != this && V_in != this);
+
+  // The dimension conventions are as in LapackGesvd above: LAPACK works in
+  // column order, so it sees the transpose of *this, and the U and V slots
+  // of ?gesdd are swapped relative to our U_in and V_in.
+  KaldiBlasInt M   = num_cols_;
+  KaldiBlasInt N   = num_rows_;
+  KaldiBlasInt LDA = Stride();
+
+  KALDI_ASSERT(N >= M);  // NumRows >= columns.
+  KALDI_ASSERT((int)U_in->num_rows_ == N && (int)U_in->num_cols_ == M);
+  KALDI_ASSERT((int)V_in->num_rows_ == M && (int)V_in->num_cols_ == M);
+  KALDI_ASSERT((int)s->Dim() == std::min(M, N));
+
+  KaldiBlasInt V_stride = V_in->Stride();
+  KaldiBlasInt U_stride = U_in->Stride();
+
+  KaldiBlasInt l_work = -1;
+  Real work_query;
+  KaldiBlasInt result;
+  char *job = const_cast<char*>("S");  // skinny Svd, as in LapackGesvd.
+  std::vector<KaldiBlasInt> i_work(8 * std::min(M, N));
+
+  // query for work space.
+  clapack_Xgesdd(job, &M, &N, data_, &LDA,
+                 s->Data(),
+                 V_in->Data(), &V_stride,
+                 U_in->Data(), &U_stride,
+                 &work_query, &l_work, &(i_work[0]),
+                 &result);
+
+  KALDI_ASSERT(result == 0 &&
+               "Call to CLAPACK ?gesdd_ called with wrong arguments");
+
+  // The + 1 guards against the query result having been rounded down when
+  // returned through a float.
+  l_work = static_cast<KaldiBlasInt>(work_query) + 1;
+  Real *p_work;
+  void *temp;
+  if ((p_work = static_cast<Real*>(
+          KALDI_MEMALIGN(16, sizeof(Real)*l_work, &temp))) == NULL)
+    throw std::bad_alloc();
+
+  // perform svd.
+  clapack_Xgesdd(job, &M, &N, data_, &LDA,
+                 s->Data(),
+                 V_in->Data(), &V_stride,
+                 U_in->Data(), &U_stride,
+                 p_work, &l_work, &(i_work[0]),
+                 &result);
+
+  KALDI_MEMALIGN_FREE(p_work);
+
+  KALDI_ASSERT(result >= 0 &&
+               "Call to CLAPACK ?gesdd_ called with wrong arguments");
+  return (result == 0);  // result > 0 means it did not converge.
+}
+
 #endif
 
 // Copy constructor.  Copies data to newly allocated memory.
@@ -642,8 +717,6 @@ inline void Matrix<Real>::Init(const MatrixIndexT rows,
   MatrixIndexT skip;
   MatrixIndexT real_cols;
   size_t size;
-  void *data;  // aligned memory block
-  void *temp;  // memory block to be really freed
 
   // compute the size of skip and real cols
   skip = ((16 / sizeof(Real)) - cols % (16 / sizeof(Real)))
@@ -651,16 +724,13 @@ inline void Matrix<Real>::Init(const MatrixIndexT rows,
   real_cols = cols + skip;
   size = static_cast<size_t>(rows) * static_cast<size_t>(real_cols)
       * sizeof(Real);
-  
-  // allocate the memory and set the right dimensions and parameters
-  if (NULL != (data = KALDI_MEMALIGN(16, size, &temp))) {
-    MatrixBase<Real>::data_        = static_cast<Real *> (data);
-    MatrixBase<Real>::num_rows_      = rows;
-    MatrixBase<Real>::num_cols_      = cols;
-    MatrixBase<Real>::stride_  = real_cols;
-  } else {
-    throw std::bad_alloc();
-  }
+
+  // allocate the memory (possibly reusing a pooled block, see
+  // matrix/memory-pool.h) and set the right dimensions and parameters
+  MatrixBase<Real>::data_ = static_cast<Real *>(PoolMemalign16(size));
+  MatrixBase<Real>::num_rows_      = rows;
+  MatrixBase<Real>::num_cols_      = cols;
+  MatrixBase<Real>::stride_  = real_cols;
 }
 
 template<typename Real>
@@ -972,9 +1042,14 @@ void Matrix<Real>::RemoveRow(MatrixIndexT i) {
 
 template<typename Real>
 void Matrix<Real>::Destroy() {
-  // we need to free the data block if it was defined
+  // we need to free the data block if it was defined.  The size we pass may
+  // undercount the allocation if RemoveRow() was called, which
+  // PoolMemalignFree() is documented to accept.
   if (NULL != MatrixBase<Real>::data_)
-    KALDI_MEMALIGN_FREE( MatrixBase<Real>::data_);
+    PoolMemalignFree(MatrixBase<Real>::data_,
+                     static_cast<size_t>(MatrixBase<Real>::num_rows_) *
+                     static_cast<size_t>(MatrixBase<Real>::stride_) *
+                     sizeof(Real));
   MatrixBase<Real>::data_ = NULL;
   MatrixBase<Real>::num_rows_ = MatrixBase<Real>::num_cols_
       = MatrixBase<Real>::stride_ = 0;
@@ -1175,26 +1250,14 @@ void MatrixBase<Real>::SetUnit() {
 
 template<typename Real>
 void MatrixBase<Real>::SetRandn() {
-  kaldi::RandomState rstate;
-  for (MatrixIndexT row = 0; row < num_rows_; row++) {
-    Real *row_data = this->RowData(row);
-    MatrixIndexT nc = (num_cols_ % 2 == 1) ? num_cols_ - 1 : num_cols_;
-    for (MatrixIndexT col = 0; col < nc; col += 2) {
-      kaldi::RandGauss2(row_data + col, row_data + col + 1, &rstate);
-    }
-    if (nc != num_cols_) row_data[nc] = static_cast<Real>(kaldi::RandGauss(&rstate));
-  }
+  for (MatrixIndexT row = 0; row < num_rows_; row++)
+    kaldi::RandGaussBatched(this->RowData(row), num_cols_);
 }
 
 template<typename Real>
 void MatrixBase<Real>::SetRandUniform() {
-  kaldi::RandomState rstate;
-  for (MatrixIndexT row = 0; row < num_rows_; row++) {
-    Real *row_data = this->RowData(row);
-    for (MatrixIndexT col = 0; col < num_cols_; col++, row_data++) {
-      *row_data = static_cast<Real>(kaldi::RandUniform(&rstate));
-    }
-  }
+  for (MatrixIndexT row = 0; row < num_rows_; row++)
+    kaldi::RandUniformBatched(this->RowData(row), num_cols_);
 }
 
 template<typename Real>
@@ -1617,6 +1680,17 @@ void MatrixBase<Real>::DestructiveSvd(VectorBase<Real> *s, MatrixBase<Real> *U,
 #if !defined(HAVE_ATLAS) && !defined(USE_KALDI_SVD)
   // "S" == skinny Svd (only one we support because of compatibility with Jama one which is only skinny),
   // "N"== no eigenvectors wanted.
+  if (U != NULL && Vt != NULL && num_cols_ >= kSvdDivideAndConquerDim) {
+    // Use the much faster divide-and-conquer routine for large problems.
+    // It destroys its input and can (very rarely) fail to converge, so work
+    // on a copy and fall through to ?gesvd on failure.
+    Matrix<Real> copy(*this);
+    if (copy.LapackGesdd(s, U, Vt)) {
+      if (prescale != 1.0) s->Scale(1.0/prescale);
+      return;
+    }
+    KALDI_WARN << "CLAPACK ?gesdd_ did not converge; retrying with ?gesvd_.";
+  }
   LapackGesvd(s, U, Vt);
 #else
   /*  if (num_rows_ > 1 && num_cols_ > 1 && (*this)(0, 0) == (*this)(1, 1)
@@ -682,6 +682,14 @@ class MatrixBase {
   // destroys *this!
   void LapackGesvd(VectorBase<Real> *s, MatrixBase<Real> *U,
                      MatrixBase<Real> *Vt);
+  // As LapackGesvd but uses the divide-and-conquer routine ?gesdd, which
+  // is much faster on large matrices (and runs multithreaded in threaded
+  // LAPACK builds).  ?gesdd cannot compute just one of U and Vt, so both
+  // must be non-NULL here.  Returns false if ?gesdd failed to converge
+  // (rare), in which case *this has been destroyed and the caller should
+  // retry with LapackGesvd on a copy.  Destroys *this!
+  bool LapackGesdd(VectorBase<Real> *s, MatrixBase<Real> *U,
+                   MatrixBase<Real> *Vt);
 #else
  protected:
   // destroys *this!
@@ -25,8 +25,10 @@
 #include <algorithm>
 #include <string>
 #include "matrix/cblas-wrappers.h"
+#include "matrix/simd-vector-kernels.h"
 #include "matrix/kaldi-vector.h"
 #include "matrix/kaldi-matrix.h"
+#include "matrix/memory-pool.h"
 #include "matrix/sp-matrix.h"
 #include "matrix/sparse-matrix.h"
 
@@ -37,6 +39,15 @@ Real VecVec(const VectorBase<Real> &a,
             const VectorBase<Real> &b) {
   MatrixIndexT adim = a.Dim();
   KALDI_ASSERT(adim == b.Dim());
+#ifdef KALDI_SIMD_VECTOR_KERNELS
+  // For short single-precision vectors the BLAS call overhead exceeds the
+  // work; use the inline kernel.  (The casts are no-ops in the float
+  // instantiation, which is the only one that takes this branch.)
+  if (sizeof(Real) == sizeof(float) && adim < simd::kBlasDimThreshold &&
+      simd::Enabled())
+    return simd::Dot(reinterpret_cast<const float*>(a.Data()),
+                     reinterpret_cast<const float*>(b.Data()), adim);
+#endif
   return cblas_Xdot(adim, a.Data(), 1, b.Data(), 1);
 }
 
@@ -75,6 +86,12 @@ void VectorBase<float>::AddVec(const float alpha,
                                const VectorBase<float> &v) {
   KALDI_ASSERT(dim_ == v.dim_);
   KALDI_ASSERT(&v != this);
+#ifdef KALDI_SIMD_VECTOR_KERNELS
+  if (dim_ < simd::kBlasDimThreshold && simd::Enabled()) {
+    simd::Axpy(dim_, alpha, v.Data(), data_);
+    return;
+  }
+#endif
   cblas_Xaxpy(dim_, alpha, v.Data(), 1, data_, 1);
 }
 
@@ -170,18 +187,8 @@ inline void Vector<Real>::Init(const MatrixIndexT dim) {
     this->data_ = NULL;
     return;
   }
-  MatrixIndexT size;
-  void *data;
-  void *free_data;
-
-  size = dim * sizeof(Real);
-
-  if ((data = KALDI_MEMALIGN(16, size, &free_data)) != NULL) {
-    this->data_ = static_cast<Real*> (data);
-    this->dim_ = dim;
-  } else {
-    throw std::bad_alloc();
-  }
+  this->data_ = static_cast<Real*>(PoolMemalign16(dim * sizeof(Real)));
+  this->dim_ = dim;
 }
 
 
@@ -288,9 +295,11 @@ void Vector<Real>::RemoveElement(MatrixIndexT i) {
 /// Deallocates memory and sets object to empty vector.
 template<typename Real>
 void Vector<Real>::Destroy() {
-  /// we need to free the data block if it was defined
+  /// we need to free the data block if it was defined.
+  /// Note: dim_ can be smaller than the allocation after RemoveElement(),
+  /// which PoolMemalignFree() is documented to accept.
   if (this->data_ != NULL)
-    KALDI_MEMALIGN_FREE(this->data_);
+    PoolMemalignFree(this->data_, this->dim_ * sizeof(Real));
   this->data_ = NULL;
   this->dim_ = 0;
 }
@@ -310,12 +319,7 @@ bool VectorBase<Real>::IsZero(Real cutoff) const {
 
 template<typename Real>
 void VectorBase<Real>::SetRandn() {
-  kaldi::RandomState rstate;
-  MatrixIndexT last = (Dim() % 2 == 1) ? Dim() - 1 : Dim();
-  for (MatrixIndexT i = 0; i < last; i += 2) {
-    kaldi::RandGauss2(data_ + i, data_ + i +1, &rstate);
-  }
-  if (Dim() != last) data_[last] = static_cast<Real>(kaldi::RandGauss(&rstate));
+  kaldi::RandGaussBatched(data_, Dim());
 }
 
 template<typename Real>
@@ -690,6 +694,14 @@ void VectorBase<Real>::CopyDiagFromPacked(const PackedMatrix<Real> &M) {
 
 template<typename Real>
 Real VectorBase<Real>::Sum() const {
+#ifdef KALDI_SIMD_VECTOR_KERNELS
+  // Only for short vectors: the scalar loop below accumulates in double,
+  // and we don't want to give that up where the vector is long enough for
+  // the accuracy difference to matter.
+  if (sizeof(Real) == sizeof(float) && dim_ < simd::kBlasDimThreshold &&
+      simd::Enabled())
+    return simd::Sum(reinterpret_cast<const float*>(data_), dim_);
+#endif
   double sum = 0.0;
   for (MatrixIndexT i = 0; i < dim_; i++) { sum += data_[i]; }
   return sum;
@@ -812,6 +824,11 @@ void VectorBase<Real>::ApplyAbs() {
 
 template<typename Real>
 MatrixIndexT VectorBase<Real>::ApplyFloor(Real floor_val) {
+#ifdef KALDI_SIMD_VECTOR_KERNELS
+  if (sizeof(Real) == sizeof(float) && simd::Enabled())
+    return simd::ApplyFloor(reinterpret_cast<float*>(data_), dim_,
+                            floor_val);
+#endif
   MatrixIndexT num_floored = 0;
   for (MatrixIndexT i = 0; i < dim_; i++) {
     if (data_[i] < floor_val) {
@@ -850,6 +867,19 @@ MatrixIndexT VectorBase<Real>::ApplyFloor(const VectorBase<Real> &floor_vec) {
 
 template<typename Real>
 Real VectorBase<Real>::ApplySoftMax() {
+#ifdef KALDI_SIMD_VECTOR_KERNELS
+  if (sizeof(Real) == sizeof(float) && dim_ > 0 && simd::Enabled()) {
+    // same algorithm as below, but with the max and the final scaling done
+    // by the inline kernels (Scale() would go through cblas); the exps
+    // remain scalar.
+    float *data = reinterpret_cast<float*>(data_);
+    float max = simd::Max(data, dim_), sum = 0.0;
+    for (MatrixIndexT i = 0; i < dim_; i++)
+      sum += (data[i] = Exp(data[i] - max));
+    simd::Scale(data, dim_, 1.0f / sum);
+    return max + Log(sum);
+  }
+#endif
   Real max = this->Max(), sum = 0.0;
   for (MatrixIndexT i = 0; i < dim_; i++) {
     sum += (data_[i] = Exp(data_[i] - max));
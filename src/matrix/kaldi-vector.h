@@ -479,7 +479,6 @@ class Vector: public VectorBase<Real> {
 
   /// Destroy function, called internally.
   void Destroy();
-
 };
 
 
@@ -0,0 +1,166 @@
+// matrix/matrix-benchmark.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+// Micro-benchmarks for the CPU matrix library, using the harness in
+// base/kaldi-benchmark.h.  Unlike matrix-lib-speed-test.cc this produces
+// machine-readable output (CSV by default) with the compiler, BLAS library
+// and CPU recorded, so numbers from different builds can be compared; see
+// the usage message for the options.
+
+#include <cstdlib>
+#include <iostream>
+
+#include "base/kaldi-benchmark.h"
+#include "matrix/matrix-lib.h"
+#include "matrix/compressed-matrix.h"
+
+namespace kaldi {
+
+// Each helper keeps its operands in function-local statics, initialized on
+// the first call, so per-iteration cost is just the operation itself.
+
+template<typename Real, int32 kDim>
+static void AddMatMatHelper() {
+  static Matrix<Real> a(kDim, kDim), b(kDim, kDim), c(kDim, kDim);
+  static bool init = false;
+  if (!init) { a.SetRandn(); b.SetRandn(); init = true; }
+  c.AddMatMat(1.0, a, kNoTrans, b, kNoTrans, 0.0);
+}
+
+template<typename Real, int32 kDim>
+static void AddMatVecHelper() {
+  static Matrix<Real> m(kDim, kDim);
+  static Vector<Real> v(kDim), w(kDim);
+  static bool init = false;
+  if (!init) { m.SetRandn(); v.SetRandn(); init = true; }
+  w.AddMatVec(1.0, m, kNoTrans, v, 0.0);
+}
+
+template<typename Real, int32 kDim>
+static void VecVecHelper() {
+  static Vector<Real> a(kDim), b(kDim);
+  static Real sink = 0;
+  static bool init = false;
+  if (!init) { a.SetRandn(); b.SetRandn(); init = true; }
+  sink += VecVec(a, b);  // the sink keeps the call from being optimized out.
+}
+
+template<typename Real, int32 kDim>
+static void AddVecHelper() {
+  static Vector<Real> a(kDim), b(kDim);
+  static bool init = false;
+  if (!init) { a.SetRandn(); b.SetRandn(); init = true; }
+  b.AddVec(0.001, a);
+}
+
+template<typename Real>
+static void RealFftHelper() {
+  static Vector<Real> orig(512), v(512);
+  static bool init = false;
+  if (!init) { orig.SetRandn(); init = true; }
+  v.CopyFromVec(orig);  // transform fresh data each time, else it blows up.
+  RealFft(&v, true);
+}
+
+template<typename Real>
+static void SplitRadixRealFftHelper() {
+  static SplitRadixRealFft<Real> srfft(512);
+  static Vector<Real> orig(512), v(512);
+  static bool init = false;
+  if (!init) { orig.SetRandn(); init = true; }
+  v.CopyFromVec(orig);
+  srfft.Compute(v.Data(), true);
+}
+
+// Matrix-matrix and matrix-vector products (what the BLAS build mostly
+// determines).
+void BenchmarkAddMatMatFloat256() { AddMatMatHelper<float, 256>(); }
+void BenchmarkAddMatMatFloat1024() { AddMatMatHelper<float, 1024>(); }
+void BenchmarkAddMatMatDouble256() { AddMatMatHelper<double, 256>(); }
+void BenchmarkAddMatVecFloat1024() { AddMatVecHelper<float, 1024>(); }
+KALDI_BENCHMARK(BenchmarkAddMatMatFloat256);
+KALDI_BENCHMARK(BenchmarkAddMatMatFloat1024);
+KALDI_BENCHMARK(BenchmarkAddMatMatDouble256);
+KALDI_BENCHMARK(BenchmarkAddMatVecFloat1024);
+
+// Short-vector operations from kaldi-vector.cc, where call overhead and the
+// compiler matter more than the BLAS.
+void BenchmarkVecVecFloat8() { VecVecHelper<float, 8>(); }
+void BenchmarkVecVecFloat64() { VecVecHelper<float, 64>(); }
+void BenchmarkVecVecFloat1024() { VecVecHelper<float, 1024>(); }
+void BenchmarkAddVecFloat8() { AddVecHelper<float, 8>(); }
+void BenchmarkAddVecFloat1024() { AddVecHelper<float, 1024>(); }
+KALDI_BENCHMARK(BenchmarkVecVecFloat8);
+KALDI_BENCHMARK(BenchmarkVecVecFloat64);
+KALDI_BENCHMARK(BenchmarkVecVecFloat1024);
+KALDI_BENCHMARK(BenchmarkAddVecFloat8);
+KALDI_BENCHMARK(BenchmarkAddVecFloat1024);
+
+// CompressedMatrix codecs, on a typical feature-matrix shape.
+void BenchmarkCompressedMatrixCompress() {
+  static Matrix<BaseFloat> feats(1000, 40);
+  static bool init = false;
+  if (!init) { feats.SetRandn(); init = true; }
+  CompressedMatrix cmat(feats);
+}
+void BenchmarkCompressedMatrixDecompress() {
+  static Matrix<BaseFloat> feats(1000, 40), out(1000, 40);
+  static CompressedMatrix cmat;
+  static bool init = false;
+  if (!init) { feats.SetRandn(); cmat.CopyFromMat(feats); init = true; }
+  cmat.CopyToMat(&out);
+}
+KALDI_BENCHMARK(BenchmarkCompressedMatrixCompress);
+KALDI_BENCHMARK(BenchmarkCompressedMatrixDecompress);
+
+// FFTs (512-point, a typical analysis-window size).
+void BenchmarkRealFftFloat512() { RealFftHelper<float>(); }
+void BenchmarkSplitRadixRealFftFloat512() { SplitRadixRealFftHelper<float>(); }
+KALDI_BENCHMARK(BenchmarkRealFftFloat512);
+KALDI_BENCHMARK(BenchmarkSplitRadixRealFftFloat512);
+
+}  // namespace kaldi
+
+int main(int argc, char *argv[]) {
+  using namespace kaldi;
+  // We parse the options by hand since the matrix directory does not depend
+  // on the util library where ParseOptions lives.
+  BenchmarkOptions opts;
+  for (int32 i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg.compare(0, 9, "--filter=") == 0) {
+      opts.filter = arg.substr(9);
+    } else if (arg.compare(0, 9, "--format=") == 0) {
+      opts.format = arg.substr(9);
+    } else if (arg.compare(0, 14, "--min-seconds=") == 0) {
+      opts.min_seconds = atof(arg.substr(14).c_str());
+    } else if (arg.compare(0, 15, "--warmup-iters=") == 0) {
+      opts.warmup_iters = atoi(arg.substr(15).c_str());
+    } else {
+      std::cerr << "Usage: matrix-benchmark [--filter=<substring>] "
+                << "[--format=csv|json] [--min-seconds=<float>] "
+                << "[--warmup-iters=<int>]\n"
+                << "Runs the matrix-kernel micro-benchmarks and writes the "
+                << "results to stdout.\n";
+      return 1;
+    }
+  }
+  BenchmarkRegistry::Instance()->RunAll(opts, std::cout);
+  return 0;
+}
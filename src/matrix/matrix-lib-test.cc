@@ -3701,7 +3701,26 @@ template<typename Real> static void UnitTestSplitRadixRealFft() {
   }
 }
 
-
+template<typename Real> static void UnitTestSplitRadixRealFftCache() {
+  for (MatrixIndexT p = 0; p < 10; p++) {
+    MatrixIndexT logn = 2 + Rand() % 9, N = 1 << logn;
+    const SplitRadixRealFft<Real> *srfft = GetSplitRadixRealFft<Real>(N);
+    // the cache must hand back the same plan for the same size.
+    KALDI_ASSERT(srfft == GetSplitRadixRealFft<Real>(N));
+    std::vector<Real> temp_buffer;
+    MatrixIndexT num_frames = 1 + Rand() % 5;
+    Matrix<Real> frames(num_frames, N);
+    frames.SetRandn();
+    Matrix<Real> frames2(frames);
+    srfft->ComputeBatch(&frames, true, &temp_buffer);
+    SplitRadixRealFft<Real> srfft2(N);
+    for (MatrixIndexT r = 0; r < num_frames; r++) {
+      srfft2.Compute(frames2.RowData(r), true);
+      SubVector<Real> row(frames, r), row2(frames2, r);
+      AssertEqual(row, row2, 0.001*N);
+    }
+  }
+}
 
 template<typename Real> static void UnitTestRealFftSpeed() {
 
@@ -4425,6 +4444,125 @@ static void UnitTestExtractCompressedMatrix() {
   }
 }
 
+template<typename Real> static void UnitTestSvdEigDivideAndConquer() {
+  // exercises the large-dimension paths of Svd and SpMatrix::Eig, which
+  // (on LAPACK builds) go through the divide-and-conquer routines
+  // ?gesdd/?syevd rather than the code used for small problems.
+  {
+    MatrixIndexT rows = 130, cols = 110;
+    Matrix<Real> M(rows, cols);
+    M.SetRandn();
+    Vector<Real> s(cols);
+    Matrix<Real> U(rows, cols), Vt(cols, cols);
+    M.Svd(&s, &U, &Vt);
+    Matrix<Real> Us(U);
+    Us.MulColsVec(s);
+    Matrix<Real> recon(rows, cols);
+    recon.AddMatMat(1.0, Us, kNoTrans, Vt, kNoTrans, 0.0);
+    AssertEqual(M, recon, 1.0e-04);
+  }
+  {
+    MatrixIndexT dim = 90;
+    SpMatrix<Real> S(dim);
+    S.SetRandn();
+    Vector<Real> eigs(dim);
+    Matrix<Real> P(dim, dim);
+    S.Eig(&eigs, &P);
+    Matrix<Real> Pd(P);
+    Pd.MulColsVec(eigs);
+    Matrix<Real> recon(dim, dim);
+    recon.AddMatMat(1.0, Pd, kNoTrans, P, kTrans, 0.0);
+    Matrix<Real> Sfull(dim, dim);
+    Sfull.CopyFromSp(S);
+    AssertEqual(Sfull, recon, 1.0e-04);
+  }
+}
+
+static void UnitTestCompressedMatrixRowStream() {
+  for (int32 i = 0; i < 30; i++) {
+    // make sure we sometimes get the small-matrix format (<= 8 rows) and
+    // block sizes both smaller and larger than the number of rows.
+    MatrixIndexT num_rows = 1 + Rand() % 20, num_cols = 1 + Rand() % 30,
+        rows_per_block = 1 + Rand() % 10;
+    Matrix<BaseFloat> mat(num_rows, num_cols);
+    mat.SetRandn();
+    CompressedMatrix cmat(mat);
+    Matrix<BaseFloat> mat2(num_rows, num_cols);
+    cmat.CopyToMat(&mat2);
+
+    CompressedMatrixRowStream stream(cmat, rows_per_block);
+    KALDI_ASSERT(stream.NumRows() == num_rows &&
+                 stream.NumCols() == num_cols);
+    for (MatrixIndexT r = 0; r < num_rows; r++) {
+      SubVector<BaseFloat> row(stream.Row(r));
+      if (!row.ApproxEqual(mat2.Row(r), 1.0e-06))
+        KALDI_ERR << "Streamed row " << r << " differs: " << row
+                  << " vs. " << mat2.Row(r);
+    }
+    // spot-check random access (which re-decompresses blocks).
+    for (int32 j = 0; j < 5; j++) {
+      MatrixIndexT r = Rand() % num_rows;
+      KALDI_ASSERT(stream.Row(r).ApproxEqual(mat2.Row(r), 1.0e-06));
+    }
+  }
+}
+
+template<typename Real>
+static void UnitTestMemoryPool() {
+  SetMatrixVectorPooling(true);
+  KALDI_ASSERT(MatrixVectorPoolingEnabled());
+#ifndef _MSC_VER
+  { // destroying and re-creating a same-shape matrix should reuse the
+    // pooled block (we're single-threaded here, so this is deterministic).
+    Real *ptr;
+    {
+      Matrix<Real> M(50, 40, kUndefined);
+      ptr = M.Data();
+    }
+    Matrix<Real> M2(50, 40, kUndefined);
+    KALDI_ASSERT(M2.Data() == ptr);
+  }
+  { // likewise for (heap-allocated) vectors.
+    Real *ptr;
+    {
+      Vector<Real> v(1000, kUndefined);
+      ptr = v.Data();
+    }
+    Vector<Real> v2(1000, kUndefined);
+    KALDI_ASSERT(v2.Data() == ptr);
+  }
+#endif
+  // swap vectors of assorted (including very lopsided) sizes.
+  for (int32 i = 0; i < 20; i++) {
+    MatrixIndexT dim1 = Rand() % 10,
+        dim2 = (Rand() % 2 == 0 ? Rand() % 10 : 200 + Rand() % 100);
+    Vector<Real> v1(dim1), v2(dim2);
+    v1.SetRandn();
+    v2.SetRandn();
+    Vector<Real> c1(v1), c2(v2);
+    v1.Swap(&v2);
+    AssertEqual(v1, c2);
+    AssertEqual(v2, c1);
+  }
+  { // resize with kCopyData, growing and then shrinking.
+    Vector<Real> v(5);
+    v.SetRandn();
+    Vector<Real> orig(v);
+    v.Resize(300, kCopyData);
+    for (MatrixIndexT i = 0; i < 300; i++)
+      KALDI_ASSERT(v(i) == (i < 5 ? orig(i) : Real(0)));
+    v.Resize(3, kCopyData);
+    for (MatrixIndexT i = 0; i < 3; i++)
+      KALDI_ASSERT(v(i) == orig(i));
+  }
+  { // RemoveElement() makes dim_ undercount the allocation; the destructor
+    // and the pool must cope with that.
+    Vector<Real> v(300, kUndefined);
+    v.SetRandn();
+    v.RemoveElement(10);
+  }
+  SetMatrixVectorPooling(false);
+}
 
 template<typename Real>
 static void UnitTestTridiag() {
@@ -4548,11 +4686,14 @@ template<typename Real> static void MatrixUnitTest(bool full_test) {
   // UnitTestSvdBad<Real>(); // test bug in Jama SVD code.
   UnitTestCompressedMatrix<Real>();
   UnitTestExtractCompressedMatrix<Real>();
+  UnitTestCompressedMatrixRowStream();
   UnitTestResize<Real>();
+  UnitTestMemoryPool<Real>();
   UnitTestMatrixExponentialBackprop();
   UnitTestMatrixExponential<Real>();
   UnitTestNonsymmetricPower<Real>();
   UnitTestEigSymmetric<Real>();
+  UnitTestSvdEigDivideAndConquer<Real>();
   KALDI_LOG << " Point A";
   UnitTestComplexPower<Real>();
   UnitTestEig<Real>();
@@ -4570,6 +4711,7 @@ template<typename Real> static void MatrixUnitTest(bool full_test) {
   UnitTestRealFft<Real>();
   KALDI_LOG << " Point C";
   UnitTestSplitRadixRealFft<Real>();
+  UnitTestSplitRadixRealFftCache<Real>();
   UnitTestSvd<Real>();
   UnitTestSvdNodestroy<Real>();
   UnitTestSvdJustvec<Real>();
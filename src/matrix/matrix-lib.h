@@ -33,6 +33,7 @@
 #include "matrix/compressed-matrix.h"
 #include "matrix/sparse-matrix.h"
 #include "matrix/optimization.h"
+#include "matrix/memory-pool.h"
 
 #endif
 
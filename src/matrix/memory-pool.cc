@@ -0,0 +1,132 @@
+// matrix/memory-pool.cc
+
+// Copyright 2014   Johns Hopkins University
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <map>
+#include <vector>
+
+#include "matrix/memory-pool.h"
+#include "base/kaldi-common.h"
+
+#ifndef _MSC_VER
+#include <pthread.h>
+#endif
+
+namespace kaldi {
+
+// Process-wide switch; reads are not synchronized, which is fine because
+// PoolMemalignFree() never assumes a block came from the pool (blocks are
+// always allocated with KALDI_MEMALIGN and freeable with
+// KALDI_MEMALIGN_FREE, whichever mode they were obtained in).
+static bool g_pooling_enabled = false;
+
+void SetMatrixVectorPooling(bool enable) { g_pooling_enabled = enable; }
+
+bool MatrixVectorPoolingEnabled() { return g_pooling_enabled; }
+
+#ifndef _MSC_VER
+
+namespace {
+
+// Caps on what one thread may cache: beyond these we fall through to the
+// system allocator, so a burst of unusually shaped temporaries cannot pin
+// memory for the rest of the run.
+const size_t kMaxBlocksPerBucket = 8;
+const size_t kMaxCachedBytes = size_t(64) << 20;  // 64MB per thread.
+
+struct MemoryPool {
+  // Freed blocks, keyed by the byte size they were requested with.
+  std::map<size_t, std::vector<void*> > buckets;
+  size_t cached_bytes;
+  MemoryPool(): cached_bytes(0) { }
+  ~MemoryPool() {
+    std::map<size_t, std::vector<void*> >::iterator iter = buckets.begin(),
+        end = buckets.end();
+    for (; iter != end; ++iter)
+      for (size_t i = 0; i < iter->second.size(); i++)
+        KALDI_MEMALIGN_FREE(iter->second[i]);
+  }
+};
+
+pthread_key_t g_pool_key;
+pthread_once_t g_pool_once = PTHREAD_ONCE_INIT;
+
+extern "C" void DeleteMemoryPool(void *pool) {
+  delete static_cast<MemoryPool*>(pool);
+}
+
+void CreatePoolKey() {
+  int ret = pthread_key_create(&g_pool_key, DeleteMemoryPool);
+  if (ret != 0)
+    KALDI_ERR << "Cannot create thread-local key for memory pool, error is: "
+              << ret;
+}
+
+MemoryPool *GetThisThreadsPool() {
+  pthread_once(&g_pool_once, CreatePoolKey);
+  MemoryPool *pool =
+      static_cast<MemoryPool*>(pthread_getspecific(g_pool_key));
+  if (pool == NULL) {
+    pool = new MemoryPool();
+    pthread_setspecific(g_pool_key, pool);
+  }
+  return pool;
+}
+
+}  // namespace
+
+#endif  // !defined(_MSC_VER)
+
+void *PoolMemalign16(size_t size) {
+#ifndef _MSC_VER
+  if (g_pooling_enabled) {
+    MemoryPool *pool = GetThisThreadsPool();
+    std::map<size_t, std::vector<void*> >::iterator iter =
+        pool->buckets.find(size);
+    if (iter != pool->buckets.end() && !iter->second.empty()) {
+      void *ans = iter->second.back();
+      iter->second.pop_back();
+      pool->cached_bytes -= size;
+      return ans;
+    }
+  }
+#endif
+  void *data;  // aligned memory block
+  void *temp;  // memory block to be really freed
+  if ((data = KALDI_MEMALIGN(16, size, &temp)) == NULL)
+    throw std::bad_alloc();
+  return data;
+}
+
+void PoolMemalignFree(void *ptr, size_t size) {
+#ifndef _MSC_VER
+  if (g_pooling_enabled) {
+    MemoryPool *pool = GetThisThreadsPool();
+    std::vector<void*> &bucket = pool->buckets[size];
+    if (bucket.size() < kMaxBlocksPerBucket &&
+        pool->cached_bytes + size <= kMaxCachedBytes) {
+      bucket.push_back(ptr);
+      pool->cached_bytes += size;
+      return;
+    }
+  }
+#endif
+  KALDI_MEMALIGN_FREE(ptr);
+}
+
+}  // namespace kaldi
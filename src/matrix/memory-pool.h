@@ -0,0 +1,61 @@
+// matrix/memory-pool.h
+
+// Copyright 2014   Johns Hopkins University
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_MATRIX_MEMORY_POOL_H_
+#define KALDI_MATRIX_MEMORY_POOL_H_
+
+#include <cstddef>
+
+namespace kaldi {
+
+/// @addtogroup matrix_group
+/// @{
+
+/// Enables or disables pooling of the aligned memory blocks allocated by
+/// Matrix::Resize() and Vector::Resize().  When enabled, freed blocks go
+/// into a per-thread free-list keyed by block size instead of back to the
+/// system allocator, so code that creates millions of short-lived
+/// same-shape temporaries (e.g. neural-net training) mostly stops calling
+/// into the allocator at all.  It is off by default and intended to be
+/// switched on once at the top of programs known to benefit; it is safe to
+/// enable or disable at any time (blocks allocated in either mode may be
+/// freed in the other).  Each thread caches at most a fixed number of
+/// blocks per size and a bounded total (see memory-pool.cc); the cache is
+/// freed when the thread exits.  On Windows this is a no-op.
+void SetMatrixVectorPooling(bool enable);
+
+bool MatrixVectorPoolingEnabled();
+
+/// Internal-use allocator behind the pooling above: returns a 16-byte
+/// aligned block of the given size, from the calling thread's pool if
+/// possible.  Throws std::bad_alloc on failure.  Called by
+/// Matrix/Vector::Init(); user code should not need it.
+void *PoolMemalign16(size_t size);
+
+/// Frees (or, if pooling is enabled, caches) a block obtained from
+/// PoolMemalign16().  "size" must be the size the block was requested
+/// with, or a smaller value (a smaller value just wastes the excess if the
+/// block gets reused; this can happen after Matrix::RemoveRow()).
+void PoolMemalignFree(void *ptr, size_t size);
+
+/// @} end of \addtogroup matrix_group
+
+}  // namespace kaldi
+
+#endif  // KALDI_MATRIX_MEMORY_POOL_H_
@@ -429,12 +429,62 @@ void SpMatrix<Real>::Qr(MatrixBase<Real> *Q) {
   }
 }
 
+#if !defined(HAVE_ATLAS)
+// From this dimension upwards, Eig() tries the LAPACK divide-and-conquer
+// routine ?syevd before the QR-based code below; on large problems (e.g.
+// the 10k-dim eigenproblems in LDA/MLLT estimation) it is dramatically
+// faster, and it runs multithreaded in threaded LAPACK builds.
+static const MatrixIndexT kEigDivideAndConquerDim = 64;
+
+// Attempts the eigendecomposition via ?syevd; returns false if LAPACK
+// reported failure (in which case s and P are undefined and the caller
+// should use the QR-based code).
+template<typename Real>
+static bool EigInternalLapack(const SpMatrix<Real> &S, VectorBase<Real> *s,
+                              MatrixBase<Real> *P) {
+  MatrixIndexT dim = S.NumRows();
+  Matrix<Real> A_mat(dim, dim, kUndefined);
+  A_mat.CopyFromSp(S);
+  KaldiBlasInt n = dim, lda = A_mat.Stride(), l_work = -1, l_iwork = -1,
+      result;
+  Real work_query;
+  KaldiBlasInt iwork_query;
+  char *jobz = const_cast<char*>(P != NULL ? "V" : "N"),
+      *uplo = const_cast<char*>("L");
+  // workspace query.
+  clapack_Xsyevd(jobz, uplo, &n, A_mat.Data(), &lda, s->Data(),
+                 &work_query, &l_work, &iwork_query, &l_iwork, &result);
+  if (result != 0) return false;
+  // the + 1 guards against the query result having been rounded down when
+  // returned through a float.
+  l_work = static_cast<KaldiBlasInt>(work_query) + 1;
+  l_iwork = iwork_query;
+  std::vector<Real> work(l_work);
+  std::vector<KaldiBlasInt> i_work(l_iwork);
+  clapack_Xsyevd(jobz, uplo, &n, A_mat.Data(), &lda, s->Data(),
+                 &(work[0]), &l_work, &(i_work[0]), &l_iwork, &result);
+  if (result != 0) return false;
+  // LAPACK worked in column order, so it has left the eigenvectors in the
+  // *rows* of A_mat; make them the columns of P, as our interface promises.
+  if (P != NULL) P->CopyFromMat(A_mat, kTrans);
+  return true;
+}
+#endif
+
 template<typename Real>
 void SpMatrix<Real>::Eig(VectorBase<Real> *s, MatrixBase<Real> *P) const {
   MatrixIndexT dim = this->NumRows();
   KALDI_ASSERT(s->Dim() == dim);
   KALDI_ASSERT(P == NULL || (P->NumRows() == dim && P->NumCols() == dim));
 
+#if !defined(HAVE_ATLAS)
+  if (dim >= kEigDivideAndConquerDim) {
+    if (EigInternalLapack(*this, s, P)) return;
+    KALDI_WARN << "LAPACK ?syevd_ failed for dimension " << dim
+               << "; falling back to the QR-based eigensolver.";
+  }
+#endif
+
   SpMatrix<Real> A(*this); // Copy *this, since the tridiagonalization
   // and QR decomposition are destructive.
   // Note: for efficiency of memory access, the tridiagonalization
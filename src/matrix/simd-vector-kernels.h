@@ -0,0 +1,237 @@
+// matrix/simd-vector-kernels.h
+
+// Copyright 2014   Johns Hopkins University
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_MATRIX_SIMD_VECTOR_KERNELS_H_
+#define KALDI_MATRIX_SIMD_VECTOR_KERNELS_H_
+
+#include "base/cpu-features.h"
+#include "matrix/matrix-common.h"
+
+// This header provides inline single-precision SIMD kernels for a few
+// element-wise vector operations (dot product, axpy, sum, max, scale,
+// floor), used from kaldi-vector.cc.  For the short vectors that dominate
+// the feature and transform code (dimensions in the teens to forties), the
+// function-pointer indirection and argument checking inside a BLAS call
+// costs more than the arithmetic itself, so below simd::kBlasDimThreshold
+// we use these kernels instead of cblas.  Where it pays off (dot, axpy,
+// sum) an AVX variant is selected over the SSE2 baseline the first time a
+// kernel runs, via GetCpuSimdLevel() (see base/cpu-features.h), so one
+// binary serves all hosts and the KALDI_SIMD environment variable can force
+// a lower level (KALDI_SIMD=generic disables these kernels entirely; the
+// call sites check simd::Enabled()).
+//
+// As elsewhere (see the similar block in gmm/diag-gmm.cc), this is enabled
+// only for GCC on x86_64, where SSE2 and the target attribute are
+// guaranteed to be available; other configurations keep the existing code
+// paths.
+
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && \
+    (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 8))
+#define KALDI_SIMD_VECTOR_KERNELS 1
+
+#include <immintrin.h>
+
+namespace kaldi {
+namespace simd {
+
+// Above this dimension we let the configured BLAS handle dot and axpy: a
+// tuned BLAS wins on long vectors, and the call overhead is amortized.
+static const MatrixIndexT kBlasDimThreshold = 128;
+
+// Whether the kernels in this header should be used at all; false only
+// under the KALDI_SIMD=generic override (the detected level on x86-64 is
+// always at least sse2).  Call sites test this before the dim threshold.
+inline bool Enabled() {
+  static const bool enabled = (GetCpuSimdLevel() >= kSimdSse2);
+  return enabled;
+}
+
+inline float HorizontalSum(__m128 v) {
+  __m128 hi = _mm_add_ps(v, _mm_movehl_ps(v, v));
+  hi = _mm_add_ss(hi, _mm_shuffle_ps(hi, hi, 0x1));
+  return _mm_cvtss_f32(hi);
+}
+
+inline float DotSse2(const float *a, const float *b, MatrixIndexT dim) {
+  __m128 sum0 = _mm_setzero_ps(), sum1 = _mm_setzero_ps();
+  MatrixIndexT i = 0;
+  for (; i + 8 <= dim; i += 8) {
+    sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + i),
+                                       _mm_loadu_ps(b + i)));
+    sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 4),
+                                       _mm_loadu_ps(b + i + 4)));
+  }
+  if (i + 4 <= dim) {
+    sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + i),
+                                       _mm_loadu_ps(b + i)));
+    i += 4;
+  }
+  float sum = HorizontalSum(_mm_add_ps(sum0, sum1));
+  for (; i < dim; i++) sum += a[i] * b[i];
+  return sum;
+}
+
+__attribute__((target("avx")))
+inline float DotAvx(const float *a, const float *b, MatrixIndexT dim) {
+  __m256 sum0 = _mm256_setzero_ps(), sum1 = _mm256_setzero_ps();
+  MatrixIndexT i = 0;
+  for (; i + 16 <= dim; i += 16) {
+    sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(_mm256_loadu_ps(a + i),
+                                             _mm256_loadu_ps(b + i)));
+    sum1 = _mm256_add_ps(sum1, _mm256_mul_ps(_mm256_loadu_ps(a + i + 8),
+                                             _mm256_loadu_ps(b + i + 8)));
+  }
+  if (i + 8 <= dim) {
+    sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(_mm256_loadu_ps(a + i),
+                                             _mm256_loadu_ps(b + i)));
+    i += 8;
+  }
+  __m256 sum8 = _mm256_add_ps(sum0, sum1);
+  float sum = HorizontalSum(_mm_add_ps(_mm256_castps256_ps128(sum8),
+                                       _mm256_extractf128_ps(sum8, 1)));
+  for (; i < dim; i++) sum += a[i] * b[i];
+  return sum;
+}
+
+inline float Dot(const float *a, const float *b, MatrixIndexT dim) {
+  static const bool have_avx = (GetCpuSimdLevel() >= kSimdAvx);
+  return have_avx ? DotAvx(a, b, dim) : DotSse2(a, b, dim);
+}
+
+inline void AxpySse2(MatrixIndexT dim, float alpha, const float *x,
+                     float *y) {
+  __m128 va = _mm_set1_ps(alpha);
+  MatrixIndexT i = 0;
+  for (; i + 4 <= dim; i += 4)
+    _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i),
+                                    _mm_mul_ps(va, _mm_loadu_ps(x + i))));
+  for (; i < dim; i++) y[i] += alpha * x[i];
+}
+
+__attribute__((target("avx")))
+inline void AxpyAvx(MatrixIndexT dim, float alpha, const float *x,
+                    float *y) {
+  __m256 va = _mm256_set1_ps(alpha);
+  MatrixIndexT i = 0;
+  for (; i + 8 <= dim; i += 8)
+    _mm256_storeu_ps(y + i,
+                     _mm256_add_ps(_mm256_loadu_ps(y + i),
+                                   _mm256_mul_ps(va, _mm256_loadu_ps(x + i))));
+  for (; i < dim; i++) y[i] += alpha * x[i];
+}
+
+inline void Axpy(MatrixIndexT dim, float alpha, const float *x, float *y) {
+  static const bool have_avx = (GetCpuSimdLevel() >= kSimdAvx);
+  if (have_avx) AxpyAvx(dim, alpha, x, y);
+  else AxpySse2(dim, alpha, x, y);
+}
+
+inline float SumSse2(const float *x, MatrixIndexT dim) {
+  __m128 sum0 = _mm_setzero_ps(), sum1 = _mm_setzero_ps();
+  MatrixIndexT i = 0;
+  for (; i + 8 <= dim; i += 8) {
+    sum0 = _mm_add_ps(sum0, _mm_loadu_ps(x + i));
+    sum1 = _mm_add_ps(sum1, _mm_loadu_ps(x + i + 4));
+  }
+  if (i + 4 <= dim) {
+    sum0 = _mm_add_ps(sum0, _mm_loadu_ps(x + i));
+    i += 4;
+  }
+  float sum = HorizontalSum(_mm_add_ps(sum0, sum1));
+  for (; i < dim; i++) sum += x[i];
+  return sum;
+}
+
+__attribute__((target("avx")))
+inline float SumAvx(const float *x, MatrixIndexT dim) {
+  __m256 sum0 = _mm256_setzero_ps(), sum1 = _mm256_setzero_ps();
+  MatrixIndexT i = 0;
+  for (; i + 16 <= dim; i += 16) {
+    sum0 = _mm256_add_ps(sum0, _mm256_loadu_ps(x + i));
+    sum1 = _mm256_add_ps(sum1, _mm256_loadu_ps(x + i + 8));
+  }
+  if (i + 8 <= dim) {
+    sum0 = _mm256_add_ps(sum0, _mm256_loadu_ps(x + i));
+    i += 8;
+  }
+  __m256 sum8 = _mm256_add_ps(sum0, sum1);
+  float sum = HorizontalSum(_mm_add_ps(_mm256_castps256_ps128(sum8),
+                                       _mm256_extractf128_ps(sum8, 1)));
+  for (; i < dim; i++) sum += x[i];
+  return sum;
+}
+
+inline float Sum(const float *x, MatrixIndexT dim) {
+  static const bool have_avx = (GetCpuSimdLevel() >= kSimdAvx);
+  return have_avx ? SumAvx(x, dim) : SumSse2(x, dim);
+}
+
+// The remaining kernels are SSE2-only: they are load/store bound, so a
+// wider variant would gain little.
+
+inline float Max(const float *x, MatrixIndexT dim) {
+  // caller guarantees dim > 0.
+  float max = x[0];
+  MatrixIndexT i = 1;
+  if (dim >= 8) {
+    __m128 vmax = _mm_loadu_ps(x);
+    for (i = 4; i + 4 <= dim; i += 4)
+      vmax = _mm_max_ps(vmax, _mm_loadu_ps(x + i));
+    vmax = _mm_max_ps(vmax, _mm_movehl_ps(vmax, vmax));
+    vmax = _mm_max_ss(vmax, _mm_shuffle_ps(vmax, vmax, 0x1));
+    max = _mm_cvtss_f32(vmax);
+  }
+  for (; i < dim; i++)
+    if (x[i] > max) max = x[i];
+  return max;
+}
+
+inline void Scale(float *x, MatrixIndexT dim, float alpha) {
+  __m128 va = _mm_set1_ps(alpha);
+  MatrixIndexT i = 0;
+  for (; i + 4 <= dim; i += 4)
+    _mm_storeu_ps(x + i, _mm_mul_ps(va, _mm_loadu_ps(x + i)));
+  for (; i < dim; i++) x[i] *= alpha;
+}
+
+// Floors the elements of x at floor_val and returns how many were floored
+// (counted from the comparison mask, so there is no branch per element).
+inline MatrixIndexT ApplyFloor(float *x, MatrixIndexT dim, float floor_val) {
+  __m128 vf = _mm_set1_ps(floor_val);
+  MatrixIndexT i = 0, num_floored = 0;
+  for (; i + 4 <= dim; i += 4) {
+    __m128 v = _mm_loadu_ps(x + i);
+    num_floored += __builtin_popcount(_mm_movemask_ps(_mm_cmplt_ps(v, vf)));
+    _mm_storeu_ps(x + i, _mm_max_ps(v, vf));
+  }
+  for (; i < dim; i++) {
+    if (x[i] < floor_val) {
+      x[i] = floor_val;
+      num_floored++;
+    }
+  }
+  return num_floored;
+}
+
+}  // namespace simd
+}  // namespace kaldi
+
+#endif  // GCC on x86_64
+
+#endif  // KALDI_MATRIX_SIMD_VECTOR_KERNELS_H_
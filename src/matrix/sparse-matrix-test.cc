@@ -202,6 +202,78 @@ void UnitTestSparseMatrixTraceMatSmat() {
   }
 }
 
+template <typename Real>
+void UnitTestCsrSparseMatrixConversion() {
+  for (int32 i = 0; i < 10; i++) {
+    MatrixIndexT row = 10 + Rand() % 40;
+    MatrixIndexT col = 10 + Rand() % 50;
+
+    SparseMatrix<Real> smat(row, col);
+    smat.SetRandn(0.8);
+
+    CsrSparseMatrix<Real> csr(smat);
+    KALDI_ASSERT(csr.NumRows() == row && csr.NumCols() == col &&
+                 csr.NumElements() == smat.NumElements());
+    AssertEqual(csr.Sum(), smat.Sum(), 0.00001);
+
+    // conversion must round-trip exactly.
+    SparseMatrix<Real> smat2;
+    csr.CopyToSmat(&smat2);
+    Matrix<Real> mat1(row, col), mat2(row, col);
+    smat.CopyToMat(&mat1);
+    smat2.CopyToMat(&mat2);
+    AssertEqual(mat1, mat2, 0.0);
+
+    // CopyToMat and AddToMat must agree with the SparseMatrix versions,
+    // in both the kNoTrans and kTrans cases.
+    Matrix<Real> mat3(row, col);
+    mat3.SetRandn();
+    csr.CopyToMat(&mat3);
+    AssertEqual(mat1, mat3, 0.0);
+
+    Matrix<Real> mat4(col, row), mat5(col, row);
+    smat.CopyToMat(&mat4, kTrans);
+    csr.CopyToMat(&mat5, kTrans);
+    AssertEqual(mat4, mat5, 0.0);
+
+    Matrix<Real> mat6(row, col);
+    mat6.SetRandn();
+    Matrix<Real> mat7(mat6);
+    smat.AddToMat(0.7, &mat6);
+    csr.AddToMat(0.7, &mat7);
+    AssertEqual(mat6, mat7, 0.00001);
+
+    Matrix<Real> mat8(col, row);
+    mat8.SetRandn();
+    Matrix<Real> mat9(mat8);
+    smat.AddToMat(0.7, &mat8, kTrans);
+    csr.AddToMat(0.7, &mat9, kTrans);
+    AssertEqual(mat8, mat9, 0.00001);
+  }
+}
+
+template <typename Real>
+void UnitTestCsrSparseMatrixFromPairs() {
+  for (int32 i = 0; i < 10; i++) {
+    MatrixIndexT num_rows = 1 + Rand() % 40;
+    MatrixIndexT dim = 10 + Rand() % 50;
+    // Posterior-type input; unsorted, with duplicates.
+    std::vector<std::vector<std::pair<MatrixIndexT, Real> > > pairs(num_rows);
+    for (MatrixIndexT row = 0; row < num_rows; row++) {
+      MatrixIndexT num_elems = Rand() % 4;
+      for (MatrixIndexT e = 0; e < num_elems; e++)
+        pairs[row].push_back(std::pair<MatrixIndexT, Real>(
+            Rand() % dim, static_cast<Real>(RandGauss())));
+    }
+    SparseMatrix<Real> smat(dim, pairs);
+    CsrSparseMatrix<Real> csr(dim, pairs);
+    Matrix<Real> mat1(num_rows, dim), mat2(num_rows, dim);
+    smat.CopyToMat(&mat1);
+    csr.CopyToMat(&mat2);
+    AssertEqual(mat1, mat2, 0.00001);
+  }
+}
+
 template <typename Real>
 void SparseMatrixUnitTest() {
   // SparseVector
@@ -215,6 +287,10 @@ void SparseMatrixUnitTest() {
   UnitTestSparseMatrixFrobeniusNorm<Real>();
   UnitTestSparseMatrixAddToMat<Real>();
   UnitTestSparseMatrixTraceMatSmat<Real>();
+
+  // CsrSparseMatrix
+  UnitTestCsrSparseMatrixConversion<Real>();
+  UnitTestCsrSparseMatrixFromPairs<Real>();
 }
 
 }  // namespace kaldi
@@ -64,6 +64,14 @@ void SparseVector<Real>::CopyToVec(VectorBase<OtherReal> *vec) const {
     other_data[iter->first] = iter->second;
 }
 
+template
+void SparseVector<float>::CopyToVec(VectorBase<float> *vec) const;
+template
+void SparseVector<float>::CopyToVec(VectorBase<double> *vec) const;
+template
+void SparseVector<double>::CopyToVec(VectorBase<float> *vec) const;
+template
+void SparseVector<double>::CopyToVec(VectorBase<double> *vec) const;
 
 template <typename Real>
 template <typename OtherReal>
@@ -641,6 +649,161 @@ double TraceMatSmat(const MatrixBase<double> &A,
                    const SparseMatrix<double> &B,
                    MatrixTransposeType trans);
 
+template <typename Real>
+CsrSparseMatrix<Real>::CsrSparseMatrix(
+    MatrixIndexT dim,
+    const std::vector<std::vector<std::pair<MatrixIndexT, Real> > > &pairs):
+    num_cols_(dim) {
+  KALDI_ASSERT(dim >= 0);
+  MatrixIndexT num_rows = static_cast<MatrixIndexT>(pairs.size()),
+      num_elems = 0;
+  for (MatrixIndexT row = 0; row < num_rows; row++)
+    num_elems += static_cast<MatrixIndexT>(pairs[row].size());
+  row_offsets_.resize(num_rows + 1);
+  col_indices_.reserve(num_elems);
+  values_.reserve(num_elems);
+  // "buf" is reused across rows so we don't allocate per row.
+  std::vector<std::pair<MatrixIndexT, Real> > buf;
+  row_offsets_[0] = 0;
+  for (MatrixIndexT row = 0; row < num_rows; row++) {
+    buf.assign(pairs[row].begin(), pairs[row].end());
+    std::sort(buf.begin(), buf.end(),
+              sparse_vector_utils::CompareFirst<Real>());
+    typename std::vector<std::pair<MatrixIndexT, Real> >::const_iterator
+        in = buf.begin(), end = buf.end();
+    while (in != end) {
+      MatrixIndexT col = in->first;
+      Real val = in->second;
+      for (++in; in != end && in->first == col; ++in)
+        val += in->second;  // this is the merge operation.
+      if (val != Real(0.0)) {  // Don't keep zero elements.
+        KALDI_ASSERT(col >= 0 && col < dim);
+        col_indices_.push_back(col);
+        values_.push_back(val);
+      }
+    }
+    row_offsets_[row + 1] = static_cast<MatrixIndexT>(values_.size());
+  }
+}
+
+template <typename Real>
+Real CsrSparseMatrix<Real>::Sum() const {
+  Real sum = 0.0;
+  MatrixIndexT num_elems = NumElements();
+  for (MatrixIndexT e = 0; e < num_elems; e++)
+    sum += values_[e];
+  return sum;
+}
+
+template <typename Real>
+void CsrSparseMatrix<Real>::CopyFromSmat(const SparseMatrix<Real> &smat) {
+  MatrixIndexT num_rows = smat.NumRows();
+  num_cols_ = smat.NumCols();
+  row_offsets_.resize(num_rows + 1);
+  col_indices_.clear();
+  values_.clear();
+  col_indices_.reserve(smat.NumElements());
+  values_.reserve(smat.NumElements());
+  row_offsets_[0] = 0;
+  for (MatrixIndexT row = 0; row < num_rows; row++) {
+    const SparseVector<Real> &svec = smat.Row(row);
+    MatrixIndexT num_elems = svec.NumElements();
+    const std::pair<MatrixIndexT, Real> *sdata = svec.Data();
+    for (MatrixIndexT e = 0; e < num_elems; e++) {
+      col_indices_.push_back(sdata[e].first);
+      values_.push_back(sdata[e].second);
+    }
+    row_offsets_[row + 1] = static_cast<MatrixIndexT>(values_.size());
+  }
+}
+
+template <typename Real>
+void CsrSparseMatrix<Real>::CopyToSmat(SparseMatrix<Real> *smat) const {
+  MatrixIndexT num_rows = NumRows();
+  smat->Resize(num_rows, num_cols_);
+  std::vector<std::pair<MatrixIndexT, Real> > buf;  // reused across rows.
+  for (MatrixIndexT row = 0; row < num_rows; row++) {
+    buf.clear();
+    for (MatrixIndexT e = row_offsets_[row]; e < row_offsets_[row + 1]; e++)
+      buf.push_back(std::make_pair(col_indices_[e], values_[e]));
+    SparseVector<Real> svec(num_cols_, buf);
+    smat->SetRow(row, svec);
+  }
+}
+
+template <typename Real>
+template <typename OtherReal>
+void CsrSparseMatrix<Real>::CopyToMat(MatrixBase<OtherReal> *other,
+                                      MatrixTransposeType trans) const {
+  MatrixIndexT num_rows = NumRows();
+  if (trans == kNoTrans) {
+    KALDI_ASSERT(other->NumRows() == num_rows &&
+                 other->NumCols() == num_cols_);
+    other->SetZero();
+    for (MatrixIndexT row = 0; row < num_rows; row++) {
+      OtherReal *row_data = other->RowData(row);
+      for (MatrixIndexT e = row_offsets_[row]; e < row_offsets_[row + 1]; e++)
+        row_data[col_indices_[e]] = values_[e];
+    }
+  } else {
+    OtherReal *other_col_data = other->Data();
+    MatrixIndexT other_stride = other->Stride();
+    KALDI_ASSERT(num_rows == other->NumCols() &&
+                 num_cols_ == other->NumRows());
+    other->SetZero();
+    for (MatrixIndexT row = 0; row < num_rows; row++, other_col_data++) {
+      for (MatrixIndexT e = row_offsets_[row]; e < row_offsets_[row + 1]; e++)
+        other_col_data[col_indices_[e] * other_stride] = values_[e];
+    }
+  }
+}
+
+template
+void CsrSparseMatrix<float>::CopyToMat(MatrixBase<float> *other,
+                                       MatrixTransposeType trans) const;
+template
+void CsrSparseMatrix<float>::CopyToMat(MatrixBase<double> *other,
+                                       MatrixTransposeType trans) const;
+template
+void CsrSparseMatrix<double>::CopyToMat(MatrixBase<float> *other,
+                                        MatrixTransposeType trans) const;
+template
+void CsrSparseMatrix<double>::CopyToMat(MatrixBase<double> *other,
+                                        MatrixTransposeType trans) const;
+
+template <typename Real>
+void CsrSparseMatrix<Real>::AddToMat(BaseFloat alpha,
+                                     MatrixBase<Real> *other,
+                                     MatrixTransposeType trans) const {
+  MatrixIndexT num_rows = NumRows();
+  if (trans == kNoTrans) {
+    KALDI_ASSERT(other->NumRows() == num_rows &&
+                 other->NumCols() == num_cols_);
+    for (MatrixIndexT row = 0; row < num_rows; row++) {
+      Real *row_data = other->RowData(row);
+      for (MatrixIndexT e = row_offsets_[row]; e < row_offsets_[row + 1]; e++)
+        row_data[col_indices_[e]] += alpha * values_[e];
+    }
+  } else {
+    Real *other_col_data = other->Data();
+    MatrixIndexT other_stride = other->Stride();
+    KALDI_ASSERT(num_rows == other->NumCols() &&
+                 num_cols_ == other->NumRows());
+    for (MatrixIndexT row = 0; row < num_rows; row++, other_col_data++) {
+      for (MatrixIndexT e = row_offsets_[row]; e < row_offsets_[row + 1]; e++)
+        other_col_data[col_indices_[e] * other_stride] += alpha * values_[e];
+    }
+  }
+}
+
+template <typename Real>
+void CsrSparseMatrix<Real>::Swap(CsrSparseMatrix<Real> *other) {
+  std::swap(num_cols_, other->num_cols_);
+  row_offsets_.swap(other->row_offsets_);
+  col_indices_.swap(other->col_indices_);
+  values_.swap(other->values_);
+}
+
 void GeneralMatrix::Clear() {
   mat_.Resize(0, 0);
   cmat_.Clear();
@@ -775,6 +938,12 @@ void GeneralMatrix::SwapFullMatrix(Matrix<BaseFloat> *mat) {
   mat->Swap(&mat_);
 }
 
+void GeneralMatrix::Swap(GeneralMatrix *other) {
+  mat_.Swap(&(other->mat_));
+  cmat_.Swap(&(other->cmat_));
+  smat_.Swap(&(other->smat_));
+}
+
 void GeneralMatrix::Write(std::ostream &os, bool binary) const {
   if (smat_.NumRows() != 0) {
     smat_.Write(os, binary);
@@ -1100,5 +1269,7 @@ template class SparseVector<float>;
 template class SparseVector<double>;
 template class SparseMatrix<float>;
 template class SparseMatrix<double>;
+template class CsrSparseMatrix<float>;
+template class CsrSparseMatrix<double>;
 
 }  // namespace kaldi
@@ -214,6 +214,72 @@ Real TraceMatSmat(const MatrixBase<Real> &A,
                   MatrixTransposeType trans = kNoTrans);
 
 
+/// CsrSparseMatrix stores the same contents as SparseMatrix in
+/// compressed-sparse-row (CSR) form: one flat array of column indexes and one
+/// of values, plus an array of per-row offsets, instead of a separately
+/// allocated vector of pairs per row.  This makes it much cheaper to construct
+/// from Posterior-type input (a single allocation instead of one per row), and
+/// its CopyToMat/AddToMat run over contiguous arrays, which has better memory
+/// locality.  It is intended as an in-memory working format, e.g. when
+/// building supervision for many rows per minibatch; SparseMatrix remains the
+/// format used for I/O (convert with CopyFromSmat()/CopyToSmat()).
+template <typename Real>
+class CsrSparseMatrix {
+ public:
+  CsrSparseMatrix(): num_cols_(0), row_offsets_(1, 0) { }
+
+  /// Initializer from the type that elsewhere in Kaldi is referred to as type
+  /// Posterior: indexed first by row-index; the pairs are (column-index,
+  /// value), and they do not have to be sorted and uniq (duplicates get
+  /// summed, as in the corresponding SparseMatrix constructor).
+  CsrSparseMatrix(
+      MatrixIndexT dim,
+      const std::vector<std::vector<std::pair<MatrixIndexT, Real> > > &pairs);
+
+  explicit CsrSparseMatrix(const SparseMatrix<Real> &smat) {
+    CopyFromSmat(smat);
+  }
+
+  // Note: we allow the default constructor, copy and assignment.
+
+  MatrixIndexT NumRows() const {
+    return static_cast<MatrixIndexT>(row_offsets_.size()) - 1;
+  }
+
+  MatrixIndexT NumCols() const { return num_cols_; }
+
+  /// Returns the number of nonzero elements.
+  MatrixIndexT NumElements() const {
+    return static_cast<MatrixIndexT>(values_.size());
+  }
+
+  Real Sum() const;
+
+  void CopyFromSmat(const SparseMatrix<Real> &smat);
+
+  void CopyToSmat(SparseMatrix<Real> *smat) const;
+
+  template <class OtherReal>
+  void CopyToMat(MatrixBase<OtherReal> *other,
+                 MatrixTransposeType t = kNoTrans) const;
+
+  /// Does *other = *other + alpha * *this.
+  void AddToMat(BaseFloat alpha, MatrixBase<Real> *other,
+                MatrixTransposeType t = kNoTrans) const;
+
+  void Swap(CsrSparseMatrix<Real> *other);
+
+ private:
+  MatrixIndexT num_cols_;
+  // Row r occupies entries [ row_offsets_[r], row_offsets_[r+1] ) of
+  // col_indices_ and values_; row_offsets_.size() equals NumRows() + 1.
+  std::vector<MatrixIndexT> row_offsets_;
+  // Column indexes; sorted and uniq within each row.
+  std::vector<MatrixIndexT> col_indices_;
+  std::vector<Real> values_;
+};
+
+
 enum GeneralMatrixType {
   kFullMatrix,
   kCompressedMatrix,
@@ -266,6 +332,10 @@ class GeneralMatrix {
   /// Type() returns kFullMatrix, or NumRows() == 0.
   void SwapFullMatrix(Matrix<BaseFloat> *mat);
 
+  /// Swaps the contents with "other", whatever the types of the two; this
+  /// does no allocation or copying of data.
+  void Swap(GeneralMatrix *other);
+
   /// Copies contents, regardless of type, to "mat", which must be correctly
   /// sized.
   void CopyToMat(MatrixBase<BaseFloat> *mat,
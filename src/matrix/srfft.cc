@@ -25,6 +25,11 @@
 // License v2.0.
 
 
+#include <map>
+#ifndef _MSC_VER
+#include <pthread.h>
+#endif
+
 #include "matrix/srfft.h"
 #include "matrix/matrix-functions.h"
 
@@ -404,10 +409,45 @@ void SplitRadixRealFft<Real>::Compute(Real *data, bool forward,
   }
 }
 
+template<typename Real>
+void SplitRadixRealFft<Real>::ComputeBatch(
+    MatrixBase<Real> *frames, bool forward,
+    std::vector<Real> *temp_buffer) const {
+  KALDI_ASSERT(frames != NULL && frames->NumCols() == N_);
+  MatrixIndexT num_frames = frames->NumRows();
+  for (MatrixIndexT r = 0; r < num_frames; r++)
+    Compute(frames->RowData(r), forward, temp_buffer);
+}
+
+template<typename Real>
+const SplitRadixRealFft<Real> *GetSplitRadixRealFft(MatrixIndexT N) {
+  // There is one cache per instantiation of Real.  The map and its plans
+  // are never freed: they live for the lifetime of the process, which is
+  // the point (the plan for a given size is built exactly once, however
+  // many feature computers come and go).
+  static std::map<MatrixIndexT, SplitRadixRealFft<Real>*> *cache = NULL;
+#ifndef _MSC_VER
+  static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+  pthread_mutex_lock(&mutex);
+#endif
+  if (cache == NULL)
+    cache = new std::map<MatrixIndexT, SplitRadixRealFft<Real>*>;
+  SplitRadixRealFft<Real> **plan = &((*cache)[N]);
+  if (*plan == NULL)
+    *plan = new SplitRadixRealFft<Real>(N);
+  const SplitRadixRealFft<Real> *ans = *plan;
+#ifndef _MSC_VER
+  pthread_mutex_unlock(&mutex);
+#endif
+  return ans;
+}
+
 template class SplitRadixComplexFft<float>;
 template class SplitRadixComplexFft<double>;
 template class SplitRadixRealFft<float>;
 template class SplitRadixRealFft<double>;
+template const SplitRadixRealFft<float> *GetSplitRadixRealFft(MatrixIndexT N);
+template const SplitRadixRealFft<double> *GetSplitRadixRealFft(MatrixIndexT N);
 
 
 } // end namespace kaldi
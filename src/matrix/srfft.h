@@ -117,11 +117,31 @@ class SplitRadixRealFft: private SplitRadixComplexFft<Real> {
   /// uses a user-supplied buffer.
   void Compute(Real *x, bool forward, std::vector<Real> *temp_buffer) const;
 
+  /// Transforms each row of "frames" in place (each row must have N
+  /// columns, interpreted as for the single-frame Compute()).  This is a
+  /// convenience for feature extraction over many windowed frames at once:
+  /// it reuses one temporary buffer for the whole batch and keeps the
+  /// butterfly tables hot in cache across frames.  Like the const
+  /// Compute(), it is safe to call from multiple threads on a shared
+  /// object as long as each caller supplies its own temp_buffer.
+  void ComputeBatch(MatrixBase<Real> *frames, bool forward,
+                    std::vector<Real> *temp_buffer) const;
+
  private:
-  KALDI_DISALLOW_COPY_AND_ASSIGN(SplitRadixRealFft);  
+  KALDI_DISALLOW_COPY_AND_ASSIGN(SplitRadixRealFft);
   int N_;
 };
 
+/// Returns a pointer to a process-wide SplitRadixRealFft object for size N
+/// (N must be a power of 2 and >= 4), creating it on the first request for
+/// that size.  The returned object is shared and lives until the process
+/// exits; callers must only use the const Compute()/ComputeBatch() methods
+/// with their own temp_buffer.  This saves the nontrivial table
+/// construction each time a feature computer is created, e.g. one per
+/// stream in online decoding.
+template<typename Real>
+const SplitRadixRealFft<Real> *GetSplitRadixRealFft(MatrixIndexT N);
+
 
 /// @} end of "addtogroup matrix_funcs_misc"
 
@@ -808,6 +808,87 @@ void UnitTestSpliceComponent() {
   }
 }
 
+void UnitTestSpliceAffineComponent() {
+  // Checks that SpliceAffineComponent computes the same output as the
+  // SpliceComponent + AffineComponent pair it is fused from, and that it
+  // survives a write/read round trip.
+  int32 feat_dim = RandInt(1, 20),
+      const_dim =  RandInt(0, 10),
+      left_context = RandInt(-5, 0),
+      right_context = RandInt(0, 5),
+      output_dim = RandInt(1, 20),
+      num_chunks = RandInt(1, 20);
+  std::vector<bool> contiguous(2);
+  contiguous[0] = true;
+  contiguous[1] = false;
+  for (int32 i = 0; i < contiguous.size(); i++) {
+    std::vector<int32> splice_indexes;
+    if (contiguous[i]) {
+      splice_indexes.reserve(right_context - left_context + 1);
+      for (int32 i = left_context; i <= right_context; i++)
+        splice_indexes.push_back(i);
+    } else  {
+      int32 num_left_splice_indexes = RandInt(0, -left_context) + 1;
+      int32 num_right_splice_indexes = RandInt(0, right_context);
+      splice_indexes.reserve(num_left_splice_indexes + num_right_splice_indexes);
+      while (splice_indexes.size() < num_left_splice_indexes)  {
+        int32 new_index = RandInt(left_context, 0);
+        if (std::find(splice_indexes.begin(), splice_indexes.end(), new_index)
+            == splice_indexes.end())  {
+          splice_indexes.push_back(new_index);
+        }
+      }
+      while (splice_indexes.size() < num_left_splice_indexes + num_right_splice_indexes)  {
+        int32 new_index = RandInt(0, right_context);
+        if (std::find(splice_indexes.begin(), splice_indexes.end(), new_index)
+            == splice_indexes.end())  {
+          splice_indexes.push_back(new_index);
+        }
+      }
+      sort(splice_indexes.begin(), splice_indexes.end());
+      if (splice_indexes.back() < 0) // will fail assertion in init of component
+        splice_indexes.push_back(0);
+    }
+    std::vector<int32> input_offsets;
+    for (int32 i = 0; i < splice_indexes.size(); i++)
+      input_offsets.push_back(splice_indexes[i] - splice_indexes.front());
+    int32 output_offset = -splice_indexes.front();
+
+    SpliceComponent splice;
+    splice.Init(feat_dim + const_dim, splice_indexes, const_dim);
+    AffineComponent affine;
+    affine.Init(0.01, splice.OutputDim(), output_dim, 0.1, 1.0);
+    SpliceAffineComponent fused;
+    fused.Init(feat_dim + const_dim, splice_indexes, const_dim,
+               affine.LinearParams(), affine.BiasParams());
+
+    ChunkInfo in_info = ChunkInfo(feat_dim + const_dim, num_chunks,
+                                  input_offsets),
+        mid_info = ChunkInfo(splice.OutputDim(), num_chunks,
+                             output_offset, output_offset),
+        out_info = ChunkInfo(output_dim, num_chunks,
+                             output_offset, output_offset);
+    CuMatrix<BaseFloat> in(in_info.NumRows(), in_info.NumCols()),
+        mid(mid_info.NumRows(), mid_info.NumCols()),
+        out_ref(out_info.NumRows(), out_info.NumCols()),
+        out_fused(out_info.NumRows(), out_info.NumCols());
+    in.SetRandn();
+    splice.Propagate(in_info, mid_info, in, &mid);
+    affine.Propagate(mid_info, out_info, mid, &out_ref);
+    fused.Propagate(in_info, out_info, in, &out_fused);
+    KALDI_ASSERT(out_ref.ApproxEqual(out_fused));
+
+    std::ostringstream os;
+    fused.Write(os, true);
+    std::istringstream is(os.str());
+    SpliceAffineComponent fused2;
+    fused2.Read(is, true);
+    out_fused.SetZero();
+    fused2.Propagate(in_info, out_info, in, &out_fused);
+    KALDI_ASSERT(out_ref.ApproxEqual(out_fused));
+  }
+}
+
 void BasicDebugTestForSpliceMax(bool output=false) {
   int32 C=5,
         context_len=2,
@@ -877,6 +958,7 @@ int main() {
       UnitTestGenericComponent<RectifiedLinearComponent>();
       UnitTestGenericComponent<SoftHingeComponent>();
       UnitTestSpliceComponent();
+      UnitTestSpliceAffineComponent();
       UnitTestMaxoutComponent();
       UnitTestPnormComponent();
       UnitTestMaxpoolingComponent();
@@ -26,6 +26,7 @@
 #include "nnet2/nnet-component.h"
 #include "nnet2/nnet-precondition.h"
 #include "nnet2/nnet-precondition-online.h"
+#include "cudamatrix/cu-math.h"
 #include "util/stl-utils.h"
 #include "util/text-utils.h"
 #include "util/kaldi-io.h"
@@ -92,6 +93,8 @@ Component* Component::NewComponentOfType(const std::string &component_type) {
     ans = new FixedLinearComponent();
   } else if (component_type == "FixedAffineComponent") {
     ans = new FixedAffineComponent();
+  } else if (component_type == "SpliceAffineComponent") {
+    ans = new SpliceAffineComponent();
   } else if (component_type == "FixedScaleComponent") {
     ans = new FixedScaleComponent();
   } else if (component_type == "FixedBiasComponent") {
@@ -930,12 +933,10 @@ void SoftmaxComponent::Propagate(const ChunkInfo &in_info,
   // Apply softmax function to each row of the output...
   // for that row, we do
   // x_i = exp(x_i) / sum_j exp(x_j).
-
-  out->ApplySoftMaxPerRow(in);
-
-  // This floor on the output helps us deal with
-  // almost-zeros in a way that doesn't lead to overflow.
-  out->ApplyFloor(1.0e-20);
+  // The floor on the output helps us deal with
+  // almost-zeros in a way that doesn't lead to overflow;
+  // it is applied inside the softmax kernel.
+  cu::SoftmaxWithFloor(in, BaseFloat(1.0e-20), out);
 }
 
 void SoftmaxComponent::Backprop(const ChunkInfo &in_info,
@@ -1001,10 +1002,9 @@ void LogSoftmaxComponent::Propagate(const ChunkInfo &in_info,
   
   // Applies log softmax function to each row of the output. For each row, we do
   // x_i = x_i - log(sum_j exp(x_j))
-  out->ApplyLogSoftMaxPerRow(in);
-
-  // Just to be consistent with SoftmaxComponent::Propagate()
-  out->ApplyFloor(Log(1.0e-20));
+  // The floor (applied inside the kernel) is just to be consistent with
+  // SoftmaxComponent::Propagate().
+  cu::LogSoftmaxWithFloor(in, BaseFloat(Log(1.0e-20)), out);
 }
 
 void LogSoftmaxComponent::Backprop(const ChunkInfo &in_info,
@@ -3387,6 +3387,232 @@ void FixedAffineComponent::Read(std::istream &is, bool binary) {
 }
 
 
+void SpliceAffineComponent::Init(int32 input_dim,
+                                 const std::vector<int32> &context,
+                                 int32 const_component_dim,
+                                 const CuMatrixBase<BaseFloat> &linear_params,
+                                 const CuVectorBase<BaseFloat> &bias_params) {
+  input_dim_ = input_dim;
+  context_ = context;
+  const_component_dim_ = const_component_dim;
+  linear_params_ = linear_params;
+  bias_params_ = bias_params;
+  KALDI_ASSERT(context_.size() > 0);
+  KALDI_ASSERT(input_dim_ > 0 && context_.front() <= 0 && context_.back() >= 0);
+  KALDI_ASSERT(IsSortedAndUniq(context_));
+  KALDI_ASSERT(const_component_dim_ >= 0 && const_component_dim_ < input_dim_);
+  KALDI_ASSERT(linear_params_.NumCols() ==
+               (input_dim_ - const_component_dim_) *
+               static_cast<int32>(context_.size()) + const_component_dim_);
+  KALDI_ASSERT(bias_params_.Dim() == linear_params_.NumRows());
+}
+
+void SpliceAffineComponent::InitFromString(std::string args) {
+  std::string orig_args(args);
+  std::string filename;
+  int32 input_dim, left_context, right_context;
+  std::vector<int32> context;
+  bool matrix_ok = ParseFromString("matrix", &args, &filename);
+  bool in_dim_ok = ParseFromString("input-dim", &args, &input_dim);
+  bool context_ok = ParseFromString("context", &args, &context);
+  bool left_right_context_ok = ParseFromString("left-context", &args,
+                                               &left_context) &&
+                               ParseFromString("right-context", &args,
+                                               &right_context);
+  int32 const_component_dim = 0;
+  ParseFromString("const-component-dim", &args, &const_component_dim);
+
+  if (!(matrix_ok && in_dim_ok && (context_ok || left_right_context_ok)) ||
+      !args.empty() || input_dim <= 0)
+    KALDI_ERR << "Invalid initializer for layer of type "
+              << Type() << ": \"" << orig_args << "\"";
+  if (left_right_context_ok)  {
+    KALDI_ASSERT(context.size() == 0);
+    for (int32 i = -left_context; i <= right_context; i++)
+      context.push_back(i);
+  }
+  bool binary;
+  Input ki(filename, &binary);
+  CuMatrix<BaseFloat> mat;
+  mat.Read(ki.Stream(), binary);
+  KALDI_ASSERT(mat.NumRows() != 0 && mat.NumCols() > 1);
+  CuVector<BaseFloat> bias(mat.NumRows());
+  bias.CopyColFromMat(mat, mat.NumCols() - 1);
+  Init(input_dim, context, const_component_dim,
+       mat.Range(0, mat.NumRows(), 0, mat.NumCols() - 1), bias);
+}
+
+std::string SpliceAffineComponent::Info() const {
+  std::stringstream stream;
+  std::ostringstream os;
+  std::copy(context_.begin(), context_.end(),
+            std::ostream_iterator<int32>(os, " "));
+  BaseFloat linear_params_size =
+      static_cast<BaseFloat>(linear_params_.NumRows())
+      * static_cast<BaseFloat>(linear_params_.NumCols()),
+      linear_params_stddev =
+      std::sqrt(TraceMatMat(linear_params_,
+                            linear_params_, kTrans) /
+                linear_params_size),
+      bias_params_stddev = std::sqrt(VecVec(bias_params_, bias_params_) /
+                                     bias_params_.Dim());
+  stream << Component::Info() << ", context=" << os.str();
+  if (const_component_dim_ != 0)
+    stream << ", const_component_dim=" << const_component_dim_;
+  stream << ", linear-params-stddev=" << linear_params_stddev
+         << ", bias-params-stddev=" << bias_params_stddev;
+  return stream.str();
+}
+
+void SpliceAffineComponent::Propagate(const ChunkInfo &in_info,
+                                      const ChunkInfo &out_info,
+                                      const CuMatrixBase<BaseFloat> &in,
+                                      CuMatrixBase<BaseFloat> *out) const  {
+  in_info.Check();
+  out_info.Check();
+  in_info.CheckSize(in);
+  out_info.CheckSize(*out);
+  KALDI_ASSERT(in_info.NumChunks() == out_info.NumChunks());
+
+  int32 in_chunk_size  = in_info.ChunkSize(),
+        out_chunk_size = out_info.ChunkSize(),
+        num_chunks = in_info.NumChunks(),
+        num_splice = context_.size(),
+        const_dim = const_component_dim_,
+        dim = input_dim_ - const_dim;  // dimension we are splicing.
+
+  if (out_chunk_size <= 0)
+    KALDI_ERR << "Splicing features: output will have zero dimension. "
+              << "Probably a code error.";
+
+  // For each context position, the input row within the chunk that the first
+  // output row of the chunk reads from; and whether the remaining rows follow
+  // contiguously (the normal case, where the chunk's frames are consecutive).
+  // If they do, the splice reduces to a row-shifted sub-matrix view of "in",
+  // and we never materialize the spliced matrix.  The index pattern is the
+  // same for every chunk, so we compute it once.
+  std::vector<int32> first_index(num_splice);
+  bool contiguous = true;
+  for (int32 c = 0; c < num_splice; c++) {
+    first_index[c] = in_info.GetIndex(out_info.GetOffset(0) + context_[c]);
+    for (int32 out_index = 1;
+         out_index < out_chunk_size && contiguous; out_index++) {
+      int32 in_index = in_info.GetIndex(out_info.GetOffset(out_index) +
+                                        context_[c]);
+      if (in_index != first_index[c] + out_index)
+        contiguous = false;
+    }
+  }
+
+  out->CopyRowsFromVec(bias_params_);  // copies bias_params_ to each row.
+  if (contiguous) {
+    for (int32 chunk = 0; chunk < num_chunks; chunk++) {
+      CuSubMatrix<BaseFloat> out_chunk(*out, chunk * out_chunk_size,
+                                       out_chunk_size, 0, out->NumCols());
+      for (int32 c = 0; c < num_splice; c++) {
+        CuSubMatrix<BaseFloat> in_part(in,
+                                       chunk * in_chunk_size + first_index[c],
+                                       out_chunk_size, 0, dim),
+            params(linear_params_, 0, linear_params_.NumRows(),
+                   c * dim, dim);
+        out_chunk.AddMatMat(1.0, in_part, kNoTrans, params, kTrans, 1.0);
+      }
+      if (const_dim != 0) {
+        // as in SpliceComponent, the const part is assumed constant within
+        // each chunk, so it doesn't matter which rows we take it from.
+        CuSubMatrix<BaseFloat> in_part(in, chunk * in_chunk_size,
+                                       out_chunk_size,
+                                       in.NumCols() - const_dim, const_dim),
+            params(linear_params_, 0, linear_params_.NumRows(),
+                   num_splice * dim, const_dim);
+        out_chunk.AddMatMat(1.0, in_part, kNoTrans, params, kTrans, 1.0);
+      }
+    }
+  } else {
+    // Non-contiguous frame offsets (doesn't happen in online decoding): fall
+    // back to gathering the spliced matrix, as SpliceComponent would.
+    CuMatrix<BaseFloat> spliced(out->NumRows(), linear_params_.NumCols(),
+                                kUndefined);
+    std::vector<int32> indexes(out->NumRows());
+    for (int32 c = 0; c < num_splice; c++) {
+      for (int32 chunk = 0; chunk < num_chunks; chunk++)
+        for (int32 out_index = 0; out_index < out_chunk_size; out_index++)
+          indexes[chunk * out_chunk_size + out_index] =
+              chunk * in_chunk_size +
+              in_info.GetIndex(out_info.GetOffset(out_index) + context_[c]);
+      CuSubMatrix<BaseFloat> in_part(in, 0, in.NumRows(), 0, dim),
+          spliced_part(spliced, 0, spliced.NumRows(), c * dim, dim);
+      CuArray<int32> cu_indexes(indexes);
+      spliced_part.CopyRows(in_part, cu_indexes);
+    }
+    if (const_dim != 0) {
+      for (int32 chunk = 0; chunk < num_chunks; chunk++)
+        for (int32 out_index = 0; out_index < out_chunk_size; out_index++)
+          indexes[chunk * out_chunk_size + out_index] =
+              chunk * in_chunk_size + out_index;
+      CuSubMatrix<BaseFloat> in_part(in, 0, in.NumRows(),
+                                     in.NumCols() - const_dim, const_dim),
+          spliced_part(spliced, 0, spliced.NumRows(),
+                       num_splice * dim, const_dim);
+      CuArray<int32> cu_indexes(indexes);
+      spliced_part.CopyRows(in_part, cu_indexes);
+    }
+    out->AddMatMat(1.0, spliced, kNoTrans, linear_params_, kTrans, 1.0);
+  }
+}
+
+void SpliceAffineComponent::Backprop(const ChunkInfo &,  // in_info,
+                                     const ChunkInfo &,  // out_info,
+                                     const CuMatrixBase<BaseFloat> &,  // in_value,
+                                     const CuMatrixBase<BaseFloat> &,  // out_value,
+                                     const CuMatrixBase<BaseFloat> &,  // out_deriv,
+                                     Component *,  // to_update
+                                     CuMatrix<BaseFloat> *) const  {
+  KALDI_ERR << "SpliceAffineComponent is for decoding only and does not "
+            << "support Backprop; train with separate splice and affine "
+            << "components and fuse afterward.";
+}
+
+Component* SpliceAffineComponent::Copy() const {
+  SpliceAffineComponent *ans = new SpliceAffineComponent();
+  ans->input_dim_ = input_dim_;
+  ans->context_ = context_;
+  ans->const_component_dim_ = const_component_dim_;
+  ans->linear_params_ = linear_params_;
+  ans->bias_params_ = bias_params_;
+  return ans;
+}
+
+void SpliceAffineComponent::Write(std::ostream &os, bool binary) const {
+  WriteToken(os, binary, "<SpliceAffineComponent>");
+  WriteToken(os, binary, "<InputDim>");
+  WriteBasicType(os, binary, input_dim_);
+  WriteToken(os, binary, "<Context>");
+  WriteIntegerVector(os, binary, context_);
+  WriteToken(os, binary, "<ConstComponentDim>");
+  WriteBasicType(os, binary, const_component_dim_);
+  WriteToken(os, binary, "<LinearParams>");
+  linear_params_.Write(os, binary);
+  WriteToken(os, binary, "<BiasParams>");
+  bias_params_.Write(os, binary);
+  WriteToken(os, binary, "</SpliceAffineComponent>");
+}
+
+void SpliceAffineComponent::Read(std::istream &is, bool binary) {
+  ExpectOneOrTwoTokens(is, binary, "<SpliceAffineComponent>", "<InputDim>");
+  ReadBasicType(is, binary, &input_dim_);
+  ExpectToken(is, binary, "<Context>");
+  ReadIntegerVector(is, binary, &context_);
+  ExpectToken(is, binary, "<ConstComponentDim>");
+  ReadBasicType(is, binary, &const_component_dim_);
+  ExpectToken(is, binary, "<LinearParams>");
+  linear_params_.Read(is, binary);
+  ExpectToken(is, binary, "<BiasParams>");
+  bias_params_.Read(is, binary);
+  ExpectToken(is, binary, "</SpliceAffineComponent>");
+}
+
+
 void FixedScaleComponent::Init(const CuVectorBase<BaseFloat> &scales) {
   KALDI_ASSERT(scales.Dim() != 0);
   scales_ = scales;
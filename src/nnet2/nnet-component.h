@@ -1104,6 +1104,7 @@ class SpliceComponent: public Component {
   virtual int32 InputDim() const { return input_dim_; }
   virtual int32 OutputDim() const;
   virtual std::vector<int32> Context() const { return context_; }
+  int32 ConstComponentDim() const { return const_component_dim_; }
   using Component::Propagate; // to avoid name hiding
   virtual void Propagate(const ChunkInfo &in_info,
                          const ChunkInfo &out_info,
@@ -1484,17 +1485,79 @@ class FixedAffineComponent: public Component {
   virtual void Read(std::istream &is, bool binary);
   virtual void Write(std::ostream &os, bool binary) const;
 
-  // Function to provide access to linear_params_.
+  // Functions to provide access to linear_params_ and bias_params_.
   const CuMatrix<BaseFloat> &LinearParams() const { return linear_params_; }
+  const CuVector<BaseFloat> &BiasParams() const { return bias_params_; }
  protected:
   friend class AffineComponent;
   CuMatrix<BaseFloat> linear_params_;
   CuVector<BaseFloat> bias_params_;
-  
+
   KALDI_DISALLOW_COPY_AND_ASSIGN(FixedAffineComponent);
 };
 
 
+/// SpliceAffineComponent is a fused equivalent of a SpliceComponent followed
+/// by an AffineComponent or FixedAffineComponent.  Instead of materializing
+/// the spliced (wide) intermediate matrix and then doing one big
+/// matrix-multiply, it multiplies row-shifted sub-matrix views of the input
+/// directly with the corresponding column-blocks of the parameter matrix, so
+/// the splice copy costs no memory bandwidth at all.  It is not updatable and
+/// does not support Backprop; it is intended for decoding, and is normally
+/// created from an existing model via Nnet::FuseSpliceAffine() (see
+/// nnet-am-copy --fuse-splice-affine).
+class SpliceAffineComponent: public Component {
+ public:
+  SpliceAffineComponent() { }
+  virtual std::string Type() const { return "SpliceAffineComponent"; }
+  virtual std::string Info() const;
+
+  /// "linear_params" must have (input_dim - const_component_dim) *
+  /// context.size() + const_component_dim columns, laid out the way an
+  /// AffineComponent following a SpliceComponent expects; the meaning of
+  /// "context" and "const_component_dim" is as in SpliceComponent::Init().
+  void Init(int32 input_dim,
+            const std::vector<int32> &context,
+            int32 const_component_dim,
+            const CuMatrixBase<BaseFloat> &linear_params,
+            const CuVectorBase<BaseFloat> &bias_params);
+
+  // InitFromString takes the options matrix=<rxfilename> (a matrix of size
+  // output-dim by spliced-dim + 1, last column the offset, as for
+  // FixedAffineComponent), input-dim, context or left-context/right-context,
+  // and optionally const-component-dim.
+  virtual void InitFromString(std::string args);
+
+  virtual int32 InputDim() const { return input_dim_; }
+  virtual int32 OutputDim() const { return linear_params_.NumRows(); }
+  virtual std::vector<int32> Context() const { return context_; }
+  using Component::Propagate; // to avoid name hiding
+  virtual void Propagate(const ChunkInfo &in_info,
+                         const ChunkInfo &out_info,
+                         const CuMatrixBase<BaseFloat> &in,
+                         CuMatrixBase<BaseFloat> *out) const;
+  virtual void Backprop(const ChunkInfo &in_info,
+                        const ChunkInfo &out_info,
+                        const CuMatrixBase<BaseFloat> &in_value,
+                        const CuMatrixBase<BaseFloat> &out_value,
+                        const CuMatrixBase<BaseFloat> &out_deriv,
+                        Component *to_update, // may be identical to "this".
+                        CuMatrix<BaseFloat> *in_deriv) const;
+  virtual bool BackpropNeedsInput() const { return false; }
+  virtual bool BackpropNeedsOutput() const { return false; }
+  virtual Component* Copy() const;
+  virtual void Read(std::istream &is, bool binary);
+  virtual void Write(std::ostream &os, bool binary) const;
+ private:
+  KALDI_DISALLOW_COPY_AND_ASSIGN(SpliceAffineComponent);
+  int32 input_dim_;  // dimension of each (pre-splice) input frame.
+  std::vector<int32> context_;
+  int32 const_component_dim_;
+  CuMatrix<BaseFloat> linear_params_;
+  CuVector<BaseFloat> bias_params_;
+};
+
+
 /// FixedScaleComponent applies a fixed per-element scale; it's similar
 /// to the Rescale component in the nnet1 setup (and only needed for nnet1
 /// model conversion).
@@ -19,15 +19,17 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
-#include "nnet2/nnet-compute-online.h"
+#include <cstdio>
 #include <vector>
+#include "nnet2/nnet-compute-online.h"
+#include "base/timer.h"
 
 namespace kaldi {
 namespace nnet2 {
 
 NnetOnlineComputer::NnetOnlineComputer(const Nnet &nnet, bool pad_input)
     : nnet_(nnet), pad_input_(pad_input),
-      is_first_chunk_(true), finished_(false) {
+      is_first_chunk_(true), finished_(false), profile_(false) {
   data_.resize(nnet_.NumComponents() + 1);
   reusable_component_inputs_.resize(nnet_.NumComponents()+1);
 }
@@ -201,9 +203,78 @@ void NnetOnlineComputer::Propagate() {
                                 chunk_info_[c + 1].NumChunks(),
                                 first_offset,
                                 last_offset);
-    component.Propagate(input_chunk_info, output_chunk_info,
-                        input_data, &output_data);
+    if (!profile_) {
+      component.Propagate(input_chunk_info, output_chunk_info,
+                          input_data, &output_data);
+    } else {
+      Timer tim;
+      component.Propagate(input_chunk_info, output_chunk_info,
+                          input_data, &output_data);
+      ComponentProfile &prof = profiles_[c];
+      int64 in_elems = static_cast<int64>(input_data.NumRows()) *
+          input_data.NumCols(),
+          out_elems = static_cast<int64>(output_data.NumRows()) *
+          output_data.NumCols();
+      prof.count++;
+      prof.seconds += tim.Elapsed();
+      prof.bytes += static_cast<double>(in_elems + out_elems) *
+          sizeof(BaseFloat);
+      // updatable components are assumed to be matrix multiplies; others are
+      // charged one operation per output element.
+      if (dynamic_cast<const UpdatableComponent*>(&component) != NULL)
+        prof.flops += 2.0 * output_data.NumRows() * input_data.NumCols() *
+            output_data.NumCols();
+      else
+        prof.flops += static_cast<double>(out_elems);
+    }
+  }
+}
+
+void NnetOnlineComputer::SetProfiling(bool profile) {
+  profile_ = profile;
+  if (profile_ && profiles_.empty())
+    profiles_.resize(nnet_.NumComponents());
+}
+
+std::string NnetOnlineComputer::ProfileInfo() const {
+  if (profiles_.empty())
+    return "NnetOnlineComputer: profiling was not enabled "
+        "(call SetProfiling(true)).";
+  // sort by time taken, largest first (we negate the time so that the
+  // default ordering does what we want).
+  std::vector<std::pair<double, int32> > order;
+  for (int32 c = 0; c < static_cast<int32>(profiles_.size()); c++)
+    if (profiles_[c].count != 0)
+      order.push_back(std::make_pair(-profiles_[c].seconds, c));
+  std::sort(order.begin(), order.end());
+  std::ostringstream os;
+  os << "NnetOnlineComputer profile, accumulated over all Compute() calls:\n";
+  char buf[256];
+  snprintf(buf, sizeof(buf), "%-10s %-40s %8s %10s %10s %10s %9s\n",
+           "component", "type", "calls", "seconds", "gflop", "mbytes",
+           "gflop/s");
+  os << buf;
+  double tot_seconds = 0.0, tot_flops = 0.0, tot_bytes = 0.0;
+  for (size_t i = 0; i < order.size(); i++) {
+    int32 c = order[i].second;
+    const ComponentProfile &prof = profiles_[c];
+    snprintf(buf, sizeof(buf), "%-10d %-40s %8ld %10.3f %10.3f %10.1f %9.2f\n",
+             c, nnet_.GetComponent(c).Type().c_str(),
+             static_cast<long>(prof.count), prof.seconds,
+             prof.flops * 1.0e-09, prof.bytes * 1.0e-06,
+             (prof.seconds > 0.0 ?
+              prof.flops * 1.0e-09 / prof.seconds : 0.0));
+    os << buf;
+    tot_seconds += prof.seconds;
+    tot_flops += prof.flops;
+    tot_bytes += prof.bytes;
   }
+  snprintf(buf, sizeof(buf), "%-10s %-40s %8s %10.3f %10.3f %10.1f %9.2f\n",
+           "TOTAL", "", "", tot_seconds, tot_flops * 1.0e-09,
+           tot_bytes * 1.0e-06,
+           (tot_seconds > 0.0 ? tot_flops * 1.0e-09 / tot_seconds : 0.0));
+  os << buf;
+  return os.str();
 }
 
 }  // namespace nnet2
@@ -70,6 +70,17 @@ class NnetOnlineComputer {
   // input or if no frames have been output; this produces empty output.
   void Flush(CuMatrix<BaseFloat> *output);
 
+  // If called with true, each component's Propagate() calls will be timed
+  // and per-component wall time, bytes moved and estimated FLOPs accumulated;
+  // call before the first Compute().
+  void SetProfiling(bool profile);
+
+  // Returns a table of the per-component cost accumulated since profiling
+  // was enabled, sorted by time, largest first.  The FLOP counts assume
+  // updatable components are matrix multiplies and other components cost one
+  // operation per output element, so treat them as estimates.
+  std::string ProfileInfo() const;
+
  private:
   void Propagate();
 
@@ -100,6 +111,18 @@ class NnetOnlineComputer {
 
   bool finished_;  // forward-pass is complete
 
+  bool profile_;  // see SetProfiling().
+
+  // Per-component accumulators, indexed by component; used if profile_.
+  struct ComponentProfile {
+    int64 count;     // number of Propagate() calls.
+    double seconds;  // wall time.
+    double flops;    // estimated floating-point operations.
+    double bytes;    // bytes read plus written.
+    ComponentProfile(): count(0), seconds(0.0), flops(0.0), bytes(0.0) { }
+  };
+  std::vector<ComponentProfile> profiles_;
+
   KALDI_DISALLOW_COPY_AND_ASSIGN(NnetOnlineComputer);
 };
 
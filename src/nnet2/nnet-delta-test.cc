@@ -0,0 +1,97 @@
+// nnet2/nnet-delta-test.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nnet2/nnet-delta.h"
+
+namespace kaldi {
+namespace nnet2 {
+
+void UnitTestNnetDelta() {
+  int32 input_dim = 10 + Rand() % 40, output_dim = 100 + Rand() % 500;
+  Nnet *base_nnet = GenRandomNnet(input_dim, output_dim);
+  int32 dim = base_nnet->GetParameterDim();
+
+  // Simulate two SGD workers by perturbing the base parameters.
+  Vector<BaseFloat> base_params(dim), params1(dim), params2(dim);
+  base_nnet->Vectorize(&base_params);
+  params1.CopyFromVec(base_params);
+  params2.CopyFromVec(base_params);
+  for (int32 i = 0; i < dim; i++) {
+    params1(i) += 0.1 * RandGauss();
+    params2(i) += 0.1 * RandGauss();
+  }
+  Nnet nnet1(*base_nnet), nnet2(*base_nnet);
+  nnet1.UnVectorize(params1);
+  nnet2.UnVectorize(params2);
+
+  NnetDeltaConfig config;
+  int32 bits_choice = Rand() % 3;
+  config.quantize_bits = (bits_choice == 0 ? 8 : (bits_choice == 1 ? 16 : 32));
+  if (Rand() % 2 == 0) config.truncate_ratio = 0.01;
+  bool binary = (Rand() % 2 == 0);
+
+  std::ostringstream os1, os2;
+  WriteNnetDelta(*base_nnet, nnet1, config, binary, os1);
+  WriteNnetDelta(*base_nnet, nnet2, config, binary, os2);
+
+  // Average the two deltas, streaming one at a time.
+  Vector<BaseFloat> delta_sum;
+  std::istringstream is1(os1.str()), is2(os2.str());
+  ReadNnetDelta(is1, binary, 0.5, &delta_sum);
+  ReadNnetDelta(is2, binary, 0.5, &delta_sum);
+
+  Nnet avg_nnet(*base_nnet);
+  ApplyNnetDelta(delta_sum, &avg_nnet);
+
+  Vector<BaseFloat> avg_params(dim), expected_params(dim);
+  avg_nnet.Vectorize(&avg_params);
+  expected_params.AddVec(0.5, params1);
+  expected_params.AddVec(0.5, params2);
+
+  // Each delta element is reproduced to within one quantization step (or a
+  // truncation threshold of 1% of the largest element, if enabled).
+  Vector<BaseFloat> delta1(params1), delta2(params2);
+  delta1.AddVec(-1.0, base_params);
+  delta2.AddVec(-1.0, base_params);
+  delta1.ApplyAbs();
+  delta2.ApplyAbs();
+  BaseFloat max_abs = std::max(delta1.Max(), delta2.Max());
+  BaseFloat tol = 1.0e-05;
+  if (config.quantize_bits != 32)
+    tol += max_abs / ((1 << (config.quantize_bits - 1)) - 1);
+  if (config.truncate_ratio != 0.0)
+    tol += config.truncate_ratio * max_abs;
+  for (int32 i = 0; i < dim; i++)
+    KALDI_ASSERT(std::abs(avg_params(i) - expected_params(i)) < tol);
+
+  delete base_nnet;
+}
+
+} // namespace nnet2
+} // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  using namespace kaldi::nnet2;
+
+  for (int32 i = 0; i < 10; i++)
+    UnitTestNnetDelta();
+  KALDI_LOG << "Nnet-delta tests succeeded.";
+  return 0;
+}
@@ -0,0 +1,183 @@
+// nnet2/nnet-delta.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nnet2/nnet-delta.h"
+
+namespace kaldi {
+namespace nnet2 {
+
+// Maximum representable quantized magnitude, e.g. 127 for 8 bits.
+static int32 QuantMaxVal(int32 quantize_bits) {
+  KALDI_ASSERT(quantize_bits == 8 || quantize_bits == 16 ||
+               quantize_bits == 32);
+  return (1 << (quantize_bits - 1)) - 1;
+}
+
+void WriteNnetDelta(const Nnet &base_nnet,
+                    const Nnet &new_nnet,
+                    const NnetDeltaConfig &config,
+                    bool binary,
+                    std::ostream &os) {
+  int32 dim = base_nnet.GetParameterDim();
+  KALDI_ASSERT(new_nnet.GetParameterDim() == dim &&
+               "Networks must have the same structure.");
+  KALDI_ASSERT(config.truncate_ratio >= 0.0 && config.truncate_ratio < 1.0);
+  Vector<BaseFloat> delta(dim), base_params(dim);
+  new_nnet.Vectorize(&delta);
+  base_nnet.Vectorize(&base_params);
+  delta.AddVec(-1.0, base_params);
+
+  BaseFloat max_abs = std::max(std::abs(delta.Max()), std::abs(delta.Min()));
+  if (config.truncate_ratio > 0.0) {
+    BaseFloat threshold = config.truncate_ratio * max_abs;
+    BaseFloat *data = delta.Data();
+    for (int32 i = 0; i < dim; i++)
+      if (std::abs(data[i]) < threshold) data[i] = 0.0;
+  }
+
+  WriteToken(os, binary, "<NnetDelta>");
+  WriteToken(os, binary, "<ParamDim>");
+  WriteBasicType(os, binary, dim);
+  WriteToken(os, binary, "<QuantBits>");
+  WriteBasicType(os, binary, config.quantize_bits);
+  WriteToken(os, binary, "<Scale>");
+  WriteBasicType(os, binary, max_abs);
+  WriteToken(os, binary, "<Data>");
+  if (config.quantize_bits == 32) {
+    const BaseFloat *data = delta.Data();
+    if (binary) {
+      os.write(reinterpret_cast<const char*>(data), sizeof(BaseFloat) * dim);
+    } else {
+      for (int32 i = 0; i < dim; i++)
+        WriteBasicType(os, binary, data[i]);
+    }
+  } else {
+    int32 max_val = QuantMaxVal(config.quantize_bits);
+    BaseFloat inv_scale = (max_abs > 0.0 ? max_val / max_abs : 0.0);
+    const BaseFloat *data = delta.Data();
+    if (config.quantize_bits == 8) {
+      std::vector<int8> quantized(dim);
+      for (int32 i = 0; i < dim; i++)
+        quantized[i] = static_cast<int8>(round(data[i] * inv_scale));
+      if (binary) {
+        os.write(reinterpret_cast<const char*>(&(quantized[0])), dim);
+      } else {
+        for (int32 i = 0; i < dim; i++)
+          WriteBasicType(os, binary, static_cast<int32>(quantized[i]));
+      }
+    } else { // 16 bits.
+      std::vector<int16> quantized(dim);
+      for (int32 i = 0; i < dim; i++)
+        quantized[i] = static_cast<int16>(round(data[i] * inv_scale));
+      if (binary) {
+        os.write(reinterpret_cast<const char*>(&(quantized[0])),
+                 sizeof(int16) * dim);
+      } else {
+        for (int32 i = 0; i < dim; i++)
+          WriteBasicType(os, binary, static_cast<int32>(quantized[i]));
+      }
+    }
+  }
+  WriteToken(os, binary, "</NnetDelta>");
+  if (os.fail())
+    KALDI_ERR << "Error writing neural net parameter delta to stream.";
+}
+
+void ReadNnetDelta(std::istream &is,
+                   bool binary,
+                   BaseFloat weight,
+                   Vector<BaseFloat> *delta_sum) {
+  ExpectToken(is, binary, "<NnetDelta>");
+  int32 dim, quantize_bits;
+  BaseFloat scale;
+  ExpectToken(is, binary, "<ParamDim>");
+  ReadBasicType(is, binary, &dim);
+  ExpectToken(is, binary, "<QuantBits>");
+  ReadBasicType(is, binary, &quantize_bits);
+  ExpectToken(is, binary, "<Scale>");
+  ReadBasicType(is, binary, &scale);
+  KALDI_ASSERT(dim > 0);
+  if (delta_sum->Dim() == 0) delta_sum->Resize(dim);
+  else if (delta_sum->Dim() != dim)
+    KALDI_ERR << "Parameter-delta dimension mismatch: expected "
+              << delta_sum->Dim() << ", got " << dim;
+  ExpectToken(is, binary, "<Data>");
+  BaseFloat *sum_data = delta_sum->Data();
+  if (quantize_bits == 32) {
+    if (binary) {
+      Vector<BaseFloat> delta(dim, kUndefined);
+      is.read(reinterpret_cast<char*>(delta.Data()), sizeof(BaseFloat) * dim);
+      delta_sum->AddVec(weight, delta);
+    } else {
+      for (int32 i = 0; i < dim; i++) {
+        BaseFloat d;
+        ReadBasicType(is, binary, &d);
+        sum_data[i] += weight * d;
+      }
+    }
+  } else {
+    int32 max_val = QuantMaxVal(quantize_bits);
+    BaseFloat factor = weight * scale / max_val;
+    if (quantize_bits == 8) {
+      if (binary) {
+        std::vector<int8> quantized(dim);
+        is.read(reinterpret_cast<char*>(&(quantized[0])), dim);
+        for (int32 i = 0; i < dim; i++)
+          sum_data[i] += factor * quantized[i];
+      } else {
+        for (int32 i = 0; i < dim; i++) {
+          int32 q;
+          ReadBasicType(is, binary, &q);
+          sum_data[i] += factor * q;
+        }
+      }
+    } else { // 16 bits.
+      if (binary) {
+        std::vector<int16> quantized(dim);
+        is.read(reinterpret_cast<char*>(&(quantized[0])),
+                sizeof(int16) * dim);
+        for (int32 i = 0; i < dim; i++)
+          sum_data[i] += factor * quantized[i];
+      } else {
+        for (int32 i = 0; i < dim; i++) {
+          int32 q;
+          ReadBasicType(is, binary, &q);
+          sum_data[i] += factor * q;
+        }
+      }
+    }
+  }
+  ExpectToken(is, binary, "</NnetDelta>");
+  if (is.fail())
+    KALDI_ERR << "Error reading neural net parameter delta from stream.";
+}
+
+void ApplyNnetDelta(const VectorBase<BaseFloat> &delta,
+                    Nnet *nnet) {
+  int32 dim = nnet->GetParameterDim();
+  KALDI_ASSERT(delta.Dim() == dim);
+  Vector<BaseFloat> params(dim);
+  nnet->Vectorize(&params);
+  params.AddVec(1.0, delta);
+  nnet->UnVectorize(params);
+}
+
+
+} // namespace nnet2
+} // namespace kaldi
@@ -0,0 +1,84 @@
+// nnet2/nnet-delta.h
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_NNET2_NNET_DELTA_H_
+#define KALDI_NNET2_NNET_DELTA_H_
+
+#include "nnet2/nnet-nnet.h"
+#include "itf/options-itf.h"
+
+namespace kaldi {
+namespace nnet2 {
+
+/* This header provides a compact "parameter delta" representation for
+   parallel-SGD model averaging.  Instead of each worker writing out a full
+   model and the averaging tool reading N full models, each worker writes the
+   difference between its trained parameters and the iteration-start (base)
+   model, optionally quantized to 8 or 16 bits per parameter.  The averaging
+   side streams the deltas one at a time, so only one parameter-vector's worth
+   of memory is needed regardless of the number of jobs.
+
+   Note: the delta covers the updatable parameters only (what
+   Nnet::Vectorize() sees); the stored statistics of NonlinearComponents are
+   taken from the base model, unlike regular nnet-am-average.
+*/
+
+struct NnetDeltaConfig {
+  int32 quantize_bits; // 8, 16 or 32; 32 means no quantization.
+  BaseFloat truncate_ratio; // delta elements smaller in magnitude than this
+                            // times the largest element are set to zero
+                            // before quantization.
+  NnetDeltaConfig(): quantize_bits(16), truncate_ratio(0.0) { }
+  void Register(OptionsItf *opts) {
+    opts->Register("quantize-bits", &quantize_bits,
+                   "Number of bits per delta parameter: 8, 16 or 32 "
+                   "(32 means no quantization)");
+    opts->Register("truncate-ratio", &truncate_ratio,
+                   "Delta elements smaller than this times the largest "
+                   "element are zeroed before quantization");
+  }
+};
+
+/// Computes the delta of the updatable parameters of "new_nnet" versus
+/// "base_nnet" (which must have the same structure), and writes it to the
+/// stream in the format described above.
+void WriteNnetDelta(const Nnet &base_nnet,
+                    const Nnet &new_nnet,
+                    const NnetDeltaConfig &config,
+                    bool binary,
+                    std::ostream &os);
+
+/// Reads one delta written by WriteNnetDelta and adds "weight" times it to
+/// "*delta_sum", which must either be empty (in which case it is resized),
+/// or of the right dimension.  Only one delta is held in memory at a time.
+void ReadNnetDelta(std::istream &is,
+                   bool binary,
+                   BaseFloat weight,
+                   Vector<BaseFloat> *delta_sum);
+
+/// Adds "delta" to the updatable parameters of "nnet"; "delta" must have
+/// dimension nnet->GetParameterDim().
+void ApplyNnetDelta(const VectorBase<BaseFloat> &delta,
+                    Nnet *nnet);
+
+
+} // namespace nnet2
+} // namespace kaldi
+
+#endif // KALDI_NNET2_NNET_DELTA_H_
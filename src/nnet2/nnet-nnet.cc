@@ -769,6 +769,32 @@ void Nnet::Collapse(bool match_updatableness) {
                 "  Try --match-updatableness=false." : "");
 }
 
+void Nnet::FuseSpliceAffine() {
+  int32 num_fused = 0;
+  for (size_t i = 0; i + 1 < components_.size(); i++) {
+    SpliceComponent *s = dynamic_cast<SpliceComponent*>(components_[i]);
+    if (s == NULL) continue;
+    AffineComponent *a = dynamic_cast<AffineComponent*>(components_[i + 1]);
+    FixedAffineComponent
+        *f = dynamic_cast<FixedAffineComponent*>(components_[i + 1]);
+    if (a == NULL && f == NULL) continue;
+    SpliceAffineComponent *fused = new SpliceAffineComponent();
+    fused->Init(s->InputDim(), s->Context(), s->ConstComponentDim(),
+                (a != NULL ? a->LinearParams() : f->LinearParams()),
+                (a != NULL ? a->BiasParams() : f->BiasParams()));
+    delete components_[i];
+    delete components_[i + 1];
+    components_[i] = fused;
+    for (size_t j = i + 1; j + 1 < components_.size(); j++)
+      components_[j] = components_[j + 1];
+    components_.pop_back();
+    num_fused++;
+  }
+  this->SetIndexes();
+  this->Check();
+  KALDI_LOG << "Fused " << num_fused << " splice+affine component pairs.";
+}
+
 Nnet *GenRandomNnet(int32 input_dim,
                     int32 output_dim) {
   std::vector<Component*> components;
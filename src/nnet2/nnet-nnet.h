@@ -190,7 +190,15 @@ class Nnet {
   /// work for all pairs of such layers.  It currently only works where
   /// one of each pair is an AffineComponent.
   void Collapse(bool match_updatableness);
-  
+
+  /// Replaces each SpliceComponent that is directly followed by an
+  /// AffineComponent (or FixedAffineComponent) with a single fused
+  /// SpliceAffineComponent, which avoids materializing the spliced
+  /// intermediate matrix.  The fused component does not support Backprop, so
+  /// only do this to models you will use for decoding.
+  void FuseSpliceAffine();
+
+
 
   /// Sets the index_ values of the components.
   void SetIndexes(); 
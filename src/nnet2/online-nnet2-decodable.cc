@@ -18,6 +18,7 @@
 // limitations under the License.
 
 #include "nnet2/online-nnet2-decodable.h"
+#include "cudamatrix/cu-math.h"
 
 namespace kaldi {
 namespace nnet2 {
@@ -37,6 +38,7 @@ DecodableNnet2Online::DecodableNnet2Online(
     num_pdfs_(nnet.GetNnet().OutputDim()),
     begin_frame_(-1) {
   KALDI_ASSERT(opts_.max_nnet_batch_size > 0);
+  KALDI_ASSERT(opts_.frame_skip >= 1);
   log_priors_ = nnet_.Priors();
   KALDI_ASSERT(log_priors_.Dim() == trans_model_.NumPdfs() &&
                "Priors in neural network not set up (or mismatch "
@@ -68,24 +70,41 @@ int32 DecodableNnet2Online::NumFramesReady() const {
   if (features_ready == 0)
     return 0;
   bool input_finished = features_->IsLastFrame(features_ready - 1);
+  int32 ans;
   if (opts_.pad_input) {
     // normal case... we'll pad with duplicates of first + last frame to get the
     // required left and right context.
-    if (input_finished) return features_ready;
-    else return std::max<int32>(0, features_ready - right_context_);
+    if (input_finished) ans = features_ready;
+    else ans = std::max<int32>(0, features_ready - right_context_);
   } else {
-    return std::max<int32>(0, features_ready - right_context_ - left_context_);
+    ans = std::max<int32>(0, features_ready - right_context_ - left_context_);
   }
+  if (opts_.frame_skip > 1 && !input_finished && ans > 0) {
+    // Hold back the frames past the last frame we'd actually evaluate (the
+    // "keyframes" are the multiples of frame_skip) until the next keyframe is
+    // available, so the frames in between can be interpolated between their
+    // two evaluated neighbors; this adds less than frame_skip frames of
+    // latency.
+    ans = ((ans - 1) / opts_.frame_skip) * opts_.frame_skip + 1;
+  }
+  return ans;
 }
 
 void DecodableNnet2Online::ComputeForFrame(int32 frame) {
   int32 features_ready = features_->NumFramesReady();
   bool input_finished = features_->IsLastFrame(features_ready - 1);  
   KALDI_ASSERT(frame >= 0);
-  if (frame >= begin_frame_ &&
+  // note: the begin_frame_ >= 0 test matters after Reset(), which keeps the
+  // scaled_loglikes_ matrix allocated but marks its contents invalid by
+  // setting begin_frame_ to -1.
+  if (begin_frame_ >= 0 && frame >= begin_frame_ &&
       frame < begin_frame_ + scaled_loglikes_.NumRows())
     return;
   KALDI_ASSERT(frame < NumFramesReady());
+  if (opts_.frame_skip > 1) {
+    ComputeForFrameSkipped(frame);
+    return;
+  }
 
   int32 input_frame_begin;
   if (opts_.pad_input)
@@ -126,8 +145,8 @@ void DecodableNnet2Online::ComputeForFrame(int32 frame) {
   NnetComputation(nnet_.GetNnet(), cu_features,
                   false, &cu_posteriors);
   
-  cu_posteriors.ApplyFloor(1.0e-20); // Avoid log of zero which leads to NaN.
-  cu_posteriors.ApplyLog();
+  // Floor avoids log of zero which leads to NaN.
+  cu::FloorAndLog(BaseFloat(1.0e-20), &cu_posteriors);
   // subtract log-prior (divide by prior)
   cu_posteriors.AddVecToRows(-1.0, log_priors_);
   // apply probability scale.
@@ -141,5 +160,94 @@ void DecodableNnet2Online::ComputeForFrame(int32 frame) {
   begin_frame_ = frame;
 }
 
+void DecodableNnet2Online::ComputeForFrameSkipped(int32 frame) {
+  int32 skip = opts_.frame_skip,
+      num_ready = NumFramesReady(),
+      features_ready = features_->NumFramesReady();
+  bool input_finished = features_->IsLastFrame(features_ready - 1);
+  // Start the batch at the keyframe at or before "frame", so we always have a
+  // left endpoint to interpolate from.  (This may re-evaluate one frame from
+  // the previous batch; that costs us one extra frame per batch.)
+  int32 out_begin = (frame / skip) * skip;
+  int32 out_end = std::min<int32>(num_ready,
+                                  out_begin + opts_.max_nnet_batch_size);
+  bool at_end = (input_finished && out_end == num_ready);
+  if (!at_end) {
+    // Only emit frames up to the last keyframe in range; frames past it will
+    // be emitted in the next batch, where their right neighbor is available.
+    // NumFramesReady() is rounded so that this still covers "frame".
+    out_end = out_begin + ((out_end - 1 - out_begin) / skip) * skip + 1;
+  }
+  KALDI_ASSERT(frame >= out_begin && frame < out_end);
+  scaled_loglikes_.Resize(out_end - out_begin, num_pdfs_);
+
+  // The keyframes are the multiples of "skip"; at the very end of the
+  // utterance we also evaluate the last frame, so the final frames are
+  // interpolated rather than extrapolated.
+  std::vector<int32> keyframes;
+  for (int32 t = out_begin; t < out_end; t += skip)
+    keyframes.push_back(t);
+  if (at_end && keyframes.back() != out_end - 1)
+    keyframes.push_back(out_end - 1);
+  for (size_t i = 0; i < keyframes.size(); i++) {
+    SubVector<BaseFloat> row(scaled_loglikes_, keyframes[i] - out_begin);
+    ComputeForOneFrame(keyframes[i], &row);
+  }
+  for (size_t i = 0; i + 1 < keyframes.size(); i++) {
+    int32 k1 = keyframes[i], k2 = keyframes[i + 1];
+    SubVector<BaseFloat> row1(scaled_loglikes_, k1 - out_begin),
+        row2(scaled_loglikes_, k2 - out_begin);
+    for (int32 t = k1 + 1; t < k2; t++) {
+      SubVector<BaseFloat> row(scaled_loglikes_, t - out_begin);
+      if (opts_.frame_skip_interpolate) {
+        // We interpolate the scaled log-posteriors linearly; interpolating
+        // the posteriors themselves would arguably be more principled, but
+        // this is cheaper and the difference is negligible.
+        BaseFloat p = static_cast<BaseFloat>(t - k1) / (k2 - k1);
+        row.AddVec(1.0 - p, row1);  // row is zero, from the Resize() above.
+        row.AddVec(p, row2);
+      } else {
+        row.CopyFromVec(row1);
+      }
+    }
+  }
+  begin_frame_ = out_begin;
+}
+
+void DecodableNnet2Online::ComputeForOneFrame(int32 frame,
+                                              VectorBase<BaseFloat> *output) {
+  int32 features_ready = features_->NumFramesReady();
+  int32 input_frame_begin =
+      (opts_.pad_input ? frame - left_context_ : frame),
+      input_frame_end = input_frame_begin + left_context_ + right_context_ + 1;
+  Matrix<BaseFloat> features(input_frame_end - input_frame_begin,
+                             feat_dim_);
+  for (int32 t = input_frame_begin; t < input_frame_end; t++) {
+    SubVector<BaseFloat> row(features, t - input_frame_begin);
+    int32 t_modified = t;
+    // The next two if-statements take care of "pad_input"
+    if (t_modified < 0)
+      t_modified = 0;
+    if (t_modified >= features_ready)
+      t_modified = features_ready - 1;
+    features_->GetFrame(t_modified, &row);
+  }
+  CuMatrix<BaseFloat> cu_features;
+  cu_features.Swap(&features);  // Copy to GPU, if we're using one.
+
+  CuMatrix<BaseFloat> cu_posteriors(1, num_pdfs_);
+  // The "false" below tells it not to pad the input: we've already done
+  // any padding that we needed to do.
+  NnetComputation(nnet_.GetNnet(), cu_features,
+                  false, &cu_posteriors);
+  cu::FloorAndLog(BaseFloat(1.0e-20), &cu_posteriors);
+  cu_posteriors.AddVecToRows(-1.0, log_priors_);
+  cu_posteriors.Scale(opts_.acoustic_scale);
+
+  Matrix<BaseFloat> posteriors(1, num_pdfs_, kUndefined);
+  cu_posteriors.CopyToMat(&posteriors);
+  output->CopyFromVec(posteriors.Row(0));
+}
+
 } // namespace nnet2
 } // namespace kaldi
@@ -38,11 +38,15 @@ struct DecodableNnet2OnlineOptions {
   BaseFloat acoustic_scale;
   bool pad_input;
   int32 max_nnet_batch_size;
-  
+  int32 frame_skip;
+  bool frame_skip_interpolate;
+
   DecodableNnet2OnlineOptions():
       acoustic_scale(0.1),
       pad_input(true),
-      max_nnet_batch_size(256) { }
+      max_nnet_batch_size(256),
+      frame_skip(1),
+      frame_skip_interpolate(true) { }
 
   void Register(OptionsItf *opts) {
     opts->Register("acoustic-scale", &acoustic_scale,
@@ -54,7 +58,16 @@ struct DecodableNnet2OnlineOptions {
                    "Maximum batch size we use in neural-network decodable object, "
                    "in cases where we are not constrained by currently available "
                    "frames (this will rarely make a difference)");
-                 
+    opts->Register("frame-skip", &frame_skip,
+                   "If >1, evaluate the neural network only on every this-many'th "
+                   "frame, and fill in the frames in between from their evaluated "
+                   "neighbors (see --frame-skip-interpolate); cuts computation "
+                   "at a small cost in accuracy.");
+    opts->Register("frame-skip-interpolate", &frame_skip_interpolate,
+                   "If true (and --frame-skip > 1), linearly interpolate the "
+                   "scaled log-posteriors of non-evaluated frames between their "
+                   "two evaluated neighbors; if false, copy those of the "
+                   "previous evaluated frame.");
   }
 };
 
@@ -82,13 +95,30 @@ class DecodableNnet2Online: public DecodableInterface {
   
   /// Indices are one-based!  This is for compatibility with OpenFst.
   virtual int32 NumIndices() const { return trans_model_.NumTransitionIds(); }
-  
+
+  /// Discards the cached log-likelihoods, as if freshly constructed, so this
+  /// object can be re-used for the next utterance of a session; the features
+  /// object it reads from must be reset separately.  The cache matrix stays
+  /// allocated at its high-water-mark size.
+  void Reset() { begin_frame_ = -1; }
+
  private:
 
   /// If the neural-network outputs for this frame are not cached, it computes
   /// them (and possibly for some succeeding frames)
   void ComputeForFrame(int32 frame);
-  
+
+  /// Version of ComputeForFrame() for when opts_.frame_skip > 1: evaluates
+  /// the network only on every frame_skip'th frame (plus the last frame of
+  /// the utterance), and interpolates or copies the scaled log-posteriors of
+  /// the frames in between.
+  void ComputeForFrameSkipped(int32 frame);
+
+  /// Evaluates the network for a single output frame and writes the scaled
+  /// log-posteriors to "output" (of dimension num_pdfs_).  Used by
+  /// ComputeForFrameSkipped().
+  void ComputeForOneFrame(int32 frame, VectorBase<BaseFloat> *output);
+
   OnlineFeatureInterface *features_;
   const AmNnet &nnet_;
   const TransitionModel &trans_model_;
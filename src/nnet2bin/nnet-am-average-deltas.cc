@@ -0,0 +1,115 @@
+// nnet2bin/nnet-am-average-deltas.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "hmm/transition-model.h"
+#include "nnet2/am-nnet.h"
+#include "nnet2/nnet-delta.h"
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    using namespace kaldi::nnet2;
+    typedef kaldi::int32 int32;
+
+    const char *usage =
+        "Average parameter deltas written by nnet-am-delta and apply the\n"
+        "result to the base model.  The deltas are streamed and reduced one\n"
+        "at a time, so memory usage is independent of the number of inputs.\n"
+        "Equivalent to nnet-am-average over the corresponding full models,\n"
+        "except that the stored statistics of nonlinear components come from\n"
+        "the base model.\n"
+        "\n"
+        "Usage:  nnet-am-average-deltas [options] <base-model-in> <delta1> ... <deltaN> <model-out>\n"
+        "e.g.:\n"
+        " nnet-am-average-deltas 10.mdl 11.1.delta 11.2.delta 11.mdl\n";
+
+    bool binary_write = true;
+    std::string weights_str;
+
+    ParseOptions po(usage);
+    po.Register("binary", &binary_write, "Write output in binary mode");
+    po.Register("weights", &weights_str, "Colon-separated list of weights, "
+                "one for each input delta.  These will be normalized to sum "
+                "to one.");
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() < 3) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string base_model_rxfilename = po.GetArg(1),
+        model_wxfilename = po.GetArg(po.NumArgs());
+    int32 num_inputs = po.NumArgs() - 2;
+
+    std::vector<BaseFloat> weights;
+    if (!weights_str.empty()) {
+      SplitStringToFloats(weights_str, ":", true, &weights);
+      if (static_cast<int32>(weights.size()) != num_inputs)
+        KALDI_ERR << "--weights option must be a colon-separated list "
+                  << "with " << num_inputs << " elements, got: "
+                  << weights_str;
+      BaseFloat weight_sum = 0.0;
+      for (int32 i = 0; i < num_inputs; i++)
+        weight_sum += weights[i];
+      if (fabs(weight_sum - 1.0) > 0.01)
+        KALDI_WARN << "Normalizing weights to sum to one, sum was "
+                   << weight_sum;
+      for (int32 i = 0; i < num_inputs; i++)
+        weights[i] /= weight_sum;
+    } else {
+      weights.resize(num_inputs, 1.0 / num_inputs);
+    }
+
+    TransitionModel trans_model;
+    AmNnet am_nnet;
+    {
+      bool binary_read;
+      Input ki(base_model_rxfilename, &binary_read);
+      trans_model.Read(ki.Stream(), binary_read);
+      am_nnet.Read(ki.Stream(), binary_read);
+    }
+
+    Vector<BaseFloat> delta_sum;
+    for (int32 i = 0; i < num_inputs; i++) {
+      bool binary_read;
+      Input ki(po.GetArg(i + 2), &binary_read);
+      ReadNnetDelta(ki.Stream(), binary_read, weights[i], &delta_sum);
+    }
+
+    ApplyNnetDelta(delta_sum, &(am_nnet.GetNnet()));
+
+    {
+      Output ko(model_wxfilename, binary_write);
+      trans_model.Write(ko.Stream(), binary_write);
+      am_nnet.Write(ko.Stream(), binary_write);
+    }
+
+    KALDI_LOG << "Applied the average of " << num_inputs
+              << " parameter deltas to " << base_model_rxfilename
+              << "; wrote result to " << model_wxfilename;
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what() << '\n';
+    return -1;
+  }
+}
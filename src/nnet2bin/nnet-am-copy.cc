@@ -48,6 +48,7 @@ int main(int argc, char *argv[]) {
     bool remove_preconditioning = false;
     bool collapse = false;
     bool match_updatableness = true;
+    bool fuse_splice_affine = false;
     BaseFloat learning_rate_factor = 1.0, learning_rate = -1;
     std::string learning_rate_scales_str = " ";
     std::string learning_rates = "";
@@ -89,6 +90,10 @@ int main(int argc, char *argv[]) {
                 "and FixedAffineComponents to compactify model");
     po.Register("match-updatableness", &match_updatableness, "Only relevant if "
                 "collapse=true; set this to false to collapse mixed types.");
+    po.Register("fuse-splice-affine", &fuse_splice_affine, "If true, replace "
+                "each SpliceComponent followed by an AffineComponent or "
+                "FixedAffineComponent with a fused SpliceAffineComponent.  "
+                "The result can only be used for decoding, not training.");
 
     po.Read(argc, argv);
     
@@ -186,6 +191,8 @@ int main(int argc, char *argv[]) {
     if (remove_preconditioning) am_nnet.GetNnet().RemovePreconditioning();
 
     if (collapse) am_nnet.GetNnet().Collapse(match_updatableness);
+
+    if (fuse_splice_affine) am_nnet.GetNnet().FuseSpliceAffine();
     
     if (stats_from != "") {
       // Copy the stats associated with the layers descending from
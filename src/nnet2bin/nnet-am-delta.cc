@@ -0,0 +1,91 @@
+// nnet2bin/nnet-am-delta.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "hmm/transition-model.h"
+#include "nnet2/am-nnet.h"
+#include "nnet2/nnet-delta.h"
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    using namespace kaldi::nnet2;
+    typedef kaldi::int32 int32;
+
+    const char *usage =
+        "Write the delta of the updatable parameters of a trained neural net\n"
+        "versus the iteration-start (base) model, optionally quantized to 8 or\n"
+        "16 bits per parameter.  Used together with nnet-am-average-deltas to\n"
+        "reduce model traffic in parallel training.  Note: the delta does not\n"
+        "cover the stored statistics of nonlinear components.\n"
+        "\n"
+        "Usage:  nnet-am-delta [options] <base-model-in> <model-in> <delta-out>\n"
+        "e.g.:\n"
+        " nnet-am-delta 10.mdl 11.1.mdl 11.1.delta\n";
+
+    bool binary_write = true;
+    NnetDeltaConfig config;
+
+    ParseOptions po(usage);
+    po.Register("binary", &binary_write, "Write output in binary mode");
+    config.Register(&po);
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 3) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string base_model_rxfilename = po.GetArg(1),
+        model_rxfilename = po.GetArg(2),
+        delta_wxfilename = po.GetArg(3);
+
+    TransitionModel trans_model;
+    AmNnet base_am_nnet, am_nnet;
+    {
+      bool binary_read;
+      Input ki(base_model_rxfilename, &binary_read);
+      trans_model.Read(ki.Stream(), binary_read);
+      base_am_nnet.Read(ki.Stream(), binary_read);
+    }
+    {
+      bool binary_read;
+      TransitionModel trans_model_tmp;
+      Input ki(model_rxfilename, &binary_read);
+      trans_model_tmp.Read(ki.Stream(), binary_read);
+      am_nnet.Read(ki.Stream(), binary_read);
+    }
+
+    {
+      Output ko(delta_wxfilename, binary_write);
+      WriteNnetDelta(base_am_nnet.GetNnet(), am_nnet.GetNnet(),
+                     config, binary_write, ko.Stream());
+    }
+
+    KALDI_LOG << "Wrote parameter delta of " << model_rxfilename
+              << " versus " << base_model_rxfilename << " to "
+              << delta_wxfilename;
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what() << '\n';
+    return -1;
+  }
+}
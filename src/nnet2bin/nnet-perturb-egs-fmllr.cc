@@ -33,10 +33,7 @@ void TransformTrainingExample(const Matrix<BaseFloat> &fmllr_mat,
   Matrix<BaseFloat> input_frames(eg->input_frames);
   Matrix<BaseFloat> transformed_frames(input_frames);
 
-  for (int32 t = 0; t < transformed_frames.NumRows(); t++) {
-    SubVector<BaseFloat> row(transformed_frames, t);
-    ApplyAffineTransform(fmllr_mat, &row);
-  }
+  ApplyAffineTransform(fmllr_mat, &transformed_frames);
   input_frames.Scale(1.0 - noise_factor);
   input_frames.AddMat(noise_factor, transformed_frames);
   eg->input_frames.CopyFromMat(input_frames);
@@ -0,0 +1,217 @@
+// nnet3/nnet-batched-computer.cc
+
+// Copyright      2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+
+#include "nnet3/nnet-batched-computer.h"
+#include "nnet3/nnet-utils.h"
+
+namespace kaldi {
+namespace nnet3 {
+
+BatchedNnetComputer::BatchedNnetComputer(
+    const BatchedNnetComputerOptions &opts,
+    const Nnet &nnet,
+    BatchedNnetComputerCallback *callback):
+    opts_(opts),
+    nnet_(nnet),
+    callback_(callback),
+    compiler_(nnet_, opts_.optimize_config) {
+  KALDI_ASSERT(callback != NULL);
+  KALDI_ASSERT(opts_.frames_per_chunk > 0 && opts_.minibatch_size > 0 &&
+               opts_.extra_left_context >= 0);
+  ComputeSimpleNnetContext(nnet_, &left_context_, &right_context_);
+  int32 nnet_modulus = nnet_.Modulus();
+  if (opts_.frames_per_chunk % nnet_modulus != 0)
+    KALDI_WARN << "It may be more efficient to set the --frames-per-chunk "
+               << "(currently " << opts_.frames_per_chunk << ") to a "
+               << "multiple of the network's shift-invariance modulus "
+               << nnet_modulus;
+}
+
+void BatchedNnetComputer::AcceptUtterance(
+    const std::string &utt_id,
+    const MatrixBase<BaseFloat> &feats,
+    const VectorBase<BaseFloat> *ivector) {
+  KALDI_ASSERT(feats.NumRows() > 0);
+  int32 feature_dim = feats.NumCols(),
+      ivector_dim = (ivector != NULL ? ivector->Dim() : 0),
+      nnet_input_dim = nnet_.InputDim("input"),
+      nnet_ivector_dim = std::max<int32>(0, nnet_.InputDim("ivector"));
+  if (feature_dim != nnet_input_dim)
+    KALDI_ERR << "Neural net expects 'input' features with dimension "
+              << nnet_input_dim << " but you provided "
+              << feature_dim;
+  if (ivector_dim != nnet_ivector_dim)
+    KALDI_ERR << "Neural net expects 'ivector' features with dimension "
+              << nnet_ivector_dim << " but you provided " << ivector_dim;
+
+  UtteranceInfo *utt = new UtteranceInfo();
+  utt->utt_id = utt_id;
+  utt->feats = feats;
+  if (ivector != NULL)
+    utt->ivector = *ivector;
+  utt->output.Resize(feats.NumRows(), nnet_.OutputDim("output"));
+  utt->num_chunks = (feats.NumRows() + opts_.frames_per_chunk - 1) /
+      opts_.frames_per_chunk;
+  utterances_.push_back(utt);
+  for (int32 c = 0; c < utt->num_chunks; c++)
+    pending_chunks_.push_back(
+        ChunkInfo(utt, c * opts_.frames_per_chunk));
+  while (static_cast<int32>(pending_chunks_.size()) >= opts_.minibatch_size)
+    ComputeMinibatch();
+}
+
+void BatchedNnetComputer::Flush() {
+  while (!pending_chunks_.empty())
+    ComputeMinibatch();
+}
+
+BatchedNnetComputer::~BatchedNnetComputer() {
+  Flush();
+  // Flush() completes all utterances, so nothing should be left; this is
+  // just belt-and-braces in case of an exception part-way through.
+  for (std::list<UtteranceInfo*>::iterator iter = utterances_.begin();
+       iter != utterances_.end(); ++iter)
+    delete *iter;
+}
+
+void BatchedNnetComputer::GetComputationRequest(
+    ComputationRequest *request) const {
+  request->inputs.clear();
+  request->outputs.clear();
+  request->need_model_derivative = false;
+  request->store_component_stats = false;
+
+  int32 num_chunks = opts_.minibatch_size,
+      left_context = left_context_ + opts_.extra_left_context,
+      chunk_size = opts_.frames_per_chunk,
+      ivector_dim = std::max<int32>(0, nnet_.InputDim("ivector"));
+
+  std::vector<Index> input_indexes, ivector_indexes, output_indexes;
+  input_indexes.reserve(num_chunks * (left_context + chunk_size +
+                                      right_context_));
+  output_indexes.reserve(num_chunks * chunk_size);
+  for (int32 n = 0; n < num_chunks; n++) {
+    for (int32 t = -left_context; t < chunk_size + right_context_; t++)
+      input_indexes.push_back(Index(n, t, 0));
+    if (ivector_dim > 0)
+      ivector_indexes.push_back(Index(n, 0, 0));
+    for (int32 t = 0; t < chunk_size; t++)
+      output_indexes.push_back(Index(n, t, 0));
+  }
+  request->inputs.push_back(IoSpecification("input", input_indexes));
+  if (ivector_dim > 0)
+    request->inputs.push_back(IoSpecification("ivector", ivector_indexes));
+  request->outputs.push_back(IoSpecification("output", output_indexes));
+}
+
+void BatchedNnetComputer::FormatInputs(
+    const std::vector<ChunkInfo> &chunks,
+    Matrix<BaseFloat> *input,
+    Matrix<BaseFloat> *ivectors) const {
+  int32 left_context = left_context_ + opts_.extra_left_context,
+      rows_per_chunk = left_context + opts_.frames_per_chunk + right_context_,
+      num_chunks = chunks.size(),
+      ivector_dim = std::max<int32>(0, nnet_.InputDim("ivector"));
+  input->Resize(num_chunks * rows_per_chunk, nnet_.InputDim("input"));
+  ivectors->Resize(ivector_dim > 0 ? num_chunks : 0, ivector_dim);
+  for (int32 n = 0; n < num_chunks; n++) {
+    const UtteranceInfo *utt = chunks[n].utt;
+    if (utt == NULL)  // dummy chunk padding the final minibatch; the zeros
+      continue;       // left by Resize() are fine, the output is discarded.
+    int32 num_utt_frames = utt->feats.NumRows();
+    for (int32 i = 0; i < rows_per_chunk; i++) {
+      SubVector<BaseFloat> dest(*input, n * rows_per_chunk + i);
+      int32 t = chunks[n].output_t_start - left_context + i;
+      if (t < 0) t = 0;
+      if (t >= num_utt_frames) t = num_utt_frames - 1;
+      const SubVector<BaseFloat> src(utt->feats, t);
+      dest.CopyFromVec(src);
+    }
+    if (ivector_dim > 0)
+      ivectors->Row(n).CopyFromVec(utt->ivector);
+  }
+}
+
+void BatchedNnetComputer::ComputeMinibatch() {
+  KALDI_ASSERT(!pending_chunks_.empty());
+  std::vector<ChunkInfo> chunks;
+  chunks.reserve(opts_.minibatch_size);
+  for (int32 n = 0; n < opts_.minibatch_size; n++) {
+    if (!pending_chunks_.empty()) {
+      chunks.push_back(pending_chunks_.front());
+      pending_chunks_.pop_front();
+    } else {
+      // This only happens when flushing: pad the minibatch with dummy chunks
+      // so the shape (and hence the compiled computation) stays the same.
+      chunks.push_back(ChunkInfo(NULL, 0));
+    }
+  }
+
+  ComputationRequest request;
+  GetComputationRequest(&request);
+  const NnetComputation *computation = compiler_.Compile(request);
+  Nnet *nnet_to_update = NULL;  // we're not doing any update.
+  NnetComputer computer(opts_.compute_config, *computation,
+                        nnet_, nnet_to_update);
+
+  Matrix<BaseFloat> input, ivectors;
+  FormatInputs(chunks, &input, &ivectors);
+  CuMatrix<BaseFloat> input_cu;
+  input_cu.Swap(&input);
+  computer.AcceptInput("input", &input_cu);
+  if (ivectors.NumRows() > 0) {
+    CuMatrix<BaseFloat> ivectors_cu;
+    ivectors_cu.Swap(&ivectors);
+    computer.AcceptInput("ivector", &ivectors_cu);
+  }
+  computer.Forward();
+  CuMatrix<BaseFloat> cu_output;
+  computer.GetOutputDestructive("output", &cu_output);
+  Matrix<BaseFloat> output;
+  // the following statement just swaps the pointers if we're not using a GPU.
+  cu_output.Swap(&output);
+
+  int32 chunk_size = opts_.frames_per_chunk;
+  for (int32 n = 0; n < static_cast<int32>(chunks.size()); n++) {
+    UtteranceInfo *utt = chunks[n].utt;
+    if (utt == NULL)
+      continue;
+    int32 output_t_start = chunks[n].output_t_start,
+        num_valid_frames = std::min<int32>(
+            chunk_size, utt->feats.NumRows() - output_t_start);
+    KALDI_ASSERT(num_valid_frames > 0);
+    SubMatrix<BaseFloat> src(output, n * chunk_size, num_valid_frames,
+                             0, output.NumCols()),
+        dest(utt->output, output_t_start, num_valid_frames,
+             0, utt->output.NumCols());
+    dest.CopyFromMat(src);
+    utt->num_chunks_computed++;
+    if (utt->num_chunks_computed == utt->num_chunks) {
+      callback_->UtteranceComputed(utt->utt_id, utt->output);
+      utterances_.erase(std::find(utterances_.begin(), utterances_.end(),
+                                  utt));
+      delete utt;
+    }
+  }
+}
+
+} // namespace nnet3
+} // namespace kaldi
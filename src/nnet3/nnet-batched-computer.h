@@ -0,0 +1,197 @@
+// nnet3/nnet-batched-computer.h
+
+// Copyright      2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_NNET3_NNET_BATCHED_COMPUTER_H_
+#define KALDI_NNET3_NNET_BATCHED_COMPUTER_H_
+
+#include <deque>
+#include <list>
+
+#include "base/kaldi-common.h"
+#include "nnet3/nnet-optimize.h"
+#include "nnet3/nnet-compute.h"
+
+namespace kaldi {
+namespace nnet3 {
+
+struct BatchedNnetComputerOptions {
+  int32 extra_left_context;
+  int32 frames_per_chunk;
+  int32 minibatch_size;
+  bool debug_computation;
+
+  NnetOptimizeOptions optimize_config;
+  NnetComputeOptions compute_config;
+
+  BatchedNnetComputerOptions():
+      extra_left_context(0),
+      frames_per_chunk(50),
+      minibatch_size(128),
+      debug_computation(false) { }
+
+  void Register(OptionsItf *opts) {
+    opts->Register("extra-left-context", &extra_left_context,
+                   "Number of frames of additional left-context to add on top "
+                   "of the neural net's inherent left context "
+                   "(may be useful in recurrent setups");
+    opts->Register("frames-per-chunk", &frames_per_chunk,
+                   "Number of frames in each chunk that is separately "
+                   "evaluated by the neural net.");
+    opts->Register("minibatch-size", &minibatch_size,
+                   "Number of chunks (possibly from different utterances) "
+                   "that we evaluate in a single nnet computation.");
+    opts->Register("debug-computation", &debug_computation, "If true, turn on "
+                   "debug for the actual computation (very verbose!)");
+
+    // register the optimization options with the prefix "optimization".
+    ParseOptions optimization_opts("optimization", opts);
+    optimize_config.Register(&optimization_opts);
+
+    // register the compute options with the prefix "computation".
+    ParseOptions compute_opts("computation", opts);
+    compute_config.Register(&compute_opts);
+  }
+};
+
+
+/// Interface through which BatchedNnetComputer hands back the nnet output for
+/// each utterance once all its chunks have been evaluated.  The caller
+/// implements this (e.g. to rescale by priors and feed a decoder); the
+/// reference to "output" is only valid for the duration of the call.
+class BatchedNnetComputerCallback {
+ public:
+  virtual void UtteranceComputed(const std::string &utt_id,
+                                 const Matrix<BaseFloat> &output) = 0;
+  virtual ~BatchedNnetComputerCallback() { }
+};
+
+
+/** BatchedNnetComputer evaluates a (simple) nnet over many utterances at
+    once, for throughput: where NnetSimpleComputer evaluates one utterance's
+    chunk at a time, this class cuts each utterance into fixed-size chunks
+    and aggregates chunks from different utterances into one minibatch, using
+    the "n" index to distinguish them (the same mechanism the training code
+    uses when merging examples).  Because every chunk has the same shape, the
+    whole run uses a single computation, which the CachingOptimizingCompiler
+    compiles just once; on a GPU this keeps the matrix operations large.
+
+    Usage: call AcceptUtterance() for each utterance as it arrives; whenever
+    enough chunks are pending to fill a minibatch the computation runs, and
+    the callback is invoked for each utterance whose last chunk has been
+    computed.  Call Flush() (or let the destructor do it) to evaluate any
+    chunks still pending in a final, partially-padded minibatch.
+
+    Note: unlike NnetSimpleComputer this class copies the features, since
+    they must outlive the call to AcceptUtterance().  Chunks at utterance
+    boundaries are padded by repeating the first/last frame, as the
+    one-utterance code does.  */
+class BatchedNnetComputer {
+ public:
+  /// Note: this class stores references to "opts" and "nnet", and a pointer
+  /// to "callback", so they must outlive this object.  The nnet is assumed
+  /// to be "simple" (describable by left and right context), with an input
+  /// named "input", optionally an input named "ivector", and an output named
+  /// "output".
+  BatchedNnetComputer(const BatchedNnetComputerOptions &opts,
+                      const Nnet &nnet,
+                      BatchedNnetComputerCallback *callback);
+
+  /// Queues one utterance for evaluation, possibly triggering the
+  /// computation of one or more minibatches (and hence callbacks for
+  /// utterances that complete).  "ivector" may be NULL if the network has no
+  /// input of that name; if supplied, a single iVector is used for all
+  /// chunks of the utterance.
+  void AcceptUtterance(const std::string &utt_id,
+                       const MatrixBase<BaseFloat> &feats,
+                       const VectorBase<BaseFloat> *ivector = NULL);
+
+  /// Computes any chunks still pending, padding the final minibatch with
+  /// dummy chunks if needed; on return the callback has been invoked for
+  /// every utterance accepted so far.
+  void Flush();
+
+  /// Calls Flush().
+  ~BatchedNnetComputer();
+
+ private:
+  // All the per-utterance state: the (copied) input features and iVector,
+  // the output being assembled chunk by chunk, and a count of how many
+  // chunks remain.
+  struct UtteranceInfo {
+    std::string utt_id;
+    Matrix<BaseFloat> feats;
+    Vector<BaseFloat> ivector;  // empty if the network has no iVector input.
+    Matrix<BaseFloat> output;
+    int32 num_chunks;
+    int32 num_chunks_computed;
+    UtteranceInfo(): num_chunks(0), num_chunks_computed(0) { }
+  };
+
+  // One fixed-size chunk awaiting computation.  "utt" is NULL for the dummy
+  // chunks used to pad the final minibatch, whose output is discarded.
+  struct ChunkInfo {
+    UtteranceInfo *utt;
+    int32 output_t_start;  // first output frame of this chunk.
+    ChunkInfo(UtteranceInfo *utt, int32 output_t_start):
+        utt(utt), output_t_start(output_t_start) { }
+  };
+
+  // Takes the first opts_.minibatch_size chunks off pending_chunks_ (padding
+  // with dummy chunks if fewer are pending, which only happens when
+  // flushing), runs the nnet on them, and distributes the output to the
+  // utterances, invoking the callback for any that complete.
+  void ComputeMinibatch();
+
+  // Creates the (cacheable) computation request for one minibatch; the
+  // indexes are laid out with n varying slowest, matching the row order
+  // of the matrices that FormatInputs creates.
+  void GetComputationRequest(ComputationRequest *request) const;
+
+  // Copies the chunks' features (with edge replication where a chunk's
+  // context extends past the utterance) into one big input matrix, and their
+  // iVectors into "ivectors" (resized to zero if the network has no iVector
+  // input).
+  void FormatInputs(const std::vector<ChunkInfo> &chunks,
+                    Matrix<BaseFloat> *input,
+                    Matrix<BaseFloat> *ivectors) const;
+
+  const BatchedNnetComputerOptions &opts_;
+  const Nnet &nnet_;
+  BatchedNnetComputerCallback *callback_;
+
+  CachingOptimizingCompiler compiler_;
+
+  // The nnet's inherent left and right context (from
+  // ComputeSimpleNnetContext()).
+  int32 left_context_;
+  int32 right_context_;
+
+  // Utterances with at least one chunk not yet computed; owned here.
+  std::list<UtteranceInfo*> utterances_;
+
+  // Chunks not yet computed, in order of arrival.
+  std::deque<ChunkInfo> pending_chunks_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(BatchedNnetComputer);
+};
+
+} // namespace nnet3
+} // namespace kaldi
+
+#endif  // KALDI_NNET3_NNET_BATCHED_COMPUTER_H_
@@ -76,6 +76,10 @@ Component* Component::NewComponentOfType(const std::string &component_type) {
     ans = new SumGroupComponent();
   } else if (component_type == "FixedAffineComponent") {
     ans = new FixedAffineComponent();
+  } else if (component_type == "QuantizedAffineComponent") {
+    ans = new QuantizedAffineComponent();
+  } else if (component_type == "BlockSparseAffineComponent") {
+    ans = new BlockSparseAffineComponent();
   } else if (component_type == "FixedScaleComponent") {
     ans = new FixedScaleComponent();
   } else if (component_type == "FixedBiasComponent") {
@@ -413,6 +413,169 @@ void NnetComputation::Print(std::ostream &os, const Nnet &nnet) const {
   }
 }
 
+// Writes a vector of vectors of pairs of int32's; used below by
+// NnetComputation::Write for indexes_multi and indexes_ranges.
+static void WriteIntPairVectorVector(
+    std::ostream &os, bool binary,
+    const std::vector<std::vector<std::pair<int32, int32> > > &vec) {
+  WriteBasicType(os, binary, static_cast<int32>(vec.size()));
+  for (size_t i = 0; i < vec.size(); i++) {
+    WriteBasicType(os, binary, static_cast<int32>(vec[i].size()));
+    for (size_t j = 0; j < vec[i].size(); j++) {
+      WriteBasicType(os, binary, vec[i][j].first);
+      WriteBasicType(os, binary, vec[i][j].second);
+    }
+  }
+}
+
+static void ReadIntPairVectorVector(
+    std::istream &is, bool binary,
+    std::vector<std::vector<std::pair<int32, int32> > > *vec) {
+  int32 size;
+  ReadBasicType(is, binary, &size);
+  KALDI_ASSERT(size >= 0);
+  vec->resize(size);
+  for (int32 i = 0; i < size; i++) {
+    int32 this_size;
+    ReadBasicType(is, binary, &this_size);
+    KALDI_ASSERT(this_size >= 0);
+    (*vec)[i].resize(this_size);
+    for (int32 j = 0; j < this_size; j++) {
+      ReadBasicType(is, binary, &((*vec)[i][j].first));
+      ReadBasicType(is, binary, &((*vec)[i][j].second));
+    }
+  }
+}
+
+void NnetComputation::Write(std::ostream &os, bool binary) const {
+  if (component_precomputed_indexes.size() > 1)
+    KALDI_ERR << "Cannot write computations that use precomputed indexes, "
+              << "as class ComponentPrecomputedIndexes is not serializable.";
+  WriteToken(os, binary, "<NnetComputation>");
+  WriteToken(os, binary, "<Matrices>");
+  WriteBasicType(os, binary, static_cast<int32>(matrices.size()));
+  for (size_t i = 0; i < matrices.size(); i++) {
+    WriteBasicType(os, binary, matrices[i].num_rows);
+    WriteBasicType(os, binary, matrices[i].num_cols);
+  }
+  // matrix_debug_info is only present if requested in the compiler options,
+  // and is only for debugging, so we don't write it.
+  WriteToken(os, binary, "<SubMatrices>");
+  WriteBasicType(os, binary, static_cast<int32>(submatrices.size()));
+  for (size_t i = 0; i < submatrices.size(); i++) {
+    const SubMatrixInfo &s = submatrices[i];
+    WriteBasicType(os, binary, s.matrix_index);
+    WriteBasicType(os, binary, s.row_offset);
+    WriteBasicType(os, binary, s.num_rows);
+    WriteBasicType(os, binary, s.col_offset);
+    WriteBasicType(os, binary, s.num_cols);
+  }
+  WriteToken(os, binary, "<Indexes>");
+  WriteBasicType(os, binary, static_cast<int32>(indexes.size()));
+  for (size_t i = 0; i < indexes.size(); i++)
+    WriteIntegerVector(os, binary, indexes[i]);
+  WriteToken(os, binary, "<IndexesMulti>");
+  WriteIntPairVectorVector(os, binary, indexes_multi);
+  WriteToken(os, binary, "<IndexesRanges>");
+  WriteIntPairVectorVector(os, binary, indexes_ranges);
+  WriteToken(os, binary, "<InputOutputInfo>");
+  WriteBasicType(os, binary, static_cast<int32>(input_output_info.size()));
+  for (unordered_map<int32, std::pair<int32, int32> >::const_iterator
+           iter = input_output_info.begin();
+       iter != input_output_info.end(); ++iter) {
+    WriteBasicType(os, binary, iter->first);
+    WriteBasicType(os, binary, iter->second.first);
+    WriteBasicType(os, binary, iter->second.second);
+  }
+  WriteToken(os, binary, "<Commands>");
+  WriteBasicType(os, binary, static_cast<int32>(commands.size()));
+  for (size_t i = 0; i < commands.size(); i++) {
+    const Command &c = commands[i];
+    WriteBasicType(os, binary, static_cast<int32>(c.command_type));
+    WriteBasicType(os, binary, c.arg1);
+    WriteBasicType(os, binary, c.arg2);
+    WriteBasicType(os, binary, c.arg3);
+    WriteBasicType(os, binary, c.arg4);
+    WriteBasicType(os, binary, c.arg5);
+    WriteBasicType(os, binary, c.arg6);
+  }
+  WriteToken(os, binary, "<NeedModelDerivative>");
+  WriteBasicType(os, binary, need_model_derivative);
+  WriteToken(os, binary, "</NnetComputation>");
+}
+
+void NnetComputation::Read(std::istream &is, bool binary) {
+  Clear();
+  ExpectToken(is, binary, "<NnetComputation>");
+  ExpectToken(is, binary, "<Matrices>");
+  int32 num_matrices;
+  ReadBasicType(is, binary, &num_matrices);
+  KALDI_ASSERT(num_matrices >= 0);
+  matrices.resize(num_matrices);
+  for (int32 i = 0; i < num_matrices; i++) {
+    ReadBasicType(is, binary, &(matrices[i].num_rows));
+    ReadBasicType(is, binary, &(matrices[i].num_cols));
+  }
+  ExpectToken(is, binary, "<SubMatrices>");
+  int32 num_submatrices;
+  ReadBasicType(is, binary, &num_submatrices);
+  KALDI_ASSERT(num_submatrices >= 0);
+  submatrices.resize(num_submatrices);
+  for (int32 i = 0; i < num_submatrices; i++) {
+    SubMatrixInfo &s = submatrices[i];
+    ReadBasicType(is, binary, &(s.matrix_index));
+    ReadBasicType(is, binary, &(s.row_offset));
+    ReadBasicType(is, binary, &(s.num_rows));
+    ReadBasicType(is, binary, &(s.col_offset));
+    ReadBasicType(is, binary, &(s.num_cols));
+  }
+  ExpectToken(is, binary, "<Indexes>");
+  int32 num_indexes;
+  ReadBasicType(is, binary, &num_indexes);
+  KALDI_ASSERT(num_indexes >= 0);
+  indexes.resize(num_indexes);
+  for (int32 i = 0; i < num_indexes; i++)
+    ReadIntegerVector(is, binary, &(indexes[i]));
+  ExpectToken(is, binary, "<IndexesMulti>");
+  ReadIntPairVectorVector(is, binary, &indexes_multi);
+  ExpectToken(is, binary, "<IndexesRanges>");
+  ReadIntPairVectorVector(is, binary, &indexes_ranges);
+  ExpectToken(is, binary, "<InputOutputInfo>");
+  int32 info_size;
+  ReadBasicType(is, binary, &info_size);
+  KALDI_ASSERT(info_size >= 0);
+  for (int32 i = 0; i < info_size; i++) {
+    int32 key, value, deriv;
+    ReadBasicType(is, binary, &key);
+    ReadBasicType(is, binary, &value);
+    ReadBasicType(is, binary, &deriv);
+    input_output_info[key] = std::make_pair(value, deriv);
+  }
+  ExpectToken(is, binary, "<Commands>");
+  int32 num_commands;
+  ReadBasicType(is, binary, &num_commands);
+  KALDI_ASSERT(num_commands >= 0);
+  commands.resize(num_commands);
+  for (int32 i = 0; i < num_commands; i++) {
+    Command &c = commands[i];
+    int32 command_type;
+    ReadBasicType(is, binary, &command_type);
+    c.command_type = static_cast<CommandType>(command_type);
+    ReadBasicType(is, binary, &(c.arg1));
+    ReadBasicType(is, binary, &(c.arg2));
+    ReadBasicType(is, binary, &(c.arg3));
+    ReadBasicType(is, binary, &(c.arg4));
+    ReadBasicType(is, binary, &(c.arg5));
+    ReadBasicType(is, binary, &(c.arg6));
+  }
+  ExpectToken(is, binary, "<NeedModelDerivative>");
+  ReadBasicType(is, binary, &need_model_derivative);
+  ExpectToken(is, binary, "</NnetComputation>");
+  // the compiler reserves index zero of component_precomputed_indexes for the
+  // NULL pointer; restore that (Write refuses to write any other entries).
+  component_precomputed_indexes.push_back(NULL);
+}
+
 void NnetComputation::GetCommandStrings(
     const Nnet &nnet,
     std::string *preamble,
@@ -486,6 +649,70 @@ void ComputationRequest::Print(std::ostream &os) const {
   misc_info.Print(os);
 }
 
+void IoSpecification::Write(std::ostream &os, bool binary) const {
+  WriteToken(os, binary, "<IoSpecification>");
+  WriteToken(os, binary, "<Name>");
+  WriteToken(os, binary, name);
+  WriteToken(os, binary, "<Indexes>");
+  WriteIndexVector(os, binary, indexes);
+  WriteToken(os, binary, "<HasDeriv>");
+  WriteBasicType(os, binary, has_deriv);
+  WriteToken(os, binary, "</IoSpecification>");
+}
+
+void IoSpecification::Read(std::istream &is, bool binary) {
+  ExpectToken(is, binary, "<IoSpecification>");
+  ExpectToken(is, binary, "<Name>");
+  ReadToken(is, binary, &name);
+  ExpectToken(is, binary, "<Indexes>");
+  ReadIndexVector(is, binary, &indexes);
+  ExpectToken(is, binary, "<HasDeriv>");
+  ReadBasicType(is, binary, &has_deriv);
+  ExpectToken(is, binary, "</IoSpecification>");
+}
+
+void ComputationRequest::Write(std::ostream &os, bool binary) const {
+  // Note: since the MiscComputationInfo struct currently has no members,
+  // we do not write it; if members are added, this will need updating.
+  WriteToken(os, binary, "<ComputationRequest>");
+  WriteToken(os, binary, "<NumInputs>");
+  WriteBasicType(os, binary, static_cast<int32>(inputs.size()));
+  for (size_t i = 0; i < inputs.size(); i++)
+    inputs[i].Write(os, binary);
+  WriteToken(os, binary, "<NumOutputs>");
+  WriteBasicType(os, binary, static_cast<int32>(outputs.size()));
+  for (size_t i = 0; i < outputs.size(); i++)
+    outputs[i].Write(os, binary);
+  WriteToken(os, binary, "<NeedModelDerivative>");
+  WriteBasicType(os, binary, need_model_derivative);
+  WriteToken(os, binary, "<StoreComponentStats>");
+  WriteBasicType(os, binary, store_component_stats);
+  WriteToken(os, binary, "</ComputationRequest>");
+}
+
+void ComputationRequest::Read(std::istream &is, bool binary) {
+  ExpectToken(is, binary, "<ComputationRequest>");
+  ExpectToken(is, binary, "<NumInputs>");
+  int32 num_inputs;
+  ReadBasicType(is, binary, &num_inputs);
+  KALDI_ASSERT(num_inputs >= 0);
+  inputs.resize(num_inputs);
+  for (int32 i = 0; i < num_inputs; i++)
+    inputs[i].Read(is, binary);
+  ExpectToken(is, binary, "<NumOutputs>");
+  int32 num_outputs;
+  ReadBasicType(is, binary, &num_outputs);
+  KALDI_ASSERT(num_outputs >= 0);
+  outputs.resize(num_outputs);
+  for (int32 i = 0; i < num_outputs; i++)
+    outputs[i].Read(is, binary);
+  ExpectToken(is, binary, "<NeedModelDerivative>");
+  ReadBasicType(is, binary, &need_model_derivative);
+  ExpectToken(is, binary, "<StoreComponentStats>");
+  ReadBasicType(is, binary, &store_component_stats);
+  ExpectToken(is, binary, "</ComputationRequest>");
+}
+
 bool IoSpecification::operator== (const IoSpecification &other) const {
   return (name == other.name && indexes == other.indexes &&
           has_deriv == other.has_deriv);
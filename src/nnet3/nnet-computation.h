@@ -87,6 +87,10 @@ struct IoSpecification {
   /// Output ends in a newline.
   void Print(std::ostream &os) const;
 
+  void Write(std::ostream &os, bool binary) const;
+
+  void Read(std::istream &is, bool binary);
+
   bool operator== (const IoSpecification &other) const;
 };
 
@@ -137,6 +141,12 @@ struct ComputationRequest {
   /// in a human-readable way.
   void Print(std::ostream &os) const;
 
+  /// Note: misc_info currently has no members, so it is not written; if
+  /// members are added to it they will need to be handled here.
+  void Write(std::ostream &os, bool binary) const;
+
+  void Read(std::istream &is, bool binary);
+
   bool operator== (const ComputationRequest &other) const;
 };
 
@@ -339,6 +349,19 @@ struct NnetComputation {
   // interpret the computation.
   void Print(std::ostream &os, const Nnet &nnet) const;
 
+  // Writes the computation to disk; used by the on-disk computation cache of
+  // class CachingOptimizingCompiler.  It is an error to call this if
+  // component_precomputed_indexes has entries other than the reserved NULL at
+  // index zero, since class ComponentPrecomputedIndexes has no serialization
+  // mechanism; matrix_debug_info is also not written, as it is only for
+  // debugging.  See also NnetComputation::Read.
+  void Write(std::ostream &os, bool binary) const;
+
+  // Reads the computation from disk (see NnetComputation::Write).  Note: this
+  // does not call ComputeCudaIndexes(), so the caller must do so before the
+  // computation is used.
+  void Read(std::istream &is, bool binary);
+
 
   // This function outputs a vector of strings, one for each submatrix,
   // that explains the meaning of each one: something like "m1", "m2";
@@ -374,8 +397,6 @@ struct NnetComputation {
 
 // This operator is to print out the NnetComputation in a human-readable way, for
 // debugging purposes.
-// We don't give Read and Write functions to struct NnetComputation, because we
-// don't anticipate needing to write it to disk.
 std::ostream &operator << (std::ostream &os,
                            NnetComputation &computation);
 
@@ -17,9 +17,12 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cstdio>
 #include <iterator>
 #include <sstream>
 #include "nnet3/nnet-compute.h"
+#include "base/timer.h"
+#include "thread/kaldi-profiler.h"
 
 namespace kaldi {
 namespace nnet3 {
@@ -36,6 +39,11 @@ NnetComputer::NnetComputer(const NnetComputeOptions &options,
                "You must call NnetComputation::ComputeCudaIndexes() before "
                "executing the computation.");
   matrices_.resize(computation.matrices.size());
+  BindCommands();
+  if (options_.profile) {
+    propagate_profiles_.resize(nnet_.NumComponents());
+    backprop_profiles_.resize(nnet_.NumComponents());
+  }
   debug_ = (options_.debug || GetVerboseLevel() >= 5);
   if (debug_) {
     ComputationVariables variables;
@@ -49,6 +57,48 @@ NnetComputer::NnetComputer(const NnetComputeOptions &options,
   }
 }
 
+void NnetComputer::BindCommands() {
+  const std::vector<NnetComputation::Command> &commands = computation_.commands;
+  int32 num_commands = commands.size();
+  bound_commands_.resize(num_commands);
+  forward_commands_end_ = num_commands;
+  for (int32 i = 0; i < num_commands; i++) {
+    const NnetComputation::Command &c = commands[i];
+    BoundCommand &b = bound_commands_[i];
+    b.command = &c;
+    b.component = NULL;
+    b.upd_component = NULL;
+    b.indexes = NULL;
+    switch (c.command_type) {
+      case kNoOperationMarker:
+        if (forward_commands_end_ == num_commands)
+          forward_commands_end_ = i;
+        break;
+      case kPropagate:
+        b.component = nnet_.GetComponent(c.arg1);
+        b.indexes = computation_.component_precomputed_indexes[c.arg2];
+        break;
+      case kStoreStats:
+        // we leave upd_component NULL if there is no nnet to update; the
+        // error, if any, is reported when the command executes.
+        if (nnet_to_update_ != NULL)
+          b.upd_component = nnet_to_update_->GetComponent(c.arg1);
+        break;
+      case kBackprop:
+      case kBackpropNoModelUpdate:
+        KALDI_ASSERT(!(computation_.need_model_derivative && !nnet_to_update_));
+        b.component = nnet_.GetComponent(c.arg1);
+        b.indexes = computation_.component_precomputed_indexes[c.arg2];
+        if (nnet_to_update_ != NULL && c.command_type == kBackprop &&
+            computation_.need_model_derivative)
+          b.upd_component = nnet_to_update_->GetComponent(c.arg1);
+        break;
+      default:
+        break;
+    }
+  }
+}
+
 //static
 BaseFloat NnetComputer::MatrixStddev(const CuMatrixBase<BaseFloat> &m) {
   if (m.NumRows() == 0)
@@ -144,7 +194,8 @@ void NnetComputer::DebugAfterExecute(int32 command,
 
 
 void NnetComputer::ExecuteCommand(int32 command) {
-  const NnetComputation::Command &c = computation_.commands[command];
+  const BoundCommand &b = bound_commands_[command];
+  const NnetComputation::Command &c = *(b.command);
   try {
     switch (c.command_type) {
       case kAllocMatrixZeroed:
@@ -168,42 +219,68 @@ void NnetComputer::ExecuteCommand(int32 command) {
         matrices_[c.arg1].SetZero();
         break;
       case kPropagate: {
-        const Component *component = nnet_.GetComponent(c.arg1);
-        ComponentPrecomputedIndexes *indexes =
-            computation_.component_precomputed_indexes[c.arg2];
         const CuSubMatrix<BaseFloat> input(GetSubMatrix(c.arg3));
         CuSubMatrix<BaseFloat> output(GetSubMatrix(c.arg4));
-        component->Propagate(indexes, input, &output);
+        if (!options_.profile) {
+          b.component->Propagate(b.indexes, input, &output);
+        } else {
+          Timer tim;
+          b.component->Propagate(b.indexes, input, &output);
+          int64 in_elems =
+              static_cast<int64>(input.NumRows()) * input.NumCols(),
+              out_elems =
+              static_cast<int64>(output.NumRows()) * output.NumCols();
+          // updatable components are assumed to be matrix multiplies; others
+          // are charged one operation per output element.
+          double flops =
+              (b.component->Properties() & kUpdatableComponent) != 0 ?
+              2.0 * input.NumRows() * input.NumCols() * output.NumCols() :
+              static_cast<double>(out_elems);
+          AccProfile(&(propagate_profiles_[c.arg1]), tim.Elapsed(),
+                     flops, in_elems + out_elems);
+        }
         break;
       }
       case kStoreStats: {
-        KALDI_ASSERT(nnet_to_update_ != NULL);
-        Component *upd_component = nnet_to_update_->GetComponent(c.arg1);
+        KALDI_ASSERT(b.upd_component != NULL);
         CuSubMatrix<BaseFloat> output(GetSubMatrix(c.arg2));
-        upd_component->StoreStats(output);
+        b.upd_component->StoreStats(output);
         break;
       }
       case kBackprop:
       case kBackpropNoModelUpdate:  {
-        std::ostringstream debug_str;
         KALDI_ASSERT(nnet_to_update_ != NULL);
-        debug_str << nnet_.GetComponentName(c.arg1);
-        const Component *component = nnet_.GetComponent(c.arg1);
-        KALDI_ASSERT(!(computation_.need_model_derivative && !nnet_to_update_));
-        Component *upd_component = (nnet_to_update_ &&
-                                    c.command_type == kBackprop &&
-                                    computation_.need_model_derivative ?
-                                    nnet_to_update_->GetComponent(c.arg1) :
-                                    NULL);
-        ComponentPrecomputedIndexes *indexes =
-            computation_.component_precomputed_indexes[c.arg2];
         const CuSubMatrix<BaseFloat> in_value(GetSubMatrix(c.arg3));
         const CuSubMatrix<BaseFloat> out_value(GetSubMatrix(c.arg4));
         const CuSubMatrix<BaseFloat> out_deriv(GetSubMatrix(c.arg5));
         CuSubMatrix<BaseFloat> in_deriv(GetSubMatrix(c.arg6));
-        component->Backprop(debug_str.str(), indexes,
-                            in_value, out_value, out_deriv, upd_component,
-                            c.arg6 == 0 ? NULL : &in_deriv);
+        if (!options_.profile) {
+          b.component->Backprop(nnet_.GetComponentName(c.arg1), b.indexes,
+                                in_value, out_value, out_deriv,
+                                b.upd_component,
+                                c.arg6 == 0 ? NULL : &in_deriv);
+        } else {
+          Timer tim;
+          b.component->Backprop(nnet_.GetComponentName(c.arg1), b.indexes,
+                                in_value, out_value, out_deriv,
+                                b.upd_component,
+                                c.arg6 == 0 ? NULL : &in_deriv);
+          int64 elems =
+              static_cast<int64>(in_value.NumRows()) * in_value.NumCols() +
+              static_cast<int64>(out_value.NumRows()) * out_value.NumCols() +
+              static_cast<int64>(out_deriv.NumRows()) * out_deriv.NumCols() +
+              (c.arg6 == 0 ? 0 :
+               static_cast<int64>(in_deriv.NumRows()) * in_deriv.NumCols());
+          // parameter-derivative plus input-derivative products, roughly
+          // twice the propagation cost for matrix-multiply components.
+          double flops =
+              (b.component->Properties() & kUpdatableComponent) != 0 ?
+              4.0 * out_deriv.NumRows() * in_value.NumCols() *
+              out_deriv.NumCols() :
+              static_cast<double>(out_deriv.NumRows()) * out_deriv.NumCols();
+          AccProfile(&(backprop_profiles_[c.arg1]), tim.Elapsed(),
+                     flops, elems);
+        }
         break;
       }
       case kMatrixCopy: {
@@ -349,13 +426,12 @@ void NnetComputer::GetPointers(int32 indexes_multi_index,
 }
 
 void NnetComputer::Forward() {
+  KALDI_PROFILE_SCOPE("NnetComputer::Forward");
   CheckInputs(false);
-  int32 size = computation_.commands.size(), i = 0;
-  const std::vector<NnetComputation::Command> &c = computation_.commands;
+  int32 size = forward_commands_end_;
   CommandDebugInfo info;
 
-  for (; i < size && c[i].command_type != kNoOperationMarker;
-       i++) {
+  for (int32 i = 0; i < size; i++) {
     if (debug_)
       DebugBeforeExecute(i, &info);
     ExecuteCommand(i);
@@ -366,14 +442,72 @@ void NnetComputer::Forward() {
 }
 
 
+// static
+void NnetComputer::AccProfile(ComponentProfile *prof, double seconds,
+                              double flops, int64 elems) {
+  prof->count++;
+  prof->seconds += seconds;
+  prof->flops += flops;
+  prof->bytes += static_cast<double>(elems) * sizeof(BaseFloat);
+}
+
+std::string NnetComputer::ProfileInfo() const {
+  if (!options_.profile)
+    return "NnetComputer: profiling was not enabled "
+        "(set the \"profile\" option of NnetComputeOptions).";
+  // One entry per (phase, component) pair with any calls, sorted by time
+  // taken, largest first (we negate the time to use the default ordering).
+  std::vector<std::pair<double, std::pair<int32, int32> > > order;
+  for (int32 phase = 0; phase < 2; phase++) {
+    const std::vector<ComponentProfile> &profiles =
+        (phase == 0 ? propagate_profiles_ : backprop_profiles_);
+    for (int32 c = 0; c < static_cast<int32>(profiles.size()); c++)
+      if (profiles[c].count != 0)
+        order.push_back(std::make_pair(-profiles[c].seconds,
+                                       std::make_pair(phase, c)));
+  }
+  std::sort(order.begin(), order.end());
+  std::ostringstream os;
+  os << "NnetComputer profile, accumulated over "
+     << "all Forward()/Backward() calls:\n";
+  char buf[256];
+  snprintf(buf, sizeof(buf), "%-30s %-9s %8s %10s %10s %10s %9s\n",
+           "component", "phase", "calls", "seconds", "gflop", "mbytes",
+           "gflop/s");
+  os << buf;
+  double tot_seconds = 0.0, tot_flops = 0.0, tot_bytes = 0.0;
+  for (size_t i = 0; i < order.size(); i++) {
+    int32 phase = order[i].second.first, c = order[i].second.second;
+    const ComponentProfile &prof =
+        (phase == 0 ? propagate_profiles_[c] : backprop_profiles_[c]);
+    snprintf(buf, sizeof(buf),
+             "%-30s %-9s %8ld %10.3f %10.3f %10.1f %9.2f\n",
+             nnet_.GetComponentName(c).c_str(),
+             (phase == 0 ? "propagate" : "backprop"),
+             static_cast<long>(prof.count), prof.seconds,
+             prof.flops * 1.0e-09, prof.bytes * 1.0e-06,
+             (prof.seconds > 0.0 ?
+              prof.flops * 1.0e-09 / prof.seconds : 0.0));
+    os << buf;
+    tot_seconds += prof.seconds;
+    tot_flops += prof.flops;
+    tot_bytes += prof.bytes;
+  }
+  snprintf(buf, sizeof(buf), "%-30s %-9s %8s %10.3f %10.3f %10.1f %9.2f\n",
+           "TOTAL", "", "", tot_seconds, tot_flops * 1.0e-09,
+           tot_bytes * 1.0e-06,
+           (tot_seconds > 0.0 ? tot_flops * 1.0e-09 / tot_seconds : 0.0));
+  os << buf;
+  return os.str();
+}
+
+
 void NnetComputer::Backward() {
+  KALDI_PROFILE_SCOPE("NnetComputer::Backward");
   CheckInputs(true);
-  int32 size = computation_.commands.size(), i = 0;
-  const std::vector<NnetComputation::Command> &c = computation_.commands;
-  for (; i < size && c[i].command_type != kNoOperationMarker;
-       i++);
+  int32 size = computation_.commands.size();
   CommandDebugInfo info;
-  for (; i < size; i++) {
+  for (int32 i = forward_commands_end_; i < size; i++) {
     if (debug_)
       DebugBeforeExecute(i, &info);
     ExecuteCommand(i);
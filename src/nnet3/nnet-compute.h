@@ -38,13 +38,17 @@ namespace nnet3 {
 
 struct NnetComputeOptions {
   bool debug;
-  NnetComputeOptions(): debug(false) { }
+  bool profile;
+  NnetComputeOptions(): debug(false), profile(false) { }
   void Register(OptionsItf *opts) {
     opts->Register("debug", &debug, "If true, turn on "
                    "debug for the neural net computation (very verbose!) "
                    "Will be turned on regardless if --verbose >= 5");
+    opts->Register("profile", &profile, "If true, accumulate per-component "
+                   "wall time, bytes moved and estimated FLOPs across calls; "
+                   "the table is available from NnetComputer::ProfileInfo().");
   }
-  
+
 };
 
 
@@ -109,7 +113,18 @@ class NnetComputer {
   // ComputationRequest.
   const CuMatrixBase<BaseFloat> &GetInputDeriv(
       const std::string &input_name) const;
-  
+
+  /// If options.profile was set, returns a table of the per-component wall
+  /// time, bytes moved and estimated FLOPs accumulated over all Forward() and
+  /// Backward() calls so far, sorted by time, with propagation and backprop
+  /// listed separately; useful for deciding which layers of a particular
+  /// model are worth quantizing or pruning.  The FLOP counts assume
+  /// updatable components are matrix multiplies and other components cost
+  /// one operation per output element, so treat them as estimates.  Note:
+  /// when running on a GPU the times may attribute asynchronously executed
+  /// kernels to the wrong component.
+  std::string ProfileInfo() const;
+
  private:
   const NnetComputeOptions &options_;
   const NnetComputation &computation_;
@@ -127,6 +142,52 @@ class NnetComputer {
   // The matrices used in the computation.
   std::vector<CuMatrix<BaseFloat> > matrices_;
 
+  // A pre-resolved ("sealed") form of one command of the computation: we look
+  // up the component, component-to-update and precomputed-indexes pointers
+  // once, in the constructor, instead of on every ExecuteCommand() call, since
+  // the same computation is typically executed on many successive minibatches
+  // or chunks.  We do not pre-resolve the data pointers of submatrices,
+  // because the underlying matrices are allocated and freed by commands of the
+  // computation itself.
+  struct BoundCommand {
+    // points into computation_.commands (the computation is owned elsewhere
+    // and is not modified during our lifetime).
+    const NnetComputation::Command *command;
+    // for kPropagate, kBackprop and kBackpropNoModelUpdate; else NULL.
+    const Component *component;
+    // component of nnet_to_update_, for kStoreStats and for kBackprop when
+    // we're doing model update; else NULL.
+    Component *upd_component;
+    // precomputed indexes for kPropagate/kBackprop; NULL if none.
+    const ComponentPrecomputedIndexes *indexes;
+  };
+  // indexed by command index; set up by BindCommands() in the constructor.
+  std::vector<BoundCommand> bound_commands_;
+
+  // Per-component accumulators used if options_.profile is true; indexed by
+  // component index in nnet_.  Propagation and backprop are kept separate.
+  struct ComponentProfile {
+    int64 count;     // number of calls.
+    double seconds;  // wall time.
+    double flops;    // estimated floating-point operations.
+    double bytes;    // bytes read plus written (matrices and parameters).
+    ComponentProfile(): count(0), seconds(0.0), flops(0.0), bytes(0.0) { }
+  };
+  std::vector<ComponentProfile> propagate_profiles_, backprop_profiles_;
+
+  // Adds one timed call to *prof; "flops" is the estimated operation count
+  // and "elems" the total elements of the matrices the call read and wrote.
+  static void AccProfile(ComponentProfile *prof, double seconds,
+                         double flops, int64 elems);
+  // the index of the first kNoOperationMarker command (which separates the
+  // forward and backward phases), or commands.size() if there is none; located
+  // once in BindCommands() so Forward() and Backward() don't re-scan for it.
+  int32 forward_commands_end_;
+
+  // called from the constructor: sets up bound_commands_ and
+  // forward_commands_end_.
+  void BindCommands();
+
   // executes the command in computation_.commands[command].
   void ExecuteCommand(int32 command);
 
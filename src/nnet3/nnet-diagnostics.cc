@@ -45,12 +45,26 @@ const Nnet &NnetComputeProb::GetDeriv() const {
 
 NnetComputeProb::~NnetComputeProb() {
   delete deriv_nnet_;  // delete does nothing if pointer is NULL.
+  unordered_map<std::string, CuVector<BaseFloat>*, StringHasher>::iterator
+      iter;
+  for (iter = objf_acc_.begin(); iter != objf_acc_.end(); ++iter)
+    delete iter->second;
+  for (iter = accuracy_acc_.begin(); iter != accuracy_acc_.end(); ++iter)
+    delete iter->second;
 }
 
 void NnetComputeProb::Reset() {
   num_minibatches_processed_ = 0;
   objf_info_.clear();
   accuracy_info_.clear();
+  unordered_map<std::string, CuVector<BaseFloat>*, StringHasher>::iterator
+      iter;
+  for (iter = objf_acc_.begin(); iter != objf_acc_.end(); ++iter)
+    delete iter->second;
+  for (iter = accuracy_acc_.begin(); iter != accuracy_acc_.end(); ++iter)
+    delete iter->second;
+  objf_acc_.clear();
+  accuracy_acc_.clear();
   if (deriv_nnet_) {
     bool is_gradient = true;
     SetZero(is_gradient, deriv_nnet_);
@@ -92,7 +106,25 @@ void NnetComputeProb::ProcessOutputs(const NnetExample &eg,
                   << "mismatch for '" << io.name << "': " << output.NumCols()
                   << " (nnet) vs. " << io.features.NumCols() << " (egs)\n";
       }
-      {
+      if (obj_type == kLinear && io.features.Type() == kSparseMatrix &&
+          !config_.compute_deriv) {
+        // The common case for diagnostics: accumulate the objective on the
+        // device so the only device-to-host read is in ReadDeviceTotals().
+        // (Sum(), TraceMatSmat() etc. each sync with the device to return
+        // their scalar, which makes diagnostic passes much slower than they
+        // need to be.)
+        const SparseMatrix<BaseFloat> &post = io.features.GetSparseMatrix();
+        CuSparseMatrix<BaseFloat> cu_post(post);
+        // the weight is a sum over the host-side supervision, so it costs
+        // no device sync.
+        objf_info_[io.name].tot_weight += post.Sum();
+        CuVector<BaseFloat> *&acc = objf_acc_[io.name];
+        if (acc == NULL)
+          acc = new CuVector<BaseFloat>(1);
+        CuVector<BaseFloat> this_objf(1, kUndefined);
+        TraceMatSmat(output, cu_post, kTrans, &this_objf);
+        acc->AddVec(1.0, this_objf);  // device-side accumulation.
+      } else {
         BaseFloat tot_weight, tot_objf;
         bool supply_deriv = config_.compute_deriv;
         ComputeObjectiveFunction(io.features, obj_type, io.name,
@@ -103,19 +135,64 @@ void NnetComputeProb::ProcessOutputs(const NnetExample &eg,
         totals.tot_objective += tot_objf;
       }
       if (obj_type == kLinear && config_.compute_accuracy) {
-        BaseFloat tot_weight, tot_accuracy;
-        ComputeAccuracy(io.features, output,
-                        &tot_weight, &tot_accuracy);
-        SimpleObjectiveInfo &totals = accuracy_info_[io.name];
-        totals.tot_weight += tot_weight;
-        totals.tot_objective += tot_accuracy;
+        if (io.features.Type() == kSparseMatrix) {
+          // as above, accumulate on the device; the reference labels and
+          // weights come from the host-side supervision and are copied *to*
+          // the device, which does not stall the pipeline the way reading
+          // the per-minibatch result back would.
+          int32 num_rows = output.NumRows();
+          CuArray<int32> best_index(num_rows);
+          output.FindRowMaxId(&best_index);
+          const SparseMatrix<BaseFloat> &smat = io.features.GetSparseMatrix();
+          std::vector<int32> ref_index(num_rows);
+          Vector<BaseFloat> weights(num_rows, kUndefined);
+          for (int32 r = 0; r < num_rows; r++) {
+            const SparseVector<BaseFloat> &row = smat.Row(r);
+            row.Max(&(ref_index[r]));
+            KALDI_ASSERT(ref_index[r] < output.NumCols());
+            weights(r) = row.Sum();
+          }
+          CuArray<int32> ref_index_gpu(ref_index);
+          CuVector<BaseFloat> weights_gpu(weights);
+          CuVector<BaseFloat> *&acc = accuracy_acc_[io.name];
+          if (acc == NULL)
+            acc = new CuVector<BaseFloat>(2);
+          cu::AccumulateAccuracy(best_index, ref_index_gpu, weights_gpu, acc);
+        } else {
+          BaseFloat tot_weight, tot_accuracy;
+          ComputeAccuracy(io.features, output,
+                          &tot_weight, &tot_accuracy);
+          SimpleObjectiveInfo &totals = accuracy_info_[io.name];
+          totals.tot_weight += tot_weight;
+          totals.tot_objective += tot_accuracy;
+        }
       }
       num_minibatches_processed_++;
     }
   }
 }
 
+void NnetComputeProb::ReadDeviceTotals() const {
+  unordered_map<std::string, CuVector<BaseFloat>*, StringHasher>::iterator
+      iter;
+  for (iter = objf_acc_.begin(); iter != objf_acc_.end(); ++iter) {
+    Vector<BaseFloat> v(1);
+    iter->second->CopyToVec(&v);
+    objf_info_[iter->first].tot_objective += v(0);
+    iter->second->SetZero();
+  }
+  for (iter = accuracy_acc_.begin(); iter != accuracy_acc_.end(); ++iter) {
+    Vector<BaseFloat> v(2);
+    iter->second->CopyToVec(&v);
+    SimpleObjectiveInfo &totals = accuracy_info_[iter->first];
+    totals.tot_weight += v(0);
+    totals.tot_objective += v(1);
+    iter->second->SetZero();
+  }
+}
+
 bool NnetComputeProb::PrintTotalStats() const {
+  ReadDeviceTotals();
   bool ans = false;
   unordered_map<std::string, SimpleObjectiveInfo, StringHasher>::const_iterator
       iter, end;
@@ -227,6 +304,7 @@ void ComputeAccuracy(const GeneralMatrix &supervision,
 
 const SimpleObjectiveInfo* NnetComputeProb::GetObjective(
     const std::string &output_name) const {
+  ReadDeviceTotals();
   unordered_map<std::string, SimpleObjectiveInfo, StringHasher>::const_iterator
       iter = objf_info_.find(output_name);
   if (iter != objf_info_.end())
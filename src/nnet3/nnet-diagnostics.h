@@ -107,6 +107,13 @@ class NnetComputeProb {
   void ProcessOutputs(const NnetExample &eg,
                       NnetComputer *computer);
 
+  // Adds the contents of the device-resident accumulators (see below) into
+  // objf_info_ / accuracy_info_ and zeroes the accumulators; called before
+  // the totals are read.  This is the only place the per-output statistics
+  // are copied from the device, so a diagnostic pass costs one
+  // device-to-host read per output instead of several per minibatch.
+  void ReadDeviceTotals() const;
+
   NnetComputeProbOptions config_;
   const Nnet &nnet_;
 
@@ -116,9 +123,19 @@ class NnetComputeProb {
   // this is only for diagnostics.
   int32 num_minibatches_processed_;
 
-  unordered_map<std::string, SimpleObjectiveInfo, StringHasher> objf_info_;
+  // The members below are mutable because ReadDeviceTotals() is called from
+  // the const accessors PrintTotalStats() and GetObjective().
+  mutable unordered_map<std::string, SimpleObjectiveInfo, StringHasher> objf_info_;
+
+  mutable unordered_map<std::string, SimpleObjectiveInfo, StringHasher> accuracy_info_;
+
+  // Device-resident accumulators, indexed by output name: the objective
+  // (dimension 1), and the [weight, correctly-classified weight] pair for
+  // the accuracy (dimension 2).  ProcessOutputs() accumulates into these on
+  // the device without reading anything back.
+  mutable unordered_map<std::string, CuVector<BaseFloat>*, StringHasher> objf_acc_;
 
-  unordered_map<std::string, SimpleObjectiveInfo, StringHasher> accuracy_info_;
+  mutable unordered_map<std::string, CuVector<BaseFloat>*, StringHasher> accuracy_acc_;
 };
 
 
@@ -192,5 +192,59 @@ void GetComputationRequest(const Nnet &nnet,
     KALDI_ERR << "No outputs in computation request.";
 }
 
+ShuffledExampleReader::ShuffledExampleReader(
+    const ExampleShufflerConfig &config,
+    const std::string &examples_rspecifier):
+    config_(config), reader_(examples_rspecifier),
+    drain_pos_(0), eg_(NULL), done_(false) {
+  KALDI_ASSERT(config_.shuffle_buffer_size > 0);
+  rand_state_.seed = static_cast<unsigned>(config_.srand_seed) + 27437;
+  buffer_.resize(config_.shuffle_buffer_size,
+                 std::pair<std::string, NnetExample*>(std::string(),
+                                                      static_cast<NnetExample*>(NULL)));
+  Next();  // get the first example (or set done_).
+}
+
+void ShuffledExampleReader::Next() {
+  delete eg_;
+  eg_ = NULL;
+  while (!reader_.Done()) {
+    int32 index = RandInt(0, buffer_.size() - 1, &rand_state_);
+    if (buffer_[index].second == NULL) {
+      buffer_[index].first = reader_.Key();
+      buffer_[index].second = new NnetExample();
+      // swap rather than copy; we won't need the reader's value again.
+      buffer_[index].second->Swap(&reader_.Value());
+      reader_.Next();
+    } else {
+      key_.swap(buffer_[index].first);
+      eg_ = buffer_[index].second;
+      buffer_[index].first = reader_.Key();
+      buffer_[index].second = new NnetExample();
+      buffer_[index].second->Swap(&reader_.Value());
+      reader_.Next();
+      return;
+    }
+  }
+  // The input is exhausted: drain the buffer.  The slot order is unrelated to
+  // the input order, so no further randomization is needed here.
+  for (; drain_pos_ < buffer_.size(); drain_pos_++) {
+    if (buffer_[drain_pos_].second != NULL) {
+      key_.swap(buffer_[drain_pos_].first);
+      eg_ = buffer_[drain_pos_].second;
+      buffer_[drain_pos_].second = NULL;
+      drain_pos_++;
+      return;
+    }
+  }
+  done_ = true;
+}
+
+ShuffledExampleReader::~ShuffledExampleReader() {
+  delete eg_;
+  for (size_t i = 0; i < buffer_.size(); i++)
+    delete buffer_[i].second;
+}
+
 } // namespace nnet3
 } // namespace kaldi
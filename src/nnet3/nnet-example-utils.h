@@ -23,6 +23,7 @@
 #include "nnet3/nnet-example.h"
 #include "nnet3/nnet-computation.h"
 #include "nnet3/nnet-compute.h"
+#include "itf/options-itf.h"
 
 namespace kaldi {
 namespace nnet3 {
@@ -64,6 +65,69 @@ void GetComputationRequest(const Nnet &nnet,
                            ComputationRequest *computation_request);
 
 
+/// Configuration class for ShuffledExampleReader.
+struct ExampleShufflerConfig {
+  int32 shuffle_buffer_size;
+  int32 srand_seed;
+
+  ExampleShufflerConfig(): shuffle_buffer_size(0), srand_seed(0) { }
+
+  void Register(OptionsItf *opts) {
+    opts->Register("shuffle-buffer-size", &shuffle_buffer_size,
+                   "If >0, randomize the order of the input examples using a "
+                   "buffer of this many examples, as a bounded-memory "
+                   "approximate shuffle (each example is held back a random "
+                   "number of positions, up to about the buffer size).");
+    opts->Register("srand", &srand_seed,
+                   "Seed for the random number generator used in shuffling.");
+  }
+};
+
+
+/** ShuffledExampleReader reads examples sequentially from an rspecifier and
+    outputs them in an approximately-shuffled order, using bounded memory: it
+    keeps a buffer ("reservoir") of config.shuffle_buffer_size examples, and
+    each incoming example displaces (and thereby outputs) the occupant of a
+    randomly chosen buffer slot.  This gives a local shuffle with a window on
+    the order of the buffer size, without reading the whole input into memory
+    or doing an extra read+write pass over the data; it is suitable for
+    training pipelines whose examples were written in a correlated order.  The
+    randomization is deterministic given config.srand_seed (it does not depend
+    on the global srand()).
+
+    The interface mirrors the sequential table readers: while (!Done()), access
+    Key() and Value(), then call Next().  Value() is valid until the next call
+    to Next(). */
+class ShuffledExampleReader {
+ public:
+  ShuffledExampleReader(const ExampleShufflerConfig &config,
+                        const std::string &examples_rspecifier);
+
+  bool Done() const { return done_; }
+
+  const std::string &Key() const { return key_; }
+
+  NnetExample &Value() { return *eg_; }
+
+  void Next();
+
+  ~ShuffledExampleReader();
+
+ private:
+  KALDI_DISALLOW_COPY_AND_ASSIGN(ShuffledExampleReader);
+
+  ExampleShufflerConfig config_;
+  SequentialNnetExampleReader reader_;
+  RandomState rand_state_;
+  // buffer_ has size config_.shuffle_buffer_size; slots with NULL .second are
+  // empty.  We own the examples in the buffer.
+  std::vector<std::pair<std::string, NnetExample*> > buffer_;
+  size_t drain_pos_;  // position in buffer_ while draining it at end of input.
+  std::string key_;   // key of the current output example.
+  NnetExample *eg_;   // current output example; owned here, NULL if none.
+  bool done_;
+};
+
 
 } // namespace nnet3
 } // namespace kaldi
@@ -60,7 +60,9 @@ NnetIo::NnetIo(const std::string &name,
   int32 num_rows = labels.size();
   KALDI_ASSERT(num_rows > 0);
   SparseMatrix<BaseFloat> sparse_feats(dim, labels);
-  features = sparse_feats;
+  // swap rather than assign, to avoid copying all the rows ("features" was
+  // just default-constructed, so it's empty).
+  features.SwapSparseMatrix(&sparse_feats);
   indexes.resize(num_rows);  // sets all n,t,x to zeros.
   for (int32 i = 0; i < num_rows; i++)
     indexes[i].t = t_begin + i;
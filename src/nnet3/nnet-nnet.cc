@@ -138,6 +138,23 @@ Component *Nnet::GetComponent(int32 c) {
   return components_[c];
 }
 
+void Nnet::SetComponent(int32 c, Component *component) {
+  KALDI_ASSERT(static_cast<size_t>(c) < components_.size());
+  KALDI_ASSERT(component->InputDim() == components_[c]->InputDim() &&
+               component->OutputDim() == components_[c]->OutputDim());
+  delete components_[c];
+  components_[c] = component;
+}
+
+int32 Nnet::AddComponent(const std::string &name, Component *component) {
+  KALDI_ASSERT(component != NULL && IsValidName(name) &&
+               GetComponentIndex(name) == -1);
+  int32 ans = components_.size();
+  components_.push_back(component);
+  component_names_.push_back(name);
+  return ans;
+}
+
 /// Returns true if this is component-input node, i.e. a node of type kDescriptor
 /// that immediately precedes a node of type kComponent.
 bool Nnet::IsComponentInputNode(int32 node) const {
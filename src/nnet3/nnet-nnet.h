@@ -130,6 +130,16 @@ class Nnet {
   /// caller.
   const Component *GetComponent(int32 c) const;
 
+  /// Replace the component indexed by c, deleting the old one.  Takes
+  /// ownership of the pointer.  The caller is responsible for supplying a
+  /// component whose input and output dims match the old one's, since the
+  /// network's nodes are unchanged.
+  void SetComponent(int32 c, Component *component);
+
+  /// Adds a new component with the given name (which must be a valid component
+  /// name that is not already the name of a component).  Takes ownership of
+  /// the pointer.  Returns the index of the new component.
+  int32 AddComponent(const std::string &name, Component *component);
 
   /// returns const reference to a particular numbered network node.
   const NetworkNode &GetNode(int32 node) const {
@@ -137,6 +147,15 @@ class Nnet {
     return nodes_[node];
   }
 
+  /// returns non-const reference to a particular numbered network node; this
+  /// is for code that modifies the structure of an existing network, such as
+  /// CollapseModelForInference() in nnet-utils.h.  Most code should use the
+  /// const version.
+  NetworkNode &GetNode(int32 node) {
+    KALDI_ASSERT(node >= 0 && node < nodes_.size());
+    return nodes_[node];
+  }
+
   /// Returns true if this is a component node, meaning that it is of type
   /// kComponent.
   bool IsComponentNode(int32 node) const;
@@ -224,6 +243,18 @@ class Nnet {
 
   // Assignment operator
   Nnet& operator =(const Nnet &nnet);
+
+  // This function outputs to "config_lines" the lines of a config file.  If you
+  // provide include_dim=false, this will enable you to reconstruct the nodes in
+  // the network (but not the components, which need to be written separately).
+  // If you provide include_dim=true, it also adds extra information about
+  // node dimensions which is useful for a human reader but won't be
+  // accepted as the config-file format.  (This is public because, with
+  // include_dim=true, it describes the structure of the network in a way that
+  // excludes the parameter values, which CachingOptimizingCompiler uses to
+  // check the validity of computation caches read from disk).
+  void GetConfigLines(bool include_dim,
+                      std::vector<std::string> *config_lines) const;
  private:
 
   void Destroy();
@@ -235,15 +266,6 @@ class Nnet {
   // include dimension information that would not be provided in a config file.
   std::string GetAsConfigLine(int32 node_index, bool include_dim) const;
 
-  // This function outputs to "config_lines" the lines of a config file.  If you
-  // provide include_dim=false, this will enable you to reconstruct the nodes in
-  // the network (but not the components, which need to be written separately).
-  // If you provide include_dim=true, it also adds extra information about
-  // node dimensions which is useful for a human reader but won't be
-  // accepted as the config-file format.
-  void GetConfigLines(bool include_dim,
-                      std::vector<std::string> *config_lines) const;
-
   // This function is used when reading config files; it exists in order to
   // handle replacement of existing nodes.  The two input vectors have the same
   // size.  Its job is to remove redundant lines that do not have "component" as
@@ -27,6 +27,35 @@
 namespace kaldi {
 namespace nnet3 {
 
+// Checks that a ComputationRequest survives a write/read round trip
+// unchanged (this I/O is used by the on-disk computation cache).
+static void UnitTestComputationRequestIo(ComputationRequest *request) {
+  bool binary = (Rand() % 2 == 0);
+  std::ostringstream os;
+  request->Write(os, binary);
+  std::istringstream is(os.str());
+  ComputationRequest request2;
+  request2.Read(is, binary);
+  KALDI_ASSERT(*request == request2);
+}
+
+// Checks that an NnetComputation survives a write/read round trip, by
+// comparing the serialized forms (the struct has no operator ==).
+static void UnitTestNnetComputationIo(NnetComputation *computation) {
+  bool binary = (Rand() % 2 == 0);
+  std::ostringstream os;
+  computation->Write(os, binary);
+  std::istringstream is(os.str());
+  NnetComputation computation2;
+  computation2.Read(is, binary);
+  std::istringstream is2(os.str());
+  computation2.Read(is2, binary);  // read twice, to check that Read()
+                                   // clears any existing contents.
+  std::ostringstream os2;
+  computation2.Write(os2, binary);
+  KALDI_ASSERT(os.str() == os2.str());
+}
+
 // Run the test wothout optimizations and with optimizations specified by the
 // parameter. Only print warnings; we'll fail the whole test later.
 static bool UnitTestNnetOptimizeWithOptions(NnetOptimizeOptions opt_config) {
@@ -68,6 +97,10 @@ static bool UnitTestNnetOptimizeWithOptions(NnetOptimizeOptions opt_config) {
     ComputationChecker checker(check_config, nnet, request, computation);
     checker.Check();
 
+    UnitTestComputationRequestIo(&request);
+    if (computation.component_precomputed_indexes.size() <= 1)
+      UnitTestNnetComputationIo(&computation);
+
     NnetComputation computation_opt(computation);
 
     {
@@ -211,6 +244,10 @@ static void UnitTestNnetOptimize() {
   optimize.move_sizing_commands = false;
   bool succ_no_move_sizing_commands = UnitTestNnetOptimizeWithOptions(optimize);
 
+  optimize = optimize_all;
+  optimize.share_storage = false;
+  bool succ_no_share_storage = UnitTestNnetOptimizeWithOptions(optimize);
+
 #define KALDI_SUCCFAIL(b) ((b) ? "SUCCESS" : "FAILURE")
   KALDI_ERR
     << "Test failed with all optimizations enabled. Retried test with the "
@@ -219,7 +256,8 @@ static void UnitTestNnetOptimize() {
     << "\n  backprop_in_place    ... " << KALDI_SUCCFAIL(succ_no_backprop_in_place)
     << "\n  remove_assignments   ... " << KALDI_SUCCFAIL(succ_no_remove_assignments)
     << "\n  initialize_undefined ... " << KALDI_SUCCFAIL(succ_no_initialize_undefined)
-    << "\n  move_sizing_commands ... " << KALDI_SUCCFAIL(succ_no_move_sizing_commands);
+    << "\n  move_sizing_commands ... " << KALDI_SUCCFAIL(succ_no_move_sizing_commands)
+    << "\n  share_storage        ... " << KALDI_SUCCFAIL(succ_no_share_storage);
 #undef KALDI_SUCCFAIL
 }
 
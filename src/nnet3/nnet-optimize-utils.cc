@@ -615,6 +615,165 @@ void RemoveNoOps(NnetComputation *computation) {
   computation->commands.resize(output_iter - computation->commands.begin());
 }
 
+// Used in ShareMatrixStorage(), this struct represents a set of matrices
+// with non-overlapping lifetimes, which will be made to share one block of
+// storage.  We declare it here as it is not needed outside this file.
+struct MatrixStorageSlot {
+  std::vector<int32> members;  // matrix indexes, in order of allocation time.
+  int32 last_dealloc;  // deallocation command-index of the latest member.
+  int32 min_rows;   // smallest num-rows of any member.
+  int32 max_rows;   // largest num-rows of any member.
+};
+
+void ShareMatrixStorage(const Nnet &nnet, NnetComputation *computation) {
+  Analyzer analyzer;
+  analyzer.Init(nnet, *computation);
+  const std::vector<MatrixAccesses> &matrix_accesses = analyzer.matrix_accesses;
+  int32 num_matrices = computation->matrices.size();
+
+  // Get the list of candidate matrices, sorted on the command-index of their
+  // allocation (the greedy assignment below relies on seeing them in order of
+  // the start of their lifetimes).  We restrict ourselves to matrices that
+  // are allocated as undefined and deallocated normally: for these we know
+  // (and the ComputationChecker has verified) that every part of the matrix
+  // is written before it is read, so stale data from a previous occupant of
+  // the same storage can never be read; and matrices involved in
+  // kAllocMatrixFromOther commands already share storage with some other
+  // matrix, so we leave them alone.
+  std::vector<std::pair<int32, int32> > candidates;  // (allocate_command, m).
+  for (int32 m = 1; m < num_matrices; m++) {
+    const MatrixAccesses &ma = matrix_accesses[m];
+    if (ma.is_input || ma.is_output ||
+        ma.allocate_command == -1 || ma.deallocate_command == -1 ||
+        ma.accesses.empty())
+      continue;
+    if (computation->commands[ma.allocate_command].command_type !=
+        kAllocMatrixUndefined ||
+        computation->commands[ma.deallocate_command].command_type !=
+        kDeallocMatrix)
+      continue;
+    candidates.push_back(std::pair<int32, int32>(ma.allocate_command, m));
+  }
+  std::sort(candidates.begin(), candidates.end());
+
+  // Assign each candidate to a "slot"; matrices in the same slot will share
+  // storage.  Only matrices with the same number of columns can share (the
+  // sharing works by re-pointing their submatrices into a taller matrix, so
+  // the column structure has to agree).  Among the slots whose current
+  // lifetime ends before this matrix's begins, we pick the one that became
+  // free most recently; we also require the row-counts within a slot to be
+  // within a factor of two of each other, because making a small matrix
+  // share the storage of a much taller one could actually increase the
+  // memory in use while the small one is alive.
+  typedef unordered_map<int32, std::vector<MatrixStorageSlot> > MapType;
+  MapType slot_map;
+  for (size_t i = 0; i < candidates.size(); i++) {
+    int32 allocate_command = candidates[i].first, m = candidates[i].second;
+    int32 num_rows = computation->matrices[m].num_rows,
+        num_cols = computation->matrices[m].num_cols;
+    std::vector<MatrixStorageSlot> &slots = slot_map[num_cols];
+    int32 best_slot = -1, best_dealloc = -1;
+    for (size_t s = 0; s < slots.size(); s++) {
+      const MatrixStorageSlot &slot = slots[s];
+      if (slot.last_dealloc < allocate_command &&
+          slot.last_dealloc > best_dealloc &&
+          std::max(slot.max_rows, num_rows) <=
+          2 * std::min(slot.min_rows, num_rows)) {
+        best_slot = s;
+        best_dealloc = slot.last_dealloc;
+      }
+    }
+    if (best_slot == -1) {
+      slots.resize(slots.size() + 1);
+      MatrixStorageSlot &slot = slots.back();
+      slot.min_rows = num_rows;
+      slot.max_rows = num_rows;
+      slot.members.push_back(m);
+      slot.last_dealloc = matrix_accesses[m].deallocate_command;
+    } else {
+      MatrixStorageSlot &slot = slots[best_slot];
+      slot.min_rows = std::min(slot.min_rows, num_rows);
+      slot.max_rows = std::max(slot.max_rows, num_rows);
+      slot.members.push_back(m);
+      slot.last_dealloc = matrix_accesses[m].deallocate_command;
+    }
+  }
+
+  // For each slot with more than one member, create the shared matrix and
+  // replace the members with it.  "replacement" maps from the old matrix
+  // index to the shared matrix index, or -1 for matrices we don't touch.
+  std::vector<int32> replacement(num_matrices, -1);
+  bool changed = false;
+  for (MapType::iterator iter = slot_map.begin(); iter != slot_map.end();
+       ++iter) {
+    int32 num_cols = iter->first;
+    const std::vector<MatrixStorageSlot> &slots = iter->second;
+    for (size_t s = 0; s < slots.size(); s++) {
+      const MatrixStorageSlot &slot = slots[s];
+      if (slot.members.size() < 2)
+        continue;
+      changed = true;
+      int32 shared_matrix = computation->matrices.size();
+      computation->matrices.push_back(
+          NnetComputation::MatrixInfo(slot.max_rows, num_cols));
+      if (!computation->matrix_debug_info.empty()) {
+        // the debug info can only describe one occupant of the storage; we
+        // arbitrarily use that of the tallest member, which at least has the
+        // right number of rows.
+        int32 tallest_member = slot.members[0];
+        for (size_t j = 1; j < slot.members.size(); j++)
+          if (computation->matrices[slot.members[j]].num_rows >
+              computation->matrices[tallest_member].num_rows)
+            tallest_member = slot.members[j];
+        computation->matrix_debug_info.push_back(
+            computation->matrix_debug_info[tallest_member]);
+      }
+      for (size_t j = 0; j < slot.members.size(); j++) {
+        int32 member = slot.members[j];
+        replacement[member] = shared_matrix;
+        const MatrixAccesses &ma = matrix_accesses[member];
+        NnetComputation::Command
+            &alloc_command = computation->commands[ma.allocate_command],
+            &dealloc_command = computation->commands[ma.deallocate_command];
+        if (j == 0) {
+          // the first member's allocation command becomes the allocation of
+          // the shared matrix.  We allocate it zeroed, although the members
+          // were allocated undefined: a write to a sub-matrix that does not
+          // span the whole of a matrix is treated by the analysis code as a
+          // read-write operation, so with an undefined allocation the
+          // checker would report reads of undefined data.  The cost of the
+          // zeroing is small compared with what we save by not allocating.
+          alloc_command = NnetComputation::Command(kAllocMatrixZeroed,
+                                                   shared_matrix);
+        } else {
+          alloc_command = NnetComputation::Command(kNoOperation);
+        }
+        if (j + 1 == slot.members.size())
+          dealloc_command = NnetComputation::Command(kDeallocMatrix,
+                                                     shared_matrix);
+        else
+          dealloc_command = NnetComputation::Command(kNoOperation);
+      }
+    }
+  }
+  if (!changed)
+    return;
+
+  // Re-point the members' submatrices at the shared matrices.  The row and
+  // column offsets don't change: each member just uses the first part of the
+  // shared storage.
+  int32 num_submatrices = computation->submatrices.size();
+  for (int32 submat = 1; submat < num_submatrices; submat++) {
+    int32 &matrix_index = computation->submatrices[submat].matrix_index;
+    if (replacement[matrix_index] != -1)
+      matrix_index = replacement[matrix_index];
+  }
+  RemoveNoOps(computation);
+  // this removes the now-unused matrices (and merges any duplicate
+  // submatrices that the re-pointing may have created).
+  RenumberComputation(computation);
+}
+
 /// Wherever matrix orig_matrix_index appears in the input of the network
 /// (i.e. in computation->input_output_info), replaces it with new_matrix_index.
 /// Returns true if it did replace it.
@@ -531,6 +531,17 @@ void RenumberComputation(NnetComputation *computation);
 /// Removes commands of type kNoOperation in the computation.
 void RemoveNoOps(NnetComputation *computation);
 
+/// This function performs lifetime analysis on the matrices of the
+/// computation and makes matrices with the same number of columns and
+/// non-overlapping lifetimes share a single block of storage, reducing the
+/// peak memory of large computations (e.g. recurrent nets on long
+/// utterances).  It complements RemoveUnnecessaryAllocation(), which handles
+/// the case of matrices with identical dimensions; this function also pairs
+/// up matrices whose row-counts differ (by up to a factor of two).  Expected
+/// to be called at the end of optimization, after MoveSizingCommands() and
+/// RemoveUnnecessaryAllocation().
+void ShareMatrixStorage(const Nnet &nnet, NnetComputation *computation);
+
 /// Wherever matrix orig_matrix_index appears in the input of the network
 /// (i.e. in computation->input_output_info), replaces it with new_matrix_index.
 /// Returns true if it did replace it.
@@ -19,6 +19,7 @@
 
 #include "nnet3/nnet-optimize.h"
 #include "nnet3/nnet-optimize-utils.h"
+#include "thread/kaldi-thread.h"
 
 namespace kaldi {
 namespace nnet3 {
@@ -323,6 +324,69 @@ void ConvertAdditionToAssignment(const Nnet &nnet,
   }
 }
 
+void BatchPropagateCommands(const Nnet &nnet, NnetComputation *computation) {
+  int32 num_commands = computation->commands.size(),
+      num_merged = 0;
+  for (int32 c = 0; c < num_commands; c++) {
+    NnetComputation::Command &command = computation->commands[c];
+    // We only consider Propagate commands without precomputed indexes
+    // (simple components never have them).
+    if (command.command_type != kPropagate || command.arg2 != 0)
+      continue;
+    const Component *component = nnet.GetComponent(command.arg1);
+    if (!(component->Properties() & kSimpleComponent))
+      continue;
+    // These are copies, not references: we will be appending to the
+    // submatrices vector below, which could invalidate references.
+    NnetComputation::SubMatrixInfo in_info =
+        computation->submatrices[command.arg3],
+        out_info = computation->submatrices[command.arg4];
+    // See how many of the immediately following commands are Propagates of the
+    // same component whose input (and output) submatrices directly follow the
+    // current combined row-range in the same underlying matrix.
+    int32 d = c + 1;
+    for (; d < num_commands; d++) {
+      const NnetComputation::Command &next = computation->commands[d];
+      if (next.command_type != kPropagate || next.arg1 != command.arg1 ||
+          next.arg2 != 0)
+        break;
+      const NnetComputation::SubMatrixInfo
+          &next_in = computation->submatrices[next.arg3],
+          &next_out = computation->submatrices[next.arg4];
+      if (!(next_in.matrix_index == in_info.matrix_index &&
+            next_in.col_offset == in_info.col_offset &&
+            next_in.num_cols == in_info.num_cols &&
+            next_in.row_offset == in_info.row_offset + in_info.num_rows &&
+            next_out.matrix_index == out_info.matrix_index &&
+            next_out.col_offset == out_info.col_offset &&
+            next_out.num_cols == out_info.num_cols &&
+            next_out.row_offset == out_info.row_offset + out_info.num_rows))
+        break;
+      in_info.num_rows += next_in.num_rows;
+      out_info.num_rows += next_out.num_rows;
+    }
+    if (d == c + 1)  // no adjacent command could be merged into this one.
+      continue;
+    // Create submatrices covering the combined row-ranges.  We can't use
+    // NewSubMatrix here because the combined range extends beyond any of the
+    // existing submatrices; appending directly is fine (duplicates, if any,
+    // will be cleaned up when the computation is renumbered).
+    command.arg3 = static_cast<int32>(computation->submatrices.size());
+    computation->submatrices.push_back(in_info);
+    command.arg4 = static_cast<int32>(computation->submatrices.size());
+    computation->submatrices.push_back(out_info);
+    for (int32 e = c + 1; e < d; e++)
+      computation->commands[e].command_type = kNoOperation;
+    num_merged += d - (c + 1);
+    c = d - 1;  // skip over the commands we just merged.
+  }
+  if (num_merged > 0) {
+    RemoveNoOps(computation);
+    KALDI_VLOG(3) << "Merged " << num_merged
+                  << " propagate commands into adjacent ones.";
+  }
+}
+
 void Optimize(const NnetOptimizeOptions &config,
               const Nnet &nnet,
               const ComputationRequest &request,
@@ -360,6 +424,12 @@ void Optimize(const NnetOptimizeOptions &config,
   if (GetVerboseLevel() >= 4)
     CheckComputation(nnet, request, *computation, false);
 
+  if (config.batch_propagate)
+    BatchPropagateCommands(nnet, computation);
+
+  if (GetVerboseLevel() >= 4)
+    CheckComputation(nnet, request, *computation, false);
+
   if (config.initialize_undefined)
     RemoveUnnecessaryZeroing(nnet, computation);
 
@@ -377,6 +447,12 @@ void Optimize(const NnetOptimizeOptions &config,
 
   if (GetVerboseLevel() >= 4)
     CheckComputation(nnet, request, *computation, false);
+
+  if (config.share_storage)
+    ShareMatrixStorage(nnet, computation);
+
+  if (GetVerboseLevel() >= 4)
+    CheckComputation(nnet, request, *computation, false);
 }
 
 // ComputationRequests are distinguished by the names and indexes
@@ -445,6 +521,201 @@ CachingOptimizingCompiler::~CachingOptimizingCompiler() {
   }
 }
 
+int64 CachingOptimizingCompiler::NnetStructureHash() const {
+  // We hash the config lines (which describe the nodes and their dimensions)
+  // plus the component names and types; this determines the validity of a
+  // compiled computation, while excluding the parameter values so the hash
+  // is stable as the model trains.
+  std::ostringstream os;
+  std::vector<std::string> config_lines;
+  bool include_dim = true;
+  nnet_.GetConfigLines(include_dim, &config_lines);
+  for (size_t i = 0; i < config_lines.size(); i++)
+    os << config_lines[i] << "\n";
+  for (int32 c = 0; c < nnet_.NumComponents(); c++)
+    os << nnet_.GetComponentName(c) << " "
+       << nnet_.GetComponent(c)->Type() << "\n";
+  StringHasher hasher;
+  return static_cast<int64>(hasher(os.str()));
+}
+
+void CachingOptimizingCompiler::WriteCache(std::ostream &os,
+                                           bool binary) const {
+  WriteToken(os, binary, "<NnetComputationCache>");
+  WriteToken(os, binary, "<NnetHash>");
+  WriteBasicType(os, binary, NnetStructureHash());
+  int32 num_entries = 0, num_skipped = 0;
+  AqType::const_iterator qiter = access_queue_.begin(),
+      qend = access_queue_.end();
+  for (; qiter != qend; ++qiter) {
+    CacheType::const_iterator citer = computation_cache_.find(*qiter);
+    KALDI_ASSERT(citer != computation_cache_.end());
+    if (citer->second.first->component_precomputed_indexes.size() > 1)
+      num_skipped++;  // not serializable; see NnetComputation::Write.
+    else
+      num_entries++;
+  }
+  if (num_skipped > 0)
+    KALDI_WARN << "Not writing " << num_skipped << " cached computation(s) "
+               << "that use precomputed indexes, which are not serializable.";
+  WriteToken(os, binary, "<NumEntries>");
+  WriteBasicType(os, binary, num_entries);
+  // We write in access-queue order (least-recently-used first), so that when
+  // the cache is read back, the most-recently-used entries end up freshest.
+  for (qiter = access_queue_.begin(); qiter != qend; ++qiter) {
+    CacheType::const_iterator citer = computation_cache_.find(*qiter);
+    if (citer->second.first->component_precomputed_indexes.size() > 1)
+      continue;
+    citer->first->Write(os, binary);
+    citer->second.first->Write(os, binary);
+  }
+  WriteToken(os, binary, "</NnetComputationCache>");
+}
+
+void CachingOptimizingCompiler::ReadCache(std::istream &is, bool binary) {
+  ExpectToken(is, binary, "<NnetComputationCache>");
+  ExpectToken(is, binary, "<NnetHash>");
+  int64 nnet_hash;
+  ReadBasicType(is, binary, &nnet_hash);
+  if (nnet_hash != NnetStructureHash()) {
+    KALDI_WARN << "Computation cache was compiled for a network with a "
+               << "different structure; ignoring it.";
+    return;
+  }
+  ExpectToken(is, binary, "<NumEntries>");
+  int32 num_entries;
+  ReadBasicType(is, binary, &num_entries);
+  KALDI_ASSERT(num_entries >= 0);
+  // make sure reading the cache does not evict anything.
+  if (static_cast<int32>(computation_cache_.size()) + num_entries >
+      cache_capacity_)
+    cache_capacity_ = computation_cache_.size() + num_entries;
+  for (int32 i = 0; i < num_entries; i++) {
+    ComputationRequest *request = new ComputationRequest;
+    request->Read(is, binary);
+    NnetComputation *computation = new NnetComputation;
+    computation->Read(is, binary);
+    if (computation_cache_.count(request) != 0) {
+      // a computation for this request is already cached.
+      delete request;
+      delete computation;
+      continue;
+    }
+    computation->ComputeCudaIndexes();
+    UpdateCache(request, computation);
+  }
+  ExpectToken(is, binary, "</NnetComputationCache>");
+}
+
+// Compiles, checks and optimizes the computation for "request": this is the
+// work that CachingOptimizingCompiler::Compile() does on a cache miss,
+// factored out so CompileMultiple() can invoke it from worker threads (it
+// touches no shared state).  Does not call ComputeCudaIndexes(), which the
+// caller should do from a single thread.  The caller takes ownership of the
+// returned computation.
+static NnetComputation* CompileAndOptimize(
+    const Nnet &nnet,
+    const NnetOptimizeOptions &opt_config,
+    const ComputationRequest &request) {
+  Compiler compiler(request, nnet);
+  CompilerOptions opts;
+  NnetComputation *computation = new NnetComputation;
+  compiler.CreateComputation(opts, computation);
+
+  int32 verbose_cutoff = 4;
+  if (GetVerboseLevel() >= verbose_cutoff) {
+    std::ostringstream os1;
+    request.Print(os1);
+    KALDI_LOG << "Computation request is " << os1.str();
+    std::ostringstream os2;
+    computation->Print(os2, nnet);
+    KALDI_LOG << "Generated computation is: " << os2.str();
+  }
+  { // some checking.
+    CheckComputationOptions check_config;
+    // we can do the rewrite check since it's before optimization.
+    check_config.check_rewrite = true;
+    ComputationChecker checker(check_config, nnet, request,
+                               *computation);
+    checker.Check();
+  }
+  Optimize(opt_config, nnet, request, computation);
+  if (GetVerboseLevel() >= verbose_cutoff) {
+    std::ostringstream os;
+    computation->Print(os, nnet);
+    KALDI_LOG << "Optimized computation is: " << os.str();
+  }
+  {  // check the computation again.
+    CheckComputationOptions check_config;
+    ComputationChecker checker(check_config, nnet, request, *computation);
+    checker.Check();
+  }
+  return computation;
+}
+
+// Worker for CachingOptimizingCompiler::CompileMultiple(): thread i compiles
+// the requests whose indexes equal i modulo the number of threads.  The
+// output slots are distinct across threads, so no locking is needed.
+class ParallelCompilationWorker: public MultiThreadable {
+ public:
+  ParallelCompilationWorker(
+      const Nnet &nnet,
+      const NnetOptimizeOptions &opt_config,
+      const std::vector<const ComputationRequest*> &requests,
+      std::vector<NnetComputation*> *computations):
+      nnet_(nnet), opt_config_(opt_config), requests_(requests),
+      computations_(computations) { }
+  void operator() () {
+    for (size_t i = thread_id_; i < requests_.size(); i += num_threads_)
+      (*computations_)[i] = CompileAndOptimize(nnet_, opt_config_,
+                                               *(requests_[i]));
+  }
+ private:
+  const Nnet &nnet_;
+  const NnetOptimizeOptions &opt_config_;
+  const std::vector<const ComputationRequest*> &requests_;
+  std::vector<NnetComputation*> *computations_;
+};
+
+void CachingOptimizingCompiler::CompileMultiple(
+    const std::vector<const ComputationRequest*> &requests) {
+  // Work out which requests actually need compiling: skip any that are
+  // already cached, and any duplicates within the batch itself.
+  ComputationRequestPtrEqual equal;
+  std::vector<const ComputationRequest*> to_compile;
+  for (size_t i = 0; i < requests.size(); i++) {
+    const ComputationRequest *request = requests[i];
+    if (computation_cache_.count(request) != 0)
+      continue;
+    bool duplicate = false;
+    for (size_t j = 0; j < to_compile.size() && !duplicate; j++)
+      if (equal(to_compile[j], request))
+        duplicate = true;
+    if (!duplicate)
+      to_compile.push_back(request);
+  }
+  if (to_compile.empty())
+    return;
+  std::vector<NnetComputation*> computations(to_compile.size(),
+                                             static_cast<NnetComputation*>(NULL));
+  {
+    ParallelCompilationWorker worker(nnet_, opt_config_, to_compile,
+                                     &computations);
+    RunMultiThreaded(worker);
+  }
+  // make sure adding the new computations does not evict anything.
+  if (static_cast<int32>(computation_cache_.size() + to_compile.size()) >
+      cache_capacity_)
+    cache_capacity_ = computation_cache_.size() + to_compile.size();
+  for (size_t i = 0; i < to_compile.size(); i++) {
+    // ComputeCudaIndexes() is done here rather than in the workers, as it may
+    // interact with the GPU.
+    computations[i]->ComputeCudaIndexes();
+    ComputationRequest *request = new ComputationRequest(*(to_compile[i]));
+    UpdateCache(request, computations[i]);
+  }
+}
+
 const NnetComputation* CachingOptimizingCompiler::Compile(
     const ComputationRequest  &in_request) {
   NnetComputation *computation;
@@ -455,39 +726,7 @@ const NnetComputation* CachingOptimizingCompiler::Compile(
     // if not found, compile and update cache
     request = new ComputationRequest;
     *request = in_request;
-    Compiler compiler(*request, nnet_);
-    CompilerOptions opts;
-    computation = new NnetComputation;
-    compiler.CreateComputation(opts, computation);
-
-    int32 verbose_cutoff = 4;
-    if (GetVerboseLevel() >= verbose_cutoff) {
-      std::ostringstream os1;
-      request->Print(os1);
-      KALDI_LOG << "Computation request is " << os1.str();
-      std::ostringstream os2;
-      computation->Print(os2, nnet_);
-      KALDI_LOG << "Generated computation is: " << os2.str();
-    }
-    { // some checking.
-      CheckComputationOptions check_config;
-      // we can do the rewrite check since it's before optimization.
-      check_config.check_rewrite = true;
-      ComputationChecker checker(check_config, nnet_, *request,
-                                 *computation);
-      checker.Check();
-    }
-    Optimize(opt_config_, nnet_, *request, computation);
-    if (GetVerboseLevel() >= verbose_cutoff) {
-      std::ostringstream os;
-      computation->Print(os, nnet_);
-      KALDI_LOG << "Optimized computation is: " << os.str();
-    }
-    {  // check the computation again.
-      CheckComputationOptions check_config;
-      ComputationChecker checker(check_config, nnet_, *request, *computation);
-      checker.Check();
-    }
+    computation = CompileAndOptimize(nnet_, opt_config_, *request);
     computation->ComputeCudaIndexes();
     UpdateCache(request, computation);
   } else {
@@ -43,6 +43,8 @@ struct NnetOptimizeOptions {
   bool initialize_undefined;
   bool move_sizing_commands;
   bool allocate_from_other;
+  bool share_storage;
+  bool batch_propagate;
   int32 min_deriv_time;
   int32 max_deriv_time;
 
@@ -57,6 +59,8 @@ struct NnetOptimizeOptions {
                          initialize_undefined(true),
                          move_sizing_commands(true),
                          allocate_from_other(true),
+                         share_storage(true),
+                         batch_propagate(true),
                          min_deriv_time(std::numeric_limits<int32>::min()),
                          max_deriv_time(std::numeric_limits<int32>::max()) { }
 
@@ -90,6 +94,16 @@ struct NnetOptimizeOptions {
     opts->Register("allocate-from-other", &allocate_from_other, "Instead of "
                    "deleting a matrix of a given size and then allocating "
                    "a matrix of the same size, allow re-use of that memory");
+    opts->Register("share-storage", &share_storage, "If true, perform "
+                   "lifetime analysis on the matrices of the computation and "
+                   "let matrices with non-overlapping lifetimes share "
+                   "storage; this reduces the peak memory of large "
+                   "computations (e.g. recurrent nets on long utterances)");
+    opts->Register("batch-propagate", &batch_propagate, "Set to false to "
+                   "disable optimization that merges consecutive Propagate "
+                   "commands on the same component (e.g. for different "
+                   "time-shifts) into a single larger Propagate, reducing "
+                   "the number of kernel launches");
     opts->Register("min-deriv-time", &min_deriv_time, "You can set this to "
                    "the minimum t value that you want derivatives to be computed "
                    "at when updating the model.  This is an optimization that "
@@ -147,7 +161,40 @@ class CachingOptimizingCompiler {
   /// It calls ComputeCudaIndexes() for you, because you wouldn't
   /// be able to do this on a const object.
   const NnetComputation* Compile(const ComputationRequest &request);
+
+  /// Compiles those of the supplied requests that are not already in the
+  /// cache, using multiple threads (up to g_num_threads, see
+  /// thread/kaldi-thread.h), and adds the results to the cache (increasing
+  /// the cache capacity if needed so that nothing is evicted).  Each request
+  /// is independent work, so this parallelizes e.g. server warm-up over all
+  /// the distinct chunk shapes you expect to see.  The requests pointers are
+  /// only required to be valid for the duration of the call.  Note: this
+  /// function itself must be called from a single thread, like the rest of
+  /// this class's interface.
+  void CompileMultiple(const std::vector<const ComputationRequest*> &requests);
+
+  /// Writes the contents of the cache to disk, so that a later process can
+  /// avoid the compilation and optimization cost for the same requests (see
+  /// ReadCache()); e.g. online-decoding servers can use this to avoid a
+  /// several-second warm-up and a latency spike on the first request.
+  /// Computations that use precomputed indexes are skipped with a warning,
+  /// as those are not serializable (this does not happen for typical
+  /// feed-forward and splicing setups).
+  void WriteCache(std::ostream &os, bool binary) const;
+
+  /// Reads a cache previously written with WriteCache(), and adds its
+  /// contents to the cache (increasing the cache capacity if needed so that
+  /// nothing read is evicted).  The cache file records a hash of the
+  /// structure of the nnet it was compiled for; if it does not match this
+  /// object's nnet the cache is ignored with a warning, since the stored
+  /// computations would be invalid.
+  void ReadCache(std::istream &is, bool binary);
  private:
+  /// Returns a hash of the structural part of nnet_ (config lines, component
+  /// names and types), used to check that a cache read from disk was
+  /// compiled for the same network.  Parameter values are excluded, so the
+  /// hash is stable across training iterations.
+  int64 NnetStructureHash() const;
   const Nnet &nnet_;
   NnetOptimizeOptions opt_config_;
 
@@ -244,6 +291,17 @@ void VariableMergingOptimization(const NnetOptimizeOptions &config,
 void RemoveUnnecessaryZeroing(const Nnet &nnet, NnetComputation *computation);
 
 
+/// This optimization merges, where possible, runs of consecutive kPropagate
+/// commands on the same (simple) component whose input submatrices, and
+/// likewise whose output submatrices, are adjacent row-ranges of the same
+/// underlying matrices (as happens for the per-time-shift propagations of
+/// recurrent and TDNN setups), into a single kPropagate on the combined
+/// row-ranges.  Simple components operate independently on each row, so this
+/// does not change the result; it just replaces several small kernel
+/// invocations with one larger one.  Only strictly consecutive commands are
+/// merged, so no dependency analysis is needed.
+void BatchPropagateCommands(const Nnet &nnet, NnetComputation *computation);
+
 /// This optimization moves commands that initialize matrices to as late as
 /// possible, and commands that empty matrices to as early as possible.
 void MoveSizingCommands(const Nnet &nnet, NnetComputation *computation);
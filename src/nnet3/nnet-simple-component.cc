@@ -22,6 +22,7 @@
 #include <sstream>
 #include "nnet3/nnet-simple-component.h"
 #include "nnet3/nnet-parse.h"
+#include "cudamatrix/cu-math.h"
 
 namespace kaldi {
 namespace nnet3 {
@@ -1114,6 +1115,13 @@ void NaturalGradientAffineComponent::InitFromConfig(ConfigLine *cfl) {
     KALDI_ERR << "Bad initializer " << cfl->WholeLine();
 }
 
+void NaturalGradientAffineComponent::SetUpdatePeriod(int32 update_period) {
+  KALDI_ASSERT(update_period >= 1);
+  update_period_ = update_period;
+  preconditioner_in_.SetUpdatePeriod(update_period_);
+  preconditioner_out_.SetUpdatePeriod(update_period_);
+}
+
 void NaturalGradientAffineComponent::SetNaturalGradientConfigs() {
   preconditioner_in_.SetRank(rank_in_);
   preconditioner_in_.SetNumSamplesHistory(num_samples_history_);
@@ -1448,6 +1456,209 @@ void FixedAffineComponent::Read(std::istream &is, bool binary) {
   ExpectToken(is, binary, "</FixedAffineComponent>");
 }
 
+std::string QuantizedAffineComponent::Info() const {
+  std::stringstream stream;
+  BaseFloat bias_params_stddev =
+      std::sqrt(VecVec(bias_params_, bias_params_) / bias_params_.Dim());
+  stream << Component::Info()
+         << ", linear-params-quantized-bytes="
+         << (linear_params_.NumRows() * linear_params_.NumCols())
+         << ", bias-params-stddev=" << bias_params_stddev;
+  return stream.str();
+}
+
+void QuantizedAffineComponent::Init(const CuMatrixBase<BaseFloat> &mat) {
+  KALDI_ASSERT(mat.NumCols() > 1);
+  CuSubMatrix<BaseFloat> linear(mat, 0, mat.NumRows(), 0, mat.NumCols() - 1);
+  linear_params_.CopyFromMat(linear);
+  bias_params_.Resize(mat.NumRows());
+  bias_params_.CopyColFromMat(mat, mat.NumCols() - 1);
+}
+
+void QuantizedAffineComponent::InitFromConfig(ConfigLine *cfl) {
+  std::string filename;
+  // Two forms allowed: "matrix=<rxfilename>", or "input-dim=x output-dim=y"
+  // (for testing purposes only).
+  if (cfl->GetValue("matrix", &filename)) {
+    if (cfl->HasUnusedValues())
+      KALDI_ERR << "Invalid initializer for layer of type "
+                << Type() << ": \"" << cfl->WholeLine() << "\"";
+
+    bool binary;
+    Input ki(filename, &binary);
+    CuMatrix<BaseFloat> mat;
+    mat.Read(ki.Stream(), binary);
+    KALDI_ASSERT(mat.NumRows() != 0);
+    Init(mat);
+  } else {
+    int32 input_dim, output_dim;
+    if (!cfl->GetValue("input-dim", &input_dim) ||
+        !cfl->GetValue("output-dim", &output_dim) || cfl->HasUnusedValues()) {
+      KALDI_ERR << "Invalid initializer for layer of type "
+                << Type() << ": \"" << cfl->WholeLine() << "\"";
+    }
+    CuMatrix<BaseFloat> mat(output_dim, input_dim + 1);
+    mat.SetRandn();
+    Init(mat);
+  }
+}
+
+void QuantizedAffineComponent::Propagate(
+    const ComponentPrecomputedIndexes *indexes,
+    const CuMatrixBase<BaseFloat> &in,
+    CuMatrixBase<BaseFloat> *out) const  {
+  out->CopyRowsFromVec(bias_params_); // Adds the bias term first.
+  AddMatMatQuantized(1.0, in, kNoTrans, linear_params_, kTrans, 1.0, out);
+}
+
+void QuantizedAffineComponent::Backprop(
+    const std::string &debug_info,
+    const ComponentPrecomputedIndexes *indexes,
+    const CuMatrixBase<BaseFloat> &, //in_value
+    const CuMatrixBase<BaseFloat> &, //out_value
+    const CuMatrixBase<BaseFloat> &out_deriv,
+    Component *, //to_update
+    CuMatrixBase<BaseFloat> *in_deriv) const {
+  // kBackpropAdds is true. It's the user's responsibility to zero out
+  // <in_deriv> if they need it to be so.  This component is meant for
+  // inference, so we don't mind dequantizing the parameters here.
+  if (in_deriv) {
+    CuMatrix<BaseFloat> linear(linear_params_.NumRows(),
+                               linear_params_.NumCols(), kUndefined);
+    linear_params_.CopyToMat(&linear);
+    in_deriv->AddMatMat(1.0, out_deriv, kNoTrans, linear, kNoTrans, 1.0);
+  }
+}
+
+Component* QuantizedAffineComponent::Copy() const {
+  QuantizedAffineComponent *ans = new QuantizedAffineComponent();
+  ans->linear_params_ = linear_params_;
+  ans->bias_params_ = bias_params_;
+  return ans;
+}
+
+void QuantizedAffineComponent::Write(std::ostream &os, bool binary) const {
+  WriteToken(os, binary, "<QuantizedAffineComponent>");
+  WriteToken(os, binary, "<LinearParams>");
+  linear_params_.Write(os, binary);
+  WriteToken(os, binary, "<BiasParams>");
+  bias_params_.Write(os, binary);
+  WriteToken(os, binary, "</QuantizedAffineComponent>");
+}
+
+void QuantizedAffineComponent::Read(std::istream &is, bool binary) {
+  ExpectOneOrTwoTokens(is, binary, "<QuantizedAffineComponent>",
+                       "<LinearParams>");
+  linear_params_.Read(is, binary);
+  ExpectToken(is, binary, "<BiasParams>");
+  bias_params_.Read(is, binary);
+  ExpectToken(is, binary, "</QuantizedAffineComponent>");
+}
+
+std::string BlockSparseAffineComponent::Info() const {
+  std::stringstream stream;
+  BaseFloat bias_params_stddev =
+      std::sqrt(VecVec(bias_params_, bias_params_) / bias_params_.Dim());
+  stream << Component::Info()
+         << ", block-rows=" << linear_params_.BlockRows()
+         << ", block-cols=" << linear_params_.BlockCols()
+         << ", num-blocks=" << linear_params_.NumBlocks()
+         << ", block-density=" << linear_params_.Density()
+         << ", bias-params-stddev=" << bias_params_stddev;
+  return stream.str();
+}
+
+void BlockSparseAffineComponent::Init(const CuMatrixBase<BaseFloat> &mat,
+                                      int32 block_rows, int32 block_cols,
+                                      BaseFloat threshold) {
+  KALDI_ASSERT(mat.NumCols() > 1);
+  CuSubMatrix<BaseFloat> linear(mat, 0, mat.NumRows(), 0, mat.NumCols() - 1);
+  linear_params_.CopyFromMat(linear, block_rows, block_cols, threshold);
+  bias_params_.Resize(mat.NumRows());
+  bias_params_.CopyColFromMat(mat, mat.NumCols() - 1);
+}
+
+void BlockSparseAffineComponent::InitFromConfig(ConfigLine *cfl) {
+  int32 block_rows = 16, block_cols = 16;
+  BaseFloat threshold = 0.0;
+  cfl->GetValue("block-rows", &block_rows);
+  cfl->GetValue("block-cols", &block_cols);
+  cfl->GetValue("threshold", &threshold);
+  std::string filename;
+  // Two forms allowed: "matrix=<rxfilename>", or "input-dim=x output-dim=y"
+  // (for testing purposes only).
+  if (cfl->GetValue("matrix", &filename)) {
+    if (cfl->HasUnusedValues())
+      KALDI_ERR << "Invalid initializer for layer of type "
+                << Type() << ": \"" << cfl->WholeLine() << "\"";
+
+    bool binary;
+    Input ki(filename, &binary);
+    CuMatrix<BaseFloat> mat;
+    mat.Read(ki.Stream(), binary);
+    KALDI_ASSERT(mat.NumRows() != 0);
+    Init(mat, block_rows, block_cols, threshold);
+  } else {
+    int32 input_dim, output_dim;
+    if (!cfl->GetValue("input-dim", &input_dim) ||
+        !cfl->GetValue("output-dim", &output_dim) || cfl->HasUnusedValues()) {
+      KALDI_ERR << "Invalid initializer for layer of type "
+                << Type() << ": \"" << cfl->WholeLine() << "\"";
+    }
+    CuMatrix<BaseFloat> mat(output_dim, input_dim + 1);
+    mat.SetRandn();
+    Init(mat, block_rows, block_cols, threshold);
+  }
+}
+
+void BlockSparseAffineComponent::Propagate(
+    const ComponentPrecomputedIndexes *indexes,
+    const CuMatrixBase<BaseFloat> &in,
+    CuMatrixBase<BaseFloat> *out) const  {
+  out->CopyRowsFromVec(bias_params_); // Adds the bias term first.
+  AddMatBlockSparse(1.0, in, kNoTrans, linear_params_, kTrans, 1.0, out);
+}
+
+void BlockSparseAffineComponent::Backprop(
+    const std::string &debug_info,
+    const ComponentPrecomputedIndexes *indexes,
+    const CuMatrixBase<BaseFloat> &, //in_value
+    const CuMatrixBase<BaseFloat> &, //out_value
+    const CuMatrixBase<BaseFloat> &out_deriv,
+    Component *, //to_update
+    CuMatrixBase<BaseFloat> *in_deriv) const {
+  // kBackpropAdds is true. It's the user's responsibility to zero out
+  // <in_deriv> if they need it to be so.
+  if (in_deriv)
+    AddMatBlockSparse(1.0, out_deriv, kNoTrans, linear_params_, kNoTrans,
+                      1.0, in_deriv);
+}
+
+Component* BlockSparseAffineComponent::Copy() const {
+  BlockSparseAffineComponent *ans = new BlockSparseAffineComponent();
+  ans->linear_params_ = linear_params_;
+  ans->bias_params_ = bias_params_;
+  return ans;
+}
+
+void BlockSparseAffineComponent::Write(std::ostream &os, bool binary) const {
+  WriteToken(os, binary, "<BlockSparseAffineComponent>");
+  WriteToken(os, binary, "<LinearParams>");
+  linear_params_.Write(os, binary);
+  WriteToken(os, binary, "<BiasParams>");
+  bias_params_.Write(os, binary);
+  WriteToken(os, binary, "</BlockSparseAffineComponent>");
+}
+
+void BlockSparseAffineComponent::Read(std::istream &is, bool binary) {
+  ExpectOneOrTwoTokens(is, binary, "<BlockSparseAffineComponent>",
+                       "<LinearParams>");
+  linear_params_.Read(is, binary);
+  ExpectToken(is, binary, "<BiasParams>");
+  bias_params_.Read(is, binary);
+  ExpectToken(is, binary, "</BlockSparseAffineComponent>");
+}
+
 void SumGroupComponent::Init(const std::vector<int32> &sizes) {
   KALDI_ASSERT(!sizes.empty());
   std::vector<Int32Pair> cpu_vec(sizes.size());
@@ -1544,11 +1755,10 @@ void SoftmaxComponent::Propagate(const ComponentPrecomputedIndexes *indexes,
   // Apply softmax function to each row of the output...
   // for that row, we do
   // x_i = exp(x_i) / sum_j exp(x_j).
-  out->ApplySoftMaxPerRow(in);
-
-  // This floor on the output helps us deal with
-  // almost-zeros in a way that doesn't lead to overflow.
-  out->ApplyFloor(1.0e-20);
+  // The floor on the output helps us deal with
+  // almost-zeros in a way that doesn't lead to overflow;
+  // it is applied inside the softmax kernel.
+  cu::SoftmaxWithFloor(in, BaseFloat(1.0e-20), out);
 }
 
 void SoftmaxComponent::Backprop(const std::string &debug_info,
@@ -27,6 +27,8 @@
 #include "nnet3/nnet-common.h"
 #include "nnet3/nnet-component-itf.h"
 #include "nnet3/natural-gradient-online.h"
+#include "cudamatrix/cu-quantized-matrix.h"
+#include "cudamatrix/cu-block-sparse-matrix.h"
 #include <iostream>
 
 namespace kaldi {
@@ -416,11 +418,18 @@ class NaturalGradientAffineComponent: public AffineComponent {
   virtual void InitFromConfig(ConfigLine *cfl);
   virtual std::string Info() const;
   virtual Component* Copy() const;
-  virtual void Scale(BaseFloat scale); 
+  virtual void Scale(BaseFloat scale);
   virtual void Add(BaseFloat alpha, const Component &other);
   NaturalGradientAffineComponent();
   virtual void ZeroStats();
 
+  // Changes how often the preconditioners update their Fisher-matrix
+  // estimates (on the other minibatches they just apply the current
+  // preconditioner, which is much cheaper).  Can be used to reduce the
+  // natural-gradient overhead on an existing model; see also the
+  // update-period config value and nnet3-copy --ng-update-period.
+  void SetUpdatePeriod(int32 update_period);
+
  private:
   KALDI_DISALLOW_COPY_AND_ASSIGN(NaturalGradientAffineComponent);
 
@@ -515,6 +524,105 @@ class FixedAffineComponent: public Component {
   KALDI_DISALLOW_COPY_AND_ASSIGN(FixedAffineComponent);
 };
 
+/// QuantizedAffineComponent is an inference-only variant of
+/// FixedAffineComponent that keeps its linear parameters in 8-bit quantized
+/// form (see CuInt8Matrix in ../cudamatrix/cu-quantized-matrix.h), cutting
+/// the weight-matrix storage and memory bandwidth by a factor of 4.  It is
+/// not updatable; you get one by initializing it from a matrix (typically
+/// the parameters of a trained affine component).
+class QuantizedAffineComponent: public Component {
+ public:
+  QuantizedAffineComponent() { }
+  virtual std::string Type() const { return "QuantizedAffineComponent"; }
+  virtual std::string Info() const;
+
+  /// matrix should be of size input-dim+1 to output-dim, last col is offset
+  void Init(const CuMatrixBase<BaseFloat> &matrix);
+
+  // The ConfigLine cfl contains just the option matrix=<string>,
+  // where the string is the filename of a Kaldi-format matrix to read.
+  virtual void InitFromConfig(ConfigLine *cfl);
+
+  virtual int32 Properties() const { return kSimpleComponent|kBackpropAdds; }
+  virtual int32 InputDim() const { return linear_params_.NumCols(); }
+  virtual int32 OutputDim() const { return linear_params_.NumRows(); }
+
+  virtual void Propagate(const ComponentPrecomputedIndexes *indexes,
+                         const CuMatrixBase<BaseFloat> &in,
+                         CuMatrixBase<BaseFloat> *out) const;
+  virtual void Backprop(const std::string &debug_info,
+                        const ComponentPrecomputedIndexes *indexes,
+                        const CuMatrixBase<BaseFloat> &in_value,
+                        const CuMatrixBase<BaseFloat> &, // out_value
+                        const CuMatrixBase<BaseFloat> &out_deriv,
+                        Component *to_update,
+                        CuMatrixBase<BaseFloat> *in_deriv) const;
+
+  virtual Component* Copy() const;
+  virtual void Read(std::istream &is, bool binary);
+  virtual void Write(std::ostream &os, bool binary) const;
+
+  const CuInt8Matrix &LinearParams() const { return linear_params_; }
+ protected:
+  CuInt8Matrix linear_params_;
+  CuVector<BaseFloat> bias_params_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(QuantizedAffineComponent);
+};
+
+/// BlockSparseAffineComponent is an inference-only affine component whose
+/// linear parameters are stored in block-sparse (BSR) form (see
+/// CuBlockSparseMatrix in ../cudamatrix/cu-block-sparse-matrix.h): only the
+/// weight blocks whose largest absolute element exceeds a threshold are
+/// kept, and the forward matrix multiply only visits the kept blocks.  It
+/// is intended for models that were pruned to high sparsity with a
+/// structured (block) pattern during training; you get one by converting a
+/// trained affine component (see nnet3-sparsify-components).  Like
+/// QuantizedAffineComponent it is not updatable.
+class BlockSparseAffineComponent: public Component {
+ public:
+  BlockSparseAffineComponent() { }
+  virtual std::string Type() const { return "BlockSparseAffineComponent"; }
+  virtual std::string Info() const;
+
+  /// matrix should be of size input-dim+1 to output-dim, last col is offset;
+  /// blocks of the linear part (of size block_rows by block_cols) whose
+  /// largest absolute element is <= threshold are dropped.
+  void Init(const CuMatrixBase<BaseFloat> &matrix,
+            int32 block_rows, int32 block_cols, BaseFloat threshold);
+
+  // The ConfigLine cfl contains the option matrix=<string> (the filename of
+  // a Kaldi-format matrix to read), plus optionally block-rows, block-cols
+  // and threshold.
+  virtual void InitFromConfig(ConfigLine *cfl);
+
+  virtual int32 Properties() const { return kSimpleComponent|kBackpropAdds; }
+  virtual int32 InputDim() const { return linear_params_.NumCols(); }
+  virtual int32 OutputDim() const { return linear_params_.NumRows(); }
+
+  virtual void Propagate(const ComponentPrecomputedIndexes *indexes,
+                         const CuMatrixBase<BaseFloat> &in,
+                         CuMatrixBase<BaseFloat> *out) const;
+  virtual void Backprop(const std::string &debug_info,
+                        const ComponentPrecomputedIndexes *indexes,
+                        const CuMatrixBase<BaseFloat> &in_value,
+                        const CuMatrixBase<BaseFloat> &, // out_value
+                        const CuMatrixBase<BaseFloat> &out_deriv,
+                        Component *to_update,
+                        CuMatrixBase<BaseFloat> *in_deriv) const;
+
+  virtual Component* Copy() const;
+  virtual void Read(std::istream &is, bool binary);
+  virtual void Write(std::ostream &os, bool binary) const;
+
+  const CuBlockSparseMatrix &LinearParams() const { return linear_params_; }
+ protected:
+  CuBlockSparseMatrix linear_params_;
+  CuVector<BaseFloat> bias_params_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(BlockSparseAffineComponent);
+};
+
 // SumGroupComponent is used to sum up groups of posteriors.
 // It's used to introduce a kind of Gaussian-mixture-model-like
 // idea into neural nets.  This is basically a degenerate case of
@@ -856,6 +964,11 @@ class NaturalGradientPerElementScaleComponent: public PerElementScaleComponent {
             int32 rank, int32 update_period, BaseFloat num_samples_history,
             BaseFloat alpha, BaseFloat max_change_per_minibatch);
 
+  // See the comment for NaturalGradientAffineComponent::SetUpdatePeriod.
+  void SetUpdatePeriod(int32 update_period) {
+    preconditioner_.SetUpdatePeriod(update_period);
+  }
+
  private:
   // configuration value for imposing max-change...
   BaseFloat max_change_per_minibatch_;
@@ -20,6 +20,7 @@
 
 #include "nnet3/nnet-simple-computer.h"
 #include "nnet3/nnet-utils.h"
+#include "util/text-utils.h"
 
 namespace kaldi {
 namespace nnet3 {
@@ -44,6 +45,7 @@ namespace nnet3 {
  KALDI_ASSERT(!(online_ivectors != NULL && online_ivector_period <= 0 &&
     "You need to set the --online-ivector-period option!"));
  PossiblyWarnForFramesPerChunk();
+ InitStateCarryOver();
 }
 
 NnetSimpleComputer::NnetSimpleComputer(
@@ -64,6 +66,7 @@ NnetSimpleComputer::NnetSimpleComputer(
  KALDI_ASSERT(!(online_ivectors != NULL && online_ivector_period <= 0 &&
     "You need to set the --online-ivector-period option!"));
  PossiblyWarnForFramesPerChunk();
+ InitStateCarryOver();
  ComputeSimpleNnetContext(nnet_, &left_context_, &right_context_);
 }
 
@@ -82,6 +85,7 @@ NnetSimpleComputer::NnetSimpleComputer(
  compiler_(nnet, opts_.optimize_config),
  current_log_post_offset_(0) {
  PossiblyWarnForFramesPerChunk();
+ InitStateCarryOver();
  ComputeSimpleNnetContext(nnet_, &left_context_, &right_context_);
 }  
 
@@ -99,6 +103,7 @@ NnetSimpleComputer::NnetSimpleComputer(
  compiler_(nnet, opts_.optimize_config),
  current_log_post_offset_(0) {
  PossiblyWarnForFramesPerChunk();
+ InitStateCarryOver();
  ComputeSimpleNnetContext(nnet_, &left_context_, &right_context_);
 }      
 
@@ -200,6 +205,94 @@ void NnetSimpleComputer::GetCurrentIvector(int32 output_t_start,
 }
   
 
+void NnetSimpleComputer::InitStateCarryOver() {
+  next_state_t_ = 0;
+  if (opts_.recurrent_state_nodes.empty())
+    return;
+  KALDI_ASSERT(opts_.state_context > 0);
+  std::vector<std::string> pairs;
+  SplitStringToVector(opts_.recurrent_state_nodes, ",", true, &pairs);
+  for (size_t i = 0; i < pairs.size(); i++) {
+    std::vector<std::string> nodes;
+    SplitStringToVector(pairs[i], ":", true, &nodes);
+    if (nodes.size() != 2)
+      KALDI_ERR << "Invalid --recurrent-state-nodes entry '" << pairs[i]
+                << "': expected <output-node>:<input-node>";
+    int32 output_node = nnet_.GetNodeIndex(nodes[0]),
+        input_node = nnet_.GetNodeIndex(nodes[1]);
+    if (output_node == -1 || !nnet_.IsOutputNode(output_node))
+      KALDI_ERR << "--recurrent-state-nodes: no output node named '"
+                << nodes[0] << "' in the network.";
+    if (input_node == -1 || !nnet_.IsInputNode(input_node))
+      KALDI_ERR << "--recurrent-state-nodes: no input node named '"
+                << nodes[1] << "' in the network.";
+    if (nnet_.OutputDim(nodes[0]) != nnet_.InputDim(nodes[1]))
+      KALDI_ERR << "--recurrent-state-nodes: dimension mismatch between '"
+                << nodes[0] << "' and '" << nodes[1] << "'.";
+    state_pairs_.push_back(std::make_pair(nodes[0], nodes[1]));
+  }
+  state_values_.resize(state_pairs_.size());
+}
+
+void NnetSimpleComputer::AddStateIoToRequest(int32 output_t_start,
+                                             int32 num_output_frames,
+                                             ComputationRequest *request) {
+  if (output_t_start != next_state_t_) {
+    if (next_state_t_ != 0)
+      KALDI_WARN << "Chunks are not being computed consecutively (expected "
+                 << "start frame " << next_state_t_ << ", got "
+                 << output_t_start << "); resetting recurrent state.";
+    for (size_t i = 0; i < state_values_.size(); i++)
+      state_values_[i].Resize(0, 0);
+  }
+  next_state_t_ = output_t_start + num_output_frames;
+  // We never request more state frames than this chunk can produce (only
+  // relevant for a final partial chunk shorter than the state context).
+  int32 state_frames = std::min(opts_.state_context, num_output_frames);
+  for (size_t i = 0; i < state_pairs_.size(); i++) {
+    request->inputs.push_back(
+        IoSpecification(state_pairs_[i].second, -opts_.state_context, 0));
+    request->outputs.push_back(
+        IoSpecification(state_pairs_[i].first,
+                        num_output_frames - state_frames, num_output_frames));
+  }
+}
+
+void NnetSimpleComputer::AcceptStateInputs(NnetComputer *computer) {
+  for (size_t i = 0; i < state_pairs_.size(); i++) {
+    const std::string &input_node = state_pairs_[i].second;
+    CuMatrix<BaseFloat> state;
+    if (state_values_[i].NumRows() == opts_.state_context)
+      state = state_values_[i];  // AcceptInput is destructive, so copy.
+    else  // first chunk (or state was just reset): zero state.
+      state.Resize(opts_.state_context, nnet_.InputDim(input_node));
+    computer->AcceptInput(input_node, &state);
+  }
+}
+
+void NnetSimpleComputer::SaveStateOutputs(int32 num_output_frames,
+                                          NnetComputer *computer) {
+  int32 R = opts_.state_context,
+      state_frames = std::min(R, num_output_frames);
+  for (size_t i = 0; i < state_pairs_.size(); i++) {
+    CuMatrix<BaseFloat> new_state;
+    computer->GetOutputDestructive(state_pairs_[i].first, &new_state);
+    KALDI_ASSERT(new_state.NumRows() == state_frames);
+    if (state_frames == R) {
+      state_values_[i].Swap(&new_state);
+    } else {
+      // a partial chunk produced fewer frames than we carry: shift the old
+      // state up and append the new frames at the bottom.
+      CuMatrix<BaseFloat> merged(R, new_state.NumCols());
+      if (state_values_[i].NumRows() == R)
+        merged.RowRange(0, R - state_frames).CopyFromMat(
+            state_values_[i].RowRange(state_frames, R - state_frames));
+      merged.RowRange(R - state_frames, state_frames).CopyFromMat(new_state);
+      state_values_[i].Swap(&merged);
+    }
+  }
+}
+
 void NnetSimpleComputer::DoNnetComputation(
     int32 input_t_start,
     const MatrixBase<BaseFloat> &input_feats,
@@ -246,6 +339,8 @@ void NnetSimpleComputer::DoNnetComputationInternal(
   request.outputs.push_back(
       IoSpecification("output", time_offset + output_t_start,
                       time_offset + output_t_start + num_output_frames));
+  if (!state_pairs_.empty())
+    AddStateIoToRequest(output_t_start, num_output_frames, &request);
   const NnetComputation *computation = compiler_.Compile(request);
   Nnet *nnet_to_update = NULL;  // we're not doing any update.
   NnetComputer computer(opts_.compute_config, *computation,
@@ -259,8 +354,12 @@ void NnetSimpleComputer::DoNnetComputationInternal(
     ivector_feats_cu.Row(0).CopyFromVec(ivector);
     computer.AcceptInput("ivector", &ivector_feats_cu);
   }
+  if (!state_pairs_.empty())
+    AcceptStateInputs(&computer);
   computer.Forward();
   computer.GetOutputDestructive("output", cu_output);
+  if (!state_pairs_.empty())
+    SaveStateOutputs(num_output_frames, &computer);
 }
 
 void NnetSimpleComputer::PossiblyWarnForFramesPerChunk() const {
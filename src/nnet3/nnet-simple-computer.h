@@ -33,14 +33,18 @@ struct NnetSimpleComputerOptions {
   int32 extra_left_context;
   int32 frames_per_chunk;
   bool debug_computation;
-  
+  std::string recurrent_state_nodes;
+  int32 state_context;
+
   NnetOptimizeOptions optimize_config;
   NnetComputeOptions compute_config;
 
   NnetSimpleComputerOptions():
       extra_left_context(0),
       frames_per_chunk(50),
-      debug_computation(false) { }
+      debug_computation(false),
+      recurrent_state_nodes(""),
+      state_context(1) { }
 
   void Register(OptionsItf *opts) {
     opts->Register("extra-left-context", &extra_left_context,
@@ -52,6 +56,20 @@ struct NnetSimpleComputerOptions {
                    "evaluated by the neural net.");
     opts->Register("debug-computation", &debug_computation, "If true, turn on "
                    "debug for the actual computation (very verbose!)");
+    opts->Register("recurrent-state-nodes", &recurrent_state_nodes,
+                   "Comma-separated list of pairs <output-node>:<input-node> "
+                   "designating recurrent state to carry between chunks: "
+                   "after each chunk, the last --state-context frames of each "
+                   "<output-node> are saved and supplied as the corresponding "
+                   "<input-node> for the next chunk (the first chunk gets "
+                   "zeros).  This avoids re-computing left context each chunk "
+                   "for recurrent models; you will normally want "
+                   "--extra-left-context=0 with this.");
+    opts->Register("state-context", &state_context,
+                   "Number of trailing frames of each recurrent-state output "
+                   "to carry over to the next chunk; set it to the largest "
+                   "recurrence delay in the model.  Only relevant if "
+                   "--recurrent-state-nodes is set.");
 
     // register the optimization options with the prefix "optimization".
     ParseOptions optimization_opts("optimization", opts);
@@ -150,6 +168,27 @@ class NnetSimpleComputer {
   // returns dimension of the provided iVectors if supplied, or 0 otherwise.
   int32 GetIvectorDim() const;
 
+  // Called from the constructors: parses opts_.recurrent_state_nodes into
+  // state_pairs_ and checks that the designated nodes exist in the nnet.
+  void InitStateCarryOver();
+
+  // If state carry-over is active, checks that this chunk directly follows
+  // the previous one (resetting the state with a warning if not) and adds
+  // the state inputs and outputs to the request.  The t values are
+  // chunk-normalized (state inputs at [-state_context, 0), state outputs at
+  // the last frames of the chunk), so the compiled computation is the same
+  // for every full-size chunk and the compiler cache still works.
+  void AddStateIoToRequest(int32 output_t_start, int32 num_output_frames,
+                           ComputationRequest *request);
+
+  // Supplies the carried state (or zeros, for the first chunk) to the
+  // computer; called from DoNnetComputationInternal before Forward().
+  void AcceptStateInputs(NnetComputer *computer);
+
+  // Saves the state outputs of this chunk for use by the next one; called
+  // from DoNnetComputationInternal after Forward().
+  void SaveStateOutputs(int32 num_output_frames, NnetComputer *computer);
+
   int32 LeftContext() const { return left_context_; }
   int32 RightContext() const { return right_context_; }
 
@@ -182,6 +221,18 @@ class NnetSimpleComputer {
   // The left and right contexts that are needed for per-frame computation
   int32 left_context_;
   int32 right_context_;
+
+  // Parsed form of opts_.recurrent_state_nodes: pairs of (output node that
+  // produces the state, input node that consumes it next chunk).  Empty if
+  // state carry-over is not in use.
+  std::vector<std::pair<std::string, std::string> > state_pairs_;
+  // The carried state for each pair: opts_.state_context rows per state once
+  // a chunk has been computed; zero rows before the first chunk (meaning the
+  // next chunk gets zeros).
+  std::vector<CuMatrix<BaseFloat> > state_values_;
+  // The output frame at which we expect the next chunk to start; used to
+  // detect (and reset the state for) non-consecutive computations.
+  int32 next_state_t_;
 };
 
 } // namespace nnet3
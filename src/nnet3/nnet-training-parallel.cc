@@ -0,0 +1,122 @@
+// nnet3/nnet-training-parallel.cc
+
+// Copyright 2014   Johns Hopkins University
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nnet3/nnet-training-parallel.h"
+
+namespace kaldi {
+namespace nnet3 {
+
+void NnetExampleRepository::AcceptExample(NnetExample *example) {
+  empty_semaphore_.Wait();
+  KALDI_ASSERT(example_.io.empty());
+  example_.Swap(example);
+  full_semaphore_.Signal();
+}
+
+void NnetExampleRepository::ExamplesDone() {
+  empty_semaphore_.Wait();
+  KALDI_ASSERT(example_.io.empty());
+  done_ = true;
+  full_semaphore_.Signal();
+}
+
+bool NnetExampleRepository::ProvideExample(NnetExample *example) {
+  full_semaphore_.Wait();
+  if (done_) {
+    KALDI_ASSERT(example_.io.empty());
+    full_semaphore_.Signal();  // Increment the semaphore so
+    // the call by the next thread will not block.
+    return false;  // no examples to return-- all finished.
+  } else {
+    KALDI_ASSERT(!example_.io.empty() && example->io.empty());
+    example->Swap(&example_);
+    empty_semaphore_.Signal();
+    return true;
+  }
+}
+
+class NnetTrainerParallelClass: public MultiThreadable {
+ public:
+  // This constructor is only called for a temporary object
+  // that we pass to the MultiThreader.
+  NnetTrainerParallelClass(const NnetTrainerOptions &config,
+                           NnetExampleRepository *repository,
+                           Nnet *nnet,
+                           bool *ok_ptr):
+      config_(config), repository_(repository), nnet_(nnet),
+      ok_ptr_(ok_ptr), trainer_(NULL) { }
+
+  // The following constructor is called once per thread inside the
+  // MultiThreader; each thread gets its own NnetTrainer (hence its own
+  // compiler and, if applicable, delta-nnet), all updating the shared nnet.
+  NnetTrainerParallelClass(const NnetTrainerParallelClass &other):
+      config_(other.config_), repository_(other.repository_),
+      nnet_(other.nnet_), ok_ptr_(other.ok_ptr_),
+      trainer_(new NnetTrainer(other.config_, other.nnet_)) { }
+
+  void operator () () {
+    NnetExample eg;
+    while (repository_->ProvideExample(&eg)) {
+      trainer_->Train(eg);
+      eg.io.clear();
+    }
+  }
+
+  ~NnetTrainerParallelClass() {
+    // This is only nonzero for the objects copy-constructed inside the
+    // MultiThreader; their destructors get called sequentially in the main
+    // thread after the threads have been joined, so no locking is needed.
+    if (trainer_ != NULL) {
+      *ok_ptr_ = trainer_->PrintTotalStats() || *ok_ptr_;
+      delete trainer_;
+    }
+  }
+ private:
+  const NnetTrainerOptions &config_;
+  NnetExampleRepository *repository_;
+  Nnet *nnet_;
+  bool *ok_ptr_;
+  NnetTrainer *trainer_;
+};
+
+bool TrainNnetParallel(const NnetTrainerOptions &config,
+                       SequentialNnetExampleReader *example_reader,
+                       Nnet *nnet) {
+  KALDI_ASSERT(config.num_threads >= 1);
+  NnetExampleRepository repository;
+  bool ok = false;
+
+  NnetTrainerParallelClass c(config, &repository, nnet, &ok);
+  {
+    // The initialization of the following object spawns the threads that
+    // process the examples.  They get re-joined in its destructor.
+    MultiThreader<NnetTrainerParallelClass> m(config.num_threads, c);
+
+    for (; !example_reader->Done(); example_reader->Next()) {
+      NnetExample eg(example_reader->Value());
+      repository.AcceptExample(&eg);
+    }
+    repository.ExamplesDone();
+  }
+  return ok;
+}
+
+
+} // namespace nnet3
+} // namespace kaldi
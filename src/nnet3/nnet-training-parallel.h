@@ -0,0 +1,86 @@
+// nnet3/nnet-training-parallel.h
+
+// Copyright 2014   Johns Hopkins University
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_NNET3_NNET_TRAINING_PARALLEL_H_
+#define KALDI_NNET3_NNET_TRAINING_PARALLEL_H_
+
+#include "nnet3/nnet-training.h"
+#include "util/table-types.h"
+#include "thread/kaldi-semaphore.h"
+#include "thread/kaldi-thread.h"
+
+namespace kaldi {
+namespace nnet3 {
+
+/** This class hands off training examples from the thread that reads them to
+    the training threads; it is the nnet3 analog of nnet2's
+    ExamplesRepository.  Since in nnet3 each NnetExample read from disk is
+    already a merged minibatch (see nnet3-merge-egs), we hand them off one at
+    a time rather than in batches.
+ */
+class NnetExampleRepository {
+ public:
+  /// Called by the code that reads in the examples; hands over one example
+  /// (it will swap out the contents of "example").  Blocks if a previous
+  /// example has not yet been taken by a training thread.
+  void AcceptExample(NnetExample *example);
+
+  /// Called by the code that reads in the examples, when there are no more.
+  void ExamplesDone();
+
+  /// Called by the training threads.  If an example is available it puts it
+  /// in "example" and returns true; it returns false when there are no
+  /// examples left and ExamplesDone() has been called.
+  bool ProvideExample(NnetExample *example);
+
+  NnetExampleRepository(): empty_semaphore_(1), done_(false) { }
+ private:
+  Semaphore full_semaphore_;
+  Semaphore empty_semaphore_;
+
+  NnetExample example_;
+  bool done_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(NnetExampleRepository);
+};
+
+/** This function trains on examples from the reader using
+    config.num_threads threads, all updating the same model "nnet"; it is
+    the nnet3 analog of nnet2's DoBackpropParallel.  The threads do a
+    Hogwild-style update (no locking around the parameter additions), so it
+    is suitable for SGD but not for exact gradient computation; each thread
+    has its own compiler and computation, and its own delta-nnet if momentum
+    or max-param-change is in use, so those options are applied per thread.
+    When compiled with CUDA and per-thread streams (see
+    makefiles/linux_x86_64_cuda.mk), the threads share the GPU and their
+    computations overlap; this gives a single-process alternative to running
+    several jobs with model averaging.  Note: cudamatrix routes all GPU work
+    through the per-process CuDevice singleton, so all threads use the one
+    device that was selected with SelectGpuId().
+
+    Returns true if the total weight of training examples was nonzero.
+*/
+bool TrainNnetParallel(const NnetTrainerOptions &config,
+                       SequentialNnetExampleReader *example_reader,
+                       Nnet *nnet);
+
+
+} // namespace nnet3
+} // namespace kaldi
+
+#endif // KALDI_NNET3_NNET_TRAINING_PARALLEL_H_
@@ -41,6 +41,17 @@ NnetTrainer::NnetTrainer(const NnetTrainerOptions &config,
                                // natural-gradient updates.
     SetZero(is_gradient, delta_nnet_);
   }
+  if (!config_.read_cache.empty()) {
+    bool binary;
+    Input ki;
+    if (ki.Open(config_.read_cache, &binary)) {
+      compiler_.ReadCache(ki.Stream(), binary);
+      KALDI_LOG << "Read computation cache from " << config_.read_cache;
+    } else {
+      KALDI_WARN << "Could not open cached computation. "
+                 << "Probably this is the first training iteration.";
+    }
+  }
 }
 
 
@@ -161,6 +172,11 @@ bool ObjectiveFunctionInfo::PrintTotalStats(const std::string &name) const {
 }
 
 NnetTrainer::~NnetTrainer() {
+  if (!config_.write_cache.empty()) {
+    Output ko(config_.write_cache, config_.binary_write_cache);
+    compiler_.WriteCache(ko.Stream(), config_.binary_write_cache);
+    KALDI_LOG << "Wrote computation cache to " << config_.write_cache;
+  }
   delete delta_nnet_;
 }
 
@@ -36,6 +36,10 @@ struct NnetTrainerOptions {
   bool debug_computation;
   BaseFloat momentum;
   BaseFloat max_param_change;
+  int32 num_threads;
+  std::string read_cache;
+  std::string write_cache;
+  bool binary_write_cache;
   NnetOptimizeOptions optimize_config;
   NnetComputeOptions compute_config;
   NnetTrainerOptions():
@@ -44,7 +48,9 @@ struct NnetTrainerOptions {
       print_interval(100),
       debug_computation(false),
       momentum(0.0),
-      max_param_change(1.0) { }
+      max_param_change(1.0),
+      num_threads(1),
+      binary_write_cache(true) { }
   void Register(OptionsItf *opts) {
     opts->Register("store-component-stats", &store_component_stats,
                    "If true, store activations and derivatives for nonlinear "
@@ -55,6 +61,18 @@ struct NnetTrainerOptions {
     opts->Register("print-interval", &print_interval, "Interval (measured in "
                    "minibatches) after which we print out objective function "
                    "during training\n");
+    opts->Register("num-threads", &num_threads, "Number of training threads "
+                   "to use in the parallel (Hogwild-style) update; only "
+                   "interpreted by programs such as nnet3-train-parallel.  "
+                   "The threads share the model and, if compiled with CUDA "
+                   "and per-thread streams, also share the GPU.");
+    opts->Register("read-cache", &read_cache, "The location from which to "
+                   "read the cached computations, to avoid the cost of "
+                   "compiling and optimizing them again.");
+    opts->Register("write-cache", &write_cache, "The location to which to "
+                   "write the cached computations (see --read-cache).");
+    opts->Register("binary-write-cache", &binary_write_cache, "Write "
+                   "computation cache in binary mode");
     opts->Register("max-param-change", &max_param_change, "The maximum change in"
                    "parameters allowed per minibatch, measured in Frobenius norm "
                    "over the entire model (change will be clipped to this value)");
@@ -20,6 +20,7 @@
 // limitations under the License.
 
 #include "nnet3/nnet-utils.h"
+#include "nnet3/nnet-simple-component.h"
 
 namespace kaldi {
 namespace nnet3 {
@@ -266,6 +267,154 @@ void SetLearningRate(BaseFloat learning_rate,
   }
 }
 
+void SetNaturalGradientUpdatePeriod(int32 update_period,
+                                    Nnet *nnet) {
+  for (int32 c = 0; c < nnet->NumComponents(); c++) {
+    Component *comp = nnet->GetComponent(c);
+    if (NaturalGradientAffineComponent *nc =
+        dynamic_cast<NaturalGradientAffineComponent*>(comp)) {
+      nc->SetUpdatePeriod(update_period);
+    } else if (NaturalGradientPerElementScaleComponent *sc =
+               dynamic_cast<NaturalGradientPerElementScaleComponent*>(comp)) {
+      sc->SetUpdatePeriod(update_period);
+    }
+  }
+}
+
+// Used in CollapseModelForInference(): returns the node index that
+// "descriptor" refers to, if the descriptor is just a plain reference to a
+// single node (no Append, Sum, Offset or the like); otherwise returns -1.  We
+// detect this by writing the descriptor out in config format: for a plain
+// reference, the written form is exactly the node name.
+static int32 PlainSourceNode(const Nnet &nnet, const Descriptor &descriptor) {
+  std::vector<int32> node_indexes;
+  descriptor.GetNodeDependencies(&node_indexes);
+  if (node_indexes.size() != 1)
+    return -1;
+  int32 src_node = node_indexes[0];
+  std::ostringstream os;
+  descriptor.WriteConfig(os, nnet.GetNodeNames());
+  if (os.str() != nnet.GetNodeName(src_node))
+    return -1;
+  return src_node;
+}
+
+// Used in CollapseModelForInference(): returns true if this component is an
+// identity function in the forward pass, so it can be bypassed for inference.
+static bool IsIdentityComponent(const Component &component) {
+  return (dynamic_cast<const NoOpComponent*>(&component) != NULL ||
+          dynamic_cast<const ClipGradientComponent*>(&component) != NULL);
+}
+
+// Used in CollapseModelForInference(): if "component" implements an affine
+// function of its input, returns true and outputs to "transform" a matrix of
+// dimension output-dim by input-dim + 1 whose last column is the bias.  We
+// obtain the parameters by propagating [ I; 0 ] through the component (the
+// zero row picks up the bias), which saves us from needing special-case code
+// to get at the parameters of each of the component types concerned.
+static bool GetAffineTransform(const Component &component,
+                               CuMatrix<BaseFloat> *transform) {
+  if (dynamic_cast<const AffineComponent*>(&component) == NULL &&
+      dynamic_cast<const FixedAffineComponent*>(&component) == NULL &&
+      dynamic_cast<const FixedScaleComponent*>(&component) == NULL &&
+      dynamic_cast<const FixedBiasComponent*>(&component) == NULL &&
+      dynamic_cast<const PerElementScaleComponent*>(&component) == NULL)
+    return false;
+  int32 input_dim = component.InputDim(),
+      output_dim = component.OutputDim();
+  Matrix<BaseFloat> probe(input_dim + 1, input_dim);
+  probe.SetUnit();
+  CuMatrix<BaseFloat> in(probe),
+      out(input_dim + 1, output_dim);
+  component.Propagate(NULL, in, &out);
+  transform->Resize(output_dim, input_dim + 1);
+  CuSubMatrix<BaseFloat> linear_part(*transform, 0, output_dim, 0, input_dim);
+  linear_part.CopyFromMat(out.RowRange(0, input_dim), kTrans);
+  CuSubVector<BaseFloat> bias(out.Row(input_dim));
+  // remove the bias, which the propagation added to every row.
+  linear_part.AddVecToCols(-1.0, bias);
+  transform->CopyColFromVec(bias, input_dim);
+  return true;
+}
+
+void CollapseModelForInference(Nnet *nnet) {
+  int32 num_folded = 0, num_bypassed = 0;
+  bool changed = true;
+  // repeat until fixpoint, so that chains longer than two components
+  // (e.g. splice+LDA -> affine -> fixed-scale) collapse fully.
+  while (changed) {
+    changed = false;
+    for (int32 node_b = 0; node_b < nnet->NumNodes(); node_b++) {
+      if (!nnet->IsComponentNode(node_b))
+        continue;
+      // the input descriptor of a component node immediately precedes it.
+      int32 node_a = PlainSourceNode(*nnet,
+                                     nnet->GetNode(node_b - 1).descriptor);
+      if (node_a == -1 || !nnet->IsComponentNode(node_a))
+        continue;
+      int32 comp_a = nnet->GetNode(node_a).u.component_index,
+          comp_b = nnet->GetNode(node_b).u.component_index;
+      const Component &a = *(nnet->GetComponent(comp_a)),
+          &b = *(nnet->GetComponent(comp_b));
+      if (IsIdentityComponent(b)) {
+        // node_b now does what node_a did; node_a may become an orphan.
+        nnet->GetNode(node_b).u.component_index = comp_a;
+        nnet->GetNode(node_b - 1).descriptor =
+            nnet->GetNode(node_a - 1).descriptor;
+        num_bypassed++;
+        changed = true;
+        continue;
+      }
+      if (IsIdentityComponent(a)) {
+        nnet->GetNode(node_b - 1).descriptor =
+            nnet->GetNode(node_a - 1).descriptor;
+        num_bypassed++;
+        changed = true;
+        continue;
+      }
+      CuMatrix<BaseFloat> transform_a, transform_b;
+      if (!GetAffineTransform(a, &transform_a) ||
+          !GetAffineTransform(b, &transform_b))
+        continue;
+      int32 in_dim = transform_a.NumCols() - 1,
+          mid_dim = transform_a.NumRows(),
+          out_dim = transform_b.NumRows();
+      KALDI_ASSERT(transform_b.NumCols() - 1 == mid_dim);
+      // combined transform is [ W_b W_a, W_b b_a + b_b ].
+      CuMatrix<BaseFloat> transform_ab(out_dim, in_dim + 1);
+      CuSubMatrix<BaseFloat> linear_a(transform_a, 0, mid_dim, 0, in_dim),
+          linear_b(transform_b, 0, out_dim, 0, mid_dim);
+      transform_ab.ColRange(0, in_dim).AddMatMat(
+          1.0, linear_b, kNoTrans, linear_a, kNoTrans, 0.0);
+      transform_ab.ColRange(in_dim, 1).AddMatMat(
+          1.0, linear_b, kNoTrans, transform_a.ColRange(in_dim, 1),
+          kNoTrans, 0.0);
+      transform_ab.ColRange(in_dim, 1).AddMat(
+          1.0, transform_b.ColRange(mid_dim, 1));
+      FixedAffineComponent *combined = new FixedAffineComponent();
+      combined->Init(transform_ab);
+      std::string base_name = nnet->GetComponentName(comp_a) + "-" +
+          nnet->GetComponentName(comp_b),
+          name = base_name;
+      for (int32 suffix = 2; nnet->GetComponentIndex(name) != -1; suffix++) {
+        std::ostringstream os;
+        os << base_name << "-" << suffix;
+        name = os.str();
+      }
+      int32 comp_ab = nnet->AddComponent(name, combined);
+      nnet->GetNode(node_b).u.component_index = comp_ab;
+      nnet->GetNode(node_b - 1).descriptor =
+          nnet->GetNode(node_a - 1).descriptor;
+      num_folded++;
+      changed = true;
+    }
+  }
+  if (num_folded > 0 || num_bypassed > 0)
+    KALDI_LOG << "Collapsed model for inference: folded " << num_folded
+              << " pairs of affine-type components and bypassed "
+              << num_bypassed << " identity components.";
+}
+
 void ScaleNnet(BaseFloat scale, Nnet *nnet) {
   for (int32 c = 0; c < nnet->NumComponents(); c++) {
     Component *comp = nnet->GetComponent(c);
@@ -113,6 +113,30 @@ void ComputeSimpleNnetContext(const Nnet &nnet,
 void SetLearningRate(BaseFloat learning_rate,
                      Nnet *nnet);
 
+/// Sets, for all natural-gradient components in the nnet, how many
+/// minibatches apart the online preconditioners update their Fisher-matrix
+/// estimates (on the minibatches in between they only apply the current
+/// preconditioner, which is much cheaper).  Raising this reduces the
+/// natural-gradient overhead, which can be significant for small models, at
+/// a small cost in how up-to-date the preconditioning is.  Has no effect on
+/// components without natural gradient.
+void SetNaturalGradientUpdatePeriod(int32 update_period,
+                                    Nnet *nnet);
+
+/// This function modifies the structure of the nnet to make inference faster;
+/// you should not train a model after calling it.  Wherever the input of a
+/// component is just the output of another component (no Append, Sum, Offset
+/// or the like in between), it does the following: it bypasses components
+/// that are identity functions in the forward pass (NoOpComponent,
+/// ClipGradientComponent), and it folds pairs of affine-type components
+/// (affine, fixed-affine, fixed-scale, fixed-bias, per-element-scale) into a
+/// single FixedAffineComponent.  This reduces the number of Propagate calls
+/// per frame; folding e.g. an LDA-type FixedAffineComponent into the affine
+/// component that follows it also reduces the amount of arithmetic.  Any
+/// components that become unreachable from the outputs are left in place;
+/// they are never computed, and only affect the size of the model on disk.
+void CollapseModelForInference(Nnet *nnet);
+
 /// Scales the nnet parameters and stats by this scale.
 void ScaleNnet(BaseFloat scale, Nnet *nnet);
 
@@ -42,12 +42,24 @@ int main(int argc, char *argv[]) {
 
     bool binary_write = true;
     BaseFloat learning_rate = -1;
-    
+    int32 ng_update_period = -1;
+    bool collapse_model = false;
+
     ParseOptions po(usage);
     po.Register("binary", &binary_write, "Write output in binary mode");
     po.Register("learning-rate", &learning_rate,
                 "If supplied, all the learning rates of updatable components"
                 "are set to this value.");
+    po.Register("ng-update-period", &ng_update_period,
+                "If supplied, natural-gradient components will update their "
+                "preconditioners only every this many minibatches (applying "
+                "the current preconditioner on the others); raising it "
+                "reduces the natural-gradient overhead in training.");
+    po.Register("collapse-model", &collapse_model,
+                "If true, bypass identity components and fold chains of "
+                "affine-type components together, for faster inference; see "
+                "CollapseModelForInference() in nnet-utils.h.  Don't train "
+                "the resulting model.");
 
     po.Read(argc, argv);
     
@@ -65,6 +77,12 @@ int main(int argc, char *argv[]) {
     if (learning_rate >= 0)
       SetLearningRate(learning_rate, &nnet);
 
+    if (ng_update_period >= 1)
+      SetNaturalGradientUpdatePeriod(ng_update_period, &nnet);
+
+    if (collapse_model)
+      CollapseModelForInference(&nnet);
+
     WriteKaldiObject(nnet, raw_nnet_wxfilename, binary_write);
     KALDI_LOG << "Copied raw neural net from " << raw_nnet_rxfilename
               << " to " << raw_nnet_wxfilename;
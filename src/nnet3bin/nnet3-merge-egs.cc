@@ -36,6 +36,25 @@ int32 NumOutputIndexes(const NnetExample &eg) {
   return 0;  // Suppress compiler warning.
 }
 
+// returns a string that encodes the "shape" of the example: the name, number of
+// indexes and feature dimension of each of its NnetIo members.  Examples with
+// the same signature produce structurally identical minibatches when merged.
+std::string ExampleShapeSignature(const NnetExample &eg) {
+  std::ostringstream os;
+  for (size_t i = 0; i < eg.io.size(); i++)
+    os << eg.io[i].name << ":" << eg.io[i].indexes.size() << ":"
+       << eg.io[i].features.NumCols() << " ";
+  return os.str();
+}
+
+// Holds the examples waiting to be merged for one shape bucket (see the
+// --bucket-by-shape option; without it there is a single bucket).
+struct EgsBucket {
+  std::vector<NnetExample> examples;
+  int32 num_output_frames;
+  EgsBucket(): num_output_frames(0) { }
+};
+
 }
 }
 
@@ -63,6 +82,7 @@ int main(int argc, char *argv[]) {
     int32 minibatch_size = 512;
     bool measure_output_frames = true;
     bool discard_partial_minibatches = false;
+    bool bucket_by_shape = false;
 
     ParseOptions po(usage);
     po.Register("minibatch-size", &minibatch_size, "Target size of minibatches "
@@ -76,7 +96,15 @@ int main(int argc, char *argv[]) {
     po.Register("discard-partial-minibatches", &discard_partial_minibatches,
 		"discard any partial minibatches of 'uneven' size that may be "
 		"encountered at the end.");
-    
+    po.Register("bucket-by-shape", &bucket_by_shape, "If true, group input "
+                "examples into buckets by their shape (number of frames and "
+                "feature dimension of each input/output), so each merged "
+                "minibatch contains identically-shaped examples.  This makes "
+                "the minibatch structure repeat, which lets the training "
+                "program reuse cached computations instead of recompiling.  "
+                "Leftover partial minibatches (one per shape, at the end) are "
+                "written unless --discard-partial-minibatches=true.");
+
     po.Read(argc, argv);
 
     if (po.NumArgs() != 2) {
@@ -89,41 +117,72 @@ int main(int argc, char *argv[]) {
 
     SequentialNnetExampleReader example_reader(examples_rspecifier);
     NnetExampleWriter example_writer(examples_wspecifier);
-    
-    std::vector<NnetExample> examples;
-    examples.reserve(minibatch_size);
 
-    int32 cur_num_output_frames = 0;
-    
-    int64 num_read = 0, num_written = 0;
+    // With --bucket-by-shape=false there is a single bucket, keyed by the
+    // empty string, and this reduces to simple sequential merging.
+    typedef std::map<std::string, EgsBucket> BucketMap;
+    BucketMap buckets;
+
+    int64 num_read = 0, num_written = 0, num_full_frames = 0;
     while (!example_reader.Done()) {
-      const NnetExample &cur_eg = example_reader.Value();
-      examples.resize(examples.size() + 1);
-      examples.back() = cur_eg;
-      cur_num_output_frames += NumOutputIndexes(cur_eg);
+      NnetExample &cur_eg = example_reader.Value();
+      std::string key = (bucket_by_shape ? ExampleShapeSignature(cur_eg) : "");
+      EgsBucket &bucket = buckets[key];
+      bucket.num_output_frames += NumOutputIndexes(cur_eg);
+      bucket.examples.resize(bucket.examples.size() + 1);
+      // swap rather than copy: we won't need the reader's value again, and
+      // this avoids reallocating and copying all the feature matrices.
+      bucket.examples.back().Swap(&cur_eg);
       bool minibatch_ready =
           (measure_output_frames ?
-           cur_num_output_frames >= minibatch_size :
-           static_cast<int32>(examples.size()) >= minibatch_size);
+           bucket.num_output_frames >= minibatch_size :
+           static_cast<int32>(bucket.examples.size()) >= minibatch_size);
 
-      // Do Next() now, so we can test example_reader.Done() below .
       example_reader.Next();
       num_read++;
 
-      if (minibatch_ready || (!discard_partial_minibatches &&
-			      (example_reader.Done() && !examples.empty()))) {
+      if (minibatch_ready) {
+        NnetExample merged_eg;
+        MergeExamples(bucket.examples, compress, &merged_eg);
+        std::ostringstream ostr;
+        ostr << "merged-" << num_written;
+        num_written++;
+        num_full_frames += bucket.num_output_frames;
+        std::string output_key = ostr.str();
+        example_writer.Write(output_key, merged_eg);
+        bucket.examples.clear();
+        bucket.num_output_frames = 0;
+      }
+    }
+    // Flush whatever is left over in the buckets: these are the partial
+    // minibatches (at most one per distinct shape).
+    int64 num_partial = 0, num_partial_frames = 0;
+    for (BucketMap::iterator iter = buckets.begin();
+         iter != buckets.end(); ++iter) {
+      EgsBucket &bucket = iter->second;
+      if (bucket.examples.empty())
+        continue;
+      num_partial++;
+      num_partial_frames += bucket.num_output_frames;
+      if (!discard_partial_minibatches) {
         NnetExample merged_eg;
-        MergeExamples(examples, compress, &merged_eg);
+        MergeExamples(bucket.examples, compress, &merged_eg);
         std::ostringstream ostr;
         ostr << "merged-" << num_written;
         num_written++;
         std::string output_key = ostr.str();
         example_writer.Write(output_key, merged_eg);
-        examples.clear();
-        cur_num_output_frames = 0;
       }
     }
     KALDI_LOG << "Merged " << num_read << " egs to " << num_written << '.';
+    if (bucket_by_shape && num_full_frames + num_partial_frames > 0)
+      KALDI_LOG << "Saw " << buckets.size() << " distinct example shapes; "
+                << num_partial << " partial minibatches containing "
+                << num_partial_frames << " output frames ("
+                << (100.0 * num_partial_frames /
+                    (num_full_frames + num_partial_frames))
+                << "% of the total) were "
+                << (discard_partial_minibatches ? "discarded." : "written.");
     return (num_written != 0 ? 0 : 1);
   } catch(const std::exception &e) {
     std::cerr << e.what() << '\n';
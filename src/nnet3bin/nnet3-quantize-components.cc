@@ -0,0 +1,132 @@
+// nnet3bin/nnet3-quantize-components.cc
+
+// Copyright 2015  Johns Hopkins University (author:  Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "nnet3/nnet-nnet.h"
+#include "nnet3/nnet-simple-component.h"
+
+namespace kaldi {
+namespace nnet3 {
+
+// Returns a QuantizedAffineComponent with the same parameters as the given
+// affine-type component (quantized to int8 with per-row scales), or NULL if
+// the component is not of an affine type that we know how to convert.
+Component* QuantizeComponent(Component *component) {
+  CuMatrix<BaseFloat> params;  // output-dim by input-dim + 1; last column
+                               // is the bias term.
+  if (AffineComponent *ac = dynamic_cast<AffineComponent*>(component)) {
+    // this covers NaturalGradientAffineComponent too.
+    int32 input_dim = ac->InputDim(), output_dim = ac->OutputDim();
+    params.Resize(output_dim, input_dim + 1);
+    params.ColRange(0, input_dim).CopyFromMat(ac->LinearParams());
+    params.CopyColFromVec(ac->BiasParams(), input_dim);
+  } else if (FixedAffineComponent *fc =
+             dynamic_cast<FixedAffineComponent*>(component)) {
+    int32 input_dim = fc->InputDim(), output_dim = fc->OutputDim();
+    params.Resize(output_dim, input_dim + 1);
+    params.ColRange(0, input_dim).CopyFromMat(fc->LinearParams());
+    // FixedAffineComponent exposes no bias accessor, so recover the bias by
+    // propagating a zero input through the component.
+    CuMatrix<BaseFloat> zero_in(1, input_dim), bias_out(1, output_dim);
+    fc->Propagate(NULL, zero_in, &bias_out);
+    params.ColRange(input_dim, 1).CopyFromMat(bias_out, kTrans);
+  } else {
+    return NULL;
+  }
+  QuantizedAffineComponent *qc = new QuantizedAffineComponent();
+  qc->Init(params);
+  return qc;
+}
+
+}
+}
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    using namespace kaldi::nnet3;
+    typedef kaldi::int32 int32;
+
+    const char *usage =
+        "Convert the affine components of a 'raw' nnet3 neural network to\n"
+        "QuantizedAffineComponent, which stores the weights as int8 with\n"
+        "per-row scales (4x smaller, for inference only; the resulting\n"
+        "network cannot be trained further).  To convert an .mdl file,\n"
+        "first extract the raw network with nnet3-am-copy --raw=true.\n"
+        "\n"
+        "Usage:  nnet3-quantize-components [options] <nnet-in> <nnet-out>\n"
+        "e.g.:\n"
+        " nnet3-quantize-components final.raw final_quant.raw\n";
+
+    bool binary_write = true;
+    std::string skip_components;
+
+    ParseOptions po(usage);
+    po.Register("binary", &binary_write, "Write output in binary mode");
+    po.Register("skip-components", &skip_components, "Comma-separated list "
+                "of names of components to leave unquantized (e.g. the "
+                "final layer, if it turns out to be sensitive).");
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 2) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string raw_nnet_rxfilename = po.GetArg(1),
+                raw_nnet_wxfilename = po.GetArg(2);
+
+    std::vector<std::string> skip_list;
+    SplitStringToVector(skip_components, ",", true, &skip_list);
+
+    Nnet nnet;
+    ReadKaldiObject(raw_nnet_rxfilename, &nnet);
+
+    int32 num_quantized = 0;
+    for (int32 c = 0; c < nnet.NumComponents(); c++) {
+      const std::string &name = nnet.GetComponentName(c);
+      if (std::find(skip_list.begin(), skip_list.end(), name) !=
+          skip_list.end()) {
+        KALDI_LOG << "Skipping component " << name << " as requested.";
+        continue;
+      }
+      Component *quantized = QuantizeComponent(nnet.GetComponent(c));
+      if (quantized != NULL) {
+        KALDI_VLOG(1) << "Quantized component " << name << " (was "
+                      << nnet.GetComponent(c)->Type() << ").";
+        nnet.SetComponent(c, quantized);
+        num_quantized++;
+      }
+    }
+    if (num_quantized == 0)
+      KALDI_WARN << "The network had no affine components to quantize.";
+
+    WriteKaldiObject(nnet, raw_nnet_wxfilename, binary_write);
+    KALDI_LOG << "Quantized " << num_quantized << " components of neural net "
+              << "from " << raw_nnet_rxfilename << "; wrote to "
+              << raw_nnet_wxfilename;
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what() << '\n';
+    return -1;
+  }
+}
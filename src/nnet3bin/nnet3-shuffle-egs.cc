@@ -22,6 +22,7 @@
 #include "util/common-utils.h"
 #include "hmm/transition-model.h"
 #include "nnet3/nnet-example.h"
+#include "nnet3/nnet-example-utils.h"
 
 int main(int argc, char *argv[]) {
   try {
@@ -62,40 +63,35 @@ int main(int argc, char *argv[]) {
 
     int64 num_done = 0;
 
-    std::vector<std::pair<std::string, NnetExample*> > egs;
-
-    SequentialNnetExampleReader example_reader(examples_rspecifier);
     NnetExampleWriter example_writer(examples_wspecifier);
     if (buffer_size == 0) { // Do full randomization
       // Putting in an extra level of indirection here to avoid excessive
       // computation and memory demands when we have to resize the vector.
+      std::vector<std::pair<std::string, NnetExample*> > egs;
 
-      for (; !example_reader.Done(); example_reader.Next())
-        egs.push_back(std::make_pair(example_reader.Key(),
-                                    new NnetExample(example_reader.Value())));
+      SequentialNnetExampleReader example_reader(examples_rspecifier);
+      for (; !example_reader.Done(); example_reader.Next()) {
+        NnetExample *eg = new NnetExample();
+        // swap rather than copy; we won't need the reader's value again.
+        eg->Swap(&example_reader.Value());
+        egs.push_back(std::make_pair(example_reader.Key(), eg));
+      }
 
       std::random_shuffle(egs.begin(), egs.end());
+      for (size_t i = 0; i < egs.size(); i++) {
+        example_writer.Write(egs[i].first, *(egs[i].second));
+        delete egs[i].second;
+        num_done++;
+      }
     } else {
       KALDI_ASSERT(buffer_size > 0);
-      egs.resize(buffer_size, std::make_pair(std::string(""),
-                                             static_cast<NnetExample*>(NULL)));
+      ExampleShufflerConfig shuffle_config;
+      shuffle_config.shuffle_buffer_size = buffer_size;
+      shuffle_config.srand_seed = srand_seed;
+      ShuffledExampleReader example_reader(shuffle_config,
+                                           examples_rspecifier);
       for (; !example_reader.Done(); example_reader.Next()) {
-        int32 index = RandInt(0, buffer_size - 1);
-        if (egs[index].second == NULL) {
-          egs[index] = std::make_pair(example_reader.Key(),
-                                    new NnetExample(example_reader.Value()));
-        } else {
-          example_writer.Write(egs[index].first, *(egs[index].second));
-          egs[index].first = example_reader.Key();
-          *(egs[index].second) = example_reader.Value();
-          num_done++;
-        }
-      }
-    }
-    for (size_t i = 0; i < egs.size(); i++) {
-      if (egs[i].second != NULL) {
-        example_writer.Write(egs[i].first, *(egs[i].second));
-        delete egs[i].second;
+        example_writer.Write(example_reader.Key(), example_reader.Value());
         num_done++;
       }
     }
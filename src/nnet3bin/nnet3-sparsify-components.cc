@@ -0,0 +1,152 @@
+// nnet3bin/nnet3-sparsify-components.cc
+
+// Copyright 2015  Johns Hopkins University (author:  Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "nnet3/nnet-nnet.h"
+#include "nnet3/nnet-simple-component.h"
+
+namespace kaldi {
+namespace nnet3 {
+
+// Returns a BlockSparseAffineComponent with the same parameters as the
+// given affine-type component, minus the weight blocks whose largest
+// absolute element is at or below the threshold; or NULL if the component
+// is not of an affine type that we know how to convert.
+Component* SparsifyComponent(Component *component, int32 block_rows,
+                             int32 block_cols, BaseFloat threshold) {
+  CuMatrix<BaseFloat> params;  // output-dim by input-dim + 1; last column
+                               // is the bias term.
+  if (AffineComponent *ac = dynamic_cast<AffineComponent*>(component)) {
+    // this covers NaturalGradientAffineComponent too.
+    int32 input_dim = ac->InputDim(), output_dim = ac->OutputDim();
+    params.Resize(output_dim, input_dim + 1);
+    params.ColRange(0, input_dim).CopyFromMat(ac->LinearParams());
+    params.CopyColFromVec(ac->BiasParams(), input_dim);
+  } else if (FixedAffineComponent *fc =
+             dynamic_cast<FixedAffineComponent*>(component)) {
+    int32 input_dim = fc->InputDim(), output_dim = fc->OutputDim();
+    params.Resize(output_dim, input_dim + 1);
+    params.ColRange(0, input_dim).CopyFromMat(fc->LinearParams());
+    // FixedAffineComponent exposes no bias accessor, so recover the bias by
+    // propagating a zero input through the component.
+    CuMatrix<BaseFloat> zero_in(1, input_dim), bias_out(1, output_dim);
+    fc->Propagate(NULL, zero_in, &bias_out);
+    params.ColRange(input_dim, 1).CopyFromMat(bias_out, kTrans);
+  } else {
+    return NULL;
+  }
+  BlockSparseAffineComponent *sc = new BlockSparseAffineComponent();
+  sc->Init(params, block_rows, block_cols, threshold);
+  return sc;
+}
+
+}
+}
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    using namespace kaldi::nnet3;
+    typedef kaldi::int32 int32;
+
+    const char *usage =
+        "Convert the affine components of a 'raw' nnet3 neural network to\n"
+        "BlockSparseAffineComponent, dropping the weight blocks whose\n"
+        "largest absolute element is at or below a threshold (for\n"
+        "inference only; the resulting network cannot be trained further).\n"
+        "This is intended for models pruned to a structured (block)\n"
+        "sparsity pattern during training, where the dropped blocks are\n"
+        "exactly or nearly zero.  To convert an .mdl file, first extract\n"
+        "the raw network with nnet3-am-copy --raw=true.\n"
+        "\n"
+        "Usage:  nnet3-sparsify-components [options] <nnet-in> <nnet-out>\n"
+        "e.g.:\n"
+        " nnet3-sparsify-components --block-rows=16 --block-cols=16 \\\n"
+        "   --threshold=0.01 final.raw final_sparse.raw\n";
+
+    bool binary_write = true;
+    int32 block_rows = 16, block_cols = 16;
+    BaseFloat threshold = 0.0;
+    std::string skip_components;
+
+    ParseOptions po(usage);
+    po.Register("binary", &binary_write, "Write output in binary mode");
+    po.Register("block-rows", &block_rows, "Number of rows in each weight "
+                "block; should match the block pattern the model was pruned "
+                "with.");
+    po.Register("block-cols", &block_cols, "Number of columns in each weight "
+                "block.");
+    po.Register("threshold", &threshold, "Weight blocks whose largest "
+                "absolute element is at or below this value are dropped "
+                "(treated as zero).  With the default of 0, only "
+                "exactly-zero blocks are dropped and the conversion is "
+                "lossless.");
+    po.Register("skip-components", &skip_components, "Comma-separated list "
+                "of names of components to leave dense (e.g. the final "
+                "layer, if it turns out to be sensitive).");
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 2) {
+      po.PrintUsage();
+      exit(1);
+    }
+
+    std::string raw_nnet_rxfilename = po.GetArg(1),
+                raw_nnet_wxfilename = po.GetArg(2);
+
+    std::vector<std::string> skip_list;
+    SplitStringToVector(skip_components, ",", true, &skip_list);
+
+    Nnet nnet;
+    ReadKaldiObject(raw_nnet_rxfilename, &nnet);
+
+    int32 num_sparsified = 0;
+    for (int32 c = 0; c < nnet.NumComponents(); c++) {
+      const std::string &name = nnet.GetComponentName(c);
+      if (std::find(skip_list.begin(), skip_list.end(), name) !=
+          skip_list.end()) {
+        KALDI_LOG << "Skipping component " << name << " as requested.";
+        continue;
+      }
+      Component *sparse = SparsifyComponent(nnet.GetComponent(c), block_rows,
+                                            block_cols, threshold);
+      if (sparse != NULL) {
+        KALDI_VLOG(1) << "Sparsified component " << name << " (was "
+                      << nnet.GetComponent(c)->Type() << "); info: "
+                      << sparse->Info();
+        nnet.SetComponent(c, sparse);
+        num_sparsified++;
+      }
+    }
+    if (num_sparsified == 0)
+      KALDI_WARN << "The network had no affine components to sparsify.";
+
+    WriteKaldiObject(nnet, raw_nnet_wxfilename, binary_write);
+    KALDI_LOG << "Sparsified " << num_sparsified << " components of neural "
+              << "net from " << raw_nnet_rxfilename << "; wrote to "
+              << raw_nnet_wxfilename;
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what() << '\n';
+    return -1;
+  }
+}
@@ -19,7 +19,9 @@
 
 #include "base/kaldi-common.h"
 #include "util/common-utils.h"
+#include "thread/kaldi-prefetch-table-reader.h"
 #include "nnet3/nnet-training.h"
+#include "nnet3/nnet-example-utils.h"
 
 
 int main(int argc, char *argv[]) {
@@ -43,14 +45,21 @@ int main(int argc, char *argv[]) {
 
     bool binary_write = true;
     std::string use_gpu = "yes";
+    int32 prefetch_depth = 2;
     NnetTrainerOptions train_config;
+    ExampleShufflerConfig shuffle_config;
 
     ParseOptions po(usage);
     po.Register("binary", &binary_write, "Write output in binary mode");
     po.Register("use-gpu", &use_gpu,
                 "yes|no|optional|wait, only has effect if compiled with CUDA");
+    po.Register("prefetch-depth", &prefetch_depth, "Number of minibatches the "
+                "background thread reads and deserializes ahead of the "
+                "training, so the next minibatch is staged in memory while "
+                "the current one computes.");
 
     train_config.Register(&po);
+    shuffle_config.Register(&po);
 
     po.Read(argc, argv);
 
@@ -74,10 +83,23 @@ int main(int argc, char *argv[]) {
     {
       NnetTrainer trainer(train_config, &nnet);
 
-      SequentialNnetExampleReader example_reader(examples_rspecifier);
-
-      for (; !example_reader.Done(); example_reader.Next())
-        trainer.Train(example_reader.Value());
+      if (shuffle_config.shuffle_buffer_size > 0) {
+        // Approximately shuffle the examples on the fly with bounded memory,
+        // instead of a separate nnet3-shuffle-egs pass over the data.
+        ShuffledExampleReader example_reader(shuffle_config,
+                                             examples_rspecifier);
+        for (; !example_reader.Done(); example_reader.Next())
+          trainer.Train(example_reader.Value());
+      } else {
+        // The prefetching reader reads and deserializes the next minibatches
+        // in a background thread, so the main thread (and hence the GPU)
+        // doesn't wait on I/O between steps.
+        PrefetchingSequentialTableReader<KaldiObjectHolder<NnetExample> >
+            example_reader(examples_rspecifier, prefetch_depth);
+
+        for (; !example_reader.Done(); example_reader.Next())
+          trainer.Train(example_reader.Value());
+      }
 
       ok = trainer.PrintTotalStats();
 
@@ -27,6 +27,7 @@
 #include "decoder/decodable-matrix.h"
 #include "lat/kaldi-lattice.h"
 #include "lat/lattice-functions.h"
+#include "lat/cu-lattice-functions.h"
 
 #include "nnet/nnet-trnopts.h"
 #include "nnet/nnet-component.h"
@@ -299,9 +300,11 @@ int main(int argc, char *argv[]) {
       if (acoustic_scale != 1.0 || lm_scale != 1.0)
         fst::ScaleLattice(fst::LatticeScale(lm_scale, acoustic_scale), &den_lat);
 
-      // 5) get the posteriors
+      // 5) get the posteriors (on the GPU when one is active, which it
+      // normally is in this binary; falls back to the CPU code otherwise)
       kaldi::Posterior post;
-      lat_like = kaldi::LatticeForwardBackward(den_lat, &post, &lat_ac_like);
+      lat_like = kaldi::CudaLatticeForwardBackward(den_lat, &post,
+                                                   &lat_ac_like);
 
       // 6) convert the Posterior to a matrix
       nnet_diff_h.Resize(num_frames, num_pdfs, kSetZero);
@@ -185,4 +185,107 @@ bool OnlineVectorSource::Read(Vector<BaseFloat> *data) {
   return (pos_ < src_.Dim());
 }
 
+
+OnlineVadSource::OnlineVadSource(OnlineAudioSourceItf *input,
+                                 const OnlineVadOptions &opts)
+    : input_(input), opts_(opts), hangover_left_(0),
+      in_segment_(false), end_of_segment_(false), samples_discarded_(0) {
+  KALDI_ASSERT(opts.block_size > 1);
+  KALDI_ASSERT(opts.energy_threshold >= 0.0);
+  KALDI_ASSERT(opts.zcr_threshold >= 0.0 && opts.zcr_threshold <= 1.0);
+  KALDI_ASSERT(opts.hangover_blocks >= 0 && opts.lookback_blocks >= 0);
+}
+
+
+bool OnlineVadSource::IsVoiced(const BaseFloat *block,
+                               int32 num_samples) const {
+  // Two simple loops over contiguous data, with no branches dependent on
+  // the sample values, so the compiler can vectorize them.
+  double abs_sum = 0.0;
+  for (int32 i = 0; i < num_samples; ++i)
+    abs_sum += std::abs(block[i]);
+  int32 num_crossings = 0;
+  for (int32 i = 1; i < num_samples; ++i)
+    num_crossings += ((block[i - 1] < 0.0) != (block[i] < 0.0)) ? 1 : 0;
+  BaseFloat mean_abs = abs_sum / num_samples,
+      zcr = static_cast<BaseFloat>(num_crossings) / (num_samples - 1);
+  if (mean_abs >= opts_.energy_threshold)
+    return true;
+  // Fricatives can have fairly low energy but a high zero-crossing rate;
+  // accept such blocks down to a quarter of the energy threshold.
+  return (mean_abs >= 0.25 * opts_.energy_threshold &&
+          zcr >= opts_.zcr_threshold);
+}
+
+
+bool OnlineVadSource::Read(Vector<BaseFloat> *data) {
+  KALDI_ASSERT(data->Dim() > 0);
+  const int32 block_size = opts_.block_size;
+  Vector<BaseFloat> raw(data->Dim());
+  bool more = input_->Read(&raw);
+
+  std::vector<BaseFloat> buf;
+  buf.reserve(partial_.size() + raw.Dim());
+  buf.insert(buf.end(), partial_.begin(), partial_.end());
+  for (int32 i = 0; i < raw.Dim(); ++i)
+    buf.push_back(raw(i));
+  partial_.clear();
+
+  end_of_segment_ = false;
+  std::vector<BaseFloat> out;
+  out.reserve(lookback_.size() + buf.size());
+  int32 num_blocks = buf.size() / block_size;
+  for (int32 b = 0; b < num_blocks; ++b) {
+    const BaseFloat *block = &buf[b * block_size];
+    if (IsVoiced(block, block_size)) {
+      if (!in_segment_) { // speech resumes: replay the lookback samples so
+                          // we don't clip the beginning of the word.
+        out.insert(out.end(), lookback_.begin(), lookback_.end());
+        lookback_.clear();
+        in_segment_ = true;
+      }
+      hangover_left_ = opts_.hangover_blocks;
+      out.insert(out.end(), block, block + block_size);
+    } else if (in_segment_) {
+      out.insert(out.end(), block, block + block_size);
+      if (--hangover_left_ <= 0) {
+        in_segment_ = false;
+        end_of_segment_ = true;
+      }
+    } else {
+      // Samples only count as discarded once they fall off the end of the
+      // lookback buffer (samples still in it may yet be replayed).
+      lookback_.insert(lookback_.end(), block, block + block_size);
+      size_t max_lookback =
+          static_cast<size_t>(opts_.lookback_blocks) * block_size;
+      if (lookback_.size() > max_lookback) {
+        samples_discarded_ += lookback_.size() - max_lookback;
+        lookback_.erase(lookback_.begin(),
+                        lookback_.end() - max_lookback);
+      }
+    }
+  }
+
+  if (more) { // carry the sub-block tail over to the next call.
+    partial_.assign(buf.begin() + num_blocks * block_size, buf.end());
+  } else { // end of stream: pass the unclassified tail through if we are in
+           // a segment, otherwise drop it along with the pending lookback.
+    int32 tail = buf.size() - num_blocks * block_size;
+    if (in_segment_) {
+      out.insert(out.end(), buf.end() - tail, buf.end());
+      end_of_segment_ = true;
+      in_segment_ = false;
+    } else {
+      samples_discarded_ += tail;
+    }
+    samples_discarded_ += lookback_.size();
+    lookback_.clear();
+  }
+
+  data->Resize(out.size());
+  for (size_t i = 0; i < out.size(); ++i)
+    (*data)(i) = out[i];
+  return more;
+}
+
 }  // namespace kaldi
@@ -30,7 +30,10 @@
 
 #endif //KALDI_NO_PORTAUDIO
 
+#include <vector>
+
 #include "matrix/kaldi-vector.h"
+#include "itf/options-itf.h"
 
 namespace kaldi {
 
@@ -150,6 +153,84 @@ class OnlineVectorSource: public OnlineAudioSourceItf {
   KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineVectorSource);
 };
 
+
+// Options for the block-based energy/zero-crossing voice activity
+// detector in OnlineVadSource.  The defaults assume 16-bit input
+// at ~16kHz, as produced by OnlinePaSource.
+struct OnlineVadOptions {
+  int32 block_size; // number of samples classified together
+  BaseFloat energy_threshold; // mean absolute amplitude (16-bit sample scale)
+                              // above which a block counts as speech
+  BaseFloat zcr_threshold; // zero-crossing rate, in [0, 1], above which a
+                           // block counts as speech even at lower energy
+                           // (catches fricatives); see OnlineVadSource
+  int32 hangover_blocks; // silent blocks we keep emitting after the last
+                         // speech block, to avoid clipping word endings
+  int32 lookback_blocks; // recent silent blocks replayed when speech
+                         // resumes, to avoid clipping word beginnings
+  OnlineVadOptions(): block_size(256), energy_threshold(256.0),
+                      zcr_threshold(0.35), hangover_blocks(8),
+                      lookback_blocks(2) { }
+  void Register(OptionsItf *opts) {
+    opts->Register("vad-block-size", &block_size,
+                   "Number of audio samples per VAD block");
+    opts->Register("vad-energy-threshold", &energy_threshold,
+                   "Mean absolute amplitude (16-bit scale) above which a "
+                   "block is considered speech");
+    opts->Register("vad-zcr-threshold", &zcr_threshold,
+                   "Zero-crossing rate above which a lower-energy block is "
+                   "still considered speech");
+    opts->Register("vad-hangover-blocks", &hangover_blocks,
+                   "Number of silent blocks emitted after speech ends");
+    opts->Register("vad-lookback-blocks", &lookback_blocks,
+                   "Number of silent blocks replayed when speech resumes");
+  }
+};
+
+// Acts as a proxy to another OnlineAudioSourceItf, gating the audio with a
+// cheap energy/zero-crossing voice activity detector so that downstream
+// feature extraction (e.g. OnlineFeInput in online-feat-input.h) never sees
+// long stretches of silence.  Each block of "block_size" samples is
+// classified in a single pass over the samples, and silent blocks are
+// dropped wholesale; "hangover" and "lookback" blocks around each speech
+// segment are retained so we don't clip word boundaries.  Note: because
+// silence is removed, the frame indices seen downstream no longer
+// correspond to wall-clock time; EndOfSegment() can be polled after each
+// Read() to detect segment boundaries.
+class OnlineVadSource : public OnlineAudioSourceItf {
+ public:
+  // Does not take ownership of "input", which must out-live this object.
+  OnlineVadSource(OnlineAudioSourceItf *input, const OnlineVadOptions &opts);
+
+  // Implementation of the OnlineAudioSourceItf.  Reads data->Dim() samples
+  // from the underlying source and returns only those classified as speech
+  // (possibly zero samples), resizing "data" accordingly.
+  bool Read(Vector<BaseFloat> *data);
+
+  // Returns true if a speech-to-silence transition was detected during the
+  // last call to Read() (i.e. a segment ended).
+  bool EndOfSegment() const { return end_of_segment_; }
+
+  // The total number of samples classified as silence and dropped so far.
+  int64 SamplesDiscarded() const { return samples_discarded_; }
+
+ private:
+  // Classifies one block of samples; single pass, no state.
+  bool IsVoiced(const BaseFloat *block, int32 num_samples) const;
+
+  OnlineAudioSourceItf *input_;
+  const OnlineVadOptions opts_;
+  std::vector<BaseFloat> partial_; // tail of the last read that was shorter
+                                   // than a block; prepended to the next read
+  std::vector<BaseFloat> lookback_; // most recent silent samples, capped at
+                                    // lookback_blocks * block_size
+  int32 hangover_left_; // silent blocks still to emit after last speech block
+  bool in_segment_; // true if we are currently inside a speech segment
+  bool end_of_segment_; // see EndOfSegment()
+  int64 samples_discarded_; // see SamplesDiscarded()
+  KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineVadSource);
+};
+
 } // namespace kaldi
 
 #endif // KALDI_ONLINE_ONLINE_AUDIO_SOURCE_H_
@@ -242,6 +242,59 @@ void TestOnlineCmnInput() { // We're also testing OnlineCacheInput here.
   KALDI_ASSERT(output_feats1.ApproxEqual(output_feats3));
 }
 
+void TestOnlineVadSource() {
+  OnlineVadOptions opts;
+  opts.block_size = 64 + Rand() % 64;
+  int32 bs = opts.block_size;
+  // silence / speech / silence; amplitudes on the 16-bit sample scale.
+  int32 sil1_blocks = 10 + Rand() % 10,
+      speech_blocks = 5 + Rand() % 10,
+      sil2_blocks = 10 + Rand() % 10;
+  Vector<BaseFloat> wave((sil1_blocks + speech_blocks + sil2_blocks) * bs);
+  for (int32 i = 0; i < wave.Dim(); ++i)
+    wave(i) = 10.0 * RandGauss(); // low-level background noise
+  for (int32 i = sil1_blocks * bs;
+       i < (sil1_blocks + speech_blocks) * bs; ++i)
+    wave(i) += 8000.0 * sin(0.05 * i); // loud "speech" segment
+
+  OnlineVectorSource vector_source(wave);
+  OnlineVadSource vad_source(&vector_source, opts);
+  std::vector<BaseFloat> received;
+  bool saw_end_of_segment = false;
+  Vector<BaseFloat> chunk;
+  bool more = true;
+  int32 remaining = wave.Dim(); // never over-request: OnlineVectorSource
+                                // does not shrink "data" on a short read.
+  while (more) {
+    chunk.Resize(std::min(bs * (1 + Rand() % 5), remaining));
+    remaining -= chunk.Dim();
+    more = vad_source.Read(&chunk);
+    for (int32 i = 0; i < chunk.Dim(); ++i)
+      received.push_back(chunk(i));
+    if (vad_source.EndOfSegment())
+      saw_end_of_segment = true;
+  }
+  KALDI_ASSERT(saw_end_of_segment);
+  KALDI_ASSERT(vad_source.SamplesDiscarded() > 0);
+  KALDI_ASSERT(static_cast<int32>(received.size()) +
+               vad_source.SamplesDiscarded() == wave.Dim());
+  // We must get the whole speech segment, plus at most the lookback and
+  // hangover context around it.
+  int32 min_samples = speech_blocks * bs,
+      max_samples = (speech_blocks + opts.lookback_blocks +
+                     opts.hangover_blocks) * bs;
+  KALDI_ASSERT(static_cast<int32>(received.size()) >= min_samples);
+  KALDI_ASSERT(static_cast<int32>(received.size()) <= max_samples);
+  // The speech samples themselves must come through unmodified, in order;
+  // locate the start of the speech segment in the output.
+  int32 speech_start = sil1_blocks * bs, offset = -1;
+  for (size_t i = 0; i < received.size(); ++i) {
+    if (received[i] == wave(speech_start)) { offset = i; break; }
+  }
+  KALDI_ASSERT(offset >= 0);
+  for (int32 i = 0; i < speech_blocks * bs; ++i)
+    KALDI_ASSERT(received[offset + i] == wave(speech_start + i));
+}
 
 
 }  // end namespace kaldi
@@ -254,6 +307,7 @@ int main() {
     TestOnlineLdaInput();
     TestOnlineDeltaInput();
     TestOnlineCmnInput(); // also tests cache input.
+    TestOnlineVadSource();
     // I have not tested the delta input yet.
   }
   std::cout << "Test OK.\n";
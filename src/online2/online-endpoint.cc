@@ -107,20 +107,29 @@ int32 TrailingSilenceLength(const TransitionModel &tmodel,
 
 bool EndpointDetected(
     const OnlineEndpointConfig &config,
-    const TransitionModel &tmodel,    
+    const TransitionModel &tmodel,
     BaseFloat frame_shift_in_seconds,
     const LatticeFasterOnlineDecoder &decoder) {
   if (decoder.NumFramesDecoded() == 0) return false;
 
-  BaseFloat final_relative_cost = decoder.FinalRelativeCost();
-
   int32 num_frames_decoded = decoder.NumFramesDecoded(),
-      trailing_silence_frames = TrailingSilenceLength(tmodel,
-                                                      config.silence_phones,
-                                                      decoder);
+      trailing_silence_frames;
+  BaseFloat final_relative_cost;
+
+  // Fast path: if the decoder was told to track the trailing silence as it
+  // decodes [see LatticeFasterOnlineDecoder::TrackTrailingSilence()], this is
+  // O(1); otherwise we do the best-path traceback each time we're called,
+  // which can add up when polling frequently.
+  if (!decoder.GetCachedEndpointInfo(&trailing_silence_frames,
+                                     &final_relative_cost)) {
+    final_relative_cost = decoder.FinalRelativeCost();
+    trailing_silence_frames = TrailingSilenceLength(tmodel,
+                                                    config.silence_phones,
+                                                    decoder);
+  }
 
   return EndpointDetected(config, num_frames_decoded, trailing_silence_frames,
-                          frame_shift_in_seconds, final_relative_cost);  
+                          frame_shift_in_seconds, final_relative_cost);
 }
 
 
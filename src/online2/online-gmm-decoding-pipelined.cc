@@ -0,0 +1,139 @@
+// online2/online-gmm-decoding-pipelined.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "online2/online-gmm-decoding-pipelined.h"
+
+namespace kaldi {
+
+SingleUtteranceGmmDecoderPipelined::SingleUtteranceGmmDecoderPipelined(
+    const OnlineGmmDecodingConfig &config,
+    const ThreadedLoglikePipelineConfig &pipeline_config,
+    const OnlineGmmDecodingModels &models,
+    const OnlineFeaturePipeline &feature_prototype,
+    const fst::Fst<fst::StdArc> &fst,
+    const OnlineGmmAdaptationState &adaptation_state):
+    SingleUtteranceGmmDecoder(config, models, feature_prototype, fst,
+                              adaptation_state),
+    input_finished_(false), abort_(false),
+    pipeline_(pipeline_config, models.GetTransitionModel(), this) {
+  // caution: the pipeline_ constructor spawned the background thread, which
+  // by now may already be blocked inside ComputeLoglikes() waiting for
+  // waveform.
+}
+
+SingleUtteranceGmmDecoderPipelined::~SingleUtteranceGmmDecoderPipelined() {
+  // Make the background thread exit before the members it uses are destroyed.
+  // We call SetAbort() here rather than relying on pipeline_'s destructor to
+  // do it, because SetAbort() calls the virtual Abort() on this object and we
+  // want that to happen while this object is still intact; pipeline_'s
+  // destructor (which runs first, as it's the last member) joins the thread.
+  pipeline_.SetAbort();
+}
+
+void SingleUtteranceGmmDecoderPipelined::AcceptWaveform(
+    BaseFloat sampling_rate,
+    const VectorBase<BaseFloat> &wave_part) {
+  feature_pipeline_mutex_.Lock();
+  feature_pipeline_->AcceptWaveform(sampling_rate, wave_part);
+  feature_pipeline_mutex_.Unlock();
+  waveform_ready_.Signal();  // wake the background thread if it is sleeping.
+}
+
+void SingleUtteranceGmmDecoderPipelined::InputFinished() {
+  feature_pipeline_mutex_.Lock();
+  KALDI_ASSERT(!input_finished_ && "InputFinished called twice");
+  feature_pipeline_->InputFinished();  // flushes out the last few frames.
+  input_finished_ = true;
+  feature_pipeline_mutex_.Unlock();
+  waveform_ready_.Signal();  // so the background thread notices, even if no
+                             // more waveform is coming.
+}
+
+void SingleUtteranceGmmDecoderPipelined::AdvanceDecoding() {
+  pipeline_.AdvanceDecoding(&decoder_);
+}
+
+void SingleUtteranceGmmDecoderPipelined::FinalizeDecoding() {
+  if (!input_finished_)
+    KALDI_ERR << "You cannot call FinalizeDecoding() before calling "
+              << "InputFinished().";
+  pipeline_.FinishDecoding(&decoder_);
+  decoder_.FinalizeDecoding();
+}
+
+void SingleUtteranceGmmDecoderPipelined::ComputeLoglikes(
+    int32 begin_frame, int32 max_frames,
+    Matrix<BaseFloat> *loglikes, bool *no_more_frames) {
+  KALDI_ASSERT(begin_frame >= 0 && max_frames > 0);
+  Matrix<BaseFloat> feats;
+
+  feature_pipeline_mutex_.Lock();
+  // Wait until at least one not-yet-scored frame of features is available, or
+  // until we know that none will come.  waveform_ready_ is a counting
+  // semaphore, so a signal from the main thread cannot be lost while we are
+  // busy; a stale signal just causes one spurious iteration of this loop.
+  while (feature_pipeline_->NumFramesReady() <= begin_frame &&
+         !input_finished_ && !abort_) {
+    feature_pipeline_mutex_.Unlock();
+    waveform_ready_.Wait();
+    feature_pipeline_mutex_.Lock();
+  }
+  int32 num_frames_ready = feature_pipeline_->NumFramesReady(),
+      num_frames = std::min<int32>(num_frames_ready - begin_frame, max_frames);
+  if (num_frames < 0) num_frames = 0;  // possible if we were aborted.
+  if (num_frames > 0) {
+    feats.Resize(num_frames, feature_pipeline_->Dim());
+    for (int32 i = 0; i < num_frames; i++) {
+      SubVector<BaseFloat> this_feat(feats, i);
+      feature_pipeline_->GetFrame(begin_frame + i, &this_feat);
+    }
+  }
+  // The choice of model mirrors SingleUtteranceGmmDecoder::AdvanceDecoding().
+  // Since we don't re-estimate fMLLR mid-utterance (see the comment above the
+  // class, in the header), this choice is stable for the whole utterance.
+  const AmDiagGmm &am_gmm = (feature_pipeline_->HaveFmllrTransform() ?
+                             models_.GetModel() :
+                             models_.GetOnlineAlignmentModel());
+  *no_more_frames = (abort_ ||
+                     (input_finished_ &&
+                      begin_frame + num_frames == num_frames_ready));
+  feature_pipeline_mutex_.Unlock();
+
+  // The likelihood computation is the expensive part, so we do it outside the
+  // lock; this is the work that gets moved off the decoding thread.  Note:
+  // unlike DecodableDiagGmmScaledOnline we compute all the pdfs of each
+  // frame, since we don't know in advance which ones the search will ask for.
+  loglikes->Resize(num_frames, am_gmm.NumPdfs());
+  for (int32 i = 0; i < num_frames; i++) {
+    SubVector<BaseFloat> this_feat(feats, i);
+    for (int32 pdf = 0; pdf < am_gmm.NumPdfs(); pdf++)
+      (*loglikes)(i, pdf) = am_gmm.LogLikelihood(pdf, this_feat);
+  }
+  loglikes->Scale(config_.acoustic_scale);
+}
+
+void SingleUtteranceGmmDecoderPipelined::Abort() {
+  // No lock is taken here: this may be called from the background thread's
+  // error handler, which could already be holding feature_pipeline_mutex_.
+  abort_ = true;
+  waveform_ready_.Signal();  // wake the background thread, if it is waiting
+                             // for waveform; it will see abort_.
+}
+
+}  // namespace kaldi
@@ -0,0 +1,145 @@
+// online2/online-gmm-decoding-pipelined.h
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_ONLINE2_ONLINE_GMM_DECODING_PIPELINED_H_
+#define KALDI_ONLINE2_ONLINE_GMM_DECODING_PIPELINED_H_
+
+#include <string>
+#include <vector>
+
+#include "online2/online-gmm-decoding.h"
+#include "online2/online-loglike-pipeline.h"
+#include "thread/kaldi-mutex.h"
+#include "thread/kaldi-semaphore.h"
+
+namespace kaldi {
+/// @addtogroup  onlinedecoding OnlineDecoding
+/// @{
+
+/**
+   This is a pipelined version of SingleUtteranceGmmDecoder: the feature
+   computation and GMM likelihood computation run about one chunk ahead of the
+   graph search, on a background thread (see class ThreadedLoglikePipeline),
+   instead of being interleaved with the search on the calling thread.  This
+   roughly halves the real-time factor on machines with a spare core, at the
+   cost of computing likelihoods for all pdfs of each frame (the serial decoder
+   only computes the pdfs the search actually asks for).
+
+   It is intended as a drop-in replacement for SingleUtteranceGmmDecoder, with
+   the following differences:
+
+     - You supply waveform by calling AcceptWaveform() and InputFinished() on
+       this class, instead of on FeaturePipeline() (the feature pipeline is
+       shared with the background thread, and this class takes care of the
+       locking).
+     - fMLLR is applied from the start of the utterance if the supplied
+       adaptation state contains a transform, but we do not re-estimate it
+       mid-utterance (the likelihoods are computed ahead of the search, so a
+       mid-utterance transform would take effect with a delay anyway).  Call
+       EstimateFmllr() after FinalizeDecoding(), and rely on
+       GetLattice(rescore_if_needed=true, ...) and on carrying the adaptation
+       state over to the next utterance, as the command-line decoders already
+       do at utterance boundaries.
+     - FinalizeDecoding() blocks until the background thread has scored and we
+       have decoded all input; you must call InputFinished() first.
+     - Use this class directly (not through a pointer or reference to
+       SingleUtteranceGmmDecoder), since AdvanceDecoding() and
+       FinalizeDecoding() are redefined non-virtually.
+
+   Note: we assume that all calls to the public interface of this class happen
+   from a single thread.
+*/
+class SingleUtteranceGmmDecoderPipelined: public SingleUtteranceGmmDecoder,
+                                          private OnlineLoglikeComputer {
+ public:
+  // Constructor.  In addition to the arguments of the SingleUtteranceGmmDecoder
+  // constructor, it takes the configuration of the likelihood pipeline; the
+  // background scoring thread is spawned here.
+  SingleUtteranceGmmDecoderPipelined(
+      const OnlineGmmDecodingConfig &config,
+      const ThreadedLoglikePipelineConfig &pipeline_config,
+      const OnlineGmmDecodingModels &models,
+      const OnlineFeaturePipeline &feature_prototype,
+      const fst::Fst<fst::StdArc> &fst,
+      const OnlineGmmAdaptationState &adaptation_state);
+
+  /// You call this to provide this class with more waveform to decode.  This
+  /// call is, for all practical purposes, non-blocking.
+  void AcceptWaveform(BaseFloat sampling_rate,
+                      const VectorBase<BaseFloat> &wave_part);
+
+  /// You call this to inform the class that no more waveform will be
+  /// provided; this allows the feature pipeline to flush out the last few
+  /// frames of features.  You must call this before FinalizeDecoding().
+  void InputFinished();
+
+  /// Advances the decoding over all frames whose likelihoods the background
+  /// thread has already computed, then returns without waiting for more.
+  /// Note: unlike SingleUtteranceGmmDecoder::AdvanceDecoding(), this does not
+  /// estimate fMLLR mid-utterance; see the comment above the class.
+  void AdvanceDecoding();
+
+  /// Finalizes the decoding: waits until all input has been scored and
+  /// decoded, then cleans up and prunes remaining tokens.  You must call
+  /// InputFinished() before calling this.  After this call the background
+  /// thread has exited, so it is safe to call the inherited EstimateFmllr(),
+  /// GetLattice() and GetAdaptationState() functions.
+  void FinalizeDecoding();
+
+  ~SingleUtteranceGmmDecoderPipelined();
+ private:
+  // The following two functions implement the OnlineLoglikeComputer
+  // interface; they are called by pipeline_, ComputeLoglikes() from the
+  // background thread.
+  virtual void ComputeLoglikes(int32 begin_frame, int32 max_frames,
+                               Matrix<BaseFloat> *loglikes,
+                               bool *no_more_frames);
+  virtual void Abort();
+
+  // Guards feature_pipeline_ (inherited) and input_finished_ below: the
+  // feature pipeline is written to by AcceptWaveform() and InputFinished() on
+  // the main thread and read by ComputeLoglikes() on the background thread.
+  // (abort_ is accessed without the lock, like abort_ in
+  // SingleUtteranceNnet2DecoderThreaded, since Abort() may be called from a
+  // context that already holds the mutex.)
+  Mutex feature_pipeline_mutex_;
+
+  // Signaled after each call to AcceptWaveform() and InputFinished(), and by
+  // Abort(), so that ComputeLoglikes() can sleep when it has no input to
+  // process.  There may be more signals than pieces of waveform; the
+  // background thread just re-checks the pipeline when woken.
+  Semaphore waveform_ready_;
+
+  bool input_finished_;
+  bool abort_;
+
+  // Caution: pipeline_ must be the last member of this class, because its
+  // constructor spawns the background thread, which immediately starts
+  // calling ComputeLoglikes() on this object; and its destructor joins that
+  // thread, which must happen before the rest of this object is destroyed.
+  ThreadedLoglikePipeline pipeline_;
+};
+
+
+/// @} End of "addtogroup onlinedecoding"
+
+}  // namespace kaldi
+
+#endif  // KALDI_ONLINE2_ONLINE_GMM_DECODING_PIPELINED_H_
@@ -20,6 +20,7 @@
 #include "online2/online-gmm-decoding.h"
 #include "lat/lattice-functions.h"
 #include "lat/determinize-lattice-pruned.h"
+#include "thread/kaldi-profiler.h"
 
 namespace kaldi {
 
@@ -45,6 +46,56 @@ void OnlineGmmAdaptationState::Write(std::ostream &out_stream, bool binary) cons
   WriteToken(out_stream, binary, "</ONLINEGMMADAPTATIONSTATE>");
 }
 
+bool OnlineGmmAdaptationStateStore::HasSpeaker(
+    const std::string &speaker) const {
+  return (states_.count(speaker) != 0);
+}
+
+void OnlineGmmAdaptationStateStore::GetState(
+    const std::string &speaker,
+    OnlineGmmAdaptationState *state) const {
+  std::map<std::string, OnlineGmmAdaptationState>::const_iterator iter =
+      states_.find(speaker);
+  if (iter != states_.end()) *state = iter->second;
+  else *state = OnlineGmmAdaptationState();
+}
+
+void OnlineGmmAdaptationStateStore::SetState(
+    const std::string &speaker,
+    const OnlineGmmAdaptationState &state) {
+  KALDI_ASSERT(!speaker.empty() &&
+               speaker.find_first_of(" \t\n\r") == std::string::npos);
+  states_[speaker] = state;
+}
+
+void OnlineGmmAdaptationStateStore::Write(std::ostream &out_stream,
+                                          bool binary) const {
+  WriteToken(out_stream, binary, "<ONLINEGMMADAPTATIONSTATESTORE>");
+  WriteBasicType(out_stream, binary, NumSpeakers());
+  if (!binary) out_stream << '\n';
+  std::map<std::string, OnlineGmmAdaptationState>::const_iterator iter;
+  for (iter = states_.begin(); iter != states_.end(); ++iter) {
+    WriteToken(out_stream, binary, iter->first);
+    iter->second.Write(out_stream, binary);
+  }
+  WriteToken(out_stream, binary, "</ONLINEGMMADAPTATIONSTATESTORE>");
+}
+
+void OnlineGmmAdaptationStateStore::Read(std::istream &in_stream,
+                                         bool binary) {
+  states_.clear();
+  ExpectToken(in_stream, binary, "<ONLINEGMMADAPTATIONSTATESTORE>");
+  int32 num_speakers;
+  ReadBasicType(in_stream, binary, &num_speakers);
+  KALDI_ASSERT(num_speakers >= 0);
+  for (int32 i = 0; i < num_speakers; i++) {
+    std::string speaker;
+    ReadToken(in_stream, binary, &speaker);
+    states_[speaker].Read(in_stream, binary);
+  }
+  ExpectToken(in_stream, binary, "</ONLINEGMMADAPTATIONSTATESTORE>");
+}
+
 SingleUtteranceGmmDecoder::SingleUtteranceGmmDecoder(
     const OnlineGmmDecodingConfig &config,
     const OnlineGmmDecodingModels &models,                            
@@ -55,6 +106,7 @@ SingleUtteranceGmmDecoder::SingleUtteranceGmmDecoder(
     feature_pipeline_(feature_prototype.New()),
     orig_adaptation_state_(adaptation_state),
     adaptation_state_(adaptation_state),
+    num_frames_in_spk_stats_(0),
     decoder_(fst, config.faster_decoder_opts) {
   if (!SplitStringToIntegers(config_.silence_phones, ":", false,
                              &silence_phones_))
@@ -67,6 +119,7 @@ SingleUtteranceGmmDecoder::SingleUtteranceGmmDecoder(
 
 // Advance the decoding as far as we can, and possibly estimate fMLLR.
 void SingleUtteranceGmmDecoder::AdvanceDecoding() {
+  KALDI_PROFILE_SCOPE("SingleUtteranceGmmDecoder::AdvanceDecoding");
 
   const AmDiagGmm &am_gmm = (HaveTransform() ? models_.GetModel() :
                              models_.GetOnlineAlignmentModel());
@@ -221,16 +274,25 @@ void SingleUtteranceGmmDecoder::EstimateFmllr(bool end_of_utterance) {
   GetGaussianPosteriors(end_of_utterance, &gpost);
   
   FmllrDiagGmmAccs &spk_stats = adaptation_state_.spk_stats;
-  
-  if (spk_stats.beta_ !=
-      orig_adaptation_state_.spk_stats.beta_) {
+
+  size_t first_frame_to_accumulate = 0;
+  if (config_.adaptation_policy_opts.adaptation_incremental) {
+    // Incremental mode: keep whatever stats we committed earlier during this
+    // utterance and accumulate only the newly decoded frames.  The earlier
+    // frames' posteriors were computed with a less refined transform, which
+    // costs a little accuracy, but we avoid re-accumulating the whole
+    // utterance each time we adapt.
+    first_frame_to_accumulate =
+        static_cast<size_t>(num_frames_in_spk_stats_);
+  } else if (spk_stats.beta_ !=
+             orig_adaptation_state_.spk_stats.beta_) {
     // This could happen if the user called EstimateFmllr() twice on the
     // same utterance... we don't want to count any stats twice so we
     // have to reset the stats to what they were before this utterance
     // (possibly empty).
     spk_stats = orig_adaptation_state_.spk_stats;
   }
-  
+
   int32 dim = feature_pipeline_->Dim();
   if (spk_stats.Dim() == 0)
     spk_stats.Init(dim);
@@ -252,8 +314,8 @@ void SingleUtteranceGmmDecoder::EstimateFmllr(bool end_of_utterance) {
   // transforms.
   const AmDiagGmm &am_gmm = models_.GetModel();
   
-  for (size_t i = 0; i < gpost.size(); i++) {
-    feature_pipeline_->GetFrame(i, &feat);    
+  for (size_t i = first_frame_to_accumulate; i < gpost.size(); i++) {
+    feature_pipeline_->GetFrame(i, &feat);
     for (size_t j = 0; j < gpost[i].size(); j++) {
       int32 pdf_id = gpost[i][j].first; // caution: this gpost has pdf-id
                                         // instead of transition-id, which is
@@ -263,7 +325,8 @@ void SingleUtteranceGmmDecoder::EstimateFmllr(bool end_of_utterance) {
                                          feat, posterior);
     }
   }
-  
+  num_frames_in_spk_stats_ = static_cast<int32>(gpost.size());
+
   const BasisFmllrEstimate &basis = models_.GetFmllrBasis();
   if (basis.Dim() == 0)
     KALDI_ERR << "In order to estimate fMLLR, you need to supply the "
@@ -354,45 +417,52 @@ OnlineGmmDecodingModels::OnlineGmmDecodingModels(
     tmodel_.Read(ki.Stream(), binary);
     model_.Read(ki.Stream(), binary);
   }
-  
-  if (!config.online_alimdl_rxfilename.empty()) {
-    bool binary;
-    Input ki(config.online_alimdl_rxfilename, &binary);
-    TransitionModel tmodel;
-    tmodel.Read(ki.Stream(), binary);
-    if (!tmodel.Compatible(tmodel_))
-      KALDI_ERR << "Incompatible models given to the --model and "
-                << "--online-alignment-model options";
-    online_alignment_model_.Read(ki.Stream(), binary);
-  }
 
-  if (!config.rescore_model_rxfilename.empty()) {
-    bool binary;
-    Input ki(config.rescore_model_rxfilename, &binary);
-    TransitionModel tmodel;
-    tmodel.Read(ki.Stream(), binary);
-    if (!tmodel.Compatible(tmodel_))
-      KALDI_ERR << "Incompatible models given to the --model and "
-                << "--final-model options";
-    rescore_model_.Read(ki.Stream(), binary);
-  }
+  // The remaining models are only read on first use; see the comment in the
+  // header.  The compatibility checks that used to happen here now happen
+  // when the models are materialized (see the Check* functions below).
+  online_alignment_model_.SetFilename(config.online_alimdl_rxfilename);
+  online_alignment_model_.SetPostLoadFunction(
+      &OnlineGmmDecodingModels::CheckOnlineAlignmentModel,
+      static_cast<void*>(this));
+  // The online-alignment model, if supplied, is needed as soon as audio
+  // arrives, so read it on a background thread rather than making the first
+  // chunk of audio wait for it.
+  online_alignment_model_.StartBackgroundLoad();
+
+  rescore_model_.SetFilename(config.rescore_model_rxfilename);
+  rescore_model_.SetPostLoadFunction(
+      &OnlineGmmDecodingModels::CheckRescoreModel,
+      static_cast<void*>(this));
+
+  fmllr_basis_.SetFilename(config.fmllr_basis_rxfilename);
+}
 
-  if (!config.fmllr_basis_rxfilename.empty()) {
-    // We could just as easily use ReadKaldiObject() here.
-    bool binary;
-    Input ki(config.fmllr_basis_rxfilename, &binary);
-    fmllr_basis_.Read(ki.Stream(), binary);
-  }
+void OnlineGmmDecodingModels::CheckOnlineAlignmentModel(
+    OnlineGmmDecodingModelFile *file, void *context) {
+  OnlineGmmDecodingModels *models =
+      static_cast<OnlineGmmDecodingModels*>(context);
+  if (!file->tmodel.Compatible(models->tmodel_))
+    KALDI_ERR << "Incompatible models given to the --model and "
+              << "--online-alignment-model options";
 }
 
+void OnlineGmmDecodingModels::CheckRescoreModel(
+    OnlineGmmDecodingModelFile *file, void *context) {
+  OnlineGmmDecodingModels *models =
+      static_cast<OnlineGmmDecodingModels*>(context);
+  if (!file->tmodel.Compatible(models->tmodel_))
+    KALDI_ERR << "Incompatible models given to the --model and "
+              << "--final-model options";
+}
 
 const TransitionModel &OnlineGmmDecodingModels::GetTransitionModel() const {
   return tmodel_;
 }
 
 const AmDiagGmm &OnlineGmmDecodingModels::GetOnlineAlignmentModel() const {
-  if (online_alignment_model_.NumPdfs() != 0)
-    return online_alignment_model_;
+  if (!online_alignment_model_.IsEmpty())
+    return online_alignment_model_.Get().am_gmm;
   else
     return model_;
 }
@@ -402,14 +472,17 @@ const AmDiagGmm &OnlineGmmDecodingModels::GetModel() const {
 }
 
 const AmDiagGmm &OnlineGmmDecodingModels::GetFinalModel() const {
-  if (rescore_model_.NumPdfs() != 0)
-    return rescore_model_;
+  if (!rescore_model_.IsEmpty())
+    return rescore_model_.Get().am_gmm;
   else
     return model_;
 }
 
 const BasisFmllrEstimate &OnlineGmmDecodingModels::GetFmllrBasis() const {
-  return fmllr_basis_;  
+  if (!fmllr_basis_.IsEmpty())
+    return fmllr_basis_.Get();
+  else
+    return empty_fmllr_basis_;
 }
 
 
@@ -21,12 +21,14 @@
 #ifndef KALDI_ONLINE2_ONLINE_GMM_DECODING_H_
 #define KALDI_ONLINE2_ONLINE_GMM_DECODING_H_
 
+#include <map>
 #include <string>
 #include <vector>
 #include <deque>
 
 #include "matrix/matrix-lib.h"
 #include "util/common-utils.h"
+#include "util/lazy-read-handle.h"
 #include "base/kaldi-error.h"
 #include "transform/basis-fmllr-diag-gmm.h"
 #include "transform/fmllr-diag-gmm.h"
@@ -58,11 +60,13 @@ struct OnlineGmmDecodingAdaptationPolicyConfig {
   BaseFloat adaptation_first_utt_ratio;
   BaseFloat adaptation_delay;
   BaseFloat adaptation_ratio;
+  bool adaptation_incremental;
   OnlineGmmDecodingAdaptationPolicyConfig():
       adaptation_first_utt_delay(2.0),
       adaptation_first_utt_ratio(1.5),
       adaptation_delay(5.0),
-      adaptation_ratio(2.0) { }
+      adaptation_ratio(2.0),
+      adaptation_incremental(false) { }
 
   void Register(OptionsItf *opts) {
     opts->Register("adaptation-first-utt-delay", &adaptation_first_utt_delay,
@@ -77,6 +81,11 @@ struct OnlineGmmDecodingAdaptationPolicyConfig {
     opts->Register("adaptation-ratio", &adaptation_first_utt_ratio,
                    "Ratio that controls frequency of fMLLR adaptation for "
                    "not-first utterances of each speaker");
+    opts->Register("adaptation-incremental", &adaptation_incremental,
+                   "If true, each fMLLR re-estimation keeps the stats already "
+                   "accumulated this utterance and only adds newly decoded "
+                   "frames, instead of re-accumulating the whole utterance "
+                   "(cheaper, at a small cost in accuracy).");
   }
   
   /// Check that configuration values make sense.
@@ -155,6 +164,18 @@ struct OnlineGmmDecodingConfig {
 };
 
 
+/// The files given to the --online-alignment-model and --rescore-model
+/// options contain a TransitionModel followed by an AmDiagGmm; this struct
+/// lets OnlineGmmDecodingModels read them lazily via LazyReadHandle.
+struct OnlineGmmDecodingModelFile {
+  TransitionModel tmodel;
+  AmDiagGmm am_gmm;
+  void Read(std::istream &is, bool binary) {
+    tmodel.Read(is, binary);
+    am_gmm.Read(is, binary);
+  }
+};
+
 /**
    This class is used to read, store and give access to the models used for 3
    phases of decoding (first-pass with online-CMN features; the ML models used
@@ -162,7 +183,13 @@ struct OnlineGmmDecodingConfig {
    takes care of the logic whereby if, say, the last model isn't given we
    default to the second model, and so on, and it interpretes the filenames
    from the config object.  It is passed as a const reference to other
-   objects in this header. */
+   objects in this header.
+
+   The transition model and the main model are read at construction time
+   (nothing can be done without them), but the optional models are read
+   lazily on first use, so e.g. a session that is never rescored never
+   pays for reading the rescoring model; this reduces the delay between
+   process start and being able to accept audio. */
 class OnlineGmmDecodingModels {
  public:
   OnlineGmmDecodingModels(const OnlineGmmDecodingConfig &config);
@@ -176,23 +203,34 @@ class OnlineGmmDecodingModels {
   const AmDiagGmm &GetFinalModel() const;
 
   const BasisFmllrEstimate &GetFmllrBasis() const;
-  
+
  private:
+  // Called under the handles' locks when the lazily read models are
+  // materialized; they check compatibility with tmodel_ ("context" is the
+  // OnlineGmmDecodingModels object).
+  static void CheckOnlineAlignmentModel(OnlineGmmDecodingModelFile *file,
+                                        void *context);
+  static void CheckRescoreModel(OnlineGmmDecodingModelFile *file,
+                                void *context);
+
   // The transition-model is only needed for its integer ids, and these need to
   // be identical for all 3 models, so we only store one (it doesn't matter
   // which one).
-  TransitionModel tmodel_; 
-  // The model trained with online-CMVN features
+  TransitionModel tmodel_;
+  // The model trained with online-CMVN features, read on first use
   // (if supplied, otherwise use model_)
-  AmDiagGmm online_alignment_model_;
+  LazyReadHandle<OnlineGmmDecodingModelFile> online_alignment_model_;
   // The ML-trained model used to get transforms (required)
   AmDiagGmm model_;
-  // The discriminatively trained model
+  // The discriminatively trained model, read on first use
   // (if supplied, otherwise use model_)
-  AmDiagGmm rescore_model_;
+  LazyReadHandle<OnlineGmmDecodingModelFile> rescore_model_;
   // The following object contains the basis elements for
-  // "Basis fMLLR".
-  BasisFmllrEstimate fmllr_basis_;
+  // "Basis fMLLR", read on first use.
+  LazyReadHandle<BasisFmllrEstimate> fmllr_basis_;
+  // What GetFmllrBasis() returns when --fmllr-basis was not supplied
+  // (callers detect this as Dim() == 0).
+  BasisFmllrEstimate empty_fmllr_basis_;
 };
 
 
@@ -208,6 +246,38 @@ struct OnlineGmmAdaptationState {
 
 };
 
+/**
+   This class stores per-speaker adaptation state keyed by speaker-id, so that
+   a returning speaker can be warm-started with the CMVN state, fMLLR stats and
+   transform from their previous sessions, instead of re-estimating everything
+   from scratch.  It is serializable so a server can persist it across
+   restarts.  The speaker-ids must be nonempty and contain no whitespace (they
+   are written with WriteToken).
+*/
+class OnlineGmmAdaptationStateStore {
+ public:
+  OnlineGmmAdaptationStateStore() { }
+
+  bool HasSpeaker(const std::string &speaker) const;
+
+  /// Sets *state to the stored state for this speaker, or to a
+  /// default-constructed state if we have nothing stored for this speaker.
+  void GetState(const std::string &speaker,
+                OnlineGmmAdaptationState *state) const;
+
+  /// Stores the state for this speaker, overwriting any previous value.
+  void SetState(const std::string &speaker,
+                const OnlineGmmAdaptationState &state);
+
+  int32 NumSpeakers() const { return static_cast<int32>(states_.size()); }
+
+  void Write(std::ostream &out_stream, bool binary) const;
+  void Read(std::istream &in_stream, bool binary);
+
+ private:
+  std::map<std::string, OnlineGmmAdaptationState> states_;
+};
+
 /**
    You will instantiate this class when you want to decode a single
    utterance using the online-decoding setup.  This is an alternative
@@ -281,7 +351,10 @@ class SingleUtteranceGmmDecoder {
   bool EndpointDetected(const OnlineEndpointConfig &config);
 
   ~SingleUtteranceGmmDecoder();
- private:
+ protected:
+  // The members are protected, not private, so that class
+  // SingleUtteranceGmmDecoderPipelined (see online-gmm-decoding-pipelined.h)
+  // can reuse this class's lattice-getting and adaptation code.
   bool GetGaussianPosteriors(bool end_of_utterance, GaussPost *gpost);
 
   /// Returns true if doing a lattice rescoring pass would have any point, i.e.
@@ -301,6 +374,10 @@ class SingleUtteranceGmmDecoder {
   // orig_adaptation_state, the function GetAdaptationState() gets the CMVN
   // state.
   OnlineGmmAdaptationState adaptation_state_;
+  // The number of frames of this utterance whose stats have been committed to
+  // adaptation_state_.spk_stats; only used if
+  // config_.adaptation_policy_opts.adaptation_incremental is true.
+  int32 num_frames_in_spk_stats_;
   LatticeFasterOnlineDecoder decoder_;
 };
 
@@ -41,6 +41,12 @@ void OnlineIvectorExtractionInfo::Init(
                << "--use-most-recent-ivector=true";
     use_most_recent_ivector = true;
   }
+  async_update = config.async_update;
+  if (async_update && !use_most_recent_ivector) {
+    KALDI_WARN << "--async-update=true implies "
+               << "--use-most-recent-ivector=true";
+    use_most_recent_ivector = true;
+  }
   max_remembered_frames = config.max_remembered_frames;
   
   std::string note = "(note: this may be needed "
@@ -89,7 +95,7 @@ void OnlineIvectorExtractionInfo::Check() const {
 OnlineIvectorExtractionInfo::OnlineIvectorExtractionInfo():
     ivector_period(0), num_gselect(0), min_post(0.0), posterior_scale(0.0),
     use_most_recent_ivector(true), greedy_ivector_extractor(false),
-    max_remembered_frames(0) { }
+    async_update(false), max_remembered_frames(0) { }
 
 OnlineIvectorExtractorAdaptationState::OnlineIvectorExtractorAdaptationState(
     const OnlineIvectorExtractorAdaptationState &other):
@@ -154,6 +160,22 @@ int32 OnlineIvectorFeature::NumFramesReady() const {
 
 void OnlineIvectorFeature::UpdateFrameWeights(
     const std::vector<std::pair<int32, BaseFloat> > &delta_weights) {
+  if (info_.async_update) {
+    // In async mode, delta_weights_ is owned by the update thread; we just
+    // queue the new weights for it to consume (see UpdateThreadFunc()).
+    int32 num_frames_ready = NumFramesReady();
+    for (size_t i = 0; i < delta_weights.size(); i++) {
+      int32 frame = delta_weights[i].first;
+      KALDI_ASSERT(frame >= 0 && frame < num_frames_ready);
+    }
+    work_mutex_.Lock();
+    pending_delta_weights_.insert(pending_delta_weights_.end(),
+                                  delta_weights.begin(), delta_weights.end());
+    delta_weights_provided_ = true;
+    work_mutex_.Unlock();
+    work_available_.Signal();
+    return;
+  }
   // add the elements to delta_weights_, which is a priority queue.  The top
   // element of the priority queue is the lowest numbered frame (we ensured this
   // by making the comparison object std::greater instead of std::less).  Adding
@@ -171,13 +193,36 @@ void OnlineIvectorFeature::UpdateFrameWeights(
   delta_weights_provided_ = true;
 }
 
+void OnlineIvectorFeature::GetStatsFeatures(
+    int32 t, VectorBase<BaseFloat> *feat_normalized,
+    VectorBase<BaseFloat> *feat) {
+  if (info_.async_update) {
+    // The feature pipelines are not thread-safe, so the update thread reads
+    // from the cache that the main thread filled in via
+    // CacheFramesForUpdateThread().  The lock only protects the vectors
+    // themselves (which push_back may reallocate); the pointed-to data is
+    // never modified or freed while the update thread runs.
+    work_mutex_.Lock();
+    KALDI_ASSERT(static_cast<size_t>(t) < cached_feats_.size());
+    const Vector<BaseFloat> *cached = cached_feats_[t],
+        *cached_normalized = cached_feats_normalized_[t];
+    work_mutex_.Unlock();
+    feat_normalized->CopyFromVec(*cached_normalized);
+    feat->CopyFromVec(*cached);
+  } else {
+    lda_normalized_->GetFrame(t, feat_normalized);
+    lda_->GetFrame(t, feat);  // get feature without CMN.
+  }
+}
+
 void OnlineIvectorFeature::UpdateStatsForFrame(int32 t,
                                                BaseFloat weight) {
-  int32 feat_dim = lda_normalized_->Dim();      
-  Vector<BaseFloat> feat(feat_dim),  // features given to iVector extractor
+  int32 feat_dim = lda_normalized_->Dim();
+  Vector<BaseFloat> feat_normalized(feat_dim),
+      feat(feat_dim),  // features given to iVector extractor
       log_likes(info_.diag_ubm.NumGauss());
-  lda_normalized_->GetFrame(t, &feat);
-  info_.diag_ubm.LogLikelihoods(feat, &log_likes);
+  GetStatsFeatures(t, &feat_normalized, &feat);
+  info_.diag_ubm.LogLikelihoods(feat_normalized, &log_likes);
   // "posterior" stores the pruned posteriors for Gaussians in the UBM.
   std::vector<std::pair<int32, BaseFloat> > posterior;
   tot_ubm_loglike_ += weight *
@@ -185,12 +230,15 @@ void OnlineIvectorFeature::UpdateStatsForFrame(int32 t,
                              info_.min_post, &posterior);
   for (size_t i = 0; i < posterior.size(); i++)
     posterior[i].second *= info_.posterior_scale * weight;
-  lda_->GetFrame(t, &feat); // get feature without CMN.
   ivector_stats_.AccStats(info_.extractor, feat, posterior);
 }
 
 void OnlineIvectorFeature::UpdateStatsUntilFrame(int32 frame) {
-  KALDI_ASSERT(frame >= 0 && frame < this->NumFramesReady() &&
+  // In async mode this runs on the update thread, which must not touch the
+  // feature pipelines (so no NumFramesReady() call); the main thread already
+  // checked that "frame" was ready when it cached the features.
+  KALDI_ASSERT(frame >= 0 &&
+               (info_.async_update || frame < this->NumFramesReady()) &&
                !delta_weights_provided_);
   updated_with_no_delta_weights_ = true;
   
@@ -213,7 +261,8 @@ void OnlineIvectorFeature::UpdateStatsUntilFrame(int32 frame) {
 }
 
 void OnlineIvectorFeature::UpdateStatsUntilFrameWeighted(int32 frame) {
-  KALDI_ASSERT(frame >= 0 && frame < this->NumFramesReady() &&
+  KALDI_ASSERT(frame >= 0 &&
+               (info_.async_update || frame < this->NumFramesReady()) &&
                delta_weights_provided_ &&
                ! updated_with_no_delta_weights_ &&
                frame <= most_recent_frame_with_weight_);
@@ -256,6 +305,21 @@ void OnlineIvectorFeature::UpdateStatsUntilFrameWeighted(int32 frame) {
 
 void OnlineIvectorFeature::GetFrame(int32 frame,
                                     VectorBase<BaseFloat> *feat) {
+  if (info_.async_update) {
+    KALDI_ASSERT(feat->Dim() == this->Dim());
+    // Hand any newly available frames to the update thread and serve the most
+    // recently estimated iVector; this never waits on the estimation.  (Early
+    // in the utterance we may serve the default iVector, until the update
+    // thread has caught up.)
+    CacheFramesForUpdateThread(frame);
+    ivector_buffer_mutex_.Lock();
+    feat->CopyFromVec(ivector_buffers_[cur_ivector_buffer_]);
+    ivector_buffer_mutex_.Unlock();
+    // Subtract the prior-mean from the first dimension of the output feature
+    // so it's approximately zero-mean.
+    (*feat)(0) -= info_.extractor.PriorOffset();
+    return;
+  }
   int32 frame_to_update_until = (info_.greedy_ivector_extractor ?
                                  lda_->NumFramesReady() - 1 : frame);
   if (!delta_weights_provided_)  // No silence weighting.
@@ -304,7 +368,129 @@ void OnlineIvectorFeature::PrintDiagnostics() const {
   }
 }
 
+void OnlineIvectorFeature::CacheFramesForUpdateThread(int32 frame) {
+  int32 frame_to_update_until = (info_.greedy_ivector_extractor ?
+                                 lda_->NumFramesReady() - 1 : frame);
+  KALDI_ASSERT(frame_to_update_until < this->NumFramesReady());
+  int32 feat_dim = lda_->Dim();
+  // Copy the newly ready frames of the two pipelines outside the lock; this
+  // is cheap (splicing plus a matrix-vector multiply), unlike the stats
+  // accumulation that the update thread does with them.
+  std::vector<Vector<BaseFloat>*> new_feats, new_feats_normalized;
+  for (; num_frames_cached_ <= frame_to_update_until; num_frames_cached_++) {
+    int32 t = num_frames_cached_;
+    Vector<BaseFloat> *feat, *feat_normalized;
+    if (recycled_feats_.size() >= 2) {  // re-use vectors freed by Reset().
+      feat = recycled_feats_.back();
+      recycled_feats_.pop_back();
+      feat_normalized = recycled_feats_.back();
+      recycled_feats_.pop_back();
+      feat->Resize(feat_dim, kUndefined);
+      feat_normalized->Resize(feat_dim, kUndefined);
+    } else {
+      feat = new Vector<BaseFloat>(feat_dim);
+      feat_normalized = new Vector<BaseFloat>(feat_dim);
+    }
+    lda_->GetFrame(t, feat);
+    lda_normalized_->GetFrame(t, feat_normalized);
+    new_feats.push_back(feat);
+    new_feats_normalized.push_back(feat_normalized);
+  }
+  work_mutex_.Lock();
+  cached_feats_.insert(cached_feats_.end(),
+                       new_feats.begin(), new_feats.end());
+  cached_feats_normalized_.insert(cached_feats_normalized_.end(),
+                                  new_feats_normalized.begin(),
+                                  new_feats_normalized.end());
+  bool new_work = (frame_to_update_until > target_frame_);
+  if (new_work)
+    target_frame_ = frame_to_update_until;
+  work_mutex_.Unlock();
+  if (new_work)
+    work_available_.Signal();
+}
+
+// static
+void* OnlineIvectorFeature::RunUpdateThread(void *ptr) {
+  OnlineIvectorFeature *feature = static_cast<OnlineIvectorFeature*>(ptr);
+  feature->UpdateThreadFunc();
+  return NULL;
+}
+
+void OnlineIvectorFeature::UpdateThreadFunc() {
+  while (true) {
+    work_available_.Wait();
+    work_mutex_.Lock();
+    bool done = done_, sync_requested = sync_requested_,
+        weighted = delta_weights_provided_;
+    sync_requested_ = false;
+    int32 target_frame = target_frame_;
+    for (size_t i = 0; i < pending_delta_weights_.size(); i++) {
+      const std::pair<int32, BaseFloat> &p = pending_delta_weights_[i];
+      delta_weights_.push(p);
+      if (p.first > most_recent_frame_with_weight_)
+        most_recent_frame_with_weight_ = p.first;
+    }
+    pending_delta_weights_.clear();
+    work_mutex_.Unlock();
+
+    // In the weighted case, don't go past the most recent frame that has a
+    // weight (the weights for later frames haven't arrived yet; a later
+    // wakeup will deal with them).
+    if (weighted && target_frame > most_recent_frame_with_weight_)
+      target_frame = most_recent_frame_with_weight_;
+    if (target_frame >= num_frames_stats_) {
+      if (!weighted)
+        UpdateStatsUntilFrame(target_frame);
+      else
+        UpdateStatsUntilFrameWeighted(target_frame);
+      PublishIvector();
+    }
+    if (sync_requested)
+      caught_up_.Signal();
+    if (done)
+      return;
+  }
+}
+
+void OnlineIvectorFeature::PublishIvector() {
+  // This runs on the update thread, which is the only thread that modifies
+  // cur_ivector_buffer_, so we may read it without the lock; the expensive
+  // part (the copy into the back buffer) is done without the lock held.
+  int32 back_buffer = 1 - cur_ivector_buffer_;
+  ivector_buffers_[back_buffer] = current_ivector_;
+  ivector_buffer_mutex_.Lock();
+  cur_ivector_buffer_ = back_buffer;
+  ivector_buffer_mutex_.Unlock();
+}
+
+void OnlineIvectorFeature::SynchronizeUpdateThread() const {
+  if (!info_.async_update)
+    return;
+  work_mutex_.Lock();
+  sync_requested_ = true;
+  work_mutex_.Unlock();
+  work_available_.Signal();
+  caught_up_.Wait();
+}
+
 OnlineIvectorFeature::~OnlineIvectorFeature() {
+  if (info_.async_update) {
+    // Tell the update thread to finish any outstanding work and exit, and
+    // join it, so that the diagnostics below reflect all the frames.
+    work_mutex_.Lock();
+    done_ = true;
+    work_mutex_.Unlock();
+    work_available_.Signal();
+    if (pthread_join(update_thread_, NULL))
+      KALDI_ERR << "Error rejoining thread";  // this should not happen.
+    for (size_t i = 0; i < cached_feats_.size(); i++)
+      delete cached_feats_[i];
+    for (size_t i = 0; i < cached_feats_normalized_.size(); i++)
+      delete cached_feats_normalized_[i];
+    for (size_t i = 0; i < recycled_feats_.size(); i++)
+      delete recycled_feats_[i];
+  }
   PrintDiagnostics();
   // Delete objects owned here.
   delete lda_normalized_;
@@ -319,6 +505,9 @@ OnlineIvectorFeature::~OnlineIvectorFeature() {
 
 void OnlineIvectorFeature::GetAdaptationState(
     OnlineIvectorExtractorAdaptationState *adaptation_state) const {
+  // In async mode, wait for the update thread to finish the work queued so
+  // far, so the returned stats include all the frames we've seen.
+  SynchronizeUpdateThread();
   // Note: the following call will work even if cmvn_->NumFramesReady() == 0; in
   // that case it will return the unmodified adaptation state that cmvn_ was
   // initialized with.
@@ -339,7 +528,9 @@ OnlineIvectorFeature::OnlineIvectorFeature(
                    info_.max_count),
     num_frames_stats_(0), delta_weights_provided_(false),
     updated_with_no_delta_weights_(false),
-    most_recent_frame_with_weight_(-1), tot_ubm_loglike_(0.0) {
+    most_recent_frame_with_weight_(-1), tot_ubm_loglike_(0.0),
+    num_frames_cached_(0), target_frame_(-1), sync_requested_(false),
+    done_(false), cur_ivector_buffer_(0) {
   info.Check();
   KALDI_ASSERT(base_feature != NULL);
   splice_ = new OnlineSpliceFrames(info_.splice_opts, base_);
@@ -355,7 +546,22 @@ OnlineIvectorFeature::OnlineIvectorFeature(
 
   // Set the iVector to its default value, [ prior_offset, 0, 0, ... ].
   current_ivector_.Resize(info_.extractor.IvectorDim());
-  current_ivector_(0) = info_.extractor.PriorOffset(); 
+  current_ivector_(0) = info_.extractor.PriorOffset();
+
+  if (info_.async_update) {
+    ivector_buffers_[0] = current_ivector_;
+    ivector_buffers_[1] = current_ivector_;
+    pthread_attr_t pthread_attr;
+    pthread_attr_init(&pthread_attr);
+    int32 ret;
+    if ((ret = pthread_create(&update_thread_,
+                              &pthread_attr, RunUpdateThread,
+                              (void*)this)) != 0) {
+      const char *c = strerror(ret);
+      if (c == NULL) { c = "[NULL]"; }
+      KALDI_ERR << "Error creating thread, errno was: " << c;
+    }
+  }
 }
 
 void OnlineIvectorFeature::SetAdaptationState(
@@ -368,12 +574,57 @@ void OnlineIvectorFeature::SetAdaptationState(
   cmvn_->SetState(adaptation_state.cmvn_state);
 }
 
+void OnlineIvectorFeature::Reset() {
+  if (info_.async_update) {
+    // After this the update thread is parked waiting for work, with nothing
+    // queued, so it's safe to modify the state it shares with us.
+    SynchronizeUpdateThread();
+    work_mutex_.Lock();
+    recycled_feats_.insert(recycled_feats_.end(),
+                           cached_feats_.begin(), cached_feats_.end());
+    cached_feats_.clear();
+    recycled_feats_.insert(recycled_feats_.end(),
+                           cached_feats_normalized_.begin(),
+                           cached_feats_normalized_.end());
+    cached_feats_normalized_.clear();
+    num_frames_cached_ = 0;
+    target_frame_ = -1;
+    pending_delta_weights_.clear();
+    work_mutex_.Unlock();
+  }
+  // Scaling the stats by zero discards what we accumulated but keeps the
+  // prior term, which is exactly the state the constructor sets up.
+  ivector_stats_.Scale(0.0);
+  num_frames_stats_ = 0;
+  while (!delta_weights_.empty())
+    delta_weights_.pop();
+  current_frame_weight_debug_.clear();
+  delta_weights_provided_ = false;
+  updated_with_no_delta_weights_ = false;
+  most_recent_frame_with_weight_ = -1;
+  tot_ubm_loglike_ = 0.0;
+  current_ivector_.SetZero();
+  current_ivector_(0) = info_.extractor.PriorOffset();
+  for (size_t i = 0; i < ivectors_history_.size(); i++)
+    delete ivectors_history_[i];
+  ivectors_history_.clear();
+  if (info_.async_update) {
+    ivector_buffers_[0] = current_ivector_;
+    ivector_buffers_[1] = current_ivector_;
+  }
+  // As in the constructor, the CMVN state after this knows nothing about the
+  // speaker; SetAdaptationState() can supply it.
+  cmvn_->Reset(OnlineCmvnState(info_.global_cmvn_stats));
+}
+
 BaseFloat OnlineIvectorFeature::UbmLogLikePerFrame() const {
+  SynchronizeUpdateThread();  // no-op except in async mode.
   if (NumFrames() == 0) return 0;
   else return tot_ubm_loglike_ / NumFrames();
 }
 
 BaseFloat OnlineIvectorFeature::ObjfImprPerFrame() const {
+  SynchronizeUpdateThread();  // no-op except in async mode.
   return ivector_stats_.ObjfChange(current_ivector_);
 }
 
@@ -463,9 +714,9 @@ int32 OnlineSilenceWeighting::GetBeginFrame() {
   // t_lower will be the first index in the run of equal transition-ids.
   for (t_lower = t_last_untouched;
        t_lower > lower_search_bound &&
-           frame_info_[t_lower - 1].transition_id == transition_id; t_lower++);
+           frame_info_[t_lower - 1].transition_id == transition_id; t_lower--);
 
-  // t_lower will be the last index in the run of equal transition-ids.
+  // t_upper will be the last index in the run of equal transition-ids.
   for (t_upper = t_last_untouched;
        t_upper < upper_search_bound &&
            frame_info_[t_upper + 1].transition_id == transition_id; t_upper++);
@@ -577,7 +828,12 @@ void OnlineSilenceWeighting::GetDeltaWeights(
     if (weight_diff != 0.0 || offset + 1 == frames_out)
       delta_weights->push_back(std::make_pair(frame, weight_diff));
   }
-  
+  // Record that all frames up to here now have correct weights output, so the
+  // next call only revisits frames that ComputeCurrentTraceback() has since
+  // touched (plus whatever GetBeginFrame() adds for max-state-duration).
+  // Without this, every call would re-walk from frame zero, which is
+  // quadratic over the utterance.
+  num_frames_output_and_correct_ = frame_info_.size();
 }
 
 }  // namespace kaldi
@@ -33,6 +33,8 @@
 #include "feat/online-feature.h"
 #include "ivector/ivector-extractor.h"
 #include "decoder/lattice-faster-online-decoder.h"
+#include "thread/kaldi-mutex.h"
+#include "thread/kaldi-semaphore.h"
 
 namespace kaldi {
 /// @addtogroup  onlinefeat OnlineFeatureExtraction
@@ -90,6 +92,13 @@ struct OnlineIvectorExtractionConfig {
   // If true, always read ahead to NumFramesReady() when getting iVector stats.
   bool greedy_ivector_extractor;
 
+  // If true, the stat accumulation and iVector estimation run on a background
+  // thread, ahead of the frames the decoder asks for, and GetFrame() just
+  // copies the most recently estimated iVector; this removes the estimation
+  // cost (and its latency jitter) from the decoder's request path.  Implies
+  // use_most_recent_ivector == true.
+  bool async_update;
+
   // max_remembered_frames is the largest number of frames it will remember
   // between utterances of the same speaker; this affects the output of
   // GetAdaptationState(), and has the effect of limiting the number of frames
@@ -104,6 +113,7 @@ struct OnlineIvectorExtractionConfig {
                                    max_count(0.0), num_cg_iters(15),
                                    use_most_recent_ivector(true),
                                    greedy_ivector_extractor(false),
+                                   async_update(false),
                                    max_remembered_frames(1000) { }
   
   void Register(OptionsItf *opts) {
@@ -145,6 +155,11 @@ struct OnlineIvectorExtractionConfig {
     opts->Register("greedy-ivector-extractor", &greedy_ivector_extractor, "If "
                    "true, 'read ahead' as many frames as we currently have available "
                    "when extracting the iVector.  May improve iVector quality.");
+    opts->Register("async-update", &async_update, "If true, accumulate the "
+                   "iVector stats and estimate the iVector on a background "
+                   "thread, so that getting the iVector for a frame never "
+                   "waits on estimation (the most recently estimated iVector "
+                   "is returned).  Implies --use-most-recent-ivector=true.");
     opts->Register("max-remembered-frames", &max_remembered_frames, "The maximum "
                    "number of frames of adaptation history that we carry through "
                    "to later utterances of the same speaker (having a finite "
@@ -178,6 +193,7 @@ struct OnlineIvectorExtractionInfo {
   int32 num_cg_iters;
   bool use_most_recent_ivector;
   bool greedy_ivector_extractor;
+  bool async_update;
   BaseFloat max_remembered_frames;
 
   OnlineIvectorExtractionInfo(const OnlineIvectorExtractionConfig &config);
@@ -308,12 +324,60 @@ class OnlineIvectorFeature: public OnlineFeatureInterface {
   // lifetime of this object.
   void UpdateFrameWeights(
       const std::vector<std::pair<int32, BaseFloat> > &delta_weights);
-  
+
+  // Discards the state of this utterance and returns the object to the state
+  // it had just after construction, so it can be re-used for the next
+  // utterance of a session (in async-update mode this first waits for the
+  // update thread to drain any queued work).  As after construction, the
+  // CMVN state knows nothing about the speaker, so you would normally call
+  // SetAdaptationState() after this.  The cached feature vectors and stats
+  // are kept allocated and recycled for the next utterance.
+  void Reset();
+
  private:
   // this function adds "weight" to the stats for frame "frame".
   void UpdateStatsForFrame(int32 frame,
                            BaseFloat weight);
 
+  // Called from UpdateStatsForFrame(); outputs the frame "frame" of the two
+  // feature pipelines: the CMVN-normalized one (used to get posteriors) and
+  // the unnormalized one (used to accumulate the linear stats).  In async
+  // mode it reads from cached_feats_ etc. (filled in by the main thread),
+  // since the underlying feature pipelines are not thread-safe.
+  void GetStatsFeatures(int32 frame,
+                        VectorBase<BaseFloat> *feat_normalized,
+                        VectorBase<BaseFloat> *feat);
+
+  // === The remaining private functions are used only in async-update mode
+  // (info_.async_update == true). ===
+
+  // Entry point of the background update thread; "ptr" is "this".
+  static void* RunUpdateThread(void *ptr);
+
+  // The loop run by the background update thread: waits for work
+  // (new cached frames, new delta-weights, a synchronization request or
+  // shutdown), accumulates stats up to the requested frame, re-estimates the
+  // iVector and publishes it.
+  void UpdateThreadFunc();
+
+  // Called by the main thread from GetFrame(): copies any newly available
+  // frames of the two feature pipelines into cached_feats_ /
+  // cached_feats_normalized_ (this is cheap; it's just splicing and a matrix
+  // multiply that has already been computed), updates target_frame_ and wakes
+  // the update thread.
+  void CacheFramesForUpdateThread(int32 frame);
+
+  // Called by the update thread after re-estimating the iVector: copies
+  // current_ivector_ into the back buffer of ivector_buffers_ and flips
+  // cur_ivector_buffer_ (the only operation done while holding
+  // ivector_buffer_mutex_, so readers are never blocked for long).
+  void PublishIvector();
+
+  // Blocks until the update thread has processed all work queued so far; used
+  // before reading the stats from the main thread, e.g. in
+  // GetAdaptationState() and the diagnostics functions.
+  void SynchronizeUpdateThread() const;
+
   // This is the original UpdateStatsUntilFrame that is called when there is
   // no data-weighting involved.
   void UpdateStatsUntilFrame(int32 frame);
@@ -384,7 +448,77 @@ class OnlineIvectorFeature: public OnlineFeatureInterface {
   /// ivectors_history_[i] contains the iVector we estimated on
   /// frame t = i * info_.ivector_period.
   std::vector<Vector<BaseFloat>* > ivectors_history_;
- 
+
+  // === The following members are used only in async-update mode
+  // (info_.async_update == true). ===
+
+  /// The background thread that accumulates stats and re-estimates the
+  /// iVector; valid only if info_.async_update == true.
+  pthread_t update_thread_;
+
+  /// work_mutex_ guards cached_feats_, cached_feats_normalized_,
+  /// target_frame_, pending_delta_weights_, sync_requested_ and done_.
+  /// It's mutable because const functions like GetAdaptationState() need to
+  /// synchronize with the update thread.
+  mutable Mutex work_mutex_;
+
+  /// The update thread waits on this; the main thread signals it whenever
+  /// there is new work (new frames, new weights, a synchronization request,
+  /// or shutdown).
+  mutable Semaphore work_available_;
+
+  /// Signaled by the update thread when it has caught up with all queued
+  /// work after sync_requested_ was set; SynchronizeUpdateThread() waits
+  /// on it.
+  mutable Semaphore caught_up_;
+
+  /// Copies of the frames of the two feature pipelines, made by the main
+  /// thread in CacheFramesForUpdateThread() for the update thread to consume;
+  /// cached_feats_ is without CMN (input to the stats accumulation), and
+  /// cached_feats_normalized_ is with CMN (used to get the posteriors).  The
+  /// pointers are owned here; elements are never modified or freed while the
+  /// update thread is running, so the update thread may dereference them
+  /// without holding work_mutex_ (it only needs the lock to read the vector
+  /// itself, which may be reallocated by push_back).
+  std::vector<Vector<BaseFloat>*> cached_feats_;
+  std::vector<Vector<BaseFloat>*> cached_feats_normalized_;
+
+  /// Vectors previously used in cached_feats_ / cached_feats_normalized_ and
+  /// recycled by Reset(), ready for re-use by CacheFramesForUpdateThread();
+  /// only the main thread touches this.
+  std::vector<Vector<BaseFloat>*> recycled_feats_;
+
+  /// Number of frames we have copied into cached_feats_ (only accessed by
+  /// the main thread).
+  int32 num_frames_cached_;
+
+  /// The frame up to which (inclusive) the update thread should accumulate
+  /// stats; -1 if no work has been requested yet.
+  int32 target_frame_;
+
+  /// Delta-weights passed in via UpdateFrameWeights(), waiting to be moved
+  /// onto delta_weights_ by the update thread (delta_weights_ itself is owned
+  /// by the update thread in async mode).
+  std::vector<std::pair<int32, BaseFloat> > pending_delta_weights_;
+
+  /// Set (under work_mutex_) when a thread is blocked in
+  /// SynchronizeUpdateThread(); tells the update thread to signal caught_up_
+  /// once it has drained all queued work.
+  mutable bool sync_requested_;
+
+  /// Set (under work_mutex_) by the destructor to tell the update thread to
+  /// exit after finishing any outstanding work.
+  bool done_;
+
+  /// Double buffer from which GetFrame() serves the iVector in async mode.
+  /// The update thread writes the back buffer without any lock held, then
+  /// flips cur_ivector_buffer_ while holding ivector_buffer_mutex_; readers
+  /// copy the front buffer while holding the same mutex.  Since both critical
+  /// sections are just an index flip and a small vector copy, GetFrame()
+  /// never waits on iVector estimation.
+  Vector<double> ivector_buffers_[2];
+  int32 cur_ivector_buffer_;
+  mutable Mutex ivector_buffer_mutex_;
 };
 
 
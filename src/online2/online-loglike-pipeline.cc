@@ -0,0 +1,201 @@
+// online2/online-loglike-pipeline.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "online2/online-loglike-pipeline.h"
+#include "thread/kaldi-thread.h"
+
+namespace kaldi {
+
+void ThreadedLoglikePipelineConfig::Check() {
+  KALDI_ASSERT(compute_batch_size > 0);
+  KALDI_ASSERT(max_loglikes_copy >= 0);
+  KALDI_ASSERT(decode_batch_size >= 1);
+}
+
+ThreadedLoglikePipeline::ThreadedLoglikePipeline(
+    const ThreadedLoglikePipelineConfig &config,
+    const TransitionModel &tmodel,
+    OnlineLoglikeComputer *computer):
+    config_(config), computer_(computer), decodable_(tmodel),
+    num_frames_decoded_(0), abort_(false), error_(false) {
+  config_.Check();
+
+  pthread_attr_t pthread_attr;
+  pthread_attr_init(&pthread_attr);
+  int32 ret;
+  // Note: if the constructor throws an exception, the corresponding destructor
+  // will not be called, so there is no danger of joining a thread that was
+  // never created.
+  if ((ret = pthread_create(&thread_,
+                            &pthread_attr, RunComputation,
+                            (void*)this)) != 0) {
+    const char *c = strerror(ret);
+    if (c == NULL) { c = "[NULL]"; }
+    KALDI_ERR << "Error creating thread, errno was: " << c;
+  }
+}
+
+ThreadedLoglikePipeline::~ThreadedLoglikePipeline() {
+  if (!abort_)
+    SetAbort();
+  // join the background thread (this avoids leaving a zombie thread around, or
+  // a thread that might be accessing a deconstructed object).  If the thread
+  // already exited normally, the join returns immediately.
+  if (pthread_join(thread_, NULL))
+    KALDI_ERR << "Error rejoining thread";  // this should not happen.
+}
+
+void ThreadedLoglikePipeline::SetAbort() {
+  abort_ = true;
+  synchronizer_.SetAbort();  // wakes the background thread if it's waiting on
+                             // the synchronizer.
+  computer_->Abort();  // wakes the background thread if it's waiting for
+                       // input inside ComputeLoglikes().
+}
+
+void ThreadedLoglikePipeline::AdvanceDecoding(
+    LatticeFasterOnlineDecoder *decoder) {
+  if (!AdvanceDecodingInternal(decoder, false) && error_)
+    KALDI_ERR << "Error encountered during pipelined decoding.  See above.";
+}
+
+void ThreadedLoglikePipeline::FinishDecoding(
+    LatticeFasterOnlineDecoder *decoder) {
+  if (!AdvanceDecodingInternal(decoder, true) && error_)
+    KALDI_ERR << "Error encountered during pipelined decoding.  See above.";
+}
+
+// static
+void* ThreadedLoglikePipeline::RunComputation(void *ptr_in) {
+  ThreadedLoglikePipeline *me =
+      reinterpret_cast<ThreadedLoglikePipeline*>(ptr_in);
+  try {
+    if (!me->RunComputationInternal() && !me->abort_)
+      KALDI_ERR << "Returned abnormally and abort was not called";
+  } catch(const std::exception &e) {
+    KALDI_WARN << "Caught exception: " << e.what();
+    // if an error happened on this thread, we need to make sure the main
+    // thread notices (it will check error_ and throw).
+    me->error_ = true;
+    me->SetAbort();
+  }
+  return NULL;
+}
+
+bool ThreadedLoglikePipeline::RunComputationInternal() {
+  // if any of the Lock/Unlock functions return false, it's because SetAbort()
+  // was called.
+
+  // num_frames_output is the number of frames of log-likelihoods we have given
+  // to the decodable object so far.
+  int32 num_frames_output = 0;
+
+  while (true) {
+    Matrix<BaseFloat> loglikes;
+    bool no_more_frames = false;
+    // This call may block, waiting for input; on abort, computer_->Abort()
+    // will have woken it up.
+    computer_->ComputeLoglikes(num_frames_output, config_.compute_batch_size,
+                               &loglikes, &no_more_frames);
+
+    int32 num_loglike_frames = loglikes.NumRows();
+
+    if (num_loglike_frames != 0) {
+      while (true) {
+        // we may have to grab and release the synchronizer a few times before
+        // the decodable object is ready to accept the loglikes.
+        if (!synchronizer_.Lock(ThreadSynchronizer::kProducer))
+          return false;
+        // we can't have output fewer frames than were decoded.
+        KALDI_ASSERT(num_frames_output >= num_frames_decoded_);
+        if (num_frames_output - num_frames_decoded_ <=
+            config_.max_loglikes_copy) {
+          // If we would have to copy fewer than config_.max_loglikes_copy
+          // previously output log-likelihoods inside the decodable object,
+          // then we go ahead and copy them to that object.
+          int32 frames_to_discard = num_frames_decoded_ -
+              decodable_.FirstAvailableFrame();
+          KALDI_ASSERT(frames_to_discard >= 0);
+          num_frames_output += num_loglike_frames;
+          decodable_.AcceptLoglikes(&loglikes, frames_to_discard);
+          if (!synchronizer_.UnlockSuccess(ThreadSynchronizer::kProducer))
+            return false;
+          break;  // break from the innermost while loop.
+        } else {
+          // There are too many frames already available to the decoder, that
+          // it hasn't processed yet, and we don't want them to have to be
+          // copied inside AcceptLoglikes(), so we wait for a bit.  The next
+          // call to Lock will block until the decoder has processed more
+          // frames.
+          if (!synchronizer_.UnlockFailure(ThreadSynchronizer::kProducer))
+            return false;
+        }
+      }
+    }
+    if (no_more_frames) {
+      // Inform the decodable object that there will be no more input.
+      if (!synchronizer_.Lock(ThreadSynchronizer::kProducer))
+        return false;
+      decodable_.InputIsFinished();
+      if (!synchronizer_.UnlockSuccess(ThreadSynchronizer::kProducer))
+        return false;
+      return true;
+    }
+    if (abort_)  // in case the computer returned no frames on abort without
+                 // setting no_more_frames.
+      return false;
+  }
+}
+
+bool ThreadedLoglikePipeline::AdvanceDecodingInternal(
+    LatticeFasterOnlineDecoder *decoder, bool wait) {
+  while (true) {
+    if (!synchronizer_.Lock(ThreadSynchronizer::kConsumer))
+      return false;  // SetAbort() was called.
+    int32 num_frames_decoded = decoder->NumFramesDecoded();
+    if (decodable_.NumFramesReady() <= num_frames_decoded) {
+      // no frames available to decode.
+      KALDI_ASSERT(decodable_.NumFramesReady() == num_frames_decoded);
+      if (decodable_.IsLastFrame(num_frames_decoded - 1)) {
+        // all input has been decoded; we're done.
+        return synchronizer_.UnlockSuccess(ThreadSynchronizer::kConsumer);
+      } else if (!wait) {
+        // we've decoded everything that's currently computed, and the caller
+        // doesn't want to wait for more.
+        return synchronizer_.UnlockSuccess(ThreadSynchronizer::kConsumer);
+      } else {
+        // we were not able to advance the decoding due to no available input.
+        // The following call ensures that the next call to Lock() will wait
+        // until the background thread has produced something.
+        if (!synchronizer_.UnlockFailure(ThreadSynchronizer::kConsumer))
+          return false;
+      }
+    } else {
+      // Decode at most config_.decode_batch_size frames (e.g. 1 or 2); we
+      // release the synchronizer in between so the background thread can give
+      // us more log-likelihoods while we work.
+      decoder->AdvanceDecoding(&decodable_, config_.decode_batch_size);
+      num_frames_decoded_ = decoder->NumFramesDecoded();
+      if (!synchronizer_.UnlockSuccess(ThreadSynchronizer::kConsumer))
+        return false;
+    }
+  }
+}
+
+}  // namespace kaldi
@@ -0,0 +1,205 @@
+// online2/online-loglike-pipeline.h
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_ONLINE2_ONLINE_LOGLIKE_PIPELINE_H_
+#define KALDI_ONLINE2_ONLINE_LOGLIKE_PIPELINE_H_
+
+#include <string>
+#include <vector>
+
+#include "matrix/matrix-lib.h"
+#include "util/common-utils.h"
+#include "base/kaldi-error.h"
+#include "decoder/decodable-matrix.h"
+#include "decoder/lattice-faster-online-decoder.h"
+#include "hmm/transition-model.h"
+#include "online2/online-nnet2-decoding-threaded.h"  // for ThreadSynchronizer.
+
+namespace kaldi {
+/// @addtogroup  onlinedecoding OnlineDecoding
+/// @{
+
+/**
+   This interface represents the "acoustic scoring" side of class
+   ThreadedLoglikePipeline: something that can compute, for successive frames,
+   a row of scaled pseudo-log-likelihoods indexed by pdf-id.  An implementation
+   will typically own (or have access to) an online feature pipeline and an
+   acoustic model; see class SingleUtteranceGmmDecoderPipelined in
+   online-gmm-decoding-pipelined.h for an example.
+
+   Caution: ComputeLoglikes() and Abort() are called from the pipeline's
+   background thread and from the main thread respectively, so implementations
+   must do their own locking for any state the two calls share.
+*/
+class OnlineLoglikeComputer {
+ public:
+  /// Computes scaled log-likelihoods for up to "max_frames" frames starting
+  /// from frame index "begin_frame", outputting one row per frame to
+  /// "loglikes" (which is resized by this function; columns are indexed by
+  /// pdf-id).  If no frame is available yet, this function should block until
+  /// at least one is.  It may output fewer than max_frames rows (even zero
+  /// rows) if fewer are available.  It should set *no_more_frames to true if
+  /// no frames past the ones it output will ever become available, i.e. if
+  /// the input was finished or processing was aborted; at that point the
+  /// pipeline's background thread will exit.
+  virtual void ComputeLoglikes(int32 begin_frame, int32 max_frames,
+                               Matrix<BaseFloat> *loglikes,
+                               bool *no_more_frames) = 0;
+
+  /// Called (from the main thread) when the pipeline is aborting; the
+  /// implementation should wake up any wait that ComputeLoglikes() may be
+  /// blocked in, and arrange for it to return promptly.
+  virtual void Abort() = 0;
+
+  virtual ~OnlineLoglikeComputer() { }
+};
+
+
+// Configuration class for class ThreadedLoglikePipeline.  The defaults should
+// rarely need to be changed.
+struct ThreadedLoglikePipelineConfig {
+  int32 compute_batch_size;  // maximum number of frames of log-likelihoods we
+                             // request from the OnlineLoglikeComputer at a
+                             // time.  Making this larger improves the locality
+                             // of the scoring but increases the latency of the
+                             // pipeline.
+  int32 max_loglikes_copy;   // maximum unused frames of log-likelihoods we
+                             // will copy from the decodable object back into
+                             // another matrix to be supplied to the decodable
+                             // object.  make this too large-> will block the
+                             // main thread while copying; too small -> the
+                             // scoring thread may get blocked for too long
+                             // while waiting for the decoder to catch up.
+  int32 decode_batch_size;   // maximum number of frames at a time that we
+                             // decode before unlocking the synchronizer.  The
+                             // only real cost here is a lock/unlock, so it's
+                             // OK to make this fairly small.
+
+  ThreadedLoglikePipelineConfig() {
+    compute_batch_size = 32;
+    max_loglikes_copy = 20;
+    decode_batch_size = 2;
+  }
+
+  void Check();
+
+  void Register(OptionsItf *opts) {
+    opts->Register("compute-batch-size", &compute_batch_size, "Maximum batch "
+                   "size (in frames) used when computing log-likelihoods on "
+                   "the scoring thread");
+    opts->Register("max-loglikes-copy", &max_loglikes_copy, "Obscure setting, "
+                   "affects pipelined decoding.");
+    opts->Register("decode-batch-size", &decode_batch_size, "Obscure setting, "
+                   "affects pipelined decoding.");
+  }
+};
+
+/**
+   class ThreadedLoglikePipeline generalizes the producer/consumer mechanism of
+   online-nnet2-decoding-threaded.cc: a background thread repeatedly asks an
+   OnlineLoglikeComputer for batches of scaled log-likelihoods (this is where
+   the feature computation and acoustic scoring happen), and buffers them in a
+   DecodableMatrixMappedOffset guarded by a ThreadSynchronizer; the main thread
+   consumes them by advancing a decoder.  The effect is that the scoring runs
+   about one batch ahead of the graph search, on a second thread.
+
+   Unlike SingleUtteranceNnet2DecoderThreaded, the graph search itself stays on
+   the calling thread: you keep ownership of the decoder and call
+   AdvanceDecoding() whenever convenient, so this class can be dropped into
+   code that was structured around the single-threaded decoders.
+   Note: we assume that all calls to the public interface of this class happen
+   from a single thread (the same one that owns the decoder).
+*/
+class ThreadedLoglikePipeline {
+ public:
+  // The constructor spawns the background scoring thread, which will
+  // immediately start calling computer->ComputeLoglikes().  "computer" is not
+  // owned here and must outlive this object; "tmodel" is needed to map
+  // transition-ids to the pdf-ids that index the log-likelihood matrix.
+  ThreadedLoglikePipeline(const ThreadedLoglikePipelineConfig &config,
+                          const TransitionModel &tmodel,
+                          OnlineLoglikeComputer *computer);
+
+  /// Advances "decoder" over all frames whose log-likelihoods the background
+  /// thread has already computed, then returns; it does not wait for more
+  /// frames to be computed (so this call is cheap if nothing is ready).
+  void AdvanceDecoding(LatticeFasterOnlineDecoder *decoder);
+
+  /// Like AdvanceDecoding(), but blocks until all frames have been decoded,
+  /// i.e. until the computer has signaled that no more frames are coming.  You
+  /// must have informed the computer that its input is finished before calling
+  /// this (e.g. by calling InputFinished() on the feature pipeline it reads
+  /// from); otherwise this call would block forever.
+  void FinishDecoding(LatticeFasterOnlineDecoder *decoder);
+
+  /// You can call this if you don't want any more processing to be done; the
+  /// background thread will exit as soon as it safely can.  Called from the
+  /// destructor if not called before.
+  void SetAbort();
+
+  ~ThreadedLoglikePipeline();
+
+ private:
+  // this function runs the background thread that computes the
+  // log-likelihoods; ptr_in is to class ThreadedLoglikePipeline.  Always
+  // returns NULL, but in case of failure, calls ptr_in->SetAbort() after
+  // setting error_.
+  static void* RunComputation(void *ptr_in);
+  // member-function version of RunComputation, called by RunComputation.
+  bool RunComputationInternal();
+
+  // Implements AdvanceDecoding() and FinishDecoding(); if "wait" is true it
+  // blocks until the last frame has been decoded.  Returns false if
+  // SetAbort() was called.
+  bool AdvanceDecodingInternal(LatticeFasterOnlineDecoder *decoder,
+                               bool wait);
+
+  ThreadedLoglikePipelineConfig config_;
+
+  OnlineLoglikeComputer *computer_;  // not owned here.
+
+  // this Decodable object just stores a matrix of scaled log-likelihoods
+  // produced by the background thread and consumed by AdvanceDecoding() on the
+  // main thread.  The main thread sets num_frames_decoded_ so the background
+  // thread knows which frames of log-likelihoods it can discard.  Both of
+  // these variables are guarded by synchronizer_.
+  DecodableMatrixMappedOffset decodable_;
+  int32 num_frames_decoded_;
+  ThreadSynchronizer synchronizer_;
+
+  // The background scoring thread (joined in the destructor).
+  pthread_t thread_;
+
+  // This is set to true if SetAbort() was called for any reason.
+  bool abort_;
+
+  // This is set to true if any kind of unexpected error is encountered,
+  // including if exceptions are raised on the background thread.
+  bool error_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(ThreadedLoglikePipeline);
+};
+
+
+/// @} End of "addtogroup onlinedecoding"
+
+}  // namespace kaldi
+
+#endif  // KALDI_ONLINE2_ONLINE_LOGLIKE_PIPELINE_H_
@@ -25,6 +25,12 @@
 
 namespace kaldi {
 
+// The capacity of the lock-free queue of waveform pieces going to the
+// feature-processing thread.  One entry is used per AcceptWaveform call, so
+// this is effectively unbounded; if the queue ever does fill up,
+// AcceptWaveform sleeps briefly and retries.
+static const int32 kMaxPendingWaveformPieces = 4096;
+
 ThreadSynchronizer::ThreadSynchronizer():
     abort_(false), 
     producer_waiting_(false),
@@ -118,6 +124,7 @@ SingleUtteranceNnet2DecoderThreaded::SingleUtteranceNnet2DecoderThreaded(
     const OnlineIvectorExtractorAdaptationState &adaptation_state):
   config_(config), am_nnet_(am_nnet), tmodel_(tmodel), sampling_rate_(0.0),
   num_samples_received_(0), input_finished_(false),
+  input_waveform_(kMaxPendingWaveformPieces),
   feature_pipeline_(feature_info),
   num_samples_discarded_(0),
   silence_weighting_(tmodel, feature_info.silence_weighting_config),
@@ -173,10 +180,9 @@ SingleUtteranceNnet2DecoderThreaded::~SingleUtteranceNnet2DecoderThreaded() {
   // join all the threads (this avoids leaving zombie threads around, or threads
   // that might be accessing deconstructed object).
   WaitForAllThreads();
-  while (!input_waveform_.empty()) {
-    delete input_waveform_.front();
-    input_waveform_.pop_front();
-  }
+  Vector<BaseFloat> *piece;
+  while (input_waveform_.TryPop(&piece))
+    delete piece;
   while (!processed_waveform_.empty()) {
     delete processed_waveform_.front();
     processed_waveform_.pop_front();
@@ -194,30 +200,26 @@ void SingleUtteranceNnet2DecoderThreaded::AcceptWaveform(
   num_samples_received_ += wave_part.Dim();
   
   if (wave_part.Dim() == 0) return;
-  if (!waveform_synchronizer_.Lock(ThreadSynchronizer::kProducer)) {
-    KALDI_ERR << "Failure locking mutex: decoding aborted.";
-  }
 
   Vector<BaseFloat> *new_part = new Vector<BaseFloat>(wave_part);
-  input_waveform_.push_back(new_part);
-  // we always unlock with success because there is no buffer size limitation
-  // for the waveform so no reason why we might wait.
-  waveform_synchronizer_.UnlockSuccess(ThreadSynchronizer::kProducer);
+  // No lock is taken here: input_waveform_ is a lock-free queue.  Its
+  // capacity is large enough that it will not fill up unless the consumer
+  // thread has fallen a very long way behind.
+  while (!input_waveform_.TryPush(new_part)) {
+    if (abort_) {
+      delete new_part;
+      KALDI_ERR << "Failure pushing waveform: decoding aborted.";
+    }
+    Sleep(0.001f);
+  }
+  waveform_ready_.Signal();  // wake the feature-processing thread if it is
+                             // sleeping.
 }
 
 int32 SingleUtteranceNnet2DecoderThreaded::NumWaveformPiecesPending() {
-  // Note RE locking: what we really want here is just to lock the mutex.  As a
-  // side effect, because of the way the synchronizer code works, it will also
-  // increment the semaphore and might wake up the consumer thread.  This will
-  // possibly make it do a little useless work (go around a loop once), but
-  // won't really do any harm.  Perhaps we should have implemented a version of
-  // the Lock function that takes no arguments.
-  if (!waveform_synchronizer_.Lock(ThreadSynchronizer::kProducer)) {
-    KALDI_ERR << "Failure locking mutex: decoding aborted.";
-  }
-  int32 ans = input_waveform_.size();
-  waveform_synchronizer_.UnlockSuccess(ThreadSynchronizer::kProducer);
-  return ans;
+  // This is exact because we (the main thread) are the producer side of the
+  // queue.
+  return input_waveform_.Size();
 }
 
 
@@ -230,12 +232,10 @@ void SingleUtteranceNnet2DecoderThreaded::InputFinished() {
   // setting input_finished_ = true informs the feature-processing pipeline
   // to expect no more input, and to flush out the last few frames if there
   // is any latency in the pipeline (e.g. due to pitch).
-  if (!waveform_synchronizer_.Lock(ThreadSynchronizer::kProducer)) {
-    KALDI_ERR << "Failure locking mutex: decoding aborted.";
-  }
   KALDI_ASSERT(!input_finished_ && "InputFinished called twice");
   input_finished_ = true;
-  waveform_synchronizer_.UnlockSuccess(ThreadSynchronizer::kProducer);
+  waveform_ready_.Signal();  // so the feature-processing thread notices,
+                             // even if no more waveform is coming.
 }
 
 void SingleUtteranceNnet2DecoderThreaded::TerminateDecoding() {
@@ -271,9 +271,11 @@ BaseFloat SingleUtteranceNnet2DecoderThreaded::GetRemainingWaveform(
     num_samples_stored += (*iter)->Dim();
     all_pieces.push_back(*iter);
   }
-  for (iter = input_waveform_.begin(); iter != input_waveform_.end(); ++iter) {
-    num_samples_stored += (*iter)->Dim();
-    all_pieces.push_back(*iter);
+  // The threads have been joined at this point (see the check above), so
+  // the indexed access to the queue below is safe.
+  for (int32 i = 0; i < input_waveform_.Size(); i++) {
+    num_samples_stored += input_waveform_.At(i)->Dim();
+    all_pieces.push_back(input_waveform_.At(i));
   }
   int64 samples_shift_per_frame =
       sampling_rate_ * feature_pipeline_.FrameShiftInSeconds();
@@ -369,7 +371,8 @@ void SingleUtteranceNnet2DecoderThreaded::AbortAllThreads(bool error) {
   abort_ = true;
   if (error)
     error_ = true;
-  waveform_synchronizer_.SetAbort();
+  waveform_ready_.Signal();  // wake the feature-processing thread, if it is
+                             // waiting for waveform; it will see abort_.
   decodable_synchronizer_.SetAbort();
 }
 
@@ -458,31 +461,39 @@ bool SingleUtteranceNnet2DecoderThreaded::FeatureComputation(
     if (num_frames_usable >= config_.nnet_batch_size)
       return true;  // We don't need more data yet.
     
-    // Now try to get more data, if we can.
-    if (!waveform_synchronizer_.Lock(ThreadSynchronizer::kConsumer)) {
-      return false;
-    }
-    // we've got the lock.
-    if (input_waveform_.empty()) {  // we got no data
+    // Now try to get more data, if we can.  No lock is taken here:
+    // input_waveform_ is a lock-free queue of which we are the only
+    // consumer.
+    if (input_waveform_.Empty()) {  // we got no data
       if (input_finished_ &&
           !feature_pipeline_.IsLastFrame(feature_pipeline_.NumFramesReady()-1)) {
         // the main thread called InputFinished() and set input_finished_, and
-        // we haven't yet registered that fact.  This is progress so
-        // unlock with UnlockSuccess().
+        // we haven't yet registered that fact.  This is progress, so return
+        // and let the caller loop around.
         feature_pipeline_.InputFinished();
-        return waveform_synchronizer_.UnlockSuccess(ThreadSynchronizer::kConsumer);
+        return true;
       } else {
-        // there is no progress.  Unlock with UnlockFailure() so the next call to
-        // waveform_synchronizer_.Lock() will lock.
-        return waveform_synchronizer_.UnlockFailure(ThreadSynchronizer::kConsumer);
+        // There is no progress, so wait until the producer signals that it
+        // has pushed waveform, called InputFinished(), or aborted.  First
+        // discard any stale wakeups from pieces we already popped (the
+        // semaphore can have more signals than the queue has elements), then
+        // re-check the queue: a signal arriving after the drain will be
+        // caught by Wait() below, because the producer pushes before it
+        // signals.
+        while (waveform_ready_.TryWait());
+        if (input_waveform_.Empty() && !input_finished_ && !abort_)
+          waveform_ready_.Wait();
+        if (abort_)
+          return false;
+        return true;  // the caller loops around and re-assesses.
       }
     } else {  // we got some data.  Only take enough of the waveform to
               // give us a maximum nnet batch size of frames to decode.
+      Vector<BaseFloat> *piece;
       while (num_frames_usable < config_.nnet_batch_size &&
-             !input_waveform_.empty()) {
-        feature_pipeline_.AcceptWaveform(sampling_rate_, *input_waveform_.front());
-        processed_waveform_.push_back(input_waveform_.front());
-        input_waveform_.pop_front();
+             input_waveform_.TryPop(&piece)) {
+        feature_pipeline_.AcceptWaveform(sampling_rate_, *piece);
+        processed_waveform_.push_back(piece);
         num_frames_ready = feature_pipeline_.NumFramesReady();
         num_frames_usable = num_frames_ready - num_frames_consumed;
       }
@@ -498,7 +509,7 @@ bool SingleUtteranceNnet2DecoderThreaded::FeatureComputation(
         delete processed_waveform_.front();
         processed_waveform_.pop_front();
       }
-      return waveform_synchronizer_.UnlockSuccess(ThreadSynchronizer::kConsumer);
+      return true;
     }
   }
 }
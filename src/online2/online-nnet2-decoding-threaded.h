@@ -36,6 +36,7 @@
 #include "hmm/transition-model.h"
 #include "thread/kaldi-mutex.h"
 #include "thread/kaldi-semaphore.h"
+#include "thread/kaldi-lockfree-queue.h"
 
 namespace kaldi {
 /// @addtogroup  onlinedecoding OnlineDecoding
@@ -355,17 +356,23 @@ class SingleUtteranceNnet2DecoderThreaded {
   int64 num_samples_received_;
 
   // The next two variables are written to by AcceptWaveform from the main
-  // thread, and read by the feature-processing thread; they are guarded by
-  // waveform_synchronizer_.  There is no bound on the buffer size here.
-  // Later-arriving data is appended to the vector.  When InputFinished() is
-  // called from the main thread, the main thread sets input_finished_ = true.
+  // thread, and read by the feature-processing thread.  input_waveform_ is
+  // a lock-free single-producer single-consumer queue (see
+  // thread/kaldi-lockfree-queue.h), so no mutex is taken per piece of
+  // waveform; its capacity is large enough that AcceptWaveform will not
+  // block in practice.  When InputFinished() is called from the main
+  // thread, the main thread sets input_finished_ = true.
   // sampling_rate_ is only needed for checking that it matches the config.
   bool input_finished_;
-  std::deque< Vector<BaseFloat>* > input_waveform_;
+  SpscQueue< Vector<BaseFloat>* > input_waveform_;
+
+  // The producer signals this semaphore after each push to input_waveform_,
+  // after setting input_finished_, and on abort, so the feature-processing
+  // thread can sleep when it has nothing to do without polling the queue.
+  // There may be more signals than pieces of waveform; the consumer just
+  // rechecks the queue when woken.
+  Semaphore waveform_ready_;
 
-  
-  ThreadSynchronizer waveform_synchronizer_;
-  
   // feature_pipeline_ is accessed by the nnet-evaluation thread, by the main
   // thread if GetAdaptionState() is called, and by the decoding thread via
   // ComputeCurrentTraceback() if online silence weighting is being used.  It is
@@ -20,6 +20,7 @@
 #include "online2/online-nnet2-decoding.h"
 #include "lat/lattice-functions.h"
 #include "lat/determinize-lattice-pruned.h"
+#include "thread/kaldi-profiler.h"
 
 namespace kaldi {
 
@@ -33,12 +34,66 @@ SingleUtteranceNnet2Decoder::SingleUtteranceNnet2Decoder(
     feature_pipeline_(feature_pipeline),
     tmodel_(tmodel),
     decodable_(model, tmodel, config.decodable_opts, feature_pipeline),
+    vad_(NULL),
+    gated_decodable_(NULL),
     decoder_(fst, config.decoder_opts) {
+  if (config_.vad_gate_silence) {
+    // The VAD watches the raw MFCC/PLP features, whose first coefficient is a
+    // log-energy, not the final (e.g. iVector-appended) features.
+    vad_ = new OnlineVad(config_.vad_opts, feature_pipeline->InputFeature());
+    gated_decodable_ = new VadGatedDecodable(config_.vad_min_silence_frames,
+                                             vad_, &decodable_);
+  }
   decoder_.InitDecoding();
 }
 
+SingleUtteranceNnet2Decoder::SingleUtteranceNnet2Decoder(
+    const OnlineNnet2DecodingConfig &config,
+    const TransitionModel &tmodel,
+    const nnet2::AmNnet &model,
+    SharedFst *shared_fst,
+    OnlineNnet2FeaturePipeline *feature_pipeline):
+    config_(config),
+    feature_pipeline_(feature_pipeline),
+    tmodel_(tmodel),
+    decodable_(model, tmodel, config.decodable_opts, feature_pipeline),
+    vad_(NULL),
+    gated_decodable_(NULL),
+    decoder_(shared_fst, config.decoder_opts) {
+  if (config_.vad_gate_silence) {
+    // see the comment in the other constructor.
+    vad_ = new OnlineVad(config_.vad_opts, feature_pipeline->InputFeature());
+    gated_decodable_ = new VadGatedDecodable(config_.vad_min_silence_frames,
+                                             vad_, &decodable_);
+  }
+  decoder_.InitDecoding();
+}
+
+void SingleUtteranceNnet2Decoder::Reset() {
+  feature_pipeline_->Reset();
+  decodable_.Reset();
+  if (vad_ != NULL)
+    vad_->Reset();
+  if (gated_decodable_ != NULL)
+    gated_decodable_->Reset();
+  decoder_.InitDecoding();
+}
+
+SingleUtteranceNnet2Decoder::~SingleUtteranceNnet2Decoder() {
+  if (gated_decodable_ != NULL)
+    KALDI_VLOG(2) << "Silence gating borrowed acoustic scores for "
+                  << gated_decodable_->NumFramesSkipped() << " of "
+                  << NumFramesDecoded() << " frames decoded.";
+  delete gated_decodable_;
+  delete vad_;
+}
+
 void SingleUtteranceNnet2Decoder::AdvanceDecoding() {
-  decoder_.AdvanceDecoding(&decodable_);
+  KALDI_PROFILE_SCOPE("SingleUtteranceNnet2Decoder::AdvanceDecoding");
+  if (gated_decodable_ != NULL)
+    decoder_.AdvanceDecoding(gated_decodable_);
+  else
+    decoder_.AdvanceDecoding(&decodable_);
 }
 
 void SingleUtteranceNnet2Decoder::FinalizeDecoding() {
@@ -30,6 +30,7 @@
 #include "base/kaldi-error.h"
 #include "nnet2/online-nnet2-decodable.h"
 #include "online2/online-nnet2-feature-pipeline.h"
+#include "online2/online-vad.h"
 #include "online2/online-endpoint.h"
 #include "decoder/lattice-faster-online-decoder.h"
 #include "hmm/transition-model.h"
@@ -48,15 +49,32 @@ namespace kaldi {
 // requires other configs that it creates separately, and which are not included
 // here: namely, OnlineNnet2FeaturePipelineConfig and OnlineEndpointConfig.
 struct OnlineNnet2DecodingConfig {
-  
+
   LatticeFasterDecoderConfig decoder_opts;
   nnet2::DecodableNnet2OnlineOptions decodable_opts;
-  
-  OnlineNnet2DecodingConfig() {  decodable_opts.acoustic_scale = 0.1; }
-  
+  VadEnergyOptions vad_opts;  // only relevant if vad_gate_silence == true.
+
+  bool vad_gate_silence;
+  int32 vad_min_silence_frames;
+
+  OnlineNnet2DecodingConfig(): vad_gate_silence(false),
+                               vad_min_silence_frames(20) {
+    decodable_opts.acoustic_scale = 0.1;
+  }
+
   void Register(OptionsItf *opts) {
     decoder_opts.Register(opts);
     decodable_opts.Register(opts);
+    vad_opts.Register(opts);
+    opts->Register("vad-gate-silence", &vad_gate_silence,
+                   "If true, use energy-based voice activity detection to "
+                   "avoid evaluating the neural net inside long silence "
+                   "regions (the scores of the last evaluated frame are "
+                   "re-used there).");
+    opts->Register("vad-min-silence-frames", &vad_min_silence_frames,
+                   "Number of consecutive unvoiced frames we evaluate "
+                   "normally before the gating of --vad-gate-silence "
+                   "kicks in.");
   }
 };
 
@@ -73,7 +91,18 @@ class SingleUtteranceNnet2Decoder {
                               const nnet2::AmNnet &model,
                               const fst::Fst<fst::StdArc> &fst,
                               OnlineNnet2FeaturePipeline *feature_pipeline);
-  
+
+  // As above, but gets the decoding graph from a SharedFst (see
+  // decoder/shared-fst.h): the session binds whichever graph is current
+  // when it starts, so a server can swap in a refreshed graph for new
+  // sessions without interrupting the sessions that are in flight.
+  SingleUtteranceNnet2Decoder(const OnlineNnet2DecodingConfig &config,
+                              const TransitionModel &tmodel,
+                              const nnet2::AmNnet &model,
+                              SharedFst *shared_fst,
+                              OnlineNnet2FeaturePipeline *feature_pipeline);
+
+
   /// advance the decoding as far as we can.
   void AdvanceDecoding();
 
@@ -100,13 +129,32 @@ class SingleUtteranceNnet2Decoder {
                    Lattice *best_path) const;
 
 
+  /// Optional; call this right after the constructor (i.e. before decoding
+  /// anything) if you intend to do endpointing, and the decoder will track
+  /// the required quantities as it decodes, making EndpointDetected() an
+  /// O(1) query instead of a best-path traceback per call.
+  void InitEndpointing(const OnlineEndpointConfig &config) {
+    decoder_.TrackTrailingSilence(tmodel_, config.silence_phones);
+  }
+
   /// This function calls EndpointDetected from online-endpoint.h,
   /// with the required arguments.
   bool EndpointDetected(const OnlineEndpointConfig &config);
 
   const LatticeFasterOnlineDecoder &Decoder() const { return decoder_; }
-  
-  ~SingleUtteranceNnet2Decoder() { }
+
+  /// Returns the whole stack -- feature pipeline, decodable and decoder --
+  /// to the state it had just after construction, so the same objects can
+  /// decode the next utterance of a session.  Unlike destroying and
+  /// re-creating the objects, this keeps all the internal buffers (the
+  /// decoder's token and link pools and hash table, the feature and
+  /// log-likelihood matrices) allocated at their high-water-mark sizes, so
+  /// back-to-back short utterances don't pay per-utterance allocation costs.
+  /// As with a newly constructed object, you may want to call
+  /// feature_pipeline->SetAdaptationState() after this.
+  void Reset();
+
+  ~SingleUtteranceNnet2Decoder();
  private:
 
   OnlineNnet2DecodingConfig config_;
@@ -114,11 +162,17 @@ class SingleUtteranceNnet2Decoder {
   OnlineNnet2FeaturePipeline *feature_pipeline_;
 
   const TransitionModel &tmodel_;
-  
+
   nnet2::DecodableNnet2Online decodable_;
-  
+
+  // vad_ and gated_decodable_ are NULL unless config_.vad_gate_silence is
+  // true; they are owned here.  gated_decodable_ wraps decodable_ so that the
+  // nnet is not evaluated inside long silence regions; see online-vad.h.
+  OnlineVad *vad_;
+  VadGatedDecodable *gated_decodable_;
+
   LatticeFasterOnlineDecoder decoder_;
-  
+
 };
 
   
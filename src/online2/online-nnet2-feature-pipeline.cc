@@ -19,6 +19,7 @@
 
 #include "online2/online-nnet2-feature-pipeline.h"
 #include "transform/cmvn.h"
+#include "thread/kaldi-profiler.h"
 
 namespace kaldi {
 
@@ -163,6 +164,7 @@ OnlineNnet2FeaturePipeline::~OnlineNnet2FeaturePipeline() {
 void OnlineNnet2FeaturePipeline::AcceptWaveform(
     BaseFloat sampling_rate,
     const VectorBase<BaseFloat> &waveform) {
+  KALDI_PROFILE_SCOPE("OnlineNnet2FeaturePipeline::AcceptWaveform");
   base_feature_->AcceptWaveform(sampling_rate, waveform);
   if (pitch_)
     pitch_->AcceptWaveform(sampling_rate, waveform);
@@ -180,6 +182,17 @@ void OnlineNnet2FeaturePipeline::InputFinished() {
     pitch_->InputFinished();
 }
 
+void OnlineNnet2FeaturePipeline::Reset() {
+  base_feature_->Reset();
+  if (pitch_) {
+    pitch_->Reset();
+    pitch_feature_->Reset();
+  }
+  // The OnlineAppendFeature objects have no per-utterance state of their own.
+  if (ivector_feature_)
+    ivector_feature_->Reset();
+}
+
 BaseFloat OnlineNnet2FeaturePipelineInfo::FrameShiftInSeconds() const {
   if (feature_type == "mfcc") {
     return mfcc_opts.frame_opts.frame_shift_ms * 1.0e-03;
@@ -231,6 +231,23 @@ class OnlineNnet2FeaturePipeline: public OnlineFeatureInterface {
   /// rescoring the lattices, this may not be much of an issue.
   void InputFinished();
 
+  /// Returns this object to the state it had just after construction, so it
+  /// can be re-used for the next utterance of a session instead of being
+  /// destroyed and re-created; all the component feature objects keep their
+  /// buffers allocated (except the pitch extractor, if pitch is in use --
+  /// see OnlinePitchFeature::Reset()), so back-to-back short utterances
+  /// don't pay per-utterance allocation costs.  After calling this for a
+  /// non-initial utterance of a speaker, you may want to call
+  /// SetAdaptationState(), just as after the constructor.
+  void Reset();
+
+  /// Returns the part of the pipeline that produces the raw MFCC/PLP/
+  /// filterbank features, before any pitch or iVector augmentation; this is
+  /// what you want for things (like energy-based voice activity detection)
+  /// that need the log-energy in the first coefficient.  The pointer is
+  /// owned here and is valid for the lifetime of this object.
+  OnlineFeatureInterface *InputFeature() const { return base_feature_; }
+
   virtual ~OnlineNnet2FeaturePipeline();
  private:
 
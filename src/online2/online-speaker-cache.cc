@@ -0,0 +1,146 @@
+// online2/online-speaker-cache.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "online2/online-speaker-cache.h"
+
+#include <ctime>
+
+namespace kaldi {
+
+SpeakerProfileCache::SpeakerProfileCache(
+    const SpeakerProfileCacheConfig &config): config_(config), tick_(0) {
+  if (!config_.snapshot_rxfilename.empty()) {
+    bool binary;
+    Input ki(config_.snapshot_rxfilename, &binary);
+    std::istream &is = ki.Stream();
+    ExpectToken(is, binary, "<SpeakerProfileCache>");
+    int32 num_profiles;
+    ReadBasicType(is, binary, &num_profiles);
+    for (int32 i = 0; i < num_profiles; i++) {
+      std::string speaker_id;
+      ReadToken(is, binary, &speaker_id);
+      Entry &entry = profiles_[speaker_id];
+      ReadBasicType(is, binary, &entry.last_used);
+      entry.last_used_tick = tick_++;
+      entry.state.Read(is, binary);
+    }
+    ExpectToken(is, binary, "</SpeakerProfileCache>");
+    KALDI_LOG << "Read snapshot of " << num_profiles << " speaker profiles "
+              << "from " << config_.snapshot_rxfilename;
+    EvictIfNeeded();  // in case the config allows fewer than the snapshot.
+  }
+}
+
+bool SpeakerProfileCache::GetProfile(const std::string &speaker_id,
+                                     OnlineGmmAdaptationState *state) {
+  KALDI_ASSERT(state != NULL);
+  double now = static_cast<double>(std::time(NULL));
+  mutex_.Lock();
+  std::map<std::string, Entry>::iterator iter = profiles_.find(speaker_id);
+  if (iter == profiles_.end()) {
+    mutex_.Unlock();
+    return false;
+  }
+  if (config_.ttl_seconds > 0.0 &&
+      now - iter->second.last_used > config_.ttl_seconds) {
+    profiles_.erase(iter);
+    mutex_.Unlock();
+    KALDI_VLOG(2) << "Cached profile for speaker " << speaker_id
+                  << " had expired.";
+    return false;
+  }
+  iter->second.last_used = now;
+  iter->second.last_used_tick = tick_++;
+  *state = iter->second.state;
+  mutex_.Unlock();
+  return true;
+}
+
+void SpeakerProfileCache::SetProfile(const std::string &speaker_id,
+                                     const OnlineGmmAdaptationState &state) {
+  if (speaker_id.find_first_of(" \t\n\r") != std::string::npos ||
+      speaker_id.empty())
+    KALDI_ERR << "Invalid speaker-id '" << speaker_id
+              << "' (must be nonempty, without whitespace)";
+  double now = static_cast<double>(std::time(NULL));
+  mutex_.Lock();
+  Entry &entry = profiles_[speaker_id];
+  entry.state = state;
+  entry.last_used = now;
+  entry.last_used_tick = tick_++;
+  EvictIfNeeded();
+  mutex_.Unlock();
+}
+
+bool SpeakerProfileCache::InitPipeline(const std::string &speaker_id,
+                                       OnlineFeaturePipeline *pipeline) {
+  KALDI_ASSERT(pipeline != NULL);
+  OnlineGmmAdaptationState state;
+  if (!GetProfile(speaker_id, &state))
+    return false;
+  pipeline->SetCmvnState(state.cmvn_state);
+  if (state.transform.NumRows() != 0)
+    pipeline->SetTransform(state.transform);
+  return true;
+}
+
+int32 SpeakerProfileCache::NumProfiles() const {
+  mutex_.Lock();
+  int32 ans = profiles_.size();
+  mutex_.Unlock();
+  return ans;
+}
+
+void SpeakerProfileCache::WriteSnapshot(
+    const std::string &snapshot_wxfilename) const {
+  mutex_.Lock();
+  bool binary = true;
+  Output ko(snapshot_wxfilename, binary);
+  std::ostream &os = ko.Stream();
+  WriteToken(os, binary, "<SpeakerProfileCache>");
+  int32 num_profiles = profiles_.size();
+  WriteBasicType(os, binary, num_profiles);
+  for (std::map<std::string, Entry>::const_iterator iter = profiles_.begin();
+       iter != profiles_.end(); ++iter) {
+    WriteToken(os, binary, iter->first);
+    WriteBasicType(os, binary, iter->second.last_used);
+    iter->second.state.Write(os, binary);
+  }
+  WriteToken(os, binary, "</SpeakerProfileCache>");
+  mutex_.Unlock();
+  KALDI_LOG << "Wrote snapshot of " << num_profiles << " speaker profiles "
+            << "to " << snapshot_wxfilename;
+}
+
+void SpeakerProfileCache::EvictIfNeeded() {
+  if (config_.max_speakers <= 0)
+    return;
+  while (static_cast<int32>(profiles_.size()) > config_.max_speakers) {
+    std::map<std::string, Entry>::iterator oldest = profiles_.begin();
+    for (std::map<std::string, Entry>::iterator iter = profiles_.begin();
+         iter != profiles_.end(); ++iter)
+      if (iter->second.last_used_tick < oldest->second.last_used_tick)
+        oldest = iter;
+    KALDI_VLOG(2) << "Evicting least-recently-used profile of speaker "
+                  << oldest->first;
+    profiles_.erase(oldest);
+  }
+}
+
+}  // namespace kaldi
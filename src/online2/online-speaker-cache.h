@@ -0,0 +1,139 @@
+// online2/online-speaker-cache.h
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_ONLINE2_ONLINE_SPEAKER_CACHE_H_
+#define KALDI_ONLINE2_ONLINE_SPEAKER_CACHE_H_
+
+#include <map>
+#include <string>
+
+#include "base/kaldi-common.h"
+#include "util/common-utils.h"
+#include "thread/kaldi-mutex.h"
+#include "online2/online-feature-pipeline.h"
+#include "online2/online-gmm-decoding.h"
+
+namespace kaldi {
+/// @addtogroup  onlinedecoding OnlineDecoding
+/// @{
+
+/// This header provides a cache of per-speaker adaptation profiles (CMVN
+/// state and fMLLR transform, i.e. OnlineGmmAdaptationState) for
+/// long-running online decoding servers that see many speakers coming and
+/// going.  Without it, each application has to plumb the adaptation state
+/// between utterances by hand and invent its own storage; with it, you call
+/// InitPipeline() with the speaker-id when an utterance starts (which
+/// warm-starts the CMVN, skipping the stats bootstrap and helping
+/// first-utterance accuracy), and SetProfile() when it ends.  The cache is
+/// guarded by a mutex so decoding threads can share one instance; it evicts
+/// the least-recently-used speaker beyond a configurable size, can expire
+/// profiles by age, and can write/read a snapshot of itself so a server
+/// restart does not lose the profiles.
+
+struct SpeakerProfileCacheConfig {
+  /// Maximum number of speakers to keep; beyond this the least recently
+  /// used is evicted.  Zero or negative means no limit.
+  int32 max_speakers;
+  /// Profiles not used for this many seconds are treated as absent (and
+  /// removed when encountered).  Zero or negative means no expiry.
+  BaseFloat ttl_seconds;
+  /// If nonempty, a snapshot previously written with WriteSnapshot() is
+  /// read from here on construction (missing file is an error; empty string
+  /// means start empty).
+  std::string snapshot_rxfilename;
+
+  SpeakerProfileCacheConfig(): max_speakers(100), ttl_seconds(0.0),
+                               snapshot_rxfilename("") { }
+
+  void Register(OptionsItf *opts) {
+    opts->Register("max-speakers", &max_speakers, "Maximum number of "
+                   "speaker profiles to cache; the least recently used one "
+                   "is evicted beyond this (<= 0 means no limit).");
+    opts->Register("ttl-seconds", &ttl_seconds, "Expire cached speaker "
+                   "profiles not used for this many seconds (<= 0 means "
+                   "never expire).");
+    opts->Register("snapshot-rxfilename", &snapshot_rxfilename, "If set, "
+                   "read a previously written snapshot of the speaker "
+                   "profile cache from this (extended) filename on startup.");
+  }
+};
+
+
+class SpeakerProfileCache {
+ public:
+  /// Reads the snapshot named in the config, if any.
+  explicit SpeakerProfileCache(const SpeakerProfileCacheConfig &config);
+
+  /// If we have a non-expired profile for this speaker, outputs it to
+  /// "state" and returns true (this counts as a use, for the LRU and TTL);
+  /// else returns false and leaves "state" untouched.
+  bool GetProfile(const std::string &speaker_id,
+                  OnlineGmmAdaptationState *state);
+
+  /// Stores (or replaces) the profile for this speaker; you would normally
+  /// call this at the end of each utterance, with the state obtained from
+  /// SingleUtteranceGmmDecoder::GetAdaptationState().
+  void SetProfile(const std::string &speaker_id,
+                  const OnlineGmmAdaptationState &state);
+
+  /// Convenience function to be called right after constructing a feature
+  /// pipeline for a new utterance: if we have a profile for this speaker,
+  /// sets the pipeline's CMVN state and (if one has been estimated) its
+  /// fMLLR transform from it and returns true; else leaves the pipeline at
+  /// its defaults and returns false.
+  bool InitPipeline(const std::string &speaker_id,
+                    OnlineFeaturePipeline *pipeline);
+
+  /// Returns the number of cached profiles (expired ones that have not yet
+  /// been encountered and removed are counted).
+  int32 NumProfiles() const;
+
+  /// Writes a snapshot of the cache (profiles and their last-used times) to
+  /// this (extended) filename, from which a later process can restore it
+  /// via the config; binary mode.
+  void WriteSnapshot(const std::string &snapshot_wxfilename) const;
+
+ private:
+  struct Entry {
+    OnlineGmmAdaptationState state;
+    double last_used;  // wall-clock time (seconds since epoch) of the last
+                       // Get/SetProfile; used for the TTL and the snapshot.
+    int64 last_used_tick;  // value of tick_ at the last use; used for the
+                           // LRU ordering (finer-grained than last_used).
+  };
+
+  /// Removes the least-recently-used entries while we are over
+  /// config_.max_speakers; called with the mutex held.  This is a linear
+  /// scan, which is fine for the cache sizes this is meant for (hundreds of
+  /// speakers); it runs only on insertion of a new speaker.
+  void EvictIfNeeded();
+
+  SpeakerProfileCacheConfig config_;
+  mutable Mutex mutex_;  // guards profiles_ and tick_.
+  std::map<std::string, Entry> profiles_;
+  int64 tick_;  // incremented on each use, for the LRU ordering.
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(SpeakerProfileCache);
+};
+
+
+/// @} End of "addtogroup onlinedecoding"
+}  // namespace kaldi
+
+#endif  // KALDI_ONLINE2_ONLINE_SPEAKER_CACHE_H_
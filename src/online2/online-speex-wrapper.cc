@@ -17,13 +17,14 @@
 // See the Apache 2 License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <cstring>
 #include "online-speex-wrapper.h"
 
 namespace kaldi {
 
 OnlineSpeexEncoder::OnlineSpeexEncoder(const SpeexOptions &config):
- input_finished_(false) {
+ buffer_dim_(0), input_finished_(false) {
   speex_frame_size_ = config.speex_bits_frame_size;
   speex_encoded_frame_size_ = config.speex_wave_frame_size;
   sample_rate_ = config.sample_rate;
@@ -64,92 +65,73 @@ void OnlineSpeexEncoder::AcceptWaveform(
               << sample_rate_ << ", got " << sample_rate;
   }
 
-  Vector<BaseFloat> appended_wave;
-  const VectorBase<BaseFloat> &wave_to_use = (waveform_remainder_.Dim() != 0 ?
-                                              appended_wave : waveform);
-  if (waveform_remainder_.Dim() != 0) {
-    appended_wave.Resize(waveform_remainder_.Dim() +
-                         waveform.Dim());
-    appended_wave.Range(0, waveform_remainder_.Dim()).CopyFromVec(
-        waveform_remainder_);
-    appended_wave.Range(waveform_remainder_.Dim(),
-                        waveform.Dim()).CopyFromVec(waveform);
+  int32 new_dim = buffer_dim_ + waveform.Dim();
+  if (new_dim > waveform_buffer_.Dim()) {
+    // Grow the buffer (at least doubling it, so repeated small chunks don't
+    // cause repeated re-allocation); we never shrink it.
+    waveform_buffer_.Resize(std::max(new_dim, 2 * waveform_buffer_.Dim()),
+                            kCopyData);
   }
-  waveform_remainder_.Resize(0);
+  waveform_buffer_.Range(buffer_dim_, waveform.Dim()).CopyFromVec(waveform);
+  buffer_dim_ = new_dim;
 
-  std::vector<char> spx_bits;
-  Encode(wave_to_use, &spx_bits);
-
-  if (spx_bits.size() > 0) {
-    speex_encoded_char_bits_.insert(speex_encoded_char_bits_.end(),
-                                    spx_bits.begin(), spx_bits.end());
-  }
+  EncodeBuffered(false);
 }
 
 // Deal with the last frame, pad zeros
 void OnlineSpeexEncoder::InputFinished() {
   input_finished_ = true;
+  EncodeBuffered(true);  // encodes the final partial frame, if there is one,
+                         // after padding it with zeros.
+}
 
-  int32 dim = waveform_remainder_.Dim();
-  if (dim != 0) {
-    KALDI_ASSERT(dim <= speex_encoded_frame_size_);
-    Vector<BaseFloat> wave_last(speex_encoded_frame_size_);
-    std::vector<char> spx_bits;
-    wave_last.Range(0, dim).CopyFromVec(waveform_remainder_);
-    Encode(wave_last, &spx_bits);
-
-    speex_encoded_char_bits_.insert(speex_encoded_char_bits_.end(),
-                                    spx_bits.begin(), spx_bits.end());
+void OnlineSpeexEncoder::EncodeBuffered(bool flush) {
+  int32 frame_size = speex_encoded_frame_size_,
+      num_frames = buffer_dim_ / frame_size,
+      leftover = buffer_dim_ - num_frames * frame_size;
+
+  // Encode all complete frames in the buffer in one batch; reserving the
+  // output space up front means the per-frame work is just the codec call
+  // plus one append.
+  if (num_frames > 0) {
+    speex_encoded_char_bits_.reserve(speex_encoded_char_bits_.size() +
+                                     num_frames * speex_frame_size_);
+    for (int32 f = 0; f < num_frames; f++)
+      EncodeFrame(waveform_buffer_.Data() + f * frame_size);
+    if (leftover > 0) {
+      // move the leftover partial frame to the start of the buffer.  The
+      // ranges cannot overlap, because leftover < frame_size <=
+      // num_frames * frame_size.
+      waveform_buffer_.Range(0, leftover).CopyFromVec(
+          waveform_buffer_.Range(num_frames * frame_size, leftover));
+    }
   }
-}
+  buffer_dim_ = leftover;
 
-void OnlineSpeexEncoder::Encode(const VectorBase<BaseFloat> &wave,
- std::vector<char> *speex_encoder_bits) {
-  if (wave.Dim() == 0) {
-    return;
+  if (flush && leftover > 0) {
+    Vector<BaseFloat> wave_last(frame_size);  // zero padding.
+    wave_last.Range(0, leftover).CopyFromVec(
+        waveform_buffer_.Range(0, leftover));
+    EncodeFrame(wave_last.Data());
+    buffer_dim_ = 0;
   }
+}
 
-  int32 to_encode = wave.Dim();
-  int32 has_encode = 0;
+void OnlineSpeexEncoder::EncodeFrame(BaseFloat *frame_data) {
   char cbits[200];
-  std::vector<char> encoded_bits;
-  while (to_encode > speex_encoded_frame_size_) {
-    SubVector<BaseFloat> wave_frame(wave, has_encode,
-      speex_encoded_frame_size_);
-    int32 nbytes = 0;
+  int32 nbytes = 0;
 #ifdef HAVE_SPEEX
-    speex_bits_reset(&speex_bits_);
-    speex_encode(speex_state_, wave_frame.Data(), &speex_bits_);
-    nbytes = speex_bits_nbytes(&speex_bits_);
-    if (nbytes != speex_frame_size_) {
-      KALDI_ERR << "The number of bytes of Speex encoded frame mismatch,"
-        << "expected " << speex_frame_size_ << ", got " << nbytes;
-    }
-    nbytes = speex_bits_write(&speex_bits_, cbits, 200);
+  speex_bits_reset(&speex_bits_);
+  speex_encode(speex_state_, frame_data, &speex_bits_);
+  nbytes = speex_bits_nbytes(&speex_bits_);
+  if (nbytes != speex_frame_size_) {
+    KALDI_ERR << "The number of bytes of Speex encoded frame mismatch,"
+      << "expected " << speex_frame_size_ << ", got " << nbytes;
+  }
+  nbytes = speex_bits_write(&speex_bits_, cbits, 200);
 #endif
-
-    int32 encoded_bits_len = encoded_bits.size();
-    encoded_bits.resize(encoded_bits_len + nbytes);
-    for (int32 i = 0; i < nbytes; i++) {
-      encoded_bits[i+encoded_bits_len] = cbits[i];
-    }
-
-    has_encode += speex_encoded_frame_size_;
-    to_encode -= speex_encoded_frame_size_;
-  }
-
-  if (to_encode > 0) {
-    SubVector<BaseFloat> wave_left(wave, has_encode, to_encode);
-    int32 dim = waveform_remainder_.Dim();
-    if (dim != 0) {
-      waveform_remainder_.Resize(dim + to_encode, kCopyData);
-      waveform_remainder_.Range(dim, to_encode).CopyFromVec(wave_left);
-    } else {
-      waveform_remainder_ = wave_left;
-    }
-  }
-
-  *speex_encoder_bits = encoded_bits;
+  speex_encoded_char_bits_.insert(speex_encoded_char_bits_.end(),
+                                  cbits, cbits + nbytes);
 }
 
 
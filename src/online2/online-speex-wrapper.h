@@ -93,7 +93,12 @@ class OnlineSpeexEncoder {
 #endif
     SPEEXBITS speex_bits_;
 
-    Vector<BaseFloat> waveform_remainder_;      // Holds the waveform that have not been processed
+    // Holds the waveform that has not been encoded yet; only the first
+    // buffer_dim_ elements are meaningful.  The buffer is kept across calls to
+    // AcceptWaveform() and only ever grows, so that once the chunk size has
+    // stabilized we don't re-allocate per chunk.
+    Vector<BaseFloat> waveform_buffer_;
+    int32 buffer_dim_;
 
     // Holds the Speex-encoded char bits, will be peaked by GetSpeexBits().
     // We use a vector container rather than a char-type pointer because
@@ -103,8 +108,15 @@ class OnlineSpeexEncoder {
     BaseFloat sample_rate_;
     bool input_finished_;
 
-    void Encode(const VectorBase<BaseFloat> &wave,
-                std::vector<char> *speex_encoder_bits) ;
+    // Encodes all complete frames currently in waveform_buffer_, appending
+    // their bits to speex_encoded_char_bits_ and keeping any partial frame at
+    // the start of the buffer; if flush == true, the partial frame is padded
+    // with zeros and encoded too (this is used from InputFinished()).
+    void EncodeBuffered(bool flush);
+
+    // Encodes one frame of speex_wave_frame_size samples, appending its bits
+    // to speex_encoded_char_bits_.
+    void EncodeFrame(BaseFloat *frame_data);
 };
 
 class OnlineSpeexDecoder {
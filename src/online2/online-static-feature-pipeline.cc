@@ -0,0 +1,116 @@
+// online2/online-static-feature-pipeline.cc
+
+// Copyright 2015   Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "online2/online-static-feature-pipeline.h"
+
+namespace kaldi {
+
+template<class C>
+StaticFeaturePipeline<C>::StaticFeaturePipeline(
+    const typename C::Options &base_opts,
+    const OnlineCmvnOptions &cmvn_opts,
+    const OnlineCmvnState &cmvn_state,
+    const OnlineSpliceOptions &splice_opts,
+    const MatrixBase<BaseFloat> &lda_mat):
+    base_feature_(base_opts),
+    cmvn_(cmvn_opts, cmvn_state, &base_feature_),
+    left_context_(splice_opts.left_context),
+    right_context_(splice_opts.right_context),
+    frame_shift_seconds_(base_opts.frame_opts.frame_shift_ms / 1000.0f),
+    num_cmvn_frames_(0) {
+  KALDI_ASSERT(left_context_ >= 0 && right_context_ >= 0);
+  int32 spliced_dim =
+      base_feature_.Dim() * (1 + left_context_ + right_context_);
+  if (lda_mat.NumCols() == spliced_dim) {  // Linear transform
+    linear_term_ = lda_mat;
+    offset_.Resize(lda_mat.NumRows());  // Resize() will zero it.
+  } else if (lda_mat.NumCols() == spliced_dim + 1) {  // Affine transform
+    linear_term_ = lda_mat.Range(0, lda_mat.NumRows(), 0, spliced_dim);
+    offset_.Resize(lda_mat.NumRows());
+    offset_.CopyColFromMat(lda_mat, spliced_dim);
+  } else {
+    KALDI_ERR << "Dimension mismatch: spliced features have dimension "
+              << spliced_dim << " and LDA #cols is " << lda_mat.NumCols();
+  }
+  spliced_.Resize(spliced_dim);
+}
+
+template<class C>
+int32 StaticFeaturePipeline<C>::NumFramesReady() const {
+  // The CMVN stage does not introduce latency, so this is the same rule as
+  // in OnlineSpliceFrames::NumFramesReady().
+  int32 num_frames = base_feature_.NumFramesReady();
+  if (num_frames > 0 && base_feature_.IsLastFrame(num_frames - 1))
+    return num_frames;
+  else
+    return std::max<int32>(0, num_frames - right_context_);
+}
+
+template<class C>
+void StaticFeaturePipeline<C>::EnsureCmvnComputed(int32 frame) {
+  if (frame < num_cmvn_frames_)
+    return;
+  int32 dim = cmvn_.Dim();
+  if (frame >= cmvn_feats_.NumRows()) {
+    int32 new_num_rows = std::max<int32>(frame + 1,
+                                         cmvn_feats_.NumRows() * 2);
+    cmvn_feats_.Resize(new_num_rows, dim, kCopyData);
+  }
+  // Computing the frames in order is the access pattern OnlineCmvn's
+  // internal caching is designed for.
+  for (; num_cmvn_frames_ <= frame; num_cmvn_frames_++) {
+    SubVector<BaseFloat> row(cmvn_feats_, num_cmvn_frames_);
+    cmvn_.GetFrame(num_cmvn_frames_, &row);
+  }
+}
+
+template<class C>
+void StaticFeaturePipeline<C>::GetFrame(int32 frame,
+                                        VectorBase<BaseFloat> *feat) {
+  KALDI_ASSERT(frame >= 0 && frame < NumFramesReady());
+  KALDI_ASSERT(feat->Dim() == Dim());
+  int32 dim_in = cmvn_.Dim(),
+      T = cmvn_.NumFramesReady();
+  EnsureCmvnComputed(std::min<int32>(frame + right_context_, T - 1));
+  for (int32 t2 = frame - left_context_; t2 <= frame + right_context_; t2++) {
+    int32 t2_limited = t2;
+    if (t2_limited < 0) t2_limited = 0;
+    if (t2_limited >= T) t2_limited = T - 1;
+    int32 n = t2 - (frame - left_context_);  // 0 for left-most frame,
+                                             // increases to the right.
+    spliced_.Range(n * dim_in, dim_in).CopyFromVec(
+        cmvn_feats_.Row(t2_limited));
+  }
+  feat->CopyFromVec(offset_);
+  feat->AddMatVec(1.0, linear_term_, kNoTrans, spliced_, 1.0);
+}
+
+template<class C>
+void StaticFeaturePipeline<C>::GetCmvnState(OnlineCmvnState *cmvn_state) {
+  int32 frame = cmvn_.NumFramesReady() - 1;
+  // the following call will crash if no frames are ready.
+  cmvn_.GetState(frame, cmvn_state);
+}
+
+// instantiate the templates defined here for the types we need:
+template class StaticFeaturePipeline<Mfcc>;
+template class StaticFeaturePipeline<Plp>;
+template class StaticFeaturePipeline<Fbank>;
+
+}  // namespace kaldi
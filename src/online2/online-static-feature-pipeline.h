@@ -0,0 +1,131 @@
+// online2/online-static-feature-pipeline.h
+
+// Copyright 2015   Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef KALDI_ONLINE2_ONLINE_STATIC_FEATURE_PIPELINE_H_
+#define KALDI_ONLINE2_ONLINE_STATIC_FEATURE_PIPELINE_H_
+
+#include <string>
+#include <vector>
+
+#include "matrix/matrix-lib.h"
+#include "util/common-utils.h"
+#include "base/kaldi-error.h"
+#include "feat/online-feature.h"
+
+namespace kaldi {
+/// @addtogroup  onlinefeat OnlineFeatureExtraction
+/// @{
+
+/// StaticFeaturePipeline is a compile-time-composed version of the common
+/// MFCC/PLP/fbank -> CMVN -> splicing -> LDA (or LDA+MLLT) feature chain that
+/// OnlineFeaturePipeline builds out of separate objects connected through the
+/// virtual OnlineFeatureInterface.  The generic pipeline crosses a virtual
+/// GetFrame() boundary at every stage of every frame and materializes the
+/// spliced vector as a separate intermediate; here the stages are concrete
+/// members of one object, each CMVN-normalized frame is computed once and
+/// cached (like OnlineCacheFeature would do), and splicing plus the LDA
+/// transform are applied together as a single matrix-vector product directly
+/// from that cache.  This matters when you are running very many concurrent
+/// streams and per-frame overhead adds up.
+///
+/// It produces exactly the same features as the chain
+/// OnlineGenericBaseFeature<C> -> OnlineCmvn -> OnlineSpliceFrames ->
+/// OnlineTransform.  It does not attempt to be configurable the way
+/// OnlineFeaturePipeline is: no pitch, no deltas, no fMLLR, and the LDA
+/// matrix is required; if you need those, use OnlineFeaturePipeline.
+template<class C>  // e.g. C == Mfcc, Plp or Fbank.
+class StaticFeaturePipeline: public OnlineFeatureInterface {
+ public:
+  /// "lda_mat" may be a linear transform (#cols == spliced dimension) or an
+  /// affine one (#cols == spliced dimension + 1, last column the offset),
+  /// as accepted by OnlineTransform.  If you don't have previous utterances
+  /// from this speaker, initialize "cmvn_state" from global CMVN stats.
+  StaticFeaturePipeline(const typename C::Options &base_opts,
+                        const OnlineCmvnOptions &cmvn_opts,
+                        const OnlineCmvnState &cmvn_state,
+                        const OnlineSpliceOptions &splice_opts,
+                        const MatrixBase<BaseFloat> &lda_mat);
+
+  /// Member functions from OnlineFeatureInterface:
+  virtual int32 Dim() const { return offset_.Dim(); }
+  virtual bool IsLastFrame(int32 frame) const {
+    return base_feature_.IsLastFrame(frame);
+  }
+  virtual int32 NumFramesReady() const;
+  virtual void GetFrame(int32 frame, VectorBase<BaseFloat> *feat);
+
+  /// Accept more waveform data to process; as with
+  /// OnlineGenericBaseFeature, sampling_rate is only used to check
+  /// that it matches what is in the config.
+  void AcceptWaveform(BaseFloat sampling_rate,
+                      const VectorBase<BaseFloat> &waveform) {
+    base_feature_.AcceptWaveform(sampling_rate, waveform);
+  }
+
+  /// Tells the class you won't be providing any more waveform; flushes out
+  /// the last few frames of features.
+  void InputFinished() { base_feature_.InputFinished(); }
+
+  BaseFloat FrameShiftInSeconds() const { return frame_shift_seconds_; }
+
+  /// Outputs the CMVN state, e.g. to carry over to the next utterance of
+  /// this speaker (see the initializer of class OnlineCmvn).
+  void GetCmvnState(OnlineCmvnState *cmvn_state);
+
+ private:
+  /// Makes sure rows 0 through "frame" of cmvn_feats_ contain the
+  /// CMVN-normalized base features.
+  void EnsureCmvnComputed(int32 frame);
+
+  // Note: cmvn_ reads from base_feature_, so the declaration order below
+  // matters.
+  OnlineGenericBaseFeature<C> base_feature_;
+  OnlineCmvn cmvn_;
+
+  int32 left_context_;
+  int32 right_context_;
+  BaseFloat frame_shift_seconds_;
+
+  // The LDA transform, with any offset column split off, as in
+  // OnlineTransform.
+  Matrix<BaseFloat> linear_term_;
+  Vector<BaseFloat> offset_;
+
+  // Cache of CMVN-normalized base features; row r contains frame r.  Like
+  // features_ in OnlineGenericBaseFeature it may have more rows than
+  // num_cmvn_frames_, because we leave extra room when resizing.
+  Matrix<BaseFloat> cmvn_feats_;
+  int32 num_cmvn_frames_;  // number of valid rows of cmvn_feats_.
+
+  // Pre-allocated buffer that the context frames are gathered into before
+  // the single multiply by linear_term_.
+  Vector<BaseFloat> spliced_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(StaticFeaturePipeline);
+};
+
+typedef StaticFeaturePipeline<Mfcc> StaticMfccPipeline;
+typedef StaticFeaturePipeline<Plp> StaticPlpPipeline;
+typedef StaticFeaturePipeline<Fbank> StaticFbankPipeline;
+
+/// @} End of "addtogroup onlinefeat"
+}  // namespace kaldi
+
+#endif  // KALDI_ONLINE2_ONLINE_STATIC_FEATURE_PIPELINE_H_
@@ -0,0 +1,91 @@
+// online2/online-vad.cc
+
+// Copyright 2015   Johns Hopkins University (Author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "online2/online-vad.h"
+
+namespace kaldi {
+
+OnlineVad::OnlineVad(const VadEnergyOptions &opts,
+                     OnlineFeatureInterface *src):
+    opts_(opts), src_(src), energy_sum_(0.0) {
+  KALDI_ASSERT(opts_.vad_frames_context >= 0);
+  KALDI_ASSERT(opts_.vad_proportion_threshold > 0.0 &&
+               opts_.vad_proportion_threshold < 1.0);
+}
+
+void OnlineVad::UpdateEnergies(int32 frame_limit) {
+  int32 num_seen = static_cast<int32>(log_energy_.size());
+  if (frame_limit <= num_seen)
+    return;
+  Vector<BaseFloat> feat(src_->Dim());
+  for (int32 t = num_seen; t < frame_limit; t++) {
+    src_->GetFrame(t, &feat);
+    log_energy_.push_back(feat(0));
+    energy_sum_ += feat(0);
+  }
+}
+
+bool OnlineVad::IsVoiced(int32 frame) {
+  int32 num_frames = src_->NumFramesReady(),
+      context = opts_.vad_frames_context;
+  KALDI_ASSERT(frame >= 0 && frame < num_frames);
+  int32 window_end = std::min(frame + context, num_frames - 1);
+  UpdateEnergies(window_end + 1);
+
+  BaseFloat energy_threshold = opts_.vad_energy_threshold;
+  if (opts_.vad_energy_mean_scale != 0.0) {
+    KALDI_ASSERT(opts_.vad_energy_mean_scale > 0.0);
+    // Note: unlike ComputeVadEnergy(), which can use the mean log-energy of
+    // the whole file, here we only have the frames seen so far.
+    energy_threshold += opts_.vad_energy_mean_scale * energy_sum_ /
+        log_energy_.size();
+  }
+  int32 num_count = 0, den_count = 0;
+  for (int32 t2 = frame - context; t2 <= window_end; t2++) {
+    if (t2 >= 0) {
+      den_count++;
+      if (log_energy_[t2] > energy_threshold)
+        num_count++;
+    }
+  }
+  return (num_count >= den_count * opts_.vad_proportion_threshold);
+}
+
+int32 VadGatedDecodable::EvalFrame(int32 frame) {
+  KALDI_ASSERT(frame >= 0 && frame < NumFramesReady());
+  for (int32 t = static_cast<int32>(eval_frame_.size()); t <= frame; t++) {
+    if (vad_->IsVoiced(t)) {
+      silence_run_ = 0;
+      eval_frame_.push_back(t);
+    } else {
+      silence_run_++;
+      if (silence_run_ > min_silence_frames_ && t > 0) {
+        // Bridge: borrow the scores of the last frame we evaluated (which,
+        // note, is itself an unvoiced frame, so this is fairly safe).
+        eval_frame_.push_back(eval_frame_[t - 1]);
+        num_frames_skipped_++;
+      } else {
+        eval_frame_.push_back(t);
+      }
+    }
+  }
+  return eval_frame_[frame];
+}
+
+}  // namespace kaldi
@@ -0,0 +1,153 @@
+// online2/online-vad.h
+
+// Copyright 2015   Johns Hopkins University (Author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_ONLINE2_ONLINE_VAD_H_
+#define KALDI_ONLINE2_ONLINE_VAD_H_
+
+#include <vector>
+
+#include "itf/online-feature-itf.h"
+#include "itf/decodable-itf.h"
+#include "ivector/voice-activity-detection.h"
+
+namespace kaldi {
+/// @addtogroup  onlinefeat OnlineFeatureExtraction
+/// @{
+
+/// OnlineVad is a streaming version of the energy-based voice activity
+/// detection of ComputeVadEnergy() (see ivector/voice-activity-detection.h).
+/// It wraps a source of features and passes them through unchanged, so it can
+/// be inserted as a stage of a feature pipeline; the extra functionality is
+/// IsVoiced(), which tags each frame as voiced or unvoiced as soon as its
+/// context window is available.  As with ComputeVadEnergy(), the first
+/// coefficient of the features is assumed to be a log-energy or something
+/// similar, and decisions are made independently per frame, so this is for
+/// things like gating computation, not for accurate speech/nonspeech
+/// segmentation.  Two streaming-related differences from the offline
+/// computation: the energy threshold uses the mean log-energy of the frames
+/// seen so far rather than of the whole file, and the context window of a
+/// frame near the end of the currently available features is truncated.
+class OnlineVad: public OnlineFeatureInterface {
+ public:
+  /// Constructor; "src" is not owned here and must outlive this object.
+  OnlineVad(const VadEnergyOptions &opts,
+            OnlineFeatureInterface *src);
+
+  /// Member functions from OnlineFeatureInterface; the features pass through
+  /// unchanged.
+  virtual int32 Dim() const { return src_->Dim(); }
+  virtual int32 NumFramesReady() const { return src_->NumFramesReady(); }
+  virtual bool IsLastFrame(int32 frame) const {
+    return src_->IsLastFrame(frame);
+  }
+  virtual void GetFrame(int32 frame, VectorBase<BaseFloat> *feat) {
+    src_->GetFrame(frame, feat);
+  }
+
+  /// Returns true if we judge this frame as voiced.  "frame" must be less
+  /// than NumFramesReady().  Note: because the decision uses whatever part of
+  /// the context window is available at the time, calling this again later
+  /// for the same frame may (rarely) give a different answer.
+  bool IsVoiced(int32 frame);
+
+  /// Discards the state of this utterance, as if freshly constructed (the
+  /// source, which is not owned here, must be reset separately).
+  void Reset() {
+    log_energy_.clear();
+    energy_sum_ = 0.0;
+  }
+
+ private:
+  // Reads the log-energies of any frames < frame_limit that we have not seen
+  // yet, into log_energy_.
+  void UpdateEnergies(int32 frame_limit);
+
+  VadEnergyOptions opts_;
+  OnlineFeatureInterface *src_;  // not owned here.
+  std::vector<BaseFloat> log_energy_;  // first feature coefficient of each
+                                       // frame seen so far.
+  double energy_sum_;  // sum of log_energy_, for the running mean.
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(OnlineVad);
+};
+
+
+/// VadGatedDecodable wraps a DecodableInterface so as to skip acoustic
+/// evaluation inside long silence regions, as judged by an OnlineVad over the
+/// same frames.  Once more than "min_silence_frames" consecutive frames have
+/// been tagged as unvoiced, subsequent unvoiced frames re-use the
+/// log-likelihoods of the last frame that was actually evaluated, bridging
+/// over the silence, so a decodable that computes its scores lazily (such as
+/// DecodableNnet2Online) never evaluates them.  The decoder still consumes
+/// every frame (dropping frames would break the frame indexing of the
+/// lattice), but for neural-net decodables the acoustic evaluation is the
+/// dominant cost.  Neither the VAD nor the decodable is owned here.
+class VadGatedDecodable: public DecodableInterface {
+ public:
+  VadGatedDecodable(int32 min_silence_frames,
+                    OnlineVad *vad,
+                    DecodableInterface *decodable):
+      min_silence_frames_(min_silence_frames), vad_(vad),
+      decodable_(decodable), silence_run_(0), num_frames_skipped_(0) {
+    KALDI_ASSERT(min_silence_frames >= 0);
+  }
+
+  virtual BaseFloat LogLikelihood(int32 frame, int32 index) {
+    return decodable_->LogLikelihood(EvalFrame(frame), index);
+  }
+  virtual bool IsLastFrame(int32 frame) const {
+    return decodable_->IsLastFrame(frame);
+  }
+  virtual int32 NumFramesReady() const { return decodable_->NumFramesReady(); }
+  virtual int32 NumIndices() const { return decodable_->NumIndices(); }
+
+  /// Returns the number of frames, so far, whose acoustic scores were
+  /// borrowed from an earlier frame (useful as a diagnostic).
+  int32 NumFramesSkipped() const { return num_frames_skipped_; }
+
+  /// Discards the state of this utterance, as if freshly constructed (the
+  /// VAD and decodable, which are not owned here, must be reset separately).
+  void Reset() {
+    eval_frame_.clear();
+    silence_run_ = 0;
+    num_frames_skipped_ = 0;
+  }
+
+ private:
+  // Returns the frame whose scores we use for this frame: the frame itself,
+  // except inside a bridged silence region.  The decision for each frame is
+  // made once, the first time we get to it, and then remembered.
+  int32 EvalFrame(int32 frame);
+
+  int32 min_silence_frames_;
+  OnlineVad *vad_;  // not owned here.
+  DecodableInterface *decodable_;  // not owned here.
+  std::vector<int32> eval_frame_;  // for each frame so far, the frame whose
+                                   // scores we use.
+  int32 silence_run_;  // number of consecutive unvoiced frames ending at the
+                       // last frame we made a decision for.
+  int32 num_frames_skipped_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(VadGatedDecodable);
+};
+
+/// @} End of "addtogroup onlinefeat"
+}  // namespace kaldi
+
+#endif  // KALDI_ONLINE2_ONLINE_VAD_H_
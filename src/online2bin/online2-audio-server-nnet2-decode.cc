@@ -0,0 +1,398 @@
+// online2bin/online2-audio-server-nnet2-decode.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "online2/online-nnet2-decoding-threaded.h"
+#include "online2/onlinebin-util.h"
+#include "fstext/fstext-lib.h"
+#include "lat/lattice-functions.h"
+#include "thread/kaldi-mutex.h"
+#include "thread/kaldi-semaphore.h"
+#include "thread/kaldi-thread-pool.h"
+#include "thread/kaldi-thread.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+namespace kaldi {
+
+// Reads exactly "size" bytes from the socket; returns false if the peer
+// disconnected (or errored) before that many bytes arrived.
+static bool ReadBlock(int32 socket, void *data, size_t size) {
+  char *p = static_cast<char*>(data);
+  size_t num_read = 0;
+  while (num_read < size) {
+    ssize_t ret = read(socket, p + num_read, size - num_read);
+    if (ret <= 0)
+      return false;
+    num_read += ret;
+  }
+  return true;
+}
+
+// Writes a line of text (adding '\n') to the socket; returns false on error.
+static bool WriteLine(int32 socket, const std::string &line_in) {
+  std::string line = line_in + "\n";
+  const char *p = line.c_str();
+  size_t num_written = 0;
+  while (num_written < line.size()) {
+    ssize_t ret = write(socket, p + num_written, line.size() - num_written);
+    if (ret <= 0)
+      return false;
+    num_written += ret;
+  }
+  return true;
+}
+
+/**
+   Nnet2DecodeServer serves many concurrent decoding sessions (one per TCP
+   connection) from a single process, so that the models, the decoding graph
+   and the worker threads are shared instead of paying the startup cost of a
+   one-shot binary per stream.  Each session runs on a thread from the
+   process-wide ThreadPool; per-session state (adaptation state, sample
+   buffers) is kept in a pool of Session objects that are reused across
+   connections, so steady-state traffic does no per-connection allocation of
+   anything large.
+
+   The wire protocol, designed to be trivial for clients (see also
+   onlinebin/online-audio-server-decode-faster which uses raw audio with no
+   framing): all integers are little-endian.  The client first sends the
+   sampling rate as int32.  Then, for each utterance, it sends chunks of
+   audio, each as an int32 sample count followed by that many int16 PCM
+   samples; a sample count of zero ends the utterance, upon which the server
+   sends back one '\n'-terminated text line containing the best-path word
+   sequence (words if a symbol table was supplied, integer ids otherwise).
+   The connection can carry any number of utterances; iVector adaptation
+   state carries over between utterances of the same connection, as it does
+   between utterances of the same speaker in online2-wav-nnet2-latgen-faster.
+   The client closes the connection to end the session.
+*/
+class Nnet2DecodeServer {
+ public:
+  Nnet2DecodeServer(const OnlineNnet2DecodingThreadedConfig &decoding_config,
+                    const TransitionModel &trans_model,
+                    const nnet2::AmNnet &am_nnet,
+                    const fst::Fst<fst::StdArc> &decode_fst,
+                    const OnlineNnet2FeaturePipelineInfo &feature_info,
+                    const fst::SymbolTable *word_syms,
+                    int32 max_sessions):
+      decoding_config_(decoding_config), trans_model_(trans_model),
+      am_nnet_(am_nnet), decode_fst_(decode_fst), feature_info_(feature_info),
+      word_syms_(word_syms),
+      pristine_adaptation_state_(feature_info.ivector_extractor_info),
+      max_sessions_(max_sessions), num_done_(0), num_interrupted_(0) { }
+
+  ~Nnet2DecodeServer() {
+    for (size_t i = 0; i < free_sessions_.size(); i++)
+      delete free_sessions_[i];
+  }
+
+  // Handles one connection, start to finish; runs on a worker thread.
+  // Closes the socket before returning.
+  void HandleSession(int32 socket) {
+    Session *session = AcquireSession();
+    int32 samp_freq_int;
+    if (ReadBlock(socket, &samp_freq_int, sizeof(samp_freq_int))) {
+      BaseFloat samp_freq = static_cast<BaseFloat>(samp_freq_int);
+      while (DecodeOneUtterance(socket, samp_freq, session))
+        ;
+    }
+    close(socket);
+    ReleaseSession(session);
+  }
+
+  int64 NumDone() const { return num_done_; }
+  int64 NumInterrupted() const { return num_interrupted_; }
+
+ private:
+  // Per-session state that is expensive to construct; pooled and reused
+  // across connections.
+  struct Session {
+    OnlineIvectorExtractorAdaptationState adaptation_state;
+    Vector<BaseFloat> chunk;       // reusable sample buffer.
+    std::vector<int16> raw_chunk;  // reusable wire-format buffer.
+    explicit Session(const OnlineIvectorExtractorAdaptationState &pristine):
+        adaptation_state(pristine) { }
+  };
+
+  Session *AcquireSession() {
+    Session *session = NULL;
+    stats_mutex_.Lock();
+    if (!free_sessions_.empty()) {
+      session = free_sessions_.back();
+      free_sessions_.pop_back();
+    }
+    stats_mutex_.Unlock();
+    if (session != NULL) {
+      // reset the speaker-specific part; the buffers keep their capacity.
+      session->adaptation_state = pristine_adaptation_state_;
+    } else {
+      session = new Session(pristine_adaptation_state_);
+    }
+    return session;
+  }
+
+  void ReleaseSession(Session *session) {
+    stats_mutex_.Lock();
+    if (static_cast<int32>(free_sessions_.size()) < max_sessions_) {
+      free_sessions_.push_back(session);
+      session = NULL;
+    }
+    stats_mutex_.Unlock();
+    delete session;  // only if the pool was full.
+  }
+
+  // Decodes a single utterance of the session: feeds chunks from the socket
+  // to a decoder until the zero-length end-of-utterance chunk, then writes
+  // the best-path text back.  Returns true if the session should continue
+  // with another utterance, false if the client disconnected.
+  bool DecodeOneUtterance(int32 socket, BaseFloat samp_freq,
+                          Session *session) {
+    SingleUtteranceNnet2DecoderThreaded decoder(
+        decoding_config_, trans_model_, am_nnet_, decode_fst_,
+        feature_info_, session->adaptation_state);
+    bool connected = true, got_data = false;
+    while (connected) {
+      int32 num_samp;
+      if (!ReadBlock(socket, &num_samp, sizeof(num_samp)) ||
+          num_samp < 0) {
+        connected = false;
+        break;
+      }
+      if (num_samp == 0) {  // end of utterance.
+        decoder.InputFinished();
+        break;
+      }
+      session->raw_chunk.resize(num_samp);
+      if (!ReadBlock(socket, &(session->raw_chunk[0]),
+                     num_samp * sizeof(int16))) {
+        connected = false;
+        break;
+      }
+      session->chunk.Resize(num_samp, kUndefined);
+      for (int32 i = 0; i < num_samp; i++)
+        session->chunk(i) = static_cast<BaseFloat>(session->raw_chunk[i]);
+      decoder.AcceptWaveform(samp_freq, session->chunk);
+      got_data = true;
+    }
+    if (!connected) {
+      decoder.TerminateDecoding();
+      decoder.Wait();
+      stats_mutex_.Lock();
+      num_interrupted_++;
+      stats_mutex_.Unlock();
+      return false;
+    }
+    decoder.Wait();
+    decoder.FinalizeDecoding();
+    std::string text;
+    if (got_data && decoder.NumFramesDecoded() > 0) {
+      Lattice best_path;
+      decoder.GetBestPath(true, &best_path, NULL);
+      GetTextFromBestPath(best_path, &text);
+    }
+    decoder.GetAdaptationState(&(session->adaptation_state));
+    stats_mutex_.Lock();
+    num_done_++;
+    stats_mutex_.Unlock();
+    return WriteLine(socket, text);
+  }
+
+  void GetTextFromBestPath(const Lattice &best_path, std::string *text) {
+    std::vector<int32> words;
+    GetLinearSymbolSequence(best_path, static_cast<std::vector<int32>*>(NULL),
+                            &words,
+                            static_cast<LatticeWeight*>(NULL));
+    std::ostringstream os;
+    for (size_t i = 0; i < words.size(); i++) {
+      if (i > 0) os << ' ';
+      if (word_syms_ != NULL) {
+        std::string s = word_syms_->Find(words[i]);
+        if (s == "")
+          KALDI_ERR << "Word-id " << words[i] << " not in symbol table.";
+        os << s;
+      } else {
+        os << words[i];
+      }
+    }
+    *text = os.str();
+  }
+
+  const OnlineNnet2DecodingThreadedConfig &decoding_config_;
+  const TransitionModel &trans_model_;
+  const nnet2::AmNnet &am_nnet_;
+  const fst::Fst<fst::StdArc> &decode_fst_;
+  const OnlineNnet2FeaturePipelineInfo &feature_info_;
+  const fst::SymbolTable *word_syms_;  // may be NULL.
+  const OnlineIvectorExtractorAdaptationState pristine_adaptation_state_;
+  int32 max_sessions_;
+
+  Mutex stats_mutex_;  // guards free_sessions_ and the counters.
+  std::vector<Session*> free_sessions_;
+  int64 num_done_;
+  int64 num_interrupted_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(Nnet2DecodeServer);
+};
+
+// Argument to SessionTask, below; heap-allocated per accepted connection
+// (this small allocation is the only per-connection one in steady state).
+struct SessionTaskArgs {
+  Nnet2DecodeServer *server;
+  int32 socket;
+  Semaphore *sessions_available;
+};
+
+// Runs one session on a ThreadPool worker thread.
+static void *SessionTask(void *args_in) {
+  SessionTaskArgs *args = static_cast<SessionTaskArgs*>(args_in);
+  args->server->HandleSession(args->socket);
+  args->sessions_available->Signal();
+  delete args;
+  return NULL;
+}
+
+}  // namespace kaldi
+
+int main(int argc, char *argv[]) {
+  try {
+    using namespace kaldi;
+    using namespace fst;
+
+    typedef kaldi::int32 int32;
+
+    const char *usage =
+        "Starts a TCP server that decodes raw audio with neural nets (nnet2\n"
+        "setup), serving many concurrent sessions from shared models.  One\n"
+        "connection is one session and may carry multiple utterances; see\n"
+        "the comment above class Nnet2DecodeServer in the source for the\n"
+        "wire protocol.  Note: some configuration values and inputs are set\n"
+        "via config files whose filenames are passed as options.\n"
+        "\n"
+        "Usage: online2-audio-server-nnet2-decode [options] <nnet2-in> "
+        "<fst-in> <tcp-port>\n"
+        "See also online2-wav-nnet2-latgen-threaded, "
+        "online-audio-server-decode-faster\n";
+
+    ParseOptions po(usage);
+
+    std::string word_syms_rxfilename;
+    int32 max_sessions = 128;
+
+    // feature_config includes configuration for the iVector adaptation,
+    // as well as the basic features.
+    OnlineNnet2FeaturePipelineConfig feature_config;
+    OnlineNnet2DecodingThreadedConfig nnet2_decoding_config;
+
+    po.Register("word-symbol-table", &word_syms_rxfilename,
+                "Symbol table for words; if not supplied, integer word-ids "
+                "are sent to clients");
+    po.Register("max-sessions", &max_sessions,
+                "Maximum number of concurrent sessions; further connections "
+                "wait in the listen queue until a session finishes");
+    po.Register("num-threads-startup", &g_num_threads,
+                "Number of threads used when initializing iVector extractor.");
+
+    feature_config.Register(&po);
+    nnet2_decoding_config.Register(&po);
+
+    po.Read(argc, argv);
+
+    if (po.NumArgs() != 3) {
+      po.PrintUsage();
+      return 1;
+    }
+
+    std::string nnet2_rxfilename = po.GetArg(1),
+        fst_rxfilename = po.GetArg(2);
+    int32 port;
+    if (!ConvertStringToInteger(po.GetArg(3), &port) || port <= 0)
+      KALDI_ERR << "Invalid TCP port " << po.GetArg(3);
+    KALDI_ASSERT(max_sessions > 0);
+
+    signal(SIGPIPE, SIG_IGN);  // a client may disconnect while we write.
+
+    OnlineNnet2FeaturePipelineInfo feature_info(feature_config);
+
+    TransitionModel trans_model;
+    nnet2::AmNnet am_nnet;
+    {
+      bool binary;
+      Input ki(nnet2_rxfilename, &binary);
+      trans_model.Read(ki.Stream(), binary);
+      am_nnet.Read(ki.Stream(), binary);
+    }
+
+    fst::Fst<fst::StdArc> *decode_fst = ReadFstKaldi(fst_rxfilename);
+
+    fst::SymbolTable *word_syms = NULL;
+    if (word_syms_rxfilename != "")
+      if (!(word_syms = fst::SymbolTable::ReadText(word_syms_rxfilename)))
+        KALDI_ERR << "Could not read symbol table from file "
+                  << word_syms_rxfilename;
+
+    Nnet2DecodeServer server(nnet2_decoding_config, trans_model, am_nnet,
+                             *decode_fst, feature_info, word_syms,
+                             max_sessions);
+
+    int32 server_socket = socket(AF_INET, SOCK_STREAM, 0);
+    if (server_socket == -1)
+      KALDI_ERR << "Cannot create TCP socket";
+    int32 flag = 1;
+    setsockopt(server_socket, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof(flag));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(port);
+    if (bind(server_socket, reinterpret_cast<struct sockaddr*>(&addr),
+             sizeof(addr)) == -1)
+      KALDI_ERR << "Cannot bind to port " << port << " (is it taken?)";
+    if (listen(server_socket, max_sessions) == -1)
+      KALDI_ERR << "Cannot listen on port " << port;
+    KALDI_LOG << "Listening on port " << port << ", serving up to "
+              << max_sessions << " concurrent sessions.";
+
+    Semaphore sessions_available(max_sessions);
+    while (true) {  // runs until killed.
+      int32 client_socket = accept(server_socket, NULL, NULL);
+      if (client_socket == -1) {
+        KALDI_WARN << "accept() failed.";
+        continue;
+      }
+      sessions_available.Wait();  // limits concurrent sessions.
+      SessionTaskArgs *args = new SessionTaskArgs();
+      args->server = &server;
+      args->socket = client_socket;
+      args->sessions_available = &sessions_available;
+      ThreadPool::Instance()->Submit(&SessionTask, args, NULL);
+    }
+
+    // not reached.
+    delete decode_fst;
+    delete word_syms;
+    return 0;
+  } catch(const std::exception &e) {
+    std::cerr << e.what();
+    return -1;
+  }
+}  // main()
@@ -99,13 +99,22 @@ int main(int argc, char *argv[]) {
     BaseFloat chunk_length_secs = 0.05;
     bool do_endpointing = false;
     std::string use_gpu = "no";
-    
+    std::string adaptation_state_in_rxfilename,
+        adaptation_state_out_wxfilename;
+
     po.Register("chunk-length", &chunk_length_secs,
                 "Length of chunk size in seconds, that we process.");
     po.Register("word-symbol-table", &word_syms_rxfilename,
                 "Symbol table for words [for debug output]");
     po.Register("do-endpointing", &do_endpointing,
                 "If true, apply endpoint detection");
+    po.Register("adaptation-state-in", &adaptation_state_in_rxfilename,
+                "If supplied, rxfilename of per-speaker adaptation state "
+                "(as written by --adaptation-state-out), used to warm-start "
+                "the adaptation of returning speakers.");
+    po.Register("adaptation-state-out", &adaptation_state_out_wxfilename,
+                "If supplied, wxfilename to which we write the per-speaker "
+                "adaptation state at the end.");
     
     feature_cmdline_config.Register(&po);
     decode_config.Register(&po);
@@ -137,6 +146,16 @@ int main(int argc, char *argv[]) {
         KALDI_ERR << "Could not read symbol table from file "
                   << word_syms_rxfilename;
     
+    OnlineGmmAdaptationStateStore adaptation_state_store;
+    if (adaptation_state_in_rxfilename != "") {
+      bool binary_in;
+      Input ki(adaptation_state_in_rxfilename, &binary_in);
+      adaptation_state_store.Read(ki.Stream(), binary_in);
+      KALDI_LOG << "Read adaptation state for "
+                << adaptation_state_store.NumSpeakers() << " speakers from "
+                << adaptation_state_in_rxfilename;
+    }
+
     int32 num_done = 0, num_err = 0;
     double tot_like = 0.0;
     int64 num_frames = 0;
@@ -151,6 +170,8 @@ int main(int argc, char *argv[]) {
       std::string spk = spk2utt_reader.Key();
       const std::vector<std::string> &uttlist = spk2utt_reader.Value();
       OnlineGmmAdaptationState adaptation_state;
+      // this is a no-op if we have no stored state for this speaker.
+      adaptation_state_store.GetState(spk, &adaptation_state);
       for (size_t i = 0; i < uttlist.size(); i++) {
         std::string utt = uttlist[i];
         if (!wav_reader.HasKey(utt)) {
@@ -221,6 +242,14 @@ int main(int argc, char *argv[]) {
         KALDI_LOG << "Decoded utterance " << utt;
         num_done++;
       }
+      adaptation_state_store.SetState(spk, adaptation_state);
+    }
+    if (adaptation_state_out_wxfilename != "") {
+      Output ko(adaptation_state_out_wxfilename, true);
+      adaptation_state_store.Write(ko.Stream(), true);
+      KALDI_LOG << "Wrote adaptation state for "
+                << adaptation_state_store.NumSpeakers() << " speakers to "
+                << adaptation_state_out_wxfilename;
     }
     timing_stats.Print();    
     KALDI_LOG << "Decoded " << num_done << " utterances, "
@@ -207,6 +207,8 @@ int main(int argc, char *argv[]) {
                                             nnet,
                                             *decode_fst,
                                             &feature_pipeline);
+        if (do_endpointing)
+          decoder.InitEndpointing(endpoint_config);
         OnlineTimer decoding_timer(utt);
         
         BaseFloat samp_freq = wave_data.SampFreq();
@@ -258,6 +258,81 @@ void TestSgmm2PreXform(const AmSgmm2 &sgmm) {
   KALDI_ASSERT(res_vec.IsZero(1.0e-5));
 }
 
+// Tests that substate pruning (Sgmm2LikelihoodCache::substate_mass < 1.0)
+// gives likelihoods close to the unpruned ones: the pruned likelihood can
+// be at most log(substate_mass) below the full one, and never above it by
+// more than rounding.
+void TestSgmm2SubstatePruning(const AmSgmm2 &sgmm) {
+  using namespace kaldi;
+  int32 target_substates = 4 * sgmm.NumPdfs();
+  kaldi::Vector<BaseFloat> occs(sgmm.NumPdfs());
+  for (int32 i = 0; i < occs.Dim(); i++)
+    occs(i) = std::fabs(kaldi::RandGauss()) * (kaldi::RandUniform()+1);
+  AmSgmm2 *sgmm1 = new AmSgmm2();
+  sgmm1->CopyFromSgmm2(sgmm, false, false);
+  Sgmm2SplitSubstatesConfig cfg;
+  cfg.split_substates = target_substates;
+  sgmm1->SplitSubstates(occs, cfg);
+  sgmm1->ComputeNormalizers();
+  sgmm1->ComputeWeights();
+
+  int32 dim = sgmm.FeatureDim();
+  kaldi::Sgmm2GselectConfig config;
+  config.full_gmm_nbest = std::min(config.full_gmm_nbest, sgmm.NumGauss());
+  BaseFloat substate_mass = 0.95;
+  for (int32 n = 0; n < 5; n++) {
+    kaldi::Vector<BaseFloat> feat(dim);
+    for (int32 d = 0; d < dim; d++)
+      feat(d) = kaldi::RandGauss();
+    std::vector<int32> gselect;
+    sgmm1->GaussianSelection(config, feat, &gselect);
+    Sgmm2PerSpkDerivedVars empty;
+    Sgmm2PerFrameDerivedVars per_frame;
+    sgmm1->ComputePerFrameVars(feat, gselect, empty, &per_frame);
+
+    Sgmm2LikelihoodCache full_cache(sgmm1->NumGroups(), sgmm1->NumPdfs()),
+        pruned_cache(sgmm1->NumGroups(), sgmm1->NumPdfs());
+    pruned_cache.substate_mass = substate_mass;
+    BaseFloat loglike = sgmm1->LogLikelihood(per_frame, 0, &full_cache,
+                                             &empty),
+        loglike_pruned = sgmm1->LogLikelihood(per_frame, 0, &pruned_cache,
+                                              &empty);
+    KALDI_ASSERT(loglike_pruned <= loglike + 1.0e-4);
+    // The bound below is deliberately loose: the shortlist mass is
+    // measured without the per-pdf substate weights, so the pruned
+    // likelihood can drop a little more than log(substate_mass).
+    KALDI_ASSERT(loglike_pruned >= loglike - 0.5);
+  }
+  delete sgmm1;
+}
+
+// Tests that ComputePerFrameVarsBatch() gives the same per-frame vars as
+// per-frame ComputePerFrameVars() (up to BLAS reassociation).
+void TestSgmm2PerFrameVarsBatch(const AmSgmm2 &sgmm) {
+  using namespace kaldi;
+  int32 dim = sgmm.FeatureDim(), num_frames = 1 + kaldi::RandInt(0, 19);
+  kaldi::Sgmm2GselectConfig config;
+  config.full_gmm_nbest = std::min(config.full_gmm_nbest, sgmm.NumGauss());
+
+  kaldi::Matrix<BaseFloat> feats(num_frames, dim);
+  feats.SetRandn();
+  std::vector<std::vector<int32> > gselect(num_frames);
+  for (int32 t = 0; t < num_frames; t++)
+    sgmm.GaussianSelection(config, feats.Row(t), &gselect[t]);
+
+  Sgmm2PerSpkDerivedVars empty;
+  std::vector<Sgmm2PerFrameDerivedVars> batch_vars;
+  sgmm.ComputePerFrameVarsBatch(feats, gselect, empty, &batch_vars);
+  Sgmm2PerFrameDerivedVars frame_vars;
+  for (int32 t = 0; t < num_frames; t++) {
+    sgmm.ComputePerFrameVars(feats.Row(t), gselect[t], empty, &frame_vars);
+    KALDI_ASSERT(batch_vars[t].gselect == gselect[t]);
+    kaldi::AssertEqual(frame_vars.xti, batch_vars[t].xti, 1e-5);
+    kaldi::AssertEqual(frame_vars.zti, batch_vars[t].zti, 1e-4);
+    kaldi::AssertEqual(frame_vars.nti, batch_vars[t].nti, 1e-4);
+  }
+}
+
 void UnitTestSgmm2() {
   size_t dim = 1 + kaldi::RandInt(0, 9);  // random dimension of the gmm
   size_t num_comp = 1 + kaldi::RandInt(0, 9);  // random number of mixtures
@@ -271,6 +346,8 @@ void UnitTestSgmm2() {
   sgmm.InitializeFromFullGmm(full_gmm, pdf2group, dim+1, 0, true, 0.9);
   sgmm.ComputeNormalizers();
   TestSgmm2Init(sgmm);
+  TestSgmm2PerFrameVarsBatch(sgmm);
+  TestSgmm2SubstatePruning(sgmm);
   TestSgmm2IO(sgmm);
   TestSgmm2Substates(sgmm);
   TestSgmm2IncreaseDim(sgmm);
@@ -472,6 +472,59 @@ void AmSgmm2::ComputePerFrameVars(const VectorBase<BaseFloat> &data,
   }
 }
 
+void AmSgmm2::ComputePerFrameVarsBatch(
+    const MatrixBase<BaseFloat> &data,
+    const std::vector<std::vector<int32> > &gselect,
+    const Sgmm2PerSpkDerivedVars &spk_vars,
+    std::vector<Sgmm2PerFrameDerivedVars> *per_frame_vars) const {
+  KALDI_ASSERT(!n_.empty() && "ComputeNormalizers() must be called.");
+  int32 num_frames = data.NumRows();
+  KALDI_ASSERT(gselect.size() == static_cast<size_t>(num_frames));
+  int32 feature_dim = FeatureDim(), phn_space_dim = PhoneSpaceDim();
+  bool have_spk_vec = (spk_vars.v_s.Dim() != 0);
+  bool speaker_dep_weights = (have_spk_vec && HasSpeakerDependentWeights());
+
+  per_frame_vars->resize(num_frames);
+  // Group the (frame, gselect-position) pairs by Gaussian index; the
+  // per-Gaussian work then becomes matrix-matrix products over all the
+  // frames that selected that Gaussian.
+  std::vector<std::vector<std::pair<int32, int32> > > pairs(NumGauss());
+  for (int32 t = 0; t < num_frames; t++) {
+    Sgmm2PerFrameDerivedVars &frame_vars = (*per_frame_vars)[t];
+    frame_vars.Resize(gselect[t].size(), feature_dim, phn_space_dim);
+    frame_vars.gselect = gselect[t];
+    frame_vars.xt.CopyFromVec(data.Row(t));
+    for (int32 ki = 0, last = gselect[t].size(); ki < last; ki++)
+      pairs[gselect[t][ki]].push_back(std::make_pair(t, ki));
+  }
+
+  Matrix<BaseFloat> X, SigmaInv_X, Z;  // reused across Gaussians.
+  for (int32 i = 0; i < NumGauss(); i++) {
+    if (pairs[i].empty()) continue;
+    int32 n = pairs[i].size();
+    X.Resize(n, feature_dim, kUndefined);
+    for (int32 r = 0; r < n; r++)
+      X.Row(r).CopyFromVec(data.Row(pairs[i][r].first));
+    if (have_spk_vec)  // as in Eq. (34): x_{i}(t) = x'(t) - o_i(s).
+      X.AddVecToRows(-1.0, spk_vars.o_s.Row(i));
+    SigmaInv_X.Resize(n, feature_dim, kUndefined);
+    SigmaInv_X.AddMatSp(1.0, X, kNoTrans, SigmaInv_[i], 0.0);
+    // Eq. (35) for all rows at once: Z = (\Sigma_{i}^{-1} X^T)^T M_{i}.
+    Z.Resize(n, phn_space_dim, kUndefined);
+    Z.AddMatMat(1.0, SigmaInv_X, kNoTrans, M_[i], kNoTrans, 0.0);
+    BaseFloat ssgmm_term = (speaker_dep_weights ? spk_vars.log_b_is(i) : 0.0);
+    for (int32 r = 0; r < n; r++) {
+      int32 t = pairs[i][r].first, ki = pairs[i][r].second;
+      Sgmm2PerFrameDerivedVars &frame_vars = (*per_frame_vars)[t];
+      frame_vars.xti.Row(ki).CopyFromVec(X.Row(r));
+      frame_vars.zti.Row(ki).CopyFromVec(Z.Row(r));
+      // Eq. (36).
+      frame_vars.nti(ki) = -0.5 * VecVec(X.Row(r), SigmaInv_X.Row(r)) +
+          ssgmm_term;
+    }
+  }
+}
+
 // inline
 void AmSgmm2::ComponentLogLikes(const Sgmm2PerFrameDerivedVars &per_frame_vars,
                                int32 j1,
@@ -514,6 +567,32 @@ void AmSgmm2::ComponentLogLikes(const Sgmm2PerFrameDerivedVars &per_frame_vars,
 }
 
 
+// Computes the indices of the substates that together carry at least
+// "mass" (e.g. 0.995) of the total of "likes"; the shortlist is left in
+// increasing index order.  If nothing would be pruned, the shortlist is
+// cleared (meaning: use all substates).
+static void ComputeSubstateShortlist(const VectorBase<BaseFloat> &likes,
+                                     BaseFloat mass,
+                                     std::vector<int32> *shortlist) {
+  int32 num_substates = likes.Dim();
+  std::vector<std::pair<BaseFloat, int32> > pairs(num_substates);
+  for (int32 m = 0; m < num_substates; m++)
+    pairs[m] = std::make_pair(likes(m), m);
+  std::sort(pairs.begin(), pairs.end(),
+            std::greater<std::pair<BaseFloat, int32> >());
+  double target = mass * likes.Sum(), cum = 0.0;
+  shortlist->clear();
+  for (int32 k = 0; k < num_substates; k++) {
+    shortlist->push_back(pairs[k].second);
+    cum += pairs[k].first;
+    if (cum >= target) break;
+  }
+  if (static_cast<int32>(shortlist->size()) == num_substates)
+    shortlist->clear();  // nothing pruned; take the unpruned code path.
+  else
+    std::sort(shortlist->begin(), shortlist->end());
+}
+
 BaseFloat AmSgmm2::LogLikelihood(const Sgmm2PerFrameDerivedVars &per_frame_vars,
                                 int32 j2,
                                 Sgmm2LikelihoodCache *cache,
@@ -556,10 +635,28 @@ BaseFloat AmSgmm2::LogLikelihood(const Sgmm2PerFrameDerivedVars &per_frame_vars,
     // each column [i.e. summing over the rows], so we get the sum for
     // each substate index.  You have to multiply by exp(remaining_log_like)
     // to get a real likelihood.
+    if (cache->substate_mass < 1.0)
+      ComputeSubstateShortlist(substate_cache.likes, cache->substate_mass,
+                               &substate_cache.shortlist);
+    else
+      substate_cache.shortlist.clear();
+  }
+
+  BaseFloat like_sum;
+  if (!substate_cache.shortlist.empty()) {
+    const std::vector<int32> &shortlist = substate_cache.shortlist;
+    const Vector<BaseFloat> &likes = substate_cache.likes,
+        &weights = c_[j2];
+    double sum = 0.0;
+    for (size_t k = 0; k < shortlist.size(); k++)
+      sum += likes(shortlist[k]) * weights(shortlist[k]);
+    like_sum = sum;
+    if (like_sum <= 0.0)  // this pdf's weight mass happened to sit on the
+      like_sum = VecVec(likes, weights);  // pruned substates; don't prune.
+  } else {
+    like_sum = VecVec(substate_cache.likes, c_[j2]);
   }
-  
-  BaseFloat log_like = substate_cache.remaining_log_like
-      + Log(VecVec(substate_cache.likes, c_[j2]));
+  BaseFloat log_like = substate_cache.remaining_log_like + Log(like_sum);
 
   if (random_test)
     KALDI_ASSERT(ApproxEqual(pdf_cache.log_like, log_like));
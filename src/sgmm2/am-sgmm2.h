@@ -200,18 +200,24 @@ struct Sgmm2LikelihoodCache {
  public:
   // you'll typically initialize with (sgmm.NumGroups(), sgmm.NumPdfs()).
   Sgmm2LikelihoodCache(int32 num_groups, int32 num_pdfs):
-      substate_cache(num_groups), pdf_cache(num_pdfs), t(1) { }
-  
+      substate_cache(num_groups), pdf_cache(num_pdfs), t(1),
+      substate_mass(1.0) { }
+
   struct SubstateCacheElement { // indexed by j1.
     SubstateCacheElement(): t(0) { }
     // The "likes" and "remaining_log_like" quantities store the
     // log-like of the data given each substate vector, in a redundant
     // way, so the likelihood is likes(i) * exp(remaining_log_like).
     // This is to get around problems with numerical range.
-    Vector<BaseFloat> likes; 
+    Vector<BaseFloat> likes;
     BaseFloat remaining_log_like;
+    // If substate_mass < 1.0, the indices of the substates that together
+    // carry at least that fraction of the total of "likes" this frame
+    // (empty means no pruning); per-pdf evaluations then only sum over
+    // these.  Recomputed whenever "likes" is.
+    std::vector<int32> shortlist;
     int32 t; // used in detecting "freshness."
-  };  
+  };
   struct PdfCacheElement { // indexed by j2.
     PdfCacheElement(): t(0) { }
     BaseFloat log_like;
@@ -222,6 +228,13 @@ struct Sgmm2LikelihoodCache {
   std::vector<SubstateCacheElement> substate_cache; // indexed by j1.
   std::vector<PdfCacheElement> pdf_cache; // indexed by j2.
   int32 t;
+  // If set to less than 1.0 (e.g. 0.995), each frame's per-group substate
+  // likelihoods are pruned to a shortlist carrying this fraction of the
+  // total mass, and per-pdf evaluations only sum over the shortlist.
+  // This is approximate (the mass is measured before the per-pdf substate
+  // weights are applied), but negligible substates dominate the per-token
+  // cost in decoding.  1.0 means no pruning (the default).
+  BaseFloat substate_mass;
 };
 
 
@@ -280,6 +293,20 @@ class AmSgmm2 {
                            const Sgmm2PerSpkDerivedVars &spk_vars,
                            Sgmm2PerFrameDerivedVars *per_frame_vars) const;
 
+  /// Batched version of ComputePerFrameVars() for a block of frames (rows
+  /// of "data"; "gselect" is indexed by frame).  It groups the work by
+  /// Gaussian index so each Gaussian's x_{i}(t) and z_{i}(t) for all
+  /// frames that selected it are computed with two matrix-matrix products
+  /// instead of per-frame matrix-vector products, which is substantially
+  /// faster for typical gselect sizes.  The output is numerically
+  /// identical to calling ComputePerFrameVars() per frame, up to the
+  /// usual BLAS reassociation.
+  void ComputePerFrameVarsBatch(
+      const MatrixBase<BaseFloat> &data,
+      const std::vector<std::vector<int32> > &gselect,
+      const Sgmm2PerSpkDerivedVars &spk_vars,
+      std::vector<Sgmm2PerFrameDerivedVars> *per_frame_vars) const;
+
 
   /// Computes the per-speaker derived vars; assumes vars->v_s is already
   /// set up.
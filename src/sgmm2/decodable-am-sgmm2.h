@@ -73,6 +73,14 @@ class DecodableAmSgmm2 : public DecodableInterface {
     return (frame == NumFramesReady() - 1);
   }
 
+  /// Sets the per-frame substate pruning threshold on the likelihood
+  /// cache; see Sgmm2LikelihoodCache::substate_mass.  1.0 (the default)
+  /// means no pruning.
+  void SetSubstateMass(BaseFloat substate_mass) {
+    KALDI_ASSERT(substate_mass > 0.0 && substate_mass <= 1.0);
+    sgmm_cache_.substate_mass = substate_mass;
+  }
+
   virtual ~DecodableAmSgmm2();
  protected:
   virtual BaseFloat LogLikelihoodForPdf(int32 frame, int32 pdf_id);
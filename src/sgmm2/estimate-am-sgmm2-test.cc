@@ -124,6 +124,55 @@ void TestSgmm2AccsIO(const AmSgmm2 &sgmm,
   unlink("tmpfb");
 }
 
+// Tests that AccumulateMultiThreaded() accumulates the same stats as the
+// per-frame Accumulate() loop.
+void TestSgmm2AccumulateMultiThreaded(const AmSgmm2 &sgmm,
+                                      const kaldi::Matrix<BaseFloat> &feats) {
+  using namespace kaldi;
+  SgmmUpdateFlagsType flags = kSgmmAll & ~kSgmmSpeakerWeightProjections;
+  Sgmm2GselectConfig sgmm_config;
+  sgmm_config.full_gmm_nbest = std::min(sgmm_config.full_gmm_nbest,
+                                        sgmm.NumGauss());
+  int32 num_frames = feats.NumRows();
+  std::vector<std::vector<int32> > gselect(num_frames);
+  for (int32 t = 0; t < num_frames; t++)
+    sgmm.GaussianSelection(sgmm_config, feats.Row(t), &gselect[t]);
+  Posterior pdf_post(num_frames);
+  for (int32 t = 0; t < num_frames; t++)
+    pdf_post[t].push_back(std::make_pair(0, static_cast<BaseFloat>(1.0)));
+
+  BaseFloat rand_prune = 0.0;  // keep the reference deterministic.
+  MleAmSgmm2Accs accs_ref(rand_prune), accs_mt(rand_prune);
+  accs_ref.ResizeAccumulators(sgmm, flags, true);
+  accs_mt.ResizeAccumulators(sgmm, flags, true);
+
+  Sgmm2PerSpkDerivedVars empty;
+  Sgmm2PerFrameDerivedVars frame_vars;
+  BaseFloat like_ref = 0.0;
+  for (int32 t = 0; t < num_frames; t++) {
+    sgmm.ComputePerFrameVars(feats.Row(t), gselect[t], empty, &frame_vars);
+    like_ref += accs_ref.Accumulate(sgmm, frame_vars, 0, 1.0, &empty);
+  }
+
+  int32 old_num_threads = g_num_threads;
+  g_num_threads = 4;
+  Sgmm2PerSpkDerivedVars empty_mt;
+  BaseFloat tot_weight;
+  BaseFloat like_mt = accs_mt.AccumulateMultiThreaded(
+      sgmm, feats, gselect, pdf_post, flags, true, &empty_mt, &tot_weight);
+  g_num_threads = old_num_threads;
+
+  accs_ref.CommitStatsForSpk(sgmm, empty);
+  accs_mt.CommitStatsForSpk(sgmm, empty_mt);
+
+  kaldi::AssertEqual(like_ref, like_mt, 1e-3);
+  kaldi::AssertEqual(tot_weight, static_cast<BaseFloat>(num_frames), 1e-4);
+  kaldi::Vector<BaseFloat> occs_ref, occs_mt;
+  accs_ref.GetStateOccupancies(&occs_ref);
+  accs_mt.GetStateOccupancies(&occs_mt);
+  kaldi::AssertEqual(occs_ref, occs_mt, 1e-3);
+}
+
 void UnitTestEstimateSgmm2() {
   int32 dim = 1 + kaldi::RandInt(0, 9);  // random dimension of the gmm
   int32 num_comp = 2 + kaldi::RandInt(0, 9);  // random mixture size
@@ -158,6 +207,7 @@ void UnitTestEstimateSgmm2() {
   }
   sgmm.ComputeDerivedVars();
   TestSgmm2AccsIO(sgmm, feats);
+  TestSgmm2AccumulateMultiThreaded(sgmm, feats);
 }
 
 int main() {
@@ -577,6 +577,161 @@ BaseFloat MleAmSgmm2Accs::AccumulateFromPosteriors(
   return tot_count;
 }
 
+void MleAmSgmm2Accs::Add(const MleAmSgmm2Accs &other) {
+  KALDI_ASSERT(num_pdfs_ == other.num_pdfs_ &&
+               num_groups_ == other.num_groups_ &&
+               num_gaussians_ == other.num_gaussians_ &&
+               feature_dim_ == other.feature_dim_ &&
+               phn_space_dim_ == other.phn_space_dim_ &&
+               spk_space_dim_ == other.spk_space_dim_);
+  KALDI_ASSERT(Y_.size() == other.Y_.size() && Z_.size() == other.Z_.size() &&
+               S_.size() == other.S_.size() && y_.size() == other.y_.size() &&
+               gamma_.size() == other.gamma_.size() &&
+               a_.size() == other.a_.size() && U_.size() == other.U_.size() &&
+               gamma_s_.Dim() == other.gamma_s_.Dim() &&
+               a_s_.Dim() == other.a_s_.Dim());
+  total_frames_ += other.total_frames_;
+  total_like_ += other.total_like_;
+  for (size_t i = 0; i < Y_.size(); i++)
+    Y_[i].AddMat(1.0, other.Y_[i]);
+  for (size_t i = 0; i < Z_.size(); i++) {
+    Z_[i].AddMat(1.0, other.Z_[i]);
+    R_[i].AddSp(1.0, other.R_[i]);
+  }
+  for (size_t i = 0; i < S_.size(); i++)
+    S_[i].AddSp(1.0, other.S_[i]);
+  for (size_t j1 = 0; j1 < y_.size(); j1++)
+    y_[j1].AddMat(1.0, other.y_[j1]);
+  for (size_t j1 = 0; j1 < gamma_.size(); j1++)
+    gamma_[j1].AddMat(1.0, other.gamma_[j1]);
+  for (size_t j1 = 0; j1 < a_.size(); j1++)
+    a_[j1].AddMat(1.0, other.a_[j1]);
+  if (t_.NumRows() != 0)
+    t_.AddMat(1.0, other.t_);
+  for (size_t i = 0; i < U_.size(); i++)
+    U_[i].AddSp(1.0, other.U_[i]);
+  for (size_t j2 = 0; j2 < gamma_c_.size(); j2++)
+    gamma_c_[j2].AddVec(1.0, other.gamma_c_[j2]);
+  // The per-speaker temporaries: summing them is only correct if both
+  // accumulators have seen data from the same (current) speaker.
+  if (gamma_s_.Dim() != 0)
+    gamma_s_.AddVec(1.0, other.gamma_s_);
+  if (a_s_.Dim() != 0)
+    a_s_.AddVec(1.0, other.a_s_);
+}
+
+// The MultiThreadable that AccumulateMultiThreaded() runs: each copy
+// accumulates its own contiguous block of frames into its own accumulator
+// (indexed by thread_id_), with its own copy of the speaker vars (whose
+// caches are written to during accumulation).
+class Sgmm2FrameBlockAccumulator: public MultiThreadable {
+ public:
+  Sgmm2FrameBlockAccumulator(
+      const AmSgmm2 &model,
+      const MatrixBase<BaseFloat> &feats,
+      const std::vector<std::vector<int32> > &gselect,
+      const Posterior &pdf_post,
+      std::vector<MleAmSgmm2Accs*> *accs,
+      std::vector<Sgmm2PerSpkDerivedVars> *spk_vars,
+      std::vector<double> *likes,
+      std::vector<double> *weights):
+      model_(model), feats_(feats), gselect_(gselect), pdf_post_(pdf_post),
+      accs_(accs), spk_vars_(spk_vars), likes_(likes), weights_(weights) { }
+
+  void operator() () {
+    int32 num_frames = feats_.NumRows();
+    int32 block_begin = (thread_id_ * num_frames) / num_threads_,
+        block_end = ((thread_id_ + 1) * num_frames) / num_threads_;
+    if (block_begin == block_end) return;
+    MleAmSgmm2Accs *accs = (*accs_)[thread_id_];
+    Sgmm2PerSpkDerivedVars &spk_vars = (*spk_vars_)[thread_id_];
+    std::vector<std::vector<int32> > gselect_block(
+        gselect_.begin() + block_begin, gselect_.begin() + block_end);
+    std::vector<Sgmm2PerFrameDerivedVars> frame_vars;
+    model_.ComputePerFrameVarsBatch(
+        feats_.Range(block_begin, block_end - block_begin,
+                     0, feats_.NumCols()),
+        gselect_block, spk_vars, &frame_vars);
+    double like = 0.0, weight = 0.0;
+    for (int32 t = block_begin; t < block_end; t++) {
+      const std::vector<std::pair<int32, BaseFloat> > &post = pdf_post_[t];
+      for (size_t j = 0; j < post.size(); j++) {
+        int32 pdf_id = post[j].first;
+        BaseFloat w = post[j].second;
+        like += w * accs->Accumulate(model_, frame_vars[t - block_begin],
+                                     pdf_id, w, &spk_vars);
+        weight += w;
+      }
+    }
+    (*likes_)[thread_id_] = like;
+    (*weights_)[thread_id_] = weight;
+  }
+
+ private:
+  const AmSgmm2 &model_;
+  const MatrixBase<BaseFloat> &feats_;
+  const std::vector<std::vector<int32> > &gselect_;
+  const Posterior &pdf_post_;
+  std::vector<MleAmSgmm2Accs*> *accs_;
+  std::vector<Sgmm2PerSpkDerivedVars> *spk_vars_;
+  std::vector<double> *likes_;
+  std::vector<double> *weights_;
+};
+
+BaseFloat MleAmSgmm2Accs::AccumulateMultiThreaded(
+    const AmSgmm2 &model,
+    const MatrixBase<BaseFloat> &feats,
+    const std::vector<std::vector<int32> > &gselect,
+    const Posterior &pdf_post,
+    SgmmUpdateFlagsType flags,
+    bool have_spk_vecs,
+    Sgmm2PerSpkDerivedVars *spk_vars,
+    BaseFloat *tot_weight_out) {
+  int32 num_frames = feats.NumRows();
+  KALDI_ASSERT(gselect.size() == static_cast<size_t>(num_frames) &&
+               pdf_post.size() == static_cast<size_t>(num_frames));
+  int32 num_threads = std::max<int32>(1, g_num_threads);
+  if (num_frames < num_threads) num_threads = 1;  // not worth the copies.
+
+  // Thread 0 accumulates directly into this object; the other threads get
+  // their own accumulators (these are as large as the model, which is why
+  // we don't spawn threads for very short utterances above).
+  std::vector<MleAmSgmm2Accs*> accs(num_threads);
+  accs[0] = this;
+  for (int32 t = 1; t < num_threads; t++) {
+    accs[t] = new MleAmSgmm2Accs(rand_prune_);
+    accs[t]->ResizeAccumulators(model, flags, have_spk_vecs);
+  }
+  std::vector<Sgmm2PerSpkDerivedVars> spk_vars_copies(num_threads, *spk_vars);
+  std::vector<double> likes(num_threads, 0.0), weights(num_threads, 0.0);
+
+  Sgmm2FrameBlockAccumulator accumulator(model, feats, gselect, pdf_post,
+                                         &accs, &spk_vars_copies,
+                                         &likes, &weights);
+  {
+    MultiThreader<Sgmm2FrameBlockAccumulator> threader(num_threads,
+                                                       accumulator);
+    // The destructor waits for the threads.
+  }
+
+  double tot_like = likes[0], tot_weight = weights[0];
+  for (int32 t = 1; t < num_threads; t++) {
+    Add(*accs[t]);
+    tot_like += likes[t];
+    tot_weight += weights[t];
+    // The per-speaker temporaries have been merged into this object (the
+    // caller will CommitStatsForSpk() on it); zero them so the destructor
+    // does not think stats went uncommitted.
+    accs[t]->gamma_s_.SetZero();
+    delete accs[t];
+  }
+  // Keep the caller's speaker-var caches warm for subsequent utterances
+  // of the same speaker.
+  *spk_vars = spk_vars_copies[0];
+  *tot_weight_out = tot_weight;
+  return tot_like;
+}
+
 void MleAmSgmm2Accs::CommitStatsForSpk(const AmSgmm2 &model,
                                        const Sgmm2PerSpkDerivedVars &spk_vars) {
   const VectorBase<BaseFloat> &v_s = spk_vars.v_s;
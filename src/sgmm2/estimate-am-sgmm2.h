@@ -29,6 +29,7 @@
 
 #include "sgmm2/am-sgmm2.h"
 #include "gmm/model-common.h"
+#include "hmm/posterior.h"
 #include "itf/options-itf.h"
 #include "thread/kaldi-thread.h"
 
@@ -168,6 +169,33 @@ class MleAmSgmm2Accs {
                                      int32 pdf_index, // == j2.
                                      Sgmm2PerSpkDerivedVars *spk_vars);
 
+  /// Adds the stats in "other" to this one; both must have been resized
+  /// for the same model and flags.  The per-speaker temporaries (gamma_s_
+  /// and a_s_) are summed too, so accumulators for the same speaker can
+  /// be merged before CommitStatsForSpk().  Used to reduce the
+  /// thread-local accumulators of AccumulateMultiThreaded().
+  void Add(const MleAmSgmm2Accs &other);
+
+  /// Accumulates over a whole utterance with frame-block parallelism
+  /// (g_num_threads threads): each thread computes its own contiguous
+  /// block of frames with AmSgmm2::ComputePerFrameVarsBatch() and
+  /// accumulates into a thread-local accumulator; the accumulators are
+  /// then reduced into this one with Add().  "pdf_post" must be
+  /// pdf-level posteriors (see ConvertPosteriorToPdfs()), indexed by
+  /// frame; "flags" and "have_spk_vecs" must match what was given to
+  /// ResizeAccumulators().  Returns the total posterior-weighted
+  /// log-likelihood, and outputs the total count accumulated to
+  /// "tot_weight_out".
+  BaseFloat AccumulateMultiThreaded(
+      const AmSgmm2 &model,
+      const MatrixBase<BaseFloat> &feats,
+      const std::vector<std::vector<int32> > &gselect,
+      const Posterior &pdf_post,
+      SgmmUpdateFlagsType flags,
+      bool have_spk_vecs,
+      Sgmm2PerSpkDerivedVars *spk_vars,
+      BaseFloat *tot_weight_out);
+
   /// Accumulates global stats for the current speaker (if applicable).  If
   /// flags contains kSgmmSpeakerProjections (N), or
   /// kSgmmSpeakerWeightProjections (u), must call this after finishing the
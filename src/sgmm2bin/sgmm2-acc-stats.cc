@@ -25,6 +25,7 @@
 #include "sgmm2/am-sgmm2.h"
 #include "hmm/transition-model.h"
 #include "sgmm2/estimate-am-sgmm2.h"
+#include "thread/kaldi-thread.h"
 #include "hmm/posterior.h"
 
 int main(int argc, char *argv[]) {
@@ -51,6 +52,8 @@ int main(int argc, char *argv[]) {
     po.Register("rand-prune", &rand_prune, "Pruning threshold for posteriors");
     po.Register("update-flags", &update_flags_str, "Which SGMM parameters to accumulate "
                 "stats for: subset of vMNwcS.");
+    po.Register("num-threads", &g_num_threads, "Number of threads to use for "
+                "accumulation (frame-block parallelism within utterances).");
 
     po.Read(argc, argv);
 
@@ -105,7 +108,6 @@ int main(int argc, char *argv[]) {
       double tot_like = 0.0;
       double tot_t = 0;
 
-      kaldi::Sgmm2PerFrameDerivedVars per_frame_vars;
       std::string cur_spk;
       Sgmm2PerSpkDerivedVars spk_vars;
               
@@ -164,20 +166,14 @@ int main(int argc, char *argv[]) {
 
         Posterior pdf_posterior;
         ConvertPosteriorToPdfs(trans_model, posterior, &pdf_posterior);
-        for (size_t i = 0; i < posterior.size(); i++) {
-          am_sgmm.ComputePerFrameVars(features.Row(i), gselect[i], spk_vars,
-                                      &per_frame_vars);
-          // Accumulates for SGMM.
-          for (size_t j = 0; j < pdf_posterior[i].size(); j++) {
-            int32 pdf_id = pdf_posterior[i][j].first;
-            BaseFloat weight = pdf_posterior[i][j].second;
-            tot_like_this_file += sgmm_accs.Accumulate(am_sgmm, per_frame_vars,
-                                                       pdf_id, weight, &spk_vars)
-                * weight;
-            tot_weight += weight;
-          }
+        // Accumulates for SGMM, with frame-block parallelism over
+        // g_num_threads threads (a no-op with one thread).
+        tot_like_this_file = sgmm_accs.AccumulateMultiThreaded(
+            am_sgmm, features, gselect, pdf_posterior, acc_flags,
+            (spkvecs_rspecifier != ""), &spk_vars, &tot_weight);
 
-          // Accumulates for transitions.
+        // Accumulates for transitions.
+        for (size_t i = 0; i < posterior.size(); i++) {
           for (size_t j = 0; j < posterior[i].size(); j++) {
             int32 tid = posterior[i][j].first;
             BaseFloat weight = posterior[i][j].second;
@@ -39,6 +39,7 @@ bool ProcessUtterance(LatticeFasterDecoder &decoder,
                       const AmSgmm2 &am_sgmm,
                       const TransitionModel &trans_model,
                       double log_prune,
+                      double substate_mass,
                       double acoustic_scale,
                       const Matrix<BaseFloat> &features,
                       RandomAccessInt32VectorVectorReader &gselect_reader,
@@ -76,6 +77,7 @@ bool ProcessUtterance(LatticeFasterDecoder &decoder,
   
   DecodableAmSgmm2Scaled sgmm_decodable(am_sgmm, trans_model, features, gselect,
                                         log_prune, acoustic_scale, &spk_vars);
+  sgmm_decodable.SetSubstateMass(substate_mass);
 
   return DecodeUtteranceLatticeFaster(
       decoder, sgmm_decodable, trans_model, word_syms, utt, acoustic_scale,
@@ -101,6 +103,7 @@ int main(int argc, char *argv[]) {
     BaseFloat acoustic_scale = 0.1;
     bool allow_partial = false;
     BaseFloat log_prune = 5.0;
+    BaseFloat substate_mass = 1.0;
     string word_syms_filename, gselect_rspecifier, spkvecs_rspecifier,
         utt2spk_rspecifier;
 
@@ -111,6 +114,10 @@ int main(int argc, char *argv[]) {
         "Scaling factor for acoustic likelihoods");
     po.Register("log-prune", &log_prune,
                 "Pruning beam used to reduce number of exp() evaluations.");
+    po.Register("substate-mass", &substate_mass,
+                "If less than 1.0 (e.g. 0.995), prune each frame's substates "
+                "to a shortlist carrying this fraction of the likelihood "
+                "mass.");
     po.Register("word-symbol-table", &word_syms_filename,
         "Symbol table for words [for debug output]");
     po.Register("allow-partial", &allow_partial,
@@ -199,7 +206,8 @@ int main(int argc, char *argv[]) {
             continue;
           }
           double like;
-          if (ProcessUtterance(decoder, am_sgmm, trans_model, log_prune, acoustic_scale,
+          if (ProcessUtterance(decoder, am_sgmm, trans_model, log_prune,
+                               substate_mass, acoustic_scale,
                                features, gselect_reader, spkvecs_reader, word_syms,
                                utt, determinize, allow_partial,
                                &alignment_writer, &words_writer, &compact_lattice_writer,
@@ -234,7 +242,8 @@ int main(int argc, char *argv[]) {
         LatticeFasterDecoder decoder(fst_reader.Value(), decoder_opts);
         double like;
 
-        if (ProcessUtterance(decoder, am_sgmm, trans_model, log_prune, acoustic_scale,
+        if (ProcessUtterance(decoder, am_sgmm, trans_model, log_prune,
+                             substate_mass, acoustic_scale,
                              features, gselect_reader, spkvecs_reader, word_syms,
                              utt, determinize, allow_partial,
                              &alignment_writer, &words_writer, &compact_lattice_writer,
@@ -0,0 +1,93 @@
+// thread/kaldi-async-table-writer-test.cc
+
+// Copyright 2015  Johns Hopkins University (Author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdio>
+#include <vector>
+
+#ifndef _MSC_VER
+#include <unistd.h>
+#endif
+
+#include "base/kaldi-math.h"
+#include "thread/kaldi-async-table-writer.h"
+#include "util/table-types.h"
+
+namespace kaldi {
+
+void UnitTestAsyncTableWriterMatrix() {
+  for (int32 iter = 0; iter < 3; iter++) {
+    const char *filename = "tmpf";
+    int32 num_records = 50 + Rand() % 100,
+        queue_size = 1 + Rand() % 10;  // small, to exercise blocking.
+    std::vector<Matrix<BaseFloat> > written(num_records);
+    {
+      AsyncTableWriter<KaldiObjectHolder<Matrix<BaseFloat> > > writer(
+          std::string("ark:") + filename, queue_size);
+      for (int32 i = 0; i < num_records; i++) {
+        char buf[100];
+        snprintf(buf, sizeof(buf), "key%05d", i);
+        written[i].Resize(1 + Rand() % 40, 1 + Rand() % 40);
+        written[i].SetRandn();
+        writer.Write(buf, written[i]);
+      }
+      writer.Close();
+    }
+    int32 i = 0;
+    SequentialBaseFloatMatrixReader reader(std::string("ark:") + filename);
+    for (; !reader.Done(); reader.Next(), i++) {
+      char buf[100];
+      snprintf(buf, sizeof(buf), "key%05d", i);
+      KALDI_ASSERT(reader.Key() == buf);  // order must be preserved.
+      KALDI_ASSERT(reader.Value().ApproxEqual(written[i], 0.0f));
+    }
+    KALDI_ASSERT(i == num_records);
+    unlink(filename);
+  }
+}
+
+void UnitTestAsyncTableWriterInt32() {
+  const char *filename = "tmpf";
+  int32 num_records = 500;
+  {
+    AsyncTableWriter<BasicHolder<int32> > writer(
+        std::string("ark:") + filename);
+    for (int32 i = 0; i < num_records; i++) {
+      char buf[100];
+      snprintf(buf, sizeof(buf), "key%05d", i);
+      writer.Write(buf, i);
+    }
+    // no explicit Close(): the destructor must drain the queue.
+  }
+  int32 i = 0;
+  SequentialInt32Reader reader(std::string("ark:") + filename);
+  for (; !reader.Done(); reader.Next(), i++)
+    KALDI_ASSERT(reader.Value() == i);
+  KALDI_ASSERT(i == num_records);
+  unlink(filename);
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  UnitTestAsyncTableWriterMatrix();
+  UnitTestAsyncTableWriterInt32();
+  std::cout << "Test OK.\n";
+  return 0;
+}
@@ -0,0 +1,177 @@
+// thread/kaldi-async-table-writer.h
+
+// Copyright 2015  Johns Hopkins University (Author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_THREAD_KALDI_ASYNC_TABLE_WRITER_H_
+#define KALDI_THREAD_KALDI_ASYNC_TABLE_WRITER_H_ 1
+
+#include <pthread.h>
+#include <deque>
+#include <string>
+#include <utility>
+
+#include "util/kaldi-table.h"
+#include "thread/kaldi-mutex.h"
+#include "thread/kaldi-semaphore.h"
+
+namespace kaldi {
+
+/**
+   AsyncTableWriter<Holder> wraps a TableWriter<Holder> so that Write() just
+   copies the object into a bounded queue and returns, while a single
+   background thread does the serialization (including any compression the
+   Holder does, e.g. for CompressedMatrix) and the actual write.  This keeps
+   a compute thread from stalling on slow or shared storage.  Write() blocks
+   only when the queue is full, which bounds the memory used by buffered
+   objects.  Records are written in the order Write() was called.
+
+   Errors that happen on the background thread are reported from the next
+   Write() or from Close(), via KALDI_ERR; as with TableWriter, call Close()
+   if you want to handle error states, as the destructor will throw on an
+   error you have not collected.
+
+   This class is intended for a single producer thread; concurrent Write()
+   calls from several threads are not supported (if you need that, see
+   TaskSequencer, whose sequential destructors can do table output from
+   multiple workers).
+*/
+template<class Holder>
+class AsyncTableWriter {
+ public:
+  typedef typename Holder::T T;
+
+  /// Opens the table, throwing on error as the TableWriter constructor
+  /// does; "queue_size" is the maximum number of records buffered before
+  /// Write() blocks.
+  explicit AsyncTableWriter(const std::string &wspecifier,
+                            int32 queue_size = 32):
+      writer_(wspecifier), full_slots_(0), empty_slots_(queue_size),
+      finished_(false), error_(false) {
+    KALDI_ASSERT(queue_size > 0);
+    int32 ret;
+    if ((ret = pthread_create(&thread_,
+                              NULL,  // default attributes
+                              AsyncTableWriter<Holder>::RunBackgroundThread,
+                              static_cast<void*>(this)))) {
+      const char *c = strerror(ret);
+      KALDI_ERR << "Error creating thread, errno was: " << (c ? c : "[NULL]");
+    }
+  }
+
+  /// Queues the object for writing, copying it; blocks if the queue is
+  /// full.  Throws if a previously queued write failed.
+  void Write(const std::string &key, const T &value) {
+    KALDI_ASSERT(!finished_ &&
+                 "Write() called after Close() on AsyncTableWriter.");
+    CheckForError();
+    empty_slots_.Wait();
+    T *copy = new T(value);
+    mutex_.Lock();
+    queue_.push_back(std::make_pair(key, copy));
+    mutex_.Unlock();
+    full_slots_.Signal();
+  }
+
+  /// Waits for all queued records to be written and closes the underlying
+  /// writer; throws if any write failed.  Called from the destructor if
+  /// you do not call it.
+  void Close() {
+    KALDI_ASSERT(!finished_);
+    finished_ = true;
+    // The extra token below is consumed by the background thread after all
+    // queued records, at which point it sees an empty queue and exits.
+    full_slots_.Signal();
+    int32 ret = pthread_join(thread_, NULL);
+    if (ret != 0) {
+      const char *c = strerror(ret);
+      KALDI_ERR << "Error joining thread, errno was: " << (c ? c : "[NULL]");
+    }
+    bool ok = writer_.Close();
+    CheckForError();
+    if (!ok)
+      KALDI_ERR << "Error closing table in AsyncTableWriter.";
+  }
+
+  ~AsyncTableWriter() {
+    if (!finished_) Close();
+  }
+
+ private:
+  static void* RunBackgroundThread(void *ptr) {
+    static_cast<AsyncTableWriter<Holder>*>(ptr)->BackgroundLoop();
+    return NULL;
+  }
+
+  void BackgroundLoop() {
+    while (true) {
+      full_slots_.Wait();
+      mutex_.Lock();
+      if (queue_.empty()) {  // Close() signalled us with nothing queued:
+        mutex_.Unlock();     // we are done.
+        break;
+      }
+      std::string key = queue_.front().first;
+      T *value = queue_.front().second;
+      queue_.pop_front();
+      bool error = error_;
+      mutex_.Unlock();
+      if (!error) {
+        try {
+          writer_.Write(key, *value);
+        } catch(const std::exception &e) {
+          mutex_.Lock();
+          error_ = true;
+          error_message_ = e.what();
+          mutex_.Unlock();
+        }
+      }
+      delete value;
+      empty_slots_.Signal();
+    }
+  }
+
+  // Throws if the background thread has recorded a write failure.
+  void CheckForError() {
+    mutex_.Lock();
+    bool error = error_;
+    std::string message = error_message_;
+    mutex_.Unlock();
+    if (error)
+      KALDI_ERR << "Asynchronous table write failed: " << message;
+  }
+
+  TableWriter<Holder> writer_;
+  pthread_t thread_;
+
+  Mutex mutex_;  // guards queue_, error_ and error_message_.
+  std::deque<std::pair<std::string, T*> > queue_;
+  Semaphore full_slots_;   // number of queued records; the background
+                           // thread waits on this.
+  Semaphore empty_slots_;  // number of free queue slots; Write() waits on
+                           // this.
+  bool finished_;  // true after Close(); accessed from the producer thread
+                   // only.
+  bool error_;
+  std::string error_message_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(AsyncTableWriter);
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_THREAD_KALDI_ASYNC_TABLE_WRITER_H_
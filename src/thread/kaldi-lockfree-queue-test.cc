@@ -0,0 +1,180 @@
+// thread/kaldi-lockfree-queue-test.cc
+
+// Copyright 2015  Johns Hopkins University (Author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <pthread.h>
+#include <sched.h>
+#include <vector>
+
+#include "base/kaldi-math.h"
+#include "thread/kaldi-lockfree-queue.h"
+#include "thread/kaldi-mutex.h"
+
+namespace kaldi {
+
+void UnitTestSpscQueueSingleThreaded() {
+  SpscQueue<int32> q(5);  // rounds up to capacity 8.
+  int32 value;
+  KALDI_ASSERT(q.Empty() && q.Size() == 0 && !q.TryPop(&value));
+  for (int32 i = 0; i < 8; i++)
+    KALDI_ASSERT(q.TryPush(i));
+  KALDI_ASSERT(!q.TryPush(8));  // full.
+  KALDI_ASSERT(q.Size() == 8);
+  for (int32 i = 0; i < 8; i++)
+    KALDI_ASSERT(q.At(i) == i);
+  for (int32 i = 0; i < 8; i++) {
+    KALDI_ASSERT(q.TryPop(&value) && value == i);
+  }
+  KALDI_ASSERT(q.Empty() && !q.TryPop(&value));
+  // Wrap around the ring a few times with interleaved push/pop.
+  for (int32 i = 0; i < 100; i++) {
+    KALDI_ASSERT(q.TryPush(i));
+    KALDI_ASSERT(q.TryPop(&value) && value == i);
+  }
+  KALDI_ASSERT(q.Empty());
+}
+
+struct SpscTestArgs {
+  SpscQueue<int32> *queue;
+  int32 num_elements;
+};
+
+static void *SpscProducer(void *args_in) {
+  SpscTestArgs *args = static_cast<SpscTestArgs*>(args_in);
+  for (int32 i = 0; i < args->num_elements; i++) {
+    while (!args->queue->TryPush(i))  // yield when full: the test may run
+      sched_yield();                   // on fewer cores than threads.
+  }
+  return NULL;
+}
+
+static void *SpscConsumer(void *args_in) {
+  SpscTestArgs *args = static_cast<SpscTestArgs*>(args_in);
+  for (int32 i = 0; i < args->num_elements; i++) {
+    int32 value;
+    while (!args->queue->TryPop(&value))  // yield when empty.
+      sched_yield();
+    KALDI_ASSERT(value == i);  // order must be preserved.
+  }
+  return NULL;
+}
+
+void UnitTestSpscQueueThreaded() {
+  for (int32 iter = 0; iter < 3; iter++) {
+    SpscQueue<int32> queue(1 << (1 + Rand() % 8));  // small capacities
+                                                    // exercise full/empty.
+    SpscTestArgs args;
+    args.queue = &queue;
+    args.num_elements = 30000;
+    pthread_t producer, consumer;
+    KALDI_ASSERT(pthread_create(&producer, NULL, SpscProducer, &args) == 0);
+    KALDI_ASSERT(pthread_create(&consumer, NULL, SpscConsumer, &args) == 0);
+    KALDI_ASSERT(pthread_join(producer, NULL) == 0);
+    KALDI_ASSERT(pthread_join(consumer, NULL) == 0);
+    KALDI_ASSERT(queue.Empty());
+  }
+}
+
+struct MpmcTestArgs {
+  MpmcQueue<int32> *queue;
+  int32 num_elements;  // per producer.
+  int32 thread_id;
+  int32 num_producers;
+  // Consumer output: how often each value was seen, guarded by *mutex.
+  std::vector<int32> *counts;
+  Mutex *mutex;
+  volatile int32 *num_popped;  // total elements popped so far, over all
+                               // consumers; updated with compare-and-swap.
+  int32 total_elements;
+};
+
+static void *MpmcProducer(void *args_in) {
+  MpmcTestArgs *args = static_cast<MpmcTestArgs*>(args_in);
+  for (int32 i = 0; i < args->num_elements; i++) {
+    int32 value = args->thread_id * args->num_elements + i;
+    while (!args->queue->TryPush(value))  // yield when full.
+      sched_yield();
+  }
+  return NULL;
+}
+
+static void *MpmcConsumer(void *args_in) {
+  MpmcTestArgs *args = static_cast<MpmcTestArgs*>(args_in);
+  while (true) {
+    // Claim one element (if any remain unclaimed), then pop it.
+    int32 claimed = *args->num_popped;
+    if (claimed >= args->total_elements)
+      return NULL;
+    if (!ThreadCompareAndSwap(
+            reinterpret_cast<volatile uint32*>(args->num_popped),
+            claimed, claimed + 1)) {
+      sched_yield();
+      continue;
+    }
+    int32 value;
+    while (!args->queue->TryPop(&value))  // yield when empty.
+      sched_yield();
+    args->mutex->Lock();
+    (*args->counts)[value]++;
+    args->mutex->Unlock();
+  }
+}
+
+void UnitTestMpmcQueueThreaded() {
+  for (int32 iter = 0; iter < 3; iter++) {
+    int32 num_producers = 4, num_consumers = 4, num_elements = 5000;
+    MpmcQueue<int32> queue(1 << (1 + Rand() % 8));
+    std::vector<int32> counts(num_producers * num_elements, 0);
+    Mutex mutex;
+    volatile int32 num_popped = 0;
+    std::vector<MpmcTestArgs> args(num_producers + num_consumers);
+    std::vector<pthread_t> threads(num_producers + num_consumers);
+    for (int32 i = 0; i < num_producers + num_consumers; i++) {
+      args[i].queue = &queue;
+      args[i].num_elements = num_elements;
+      args[i].thread_id = i;
+      args[i].num_producers = num_producers;
+      args[i].counts = &counts;
+      args[i].mutex = &mutex;
+      args[i].num_popped = &num_popped;
+      args[i].total_elements = num_producers * num_elements;
+      KALDI_ASSERT(pthread_create(&threads[i], NULL,
+                                  i < num_producers ? MpmcProducer
+                                                    : MpmcConsumer,
+                                  &args[i]) == 0);
+    }
+    for (int32 i = 0; i < num_producers + num_consumers; i++)
+      KALDI_ASSERT(pthread_join(threads[i], NULL) == 0);
+    // Every pushed element must have been popped exactly once.
+    for (size_t i = 0; i < counts.size(); i++)
+      KALDI_ASSERT(counts[i] == 1);
+    int32 value;
+    KALDI_ASSERT(!queue.TryPop(&value));
+  }
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  UnitTestSpscQueueSingleThreaded();
+  UnitTestSpscQueueThreaded();
+  UnitTestMpmcQueueThreaded();
+  std::cout << "Test OK.\n";
+  return 0;
+}
@@ -0,0 +1,246 @@
+// thread/kaldi-lockfree-queue.h
+
+// Copyright 2015  Johns Hopkins University (Author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_THREAD_KALDI_LOCKFREE_QUEUE_H_
+#define KALDI_THREAD_KALDI_LOCKFREE_QUEUE_H_ 1
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "base/kaldi-math.h"
+
+namespace kaldi {
+
+/**
+   This header provides bounded lock-free queues for passing small objects
+   (typically pointers) between threads without taking a mutex on each
+   element: SpscQueue for exactly one producer thread and one consumer
+   thread, and MpmcQueue for any number of each.  They exist because
+   fine-grained streams (e.g. per-chunk hand-off between a feature thread
+   and a decoding thread in online decoding) make per-element mutex
+   contention measurable when many streams run in one process.
+
+   These queues never block: TryPush fails when the queue is full and
+   TryPop fails when it is empty.  Code that needs to sleep rather than
+   poll should pair a queue with a Semaphore that the producer signals
+   after each push (one wakeup per element, instead of a lock per element);
+   see the use in online2/online-nnet2-decoding-threaded.cc.
+
+   The element type T must be copyable and default-constructible, and its
+   copies should be cheap (the intended use is T = some pointer type).
+*/
+
+
+/// \addtogroup thread
+/// @{
+
+// A full memory barrier, preventing both the compiler and the processor
+// from reordering memory operations across it.  Full barriers are
+// conservative but portable; the queues below issue one per operation,
+// which is still far cheaper than a mutex.
+inline void ThreadMemoryBarrier() {
+#ifdef _MSC_VER
+  _ReadWriteBarrier();
+  MemoryBarrier();
+#else
+  __sync_synchronize();
+#endif
+}
+
+// Atomically: if *ptr == expected, sets *ptr to desired and returns true;
+// otherwise returns false.
+inline bool ThreadCompareAndSwap(volatile uint32 *ptr, uint32 expected,
+                                 uint32 desired) {
+#ifdef _MSC_VER
+  return _InterlockedCompareExchange(
+      reinterpret_cast<volatile long*>(const_cast<uint32*>(ptr)),
+      static_cast<long>(desired), static_cast<long>(expected)) ==
+      static_cast<long>(expected);
+#else
+  return __sync_bool_compare_and_swap(ptr, expected, desired);
+#endif
+}
+
+
+/** A bounded lock-free queue for exactly one producer thread and one
+    consumer thread.  TryPush must only ever be called from one thread at a
+    time, and TryPop from one (possibly different) thread; this is not
+    checked.  Implemented as a ring buffer with free-running read and write
+    counters.
+*/
+template<class T>
+class SpscQueue {
+ public:
+  /// "capacity" is the maximum number of elements the queue can hold; it
+  /// is rounded up to a power of two.
+  explicit SpscQueue(int32 capacity):
+      read_pos_(0), write_pos_(0) {
+    KALDI_ASSERT(capacity > 0 && capacity < (1 << 30));
+    buffer_.resize(RoundUpToNearestPowerOfTwo(capacity));
+    mask_ = static_cast<uint32>(buffer_.size()) - 1;
+  }
+
+  /// Appends "t"; returns false if the queue is full.  Producer thread
+  /// only.
+  bool TryPush(const T &t) {
+    uint32 w = write_pos_, r = read_pos_;
+    if (w - r >= static_cast<uint32>(buffer_.size()))
+      return false;  // full.
+    buffer_[w & mask_] = t;
+    ThreadMemoryBarrier();  // the element must be written before the
+                            // updated write_pos_ makes it visible.
+    write_pos_ = w + 1;
+    return true;
+  }
+
+  /// Removes the oldest element into *t; returns false if the queue is
+  /// empty.  Consumer thread only.
+  bool TryPop(T *t) {
+    uint32 r = read_pos_, w = write_pos_;
+    if (w == r)
+      return false;  // empty.
+    ThreadMemoryBarrier();  // read the element only after seeing the
+                            // write_pos_ that published it.
+    *t = buffer_[r & mask_];
+    ThreadMemoryBarrier();  // finish reading before freeing the slot.
+    read_pos_ = r + 1;
+    return true;
+  }
+
+  /// Number of queued elements.  Exact when called from the producer or
+  /// consumer thread, approximate from any other thread.
+  int32 Size() const { return static_cast<int32>(write_pos_ - read_pos_); }
+
+  bool Empty() const { return write_pos_ == read_pos_; }
+
+  /// Returns the i'th-oldest queued element, 0 <= i < Size(), without
+  /// removing it.  Only valid when no other thread is concurrently
+  /// accessing the queue (e.g. after worker threads have been joined).
+  const T &At(int32 i) const {
+    KALDI_ASSERT(i >= 0 && i < Size());
+    return buffer_[(read_pos_ + static_cast<uint32>(i)) & mask_];
+  }
+
+ private:
+  std::vector<T> buffer_;
+  uint32 mask_;  // buffer_.size() - 1; size is a power of two.
+  // Free-running positions; the difference is the queue size.  On separate
+  // cache lines so the producer and consumer do not false-share.
+  volatile uint32 read_pos_;
+  char padding_[64];
+  volatile uint32 write_pos_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(SpscQueue);
+};
+
+
+/** A bounded lock-free queue for any number of producer and consumer
+    threads; elements are popped in the order they were pushed.  This is
+    the algorithm of Dmitry Vyukov's bounded MPMC queue: each cell carries
+    a sequence number saying which push/pop it is ready for, and producers
+    and consumers claim positions with compare-and-swap.
+*/
+template<class T>
+class MpmcQueue {
+ public:
+  /// "capacity" is the maximum number of elements the queue can hold; it
+  /// is rounded up to a power of two.
+  explicit MpmcQueue(int32 capacity):
+      enqueue_pos_(0), dequeue_pos_(0) {
+    KALDI_ASSERT(capacity > 0 && capacity < (1 << 30));
+    cells_.resize(RoundUpToNearestPowerOfTwo(capacity));
+    mask_ = static_cast<uint32>(cells_.size()) - 1;
+    for (size_t i = 0; i < cells_.size(); i++)
+      cells_[i].sequence = static_cast<uint32>(i);
+  }
+
+  /// Appends "t"; returns false if the queue is full.
+  bool TryPush(const T &t) {
+    uint32 pos = enqueue_pos_;
+    while (true) {
+      Cell *cell = &cells_[pos & mask_];
+      uint32 seq = cell->sequence;
+      ThreadMemoryBarrier();
+      int32 diff = static_cast<int32>(seq - pos);
+      if (diff == 0) {  // the cell is ready to be written by push "pos".
+        if (ThreadCompareAndSwap(&enqueue_pos_, pos, pos + 1)) {
+          cell->value = t;
+          ThreadMemoryBarrier();  // write the element before publishing it.
+          cell->sequence = pos + 1;
+          return true;
+        }
+        pos = enqueue_pos_;  // someone else claimed it; retry.
+      } else if (diff < 0) {
+        return false;  // the cell still holds an unpopped element: full.
+      } else {
+        pos = enqueue_pos_;  // we read a stale position; retry.
+      }
+    }
+  }
+
+  /// Removes the oldest element into *t; returns false if the queue is
+  /// empty.
+  bool TryPop(T *t) {
+    uint32 pos = dequeue_pos_;
+    while (true) {
+      Cell *cell = &cells_[pos & mask_];
+      uint32 seq = cell->sequence;
+      ThreadMemoryBarrier();
+      int32 diff = static_cast<int32>(seq - (pos + 1));
+      if (diff == 0) {  // the cell holds the element of push "pos".
+        if (ThreadCompareAndSwap(&dequeue_pos_, pos, pos + 1)) {
+          ThreadMemoryBarrier();  // read only after claiming the cell.
+          *t = cell->value;
+          ThreadMemoryBarrier();  // finish reading before recycling it.
+          cell->sequence = pos + mask_ + 1;  // ready for the next lap's push.
+          return true;
+        }
+        pos = dequeue_pos_;  // someone else claimed it; retry.
+      } else if (diff < 0) {
+        return false;  // not yet written: empty.
+      } else {
+        pos = dequeue_pos_;  // we read a stale position; retry.
+      }
+    }
+  }
+
+ private:
+  struct Cell {
+    volatile uint32 sequence;
+    T value;
+  };
+
+  std::vector<Cell> cells_;
+  uint32 mask_;  // cells_.size() - 1; size is a power of two.
+  volatile uint32 enqueue_pos_;
+  char padding_[64];
+  volatile uint32 dequeue_pos_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(MpmcQueue);
+};
+
+/// @}
+
+}  // namespace kaldi
+
+#endif  // KALDI_THREAD_KALDI_LOCKFREE_QUEUE_H_
@@ -0,0 +1,109 @@
+// thread/kaldi-numa-test.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "thread/kaldi-numa.h"
+#include "base/io-funcs.h"
+
+namespace kaldi {
+
+void UnitTestNumaTopology() {
+  int32 num_nodes = NumNumaNodes();
+  KALDI_ASSERT(num_nodes >= 1);
+  KALDI_LOG << "This machine has " << num_nodes << " NUMA node(s).";
+  for (int32 node = 0; node < num_nodes; node++) {
+    std::vector<int32> cpus;
+    GetNumaNodeCpus(node, &cpus);
+    for (size_t i = 0; i < cpus.size(); i++)
+      KALDI_ASSERT(cpus[i] >= 0);
+  }
+}
+
+void UnitTestNumaPinning() {
+  // Pinning may legitimately fail (e.g. no affinity support); we only check
+  // consistency when it succeeds.
+  if (PinThreadToNumaNode(0)) {
+    int32 node = GetCurrentNumaNode();
+    KALDI_ASSERT(node == 0 || node == -1);
+    UnpinThread();
+  }
+  {  // a no-op scoped pin.
+    ScopedNumaPin pin(-1);
+  }
+  {
+    ScopedNumaPin pin(NumNumaNodes() - 1);
+  }
+}
+
+void UnitTestNumaArena() {
+  for (int32 iter = 0; iter < 4; iter++) {
+    // Small block size so the test exercises block transitions.
+    NumaArena arena(iter % NumNumaNodes(), 1024);
+    std::vector<char*> ptrs;
+    std::vector<size_t> sizes;
+    for (int32 i = 0; i < 200; i++) {
+      size_t size = 1 + Rand() % 600;
+      char *p = static_cast<char*>(arena.Malloc(size));
+      KALDI_ASSERT((reinterpret_cast<size_t>(p) & 15) == 0);
+      memset(p, static_cast<char>(i), size);
+      ptrs.push_back(p);
+      sizes.push_back(size);
+    }
+    for (int32 i = 0; i < 200; i++)  // no allocation overlapped another.
+      for (size_t j = 0; j < sizes[i]; j++)
+        KALDI_ASSERT(ptrs[i][j] == static_cast<char>(i));
+    arena.Clear();
+    // after Clear() the same memory gets reused.
+    char *p = static_cast<char*>(arena.Malloc(16));
+    KALDI_ASSERT(p == ptrs[0]);
+  }
+}
+
+// A minimal object with Kaldi-style Write/Read, for NumaReplicator.
+struct NumaTestObject {
+  std::vector<int32> data;
+  void Write(std::ostream &os, bool binary) const {
+    WriteIntegerVector(os, binary, data);
+  }
+  void Read(std::istream &is, bool binary) {
+    ReadIntegerVector(is, binary, &data);
+  }
+};
+
+void UnitTestNumaReplicator() {
+  NumaTestObject src;
+  for (int32 i = 0; i < 1000; i++)
+    src.data.push_back(Rand());
+  NumaReplicator<NumaTestObject> replicator(src);
+  KALDI_ASSERT(replicator.NumCopies() == NumNumaNodes());
+  for (int32 node = 0; node < replicator.NumCopies(); node++)
+    KALDI_ASSERT(replicator.Get(node).data == src.data);
+  KALDI_ASSERT(replicator.Get().data == src.data);  // current node.
+}
+
+}  // end namespace kaldi.
+
+int main() {
+  using namespace kaldi;
+  UnitTestNumaTopology();
+  UnitTestNumaPinning();
+  UnitTestNumaArena();
+  UnitTestNumaReplicator();
+  KALDI_LOG << "Test OK.";
+  return 0;
+}
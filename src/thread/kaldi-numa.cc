@@ -0,0 +1,232 @@
+// thread/kaldi-numa.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "thread/kaldi-numa.h"
+
+#ifdef __linux__
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE  // for sched_getcpu(), CPU_SET etc.
+#endif
+#include <sched.h>
+#include <unistd.h>
+#include <pthread.h>
+#endif
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+namespace kaldi {
+
+#ifdef __linux__
+
+// The NUMA topology, read once from /sys/devices/system/node.
+struct NumaTopology {
+  int32 num_nodes;
+  std::vector<std::vector<int32> > node_cpus;  // indexed by node.
+  std::vector<int32> cpu_node;  // indexed by cpu; maps to node, or -1.
+};
+
+static NumaTopology *g_numa_topology = NULL;
+static pthread_once_t g_numa_topology_once = PTHREAD_ONCE_INIT;
+
+// Parses a sysfs cpulist such as "0-7,16-23" into CPU indexes.
+static void ParseCpuList(const std::string &line, std::vector<int32> *cpus) {
+  const char *p = line.c_str();
+  while (*p != '\0' && *p != '\n') {
+    char *end;
+    long a = strtol(p, &end, 10);
+    if (end == p || a < 0) break;
+    p = end;
+    long b = a;
+    if (*p == '-') {
+      p++;
+      b = strtol(p, &end, 10);
+      if (end == p || b < a) break;
+      p = end;
+    }
+    for (long c = a; c <= b; c++)
+      cpus->push_back(static_cast<int32>(c));
+    if (*p != ',') break;
+    p++;
+  }
+}
+
+static void InitNumaTopology() {
+  NumaTopology *topo = new NumaTopology();
+  topo->num_nodes = 0;
+  while (true) {
+    std::ostringstream path;
+    path << "/sys/devices/system/node/node" << topo->num_nodes << "/cpulist";
+    std::ifstream is(path.str().c_str());
+    if (!is.is_open()) break;
+    std::string line;
+    std::getline(is, line);
+    std::vector<int32> cpus;
+    ParseCpuList(line, &cpus);
+    topo->node_cpus.push_back(cpus);
+    topo->num_nodes++;
+  }
+  if (topo->num_nodes == 0) {  // no sysfs info: treat as one node.
+    topo->num_nodes = 1;
+    topo->node_cpus.resize(1);
+  }
+  for (int32 node = 0; node < topo->num_nodes; node++) {
+    const std::vector<int32> &cpus = topo->node_cpus[node];
+    for (size_t i = 0; i < cpus.size(); i++) {
+      if (cpus[i] >= static_cast<int32>(topo->cpu_node.size()))
+        topo->cpu_node.resize(cpus[i] + 1, -1);
+      topo->cpu_node[cpus[i]] = node;
+    }
+  }
+  g_numa_topology = topo;
+}
+
+static const NumaTopology *GetNumaTopology() {
+  pthread_once(&g_numa_topology_once, InitNumaTopology);
+  return g_numa_topology;
+}
+
+#endif  // __linux__
+
+int32 NumNumaNodes() {
+#ifdef __linux__
+  return GetNumaTopology()->num_nodes;
+#else
+  return 1;
+#endif
+}
+
+void GetNumaNodeCpus(int32 node, std::vector<int32> *cpus) {
+  KALDI_ASSERT(cpus != NULL && node >= 0 && node < NumNumaNodes());
+  cpus->clear();
+#ifdef __linux__
+  *cpus = GetNumaTopology()->node_cpus[node];
+#endif
+}
+
+bool PinThreadToNumaNode(int32 node) {
+#ifdef __linux__
+  std::vector<int32> cpus;
+  GetNumaNodeCpus(node, &cpus);
+  if (cpus.empty()) return false;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (size_t i = 0; i < cpus.size(); i++)
+    if (cpus[i] < CPU_SETSIZE)
+      CPU_SET(cpus[i], &set);
+  return (sched_setaffinity(0, sizeof(set), &set) == 0);
+#else
+  return false;
+#endif
+}
+
+void UnpinThread() {
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  long num_cpus = sysconf(_SC_NPROCESSORS_CONF);
+  for (long c = 0; c < num_cpus && c < CPU_SETSIZE; c++)
+    CPU_SET(c, &set);
+  sched_setaffinity(0, sizeof(set), &set);
+#endif
+}
+
+int32 GetCurrentNumaNode() {
+#ifdef __linux__
+  int cpu = sched_getcpu();
+  if (cpu < 0) return -1;
+  const NumaTopology *topo = GetNumaTopology();
+  if (cpu < static_cast<int>(topo->cpu_node.size()))
+    return topo->cpu_node[cpu];
+  return (topo->num_nodes == 1 ? 0 : -1);
+#else
+  return 0;  // there is only one "node".
+#endif
+}
+
+ScopedNumaPin::ScopedNumaPin(int32 node): active_(false) {
+#ifdef __linux__
+  if (node < 0) return;
+  KALDI_COMPILE_TIME_ASSERT(sizeof(cpu_set_t) <= sizeof(saved_affinity_));
+  cpu_set_t *saved = reinterpret_cast<cpu_set_t*>(saved_affinity_);
+  if (sched_getaffinity(0, sizeof(cpu_set_t), saved) != 0) return;
+  if (PinThreadToNumaNode(node))
+    active_ = true;
+#endif
+}
+
+ScopedNumaPin::~ScopedNumaPin() {
+#ifdef __linux__
+  if (active_)
+    sched_setaffinity(0, sizeof(cpu_set_t),
+                      reinterpret_cast<cpu_set_t*>(saved_affinity_));
+#endif
+}
+
+NumaArena::NumaArena(int32 node, size_t block_bytes):
+    node_(node), block_bytes_(block_bytes), cur_block_(0), cur_offset_(0) {
+  KALDI_ASSERT(block_bytes_ > 0);
+}
+
+void *NumaArena::Malloc(size_t bytes) {
+  if (bytes == 0) bytes = 1;
+  bytes = (bytes + 15) & ~static_cast<size_t>(15);  // round up to 16.
+  while (cur_block_ < blocks_.size() &&
+         cur_offset_ + bytes > blocks_[cur_block_].size) {
+    cur_block_++;  // current block is full (we waste its tail, as arenas do).
+    cur_offset_ = 0;
+  }
+  if (cur_block_ == blocks_.size())
+    NewBlock(bytes);
+  void *ans = blocks_[cur_block_].data + cur_offset_;
+  cur_offset_ += bytes;
+  return ans;
+}
+
+void NumaArena::NewBlock(size_t min_bytes) {
+  Block block;
+  block.size = (min_bytes > block_bytes_ ? min_bytes : block_bytes_);
+  void *data, *temp;
+  data = KALDI_MEMALIGN(16, block.size, &temp);
+  if (data == NULL)
+    KALDI_ERR << "NumaArena: failed to allocate " << block.size << " bytes.";
+  block.data = static_cast<char*>(data);
+  {
+    // First-touch the pages while pinned to our node, so they get placed
+    // there no matter which node this thread normally runs on.
+    ScopedNumaPin pin(node_);
+    memset(block.data, 0, block.size);
+  }
+  blocks_.push_back(block);
+  cur_block_ = blocks_.size() - 1;
+  cur_offset_ = 0;
+}
+
+void NumaArena::Clear() {
+  cur_block_ = 0;
+  cur_offset_ = 0;
+}
+
+NumaArena::~NumaArena() {
+  for (size_t i = 0; i < blocks_.size(); i++)
+    KALDI_MEMALIGN_FREE(blocks_[i].data);
+}
+
+}  // namespace kaldi
@@ -0,0 +1,170 @@
+// thread/kaldi-numa.h
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_THREAD_KALDI_NUMA_H_
+#define KALDI_THREAD_KALDI_NUMA_H_ 1
+
+#include <sstream>
+#include <vector>
+
+#include "base/kaldi-common.h"
+
+/* This header provides simple NUMA (non-uniform memory access) utilities for
+   multi-socket servers.  On such machines, memory is allocated on the node
+   whose CPU first touches it, and a decoding thread running on one socket
+   while its tokens or its copy of the decoding graph live on the other pays
+   for every access with cross-socket traffic.  The facilities here let a
+   program (a) pin threads to a node (also see the --pin-numa-nodes option of
+   TaskSequencerConfig, which does this for task threads round-robin), (b)
+   allocate working memory whose pages are first-touched on a chosen node
+   (NumaArena), and (c) keep a per-node copy of large read-only objects such
+   as the transition model (NumaReplicator).
+
+   Everything degrades gracefully: on non-Linux systems, or single-socket
+   machines, there is one "node", pinning is a no-op, and the arena behaves
+   like plain malloc-backed allocation.  We deliberately do not depend on
+   libnuma; the topology is read from /sys/devices/system/node and placement
+   is done with thread affinity plus first-touch. */
+
+namespace kaldi {
+
+/// Returns the number of NUMA nodes on this machine (>= 1); returns 1 if the
+/// topology cannot be determined.
+int32 NumNumaNodes();
+
+/// Outputs the CPU indexes belonging to the given node; empty if unknown.
+/// "node" must be in [0, NumNumaNodes() - 1].
+void GetNumaNodeCpus(int32 node, std::vector<int32> *cpus);
+
+/// Restricts the calling thread to the CPUs of the given node; returns false
+/// if this could not be done (e.g. unknown topology, or not Linux).
+bool PinThreadToNumaNode(int32 node);
+
+/// Undoes PinThreadToNumaNode(): allows the calling thread to run on any CPU.
+void UnpinThread();
+
+/// Returns the node the calling thread is currently executing on, or -1 if
+/// this cannot be determined.
+int32 GetCurrentNumaNode();
+
+/// Pins the calling thread to a node for the lifetime of this object and
+/// then restores the thread's previous CPU affinity.  Constructing it with
+/// node == -1 makes it a no-op, which is convenient for optional pinning.
+class ScopedNumaPin {
+ public:
+  explicit ScopedNumaPin(int32 node);
+  ~ScopedNumaPin();
+ private:
+  KALDI_DISALLOW_COPY_AND_ASSIGN(ScopedNumaPin);
+  bool active_;  // true if we pinned and must restore.
+  // Opaque storage for the previous cpu_set_t; we avoid including
+  // <sched.h> in this header.  (16 * 8 = 128 bytes, the glibc size.)
+  unsigned long saved_affinity_[16];
+};
+
+/// NumaArena is a simple arena allocator whose memory is first-touched on a
+/// chosen node, so that per-thread working structures (tokens, traceback
+/// records and the like) end up local to the socket the thread runs on.
+/// Allocation is bump-pointer and there is no per-object Free(): call
+/// Clear() to make all the memory reusable at once (the blocks are kept),
+/// e.g. between utterances.  Not thread-safe; use one arena per thread.
+class NumaArena {
+ public:
+  /// "node" may be -1, meaning do not care (no pinning when touching pages).
+  explicit NumaArena(int32 node, size_t block_bytes = 1048576);
+
+  /// Returns "bytes" bytes of storage, aligned to 16 bytes, first-touched on
+  /// the arena's node.  The memory is owned by the arena.
+  void *Malloc(size_t bytes);
+
+  /// Makes all memory handed out so far available for reuse, keeping the
+  /// underlying blocks (and hence their page placement).
+  void Clear();
+
+  int32 NumaNode() const { return node_; }
+
+  ~NumaArena();
+
+ private:
+  void NewBlock(size_t min_bytes);
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(NumaArena);
+
+  int32 node_;
+  size_t block_bytes_;
+  struct Block {
+    char *data;
+    size_t size;
+  };
+  std::vector<Block> blocks_;
+  size_t cur_block_;  // index into blocks_ we are allocating from.
+  size_t cur_offset_;  // offset of the next allocation within that block.
+};
+
+/// NumaReplicator<T> keeps one copy of a read-only object per NUMA node, so
+/// that every thread can work from memory local to its socket.  The copies
+/// are made by writing the source object and reading it back in binary mode
+/// while pinned to each node in turn, so each copy's memory is first-touched
+/// (hence allocated) on its node.  T must have Kaldi-style
+/// Write(std::ostream&, bool binary) and Read(std::istream&, bool binary)
+/// methods; this covers e.g. TransitionModel but not OpenFst objects, whose
+/// per-node copies must be read from disk on a pinned thread instead (see
+/// ScopedNumaPin).  The source object is not needed once the replicator is
+/// constructed.  Get() is safe to call from any thread.
+template<class T>
+class NumaReplicator {
+ public:
+  explicit NumaReplicator(const T &src) {
+    int32 num_nodes = NumNumaNodes();
+    copies_.resize(num_nodes, static_cast<T*>(NULL));
+    for (int32 node = 0; node < num_nodes; node++) {
+      ScopedNumaPin pin(num_nodes > 1 ? node : -1);
+      std::stringstream ss(std::ios_base::in | std::ios_base::out |
+                           std::ios_base::binary);
+      src.Write(ss, true);
+      T *copy = new T();
+      copy->Read(ss, true);
+      copies_[node] = copy;
+    }
+  }
+
+  /// Returns the copy for the given node, or for the node the calling
+  /// thread is currently running on if node == -1.
+  const T &Get(int32 node = -1) const {
+    if (node < 0) node = GetCurrentNumaNode();
+    if (node < 0 || node >= static_cast<int32>(copies_.size()))
+      node = 0;
+    return *(copies_[node]);
+  }
+
+  int32 NumCopies() const { return static_cast<int32>(copies_.size()); }
+
+  ~NumaReplicator() {
+    for (size_t i = 0; i < copies_.size(); i++)
+      delete copies_[i];
+  }
+
+ private:
+  KALDI_DISALLOW_COPY_AND_ASSIGN(NumaReplicator);
+  std::vector<T*> copies_;
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_THREAD_KALDI_NUMA_H_
@@ -0,0 +1,140 @@
+// thread/kaldi-parallel-table-driver.h
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_THREAD_KALDI_PARALLEL_TABLE_DRIVER_H_
+#define KALDI_THREAD_KALDI_PARALLEL_TABLE_DRIVER_H_
+
+#include <string>
+
+#include "util/kaldi-table.h"
+#include "thread/kaldi-prefetch-table-reader.h"
+#include "thread/kaldi-task-sequence.h"
+
+namespace kaldi {
+
+/**
+   ParallelTableDriver glues together the pieces needed to run a per-key
+   transform over a whole table with multiple threads, for binaries whose
+   main loop is "read record, compute, write record" (most of latbin, for
+   example).  It combines a PrefetchingSequentialTableReader, so reading
+   and deserialization overlap the computation, with a TaskSequencer worker
+   pool; output is written in input order, because each task writes from
+   its destructor and the sequencer runs destructors in order on the
+   driver's thread.
+
+   The Mapper class must define
+
+     bool operator()(const std::string &key, InT *input, OutT *output);
+
+   which does the per-key work.  It is called concurrently from worker
+   threads, so anything it touches other than *input and *output must be
+   read-only or protected by a lock (e.g. accumulate statistics under a
+   Mutex).  *input belongs to the task and the mapper may destroy its
+   contents.  Return false to write nothing for this key (counted as
+   skipped); warnings about the key should be logged by the mapper.
+
+   Typical use, with "mapper" an instance of a Mapper as above:
+
+     TaskSequencerConfig sequencer_config;  // has --num-threads option.
+     ...register options, read command line...
+     ParallelTableDriver<CompactLatticeHolder, CompactLatticeHolder,
+         MyMapper> driver(sequencer_config, &mapper, rspecifier, wspecifier);
+     driver.Run();
+     KALDI_LOG << "Done " << driver.NumDone() << " lattices, "
+               << driver.NumSkipped() << " had errors.";
+*/
+template<class InHolder, class OutHolder, class Mapper>
+class ParallelTableDriver {
+ public:
+  typedef typename InHolder::T InT;
+  typedef typename OutHolder::T OutT;
+
+  /// Opens the input and output tables, throwing on error as the
+  /// underlying reader and writer constructors do.
+  ParallelTableDriver(const TaskSequencerConfig &config,
+                      Mapper *mapper,
+                      const std::string &rspecifier,
+                      const std::string &wspecifier):
+      config_(config), mapper_(mapper), reader_(rspecifier),
+      writer_(wspecifier), num_done_(0), num_skipped_(0) {
+    KALDI_ASSERT(mapper != NULL);
+  }
+
+  /// Runs the mapper over every record of the table; returns the number of
+  /// records for which output was written.
+  int64 Run() {
+    TaskSequencer<MapTask> sequencer(config_);
+    for (; !reader_.Done(); reader_.Next()) {
+      sequencer.Run(new MapTask(mapper_, reader_.Key(), reader_.Value(),
+                                &writer_, &num_done_, &num_skipped_));
+    }
+    sequencer.Wait();
+    return num_done_;
+  }
+
+  int64 NumDone() const { return num_done_; }
+  int64 NumSkipped() const { return num_skipped_; }
+
+ private:
+  class MapTask {
+   public:
+    MapTask(Mapper *mapper, const std::string &key, const InT &value,
+            TableWriter<OutHolder> *writer,
+            int64 *num_done, int64 *num_skipped):
+        mapper_(mapper), key_(key), input_(value), writer_(writer),
+        num_done_(num_done), num_skipped_(num_skipped), produced_(false) { }
+
+    void operator()() {  // runs in a worker thread.
+      produced_ = (*mapper_)(key_, &input_, &output_);
+    }
+
+    ~MapTask() {  // the sequencer runs this in order, on the driver's
+                  // thread, so the writes and counters need no locking.
+      if (produced_) {
+        writer_->Write(key_, output_);
+        (*num_done_)++;
+      } else {
+        (*num_skipped_)++;
+      }
+    }
+
+   private:
+    Mapper *mapper_;
+    std::string key_;
+    InT input_;
+    OutT output_;
+    TableWriter<OutHolder> *writer_;
+    int64 *num_done_;
+    int64 *num_skipped_;
+    bool produced_;
+  };
+
+  TaskSequencerConfig config_;
+  Mapper *mapper_;
+  PrefetchingSequentialTableReader<InHolder> reader_;
+  TableWriter<OutHolder> writer_;
+  int64 num_done_;
+  int64 num_skipped_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(ParallelTableDriver);
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_THREAD_KALDI_PARALLEL_TABLE_DRIVER_H_
@@ -0,0 +1,96 @@
+// thread/kaldi-prefetch-table-reader-test.cc
+
+// Copyright 2015  Johns Hopkins University (Author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdio>
+#include <vector>
+
+#ifndef _MSC_VER
+#include <unistd.h>
+#endif
+
+#include "base/kaldi-math.h"
+#include "thread/kaldi-prefetch-table-reader.h"
+#include "util/table-types.h"
+
+namespace kaldi {
+
+void UnitTestPrefetchTableReaderMatrix() {
+  for (int32 iter = 0; iter < 3; iter++) {
+    const char *filename = "tmpf";
+    int32 num_records = 50 + Rand() % 100,
+        prefetch_depth = 1 + Rand() % 10;
+    std::vector<Matrix<BaseFloat> > written(num_records);
+    {
+      BaseFloatMatrixWriter writer(std::string("ark:") + filename);
+      for (int32 i = 0; i < num_records; i++) {
+        char buf[100];
+        snprintf(buf, sizeof(buf), "key%05d", i);
+        written[i].Resize(1 + Rand() % 40, 1 + Rand() % 40);
+        written[i].SetRandn();
+        writer.Write(buf, written[i]);
+      }
+    }
+    int32 i = 0;
+    PrefetchingSequentialTableReader<KaldiObjectHolder<Matrix<BaseFloat> > >
+        reader(std::string("ark:") + filename, prefetch_depth);
+    for (; !reader.Done(); reader.Next(), i++) {
+      char buf[100];
+      snprintf(buf, sizeof(buf), "key%05d", i);
+      KALDI_ASSERT(reader.Key() == buf);  // order must be preserved.
+      KALDI_ASSERT(reader.Value().ApproxEqual(written[i], 0.0f));
+      if (Rand() % 4 == 0)  // the consumer may be slower than the reader.
+        usleep(1000);
+    }
+    KALDI_ASSERT(i == num_records);
+    unlink(filename);
+  }
+}
+
+void UnitTestPrefetchTableReaderEarlyExit() {
+  // Check that destroying the reader before the end of the table (as a
+  // binary that stops early would) shuts down cleanly.
+  const char *filename = "tmpf";
+  int32 num_records = 100;
+  {
+    Int32Writer writer(std::string("ark:") + filename);
+    for (int32 i = 0; i < num_records; i++) {
+      char buf[100];
+      snprintf(buf, sizeof(buf), "key%05d", i);
+      writer.Write(buf, i);
+    }
+  }
+  {
+    PrefetchingSequentialTableReader<BasicHolder<int32> > reader(
+        std::string("ark:") + filename, 4);
+    int32 i = 0;
+    for (; !reader.Done() && i < num_records / 2; reader.Next(), i++)
+      KALDI_ASSERT(reader.Value() == i);
+  }
+  unlink(filename);
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  UnitTestPrefetchTableReaderMatrix();
+  UnitTestPrefetchTableReaderEarlyExit();
+  std::cout << "Test OK.\n";
+  return 0;
+}
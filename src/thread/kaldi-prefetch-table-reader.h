@@ -0,0 +1,213 @@
+// thread/kaldi-prefetch-table-reader.h
+
+// Copyright 2015  Johns Hopkins University (Author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_THREAD_KALDI_PREFETCH_TABLE_READER_H_
+#define KALDI_THREAD_KALDI_PREFETCH_TABLE_READER_H_ 1
+
+#include <pthread.h>
+#include <deque>
+#include <string>
+#include <utility>
+
+#include "util/kaldi-table.h"
+#include "thread/kaldi-mutex.h"
+#include "thread/kaldi-semaphore.h"
+
+namespace kaldi {
+
+/**
+   PrefetchingSequentialTableReader<Holder> wraps a
+   SequentialTableReader<Holder> with a background thread that reads and
+   deserializes up to "prefetch_depth" records ahead of the consumer into a
+   queue, so Next() normally just pops an already-decoded object instead of
+   blocking on I/O and deserialization (e.g. decompression of compressed
+   matrices, or lattice parsing).  The Done()/Key()/Value()/Next() interface
+   and the order of the records are the same as the plain reader's.
+
+   The objects handed to the consumer are copies of what the Holder
+   deserialized, so Holder::T must be copyable (true of the usual matrix,
+   vector and lattice types); the copy is cheap relative to the
+   deserialization this overlaps.  Errors raised while reading ahead are
+   rethrown from the consumer's next call.  This class is intended for a
+   single consumer thread.
+*/
+template<class Holder>
+class PrefetchingSequentialTableReader {
+ public:
+  typedef typename Holder::T T;
+
+  /// Opens the table, throwing on error as the SequentialTableReader
+  /// constructor does; "prefetch_depth" is the maximum number of decoded
+  /// records buffered ahead of the consumer.
+  explicit PrefetchingSequentialTableReader(const std::string &rspecifier,
+                                            int32 prefetch_depth = 8):
+      reader_(rspecifier), empty_slots_(prefetch_depth), full_slots_(0),
+      producer_done_(false), cancel_(false), error_(false),
+      fetched_(false), at_end_(false), value_(NULL) {
+    KALDI_ASSERT(prefetch_depth > 0);
+    int32 ret;
+    if ((ret = pthread_create(
+            &thread_,
+            NULL,  // default attributes
+            PrefetchingSequentialTableReader<Holder>::RunBackgroundThread,
+            static_cast<void*>(this)))) {
+      const char *c = strerror(ret);
+      KALDI_ERR << "Error creating thread, errno was: " << (c ? c : "[NULL]");
+    }
+  }
+
+  bool Done() {
+    FetchIfNeeded();
+    return at_end_;
+  }
+
+  std::string Key() {
+    FetchIfNeeded();
+    KALDI_ASSERT(!at_end_ && "Called Key() at end of table.");
+    return key_;
+  }
+
+  // As with SequentialTableReader, the reference is non-const so the caller
+  // may swap the contents out instead of copying them.
+  T &Value() {
+    FetchIfNeeded();
+    KALDI_ASSERT(!at_end_ && "Called Value() at end of table.");
+    return *value_;
+  }
+
+  void Next() {
+    FetchIfNeeded();
+    KALDI_ASSERT(!at_end_ && "Called Next() at end of table.");
+    delete value_;
+    value_ = NULL;
+    fetched_ = false;  // the next access fetches the next record.
+  }
+
+  ~PrefetchingSequentialTableReader() {
+    // Tell the background thread to exit even if we did not read to the
+    // end, and wake it if it is waiting for a free queue slot.
+    mutex_.Lock();
+    cancel_ = true;
+    mutex_.Unlock();
+    empty_slots_.Signal();
+    int32 ret = pthread_join(thread_, NULL);
+    if (ret != 0) {
+      const char *c = strerror(ret);
+      KALDI_ERR << "Error joining thread, errno was: " << (c ? c : "[NULL]");
+    }
+    delete value_;
+    for (size_t i = 0; i < queue_.size(); i++)
+      delete queue_[i].second;
+  }
+
+ private:
+  static void* RunBackgroundThread(void *ptr) {
+    static_cast<PrefetchingSequentialTableReader<Holder>*>(ptr)
+        ->BackgroundLoop();
+    return NULL;
+  }
+
+  void BackgroundLoop() {
+    try {
+      for (; !reader_.Done(); reader_.Next()) {
+        empty_slots_.Wait();
+        mutex_.Lock();
+        if (cancel_) {
+          mutex_.Unlock();
+          return;
+        }
+        mutex_.Unlock();
+        // Deserialization happens here (in reader_.Value(), for the first
+        // access to this record), outside the lock.
+        std::string key = reader_.Key();
+        T *value = new T(reader_.Value());
+        mutex_.Lock();
+        queue_.push_back(std::make_pair(key, value));
+        mutex_.Unlock();
+        full_slots_.Signal();
+      }
+    } catch(const std::exception &e) {
+      mutex_.Lock();
+      error_ = true;
+      error_message_ = e.what();
+      mutex_.Unlock();
+    }
+    mutex_.Lock();
+    producer_done_ = true;
+    mutex_.Unlock();
+    full_slots_.Signal();  // wake the consumer so it can see we are done.
+  }
+
+  // If we do not have a current record, blocks until the background thread
+  // has produced one (or reached the end of the table), and takes it.
+  void FetchIfNeeded() {
+    if (fetched_)
+      return;
+    full_slots_.Wait();
+    mutex_.Lock();
+    if (!queue_.empty()) {
+      key_ = queue_.front().first;
+      value_ = queue_.front().second;
+      queue_.pop_front();
+      mutex_.Unlock();
+      empty_slots_.Signal();
+      fetched_ = true;
+    } else {  // the producer is done (normally, or with an error; any
+              // records it read before an error have been delivered).
+      bool error = error_;
+      std::string message = error_message_;
+      at_end_ = true;
+      mutex_.Unlock();
+      full_slots_.Signal();  // so any further calls do not block.
+      fetched_ = true;
+      if (error)
+        KALDI_ERR << "Error reading table in background: " << message;
+    }
+  }
+
+  SequentialTableReader<Holder> reader_;  // only accessed by the
+                                          // background thread after the
+                                          // constructor.
+  pthread_t thread_;
+
+  Mutex mutex_;  // guards queue_, producer_done_, cancel_, error_ and
+                 // error_message_.
+  std::deque<std::pair<std::string, T*> > queue_;
+  Semaphore empty_slots_;  // free queue slots; the background thread waits
+                           // on this.
+  Semaphore full_slots_;   // queued records (plus one final token when the
+                           // producer finishes); FetchIfNeeded() waits on
+                           // this.
+  bool producer_done_;
+  bool cancel_;
+  bool error_;
+  std::string error_message_;
+
+  // The current record; accessed from the consumer thread only.
+  bool fetched_;
+  bool at_end_;
+  std::string key_;
+  T *value_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(PrefetchingSequentialTableReader);
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_THREAD_KALDI_PREFETCH_TABLE_READER_H_
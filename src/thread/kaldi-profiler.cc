@@ -0,0 +1,135 @@
+// thread/kaldi-profiler.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <signal.h>
+#include <cstdlib>
+
+#include "thread/kaldi-profiler.h"
+#include "thread/kaldi-mutex.h"
+#include "base/timer.h"
+
+namespace kaldi {
+
+bool Profiler::enabled_ = (getenv("KALDI_PROFILE") != NULL);
+pthread_key_t Profiler::key_;
+pthread_once_t Profiler::once_ = PTHREAD_ONCE_INIT;
+
+// All profilers ever created, so Dump() can cover every thread; guarded by
+// profiler_list_mutex.  Profilers are never freed (see ~Profiler()).
+static Mutex profiler_list_mutex;
+static std::vector<Profiler*> *profiler_list = NULL;
+
+// Tick-rate calibration: we note the tick counter and the wall-clock time
+// when the first profiler is created, and again when Dump() runs; the ratio
+// gives ticks per second averaged over the run, which is accurate enough
+// for a report (modern x86 has a constant-rate tsc anyway).
+static uint64 calibration_ticks = 0;
+static Timer *calibration_timer = NULL;
+
+static void ProfileDumpSignalHandler(int) {
+  // Not async-signal-safe (it allocates and writes to stderr), but this is
+  // a diagnostic facility that is off by default; the worst case is a
+  // garbled dump.
+  Profiler::Dump();
+}
+
+static void ProfileDumpAtExit() {
+  Profiler::Dump();
+}
+
+void Profiler::InitKey() {
+  // No key destructor: the per-thread trees must outlive their threads so
+  // that the dump at program exit includes them.
+  int ret = pthread_key_create(&key_, NULL);
+  if (ret != 0)
+    KALDI_ERR << "Cannot create thread-specific key for profiler, error is: "
+              << strerror(ret);
+}
+
+Profiler::Profiler(): root_("<root>", NULL), current_(&root_) { }
+
+Profiler *Profiler::ThreadInstance() {
+  pthread_once(&once_, InitKey);
+  Profiler *profiler = static_cast<Profiler*>(pthread_getspecific(key_));
+  if (profiler == NULL) {
+    profiler = new Profiler();
+    pthread_setspecific(key_, profiler);
+    profiler_list_mutex.Lock();
+    if (profiler_list == NULL) {  // first profiled scope in the program:
+      profiler_list = new std::vector<Profiler*>();
+      calibration_ticks = GetCpuTicks();
+      calibration_timer = new Timer();
+      atexit(ProfileDumpAtExit);
+      signal(SIGUSR1, ProfileDumpSignalHandler);
+    }
+    profiler_list->push_back(profiler);
+    profiler_list_mutex.Unlock();
+  }
+  return profiler;
+}
+
+void Profiler::DumpNode(const ProfileNode &node, int32 depth,
+                        uint64 parent_ticks, double seconds_per_tick,
+                        std::ostringstream *os) {
+  (*os) << std::string(static_cast<size_t>(depth) * 2, ' ') << node.name
+        << ": count=" << node.count << ", time="
+        << (node.ticks * seconds_per_tick) << "s";
+  if (parent_ticks > 0)
+    (*os) << " (" << (100.0 * node.ticks / parent_ticks) << "% of parent)";
+  uint64 child_ticks = 0;
+  for (size_t i = 0; i < node.children.size(); i++)
+    child_ticks += node.children[i]->ticks;
+  if (!node.children.empty() && node.ticks > child_ticks)
+    (*os) << ", self=" << ((node.ticks - child_ticks) * seconds_per_tick)
+          << "s";
+  (*os) << '\n';
+  for (size_t i = 0; i < node.children.size(); i++)
+    DumpNode(*(node.children[i]), depth + 1, node.ticks, seconds_per_tick,
+             os);
+}
+
+void Profiler::Dump() {
+  profiler_list_mutex.Lock();
+  if (profiler_list == NULL || profiler_list->empty()) {
+    profiler_list_mutex.Unlock();
+    return;
+  }
+  double elapsed_ticks = static_cast<double>(GetCpuTicks() -
+                                             calibration_ticks),
+      elapsed_seconds = calibration_timer->Elapsed();
+  double seconds_per_tick = (elapsed_ticks > 0.0 ?
+                             elapsed_seconds / elapsed_ticks : 0.0);
+  std::ostringstream os;
+  os << "Profile over " << elapsed_seconds << " seconds of wall-clock time ("
+     << profiler_list->size() << " thread(s) recorded scopes):\n";
+  for (size_t t = 0; t < profiler_list->size(); t++) {
+    const ProfileNode &root = (*profiler_list)[t]->root_;
+    uint64 total_ticks = 0;
+    for (size_t i = 0; i < root.children.size(); i++)
+      total_ticks += root.children[i]->ticks;
+    os << "Thread " << t << " (total "
+       << (total_ticks * seconds_per_tick) << "s in scopes):\n";
+    for (size_t i = 0; i < root.children.size(); i++)
+      DumpNode(*(root.children[i]), 1, total_ticks, seconds_per_tick, &os);
+  }
+  profiler_list_mutex.Unlock();
+  KALDI_LOG << os.str();
+}
+
+}  // namespace kaldi
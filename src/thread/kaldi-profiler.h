@@ -0,0 +1,197 @@
+// thread/kaldi-profiler.h
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_THREAD_KALDI_PROFILER_H_
+#define KALDI_THREAD_KALDI_PROFILER_H_
+
+#include <pthread.h>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <sys/time.h>
+#endif
+
+#include "base/kaldi-common.h"
+
+namespace kaldi {
+
+/// \file kaldi-profiler.h
+/// A lightweight scoped profiler for finding out where time goes inside a
+/// binary, without an external profiler.  Code marks its hot regions with
+///   KALDI_PROFILE_SCOPE("LatticeFasterDecoder::ProcessEmitting");
+/// at the top of a block; scopes nest, so the dump is a tree of named
+/// regions with call counts, time, and percentage of the parent.  Each
+/// thread accumulates into its own tree (no locking on the hot path), and
+/// the trees of all threads that ever recorded a scope are printed by
+/// Profiler::Dump(), which runs automatically at exit and on SIGUSR1.
+///
+/// The whole facility is off unless the environment variable KALDI_PROFILE
+/// is set; when it is off, a scope costs a single test of a bool, and
+/// compiling with -DKALDI_NO_PROFILE removes even that.  Timing uses the
+/// processor cycle counter (rdtsc) on x86, falling back to gettimeofday()
+/// elsewhere; the cycle rate is calibrated against wall-clock time when the
+/// dump is printed, so times are reported in seconds.
+///
+/// Caveats: a scope's time includes its children (the dump also shows the
+/// "self" time with children subtracted); recursive scopes appear once per
+/// nesting level; and a dump triggered by a signal while threads are
+/// running reads their counters without synchronization, so it is
+/// approximate (fine for diagnostics, which is all this is for).
+
+/// Returns a monotonically increasing tick count: processor cycles on x86,
+/// microseconds elsewhere.  Only differences of ticks are meaningful; the
+/// tick rate is measured against wall-clock time in Profiler::Dump().
+inline uint64 GetCpuTicks() {
+#if defined(_MSC_VER)
+  return __rdtsc();
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  uint32 lo, hi;
+  __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+  return (static_cast<uint64>(hi) << 32) | lo;
+#else
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return static_cast<uint64>(tv.tv_sec) * 1000000 + tv.tv_usec;
+#endif
+}
+
+/// One node in a thread's tree of profiled scopes.  The name pointers are
+/// the string literals passed to KALDI_PROFILE_SCOPE, so they must stay
+/// valid for the life of the program (string literals always do).
+struct ProfileNode {
+  const char *name;
+  ProfileNode *parent;  // NULL only for the per-thread root.
+  int64 count;          // number of times the scope was entered.
+  uint64 ticks;         // total ticks inside the scope, children included.
+  std::vector<ProfileNode*> children;
+
+  ProfileNode(const char *name, ProfileNode *parent):
+      name(name), parent(parent), count(0), ticks(0) { }
+  ~ProfileNode() {
+    for (size_t i = 0; i < children.size(); i++)
+      delete children[i];
+  }
+};
+
+/// Per-thread profile state; you don't normally use this class directly,
+/// only the KALDI_PROFILE_SCOPE macro and possibly Profiler::Dump().
+class Profiler {
+ public:
+  /// True if the KALDI_PROFILE environment variable was set when the
+  /// program started; when false, scopes do nothing.
+  static inline bool Enabled() { return enabled_; }
+
+  /// Returns this thread's Profiler, creating and registering it on the
+  /// first call from each thread.
+  static Profiler *ThreadInstance();
+
+  /// Enters the scope "name" as a child of the current scope, creating the
+  /// node the first time, and makes it current.  The lookup is a linear
+  /// scan with strcmp over the current node's children, which are few.
+  inline ProfileNode *Enter(const char *name) {
+    ProfileNode *cur = current_;
+    for (size_t i = 0; i < cur->children.size(); i++)
+      if (strcmp(cur->children[i]->name, name) == 0) {
+        current_ = cur->children[i];
+        return current_;
+      }
+    ProfileNode *node = new ProfileNode(name, cur);
+    cur->children.push_back(node);
+    current_ = node;
+    return node;
+  }
+
+  /// Credits "ticks" to "node" and makes its parent current again.  Scopes
+  /// are stack objects so Exit calls are always in LIFO order.
+  inline void Exit(ProfileNode *node, uint64 ticks) {
+    node->count++;
+    node->ticks += ticks;
+    current_ = node->parent;
+  }
+
+  /// Prints the profile trees of all threads via KALDI_LOG.  Called
+  /// automatically at exit and on SIGUSR1 (both installed on first use);
+  /// you can also call it yourself, e.g. once per utterance.  Does nothing
+  /// if no scope was ever entered.
+  static void Dump();
+
+ private:
+  Profiler();
+  ~Profiler() { }  // never destroyed: trees must survive thread exit so the
+                   // dump at program exit still covers finished threads.
+
+  static void InitKey();
+  static void DumpNode(const ProfileNode &node, int32 depth,
+                       uint64 parent_ticks, double seconds_per_tick,
+                       std::ostringstream *os);
+
+  ProfileNode root_;
+  ProfileNode *current_;
+
+  static bool enabled_;
+  static pthread_key_t key_;
+  static pthread_once_t once_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(Profiler);
+};
+
+/// RAII object created by KALDI_PROFILE_SCOPE; times a scope from its
+/// construction to the end of the enclosing block.
+class ProfileScope {
+ public:
+  explicit inline ProfileScope(const char *name) {
+    if (!Profiler::Enabled()) {
+      profiler_ = NULL;
+      return;
+    }
+    profiler_ = Profiler::ThreadInstance();
+    node_ = profiler_->Enter(name);
+    begin_ticks_ = GetCpuTicks();
+  }
+  inline ~ProfileScope() {
+    if (profiler_ != NULL)
+      profiler_->Exit(node_, GetCpuTicks() - begin_ticks_);
+  }
+ private:
+  Profiler *profiler_;
+  ProfileNode *node_;
+  uint64 begin_ticks_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(ProfileScope);
+};
+
+#if defined(KALDI_NO_PROFILE)
+#define KALDI_PROFILE_SCOPE(name)
+#else
+#define KALDI_PROFILE_PASTE_AUX(a, b) a ## b
+#define KALDI_PROFILE_PASTE(a, b) KALDI_PROFILE_PASTE_AUX(a, b)
+/// Put KALDI_PROFILE_SCOPE("SomeClass::SomeFunction"); at the top of a
+/// block to time it; "name" must be a string literal.  The __LINE__ paste
+/// lets two scopes coexist in one block (e.g. in nested braces).
+#define KALDI_PROFILE_SCOPE(name) \
+  ::kaldi::ProfileScope KALDI_PROFILE_PASTE(kaldi_profile_scope_, \
+                                            __LINE__)(name)
+#endif
+
+}  // namespace kaldi
+
+#endif  // KALDI_THREAD_KALDI_PROFILER_H_
@@ -66,11 +66,54 @@ void TestTaskSequencer() {
     KALDI_ASSERT(task_output[i] == i);
 }
 
+void TestTaskSequencerStats() {
+  TaskSequencerConfig config;
+  config.num_threads = 1 + Rand() % 8;
+  config.print_stats = true;  // exercise the printout in the destructor.
+
+  int32 num_tasks = 10 + Rand() % 100;
+  std::vector<int32> task_output;
+  {
+    TaskSequencer<MyTaskClass> sequencer(config);
+    for (int32 i = 0; i < num_tasks; i++)
+      sequencer.Run(new MyTaskClass(i, &task_output));
+    sequencer.Wait();
+    TaskSequencerStats stats = sequencer.GetStats();
+    KALDI_ASSERT(stats.num_tasks == num_tasks);
+    KALDI_ASSERT(stats.num_completed == num_tasks);
+    // one queue-depth sample per Run() call...
+    KALDI_ASSERT(stats.num_depth_samples == num_tasks);
+    KALDI_ASSERT(stats.max_depth >= 1 && stats.depth_sum >= num_tasks);
+    // ... and each task lands in exactly one lag bucket.
+    int64 hist_sum = 0;
+    for (int32 b = 0; b < TaskSequencerStats::kNumLagBuckets; b++)
+      hist_sum += stats.lag_histogram[b];
+    KALDI_ASSERT(hist_sum == num_tasks);
+    KALDI_ASSERT(stats.total_task_secs >= 0.0 &&
+                 stats.finish_to_reap_secs >= 0.0);
+    KALDI_ASSERT(sequencer.ElapsedSecs() > 0.0);
+    KALDI_LOG << stats.Info(sequencer.ElapsedSecs(), config.num_threads);
+  }
+  KALDI_ASSERT(task_output.size() == static_cast<size_t>(num_tasks));
+  // With one thread everything completes in submission order, so all
+  // tasks must be in lag bucket zero.
+  config.num_threads = 1;
+  config.print_stats = false;
+  task_output.clear();
+  TaskSequencer<MyTaskClass> sequencer(config);
+  for (int32 i = 0; i < num_tasks; i++)
+    sequencer.Run(new MyTaskClass(i, &task_output));
+  sequencer.Wait();
+  KALDI_ASSERT(sequencer.GetStats().lag_histogram[0] == num_tasks);
+}
+
 }  // end namespace kaldi.
 
 int main() {
   using namespace kaldi;
   for (int32 i = 0; i < 1000; i++)
     TestTaskSequencer();
+  for (int32 i = 0; i < 10; i++)
+    TestTaskSequencerStats();
 }
 
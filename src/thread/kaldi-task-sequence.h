@@ -21,9 +21,15 @@
 #define KALDI_THREAD_KALDI_TASK_SEQUENCE_H_ 1
 
 #include <pthread.h>
+#include <deque>
+#include <sstream>
+#include "base/timer.h"
 #include "thread/kaldi-thread.h"
 #include "itf/options-itf.h"
+#include "thread/kaldi-mutex.h"
+#include "thread/kaldi-numa.h"
 #include "thread/kaldi-semaphore.h"
+#include "thread/kaldi-thread-pool.h"
 
 
 namespace kaldi {
@@ -46,21 +52,26 @@ namespace kaldi {
    does some kind of output).  We have a templated class TaskSequencer<C> which
    is responsible for running the jobs in parallel.  It has a function Run()
    that will accept a new object of class C; this will block until a thread is
-   free, at which time it will spawn a thread that starts running the operator
-   () of the class.  When classes are finished running, the objects will be
-   deleted.  Class TaskSequencer guarantees that the destructors will be called
-   sequentially (not in parallel) and in the same order the objects were given
-   to the Run() function, so that it is safe for the destructor to have side
-   effects such as outputting data.
+   free, at which time the operator () of the object starts running on a
+   thread from the process-wide pool (see kaldi-thread-pool.h).  When objects
+   are finished running, they will be deleted.  Class TaskSequencer guarantees
+   that the destructors will be called sequentially (not in parallel) and in
+   the same order the objects were given to the Run() function, so that it is
+   safe for the destructor to have side effects such as outputting data; the
+   destructors run on the thread that calls Run() (and Wait()), as finished
+   tasks get collected.
 
    Note: the destructor of TaskSequencer will wait for any remaining jobs that
-   are still running and will call the destructors.   
+   are still running and will call the destructors.
  */
 
 struct TaskSequencerConfig {
   int32 num_threads;
   int32 num_threads_total;
-  TaskSequencerConfig(): num_threads(1), num_threads_total(0)  { }
+  bool pin_numa_nodes;
+  bool print_stats;
+  TaskSequencerConfig(): num_threads(1), num_threads_total(0),
+                         pin_numa_nodes(false), print_stats(false)  { }
   void Register(OptionsItf *opts) {
     opts->Register("num-threads", &num_threads, "Number of actively processing "
                    "threads to run in parallel");
@@ -69,6 +80,111 @@ struct TaskSequencerConfig {
                    "to produce their output.  Controls memory use.  If <= 0, "
                    "defaults to --num-threads plus 20.  Otherwise, must "
                    "be >= num-threads.");
+    opts->Register("pin-numa-nodes", &pin_numa_nodes, "If true, pin each "
+                   "task's thread to a NUMA node (assigned round-robin), "
+                   "which reduces cross-socket memory traffic on "
+                   "multi-socket machines.  No effect on single-socket "
+                   "machines.");
+    opts->Register("print-task-stats", &print_stats, "If true, print "
+                   "statistics on task timing, queue depth and "
+                   "completion-order lag when all tasks have finished; "
+                   "useful for choosing --num-threads (e.g. low thread "
+                   "utilization with little submit-wait time means the "
+                   "caller, not the workers, is the bottleneck).");
+  }
+};
+
+
+/// Statistics accumulated by TaskSequencer, for tuning --num-threads and
+/// diagnosing where time goes (see the comments on the members, and
+/// --print-task-stats).  All times are wall-clock seconds.  Get a snapshot
+/// with TaskSequencer::GetStats(), which may be polled live; a summary is
+/// printed at destruction if configured.
+struct TaskSequencerStats {
+  enum { kNumLagBuckets = 12 };
+  int64 num_tasks;     // tasks submitted to Run() so far.
+  int64 num_completed; // tasks whose operator () has finished.
+  double total_task_secs;  // total wall time spent inside the tasks'
+                           // operator () across all workers; dividing by
+                           // (elapsed time * num-threads) gives the thread
+                           // utilization.
+  double submit_wait_secs; // time Run() spent blocked because all compute
+                           // slots were busy.  Near zero means the workers
+                           // starve on input and fewer threads would do.
+  double reap_wait_secs;   // time the calling thread spent blocked waiting
+                           // for the oldest task to finish so destructors
+                           // could run in order (this includes the final
+                           // drain in Wait()).
+  double finish_to_reap_secs; // total time tasks spent finished but queued
+                              // behind not-yet-finished earlier tasks; the
+                              // cost of the in-order-output guarantee.
+  int64 num_depth_samples; // the pending-task queue depth is sampled once
+                           // per Run() call; this counts the samples...
+  int64 depth_sum;         // ... and this is their sum, so
+                           // depth_sum / num_depth_samples is the average.
+  int32 max_depth;         // deepest the pending-task queue has been.
+  // lag_histogram[b] counts tasks by how far their position in completion
+  // order diverged from their position in submission order: bucket 0 is
+  // "completed exactly in order", bucket 1 is a divergence of 1, and
+  // bucket b >= 2 holds divergences in [2^(b-1), 2^b) (the last bucket
+  // takes everything larger).  A heavy tail means task run-times vary a
+  // lot, so finished tasks pile up behind slow ones and num-threads-total
+  // (which bounds that pile) may matter more than num-threads.
+  int64 lag_histogram[kNumLagBuckets];
+
+  TaskSequencerStats(): num_tasks(0), num_completed(0), total_task_secs(0.0),
+                        submit_wait_secs(0.0), reap_wait_secs(0.0),
+                        finish_to_reap_secs(0.0), num_depth_samples(0),
+                        depth_sum(0), max_depth(0) {
+    for (int32 b = 0; b < kNumLagBuckets; b++)
+      lag_histogram[b] = 0;
+  }
+
+  // Maps a completion-order divergence to its histogram bucket.
+  static int32 LagBucket(int64 lag) {
+    if (lag < 0) lag = -lag;
+    if (lag == 0) return 0;
+    int32 b = 1;
+    while (lag > 1 && b < kNumLagBuckets - 1) {
+      lag >>= 1;
+      b++;
+    }
+    return b;
+  }
+
+  /// Returns a one-line human-readable summary.  "elapsed_secs" should be
+  /// the wall time over which the stats were accumulated and "num_threads"
+  /// the configured number of compute threads; they are used to report the
+  /// thread utilization.
+  std::string Info(double elapsed_secs, int32 num_threads) const {
+    std::ostringstream os;
+    os << "num-tasks=" << num_tasks << ", num-threads=" << num_threads
+       << ", elapsed-secs=" << elapsed_secs
+       << ", task-secs=" << total_task_secs;
+    if (elapsed_secs > 0.0 && num_threads > 0)
+      os << ", thread-utilization="
+         << (total_task_secs / (elapsed_secs * num_threads));
+    os << ", submit-wait-secs=" << submit_wait_secs
+       << ", reap-wait-secs=" << reap_wait_secs
+       << ", finish-to-reap-secs=" << finish_to_reap_secs;
+    if (num_depth_samples > 0)
+      os << ", avg-queue-depth="
+         << (depth_sum / static_cast<double>(num_depth_samples))
+         << ", max-queue-depth=" << max_depth;
+    os << ", completion-lag-histogram=[";
+    bool first = true;
+    for (int32 b = 0; b < kNumLagBuckets; b++) {
+      if (lag_histogram[b] == 0) continue;
+      if (!first) os << " ";
+      first = false;
+      if (b == 0) os << "0:";
+      else if (b == 1) os << "1:";
+      else if (b == kNumLagBuckets - 1) os << (1 << (b - 1)) << "+:";
+      else os << (1 << (b - 1)) << "-" << ((1 << b) - 1) << ":";
+      os << lag_histogram[b];
+    }
+    os << "]";
+    return os.str();
   }
 };
 
@@ -80,9 +196,12 @@ class TaskSequencer {
  public:
   TaskSequencer(const TaskSequencerConfig &config):
       threads_avail_(config.num_threads),
-      tot_threads_avail_(config.num_threads_total > 0 ? config.num_threads_total :
-                         config.num_threads + 20),
-      thread_list_(NULL) {
+      num_threads_(config.num_threads),
+      max_pending_(config.num_threads_total > 0 ? config.num_threads_total :
+                   config.num_threads + 20),
+      pin_numa_nodes_(config.pin_numa_nodes),
+      next_numa_node_(0),
+      print_stats_(config.print_stats) {
     KALDI_ASSERT((config.num_threads_total <= 0 ||
                   config.num_threads_total >= config.num_threads) &&
                  "num-threads-total, if specified, must be >= num-threads");
@@ -91,105 +210,168 @@ class TaskSequencer {
   /// This function takes ownership of the pointer "c", and will delete it
   /// in the same sequence as Run was called on the jobs.
   void Run(C *c) {
-    threads_avail_.Wait(); // wait till we have a thread for computation free.
-    tot_threads_avail_.Wait(); // this ensures we don't have too many threads
-    // waiting on I/O, and consume too much memory.
-    
-    // put the new RunTaskArgsList object at head of the singly
-    // linked list thread_list_.
-    thread_list_ = new RunTaskArgsList(this, c, thread_list_);
-    int32 ret;
-    if ((ret=pthread_create(&(thread_list_->thread),
-                            NULL, // default attributes
-                            TaskSequencer<C>::RunTask,
-                            static_cast<void*>(thread_list_)))) {
-      const char *c = strerror(ret);
-      KALDI_ERR << "Error creating thread, errno was: " << (c ? c : "[NULL]");
+    if (!threads_avail_.TryWait()) {
+      // All compute slots are busy: wait for one, and record for how long
+      // (this is the "workers can't keep up with the caller" time).
+      Timer wait_timer;
+      threads_avail_.Wait();
+      stats_mutex_.Lock();
+      stats_.submit_wait_secs += wait_timer.Elapsed();
+      stats_mutex_.Unlock();
+    }
+
+    // Limit the number of finished-but-not-yet-deleted tasks we keep
+    // around, as the objects may hold memory or pending output.
+    while (static_cast<int32>(pending_.size()) >= max_pending_)
+      ReapOldest(true);
+
+    TaskRecord *record = new TaskRecord(this, c);
+    if (pin_numa_nodes_) {
+      record->numa_node = next_numa_node_;
+      next_numa_node_ = (next_numa_node_ + 1) % NumNumaNodes();
     }
+    pending_.push_back(record);
+    stats_mutex_.Lock();
+    record->seq = stats_.num_tasks++;
+    int32 depth = static_cast<int32>(pending_.size());
+    stats_.num_depth_samples++;
+    stats_.depth_sum += depth;
+    if (depth > stats_.max_depth) stats_.max_depth = depth;
+    stats_mutex_.Unlock();
+    ThreadPool::Instance()->Submit(TaskSequencer<C>::RunTask,
+                                   static_cast<void*>(record),
+                                   &record->future);
+
+    // Opportunistically delete (in order) any tasks that have already
+    // finished, so output from the destructors keeps flowing without
+    // waiting for the limits above to be hit.
+    while (!pending_.empty() && ReapOldest(false));
   }
 
   void Wait() { // You call this at the end if it's more convenient
     // than waiting for the destructor.  It waits for all tasks to finish.
-    if (thread_list_ != NULL) {
-      int ret = pthread_join(thread_list_->thread, NULL);
-      if (ret != 0) {
-        const char *c = strerror(ret);
-        KALDI_ERR << "Error joining thread, errno was: " << (c ? c : "[NULL]");
-      }
-      KALDI_ASSERT(thread_list_->tail == NULL); // thread would not
-      // have exited without setting tail to NULL.
-      delete thread_list_;
-      thread_list_ = NULL;
-    }
+    while (!pending_.empty())
+      ReapOldest(true);
   }
-  
-  /// The destructor waits for the last thread to exit.
+
+  /// The destructor waits for all the tasks to finish.
   ~TaskSequencer() {
-    Wait();      
+    Wait();
+    if (print_stats_)
+      KALDI_LOG << "TaskSequencer stats: "
+                << stats_.Info(timer_.Elapsed(), num_threads_);
   }
+
+  /// Returns a snapshot of the statistics accumulated so far; safe to call
+  /// at any time, including from a monitoring thread while tasks run.
+  TaskSequencerStats GetStats() {
+    stats_mutex_.Lock();
+    TaskSequencerStats ans = stats_;
+    stats_mutex_.Unlock();
+    return ans;
+  }
+
+  /// Wall time in seconds since this sequencer was constructed; useful
+  /// together with GetStats() (e.g. for the utilization in Info()).
+  double ElapsedSecs() { return timer_.Elapsed(); }
+
  private:
-  struct RunTaskArgsList {
+  struct TaskRecord {
     TaskSequencer *me; // Think of this as a "this" pointer.
-    C *c; // Clist element of the task we're expected
-    pthread_t thread;
-    RunTaskArgsList *tail;
-    RunTaskArgsList(TaskSequencer *me, C *c, RunTaskArgsList *tail):
-        me(me), c(c), tail(tail) {}
+    C *c; // the task we're expected to run and then delete.
+    ThreadPoolFuture future; // signalled when operator () has finished.
+    int32 numa_node; // node to pin the thread to while running, or -1.
+    int64 seq; // position in submission order, for the lag histogram.
+    double finish_time; // when (on me->timer_) operator () finished;
+                        // written before the future is signalled.
+    TaskRecord(TaskSequencer *me, C *c): me(me), c(c), numa_node(-1),
+                                         seq(0), finish_time(0.0) {}
   };
-  // This static function gets run in the threads that we create.
+
+  // This static function gets run in the pool's worker threads; it does
+  // the computation but not the deletion, which happens in ReapOldest() so
+  // that the destructors run sequentially in the order Run() was called.
   static void* RunTask(void *input) {
-    RunTaskArgsList *args = static_cast<RunTaskArgsList*>(input);
-    
-    // (1) run the job.
-    (*(args->c))(); // call operator () on args->c, which does the computation.
-    args->me->threads_avail_.Signal(); // Signal that the compute-intensive
-    // part of the thread is done (we want to run no more than
-    // config_.num_threads of these.)
-    
-    // (2) we want to destroy the object "c" now, by deleting it.  But for
-    //     correct sequencing (this is the whole point of this class, it
-    //     is intended to ensure the output of the program is in correct order),
-    //     we first wait till the previous thread, whose details will be in "tail",
-    //     is finished.
-    if (args->tail != NULL) {
-      int ret = pthread_join(args->tail->thread, NULL);
-      if (ret != 0) {
-        const char *c = strerror(ret);
-        KALDI_ERR << "Error joining thread, errno was: " << (c ? c : "[NULL]");
-      }
+    TaskRecord *record = static_cast<TaskRecord*>(input);
+    TaskSequencer *me = record->me;
+    double task_secs;
+    {
+      // Pins to a NUMA node for the duration of the computation if
+      // --pin-numa-nodes was set (numa_node is -1 otherwise, making this a
+      // no-op); the previous affinity is restored before the thread goes
+      // back to the pool.
+      ScopedNumaPin pin(record->numa_node);
+      Timer task_timer;
+      (*(record->c))(); // call operator () on record->c, which does the computation.
+      task_secs = task_timer.Elapsed();
     }
+    me->stats_mutex_.Lock();
+    int64 completion_index = me->stats_.num_completed++;
+    me->stats_.total_task_secs += task_secs;
+    me->stats_.lag_histogram[
+        TaskSequencerStats::LagBucket(record->seq - completion_index)]++;
+    record->finish_time = me->timer_.Elapsed();
+    me->stats_mutex_.Unlock();
+    record->me->threads_avail_.Signal(); // Signal that the compute-intensive
+    // part of the task is done (we want to run no more than
+    // config_.num_threads of these.)
+    return NULL;
+  }
 
-    delete args->c; // delete the object "c".  This may cause some output,
-    // e.g. to a stream.  We don't need to worry about concurrent access to
-    // the output stream, because each thread waits for the previous thread
-    // to be done, before doing this.  So there is no risk of concurrent
-    // access.
-    args->c = NULL;
-    
-    if (args->tail != NULL) {
-      KALDI_ASSERT(args->tail->tail == NULL); // Because we already
-      // did pthread_join on args->tail->thread, which means that
-      // thread was done, and before it exited, it would have
-      // deleted and set to NULL its tail (which is the next line of code).
-      delete args->tail;
-      args->tail = NULL;
+  // Deletes the oldest still-pending task's object (running its
+  // destructor); if "block" is false and that task has not yet finished,
+  // does nothing and returns false.  Must not be called with pending_
+  // empty.
+  bool ReapOldest(bool block) {
+    TaskRecord *record = pending_.front();
+    if (block) {
+      if (!record->future.TryWait()) {
+        // The oldest task is still running and we must wait for it before
+        // any later (possibly finished) task's output can be produced;
+        // this is the in-order-output constraint biting.
+        Timer wait_timer;
+        record->future.Wait();
+        stats_mutex_.Lock();
+        stats_.reap_wait_secs += wait_timer.Elapsed();
+        stats_mutex_.Unlock();
+      }
+    } else if (!record->future.TryWait()) {
+      return false;
     }
-    // At this point we are exiting from the thread.  Signal the
-    // "tot_threads_avail_" semaphore which is used to limit the total number of threads that are alive, including
-    // not onlhy those that are in active computation in c->operator (), but those
-    // that are waiting on I/O or other threads.
-    args->me->tot_threads_avail_.Signal();
-    // .. and exit the thread, by returning. 
-    return NULL;
+    stats_mutex_.Lock();
+    stats_.finish_to_reap_secs += timer_.Elapsed() - record->finish_time;
+    stats_mutex_.Unlock();
+    pending_.pop_front();
+    delete record->c; // This may cause some output, e.g. to a stream; it
+    // happens on the thread calling Run()/Wait(), always in order, so
+    // there is no risk of concurrent access.
+    delete record;
+    return true;
   }
 
   Semaphore threads_avail_; // Initialized to the number of threads we are
   // supposed to run with; the function Run() waits on this.
 
-  Semaphore tot_threads_avail_; // We use this semaphore to ensure we don't
-  // consume too much memory...
-  RunTaskArgsList *thread_list_; 
-  
+  int32 num_threads_; // config.num_threads; kept for the stats printout.
+
+  int32 max_pending_; // Maximum number of tasks that may be in pending_;
+  // bounds memory use, like the total-threads limit did when each task had
+  // its own thread.
+
+  bool pin_numa_nodes_; // see --pin-numa-nodes.
+  int32 next_numa_node_; // node the next task will be pinned to, if pinning.
+
+  bool print_stats_; // see --print-task-stats.
+
+  TaskSequencerStats stats_; // metrics on timing, queue depth and
+  // completion-order lag; guarded by stats_mutex_ since worker threads
+  // update the completion-side fields.
+  Mutex stats_mutex_;
+  Timer timer_; // started at construction; the time base for the stats.
+
+  std::deque<TaskRecord*> pending_; // Tasks submitted but not yet deleted,
+  // in the order Run() was called; accessed only by the thread calling
+  // Run()/Wait().
 };
 
 } // namespace kaldi
@@ -0,0 +1,107 @@
+// thread/kaldi-thread-pool-test.cc
+
+// Copyright 2015  Johns Hopkins University (Author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "base/kaldi-math.h"
+#include "thread/kaldi-thread-pool.h"
+#include "thread/kaldi-mutex.h"
+#include "thread/kaldi-semaphore.h"
+
+namespace kaldi {
+
+struct CounterTask {
+  Mutex *mutex;
+  int32 *counter;
+};
+
+static void *IncrementCounter(void *task_in) {
+  CounterTask *task = static_cast<CounterTask*>(task_in);
+  task->mutex->Lock();
+  (*task->counter)++;
+  task->mutex->Unlock();
+  return NULL;
+}
+
+void UnitTestThreadPoolBasic() {
+  // Many small batches, so threads get reused from the idle cache.
+  Mutex mutex;
+  int32 counter = 0, num_submitted = 0;
+  for (int32 iter = 0; iter < 100; iter++) {
+    int32 batch_size = 1 + Rand() % 8;
+    std::vector<CounterTask> tasks(batch_size);
+    ThreadPoolFuture *futures = new ThreadPoolFuture[batch_size];
+    for (int32 i = 0; i < batch_size; i++) {
+      tasks[i].mutex = &mutex;
+      tasks[i].counter = &counter;
+      ThreadPool::Instance()->Submit(IncrementCounter, &tasks[i],
+                                     &futures[i]);
+      num_submitted++;
+    }
+    for (int32 i = 0; i < batch_size; i++)
+      futures[i].Wait();
+    delete [] futures;
+    mutex.Lock();
+    KALDI_ASSERT(counter == num_submitted);
+    mutex.Unlock();
+  }
+}
+
+struct PingPongTask {
+  Semaphore *ping;
+  Semaphore *pong;
+};
+
+static void *PingPong(void *task_in) {
+  PingPongTask *task = static_cast<PingPongTask*>(task_in);
+  task->ping->Wait();
+  task->pong->Signal();
+  return NULL;
+}
+
+void UnitTestThreadPoolConcurrency() {
+  // Tasks submitted together must all run concurrently (they are never
+  // queued behind each other), so tasks that synchronize with each other,
+  // or with the main thread, do not deadlock.  Use more tasks than the
+  // pool will ever cache as idle threads.
+  int32 num_tasks = 50;
+  Semaphore ping, pong;
+  std::vector<PingPongTask> tasks(num_tasks);
+  ThreadPoolFuture *futures = new ThreadPoolFuture[num_tasks];
+  for (int32 i = 0; i < num_tasks; i++) {
+    tasks[i].ping = &ping;
+    tasks[i].pong = &pong;
+    ThreadPool::Instance()->Submit(PingPong, &tasks[i], &futures[i]);
+  }
+  for (int32 i = 0; i < num_tasks; i++)
+    ping.Signal();
+  for (int32 i = 0; i < num_tasks; i++)
+    pong.Wait();
+  for (int32 i = 0; i < num_tasks; i++)
+    futures[i].Wait();
+  delete [] futures;
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  UnitTestThreadPoolBasic();
+  UnitTestThreadPoolConcurrency();
+  std::cout << "Test OK.\n";
+  return 0;
+}
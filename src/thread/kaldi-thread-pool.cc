@@ -0,0 +1,105 @@
+// thread/kaldi-thread-pool.cc
+
+// Copyright 2015  Johns Hopkins University (Author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "thread/kaldi-thread-pool.h"
+
+namespace kaldi {
+
+// Idle threads above this number exit instead of being cached; it bounds
+// the resources the pool holds on to after a burst of parallelism.
+static const int32 kMaxIdleThreads = 32;
+
+ThreadPool *ThreadPool::instance_ = NULL;
+pthread_once_t ThreadPool::instance_once_ = PTHREAD_ONCE_INIT;
+
+void ThreadPool::InitInstance() {
+  // Never deleted: see the comment for Instance() in the header.
+  instance_ = new ThreadPool();
+}
+
+ThreadPool *ThreadPool::Instance() {
+  pthread_once(&instance_once_, ThreadPool::InitInstance);
+  return instance_;
+}
+
+ThreadPool::ThreadPool() { }
+
+void *ThreadPool::RunWorker(void *worker_in) {
+  Worker *worker = static_cast<Worker*>(worker_in);
+  worker->pool->WorkerLoop(worker);
+  return NULL;
+}
+
+void ThreadPool::WorkerLoop(Worker *worker) {
+  while (true) {
+    worker->task_ready.Wait();
+    // Submit() set these before signalling task_ready.
+    void *(*func)(void *) = worker->func;
+    void *arg = worker->arg;
+    ThreadPoolFuture *future = worker->future;
+    (*func)(arg);
+    if (future != NULL)
+      future->done_.Signal();
+    mutex_.Lock();
+    if (static_cast<int32>(idle_workers_.size()) >= kMaxIdleThreads) {
+      mutex_.Unlock();
+      break;  // enough threads are cached already; this one exits.
+    }
+    idle_workers_.push_back(worker);
+    mutex_.Unlock();
+    // Note: another Submit() may already have taken this worker off the
+    // idle list and signalled task_ready again; the semaphore counts, so
+    // that task is not lost.
+  }
+  delete worker;  // the thread was created detached.
+}
+
+void ThreadPool::Submit(void *(*func)(void *), void *arg,
+                        ThreadPoolFuture *future) {
+  Worker *worker = NULL;
+  mutex_.Lock();
+  if (!idle_workers_.empty()) {
+    worker = idle_workers_.back();
+    idle_workers_.pop_back();
+  }
+  mutex_.Unlock();
+  if (worker == NULL) {  // No cached thread was idle: create one.
+    worker = new Worker();
+    worker->pool = this;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    // Detached: the worker cleans up after itself when it exits, and
+    // callers synchronize through futures, not pthread_join.
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    int32 ret;
+    if ((ret = pthread_create(&worker->thread, &attr,
+                              ThreadPool::RunWorker,
+                              static_cast<void*>(worker)))) {
+      const char *c = strerror(ret);
+      KALDI_ERR << "Error creating thread, errno was: " << (c ? c : "[NULL]");
+    }
+    pthread_attr_destroy(&attr);
+  }
+  worker->func = func;
+  worker->arg = arg;
+  worker->future = future;
+  worker->task_ready.Signal();
+}
+
+}  // end namespace kaldi
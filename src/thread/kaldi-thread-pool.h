@@ -0,0 +1,122 @@
+// thread/kaldi-thread-pool.h
+
+// Copyright 2015  Johns Hopkins University (Author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_THREAD_KALDI_THREAD_POOL_H_
+#define KALDI_THREAD_KALDI_THREAD_POOL_H_ 1
+
+#include <pthread.h>
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "thread/kaldi-mutex.h"
+#include "thread/kaldi-semaphore.h"
+
+namespace kaldi {
+
+/**
+   This header provides a process-wide pool of reusable worker threads, used
+   by MultiThreader (kaldi-thread.h) and TaskSequencer
+   (kaldi-task-sequence.h) instead of creating and joining a fresh pthread
+   for every task, which costs on the order of 100 microseconds per task and
+   adds up for fine-grained parallel sections.
+
+   Every submitted task starts running immediately on its own thread, just
+   as with pthread_create: an idle cached thread is reused if one is
+   available, and a new one is created otherwise (idle threads above a small
+   cap exit instead of being cached).  The pool deliberately does not queue
+   tasks behind one another: much of the code using these facilities blocks
+   inside tasks on semaphores or barriers that other tasks or the main
+   thread signal, which would deadlock with a fixed number of workers.  For
+   the same reason, limiting the number of *concurrent* tasks remains the
+   caller's job, as before (g_num_threads, and the --num-threads option of
+   TaskSequencerConfig).
+*/
+
+
+/// An object that Submit() will signal when the task it was passed with has
+/// finished; the thread that submitted the task can Wait() for it.  A
+/// ThreadPoolFuture may be reused for a new task after being waited for,
+/// but must not be destroyed with a task still pending.
+class ThreadPoolFuture {
+ public:
+  ThreadPoolFuture(): done_(0) { }
+
+  /// Waits until the associated task has finished.  Call exactly once per
+  /// submitted task.
+  void Wait() { done_.Wait(); }
+
+  /// As Wait(), but returns false instead of blocking if the task has not
+  /// yet finished (in which case Wait() or TryWait() must be called again).
+  bool TryWait() { return done_.TryWait(); }
+
+ private:
+  friend class ThreadPool;
+  Semaphore done_;
+  KALDI_DISALLOW_COPY_AND_ASSIGN(ThreadPoolFuture);
+};
+
+
+class ThreadPool {
+ public:
+  /// Returns the process-wide pool, creating it on first use (thread-safe).
+  /// The pool is never destroyed: worker threads may still be running user
+  /// tasks when the program exits.
+  static ThreadPool *Instance();
+
+  /// Runs func(arg) on a worker thread, reusing a cached idle thread if
+  /// possible.  The task starts immediately (it is never queued behind
+  /// other tasks, so it may safely block on work done by other tasks or by
+  /// the caller).  If "future" is non-NULL it will be signalled when
+  /// func(arg) returns; the return value of "func" is discarded, the type
+  /// being chosen to match pthread-style functions such as
+  /// MultiThreadable::run.  As with pthread_create, an exception escaping
+  /// "func" will terminate the program.
+  void Submit(void *(*func)(void *), void *arg, ThreadPoolFuture *future);
+
+ private:
+  ThreadPool();
+
+  // One cached worker thread; owned by its own thread (it deletes itself
+  // when it exits).
+  struct Worker {
+    Worker(): task_ready(0) { }
+    ThreadPool *pool;
+    pthread_t thread;
+    Semaphore task_ready;  // signalled when func/arg/future are set.
+    void *(*func)(void *);
+    void *arg;
+    ThreadPoolFuture *future;
+  };
+
+  static void *RunWorker(void *worker_in);
+  void WorkerLoop(Worker *worker);
+
+  static void InitInstance();
+  static ThreadPool *instance_;
+  static pthread_once_t instance_once_;
+
+  Mutex mutex_;  // guards idle_workers_.
+  std::vector<Worker*> idle_workers_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(ThreadPool);
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_THREAD_KALDI_THREAD_POOL_H_
@@ -29,34 +29,25 @@
 
 #include <pthread.h>
 #include "thread/kaldi-barrier.h"
+#include "thread/kaldi-thread-pool.h"
 // This header provides a convenient mechanism for parallelization.  The idea is
 // that you have some range of integers, e.g. A ... B-1 (with B > A), and some
 // function call that takes a range of integers, and you partition these up into
 // a number of blocks.
 // Also see kaldi-task-sequence.h which is suitable for parallelizing the processing
 // of tasks coming in sequentially from somewhere.
+//
+// The threads themselves come from the process-wide pool of reusable worker
+// threads in kaldi-thread-pool.h, so that repeated parallel sections do not
+// pay the cost of creating and joining fresh pthreads each time.  Each of
+// the parallel jobs still runs on its own thread, all of them concurrently,
+// so jobs may safely synchronize with each other (e.g. through a Barrier or
+// Semaphore) or with the main thread.
 
 // TODO: if needed, provide a workaround for Windows and other
 // non-POSIX-compliant systems, possibly one that does not actually do
 // multi-threading.
 
-
-// Description of MultiThreadPool and its usage:
-//
-// Usage of the RunMultiThreadedPersistent is the same as the usage of
-// RunMultiThreaded, except that the object provided ust inherit MultiThreadable
-// and it's run method isn't called, but operator() is called directly instead.
-// Member variables num_threads_ and thread_id_ must NOT be redefined in the
-// classes used, as they are called when using MultiThreadable*
-//
-// MultiThreadPool is a singleton class, it's instance is obtained using
-// MultiThreadPool::Instantiate(). First instantiation initializes the thread
-// pool using g_num_threads threads, each of those threads runs infinite loop in
-// ThreadWorker::run(). When RunMultiThreadedPersistent(c) is called, each
-// ThreadWorker is given a pointer to a copy of c and calls c() in it's thread.
-// After doing this, it Waits on barrier to sync with all the threads and the
-// main one, then Waits again until it receives another job.
-
 namespace kaldi {
 
 extern int32 g_num_threads;  // Maximum number of threads (for programs that
@@ -126,41 +117,33 @@ class MultiThreader {
  public:
   MultiThreader(int32 num_threads,
                 const C &c_in):
-    threads_(new pthread_t[std::max<int32>(1, num_threads)]),
+    futures_(new ThreadPoolFuture[std::max<int32>(1, num_threads)]),
+    num_submitted_(std::max<int32>(0, num_threads)),
     cvec_(std::max<int32>(1, num_threads), c_in) {
     if (num_threads == 0) {
       // This is a special case with num_threads == 0, which behaves like with
-      // num_threads == 1 but without creating extra threads.  This can be
+      // num_threads == 1 but without using extra threads.  This can be
       // useful in GPU computations where threads cannot be used.
-      KALDI_PTHREAD_PTR(threads_[0]) = 0;
       cvec_[0].thread_id_ = 0;
       cvec_[0].num_threads_ = 1;
       (cvec_[0])();
     } else {
-      pthread_attr_t pthread_attr;
-      pthread_attr_init(&pthread_attr);
       for (int32 thread = 0; thread < num_threads; thread++) {
         cvec_[thread].thread_id_ = thread;
         cvec_[thread].num_threads_ = num_threads;
-        int32 ret;
-        if ((ret=pthread_create(&(threads_[thread]),
-                                &pthread_attr, C::run, &(cvec_[thread])))) {
-          const char *c = strerror(ret);
-          if (c == NULL) { c = "[NULL]"; }
-          KALDI_ERR << "Error creating thread, errno was: " << c;
-        }
+        ThreadPool::Instance()->Submit(C::run, &(cvec_[thread]),
+                                       &(futures_[thread]));
       }
     }
   }
   ~MultiThreader() {
-    for (size_t thread = 0; thread < cvec_.size(); thread++)
-      if (KALDI_PTHREAD_PTR(threads_[thread]) != 0)
-        if (pthread_join(threads_[thread], NULL))
-          KALDI_ERR << "Error rejoining thread.";
-    delete [] threads_;
+    for (int32 thread = 0; thread < num_submitted_; thread++)
+      futures_[thread].Wait();
+    delete [] futures_;
   }
  private:
-  pthread_t *threads_;
+  ThreadPoolFuture *futures_;
+  int32 num_submitted_;
   std::vector<C> cvec_;
 };
 
@@ -222,6 +222,61 @@ void UnitTestFmllrDiagGmmOffset() {
   // mean that something is wrong.
 }
 
+// Tests that the whole-utterance (Matrix) versions of ApplyAffineTransform
+// and AccumulateFromPosteriors give the same results as the per-frame ones.
+void UnitTestFmllrDiagGmmBatched() {
+  using namespace kaldi;
+  DiagGmm gmm;
+  InitRandomGmm(&gmm);
+  int32 dim = gmm.Dim(), num_gauss = gmm.NumGauss();
+  int32 npoints = dim*(dim+1)*5;
+  Matrix<BaseFloat> rand_points(npoints, dim);
+  for (int32 i = 0; i < npoints; i++) {
+    SubVector<BaseFloat> row(rand_points, i);
+    gmm.Generate(&row);
+  }
+  Matrix<BaseFloat> xform(dim, dim+1);
+  xform.SetRandn();
+
+  {  // batched vs. per-row transform application.
+    Matrix<BaseFloat> xformed_points(rand_points);
+    ApplyAffineTransform(xform, &xformed_points);
+    for (int32 i = 0; i < npoints; i++) {
+      Vector<BaseFloat> row(rand_points.Row(i));
+      ApplyAffineTransform(xform, &row);
+      KALDI_ASSERT(row.ApproxEqual(xformed_points.Row(i), 0.001));
+    }
+  }
+
+  Matrix<BaseFloat> posteriors(npoints, num_gauss);
+  Vector<BaseFloat> post_row(num_gauss);
+  for (int32 i = 0; i < npoints; i++) {
+    gmm.ComponentPosteriors(rand_points.Row(i), &post_row);
+    posteriors.Row(i).CopyFromVec(post_row);
+  }
+
+  for (int32 j = 0; j < 2; j++) {  // exercise both the full and the
+                                   // diagonal-update stats.
+    FmllrOptions opts;
+    if (j == 1) opts.update_type = "diag";
+    FmllrDiagGmmAccs accs(dim, opts), batched_accs(dim, opts);
+    for (int32 i = 0; i < npoints; i++)
+      accs.AccumulateFromPosteriors(gmm, rand_points.Row(i),
+                                    posteriors.Row(i));
+    batched_accs.AccumulateFromPosteriors(gmm, rand_points, posteriors);
+
+    Matrix<BaseFloat> mat1(dim, dim+1), mat2(dim, dim+1);
+    mat1.SetUnit();
+    mat2.SetUnit();
+    BaseFloat impr1, count1, impr2, count2;
+    accs.Update(opts, &mat1, &impr1, &count1);
+    batched_accs.Update(opts, &mat2, &impr2, &count2);
+    KALDI_ASSERT(ApproxEqual(count1, count2));
+    KALDI_ASSERT(ApproxEqual(impr1, impr2, 0.001));
+    KALDI_ASSERT(mat1.ApproxEqual(mat2, 0.001));
+  }
+}
+
 }  // namespace kaldi ends here
 
 int main() {
@@ -229,6 +284,7 @@ int main() {
     kaldi::UnitTestFmllrDiagGmmOffset();
     kaldi::UnitTestFmllrDiagGmmDiagonal();
     kaldi::UnitTestFmllrDiagGmm();
+    kaldi::UnitTestFmllrDiagGmmBatched();
   }
   std::cout << "Test OK.\n";
 }
@@ -42,6 +42,60 @@ void FmllrDiagGmmAccs:: AccumulateFromPosteriors(
   stats.b.AddMatVec(1.0, pdf.inv_vars(), kTrans, posterior, 1.0);
 }
 
+void FmllrDiagGmmAccs::AccumulateFromPosteriors(
+    const DiagGmm &gmm,
+    const MatrixBase<BaseFloat> &data,
+    const MatrixBase<BaseFloat> &posteriors) {
+  int32 dim = Dim(), num_frames = data.NumRows();
+  KALDI_ASSERT(data.NumCols() == dim && gmm.Dim() == dim &&
+               posteriors.NumRows() == num_frames &&
+               posteriors.NumCols() == gmm.NumGauss());
+  if (num_frames == 0) return;
+  CommitSingleFrameStats();  // flush anything pending from the frame-by-frame
+                             // interface, so the orderings can be mixed.
+
+  // The per-frame linear terms "a" and quadratic terms "b" for all frames at
+  // once: these two products replace 2 * num_frames gemv calls with two gemm
+  // calls.
+  Matrix<BaseFloat> a(num_frames, dim), b(num_frames, dim);
+  a.AddMatMat(1.0, posteriors, kNoTrans, gmm.means_invvars(), kNoTrans, 0.0);
+  b.AddMatMat(1.0, posteriors, kNoTrans, gmm.inv_vars(), kNoTrans, 0.0);
+
+  Vector<BaseFloat> counts(num_frames);
+  counts.AddColSumMat(1.0, posteriors, 0.0);  // per-frame posterior totals.
+  beta_ += counts.Sum();
+
+  Matrix<double> xplus(num_frames, dim + 1);  // row t is x_t^+ = [ x_t; 1 ].
+  xplus.Range(0, num_frames, 0, dim).CopyFromMat(data);
+  for (int32 t = 0; t < num_frames; t++)
+    xplus(t, dim) = 1.0;
+
+  // K += sum_t a_t x_t^{+T}, as a single product.
+  Matrix<double> a_dbl(a);
+  K_.AddMatMat(1.0, a_dbl, kTrans, xplus, kNoTrans, 1.0);
+
+  if (opts_.update_type == "full") {
+    KALDI_ASSERT(static_cast<size_t>(dim) == G_.size());
+    Vector<double> b_d(num_frames);
+    for (int32 d = 0; d < dim; d++) {
+      // G_d += sum_t b_t(d) x_t^+ x_t^{+T}.
+      b_d.CopyColFromMat(b, d);
+      G_[d].AddMat2Vec(1.0, xplus, kTrans, b_d, 1.0);
+    }
+  } else {
+    // We only need some elements of these stats, so just update those elements
+    // [see CommitSingleFrameStats()].
+    for (int32 t = 0; t < num_frames; t++) {
+      for (int32 d = 0; d < dim; d++) {
+        double scale = b(t, d), x_d = xplus(t, d);
+        G_[d](d, d) += scale * x_d * x_d;
+        G_[d](dim, d) += scale * 1.0 * x_d;
+        G_[d](dim, dim) += scale * 1.0 * 1.0;
+      }
+    }
+  }
+}
+
 void FmllrDiagGmmAccs:: AccumulateFromPosteriorsPreselect(
     const DiagGmm &pdf,
     const std::vector<int32> &gselect,
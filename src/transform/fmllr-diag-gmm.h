@@ -102,6 +102,16 @@ class FmllrDiagGmmAccs: public AffineXformStats {
                                 const VectorBase<BaseFloat> &data,
                                 const VectorBase<BaseFloat> &posteriors);
 
+  /// Whole-utterance version of AccumulateFromPosteriors: row t of "data" is
+  /// the feature for frame t, and row t of "posteriors" contains the
+  /// posteriors of the Gaussians of "gmm" for that frame.  This is equivalent
+  /// to calling the single-frame version above for each frame in turn, but
+  /// computes the per-frame linear and quadratic terms with blocked matrix
+  /// products, which is substantially faster.
+  void AccumulateFromPosteriors(const DiagGmm &gmm,
+                                const MatrixBase<BaseFloat> &data,
+                                const MatrixBase<BaseFloat> &posteriors);
+
   /// Accumulate stats for a GMM, given supplied posteriors.  The "posteriors"
   /// vector should be have the same size as "gselect".
   void AccumulateFromPosteriorsPreselect(
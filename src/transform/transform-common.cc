@@ -177,5 +177,19 @@ void ApplyAffineTransform(const MatrixBase<BaseFloat> &xform,
   vec->AddMatVec(1.0, xform, kNoTrans, tmp, 0.0);
 }
 
+void ApplyAffineTransform(const MatrixBase<BaseFloat> &xform,
+                          MatrixBase<BaseFloat> *feats) {
+  int32 dim = xform.NumRows();
+  KALDI_ASSERT(dim > 0 && xform.NumCols() == dim+1 && feats->NumCols() == dim);
+  Matrix<BaseFloat> tmp(*feats);
+  SubMatrix<BaseFloat> linear_part(xform, 0, dim, 0, dim);
+  // Set each row of the output to the offset term (last column of xform), then
+  // add the linear part applied to the input, as one matrix multiply.
+  Vector<BaseFloat> offset(dim);
+  offset.CopyColFromMat(xform, dim);
+  feats->CopyRowsFromVec(offset);
+  feats->AddMatMat(1.0, tmp, kNoTrans, linear_part, kTrans, 1.0);
+}
+
 }  // namespace kaldi
 
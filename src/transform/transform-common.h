@@ -66,6 +66,13 @@ bool ComposeTransforms(const Matrix<BaseFloat> &a, const Matrix<BaseFloat> &b,
 void ApplyAffineTransform(const MatrixBase<BaseFloat> &xform,
                           VectorBase<BaseFloat> *vec);
 
+/// Applies the affine transform 'xform' to each row of 'feats' and overwrites
+/// the contents of 'feats'.  This is equivalent to calling the vector version
+/// above on each row, but does the work as a single matrix-matrix multiply,
+/// which is much faster for whole utterances.
+void ApplyAffineTransform(const MatrixBase<BaseFloat> &xform,
+                          MatrixBase<BaseFloat> *feats);
+
 
 
 }  // namespace kaldi
@@ -20,6 +20,7 @@
 #include <set>
 #include <queue>
 #include "util/stl-utils.h"
+#include "thread/kaldi-thread.h"
 #include "tree/build-tree-utils.h"
 
 
@@ -837,6 +838,53 @@ EventMap *ClusterEventMapRestrictedByKeys(const EventMap &e_in,
 }
 
 
+// Thread task used by ClusterEventMapRestrictedByMap: clusters the
+// compartments i with i % num_threads_ == thread_id_.  The compartments are
+// independent, and ClusterEventMapGetMapping() writes to disjoint sets of
+// leaf indices for different compartments, so each thread accumulates its
+// own mapping and merging them afterwards (under the mutex) is just a
+// matter of copying over the non-NULL entries.
+class ClusterEventMapCompartmentTask: public MultiThreadable {
+ public:
+  ClusterEventMapCompartmentTask(
+      const EventMap &e_in,
+      const std::vector<BuildTreeStatsType> &split_stats,
+      BaseFloat thresh,
+      std::vector<EventMap*> *leaf_mapping,
+      int32 *num_removed,
+      Mutex *mutex): e_in_(e_in), split_stats_(split_stats), thresh_(thresh),
+                     leaf_mapping_(leaf_mapping), num_removed_(num_removed),
+                     mutex_(mutex) { }
+
+  void operator() () {
+    std::vector<EventMap*> this_mapping;
+    int32 this_num_removed = 0;
+    for (size_t i = thread_id_; i < split_stats_.size(); i += num_threads_)
+      if (!split_stats_[i].empty())
+        this_num_removed += ClusterEventMapGetMapping(e_in_, split_stats_[i],
+                                                      thresh_, &this_mapping);
+    mutex_->Lock();
+    if (leaf_mapping_->size() < this_mapping.size())
+      leaf_mapping_->resize(this_mapping.size(), NULL);
+    for (size_t i = 0; i < this_mapping.size(); i++) {
+      if (this_mapping[i] != NULL) {
+        KALDI_ASSERT((*leaf_mapping_)[i] == NULL);
+        (*leaf_mapping_)[i] = this_mapping[i];
+      }
+    }
+    *num_removed_ += this_num_removed;
+    mutex_->Unlock();
+  }
+
+ private:
+  const EventMap &e_in_;
+  const std::vector<BuildTreeStatsType> &split_stats_;
+  BaseFloat thresh_;
+  std::vector<EventMap*> *leaf_mapping_;
+  int32 *num_removed_;
+  Mutex *mutex_;
+};
+
 EventMap *ClusterEventMapRestrictedByMap(const EventMap &e_in,
                                          const BuildTreeStatsType &stats,
                                          BaseFloat thresh,
@@ -845,12 +893,13 @@ EventMap *ClusterEventMapRestrictedByMap(const EventMap &e_in,
   std::vector<EventMap*> leaf_mapping;
 
   std::vector<BuildTreeStatsType> split_stats;
-  int num_removed = 0;
+  int32 num_removed = 0;
   SplitStatsByMap(stats, e_restrict, &split_stats);
-  for (size_t i = 0; i < split_stats.size(); i++) {
-    if (!split_stats[i].empty())
-      num_removed += ClusterEventMapGetMapping(e_in, split_stats[i], thresh,
-                                               &leaf_mapping);
+  {
+    Mutex mutex;
+    ClusterEventMapCompartmentTask task(e_in, split_stats, thresh,
+                                        &leaf_mapping, &num_removed, &mutex);
+    RunMultiThreaded(task);
   }
 
   if (num_removed_ptr != NULL) *num_removed_ptr = num_removed;
@@ -25,6 +25,7 @@ using std::vector;
 
 #include "base/kaldi-math.h"
 #include "util/stl-utils.h"
+#include "thread/kaldi-thread.h"
 #include "tree/cluster-utils.h"
 
 namespace kaldi {
@@ -190,6 +191,11 @@ void AddToClustersOptimized(const std::vector<Clusterable*> &stats,
 // Bottom-up clustering routines
 // ============================================================================
 
+// Below this number of points, bottom-up clustering stays single-threaded:
+// the distance computations are too cheap for the parallel sections to pay
+// for themselves.
+static const int32 kMinParallelClusterPoints = 1000;
+
 class BottomUpClusterer {
  public:
   BottomUpClusterer(const std::vector<Clusterable*> &points,
@@ -221,6 +227,14 @@ class BottomUpClusterer {
   void ReconstructQueue();
 
   void SetDistance(int32 i, int32 j);
+  /// Computes the distance between clusters i and j and caches it in
+  /// dist_vec_, without touching the queue; returns the distance.
+  /// Requires j < i.
+  BaseFloat ComputeDistance(int32 i, int32 j) {
+    BaseFloat dist = (*clusters_)[i]->Distance(*((*clusters_)[j]));
+    dist_vec_[(i * (i - 1)) / 2 + j] = dist;
+    return dist;
+  }
   BaseFloat& Distance(int32 i, int32 j) {
     KALDI_ASSERT(i < npoints_ && j < i);
     return dist_vec_[(i * (i - 1)) / 2 + j];
@@ -244,6 +258,54 @@ class BottomUpClusterer {
   typedef std::priority_queue<QueueElement, std::vector<QueueElement>,
       std::greater<QueueElement>  > QueueType;
   QueueType queue_;
+
+  friend class BottomUpClustererDistanceTask;
+};
+
+/// Thread task that fills in entries of BottomUpClusterer's pairwise
+/// distance matrix in parallel.  If row_ is -1 (the initial setup), each
+/// thread handles the rows i with i % num_threads_ == thread_id_, which
+/// balances the work since row i has i entries; otherwise it handles the
+/// pairs involving cluster row_ (after a merge into that cluster).  Threads
+/// write to disjoint parts of dist_vec_, and save the pairs that are close
+/// enough to be merge candidates in their own element of *candidates_; the
+/// main thread pushes these onto the queue afterwards.
+class BottomUpClustererDistanceTask: public MultiThreadable {
+ public:
+  typedef BottomUpClusterer::QueueElement QueueElement;
+  BottomUpClustererDistanceTask(
+      BottomUpClusterer *clusterer, int32 row,
+      std::vector<std::vector<QueueElement> > *candidates):
+      clusterer_(clusterer), row_(row), candidates_(candidates) { }
+
+  void operator() () {
+    BottomUpClusterer *bc = clusterer_;
+    std::vector<QueueElement> *out = &((*candidates_)[thread_id_]);
+    if (row_ < 0) {  // initial setup: all pairs.
+      for (int32 i = thread_id_; i < bc->npoints_; i += num_threads_) {
+        for (int32 j = 0; j < i; j++) {
+          BaseFloat dist = bc->ComputeDistance(i, j);
+          if (dist <= bc->max_merge_thresh_)
+            out->push_back(std::make_pair(dist, std::make_pair(
+                static_cast<uint_smaller>(i), static_cast<uint_smaller>(j))));
+        }
+      }
+    } else {  // update the pairs involving cluster row_.
+      for (int32 k = thread_id_; k < bc->npoints_; k += num_threads_) {
+        if (k == row_ || (*bc->clusters_)[k] == NULL) continue;
+        int32 i = std::max(k, row_), j = std::min(k, row_);
+        BaseFloat dist = bc->ComputeDistance(i, j);
+        if (dist < bc->max_merge_thresh_)
+          out->push_back(std::make_pair(dist, std::make_pair(
+              static_cast<uint_smaller>(i), static_cast<uint_smaller>(j))));
+      }
+    }
+  }
+
+ private:
+  BottomUpClusterer *clusterer_;
+  int32 row_;
+  std::vector<std::vector<QueueElement> > *candidates_;
 };
 
 BaseFloat BottomUpClusterer::Cluster() {
@@ -323,15 +385,27 @@ void BottomUpClusterer::InitializeAssignments() {
 }
 
 void BottomUpClusterer::SetInitialDistances() {
-  for (int32 i = 0; i < npoints_; i++) {
-    for (int32 j = 0; j < i; j++) {
-      BaseFloat dist = (*clusters_)[i]->Distance(*((*clusters_)[j]));
-      dist_vec_[(i * (i - 1)) / 2 + j] = dist;
-      if (dist <= max_merge_thresh_)
-        queue_.push(std::make_pair(dist, std::make_pair(static_cast<uint_smaller>(i),
-            static_cast<uint_smaller>(j))));
+  int32 num_threads = g_num_threads;
+  if (npoints_ < kMinParallelClusterPoints || num_threads <= 1) {
+    for (int32 i = 0; i < npoints_; i++) {
+      for (int32 j = 0; j < i; j++) {
+        BaseFloat dist = ComputeDistance(i, j);
+        if (dist <= max_merge_thresh_)
+          queue_.push(std::make_pair(dist, std::make_pair(static_cast<uint_smaller>(i),
+              static_cast<uint_smaller>(j))));
+      }
     }
+    return;
+  }
+  std::vector<std::vector<QueueElement> > candidates(num_threads);
+  {
+    BottomUpClustererDistanceTask task(this, -1, &candidates);
+    MultiThreader<BottomUpClustererDistanceTask> m(num_threads, task);
+    // destructor waits for the threads to finish.
   }
+  for (int32 t = 0; t < num_threads; t++)
+    for (size_t c = 0; c < candidates[t].size(); c++)
+      queue_.push(candidates[t][c]);
 }
 
 bool BottomUpClusterer::CanMerge(int32 i, int32 j, BaseFloat dist) {
@@ -355,12 +429,29 @@ void BottomUpClusterer::MergeClusters(int32 i, int32 j) {
   ans_ -= dist_vec_[(i * (i - 1)) / 2 + j];
   nclusters_--;
   // Now update "distances".
-  for (int32 k = 0; k < npoints_; k++) {
-    if (k != i && (*clusters_)[k] != NULL) {
-      if (k < i)
-        SetDistance(i, k);  // SetDistance requires k < i.
-      else
-        SetDistance(k, i);
+  int32 num_threads = g_num_threads;
+  if (npoints_ < kMinParallelClusterPoints || num_threads <= 1) {
+    for (int32 k = 0; k < npoints_; k++) {
+      if (k != i && (*clusters_)[k] != NULL) {
+        if (k < i)
+          SetDistance(i, k);  // SetDistance requires k < i.
+        else
+          SetDistance(k, i);
+      }
+    }
+  } else {
+    std::vector<std::vector<QueueElement> > candidates(num_threads);
+    {
+      BottomUpClustererDistanceTask task(this, i, &candidates);
+      MultiThreader<BottomUpClustererDistanceTask> m(num_threads, task);
+    }
+    for (int32 t = 0; t < num_threads; t++)
+      for (size_t c = 0; c < candidates[t].size(); c++)
+        queue_.push(candidates[t][c]);
+    if (queue_.size() >= static_cast<size_t>(npoints_) * npoints_) {
+      // Control memory use by getting rid of orphaned queue entries, as in
+      // SetDistance().
+      ReconstructQueue();
     }
   }
 }
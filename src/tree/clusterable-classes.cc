@@ -136,9 +136,54 @@ std::string ScalarClusterable::Info() {
 
 void GaussClusterable::AddStats(const VectorBase<BaseFloat> &vec,
                                 BaseFloat weight) {
+  KALDI_ASSERT(vec.Dim() == stats_.NumCols());
   count_ += weight;
-  stats_.Row(0).AddVec(weight, vec);
-  stats_.Row(1).AddVec2(weight, vec);
+  // Fused update of both moments: reads "vec" only once, where the
+  // AddVec + AddVec2 formulation would read it twice.
+  int32 dim = stats_.NumCols();
+  double *x_stats = stats_.RowData(0), *x2_stats = stats_.RowData(1);
+  const BaseFloat *data = vec.Data();
+  for (int32 d = 0; d < dim; d++) {
+    double wv = weight * static_cast<double>(data[d]);
+    x_stats[d] += wv;
+    x2_stats[d] += wv * data[d];
+  }
+}
+
+void GaussClusterable::AddStatsBlock(const MatrixBase<BaseFloat> &feats,
+                                     const VectorBase<BaseFloat> &weights) {
+  KALDI_ASSERT(feats.NumRows() == weights.Dim() &&
+               feats.NumCols() == stats_.NumCols());
+  int32 num_frames = feats.NumRows(), dim = stats_.NumCols();
+  double *x_stats = stats_.RowData(0), *x2_stats = stats_.RowData(1);
+  for (int32 t = 0; t < num_frames; t++) {
+    BaseFloat weight = weights(t);
+    if (weight == 0.0) continue;
+    count_ += weight;
+    const BaseFloat *data = feats.RowData(t);
+    for (int32 d = 0; d < dim; d++) {
+      double wv = weight * static_cast<double>(data[d]);
+      x_stats[d] += wv;
+      x2_stats[d] += wv * data[d];
+    }
+  }
+}
+
+void GaussClusterable::AddStatsBlock(const MatrixBase<BaseFloat> &feats,
+                                     BaseFloat weight) {
+  KALDI_ASSERT(feats.NumCols() == stats_.NumCols());
+  if (weight == 0.0) return;
+  int32 num_frames = feats.NumRows(), dim = stats_.NumCols();
+  count_ += weight * num_frames;
+  double *x_stats = stats_.RowData(0), *x2_stats = stats_.RowData(1);
+  for (int32 t = 0; t < num_frames; t++) {
+    const BaseFloat *data = feats.RowData(t);
+    for (int32 d = 0; d < dim; d++) {
+      double wv = weight * static_cast<double>(data[d]);
+      x_stats[d] += wv;
+      x2_stats[d] += wv * data[d];
+    }
+  }
 }
 
 void GaussClusterable::Add(const Clusterable &other_in) {
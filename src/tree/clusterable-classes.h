@@ -78,6 +78,15 @@ class GaussClusterable: public Clusterable {
 
   virtual std::string Type() const {  return "gauss"; }
   void AddStats(const VectorBase<BaseFloat> &vec, BaseFloat weight = 1.0);
+  /// Adds the rows of "feats", weighted by the corresponding elements of
+  /// "weights", accumulating both moments in a single pass over the data
+  /// (AddStats reads its input twice, once per moment, and stats
+  /// accumulation is bandwidth-bound).
+  void AddStatsBlock(const MatrixBase<BaseFloat> &feats,
+                     const VectorBase<BaseFloat> &weights);
+  /// As above, but with the same weight for every row.
+  void AddStatsBlock(const MatrixBase<BaseFloat> &feats,
+                     BaseFloat weight = 1.0);
   virtual BaseFloat Objf() const;
   virtual void SetZero();
   virtual void Add(const Clusterable &other_in);
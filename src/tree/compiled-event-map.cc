@@ -0,0 +1,100 @@
+// tree/compiled-event-map.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tree/compiled-event-map.h"
+
+namespace kaldi {
+
+void CompiledEventMap::Build(const EventMap &emap) {
+  nodes_.clear();
+  yes_set_values_.clear();
+  table_children_.clear();
+  int32 root = BuildRecurse(emap);
+  KALDI_ASSERT(root == 0);  // the root is created first.
+}
+
+int32 CompiledEventMap::BuildRecurse(const EventMap &emap) {
+  int32 index = static_cast<int32>(nodes_.size());
+  nodes_.resize(nodes_.size() + 1);
+  // Note: don't keep references into nodes_ across the recursive calls
+  // below, as they cause reallocation; we write via nodes_[index].
+
+  if (const ConstantEventMap *cmap =
+      dynamic_cast<const ConstantEventMap*>(&emap)) {
+    nodes_[index].type = kConstantNode;
+    nodes_[index].answer = cmap->answer_;
+  } else if (const SplitEventMap *smap =
+             dynamic_cast<const SplitEventMap*>(&emap)) {
+    const ConstIntegerSet<EventValueType> &yes_set = smap->yes_set_;
+    int32 set_offset = static_cast<int32>(yes_set_values_.size()),
+        set_size = static_cast<int32>(yes_set.size());
+    yes_set_values_.insert(yes_set_values_.end(),
+                           yes_set.begin(), yes_set.end());
+    EventValueType yes_lo, yes_hi;
+    if (set_size == 0) {  // can't happen with normally built trees, but be
+                          // safe: an empty range that no value falls in.
+      yes_lo = 1;
+      yes_hi = 0;
+    } else {
+      yes_lo = *yes_set.begin();
+      yes_hi = yes_set_values_.back();  // the values are sorted and unique.
+    }
+    nodes_[index].type = kSplitNode;
+    nodes_[index].key = smap->key_;
+    nodes_[index].yes_lo = yes_lo;
+    nodes_[index].yes_hi = yes_hi;
+    if (set_size != 0 && yes_hi - yes_lo + 1 == set_size) {
+      // the yes-set is the contiguous range [yes_lo, yes_hi]; the range
+      // test alone decides the branch.
+      nodes_[index].set_offset = 0;
+      nodes_[index].set_size = -1;
+      yes_set_values_.resize(set_offset);  // no need to keep the values.
+    } else {
+      nodes_[index].set_offset = set_offset;
+      nodes_[index].set_size = set_size;
+    }
+    // The recursive calls reallocate nodes_, so we must not form the
+    // address of nodes_[index] until they have returned.
+    int32 yes_child = BuildRecurse(*(smap->yes_)),
+        no_child = BuildRecurse(*(smap->no_));
+    nodes_[index].yes_child = yes_child;
+    nodes_[index].no_child = no_child;
+  } else if (const TableEventMap *tmap =
+             dynamic_cast<const TableEventMap*>(&emap)) {
+    int32 table_size = static_cast<int32>(tmap->table_.size()),
+        table_offset = static_cast<int32>(table_children_.size());
+    nodes_[index].type = kTableNode;
+    nodes_[index].key = tmap->key_;
+    nodes_[index].table_offset = table_offset;
+    nodes_[index].table_size = table_size;
+    table_children_.resize(table_offset + table_size, -1);
+    for (int32 t = 0; t < table_size; t++) {
+      if (tmap->table_[t] != NULL) {
+        // as above: the recursive call may reallocate table_children_.
+        int32 child = BuildRecurse(*(tmap->table_[t]));
+        table_children_[table_offset + t] = child;
+      }
+    }
+  } else {
+    KALDI_ERR << "CompiledEventMap::Build: unknown EventMap type.";
+  }
+  return index;
+}
+
+}  // end namespace kaldi
@@ -0,0 +1,124 @@
+// tree/compiled-event-map.h
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_TREE_COMPILED_EVENT_MAP_H_
+#define KALDI_TREE_COMPILED_EVENT_MAP_H_
+
+#include <vector>
+#include "base/kaldi-common.h"
+#include "tree/event-map.h"
+
+namespace kaldi {
+
+/// \addtogroup event_map_group
+/// @{
+
+/// CompiledEventMap is a read-only, flattened form of an EventMap, for use
+/// where Map() is queried very many times (e.g. training-graph compilation,
+/// which makes millions of queries).  EventMap::Map() walks a tree of
+/// virtually dispatched SplitEventMap/TableEventMap objects allocated all
+/// over the heap; this class flattens that tree, once, into a contiguous
+/// array of small nodes, over which Map() is an inline loop with no virtual
+/// calls.  Splits whose yes-set is a contiguous range of values (a common
+/// case) become a pair of integer comparisons rather than a set lookup.
+///
+/// The EventMap it was built from may be deleted after Build(); the answers
+/// of Map() are identical to those of the original object.  This class does
+/// not support MultiMap(), Copy() or I/O -- the EventMap remains the
+/// authoritative representation; keep it around if you need those.
+class CompiledEventMap {
+ public:
+  CompiledEventMap() { }
+
+  explicit CompiledEventMap(const EventMap &emap) { Build(emap); }
+
+  /// Flattens "emap"; may be called again to re-build from another map.
+  void Build(const EventMap &emap);
+
+  /// Returns true if Build() has been called.
+  bool Built() const { return !nodes_.empty(); }
+
+  /// Same interface and answers as EventMap::Map(); "event" must be sorted
+  /// on key.  Must not be called before Build().
+  inline bool Map(const EventType &event, EventAnswerType *ans) const;
+
+ private:
+  enum NodeType { kConstantNode, kSplitNode, kTableNode };
+
+  struct Node {
+    int32 type;  // one of kConstantNode, kSplitNode, kTableNode.
+    EventKeyType key;  // the key examined, for split and table nodes.
+    EventAnswerType answer;  // the answer, for constant nodes.
+    int32 yes_child, no_child;  // child node indexes, for split nodes.
+    // For split nodes, [yes_lo, yes_hi] is the range spanned by the yes-set.
+    // If set_size is -1 the yes-set is exactly that range and the range test
+    // decides the branch by itself; otherwise the set's values are in
+    // yes_set_values_[set_offset ... set_offset + set_size - 1], sorted.
+    EventValueType yes_lo, yes_hi;
+    int32 set_offset, set_size;
+    // For table nodes, entry v of the table is
+    // table_children_[table_offset + v] (a node index, or -1 for a hole).
+    int32 table_offset, table_size;
+  };
+
+  /// Flattens the tree rooted at "emap"; returns the new node's index.
+  int32 BuildRecurse(const EventMap &emap);
+
+  std::vector<Node> nodes_;  // nodes_[0] is the root.
+  std::vector<EventValueType> yes_set_values_;
+  std::vector<int32> table_children_;
+};
+
+inline bool CompiledEventMap::Map(const EventType &event,
+                                  EventAnswerType *ans) const {
+  const Node *nodes = &(nodes_[0]);
+  int32 cur = 0;
+  while (true) {
+    const Node &node = nodes[cur];
+    if (node.type == kConstantNode) {
+      *ans = node.answer;
+      return true;
+    }
+    EventValueType value;
+    if (!EventMap::Lookup(event, node.key, &value))
+      return false;
+    if (node.type == kSplitNode) {
+      bool yes;
+      if (value < node.yes_lo || value > node.yes_hi) yes = false;
+      else if (node.set_size == -1) yes = true;  // yes-set is the whole range.
+      else yes = std::binary_search(
+          yes_set_values_.begin() + node.set_offset,
+          yes_set_values_.begin() + node.set_offset + node.set_size, value);
+      cur = (yes ? node.yes_child : node.no_child);
+    } else {  // kTableNode
+      if (value < 0 || value >= node.table_size)
+        return false;
+      int32 child = table_children_[node.table_offset + value];
+      if (child < 0)
+        return false;
+      cur = child;
+    }
+  }
+}
+
+/// @} end "addtogroup event_map_group"
+
+}  // end namespace kaldi
+
+#endif  // KALDI_TREE_COMPILED_EVENT_MAP_H_
@@ -40,7 +40,9 @@ bool ContextDependency::Compute(const std::vector<int32> &phoneseq,
     KALDI_ASSERT(static_cast<EventAnswerType>(phoneseq[i]) >= 0);
   }
   KALDI_ASSERT(pdf_id != NULL);
-  return to_pdf_->Map(event_vec, pdf_id);
+  // to_pdf_compiled_ gives the same answers as to_pdf_->Map(), but much
+  // faster (graph compilation makes millions of these queries).
+  return to_pdf_compiled_.Map(event_vec, pdf_id);
 }
 
 ContextDependency *GenRandContextDependency(const std::vector<int32> &phone_ids,
@@ -173,6 +175,7 @@ void ContextDependency::Read (std::istream &is, bool binary) {
   }
   ExpectToken(is, binary, "EndContextDependency");
   to_pdf_ = to_pdf;
+  to_pdf_compiled_.Build(*to_pdf_);
 }
 
 void ContextDependency::GetPdfInfo(const std::vector<int32> &phones,
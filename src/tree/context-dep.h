@@ -24,6 +24,7 @@
 #include "tree/event-map.h"
 #include "matrix/matrix-lib.h"
 #include "tree/cluster-utils.h"
+#include "tree/compiled-event-map.h"
 
 /*
   This header provides the declarations for the class ContextDependency, which inherits
@@ -89,7 +90,9 @@ class ContextDependency: public ContextDependencyInterface {
   // Constructor takes ownership of pointers.
   ContextDependency(int32 N, int32 P,
                     EventMap *to_pdf):
-      N_(N), P_(P), to_pdf_(to_pdf) { }
+      N_(N), P_(P), to_pdf_(to_pdf) {
+    if (to_pdf_ != NULL) to_pdf_compiled_.Build(*to_pdf_);
+  }
   void Write (std::ostream &os, bool binary) const;
 
   ~ContextDependency() { delete to_pdf_; }
@@ -109,6 +112,9 @@ class ContextDependency: public ContextDependencyInterface {
   int32 N_;  //
   int32 P_;
   EventMap *to_pdf_;  // owned here.
+  CompiledEventMap to_pdf_compiled_;  // flattened form of *to_pdf_, used in
+                                      // Compute() for speed; kept in sync
+                                      // wherever to_pdf_ is set.
 
   KALDI_DISALLOW_COPY_AND_ASSIGN(ContextDependency);
 };
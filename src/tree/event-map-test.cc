@@ -19,6 +19,7 @@
 // limitations under the License.
 
 #include "tree/event-map.h"
+#include "tree/compiled-event-map.h"
 #include "util/kaldi-io.h"
 #include <map>
 
@@ -310,6 +311,29 @@ void TestEventMapMapValues() {
 
 
 
+void TestCompiledEventMap() {
+  std::vector<EventKeyType> keys;
+  keys.push_back(1);
+  keys.push_back(2);
+
+  EventMap *em = RandomEventMap(keys);
+  CompiledEventMap compiled(*em);
+
+  for (int32 i = 0; i < 100; i++) {
+    EventType event;
+    for (int32 key = 1; key <= 2; key++)
+      if (Rand() % 2 == 0)
+        event.push_back(std::make_pair(key, EventValueType(Rand() % kMaxVal)));
+    EventAnswerType answer, answer2;
+    bool ret = em->Map(event, &answer),
+        ret2 = compiled.Map(event, &answer2);
+    KALDI_ASSERT(ret == ret2);
+    if (ret)
+      KALDI_ASSERT(answer == answer2);
+  }
+  delete em;
+}
+
 } // end namespace kaldi
 
 
@@ -325,5 +349,6 @@ int main() {
     TestEventMap();
     TestEventMapPrune();
     TestEventMapMapValues();
+    TestCompiledEventMap();
   }
 }
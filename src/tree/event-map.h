@@ -59,10 +59,14 @@ typedef std::vector<std::pair<EventKeyType, EventValueType> > EventType;
 // It is required to be sorted and have unique keys-- i.e. functions assume this when called
 // with this type.
 
-inline std::pair<EventKeyType, EventValueType> MakeEventPair (EventKeyType k, EventValueType v) {  
+inline std::pair<EventKeyType, EventValueType> MakeEventPair (EventKeyType k, EventValueType v) {
   return std::pair<EventKeyType, EventValueType>(k, v);
 }
 
+class CompiledEventMap;  // forward declaration; see compiled-event-map.h.  It
+// is a friend of the EventMap classes below so it can flatten their
+// internals into its table form.
+
 void WriteEventType(std::ostream &os, bool binary, const EventType &vec);
 void ReadEventType(std::istream &is, bool binary, EventType *vec);
 
@@ -199,6 +203,7 @@ class ConstantEventMap: public EventMap {
   virtual void Write(std::ostream &os, bool binary);
   static ConstantEventMap *Read(std::istream &is, bool binary);
  private:
+  friend class CompiledEventMap;
   EventAnswerType answer_;
   KALDI_DISALLOW_COPY_AND_ASSIGN(ConstantEventMap);
 };
@@ -258,6 +263,7 @@ class TableEventMap: public EventMap {
     DeletePointers(&table_);
   }
  private:
+  friend class CompiledEventMap;
   EventKeyType key_;
   std::vector<EventMap*> table_;
   KALDI_DISALLOW_COPY_AND_ASSIGN(TableEventMap);
@@ -332,6 +338,7 @@ class SplitEventMap: public EventMap {  // A decision tree [non-leaf] node.
   void Destroy() {
     delete yes_; delete no_;
   }
+  friend class CompiledEventMap;
   EventKeyType key_;
   //  std::vector<EventValueType> yes_set_;
   ConstIntegerSet<EventValueType> yes_set_;  // more efficient Map function.
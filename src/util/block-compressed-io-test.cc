@@ -0,0 +1,168 @@
+// util/block-compressed-io-test.cc
+
+// Copyright 2015  Johns Hopkins University (Author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdio>
+#include <vector>
+
+#ifndef _MSC_VER
+#include <unistd.h>
+#endif
+
+#include "base/kaldi-math.h"
+#include "util/block-compressed-io.h"
+#include "util/kaldi-io.h"
+#include "util/table-types.h"
+
+namespace kaldi {
+
+// Makes test data that is a mix of compressible (repeated or constant) and
+// incompressible (random) stretches.
+static void MakeTestData(int32 size, std::vector<char> *data) {
+  data->resize(size);
+  int32 pos = 0;
+  while (pos < size) {
+    int32 len = std::min(1 + Rand() % 2000, size - pos);
+    switch (Rand() % 3) {
+      case 0:  // constant.
+        memset(&(*data)[pos], Rand() % 256, len);
+        break;
+      case 1:  // random, i.e. incompressible.
+        for (int32 i = 0; i < len; i++)
+          (*data)[pos + i] = static_cast<char>(Rand() % 256);
+        break;
+      default:  // a repeated short pattern.
+        for (int32 i = 0; i < len; i++)
+          (*data)[pos + i] = static_cast<char>('a' + (i % (1 + Rand() % 20)));
+        break;
+    }
+    pos += len;
+  }
+}
+
+void UnitTestBlockCodec() {
+  for (int32 iter = 0; iter < 20; iter++) {
+    int32 size;
+    if (iter == 0) size = 0;
+    else if (iter % 3 == 0) size = kBlockCompressedBlockSize;  // a full block.
+    else size = Rand() % kBlockCompressedBlockSize;
+    std::vector<char> data, comp;
+    MakeTestData(size, &data);
+    BlockCompress(size == 0 ? NULL : &data[0], size, &comp);
+    std::vector<char> decomp(size);
+    KALDI_ASSERT(BlockDecompress(comp.empty() ? NULL : &comp[0], comp.size(),
+                                 size == 0 ? NULL : &decomp[0], size));
+    KALDI_ASSERT(data == decomp);
+    // Decompressing with the wrong output size must fail, not crash.
+    if (size > 1) {
+      std::vector<char> wrong(size - 1);
+      KALDI_ASSERT(!BlockDecompress(&comp[0], comp.size(),
+                                    &wrong[0], wrong.size()));
+    }
+  }
+}
+
+void UnitTestBlockCompressedStream() {
+  for (int32 iter = 0; iter < 5; iter++) {
+    const char *filename = "tmpf.blz";
+    // Sizes chosen to cover less than one block, exact multiples of the
+    // block size, and several blocks plus a partial one.
+    int32 size;
+    if (iter == 0) size = 0;
+    else if (iter == 1) size = 2 * kBlockCompressedBlockSize;
+    else size = Rand() % (3 * kBlockCompressedBlockSize);
+    std::vector<char> data;
+    MakeTestData(size, &data);
+    {
+      Output ko(filename, true, false);  // no binary header.
+      KALDI_ASSERT(static_cast<int64>(ko.Stream().tellp()) == 0);
+      if (size != 0)
+        ko.Stream().write(&data[0], size);
+      // tellp() must report the position in the uncompressed stream.
+      KALDI_ASSERT(static_cast<int64>(ko.Stream().tellp()) == size);
+      KALDI_ASSERT(ko.Close());
+    }
+    {  // Read it back sequentially.
+      Input ki(filename);
+      std::vector<char> read_data(size);
+      if (size != 0)
+        ki.Stream().read(&read_data[0], size);
+      KALDI_ASSERT(!ki.Stream().fail() && read_data == data);
+      KALDI_ASSERT(ki.Stream().get() == EOF);  // and nothing further.
+    }
+    for (int32 i = 0; i < 10 && size != 0; i++) {  // random seeks.
+      int64 offset = Rand() % size;
+      std::ostringstream os;
+      os << filename << ':' << offset;
+      Input ki(os.str());
+      KALDI_ASSERT(static_cast<int64>(ki.Stream().tellg()) == offset);
+      KALDI_ASSERT(ki.Stream().get() ==
+                   static_cast<unsigned char>(data[offset]));
+    }
+    unlink(filename);
+  }
+}
+
+void UnitTestBlockCompressedTable() {
+  // Writing with "ark,scp:" to a .blz archive must produce an scp whose
+  // offsets (into the uncompressed stream) can be used for random access.
+  const char *archive = "tmpf.blz", *script = "tmpf.scp";
+  int32 num_records = 100;
+  std::vector<Matrix<BaseFloat> > written(num_records);
+  {
+    BaseFloatMatrixWriter writer(std::string("ark,scp:") + archive +
+                                 "," + script);
+    for (int32 i = 0; i < num_records; i++) {
+      char buf[100];
+      snprintf(buf, sizeof(buf), "key%05d", i);
+      written[i].Resize(50 + Rand() % 100, 20 + Rand() % 20);
+      written[i].SetRandn();
+      writer.Write(buf, written[i]);
+    }
+  }
+  {  // sequential reading of the archive itself.
+    SequentialBaseFloatMatrixReader reader(std::string("ark:") + archive);
+    int32 i = 0;
+    for (; !reader.Done(); reader.Next(), i++)
+      KALDI_ASSERT(reader.Value().ApproxEqual(written[i], 0.0f));
+    KALDI_ASSERT(i == num_records);
+  }
+  {  // random access through the scp, in scrambled order.
+    RandomAccessBaseFloatMatrixReader reader(std::string("scp:") + script);
+    for (int32 i = 0; i < num_records; i++) {
+      int32 j = Rand() % num_records;
+      char buf[100];
+      snprintf(buf, sizeof(buf), "key%05d", j);
+      KALDI_ASSERT(reader.HasKey(buf));
+      KALDI_ASSERT(reader.Value(buf).ApproxEqual(written[j], 0.0f));
+    }
+  }
+  unlink(archive);
+  unlink(script);
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  UnitTestBlockCodec();
+  UnitTestBlockCompressedStream();
+  UnitTestBlockCompressedTable();
+  std::cout << "Test OK.\n";
+  return 0;
+}
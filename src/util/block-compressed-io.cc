@@ -0,0 +1,476 @@
+// util/block-compressed-io.cc
+
+// Copyright 2015  Johns Hopkins University (Author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstring>
+
+#include "util/block-compressed-io.h"
+#include "util/kaldi-io.h"
+
+namespace kaldi {
+
+const int32 kBlockCompressedBlockSize = 65536;
+
+/*
+  On-disk layout of a ".blz" file (all integers in host byte order, like
+  Kaldi binary data; the header lets a reader detect a mismatch):
+
+    header:  8 bytes magic "KBLZARC1";
+             uint32 block_size (uncompressed bytes per block);
+             uint32 1 (byte-order and version check).
+    blocks:  for each block, uint32 payload_size (with the top bit set if
+             the payload is stored uncompressed), uint32 uncompressed_size,
+             then the payload.  All blocks except the last hold exactly
+             block_size uncompressed bytes.
+    index:   uint64 file offset of each block, in order.
+    footer:  uint64 num_blocks; uint64 total uncompressed size;
+             8 bytes magic "KBLZEND1".
+
+  The index and footer are at the end so the writer can stream; the reader
+  locates them from the file size.
+*/
+
+static const char kBlzHeaderMagic[8] = { 'K', 'B', 'L', 'Z',
+                                         'A', 'R', 'C', '1' };
+static const char kBlzFooterMagic[8] = { 'K', 'B', 'L', 'Z',
+                                         'E', 'N', 'D', '1' };
+static const uint32 kBlzStoredFlag = 0x80000000;
+
+// The codec below is a simple byte-aligned LZ77 with 64 kB of history.
+// Each compressed block is a sequence of "sequences": a token byte whose
+// high nibble is the literal count and low nibble the match length minus 4
+// (value 15 in either nibble means further length bytes follow, each adding
+// its value, terminated by a byte less than 255), then the literal bytes,
+// then a 2-byte distance for the match.  The final sequence has no match;
+// the decoder recognizes it by the input ending after its literals.
+
+static void BlzPutLength(int32 len, std::vector<char> *out) {
+  while (len >= 255) {
+    out->push_back(static_cast<char>(255));
+    len -= 255;
+  }
+  out->push_back(static_cast<char>(len));
+}
+
+static void BlzPutSequence(const char *literals, int32 num_literals,
+                           int32 distance, int32 match_len,
+                           std::vector<char> *out) {
+  int32 literal_code = std::min<int32>(num_literals, 15),
+      match_code = (match_len == 0 ? 0 : std::min<int32>(match_len - 4, 15));
+  out->push_back(static_cast<char>((literal_code << 4) | match_code));
+  if (literal_code == 15)
+    BlzPutLength(num_literals - 15, out);
+  out->insert(out->end(), literals, literals + num_literals);
+  if (match_len != 0) {
+    out->push_back(static_cast<char>(distance & 255));
+    out->push_back(static_cast<char>((distance >> 8) & 255));
+    if (match_code == 15)
+      BlzPutLength(match_len - 4 - 15, out);
+  }
+}
+
+static inline uint32 BlzLoad32(const char *p) {
+  uint32 x;
+  memcpy(&x, p, sizeof(x));
+  return x;
+}
+
+static inline uint32 BlzHash(uint32 x) {
+  return (x * 2654435761u) >> 20;  // 12 bits -> table of 4096.
+}
+
+void BlockCompress(const char *in, int32 in_size, std::vector<char> *out) {
+  KALDI_ASSERT(in_size >= 0 && in_size <= kBlockCompressedBlockSize);
+  out->clear();
+  int32 hash_table[4096];  // position of the most recent occurrence of a
+                           // 4-byte sequence with each hash, or -1.
+  for (int32 i = 0; i < 4096; i++)
+    hash_table[i] = -1;
+  int32 pos = 0, anchor = 0;  // literals pending output start at "anchor".
+  while (pos + 4 <= in_size) {
+    uint32 h = BlzHash(BlzLoad32(in + pos));
+    int32 candidate = hash_table[h];
+    hash_table[h] = pos;
+    if (candidate >= 0 && pos - candidate <= 65535 &&
+        BlzLoad32(in + candidate) == BlzLoad32(in + pos)) {
+      int32 match_len = 4;
+      while (pos + match_len < in_size &&
+             in[candidate + match_len] == in[pos + match_len])
+        match_len++;
+      BlzPutSequence(in + anchor, pos - anchor, pos - candidate,
+                     match_len, out);
+      pos += match_len;
+      anchor = pos;
+    } else {
+      pos++;
+    }
+  }
+  // The final sequence: any remaining literals and no match.
+  BlzPutSequence(in + anchor, in_size - anchor, 0, 0, out);
+}
+
+bool BlockDecompress(const char *in, int32 in_size,
+                     char *out, int32 out_size) {
+  const char *ip = in, *in_end = in + in_size;
+  char *op = out, *out_end = out + out_size;
+  while (true) {
+    if (ip >= in_end)  // a valid stream ends after a final literal run.
+      return false;
+    uint32 token = static_cast<unsigned char>(*ip++);
+    int32 num_literals = token >> 4;
+    if (num_literals == 15) {
+      uint32 b;
+      do {
+        if (ip >= in_end) return false;
+        b = static_cast<unsigned char>(*ip++);
+        num_literals += b;
+      } while (b == 255);
+    }
+    if (num_literals > in_end - ip || num_literals > out_end - op)
+      return false;
+    memcpy(op, ip, num_literals);
+    op += num_literals;
+    ip += num_literals;
+    if (ip == in_end)  // the final sequence has no match part.
+      return op == out_end;
+    if (in_end - ip < 2)
+      return false;
+    int32 distance = static_cast<unsigned char>(ip[0]) |
+        (static_cast<unsigned char>(ip[1]) << 8);
+    ip += 2;
+    if (distance == 0 || distance > op - out)
+      return false;
+    int32 match_len = 4 + (token & 15);
+    if ((token & 15) == 15) {
+      uint32 b;
+      do {
+        if (ip >= in_end) return false;
+        b = static_cast<unsigned char>(*ip++);
+        match_len += b;
+      } while (b == 255);
+    }
+    if (match_len > out_end - op)
+      return false;
+    const char *src = op - distance;
+    for (int32 i = 0; i < match_len; i++)  // byte by byte: the source may
+      op[i] = src[i];                      // overlap the destination.
+    op += match_len;
+  }
+}
+
+static void BlzWriteUint32(std::ostream &os, uint32 x) {
+  os.write(reinterpret_cast<const char*>(&x), sizeof(x));
+}
+
+static void BlzWriteUint64(std::ostream &os, uint64 x) {
+  os.write(reinterpret_cast<const char*>(&x), sizeof(x));
+}
+
+static bool BlzReadUint32(std::istream &is, uint32 *x) {
+  is.read(reinterpret_cast<char*>(x), sizeof(*x));
+  return !is.fail();
+}
+
+static bool BlzReadUint64(std::istream &is, uint64 *x) {
+  is.read(reinterpret_cast<char*>(x), sizeof(*x));
+  return !is.fail();
+}
+
+
+BlockCompressedOutputBuffer::BlockCompressedOutputBuffer():
+    buf_(kBlockCompressedBlockSize), raw_offset_(0), uncomp_written_(0),
+    write_failed_(false) { }
+
+bool BlockCompressedOutputBuffer::Open(const std::string &filename) {
+  if (raw_.is_open())
+    KALDI_ERR << "Called Open() twice on BlockCompressedOutputBuffer.";
+  raw_.open(filename.c_str(), std::ios_base::out | std::ios_base::binary);
+  if (!raw_.is_open())
+    return false;
+  raw_.write(kBlzHeaderMagic, sizeof(kBlzHeaderMagic));
+  BlzWriteUint32(raw_, static_cast<uint32>(kBlockCompressedBlockSize));
+  BlzWriteUint32(raw_, 1);  // byte-order and version check.
+  raw_offset_ = sizeof(kBlzHeaderMagic) + 2 * sizeof(uint32);
+  uncomp_written_ = 0;
+  write_failed_ = raw_.fail();
+  block_offsets_.clear();
+  setp(&buf_[0], &buf_[0] + kBlockCompressedBlockSize);
+  return !write_failed_;
+}
+
+bool BlockCompressedOutputBuffer::WriteBlock() {
+  int32 in_size = pptr() - pbase();
+  if (in_size == 0) return !write_failed_;
+  block_offsets_.push_back(raw_offset_);
+  BlockCompress(pbase(), in_size, &comp_);
+  if (static_cast<int32>(comp_.size()) >= in_size) {
+    // Incompressible: store the block uncompressed.
+    BlzWriteUint32(raw_, static_cast<uint32>(in_size) | kBlzStoredFlag);
+    BlzWriteUint32(raw_, static_cast<uint32>(in_size));
+    raw_.write(pbase(), in_size);
+    raw_offset_ += 2 * sizeof(uint32) + in_size;
+  } else {
+    BlzWriteUint32(raw_, static_cast<uint32>(comp_.size()));
+    BlzWriteUint32(raw_, static_cast<uint32>(in_size));
+    raw_.write(&comp_[0], comp_.size());
+    raw_offset_ += 2 * sizeof(uint32) + comp_.size();
+  }
+  uncomp_written_ += in_size;
+  setp(&buf_[0], &buf_[0] + kBlockCompressedBlockSize);
+  if (raw_.fail())
+    write_failed_ = true;
+  return !write_failed_;
+}
+
+int BlockCompressedOutputBuffer::overflow(int c) {
+  if (!raw_.is_open() || !WriteBlock())
+    return traits_type::eof();
+  if (c != traits_type::eof())
+    sputc(static_cast<char>(c));
+  return traits_type::not_eof(c);
+}
+
+int BlockCompressedOutputBuffer::sync() {
+  // We flush the underlying file but keep any partial block buffered: only
+  // Close() may write a block smaller than the block size, or seeking
+  // within the file would not work.
+  if (!raw_.is_open())
+    return -1;
+  raw_.flush();
+  return (write_failed_ || raw_.fail()) ? -1 : 0;
+}
+
+std::streampos BlockCompressedOutputBuffer::seekoff(
+    std::streamoff off, std::ios_base::seekdir way,
+    std::ios_base::openmode which) {
+  // Only tellp() is supported: it reports the position in the uncompressed
+  // stream, which is what gets recorded in scp files.
+  if (off == 0 && way == std::ios_base::cur &&
+      (which & std::ios_base::out) && raw_.is_open())
+    return std::streampos(uncomp_written_ + (pptr() - pbase()));
+  return std::streampos(std::streamoff(-1));
+}
+
+bool BlockCompressedOutputBuffer::Close() {
+  if (!raw_.is_open())
+    return false;
+  bool ok = WriteBlock();  // the final, possibly partial, block.
+  for (size_t i = 0; i < block_offsets_.size(); i++)
+    BlzWriteUint64(raw_, block_offsets_[i]);
+  BlzWriteUint64(raw_, static_cast<uint64>(block_offsets_.size()));
+  BlzWriteUint64(raw_, uncomp_written_);
+  raw_.write(kBlzFooterMagic, sizeof(kBlzFooterMagic));
+  if (raw_.fail())
+    ok = false;
+  raw_.close();
+  if (raw_.fail())
+    ok = false;
+  setp(NULL, NULL);
+  block_offsets_.clear();
+  raw_offset_ = 0;
+  uncomp_written_ = 0;
+  write_failed_ = false;
+  return ok;
+}
+
+BlockCompressedOutputBuffer::~BlockCompressedOutputBuffer() {
+  if (raw_.is_open())
+    Close();  // errors are reported by whoever called Close() explicitly.
+}
+
+
+BlockCompressedInputBuffer::BlockCompressedInputBuffer():
+    block_size_(0), num_blocks_(0), total_uncompressed_(0), cur_block_(-1),
+    failed_(false) { }
+
+bool BlockCompressedInputBuffer::Open(const std::string &filename) {
+  if (raw_.is_open())
+    KALDI_ERR << "Called Open() twice on BlockCompressedInputBuffer.";
+  raw_.open(filename.c_str(), std::ios_base::in | std::ios_base::binary);
+  if (!raw_.is_open())
+    return false;
+  const int64 header_size = sizeof(kBlzHeaderMagic) + 2 * sizeof(uint32),
+      footer_size = 2 * sizeof(uint64) + sizeof(kBlzFooterMagic);
+  char magic[8];
+  uint32 check;
+  raw_.seekg(0, std::ios_base::end);
+  int64 file_size = static_cast<int64>(raw_.tellg());
+  raw_.seekg(0, std::ios_base::beg);
+  raw_.read(magic, sizeof(magic));
+  if (raw_.fail() || memcmp(magic, kBlzHeaderMagic, sizeof(magic)) != 0 ||
+      !BlzReadUint32(raw_, &block_size_) || !BlzReadUint32(raw_, &check) ||
+      check != 1 || block_size_ == 0 ||
+      file_size < header_size + footer_size) {
+    KALDI_WARN << "File " << PrintableRxfilename(filename)
+               << " is not a valid block-compressed (.blz) file.";
+    Close();
+    return false;
+  }
+  raw_.seekg(file_size - footer_size);
+  if (!BlzReadUint64(raw_, &num_blocks_) ||
+      !BlzReadUint64(raw_, &total_uncompressed_)) {
+    Close();
+    return false;
+  }
+  raw_.read(magic, sizeof(magic));
+  int64 index_offset = file_size - footer_size -
+      static_cast<int64>(num_blocks_) * sizeof(uint64);
+  uint64 max_uncompressed = num_blocks_ * static_cast<uint64>(block_size_),
+      min_uncompressed =
+      (num_blocks_ == 0 ? 0 : (num_blocks_ - 1) * block_size_ + 1);
+  if (raw_.fail() || memcmp(magic, kBlzFooterMagic, sizeof(magic)) != 0 ||
+      index_offset < header_size ||
+      total_uncompressed_ > max_uncompressed ||
+      total_uncompressed_ < min_uncompressed) {
+    KALDI_WARN << "Corrupt or truncated block-compressed file "
+               << PrintableRxfilename(filename);
+    Close();
+    return false;
+  }
+  block_offsets_.resize(num_blocks_);
+  raw_.seekg(index_offset);
+  for (uint64 i = 0; i < num_blocks_; i++) {
+    if (!BlzReadUint64(raw_, &block_offsets_[i]) ||
+        block_offsets_[i] < static_cast<uint64>(header_size) ||
+        block_offsets_[i] >= static_cast<uint64>(index_offset)) {
+      KALDI_WARN << "Corrupt block index in block-compressed file "
+                 << PrintableRxfilename(filename);
+      Close();
+      return false;
+    }
+  }
+  block_buf_.resize(block_size_);
+  cur_block_ = -1;
+  failed_ = false;
+  setg(NULL, NULL, NULL);
+  return true;
+}
+
+bool BlockCompressedInputBuffer::LoadBlock(int64 block) {
+  KALDI_ASSERT(block >= 0 && block < static_cast<int64>(num_blocks_));
+  uint32 payload_size, uncomp_size;
+  uint64 expected_size = (block + 1 < static_cast<int64>(num_blocks_) ?
+                          block_size_ :
+                          total_uncompressed_ - block * block_size_);
+  raw_.clear();
+  raw_.seekg(block_offsets_[block]);
+  if (!BlzReadUint32(raw_, &payload_size) ||
+      !BlzReadUint32(raw_, &uncomp_size) ||
+      uncomp_size != expected_size) {
+    failed_ = true;
+    KALDI_WARN << "Error reading block " << block
+               << " of block-compressed file.";
+    return false;
+  }
+  bool stored = (payload_size & kBlzStoredFlag) != 0;
+  payload_size &= ~kBlzStoredFlag;
+  if (stored) {
+    if (payload_size != uncomp_size) {
+      failed_ = true;
+      return false;
+    }
+    raw_.read(&block_buf_[0], uncomp_size);
+    if (raw_.fail()) {
+      failed_ = true;
+      return false;
+    }
+  } else {
+    comp_.resize(payload_size);
+    raw_.read(&comp_[0], payload_size);
+    if (raw_.fail() ||
+        !BlockDecompress(&comp_[0], payload_size,
+                         &block_buf_[0], uncomp_size)) {
+      failed_ = true;
+      KALDI_WARN << "Corrupt data in block " << block
+                 << " of block-compressed file.";
+      return false;
+    }
+  }
+  cur_block_ = block;
+  setg(&block_buf_[0], &block_buf_[0], &block_buf_[0] + uncomp_size);
+  return true;
+}
+
+int BlockCompressedInputBuffer::underflow() {
+  if (failed_ || !raw_.is_open())
+    return traits_type::eof();
+  if (gptr() < egptr())
+    return traits_type::to_int_type(*gptr());
+  int64 next = cur_block_ + 1;
+  if (next >= static_cast<int64>(num_blocks_) || !LoadBlock(next))
+    return traits_type::eof();
+  return traits_type::to_int_type(*gptr());
+}
+
+int64 BlockCompressedInputBuffer::CurrentPos() const {
+  if (cur_block_ < 0) return 0;
+  return cur_block_ * static_cast<int64>(block_size_) + (gptr() - eback());
+}
+
+std::streampos BlockCompressedInputBuffer::SeekInternal(int64 target) {
+  if (failed_ || !raw_.is_open() || target < 0 ||
+      target > static_cast<int64>(total_uncompressed_))
+    return std::streampos(std::streamoff(-1));
+  if (num_blocks_ == 0) {  // an empty stream: only position 0 exists.
+    setg(NULL, NULL, NULL);
+    return std::streampos(0);
+  }
+  int64 block = target / block_size_;
+  if (block == static_cast<int64>(num_blocks_))
+    block--;  // target == total_uncompressed_, a multiple of the block
+              // size: position at the end of the last block.
+  int64 within = target - block * static_cast<int64>(block_size_);
+  if (block != cur_block_ && !LoadBlock(block))
+    return std::streampos(std::streamoff(-1));
+  KALDI_ASSERT(within <= egptr() - eback());
+  setg(eback(), eback() + within, egptr());
+  return std::streampos(target);
+}
+
+std::streampos BlockCompressedInputBuffer::seekoff(
+    std::streamoff off, std::ios_base::seekdir way,
+    std::ios_base::openmode which) {
+  if (!(which & std::ios_base::in))
+    return std::streampos(std::streamoff(-1));
+  int64 target;
+  if (way == std::ios_base::beg) target = off;
+  else if (way == std::ios_base::cur) target = CurrentPos() + off;
+  else target = static_cast<int64>(total_uncompressed_) + off;
+  return SeekInternal(target);
+}
+
+std::streampos BlockCompressedInputBuffer::seekpos(
+    std::streampos pos, std::ios_base::openmode which) {
+  if (!(which & std::ios_base::in))
+    return std::streampos(std::streamoff(-1));
+  return SeekInternal(static_cast<int64>(pos));
+}
+
+void BlockCompressedInputBuffer::Close() {
+  if (raw_.is_open())
+    raw_.close();
+  block_offsets_.clear();
+  block_size_ = 0;
+  num_blocks_ = 0;
+  total_uncompressed_ = 0;
+  cur_block_ = -1;
+  failed_ = false;
+  setg(NULL, NULL, NULL);
+}
+
+}  // namespace kaldi.
@@ -0,0 +1,183 @@
+// util/block-compressed-io.h
+
+// Copyright 2015  Johns Hopkins University (Author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_UTIL_BLOCK_COMPRESSED_IO_H_
+#define KALDI_UTIL_BLOCK_COMPRESSED_IO_H_
+
+#include <fstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "base/kaldi-common.h"
+
+namespace kaldi {
+
+/**
+   This header implements a block-compressed, seekable file format (".blz")
+   that kaldi-io.{h,cc} uses to read and write compressed archives natively,
+   without forking a gzip process through a pipe (which cannot seek, so
+   offsets in scp files do not work with it).
+
+   The format compresses the byte stream in fixed-size blocks (64 kB of
+   uncompressed data per block) with a simple byte-aligned LZ77 codec
+   implemented below; an index of block positions is appended when the file
+   is closed.  Because the block size is fixed, seeking to an uncompressed
+   offset only requires decompressing the one block containing it, so
+   rxfilenames like "foo.ark.blz:12345" (with the offset interpreted in the
+   uncompressed stream, exactly as for uncompressed archives) keep working;
+   "ark,scp:foo.ark.blz,foo.scp" produces a usable scp file.  The format is
+   not compatible with gzip; like Kaldi binary data, it is not endian-safe.
+
+   User code will normally not use these classes directly but just open
+   filenames ending in ".blz" via the Input and Output classes.
+*/
+
+
+/// \addtogroup io_funcs_internal
+/// @{
+
+/// The fixed uncompressed block size of the ".blz" format.
+extern const int32 kBlockCompressedBlockSize;
+
+/// Compresses the "in_size" bytes at "in" as one block, setting *out to the
+/// compressed form.  "in_size" must not exceed kBlockCompressedBlockSize.
+/// The output may be larger than the input for incompressible data (by a
+/// bounded amount); the file layer stores such blocks uncompressed.
+void BlockCompress(const char *in, int32 in_size, std::vector<char> *out);
+
+/// Decompresses a block produced by BlockCompress.  "out_size" must be the
+/// exact uncompressed size (which the file format records).  Returns false
+/// if the compressed data is corrupted; never reads or writes out of
+/// bounds.
+bool BlockDecompress(const char *in, int32 in_size,
+                     char *out, int32 out_size);
+
+
+/** A streambuf that writes a ".blz" file.  Bytes are buffered until a full
+    block is available, then compressed and written out; Close() flushes the
+    final partial block and appends the block index.  tellp() on a stream
+    using this buffer returns the position in the *uncompressed* stream, so
+    that offsets recorded in scp files are valid for reading.  Seeking is
+    not supported (output is append-only, like a pipe).
+*/
+class BlockCompressedOutputBuffer: public std::streambuf {
+ public:
+  BlockCompressedOutputBuffer();
+
+  /// Opens "filename" for writing, returning false on failure.
+  bool Open(const std::string &filename);
+
+  bool IsOpen() const { return raw_.is_open(); }
+
+  /// Flushes the final block, writes the index and closes the file;
+  /// returns false if any write failed.
+  bool Close();
+
+  ~BlockCompressedOutputBuffer();
+
+ protected:
+  virtual int overflow(int c);
+  virtual int sync();
+  // Supports only tellp(), i.e. seekoff(0, cur); returns the offset in the
+  // uncompressed stream.
+  virtual std::streampos seekoff(std::streamoff off,
+                                 std::ios_base::seekdir way,
+                                 std::ios_base::openmode which);
+
+ private:
+  // Compresses and writes out the data currently in buf_ (a full block,
+  // except on Close()); returns false on write failure.
+  bool WriteBlock();
+
+  std::ofstream raw_;  // the underlying (compressed) file.
+  std::vector<char> buf_;   // uncompressed data of the block being filled;
+                            // the put area points into this.
+  std::vector<char> comp_;  // temporary for the compressed block.
+  std::vector<uint64> block_offsets_;  // offset in the file of each block
+                                       // written so far.
+  uint64 raw_offset_;      // current write offset in the file.
+  uint64 uncomp_written_;  // uncompressed bytes in completed blocks.
+  bool write_failed_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(BlockCompressedOutputBuffer);
+};
+
+
+/** A streambuf that reads a ".blz" file written by
+    BlockCompressedOutputBuffer.  It reads the block index when opened and
+    decompresses one block at a time; seekg() to an offset in the
+    uncompressed stream decompresses only the block containing that offset,
+    which is what makes offsets into compressed archives cheap.
+*/
+class BlockCompressedInputBuffer: public std::streambuf {
+ public:
+  BlockCompressedInputBuffer();
+
+  /// Opens "filename" and reads its header and block index; returns false
+  /// (after a warning) if the file cannot be read or is not a valid ".blz"
+  /// file.
+  bool Open(const std::string &filename);
+
+  bool IsOpen() const { return raw_.is_open(); }
+
+  void Close();
+
+  ~BlockCompressedInputBuffer() { Close(); }
+
+ protected:
+  virtual int underflow();
+  // Seeks interpret positions in the uncompressed stream.
+  virtual std::streampos seekoff(std::streamoff off,
+                                 std::ios_base::seekdir way,
+                                 std::ios_base::openmode which);
+  virtual std::streampos seekpos(std::streampos pos,
+                                 std::ios_base::openmode which);
+
+ private:
+  // Decompresses block "block" into block_buf_ and makes it the get area;
+  // returns false (having set failed_) on read error or corruption.
+  bool LoadBlock(int64 block);
+
+  // The current offset in the uncompressed stream.
+  int64 CurrentPos() const;
+
+  // Seeks to "target" in the uncompressed stream; returns -1 on failure.
+  std::streampos SeekInternal(int64 target);
+
+  std::ifstream raw_;  // the underlying (compressed) file.
+  uint32 block_size_;  // uncompressed block size recorded in the header.
+  uint64 num_blocks_;
+  uint64 total_uncompressed_;  // total size of the uncompressed stream.
+  std::vector<uint64> block_offsets_;  // offset in the file of each block.
+  std::vector<char> block_buf_;  // uncompressed data of the current block;
+                                 // the get area points into this.
+  std::vector<char> comp_;       // temporary for the compressed block.
+  int64 cur_block_;  // index of the block in block_buf_, or -1 if none.
+  bool failed_;      // a read error or corruption was detected; further
+                     // reads and seeks fail.
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(BlockCompressedInputBuffer);
+};
+
+/// @}
+
+}  // namespace kaldi.
+
+#endif  // KALDI_UTIL_BLOCK_COMPRESSED_IO_H_
@@ -29,7 +29,7 @@ namespace kaldi {
 template<class I>
 void ConstIntegerSet<I>::InitInternal() {
   KALDI_ASSERT_IS_INTEGER_TYPE(I);
-  quick_set_.clear();  // just in case we previously had data.
+  bits_.clear();  // just in case we previously had data.
   if (slow_set_.size() == 0) {
     lowest_member_=(I) 1;
     highest_member_=(I) 0;
@@ -44,11 +44,13 @@ void ConstIntegerSet<I>::InitInternal() {
       quick_=false;
     } else {
       contiguous_ = false;
-      if (range < slow_set_.size() * 8 * sizeof(I)) {  // If it would be more compact to store as bool
-        // (assuming 1 bit per element)...
-        quick_set_.resize(range, false);
-        for (size_t i = 0;i < slow_set_.size();i++)
-          quick_set_[slow_set_[i] - lowest_member_] = true;
+      if (range < slow_set_.size() * 8 * sizeof(I)) {  // If it would be more compact to store as bits
+        // (one bit per element in the range)...
+        bits_.resize((range + 63) / 64, 0);
+        for (size_t i = 0;i < slow_set_.size();i++) {
+          size_t idx = slow_set_[i] - lowest_member_;
+          bits_[idx >> 6] |= (static_cast<uint64>(1) << (idx & 63));
+        }
         quick_ = true;
       } else {
         quick_ = false;
@@ -62,7 +64,10 @@ int ConstIntegerSet<I>::count(I i) const {
   if (i < lowest_member_ || i > highest_member_) return 0;
   else {
     if (contiguous_) return true;
-    if (quick_) return (quick_set_[i-lowest_member_] ? 1 : 0);
+    if (quick_) {
+      size_t idx = i - lowest_member_;
+      return static_cast<int>((bits_[idx >> 6] >> (idx & 63)) & 1);
+    }
     else {
       bool ans = std::binary_search(slow_set_.begin(), slow_set_.end(), i);
       return (ans ? 1 : 0);
@@ -70,6 +75,29 @@ int ConstIntegerSet<I>::count(I i) const {
   }
 }
 
+template<class I>
+void ConstIntegerSet<I>::CountBatched(const I *in, size_t n, uint8 *out) const {
+  if (quick_) {
+    // The bounds test is done with one unsigned comparison: values below
+    // lowest_member_ wrap around to something >= range.  This loop has no
+    // branches in its body, so the compiler can vectorize it.
+    size_t range = static_cast<size_t>(highest_member_) + 1
+        - static_cast<size_t>(lowest_member_);
+    for (size_t j = 0; j < n; j++) {
+      size_t idx = static_cast<size_t>(in[j])
+          - static_cast<size_t>(lowest_member_);
+      out[j] = (idx < range) ?
+          static_cast<uint8>((bits_[idx >> 6] >> (idx & 63)) & 1) : 0;
+    }
+  } else if (contiguous_) {
+    for (size_t j = 0; j < n; j++)
+      out[j] = (in[j] >= lowest_member_ && in[j] <= highest_member_) ? 1 : 0;
+  } else {  // binary search per element (sparse sets), or empty set.
+    for (size_t j = 0; j < n; j++)
+      out[j] = static_cast<uint8>(count(in[j]));
+  }
+}
+
 template<class I>
 void ConstIntegerSet<I>::Write(std::ostream &os, bool binary) const {
   WriteIntegerVector(os, binary, slow_set_);
@@ -92,6 +92,19 @@ template<class Int> void TestSetOfNumbers(bool binary) {
     }
   }
 
+  {  // test the batched membership interface against count().
+    std::vector<Int> queries;
+    std::vector<uint8> answers;
+    for (size_t i = 0; i < 500; i++)
+      queries.push_back((Int) (Rand() % max));
+    answers.resize(queries.size(), 2);  // 2 = not a valid answer.
+    my_set1.CountBatched(queries.empty() ? NULL : &(queries[0]),
+                         queries.size(),
+                         answers.empty() ? NULL : &(answers[0]));
+    for (size_t i = 0; i < queries.size(); i++)
+      KALDI_ASSERT(answers[i] == (uint8) my_set1.count(queries[i]));
+  }
+
   //  if (enable_iterators) {
   typename std::set<Int>::iterator baseline_iter = baseline_set.begin();
   typename ConstIntegerSet<Int>::iterator my_iter1 = my_set1.begin();
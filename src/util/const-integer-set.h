@@ -29,8 +29,9 @@
 
   /* ConstIntegerSet is a way to efficiently test whether something is in a
      supplied set of integers.  It can be initialized from a vector or set, but
-     never changed after that. It either uses a sorted vector or an array of
-     bool, depending on the input.  It behaves like a const version of an STL set, with
+     never changed after that.  Depending on the density of the input it either
+     uses a sorted vector, or a bitmap of 64-bit words so membership is a
+     single shift-and-mask.  It behaves like a const version of an STL set, with
      only a subset of the functionality, except all the member functions are
      upper-case.
 
@@ -69,6 +70,12 @@ template<class I> class ConstIntegerSet {
 
   int count(I i) const;  // returns 1 or 0.
 
+  /// Batched version of count(): sets out[j] to 1 or 0 according to whether
+  /// in[j] is in the set, for 0 <= j < n.  In the bitmap mode this is a tight
+  /// branch-free loop that the compiler can vectorize; prefer it when testing
+  /// many values at once (e.g. the transition-ids of a whole frame or arc).
+  void CountBatched(const I *in, size_t n, uint8 *out) const;
+
   typedef typename std::vector<I>::const_iterator iterator;
   iterator begin() const { return slow_set_.begin(); }
   iterator end() const { return slow_set_.end(); }
@@ -83,7 +90,8 @@ template<class I> class ConstIntegerSet {
   I highest_member_;
   bool contiguous_;
   bool quick_;
-  std::vector<bool> quick_set_;
+  std::vector<uint64> bits_;  // bitmap indexed by (i - lowest_member_), used
+                              // if quick_ == true.
   std::vector<I> slow_set_;
   void InitInternal();
 };
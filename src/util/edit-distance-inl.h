@@ -43,6 +43,8 @@ int32 LevenshteinEditDistance(const std::vector<T> &a,
   // The outer iterations range over m = 0..M.
 
   int M = a.size(), N = b.size();
+  if (std::min(M, N) >= 16)  // the bit-parallel version wins once the
+    return LevenshteinEditDistanceBitParallel(a, b);  // sequences have some length.
   std::vector<int32> e(N+1);
   std::vector<int32> e_tmp(N+1);
   // initialize e.
@@ -63,6 +65,78 @@ int32 LevenshteinEditDistance(const std::vector<T> &a,
   }
   return e.back();
 }
+
+template<class T>
+int32 LevenshteinEditDistanceBitParallel(const std::vector<T> &a,
+                                         const std::vector<T> &b) {
+  // This is the bit-parallel algorithm of [Myers, "A fast bit-vector
+  // algorithm for approximate string matching based on dynamic programming",
+  // JACM 1999], in the blocked form of Hyyro that handles patterns longer
+  // than one machine word.  We call the shorter sequence the "pattern"; each
+  // column of the dynamic-programming table is represented by bit-vectors VP
+  // and VN holding the +1 / -1 vertical differences between adjacent cells,
+  // and one column is processed per text symbol with a constant number of
+  // word operations per 64 pattern rows.  The value returned is identical to
+  // that of the scalar recursion in LevenshteinEditDistance() above.
+  const std::vector<T> &pat = (a.size() <= b.size() ? a : b),
+      &text = (a.size() <= b.size() ? b : a);
+  int32 M = pat.size(), N = text.size();
+  if (M == 0) return N;
+  const int32 kWordBits = 64;
+  int32 num_blocks = (M + kWordBits - 1) / kWordBits;
+
+  // The alphabet is the set of distinct pattern symbols, discovered with
+  // operator == only (so T need not be hashable or ordered); peq holds, for
+  // each alphabet symbol, the bit-mask of pattern positions holding it.
+  std::vector<T> alphabet;
+  std::vector<uint64> peq;  // indexed [symbol_index * num_blocks + block].
+  for (int32 m = 0; m < M; m++) {
+    size_t s = 0;
+    while (s < alphabet.size() && !(alphabet[s] == pat[m])) s++;
+    if (s == alphabet.size()) {
+      alphabet.push_back(pat[m]);
+      peq.resize(peq.size() + num_blocks, 0);
+    }
+    peq[s * num_blocks + (m / kWordBits)] |=
+        static_cast<uint64>(1) << (m % kWordBits);
+  }
+
+  std::vector<uint64> vp(num_blocks, ~static_cast<uint64>(0)),
+      vn(num_blocks, 0);
+  int32 last_bit = (M - 1) % kWordBits;  // row of the last pattern symbol,
+                                         // within the last block.
+  int32 score = M;  // distance at the bottom of the current column.
+  for (int32 n = 0; n < N; n++) {
+    size_t s = 0;  // look up the text symbol in the pattern alphabet.
+    while (s < alphabet.size() && !(alphabet[s] == text[n])) s++;
+    const uint64 *eq_row = (s < alphabet.size() ? &(peq[s * num_blocks])
+                            : NULL);
+    int32 hin = 1;  // horizontal difference entering the top block; the
+                    // boundary row E(0, n) = n increases by one per column.
+    for (int32 j = 0; j < num_blocks; j++) {
+      uint64 eq = (eq_row != NULL ? eq_row[j] : 0);
+      uint64 xv = eq | vn[j];
+      if (hin < 0) eq |= 1;
+      uint64 xh = (((eq & vp[j]) + vp[j]) ^ vp[j]) | eq;
+      uint64 hp = vn[j] | ~(xh | vp[j]);
+      uint64 hn = xh & vp[j];
+      uint64 msb = static_cast<uint64>(1) <<
+          (j == num_blocks - 1 ? last_bit : kWordBits - 1);
+      int32 hout = 0;
+      if (hp & msb) hout = 1;
+      else if (hn & msb) hout = -1;
+      hp <<= 1;
+      hn <<= 1;
+      if (hin > 0) hp |= 1;
+      else if (hin < 0) hn |= 1;
+      vp[j] = hn | ~(xv | hp);
+      vn[j] = hp & xv;
+      hin = hout;  // carry the horizontal difference into the next block.
+    }
+    score += hin;  // hin is now the output of the last block.
+  }
+  return score;
+}
 //
 struct error_stats{
   int32 ins_num;
@@ -74,9 +148,9 @@ struct error_stats{
 // the following implementation.
 
 template<class T>
-int32 LevenshteinEditDistance(const std::vector<T> &ref,
-                              const std::vector<T> &hyp,
-                              int32 *ins, int32 *del, int32 *sub) {
+int32 LevenshteinEditDistanceReference(const std::vector<T> &ref,
+                                       const std::vector<T> &hyp,
+                                       int32 *ins, int32 *del, int32 *sub) {
   // temp sequence to remember error type and stats.
   std::vector<error_stats> e(ref.size()+1);
   std::vector<error_stats> cur_e(ref.size()+1);
@@ -124,6 +198,57 @@ int32 LevenshteinEditDistance(const std::vector<T> &ref,
   return e[ref_index].total_cost;
 }
 
+template<class T>
+int32 LevenshteinEditDistance(const std::vector<T> &ref,
+                              const std::vector<T> &hyp,
+                              int32 *ins, int32 *del, int32 *sub) {
+  // This computes exactly what LevenshteinEditDistanceReference() computes
+  // (the same branches are taken in the same order, so ties between equal-cost
+  // alignments break identically), but each cell of the dynamic-programming
+  // row is a single 64-bit word with the fields
+  //    total_cost in bits 48..63, ins_num in bits 32..47,
+  //    del_num in bits 16..31, sub_num in bits 0..15,
+  // so extending an alignment is one 64-bit add and the per-cell copies that
+  // dominated the struct version become single-word moves.  The fields cannot
+  // overflow into each other as long as both sequences have fewer than 2^16
+  // elements; longer inputs fall back to the reference implementation.
+  if (ref.size() >= 0xFFFF || hyp.size() >= 0xFFFF)
+    return LevenshteinEditDistanceReference(ref, hyp, ins, del, sub);
+  const uint64 kCost = static_cast<uint64>(1) << 48,
+      kIns = static_cast<uint64>(1) << 32,
+      kDel = static_cast<uint64>(1) << 16,
+      kSub = static_cast<uint64>(1);
+  std::vector<uint64> e(ref.size()+1);
+  std::vector<uint64> cur_e(ref.size()+1);
+  // the zeroth hypothesis row aligns i reference words to nothing,
+  // i.e. i deletions.
+  for (size_t i = 0; i < e.size(); i++)
+    e[i] = static_cast<uint64>(i) * (kCost + kDel);
+
+  for (size_t hyp_index = 1; hyp_index <= hyp.size(); hyp_index++) {
+    cur_e[0] = e[0] + kCost + kIns;
+    for (size_t ref_index = 1; ref_index <= ref.size(); ref_index++) {
+      uint64 sub_v = e[ref_index-1] +
+          (hyp[hyp_index-1] == ref[ref_index-1] ? 0 : kCost + kSub);
+      uint64 del_v = cur_e[ref_index-1] + kCost + kDel;
+      uint64 ins_v = e[ref_index] + kCost + kIns;
+      // On cost ties the reference implementation prefers insertion over
+      // deletion over substitution, which the replace-on-<= order below
+      // reproduces.
+      uint64 best = sub_v;
+      if ((del_v >> 48) <= (best >> 48)) best = del_v;
+      if ((ins_v >> 48) <= (best >> 48)) best = ins_v;
+      cur_e[ref_index] = best;
+    }
+    e.swap(cur_e);  // alternate for the next recursion.
+  }
+  uint64 result = e.back();
+  *ins = static_cast<int32>((result >> 32) & 0xFFFF);
+  *del = static_cast<int32>((result >> 16) & 0xFFFF);
+  *sub = static_cast<int32>(result & 0xFFFF);
+  return static_cast<int32>(result >> 48);
+}
+
 template<class T>
 int32 LevenshteinAlignment(const std::vector<T> &a,
                            const std::vector<T> &b,
@@ -228,6 +228,42 @@ void TestEditDistance2String() {
 }
 
 
+void TestEditDistanceBitParallel() {
+  // Compare the bit-parallel distance against the full-table computation in
+  // LevenshteinAlignment(), on lengths chosen to exercise one, two and three
+  // 64-bit blocks (and the empty cases).
+  for (size_t i = 0; i < 300; i++) {
+    size_t a_sz = Rand() % 180, b_sz = Rand() % 180;
+    int32 alphabet_size = 1 + Rand() % 10;
+    std::vector<int32> a, b;
+    for (size_t j = 0; j < a_sz; j++) a.push_back(Rand() % alphabet_size);
+    for (size_t j = 0; j < b_sz; j++) b.push_back(Rand() % alphabet_size);
+    std::vector<std::pair<int32, int32> > ans;
+    int32 e1 = LevenshteinEditDistanceBitParallel(a, b),
+        e2 = LevenshteinAlignment(a, b, -1, &ans),
+        e3 = LevenshteinEditDistance(a, b);
+    KALDI_ASSERT(e1 == e2 && e1 == e3);
+  }
+}
+
+void TestEditDistancePacked() {
+  // The packed-word stats computation must match the reference struct
+  // version exactly, including how ties between equal-cost alignments
+  // are broken (i.e. the ins/del/sub breakdown, not just the total).
+  for (size_t i = 0; i < 500; i++) {
+    size_t ref_sz = Rand() % 30, hyp_sz = Rand() % 30;
+    int32 alphabet_size = 1 + Rand() % 5;
+    std::vector<int32> ref, hyp;
+    for (size_t j = 0; j < ref_sz; j++) ref.push_back(Rand() % alphabet_size);
+    for (size_t j = 0; j < hyp_sz; j++) hyp.push_back(Rand() % alphabet_size);
+    int32 ins, del, sub, ins2, del2, sub2;
+    int32 cost = LevenshteinEditDistance(ref, hyp, &ins, &del, &sub);
+    int32 cost2 = LevenshteinEditDistanceReference(ref, hyp, &ins2, &del2,
+                                                   &sub2);
+    KALDI_ASSERT(cost == cost2 && ins == ins2 && del == del2 && sub == sub2);
+  }
+}
+
 void TestLevenshteinAlignment() {
   for (size_t i = 0; i < 100; i++) {
     size_t a_sz = Rand() % 5, b_sz = Rand() % 5;
@@ -259,6 +295,8 @@ int main() {
   TestEditDistanceString();
   TestEditDistance2();
   TestEditDistance2String();
+  TestEditDistanceBitParallel();
+  TestEditDistancePacked();
   TestLevenshteinAlignment();
   std::cout << "Test OK\n";
 }
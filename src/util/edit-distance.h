@@ -29,11 +29,19 @@
 
 namespace kaldi {
 
-// Compute the edit-distance between two strings.
+// Compute the edit-distance between two strings.  For all but very short
+// sequences this dispatches to the bit-parallel implementation below.
 template<class T>
 int32 LevenshteinEditDistance(const std::vector<T> &a,
                               const std::vector<T> &b);
 
+// Bit-parallel (Myers-style) computation of the edit distance; returns the
+// same value as the version above but processes up to 64 rows of the dynamic
+// programming table per machine word, which is substantially faster when
+// aligning many long sequences.  Only requires operator == on T.
+template<class T>
+int32 LevenshteinEditDistanceBitParallel(const std::vector<T> &a,
+                                         const std::vector<T> &b);
 
 // edit distance calculation with conventional method.
 // note: noise word must be filtered out from the hypothesis and reference sequence
@@ -43,6 +51,16 @@ int32 LevenshteinEditDistance(const std::vector<T> &ref,
                               const std::vector<T> &hyp,
                               int32 *ins, int32 *del, int32 *sub);
 
+// Reference implementation of the version above that keeps the error counts
+// in a struct per cell; the public version packs them into a single 64-bit
+// word, which gives the same answer (including tie-breaking) with much less
+// data movement.  This one is retained as a fallback for sequences too long
+// for the packed counts, and for testing.
+template<class T>
+int32 LevenshteinEditDistanceReference(const std::vector<T> &ref,
+                                       const std::vector<T> &hyp,
+                                       int32 *ins, int32 *del, int32 *sub);
+
 // This version of the edit-distance computation outputs the alignment
 // between the two.  This is a vector of pairs of (symbol a, symbol b).
 // The epsilon symbol (eps_symbol) must not occur in sequences a or b.
@@ -29,30 +29,81 @@ namespace kaldi {
 
 template<class I, class T> HashList<I, T>::HashList() {
   list_head_ = NULL;
-  bucket_list_tail_ = static_cast<size_t>(-1);  // invalid.
+  list_tail_ = NULL;
   hash_size_ = 0;
+  hash_mask_ = 0;
+  hash_shift_ = 0;
+  num_indexed_ = 0;
+  cur_epoch_ = 1;  // slots start out with epoch zero, i.e. empty.
   freed_head_ = NULL;
 }
 
+template<class I, class T>
+inline size_t HashList<I, T>::HashOf(I key) const {
+  // Multiplicative hashing (the constant is 2^64 / golden-ratio, rounded to
+  // odd); we take the high bits of the product.  With linear probing we
+  // cannot just take "key % hash_size_" the way the bucketed version did:
+  // decoder state-ids arrive in long runs of nearby values, which would
+  // form huge probe clusters.
+  uint64 product = static_cast<uint64>(key) *
+      static_cast<uint64>(0x9e3779b97f4a7c15ULL);
+  return static_cast<size_t>(product >> hash_shift_);
+}
+
+template<class I, class T> void HashList<I, T>::Grow() {
+  size_t new_size = (hash_size_ == 0 ? 2 : hash_size_ * 2);
+  int32 bits = 1;
+  while ((static_cast<size_t>(1) << bits) < new_size) bits++;
+  HashSlot empty_slot;
+  empty_slot.epoch = 0;
+  empty_slot.key = I();
+  empty_slot.elem = NULL;
+  slots_.assign(new_size, empty_slot);
+  hash_size_ = new_size;
+  hash_mask_ = new_size - 1;
+  hash_shift_ = 64 - bits;
+  num_indexed_ = 0;
+  // Re-index the stored list.  It is in insertion order, so for duplicate
+  // keys the first Elem we meet is the first that was added, which is the
+  // one Find() is supposed to return; later ones are skipped (this also
+  // covers Elems added with InsertMore(), which are never indexed).
+  for (Elem *e = list_head_; e != NULL; e = e->tail) {
+    size_t i = HashOf(e->key);
+    while (slots_[i].epoch == cur_epoch_ && !(slots_[i].key == e->key))
+      i = (i + 1) & hash_mask_;
+    if (slots_[i].epoch != cur_epoch_) {  // key was not indexed yet.
+      slots_[i].epoch = cur_epoch_;
+      slots_[i].key = e->key;
+      slots_[i].elem = e;
+      num_indexed_++;
+    }
+  }
+}
+
 template<class I, class T> void HashList<I, T>::SetSize(size_t size) {
-  hash_size_ = size;
-  KALDI_ASSERT(list_head_ == NULL && bucket_list_tail_ == static_cast<size_t>(-1));  // make sure empty.
-  if (size > buckets_.size())
-    buckets_.resize(size, HashBucket(0, NULL));
+  KALDI_ASSERT(list_head_ == NULL && num_indexed_ == 0);  // make sure empty.
+  if (size <= hash_size_) return;  // we never shrink.
+  size_t new_size = (hash_size_ == 0 ? 2 : hash_size_);
+  while (new_size < size) new_size *= 2;  // round up to a power of two.
+  hash_size_ = new_size / 2;  // Grow() doubles.
+  Grow();
 }
 
 template<class I, class T>
 typename HashList<I, T>::Elem* HashList<I, T>::Clear() {
   // Clears the hashtable and gives ownership of the currently contained list to the
-  // user.
-  for (size_t cur_bucket = bucket_list_tail_;
-      cur_bucket != static_cast<size_t>(-1);
-      cur_bucket = buckets_[cur_bucket].prev_bucket) {
-    buckets_[cur_bucket].last_elem = NULL;  // this is how we indicate "empty".
+  // user.  Bumping the epoch makes every slot count as empty, without
+  // touching them.
+  cur_epoch_++;
+  if (cur_epoch_ == 0) {  // the epoch counter wrapped around (rare); reset
+    // all the slot tags so no stale slot can match the new epoch.
+    for (size_t i = 0; i < slots_.size(); i++) slots_[i].epoch = 0;
+    cur_epoch_ = 1;
   }
-  bucket_list_tail_ = static_cast<size_t>(-1);
+  num_indexed_ = 0;
   Elem *ans = list_head_;
   list_head_ = NULL;
+  list_tail_ = NULL;
   return ans;
 }
 
@@ -69,19 +120,12 @@ inline void HashList<I, T>::Delete(Elem *e) {
 
 template<class I, class T>
 inline typename HashList<I, T>::Elem* HashList<I, T>::Find(I key) {
-  size_t index = (static_cast<size_t>(key) % hash_size_);
-  HashBucket &bucket = buckets_[index];
-  if (bucket.last_elem == NULL) {
-    return NULL;  // empty bucket.
-  } else {
-    Elem *head = (bucket.prev_bucket == static_cast<size_t>(-1) ?
-                  list_head_ :
-                  buckets_[bucket.prev_bucket].last_elem->tail),
-        *tail = bucket.last_elem->tail;
-    for (Elem *e = head; e != tail; e = e->tail)
-      if (e->key == key) return e;
-    return NULL;  // Not found.
+  size_t i = HashOf(key);
+  while (slots_[i].epoch == cur_epoch_) {
+    if (slots_[i].key == key) return slots_[i].elem;
+    i = (i + 1) & hash_mask_;  // linear probing.
   }
+  return NULL;  // hit an empty slot: not present.
 }
 
 template<class I, class T>
@@ -123,58 +167,42 @@ HashList<I, T>::~HashList() {
 
 template<class I, class T>
 void HashList<I, T>::Insert(I key, T val) {
-  size_t index = (static_cast<size_t>(key) % hash_size_);
-  HashBucket &bucket = buckets_[index];
+  if ((num_indexed_ + 1) * 2 > hash_size_)
+    Grow();  // keep the load factor at most one half.
   Elem *elem = New();
   elem->key = key;
   elem->val = val;
-
-  if (bucket.last_elem == NULL) {  // Unoccupied bucket.  Insert at
-    // head of bucket list (which is tail of regular list, they go in
-    // opposite directions).
-    if (bucket_list_tail_ == static_cast<size_t>(-1)) {
-      // list was empty so this is the first elem.
-      KALDI_ASSERT(list_head_ == NULL);
-      list_head_ = elem;
-    } else {
-      // link in to the chain of Elems
-      buckets_[bucket_list_tail_].last_elem->tail = elem;
-    }
-    elem->tail = NULL;
-    bucket.last_elem = elem;
-    bucket.prev_bucket = bucket_list_tail_;
-    bucket_list_tail_ = index;
-  } else {
-    // Already-occupied bucket.  Insert at tail of list of elements within
-    // the bucket.
-    elem->tail = bucket.last_elem->tail;
-    bucket.last_elem->tail = elem;
-    bucket.last_elem = elem;
+  elem->tail = NULL;
+  if (list_head_ == NULL) list_head_ = elem;
+  else list_tail_->tail = elem;
+  list_tail_ = elem;
+
+  size_t i = HashOf(key);
+  while (slots_[i].epoch == cur_epoch_) {
+    if (slots_[i].key == key) return;  // Duplicate insertion (see the
+    // header): the new Elem is in the list, but the index keeps pointing
+    // at the first one added, which is what Find() returns.
+    i = (i + 1) & hash_mask_;  // linear probing.
   }
+  slots_[i].epoch = cur_epoch_;
+  slots_[i].key = key;
+  slots_[i].elem = elem;
+  num_indexed_++;
 }
 
 template<class I, class T>
 void HashList<I, T>::InsertMore(I key, T val) {
-  size_t index = (static_cast<size_t>(key) % hash_size_);
-  HashBucket &bucket = buckets_[index];
+  Elem *first = Find(key);
+  KALDI_ASSERT(first != NULL); // we assume there is already one element
   Elem *elem = New();
   elem->key = key;
   elem->val = val;
-
-  KALDI_ASSERT(bucket.last_elem != NULL); // we assume there is already one element
-  if (bucket.last_elem->key == key) { // standard behavior: add as last element
-    elem->tail = bucket.last_elem->tail;
-    bucket.last_elem->tail = elem;
-    bucket.last_elem = elem;
-    return;
-  } 
-  Elem *e = (bucket.prev_bucket == static_cast<size_t>(-1) ?
-             list_head_ : buckets_[bucket.prev_bucket].last_elem->tail);
-  // find place to insert in linked list 
-  while (e != bucket.last_elem->tail && e->key != key) e = e->tail;
-  KALDI_ASSERT(e->key == key); // not found? - should not happen
-  elem->tail = e->tail;
-  e->tail = elem;
+  // Splice in right after "first", so that all elements with the same key
+  // follow each other (Find() keeps returning the first one).  The new
+  // Elem does not go in the index.
+  elem->tail = first->tail;
+  first->tail = elem;
+  if (list_tail_ == first) list_tail_ = elem;
 }
 
 
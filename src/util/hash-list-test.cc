@@ -86,6 +86,40 @@ template<class Int, class T> void TestHashList() {
   }
 }
 
+template<class Int, class T> void TestHashListGrow() {
+  typedef typename HashList<Int, T>::Elem Elem;
+
+  // Deliberately under-size the hash; the table should grow by itself as
+  // we insert, without Find() becoming wrong.
+  HashList<Int, T> hash;
+  hash.SetSize(2);
+  const size_t num_elems = 2000;
+  for (size_t j = 0; j < num_elems; j++)
+    hash.Insert(static_cast<Int>(j), static_cast<T>(j % 50));
+  KALDI_ASSERT(hash.Size() >= num_elems * 2);  // load factor at most 1/2.
+  for (size_t j = 0; j < num_elems; j++) {
+    Elem *e = hash.Find(static_cast<Int>(j));
+    KALDI_ASSERT(e != NULL && e->val == static_cast<T>(j % 50));
+  }
+  // Elements added with InsertMore() must directly follow the first element
+  // with that key, and Find() must keep returning the first one.
+  Int key = static_cast<Int>(num_elems / 2);
+  Elem *first = hash.Find(key);
+  hash.InsertMore(key, static_cast<T>(1));
+  hash.InsertMore(key, static_cast<T>(2));
+  KALDI_ASSERT(hash.Find(key) == first);
+  KALDI_ASSERT(first->tail != NULL && first->tail->key == key);
+  KALDI_ASSERT(first->tail->tail != NULL && first->tail->tail->key == key);
+
+  Elem *h = hash.Clear(), *tmp;
+  size_t count = 0;
+  for (; h != NULL; h = tmp, count++) {
+    tmp = h->tail;
+    hash.Delete(h);
+  }
+  KALDI_ASSERT(count == num_elems + 2);
+}
+
 
 
 
@@ -102,6 +136,8 @@ int main() {
     TestHashList<short unsigned int, long int>();
     TestHashList<char, unsigned char>();
     TestHashList<unsigned char, int>();
+    TestHashListGrow<int, unsigned int>();
+    TestHashListGrow<unsigned int, int>();
   }
   std::cout << "Test OK.\n";
 }
@@ -41,6 +41,16 @@
    list structure intact.  We also control memory management inside this object,
    to avoid repeated new's/deletes.
 
+   The hash part is an open-addressing table of (key, Elem*) slots with linear
+   probing: Find() and Insert() scan a flat array instead of chasing bucket
+   chains, which matters in the decoders where Find() on the token hash is one
+   of the hottest calls.  Each slot carries an epoch tag and the table is
+   cleared by bumping the current epoch, so Clear() is O(1) and there are no
+   tombstones (per-element deletion is not part of the interface).  The table
+   size is a power of two and it doubles itself whenever the load factor would
+   exceed one half, re-indexing from the stored list, so a too-small SetSize()
+   no longer degrades into long searches.
+
    See hash-list-test.cc for an example of how to use this object.
 */
 
@@ -98,31 +108,55 @@ template<class I, class T> class HashList {
   /// Find() will return the first one of the elements with the same key.
   inline void InsertMore(I key, T val);
 
-  /// SetSize tells the object how many hash buckets to allocate (should typically be
+  /// SetSize tells the object how many hash slots to allocate (should typically be
   /// at least twice the number of objects we expect to go in the structure, for fastest
   /// performance).  It must be called while the hash is empty (e.g. after Clear() or
-  /// after initializing the object, but before adding anything to the hash.
+  /// after initializing the object, but before adding anything to the hash.  The
+  /// size is rounded up to a power of two, and the table never shrinks (so a
+  /// smaller SetSize() after a larger one is a no-op).
   void SetSize(size_t sz);
 
-  /// Returns current number of hash buckets.
+  /// Returns current number of hash slots.
   inline size_t Size() { return hash_size_; }
 
+  /// Returns the bytes of dynamic memory held by this object (the hash
+  /// slots plus all Elem blocks, free or in use); neither ever shrinks, so
+  /// this is a high-water mark.  For memory accounting (see
+  /// util/memory-stats.h).
+  size_t MemoryBytes() const {
+    return slots_.capacity() * sizeof(HashSlot) +
+        allocated_.size() * allocate_block_size_ * sizeof(Elem);
+  }
+
   ~HashList();
  private:
 
-  struct HashBucket {
-    size_t prev_bucket;  // index to next bucket (-1 if list tail).  Note: list of buckets
-    // goes in opposite direction to list of Elems.
-    Elem *last_elem;  // pointer to last element in this bucket (NULL if empty)
-    inline HashBucket(size_t i, Elem *e): prev_bucket(i), last_elem(e) {}
+  struct HashSlot {
+    uint32 epoch;  // the slot is occupied iff epoch == cur_epoch_.
+    I key;
+    Elem *elem;  // the first Elem that was inserted with this key.
   };
 
-  Elem *list_head_;  // head of currently stored list.
-  size_t bucket_list_tail_;  // tail of list of active hash buckets.
+  /// Returns the index to start probing from for this key.
+  inline size_t HashOf(I key) const;
 
-  size_t hash_size_;  // number of hash buckets.
+  /// Doubles the size of the index and re-indexes the currently stored list;
+  /// called from Insert() when the load factor would exceed one half.
+  void Grow();
 
-  std::vector<HashBucket> buckets_;
+  Elem *list_head_;  // head of currently stored list.
+  Elem *list_tail_;  // tail of currently stored list (we append there, so the
+  // list is in insertion order).
+
+  size_t hash_size_;  // number of hash slots (a power of two, or zero before
+  // the first SetSize()/Insert()).
+  size_t hash_mask_;  // hash_size_ - 1, for wrapping probe indexes.
+  int32 hash_shift_;  // 64 minus log2(hash_size_); see HashOf().
+  size_t num_indexed_;  // number of slots occupied in the current epoch.
+  uint32 cur_epoch_;  // epoch tag that marks slots as occupied; incremented
+  // by Clear(), so clearing does not touch the slots at all.
+
+  std::vector<HashSlot> slots_;
 
   Elem *freed_head_;  // head of list of currently freed elements. [ready for allocation]
 
@@ -0,0 +1,132 @@
+// util/kaldi-daemon-test.cc
+
+// Copyright 2015  Johns Hopkins University (Author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "util/kaldi-daemon.h"
+
+#ifndef _MSC_VER
+
+#include <cstdio>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace kaldi {
+
+// Used as the user_data pointer, to check it arrives in the handler.
+static int g_magic = 12345;
+
+// Test handler: prints its non-program-name arguments to stdout (which the
+// daemon should have connected to the client's stdout) and returns the
+// argument count as the exit status.
+static int TestHandler(int argc, char **argv, void *user_data) {
+  KALDI_ASSERT(user_data == &g_magic);
+  for (int i = 1; i < argc; i++)
+    printf("%s\n", argv[i]);
+  return argc - 1;
+}
+
+// Like RunDaemonClient(), but retries while the server (a freshly forked
+// child) is still starting up.
+static int ClientWithRetry(const std::string &socket_path,
+                           const std::vector<std::string> &args) {
+  for (int attempt = 0; ; attempt++) {
+    try {
+      return RunDaemonClient(socket_path, args);
+    } catch (const std::exception &e) {
+      if (attempt > 50)
+        KALDI_ERR << "Could not reach the test daemon: " << e.what();
+      usleep(100 * 1000);
+    }
+  }
+}
+
+void UnitTestDaemon() {
+  char socket_path[] = "tmpf_daemon_sock_XXXXXX",
+      output_path[] = "tmpf_daemon_out_XXXXXX";
+  // mkstemp is just a convenient way to get fresh names in the current
+  // directory; the socket must not exist when the server binds it.
+  close(mkstemp(socket_path));
+  close(mkstemp(output_path));
+  unlink(socket_path);
+
+  pid_t server_pid = fork();
+  KALDI_ASSERT(server_pid >= 0);
+  if (server_pid == 0) {  // child: run the server until told to stop.
+    int ret = RunDaemonServer(socket_path, &TestHandler, &g_magic);
+    _exit(ret);
+  }
+
+  // Run a request with this process's stdout temporarily pointed at a file,
+  // to check that the handler's output really lands on the client's stdout.
+  std::vector<std::string> args;
+  args.push_back("daemon-test");
+  args.push_back("hello");
+  args.push_back("world");
+  fflush(stdout);
+  int saved_stdout = dup(1),
+      out_fd = open(output_path, O_WRONLY | O_TRUNC, 0600);
+  KALDI_ASSERT(saved_stdout >= 0 && out_fd >= 0);
+  dup2(out_fd, 1);
+  close(out_fd);
+  int status = ClientWithRetry(socket_path, args);
+  fflush(stdout);
+  dup2(saved_stdout, 1);
+  close(saved_stdout);
+  KALDI_ASSERT(status == 2);  // TestHandler returns #args.
+
+  std::ifstream is(output_path);
+  std::string line1, line2;
+  KALDI_ASSERT(std::getline(is, line1) && line1 == "hello");
+  KALDI_ASSERT(std::getline(is, line2) && line2 == "world");
+  is.close();
+
+  // A second request on the same daemon, without output redirection.
+  args.resize(1);
+  for (int i = 0; i < 5; i++) args.push_back("x");
+  KALDI_ASSERT(ClientWithRetry(socket_path, args) == 5);
+
+  // Shut the server down and check it exits cleanly.
+  args.resize(1);
+  args[0] = "--daemon-shutdown";
+  KALDI_ASSERT(ClientWithRetry(socket_path, args) == 0);
+  int wstatus;
+  KALDI_ASSERT(waitpid(server_pid, &wstatus, 0) == server_pid);
+  KALDI_ASSERT(WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0);
+
+  unlink(output_path);
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  UnitTestDaemon();
+  std::cout << "Test OK.\n";
+  return 0;
+}
+
+#else  // _MSC_VER
+
+int main() {
+  // Daemon mode is POSIX-only; nothing to test on Windows.
+  return 0;
+}
+
+#endif  // _MSC_VER
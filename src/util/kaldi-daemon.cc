@@ -0,0 +1,301 @@
+// util/kaldi-daemon.cc
+
+// Copyright 2015  Johns Hopkins University (Author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "util/kaldi-daemon.h"
+
+#include <cstdio>
+#include <cstring>
+
+#ifndef _MSC_VER
+#include <errno.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace kaldi {
+
+#ifndef _MSC_VER
+
+// Sanity limits on what we accept from the socket, so a stray process
+// writing garbage to it cannot make us allocate absurd amounts.
+static const int32 kDaemonMaxArgs = 10000;
+static const int32 kDaemonMaxArgLen = 1 << 20;
+
+// The argument a client sends (on its own) to stop the server.
+static const char *kDaemonShutdownArg = "--daemon-shutdown";
+
+// Writes exactly "count" bytes; returns false on error.
+static bool FullWriteFd(int fd, const void *buf, size_t count) {
+  const char *p = static_cast<const char*>(buf);
+  while (count > 0) {
+    ssize_t ret = write(fd, p, count);
+    if (ret < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    p += ret;
+    count -= ret;
+  }
+  return true;
+}
+
+// Reads exactly "count" bytes; returns false on error or EOF.
+static bool FullReadFd(int fd, void *buf, size_t count) {
+  char *p = static_cast<char*>(buf);
+  while (count > 0) {
+    ssize_t ret = read(fd, p, count);
+    if (ret < 0 && errno == EINTR) continue;
+    if (ret <= 0) return false;
+    p += ret;
+    count -= ret;
+  }
+  return true;
+}
+
+// Sends "num_fds" file descriptors over the connected socket "sock" with
+// SCM_RIGHTS, alongside a single dummy payload byte (some systems refuse
+// to send ancillary data with no payload).
+static bool SendFds(int sock, const int *fds, int num_fds) {
+  char dummy = 'F';
+  struct iovec iov;
+  iov.iov_base = &dummy;
+  iov.iov_len = 1;
+  char control[CMSG_SPACE(3 * sizeof(int))];
+  std::memset(control, 0, sizeof(control));
+  struct msghdr msg;
+  std::memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = CMSG_SPACE(num_fds * sizeof(int));
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(num_fds * sizeof(int));
+  std::memcpy(CMSG_DATA(cmsg), fds, num_fds * sizeof(int));
+  while (true) {
+    ssize_t ret = sendmsg(sock, &msg, 0);
+    if (ret < 0 && errno == EINTR) continue;
+    return ret == 1;
+  }
+}
+
+// Receives "num_fds" file descriptors sent by SendFds().
+static bool RecvFds(int sock, int *fds, int num_fds) {
+  char dummy;
+  struct iovec iov;
+  iov.iov_base = &dummy;
+  iov.iov_len = 1;
+  char control[CMSG_SPACE(3 * sizeof(int))];
+  struct msghdr msg;
+  std::memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  while (true) {
+    ssize_t ret = recvmsg(sock, &msg, 0);
+    if (ret < 0 && errno == EINTR) continue;
+    if (ret != 1) return false;
+    break;
+  }
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  if (cmsg == NULL || cmsg->cmsg_level != SOL_SOCKET ||
+      cmsg->cmsg_type != SCM_RIGHTS ||
+      cmsg->cmsg_len != CMSG_LEN(num_fds * sizeof(int)))
+    return false;
+  std::memcpy(fds, CMSG_DATA(cmsg), num_fds * sizeof(int));
+  return true;
+}
+
+// Reads one request's argument list; returns false (after a warning) if
+// the client sent something malformed.
+static bool ReadArgs(int sock, std::vector<std::string> *args) {
+  int32 num_args;
+  if (!FullReadFd(sock, &num_args, sizeof(num_args))) return false;
+  if (num_args <= 0 || num_args > kDaemonMaxArgs) {
+    KALDI_WARN << "Daemon: client sent implausible argument count "
+               << num_args << "; dropping the connection.";
+    return false;
+  }
+  args->resize(num_args);
+  for (int32 i = 0; i < num_args; i++) {
+    int32 len;
+    if (!FullReadFd(sock, &len, sizeof(len))) return false;
+    if (len < 0 || len > kDaemonMaxArgLen) {
+      KALDI_WARN << "Daemon: client sent implausible argument length "
+                 << len << "; dropping the connection.";
+      return false;
+    }
+    (*args)[i].resize(len);
+    if (len > 0 && !FullReadFd(sock, &((*args)[i][0]), len)) return false;
+  }
+  return true;
+}
+
+// Serves one accepted connection; sets *shutdown if the client asked the
+// server to stop.
+static void ServeRequest(int conn, DaemonHandler handler, void *user_data,
+                         bool *shutdown) {
+  std::vector<std::string> args;
+  int fds[3] = { -1, -1, -1 };
+  if (!ReadArgs(conn, &args) || !RecvFds(conn, fds, 3)) {
+    KALDI_WARN << "Daemon: malformed or interrupted request; ignoring it.";
+    for (int i = 0; i < 3; i++)
+      if (fds[i] >= 0) close(fds[i]);
+    return;
+  }
+  int32 status;
+  if (args.size() == 1 && args[0] == kDaemonShutdownArg) {
+    *shutdown = true;
+    status = 0;
+  } else {
+    pid_t pid = fork();
+    if (pid < 0) {
+      KALDI_WARN << "Daemon: fork() failed: " << strerror(errno);
+      status = -1;
+    } else if (pid == 0) {  // child: become the client, run the handler.
+      for (int i = 0; i < 3; i++) {
+        dup2(fds[i], i);
+        close(fds[i]);
+      }
+      close(conn);
+      std::vector<char*> argv(args.size() + 1, static_cast<char*>(NULL));
+      for (size_t i = 0; i < args.size(); i++)
+        argv[i] = const_cast<char*>(args[i].c_str());
+      int ret = (*handler)(static_cast<int>(args.size()), &(argv[0]),
+                           user_data);
+      fflush(stdout);
+      _exit(ret & 0xFF);
+    } else {  // parent: wait for the child and relay its exit status.
+      int wstatus;
+      while (waitpid(pid, &wstatus, 0) < 0 && errno == EINTR);
+      if (WIFEXITED(wstatus)) status = WEXITSTATUS(wstatus);
+      else status = 128 + WTERMSIG(wstatus);  // died on a signal.
+    }
+  }
+  for (int i = 0; i < 3; i++)
+    close(fds[i]);
+  if (!FullWriteFd(conn, &status, sizeof(status)))
+    KALDI_WARN << "Daemon: client went away before we could report status.";
+}
+
+int RunDaemonServer(const std::string &socket_path, DaemonHandler handler,
+                    void *user_data) {
+  // A client that disconnects early would otherwise kill us with SIGPIPE
+  // when we write the status back.
+  signal(SIGPIPE, SIG_IGN);
+  int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listen_fd < 0)
+    KALDI_ERR << "Daemon: socket() failed: " << strerror(errno);
+  struct sockaddr_un addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (socket_path.size() >= sizeof(addr.sun_path))
+    KALDI_ERR << "Daemon: socket path too long: " << socket_path;
+  std::strcpy(addr.sun_path, socket_path.c_str());
+  unlink(socket_path.c_str());  // remove any stale socket.
+  if (bind(listen_fd, reinterpret_cast<struct sockaddr*>(&addr),
+           sizeof(addr)) < 0)
+    KALDI_ERR << "Daemon: could not bind socket " << socket_path << ": "
+              << strerror(errno);
+  // The daemon executes arbitrary requests with this user's permissions,
+  // so don't let other users talk to it.
+  chmod(socket_path.c_str(), 0600);
+  if (listen(listen_fd, 8) < 0)
+    KALDI_ERR << "Daemon: listen() failed on " << socket_path << ": "
+              << strerror(errno);
+  KALDI_LOG << "Daemon: serving requests on " << socket_path;
+  int32 num_requests = 0;
+  bool shutdown = false;
+  while (!shutdown) {
+    int conn = accept(listen_fd, NULL, NULL);
+    if (conn < 0) {
+      if (errno == EINTR) continue;
+      KALDI_WARN << "Daemon: accept() failed: " << strerror(errno);
+      break;
+    }
+    ServeRequest(conn, handler, user_data, &shutdown);
+    close(conn);
+    num_requests++;
+  }
+  close(listen_fd);
+  unlink(socket_path.c_str());
+  KALDI_LOG << "Daemon: exiting after serving " << num_requests
+            << " requests.";
+  return 0;
+}
+
+int RunDaemonClient(const std::string &socket_path,
+                    const std::vector<std::string> &args) {
+  int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (sock < 0)
+    KALDI_ERR << "Daemon client: socket() failed: " << strerror(errno);
+  struct sockaddr_un addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (socket_path.size() >= sizeof(addr.sun_path))
+    KALDI_ERR << "Daemon client: socket path too long: " << socket_path;
+  std::strcpy(addr.sun_path, socket_path.c_str());
+  if (connect(sock, reinterpret_cast<struct sockaddr*>(&addr),
+              sizeof(addr)) < 0) {
+    close(sock);
+    KALDI_ERR << "Daemon client: could not connect to " << socket_path
+              << ": " << strerror(errno) << " (is the daemon running?)";
+  }
+  bool ok = true;
+  int32 num_args = static_cast<int32>(args.size());
+  ok = ok && FullWriteFd(sock, &num_args, sizeof(num_args));
+  for (int32 i = 0; ok && i < num_args; i++) {
+    int32 len = static_cast<int32>(args[i].size());
+    ok = FullWriteFd(sock, &len, sizeof(len)) &&
+        (len == 0 || FullWriteFd(sock, args[i].data(), len));
+  }
+  int fds[3] = { 0, 1, 2 };
+  ok = ok && SendFds(sock, fds, 3);
+  int32 status;
+  ok = ok && FullReadFd(sock, &status, sizeof(status));
+  close(sock);
+  if (!ok)
+    KALDI_ERR << "Daemon client: the connection to " << socket_path
+              << " broke before the request finished.";
+  return status;
+}
+
+#else  // _MSC_VER
+
+int RunDaemonServer(const std::string &socket_path, DaemonHandler handler,
+                    void *user_data) {
+  KALDI_ERR << "Daemon mode is not supported on Windows.";
+  return -1;
+}
+
+int RunDaemonClient(const std::string &socket_path,
+                    const std::vector<std::string> &args) {
+  KALDI_ERR << "Daemon mode is not supported on Windows.";
+  return -1;
+}
+
+#endif  // _MSC_VER
+
+}  // namespace kaldi
@@ -0,0 +1,90 @@
+// util/kaldi-daemon.h
+
+// Copyright 2015  Johns Hopkins University (Author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_UTIL_KALDI_DAEMON_H_
+#define KALDI_UTIL_KALDI_DAEMON_H_
+
+#include <string>
+#include <vector>
+
+#include "base/kaldi-common.h"
+
+namespace kaldi {
+
+/**
+   This header supports running a Kaldi binary as a daemon: the process
+   does its expensive one-time setup (parsing options, reading models)
+   once, then serves its per-request work repeatedly over a Unix-domain
+   socket.  For short jobs (e.g. computing likelihoods for a single
+   utterance) process startup plus model reading dominates the runtime,
+   and pipelines that launch many such jobs can instead keep one daemon
+   per machine and run a lightweight client per job.
+
+   For each request the client sends its argument list together with its
+   own stdin/stdout/stderr file descriptors (passed over the socket with
+   SCM_RIGHTS).  The server forks a child which takes over those
+   descriptors and runs the binary's handler function, so rspecifiers
+   and wspecifiers involving "-" and all logging behave exactly as if
+   the binary had been run directly; the child's exit status is relayed
+   back and the client exits with it, so scripts' error handling keeps
+   working.  Forking also means a crash in the handler cannot take the
+   daemon down, and the models read at startup are shared with the
+   children by the kernel (copy-on-write), not copied.
+
+   A binary opts in by adding a --daemon-socket option and splitting its
+   per-request work out of main(); see gmmbin/gmm-compute-likes.cc for a
+   worked example.  The generic client is the kaldi-daemon-client
+   binary; scripts can stay unchanged by symlinking the binary's name to
+   kaldi-daemon-client and setting KALDI_DAEMON_SOCKET in the
+   environment.
+
+   This is POSIX-only; on Windows these calls throw.
+*/
+
+
+/// Type of the per-request handler run (in a forked child) by
+/// RunDaemonServer(), one call per client request.  "argc"/"argv" are
+/// the client's arguments, with argv[0] a program name, so the handler
+/// can parse them with an ordinary ParseOptions; "user_data" is the
+/// pointer given to RunDaemonServer(), typically the models read at
+/// startup.  The return value becomes the client's exit status.  The
+/// handler should catch its own exceptions and return nonzero rather
+/// than throw.
+typedef int (*DaemonHandler)(int argc, char **argv, void *user_data);
+
+/// Runs the server loop: listens on a Unix-domain socket at
+/// "socket_path" (an ordinary filesystem path; any stale socket there
+/// is removed first, and the socket is made accessible only to the
+/// current user), and serves requests one at a time until a client
+/// sends the single argument "--daemon-shutdown", at which point the
+/// socket is removed and this returns 0.  Throws if the socket cannot
+/// be set up.
+int RunDaemonServer(const std::string &socket_path, DaemonHandler handler,
+                    void *user_data);
+
+/// Client side: connects to the daemon at "socket_path", sends "args"
+/// (args[0] should be a program name) and this process's
+/// stdin/stdout/stderr, waits for the request to finish and returns its
+/// exit status.  Throws if it cannot connect or the connection breaks.
+int RunDaemonClient(const std::string &socket_path,
+                    const std::vector<std::string> &args);
+
+}  // namespace kaldi
+
+#endif  // KALDI_UTIL_KALDI_DAEMON_H_
@@ -22,6 +22,7 @@
 #define KALDI_UTIL_KALDI_HOLDER_INL_H_
 
 #include <algorithm>
+#include <cstring>
 #include "util/kaldi-io.h"
 #include "util/text-utils.h"
 #include "matrix/kaldi-matrix.h"
@@ -40,7 +41,7 @@ template<class KaldiType> class KaldiObjectHolder {
  public:
   typedef KaldiType T;
 
-  KaldiObjectHolder(): t_(NULL) { }
+  KaldiObjectHolder(): t_(NULL), recycled_(NULL) { }
 
   static bool Write(std::ostream &os, bool binary, const T &t) {
     InitKaldiOutputStream(os, binary);  // Puts binary header if binary mode.
@@ -56,7 +57,13 @@ template<class KaldiType> class KaldiObjectHolder {
 
   void Clear() {
     if (t_) {
-      delete t_;
+      // We don't delete the object but keep it around for the next Read()
+      // to reuse its storage; in a sequential scan of, say, a feature
+      // archive this eliminates an allocation (and often a matrix-sized
+      // malloc) per record.  The object is freed when the holder is, or
+      // overwritten by the next record.
+      delete recycled_;
+      recycled_ = t_;
       t_ = NULL;
     }
   }
@@ -64,8 +71,17 @@ template<class KaldiType> class KaldiObjectHolder {
   // Reads into the holder.
   bool Read(std::istream &is) {
     delete t_;
-    t_ = new T;
-    // Don't want any existing state to complicate the read functioN: get new object.
+    if (recycled_ != NULL) {
+      // Reuse the storage of a previously held (or Recycle()d) object.
+      // This is safe because the Read functions of Kaldi objects
+      // completely overwrite any existing contents, and matrix/vector
+      // types resize in place-- a no-op when the shape matches the
+      // incoming record, which is the common case for features.
+      t_ = recycled_;
+      recycled_ = NULL;
+    } else {
+      t_ = new T;
+    }
     bool is_binary;
     if (!InitKaldiInputStream(is, &is_binary)) {
       KALDI_WARN << "Reading Table object, failed reading binary header\n";
@@ -87,16 +103,42 @@ template<class KaldiType> class KaldiObjectHolder {
   // reading.
   static bool IsReadInBinary() { return true; }
 
-  const T &Value() const {
+  // Value() is non-const for the benefit of callers that want to
+  // destructively obtain the contents, e.g. by swapping them out (this avoids
+  // copying the object, which may be large).
+  T &Value() {
     // code error if !t_.
     if (!t_) KALDI_ERR << "KaldiObjectHolder::Value() called wrongly.";
     return *t_;
   }
 
-  ~KaldiObjectHolder() { delete t_; }
+  // Releases ownership of the held object to the caller (who must delete
+  // it), leaving the holder empty; this is for consumers that want to keep
+  // the object without copying it.  (Callers that only want the contents
+  // can instead Swap() them out of Value(), which is the older idiom.)
+  T *Release() {
+    if (!t_) KALDI_ERR << "KaldiObjectHolder::Release() called wrongly.";
+    T *ans = t_;
+    t_ = NULL;
+    return ans;
+  }
+
+  // Hands the holder an object, e.g. one obtained earlier via Release(),
+  // whose storage the next Read() will reuse instead of allocating afresh;
+  // takes ownership, and the contents are destroyed.
+  void Recycle(T *t) {
+    delete recycled_;
+    recycled_ = t;
+  }
+
+  ~KaldiObjectHolder() {
+    delete t_;
+    delete recycled_;
+  }
  private:
   KALDI_DISALLOW_COPY_AND_ASSIGN(KaldiObjectHolder);
   T *t_;
+  T *recycled_;  // an object kept for the next Read() to reuse, or NULL.
 };
 
 
@@ -171,7 +213,7 @@ template<class BasicType> class BasicHolder {
   // open in binary mode for reading.
   static bool IsReadInBinary() { return true; }
 
-  const T &Value() const {
+  T &Value() {
     return t_;
   }
 
@@ -241,6 +283,12 @@ template<class BasicType> class BasicVectorHolder {
         KALDI_WARN << "BasicVectorHolder::Read, error reading line " << (is.eof() ? "[eof]" : "");
         return false;  // probably eof.  fail in any case.
       }
+      // Fast path: a line of whitespace-separated integers (e.g. an
+      // alignment), parsed in one pass; anything else (floats, junk)
+      // falls through to the general code below.
+      if (ConvertLineToIntegers(line, &t_))
+        return true;
+      t_.clear();
       std::istringstream line_is(line);
       try {
         while (1) {
@@ -262,10 +310,41 @@ template<class BasicType> class BasicVectorHolder {
         int32 size;
         ReadBasicType(is, true, &size);
         t_.resize(size);
-        for (typename std::vector<BasicType>::iterator iter = t_.begin();
-            iter != t_.end();
-            ++iter) {
-          ReadBasicType(is, true, &(*iter));
+        if (size > 0) {
+          // On disk each element is a one-byte type marker followed by the
+          // raw value.  We read the first element with ReadBasicType(),
+          // which validates the marker, then slurp the rest in one bulk
+          // read and just check that the marker repeats-- much faster than
+          // two stream reads per element.  (bool is stored differently,
+          // and a float vector may contain double-marked elements; those
+          // cases take the element-by-element loop below.)
+          char expected_marker = static_cast<char>(
+              (std::numeric_limits<BasicType>::is_integer ?
+               (std::numeric_limits<BasicType>::is_signed ? 1 : -1) : 1) *
+              static_cast<int>(sizeof(BasicType)));
+          if (static_cast<char>(is.peek()) == expected_marker) {
+            ReadBasicType(is, true, &(t_[0]));
+            if (size > 1) {
+              std::vector<char> buf(static_cast<size_t>(size - 1) *
+                                    (1 + sizeof(BasicType)));
+              is.read(&(buf[0]), buf.size());
+              if (is.fail())
+                throw std::runtime_error("did not read enough data.");
+              const char *src = &(buf[0]);
+              for (int32 i = 1; i < size; i++) {
+                if (*src != expected_marker)
+                  throw std::runtime_error("unexpected type marker.");
+                memcpy(&(t_[i]), src + 1, sizeof(BasicType));
+                src += 1 + sizeof(BasicType);
+              }
+            }
+          } else {
+            for (typename std::vector<BasicType>::iterator iter = t_.begin();
+                iter != t_.end();
+                ++iter) {
+              ReadBasicType(is, true, &(*iter));
+            }
+          }
         }
         return true;
       } catch (...) {
@@ -279,7 +358,7 @@ template<class BasicType> class BasicVectorHolder {
   // open in binary mode for reading.
   static bool IsReadInBinary() { return true; }
 
-  const T &Value() const {  return t_; }
+  T &Value() {  return t_; }
 
   ~BasicVectorHolder() { }
  private:
@@ -411,7 +490,7 @@ template<class BasicType> class BasicVectorVectorHolder {
   // open in binary mode for reading.
   static bool IsReadInBinary() { return true; }
 
-  const T &Value() const {  return t_; }
+  T &Value() {  return t_; }
 
   ~BasicVectorVectorHolder() { }
  private:
@@ -545,7 +624,7 @@ template<class BasicType> class BasicPairVectorHolder {
   // open in binary mode for reading.
   static bool IsReadInBinary() { return true; }
 
-  const T &Value() const {  return t_; }
+  T &Value() {  return t_; }
 
   ~BasicPairVectorHolder() { }
  private:
@@ -593,7 +672,7 @@ class TokenHolder {
   // fine either way, but doing it this way will exercise more of the code).
   static bool IsReadInBinary() { return false; }
 
-  const T &Value() const { return t_; }
+  T &Value() { return t_; }
 
   ~TokenHolder() { }
  private:
@@ -635,8 +714,7 @@ class TokenVectorHolder {
       KALDI_WARN << "BasicVectorHolder::Read, error reading line " << (is.eof() ? "[eof]" : "");
       return false;  // probably eof.  fail in any case.
     }
-    const char *white_chars = " \t\n\r\f\v";
-    SplitStringToVector(line, white_chars, true, &t_);  // true== omit empty strings e.g.
+    SplitStringOnWhitespace(line, &t_);  // omits empty strings, e.g.
     // between spaces.
     return true;
   }
@@ -645,7 +723,7 @@ class TokenVectorHolder {
   // it would work either way since we ignore the extra '\r'.
   static bool IsReadInBinary() { return false; }
 
-  const T &Value() const { return t_; }
+  T &Value() { return t_; }
 
  private:
   KALDI_DISALLOW_COPY_AND_ASSIGN(TokenVectorHolder);
@@ -683,7 +761,7 @@ class HtkMatrixHolder {
   // HTK-format matrices only read in binary.
   static bool IsReadInBinary() { return true; }
 
-  const T &Value() const { return t_; }
+  T &Value() { return t_; }
 
 
   // No destructor.
@@ -783,7 +861,7 @@ template<int kFeatDim> class SphinxMatrixHolder {
   // Only read in binary
   static bool IsReadInBinary() { return true; }
 
-  const T &Value() const { return feats_; }
+  T &Value() { return feats_; }
 
  private:
   KALDI_DISALLOW_COPY_AND_ASSIGN(SphinxMatrixHolder);
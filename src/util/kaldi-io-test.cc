@@ -42,6 +42,10 @@ void UnitTestClassifyRxfilename() {
   KALDI_ASSERT(ClassifyRxfilename("a b c:3") == kOffsetFileInput);
   KALDI_ASSERT(ClassifyRxfilename("a b c:") == kFileInput);
   KALDI_ASSERT(ClassifyRxfilename("a b c/3") == kFileInput);
+  KALDI_ASSERT(ClassifyRxfilename("a.blz") == kBlockCompressedInput);
+  KALDI_ASSERT(ClassifyRxfilename("a.blz:123") == kBlockCompressedInput);
+  KALDI_ASSERT(ClassifyRxfilename("ablz:123") == kOffsetFileInput);
+  KALDI_ASSERT(ClassifyRxfilename("a.blz:") == kFileInput);
 }
 
 
@@ -59,6 +63,8 @@ void UnitTestClassifyWxfilename() {
   KALDI_ASSERT(ClassifyWxfilename("a b c:3") == kNoOutput);
   KALDI_ASSERT(ClassifyWxfilename("a b c:") == kFileOutput);
   KALDI_ASSERT(ClassifyWxfilename("a b c/3") == kFileOutput);
+  KALDI_ASSERT(ClassifyWxfilename("a.blz") == kBlockCompressedOutput);
+  KALDI_ASSERT(ClassifyWxfilename("a.blz:123") == kNoOutput);
 }
 
 void UnitTestIoNew(bool binary) {
@@ -18,10 +18,17 @@
 // limitations under the License.
 #include "util/kaldi-io.h"
 #include "base/kaldi-math.h"
+#include "util/block-compressed-io.h"
 #include "util/text-utils.h"
 #include "util/parse-options.h"
 #include <cstdlib>
 #include <errno.h>
+#include <list>
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#endif
 
 #include "util/kaldi-pipebuf.h"
 
@@ -75,6 +82,13 @@ std::string PrintableWxfilename(std::string wxfilename) {
 }
 
 
+// Returns true if the first "length" characters of "filename" end in
+// ".blz", the extension of the block-compressed format of
+// util/block-compressed-io.h.
+static bool HasBlockCompressedSuffix(const char *filename, size_t length) {
+  return (length >= 4 && strncmp(filename + length - 4, ".blz", 4) == 0);
+}
+
 OutputType ClassifyWxfilename(const std::string &filename) {
   const char *c = filename.c_str();
   if (*c == '\0' || (*c == '-' && c[1] == '\0')) return kStandardOutput;  // "" or "-".
@@ -109,6 +123,9 @@ OutputType ClassifyWxfilename(const std::string &filename) {
         KALDI_WARN << "Trying to classify wxfilename with pipe symbol in the wrong place (pipe without | at the beginning?): " << filename;
         return kNoOutput;
       }
+      if (HasBlockCompressedSuffix(c, filename.length()))
+        return kBlockCompressedOutput;  // a filename like foo.ark.blz: write
+      // it in the seekable block-compressed format.
       return kFileOutput;  // matched no other pattern: assume it's an actual filename.
     }
   }
@@ -137,7 +154,11 @@ InputType ClassifyRxfilename(const std::string &filename) {
       // OK, it could be an offset into a file
       // which is not allowed.
       while (isdigit(*d) && d > c) d--;
-      if (*d == ':') return kOffsetFileInput;  // Filename is like some_file:12345
+      if (*d == ':') {  // Filename is like some_file:12345
+        if (HasBlockCompressedSuffix(c, d - c))  // some_file.blz:12345: an
+          return kBlockCompressedInput;  // offset into a compressed file.
+        return kOffsetFileInput;
+      }
       else return kFileInput;
     } else {
       // at this point it matched no other pattern so we assume a filename, but we
@@ -147,6 +168,8 @@ InputType ClassifyRxfilename(const std::string &filename) {
         KALDI_WARN << "Trying to classify rxfilename with pipe symbol in the wrong place (pipe without | at the end?): " << filename;
         return kNoInput;
       }
+      if (HasBlockCompressedSuffix(c, filename.length()))
+        return kBlockCompressedInput;  // a block-compressed file like foo.ark.blz.
       return kFileInput;  // matched no other pattern: assume it's an actual filename.
     }
   }
@@ -315,6 +338,47 @@ class PipeOutputImpl: public OutputImplBase {
 };
 
 
+class BlockCompressedOutputImpl: public OutputImplBase {
+ public:
+  BlockCompressedOutputImpl(): os_(&buf_) { }
+
+  virtual bool Open(const std::string &filename, bool binary) {
+    if (buf_.IsOpen()) KALDI_ERR << "BlockCompressedOutputImpl::Open(), "
+                                 << "open called on already open file.";
+    // The file itself is always binary (it holds compressed blocks); the
+    // "binary" argument only describes what the caller writes into the
+    // uncompressed stream, which we store verbatim.
+    filename_ = filename;
+    return buf_.Open(MapOsPath(filename_));
+  }
+
+  virtual std::ostream &Stream() {
+    if (!buf_.IsOpen())
+      KALDI_ERR << "BlockCompressedOutputImpl::Stream(), file is not open.";
+    // I believe this error can only arise from coding error.
+    return os_;
+  }
+
+  virtual bool Close() {
+    if (!buf_.IsOpen())
+      KALDI_ERR << "BlockCompressedOutputImpl::Close(), file is not open.";
+    // I believe this error can only arise from coding error.
+    bool ok = buf_.Close();
+    return ok && !os_.fail();
+  }
+  virtual ~BlockCompressedOutputImpl() {
+    if (buf_.IsOpen()) {
+      if (!Close())
+        KALDI_ERR << "Error closing block-compressed output file "
+                  << filename_;
+    }
+  }
+ private:
+  std::string filename_;
+  BlockCompressedOutputBuffer buf_;
+  std::ostream os_;
+};
+
 
 class InputImplBase {
  public:
@@ -501,6 +565,167 @@ class PipeInputImpl: public InputImplBase {
 #endif
 */
 
+// A process-wide cache of open file handles for offset rxfilenames like
+// /my/file.ark:12345 (the kind that .scp files point into), so that Table
+// lookups landing in the same archive seek within an already-open stream
+// instead of paying an open/close per key, even when they come through
+// different Input objects; see SetFileHandleCacheSize() in kaldi-io.h.
+// A handle is either checked out by exactly one OffsetFileInputImpl or
+// sitting in the LRU list, never both, so only Acquire/Release need the
+// lock, not the actual reads.  (On Windows there is no locking, as we
+// don't use pthreads there; the cache is only safe single-threaded.)
+class FileHandleCache {
+ public:
+  struct Handle {
+    std::string filename;  // the actual filename, without the offset.
+    bool binary;           // mode the stream was opened in.
+    std::ifstream is;
+    int fd;  // descriptor on the same file, used only to pass read-ahead
+             // hints to the kernel; -1 if unavailable.
+    ~Handle() {
+#ifndef _MSC_VER
+      if (fd != -1) close(fd);
+#endif
+    }
+  };
+
+  static FileHandleCache *Instance() {
+    static FileHandleCache cache;
+    return &cache;
+  }
+
+  // Returns an open handle for the file, reusing a cached one when
+  // possible, or NULL if the file cannot be opened.  The caller owns the
+  // handle until it calls Release() on it (or deletes it, if the stream
+  // got into a bad state and should not be reused).
+  Handle *Acquire(const std::string &filename, bool binary) {
+    Lock();
+    for (std::list<Handle*>::iterator iter = lru_.begin();
+         iter != lru_.end(); ++iter) {
+      if ((*iter)->filename == filename && (*iter)->binary == binary) {
+        Handle *handle = *iter;
+        lru_.erase(iter);
+        Unlock();
+        handle->is.clear();  // clear eof/fail bits left by the last user.
+        return handle;
+      }
+    }
+    Unlock();
+    Handle *handle = new Handle();
+    handle->filename = filename;
+    handle->binary = binary;
+    handle->fd = -1;
+    handle->is.open(MapOsPath(filename).c_str(),
+                    binary ? std::ios_base::in | std::ios_base::binary
+                           : std::ios_base::in);
+    if (!handle->is.is_open()) {
+      delete handle;
+      return NULL;
+    }
+#if !defined(_MSC_VER) && defined(POSIX_FADV_WILLNEED)
+    handle->fd = open(MapOsPath(filename).c_str(), O_RDONLY);
+#endif
+    return handle;
+  }
+
+  // Returns a handle obtained from Acquire() to the cache for reuse,
+  // evicting the least recently used handle if the cache is over size (or
+  // just closes it, if the cache is disabled).
+  void Release(Handle *handle) {
+    Handle *evicted = handle;
+    Lock();
+    if (size_ > 0) {
+      lru_.push_front(handle);
+      evicted = NULL;
+      if (static_cast<int32>(lru_.size()) > size_) {
+        evicted = lru_.back();
+        lru_.pop_back();
+      }
+    }
+    Unlock();
+    delete evicted;  // harmless if NULL.
+  }
+
+  // Drops any cached handles on "filename"; called when the file is opened
+  // for writing, so that a later read does not see stale buffered data
+  // from before the rewrite.  (Handles that are currently checked out are
+  // unaffected, as before this cache existed; and a rewrite by a
+  // *different* process can likewise not be detected.)
+  void Invalidate(const std::string &filename) {
+    std::vector<Handle*> to_close;
+    Lock();
+    for (std::list<Handle*>::iterator iter = lru_.begin();
+         iter != lru_.end(); ) {
+      if ((*iter)->filename == filename) {
+        to_close.push_back(*iter);
+        iter = lru_.erase(iter);
+      } else {
+        ++iter;
+      }
+    }
+    Unlock();
+    for (size_t i = 0; i < to_close.size(); i++)
+      delete to_close[i];
+  }
+
+  void SetSize(int32 size) {
+    KALDI_ASSERT(size >= 0);
+    std::vector<Handle*> to_close;
+    Lock();
+    size_ = size;
+    while (static_cast<int32>(lru_.size()) > size_) {
+      to_close.push_back(lru_.back());
+      lru_.pop_back();
+    }
+    Unlock();
+    for (size_t i = 0; i < to_close.size(); i++)
+      delete to_close[i];
+  }
+
+  // Advises the kernel that we are about to read sequentially starting
+  // from "offset" in the file the handle refers to; a no-op where
+  // posix_fadvise is not available.
+  static void ReadAheadHint(Handle *handle, size_t offset) {
+#if !defined(_MSC_VER) && defined(POSIX_FADV_WILLNEED)
+    static const size_t kReadAheadBytes = 1048576;  // 1MB.
+    if (handle->fd != -1)
+      posix_fadvise(handle->fd, offset, kReadAheadBytes,
+                    POSIX_FADV_WILLNEED);
+#endif
+  }
+
+ private:
+  FileHandleCache(): size_(32) {
+#ifndef _MSC_VER
+    pthread_mutex_init(&mutex_, NULL);
+#endif
+  }
+  ~FileHandleCache() { }  // cached streams are left to the OS at exit.
+
+  inline void Lock() {
+#ifndef _MSC_VER
+    pthread_mutex_lock(&mutex_);
+#endif
+  }
+  inline void Unlock() {
+#ifndef _MSC_VER
+    pthread_mutex_unlock(&mutex_);
+#endif
+  }
+
+  int32 size_;  // maximum number of cached (i.e. not checked out) handles.
+  std::list<Handle*> lru_;  // most recently released first.
+#ifndef _MSC_VER
+  pthread_mutex_t mutex_;
+#endif
+  KALDI_DISALLOW_COPY_AND_ASSIGN(FileHandleCache);
+};
+
+void SetFileHandleCacheSize(int32 num_handles) {
+  FileHandleCache::Instance()->SetSize(num_handles);
+}
+
+
 class OffsetFileInputImpl: public InputImplBase {
   // This class is a bit more complicated than the
 
@@ -523,85 +748,170 @@ class OffsetFileInputImpl: public InputImplBase {
                 << " byte offset into a file; you'll have to compile 64-bit.";
   }
 
+  OffsetFileInputImpl(): handle_(NULL) { }
+
   bool Seek(size_t offset) {
-    size_t cur_pos = is_.tellg();
+    std::ifstream &is = handle_->is;
+    size_t cur_pos = is.tellg();
     if (cur_pos == offset) return true;
     else if (cur_pos<offset && cur_pos+100 > offset) {
       // We're close enough that it may be faster to just
       // read that data, rather than seek.
       for (size_t i = cur_pos; i < offset; i++)
-        is_.get();
-      return (is_.tellg() == std::streampos(offset));
+        is.get();
+      return (is.tellg() == std::streampos(offset));
     }
     // Try to actually seek.
-    is_.seekg(offset, std::ios_base::beg);
-    if (is_.fail()) {  // failbit or badbit is set [error happened]
-      is_.close();
+    is.seekg(offset, std::ios_base::beg);
+    if (is.fail()) {  // failbit or badbit is set [error happened]
+      // The stream is in a bad state, so don't return the handle to the
+      // cache for reuse; just close it.
+      delete handle_;
+      handle_ = NULL;
       return false;  // failure.
     } else {
-      is_.clear();  // Clear any failure bits (e.g. eof).
+      is.clear();  // Clear any failure bits (e.g. eof).
       return true;  // success.
     }
   }
 
   // This Open routine is unusual in that it is designed to work even
   // if it was already open.  This for efficiency when seeking multiple
-  // times.
+  // times.  The underlying file handles come from the process-wide
+  // FileHandleCache, so the open file can also be reused across Input
+  // objects (e.g. across Table lookups into the same archive).
   virtual bool Open(const std::string &rxfilename, bool binary) {
-    if (is_.is_open()) {
+    std::string tmp_filename;
+    size_t offset;
+    SplitFilename(rxfilename, &tmp_filename, &offset);
+    if (handle_ != NULL) {
       // We are opening when we have an already-open file.
-      // We may have to seek within this file, or else close it and
-      // open a different one.
-      std::string tmp_filename;
-      size_t offset;
-      SplitFilename(rxfilename, &tmp_filename, &offset);
-      if (tmp_filename == filename_ && binary == binary_) {  // Just seek
-        is_.clear();  // clear fail bit, etc.
-        return Seek(offset);
+      // We may have to seek within this file, or else release it and
+      // get a handle on a different one.
+      if (tmp_filename == handle_->filename && binary == handle_->binary) {
+        handle_->is.clear();  // clear fail bit, etc.
       } else {
-        is_.close();  // don't bother checking error status of is_.
-        filename_ = tmp_filename;
-        is_.open(MapOsPath(filename_).c_str(),
-                 binary ? std::ios_base::in | std::ios_base::binary
-                        : std::ios_base::in);
-        if (!is_.is_open()) return false;
-        else return Seek(offset);
+        FileHandleCache::Instance()->Release(handle_);
+        handle_ = FileHandleCache::Instance()->Acquire(tmp_filename, binary);
+        if (handle_ == NULL) return false;
       }
     } else {
-      size_t offset;
-      SplitFilename(rxfilename, &filename_, &offset);
-      binary_ = binary;
-      is_.open(MapOsPath(filename_).c_str(),
-                binary ? std::ios_base::in | std::ios_base::binary
-                      : std::ios_base::in);
-      if (!is_.is_open()) return false;
-      else return Seek(offset);
+      handle_ = FileHandleCache::Instance()->Acquire(tmp_filename, binary);
+      if (handle_ == NULL) return false;
     }
+    FileHandleCache::ReadAheadHint(handle_, offset);
+    return Seek(offset);
   }
 
   virtual std::istream &Stream() {
-    if (!is_.is_open()) KALDI_ERR << "FileInputImpl::Stream(), file is not open.";
+    if (handle_ == NULL) KALDI_ERR << "FileInputImpl::Stream(), file is not open.";
     // I believe this error can only arise from coding error.
-    return is_;
+    return handle_->is;
   }
 
   virtual void Close() {
-    if (!is_.is_open()) KALDI_ERR << "FileInputImpl::Close(), file is not open.";
+    if (handle_ == NULL) KALDI_ERR << "FileInputImpl::Close(), file is not open.";
     // I believe this error can only arise from coding error.
-    is_.close();
+    FileHandleCache::Instance()->Release(handle_);
+    handle_ = NULL;
     // Don't check status.
   }
 
   virtual InputType MyType() { return kOffsetFileInput; }
 
   virtual ~OffsetFileInputImpl() {
-    // Stream will automatically be closed, and we don't care about
+    if (handle_ != NULL)
+      FileHandleCache::Instance()->Release(handle_);
+  }
+ private:
+  FileHandleCache::Handle *handle_;  // checked out from the cache; NULL if
+                                     // not open.
+};
+
+
+class BlockCompressedInputImpl: public InputImplBase {
+  // Reads files written in the block-compressed format of
+  // util/block-compressed-io.h, with or without an offset (into the
+  // uncompressed stream) appended as in /my/file.blz:12345.  Like
+  // OffsetFileInputImpl, Open may be called on an already-open object so
+  // that reading several offsets into the same archive just seeks (which
+  // here means decompressing at most one block) instead of re-reading the
+  // block index.
+ public:
+  BlockCompressedInputImpl(): is_(&buf_) { }
+
+  // Splits an rxfilename like /my/file.blz:123 into /my/file.blz and the
+  // number 123; the offset is 0 if there is none.
+  static void SplitFilename(const std::string &rxfilename,
+                            std::string *filename,
+                            size_t *offset) {
+    size_t len = rxfilename.length();
+    if (len >= 4 && rxfilename.compare(len - 4, 4, ".blz") == 0) {
+      *filename = rxfilename;
+      *offset = 0;
+      return;
+    }
+    size_t pos = rxfilename.find_last_of(':');
+    KALDI_ASSERT(pos != std::string::npos);  // would indicate error in calling
+    // code, as the filename is supposed to be of the correct form at this
+    // point.
+    *filename = std::string(rxfilename, 0, pos);
+    std::string number(rxfilename, pos+1);
+    if (!ConvertStringToInteger(number, offset))
+      KALDI_ERR << "Cannot get offset from filename " << rxfilename
+                << " (possibly you compiled in 32-bit and have a >32-bit"
+                << " byte offset into a file; you'll have to compile 64-bit.";
+  }
+
+  // As for OffsetFileInputImpl, this Open routine is designed to work even
+  // if the object was already open, for efficiency when seeking multiple
+  // times.  The "binary" argument is ignored: the uncompressed stream is
+  // returned verbatim.
+  virtual bool Open(const std::string &rxfilename, bool binary) {
+    std::string filename;
+    size_t offset;
+    SplitFilename(rxfilename, &filename, &offset);
+    if (buf_.IsOpen()) {
+      if (filename == filename_) {  // Just seek.
+        is_.clear();  // clear fail bit, etc.
+        is_.seekg(offset, std::ios_base::beg);
+        return !is_.fail();
+      }
+      buf_.Close();
+    }
+    filename_ = filename;
+    if (!buf_.Open(MapOsPath(filename_)))
+      return false;
+    is_.clear();
+    is_.seekg(offset, std::ios_base::beg);
+    return !is_.fail();
+  }
+
+  virtual std::istream &Stream() {
+    if (!buf_.IsOpen())
+      KALDI_ERR << "BlockCompressedInputImpl::Stream(), file is not open.";
+    // I believe this error can only arise from coding error.
+    return is_;
+  }
+
+  virtual void Close() {
+    if (!buf_.IsOpen())
+      KALDI_ERR << "BlockCompressedInputImpl::Close(), file is not open.";
+    // I believe this error can only arise from coding error.
+    buf_.Close();
+    // Don't check status.
+  }
+
+  virtual InputType MyType() { return kBlockCompressedInput; }
+
+  virtual ~BlockCompressedInputImpl() {
+    // The file will automatically be closed, and we don't care about
     // whether it fails.
   }
  private:
-  std::string filename_;  // the actual filename
-  bool binary_;  // true if was opened in binary mode.
-  std::ifstream is_;
+  std::string filename_;  // the actual filename, without any offset.
+  BlockCompressedInputBuffer buf_;
+  std::istream is_;
 };
 
 
@@ -659,11 +969,16 @@ bool Output::Open(const std::string &wxfn, bool binary, bool header) {
   KALDI_ASSERT(impl_ == NULL);
 
   if (type ==  kFileOutput) {
+    // We may be rewriting a file that the handle cache has open for
+    // reading; drop any such handles so later reads see the new contents.
+    FileHandleCache::Instance()->Invalidate(wxfn);
     impl_ = new FileOutputImpl();
   } else if (type == kStandardOutput) {
     impl_ = new StandardOutputImpl();
   } else if (type == kPipeOutput) {
     impl_ = new PipeOutputImpl();
+  } else if (type == kBlockCompressedOutput) {
+    impl_ = new BlockCompressedOutputImpl();
   } else {  // type == kNoOutput
     KALDI_WARN << "Invalid output filename format "<<
         PrintableWxfilename(wxfn);
@@ -708,7 +1023,8 @@ bool Input::OpenInternal(const std::string &rxfilename,
   InputType type = ClassifyRxfilename(rxfilename);
   if (IsOpen()) {
     // May have to close the stream first.
-    if (type == kOffsetFileInput && impl_->MyType() == kOffsetFileInput) {
+    if ((type == kOffsetFileInput || type == kBlockCompressedInput) &&
+        impl_->MyType() == type) {
       // We want to use the same object to Open... this is in case
       // the files are the same, so we can just seek.
       if (!impl_->Open(rxfilename, file_binary)) {  // true is binary mode-- always open in binary.
@@ -733,6 +1049,8 @@ bool Input::OpenInternal(const std::string &rxfilename,
     impl_ = new PipeInputImpl();
   } else if (type == kOffsetFileInput) {
     impl_ = new OffsetFileInputImpl();
+  } else if (type == kBlockCompressedInput) {
+    impl_ = new BlockCompressedInputImpl();
   } else {  // type == kNoInput
     KALDI_WARN << "Invalid input filename format "<<
         PrintableRxfilename(rxfilename);
@@ -88,7 +88,8 @@ enum OutputType {
   kNoOutput,
   kFileOutput,
   kStandardOutput,
-  kPipeOutput
+  kPipeOutput,
+  kBlockCompressedOutput
 };
 
 /// ClassifyWxfilename interprets filenames as follows:
@@ -96,7 +97,9 @@ enum OutputType {
 ///     like wspecifiers and rspecifiers or like pipes to read from with leading |.
 ///  - kFileOutput: Normal filenames
 ///  - kStandardOutput: The empty string or "-", interpreted as standard output
-///  - kPipeOutput: pipes, e.g. "gunzip -c some_file.gz |"  
+///  - kPipeOutput: pipes, e.g. "gunzip -c some_file.gz |"
+///  - kBlockCompressedOutput: filenames ending in ".blz", written in the
+///      seekable block-compressed format of util/block-compressed-io.h.
 OutputType ClassifyWxfilename(const std::string &wxfilename);
 
 enum InputType {
@@ -104,7 +107,8 @@ enum InputType {
   kFileInput,
   kStandardInput,
   kOffsetFileInput,
-  kPipeInput
+  kPipeInput,
+  kBlockCompressedInput
 };
 
 /// ClassifyRxfilenames interprets filenames for reading as follows:
@@ -115,6 +119,9 @@ enum InputType {
 ///  - kStandardInput: the empty string or "-"
 ///  - kPipeInput: e.g. "| gzip -c > blah.gz"
 ///  - kOffsetFileInput: offsets into files, e.g.  /some/filename:12970
+///  - kBlockCompressedInput: files in the block-compressed format of
+///      util/block-compressed-io.h, e.g. /some/filename.blz, possibly with
+///      an offset into the uncompressed stream as in /some/filename.blz:12970
 InputType ClassifyRxfilename(const std::string &rxfilename);
 
 
@@ -255,6 +262,16 @@ std::string PrintableRxfilename(std::string rxfilename);
 /// replaces "" or "-" with "standard output".
 std::string PrintableWxfilename(std::string wxfilename);
 
+/// Sets the size of the process-wide cache of open file handles that backs
+/// offset rxfilenames like /my/file.ark:12345 (the kind that .scp files
+/// point into).  While a handle for an archive is cached, reading another
+/// offset into that archive just seeks instead of re-opening the file,
+/// even across different Input objects, which matters a lot for
+/// RandomAccessTableReader on scp files over NFS.  The default is 32
+/// handles, evicted least-recently-used; 0 disables the cache (every
+/// Input then opens and closes the file itself, as it always did).
+void SetFileHandleCacheSize(int32 num_handles);
+
 /// @}
 
 }  // end namespace kaldi.
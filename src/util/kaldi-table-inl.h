@@ -41,7 +41,7 @@ template<class Holder> class SequentialTableReaderImplBase {
   virtual bool Done() const = 0;
   virtual bool IsOpen() const = 0;
   virtual std::string Key() = 0;
-  virtual const T &Value() = 0;
+  virtual T &Value() = 0;
   virtual void FreeCurrent() = 0;
   virtual void Next() = 0;
   virtual bool Close() = 0;
@@ -82,6 +82,20 @@ template<class Holder>  class SequentialTableReaderScriptImpl:
         script_input_.Close();
         return false;
       } else {
+        if (opts_.locality_sorted) {
+          // "ls" option: read the whole scp up front and iterate it in
+          // order of (archive file, byte offset), so the data reads are
+          // sequential within each archive.
+          buffered_script_.clear();
+          script_pos_ = 0;
+          if (!ReadScriptFile(script_input_.Stream(), true,
+                              &buffered_script_)) {
+            state_ = kError;
+            script_input_.Close();
+            return false;
+          }
+          SortScriptByLocality(&buffered_script_);
+        }
         state_ = kFileStart;
         Next();
         if (state_ == kError) {
@@ -132,7 +146,7 @@ template<class Holder>  class SequentialTableReaderScriptImpl:
     }
     return key_;
   }
-  const T &Value() {
+  T &Value() {
     StateType orig_state = state_;
     if (state_ == kHaveScpLine) LoadCurrent();  // Takes
     // state_ to kLoadSucceeded or kLoadFailed.
@@ -247,6 +261,23 @@ template<class Holder>  class SequentialTableReaderScriptImpl:
         // No other states are valid to call Next() from.
         KALDI_ERR << "Reading script file: Next called wrongly.";
     }
+    if (opts_.locality_sorted) {
+      // We are serving the pre-read, locality-sorted script.
+      if (script_pos_ < buffered_script_.size()) {
+        key_ = buffered_script_[script_pos_].first;
+        data_rxfilename_ = buffered_script_[script_pos_].second;
+        script_pos_++;
+        state_ = kHaveScpLine;
+      } else {
+        state_ = kEof;  // nothing more in the script.
+        // Might as well close the input streams as don't need them.
+        if (script_input_.IsOpen())
+          script_input_.Close();
+        if (data_input_.IsOpen())
+          data_input_.Close();
+      }
+      return;
+    }
     std::string line;
     if (getline(script_input_.Stream(), line)) {
       SplitStringOnFirstSpace(line, &key_, &data_rxfilename_);
@@ -278,6 +309,10 @@ template<class Holder>  class SequentialTableReaderScriptImpl:
   std::string script_rxfilename_;  // of the script file.
   RspecifierOptions opts_;  // options.
   std::string data_rxfilename_;  // of the file we're reading.
+  // These two are only used with the locality-sorted ("ls") option: the
+  // whole script, sorted by (archive, offset), and our position in it.
+  std::vector<std::pair<std::string, std::string> > buffered_script_;
+  size_t script_pos_;
   enum StateType {
     //       [The state of the reading process]               [does holder_ [is script_inp_
     //                                                         have object]   open]
@@ -435,7 +470,7 @@ template<class Holder>  class SequentialTableReaderArchiveImpl:
     }
     return key_;
   }
-  const T &Value() {
+  T &Value() {
     switch (state_) {
       case kHaveObject:
         break;  // only valid case.
@@ -573,7 +608,7 @@ void SequentialTableReader<Holder>::FreeCurrent() {
 
 
 template<class Holder>
-const typename SequentialTableReader<Holder>::T &
+typename SequentialTableReader<Holder>::T &
 SequentialTableReader<Holder>::Value() {
   CheckImpl();
   return impl_->Value();  // This may throw (if LoadCurrent() returned false you are safe.).
@@ -945,7 +980,8 @@ class TableWriterBothImpl: public TableWriterImplBase<Holder> {
                                            &script_wxfilename_,
                                            &opts_);
     KALDI_ASSERT(ws == kBothWspecifier);  // or wrongly called.
-    if (ClassifyWxfilename(archive_wxfilename_) != kFileOutput)
+    if (ClassifyWxfilename(archive_wxfilename_) != kFileOutput &&
+        ClassifyWxfilename(archive_wxfilename_) != kBlockCompressedOutput)
       KALDI_WARN << "When writing to both archive and script, the script file "
           "will generally not be interpreted correctly unless the archive is "
           "an actual file: wspecifier = " << wspecifier;
@@ -880,13 +880,85 @@ void UnitTestTableRandomBothDoubleMatrix(bool binary, bool read_scp,
 
 
 
+void UnitTestLocalitySplit() {
+  // Write an archive with an scp "index", shuffle the scp, and check that
+  // SortScriptByLocality() restores the offset order, that
+  // SplitScriptByLocality() produces contiguous shards covering everything,
+  // and that the "ls" (locality-sorted) reading option gives us back the
+  // entries in archive order.
+  int32 sz = 20;
+  std::vector<std::string> k;
+  std::vector<int32> v;
+  {
+    Int32Writer bw("b,ark,scp:tmpf,tmpf.scp");
+    for (int32 i = 0; i < sz; i++) {
+      k.push_back("key" + CharToString('a' + static_cast<char>(i)));
+      v.push_back(Rand());
+      bw.Write(k.back(), v.back());
+    }
+    KALDI_ASSERT(bw.Close());
+  }
+  std::vector<std::pair<std::string, std::string> > script;
+  KALDI_ASSERT(ReadScriptFile("tmpf.scp", true, &script));
+  KALDI_ASSERT(static_cast<int32>(script.size()) == sz);
+
+  {  // check ParseScpEntryLocation on a real entry and a plain filename.
+    std::string data_filename;
+    int64 offset;
+    ParseScpEntryLocation(script[0].second, &data_filename, &offset);
+    KALDI_ASSERT(data_filename == "tmpf" && offset >= 0);
+    ParseScpEntryLocation("some/file.mat", &data_filename, &offset);
+    KALDI_ASSERT(data_filename == "some/file.mat" && offset == -1);
+  }
+
+  std::vector<std::pair<std::string, std::string> > shuffled(script);
+  for (int32 i = 0; i < 50; i++)
+    std::swap(shuffled[Rand() % sz], shuffled[Rand() % sz]);
+
+  {  // sorting the shuffled script restores the original (offset) order.
+    std::vector<std::pair<std::string, std::string> > sorted(shuffled);
+    SortScriptByLocality(&sorted);
+    KALDI_ASSERT(sorted == script);
+  }
+
+  {  // the shards, concatenated, are the sorted script.
+    int32 num_shards = 1 + Rand() % 5;
+    std::vector<std::vector<std::pair<std::string, std::string> > > shards;
+    SplitScriptByLocality(shuffled, num_shards, &shards);
+    KALDI_ASSERT(static_cast<int32>(shards.size()) == num_shards);
+    std::vector<std::pair<std::string, std::string> > cat;
+    for (int32 i = 0; i < num_shards; i++)
+      cat.insert(cat.end(), shards[i].begin(), shards[i].end());
+    KALDI_ASSERT(cat == script);
+  }
+
+  {  // reading the shuffled scp with "ls," gives archive order back.
+    KALDI_ASSERT(WriteScriptFile("tmpf_shuf.scp", shuffled));
+    SequentialInt32Reader sbr("ls,scp:tmpf_shuf.scp");
+    std::vector<std::string> k2;
+    std::vector<int32> v2;
+    for (; !sbr.Done(); sbr.Next()) {
+      k2.push_back(sbr.Key());
+      v2.push_back(sbr.Value());
+    }
+    KALDI_ASSERT(sbr.Close());
+    KALDI_ASSERT(k2 == k);
+    KALDI_ASSERT(v2 == v);
+  }
+  unlink("tmpf");
+  unlink("tmpf.scp");
+  unlink("tmpf_shuf.scp");
+}
+
 }  // end namespace kaldi.
 
+
 int main() {
   using namespace kaldi;
   UnitTestReadScriptFile();
   UnitTestClassifyWspecifier();
   UnitTestClassifyRspecifier();
+  UnitTestLocalitySplit();
   for (int i = 0; i < 10; i++) {
     bool b = (i == 0);
     UnitTestTableSequentialBool(b);
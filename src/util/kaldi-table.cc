@@ -122,6 +122,120 @@ bool WriteScriptFile(const std::string &wxfilename,
   return true;
 }
 
+void ParseScpEntryLocation(const std::string &xfilename,
+                           std::string *data_filename,
+                           int64 *offset) {
+  KALDI_ASSERT(data_filename != NULL && offset != NULL);
+  size_t pos = xfilename.rfind(':');
+  if (pos != std::string::npos && pos + 1 < xfilename.size()) {
+    bool all_digits = true;
+    for (size_t i = pos + 1; i < xfilename.size(); i++)
+      if (!isdigit(xfilename[i])) { all_digits = false; break; }
+    if (all_digits) {
+      *data_filename = std::string(xfilename, 0, pos);
+      std::istringstream is(std::string(xfilename, pos + 1));
+      is >> *offset;
+      return;
+    }
+  }
+  *data_filename = xfilename;
+  *offset = -1;
+}
+
+namespace {
+// Used in sorting script entries by locality; see SortScriptByLocality.
+struct ScpEntryLocation {
+  std::string data_filename;
+  int64 offset;
+  size_t index;  // index into the original script, so the sort is stable and
+  // we can estimate sizes from gaps between consecutive offsets.
+  bool operator < (const ScpEntryLocation &other) const {
+    if (data_filename != other.data_filename)
+      return data_filename < other.data_filename;
+    if (offset != other.offset)
+      return offset < other.offset;
+    return index < other.index;
+  }
+};
+
+void GetSortedLocations(
+    const std::vector<std::pair<std::string, std::string> > &script,
+    std::vector<ScpEntryLocation> *locations) {
+  locations->resize(script.size());
+  for (size_t i = 0; i < script.size(); i++) {
+    (*locations)[i].index = i;
+    ParseScpEntryLocation(script[i].second,
+                          &((*locations)[i].data_filename),
+                          &((*locations)[i].offset));
+  }
+  std::sort(locations->begin(), locations->end());
+}
+}  // namespace
+
+void SortScriptByLocality(
+    std::vector<std::pair<std::string, std::string> > *script) {
+  KALDI_ASSERT(script != NULL);
+  std::vector<ScpEntryLocation> locations;
+  GetSortedLocations(*script, &locations);
+  std::vector<std::pair<std::string, std::string> > sorted(script->size());
+  for (size_t i = 0; i < locations.size(); i++)
+    sorted[i] = (*script)[locations[i].index];
+  script->swap(sorted);
+}
+
+void SplitScriptByLocality(
+    const std::vector<std::pair<std::string, std::string> > &script,
+    int32 num_shards,
+    std::vector<std::vector<std::pair<std::string, std::string> > > *shards) {
+  KALDI_ASSERT(num_shards > 0 && shards != NULL);
+  shards->clear();
+  shards->resize(num_shards);
+  std::vector<ScpEntryLocation> locations;
+  GetSortedLocations(script, &locations);
+  size_t num_entries = locations.size();
+
+  // Estimate each entry's size in bytes as the gap to the next offset into
+  // the same archive; the last entry of each archive, and entries without
+  // offsets, get the average of the known sizes (or 1 if there are none).
+  std::vector<int64> sizes(num_entries, -1);
+  int64 known_total = 0, num_known = 0;
+  for (size_t i = 0; i + 1 < num_entries; i++) {
+    if (locations[i].offset >= 0 &&
+        locations[i+1].data_filename == locations[i].data_filename &&
+        locations[i+1].offset > locations[i].offset) {
+      sizes[i] = locations[i+1].offset - locations[i].offset;
+      known_total += sizes[i];
+      num_known++;
+    }
+  }
+  int64 default_size = (num_known > 0 ? known_total / num_known : 1);
+  if (default_size < 1) default_size = 1;
+  int64 total = 0;
+  for (size_t i = 0; i < num_entries; i++) {
+    if (sizes[i] < 0) sizes[i] = default_size;
+    total += sizes[i];
+  }
+
+  // Walk the sorted entries, cutting to a new shard whenever the current
+  // shard has reached its share of the remaining bytes; each shard is a
+  // contiguous segment of the sorted order, so it reads each archive
+  // sequentially.
+  int64 remaining = total;
+  int64 cur_bytes = 0;
+  int32 shard = 0;
+  for (size_t i = 0; i < num_entries; i++) {
+    int64 target = remaining / (num_shards - shard);
+    if (cur_bytes > 0 && cur_bytes + sizes[i] / 2 >= target &&
+        shard + 1 < num_shards) {
+      remaining -= cur_bytes;
+      cur_bytes = 0;
+      shard++;
+    }
+    (*shards)[shard].push_back(script[locations[i].index]);
+    cur_bytes += sizes[i];
+  }
+}
+
 
 
 WspecifierType ClassifyWspecifier(const std::string &wspecifier,
@@ -276,6 +390,10 @@ RspecifierType ClassifyRspecifier(const std::string &rspecifier,
       if (opts) opts->called_sorted = true;
     } else if (!strcmp(c, "ncs")) {
       if (opts) opts->called_sorted = false;
+    } else if (!strcmp(c, "ls")) {
+      if (opts) opts->locality_sorted = true;
+    } else if (!strcmp(c, "nls")) {
+      if (opts) opts->locality_sorted = false;
     } else if (!strcmp(c, "ark")) {
       if (rs == kNoRspecifier) rs = kArchiveRspecifier;
       else return kNoRspecifier;  // Repeated or combined ark and scp options invalid.
@@ -156,6 +156,36 @@ bool WriteScriptFile(const std::string &wxfilename,
 bool WriteScriptFile(std::ostream &os,
                      const std::vector<std::pair<std::string, std::string> > &script);
 
+// ParseScpEntryLocation parses the xfilename part of one scp entry into the
+// underlying data filename and the byte offset, for entries of the form
+// "filename:12345" as written by "ark,scp:" wspecifiers.  For entries with
+// no offset (plain files, pipes, standard input) it sets *offset to -1 and
+// *data_filename to the whole xfilename.
+void ParseScpEntryLocation(const std::string &xfilename,
+                           std::string *data_filename,
+                           int64 *offset);
+
+// SortScriptByLocality reorders the entries of a script (as output by
+// ReadScriptFile) by (data filename, byte offset), so that reading the
+// entries in order scans each archive sequentially instead of seeking
+// around.  The sort is stable, so entries without offsets keep their
+// relative order.
+void SortScriptByLocality(
+    std::vector<std::pair<std::string, std::string> > *script);
+
+// SplitScriptByLocality splits a script into num_shards shards for parallel
+// jobs.  The entries are first sorted as in SortScriptByLocality(), and each
+// shard is one contiguous segment of that order, so each job reads one
+// sequential stretch of (usually) one archive.  The cut points are chosen to
+// balance the approximate number of bytes per shard (entry sizes are
+// estimated from the gaps between consecutive offsets into the same
+// archive), not the number of entries.  Shards may be empty if num_shards
+// exceeds the number of entries.
+void SplitScriptByLocality(
+    const std::vector<std::pair<std::string, std::string> > &script,
+    int32 num_shards,
+    std::vector<std::vector<std::pair<std::string, std::string> > > *shards);
+
 // Documentation for "rspecifier"
 // "rspecifier" describes how we read a set of objects indexed by keys.
 // The possibilities are:
@@ -173,6 +203,11 @@ bool WriteScriptFile(std::ostream &os,
 //   p   means "permissive", and causes it to skip over keys whose corresponding
 //       scp-file entries cannot be read. [and to ignore errors in archives and
 //       script files, and just consider the "good" entries].
+//   ls  (only for sequential reading of scp files) means "locality-sorted":
+//       the whole scp is read up front and iterated in order of (archive
+//       file, byte offset), so the data is read sequentially from each
+//       archive rather than in scp order; use it when the scp order does
+//       not matter but the scp seeks around large archives.
 //       We allow the negation of the options above, as in no, ns, np,
 //       but these aren't currently very useful (just equivalent to omitting the
 //       corresponding option).
@@ -198,9 +233,14 @@ struct  RspecifierOptions {
   // For archive files it will suppress errors getting thrown if the archive
   
   // is corrupted and can't be read to the end.
+  bool locality_sorted;  // For sequential reading of scp files only: read the
+  // whole scp up front and iterate it sorted by (archive file, byte offset),
+  // so each archive is read sequentially.  The keys come out in that order,
+  // not the scp order.
 
   RspecifierOptions(): once(false), sorted(false),
-                       called_sorted(false), permissive(false) { }
+                       called_sorted(false), permissive(false),
+                       locality_sorted(false) { }
 };
 
 enum RspecifierType  {
@@ -312,7 +352,10 @@ class SequentialTableReader {
   // key does not even exist, if the corresponding file cannot be
   // read.]  You probably wouldn't want to catch this exception;
   // the user can just specify the p option in the rspecifier.
-  const T &Value();
+  // The reference is non-const, so if you won't need the value again you
+  // may swap its contents out rather than copying them (the object will in
+  // any case be deallocated or overwritten by the next call to Next()).
+  T &Value();
 
   // Next goes to the next key.  It will not throw; any error will
   // result in Done() returning true, and then the destructor will
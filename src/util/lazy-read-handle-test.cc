@@ -0,0 +1,83 @@
+// util/lazy-read-handle-test.cc
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "util/lazy-read-handle.h"
+#include "matrix/kaldi-vector.h"
+
+namespace kaldi {
+
+static int32 g_num_post_load_calls = 0;
+
+static void CountingPostLoad(Vector<BaseFloat> *vec, void *context) {
+  KALDI_ASSERT(context == NULL && vec->Dim() != 0);
+  g_num_post_load_calls++;
+}
+
+void UnitTestLazyReadHandle() {
+  Vector<BaseFloat> vec(10 + Rand() % 10);
+  vec.SetRandn();
+  bool binary = (Rand() % 2 == 0);
+  WriteKaldiObject(vec, "tmpf", binary);
+
+  {
+    LazyReadHandle<Vector<BaseFloat> > handle("tmpf");
+    g_num_post_load_calls = 0;
+    handle.SetPostLoadFunction(&CountingPostLoad, NULL);
+    KALDI_ASSERT(!handle.IsEmpty() && !handle.IsLoaded());
+    const Vector<BaseFloat> &vec2 = handle.Get();
+    KALDI_ASSERT(handle.IsLoaded());
+    KALDI_ASSERT(vec2.ApproxEqual(vec));
+    // a second Get() returns the same object without re-reading.
+    KALDI_ASSERT(&handle.Get() == &vec2);
+    KALDI_ASSERT(g_num_post_load_calls == 1);
+  }
+
+  {  // background load followed by Get().
+    LazyReadHandle<Vector<BaseFloat> > handle;
+    handle.SetFilename("tmpf");
+    handle.StartBackgroundLoad();
+    KALDI_ASSERT(handle.Get().ApproxEqual(vec));
+  }
+
+  {  // an empty handle.
+    LazyReadHandle<Vector<BaseFloat> > handle;
+    KALDI_ASSERT(handle.IsEmpty());
+  }
+
+  {  // a handle on a nonexistent file: Get() should throw.
+    LazyReadHandle<Vector<BaseFloat> > handle("tmpf_nonexistent_file");
+    bool threw = false;
+    try {
+      handle.Get();
+    } catch(const std::exception &e) {
+      threw = true;
+    }
+    KALDI_ASSERT(threw && !handle.IsLoaded());
+  }
+}
+
+}  // end namespace kaldi.
+
+int main() {
+  using namespace kaldi;
+  for (int32 i = 0; i < 10; i++)
+    UnitTestLazyReadHandle();
+  KALDI_LOG << "Test OK.";
+  return 0;
+}
@@ -0,0 +1,160 @@
+// util/lazy-read-handle.h
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_UTIL_LAZY_READ_HANDLE_H_
+#define KALDI_UTIL_LAZY_READ_HANDLE_H_
+
+#include <pthread.h>
+#include <string>
+
+#include "base/kaldi-common.h"
+#include "util/kaldi-io.h"
+
+/* This header provides LazyReadHandle, a wrapper that records an rxfilename
+   at construction time but only reads the object on first access.  It exists
+   because server-type programs bundle together several models of which some
+   (e.g. a discriminatively trained rescoring model) may never be used in a
+   given session; reading them eagerly at startup delays the point at which
+   the program can accept input.  Access is thread-safe: the first caller of
+   Get() reads the object while any concurrent callers block, and later calls
+   just return the reference.  If startup can spare the cycles, call
+   StartBackgroundLoad() to read the object on a background thread so that
+   the first Get() is likely not to block at all. */
+
+namespace kaldi {
+
+/// LazyReadHandle<T> wraps an object of type T that is read from an
+/// rxfilename with ReadKaldiObject() the first time Get() is called.
+/// T must have a Read(std::istream&, bool binary) method.
+template<class T>
+class LazyReadHandle {
+ public:
+  LazyReadHandle(): object_(NULL), post_load_func_(NULL),
+                    post_load_context_(NULL), background_started_(false) {
+    pthread_mutex_init(&mutex_, NULL);
+  }
+
+  explicit LazyReadHandle(const std::string &rxfilename):
+      rxfilename_(rxfilename), object_(NULL), post_load_func_(NULL),
+      post_load_context_(NULL), background_started_(false) {
+    pthread_mutex_init(&mutex_, NULL);
+  }
+
+  /// Sets the filename to read from; only allowed before the object has been
+  /// loaded.  An empty rxfilename makes the handle empty.
+  void SetFilename(const std::string &rxfilename) {
+    KALDI_ASSERT(object_ == NULL && !background_started_);
+    rxfilename_ = rxfilename;
+  }
+
+  /// A function to be called (under the lock, exactly once) right after the
+  /// object has been read, e.g. for compatibility checks against other
+  /// models; it may throw.  Set this before the first Get() or
+  /// StartBackgroundLoad().
+  typedef void (*PostLoadFunction)(T *object, void *context);
+  void SetPostLoadFunction(PostLoadFunction func, void *context) {
+    KALDI_ASSERT(object_ == NULL && !background_started_);
+    post_load_func_ = func;
+    post_load_context_ = context;
+  }
+
+  /// True if no filename was supplied; Get() on an empty handle is an error.
+  bool IsEmpty() const { return rxfilename_.empty(); }
+
+  bool IsLoaded() const {
+    pthread_mutex_lock(&mutex_);
+    bool ans = (object_ != NULL);
+    pthread_mutex_unlock(&mutex_);
+    return ans;
+  }
+
+  const std::string &Filename() const { return rxfilename_; }
+
+  /// Returns the object, reading it if this is the first access.  The
+  /// reference stays valid for the lifetime of the handle, so callers in
+  /// inner loops should keep it rather than calling Get() repeatedly (each
+  /// call takes the lock).
+  const T &Get() const {
+    if (rxfilename_.empty())
+      KALDI_ERR << "LazyReadHandle::Get() called on an empty handle.";
+    pthread_mutex_lock(&mutex_);
+    if (object_ == NULL) {
+      T *object = new T();
+      try {
+        ReadKaldiObject(rxfilename_, object);
+        if (post_load_func_ != NULL)
+          (*post_load_func_)(object, post_load_context_);
+      } catch(...) {
+        delete object;
+        pthread_mutex_unlock(&mutex_);
+        throw;
+      }
+      object_ = object;
+    }
+    pthread_mutex_unlock(&mutex_);
+    return *object_;
+  }
+
+  /// Starts reading the object on a background thread (no-op if the handle
+  /// is empty or a load was already started).  A Get() call that arrives
+  /// before the background load finishes simply blocks until it is done.
+  void StartBackgroundLoad() const {
+    if (rxfilename_.empty() || background_started_) return;
+    if (pthread_create(&background_thread_, NULL,
+                       BackgroundThreadEntry,
+                       const_cast<LazyReadHandle<T>*>(this)) != 0)
+      KALDI_ERR << "LazyReadHandle: could not create background thread.";
+    background_started_ = true;
+  }
+
+  ~LazyReadHandle() {
+    if (background_started_)
+      pthread_join(background_thread_, NULL);
+    delete object_;
+    pthread_mutex_destroy(&mutex_);
+  }
+
+ private:
+  static void *BackgroundThreadEntry(void *handle_ptr) {
+    LazyReadHandle<T> *handle = static_cast<LazyReadHandle<T>*>(handle_ptr);
+    try {
+      handle->Get();
+    } catch(const std::exception &e) {
+      // An error here (e.g. file not found) will recur on the foreground
+      // Get() call, where it can be handled; object_ stays NULL.
+      KALDI_WARN << "Background load of " << handle->rxfilename_
+                 << " failed: " << e.what();
+    }
+    return NULL;
+  }
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(LazyReadHandle);
+
+  std::string rxfilename_;
+  mutable T *object_;  // NULL until loaded.
+  mutable pthread_mutex_t mutex_;  // guards object_.
+  PostLoadFunction post_load_func_;
+  void *post_load_context_;
+  mutable pthread_t background_thread_;
+  mutable bool background_started_;
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_UTIL_LAZY_READ_HANDLE_H_
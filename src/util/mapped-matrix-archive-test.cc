@@ -0,0 +1,91 @@
+// util/mapped-matrix-archive-test.cc
+
+// Copyright 2015   Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include <map>
+
+#ifndef _MSC_VER
+#include <unistd.h>
+#endif
+
+#include "base/kaldi-math.h"
+#include "util/mapped-matrix-archive.h"
+
+namespace kaldi {
+
+void UnitTestMappedMatrixArchive() {
+#if !defined(_MSC_VER)
+  for (int32 iter = 0; iter < 10; iter++) {
+    const char *filename = "tmpf";
+    int32 num_records = Rand() % 50;
+    std::map<std::string, Matrix<BaseFloat> > written;
+    {
+      MappedMatrixArchiveWriter writer;
+      writer.Open(filename);
+      for (int32 i = 0; i < num_records; i++) {
+        std::string key = "key_" + CharToString('a' + Rand() % 26)
+            + CharToString('a' + Rand() % 26);
+        if (written.count(key) != 0)
+          continue;  // the writer would (correctly) crash on a duplicate.
+        Matrix<BaseFloat> mat(1 + Rand() % 20, 1 + Rand() % 20);
+        mat.SetRandn();
+        if (Rand() % 10 == 0) mat.Resize(0, 0);
+        writer.Write(key, mat);
+        written[key] = mat;
+      }
+      writer.Close();
+    }
+    MappedMatrixArchiveReader reader;
+    reader.Open(filename);
+    KALDI_ASSERT(reader.NumRecords() ==
+                 static_cast<int32>(written.size()));
+    // random access by key..
+    for (std::map<std::string, Matrix<BaseFloat> >::iterator iter2 =
+             written.begin(); iter2 != written.end(); ++iter2) {
+      KALDI_ASSERT(reader.HasKey(iter2->first));
+      SubMatrix<BaseFloat> value = reader.Value(iter2->first);
+      KALDI_ASSERT(value.NumRows() == iter2->second.NumRows() &&
+                   value.NumCols() == iter2->second.NumCols());
+      if (value.NumRows() > 0)
+        KALDI_ASSERT(value.ApproxEqual(iter2->second, 0.0f));
+    }
+    KALDI_ASSERT(!reader.HasKey("key_that_is_not_there"));
+    // ..and sequential access; the keys come back sorted.
+    std::string prev_key = "";
+    for (int32 i = 0; i < reader.NumRecords(); i++) {
+      KALDI_ASSERT(i == 0 || prev_key < reader.Key(i));
+      prev_key = reader.Key(i);
+      KALDI_ASSERT(written.count(prev_key) != 0);
+      SubMatrix<BaseFloat> value = reader.Value(i);
+      if (value.NumRows() > 0)
+        KALDI_ASSERT(value.ApproxEqual(written[prev_key], 0.0f));
+    }
+    reader.Close();
+    unlink(filename);
+  }
+#endif
+}
+
+}  // end namespace kaldi.
+
+int main() {
+  using namespace kaldi;
+  UnitTestMappedMatrixArchive();
+  std::cout << "Test OK.\n";
+  return 0;
+}
@@ -0,0 +1,277 @@
+// util/mapped-matrix-archive.cc
+
+// Copyright 2015   Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "util/mapped-matrix-archive.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "util/kaldi-io.h"
+#include "util/text-utils.h"
+
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace kaldi {
+
+// The file layout is:
+//   header, 32 bytes:  8-byte magic, int32 sizeof(BaseFloat), int32 zero,
+//                      uint64 index offset, uint64 number of records.
+//   records:           each starts on a 16-byte boundary: int32 num-rows,
+//                      int32 num-cols, 8 bytes of zero padding, then the
+//                      row-major BaseFloat data (so the data itself is also
+//                      16-byte aligned).
+//   index:             per record, in sorted order on the key: int32 key
+//                      length, the key bytes, uint64 record offset.
+// Everything is in the byte order of the writing machine; the
+// sizeof(BaseFloat) field in the header doubles as a byte-order check,
+// since byte-swapped it cannot equal 4 or 8.
+static const char kMappedArchiveMagic[8] = { 'K', 'L', 'D', 'M', 'M', 'A',
+                                             '0', '1' };
+static const uint64 kMappedArchiveHeaderSize = 32;
+static const uint64 kMappedArchiveAlign = 16;
+
+void MappedMatrixArchiveWriter::Open(const std::string &filename) {
+  KALDI_ASSERT(!open_);
+  filename_ = filename;
+  stream_.open(filename.c_str(),
+               std::ios_base::out | std::ios_base::binary |
+               std::ios_base::trunc);
+  if (!stream_.is_open())
+    KALDI_ERR << "Failed to open " << PrintableWxfilename(filename)
+              << " for writing.";
+  // Write the header with placeholders for the index offset and record
+  // count; Close() seeks back and fills them in.
+  int32 base_float_size = sizeof(BaseFloat), zero = 0;
+  uint64 zero64 = 0;
+  stream_.write(kMappedArchiveMagic, 8);
+  stream_.write(reinterpret_cast<const char*>(&base_float_size), 4);
+  stream_.write(reinterpret_cast<const char*>(&zero), 4);
+  stream_.write(reinterpret_cast<const char*>(&zero64), 8);
+  stream_.write(reinterpret_cast<const char*>(&zero64), 8);
+  data_offset_ = kMappedArchiveHeaderSize;
+  open_ = true;
+}
+
+void MappedMatrixArchiveWriter::Write(const std::string &key,
+                                      const MatrixBase<BaseFloat> &mat) {
+  KALDI_ASSERT(open_);
+  if (!IsToken(key))  // the same constraint regular tables place on keys.
+    KALDI_ERR << "Invalid key \"" << key << "\"";
+  // Pad to a 16-byte boundary so the record (and hence its data) is
+  // aligned in the mapped file.
+  static const char padding[kMappedArchiveAlign] = { '\0' };
+  uint64 misalign = data_offset_ % kMappedArchiveAlign;
+  if (misalign != 0) {
+    stream_.write(padding, kMappedArchiveAlign - misalign);
+    data_offset_ += kMappedArchiveAlign - misalign;
+  }
+  index_.push_back(std::make_pair(key, data_offset_));
+  int32 num_rows = mat.NumRows(), num_cols = mat.NumCols();
+  stream_.write(reinterpret_cast<const char*>(&num_rows), 4);
+  stream_.write(reinterpret_cast<const char*>(&num_cols), 4);
+  stream_.write(padding, 8);
+  // write row by row, since the matrix stride may exceed num-cols.
+  for (int32 r = 0; r < num_rows; r++)
+    stream_.write(reinterpret_cast<const char*>(mat.RowData(r)),
+                  num_cols * sizeof(BaseFloat));
+  data_offset_ += 16 + static_cast<uint64>(num_rows) * num_cols *
+      sizeof(BaseFloat);
+  if (stream_.fail())
+    KALDI_ERR << "Failure writing record " << key << " to "
+              << PrintableWxfilename(filename_);
+}
+
+void MappedMatrixArchiveWriter::Close() {
+  KALDI_ASSERT(open_);
+  std::sort(index_.begin(), index_.end());
+  for (size_t i = 1; i < index_.size(); i++)
+    if (index_[i].first == index_[i-1].first)
+      KALDI_ERR << "Duplicate key " << index_[i].first << " writing "
+                << PrintableWxfilename(filename_);
+  uint64 index_offset = data_offset_,
+      num_records = index_.size();
+  for (size_t i = 0; i < index_.size(); i++) {
+    int32 key_length = static_cast<int32>(index_[i].first.size());
+    stream_.write(reinterpret_cast<const char*>(&key_length), 4);
+    stream_.write(index_[i].first.data(), key_length);
+    stream_.write(reinterpret_cast<const char*>(&index_[i].second), 8);
+  }
+  stream_.seekp(16);  // the offset of the index-offset field.
+  stream_.write(reinterpret_cast<const char*>(&index_offset), 8);
+  stream_.write(reinterpret_cast<const char*>(&num_records), 8);
+  stream_.close();
+  if (stream_.fail())
+    KALDI_ERR << "Failure writing " << PrintableWxfilename(filename_);
+  open_ = false;
+  index_.clear();
+  data_offset_ = 0;
+}
+
+
+// Reads a little chunk of the mapped file with bounds checking; using
+// memcpy since index entries are not aligned.
+static void ReadMapped(const char *data, size_t size, uint64 offset,
+                       void *dest, size_t num_bytes,
+                       const std::string &filename) {
+  if (offset + num_bytes > size)
+    KALDI_ERR << "Truncated or corrupt mapped archive "
+              << PrintableRxfilename(filename);
+  memcpy(dest, data + offset, num_bytes);
+}
+
+void MappedMatrixArchiveReader::Open(const std::string &filename) {
+#ifdef _MSC_VER
+  KALDI_ERR << "MappedMatrixArchiveReader is not supported on Windows.";
+#else
+  Close();
+  filename_ = filename;
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    KALDI_ERR << "Failed to open " << PrintableRxfilename(filename)
+              << " for reading.";
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+    close(fd);
+    KALDI_ERR << PrintableRxfilename(filename) << " is not a regular file "
+              << "(mapped archives cannot be pipes or offsets).";
+  }
+  mmap_size_ = static_cast<size_t>(st.st_size);
+  void *data = mmap(NULL, mmap_size_, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+    KALDI_ERR << "Failed to mmap " << PrintableRxfilename(filename);
+  mmap_data_ = static_cast<char*>(data);
+
+  try {
+    if (mmap_size_ < kMappedArchiveHeaderSize ||
+        memcmp(mmap_data_, kMappedArchiveMagic, 8) != 0)
+      KALDI_ERR << PrintableRxfilename(filename) << " is not a mapped "
+                << "matrix archive.";
+    int32 base_float_size;
+    uint64 index_offset, num_records;
+    ReadMapped(mmap_data_, mmap_size_, 8, &base_float_size, 4, filename);
+    ReadMapped(mmap_data_, mmap_size_, 16, &index_offset, 8, filename);
+    ReadMapped(mmap_data_, mmap_size_, 24, &num_records, 8, filename);
+    if (base_float_size != static_cast<int32>(sizeof(BaseFloat)))
+      KALDI_ERR << PrintableRxfilename(filename) << " was written with "
+                << "a different byte order or BaseFloat precision than "
+                << "this machine uses (header says size "
+                << base_float_size << ", we have " << sizeof(BaseFloat)
+                << ").";
+    index_.reserve(num_records);
+    uint64 offset = index_offset;
+    for (uint64 i = 0; i < num_records; i++) {
+      int32 key_length;
+      ReadMapped(mmap_data_, mmap_size_, offset, &key_length, 4, filename);
+      offset += 4;
+      if (key_length < 0 || offset + key_length > mmap_size_)
+        KALDI_ERR << "Corrupt index in " << PrintableRxfilename(filename);
+      std::string key(mmap_data_ + offset, key_length);
+      offset += key_length;
+      uint64 record_offset;
+      ReadMapped(mmap_data_, mmap_size_, offset, &record_offset, 8, filename);
+      offset += 8;
+      if (record_offset + 16 > index_offset)
+        KALDI_ERR << "Corrupt index in " << PrintableRxfilename(filename);
+      if (!index_.empty() && !(index_.back().first < key))
+        KALDI_ERR << "Index of " << PrintableRxfilename(filename)
+                  << " is not sorted on key.";
+      index_.push_back(std::make_pair(key, record_offset));
+    }
+  } catch (...) {
+    Close();
+    throw;
+  }
+#endif
+}
+
+void MappedMatrixArchiveReader::Close() {
+#ifndef _MSC_VER
+  if (mmap_data_ != NULL)
+    munmap(mmap_data_, mmap_size_);
+#endif
+  mmap_data_ = NULL;
+  mmap_size_ = 0;
+  index_.clear();
+  filename_ = "";
+}
+
+// comparison on the key only, for looking up in the sorted index.
+static bool IndexEntryLess(const std::pair<std::string, uint64> &a,
+                           const std::pair<std::string, uint64> &b) {
+  return a.first < b.first;
+}
+
+bool MappedMatrixArchiveReader::HasKey(const std::string &key) const {
+  KALDI_ASSERT(IsOpen());
+  return std::binary_search(index_.begin(), index_.end(),
+                            std::make_pair(key, static_cast<uint64>(0)),
+                            IndexEntryLess);
+}
+
+SubMatrix<BaseFloat> MappedMatrixArchiveReader::Value(
+    const std::string &key) const {
+  KALDI_ASSERT(IsOpen());
+  std::vector<std::pair<std::string, uint64> >::const_iterator iter =
+      std::lower_bound(index_.begin(), index_.end(),
+                       std::make_pair(key, static_cast<uint64>(0)),
+                       IndexEntryLess);
+  if (iter == index_.end() || iter->first != key)
+    KALDI_ERR << "No key " << key << " in "
+              << PrintableRxfilename(filename_);
+  return RecordAt(iter->second);
+}
+
+const std::string &MappedMatrixArchiveReader::Key(int32 i) const {
+  KALDI_ASSERT(IsOpen() && i >= 0 &&
+               i < static_cast<int32>(index_.size()));
+  return index_[i].first;
+}
+
+SubMatrix<BaseFloat> MappedMatrixArchiveReader::Value(int32 i) const {
+  KALDI_ASSERT(IsOpen() && i >= 0 &&
+               i < static_cast<int32>(index_.size()));
+  return RecordAt(index_[i].second);
+}
+
+SubMatrix<BaseFloat> MappedMatrixArchiveReader::RecordAt(
+    uint64 offset) const {
+  int32 num_rows, num_cols;
+  ReadMapped(mmap_data_, mmap_size_, offset, &num_rows, 4, filename_);
+  ReadMapped(mmap_data_, mmap_size_, offset + 4, &num_cols, 4, filename_);
+  uint64 data_bytes = static_cast<uint64>(num_rows) * num_cols *
+      sizeof(BaseFloat);
+  if (num_rows < 0 || num_cols < 0 ||
+      offset + 16 + data_bytes > mmap_size_)
+    KALDI_ERR << "Corrupt record in " << PrintableRxfilename(filename_);
+  if (num_rows == 0 || num_cols == 0)
+    return SubMatrix<BaseFloat>(static_cast<BaseFloat*>(NULL), 0, 0, 0);
+  // Caution: the returned matrix must not be written to, as it points into
+  // the read-only mapped file.
+  BaseFloat *data = reinterpret_cast<BaseFloat*>(
+      const_cast<char*>(mmap_data_ + offset + 16));
+  return SubMatrix<BaseFloat>(data, num_rows, num_cols, num_cols);
+}
+
+}  // namespace kaldi
@@ -0,0 +1,144 @@
+// util/mapped-matrix-archive.h
+
+// Copyright 2015   Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_UTIL_MAPPED_MATRIX_ARCHIVE_H_
+#define KALDI_UTIL_MAPPED_MATRIX_ARCHIVE_H_
+
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/kaldi-common.h"
+#include "matrix/kaldi-matrix.h"
+
+namespace kaldi {
+
+/// \addtogroup io_group
+/// @{
+
+/// The classes in this file implement an archive format for uncompressed
+/// BaseFloat matrices that is designed for random access via mmap(), as an
+/// alternative to a regular Kaldi archive plus a separate .scp index when
+/// access is random and read-heavy (e.g. reading features while generating
+/// training examples).  The file contains fixed-layout records (the matrix
+/// dimensions followed by the row-major data, 16-byte aligned) and an
+/// embedded key index, sorted on the key, that is written at the end of the
+/// file; the reader maps the whole file and looks keys up by binary search,
+/// and Value() returns a SubMatrix that points directly into the mapped
+/// data, so no seek, parse or copy happens per access.
+///
+/// Caution: the data is stored in the byte order and BaseFloat precision of
+/// the machine that wrote it (the reader checks a header and will fail
+/// cleanly on a mismatch).  This is a storage format for use within a
+/// compute cluster, not an interchange format; use regular archives for
+/// that.
+
+/// MappedMatrixArchiveWriter writes an archive in the format described
+/// above.  Keys may be written in any order but must be distinct; the
+/// index is sorted when Close() is called.
+class MappedMatrixArchiveWriter {
+ public:
+  MappedMatrixArchiveWriter(): open_(false), data_offset_(0) { }
+
+  /// Opens the file, crashing via KALDI_ERR if it cannot be opened.  This is
+  /// a plain filename, not a wspecifier.
+  void Open(const std::string &filename);
+
+  bool IsOpen() const { return open_; }
+
+  /// Writes one record.  It is an error to write two records with the same
+  /// key (detected in Close()).
+  void Write(const std::string &key, const MatrixBase<BaseFloat> &mat);
+
+  /// Writes the index and the final header and closes the file; called from
+  /// the destructor if you do not call it.  It is an error to call Close()
+  /// if the writer is not open.
+  void Close();
+
+  ~MappedMatrixArchiveWriter() {
+    if (open_) Close();
+  }
+
+ private:
+  bool open_;
+  std::string filename_;  // for error messages.
+  std::ofstream stream_;
+  uint64 data_offset_;  // current offset in the file, in bytes.
+  // key and record offset of each record written, in the order written.
+  std::vector<std::pair<std::string, uint64> > index_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(MappedMatrixArchiveWriter);
+};
+
+
+/// MappedMatrixArchiveReader memory-maps an archive written by
+/// MappedMatrixArchiveWriter and provides random access by key with no
+/// per-access parsing or copying.  The SubMatrix returned by Value() points
+/// into the mapped file, so it remains valid only while this object is
+/// alive (and must not be written to).  HasKey() and Value() are const and
+/// may be called from multiple threads at once.
+class MappedMatrixArchiveReader {
+ public:
+  MappedMatrixArchiveReader(): mmap_data_(NULL), mmap_size_(0) { }
+
+  /// Maps the file and reads the index, crashing via KALDI_ERR on any
+  /// error (missing file, bad magic, wrong byte order or BaseFloat size).
+  /// This is a plain filename, not an rspecifier.
+  void Open(const std::string &filename);
+
+  bool IsOpen() const { return mmap_data_ != NULL; }
+
+  bool HasKey(const std::string &key) const;
+
+  /// Returns the matrix for this key as a view into the mapped file;
+  /// crashes via KALDI_ERR if the key is not present (call HasKey() first).
+  SubMatrix<BaseFloat> Value(const std::string &key) const;
+
+  /// Number of records in the archive.
+  int32 NumRecords() const { return static_cast<int32>(index_.size()); }
+
+  /// The i'th key, in sorted order; with Value(), this supports sequential
+  /// iteration over the archive.
+  const std::string &Key(int32 i) const;
+
+  SubMatrix<BaseFloat> Value(int32 i) const;
+
+  void Close();
+
+  ~MappedMatrixArchiveReader() { Close(); }
+
+ private:
+  // Returns the record at byte offset "offset" as a matrix view.
+  SubMatrix<BaseFloat> RecordAt(uint64 offset) const;
+
+  std::string filename_;  // for error messages.
+  char *mmap_data_;       // the mapped file, NULL if not open.
+  size_t mmap_size_;
+  // (key, record offset), sorted on the key.
+  std::vector<std::pair<std::string, uint64> > index_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(MappedMatrixArchiveReader);
+};
+
+/// @} end "addtogroup io_group"
+
+}  // namespace kaldi
+
+#endif  // KALDI_UTIL_MAPPED_MATRIX_ARCHIVE_H_
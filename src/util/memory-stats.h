@@ -0,0 +1,72 @@
+// util/memory-stats.h
+
+// Copyright 2015  Johns Hopkins University (author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_UTIL_MEMORY_STATS_H_
+#define KALDI_UTIL_MEMORY_STATS_H_
+
+#include <sstream>
+#include <string>
+
+#include "base/kaldi-common.h"
+
+namespace kaldi {
+
+/// This header defines the common currency for memory accounting across the
+/// decoding stack, so that server code can size its containers and plan
+/// per-stream capacity from measurements instead of trial and error.
+///
+/// The convention is that a component implements
+///    void GetMemoryStats(MemoryStats *stats) const;
+/// which *adds* its own usage to *stats (it does not overwrite it), so
+/// polling all the components of a stream into one struct gives the
+/// aggregate for that stream; the decoders, OnlineGenericBaseFeature, and
+/// the lattice-size functions in lat/lattice-functions.h follow it.
+/// Polling is intended to be cheap enough to do once per utterance.
+struct MemoryStats {
+  int64 cur_bytes;   // bytes currently holding live data (tokens and links
+                     // in use, buffered feature frames, ...).
+  int64 peak_bytes;  // bytes of backing storage actually allocated.  The
+                     // containers this accounts for (the decoders' object
+                     // pools and per-frame vectors, the online feature
+                     // buffer) do not shrink, so this is also the
+                     // high-water mark of cur_bytes, and it is what you
+                     // should use for capacity planning.
+
+  MemoryStats(): cur_bytes(0), peak_bytes(0) { }
+
+  /// Adds another component's (or another stream's) stats to this one.
+  void Add(const MemoryStats &other) {
+    cur_bytes += other.cur_bytes;
+    peak_bytes += other.peak_bytes;
+  }
+
+  void Reset() { cur_bytes = 0; peak_bytes = 0; }
+
+  /// Returns a short summary such as "cur-bytes=813248 peak-bytes=1262144",
+  /// e.g. for logging once per utterance.
+  std::string Info() const {
+    std::ostringstream os;
+    os << "cur-bytes=" << cur_bytes << " peak-bytes=" << peak_bytes;
+    return os.str();
+  }
+};
+
+}  // namespace kaldi
+
+#endif  // KALDI_UTIL_MEMORY_STATS_H_
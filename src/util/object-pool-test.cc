@@ -0,0 +1,111 @@
+// util/object-pool-test.cc
+
+// Copyright 2014   Johns Hopkins University
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "util/object-pool.h"
+#include <vector>
+
+namespace kaldi {
+
+// A token-like struct, similar to what the decoders put in the pool.
+struct TestToken {
+  double cost;
+  TestToken *next;
+  TestToken(double cost, TestToken *next): cost(cost), next(next) { }
+};
+
+void TestObjectPool() {
+  for (int32 iter = 0; iter < 10; iter++) {
+    size_t block_size = 1 + Rand() % 100;
+    ObjectPool<TestToken> pool(block_size);
+    std::vector<TestToken*> toks;
+    size_t num_toks = Rand() % 500;
+    for (size_t i = 0; i < num_toks; i++) {
+      TestToken *tok = new (pool.Malloc()) TestToken(i * 0.5, NULL);
+      toks.push_back(tok);
+    }
+    KALDI_ASSERT(pool.NumUsed() == num_toks);
+    // check the objects were constructed and did not overwrite each other.
+    for (size_t i = 0; i < num_toks; i++)
+      KALDI_ASSERT(toks[i]->cost == i * 0.5);
+    // free a random subset and make sure the storage gets reused.
+    size_t num_freed = 0;
+    for (size_t i = 0; i < toks.size(); i++) {
+      if (Rand() % 2 == 0) {
+        pool.Free(toks[i]);
+        toks[i] = NULL;
+        num_freed++;
+      }
+    }
+    KALDI_ASSERT(pool.NumUsed() == num_toks - num_freed);
+    for (size_t i = 0; i < num_freed; i++)
+      new (pool.Malloc()) TestToken(0.0, NULL);
+    KALDI_ASSERT(pool.NumUsed() == num_toks);
+    // byte accounting: used tracks NumUsed(); allocated never shrinks and
+    // is always at least the used amount.
+    KALDI_ASSERT(pool.UsedBytes() >= num_toks * sizeof(TestToken));
+    KALDI_ASSERT(pool.AllocatedBytes() >= pool.UsedBytes());
+    size_t allocated = pool.AllocatedBytes();
+    // bulk reset; everything becomes invalid but the pool stays usable.
+    pool.Clear();
+    KALDI_ASSERT(pool.NumUsed() == 0);
+    KALDI_ASSERT(pool.UsedBytes() == 0);
+    KALDI_ASSERT(pool.AllocatedBytes() == allocated);  // high-water mark.
+    for (size_t i = 0; i < num_toks; i++)
+      new (pool.Malloc()) TestToken(1.0, NULL);
+    KALDI_ASSERT(pool.NumUsed() == num_toks);
+  }
+}
+
+void TestObjectPoolIndexing() {
+  for (int32 iter = 0; iter < 10; iter++) {
+    size_t block_size = 1 + Rand() % 100;
+    ObjectPool<TestToken> pool(block_size);
+    std::vector<TestToken*> toks;
+    std::vector<uint32> indexes;
+    size_t num_toks = 1 + Rand() % 500;
+    for (size_t i = 0; i < num_toks; i++) {
+      TestToken *tok = new (pool.Malloc()) TestToken(i * 0.5, NULL);
+      uint32 index = pool.IndexOf(tok);
+      KALDI_ASSERT(index != ObjectPool<TestToken>::kNoIndex);
+      toks.push_back(tok);
+      indexes.push_back(index);
+    }
+    // Get() must invert IndexOf(), for objects allocated at any time (the
+    // indices must stay valid as more blocks get allocated).
+    for (size_t i = 0; i < num_toks; i++) {
+      KALDI_ASSERT(pool.Get(indexes[i]) == toks[i]);
+      KALDI_ASSERT(pool.IndexOf(toks[i]) == indexes[i]);
+      KALDI_ASSERT(pool.Get(indexes[i])->cost == i * 0.5);
+    }
+    // freed storage that gets reused must get the same index again (the
+    // index is a property of the slot).
+    size_t i = Rand() % num_toks;
+    pool.Free(toks[i]);
+    TestToken *tok = new (pool.Malloc()) TestToken(-1.0, NULL);
+    KALDI_ASSERT(tok == toks[i] && pool.IndexOf(tok) == indexes[i]);
+  }
+}
+
+}  // end namespace kaldi.
+
+int main() {
+  kaldi::TestObjectPool();
+  kaldi::TestObjectPoolIndexing();
+  std::cout << "Test OK.\n";
+}
@@ -0,0 +1,217 @@
+// util/object-pool.h
+
+// Copyright 2014   Johns Hopkins University
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_UTIL_OBJECT_POOL_H_
+#define KALDI_UTIL_OBJECT_POOL_H_
+#include <algorithm>
+#include <new>
+#include <utility>
+#include <vector>
+#include "base/kaldi-common.h"
+
+/* This header provides a memory pool for fixed-size objects.  It exists
+   because the decoders allocate and free very large numbers of tokens and
+   forward links on the frame loop, and doing this with individual new/delete
+   calls spends a substantial fraction of decoding time inside the global
+   allocator when beams are wide.  The pool carves objects out of large blocks,
+   keeps freed objects on a free list for reuse, and can return everything to
+   the free state in one go (see Clear()), which the decoders do in
+   InitDecoding() at the start of each utterance.
+
+   The pool hands out raw storage; the caller constructs objects into it with
+   placement new, e.g.
+      Token *tok = new (pool.Malloc()) Token(...);
+      ...
+      pool.Free(tok);
+   Objects stored in the pool should have trivial destructors (the pool does
+   not call destructors, in Free(), Clear() or on its own destruction).
+
+   The pool also supports addressing live objects by a 32-bit index (see
+   Get() and IndexOf()), which lets callers that keep very large numbers of
+   small linked objects store 4-byte indices instead of 8-byte pointers; the
+   lattice decoders use this for their compact forward-link representation.
+   To make the index arithmetic cheap, the block size is rounded up to a
+   power of two.
+
+   See object-pool-test.cc for an example of how to use this object.
+*/
+
+namespace kaldi {
+
+template<class T> class ObjectPool {
+ public:
+  /// A value that is never a valid object index; see IndexOf().
+  static const uint32 kNoIndex = 0xFFFFFFFF;
+
+  /// block_size is the number of objects we allocate from the global
+  /// allocator at a time; it gets rounded up to a power of two so that
+  /// indices (see Get() and IndexOf()) can be split into a block part and a
+  /// slot part with shifts and masks.
+  explicit ObjectPool(size_t block_size = 4096):
+      free_head_(NULL), num_used_(0) {
+    KALDI_ASSERT(block_size > 0);
+    block_bits_ = 0;
+    while ((static_cast<size_t>(1) << block_bits_) < block_size)
+      block_bits_++;
+    block_size_ = static_cast<size_t>(1) << block_bits_;
+    block_mask_ = static_cast<uint32>(block_size_ - 1);
+  }
+
+  ~ObjectPool() {
+    for (size_t i = 0; i < blocks_.size(); i++)
+      delete [] blocks_[i];
+  }
+
+  /// Returns storage for one object of type T; the caller should construct
+  /// into it with placement new.
+  inline void *Malloc() {
+    if (free_head_ == NULL) AllocateBlock();
+    FreeNode *node = free_head_;
+    free_head_ = node->next;
+    num_used_++;
+    return reinterpret_cast<void*>(node);
+  }
+
+  /// Returns to the pool storage previously obtained from Malloc().  Does not
+  /// call the destructor of the object.
+  inline void Free(void *ptr) {
+    FreeNode *node = reinterpret_cast<FreeNode*>(ptr);
+    node->next = free_head_;
+    free_head_ = node;
+    num_used_--;
+  }
+
+  /// Returns all storage to the free state in one go, keeping the underlying
+  /// blocks allocated for reuse.  All objects previously obtained from
+  /// Malloc() become invalid.  This is cheaper than freeing the objects one
+  /// by one, and is what the decoders call when starting a new utterance.
+  void Clear() {
+    free_head_ = NULL;
+    for (size_t i = 0; i < blocks_.size(); i++) {
+      char *block = blocks_[i];
+      for (size_t j = 0; j < block_size_; j++) {
+        FreeNode *node = reinterpret_cast<FreeNode*>(block + j * SlotSize());
+        node->next = free_head_;
+        free_head_ = node;
+      }
+    }
+    num_used_ = 0;
+  }
+
+  /// Returns the number of objects currently allocated from the pool
+  /// (i.e. obtained from Malloc() and not yet freed).
+  size_t NumUsed() const { return num_used_; }
+
+  /// Returns the bytes of object storage currently in use,
+  /// i.e. NumUsed() objects at one slot each.
+  size_t UsedBytes() const { return num_used_ * SlotSize(); }
+
+  /// Returns the bytes of object storage obtained from the global
+  /// allocator; the pool never gives blocks back, so this is also the
+  /// high-water mark of UsedBytes().  For memory accounting (see
+  /// util/memory-stats.h).
+  size_t AllocatedBytes() const {
+    return blocks_.size() * block_size_ * SlotSize();
+  }
+
+  /// Returns the object with the given index, which must have been obtained
+  /// from IndexOf() for an object that is still allocated.  This is a shift,
+  /// a mask and two loads, so it is cheap enough for hot loops.
+  inline T *Get(uint32 index) const {
+    KALDI_PARANOID_ASSERT((index >> block_bits_) < blocks_.size());
+    return reinterpret_cast<T*>(blocks_[index >> block_bits_] +
+                                (index & block_mask_) * SlotSize());
+  }
+
+  /// Returns the 32-bit index of an object obtained from Malloc() (and not
+  /// yet freed), such that Get(IndexOf(obj)) == obj.  Indices stay valid
+  /// until the object is freed or the pool is cleared.  This does a binary
+  /// search over the allocated blocks, so it is O(log(num-blocks)); the
+  /// returned value is never kNoIndex, which callers can use as a "null"
+  /// index.
+  uint32 IndexOf(const T *obj) const {
+    const char *ptr = reinterpret_cast<const char*>(obj);
+    // Find the last block whose base address is <= ptr.  The kNoIndex in
+    // the search key makes an entry with base address equal to ptr compare
+    // as less than the key, so it ends up on the left of the bound.
+    std::vector<std::pair<const char*, uint32> >::const_iterator iter =
+        std::upper_bound(sorted_blocks_.begin(), sorted_blocks_.end(),
+                         std::make_pair(ptr, kNoIndex));
+    KALDI_ASSERT(iter != sorted_blocks_.begin());
+    --iter;
+    size_t offset = ptr - iter->first;
+    KALDI_ASSERT(offset < block_size_ * SlotSize() &&
+                 offset % SlotSize() == 0);
+    return (iter->second << block_bits_) |
+        static_cast<uint32>(offset / SlotSize());
+  }
+
+ private:
+  // Freed slots are linked together through their own storage.
+  struct FreeNode {
+    FreeNode *next;
+  };
+
+  // Each slot must be big enough for both a T and a FreeNode.
+  static inline size_t SlotSize() {
+    return sizeof(T) > sizeof(FreeNode) ? sizeof(T) : sizeof(FreeNode);
+  }
+
+  void AllocateBlock() {
+    // Make sure the new block's indices fit in 32 bits (with kNoIndex
+    // reserved); at the default block size this allows over 10^9 objects.
+    KALDI_ASSERT(blocks_.size() <
+                 static_cast<size_t>(kNoIndex) >> block_bits_);
+    // new char[] returns storage suitably aligned for any object of that
+    // size, so we can carve objects of type T out of it.
+    char *block = new char[block_size_ * SlotSize()];
+    uint32 block_index = static_cast<uint32>(blocks_.size());
+    blocks_.push_back(block);
+    // keep sorted_blocks_ sorted by address, for IndexOf().
+    std::pair<const char*, uint32> entry(block, block_index);
+    sorted_blocks_.insert(std::upper_bound(sorted_blocks_.begin(),
+                                           sorted_blocks_.end(), entry),
+                          entry);
+    for (size_t j = 0; j < block_size_; j++) {
+      FreeNode *node = reinterpret_cast<FreeNode*>(block + j * SlotSize());
+      node->next = free_head_;
+      free_head_ = node;
+    }
+  }
+
+  size_t block_size_;  // always a power of two, 1 << block_bits_.
+  uint32 block_bits_;
+  uint32 block_mask_;  // == block_size_ - 1.
+  std::vector<char*> blocks_;  // all blocks we have allocated, in the order
+                               // they were allocated (indexable by the block
+                               // part of an object index).
+  // the same blocks sorted by address, each with its index into blocks_;
+  // used by IndexOf().
+  std::vector<std::pair<const char*, uint32> > sorted_blocks_;
+  FreeNode *free_head_;  // head of singly linked list of free slots.
+  size_t num_used_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(ObjectPool);
+};
+
+template<class T> const uint32 ObjectPool<T>::kNoIndex;
+
+}  // namespace kaldi
+
+#endif  // KALDI_UTIL_OBJECT_POOL_H_
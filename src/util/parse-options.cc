@@ -32,13 +32,16 @@
 #include "util/parse-options.h"
 #include "util/text-utils.h"
 #include "base/kaldi-common.h"
+#include "base/cpu-features.h"
+#include "base/kaldi-benchmark.h"
 
 namespace kaldi {
 
 
 ParseOptions::ParseOptions(const std::string &prefix,
                            OptionsItf *other):
-    print_args_(false), help_(false), usage_(""), argc_(0), argv_(NULL) {
+    print_args_(false), help_(false), version_(false), usage_(""), argc_(0),
+    argv_(NULL) {
   ParseOptions *po = dynamic_cast<ParseOptions*>(other);
   if (po != NULL && po->other_parser_ != NULL) {
     // we get here if this constructor is used twice, recursively.
@@ -352,6 +355,10 @@ int ParseOptions::Read(int argc, const char *const argv[]) {
         PrintUsage();
         exit(0);
       }
+      if (key.compare("version") == 0) {
+        PrintVersion();
+        exit(0);
+      }
     }
   }
   bool double_dash_seen = false;
@@ -399,6 +406,20 @@ int ParseOptions::Read(int argc, const char *const argv[]) {
 }
 
 
+void ParseOptions::PrintVersion() {
+  if (argc_ > 0) {  // argv_ was stored by Read() before we got here.
+#ifdef _MSC_VER
+    const char *c = strrchr(argv_[0], '\\');
+#else
+    const char *c = strrchr(argv_[0], '/');
+#endif
+    std::cout << (c == NULL ? argv_[0] : c + 1) << " ";
+  }
+  std::cout << "compiled " << __DATE__ << '\n'
+            << BenchmarkEnvironmentInfo()
+            << CpuDispatchReport() << '\n';
+}
+
 void ParseOptions::PrintUsage(bool print_command_line) {
   std::cerr << '\n' << usage_ << '\n';
   DocMapType::iterator it;
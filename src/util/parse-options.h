@@ -36,8 +36,8 @@ namespace kaldi {
 class ParseOptions : public OptionsItf {
  public:
   explicit ParseOptions(const char *usage) :
-    print_args_(true), help_(false), usage_(usage), argc_(0), argv_(NULL),
-    prefix_(""), other_parser_(NULL) {
+    print_args_(true), help_(false), version_(false), usage_(usage),
+    argc_(0), argv_(NULL), prefix_(""), other_parser_(NULL) {
 #ifndef _MSC_VER  // This is just a convenient place to set the stderr to line
     setlinebuf(stderr);  // buffering mode, since it's called at program start.
 #endif  // This helps ensure different programs' output is not mixed up.
@@ -46,6 +46,9 @@ class ParseOptions : public OptionsItf {
     RegisterStandard("print-args", &print_args_,
                      "Print the command line arguments (to stderr)");
     RegisterStandard("help", &help_, "Print out usage message");
+    RegisterStandard("version", &version_, "Print a description of the "
+                     "build and of the runtime CPU dispatch decision, and "
+                     "exit");
     RegisterStandard("verbose", &g_kaldi_verbose_level,
                      "Verbose level (higher->more logging)");
   }
@@ -108,6 +111,11 @@ class ParseOptions : public OptionsItf {
 
   /// Prints the usage documentation [provided in the constructor].
   void PrintUsage(bool print_command_line = false);
+  /// Prints (to stdout) a description of the build (compiler, precision,
+  /// BLAS library) and of the runtime CPU dispatch decision (see
+  /// base/cpu-features.h); this is what the standard --version option
+  /// prints before exiting.
+  void PrintVersion();
   /// Prints the actual configuration of all the registered variables
   void PrintConfig(std::ostream &os);
 
@@ -208,6 +216,7 @@ class ParseOptions : public OptionsItf {
 
   bool print_args_;     ///< variable for the implicit --print-args parameter
   bool help_;           ///< variable for the implicit --help parameter
+  bool version_;        ///< variable for the implicit --version parameter
   std::string config_;  ///< variable for the implicit --config parameter
   std::vector<std::string> positional_args_;
   const char *usage_;
@@ -0,0 +1,85 @@
+// util/shared-memory-io-test.cc
+
+// Copyright 2015  Johns Hopkins University (Author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "util/shared-memory-io.h"
+#include "matrix/kaldi-matrix.h"
+#include "base/kaldi-math.h"
+
+namespace kaldi {
+
+void UnitTestSharedMemorySegment() {
+  const char *name = "kaldi-shm-test-segment";
+  SharedMemorySegment::Remove(name);  // in case a previous run crashed.
+
+  SharedMemorySegment writer;
+  KALDI_ASSERT(!writer.IsOpen());
+  KALDI_ASSERT(writer.Create(name, 1000));
+  KALDI_ASSERT(writer.IsOpen() && writer.Size() == 1000);
+  for (int32 i = 0; i < 1000; i++)
+    writer.MutableData()[i] = static_cast<char>(i % 256);
+
+  {  // attaching before Publish() must fail.
+    SharedMemorySegment reader;
+    KALDI_ASSERT(!reader.Attach(name));
+  }
+  writer.Publish();
+  {
+    SharedMemorySegment reader;
+    KALDI_ASSERT(reader.Attach(name));
+    KALDI_ASSERT(reader.Size() == 1000);
+    for (int32 i = 0; i < 1000; i++)
+      KALDI_ASSERT(reader.Data()[i] == static_cast<char>(i % 256));
+  }
+  KALDI_ASSERT(SharedMemorySegment::Remove(name));
+  KALDI_ASSERT(!SharedMemorySegment::Remove(name));  // already gone.
+  {  // attaching a removed segment must fail.
+    SharedMemorySegment reader;
+    KALDI_ASSERT(!reader.Attach(name));
+  }
+}
+
+void UnitTestSharedMemoryObject() {
+  const char *name = "kaldi-shm-test-object";
+  SharedMemorySegment::Remove(name);
+
+  for (int32 iter = 0; iter < 5; iter++) {
+    Matrix<BaseFloat> mat(10 + Rand() % 50, 10 + Rand() % 50);
+    mat.SetRandn();
+    PublishSharedMemoryObject(name, mat);
+    // Attach more than once, as separate decoding processes would.
+    for (int32 i = 0; i < 3; i++) {
+      Matrix<BaseFloat> mat2;
+      AttachSharedMemoryObject(name, &mat2);
+      KALDI_ASSERT(mat2.NumRows() == mat.NumRows() &&
+                   mat2.NumCols() == mat.NumCols());
+      KALDI_ASSERT(mat.Equal(mat2));  // binary round trip is exact.
+    }
+  }
+  KALDI_ASSERT(RemoveSharedMemorySegment(name));
+}
+
+}  // namespace kaldi
+
+int main() {
+  using namespace kaldi;
+  UnitTestSharedMemorySegment();
+  UnitTestSharedMemoryObject();
+  std::cout << "Test OK.\n";
+  return 0;
+}
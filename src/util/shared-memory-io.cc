@@ -0,0 +1,212 @@
+// util/shared-memory-io.cc
+
+// Copyright 2015  Johns Hopkins University (Author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#include "util/shared-memory-io.h"
+
+#include <cstring>
+
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace kaldi {
+
+// Every segment we create starts with this header; the "ready" field is
+// written last (after the payload), so an attacher can tell a fully
+// published segment from one that a writer is still filling in.
+struct SharedMemoryHeader {
+  char magic[8];      // "KShmSeg1".
+  uint64 size;        // payload size in bytes.
+  volatile uint32 ready;
+  uint32 padding;     // keeps the payload 8-byte aligned.
+};
+
+static const char *kSharedMemoryMagic = "KShmSeg1";
+
+#ifndef _MSC_VER
+
+// shm_open() requires a name of the form "/somename"; we present users
+// with names not containing slashes and add the leading one here.
+static std::string ShmName(const std::string &name) {
+  KALDI_ASSERT(!name.empty() && name.find('/') == std::string::npos &&
+               "Shared-memory segment names may not contain '/'.");
+  return "/" + name;
+}
+
+SharedMemorySegment::SharedMemorySegment():
+    map_(NULL), map_size_(0), size_(0), writable_(false) { }
+
+SharedMemorySegment::~SharedMemorySegment() {
+  Close();
+}
+
+bool SharedMemorySegment::Create(const std::string &name, size_t size) {
+  KALDI_COMPILE_TIME_ASSERT(sizeof(SharedMemoryHeader) == 24);
+  Close();
+  std::string shm_name = ShmName(name);
+  int fd = shm_open(shm_name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    KALDI_WARN << "Failed to create shared-memory segment " << name
+               << ": " << strerror(errno);
+    return false;
+  }
+  map_size_ = sizeof(SharedMemoryHeader) + size;
+  if (ftruncate(fd, map_size_) != 0) {
+    KALDI_WARN << "Failed to size shared-memory segment " << name << " to "
+               << map_size_ << " bytes: " << strerror(errno);
+    close(fd);
+    shm_unlink(shm_name.c_str());
+    return false;
+  }
+  map_ = mmap(NULL, map_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);  // the mapping keeps its own reference to the segment.
+  if (map_ == MAP_FAILED) {
+    map_ = NULL;
+    KALDI_WARN << "Failed to map shared-memory segment " << name
+               << ": " << strerror(errno);
+    shm_unlink(shm_name.c_str());
+    return false;
+  }
+  size_ = size;
+  writable_ = true;
+  SharedMemoryHeader *hdr = static_cast<SharedMemoryHeader*>(map_);
+  std::memcpy(hdr->magic, kSharedMemoryMagic, 8);
+  hdr->size = size;
+  hdr->ready = 0;
+  hdr->padding = 0;
+  return true;
+}
+
+bool SharedMemorySegment::Attach(const std::string &name) {
+  Close();
+  std::string shm_name = ShmName(name);
+  int fd = shm_open(shm_name.c_str(), O_RDONLY, 0);
+  if (fd < 0) {
+    KALDI_WARN << "No shared-memory segment " << name << ": "
+               << strerror(errno);
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      static_cast<size_t>(st.st_size) < sizeof(SharedMemoryHeader)) {
+    KALDI_WARN << "Shared-memory segment " << name << " is too small to be "
+               << "one of ours.";
+    close(fd);
+    return false;
+  }
+  map_size_ = st.st_size;
+  map_ = mmap(NULL, map_size_, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map_ == MAP_FAILED) {
+    map_ = NULL;
+    KALDI_WARN << "Failed to map shared-memory segment " << name
+               << ": " << strerror(errno);
+    return false;
+  }
+  const SharedMemoryHeader *hdr =
+      static_cast<const SharedMemoryHeader*>(map_);
+  if (std::memcmp(hdr->magic, kSharedMemoryMagic, 8) != 0 ||
+      hdr->size != map_size_ - sizeof(SharedMemoryHeader)) {
+    KALDI_WARN << "Shared-memory segment " << name << " was not written by "
+               << "PublishSharedMemoryObject (bad magic or size).";
+    Close();
+    return false;
+  }
+  if (hdr->ready == 0) {
+    KALDI_WARN << "Shared-memory segment " << name << " has not been "
+               << "published yet (the writer may still be filling it in).";
+    Close();
+    return false;
+  }
+  size_ = hdr->size;
+  writable_ = false;
+  return true;
+}
+
+void SharedMemorySegment::Publish() {
+  KALDI_ASSERT(map_ != NULL && writable_);
+  SharedMemoryHeader *hdr = static_cast<SharedMemoryHeader*>(map_);
+  __sync_synchronize();  // the payload must be visible before the ready
+                         // flag that publishes it.
+  hdr->ready = 1;
+}
+
+const char *SharedMemorySegment::Data() const {
+  KALDI_ASSERT(map_ != NULL);
+  return static_cast<const char*>(map_) + sizeof(SharedMemoryHeader);
+}
+
+char *SharedMemorySegment::MutableData() {
+  KALDI_ASSERT(map_ != NULL && writable_);
+  return static_cast<char*>(map_) + sizeof(SharedMemoryHeader);
+}
+
+void SharedMemorySegment::Close() {
+  if (map_ != NULL)
+    munmap(map_, map_size_);
+  map_ = NULL;
+  map_size_ = 0;
+  size_ = 0;
+  writable_ = false;
+}
+
+bool SharedMemorySegment::Remove(const std::string &name) {
+  return shm_unlink(ShmName(name).c_str()) == 0;
+}
+
+#else  // _MSC_VER
+
+// Windows has a different shared-memory interface (CreateFileMapping);
+// this could be implemented if anyone needs it there.
+
+SharedMemorySegment::SharedMemorySegment():
+    map_(NULL), map_size_(0), size_(0), writable_(false) { }
+
+SharedMemorySegment::~SharedMemorySegment() { }
+
+bool SharedMemorySegment::Create(const std::string &name, size_t size) {
+  KALDI_ERR << "Shared-memory segments are not supported on Windows.";
+  return false;
+}
+
+bool SharedMemorySegment::Attach(const std::string &name) {
+  KALDI_ERR << "Shared-memory segments are not supported on Windows.";
+  return false;
+}
+
+void SharedMemorySegment::Publish() {
+  KALDI_ERR << "Shared-memory segments are not supported on Windows.";
+}
+
+const char *SharedMemorySegment::Data() const { return NULL; }
+
+char *SharedMemorySegment::MutableData() { return NULL; }
+
+void SharedMemorySegment::Close() { }
+
+bool SharedMemorySegment::Remove(const std::string &name) {
+  return false;
+}
+
+#endif  // _MSC_VER
+
+}  // namespace kaldi
@@ -0,0 +1,193 @@
+// util/shared-memory-io.h
+
+// Copyright 2015  Johns Hopkins University (Author: Daniel Povey)
+
+// See ../../COPYING for clarification regarding multiple authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+// THIS CODE IS PROVIDED *AS IS* BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION ANY IMPLIED
+// WARRANTIES OR CONDITIONS OF TITLE, FITNESS FOR A PARTICULAR PURPOSE,
+// MERCHANTABLITY OR NON-INFRINGEMENT.
+// See the Apache 2 License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KALDI_UTIL_SHARED_MEMORY_IO_H_
+#define KALDI_UTIL_SHARED_MEMORY_IO_H_
+
+#include <sstream>
+#include <streambuf>
+#include <string>
+
+#include "base/kaldi-common.h"
+
+namespace kaldi {
+
+/**
+   This header supports sharing the serialized image of read-only objects
+   (models, transition models, decoding graphs) between processes on one
+   machine via POSIX shared memory, so that many decoding processes on a
+   box do not each read the model from disk at startup.  One process
+   publishes the object's standard binary serialization into a named
+   shared-memory segment; any number of processes then attach the segment
+   read-only and deserialize from it, paying no disk I/O and sharing the
+   physical pages of the image.
+
+   Usage, writer side (once per machine):
+     PublishSharedMemoryObject("am-model", am_gmm);
+   reader side (each process):
+     AmDiagGmm am_gmm;
+     AttachSharedMemoryObject("am-model", &am_gmm);
+   and when no process needs it any more:
+     RemoveSharedMemorySegment("am-model");
+   (segments persist until removed or the machine reboots, like files in
+   /dev/shm).
+
+   Note: what is shared is the flat serialized image, not the live C++
+   object; each process still builds its own in-memory copy when it
+   deserializes.  Sharing the live objects themselves would require the
+   model classes to store offsets instead of pointers, which would be a
+   much more invasive change.
+
+   This is POSIX-only; on Windows these calls throw.
+*/
+
+
+/// A shared-memory segment created with shm_open()/mmap().  This is the
+/// low-level interface; most code should use PublishSharedMemoryObject()
+/// and AttachSharedMemoryObject() below.  "name" arguments are
+/// filesystem-like names without slashes, e.g. "kaldi-am-model"; they
+/// live in a per-machine namespace (on Linux, /dev/shm).
+class SharedMemorySegment {
+ public:
+  SharedMemorySegment();
+
+  ~SharedMemorySegment();  // Unmaps (but does not remove) the segment.
+
+  /// Creates (or overwrites) the named segment with room for "size" bytes
+  /// of payload, mapped for writing.  Fill the payload via MutableData()
+  /// and then call Publish(); attachers will refuse to attach before
+  /// Publish() has been called.  Returns false (printing a warning) on
+  /// failure, e.g. if shared memory is not available or over quota.
+  bool Create(const std::string &name, size_t size);
+
+  /// Attaches the named segment read-only.  Returns false (printing a
+  /// warning) if it does not exist, was not published yet, or is not a
+  /// segment we wrote.
+  bool Attach(const std::string &name);
+
+  /// Marks a segment we created as complete, so attachers will accept it.
+  /// Call this after filling in the payload.
+  void Publish();
+
+  bool IsOpen() const { return map_ != NULL; }
+
+  /// Payload size in bytes (not counting our internal header).
+  size_t Size() const { return size_; }
+
+  /// Pointer to the payload; valid for the lifetime of this object.
+  const char *Data() const;
+
+  /// Writable pointer to the payload; only for segments we Create()d.
+  char *MutableData();
+
+  /// Unmaps the segment; the segment itself stays in shared memory.
+  void Close();
+
+  /// Removes the named segment from the machine (like unlinking a file;
+  /// existing mappings stay valid until unmapped).  Returns false if no
+  /// such segment existed.
+  static bool Remove(const std::string &name);
+
+ private:
+  void *map_;       // the whole mapping, starting with our header.
+  size_t map_size_; // size of the mapping, header included.
+  size_t size_;     // payload size.
+  bool writable_;
+
+  KALDI_DISALLOW_COPY_AND_ASSIGN(SharedMemorySegment);
+};
+
+
+/// A read-only streambuf over a block of memory, used to deserialize
+/// objects straight out of a shared-memory segment without copying the
+/// image.
+class MemoryInputBuffer: public std::streambuf {
+ public:
+  MemoryInputBuffer(const char *data, size_t size) {
+    char *p = const_cast<char*>(data);
+    setg(p, p, p + size);
+  }
+ protected:
+  virtual std::streampos seekoff(std::streamoff off,
+                                 std::ios_base::seekdir way,
+                                 std::ios_base::openmode which) {
+    if (!(which & std::ios_base::in))
+      return std::streampos(std::streamoff(-1));
+    char *target;
+    if (way == std::ios_base::beg) target = eback() + off;
+    else if (way == std::ios_base::cur) target = gptr() + off;
+    else target = egptr() + off;
+    if (target < eback() || target > egptr())
+      return std::streampos(std::streamoff(-1));
+    setg(eback(), target, egptr());
+    return std::streampos(target - eback());
+  }
+  virtual std::streampos seekpos(std::streampos pos,
+                                 std::ios_base::openmode which) {
+    return seekoff(std::streamoff(pos), std::ios_base::beg, which);
+  }
+};
+
+
+/// Serializes "obj" in binary mode (via its Write function) into the
+/// named shared-memory segment, creating or overwriting it, and publishes
+/// it for attachers.  Throws on failure.
+template<class Object>
+void PublishSharedMemoryObject(const std::string &name, const Object &obj) {
+  std::ostringstream os(std::ios_base::out | std::ios_base::binary);
+  obj.Write(os, true);
+  if (os.fail())
+    KALDI_ERR << "PublishSharedMemoryObject: error serializing object for "
+              << "shared-memory segment " << name;
+  const std::string &image = os.str();
+  SharedMemorySegment segment;
+  if (!segment.Create(name, image.size()))
+    KALDI_ERR << "PublishSharedMemoryObject: could not create shared-memory "
+              << "segment " << name << " of size " << image.size();
+  memcpy(segment.MutableData(), image.data(), image.size());
+  segment.Publish();
+}
+
+/// Initializes "obj" (via its Read function) from the image previously
+/// placed in the named shared-memory segment by
+/// PublishSharedMemoryObject().  Throws if the segment does not exist or
+/// was not published.
+template<class Object>
+void AttachSharedMemoryObject(const std::string &name, Object *obj) {
+  SharedMemorySegment segment;
+  if (!segment.Attach(name))
+    KALDI_ERR << "AttachSharedMemoryObject: could not attach shared-memory "
+              << "segment " << name << " (was it published?)";
+  MemoryInputBuffer buf(segment.Data(), segment.Size());
+  std::istream is(&buf);
+  obj->Read(is, true);
+  if (is.fail())
+    KALDI_ERR << "AttachSharedMemoryObject: error deserializing object from "
+              << "shared-memory segment " << name;
+}
+
+/// Removes the named shared-memory segment; returns false if it did not
+/// exist.  See SharedMemorySegment::Remove.
+inline bool RemoveSharedMemorySegment(const std::string &name) {
+  return SharedMemorySegment::Remove(name);
+}
+
+}  // namespace kaldi
+
+#endif  // KALDI_UTIL_SHARED_MEMORY_IO_H_
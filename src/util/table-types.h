@@ -44,6 +44,12 @@ typedef RandomAccessTableReader<KaldiObjectHolder<Matrix<double> > >  RandomAcce
 typedef RandomAccessTableReaderMapped<KaldiObjectHolder<Matrix<double> > >  RandomAccessDoubleMatrixReaderMapped;
 
 typedef TableWriter<KaldiObjectHolder<CompressedMatrix> >  CompressedMatrixWriter;
+// Reading an archive as CompressedMatrix (rather than as Matrix<BaseFloat>,
+// which decompresses each utterance into a full float matrix on Read) is
+// useful together with CompressedMatrixRowStream in code that only scans
+// the rows; see compressed-matrix.h.
+typedef SequentialTableReader<KaldiObjectHolder<CompressedMatrix> >  SequentialCompressedMatrixReader;
+typedef RandomAccessTableReader<KaldiObjectHolder<CompressedMatrix> >  RandomAccessCompressedMatrixReader;
 
 typedef TableWriter<KaldiObjectHolder<Vector<BaseFloat> > >  BaseFloatVectorWriter;
 typedef SequentialTableReader<KaldiObjectHolder<Vector<BaseFloat> > >  SequentialBaseFloatVectorReader;
@@ -118,6 +118,65 @@ void TestSplitStringToIntegers() {
 
 
 
+void TestSplitStringOnWhitespace() {
+  {
+    std::vector<std::string> v;
+    SplitStringOnWhitespace("", &v);
+    KALDI_ASSERT(v.empty());
+    SplitStringOnWhitespace(" \t\r\n", &v);
+    KALDI_ASSERT(v.empty());
+    SplitStringOnWhitespace(" a\tbb  c ", &v);
+    KALDI_ASSERT(v.size() == 3 && v[0] == "a" && v[1] == "bb" && v[2] == "c");
+  }
+  // check agreement with the general version on random strings.
+  for (int j = 0; j < 100; j++) {
+    std::string full;
+    int sz = Rand() % 73;
+    for (int i = 0; i < sz; i++)
+      full.push_back(GetRandChar());
+    std::vector<std::string> v1, v2;
+    SplitStringOnWhitespace(full, &v1);
+    SplitStringToVector(full, " \t\n\r\f\v", true, &v2);
+    KALDI_ASSERT(v1 == v2);
+  }
+}
+
+void TestConvertLineToIntegers() {
+  {
+    std::vector<int32> v;
+    KALDI_ASSERT(ConvertLineToIntegers(" 1 -2\t3 ", &v) == true
+           && v.size() == 3 && v[0] == 1 && v[1] == -2 && v[2] == 3);
+    KALDI_ASSERT(ConvertLineToIntegers("", &v) == true && v.empty());
+    KALDI_ASSERT(ConvertLineToIntegers("  \t", &v) == true && v.empty());
+    KALDI_ASSERT(ConvertLineToIntegers("1 2.5 3", &v) == false);
+    KALDI_ASSERT(ConvertLineToIntegers("1 foo", &v) == false);
+    KALDI_ASSERT(ConvertLineToIntegers("1 -", &v) == false);
+    KALDI_ASSERT(ConvertLineToIntegers("12345678901234567890123", &v) ==
+                 false);  // overflows long long.
+    KALDI_ASSERT(ConvertLineToIntegers("2147483648", &v) == false);
+    // does not fit in int32.
+  }
+  {
+    std::vector<uint32> v;
+    KALDI_ASSERT(ConvertLineToIntegers("-1 2", &v) == false);
+    // cannot put negative number in uint32.
+  }
+  // check agreement with SplitStringToIntegers on random integer lines.
+  for (int j = 0; j < 100; j++) {
+    std::string full;
+    int sz = Rand() % 10;
+    for (int i = 0; i < sz; i++) {
+      char buf[30];
+      snprintf(buf, sizeof(buf), "%d ", static_cast<int>(Rand() - Rand()));
+      full += buf;
+    }
+    std::vector<int32> v1, v2;
+    KALDI_ASSERT(ConvertLineToIntegers(full, &v1) == true);
+    KALDI_ASSERT(SplitStringToIntegers(full, " ", true, &v2) == true);
+    KALDI_ASSERT(v1 == v2);
+  }
+}
+
 void TestSplitStringToFloats() {
   {
     std::vector<float> v;
@@ -245,6 +304,8 @@ int main() {
   using namespace kaldi;
   TestSplitStringToVector();
   TestSplitStringToIntegers();
+  TestSplitStringOnWhitespace();
+  TestConvertLineToIntegers();
   TestSplitStringToFloats();
   TestConvertStringToInteger();
   TestConvertStringToReal<float>();
@@ -72,6 +72,18 @@ void SplitStringToVector(const std::string &full, const char *delim,
   }
 }
 
+void SplitStringOnWhitespace(const std::string &full,
+                             std::vector<std::string> *out) {
+  out->clear();
+  const char *p = full.c_str(), *end = p + full.size();
+  while (p != end) {
+    if (IsWhitespaceChar(*p)) { p++; continue; }
+    const char *token_begin = p;
+    while (p != end && !IsWhitespaceChar(*p)) p++;
+    out->push_back(std::string(token_begin, p));
+  }
+}
+
 void JoinVectorToString(const std::vector<std::string> &vec_in,
                         const char *delim, bool omit_empty_strings,
                         std::string *str_out) {
@@ -21,6 +21,7 @@
 #define KALDI_UTIL_TEXT_UTILS_H_
 
 #include <algorithm>
+#include <limits>
 #include <map>
 #include <set>
 #include <string>
@@ -42,6 +43,60 @@ void SplitStringToVector(const std::string &full, const char *delim,
                          bool omit_empty_strings,
                          std::vector<std::string> *out);
 
+/// Returns true if c is one of the whitespace characters " \t\n\r\f\v".
+/// Faster than isspace() (no locale machinery); used by the specialized
+/// tokenizing functions below.
+inline bool IsWhitespaceChar(char c) {
+  switch (c) {
+    case ' ': case '\t': case '\n': case '\r': case '\f': case '\v':
+      return true;
+    default:
+      return false;
+  }
+}
+
+/// Splits the string on whitespace, omitting empty strings: equivalent to
+/// SplitStringToVector(full, " \t\n\r\f\v", true, out) but in a single pass
+/// with one comparison per character, instead of a find_first_of() scan over
+/// the delimiter set.  This is the inner loop of reading transcripts and
+/// other text tables (see TokenVectorHolder), hence the specialized version.
+void SplitStringOnWhitespace(const std::string &full,
+                             std::vector<std::string> *out);
+
+/// Parses a line of whitespace-separated integers into *out in a single
+/// pass, without creating per-token temporaries.  Returns false, leaving
+/// *out in an undefined state, if any token is not an integer that fits in
+/// I; the caller can then fall back to more general (slower) parsing.
+/// BasicVectorHolder uses this as the fast path when reading text-form
+/// alignments and the like.
+template<class I>
+bool ConvertLineToIntegers(const std::string &line, std::vector<I> *out) {
+  KALDI_ASSERT(out != NULL);
+  out->clear();
+  const char *p = line.c_str(), *end = p + line.size();
+  const long long max_ll = std::numeric_limits<long long>::max();
+  while (p != end) {
+    if (IsWhitespaceChar(*p)) { p++; continue; }
+    bool negative = (*p == '-');
+    if (*p == '-' || *p == '+') p++;
+    if (p == end || *p < '0' || *p > '9') return false;
+    long long value = 0;
+    do {
+      int digit = *p - '0';
+      if (value > (max_ll - digit) / 10) return false;  // would overflow.
+      value = value * 10 + digit;
+      p++;
+    } while (p != end && *p >= '0' && *p <= '9');
+    if (p != end && !IsWhitespaceChar(*p)) return false;
+    if (negative) value = -value;
+    I converted = static_cast<I>(value);
+    if (static_cast<long long>(converted) != value)
+      return false;  // doesn't fit in I (or rounds, if I is floating).
+    out->push_back(converted);
+  }
+  return true;
+}
+
 /// Joins the elements of a vector of strings into a single string using
 /// "delim" as the delimiter. If omit_empty_strings == true, any empty strings
 /// in the vector are skipped. A vector of empty strings results in an empty